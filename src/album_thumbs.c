@@ -0,0 +1,446 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "defines.h"
+#include "api.h"
+#include "album_thumbs.h"
+#include "library.h"
+#include "folder_art.h"
+#include "radio_album_art.h"
+#include "jobs.h"
+#include "memstats.h"
+#include "art_scale.h"
+
+#define THUMBS_MAGIC 0x4854504D         // "MPTH"
+#define THUMBS_VERSION 1
+#define THUMB_BYTES (ALBUM_THUMB_SIZE * ALBUM_THUMB_SIZE * 4)
+#define THUMB_HAS_PIXELS 1
+#define THUMB_NO_COVER (-1)             // Index offset of an album known to have no cover
+#define THUMB_NOT_STORED (-2)
+#define THUMB_COVER_MAX (16 * 1024 * 1024)  // Larger images aren't decoded for a thumbnail
+#define INDEX_MIN_CAPACITY 256
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      // ALBUM_THUMB_SIZE
+    uint32_t reserved;
+} ThumbsHeader;
+
+// Followed by THUMB_BYTES of SDL_PIXELFORMAT_RGBA8888 with THUMB_HAS_PIXELS
+typedef struct {
+    uint64_t key;
+    uint32_t flags;
+    uint32_t reserved;
+} ThumbEntry;
+
+// Entries of the file: key -> offset of its pixels or THUMB_NO_COVER
+typedef struct {
+    uint64_t key;                       // 0 = free
+    int64_t offset;
+} ThumbIndexSlot;
+
+typedef enum {
+    CELL_FREE,
+    CELL_LOADING,
+    CELL_READY,
+    CELL_NO_COVER
+} CellState;
+
+typedef struct {
+    uint32_t album;                     // Library string offset
+    uint8_t state;                      // CellState
+    uint32_t used;                      // LRU clock
+    uint32_t load;                      // Id of the load filling it
+} AtlasCell;
+
+// One cell being filled, owned by its job
+typedef struct {
+    uint32_t generation;                // Of the cells, or prepare_generation for a prepare
+    uint32_t load;
+    int cell;                           // -1: made for the file only (AlbumThumbs_prepare)
+    uint64_t key;
+    int64_t offset;                     // Pixels in the file, or THUMB_NOT_STORED: make them
+    int64_t stored;                     // Where a made thumbnail went (THUMB_NOT_STORED: nowhere)
+    char path[512];                     // First track of the album
+    uint32_t art_offset;                // Its embedded cover
+    uint32_t art_size;
+    uint8_t* pixels;                    // Result (NULL: no cover)
+} ThumbLoad;
+
+// The file is shared with the jobs; everything else is the main thread's
+static int thumbs_fd = -1;
+static int64_t thumbs_end = 0;          // Where the next entry goes
+static pthread_mutex_t file_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ThumbIndexSlot* thumb_index = NULL;
+static int index_capacity = 0;
+static int index_count = 0;
+
+static SDL_Surface* atlas = NULL;
+static AtlasCell cells[ALBUM_THUMBS_ATLAS_CELLS];
+static uint32_t cell_clock = 0;
+static uint32_t load_counter = 0;
+static int loads_running = 0;
+static uint32_t generation = 0;         // Bumped when the cells are dropped
+static uint32_t prepare_generation = 0; // Bumped to cancel the prepares queued (read by the jobs)
+static bool updated = false;
+
+// FNV-1a over the album name and the first track's mtime and size
+static uint64_t thumb_key(const char* album, const LibraryRecord* record) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (const char* c = album; *c; c++) {
+        hash = (hash ^ (uint8_t)*c) * 1099511628211ULL;
+    }
+    int64_t stamp[2] = {record->mtime, record->size};
+    const uint8_t* bytes = (const uint8_t*)stamp;
+    for (size_t i = 0; i < sizeof(stamp); i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+static ThumbIndexSlot* index_find(uint64_t key) {
+    if (index_capacity == 0) return NULL;
+    uint32_t mask = index_capacity - 1;
+    for (uint32_t i = (uint32_t)key & mask;; i = (i + 1) & mask) {
+        if (thumb_index[i].key == key) return &thumb_index[i];
+        if (thumb_index[i].key == 0) return NULL;
+    }
+}
+
+static void index_insert(ThumbIndexSlot* table, int capacity, uint64_t key, int64_t offset) {
+    uint32_t mask = capacity - 1;
+    uint32_t i = (uint32_t)key & mask;
+    while (table[i].key != 0 && table[i].key != key) i = (i + 1) & mask;
+    table[i].key = key;
+    table[i].offset = offset;
+}
+
+// Add or replace an entry, growing the table past 3/4 full
+static void index_put(uint64_t key, int64_t offset) {
+    ThumbIndexSlot* slot = index_find(key);
+    if (slot) {
+        slot->offset = offset;
+        return;
+    }
+    if ((index_count + 1) * 4 > index_capacity * 3) {
+        int capacity = index_capacity ? index_capacity * 2 : INDEX_MIN_CAPACITY;
+        ThumbIndexSlot* table = MEM_CALLOC(MEM_TAG_THUMBS, capacity, sizeof(ThumbIndexSlot));
+        if (!table) return;
+        for (int i = 0; i < index_capacity; i++) {
+            if (thumb_index[i].key) index_insert(table, capacity, thumb_index[i].key, thumb_index[i].offset);
+        }
+        MEM_FREE(MEM_TAG_THUMBS, thumb_index);
+        thumb_index = table;
+        index_capacity = capacity;
+    }
+    index_insert(thumb_index, index_capacity, key, offset);
+    index_count++;
+}
+
+// Open the file and index its entries; one in a bad state, or grown past
+// ALBUM_THUMBS_FILE_MAX, starts over
+static void open_file(void) {
+    int fd = open(ALBUM_THUMBS_FILE, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return;
+
+    struct stat st;
+    ThumbsHeader header;
+    bool valid = fstat(fd, &st) == 0 && st.st_size <= ALBUM_THUMBS_FILE_MAX &&
+                 pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                 header.magic == THUMBS_MAGIC && header.version == THUMBS_VERSION &&
+                 header.size == ALBUM_THUMB_SIZE;
+    int64_t end = sizeof(header);
+    if (valid) {
+        // An entry torn by a crash mid-append is cut off
+        ThumbEntry entry;
+        while (pread(fd, &entry, sizeof(entry), end) == sizeof(entry)) {
+            int64_t pixels = end + sizeof(entry);
+            int64_t next = pixels + ((entry.flags & THUMB_HAS_PIXELS) ? THUMB_BYTES : 0);
+            if (next > st.st_size) break;
+            index_put(entry.key, (entry.flags & THUMB_HAS_PIXELS) ? pixels : THUMB_NO_COVER);
+            end = next;
+        }
+        if (end < st.st_size && ftruncate(fd, end) != 0) {
+            close(fd);
+            return;
+        }
+    } else {
+        memset(&header, 0, sizeof(header));
+        header.magic = THUMBS_MAGIC;
+        header.version = THUMBS_VERSION;
+        header.size = ALBUM_THUMB_SIZE;
+        if (ftruncate(fd, 0) != 0 || pwrite(fd, &header, sizeof(header), 0) != sizeof(header)) {
+            close(fd);
+            return;
+        }
+    }
+
+    pthread_mutex_lock(&file_mutex);
+    thumbs_fd = fd;
+    thumbs_end = end;
+    pthread_mutex_unlock(&file_mutex);
+}
+
+// Read and decode a cover image (at display size)
+static SDL_Surface* read_cover(const char* path, long offset, uint32_t size) {
+    if (size == 0 || size > THUMB_COVER_MAX) return NULL;
+    SDL_Surface* art = NULL;
+    FILE* f = fopen(path, "rb");
+    if (f) {
+        uint8_t* data = malloc(size);
+        if (data && fseek(f, offset, SEEK_SET) == 0 && fread(data, 1, size, f) == size) {
+            art = radio_album_art_decode(data, size);
+        }
+        free(data);
+        fclose(f);
+    }
+    return art;
+}
+
+// Thumbnail of the first track's embedded cover, else its folder image: the
+// centre square scaled to ALBUM_THUMB_SIZE. NULL if there is neither.
+static uint8_t* make_thumb(const ThumbLoad* load) {
+    SDL_Surface* art = read_cover(load->path, load->art_offset, load->art_size);
+    FolderArt folder;
+    if (!art && FolderArt_find(load->path, &folder)) art = read_cover(folder.path, 0, folder.size);
+    if (!art) return NULL;
+
+    uint8_t* pixels = NULL;
+    SDL_Surface* thumb = SDL_CreateRGBSurfaceWithFormat(0, ALBUM_THUMB_SIZE, ALBUM_THUMB_SIZE, 32,
+                                                        SDL_PIXELFORMAT_RGBA8888);
+    if (thumb) {
+        int side = art->w < art->h ? art->w : art->h;
+        SDL_Rect crop = {(art->w - side) / 2, (art->h - side) / 2, side, side};
+        if (ArtScale_blit(art, &crop, thumb) == 0 && SDL_LockSurface(thumb) == 0) {
+            pixels = malloc(THUMB_BYTES);
+            if (pixels) {
+                for (int y = 0; y < ALBUM_THUMB_SIZE; y++) {
+                    memcpy(pixels + y * ALBUM_THUMB_SIZE * 4, (uint8_t*)thumb->pixels + y * thumb->pitch,
+                           ALBUM_THUMB_SIZE * 4);
+                }
+            }
+            SDL_UnlockSurface(thumb);
+        }
+        SDL_FreeSurface(thumb);
+    }
+    SDL_FreeSurface(art);
+    return pixels;
+}
+
+// Append an entry (pixels NULL: the album has no cover); sets load->stored
+static void store_thumb(ThumbLoad* load) {
+    ThumbEntry entry = {load->key, load->pixels ? THUMB_HAS_PIXELS : 0, 0};
+    int64_t length = sizeof(entry) + (load->pixels ? THUMB_BYTES : 0);
+
+    pthread_mutex_lock(&file_mutex);
+    if (thumbs_fd >= 0 && thumbs_end + length <= ALBUM_THUMBS_FILE_MAX &&
+        pwrite(thumbs_fd, &entry, sizeof(entry), thumbs_end) == sizeof(entry) &&
+        (!load->pixels || pwrite(thumbs_fd, load->pixels, THUMB_BYTES, thumbs_end + sizeof(entry)) == THUMB_BYTES)) {
+        load->stored = load->pixels ? thumbs_end + (int64_t)sizeof(entry) : THUMB_NO_COVER;
+        thumbs_end += length;
+    }
+    pthread_mutex_unlock(&file_mutex);
+}
+
+static void thumb_load_job(void* arg, JobToken* token) {
+    ThumbLoad* load = (ThumbLoad*)arg;
+    if (load->offset >= 0) {
+        load->pixels = malloc(THUMB_BYTES);
+        if (!load->pixels) return;
+        pthread_mutex_lock(&file_mutex);
+        bool ok = thumbs_fd >= 0 && pread(thumbs_fd, load->pixels, THUMB_BYTES, load->offset) == THUMB_BYTES;
+        pthread_mutex_unlock(&file_mutex);
+        if (!ok) {
+            free(load->pixels);
+            load->pixels = NULL;
+        }
+        return;
+    }
+    if (Jobs_cancelled(token)) return;
+    if (load->cell < 0 && load->generation != __atomic_load_n(&prepare_generation, __ATOMIC_ACQUIRE)) return;
+    load->pixels = make_thumb(load);
+    store_thumb(load);
+}
+
+static void thumb_load_done(void* arg, bool cancelled) {
+    ThumbLoad* load = (ThumbLoad*)arg;
+    if (load->stored != THUMB_NOT_STORED && thumbs_fd >= 0) index_put(load->key, load->stored);
+    if (load->cell < 0) {
+        free(load->pixels);
+        free(load);
+        return;
+    }
+    loads_running--;
+
+    AtlasCell* cell = &cells[load->cell];
+    if (atlas && load->generation == generation && cell->state == CELL_LOADING && cell->load == load->load) {
+        if (cancelled) {
+            cell->state = CELL_FREE;
+        } else if (load->pixels && SDL_LockSurface(atlas) == 0) {
+            int x = (load->cell % ALBUM_THUMBS_ATLAS_COLS) * ALBUM_THUMB_SIZE;
+            int y = (load->cell / ALBUM_THUMBS_ATLAS_COLS) * ALBUM_THUMB_SIZE;
+            for (int row = 0; row < ALBUM_THUMB_SIZE; row++) {
+                memcpy((uint8_t*)atlas->pixels + (y + row) * atlas->pitch + x * 4,
+                       load->pixels + row * ALBUM_THUMB_SIZE * 4, ALBUM_THUMB_SIZE * 4);
+            }
+            SDL_UnlockSurface(atlas);
+            cell->state = CELL_READY;
+            updated = true;
+        } else {
+            cell->state = CELL_NO_COVER;
+            updated = true;
+        }
+    }
+    free(load->pixels);
+    free(load);
+}
+
+// Fill cell with album: at once for an album known to have no cover, else on a job
+static void start_load(int index, uint32_t album) {
+    int record_index;
+    const char* name = Library_string(album);
+    if (Library_filter(NULL, name, &record_index, 1) < 1) return;
+    const LibraryRecord* record = Library_record(record_index);
+    if (!record) return;
+
+    AtlasCell* cell = &cells[index];
+    uint64_t key = thumb_key(name, record);
+    ThumbIndexSlot* slot = index_find(key);
+    cell->album = album;
+    cell->used = ++cell_clock;
+    if (slot && slot->offset == THUMB_NO_COVER) {
+        cell->state = CELL_NO_COVER;
+        return;
+    }
+
+    ThumbLoad* load = calloc(1, sizeof(ThumbLoad));
+    if (!load) {
+        cell->state = CELL_FREE;
+        return;
+    }
+    load->generation = generation;
+    load->load = ++load_counter;
+    load->cell = index;
+    load->key = key;
+    load->offset = slot ? slot->offset : THUMB_NOT_STORED;
+    load->stored = THUMB_NOT_STORED;
+    snprintf(load->path, sizeof(load->path), "%s", Library_string(record->path));
+    load->art_offset = record->art_offset;
+    load->art_size = record->art_size;
+
+    // Reading a stored thumbnail is quick; making one decodes a whole cover
+    JobPriority priority = slot ? JOB_PRIORITY_INTERACTIVE : JOB_PRIORITY_BACKGROUND;
+    if (Jobs_post(priority, thumb_load_job, thumb_load_done, load) != 0) {
+        free(load);
+        cell->state = CELL_FREE;
+        return;
+    }
+    cell->state = CELL_LOADING;
+    cell->load = load->load;
+    loads_running++;
+}
+
+void AlbumThumbs_open(void) {
+    if (thumbs_fd < 0) open_file();
+    if (atlas) return;
+    atlas = SDL_CreateRGBSurfaceWithFormat(0, ALBUM_THUMBS_ATLAS_COLS * ALBUM_THUMB_SIZE,
+                                           ALBUM_THUMBS_ATLAS_ROWS * ALBUM_THUMB_SIZE, 32,
+                                           SDL_PIXELFORMAT_RGBA8888);
+    MEM_SURFACE_ADD(MEM_TAG_THUMBS, atlas);
+}
+
+void AlbumThumbs_reset(void) {
+    generation++;
+    memset(cells, 0, sizeof(cells));
+}
+
+void AlbumThumbs_close(void) {
+    AlbumThumbs_reset();
+    if (atlas) {
+        MEM_SURFACE_SUB(MEM_TAG_THUMBS, atlas);
+        SDL_FreeSurface(atlas);
+        atlas = NULL;
+    }
+}
+
+void AlbumThumbs_quit(void) {
+    AlbumThumbs_close();
+    pthread_mutex_lock(&file_mutex);
+    if (thumbs_fd >= 0) close(thumbs_fd);
+    thumbs_fd = -1;
+    pthread_mutex_unlock(&file_mutex);
+    MEM_FREE(MEM_TAG_THUMBS, thumb_index);
+    thumb_index = NULL;
+    index_capacity = 0;
+    index_count = 0;
+}
+
+bool AlbumThumbs_get(uint32_t album, SDL_Surface** out, SDL_Rect* rect) {
+    if (!atlas || album == 0) return false;
+
+    // Its cell, or the one to take: a free one, else the least recently drawn
+    int victim = -1;
+    for (int i = 0; i < ALBUM_THUMBS_ATLAS_CELLS; i++) {
+        AtlasCell* cell = &cells[i];
+        if (cell->state != CELL_FREE && cell->album == album) {
+            cell->used = ++cell_clock;
+            if (cell->state != CELL_READY) return false;
+            *out = atlas;
+            *rect = (SDL_Rect){(i % ALBUM_THUMBS_ATLAS_COLS) * ALBUM_THUMB_SIZE,
+                               (i / ALBUM_THUMBS_ATLAS_COLS) * ALBUM_THUMB_SIZE,
+                               ALBUM_THUMB_SIZE, ALBUM_THUMB_SIZE};
+            return true;
+        }
+        if (cell->state == CELL_LOADING) continue;
+        if (victim < 0 || (cells[victim].state != CELL_FREE &&
+                           (cell->state == CELL_FREE || cell->used < cells[victim].used))) {
+            victim = i;
+        }
+    }
+    if (victim >= 0 && loads_running < ALBUM_THUMBS_LOADS_MAX) start_load(victim, album);
+    return false;
+}
+
+void AlbumThumbs_prepare(uint32_t album) {
+    if (album == 0) return;
+    if (thumbs_fd < 0) open_file();
+    if (thumbs_fd < 0) return;
+
+    int record_index;
+    const char* name = Library_string(album);
+    if (Library_filter(NULL, name, &record_index, 1) < 1) return;
+    const LibraryRecord* record = Library_record(record_index);
+    if (!record) return;
+    uint64_t key = thumb_key(name, record);
+    if (index_find(key)) return;
+
+    ThumbLoad* load = calloc(1, sizeof(ThumbLoad));
+    if (!load) return;
+    load->generation = prepare_generation;
+    load->cell = -1;
+    load->key = key;
+    load->offset = THUMB_NOT_STORED;
+    load->stored = THUMB_NOT_STORED;
+    snprintf(load->path, sizeof(load->path), "%s", Library_string(record->path));
+    load->art_offset = record->art_offset;
+    load->art_size = record->art_size;
+    if (Jobs_post(JOB_PRIORITY_IDLE, thumb_load_job, thumb_load_done, load) != 0) free(load);
+}
+
+void AlbumThumbs_cancelPrepares(void) {
+    __atomic_add_fetch(&prepare_generation, 1, __ATOMIC_RELEASE);
+}
+
+bool AlbumThumbs_takeUpdate(void) {
+    bool result = updated;
+    updated = false;
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef __ALBUM_THUMBS_H__
+#define __ALBUM_THUMBS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Forward declarations for SDL types
+struct SDL_Surface;
+struct SDL_Rect;
+
+// Album grid thumbnails
+// Covers shrunk to ALBUM_THUMB_SIZE squares are kept in one packed file
+// (ALBUM_THUMBS_FILE: a header, then an entry per album, its key and the
+// pixels, appended as they are made), keyed by the album name and the mtime and
+// size of its first track, so a changed cover makes a new entry. On screen they
+// are drawn from an atlas surface of ALBUM_THUMBS_ATLAS_CELLS cells: an album
+// holds a cell while it is visible and draws by the cell's rect, so scrolling
+// only moves rects. An album without a cell gets the least recently drawn one
+// and a job fills it, reading the file or, for an album not in it yet,
+// decoding the first track's embedded cover or folder image.
+// All functions are for the main thread.
+
+#define ALBUM_THUMBS_FILE SHARED_USERDATA_PATH "/album_thumbs.bin"
+#define ALBUM_THUMB_SIZE 96
+#define ALBUM_THUMBS_ATLAS_COLS 8
+#define ALBUM_THUMBS_ATLAS_ROWS 8
+#define ALBUM_THUMBS_ATLAS_CELLS (ALBUM_THUMBS_ATLAS_COLS * ALBUM_THUMBS_ATLAS_ROWS)
+#define ALBUM_THUMBS_LOADS_MAX 8                // Cells being filled at a time
+#define ALBUM_THUMBS_FILE_MAX (64 * 1024 * 1024) // Past this the file starts over
+
+// Open the file and make the atlas (on entering the grid; no-op if open)
+void AlbumThumbs_open(void);
+
+// Give the atlas back (leaving the grid); the file's index is kept
+void AlbumThumbs_close(void);
+
+// The library index changed: album strings moved, drop every cell
+void AlbumThumbs_reset(void);
+
+// Close everything (before Jobs_quit)
+void AlbumThumbs_quit(void);
+
+// Cell of an album (Library_string offset of its name): true with *atlas and
+// *rect set once its thumbnail is in; otherwise its load is requested and false
+// is returned (also for albums without a cover)
+bool AlbumThumbs_get(uint32_t album, struct SDL_Surface** atlas, struct SDL_Rect* rect);
+
+// Make the thumbnail of an album (Library_string offset of its name) into the
+// file if it has none yet, on an idle job, with no atlas needed (idle-time
+// maintenance: the grid then only reads it)
+void AlbumThumbs_prepare(uint32_t album);
+
+// Drop the thumbnails AlbumThumbs_prepare queued that aren't made yet (the
+// maintenance that asked for them stopped); one being made is finished
+void AlbumThumbs_cancelPrepares(void);
+
+// True once per batch of cells filled since the last call (redraw the grid)
+bool AlbumThumbs_takeUpdate(void);
+
+#endif
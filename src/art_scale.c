@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "art_scale.h"
+#include "trace.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Tap weights are Q15: a destination pixel's weights add up to exactly this
+#define WEIGHT_BITS 15
+#define WEIGHT_ONE (1 << WEIGHT_BITS)
+
+// Source pixels one destination pixel covers along an axis
+typedef struct {
+    int start;
+    int count;
+} Span;
+
+// Spans and weights for d destination pixels over s source pixels
+// Positions are measured in 1/d of a source pixel, so destination pixel x covers
+// [x * s, (x + 1) * s) exactly; each weight is the covered share of the span,
+// taken as a difference of running totals so none is lost to rounding.
+static void build_spans(int s, int d, int max_taps, Span* spans, uint16_t* weights) {
+    for (int x = 0; x < d; x++) {
+        int64_t lo = (int64_t)x * s;
+        int64_t hi = lo + s;
+        int first = (int)(lo / d);
+        int last = (int)((hi - 1) / d);
+        spans[x].start = first;
+        spans[x].count = last - first + 1;
+
+        uint16_t* w = &weights[(size_t)x * max_taps];
+        int32_t prev = 0;
+        for (int i = first; i <= last; i++) {
+            int64_t end = (int64_t)(i + 1) * d < hi ? (int64_t)(i + 1) * d : hi;
+            int32_t total = (int32_t)((end - lo) * WEIGHT_ONE / s);
+            *w++ = (uint16_t)(total - prev);
+            prev = total;
+        }
+    }
+}
+
+// sums[i] += row[i] * weight for n byte lanes
+static void accumulate_row(uint32_t* sums, const uint8_t* row, size_t n, uint16_t weight) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t px = vld1q_u8(&row[i]);
+        uint16x8_t lo = vmovl_u8(vget_low_u8(px));
+        uint16x8_t hi = vmovl_u8(vget_high_u8(px));
+        vst1q_u32(&sums[i], vmlal_n_u16(vld1q_u32(&sums[i]), vget_low_u16(lo), weight));
+        vst1q_u32(&sums[i + 4], vmlal_n_u16(vld1q_u32(&sums[i + 4]), vget_high_u16(lo), weight));
+        vst1q_u32(&sums[i + 8], vmlal_n_u16(vld1q_u32(&sums[i + 8]), vget_low_u16(hi), weight));
+        vst1q_u32(&sums[i + 12], vmlal_n_u16(vld1q_u32(&sums[i + 12]), vget_high_u16(hi), weight));
+    }
+#endif
+    for (; i < n; i++) sums[i] += (uint32_t)row[i] * weight;
+}
+
+// Rounded sums back to bytes (weights add up to one, so no lane exceeds 255)
+static void narrow_row(uint8_t* line, const uint32_t* sums, size_t n) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= n; i += 8) {
+        uint16x4_t a = vmovn_u32(vrshrq_n_u32(vld1q_u32(&sums[i]), WEIGHT_BITS));
+        uint16x4_t b = vmovn_u32(vrshrq_n_u32(vld1q_u32(&sums[i + 4]), WEIGHT_BITS));
+        vst1_u8(&line[i], vmovn_u16(vcombine_u16(a, b)));
+    }
+#endif
+    for (; i < n; i++) line[i] = (uint8_t)((sums[i] + WEIGHT_ONE / 2) >> WEIGHT_BITS);
+}
+
+int ArtScale_blit(SDL_Surface* src, const SDL_Rect* crop, SDL_Surface* dst) {
+    TRACE_SCOPE("art_scale");
+    if (!src || !dst || dst->format->BytesPerPixel != 4 || dst->w <= 0 || dst->h <= 0) return -1;
+
+    SDL_Rect area = crop ? *crop : (SDL_Rect){0, 0, src->w, src->h};
+    SDL_Rect bounds = {0, 0, src->w, src->h};
+    if (!SDL_IntersectRect(&area, &bounds, &area)) return -1;
+
+    // Lanes are averaged as bytes: both sides need the same layout
+    SDL_Surface* converted = NULL;
+    if (src->format->format != dst->format->format) {
+        converted = SDL_ConvertSurfaceFormat(src, dst->format->format, 0);
+        if (!converted) return -1;
+        src = converted;
+    }
+
+    int sw = area.w, sh = area.h, dw = dst->w, dh = dst->h;
+    int taps_x = sw / dw + 2;
+    int taps_y = sh / dh + 2;
+    size_t row_bytes = (size_t)sw * 4;
+    size_t size = (size_t)dw * sizeof(Span) + (size_t)dh * sizeof(Span) +
+                  row_bytes * sizeof(uint32_t) +
+                  ((size_t)dw * taps_x + (size_t)dh * taps_y) * sizeof(uint16_t) + row_bytes;
+    uint8_t* block = malloc(size);
+    if (!block || SDL_LockSurface(src) != 0) {
+        free(block);
+        SDL_FreeSurface(converted);
+        return -1;
+    }
+    if (SDL_LockSurface(dst) != 0) {
+        SDL_UnlockSurface(src);
+        free(block);
+        SDL_FreeSurface(converted);
+        return -1;
+    }
+
+    // One block: spans, the 32-bit row sums, weights, then the summed line
+    Span* spans_x = (Span*)block;
+    Span* spans_y = spans_x + dw;
+    uint32_t* sums = (uint32_t*)(spans_y + dh);
+    uint16_t* weights_x = (uint16_t*)(sums + row_bytes);
+    uint16_t* weights_y = weights_x + (size_t)dw * taps_x;
+    uint8_t* line = (uint8_t*)(weights_y + (size_t)dh * taps_y);
+    build_spans(sw, dw, taps_x, spans_x, weights_x);
+    build_spans(sh, dh, taps_y, spans_y, weights_y);
+
+    const uint8_t* origin = (const uint8_t*)src->pixels + (size_t)area.y * src->pitch + (size_t)area.x * 4;
+    for (int y = 0; y < dh; y++) {
+        // Down: the source rows this row covers, weighted, into one line
+        memset(sums, 0, row_bytes * sizeof(uint32_t));
+        const uint16_t* wy = &weights_y[(size_t)y * taps_y];
+        for (int t = 0; t < spans_y[y].count; t++) {
+            accumulate_row(sums, origin + (size_t)(spans_y[y].start + t) * src->pitch, row_bytes, wy[t]);
+        }
+        narrow_row(line, sums, row_bytes);
+
+        // Across: the line's pixels each destination pixel covers
+        uint8_t* out = (uint8_t*)dst->pixels + (size_t)y * dst->pitch;
+        for (int x = 0; x < dw; x++, out += 4) {
+            const uint8_t* px = &line[(size_t)spans_x[x].start * 4];
+            const uint16_t* wx = &weights_x[(size_t)x * taps_x];
+            uint32_t acc[4] = {WEIGHT_ONE / 2, WEIGHT_ONE / 2, WEIGHT_ONE / 2, WEIGHT_ONE / 2};
+            for (int t = 0; t < spans_x[x].count; t++, px += 4) {
+                acc[0] += (uint32_t)px[0] * wx[t];
+                acc[1] += (uint32_t)px[1] * wx[t];
+                acc[2] += (uint32_t)px[2] * wx[t];
+                acc[3] += (uint32_t)px[3] * wx[t];
+            }
+            out[0] = (uint8_t)(acc[0] >> WEIGHT_BITS);
+            out[1] = (uint8_t)(acc[1] >> WEIGHT_BITS);
+            out[2] = (uint8_t)(acc[2] >> WEIGHT_BITS);
+            out[3] = (uint8_t)(acc[3] >> WEIGHT_BITS);
+        }
+    }
+
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+    free(block);
+    SDL_FreeSurface(converted);
+    return 0;
+}
+
+SDL_Surface* ArtScale_scale(SDL_Surface* src, const SDL_Rect* crop, int w, int h) {
+    if (w <= 0 || h <= 0) return NULL;
+    SDL_Surface* dst = SDL_CreateRGBSurfaceWithFormat(0, w, h, 32, SDL_PIXELFORMAT_RGBA8888);
+    if (!dst) return NULL;
+    if (ArtScale_blit(src, crop, dst) != 0) {
+        SDL_FreeSurface(dst);
+        return NULL;
+    }
+    return dst;
+}
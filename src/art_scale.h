@@ -0,0 +1,25 @@
+#ifndef __ART_SCALE_H__
+#define __ART_SCALE_H__
+
+#include <SDL2/SDL.h>
+
+// Cover and thumbnail scaling
+// An area-average resampler for 32-bit surfaces: each output pixel is the mean
+// of the source area it covers (partly covered pixels weighted by how much), so
+// a 1400px cover shrunk to a 40px thumbnail keeps its detail instead of
+// aliasing, in one pass over the source. Both axes are separable: rows are
+// summed into a line of 32-bit lanes (NEON, 16 bytes at a time), which is then
+// reduced across. Works per byte lane, so any 32-bit channel order goes through
+// unchanged. Also used for the rare enlargement, where it gives a sharp box
+// filter. Any thread.
+
+// Scale the crop of src (NULL = all of it) to fill dst
+// dst must be 32-bit; src in another format is converted to dst's first.
+// Returns 0, or -1 if out of memory.
+int ArtScale_blit(SDL_Surface* src, const SDL_Rect* crop, SDL_Surface* dst);
+
+// The crop of src (NULL = all of it) scaled to w x h, as a new RGBA8888 surface
+// NULL if out of memory.
+SDL_Surface* ArtScale_scale(SDL_Surface* src, const SDL_Rect* crop, int w, int h);
+
+#endif
@@ -309,8 +309,8 @@ typedef struct MP4D_demux_tag
         unsigned char *year;
         unsigned char *comment;
         unsigned char *genre;
-        // Cover art (JPEG or PNG data)
-        unsigned char *cover;
+        // Cover art (JPEG or PNG data): located in the file, not read
+        int64_t cover_offset;
         unsigned int cover_size;
     } tag;
 #endif
@@ -2975,32 +2975,16 @@ broken_android_meta_hack:
         case BOX_cgen: ptag = &mp4->tag.genre;   break;
 
         case BOX_covr:
-            // Cover art: skip 'data' atom header (16 bytes) then read image data
+            // Cover art: skip 'data' atom header (16 bytes), note where the image is
             // Structure: size(4) + 'data'(4) + type(4) + reserved(4) + image_data
-            if (payload_bytes > 16 && !mp4->tag.cover)
+            if (payload_bytes > 16 && !mp4->tag.cover_size)
             {
                 SKIP(16);  // Skip data atom header
-                payload_bytes -= 16;
-                unsigned int img_size = (unsigned int)payload_bytes;
-                mp4->tag.cover = (unsigned char*)malloc(img_size);
-                if (mp4->tag.cover)
+                if (!eof_flag && payload_bytes > 0)
                 {
-                    unsigned int i;
-                    for (i = 0; i < img_size && !eof_flag; i++)
-                    {
-                        mp4->tag.cover[i] = minimp4_read(mp4, 1, &eof_flag);
-                    }
-                    if (!eof_flag)
-                    {
-                        mp4->tag.cover_size = img_size;
-                    }
-                    else
-                    {
-                        free(mp4->tag.cover);
-                        mp4->tag.cover = NULL;
-                    }
+                    mp4->tag.cover_offset = mp4->read_pos;
+                    mp4->tag.cover_size = (unsigned int)payload_bytes;
                 }
-                payload_bytes = 0;
             }
             break;
 
@@ -3342,7 +3326,6 @@ void MP4D_close(MP4D_demux_t *mp4)
     FREE(mp4->tag.year);
     FREE(mp4->tag.comment);
     FREE(mp4->tag.genre);
-    FREE(mp4->tag.cover);
 #endif
 }
 
@@ -0,0 +1,291 @@
+// Headless decoder and pipeline benchmark (make bench)
+//
+//   bench.elf [corpus_dir] [output.json]
+//   bench.elf callback <track> [seconds] [loads] [output.json]
+//   bench.elf radio <capture_dir> [seconds] [jitter_ms] [loss_pct] [kbps] [output.json]
+//   bench.elf ui [track] [frames] [output.json]
+//
+// Runs every audio file in corpus_dir (default BENCH_CORPUS_DIR) through the
+// playback decoders and reports, as one JSON document on stdout or in
+// output.json:
+//   - per file: open time, full decode speed as a multiple of real time (wall
+//     clock and process CPU) in int16 and float, and the seek latency
+//     distribution (seek plus the first decoded block, from BENCH_SEEKS
+//     positions spread over the track in a fixed order)
+//   - per stage: ns per output frame of each resampler tier (44.1 <-> 48 kHz,
+//     int16 and float) and of the gain stages
+//   - peak RSS of the run
+// Positions and inputs are deterministic, so runs on the same device and build
+// compare directly. bench_corpus.sh builds the fixture set (MP3 CBR/VBR, FLAC
+// 16/24-bit, OGG, M4A LC/HE-AAC, WAV, mono and stereo) with ffmpeg.
+// The callback mode times the real-time path under load (bench_callback.c),
+// the radio mode replays a recorded station (bench_radio.c), the ui mode
+// times the screen renderers (bench_ui.c).
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include "defines.h"
+#include "api.h"
+#include "jobs.h"
+#include "player.h"
+#include "resampler.h"
+#include "bench.h"
+
+#define BENCH_CORPUS_DIR SDCARD_PATH "/Music/.bench"
+#define BENCH_FILES_MAX 64
+#define BENCH_CHUNK_FRAMES 4096     // Decode block, as the crossfade path reads
+#define BENCH_SEEKS 32
+#define BENCH_STAGE_FRAMES (48000 * 10)
+#define BENCH_STAGE_REPEATS 5
+
+static uint64_t wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    return usage.ru_maxrss;
+}
+
+static int compare_strings(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void json_string(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') fputc('\\', out);
+        if ((unsigned char)*s >= 0x20) fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+// Decode the whole file; returns wall and CPU seconds spent, or -1
+static int decode_pass(const char* path, bool f32, void* buffer, double* wall_s, double* cpu_s, int64_t* frames) {
+    BenchDecoder* decoder = BenchDecoder_open(path);
+    if (!decoder) return -1;
+    uint64_t wall = wall_ns(), cpu = cpu_ns();
+    int64_t total = 0;
+    size_t n;
+    do {
+        n = f32 ? BenchDecoder_readF32(decoder, (float*)buffer, BENCH_CHUNK_FRAMES)
+                : BenchDecoder_readS16(decoder, (int16_t*)buffer, BENCH_CHUNK_FRAMES);
+        total += n;
+    } while (n > 0);
+    *wall_s = (wall_ns() - wall) / 1e9;
+    *cpu_s = (cpu_ns() - cpu) / 1e9;
+    *frames = total;
+    BenchDecoder_close(decoder);
+    return 0;
+}
+
+static void bench_file(FILE* out, const char* path, bool first) {
+    float* buffer = malloc(BENCH_CHUNK_FRAMES * 2 * sizeof(float));
+    if (!buffer) return;
+
+    uint64_t start = wall_ns();
+    BenchDecoder* decoder = BenchDecoder_open(path);
+    double open_ms = (wall_ns() - start) / 1e6;
+    if (!decoder) {
+        fprintf(stderr, "bench: can't open %s\n", path);
+        free(buffer);
+        return;
+    }
+    int rate = BenchDecoder_sampleRate(decoder);
+    int64_t total = BenchDecoder_totalFrames(decoder);
+
+    // Seeks in a fixed scattered order (golden ratio steps over the track)
+    double seek_ms[BENCH_SEEKS];
+    int seeks = 0;
+    for (int i = 0; i < BENCH_SEEKS && total > BENCH_CHUNK_FRAMES; i++) {
+        double at = (i + 1) * 0.6180339887;
+        int64_t frame = (int64_t)((at - (int64_t)at) * (total - BENCH_CHUNK_FRAMES));
+        uint64_t t = wall_ns();
+        if (BenchDecoder_seek(decoder, frame) != 0) continue;
+        BenchDecoder_readS16(decoder, (int16_t*)buffer, BENCH_CHUNK_FRAMES);
+        seek_ms[seeks++] = (wall_ns() - t) / 1e6;
+    }
+    qsort(seek_ms, seeks, sizeof(double), compare_doubles);
+
+    fprintf(out, "%s    {\"file\": ", first ? "" : ",\n");
+    json_string(out, path);
+    fprintf(out, ", \"format\": \"%s\", \"sample_rate\": %d, \"channels\": %d, \"duration_s\": %.3f, \"open_ms\": %.3f",
+            BenchDecoder_format(decoder), rate, BenchDecoder_channels(decoder),
+            rate > 0 ? (double)total / rate : 0.0, open_ms);
+    BenchDecoder_close(decoder);
+
+    for (int f32 = 0; f32 <= 1; f32++) {
+        double wall_s, cpu_s;
+        int64_t frames;
+        if (decode_pass(path, f32, buffer, &wall_s, &cpu_s, &frames) != 0 || rate <= 0) continue;
+        double audio_s = (double)frames / rate;
+        fprintf(out, ", \"decode_%s\": {\"frames\": %lld, \"x_realtime\": %.2f, \"cpu_x_realtime\": %.2f}",
+                f32 ? "f32" : "s16", (long long)frames,
+                wall_s > 0 ? audio_s / wall_s : 0.0, cpu_s > 0 ? audio_s / cpu_s : 0.0);
+    }
+
+    if (seeks > 0) {
+        fprintf(out, ", \"seek_ms\": {\"count\": %d, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}",
+                seeks, seek_ms[seeks / 2], seek_ms[seeks * 9 / 10], seek_ms[(seeks * 99) / 100], seek_ms[seeks - 1]);
+    }
+    fprintf(out, ", \"peak_rss_kb\": %ld}", peak_rss_kb());
+    free(buffer);
+}
+
+// Best of BENCH_STAGE_REPEATS, in ns per output frame
+static void report_stage(FILE* out, bool* first, const char* stage, const char* variant, uint64_t best_ns, size_t frames) {
+    fprintf(out, "%s    {\"stage\": \"%s\", \"variant\": \"%s\", \"ns_per_frame\": %.2f}",
+            *first ? "" : ",\n", stage, variant, frames > 0 ? (double)best_ns / frames : 0.0);
+    *first = false;
+}
+
+static void bench_stages(FILE* out) {
+    size_t frames = BENCH_STAGE_FRAMES;
+    size_t out_max = frames * 2;
+    int16_t* in_s16 = malloc(frames * 2 * sizeof(int16_t));
+    float* in_f32 = malloc(frames * 2 * sizeof(float));
+    int16_t* out_s16 = malloc(out_max * 2 * sizeof(int16_t));
+    float* out_f32 = malloc(out_max * 2 * sizeof(float));
+    if (!in_s16 || !in_f32 || !out_s16 || !out_f32) goto done;
+
+    // Deterministic noise: a worst case for nothing, a fair load for everything
+    uint32_t seed = 1;
+    for (size_t i = 0; i < frames * 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        in_s16[i] = (int16_t)(seed >> 16) / 4;
+        in_f32[i] = in_s16[i] / 32768.0f;
+    }
+
+    bool first = true;
+    static const int rates[][2] = {{44100, 48000}, {48000, 44100}};
+    for (int q = 0; q < RESAMPLER_QUALITY_COUNT; q++) {
+        for (int r = 0; r < 2; r++) {
+            for (int f32 = 0; f32 <= 1; f32++) {
+                Resampler* resampler = Resampler_new((ResamplerQuality)q);
+                if (!resampler) continue;
+                uint64_t best = UINT64_MAX;
+                size_t produced = 0;
+                for (int rep = 0; rep < BENCH_STAGE_REPEATS; rep++) {
+                    Resampler_reset(resampler);
+                    uint64_t t = wall_ns();
+                    produced = f32 ? Resampler_processF32(resampler, in_f32, frames, rates[r][0], rates[r][1],
+                                                          out_f32, out_max, true)
+                                   : Resampler_processS16(resampler, in_s16, frames, rates[r][0], rates[r][1],
+                                                          out_s16, out_max, true);
+                    t = wall_ns() - t;
+                    if (t < best) best = t;
+                }
+                Resampler_free(resampler);
+                char variant[64];
+                snprintf(variant, sizeof(variant), "%s %d->%d %s", Resampler_qualityName((ResamplerQuality)q),
+                         rates[r][0], rates[r][1], f32 ? "f32" : "s16");
+                report_stage(out, &first, "resample", variant, best, produced);
+            }
+        }
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < BENCH_STAGE_REPEATS; rep++) {
+        memcpy(out_s16, in_s16, frames * 2 * sizeof(int16_t));
+        uint64_t t = wall_ns();
+        Bench_gainS16(out_s16, frames, 16384);
+        t = wall_ns() - t;
+        if (t < best) best = t;
+    }
+    report_stage(out, &first, "gain", "q15 s16", best, frames);
+
+    best = UINT64_MAX;
+    for (int rep = 0; rep < BENCH_STAGE_REPEATS; rep++) {
+        uint64_t t = wall_ns();
+        Bench_gainF32(in_f32, out_s16, frames, 0.5f);
+        t = wall_ns() - t;
+        if (t < best) best = t;
+    }
+    report_stage(out, &first, "gain", "f32 to s16", best, frames);
+
+done:
+    free(in_s16);
+    free(in_f32);
+    free(out_s16);
+    free(out_f32);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && strcmp(argv[1], "radio") == 0) {
+        return BenchRadio_main(argc - 2, argv + 2, stdout);     // Starts its own threads
+    }
+    if (argc > 1 && strcmp(argv[1], "ui") == 0) {
+        return BenchUi_main(argc - 2, argv + 2, stdout);        // Counts allocations from the start
+    }
+    if (argc > 1 && strcmp(argv[1], "callback") == 0) {
+        Jobs_init();
+        int result = BenchCallback_main(argc - 2, argv + 2, stdout);
+        Jobs_quit();
+        return result;
+    }
+
+    const char* corpus = argc > 1 ? argv[1] : BENCH_CORPUS_DIR;
+    FILE* out = stdout;
+    if (argc > 2) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            fprintf(stderr, "bench: can't write %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    DIR* dir = opendir(corpus);
+    if (!dir) {
+        fprintf(stderr, "bench: no corpus at %s (see bench_corpus.sh)\n", corpus);
+        return 1;
+    }
+    char* files[BENCH_FILES_MAX];
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) && count < BENCH_FILES_MAX) {
+        if (entry->d_name[0] == '.') continue;
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", corpus, entry->d_name);
+        if (Player_detectFormat(path) == AUDIO_FORMAT_UNKNOWN) continue;
+        files[count++] = strdup(path);
+    }
+    closedir(dir);
+    qsort(files, count, sizeof(char*), compare_strings);
+
+    // Seek index builders run on the job pool, as in the player
+    Jobs_init();
+
+    fprintf(out, "{\n  \"platform\": \"%s\",\n  \"files\": [\n", PLATFORM);
+    for (int i = 0; i < count; i++) {
+        bench_file(out, files[i], i == 0);
+        free(files[i]);
+    }
+    fprintf(out, "\n  ],\n  \"stages\": [\n");
+    bench_stages(out);
+    fprintf(out, "\n  ],\n  \"peak_rss_kb\": %ld\n}\n", peak_rss_kb());
+
+    Jobs_quit();
+    if (out != stdout) fclose(out);
+    return 0;
+}
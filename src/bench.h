@@ -0,0 +1,54 @@
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// Entry points into player.c for the headless benchmark (make bench, bench.c)
+// Only built with PLAYER_BENCH: they run the playback decoders and output stages
+// exactly as the decode thread and audio callback do, without a player, device
+// or screen.
+
+typedef struct BenchDecoder BenchDecoder;
+
+// NULL if the file can't be opened
+BenchDecoder* BenchDecoder_open(const char* path);
+void BenchDecoder_close(BenchDecoder* decoder);
+
+// Format name, source rate/channels and length in frames
+const char* BenchDecoder_format(const BenchDecoder* decoder);
+int BenchDecoder_sampleRate(const BenchDecoder* decoder);
+int BenchDecoder_channels(const BenchDecoder* decoder);
+int64_t BenchDecoder_totalFrames(const BenchDecoder* decoder);
+
+// Decode interleaved stereo (mono is spread to both channels)
+size_t BenchDecoder_readS16(BenchDecoder* decoder, int16_t* buffer, size_t frames);
+size_t BenchDecoder_readF32(BenchDecoder* decoder, float* buffer, size_t frames);
+
+// Returns 0 on success
+int BenchDecoder_seek(BenchDecoder* decoder, int64_t frame);
+
+// The callback's gain stages: Q15 on int16 in place, and the float pipeline's
+// float-to-int16 conversion with gain
+void Bench_gainS16(int16_t* samples, size_t frames, int16_t gain_q15);
+void Bench_gainF32(const float* in, int16_t* out, size_t frames, float gain);
+
+// Take the audio callback away from SDL once a track is playing (looped from
+// then on), so the harness can call it on its own clock. Reports the device
+// rate, period and bytes per frame. Returns 0 on success, -1 if nothing plays.
+int Bench_detachAudio(int* sample_rate, int* period_frames, int* frame_bytes);
+
+// One device period through the real callback, as the SDL audio thread calls it
+void Bench_audioCallback(uint8_t* stream, int len);
+
+// Callback deadline harness (bench_callback.c): bench.elf callback ...
+int BenchCallback_main(int argc, char* argv[], FILE* out);
+
+// Radio capture replay (bench_radio.c): bench.elf radio ...
+int BenchRadio_main(int argc, char* argv[], FILE* out);
+
+// Screen renderer timings (bench_ui.c): bench.elf ui ...
+int BenchUi_main(int argc, char* argv[], FILE* out);
+
+#endif
@@ -0,0 +1,331 @@
+// Audio callback deadline harness (make bench)
+//
+//   bench.elf callback <track> [seconds] [loads] [report.json]
+//
+// Plays track through the real player (decode thread, ring, callback), but
+// instead of the SDL device a thread in the audio role calls the callback on
+// its own clock, once per device period, and times every call:
+//   - wake: how late the call started against the period boundary
+//   - exec: how long the callback ran
+//   - slack: time left before the next boundary, when the device would have
+//     needed the buffer (negative is a missed deadline)
+// Trylock failures and short reads come from the player's own telemetry.
+// loads is a comma list of synthetic load to run meanwhile (default none):
+//   ui        software composition of a 720p frame at 60 fps, UI role
+//   download  compress-and-write to the SD card like a yt-dlp/ffmpeg download,
+//             background role, fsync every few MB
+//   hls       AES-128-CBC decrypt and SHA-256 of a segment every 2 s, like the
+//             HLS fetch thread on a TLS stream, decode role
+//   all       every one of the above
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include <mbedtls/aes.h>
+#include <mbedtls/sha256.h>
+
+#include "defines.h"
+#include "api.h"
+#include "player.h"
+#include "thread_role.h"
+#include "bench.h"
+
+#define CALLBACK_DEFAULT_SECONDS 60
+#define CALLBACK_BUFFER_MS 2000     // Decode-ahead before the clock starts
+
+#define LOAD_UI_WIDTH 1280
+#define LOAD_UI_HEIGHT 720
+#define LOAD_UI_FRAME_NS (1000000000ll / 60)
+#define LOAD_DOWNLOAD_CHUNK (256 * 1024)
+#define LOAD_DOWNLOAD_RATE (2 * 1024 * 1024)     // Bytes per second written
+#define LOAD_DOWNLOAD_SYNC (4 * 1024 * 1024)
+#define LOAD_DOWNLOAD_FILE_MAX (64 * 1024 * 1024)
+#define LOAD_DOWNLOAD_PATH SDCARD_PATH "/.bench_download.tmp"
+#define LOAD_HLS_SEGMENT (1024 * 1024)
+#define LOAD_HLS_INTERVAL_NS 2000000000ll
+#define LOAD_HLS_RECV 16384         // TLS record sized pieces
+
+#define LOAD_UI (1 << 0)
+#define LOAD_DOWNLOAD (1 << 1)
+#define LOAD_HLS (1 << 2)
+
+static volatile bool loads_quit = false;
+
+static int64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static void sleep_until_ns(int64_t at) {
+    struct timespec ts = { .tv_sec = at / 1000000000ll, .tv_nsec = at % 1000000000ll };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {}
+}
+
+// ============ SYNTHETIC LOADS ============
+
+static void* ui_load_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_UI);
+
+    SDL_Surface* screen = SDL_CreateRGBSurfaceWithFormat(0, LOAD_UI_WIDTH, LOAD_UI_HEIGHT, 32,
+                                                         SDL_PIXELFORMAT_RGBA8888);
+    SDL_Surface* art = SDL_CreateRGBSurfaceWithFormat(0, 500, 500, 32, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Surface* glyphs = SDL_CreateRGBSurfaceWithFormat(0, 400, 32, 32, SDL_PIXELFORMAT_RGBA8888);
+    if (screen && art && glyphs) {
+        uint32_t* pixels = art->pixels;
+        for (int i = 0; i < art->w * art->h; i++) pixels[i] = (uint32_t)i * 2654435761u;
+        SDL_SetSurfaceBlendMode(glyphs, SDL_BLENDMODE_BLEND);
+        SDL_FillRect(glyphs, NULL, 0x80FFFFFF);
+
+        // Cover scaled into place, a dozen text lines blended over a cleared frame
+        int64_t next = clock_ns();
+        for (int frame = 0; !loads_quit; frame++) {
+            SDL_FillRect(screen, NULL, 0x101010FF);
+            SDL_Rect cover = { 80 + frame % 16, 120, 400, 400 };
+            SDL_BlitScaled(art, NULL, screen, &cover);
+            for (int line = 0; line < 12; line++) {
+                SDL_Rect text = { 560, 120 + line * 40, glyphs->w, glyphs->h };
+                SDL_BlitSurface(glyphs, NULL, screen, &text);
+            }
+            next += LOAD_UI_FRAME_NS;
+            sleep_until_ns(next);
+        }
+    }
+    SDL_FreeSurface(glyphs);
+    SDL_FreeSurface(art);
+    SDL_FreeSurface(screen);
+    return NULL;
+}
+
+static void* download_load_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    uint8_t* chunk = malloc(LOAD_DOWNLOAD_CHUNK);
+    uLongf packed_max = compressBound(LOAD_DOWNLOAD_CHUNK);
+    uint8_t* packed = malloc(packed_max);
+    FILE* f = fopen(LOAD_DOWNLOAD_PATH, "wb");
+    if (chunk && packed && f) {
+        // Half noise, half repeats: compresses about as hard as a media remux
+        uint32_t seed = 7;
+        for (int i = 0; i < LOAD_DOWNLOAD_CHUNK; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            chunk[i] = (i & 1024) ? (uint8_t)(seed >> 24) : (uint8_t)i;
+        }
+        size_t written = 0, unsynced = 0;
+        int64_t next = clock_ns();
+        while (!loads_quit) {
+            uLongf packed_size = packed_max;
+            compress2(packed, &packed_size, chunk, LOAD_DOWNLOAD_CHUNK, Z_DEFAULT_COMPRESSION);
+            fwrite(chunk, 1, LOAD_DOWNLOAD_CHUNK, f);
+            written += LOAD_DOWNLOAD_CHUNK;
+            unsynced += LOAD_DOWNLOAD_CHUNK;
+            if (unsynced >= LOAD_DOWNLOAD_SYNC) {
+                fflush(f);
+                fsync(fileno(f));
+                unsynced = 0;
+            }
+            if (written >= LOAD_DOWNLOAD_FILE_MAX) {
+                rewind(f);
+                written = 0;
+            }
+            next += (int64_t)LOAD_DOWNLOAD_CHUNK * 1000000000ll / LOAD_DOWNLOAD_RATE;
+            sleep_until_ns(next);
+        }
+    }
+    if (f) {
+        fclose(f);
+        unlink(LOAD_DOWNLOAD_PATH);
+    }
+    free(packed);
+    free(chunk);
+    return NULL;
+}
+
+static void* hls_load_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_DECODE);
+
+    uint8_t* segment = malloc(LOAD_HLS_SEGMENT);
+    uint8_t* plain = malloc(LOAD_HLS_SEGMENT);
+    if (segment && plain) {
+        memset(segment, 0x5A, LOAD_HLS_SEGMENT);
+        static const unsigned char key[16] = "bench-hls-key-16";
+        mbedtls_aes_context aes;
+        mbedtls_aes_init(&aes);
+        mbedtls_aes_setkey_dec(&aes, key, 128);
+
+        int64_t next = clock_ns();
+        while (!loads_quit) {
+            // Arrives in records, each hashed, then the whole segment is decrypted
+            unsigned char digest[32];
+            for (size_t at = 0; at < LOAD_HLS_SEGMENT && !loads_quit; at += LOAD_HLS_RECV) {
+                mbedtls_sha256(&segment[at], LOAD_HLS_RECV, digest, 0);
+            }
+            unsigned char iv[16] = {0};
+            mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_DECRYPT, LOAD_HLS_SEGMENT, iv, segment, plain);
+            next += LOAD_HLS_INTERVAL_NS;
+            sleep_until_ns(next);
+        }
+        mbedtls_aes_free(&aes);
+    }
+    free(plain);
+    free(segment);
+    return NULL;
+}
+
+// ============ REPORT ============
+
+static int compare_ints(const void* a, const void* b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// Percentiles, then counts per power-of-two bucket of microseconds (upper bound
+// inclusive; values below zero land in the first bucket)
+static void report_histogram(FILE* out, const char* name, int32_t* values, int count, bool last) {
+    fprintf(out, "    \"%s\": {", name);
+    if (count > 0) {
+        qsort(values, count, sizeof(int32_t), compare_ints);
+        fprintf(out, "\"min\": %d, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"p999\": %d, \"max\": %d, \"buckets\": [",
+                values[0], values[count / 2], values[count * 9 / 10], values[(int64_t)count * 99 / 100],
+                values[(int64_t)count * 999 / 1000], values[count - 1]);
+        int i = 0;
+        bool first = true;
+        for (int32_t bound = 1; i < count; bound *= 2) {
+            int in_bucket = 0;
+            while (i < count && values[i] <= bound) {
+                in_bucket++;
+                i++;
+            }
+            if (in_bucket > 0) {
+                fprintf(out, "%s[%d, %d]", first ? "" : ", ", bound, in_bucket);
+                first = false;
+            }
+        }
+        fprintf(out, "]");
+    }
+    fprintf(out, "}%s\n", last ? "" : ",");
+}
+
+// ============ HARNESS ============
+
+static int parse_loads(const char* list) {
+    int loads = 0;
+    char copy[128];
+    snprintf(copy, sizeof(copy), "%s", list);
+    for (char* name = strtok(copy, ","); name; name = strtok(NULL, ",")) {
+        if (strcmp(name, "ui") == 0) loads |= LOAD_UI;
+        else if (strcmp(name, "download") == 0) loads |= LOAD_DOWNLOAD;
+        else if (strcmp(name, "hls") == 0) loads |= LOAD_HLS;
+        else if (strcmp(name, "all") == 0) loads |= LOAD_UI | LOAD_DOWNLOAD | LOAD_HLS;
+        else if (strcmp(name, "none") != 0) fprintf(stderr, "bench: unknown load %s\n", name);
+    }
+    return loads;
+}
+
+int BenchCallback_main(int argc, char* argv[], FILE* out) {
+    if (argc < 1) {
+        fprintf(stderr, "usage: bench.elf callback <track> [seconds] [ui,download,hls|all] [report.json]\n");
+        return 1;
+    }
+    const char* track = argv[0];
+    int seconds = argc > 1 ? atoi(argv[1]) : CALLBACK_DEFAULT_SECONDS;
+    const char* load_list = argc > 2 ? argv[2] : "none";
+    int loads = parse_loads(load_list);
+    if (seconds <= 0) seconds = CALLBACK_DEFAULT_SECONDS;
+    if (argc > 3) {
+        out = fopen(argv[3], "w");
+        if (!out) {
+            fprintf(stderr, "bench: can't write %s\n", argv[3]);
+            return 1;
+        }
+    }
+
+    // The real device only opens to be closed again: nothing has to hear it
+    setenv("SDL_AUDIODRIVER", "dummy", 1);
+    int sample_rate, period_frames, frame_bytes;
+    if (Player_init() != 0 || Player_load(track) != 0 || Player_play() != 0 ||
+        Bench_detachAudio(&sample_rate, &period_frames, &frame_bytes) != 0) {
+        fprintf(stderr, "bench: can't play %s\n", track);
+        if (out != stdout) fclose(out);
+        return 1;
+    }
+    usleep(CALLBACK_BUFFER_MS * 1000);
+
+    pthread_t load_threads[3];
+    int load_count = 0;
+    if ((loads & LOAD_UI) && pthread_create(&load_threads[load_count], NULL, ui_load_func, NULL) == 0) load_count++;
+    if ((loads & LOAD_DOWNLOAD) && pthread_create(&load_threads[load_count], NULL, download_load_func, NULL) == 0) {
+        load_count++;
+    }
+    if ((loads & LOAD_HLS) && pthread_create(&load_threads[load_count], NULL, hls_load_func, NULL) == 0) load_count++;
+
+    int64_t period_ns = (int64_t)period_frames * 1000000000ll / sample_rate;
+    int calls = (int)((int64_t)seconds * 1000000000ll / period_ns);
+    int len = period_frames * frame_bytes;
+    uint8_t* stream = malloc(len);
+    int32_t* wake_us = malloc(calls * sizeof(int32_t));
+    int32_t* exec_us = malloc(calls * sizeof(int32_t));
+    int32_t* slack_us = malloc(calls * sizeof(int32_t));
+    int misses = 0;
+    int done = 0;
+
+    if (stream && wake_us && exec_us && slack_us) {
+        // The callback applies the audio role to this thread on its first call
+        Player_resetStats();
+        int64_t start = clock_ns() + period_ns;
+        for (; done < calls; done++) {
+            int64_t due = start + done * period_ns;
+            sleep_until_ns(due);
+            int64_t begin = clock_ns();
+            Bench_audioCallback(stream, len);
+            int64_t end = clock_ns();
+            wake_us[done] = (int32_t)((begin - due) / 1000);
+            exec_us[done] = (int32_t)((end - begin) / 1000);
+            slack_us[done] = (int32_t)((due + period_ns - end) / 1000);
+            if (end > due + period_ns) misses++;
+        }
+    }
+
+    loads_quit = true;
+    for (int i = 0; i < load_count; i++) pthread_join(load_threads[i], NULL);
+
+    PlayerStats stats;
+    Player_getStats(&stats);
+    Player_stop();
+    Player_quit();
+
+    fprintf(out, "{\n  \"platform\": \"%s\",\n  \"mode\": \"callback\",\n  \"track\": ", PLATFORM);
+    fputc('"', out);
+    for (const char* c = track; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', out);
+        fputc(*c, out);
+    }
+    fprintf(out, "\",\n  \"loads\": \"%s\",\n", load_list);
+    fprintf(out, "  \"sample_rate\": %d,\n  \"period_frames\": %d,\n  \"period_us\": %d,\n",
+            sample_rate, period_frames, (int)(period_ns / 1000));
+    fprintf(out, "  \"callbacks\": %d,\n  \"deadline_misses\": %d,\n  \"trylock_misses\": %u,\n",
+            done, misses, stats.trylock_misses);
+    fprintf(out, "  \"short_reads\": %u,\n  \"silence_frames\": %llu,\n  \"buffer_min_ms\": %d,\n",
+            stats.underruns, (unsigned long long)stats.silence_frames, stats.buffer_min_ms);
+    fprintf(out, "  \"histograms_us\": {\n");
+    report_histogram(out, "wake_late", wake_us, done, false);
+    report_histogram(out, "exec", exec_us, done, false);
+    report_histogram(out, "slack", slack_us, done, true);
+    fprintf(out, "  }\n}\n");
+
+    free(slack_us);
+    free(exec_us);
+    free(wake_us);
+    free(stream);
+    if (out != stdout) fclose(out);
+    return 0;
+}
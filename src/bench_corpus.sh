@@ -0,0 +1,29 @@
+#!/bin/sh
+# Build the benchmark corpus for bench.elf with the bundled ffmpeg
+#   bench_corpus.sh [output_dir]
+# A 60 s synthetic program (tones over pink noise) in every format the player
+# decodes. HE-AAC needs an encoder ffmpeg builds usually lack (libfdk_aac); drop
+# a real he-aac.m4a into the directory by hand if it isn't produced.
+DIR="$(dirname "$0")"
+FFMPEG="${FFMPEG:-$DIR/../bins/ffmpeg}"
+[ -x "$FFMPEG" ] || FFMPEG=ffmpeg
+OUT="${1:-/mnt/SDCARD/Music/.bench}"
+mkdir -p "$OUT"
+
+SRC="sine=f=440:d=60,aformat=channel_layouts=mono[a];anoisesrc=d=60:c=pink:a=0.2[b];[a][b]amix=inputs=2"
+
+gen() {
+    name="$1"; shift
+    "$FFMPEG" -y -loglevel error -filter_complex "$SRC" "$@" "$OUT/$name" || echo "skipped $name"
+}
+
+gen mp3-cbr-320.mp3      -ar 44100 -ac 2 -c:a libmp3lame -b:a 320k
+gen mp3-vbr-v2.mp3       -ar 44100 -ac 2 -c:a libmp3lame -q:a 2
+gen mp3-mono.mp3         -ar 44100 -ac 1 -c:a libmp3lame -b:a 128k
+gen flac-16.flac         -ar 44100 -ac 2 -c:a flac -sample_fmt s16
+gen flac-24-96k.flac     -ar 96000 -ac 2 -c:a flac -sample_fmt s32
+gen ogg-q5.ogg           -ar 44100 -ac 2 -c:a libvorbis -q:a 5
+gen m4a-lc-256.m4a       -ar 44100 -ac 2 -c:a aac -b:a 256k
+gen he-aac.m4a           -ar 44100 -ac 2 -c:a libfdk_aac -profile:a aac_he -b:a 64k
+gen wav-16-48k.wav       -ar 48000 -ac 2 -c:a pcm_s16le
+gen wav-mono.wav         -ar 44100 -ac 1 -c:a pcm_s16le
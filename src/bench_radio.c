@@ -0,0 +1,138 @@
+// Radio replay soak benchmark (make bench)
+//
+//   bench.elf radio <capture_dir> [seconds] [jitter_ms] [loss_pct] [kbps] [report.json]
+//
+// Plays the first station of a capture (radio_capture.h; record one with a
+// RADIO_CAPTURE build) from the replay server, through the whole radio
+// pipeline and the audio callback (SDL dummy driver, real-time pace), with the
+// given faults injected, and reports as JSON: startup latency (Radio_play to
+// the first audio), rebuffers, underruns, reconnects and outages, stage
+// throughput, and CPU time. The server runs in a child process, so the CPU
+// time is the player's: network and decode stages (network_thread_func or
+// hls_stream_thread_func and their decoder) plus the callback.
+// Same capture, options and seed: same replay.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "defines.h"
+#include "api.h"
+#include "jobs.h"
+#include "player.h"
+#include "radio.h"
+#include "radio_capture.h"
+#include "bench.h"
+
+#define RADIO_DEFAULT_SECONDS 120
+#define RADIO_POLL_MS 10
+#define RADIO_SEED 1
+
+static uint64_t clock_ms(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int BenchRadio_main(int argc, char* argv[], FILE* out) {
+    if (argc < 1) {
+        fprintf(stderr, "usage: bench.elf radio <capture_dir> [seconds] [jitter_ms] [loss_pct] [kbps] [report.json]\n");
+        return 1;
+    }
+    const char* dir = argv[0];
+    int seconds = argc > 1 ? atoi(argv[1]) : RADIO_DEFAULT_SECONDS;
+    if (seconds <= 0) seconds = RADIO_DEFAULT_SECONDS;
+    RadioReplayOptions options = {
+        .jitter_ms = argc > 2 ? atoi(argv[2]) : 0,
+        .loss_pct = argc > 3 ? (float)atof(argv[3]) : 0.0f,
+        .kbps = argc > 4 ? atoi(argv[4]) : 0,
+        .seed = RADIO_SEED,
+    };
+
+    char url[2048];
+    if (radio_replay_station(dir, url, sizeof(url)) != 0) {
+        fprintf(stderr, "bench: no station in %s\n", dir);
+        return 1;
+    }
+    // Before any thread exists: the server is forked
+    int port;
+    pid_t server = radio_replay_spawn(dir, &options, &port);
+    if (server < 0) {
+        fprintf(stderr, "bench: can't serve %s\n", dir);
+        return 1;
+    }
+    if (argc > 5) {
+        out = fopen(argv[5], "w");
+        if (!out) {
+            fprintf(stderr, "bench: can't write %s\n", argv[5]);
+            kill(server, SIGTERM);
+            waitpid(server, NULL, 0);
+            return 1;
+        }
+    }
+
+    radio_replay_redirect(port);
+    setenv("SDL_AUDIODRIVER", "dummy", 1);     // Paced like a device, heard by nobody
+    Jobs_init();
+    int result = 1;
+    if (Player_init() == 0 && Radio_init() == 0) {
+        uint64_t cpu_start = clock_ms(CLOCK_PROCESS_CPUTIME_ID);
+        uint64_t start = clock_ms(CLOCK_MONOTONIC);
+        int startup_ms = -1;
+        Radio_resetStats();
+        Radio_play(url);
+
+        uint64_t end = start + (uint64_t)seconds * 1000;
+        RadioState state = Radio_getState();
+        while (state != RADIO_STATE_ERROR && clock_ms(CLOCK_MONOTONIC) < end) {
+            Radio_update();
+            Jobs_poll();
+            state = Radio_getState();
+            if (state == RADIO_STATE_PLAYING && startup_ms < 0) {
+                startup_ms = (int)(clock_ms(CLOCK_MONOTONIC) - start);
+            }
+            usleep(RADIO_POLL_MS * 1000);
+        }
+        uint64_t elapsed = clock_ms(CLOCK_MONOTONIC) - start;
+        uint64_t cpu = clock_ms(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+
+        RadioStats stats;
+        Radio_getStats(&stats);
+        fprintf(out, "{\n  \"platform\": \"%s\",\n  \"mode\": \"radio\",\n  \"station\": \"", PLATFORM);
+        for (const char* c = url; *c; c++) {
+            if (*c == '"' || *c == '\\') fputc('\\', out);
+            fputc(*c, out);
+        }
+        fprintf(out, "\",\n  \"jitter_ms\": %d,\n  \"loss_pct\": %.2f,\n  \"kbps\": %d,\n",
+                options.jitter_ms, options.loss_pct, options.kbps);
+        fprintf(out, "  \"seconds\": %.1f,\n  \"startup_ms\": %d,\n  \"error\": %s,\n",
+                elapsed / 1000.0, startup_ms, state == RADIO_STATE_ERROR ? "true" : "false");
+        fprintf(out, "  \"rebuffers\": %u,\n  \"underruns\": %u,\n  \"silence_samples\": %llu,\n",
+                stats.rebuffers, stats.underruns, (unsigned long long)stats.silence_samples);
+        fprintf(out, "  \"reconnects\": %u,\n  \"outage_ms\": %u,\n  \"outage_max_ms\": %u,\n",
+                stats.reconnects, stats.outage_ms, stats.outage_max_ms);
+        fprintf(out, "  \"buffer_min\": %.3f,\n  \"buffer_avg\": %.3f,\n", stats.buffer_min, stats.buffer_avg);
+        fprintf(out, "  \"net_kbps\": %d,\n  \"decode_kbps\": %d,\n", stats.net_kbps, stats.decode_kbps);
+        fprintf(out, "  \"cpu_ms\": %llu,\n  \"cpu_pct\": %.2f\n}\n",
+                (unsigned long long)cpu, elapsed > 0 ? cpu * 100.0 / elapsed : 0.0);
+        result = 0;
+
+        Radio_stop();
+        Radio_quit();
+        Player_quit();
+    } else {
+        fprintf(stderr, "bench: player or radio init failed\n");
+    }
+    Jobs_quit();
+    radio_replay_redirect(0);
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    if (out != stdout) fclose(out);
+    return result;
+}
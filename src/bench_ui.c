@@ -0,0 +1,433 @@
+// UI render benchmark (make bench)
+//
+//   bench.elf ui [track] [frames] [report.json]
+//
+// Drives the screen renderers the main loop calls through a scripted run of
+// navigation each, against an offscreen surface of the screen's size:
+//   browser          render_browser over a 5000-entry listing: steps, pages, jumps
+//   playing          render_playing with track's cover (when given) and the
+//                    spectrum's bars computed every frame
+//   radio_stations   render_radio_add_stations over the first curated country,
+//                    stepping through and filtering it
+//   youtube_results  render_youtube_results over 50 results, stepping
+// Every frame reports the renderer's CPU time (thread time: job pool work
+// excluded), the allocations it made (SDL's allocator, which SDL_ttf and
+// surfaces go through, and malloc; the bench links with malloc wrapped) and
+// the pixels it changed against the frame before, a lower bound of those it
+// touched. Steps that only move a list selection go through UI_beginFrame as
+// the main loop passes them, so partial repaints count as such. GFX comes up
+// for the fonts and assets the renderers draw with; the harness never flips the
+// screen (GPU layers a renderer draws itself, like the marquees, still go up).
+// Same build, same screen: same script.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "defines.h"
+#include "api.h"
+#include "jobs.h"
+#include "player.h"
+#include "radio.h"
+#include "radio_album_art.h"
+#include "browser.h"
+#include "track_meta.h"
+#include "spectrum.h"
+#include "youtube.h"
+#include "ui_fonts.h"
+#include "ui_utils.h"
+#include "ui_music.h"
+#include "ui_radio.h"
+#include "ui_youtube.h"
+#include "bench.h"
+
+#define UI_DEFAULT_FRAMES 300       // Per screen
+#define UI_BROWSER_ENTRIES 5000
+#define UI_BROWSER_FOLDERS 100
+#define UI_YOUTUBE_RESULTS 50
+#define UI_ART_WAIT_MS 3000         // For the track's cover to be decoded
+
+// ============ ALLOCATION COUNTING ============
+
+static volatile uint32_t allocations = 0;
+
+static SDL_malloc_func sdl_malloc;
+static SDL_calloc_func sdl_calloc;
+static SDL_realloc_func sdl_realloc;
+static SDL_free_func sdl_free;
+
+static void* count_sdl_malloc(size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return sdl_malloc(size);
+}
+
+static void* count_sdl_calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return sdl_calloc(count, size);
+}
+
+static void* count_sdl_realloc(void* ptr, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return sdl_realloc(ptr, size);
+}
+
+// The app's own allocations (-Wl,--wrap=malloc and co. on the bench link line)
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __real_realloc(ptr, size);
+}
+
+// ============ FIXTURES ============
+
+// Navigation steps, one per frame (scripts repeat to fill the frames):
+//   d/u  selection down/up (selection-only frame)   D/U  a page down/up
+//   t    back to the top                           f/c  filter on/cleared
+//   r    full redraw in place
+typedef struct {
+    int selected;
+    int scroll;
+    int count;
+    int page;
+    bool filtered;
+} Nav;
+
+// Apply step; returns true if only the selection moved
+static bool nav_step(Nav* nav, char step) {
+    int moved = nav->selected;
+    switch (step) {
+        case 'd': moved++; break;
+        case 'u': moved--; break;
+        case 'D': moved += nav->page; break;
+        case 'U': moved -= nav->page; break;
+        case 't': moved = 0; break;
+        case 'f': nav->filtered = true; moved = 0; break;
+        case 'c': nav->filtered = false; moved = 0; break;
+        default: break;
+    }
+    if (nav->count > 0) {
+        if (moved < 0) moved = 0;
+        if (moved >= nav->count) moved = nav->count - 1;
+    } else {
+        moved = 0;
+    }
+    nav->selected = moved;
+    return step == 'd' || step == 'u';
+}
+
+// Append s to a listing's string arena
+static uint32_t arena_add(BrowserContext* ctx, const char* s) {
+    uint32_t len = (uint32_t)strlen(s) + 1;
+    uint32_t offset = ctx->strings_size;
+    memcpy(ctx->strings + offset, s, len);
+    ctx->strings_size += len;
+    return offset;
+}
+
+// A big folder: a hundred subfolders, then files named like ripped albums
+static bool make_listing(BrowserContext* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    snprintf(ctx->current_path, sizeof(ctx->current_path), "%s/Music/Bench", SDCARD_PATH);
+    ctx->strings_capacity = UI_BROWSER_ENTRIES * 96 + 1024;
+    ctx->strings = malloc(ctx->strings_capacity);
+    ctx->entries = calloc(UI_BROWSER_ENTRIES, sizeof(FileEntry));
+    if (!ctx->strings || !ctx->entries) return false;
+
+    ctx->strings[0] = '\0';
+    ctx->strings_size = 1;
+    uint32_t dir = arena_add(ctx, ctx->current_path);
+    for (int i = 0; i < UI_BROWSER_ENTRIES; i++) {
+        FileEntry* entry = &ctx->entries[i];
+        char name[96];
+        if (i < UI_BROWSER_FOLDERS) {
+            snprintf(name, sizeof(name), "Artist %03d - Collected Recordings Volume %d", i, i % 7 + 1);
+            entry->is_dir = true;
+        } else {
+            snprintf(name, sizeof(name), "%02d - A Rather Long Song Title That Needs Scrolling %04d.mp3",
+                     i % 20 + 1, i);
+            entry->format = AUDIO_FORMAT_MP3;
+        }
+        entry->name = arena_add(ctx, name);
+        entry->dir = dir;
+        entry->file = entry->name;
+    }
+    ctx->entry_count = UI_BROWSER_ENTRIES;
+    ctx->audio_start = UI_BROWSER_FOLDERS;
+    return true;
+}
+
+static void free_listing(BrowserContext* ctx) {
+    free(ctx->entries);
+    free(ctx->strings);
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+// ============ MEASUREMENT ============
+
+typedef struct {
+    int32_t* cpu_us;
+    int32_t* allocs;
+    int32_t* pixels;
+    int count;
+} Samples;
+
+static int64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (int64_t)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+}
+
+static int64_t clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Pixels of screen that differ from last, which then takes screen's pixels
+static int32_t count_changed(SDL_Surface* screen, uint32_t* last) {
+    int32_t changed = 0;
+    for (int y = 0; y < screen->h; y++) {
+        const uint32_t* row = (const uint32_t*)((const uint8_t*)screen->pixels + (size_t)y * screen->pitch);
+        uint32_t* prev = &last[(size_t)y * screen->w];
+        for (int x = 0; x < screen->w; x++) {
+            if (row[x] != prev[x]) {
+                changed++;
+                prev[x] = row[x];
+            }
+        }
+    }
+    return changed;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report_stat(FILE* out, const char* name, int32_t* values, int count, bool last) {
+    int64_t sum = 0;
+    for (int i = 0; i < count; i++) sum += values[i];
+    qsort(values, count, sizeof(int32_t), compare_ints);
+    fprintf(out, "      \"%s\": {\"mean\": %.1f, \"p50\": %d, \"p90\": %d, \"p99\": %d, \"max\": %d}%s\n", name,
+            count > 0 ? (double)sum / count : 0.0, count > 0 ? values[count / 2] : 0,
+            count > 0 ? values[count * 9 / 10] : 0, count > 0 ? values[(int64_t)count * 99 / 100] : 0,
+            count > 0 ? values[count - 1] : 0, last ? "" : ",");
+}
+
+// ============ SCREENS ============
+
+typedef enum {
+    SCREEN_BROWSER,
+    SCREEN_PLAYING,
+    SCREEN_RADIO_STATIONS,
+    SCREEN_YOUTUBE_RESULTS,
+    SCREEN_COUNT
+} BenchScreen;
+
+static const char* screen_names[SCREEN_COUNT] = {"browser", "playing", "radio_stations", "youtube_results"};
+
+static const char* scripts[SCREEN_COUNT] = {
+    "rddddddddddddddddddddDDDDDuuuuuuuuuuDDDDDDDDDDddddtUr",
+    "r",
+    "rddddddddddDDduuuuufddddddcdddddDDt",
+    "rddddddddddddddddddddDDuuuuuuuuuutr",
+};
+
+typedef struct {
+    SDL_Surface* screen;
+    BrowserContext listing;
+    const char* country;        // Curated country for the stations screen (NULL: none)
+    int country_stations;
+    bool* stations_checked;     // Per station of the country, none checked
+    YouTubeResult* results;
+} Fixtures;
+
+// Render frame i of screen; returns false if the screen can't run here
+static bool render_frame(BenchScreen which, Fixtures* fx, Nav* nav, int i) {
+    const char* script = scripts[which];
+    bool selection_only = nav_step(nav, script[i % strlen(script)]);
+    SDL_Surface* screen = fx->screen;
+
+    UI_beginFrame(selection_only);
+    if (!selection_only) GFX_clearLayers(LAYER_SCROLLTEXT);
+    switch (which) {
+        case SCREEN_BROWSER:
+            fx->listing.selected = nav->selected;
+            render_browser(screen, 0, &fx->listing);
+            nav->page = fx->listing.items_per_page;
+            break;
+        case SCREEN_PLAYING:
+            Spectrum_update();
+            render_playing(screen, 0, 3, 12, false, false);
+            break;
+        case SCREEN_RADIO_STATIONS: {
+            const char* query = nav->filtered ? "radio" : "";
+            nav->count = Radio_openCuratedView(fx->country, query);
+            if (nav->selected >= nav->count) nav->selected = nav->count > 0 ? nav->count - 1 : 0;
+            render_radio_add_stations(screen, 0, fx->country, query, nav->selected, &nav->scroll,
+                                      fx->stations_checked, fx->country_stations);
+            break;
+        }
+        case SCREEN_YOUTUBE_RESULTS:
+            render_youtube_results(screen, 0, "long song titles", fx->results, UI_YOUTUBE_RESULTS,
+                                   nav->selected, &nav->scroll, "", 0, false, "");
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+static bool run_screen(BenchScreen which, Fixtures* fx, int frames, Samples* samples, uint32_t* last) {
+    Nav nav = {0};
+    nav.page = 8;
+    if (which == SCREEN_BROWSER) nav.count = fx->listing.entry_count;
+    if (which == SCREEN_YOUTUBE_RESULTS) nav.count = UI_YOUTUBE_RESULTS;
+    if (which == SCREEN_RADIO_STATIONS && !fx->stations_checked) return false;
+
+    // Start from a black frame, as after a screen switch
+    SDL_FillRect(fx->screen, NULL, 0);
+    memset(last, 0, (size_t)fx->screen->w * fx->screen->h * sizeof(uint32_t));
+
+    samples->count = 0;
+    for (int i = 0; i < frames; i++) {
+        Jobs_poll();            // Covers and tags arriving, as between main loop frames
+        uint32_t allocs_before = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+        int64_t start = thread_cpu_ns();
+        if (!render_frame(which, fx, &nav, i)) return false;
+        int64_t cpu = thread_cpu_ns() - start;
+        uint32_t allocs = __atomic_load_n(&allocations, __ATOMIC_RELAXED) - allocs_before;
+
+        samples->cpu_us[samples->count] = (int32_t)(cpu / 1000);
+        samples->allocs[samples->count] = (int32_t)allocs;
+        samples->pixels[samples->count] = count_changed(fx->screen, last);
+        samples->count++;
+    }
+    return true;
+}
+
+// ============ HARNESS ============
+
+int BenchUi_main(int argc, char* argv[], FILE* out) {
+    // Before SDL allocates anything: every allocation is counted
+    SDL_GetMemoryFunctions(&sdl_malloc, &sdl_calloc, &sdl_realloc, &sdl_free);
+    SDL_SetMemoryFunctions(count_sdl_malloc, count_sdl_calloc, count_sdl_realloc, sdl_free);
+
+    const char* track = argc > 0 && argv[0][0] ? argv[0] : NULL;
+    int frames = argc > 1 ? atoi(argv[1]) : UI_DEFAULT_FRAMES;
+    if (frames <= 0) frames = UI_DEFAULT_FRAMES;
+    if (argc > 2) {
+        out = fopen(argv[2], "w");
+        if (!out) {
+            fprintf(stderr, "bench: can't write %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    InitSettings();
+    SDL_Surface* device = GFX_init(MODE_MAIN);
+    radio_album_art_set_display_size(device->h);
+    load_custom_fonts();
+    setenv("SDL_AUDIODRIVER", "dummy", 1);
+    Jobs_init();
+    TrackMeta_init();
+    Spectrum_init();
+    int result = 1;
+
+    Fixtures fx;
+    memset(&fx, 0, sizeof(fx));
+    fx.screen = SDL_CreateRGBSurfaceWithFormat(0, device->w, device->h, 32, device->format->format);
+    uint32_t* last = fx.screen ? malloc((size_t)device->w * device->h * sizeof(uint32_t)) : NULL;
+    fx.results = calloc(UI_YOUTUBE_RESULTS, sizeof(YouTubeResult));
+    Samples samples = {
+        malloc(frames * sizeof(int32_t)), malloc(frames * sizeof(int32_t)), malloc(frames * sizeof(int32_t)), 0
+    };
+    bool player = false, radio = false;
+    if (!last || !fx.results || !samples.cpu_us || !samples.allocs || !samples.pixels ||
+        !make_listing(&fx.listing) || !(player = Player_init() == 0) || !(radio = Radio_init() == 0)) {
+        fprintf(stderr, "bench: ui setup failed\n");
+        goto done;
+    }
+
+    for (int i = 0; i < UI_YOUTUBE_RESULTS; i++) {
+        YouTubeResult* r = &fx.results[i];
+        snprintf(r->video_id, sizeof(r->video_id), "bench%06d", i);
+        snprintf(r->title, sizeof(r->title), "Live Session %d: An Extended Performance Of A Long Song Title", i);
+        snprintf(r->artist, sizeof(r->artist), "Channel %d", i % 9);
+        r->duration_sec = 180 + i * 7;
+    }
+    if (Radio_getCuratedCountryCount() > 0) {
+        fx.country = Radio_getCuratedCountries()[0].code;
+        fx.country_stations = Radio_getCuratedStationCount(fx.country);
+        fx.stations_checked = calloc(fx.country_stations + 1, sizeof(bool));
+    }
+
+    // The track plays (heard by nobody) so the screen has its tags, cover and spectrum
+    bool playing = false;
+    if (track && Player_load(track) == 0 && Player_play() == 0) {
+        playing = true;
+        int64_t until = clock_ms() + UI_ART_WAIT_MS;
+        while (!Player_getAlbumArt() && clock_ms() < until) {
+            Jobs_poll();
+            usleep(10000);
+        }
+    }
+
+    fprintf(out, "{\n  \"platform\": \"%s\",\n  \"mode\": \"ui\",\n  \"width\": %d,\n  \"height\": %d,\n",
+            PLATFORM, device->w, device->h);
+    fprintf(out, "  \"frames\": %d,\n  \"track\": %s,\n  \"cover\": %s,\n  \"screens\": {\n", frames,
+            playing ? "true" : "false", Player_getAlbumArt() ? "true" : "false");
+    bool first = true;
+    for (int which = 0; which < SCREEN_COUNT; which++) {
+        if (!run_screen((BenchScreen)which, &fx, frames, &samples, last)) {
+            fprintf(stderr, "bench: skipped %s (nothing to show)\n", screen_names[which]);
+            continue;
+        }
+        fprintf(out, "%s    \"%s\": {\n", first ? "" : ",\n", screen_names[which]);
+        report_stat(out, "cpu_us", samples.cpu_us, samples.count, false);
+        report_stat(out, "allocs", samples.allocs, samples.count, false);
+        report_stat(out, "pixels_changed", samples.pixels, samples.count, true);
+        fprintf(out, "    }");
+        first = false;
+    }
+    fprintf(out, "\n  }\n}\n");
+    result = 0;
+
+    if (playing) Player_stop();
+done:
+    if (radio) Radio_quit();
+    if (player) Player_quit();
+    free_listing(&fx.listing);
+    free(fx.stations_checked);
+    free(samples.pixels);
+    free(samples.allocs);
+    free(samples.cpu_us);
+    free(fx.results);
+    free(last);
+    SDL_FreeSurface(fx.screen);
+    Spectrum_quit();
+    TrackMeta_quit();
+    Jobs_quit();
+    unload_custom_fonts();
+    GFX_quit();
+    QuitSettings();
+    if (out != stdout) fclose(out);
+    return result;
+}
@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "bgtransfer.h"
+#include "radio.h"
+#include "radio_net.h"
+#include "defines.h"
+#include "api.h"
+
+#define PACE_WINDOW_MS 1000         // Rate adjusted once per window
+#define PACE_RATE_STEP (32 * 1024)  // Added per window while the radio buffer holds
+#define PACE_DRAIN 0.02f            // Level drop over a window taken as draining
+#define PACE_POLL_US 100000
+#define DOWNLOAD_BUFFER_SIZE (256 * 1024)
+
+static pthread_mutex_t pace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int rate = BGTRANSFER_RATE_START;
+static int64_t credit = 0;              // Bytes that may still go (negative = owed)
+static uint64_t refilled_ms = 0;
+static uint64_t window_start_ms = 0;
+static float window_level = 0.0f;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Bring the budget up to now (pace_mutex held)
+// Returns true if transfers may run unpaced (the radio is off).
+static bool update_budget(uint64_t now) {
+    if (!Radio_isActive()) {
+        rate = BGTRANSFER_RATE_START;
+        credit = 0;
+        refilled_ms = now;
+        window_start_ms = 0;
+        return true;
+    }
+
+    RadioState state = Radio_getState();
+    float level = Radio_getBufferLevel();
+    if (state == RADIO_STATE_CONNECTING || state == RADIO_STATE_BUFFERING || level < BGTRANSFER_PAUSE_LEVEL) {
+        // Paused: nothing accrues, and the rate starts low again
+        refilled_ms = now;
+        window_start_ms = 0;
+        if (rate > BGTRANSFER_RATE_START) rate = BGTRANSFER_RATE_START;
+        return false;
+    }
+
+    // Additive increase while the buffer holds, halve when it drains
+    if (window_start_ms == 0) {
+        window_start_ms = now;
+        window_level = level;
+    } else if (now - window_start_ms >= PACE_WINDOW_MS) {
+        if (level < window_level - PACE_DRAIN) {
+            rate /= 2;
+            if (rate < BGTRANSFER_RATE_MIN) rate = BGTRANSFER_RATE_MIN;
+        } else if (rate < BGTRANSFER_RATE_MAX) {
+            rate += PACE_RATE_STEP;
+        }
+        window_start_ms = now;
+        window_level = level;
+    }
+
+    // At most a second's worth saved up
+    credit += (int64_t)rate * (int64_t)(now - refilled_ms) / 1000;
+    if (credit > rate) credit = rate;
+    refilled_ms = now;
+    return false;
+}
+
+void BgTransfer_pace(int bytes, volatile bool* cancel) {
+    pthread_mutex_lock(&pace_mutex);
+    if (!update_budget(now_ms())) credit -= bytes;
+    pthread_mutex_unlock(&pace_mutex);
+
+    while (!(cancel && *cancel)) {
+        pthread_mutex_lock(&pace_mutex);
+        bool go = update_budget(now_ms()) || credit >= 0;
+        pthread_mutex_unlock(&pace_mutex);
+        if (go) break;
+        usleep(PACE_POLL_US);
+    }
+}
+
+typedef struct {
+    FILE* file;
+    volatile bool* cancel;
+    bool failed;
+} Download;
+
+static bool download_data(void* ctx, const uint8_t* data, int len) {
+    Download* dl = (Download*)ctx;
+    if (fwrite(data, 1, len, dl->file) != (size_t)len) {
+        dl->failed = true;
+        return false;
+    }
+    BgTransfer_pace(len, dl->cancel);
+    return !(dl->cancel && *dl->cancel);
+}
+
+int BgTransfer_download(const char* url, const char* path, volatile bool* cancel) {
+    char temp[600];
+    snprintf(temp, sizeof(temp), "%s.part", path);
+
+    Download dl = {fopen(temp, "wb"), cancel, false};
+    if (!dl.file) return -1;
+    char* buf = malloc(DOWNLOAD_BUFFER_SIZE);
+    if (buf) setvbuf(dl.file, buf, _IOFBF, DOWNLOAD_BUFFER_SIZE);
+
+    int received = radio_net_fetchStream(url, download_data, &dl);
+    if (fclose(dl.file) != 0) dl.failed = true;
+    free(buf);
+
+    if (received <= 0 || dl.failed || (cancel && *cancel) || rename(temp, path) != 0) {
+        LOG_error("[BgTransfer] Download failed: %s\n", url);
+        unlink(temp);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,27 @@
+#ifndef __BGTRANSFER_H__
+#define __BGTRANSFER_H__
+
+#include <stdbool.h>
+
+// Background transfer pacing
+// Update downloads share the Wi-Fi link with the radio stream. While the radio
+// is off they run at full speed. While it streams they share a byte budget
+// whose rate adapts to the radio buffer: raised while the buffer holds or
+// fills, halved when it drains, and paused altogether while it is low or the
+// radio is (re)buffering. Safe from any thread.
+
+#define BGTRANSFER_RATE_MIN (16 * 1024)         // Bytes per second
+#define BGTRANSFER_RATE_START (64 * 1024)
+#define BGTRANSFER_RATE_MAX (1024 * 1024)
+#define BGTRANSFER_PAUSE_LEVEL 0.40f            // Radio buffer level transfers pause below
+
+// Account for bytes just received by a background transfer, waiting as long as
+// the budget asks (returns early once *cancel is set; cancel may be NULL)
+void BgTransfer_pace(int bytes, volatile bool* cancel);
+
+// Download url to path, paced. The file is written under a temp name and renamed
+// into place once complete.
+// Returns 0, or -1 on error or cancel.
+int BgTransfer_download(const char* url, const char* path, volatile bool* cancel);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <SDL2/SDL.h>
+
+#include "bookmarks.h"
+#include "jobs.h"
+#include "defines.h"
+#include "api.h"
+
+#define BOOKMARKS_FILE SHARED_USERDATA_PATH "/music_bookmarks.bin"
+#define BOOKMARKS_MAGIC 0x314B4D42  // "BMK1"
+
+typedef struct {
+    char path[512];
+    int64_t mtime;
+    int64_t size;
+    uint32_t saved;             // Save clock, for eviction (0 = free slot)
+    Bookmark bookmark;
+} BookmarkEntry;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    BookmarkEntry entries[BOOKMARKS_MAX];
+    bool ok;                    // Written (result for the main thread)
+} BookmarksSnapshot;
+
+static BookmarksSnapshot store;
+static uint32_t save_clock = 0;
+static bool dirty = false;
+static bool flushing = false;   // A write job is in flight
+static uint32_t flushed_at = 0;
+
+static bool write_snapshot(const BookmarksSnapshot* snapshot) {
+    const char* tmp = BOOKMARKS_FILE ".tmp";
+    FILE* f = fopen(tmp, "wb");
+    if (!f) return false;
+    bool ok = fwrite(&snapshot->magic, sizeof(uint32_t), 1, f) == 1 &&
+              fwrite(&snapshot->count, sizeof(uint32_t), 1, f) == 1 &&
+              (snapshot->count == 0 ||
+               fwrite(snapshot->entries, sizeof(BookmarkEntry), snapshot->count, f) == snapshot->count);
+    if (fclose(f) != 0 || !ok || rename(tmp, BOOKMARKS_FILE) != 0) {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+static void flush_job(void* arg, JobToken* token) {
+    (void)token;
+    BookmarksSnapshot* snapshot = (BookmarksSnapshot*)arg;
+    snapshot->ok = write_snapshot(snapshot);
+}
+
+static void flush_done(void* arg, bool cancelled) {
+    BookmarksSnapshot* snapshot = (BookmarksSnapshot*)arg;
+    flushing = false;
+    if (cancelled || !snapshot->ok) {
+        if (!cancelled) LOG_error("Bookmarks: failed to write %s\n", BOOKMARKS_FILE);
+        dirty = true;           // Tried again after the interval (or by Bookmarks_quit)
+    }
+    free(snapshot);
+}
+
+void Bookmarks_init(void) {
+    memset(&store, 0, sizeof(store));
+    store.magic = BOOKMARKS_MAGIC;
+    FILE* f = fopen(BOOKMARKS_FILE, "rb");
+    if (!f) return;
+
+    uint32_t magic = 0, count = 0;
+    if (fread(&magic, sizeof(magic), 1, f) == 1 && magic == BOOKMARKS_MAGIC &&
+        fread(&count, sizeof(count), 1, f) == 1 && count <= BOOKMARKS_MAX &&
+        fread(store.entries, sizeof(BookmarkEntry), count, f) == count) {
+        store.count = count;
+    }
+    fclose(f);
+
+    // Saved in order of the clock they were written with; carry it on
+    for (uint32_t i = 0; i < store.count; i++) {
+        store.entries[i].path[sizeof(store.entries[i].path) - 1] = '\0';
+        if (store.entries[i].saved > save_clock) save_clock = store.entries[i].saved;
+    }
+}
+
+void Bookmarks_quit(void) {
+    if (!dirty) return;
+    if (write_snapshot(&store)) dirty = false;
+}
+
+static BookmarkEntry* find_entry(const char* path) {
+    for (uint32_t i = 0; i < store.count; i++) {
+        if (strcmp(store.entries[i].path, path) == 0) return &store.entries[i];
+    }
+    return NULL;
+}
+
+bool Bookmarks_get(const char* path, Bookmark* bookmark) {
+    BookmarkEntry* entry = find_entry(path);
+    if (!entry) return false;
+    struct stat st;
+    if (stat(path, &st) != 0 || entry->mtime != (int64_t)st.st_mtime || entry->size != (int64_t)st.st_size) {
+        Bookmarks_clear(path);  // Replaced or gone: its position means nothing now
+        return false;
+    }
+    *bookmark = entry->bookmark;
+    return true;
+}
+
+void Bookmarks_set(const char* path, int position_ms, const SeekHint* hint) {
+    struct stat st;
+    if (!path || !path[0] || strlen(path) >= sizeof(store.entries[0].path) || stat(path, &st) != 0) return;
+
+    BookmarkEntry* entry = find_entry(path);
+    if (!entry && store.count < BOOKMARKS_MAX) {
+        entry = &store.entries[store.count++];
+    } else if (!entry) {
+        entry = &store.entries[0];
+        for (uint32_t i = 1; i < store.count; i++) {
+            if (store.entries[i].saved < entry->saved) entry = &store.entries[i];
+        }
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    snprintf(entry->path, sizeof(entry->path), "%s", path);
+    entry->mtime = (int64_t)st.st_mtime;
+    entry->size = (int64_t)st.st_size;
+    entry->saved = ++save_clock;
+    entry->bookmark.position_ms = position_ms;
+    if (hint) {
+        entry->bookmark.hint = *hint;
+    } else {
+        entry->bookmark.hint.frame = -1;
+    }
+    dirty = true;
+}
+
+void Bookmarks_clear(const char* path) {
+    BookmarkEntry* entry = find_entry(path);
+    if (!entry) return;
+    *entry = store.entries[--store.count];
+    memset(&store.entries[store.count], 0, sizeof(BookmarkEntry));
+    dirty = true;
+}
+
+void Bookmarks_poll(void) {
+    if (!dirty || flushing) return;
+    uint32_t now = SDL_GetTicks();
+    if (flushed_at && now - flushed_at < BOOKMARKS_FLUSH_INTERVAL_MS) return;
+
+    BookmarksSnapshot* snapshot = malloc(sizeof(BookmarksSnapshot));
+    if (!snapshot) return;
+    *snapshot = store;
+    if (Jobs_post(JOB_PRIORITY_BACKGROUND, flush_job, flush_done, snapshot) != 0) {
+        free(snapshot);
+        return;
+    }
+    dirty = false;
+    flushing = true;
+    flushed_at = now;
+}
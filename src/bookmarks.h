@@ -0,0 +1,46 @@
+#ifndef __BOOKMARKS_H__
+#define __BOOKMARKS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "player.h"
+
+// Resume positions of long files (audiobooks, podcasts)
+// One entry per file, next to the library index: the position last heard and
+// the decoder's seek index entry at or before it, so reopening the file lands
+// there in one direct seek. Entries are checked against the file's mtime and
+// size like the library's records; the least recently saved one makes room
+// past BOOKMARKS_MAX. Changes are kept in memory and written out by a
+// background job at most every BOOKMARKS_FLUSH_INTERVAL_MS.
+// All functions are for the main thread.
+
+#define BOOKMARKS_MAX 64
+#define BOOKMARKS_FLUSH_INTERVAL_MS 30000
+#define BOOKMARK_MIN_DURATION_MS (20 * 60 * 1000)   // Shorter files start from the top
+#define BOOKMARK_SAVE_MS 5000                       // Playback clock sampled this often
+#define BOOKMARK_END_MS 30000                       // This close to the end counts as finished
+
+typedef struct {
+    int position_ms;            // In the file
+    SeekHint hint;              // hint.frame = -1 without one
+} Bookmark;
+
+void Bookmarks_init(void);
+
+// Write out pending changes
+void Bookmarks_quit(void);
+
+// Resume point of path, if it has one and the file is unchanged
+bool Bookmarks_get(const char* path, Bookmark* bookmark);
+
+// Save (or move) the resume point of path; hint may be NULL
+void Bookmarks_set(const char* path, int position_ms, const SeekHint* hint);
+
+// Forget path's resume point (played to the end)
+void Bookmarks_clear(const char* path);
+
+// Call once per main loop iteration: starts a due write
+void Bookmarks_poll(void);
+
+#endif
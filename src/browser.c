@@ -3,10 +3,19 @@
 #include <string.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <time.h>
 
 #include "defines.h"
 #include "api.h"
 #include "browser.h"
+#include "playlist.h"
+#include "folder_art.h"
+#include "track_meta.h"
+#include "jobs.h"
+#include "trace.h"
+#include "memstats.h"
 
 // Check if file is a supported audio format
 bool Browser_isAudioFile(const char* filename) {
@@ -17,124 +26,699 @@ bool Browser_isAudioFile(const char* filename) {
 // Free browser entries
 void Browser_freeEntries(BrowserContext* ctx) {
     if (ctx->entries) {
-        free(ctx->entries);
+        MEM_FREE(MEM_TAG_BROWSER, ctx->entries);
         ctx->entries = NULL;
     }
     ctx->entry_count = 0;
+    ctx->audio_start = 0;
+    MEM_FREE(MEM_TAG_BROWSER, ctx->strings);
+    ctx->strings = NULL;
+    ctx->strings_size = 0;
+    ctx->strings_capacity = 0;
 }
 
-// Compare function for sorting entries (directories first, then alphabetical)
-static int compare_entries(const void* a, const void* b) {
-    const FileEntry* ea = (const FileEntry*)a;
-    const FileEntry* eb = (const FileEntry*)b;
+// Append a string to the arena and return its offset (0, the empty string, if
+// out of memory). The arena may move: keep offsets, not pointers, across calls.
+static uint32_t add_string(BrowserContext* ctx, const char* s) {
+    if (!s[0]) return 0;
+    size_t len = strlen(s) + 1;
+    uint32_t size = ctx->strings_size ? ctx->strings_size : 1;
+    if (size + len > ctx->strings_capacity) {
+        uint32_t capacity = ctx->strings_capacity ? ctx->strings_capacity : 4096;
+        while (size + len > capacity) capacity *= 2;
+        char* grown = MEM_REALLOC(MEM_TAG_BROWSER, ctx->strings, capacity);
+        if (!grown) return 0;
+        ctx->strings = grown;
+        ctx->strings_capacity = capacity;
+    }
+    if (ctx->strings_size == 0) {
+        ctx->strings[0] = '\0';
+        ctx->strings_size = 1;
+    }
+    uint32_t offset = ctx->strings_size;
+    memcpy(&ctx->strings[offset], s, len);
+    ctx->strings_size += len;
+    return offset;
+}
 
-    // Directories come first
-    if (ea->is_dir && !eb->is_dir) return -1;
-    if (!ea->is_dir && eb->is_dir) return 1;
+const char* Browser_string(const BrowserContext* ctx, uint32_t offset) {
+    if (!ctx->strings || offset >= ctx->strings_size) return "";
+    return &ctx->strings[offset];
+}
 
-    // Alphabetical
-    return strcasecmp(ea->name, eb->name);
+void Browser_getPath(const BrowserContext* ctx, const FileEntry* entry, char* out, int max_len) {
+    if (entry->file) {
+        snprintf(out, max_len, "%s/%s", Browser_string(ctx, entry->dir), Browser_string(ctx, entry->file));
+    } else {
+        snprintf(out, max_len, "%s", Browser_string(ctx, entry->dir));
+    }
 }
 
-// Load directory contents
-void Browser_loadDirectory(BrowserContext* ctx, const char* path, const char* music_root) {
-    Browser_freeEntries(ctx);
+bool Browser_isSameFile(const BrowserContext* ctx, const FileEntry* a, const FileEntry* b) {
+    return strcmp(Browser_string(ctx, a->dir), Browser_string(ctx, b->dir)) == 0 &&
+           strcmp(Browser_string(ctx, a->file), Browser_string(ctx, b->file)) == 0;
+}
 
-    strncpy(ctx->current_path, path, sizeof(ctx->current_path) - 1);
-    ctx->selected = 0;
-    ctx->scroll_offset = 0;
+// Name an entry sorts by: cue tracks take the place of their album file
+static const char* sort_name(const BrowserContext* ctx, const FileEntry* entry) {
+    if (entry->cue_track == 0) return Browser_string(ctx, entry->name);
+    const char* file = Browser_string(ctx, entry->file);
+    const char* slash = strrchr(file, '/');
+    return slash ? slash + 1 : file;
+}
 
-    // Create music folder if it doesn't exist
-    if (strcmp(path, music_root) == 0) {
-        mkdir(path, 0755);
+// Entry reference with its case-folded sort name, so sorting compares with strcmp
+typedef struct {
+    const char* key;
+    int index;
+    int start_ms;
+    uint8_t group;          // 0 = directory, 1 = playlist, 2 = audio file
+    bool cue_track;
+} SortItem;
+
+// Directories first, then playlists, then alphabetical, tracks of the same album
+// file in play order
+static int compare_sort_items(const void* a, const void* b) {
+    const SortItem* ia = (const SortItem*)a;
+    const SortItem* ib = (const SortItem*)b;
+
+    if (ia->group != ib->group) return ia->group - ib->group;
+
+    int cmp = strcmp(ia->key, ib->key);
+    if (cmp == 0 && ia->cue_track && ib->cue_track) {
+        cmp = ia->start_ms - ib->start_ms;
     }
+    return cmp;
+}
 
-    DIR* dir = opendir(path);
-    if (!dir) {
-        LOG_error("Failed to open directory: %s\n", path);
+// Sort entries[0..count) (falls back to leaving them unsorted if out of memory)
+static void sort_entries(const BrowserContext* ctx, FileEntry* entries, int count) {
+    size_t key_bytes = 0;
+    for (int i = 0; i < count; i++) {
+        key_bytes += strlen(sort_name(ctx, &entries[i])) + 1;
+    }
+
+    SortItem* items = malloc(sizeof(SortItem) * count);
+    char* keys = malloc(key_bytes);
+    FileEntry* sorted = malloc(sizeof(FileEntry) * count);
+    if (!items || !keys || !sorted) {
+        free(items);
+        free(keys);
+        free(sorted);
         return;
     }
 
-    // First pass: count entries
-    int count = 0;
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != NULL) {
-        if (ent->d_name[0] == '.') continue;  // Skip hidden files
+    // Fold case once per entry (strcasecmp's tolower ordering)
+    char* key = keys;
+    for (int i = 0; i < count; i++) {
+        const char* name = sort_name(ctx, &entries[i]);
+        items[i].key = key;
+        while (*name) *key++ = (char)tolower((unsigned char)*name++);
+        *key++ = '\0';
+        items[i].index = i;
+        items[i].start_ms = entries[i].start_ms;
+        items[i].group = entries[i].is_dir ? 0 : entries[i].is_playlist ? 1 : 2;
+        items[i].cue_track = entries[i].cue_track != 0;
+    }
+
+    qsort(items, count, sizeof(SortItem), compare_sort_items);
+    for (int i = 0; i < count; i++) {
+        sorted[i] = entries[items[i].index];
+    }
+    memcpy(entries, sorted, sizeof(FileEntry) * count);
+
+    free(sorted);
+    free(keys);
+    free(items);
+}
+
+// === CUE SHEETS ===
 
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, ent->d_name);
+#define CUE_FRAMES_PER_SECOND 75
 
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
+// Tracks parsed from the cue sheets of the directory being loaded
+typedef struct {
+    FileEntry* entries;
+    int count;
+    int capacity;
+} CueList;
 
-        if (S_ISDIR(st.st_mode) || Browser_isAudioFile(ent->d_name)) {
-            count++;
+// Read the next token of a cue line into out (quoted strings keep their spaces)
+static const char* cue_token(const char* p, char* out, size_t out_size) {
+    size_t len = 0;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '"') {
+        p++;
+        for (; *p && *p != '"'; p++) {
+            if (len + 1 < out_size) out[len++] = *p;
+        }
+        if (*p == '"') p++;
+    } else {
+        for (; *p && *p != ' ' && *p != '\t'; p++) {
+            if (len + 1 < out_size) out[len++] = *p;
         }
     }
+    out[len] = '\0';
+    return p;
+}
 
-    // Add parent directory entry if not at root
-    bool has_parent = (strcmp(path, music_root) != 0);
-    if (has_parent) count++;
+// mm:ss:ff (75 frames per second) to milliseconds, -1 if malformed
+static int cue_time_ms(const char* text) {
+    int mm, ss, ff;
+    if (sscanf(text, "%d:%d:%d", &mm, &ss, &ff) != 3) return -1;
+    if (mm < 0 || ss < 0 || ss > 59 || ff < 0 || ff >= CUE_FRAMES_PER_SECOND) return -1;
+    return (mm * 60 + ss) * 1000 + ff * 1000 / CUE_FRAMES_PER_SECOND;
+}
+
+// Resolve a cue FILE name next to the sheet. Rips are often converted after the
+// sheet was written (FILE "album.wav" next to album.flac), so other audio
+// extensions with the same stem are tried too.
+static bool cue_resolve_file(const char* dir, const char* name, char* out, size_t out_size) {
+    static const char* exts[] = { ".flac", ".wav", ".mp3", ".ogg", ".m4a" };
+    struct stat st;
+
+    snprintf(out, out_size, "%s/%s", dir, name);
+    for (char* c = out + strlen(dir); *c; c++) {
+        if (*c == '\\') *c = '/';  // Sheets written on Windows
+    }
+    if (stat(out, &st) == 0 && S_ISREG(st.st_mode)) {
+        return Browser_isAudioFile(out);
+    }
+
+    char* dot = strrchr(out, '.');
+    if (!dot || dot < strrchr(out, '/')) dot = out + strlen(out);
+    size_t stem = dot - out;
+    for (int i = 0; i < (int)(sizeof(exts) / sizeof(exts[0])); i++) {
+        if (stem + strlen(exts[i]) >= out_size) break;
+        strcpy(out + stem, exts[i]);
+        if (stat(out, &st) == 0 && S_ISREG(st.st_mode)) return true;
+    }
+    return false;
+}
+
+// True if one of the first count tracks plays file (a name inside the directory)
+static bool cue_list_has_file(const BrowserContext* ctx, const CueList* list, int count, const char* file) {
+    for (int i = 0; i < count; i++) {
+        if (strcasecmp(Browser_string(ctx, list->entries[i].file), file) == 0) return true;
+    }
+    return false;
+}
+
+static FileEntry* cue_list_add(CueList* list) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 32;
+        FileEntry* grown = MEM_REALLOC(MEM_TAG_BROWSER, list->entries, sizeof(FileEntry) * capacity);
+        if (!grown) return NULL;
+        list->entries = grown;
+        list->capacity = capacity;
+    }
+    FileEntry* entry = &list->entries[list->count++];
+    memset(entry, 0, sizeof(FileEntry));
+    return entry;
+}
+
+// Add the audio tracks of one cue sheet to list
+// Files an earlier sheet already covers are skipped (several sheets for one rip).
+// Strings go to the arena, dir_offset is the directory's string.
+static void cue_parse(BrowserContext* ctx, uint32_t dir_offset, const char* cue_path, CueList* list) {
+    FILE* f = fopen(cue_path, "r");
+    if (!f) return;
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s", Browser_string(ctx, dir_offset));
+
+    int first = list->count;
+    char album[128] = "";
+    char album_artist[128] = "";
+    char file[512] = "";        // Current FILE, empty if it can't be played
+    uint32_t file_offset = 0;   // ...its name inside dir
+    FileEntry* track = NULL;    // Current TRACK, NULL outside an audio track
+    char line[1024], key[32], value[512];
+
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        const char* p = line;
+        if ((unsigned char)p[0] == 0xEF && (unsigned char)p[1] == 0xBB && (unsigned char)p[2] == 0xBF) {
+            p += 3;  // UTF-8 BOM
+        }
+        p = cue_token(p, key, sizeof(key));
+
+        if (strcasecmp(key, "FILE") == 0) {
+            cue_token(p, value, sizeof(value));
+            track = NULL;
+            if (!cue_resolve_file(dir, value, file, sizeof(file)) ||
+                cue_list_has_file(ctx, list, first, file + strlen(dir) + 1)) {
+                file[0] = '\0';
+            } else {
+                file_offset = add_string(ctx, file + strlen(dir) + 1);
+            }
+        } else if (strcasecmp(key, "TRACK") == 0) {
+            char type[16];
+            p = cue_token(p, value, sizeof(value));
+            cue_token(p, type, sizeof(type));
+            track = NULL;
+            if (!file[0] || strcasecmp(type, "AUDIO") != 0) continue;
+
+            track = cue_list_add(list);
+            if (!track) break;
+            track->cue_track = (uint16_t)atoi(value);
+            track->start_ms = -1;
+            track->dir = dir_offset;
+            track->file = file_offset;
+            track->format = Player_detectFormat(file);
+        } else if (strcasecmp(key, "TITLE") == 0) {
+            cue_token(p, value, sizeof(value));
+            if (track) {
+                track->name = add_string(ctx, value);
+            } else {
+                strncpy(album, value, sizeof(album) - 1);
+            }
+        } else if (strcasecmp(key, "PERFORMER") == 0) {
+            cue_token(p, value, sizeof(value));
+            if (track) {
+                track->artist = add_string(ctx, value);
+            } else {
+                strncpy(album_artist, value, sizeof(album_artist) - 1);
+            }
+        } else if (strcasecmp(key, "INDEX") == 0 && track) {
+            p = cue_token(p, value, sizeof(value));
+            if (atoi(value) == 1) {
+                cue_token(p, value, sizeof(value));
+                track->start_ms = cue_time_ms(value);
+            }
+        }
+    }
+    fclose(f);
+
+    // Drop tracks without a usable INDEX 01, fill in album-level fields (stored once)
+    uint32_t album_offset = add_string(ctx, album);
+    uint32_t album_artist_offset = add_string(ctx, album_artist);
+    int count = first;
+    for (int i = first; i < list->count; i++) {
+        FileEntry* entry = &list->entries[i];
+        if (entry->start_ms < 0) continue;
+        if (!entry->name) {
+            char name[16];
+            snprintf(name, sizeof(name), "Track %02d", entry->cue_track);
+            entry->name = add_string(ctx, name);
+        }
+        if (!entry->artist) entry->artist = album_artist_offset;
+        entry->album = album_offset;
+        list->entries[count++] = *entry;
+    }
+    list->count = count;
+
+    // Each track runs until the next one in the same file starts
+    for (int i = first; i < list->count; i++) {
+        FileEntry* entry = &list->entries[i];
+        FileEntry* next = i + 1 < list->count ? &list->entries[i + 1] : NULL;
+        if (next && strcmp(Browser_string(ctx, next->file), Browser_string(ctx, entry->file)) == 0 &&
+            next->start_ms > entry->start_ms) {
+            entry->end_ms = next->start_ms;
+        }
+    }
+}
+
+void Browser_getRegion(const BrowserContext* ctx, const FileEntry* entry, TrackRegion* region) {
+    memset(region, 0, sizeof(TrackRegion));
+    if (entry->cue_track == 0) return;
+
+    region->start_ms = entry->start_ms;
+    region->end_ms = entry->end_ms;
+    strncpy(region->title, Browser_string(ctx, entry->name), sizeof(region->title) - 1);
+    strncpy(region->artist, Browser_string(ctx, entry->artist), sizeof(region->artist) - 1);
+    strncpy(region->album, Browser_string(ctx, entry->album), sizeof(region->album) - 1);
+}
+
+// Append a zeroed entry, growing the array as needed (NULL if out of memory)
+static FileEntry* add_entry(BrowserContext* ctx, int* capacity) {
+    if (ctx->entry_count == *capacity) {
+        int grown_capacity = *capacity ? *capacity * 2 : 64;
+        FileEntry* grown = MEM_REALLOC(MEM_TAG_BROWSER, ctx->entries, sizeof(FileEntry) * grown_capacity);
+        if (!grown) return NULL;
+        ctx->entries = grown;
+        *capacity = grown_capacity;
+    }
+    FileEntry* entry = &ctx->entries[ctx->entry_count++];
+    memset(entry, 0, sizeof(FileEntry));
+    return entry;
+}
+
+// === LISTING CACHE ===
+// Sorted listings of recently visited directories, valid while the directory
+// mtime is unchanged (adding, removing or renaming an entry updates it)
+
+#define LISTING_CACHE_SIZE 8
+#define LISTING_MTIME_SLACK 2   // FAT stores mtimes in 2 s steps
+
+typedef struct {
+    char path[512];             // Empty if unused
+    time_t mtime;
+    FileEntry* entries;
+    int entry_count;
+    char* strings;
+    uint32_t strings_size;
+    unsigned last_used;
+} CachedListing;
+
+static CachedListing listing_cache[LISTING_CACHE_SIZE];
+static unsigned listing_clock = 0;
+
+static void listing_free(CachedListing* listing) {
+    MEM_FREE(MEM_TAG_BROWSER, listing->entries);
+    MEM_FREE(MEM_TAG_BROWSER, listing->strings);
+    memset(listing, 0, sizeof(CachedListing));
+}
+
+// Copy a cached listing of path into ctx, false if there is none for this mtime
+static bool listing_restore(BrowserContext* ctx, const char* path, time_t mtime) {
+    for (int i = 0; i < LISTING_CACHE_SIZE; i++) {
+        CachedListing* listing = &listing_cache[i];
+        if (!listing->path[0] || strcmp(listing->path, path) != 0) continue;
+        if (listing->mtime != mtime) {
+            listing_free(listing);
+            return false;
+        }
 
-    // Allocate
-    ctx->entries = malloc(sizeof(FileEntry) * count);
-    if (!ctx->entries) {
-        closedir(dir);
+        FileEntry* entries = MEM_MALLOC(MEM_TAG_BROWSER, sizeof(FileEntry) * (listing->entry_count ? listing->entry_count : 1));
+        char* strings = MEM_MALLOC(MEM_TAG_BROWSER, listing->strings_size ? listing->strings_size : 1);
+        if (!entries || !strings) {
+            MEM_FREE(MEM_TAG_BROWSER, entries);
+            MEM_FREE(MEM_TAG_BROWSER, strings);
+            return false;
+        }
+        memcpy(entries, listing->entries, sizeof(FileEntry) * listing->entry_count);
+        memcpy(strings, listing->strings, listing->strings_size);
+        ctx->entries = entries;
+        ctx->entry_count = listing->entry_count;
+        ctx->strings = strings;
+        ctx->strings_size = listing->strings_size;
+        ctx->strings_capacity = listing->strings_size;
+        listing->last_used = ++listing_clock;
+        return true;
+    }
+    return false;
+}
+
+// Keep a copy of the listing just loaded, replacing the least recently used one
+static void listing_store(const BrowserContext* ctx, time_t mtime) {
+    // A directory changed within the mtime resolution could change again unnoticed
+    if (mtime + LISTING_MTIME_SLACK >= time(NULL)) return;
+
+    CachedListing* slot = &listing_cache[0];
+    for (int i = 0; i < LISTING_CACHE_SIZE; i++) {
+        CachedListing* listing = &listing_cache[i];
+        if (!listing->path[0] || strcmp(listing->path, ctx->current_path) == 0) {
+            slot = listing;
+            break;
+        }
+        if (listing->last_used < slot->last_used) slot = listing;
+    }
+    listing_free(slot);
+
+    slot->entries = MEM_MALLOC(MEM_TAG_BROWSER, sizeof(FileEntry) * (ctx->entry_count ? ctx->entry_count : 1));
+    slot->strings = MEM_MALLOC(MEM_TAG_BROWSER, ctx->strings_size ? ctx->strings_size : 1);
+    if (!slot->entries || !slot->strings) {
+        listing_free(slot);
         return;
     }
+    memcpy(slot->entries, ctx->entries, sizeof(FileEntry) * ctx->entry_count);
+    memcpy(slot->strings, ctx->strings, ctx->strings_size);
+    slot->entry_count = ctx->entry_count;
+    slot->strings_size = ctx->strings_size;
+    slot->mtime = mtime;
+    slot->last_used = ++listing_clock;
+    snprintf(slot->path, sizeof(slot->path), "%s", ctx->current_path);
+}
+
+void Browser_clearCache(void) {
+    for (int i = 0; i < LISTING_CACHE_SIZE; i++) {
+        listing_free(&listing_cache[i]);
+    }
+}
+
+static char prefetch_root[512];          // Music root of the last load
 
-    int idx = 0;
+static bool listing_cached(const char* path) {
+    for (int i = 0; i < LISTING_CACHE_SIZE; i++) {
+        if (listing_cache[i].path[0] && strcmp(listing_cache[i].path, path) == 0) return true;
+    }
+    return false;
+}
 
-    // Add parent directory
+// Read and sort a directory into ctx
+// One readdir pass: d_type tells directories from files, so names are filtered by
+// extension with no syscall; only DT_UNKNOWN and symlinks (which may point at
+// directories) cost an fstatat.
+static void read_directory(BrowserContext* ctx, const char* path, const char* music_root) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        LOG_error("Failed to open directory: %s\n", path);
+        return;
+    }
+
+    int capacity = 0;
+    CueList cues = {0};
+    uint32_t dir_offset = add_string(ctx, ctx->current_path);
+
+    // Add parent directory entry if not at root
+    bool has_parent = (strcmp(path, music_root) != 0);
     if (has_parent) {
-        strcpy(ctx->entries[idx].name, "..");
-        char* last_slash = strrchr(ctx->current_path, '/');
+        FileEntry* parent = add_entry(ctx, &capacity);
+        if (!parent) {
+            closedir(dir);
+            return;
+        }
+        char parent_path[512];
+        snprintf(parent_path, sizeof(parent_path), "%s", ctx->current_path);
+        char* last_slash = strrchr(parent_path, '/');
         if (last_slash) {
-            strncpy(ctx->entries[idx].path, ctx->current_path, last_slash - ctx->current_path);
-            ctx->entries[idx].path[last_slash - ctx->current_path] = '\0';
+            *last_slash = '\0';
         } else {
-            strncpy(ctx->entries[idx].path, music_root, sizeof(ctx->entries[idx].path) - 1);
+            snprintf(parent_path, sizeof(parent_path), "%s", music_root);
         }
-        ctx->entries[idx].is_dir = true;
-        ctx->entries[idx].format = AUDIO_FORMAT_UNKNOWN;
-        idx++;
+        uint32_t name = add_string(ctx, "..");
+        uint32_t parent_dir = add_string(ctx, parent_path);
+        parent = &ctx->entries[0];
+        parent->name = name;
+        parent->dir = parent_dir;
+        parent->is_dir = true;
+        parent->format = AUDIO_FORMAT_UNKNOWN;
     }
 
-    // Second pass: fill entries
-    rewinddir(dir);
+    struct dirent* ent;
     while ((ent = readdir(dir)) != NULL) {
-        if (ent->d_name[0] == '.') continue;
-
-        char full_path[512];
-        snprintf(full_path, sizeof(full_path), "%s/%s", path, ent->d_name);
+        if (ent->d_name[0] == '.') continue;  // Skip hidden files
 
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
+        bool is_dir;
+        if (ent->d_type == DT_DIR) {
+            is_dir = true;
+        } else if (ent->d_type == DT_REG) {
+            is_dir = false;
+        } else if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
+            struct stat st;
+            if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0) continue;
+            if (!S_ISDIR(st.st_mode) && !S_ISREG(st.st_mode)) continue;
+            is_dir = S_ISDIR(st.st_mode);
+        } else {
+            continue;  // Devices, sockets, pipes
+        }
 
-        bool is_dir = S_ISDIR(st.st_mode);
         AudioFormat fmt = AUDIO_FORMAT_UNKNOWN;
-
         if (!is_dir) {
             fmt = Player_detectFormat(ent->d_name);
-            if (fmt == AUDIO_FORMAT_UNKNOWN) continue;
+            if (fmt == AUDIO_FORMAT_UNKNOWN && !Playlist_isPlaylistFile(ent->d_name)) {
+                const char* ext = strrchr(ent->d_name, '.');
+                if (ext && strcasecmp(ext, ".cue") == 0) {
+                    char cue_path[512];
+                    snprintf(cue_path, sizeof(cue_path), "%s/%s", path, ent->d_name);
+                    cue_parse(ctx, dir_offset, cue_path, &cues);
+                }
+                continue;
+            }
         }
 
-        strncpy(ctx->entries[idx].name, ent->d_name, sizeof(ctx->entries[idx].name) - 1);
-        strncpy(ctx->entries[idx].path, full_path, sizeof(ctx->entries[idx].path) - 1);
-        ctx->entries[idx].is_dir = is_dir;
-        ctx->entries[idx].format = fmt;
-        idx++;
+        uint32_t name = add_string(ctx, ent->d_name);
+        FileEntry* entry = add_entry(ctx, &capacity);
+        if (!entry) break;
+        entry->name = name;
+        entry->dir = dir_offset;
+        entry->file = name;
+        entry->is_dir = is_dir;
+        entry->is_playlist = !is_dir && fmt == AUDIO_FORMAT_UNKNOWN;
+        entry->format = (uint8_t)fmt;
     }
 
     closedir(dir);
-    ctx->entry_count = idx;
+
+    // Album files split by a cue sheet are listed as its tracks instead
+    if (cues.count > 0) {
+        int kept = 0;
+        for (int i = 0; i < ctx->entry_count; i++) {
+            FileEntry* entry = &ctx->entries[i];
+            if (!entry->is_dir && cue_list_has_file(ctx, &cues, cues.count, Browser_string(ctx, entry->file))) continue;
+            if (kept != i) ctx->entries[kept] = *entry;
+            kept++;
+        }
+        ctx->entry_count = kept;
+
+        for (int i = 0; i < cues.count; i++) {
+            FileEntry* entry = add_entry(ctx, &capacity);
+            if (!entry) break;
+            *entry = cues.entries[i];
+        }
+    }
+    MEM_FREE(MEM_TAG_BROWSER, cues.entries);
 
     // Sort entries (but keep ".." at top if present)
     int sort_start = has_parent ? 1 : 0;
     if (ctx->entry_count > sort_start + 1) {
-        qsort(&ctx->entries[sort_start], ctx->entry_count - sort_start,
-              sizeof(FileEntry), compare_entries);
+        sort_entries(ctx, &ctx->entries[sort_start], ctx->entry_count - sort_start);
+    }
+}
+
+// Load directory contents, from the listing cache if the directory is unchanged
+void Browser_loadDirectory(BrowserContext* ctx, const char* path, const char* music_root) {
+    TRACE_SCOPE("Browser_loadDirectory");
+    snprintf(prefetch_root, sizeof(prefetch_root), "%s", music_root);
+    char dir_path[512];
+    snprintf(dir_path, sizeof(dir_path), "%s", path);  // path may be ctx->current_path
+    Browser_freeEntries(ctx);
+
+    snprintf(ctx->current_path, sizeof(ctx->current_path), "%s", dir_path);
+    ctx->selected = 0;
+    ctx->scroll_offset = 0;
+
+    // Create music folder if it doesn't exist
+    if (strcmp(dir_path, music_root) == 0) {
+        mkdir(dir_path, 0755);
+    }
+
+    struct stat st;
+    bool have_mtime = stat(dir_path, &st) == 0;
+    if (!have_mtime || !listing_restore(ctx, dir_path, st.st_mtime)) {
+        read_directory(ctx, dir_path, music_root);
+        if (have_mtime && ctx->entries) listing_store(ctx, st.st_mtime);
+    }
+
+    // Sorted with the folders and playlists first, so the audio files are the tail of the list
+    ctx->audio_start = ctx->entry_count;
+    while (ctx->audio_start > 0 && !ctx->entries[ctx->audio_start - 1].is_dir &&
+           !ctx->entries[ctx->audio_start - 1].is_playlist) {
+        ctx->audio_start--;
+    }
+}
+
+// === PREFETCH ===
+
+typedef struct {
+    char path[512];
+    char music_root[512];
+    BrowserContext ctx;
+    time_t mtime;
+    bool listed;
+    bool tagged;                // First track's tags read
+    char track[512];
+    PlayerFileTags tags;
+} Prefetch;
+
+static char hover_path[512];                // Folder under the cursor ("" = none)
+static uint32_t hover_since = 0;
+static bool hover_done = false;             // Prefetched, or no need
+static JobToken* prefetch_token = NULL;
+static char prefetch_path[512];             // Folder of the running prefetch
+static int io_budget = BROWSER_PREFETCH_IO_BUDGET;
+static uint32_t io_refilled = 0;
+
+static void prefetch_job(void* arg, JobToken* token) {
+    Prefetch* p = (Prefetch*)arg;
+    TRACE_SCOPE("browser_prefetch");
+    struct stat st;
+    if (stat(p->path, &st) != 0 || Jobs_cancelled(token)) return;
+    p->mtime = st.st_mtime;
+    snprintf(p->ctx.current_path, sizeof(p->ctx.current_path), "%s", p->path);
+    read_directory(&p->ctx, p->path, p->music_root);
+    p->listed = p->ctx.entries != NULL;
+
+    // The first track: its folder's cover (cached by folder_art) and its tags
+    const FileEntry* first = NULL;
+    for (int i = 0; i < p->ctx.entry_count && !first; i++) {
+        const FileEntry* entry = &p->ctx.entries[i];
+        if (!entry->is_dir && !entry->is_playlist) first = entry;
     }
+    if (!first || Jobs_cancelled(token)) return;
+    Browser_getPath(&p->ctx, first, p->track, sizeof(p->track));
+    FolderArt art;
+    FolderArt_find(p->track, &art);
+    if (first->cue_track || Jobs_cancelled(token)) return;  // Titled by the cue sheet
+    p->tagged = Player_readFileTags(p->track, &p->tags) == 0;
+}
+
+static void prefetch_done(void* arg, bool cancelled) {
+    Prefetch* p = (Prefetch*)arg;
+    io_budget -= p->ctx.entry_count;
+    if (!cancelled && p->listed) listing_store(&p->ctx, p->mtime);
+    if (!cancelled && p->tagged) TrackMeta_put(p->track, p->tags.info.title, p->tags.info.artist);
+    Browser_freeEntries(&p->ctx);
+    free(p);
+
+    Jobs_release(prefetch_token);
+    prefetch_token = NULL;
+    prefetch_path[0] = '\0';
+}
+
+static void prefetch_cancel(void) {
+    if (prefetch_token) Jobs_cancel(prefetch_token);
+}
+
+static void prefetch_start(const char* path) {
+    Prefetch* p = calloc(1, sizeof(Prefetch));
+    if (!p) return;
+    snprintf(p->path, sizeof(p->path), "%s", path);
+    snprintf(p->music_root, sizeof(p->music_root), "%s", prefetch_root);
+    prefetch_token = Jobs_submit(JOB_PRIORITY_BACKGROUND, prefetch_job, prefetch_done, p);
+    if (!prefetch_token) {
+        free(p);
+        return;
+    }
+    snprintf(prefetch_path, sizeof(prefetch_path), "%s", path);
+}
+
+void Browser_hover(const BrowserContext* ctx) {
+    uint32_t now = SDL_GetTicks();
+    int refill = (int)((now - io_refilled) * BROWSER_PREFETCH_IO_REFILL / 1000);
+    if (refill > 0) {
+        io_budget = io_budget + refill < BROWSER_PREFETCH_IO_BUDGET ? io_budget + refill : BROWSER_PREFETCH_IO_BUDGET;
+        io_refilled = now;
+    }
+
+    char path[512] = "";
+    if (ctx->selected >= 0 && ctx->selected < ctx->entry_count && ctx->entries[ctx->selected].is_dir) {
+        Browser_getPath(ctx, &ctx->entries[ctx->selected], path, sizeof(path));
+    }
+    if (strcmp(path, hover_path) != 0) {
+        // Moved on: a prefetch of the folder left behind isn't wanted anymore
+        if (prefetch_token && strcmp(prefetch_path, path) != 0) prefetch_cancel();
+        snprintf(hover_path, sizeof(hover_path), "%s", path);
+        hover_since = now;
+        hover_done = !path[0] || listing_cached(path);
+        return;
+    }
+    if (hover_done || now - hover_since < BROWSER_PREFETCH_DWELL_MS) return;
+    if (prefetch_token || io_budget <= 0) return;  // One at a time, within the budget
+    prefetch_start(path);
+    hover_done = true;
+}
+
+int Browser_prefetchWaitMs(void) {
+    if (hover_done || !hover_path[0] || prefetch_token) return -1;  // Nothing waits on a running one
+    uint32_t rested = SDL_GetTicks() - hover_since;
+    int wait = rested < BROWSER_PREFETCH_DWELL_MS ? (int)(BROWSER_PREFETCH_DWELL_MS - rested) : 0;
+    if (io_budget <= 0) {
+        int refill = (1 - io_budget) * 1000 / BROWSER_PREFETCH_IO_REFILL + 1;
+        if (refill > wait) wait = refill;
+    }
+    return wait;
 }
 
 // Get display name for file (without extension)
@@ -151,18 +735,11 @@ void Browser_getDisplayName(const char* filename, char* out, int max_len) {
 
 // Count audio files in browser for "X OF Y" display
 int Browser_countAudioFiles(const BrowserContext* ctx) {
-    int count = 0;
-    for (int i = 0; i < ctx->entry_count; i++) {
-        if (!ctx->entries[i].is_dir) count++;
-    }
-    return count;
+    return ctx->entry_count - ctx->audio_start;
 }
 
 // Get current track number (1-based)
 int Browser_getCurrentTrackNumber(const BrowserContext* ctx) {
-    int num = 0;
-    for (int i = 0; i <= ctx->selected && i < ctx->entry_count; i++) {
-        if (!ctx->entries[i].is_dir) num++;
-    }
-    return num;
+    if (ctx->selected < ctx->audio_start || ctx->selected >= ctx->entry_count) return 0;
+    return ctx->selected - ctx->audio_start + 1;
 }
@@ -2,14 +2,26 @@
 #define __BROWSER_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "player.h"  // For AudioFormat
 
 // File entry structure
+// Strings are offsets into the context's string arena (see Browser_string), which
+// holds the directory path once instead of a full path per entry.
 typedef struct {
-    char name[256];
-    char path[512];
-    bool is_dir;
-    AudioFormat format;
+    uint32_t name;          // File or folder name; cue tracks: the track title
+    uint32_t dir;           // Directory of the file; "..": the parent folder itself
+    uint32_t file;          // File name inside dir (0 for ".."); cue tracks: the album file
+    uint32_t artist;        // Cue track PERFORMER (album PERFORMER if the track has none)
+    uint32_t album;         // Cue album TITLE
+
+    // Cue sheet track: a region of the album file, name is the track title
+    int start_ms;           // INDEX 01 of the track
+    int end_ms;             // INDEX 01 of the next track in the file, 0 = end of file
+    uint16_t cue_track;     // Track number (1-based), 0 for regular files
+    uint8_t format;         // AudioFormat
+    bool is_dir : 1;
+    bool is_playlist : 1;   // M3U/PLS file, listed between the folders and the audio files
 } FileEntry;
 
 // Browser context structure
@@ -17,20 +29,57 @@ typedef struct {
     char current_path[512];
     FileEntry* entries;
     int entry_count;
+    int audio_start;        // First audio file, the files follow the folders and playlists
     int selected;
     int scroll_offset;
     int items_per_page;
+    char* strings;          // String arena, offset 0 is ""
+    uint32_t strings_size;
+    uint32_t strings_capacity;
 } BrowserContext;
 
 // Free browser entries
 void Browser_freeEntries(BrowserContext* ctx);
 
 // Load directory contents
+// Listings of the last few directories are cached until the directory's mtime changes.
+// music_root is remembered for prefetches.
 void Browser_loadDirectory(BrowserContext* ctx, const char* path, const char* music_root);
 
+// Free the cached listings
+void Browser_clearCache(void);
+
+// Predictive prefetch: once the cursor has rested on a folder for
+// BROWSER_PREFETCH_DWELL_MS, a background job lists it into the listing cache
+// and looks up its cover and first track's tags, so opening it is instant.
+// Moving on cancels it. Listing costs one unit of an I/O budget per entry read,
+// refilled at BROWSER_PREFETCH_IO_REFILL a second up to BROWSER_PREFETCH_IO_BUDGET;
+// no prefetch starts while it is spent. Main thread.
+#define BROWSER_PREFETCH_DWELL_MS 200
+#define BROWSER_PREFETCH_IO_BUDGET 2000
+#define BROWSER_PREFETCH_IO_REFILL 500
+
+// The cursor is on ctx->selected (browser loop, every iteration)
+void Browser_hover(const BrowserContext* ctx);
+
+// Milliseconds until a hovered folder is due to be prefetched, -1 if none is
+int Browser_prefetchWaitMs(void);
+
+// String of an entry field
+const char* Browser_string(const BrowserContext* ctx, uint32_t offset);
+
+// Full path of an entry
+void Browser_getPath(const BrowserContext* ctx, const FileEntry* entry, char* out, int max_len);
+
+// True if both entries play the same file (cue tracks of one album file)
+bool Browser_isSameFile(const BrowserContext* ctx, const FileEntry* a, const FileEntry* b);
+
 // Get display name for file (without extension)
 void Browser_getDisplayName(const char* filename, char* out, int max_len);
 
+// Playback region of a cue track entry (whole file for regular entries)
+void Browser_getRegion(const BrowserContext* ctx, const FileEntry* entry, TrackRegion* region);
+
 // Count audio files in browser
 int Browser_countAudioFiles(const BrowserContext* ctx);
 
@@ -0,0 +1,147 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "circular_buffer.h"
+#include "defines.h"
+#include "api.h"
+
+int circular_buffer_init(CircularBuffer* cb, size_t capacity_frames, size_t frame_bytes, MemTag tag) {
+    // Round capacity up to a power of two for index masking
+    size_t capacity = 1;
+    while (capacity < capacity_frames) capacity <<= 1;
+
+    cb->buffer = MEM_MALLOC(tag, capacity * frame_bytes);
+    if (!cb->buffer) {
+        LOG_error("Failed to allocate circular buffer (%zu KB)\n",
+                  capacity * frame_bytes / 1024);
+        return -1;
+    }
+    cb->tag = tag;
+    cb->frame_bytes = frame_bytes;
+    cb->capacity = capacity;
+    cb->mask = capacity - 1;
+    __atomic_store_n(&cb->write_pos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->read_pos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->flush_pos, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->flush_pending, false, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Only call when neither the decode thread nor the audio callback can touch the buffer
+void circular_buffer_free(CircularBuffer* cb) {
+    if (cb->buffer) {
+        MEM_FREE(cb->tag, cb->buffer);
+        cb->buffer = NULL;
+    }
+    cb->frame_bytes = 0;
+    cb->capacity = 0;
+    cb->mask = 0;
+    cb->write_pos = 0;
+    cb->read_pos = 0;
+    cb->flush_pos = 0;
+    cb->flush_pending = false;
+}
+
+// Discard all buffered frames (called by decode thread, e.g. on seek)
+// The producer cannot move read_pos itself, so it asks the consumer to jump to the
+// current write position on its next read. Frames written after this call are kept.
+void circular_buffer_clear(CircularBuffer* cb) {
+    size_t w = __atomic_load_n(&cb->write_pos, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->flush_pos, w, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->flush_pending, true, __ATOMIC_RELEASE);
+}
+
+// Apply a pending flush request (consumer side only)
+static inline void circular_buffer_apply_flush(CircularBuffer* cb) {
+    if (__atomic_load_n(&cb->flush_pending, __ATOMIC_ACQUIRE)) {
+        size_t target = __atomic_load_n(&cb->flush_pos, __ATOMIC_RELAXED);
+        __atomic_store_n(&cb->flush_pending, false, __ATOMIC_RELAXED);
+        __atomic_store_n(&cb->read_pos, target, __ATOMIC_RELEASE);
+    }
+}
+
+// Frames available to read (safe from either side)
+// While a flush is pending this still counts the stale frames; the producer just
+// observes less free space until the consumer catches up.
+size_t circular_buffer_available(CircularBuffer* cb) {
+    size_t r = __atomic_load_n(&cb->read_pos, __ATOMIC_ACQUIRE);
+    size_t w = __atomic_load_n(&cb->write_pos, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&cb->flush_pending, __ATOMIC_ACQUIRE)) {
+        r = __atomic_load_n(&cb->flush_pos, __ATOMIC_RELAXED);
+    }
+    return w - r;
+}
+
+// Get contiguous writable span (producer side)
+// Returns number of frames that can be written at *span without wrapping
+size_t circular_buffer_write_span(CircularBuffer* cb, void** span) {
+    size_t w = __atomic_load_n(&cb->write_pos, __ATOMIC_RELAXED);
+    size_t r = __atomic_load_n(&cb->read_pos, __ATOMIC_ACQUIRE);
+    size_t space = cb->capacity - (w - r);
+    size_t idx = w & cb->mask;
+    size_t contiguous = cb->capacity - idx;
+    *span = &cb->buffer[idx * cb->frame_bytes];
+    return (space < contiguous) ? space : contiguous;
+}
+
+// Publish frames written into the span from circular_buffer_write_span()
+void circular_buffer_commit_write(CircularBuffer* cb, size_t frames) {
+    size_t w = __atomic_load_n(&cb->write_pos, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->write_pos, w + frames, __ATOMIC_RELEASE);
+}
+
+// Get contiguous readable span (consumer side)
+// Returns number of frames readable at *span without wrapping
+size_t circular_buffer_read_span(CircularBuffer* cb, void** span) {
+    circular_buffer_apply_flush(cb);
+    size_t r = __atomic_load_n(&cb->read_pos, __ATOMIC_RELAXED);
+    size_t w = __atomic_load_n(&cb->write_pos, __ATOMIC_ACQUIRE);
+    size_t avail = w - r;
+    size_t idx = r & cb->mask;
+    size_t contiguous = cb->capacity - idx;
+    *span = &cb->buffer[idx * cb->frame_bytes];
+    return (avail < contiguous) ? avail : contiguous;
+}
+
+// Release frames read from the span from circular_buffer_read_span()
+void circular_buffer_consume(CircularBuffer* cb, size_t frames) {
+    size_t r = __atomic_load_n(&cb->read_pos, __ATOMIC_RELAXED);
+    __atomic_store_n(&cb->read_pos, r + frames, __ATOMIC_RELEASE);
+}
+
+// Write frames to circular buffer (called by decode thread)
+size_t circular_buffer_write(CircularBuffer* cb, const void* data, size_t frames) {
+    const uint8_t* src = (const uint8_t*)data;
+    size_t written = 0;
+
+    // At most two spans: up to the end of the buffer, then from the start
+    for (int part = 0; part < 2 && written < frames; part++) {
+        void* span;
+        size_t n = circular_buffer_write_span(cb, &span);
+        if (n == 0) break;
+        if (n > frames - written) n = frames - written;
+        memcpy(span, &src[written * cb->frame_bytes], n * cb->frame_bytes);
+        circular_buffer_commit_write(cb, n);
+        written += n;
+    }
+
+    return written;
+}
+
+// Read frames from circular buffer (called by audio callback)
+size_t circular_buffer_read(CircularBuffer* cb, void* data, size_t frames) {
+    uint8_t* dst = (uint8_t*)data;
+    size_t read = 0;
+
+    for (int part = 0; part < 2 && read < frames; part++) {
+        void* span;
+        size_t n = circular_buffer_read_span(cb, &span);
+        if (n == 0) break;
+        if (n > frames - read) n = frames - read;
+        memcpy(&dst[read * cb->frame_bytes], span, n * cb->frame_bytes);
+        circular_buffer_consume(cb, n);
+        read += n;
+    }
+
+    return read;
+}
@@ -0,0 +1,66 @@
+#ifndef __CIRCULAR_BUFFER_H__
+#define __CIRCULAR_BUFFER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memstats.h"
+
+// Circular buffer for streaming playback
+// Lock-free single-producer (decode thread) / single-consumer (audio callback) ring.
+// Positions are free-running frame counters; capacity is a power of two so the
+// buffer index is (pos & mask) and (write_pos - read_pos) is always the fill level.
+// write_pos is only stored by the producer, read_pos only by the consumer. Release
+// stores publish the frame data, acquire loads on the other side observe it.
+typedef struct {
+    uint8_t* buffer;            // Interleaved frames
+    size_t frame_bytes;         // Bytes per frame
+    size_t capacity;            // Total frames capacity (power of two)
+    size_t mask;                // capacity - 1
+    size_t write_pos;           // Producer position (frames, atomic)
+    size_t read_pos;            // Consumer position (frames, atomic)
+    size_t flush_pos;           // Producer-requested read position for flush (atomic)
+    bool flush_pending;         // Set by producer, consumed by reader (atomic)
+    MemTag tag;                 // Accounted under
+} CircularBuffer;
+
+// Allocate at least capacity_frames (rounded up to a power of two)
+// Returns 0 on success, -1 if out of memory.
+int circular_buffer_init(CircularBuffer* cb, size_t capacity_frames, size_t frame_bytes, MemTag tag);
+
+// Only call when neither the producer nor the consumer can touch the buffer
+void circular_buffer_free(CircularBuffer* cb);
+
+// Discard all buffered frames (producer side, e.g. on seek)
+void circular_buffer_clear(CircularBuffer* cb);
+
+// Frames available to read (safe from either side)
+size_t circular_buffer_available(CircularBuffer* cb);
+
+// Contiguous writable span (producer side): frames that fit at *span without wrapping
+size_t circular_buffer_write_span(CircularBuffer* cb, void** span);
+
+// Publish frames written into the span from circular_buffer_write_span()
+void circular_buffer_commit_write(CircularBuffer* cb, size_t frames);
+
+// Contiguous readable span (consumer side): frames readable at *span without wrapping
+size_t circular_buffer_read_span(CircularBuffer* cb, void** span);
+
+// Release frames read from the span from circular_buffer_read_span()
+void circular_buffer_consume(CircularBuffer* cb, size_t frames);
+
+// Copy frames in/out in at most two spans; return the frames copied
+size_t circular_buffer_write(CircularBuffer* cb, const void* data, size_t frames);
+size_t circular_buffer_read(CircularBuffer* cb, void* data, size_t frames);
+
+// Free-running positions, used to mark track boundaries inside the buffer
+static inline size_t circular_buffer_read_position(CircularBuffer* cb) {
+    return __atomic_load_n(&cb->read_pos, __ATOMIC_ACQUIRE);
+}
+
+static inline size_t circular_buffer_write_position(CircularBuffer* cb) {
+    return __atomic_load_n(&cb->write_pos, __ATOMIC_ACQUIRE);
+}
+
+#endif
@@ -0,0 +1,399 @@
+#ifdef ENERGY_PROFILE
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "defines.h"
+#include "api.h"
+#include "energy.h"
+#include "thread_role.h"
+
+#define ENERGY_TASKS_MAX 64             // Threads tracked between samples
+#define ENERGY_TOP_THREADS 4            // Busiest threads written per sample
+#define ENERGY_CPUS_MAX 8
+#define POWER_SUPPLY_DIR "/sys/class/power_supply"
+
+typedef struct {
+    int tid;
+    uint64_t ticks;                     // utime + stime
+    uint64_t switches;                  // Voluntary context switches
+    char name[16];
+    bool seen;
+} EnergyTask;
+
+typedef struct {
+    double seconds;
+    double mwh;
+} EnergyBucket;
+
+// Set by the main loop, read by the sampler
+static struct {
+    const char* view;
+    bool screen_off;
+    int audio;
+    bool downloading;
+} state = {"start", false, ENERGY_AUDIO_IDLE, false};
+
+static pthread_t sampler;
+static bool running = false;
+static bool quit = false;
+static pthread_mutex_t quit_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t quit_cond = PTHREAD_COND_INITIALIZER;
+
+static char battery_dir[300];           // Empty: no battery found
+static EnergyTask tasks[ENERGY_TASKS_MAX];
+static int task_count = 0;
+// Average power per audio state x screen off x downloading
+static EnergyBucket buckets[ENERGY_AUDIO_COUNT][2][2];
+
+static const char* const audio_names[ENERGY_AUDIO_COUNT] = {"idle", "music", "radio"};
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// First line of a sysfs file
+static bool read_line(const char* path, char* out, int size) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    bool ok = fgets(out, size, f) != NULL;
+    fclose(f);
+    if (ok) out[strcspn(out, "\n")] = '\0';
+    return ok;
+}
+
+static bool read_long(const char* path, long long* value) {
+    char line[64];
+    return read_line(path, line, sizeof(line)) && sscanf(line, "%lld", value) == 1;
+}
+
+static void find_battery(void) {
+    DIR* dir = opendir(POWER_SUPPLY_DIR);
+    if (!dir) return;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char path[300], type[32];
+        snprintf(path, sizeof(path), POWER_SUPPLY_DIR "/%s/type", ent->d_name);
+        if (read_line(path, type, sizeof(type)) && strcmp(type, "Battery") == 0) {
+            snprintf(battery_dir, sizeof(battery_dir), POWER_SUPPLY_DIR "/%s", ent->d_name);
+            break;
+        }
+    }
+    closedir(dir);
+}
+
+// Battery draw in mW (power_now, else voltage x current), capacity and whether
+// it's charging; false without a battery
+static bool read_battery(double* mw, int* capacity, bool* charging) {
+    if (!battery_dir[0]) return false;
+    char path[340], status[32];
+    long long uw, uv, ua, pct;
+
+    snprintf(path, sizeof(path), "%s/status", battery_dir);
+    *charging = read_line(path, status, sizeof(status)) && strcmp(status, "Charging") == 0;
+    snprintf(path, sizeof(path), "%s/capacity", battery_dir);
+    *capacity = read_long(path, &pct) ? (int)pct : -1;
+
+    snprintf(path, sizeof(path), "%s/power_now", battery_dir);
+    if (read_long(path, &uw)) {
+        *mw = llabs(uw) / 1000.0;
+        return true;
+    }
+    char vpath[340];
+    snprintf(vpath, sizeof(vpath), "%s/voltage_now", battery_dir);
+    snprintf(path, sizeof(path), "%s/current_now", battery_dir);
+    if (!read_long(vpath, &uv) || !read_long(path, &ua)) return false;
+    // The sign of current_now differs between fuel gauge drivers
+    *mw = (double)uv / 1e6 * (double)llabs(ua) / 1e3;
+    return true;
+}
+
+// Mean and highest current frequency of the online cores, in MHz
+static void read_cpu_freq(int* mean_mhz, int* max_mhz) {
+    long long sum = 0, max = 0;
+    int count = 0;
+    for (int cpu = 0; cpu < ENERGY_CPUS_MAX; cpu++) {
+        char path[96];
+        long long khz;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/scaling_cur_freq", cpu);
+        if (!read_long(path, &khz)) continue;
+        sum += khz;
+        if (khz > max) max = khz;
+        count++;
+    }
+    *mean_mhz = count > 0 ? (int)(sum / count / 1000) : 0;
+    *max_mhz = (int)(max / 1000);
+}
+
+// Bytes received and sent on every interface but loopback
+static void read_net(uint64_t* rx, uint64_t* tx) {
+    *rx = *tx = 0;
+    FILE* f = fopen("/proc/net/dev", "r");
+    if (!f) return;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        char* colon = strchr(line, ':');
+        if (!colon) continue;       // Header lines
+        *colon = '\0';
+        char* name = line;
+        while (*name == ' ') name++;
+        if (strcmp(name, "lo") == 0) continue;
+        unsigned long long r, t, skip;
+        if (sscanf(colon + 1, "%llu %llu %llu %llu %llu %llu %llu %llu %llu",
+                   &r, &skip, &skip, &skip, &skip, &skip, &skip, &skip, &t) == 9) {
+            *rx += r;
+            *tx += t;
+        }
+    }
+    fclose(f);
+}
+
+// A thread's name and CPU ticks (stat) and voluntary switches (status)
+static bool read_task(int tid, char* name, int name_size, uint64_t* ticks, uint64_t* switches) {
+    char path[64], line[512];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    if (!read_line(path, line, sizeof(line))) return false;
+
+    // "tid (comm) state ..." - comm may hold spaces and parentheses
+    char* open = strchr(line, '(');
+    char* close = strrchr(line, ')');
+    if (!open || !close || close < open) return false;
+    int len = (int)(close - open - 1);
+    if (len >= name_size) len = name_size - 1;
+    memcpy(name, open + 1, len);
+    name[len] = '\0';
+
+    // Fields 14 and 15 (utime, stime) counted from the state, field 3
+    char* p = close + 2;
+    unsigned long long utime = 0, stime = 0;
+    for (int field = 3; field < 14 && p; field++) {
+        p = strchr(p, ' ');
+        if (p) p++;
+    }
+    if (!p || sscanf(p, "%llu %llu", &utime, &stime) != 2) return false;
+    *ticks = utime + stime;
+
+    *switches = 0;
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", tid);
+    FILE* f = fopen(path, "r");
+    if (f) {
+        unsigned long long n;
+        while (fgets(line, sizeof(line), f)) {
+            if (sscanf(line, "voluntary_ctxt_switches: %llu", &n) == 1) {
+                *switches = n;
+                break;
+            }
+        }
+        fclose(f);
+    }
+    return true;
+}
+
+typedef struct {
+    int tid;
+    char name[16];
+    float cpu;
+} EnergyThread;
+
+static int compare_threads(const void* a, const void* b) {
+    float x = ((const EnergyThread*)a)->cpu, y = ((const EnergyThread*)b)->cpu;
+    return x > y ? -1 : x < y;
+}
+
+// CPU of the process and its busiest threads over window_ms, in percent of one
+// core, and voluntary switches per second; top gets "name/tid:pct ..."
+static void sample_threads(uint64_t window_ms, float* process_cpu, float* wakeups, char* top, int top_size) {
+    long hz = sysconf(_SC_CLK_TCK);
+    float scale = hz > 0 && window_ms > 0 ? 100.0f * 1000.0f / ((float)hz * (float)window_ms) : 0.0f;
+    EnergyThread all[ENERGY_TASKS_MAX];
+    int all_count = 0;
+    uint64_t ticks_total = 0, switches_total = 0;
+
+    for (int i = 0; i < task_count; i++) tasks[i].seen = false;
+    DIR* dir = opendir("/proc/self/task");
+    struct dirent* ent;
+    while (dir && (ent = readdir(dir)) != NULL) {
+        int tid = atoi(ent->d_name);
+        if (tid <= 0) continue;
+        char name[16];
+        uint64_t ticks, switches;
+        if (!read_task(tid, name, sizeof(name), &ticks, &switches)) continue;
+
+        EnergyTask* t = NULL;
+        for (int i = 0; i < task_count; i++) {
+            if (tasks[i].tid == tid) {
+                t = &tasks[i];
+                break;
+            }
+        }
+        uint64_t dticks = 0, dswitches = 0;
+        if (t) {
+            dticks = ticks - t->ticks;
+            dswitches = switches - t->switches;
+        } else if (task_count < ENERGY_TASKS_MAX) {
+            t = &tasks[task_count++];
+            t->tid = tid;
+        }
+        if (!t) continue;
+        t->ticks = ticks;
+        t->switches = switches;
+        t->seen = true;
+        snprintf(t->name, sizeof(t->name), "%s", name);
+        ticks_total += dticks;
+        switches_total += dswitches;
+        all[all_count].tid = tid;
+        snprintf(all[all_count].name, sizeof(all[all_count].name), "%s", name);
+        all[all_count].cpu = dticks * scale;
+        all_count++;
+    }
+    if (dir) closedir(dir);
+
+    // Forget threads that exited
+    int kept = 0;
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i].seen) tasks[kept++] = tasks[i];
+    }
+    task_count = kept;
+
+    *process_cpu = ticks_total * scale;
+    *wakeups = window_ms > 0 ? switches_total * 1000.0f / window_ms : 0.0f;
+    qsort(all, all_count, sizeof(EnergyThread), compare_threads);
+    int pos = 0;
+    top[0] = '\0';
+    for (int i = 0; i < all_count && i < ENERGY_TOP_THREADS && pos < top_size; i++) {
+        pos += snprintf(top + pos, top_size - pos, "%s%s/%d:%.1f", i ? " " : "", all[i].name, all[i].tid, all[i].cpu);
+    }
+}
+
+static void* sampler_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    struct stat st;
+    bool fresh = stat(ENERGY_FILE, &st) != 0;
+    FILE* f = fopen(ENERGY_FILE, "a");
+    if (!f) {
+        LOG_error("Energy: can't write %s\n", ENERGY_FILE);
+        return NULL;
+    }
+    if (fresh) {
+        fprintf(f, "time_s,view,screen_off,audio,downloading,charging,battery_pct,power_mw,energy_mwh,"
+                   "cpu_mhz,cpu_max_mhz,process_cpu_pct,wakeups_per_s,net_rx_kbps,net_tx_kbps,top_threads\n");
+    }
+
+    uint64_t start = now_ms(), last = start;
+    double energy_mwh = 0.0, last_mw = -1.0;
+    uint64_t last_rx, last_tx;
+    read_net(&last_rx, &last_tx);
+    char top[256];
+    float process_cpu, wakeups;
+    sample_threads(0, &process_cpu, &wakeups, top, sizeof(top));     // Baseline
+
+    pthread_mutex_lock(&quit_mutex);
+    while (!quit) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ENERGY_INTERVAL_MS / 1000;
+        deadline.tv_nsec += (ENERGY_INTERVAL_MS % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&quit_cond, &quit_mutex, &deadline);
+        if (quit) break;
+        pthread_mutex_unlock(&quit_mutex);
+
+        uint64_t now = now_ms();
+        uint64_t window = now - last;
+        last = now;
+
+        const char* view = __atomic_load_n(&state.view, __ATOMIC_RELAXED);
+        bool screen_off = __atomic_load_n(&state.screen_off, __ATOMIC_RELAXED);
+        int audio = __atomic_load_n(&state.audio, __ATOMIC_RELAXED);
+        bool downloading = __atomic_load_n(&state.downloading, __ATOMIC_RELAXED);
+
+        double mw = -1.0;
+        int capacity = -1;
+        bool charging = false;
+        if (read_battery(&mw, &capacity, &charging)) {
+            // Trapezoid between samples; the state is the one at the end of the window
+            double average = last_mw >= 0.0 ? (mw + last_mw) / 2.0 : mw;
+            double mwh = average * window / 3600000.0;
+            energy_mwh += mwh;
+            if (!charging) {
+                EnergyBucket* b = &buckets[audio][screen_off][downloading];
+                b->seconds += window / 1000.0;
+                b->mwh += mwh;
+            }
+            last_mw = mw;
+        }
+        int mean_mhz, max_mhz;
+        read_cpu_freq(&mean_mhz, &max_mhz);
+        uint64_t rx, tx;
+        read_net(&rx, &tx);
+        double rx_kbps = window > 0 ? (rx - last_rx) * 8.0 / window : 0.0;
+        double tx_kbps = window > 0 ? (tx - last_tx) * 8.0 / window : 0.0;
+        last_rx = rx;
+        last_tx = tx;
+        sample_threads(window, &process_cpu, &wakeups, top, sizeof(top));
+
+        fprintf(f, "%.1f,%s,%d,%s,%d,%d,%d,%.0f,%.2f,%d,%d,%.1f,%.1f,%.1f,%.1f,\"%s\"\n",
+                (now - start) / 1000.0, view, screen_off, audio_names[audio], downloading, charging, capacity,
+                mw, energy_mwh, mean_mhz, max_mhz, process_cpu, wakeups, rx_kbps, tx_kbps, top);
+        fflush(f);
+        pthread_mutex_lock(&quit_mutex);
+    }
+    pthread_mutex_unlock(&quit_mutex);
+    fclose(f);
+    return NULL;
+}
+
+void Energy_start(void) {
+    if (running) return;
+    find_battery();
+    if (!battery_dir[0]) LOG_info("Energy: no battery in " POWER_SUPPLY_DIR ", power left empty\n");
+    quit = false;
+    running = pthread_create(&sampler, NULL, sampler_func, NULL) == 0;
+}
+
+void Energy_stop(void) {
+    if (!running) return;
+    pthread_mutex_lock(&quit_mutex);
+    quit = true;
+    pthread_cond_signal(&quit_cond);
+    pthread_mutex_unlock(&quit_mutex);
+    pthread_join(sampler, NULL);
+    running = false;
+
+    for (int audio = 0; audio < ENERGY_AUDIO_COUNT; audio++) {
+        for (int off = 0; off < 2; off++) {
+            for (int dl = 0; dl < 2; dl++) {
+                const EnergyBucket* b = &buckets[audio][off][dl];
+                if (b->seconds < 1.0) continue;
+                LOG_info("energy: %s, screen %s%s: %.1f mWh/h over %.2f h\n", audio_names[audio],
+                         off ? "off" : "on", dl ? ", downloading" : "",
+                         b->mwh * 3600.0 / b->seconds, b->seconds / 3600.0);
+            }
+        }
+    }
+}
+
+void Energy_setState(const char* view, bool screen_off, EnergyAudio audio, bool downloading) {
+    __atomic_store_n(&state.view, view, __ATOMIC_RELAXED);
+    __atomic_store_n(&state.screen_off, screen_off, __ATOMIC_RELAXED);
+    __atomic_store_n(&state.audio, (int)audio, __ATOMIC_RELAXED);
+    __atomic_store_n(&state.downloading, downloading, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __ENERGY_H__
+#define __ENERGY_H__
+
+#include <stdbool.h>
+
+// Energy profiling (ENERGY_PROFILE builds: make ENERGY_PROFILE=1)
+// A background thread samples every ENERGY_INTERVAL_MS: battery power (from the
+// power-supply sysfs voltage and current, integrated into mWh), CPU frequency,
+// process and busiest-thread CPU time, wakeups per second (voluntary context
+// switches of all threads) and network bytes. Each sample is tagged with the
+// app state the main loop last reported and appended to ENERGY_FILE as CSV.
+// At Energy_stop the log gets the average power of each state seen, which is
+// mWh per hour spent in it (samples taken while charging are left out).
+// Download subprocesses (yt-dlp, ffmpeg) show up in power and network only.
+
+#define ENERGY_FILE SHARED_USERDATA_PATH "/musicplayer_energy.csv"
+#define ENERGY_INTERVAL_MS 5000
+
+typedef enum {
+    ENERGY_AUDIO_IDLE,
+    ENERGY_AUDIO_MUSIC,
+    ENERGY_AUDIO_RADIO,
+    ENERGY_AUDIO_COUNT
+} EnergyAudio;
+
+#ifdef ENERGY_PROFILE
+
+// Start and stop the sampler (main thread)
+void Energy_start(void);
+void Energy_stop(void);
+
+// What the app is doing; view is a string literal (main loop, every iteration)
+void Energy_setState(const char* view, bool screen_off, EnergyAudio audio, bool downloading);
+
+#endif
+
+#endif
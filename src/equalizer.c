@@ -0,0 +1,215 @@
+#include "equalizer.h"
+#include <math.h>
+#include <string.h>
+#include <stdbool.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define EQ_Q 1.41f                  // About one octave wide
+#define EQ_MAX_FREQ_RATIO 0.45f     // Bands this close to Nyquist are left out
+#define EQ_BLOCK_FRAMES 256         // S16 chunks are filtered in float blocks of this size
+
+static const float band_freqs[EQUALIZER_BANDS] = {
+    31.0f, 62.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f
+};
+
+typedef struct {
+    const char* name;
+    int8_t gain_db[EQUALIZER_BANDS];
+} PresetDef;
+
+static const PresetDef presets[EQ_PRESET_COUNT] = {
+    [EQ_PRESET_FLAT]      = { "Flat",      {  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 } },
+    [EQ_PRESET_BASS]      = { "Bass",      {  6,  5,  4,  2,  0,  0,  0,  0,  0,  0 } },
+    [EQ_PRESET_TREBLE]    = { "Treble",    {  0,  0,  0,  0,  0,  0,  2,  4,  5,  6 } },
+    [EQ_PRESET_VOCAL]     = { "Vocal",     { -2, -2, -1,  1,  3,  3,  2,  1,  0, -1 } },
+    [EQ_PRESET_ROCK]      = { "Rock",      {  4,  3,  2,  0, -1, -1,  1,  2,  3,  4 } },
+    [EQ_PRESET_POP]       = { "Pop",       { -1,  1,  3,  4,  3,  0, -1, -1,  1,  1 } },
+    [EQ_PRESET_JAZZ]      = { "Jazz",      {  3,  2,  1,  2, -1, -1,  0,  1,  2,  3 } },
+    [EQ_PRESET_CLASSICAL] = { "Classical", {  4,  3,  2,  1,  0,  0,  0,  1,  2,  3 } },
+    [EQ_PRESET_LOUDNESS]  = { "Loudness",  {  5,  4,  2,  0, -1,  0,  0,  1,  3,  4 } },
+};
+
+static int current_preset = EQ_PRESET_FLAT;     // Atomic
+static unsigned preset_generation = 1;          // Bumped on every change (atomic)
+
+void Equalizer_setPreset(int preset) {
+    if (preset < 0 || preset >= EQ_PRESET_COUNT) preset = EQ_PRESET_FLAT;
+    __atomic_store_n(&current_preset, preset, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&preset_generation, 1, __ATOMIC_RELEASE);
+}
+
+int Equalizer_getPreset(void) {
+    return __atomic_load_n(&current_preset, __ATOMIC_RELAXED);
+}
+
+const char* Equalizer_getPresetName(int preset) {
+    if (preset < 0 || preset >= EQ_PRESET_COUNT) return "";
+    return presets[preset].name;
+}
+
+void Equalizer_reset(EqualizerState* eq) {
+    for (int b = 0; b < EQUALIZER_BANDS; b++) {
+        memset(eq->bands[b].z1, 0, sizeof(eq->bands[b].z1));
+        memset(eq->bands[b].z2, 0, sizeof(eq->bands[b].z2));
+    }
+}
+
+// RBJ peaking filter, normalized by a0
+static void design_peaking(EqualizerBiquad* bq, float freq, float gain_db, int sample_rate) {
+    float a = powf(10.0f, gain_db / 40.0f);
+    float w0 = 2.0f * (float)M_PI * freq / (float)sample_rate;
+    float alpha = sinf(w0) / (2.0f * EQ_Q);
+    float cos_w0 = cosf(w0);
+    float a0 = 1.0f + alpha / a;
+
+    bq->b0 = (1.0f + alpha * a) / a0;
+    bq->b1 = (-2.0f * cos_w0) / a0;
+    bq->b2 = (1.0f - alpha * a) / a0;
+    bq->a1 = (-2.0f * cos_w0) / a0;
+    bq->a2 = (1.0f - alpha / a) / a0;
+}
+
+// Bring the filters up to date with the preset and rate
+// Returns false if there is nothing to do (flat preset)
+static bool prepare(EqualizerState* eq, int sample_rate) {
+    unsigned generation = __atomic_load_n(&preset_generation, __ATOMIC_ACQUIRE);
+    if (generation == eq->generation && sample_rate == eq->sample_rate) {
+        return eq->band_count > 0;
+    }
+
+    const PresetDef* preset = &presets[__atomic_load_n(&current_preset, __ATOMIC_RELAXED)];
+    eq->generation = generation;
+    eq->sample_rate = sample_rate;
+    eq->band_count = 0;
+
+    // Headroom for the largest boost, folded into the first filter
+    float max_gain = 0.0f;
+    for (int b = 0; b < EQUALIZER_BANDS; b++) {
+        if (preset->gain_db[b] > max_gain) max_gain = preset->gain_db[b];
+    }
+
+    for (int b = 0; b < EQUALIZER_BANDS; b++) {
+        if (preset->gain_db[b] == 0 || band_freqs[b] >= sample_rate * EQ_MAX_FREQ_RATIO) continue;
+        design_peaking(&eq->bands[eq->band_count++], band_freqs[b], preset->gain_db[b], sample_rate);
+    }
+
+    if (eq->band_count > 0 && max_gain > 0.0f) {
+        float preamp = powf(10.0f, -max_gain / 20.0f);
+        eq->bands[0].b0 *= preamp;
+        eq->bands[0].b1 *= preamp;
+        eq->bands[0].b2 *= preamp;
+    }
+    Equalizer_reset(eq);
+    return eq->band_count > 0;
+}
+
+// Run every band over interleaved stereo, band by band so each filter's
+// coefficients and state stay in registers for the whole block
+static void run_stereo(EqualizerState* eq, float* samples, size_t frames) {
+    for (int b = 0; b < eq->band_count; b++) {
+        EqualizerBiquad* bq = &eq->bands[b];
+#if defined(__ARM_NEON)
+        float32x2_t b0 = vdup_n_f32(bq->b0), b1 = vdup_n_f32(bq->b1), b2 = vdup_n_f32(bq->b2);
+        float32x2_t a1 = vdup_n_f32(bq->a1), a2 = vdup_n_f32(bq->a2);
+        float32x2_t z1 = vld1_f32(bq->z1), z2 = vld1_f32(bq->z2);
+        for (size_t i = 0; i < frames; i++) {
+            float32x2_t x = vld1_f32(&samples[i * 2]);
+            float32x2_t y = vmla_f32(z1, b0, x);
+            z1 = vmls_f32(vmla_f32(z2, b1, x), a1, y);
+            z2 = vmls_f32(vmul_f32(b2, x), a2, y);
+            vst1_f32(&samples[i * 2], y);
+        }
+        vst1_f32(bq->z1, z1);
+        vst1_f32(bq->z2, z2);
+#else
+        float z1l = bq->z1[0], z1r = bq->z1[1], z2l = bq->z2[0], z2r = bq->z2[1];
+        for (size_t i = 0; i < frames; i++) {
+            float xl = samples[i * 2], xr = samples[i * 2 + 1];
+            float yl = bq->b0 * xl + z1l;
+            float yr = bq->b0 * xr + z1r;
+            z1l = bq->b1 * xl - bq->a1 * yl + z2l;
+            z1r = bq->b1 * xr - bq->a1 * yr + z2r;
+            z2l = bq->b2 * xl - bq->a2 * yl;
+            z2r = bq->b2 * xr - bq->a2 * yr;
+            samples[i * 2] = yl;
+            samples[i * 2 + 1] = yr;
+        }
+        bq->z1[0] = z1l; bq->z1[1] = z1r;
+        bq->z2[0] = z2l; bq->z2[1] = z2r;
+#endif
+    }
+}
+
+// Mono streams (radio) use the first channel's state
+static void run_mono(EqualizerState* eq, float* samples, size_t frames) {
+    for (int b = 0; b < eq->band_count; b++) {
+        EqualizerBiquad* bq = &eq->bands[b];
+        float z1 = bq->z1[0], z2 = bq->z2[0];
+        for (size_t i = 0; i < frames; i++) {
+            float x = samples[i];
+            float y = bq->b0 * x + z1;
+            z1 = bq->b1 * x - bq->a1 * y + z2;
+            z2 = bq->b2 * x - bq->a2 * y;
+            samples[i] = y;
+        }
+        bq->z1[0] = z1;
+        bq->z2[0] = z2;
+    }
+}
+
+void Equalizer_processF32(EqualizerState* eq, int sample_rate, float* samples, size_t frames, int channels) {
+    if (__atomic_load_n(&current_preset, __ATOMIC_RELAXED) == EQ_PRESET_FLAT) return;
+    if (sample_rate <= 0 || !prepare(eq, sample_rate)) return;
+
+    if (channels == 2) {
+        run_stereo(eq, samples, frames);
+    } else if (channels == 1) {
+        run_mono(eq, samples, frames);
+    }
+}
+
+void Equalizer_processS16(EqualizerState* eq, int sample_rate, int16_t* samples, size_t frames, int channels) {
+    if (__atomic_load_n(&current_preset, __ATOMIC_RELAXED) == EQ_PRESET_FLAT) return;
+    if (sample_rate <= 0 || (channels != 1 && channels != 2) || !prepare(eq, sample_rate)) return;
+
+    float block[EQ_BLOCK_FRAMES * 2];
+    while (frames > 0) {
+        size_t n = frames < EQ_BLOCK_FRAMES ? frames : EQ_BLOCK_FRAMES;
+        size_t count = n * channels;
+        size_t i = 0;
+
+#if defined(__ARM_NEON)
+        for (; i + 8 <= count; i += 8) {
+            int16x8_t s = vld1q_s16(&samples[i]);
+            vst1q_f32(&block[i], vcvtq_f32_s32(vmovl_s16(vget_low_s16(s))));
+            vst1q_f32(&block[i + 4], vcvtq_f32_s32(vmovl_s16(vget_high_s16(s))));
+        }
+#endif
+        for (; i < count; i++) block[i] = samples[i];
+
+        if (channels == 2) {
+            run_stereo(eq, block, n);
+        } else {
+            run_mono(eq, block, n);
+        }
+
+        i = 0;
+#if defined(__ARM_NEON)
+        for (; i + 8 <= count; i += 8) {
+            int32x4_t lo = vcvtnq_s32_f32(vld1q_f32(&block[i]));
+            int32x4_t hi = vcvtnq_s32_f32(vld1q_f32(&block[i + 4]));
+            vst1q_s16(&samples[i], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+        }
+#endif
+        for (; i < count; i++) {
+            float v = block[i];
+            samples[i] = (int16_t)(v > 32767.0f ? 32767 : v < -32768.0f ? -32768 : lrintf(v));
+        }
+
+        samples += count;
+        frames -= n;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef __EQUALIZER_H__
+#define __EQUALIZER_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 10-band graphic equalizer (peaking biquads at octave centres, 31 Hz - 16 kHz)
+// The preset is global; every decode path keeps its own EqualizerState and runs
+// its output through it. Both channels are filtered together (NEON lanes), and
+// a flat preset returns straight away without touching the samples.
+
+#define EQUALIZER_BANDS 10
+
+typedef enum {
+    EQ_PRESET_FLAT = 0,
+    EQ_PRESET_BASS,
+    EQ_PRESET_TREBLE,
+    EQ_PRESET_VOCAL,
+    EQ_PRESET_ROCK,
+    EQ_PRESET_POP,
+    EQ_PRESET_JAZZ,
+    EQ_PRESET_CLASSICAL,
+    EQ_PRESET_LOUDNESS,
+    EQ_PRESET_COUNT
+} EqualizerPreset;
+
+// One band's filter (transposed direct form II) and its per-channel state
+typedef struct {
+    float b0, b1, b2, a1, a2;
+    float z1[2], z2[2];
+} EqualizerBiquad;
+
+// Filters of one decode path, redesigned when the preset or sample rate changes
+typedef struct {
+    EqualizerBiquad bands[EQUALIZER_BANDS];
+    int band_count;             // Bands with non-zero gain (the only ones run)
+    int sample_rate;            // Rate the filters were designed for (0 = not designed)
+    unsigned generation;        // Preset generation they were designed from
+} EqualizerState;
+
+// Select the preset for all decode paths (applied from their next chunk)
+void Equalizer_setPreset(int preset);
+int Equalizer_getPreset(void);
+
+// Display name of a preset ("Flat", "Bass", ...)
+const char* Equalizer_getPresetName(int preset);
+
+// Clear filter history (after a seek or stream restart)
+void Equalizer_reset(EqualizerState* eq);
+
+// Filter interleaved samples in place (channels 1 or 2)
+void Equalizer_processS16(EqualizerState* eq, int sample_rate, int16_t* samples, size_t frames, int channels);
+void Equalizer_processF32(EqualizerState* eq, int sample_rate, float* samples, size_t frames, int channels);
+
+#endif
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "defines.h"
+#include "folder_art.h"
+#include "radio_album_art.h"
+
+typedef struct {
+    uint64_t dir_hash;          // 0 = free
+    long mtime;                 // Of the directory when listed
+    uint32_t used;              // LRU clock
+    bool found;
+    FolderArt art;
+} FolderArtEntry;
+
+static const char* art_names[] = {FOLDER_ART_NAMES};
+static const char* art_exts[] = {".jpg", ".jpeg", ".png"};
+
+static FolderArtEntry cache[FOLDER_ART_CACHE_MAX];
+static uint32_t cache_clock = 0;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// A downloaded track and its video
+typedef struct {
+    uint64_t track_hash;
+    char video_id[16];
+} YouTubeLink;
+
+// FOLDER_ART_YOUTUBE_LINKS as of its last read, oldest first
+static YouTubeLink links[FOLDER_ART_YOUTUBE_LINKS_MAX];
+static int link_count = 0;
+static long links_mtime = -1;
+static long links_size = -1;
+static pthread_mutex_t links_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Rank of a sidecar name (lower is preferred), -1 if it isn't one
+static int art_rank(const char* name) {
+    const char* dot = strrchr(name, '.');
+    if (!dot) return -1;
+    int ext = -1;
+    for (int i = 0; i < (int)(sizeof(art_exts) / sizeof(art_exts[0])); i++) {
+        if (strcasecmp(dot, art_exts[i]) == 0) ext = i;
+    }
+    if (ext < 0) return -1;
+    size_t len = dot - name;
+    for (int i = 0; i < (int)(sizeof(art_names) / sizeof(art_names[0])); i++) {
+        if (strlen(art_names[i]) == len && strncasecmp(name, art_names[i], len) == 0) {
+            return i * 4 + ext;
+        }
+    }
+    return -1;
+}
+
+// List dir for its best sidecar
+static bool scan_dir(const char* dir, FolderArt* art) {
+    DIR* d = opendir(dir);
+    if (!d) return false;
+    int best = -1;
+    char best_name[256] = "";
+    struct dirent* ent;
+    while ((ent = readdir(d)) != NULL) {
+        int rank = art_rank(ent->d_name);
+        if (rank < 0 || (best >= 0 && rank >= best)) continue;
+        best = rank;
+        snprintf(best_name, sizeof(best_name), "%s", ent->d_name);
+    }
+    closedir(d);
+    if (best < 0) return false;
+
+    snprintf(art->path, sizeof(art->path), "%s/%s", dir, best_name);
+    struct stat st;
+    if (stat(art->path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) return false;
+    art->size = (uint32_t)st.st_size;
+    char where[48];
+    snprintf(where, sizeof(where), "%u#%ld", art->size, (long)st.st_mtime);
+    art->key = radio_album_art_key('D', art->path, where);
+    return true;
+}
+
+static bool find_folder_image(const char* track, FolderArt* art) {
+    const char* slash = track ? strrchr(track, '/') : NULL;
+    if (!slash || slash == track) return false;
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%.*s", (int)(slash - track), track);
+
+    struct stat st;
+    if (stat(dir, &st) != 0) return false;
+    uint64_t dir_hash = radio_album_art_key('d', dir, NULL) | 1;
+
+    pthread_mutex_lock(&cache_mutex);
+    FolderArtEntry* entry = NULL;
+    for (int i = 0; i < FOLDER_ART_CACHE_MAX; i++) {
+        if (cache[i].dir_hash == dir_hash) {
+            entry = &cache[i];
+            break;
+        }
+    }
+    if (entry && entry->mtime == (long)st.st_mtime) {
+        entry->used = ++cache_clock;
+        bool found = entry->found;
+        if (found) *art = entry->art;
+        pthread_mutex_unlock(&cache_mutex);
+        return found;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+
+    // Listed without the lock; two threads listing one directory is harmless
+    FolderArt scanned;
+    bool found = scan_dir(dir, &scanned);
+
+    pthread_mutex_lock(&cache_mutex);
+    if (!entry || entry->dir_hash != dir_hash) {
+        entry = &cache[0];
+        for (int i = 0; i < FOLDER_ART_CACHE_MAX; i++) {
+            if (cache[i].dir_hash == dir_hash) {
+                entry = &cache[i];
+                break;
+            }
+            if (cache[i].used < entry->used) entry = &cache[i];
+        }
+    }
+    entry->dir_hash = dir_hash;
+    entry->mtime = (long)st.st_mtime;
+    entry->used = ++cache_clock;
+    entry->found = found;
+    if (found) entry->art = scanned;
+    pthread_mutex_unlock(&cache_mutex);
+
+    if (found) *art = scanned;
+    return found;
+}
+
+// Read the links file again if it changed (links_mutex held); a track linked
+// twice keeps its latest video
+static void load_links(void) {
+    struct stat st;
+    if (stat(FOLDER_ART_YOUTUBE_LINKS, &st) != 0) {
+        link_count = 0;
+        links_mtime = links_size = -1;
+        return;
+    }
+    if ((long)st.st_mtime == links_mtime && (long)st.st_size == links_size) return;
+    links_mtime = (long)st.st_mtime;
+    links_size = (long)st.st_size;
+    link_count = 0;
+
+    FILE* f = fopen(FOLDER_ART_YOUTUBE_LINKS, "r");
+    if (!f) return;
+    char line[640];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* bar = strrchr(line, '|');
+        if (!bar || bar == line || !bar[1] || strlen(bar + 1) >= sizeof(links[0].video_id)) continue;
+        *bar = '\0';
+        uint64_t hash = radio_album_art_key('y', line, NULL);
+        int i = 0;
+        while (i < link_count && links[i].track_hash != hash) i++;
+        if (i == FOLDER_ART_YOUTUBE_LINKS_MAX) i = 0;   // Full: the oldest goes
+        if (i < link_count) {
+            memmove(&links[i], &links[i + 1], (link_count - i - 1) * sizeof(YouTubeLink));
+            link_count--;
+        }
+        links[link_count].track_hash = hash;
+        snprintf(links[link_count].video_id, sizeof(links[link_count].video_id), "%s", bar + 1);
+        link_count++;
+    }
+    fclose(f);
+}
+
+// Thumbnail of the video track was downloaded from
+static bool find_youtube_thumbnail(const char* track, FolderArt* art) {
+    uint64_t hash = radio_album_art_key('y', track, NULL);
+    char video_id[sizeof(links[0].video_id)] = "";
+    pthread_mutex_lock(&links_mutex);
+    load_links();
+    for (int i = link_count - 1; i >= 0; i--) {
+        if (links[i].track_hash == hash) {
+            snprintf(video_id, sizeof(video_id), "%s", links[i].video_id);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&links_mutex);
+    if (!video_id[0]) return false;
+
+    snprintf(art->path, sizeof(art->path), "%s/%s.jpg", FOLDER_ART_YOUTUBE_DIR, video_id);
+    struct stat st;
+    if (stat(art->path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) return false;
+    art->size = (uint32_t)st.st_size;
+    art->key = radio_album_art_key('Y', video_id, NULL);
+    return true;
+}
+
+bool FolderArt_find(const char* track, FolderArt* art) {
+    return find_folder_image(track, art) || (track && find_youtube_thumbnail(track, art));
+}
+
+void FolderArt_linkYouTube(const char* track, const char* video_id) {
+    pthread_mutex_lock(&links_mutex);
+    mkdir(FOLDER_ART_YOUTUBE_DIR, 0755);
+    FILE* f = fopen(FOLDER_ART_YOUTUBE_LINKS, "a");
+    if (f) {
+        fprintf(f, "%s|%s\n", track, video_id);
+        fclose(f);
+    }
+    pthread_mutex_unlock(&links_mutex);
+}
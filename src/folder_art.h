@@ -0,0 +1,36 @@
+#ifndef __FOLDER_ART_H__
+#define __FOLDER_ART_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Folder covers: an image next to the tracks (cover.jpg, folder.png, ...)
+// Each directory is listed once for a sidecar, matched case-insensitively in the
+// order of FOLDER_ART_NAMES (.jpg, .jpeg, then .png). Results, "none" included,
+// are cached per directory (the newest FOLDER_ART_CACHE_MAX) and kept while its
+// mtime is unchanged, so every track of an album after the first costs one stat.
+// A track of a folder without one may be a YouTube download: its thumbnail is
+// kept by video ID in FOLDER_ART_YOUTUBE_DIR, tied to the file by a line
+// "<track path>|<video ID>" in FOLDER_ART_YOUTUBE_LINKS (read again when it changes).
+// Safe from any thread.
+
+#define FOLDER_ART_NAMES "cover", "folder", "front", "album", "albumart"
+#define FOLDER_ART_CACHE_MAX 64
+#define FOLDER_ART_YOUTUBE_DIR SHARED_USERDATA_PATH "/youtube_art"
+#define FOLDER_ART_YOUTUBE_LINKS FOLDER_ART_YOUTUBE_DIR "/links.txt"
+#define FOLDER_ART_YOUTUBE_LINKS_MAX 1024       // Newest links kept in memory
+
+typedef struct {
+    char path[512];             // The image
+    uint32_t size;              // Its length in bytes
+    uint64_t key;               // In-memory cover cache key (radio_album_art_key 'D')
+} FolderArt;
+
+// Cover image of the directory holding track, else its YouTube thumbnail;
+// false if it has neither
+bool FolderArt_find(const char* track, FolderArt* art);
+
+// Tie a downloaded track to the thumbnail of video_id (FOLDER_ART_YOUTUBE_DIR/<id>.jpg)
+void FolderArt_linkYouTube(const char* track, const char* video_id);
+
+#endif
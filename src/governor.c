@@ -0,0 +1,143 @@
+#include "governor.h"
+#include "player.h"
+#include "radio.h"
+#include "defines.h"
+#include "api.h"
+#include <stdint.h>
+
+// Speed ladder, lowest first
+static const int speed_levels[] = {
+    CPU_SPEED_POWERSAVE,
+    CPU_SPEED_MENU,
+    CPU_SPEED_NORMAL,
+    CPU_SPEED_PERFORMANCE
+};
+#define LEVEL_COUNT ((int)(sizeof(speed_levels) / sizeof(speed_levels[0])))
+#define LEVEL_LOWEST 0
+#define LEVEL_MENU 1          // UI speed, floor while the screen is on
+#define LEVEL_HIGHEST (LEVEL_COUNT - 1)
+
+#define GOVERNOR_WINDOW_MS 500          // Evaluation window
+#define GOVERNOR_LOAD_HIGH 0.50f        // Decode CPU seconds per audio second: step up above
+#define GOVERNOR_LOAD_LOW 0.20f         // ...and only step down below (one step roughly doubles load)
+#define GOVERNOR_CALM_WINDOWS 6         // Consecutive calm windows before stepping down (~3s)
+#define GOVERNOR_PLAYER_RISK 0.67f      // Player buffer at risk below this share of the low watermark
+#define GOVERNOR_PLAYER_CALM 1.0f
+#define GOVERNOR_RADIO_RISK 0.25f       // Radio ring fill at risk below this
+#define GOVERNOR_RADIO_CALM 0.50f
+
+static int level = -1;                  // Index into speed_levels, -1 = not applied yet
+static int calm_windows = 0;
+static uint32_t window_start = 0;
+static uint64_t window_cpu_us = 0;
+static uint64_t window_frames = 0;
+static int window_buffered_ms = 0;
+static float window_radio_level = 0.0f;
+static bool strained = false;           // Playing with the buffer below its calm level
+
+static void apply_level(int new_level) {
+    if (new_level < LEVEL_LOWEST) new_level = LEVEL_LOWEST;
+    if (new_level > LEVEL_HIGHEST) new_level = LEVEL_HIGHEST;
+    if (new_level == level) return;
+
+    PWR_setCPUSpeed(speed_levels[new_level]);
+    level = new_level;
+    calm_windows = 0;
+}
+
+// Start a new evaluation window from the current counters
+static void begin_window(uint32_t now, const PlayerDecodeStats* stats) {
+    window_start = now;
+    window_cpu_us = stats->cpu_us;
+    window_frames = stats->output_frames;
+    window_buffered_ms = stats->buffered_ms;
+    window_radio_level = Radio_getBufferLevel();
+}
+
+void Governor_init(void) {
+    PlayerDecodeStats stats;
+    Player_getDecodeStats(&stats);
+
+    level = -1;
+    apply_level(LEVEL_MENU);
+    begin_window(SDL_GetTicks(), &stats);
+}
+
+void Governor_update(bool screen_off) {
+    uint32_t now = SDL_GetTicks();
+    PlayerDecodeStats stats;
+    Player_getDecodeStats(&stats);
+
+    bool radio = Radio_isActive();
+    PlayerState state = Player_getState();
+    bool playing = radio || state == PLAYER_STATE_PLAYING || state == PLAYER_STATE_LOADING;
+    int min_level = screen_off ? LEVEL_LOWEST : LEVEL_MENU;
+
+    // Checked every call, for background work to back off at once
+    if (!playing) {
+        strained = false;
+    } else if (radio) {
+        strained = Radio_getState() == RADIO_STATE_BUFFERING || Radio_getBufferLevel() < GOVERNOR_RADIO_CALM;
+    } else {
+        // Power-save refills drain the buffer on purpose
+        strained = stats.active && !stats.power_save &&
+                   stats.buffered_ms < stats.low_watermark_ms * GOVERNOR_PLAYER_CALM;
+    }
+
+    // Power-save bursts: refill at full speed to get back to sleep sooner, lowest in between
+    if (!radio && stats.active && stats.power_save) {
+        apply_level(stats.refilling ? LEVEL_HIGHEST : LEVEL_LOWEST);
+        begin_window(now, &stats);
+        return;
+    }
+
+    // Nothing to keep up with: stay at the floor (UI speed while the screen is on)
+    if (!playing) {
+        apply_level(min_level);
+        begin_window(now, &stats);
+        return;
+    }
+
+    if (level < min_level) {
+        apply_level(min_level);
+    }
+
+    if (now - window_start < GOVERNOR_WINDOW_MS) return;
+
+    bool at_risk, calm;
+    float load = 0.0f;
+    if (radio) {
+        // Radio decode cost isn't measured, follow the ring fill trend
+        float fill = Radio_getBufferLevel();
+        at_risk = Radio_getState() == RADIO_STATE_BUFFERING ||
+                  (fill < GOVERNOR_RADIO_RISK && fill < window_radio_level);
+        calm = fill >= GOVERNOR_RADIO_CALM;
+    } else {
+        uint64_t frames = stats.output_frames - window_frames;
+        if (frames > 0 && stats.sample_rate > 0) {
+            float audio_us = (float)frames * 1000000.0f / stats.sample_rate;
+            load = (float)(stats.cpu_us - window_cpu_us) / audio_us;
+        }
+        // The low watermark is planned per track, so thresholds follow it
+        at_risk = stats.buffered_ms < stats.low_watermark_ms * GOVERNOR_PLAYER_RISK &&
+                  stats.buffered_ms <= window_buffered_ms;
+        calm = stats.buffered_ms >= stats.low_watermark_ms * GOVERNOR_PLAYER_CALM && load < GOVERNOR_LOAD_LOW;
+    }
+
+    if (at_risk || load > GOVERNOR_LOAD_HIGH) {
+        apply_level(level + 1);
+    } else if (calm) {
+        // Hysteresis: only step down after the buffer has stayed healthy for a while
+        if (++calm_windows >= GOVERNOR_CALM_WINDOWS && level > min_level) {
+            apply_level(level - 1);
+        }
+    } else {
+        calm_windows = 0;
+    }
+
+    begin_window(now, &stats);
+}
+
+bool Governor_playbackStrained(void) {
+    return strained;
+}
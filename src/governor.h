@@ -0,0 +1,21 @@
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include <stdbool.h>
+
+// CPU frequency governor for playback
+// Picks the lowest CPU speed that keeps the decode/stream buffers ahead of playback,
+// based on decode CPU time per second of audio and the buffer fill trend.
+
+// Take over CPU speed control (starts at CPU_SPEED_MENU)
+void Governor_init(void);
+
+// Call once per main loop iteration
+// screen_off allows going below the UI speed
+void Governor_update(bool screen_off);
+
+// True while playback runs with its buffer below the healthy level, as of the last
+// update (background work should hold off)
+bool Governor_playbackStrained(void);
+
+#endif
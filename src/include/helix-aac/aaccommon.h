@@ -163,6 +163,9 @@ typedef struct _AACDecInfo {
 	int pnsUsed;
 	int frameCount;
 
+	/* SBR extension data ignored: core only, at the core rate (AACSetSkipSBR) */
+	int sbrSkip;
+
 } AACDecInfo;
 
 /* decoder functions which must be implemented for each platform */
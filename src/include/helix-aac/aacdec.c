@@ -266,6 +266,42 @@ int AACFlushCodec(HAACDecoder hAACDecoder)
 	return ERR_AAC_NONE;
 }
 
+/**************************************************************************************
+ * Function:    AACSetSkipSBR
+ *
+ * Description: decode HE-AAC streams without the SBR tool (low-power mode)
+ *
+ * Inputs:      valid AAC decoder instance pointer (HAACDecoder)
+ *              1 to ignore SBR extension data, 0 to apply it again
+ *
+ * Outputs:     updated codec state
+ *
+ * Return:      0 if successful, error code (< 0) if error
+ *
+ * Notes:       while skipped, frames hold the AAC-LC core only: half the samples,
+ *                at sampRateCore (AACGetLastFrameInfo reports the change)
+ *              SBR state is flushed when it is turned back on, its history being
+ *                stale by then
+ **************************************************************************************/
+int AACSetSkipSBR(HAACDecoder hAACDecoder, int skip)
+{
+	AACDecInfo *aacDecInfo = (AACDecInfo *)hAACDecoder;
+
+	if (!aacDecInfo)
+		return ERR_AAC_NULL_POINTER;
+
+	if (skip) {
+		aacDecInfo->sbrEnabled = 0;
+	} else if (aacDecInfo->sbrSkip) {
+#ifdef AAC_ENABLE_SBR
+		FlushCodecSBR(aacDecInfo);
+#endif
+	}
+	aacDecInfo->sbrSkip = skip ? 1 : 0;
+
+	return ERR_AAC_NONE;
+}
+
 /**************************************************************************************
  * Function:    AACDecode
  *
@@ -49,6 +49,10 @@
 #define MBEDTLS_SSL_ALPN
 #define MBEDTLS_SSL_SESSION_TICKETS
 #define MBEDTLS_SSL_SERVER_NAME_INDICATION
+/* Low-memory record buffers: ask servers for 4 KB records (max_fragment_length)
+ * and shrink the input buffer to what was agreed once the handshake is done */
+#define MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
 
 /* mbed TLS modules */
 #define MBEDTLS_AES_C
@@ -56,6 +60,8 @@
 #define MBEDTLS_ASN1_WRITE_C
 #define MBEDTLS_BASE64_C
 #define MBEDTLS_BIGNUM_C
+#define MBEDTLS_CHACHA20_C
+#define MBEDTLS_CHACHAPOLY_C
 #define MBEDTLS_CIPHER_C
 #define MBEDTLS_CTR_DRBG_C
 #define MBEDTLS_DHM_C
@@ -74,6 +80,7 @@
 #define MBEDTLS_PK_C
 #define MBEDTLS_PK_PARSE_C
 #define MBEDTLS_PLATFORM_C
+#define MBEDTLS_POLY1305_C
 #define MBEDTLS_RSA_C
 #define MBEDTLS_SHA1_C
 #define MBEDTLS_SHA256_C
@@ -91,6 +98,11 @@
 #define MBEDTLS_AES_ROM_TABLES
 #define MBEDTLS_AES_FEWER_TABLES
 
+/* The input buffer must hold a full 16 KB record from servers that ignore
+ * max_fragment_length; the client only ever sends requests and handshake
+ * messages, which fit in 4 KB */
+#define MBEDTLS_SSL_OUT_CONTENT_LEN        4096
+
 /* MPI / BIGNUM options */
 #define MBEDTLS_MPI_WINDOW_SIZE            2
 #define MBEDTLS_MPI_MAX_SIZE             512
@@ -104,6 +116,19 @@
 #undef MBEDTLS_SELF_TEST
 #undef MBEDTLS_SSL_SRV_C
 
+/* Fixed TLS arena (make TLS_ARENA=1): every mbedTLS allocation comes from a
+ * static pool handed over by radio_net, so handshakes and record buffers don't
+ * fragment the general heap. The pool allocator keeps peak/in-use counts and
+ * needs the threading layer, as connections are set up from several threads. */
+#ifdef TLS_ARENA
+#define MBEDTLS_PLATFORM_MEMORY
+#define MBEDTLS_MEMORY_BUFFER_ALLOC_C
+#define MBEDTLS_MEMORY_DEBUG
+#define MBEDTLS_MEMORY_ALIGN_MULTIPLE      8
+#define MBEDTLS_THREADING_C
+#define MBEDTLS_THREADING_PTHREAD
+#endif
+
 #include "mbedtls/check_config.h"
 
 #endif /* MBEDTLS_CONFIG_H */
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "defines.h"
+#include "api.h"
+#include "jobs.h"
+#include "thread_role.h"
+
+struct JobToken {
+    JobFunc run;
+    JobDoneFunc done;
+    void* arg;
+    JobPriority priority;
+    int refs;                   // The pool's (until done is delivered) and the caller's
+    bool cancelled;             // Atomic
+    bool started;
+    JobToken* next;             // Queue or done list
+};
+
+static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_cond = PTHREAD_COND_INITIALIZER;
+static JobToken* queue_head[JOB_PRIORITY_COUNT];
+static JobToken* queue_tail[JOB_PRIORITY_COUNT];
+static JobToken* done_head = NULL;
+static JobToken* done_tail = NULL;
+static JobToken* running[JOBS_WORKERS];
+static int background_running = 0;
+static pthread_t workers[JOBS_WORKERS];
+static int worker_count = 0;
+static bool jobs_quit = false;
+
+static ThreadRole priority_role(JobPriority priority) {
+    switch (priority) {
+        case JOB_PRIORITY_REALTIME:
+            return THREAD_ROLE_DECODE;
+        case JOB_PRIORITY_INTERACTIVE:
+            return THREAD_ROLE_UI;
+        default:
+            return THREAD_ROLE_BACKGROUND;
+    }
+}
+
+static bool is_background(JobPriority priority) {
+    return priority >= JOB_PRIORITY_BACKGROUND;
+}
+
+static void token_release(JobToken* job) {
+    if (__atomic_sub_fetch(&job->refs, 1, __ATOMIC_ACQ_REL) == 0) free(job);
+}
+
+// Hand a job that ran or was dropped to Jobs_poll (mutex held)
+static void finish_locked(JobToken* job) {
+    if (!job->done) {
+        token_release(job);
+        return;
+    }
+    job->next = NULL;
+    if (done_tail) done_tail->next = job;
+    else __atomic_store_n(&done_head, job, __ATOMIC_RELEASE);     // Jobs_poll peeks without the lock
+    done_tail = job;
+}
+
+// Highest class first; background classes only while a slot is free (mutex held)
+static JobToken* take_locked(void) {
+    for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+        if (is_background((JobPriority)p) && background_running >= JOBS_BACKGROUND_MAX) break;
+        JobToken* job = queue_head[p];
+        if (!job) continue;
+        queue_head[p] = job->next;
+        if (!queue_head[p]) queue_tail[p] = NULL;
+        return job;
+    }
+    return NULL;
+}
+
+static void* worker_func(void* arg) {
+    int slot = (int)(intptr_t)arg;
+    ThreadRole role = THREAD_ROLE_BACKGROUND;
+    ThreadRole_apply(role);
+
+    pthread_mutex_lock(&jobs_mutex);
+    while (!jobs_quit) {
+        JobToken* job = take_locked();
+        if (!job) {
+            pthread_cond_wait(&jobs_cond, &jobs_mutex);
+            continue;
+        }
+        job->started = true;
+        running[slot] = job;
+        if (is_background(job->priority)) background_running++;
+        pthread_mutex_unlock(&jobs_mutex);
+
+        ThreadRole wanted = priority_role(job->priority);
+        if (wanted != role) {
+            role = wanted;
+            ThreadRole_apply(role);
+        }
+        job->run(job->arg, job);
+
+        pthread_mutex_lock(&jobs_mutex);
+        running[slot] = NULL;
+        if (is_background(job->priority)) {
+            background_running--;
+            pthread_cond_broadcast(&jobs_cond);     // A background slot is free
+        }
+        finish_locked(job);
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+    return NULL;
+}
+
+void Jobs_init(void) {
+    if (worker_count > 0) return;
+    jobs_quit = false;
+    for (int i = 0; i < JOBS_WORKERS; i++) {
+        if (pthread_create(&workers[worker_count], NULL, worker_func, (void*)(intptr_t)worker_count) == 0) {
+            worker_count++;
+        }
+    }
+    if (worker_count == 0) LOG_error("Jobs: no worker threads\n");
+}
+
+void Jobs_quit(void) {
+    pthread_mutex_lock(&jobs_mutex);
+    jobs_quit = true;
+    for (int p = 0; p < JOB_PRIORITY_COUNT; p++) {
+        while (queue_head[p]) {
+            JobToken* job = queue_head[p];
+            queue_head[p] = job->next;
+            __atomic_store_n(&job->cancelled, true, __ATOMIC_RELEASE);
+            finish_locked(job);
+        }
+        queue_tail[p] = NULL;
+    }
+    for (int i = 0; i < JOBS_WORKERS; i++) {
+        if (running[i]) __atomic_store_n(&running[i]->cancelled, true, __ATOMIC_RELEASE);
+    }
+    pthread_cond_broadcast(&jobs_cond);
+    pthread_mutex_unlock(&jobs_mutex);
+
+    for (int i = 0; i < worker_count; i++) pthread_join(workers[i], NULL);
+    worker_count = 0;
+    Jobs_poll();
+}
+
+JobToken* Jobs_submit(JobPriority priority, JobFunc run, JobDoneFunc done, void* arg) {
+    if (priority < 0 || priority >= JOB_PRIORITY_COUNT) priority = JOB_PRIORITY_BACKGROUND;
+    JobToken* job = calloc(1, sizeof(JobToken));
+    if (!job) return NULL;
+    job->run = run;
+    job->done = done;
+    job->arg = arg;
+    job->priority = priority;
+    job->refs = 2;
+
+    pthread_mutex_lock(&jobs_mutex);
+    if (worker_count == 0 || jobs_quit) {
+        pthread_mutex_unlock(&jobs_mutex);
+        free(job);
+        return NULL;
+    }
+    if (queue_tail[priority]) queue_tail[priority]->next = job;
+    else queue_head[priority] = job;
+    queue_tail[priority] = job;
+    pthread_cond_broadcast(&jobs_cond);
+    pthread_mutex_unlock(&jobs_mutex);
+    return job;
+}
+
+int Jobs_post(JobPriority priority, JobFunc run, JobDoneFunc done, void* arg) {
+    JobToken* token = Jobs_submit(priority, run, done, arg);
+    if (!token) return -1;
+    Jobs_release(token);
+    return 0;
+}
+
+void Jobs_cancel(JobToken* token) {
+    if (!token) return;
+    pthread_mutex_lock(&jobs_mutex);
+    __atomic_store_n(&token->cancelled, true, __ATOMIC_RELEASE);
+    if (!token->started) {
+        // Still queued: unlink it
+        JobToken** link = &queue_head[token->priority];
+        JobToken* previous = NULL;
+        while (*link && *link != token) {
+            previous = *link;
+            link = &(*link)->next;
+        }
+        if (*link == token) {
+            *link = token->next;
+            if (queue_tail[token->priority] == token) queue_tail[token->priority] = previous;
+            token->started = true;      // Never unlinked twice
+            finish_locked(token);
+        }
+    }
+    pthread_mutex_unlock(&jobs_mutex);
+}
+
+bool Jobs_cancelled(const JobToken* token) {
+    return token && __atomic_load_n(&token->cancelled, __ATOMIC_ACQUIRE);
+}
+
+void Jobs_release(JobToken* token) {
+    if (token) token_release(token);
+}
+
+bool Jobs_poll(void) {
+    if (!__atomic_load_n(&done_head, __ATOMIC_ACQUIRE)) return false;
+
+    pthread_mutex_lock(&jobs_mutex);
+    JobToken* list = done_head;
+    __atomic_store_n(&done_head, NULL, __ATOMIC_RELAXED);
+    done_tail = NULL;
+    pthread_mutex_unlock(&jobs_mutex);
+
+    bool ran = list != NULL;
+    while (list) {
+        JobToken* job = list;
+        list = job->next;
+        job->done(job->arg, Jobs_cancelled(job));
+        token_release(job);
+    }
+    return ran;
+}
@@ -0,0 +1,63 @@
+#ifndef __JOBS_H__
+#define __JOBS_H__
+
+#include <stdbool.h>
+
+// Background job pool
+// A fixed set of worker threads runs the app's short background tasks (cover
+// decodes, seek index and waveform scans, station probes) instead of a thread
+// per task. Jobs wait in four priority classes and run highest class first,
+// oldest first within a class. At most JOBS_BACKGROUND_MAX workers take
+// background or idle jobs at a time, so an interactive job never queues behind
+// scans. Each job runs under the thread role of its class. A job can be
+// cancelled through its token; its completion callback runs on the main thread,
+// from Jobs_poll().
+
+#define JOBS_WORKERS 3
+#define JOBS_BACKGROUND_MAX 2
+
+typedef enum {
+    JOB_PRIORITY_REALTIME,      // Playback is waiting on it (decode thread role)
+    JOB_PRIORITY_INTERACTIVE,   // On screen soon, e.g. the playing track's cover (UI role)
+    JOB_PRIORITY_BACKGROUND,    // Makes later work faster, e.g. a seek index
+    JOB_PRIORITY_IDLE,          // Nice to have, e.g. the waveform overview or station probes
+    JOB_PRIORITY_COUNT
+} JobPriority;
+
+typedef struct JobToken JobToken;
+
+// Runs on a worker. Long jobs check Jobs_cancelled(token) between steps.
+typedef void (*JobFunc)(void* arg, JobToken* token);
+
+// Runs on the main thread once the job finished, or was cancelled before it
+// started (cancelled: Jobs_cancel was called on it). Frees arg if it owns it.
+typedef void (*JobDoneFunc)(void* arg, bool cancelled);
+
+// Start the workers (main thread, before the first job)
+void Jobs_init(void);
+
+// Cancel queued and running jobs, wait for the running ones and deliver every
+// completion callback (main thread)
+void Jobs_quit(void);
+
+// Queue run(arg), then done(arg) on the main thread (done may be NULL)
+// Returns a token for Jobs_cancel (give it back with Jobs_release), or NULL if
+// the pool isn't running: the job is not queued and arg is untouched.
+JobToken* Jobs_submit(JobPriority priority, JobFunc run, JobDoneFunc done, void* arg);
+
+// Jobs_submit without a token. Returns 0 if queued, -1 like a NULL token.
+int Jobs_post(JobPriority priority, JobFunc run, JobDoneFunc done, void* arg);
+
+// Ask a job to stop: a queued one is dropped, a running one sees Jobs_cancelled
+void Jobs_cancel(JobToken* token);
+
+bool Jobs_cancelled(const JobToken* token);
+
+// Drop a token from Jobs_submit (the job itself goes on)
+void Jobs_release(JobToken* token);
+
+// Run the completion callbacks of finished jobs (main loop)
+// Returns true if any ran.
+bool Jobs_poll(void);
+
+#endif
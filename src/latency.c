@@ -0,0 +1,144 @@
+#if defined(LATENCY_STATS) || defined(TRACE_EVENTS)
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "latency.h"
+#include "trace.h"
+#include "defines.h"
+#include "api.h"
+
+int latency_audio_state = LATENCY_AUDIO_IDLE;
+
+static const uint32_t bucket_bounds[LATENCY_BUCKETS] = LATENCY_BUCKET_BOUNDS_MS;
+static const char* action_names[LATENCY_ACTION_COUNT] = {"next", "seek", "pause", "station", "nav"};
+
+#ifdef TRACE_EVENTS
+// Trace names must be literals
+static const char* span_names[LATENCY_KIND_COUNT][LATENCY_ACTION_COUNT] = {
+    {"latency_photon_next", "latency_photon_seek", "latency_photon_pause",
+     "latency_photon_station", "latency_photon_nav"},
+    {"latency_audio_next", "latency_audio_seek", "latency_audio_pause",
+     "latency_audio_station", "latency_audio_nav"},
+};
+#endif
+
+static LatencyHistogram histograms[LATENCY_KIND_COUNT][LATENCY_ACTION_COUNT];
+static uint64_t poll_us = 0;
+static uint64_t photon_start_us[LATENCY_ACTION_COUNT];     // 0 = none pending
+
+// The audio measurement in flight: written by the main thread while idle or
+// armed, the end by the callback before it publishes DONE
+static LatencyAction audio_action;
+static uint64_t audio_start_us;
+static uint64_t audio_end_us;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void record(LatencyKind kind, LatencyAction action, uint64_t start_us, uint64_t end_us) {
+    uint32_t ms = end_us > start_us ? (uint32_t)((end_us - start_us) / 1000) : 0;
+    LatencyHistogram* h = &histograms[kind][action];
+    int b = 0;
+    while (b < LATENCY_BUCKETS - 1 && ms > bucket_bounds[b]) b++;
+    h->buckets[b]++;
+    h->count++;
+    if (ms > h->max_ms) h->max_ms = ms;
+#ifdef TRACE_EVENTS
+    TRACE_SPAN(span_names[kind][action], start_us, end_us);
+#endif
+}
+
+// Record the audio measurement once the callback finished it
+static void collect_audio(void) {
+    if (__atomic_load_n(&latency_audio_state, __ATOMIC_ACQUIRE) != LATENCY_AUDIO_DONE) return;
+    record(LATENCY_AUDIO, audio_action, audio_start_us, audio_end_us);
+    __atomic_store_n(&latency_audio_state, LATENCY_AUDIO_IDLE, __ATOMIC_RELEASE);
+}
+
+void Latency_polled(void) {
+    poll_us = now_us();
+    collect_audio();
+}
+
+void Latency_begin(LatencyAction action, bool audio) {
+    // The oldest press not on screen yet is the one waited for
+    if (!photon_start_us[action]) photon_start_us[action] = poll_us;
+    if (audio) {
+        // The newest one decides what is heard
+        collect_audio();
+        __atomic_store_n(&latency_audio_state, LATENCY_AUDIO_IDLE, __ATOMIC_RELEASE);
+        audio_action = action;
+        audio_start_us = poll_us;
+        __atomic_store_n(&latency_audio_state, LATENCY_AUDIO_ARMED, __ATOMIC_RELEASE);
+    }
+}
+
+void Latency_flipped(void) {
+    uint64_t now = now_us();
+    for (int i = 0; i < LATENCY_ACTION_COUNT; i++) {
+        if (!photon_start_us[i]) continue;
+        record(LATENCY_PHOTON, (LatencyAction)i, photon_start_us[i], now);
+        photon_start_us[i] = 0;
+    }
+}
+
+void Latency_audioReady(void) {
+    int expected = LATENCY_AUDIO_ARMED;
+    __atomic_compare_exchange_n(&latency_audio_state, &expected, LATENCY_AUDIO_READY, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+void Latency_audioOutput(void) {
+    // A newer action may re-arm meanwhile; then the stamp is overwritten before use
+    audio_end_us = now_us();
+    int expected = LATENCY_AUDIO_READY;
+    __atomic_compare_exchange_n(&latency_audio_state, &expected, LATENCY_AUDIO_DONE, false,
+                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+void Latency_get(LatencyAction action, LatencyKind kind, LatencyHistogram* out) {
+    *out = histograms[kind][action];
+}
+
+uint32_t Latency_percentile(const LatencyHistogram* h, int percent) {
+    if (h->count == 0) return 0;
+    uint32_t rank = (h->count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (int b = 0; b < LATENCY_BUCKETS - 1; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) return bucket_bounds[b] < h->max_ms ? bucket_bounds[b] : h->max_ms;
+    }
+    return h->max_ms;
+}
+
+const char* Latency_actionName(LatencyAction action) {
+    return action_names[action];
+}
+
+static int format_histogram(char* out, size_t size, const LatencyHistogram* h) {
+    int len = snprintf(out, size, "n %u max %ums [", h->count, h->max_ms);
+    for (int b = 0; b < LATENCY_BUCKETS && len < (int)size; b++) {
+        len += snprintf(out + len, size - len, "%s%u", b ? " " : "", h->buckets[b]);
+    }
+    if (len < (int)size) len += snprintf(out + len, size - len, "]");
+    return len;
+}
+
+void Latency_log(void) {
+    for (int i = 0; i < LATENCY_ACTION_COUNT; i++) {
+        const LatencyHistogram* photon = &histograms[LATENCY_PHOTON][i];
+        const LatencyHistogram* audio = &histograms[LATENCY_AUDIO][i];
+        if (photon->count == 0 && audio->count == 0) continue;
+        char photon_text[128], audio_text[128];
+        format_histogram(photon_text, sizeof(photon_text), photon);
+        format_histogram(audio_text, sizeof(audio_text), audio);
+        LOG_info("latency: %-7s photon %s audio %s\n", action_names[i], photon_text, audio_text);
+    }
+}
+
+#endif
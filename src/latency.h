@@ -0,0 +1,102 @@
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Input-to-photon and input-to-audio latency (LATENCY_STATS builds: make
+// LATENCY=1, also on in TRACE builds)
+// Every PAD_poll is stamped. An action handled after it (skip, seek, play/pause,
+// station change, list navigation) starts a measurement at that stamp, which the
+// next main screen flip ends: input to photon. Actions that change what is heard
+// also wait for the player or radio to report new audio in place (a seek's ring
+// flushed, a track or station prebuffered) and for the first audio callback to
+// output it: input to audio. Each ends up in a per-action histogram, shown in an
+// overlay and logged, and as a span in the trace. Without either flag the
+// macros compile to nothing. Main thread, except the audio hooks.
+
+typedef enum {
+    LATENCY_NEXT,               // Next or previous track
+    LATENCY_SEEK,
+    LATENCY_PAUSE,              // Play/pause
+    LATENCY_STATION,            // Station change
+    LATENCY_NAV,                // Selection moved in a list
+    LATENCY_ACTION_COUNT
+} LatencyAction;
+
+typedef enum {
+    LATENCY_PHOTON,
+    LATENCY_AUDIO,
+    LATENCY_KIND_COUNT
+} LatencyKind;
+
+// Histogram bucket upper bounds in ms; the last bucket takes the rest
+#define LATENCY_BUCKETS 9
+#define LATENCY_BUCKET_BOUNDS_MS {16, 33, 50, 100, 200, 500, 1000, 2000, UINT32_MAX}
+
+#if defined(LATENCY_STATS) || defined(TRACE_EVENTS)
+
+typedef struct {
+    uint32_t count;
+    uint32_t max_ms;
+    uint32_t buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+enum {
+    LATENCY_AUDIO_IDLE,
+    LATENCY_AUDIO_ARMED,        // Waiting for new audio to be in place
+    LATENCY_AUDIO_READY,        // Waiting for the callback to output it
+    LATENCY_AUDIO_DONE          // Output, not yet recorded
+};
+
+extern int latency_audio_state;
+
+// PAD_poll ran: actions handled from here on start at this time
+void Latency_polled(void);
+
+// An action was handled; audio: it changes what is heard
+void Latency_begin(LatencyAction action, bool audio);
+
+// The main screen was flipped
+void Latency_flipped(void);
+
+// New audio is in place (player and radio threads)
+void Latency_audioReady(void);
+
+void Latency_audioOutput(void);
+
+// Audio callback: samples went out (a load and a compare unless one is due)
+static inline void Latency_audioOut(void) {
+    if (__atomic_load_n(&latency_audio_state, __ATOMIC_ACQUIRE) == LATENCY_AUDIO_READY) Latency_audioOutput();
+}
+
+// Copy out an action's histogram
+void Latency_get(LatencyAction action, LatencyKind kind, LatencyHistogram* out);
+
+// Upper bound of the bucket holding the given percentile (0 = no samples)
+uint32_t Latency_percentile(const LatencyHistogram* h, int percent);
+
+// Short name of an action ("next", "seek", ...)
+const char* Latency_actionName(LatencyAction action);
+
+// One log line per action measured, with its histograms (bucket counts in
+// LATENCY_BUCKET_BOUNDS_MS order)
+void Latency_log(void);
+
+#define LATENCY_POLLED() Latency_polled()
+#define LATENCY_BEGIN(action, audio) Latency_begin(action, audio)
+#define LATENCY_FLIPPED() Latency_flipped()
+#define LATENCY_AUDIO_READY() Latency_audioReady()
+#define LATENCY_AUDIO_OUT() Latency_audioOut()
+
+#else
+
+#define LATENCY_POLLED() ((void)0)
+#define LATENCY_BEGIN(action, audio) ((void)0)
+#define LATENCY_FLIPPED() ((void)0)
+#define LATENCY_AUDIO_READY() ((void)0)
+#define LATENCY_AUDIO_OUT() ((void)0)
+
+#endif
+
+#endif
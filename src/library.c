@@ -0,0 +1,1345 @@
+#define _GNU_SOURCE  // strcasestr
+#include "library.h"
+#include "player.h"
+#include "thread_role.h"
+#include "playlist.h"
+#include "defines.h"
+#include "api.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <time.h>
+#include <ctype.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+
+#define LIBRARY_FILE SHARED_USERDATA_PATH "/music_library.idx"
+#define LIBRARY_CHECKPOINT_FILE SHARED_USERDATA_PATH "/music_library.partial"
+#define LIBRARY_MAGIC 0x3142494C  // "LIB1"
+#define LIBRARY_VERSION 5
+
+#define SCAN_MAX_WORKERS 3              // Tag parsers (the audio core is kept free)
+#define SCAN_QUEUE_SIZE 64              // Files walked ahead of the workers
+#define SCAN_CHECKPOINT_FILES 250       // Newly parsed files between checkpoints
+#define SCAN_THROTTLE_MS 100            // Pause while the playback buffer is low
+#define SCAN_MTIME_SLACK 2              // FAT stores mtimes in 2 s steps
+#define SCAN_FORCED_MAX 64              // Directories reported by inotify per rescan
+#define SCAN_DEPTH_MAX 32               // Folder levels under the music folder totalled
+#define WATCH_SETTLE_MS 1500            // Quiet time after the last change before rescanning
+#define WATCH_MASK (IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+
+#define SEARCH_BUCKETS 65536            // Trigram hash buckets (power of two)
+#define SEARCH_TEXT_MAX 1024            // Folded title, artist, album and file name
+#define SEARCH_TYPO_TRIGRAMS 4          // Trigrams a typo can break (a swapped pair breaks four)
+
+// File layout: header, record_count records, dir_count directories and
+// playlist_count playlists sorted by path, item_count playlist items, the search
+// index (if posting_count > 0), then strings_size bytes of null-terminated
+// strings (offset 0 is the empty string, every string is stored once)
+//
+// Search index: SEARCH_BUCKETS + 1 offsets into posting_count record indexes.
+// Bucket h lists, in record order, the records whose folded text contains a
+// trigram hashing to h.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_count;
+    uint32_t dir_count;
+    uint32_t strings_size;
+    uint32_t posting_count;
+    uint32_t playlist_count;
+    uint32_t item_count;
+    int64_t built;              // time() the scan finished
+} LibraryHeader;
+
+// A scanned directory: while its mtime is unchanged its file list is too, so
+// the next scan takes its records from the index instead of reading it. The
+// totals are of the records inside it and its subfolders, summed when written.
+typedef struct {
+    uint32_t path;
+    uint32_t art;               // First record inside with an embedded cover (path offset, 0 = none)
+    int64_t mtime;
+    uint64_t duration_ms;
+    uint64_t bytes;
+    uint32_t file_count;
+    uint32_t direct_count;      // Of file_count, directly inside it
+    uint16_t formats;           // 1 << AudioFormat of each format among them
+    uint16_t reserved;
+    uint32_t reserved2;
+} LibraryDirectory;
+
+// A playlist file: items[first_item..first_item + item_count) are the string
+// offsets of its entries as written in the file
+typedef struct {
+    uint32_t path;
+    uint32_t first_item;
+    uint32_t item_count;
+    uint32_t reserved;
+    int64_t mtime;
+    int64_t size;
+} LibraryPlaylist;
+
+// A mapped index file
+typedef struct {
+    void* base;
+    size_t size;
+    const LibraryRecord* records;
+    int count;
+    const LibraryDirectory* dirs;
+    int dir_count;
+    const LibraryPlaylist* playlists;
+    int playlist_count;
+    const uint32_t* items;
+    uint32_t item_count;
+    const uint32_t* buckets;    // NULL without a search index
+    const uint32_t* postings;
+    uint32_t posting_count;
+    const char* strings;
+    uint32_t strings_size;
+    int64_t built;
+} LibraryMap;
+
+// Index the views read (main thread; the scanner only reads it while it runs)
+static LibraryMap current;
+
+static char library_root[512];
+static pthread_t scan_thread;
+static bool scan_active = false;        // Thread started and not joined yet
+static bool scan_done = false;          // Scanner finished (atomic)
+static bool scan_quit = false;          // Atomic, checked per file
+
+// ============ INDEX FILE ============
+
+static void map_close(LibraryMap* map) {
+    if (map->base) munmap(map->base, map->size);
+    memset(map, 0, sizeof(LibraryMap));
+}
+
+// Map an index file read-only, rejecting files that don't add up
+static bool map_open(LibraryMap* map, const char* path) {
+    memset(map, 0, sizeof(LibraryMap));
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(LibraryHeader)) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    const LibraryHeader* hdr = (const LibraryHeader*)base;
+    uint64_t search_bytes = hdr->posting_count ?
+                            (uint64_t)(SEARCH_BUCKETS + 1 + hdr->posting_count) * sizeof(uint32_t) : 0;
+    uint64_t expected = sizeof(LibraryHeader) + (uint64_t)hdr->record_count * sizeof(LibraryRecord) +
+                        (uint64_t)hdr->dir_count * sizeof(LibraryDirectory) +
+                        (uint64_t)hdr->playlist_count * sizeof(LibraryPlaylist) +
+                        (uint64_t)hdr->item_count * sizeof(uint32_t) + search_bytes + hdr->strings_size;
+    if (hdr->magic != LIBRARY_MAGIC || hdr->version != LIBRARY_VERSION ||
+        expected != (uint64_t)st.st_size || hdr->strings_size == 0) {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    const char* records = (const char*)base + sizeof(LibraryHeader);
+    const char* dirs = records + hdr->record_count * sizeof(LibraryRecord);
+    const char* playlists = dirs + hdr->dir_count * sizeof(LibraryDirectory);
+    const char* items = playlists + hdr->playlist_count * sizeof(LibraryPlaylist);
+    const char* search = items + hdr->item_count * sizeof(uint32_t);
+    const char* table = search + search_bytes;
+    if (table[hdr->strings_size - 1] != '\0') {
+        munmap(base, st.st_size);
+        return false;
+    }
+
+    map->base = base;
+    map->size = st.st_size;
+    map->records = (const LibraryRecord*)records;
+    map->count = (int)hdr->record_count;
+    map->dirs = (const LibraryDirectory*)dirs;
+    map->dir_count = (int)hdr->dir_count;
+    map->playlists = (const LibraryPlaylist*)playlists;
+    map->playlist_count = (int)hdr->playlist_count;
+    map->items = (const uint32_t*)items;
+    map->item_count = hdr->item_count;
+    if (hdr->posting_count) {
+        map->buckets = (const uint32_t*)search;
+        map->postings = map->buckets + SEARCH_BUCKETS + 1;
+        map->posting_count = hdr->posting_count;
+    }
+    map->strings = table;
+    map->strings_size = hdr->strings_size;
+    map->built = hdr->built;
+    return true;
+}
+
+static const char* map_string(const LibraryMap* map, uint32_t offset) {
+    if (!map->strings || offset >= map->strings_size) return "";
+    return &map->strings[offset];
+}
+
+// Binary search by path
+static int map_find(const LibraryMap* map, const char* path) {
+    int lo = 0, hi = map->count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(map_string(map, map->records[mid].path), path);
+        if (cmp == 0) return mid;
+        if (cmp < 0) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
+
+// First record (or directory) whose path sorts at or after prefix; entries are
+// structs starting with their path offset, stride bytes apart
+static int map_lower_bound(const LibraryMap* map, const void* entries, size_t stride, int count,
+                           const char* prefix) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t path = *(const uint32_t*)((const char*)entries + mid * stride);
+        if (strcmp(map_string(map, path), prefix) < 0) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+static int map_find_dir(const LibraryMap* map, const char* path) {
+    int i = map_lower_bound(map, map->dirs, sizeof(LibraryDirectory), map->dir_count, path);
+    if (i < map->dir_count && strcmp(map_string(map, map->dirs[i].path), path) == 0) return i;
+    return -1;
+}
+
+// Playlist of a path whose items are all in the map, or -1
+static int map_find_playlist(const LibraryMap* map, const char* path) {
+    int i = map_lower_bound(map, map->playlists, sizeof(LibraryPlaylist), map->playlist_count, path);
+    if (i >= map->playlist_count || strcmp(map_string(map, map->playlists[i].path), path) != 0) return -1;
+    const LibraryPlaylist* pl = &map->playlists[i];
+    if ((uint64_t)pl->first_item + pl->item_count > map->item_count) return -1;
+    return i;
+}
+
+// Name of path if it is directly inside the directory prefix ("dir/"), else NULL
+static const char* direct_child(const char* path, const char* prefix, size_t prefix_len) {
+    if (strncmp(path, prefix, prefix_len) != 0) return NULL;
+    return strchr(path + prefix_len, '/') ? NULL : path + prefix_len;
+}
+
+// ============ SEARCH TEXT ============
+
+// Lowercase letters and digits, other ASCII as single spaces, with a space at
+// both ends so word starts and ends make trigrams too. UTF-8 bytes pass through.
+static int search_fold(const char* in, char* out, int out_size, int len) {
+    if (len == 0) out[len++] = ' ';
+    for (; *in && len < out_size - 2; in++) {
+        unsigned char c = (unsigned char)*in;
+        if (c >= 0x80 || isalnum(c)) {
+            out[len++] = (char)tolower(c);
+        } else if (out[len - 1] != ' ') {
+            out[len++] = ' ';
+        }
+    }
+    if (out[len - 1] != ' ') out[len++] = ' ';
+    out[len] = '\0';
+    return len;
+}
+
+// Distinct trigram hashes of folded text, sorted; returns the count
+static int compare_u16(const void* a, const void* b) {
+    return (int)*(const uint16_t*)a - (int)*(const uint16_t*)b;
+}
+
+static int search_trigrams(const char* text, int len, uint16_t* hashes) {
+    int count = 0;
+    for (int i = 0; i + 3 <= len; i++) {
+        uint32_t t = ((uint32_t)(uint8_t)text[i] << 16) | ((uint32_t)(uint8_t)text[i + 1] << 8) |
+                     (uint8_t)text[i + 2];
+        hashes[count++] = (uint16_t)((t * 2654435761u) >> 16);
+    }
+    qsort(hashes, count, sizeof(uint16_t), compare_u16);
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {
+        if (distinct == 0 || hashes[distinct - 1] != hashes[i]) hashes[distinct++] = hashes[i];
+    }
+    return distinct;
+}
+
+// Searchable text of a record: title, artist, album and the file name
+static int record_search_text(const char* strings, const LibraryRecord* r, char* out) {
+    const char* path = &strings[r->path];
+    const char* slash = strrchr(path, '/');
+    char name[256];
+    snprintf(name, sizeof(name), "%s", slash ? slash + 1 : path);
+    char* dot = strrchr(name, '.');
+    if (dot && dot != name) *dot = '\0';
+
+    int len = search_fold(&strings[r->title], out, SEARCH_TEXT_MAX, 0);
+    len = search_fold(&strings[r->artist], out, SEARCH_TEXT_MAX, len);
+    len = search_fold(&strings[r->album], out, SEARCH_TEXT_MAX, len);
+    return search_fold(name, out, SEARCH_TEXT_MAX, len);
+}
+
+// ============ INDEX BUILDER ============
+
+// Records and interned strings of the index being built (scan_lock)
+typedef struct {
+    LibraryRecord* records;
+    int count;
+    int capacity;
+    LibraryDirectory* dirs;
+    int dir_count;
+    int dir_capacity;
+    LibraryPlaylist* playlists;
+    int playlist_count;
+    int playlist_capacity;
+    uint32_t* items;
+    uint32_t item_count;
+    uint32_t item_capacity;
+    char* strings;
+    uint32_t strings_size;
+    uint32_t strings_capacity;
+    uint32_t* slots;            // Intern hash table: string offset + 1, 0 = empty
+    uint32_t slot_count;        // Power of two
+    uint32_t slot_used;
+} LibraryBuilder;
+
+static uint32_t string_hash(const char* s) {
+    uint32_t hash = 5381;
+    while (*s) hash = ((hash << 5) + hash) + (uint8_t)*s++;
+    return hash;
+}
+
+static bool builder_init(LibraryBuilder* b) {
+    memset(b, 0, sizeof(*b));
+    b->strings_capacity = 64 * 1024;
+    b->strings = malloc(b->strings_capacity);
+    b->slot_count = 4096;
+    b->slots = calloc(b->slot_count, sizeof(uint32_t));
+    if (!b->strings || !b->slots) {
+        free(b->strings);
+        free(b->slots);
+        return false;
+    }
+    b->strings[0] = '\0';
+    b->strings_size = 1;
+    return true;
+}
+
+static void builder_free(LibraryBuilder* b) {
+    free(b->records);
+    free(b->dirs);
+    free(b->playlists);
+    free(b->items);
+    free(b->strings);
+    free(b->slots);
+    memset(b, 0, sizeof(*b));
+}
+
+static bool builder_grow_slots(LibraryBuilder* b) {
+    uint32_t count = b->slot_count * 2;
+    uint32_t* slots = calloc(count, sizeof(uint32_t));
+    if (!slots) return false;
+    for (uint32_t i = 0; i < b->slot_count; i++) {
+        if (!b->slots[i]) continue;
+        uint32_t j = string_hash(&b->strings[b->slots[i] - 1]) & (count - 1);
+        while (slots[j]) j = (j + 1) & (count - 1);
+        slots[j] = b->slots[i];
+    }
+    free(b->slots);
+    b->slots = slots;
+    b->slot_count = count;
+    return true;
+}
+
+// Offset of s in the string table, adding it the first time (0 on failure or "")
+static uint32_t builder_intern(LibraryBuilder* b, const char* s) {
+    if (!s || !s[0]) return 0;
+    if (b->slot_used * 2 >= b->slot_count && !builder_grow_slots(b)) return 0;
+
+    uint32_t mask = b->slot_count - 1;
+    uint32_t i = string_hash(s) & mask;
+    while (b->slots[i]) {
+        if (strcmp(&b->strings[b->slots[i] - 1], s) == 0) return b->slots[i] - 1;
+        i = (i + 1) & mask;
+    }
+
+    size_t len = strlen(s) + 1;
+    if (b->strings_size + len > b->strings_capacity) {
+        uint32_t capacity = b->strings_capacity;
+        while (b->strings_size + len > capacity) capacity *= 2;
+        char* grown = realloc(b->strings, capacity);
+        if (!grown) return 0;
+        b->strings = grown;
+        b->strings_capacity = capacity;
+    }
+    uint32_t offset = b->strings_size;
+    memcpy(&b->strings[offset], s, len);
+    b->strings_size += len;
+    b->slots[i] = offset + 1;
+    b->slot_used++;
+    return offset;
+}
+
+static LibraryRecord* builder_add(LibraryBuilder* b) {
+    if (b->count == b->capacity) {
+        int capacity = b->capacity ? b->capacity * 2 : 1024;
+        LibraryRecord* grown = realloc(b->records, sizeof(LibraryRecord) * capacity);
+        if (!grown) return NULL;
+        b->records = grown;
+        b->capacity = capacity;
+    }
+    LibraryRecord* r = &b->records[b->count++];
+    memset(r, 0, sizeof(LibraryRecord));
+    return r;
+}
+
+// Copy a record of another index, re-interning its strings
+static void builder_copy(LibraryBuilder* b, const LibraryMap* map, int index) {
+    const LibraryRecord* src = &map->records[index];
+    LibraryRecord* r = builder_add(b);
+    if (!r) return;
+    *r = *src;
+    r->path = builder_intern(b, map_string(map, src->path));
+    r->title = builder_intern(b, map_string(map, src->title));
+    r->artist = builder_intern(b, map_string(map, src->artist));
+    r->album = builder_intern(b, map_string(map, src->album));
+}
+
+static void builder_add_dir(LibraryBuilder* b, const char* path, int64_t mtime) {
+    if (b->dir_count == b->dir_capacity) {
+        int capacity = b->dir_capacity ? b->dir_capacity * 2 : 256;
+        LibraryDirectory* grown = realloc(b->dirs, sizeof(LibraryDirectory) * capacity);
+        if (!grown) return;
+        b->dirs = grown;
+        b->dir_capacity = capacity;
+    }
+    LibraryDirectory* d = &b->dirs[b->dir_count++];
+    memset(d, 0, sizeof(LibraryDirectory));
+    d->path = builder_intern(b, path);
+    d->mtime = mtime;
+}
+
+static LibraryPlaylist* builder_add_playlist(LibraryBuilder* b, const char* path, int64_t mtime, int64_t size) {
+    if (b->playlist_count == b->playlist_capacity) {
+        int capacity = b->playlist_capacity ? b->playlist_capacity * 2 : 32;
+        LibraryPlaylist* grown = realloc(b->playlists, sizeof(LibraryPlaylist) * capacity);
+        if (!grown) return NULL;
+        b->playlists = grown;
+        b->playlist_capacity = capacity;
+    }
+    LibraryPlaylist* pl = &b->playlists[b->playlist_count++];
+    memset(pl, 0, sizeof(LibraryPlaylist));
+    pl->path = builder_intern(b, path);
+    pl->first_item = b->item_count;
+    pl->mtime = mtime;
+    pl->size = size;
+    return pl;
+}
+
+// Append an item to the playlist added last
+static void builder_add_item(LibraryBuilder* b, const char* item) {
+    if (b->playlist_count == 0) return;
+    if (b->item_count == b->item_capacity) {
+        uint32_t capacity = b->item_capacity ? b->item_capacity * 2 : 1024;
+        uint32_t* grown = realloc(b->items, sizeof(uint32_t) * capacity);
+        if (!grown) return;
+        b->items = grown;
+        b->item_capacity = capacity;
+    }
+    b->items[b->item_count++] = builder_intern(b, item);
+    b->playlists[b->playlist_count - 1].item_count++;
+}
+
+// Copy a playlist of another index, re-interning its items
+static void builder_copy_playlist(LibraryBuilder* b, const LibraryMap* map, int index) {
+    const LibraryPlaylist* src = &map->playlists[index];
+    if (!builder_add_playlist(b, map_string(map, src->path), src->mtime, src->size)) return;
+    for (uint32_t i = 0; i < src->item_count; i++) {
+        builder_add_item(b, map_string(map, map->items[src->first_item + i]));
+    }
+}
+
+static const char* sort_strings;  // String table for the path comparators (scan_lock)
+
+static int compare_record_paths(const void* a, const void* b) {
+    return strcmp(&sort_strings[((const LibraryRecord*)a)->path],
+                  &sort_strings[((const LibraryRecord*)b)->path]);
+}
+
+static int compare_dir_paths(const void* a, const void* b) {
+    return strcmp(&sort_strings[((const LibraryDirectory*)a)->path],
+                  &sort_strings[((const LibraryDirectory*)b)->path]);
+}
+
+static int compare_playlist_paths(const void* a, const void* b) {
+    return strcmp(&sort_strings[((const LibraryPlaylist*)a)->path],
+                  &sort_strings[((const LibraryPlaylist*)b)->path]);
+}
+
+// Directory of a path in the (sorted) directories, or -1
+static int builder_find_dir(const LibraryBuilder* b, const char* path) {
+    int lo = 0, hi = b->dir_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(&b->strings[b->dirs[mid].path], path);
+        if (cmp == 0) return mid;
+        if (cmp < 0) lo = mid + 1; else hi = mid - 1;
+    }
+    return -1;
+}
+
+// Sum the records into their directory and every one above it, up to the music
+// folder. The chain of directories of the last record's folder is kept, so a run
+// of records in the same folder (path order mostly gives runs, though a folder's
+// files interleave with its subfolders') looks it up once; any order sums right.
+static void builder_total_dirs(LibraryBuilder* b) {
+    for (int i = 0; i < b->dir_count; i++) {
+        LibraryDirectory* d = &b->dirs[i];
+        d->art = 0;
+        d->duration_ms = 0;
+        d->bytes = 0;
+        d->file_count = 0;
+        d->direct_count = 0;
+        d->formats = 0;
+    }
+
+    char parent[512] = "";
+    int chain[SCAN_DEPTH_MAX];
+    int depth = 0;
+    for (int i = 0; i < b->count; i++) {
+        const LibraryRecord* r = &b->records[i];
+        const char* path = &b->strings[r->path];
+        const char* slash = strrchr(path, '/');
+        size_t len = slash ? (size_t)(slash - path) : 0;
+        if (len == 0 || len >= sizeof(parent)) continue;
+
+        if (strncmp(parent, path, len) != 0 || parent[len] != '\0') {
+            memcpy(parent, path, len);
+            parent[len] = '\0';
+            char dir[512];
+            memcpy(dir, parent, len + 1);
+            depth = 0;
+            int d;
+            while (depth < SCAN_DEPTH_MAX && (d = builder_find_dir(b, dir)) >= 0) {
+                chain[depth++] = d;
+                char* up = strrchr(dir, '/');
+                if (!up) break;
+                *up = '\0';
+            }
+        }
+
+        for (int k = 0; k < depth; k++) {
+            LibraryDirectory* d = &b->dirs[chain[k]];
+            d->file_count++;
+            d->duration_ms += r->duration_ms;
+            d->bytes += (uint64_t)r->size;
+            if (r->format < 16) d->formats |= (uint16_t)(1 << r->format);
+            if (!d->art && r->art_size) d->art = r->path;
+        }
+        if (depth > 0) b->dirs[chain[0]].direct_count++;
+    }
+}
+
+// Posting lists of the (sorted) records: counted in a first pass over each
+// record's distinct trigrams, filled in a second. Returns false if out of memory.
+static bool builder_build_search(const LibraryBuilder* b, uint32_t** buckets_out, uint32_t** postings_out,
+                                 uint32_t* posting_count) {
+    uint32_t* buckets = calloc(SEARCH_BUCKETS + 1, sizeof(uint32_t));
+    uint32_t* starts = malloc(sizeof(uint32_t) * (b->count + 1));
+    uint16_t* hashes = NULL;
+    uint32_t hash_count = 0, hash_capacity = 0;
+    char text[SEARCH_TEXT_MAX];
+    uint16_t record_hashes[SEARCH_TEXT_MAX];
+    if (!buckets || !starts) goto fail;
+
+    for (int i = 0; i < b->count; i++) {
+        int len = record_search_text(b->strings, &b->records[i], text);
+        int n = search_trigrams(text, len, record_hashes);
+        if (hash_count + n > hash_capacity) {
+            uint32_t capacity = hash_capacity ? hash_capacity * 2 : 64 * 1024;
+            while (hash_count + n > capacity) capacity *= 2;
+            uint16_t* grown = realloc(hashes, sizeof(uint16_t) * capacity);
+            if (!grown) goto fail;
+            hashes = grown;
+            hash_capacity = capacity;
+        }
+        starts[i] = hash_count;
+        for (int j = 0; j < n; j++) {
+            hashes[hash_count++] = record_hashes[j];
+            buckets[record_hashes[j] + 1]++;
+        }
+    }
+    starts[b->count] = hash_count;
+
+    for (int h = 0; h < SEARCH_BUCKETS; h++) buckets[h + 1] += buckets[h];
+    uint32_t* postings = malloc(sizeof(uint32_t) * (hash_count ? hash_count : 1));
+    if (!postings) goto fail;
+    uint32_t* cursor = malloc(sizeof(uint32_t) * SEARCH_BUCKETS);
+    if (!cursor) {
+        free(postings);
+        goto fail;
+    }
+    memcpy(cursor, buckets, sizeof(uint32_t) * SEARCH_BUCKETS);
+    for (int i = 0; i < b->count; i++) {
+        for (uint32_t j = starts[i]; j < starts[i + 1]; j++) {
+            postings[cursor[hashes[j]]++] = (uint32_t)i;
+        }
+    }
+    free(cursor);
+    free(hashes);
+    free(starts);
+
+    *buckets_out = buckets;
+    *postings_out = postings;
+    *posting_count = hash_count;
+    return true;
+
+fail:
+    free(hashes);
+    free(starts);
+    free(buckets);
+    return false;
+}
+
+// Sort by path and write the index to a temp file, renamed over path
+// Checkpoints are only read back by the scanner and skip the search index.
+static bool builder_write(LibraryBuilder* b, const char* path, bool with_search) {
+    sort_strings = b->strings;
+    qsort(b->records, b->count, sizeof(LibraryRecord), compare_record_paths);
+    qsort(b->dirs, b->dir_count, sizeof(LibraryDirectory), compare_dir_paths);
+    qsort(b->playlists, b->playlist_count, sizeof(LibraryPlaylist), compare_playlist_paths);
+    builder_total_dirs(b);
+
+    uint32_t* buckets = NULL;
+    uint32_t* postings = NULL;
+    uint32_t posting_count = 0;
+    if (with_search && !builder_build_search(b, &buckets, &postings, &posting_count)) {
+        LOG_error("Library: out of memory building the search index\n");
+    }
+
+    LibraryHeader hdr = {
+        .magic = LIBRARY_MAGIC,
+        .version = LIBRARY_VERSION,
+        .record_count = (uint32_t)b->count,
+        .dir_count = (uint32_t)b->dir_count,
+        .strings_size = b->strings_size,
+        .posting_count = posting_count,
+        .playlist_count = (uint32_t)b->playlist_count,
+        .item_count = b->item_count,
+        .built = (int64_t)time(NULL),
+    };
+
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(buckets);
+        free(postings);
+        return false;
+    }
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              (b->count == 0 || fwrite(b->records, sizeof(LibraryRecord), b->count, f) == (size_t)b->count) &&
+              (b->dir_count == 0 ||
+               fwrite(b->dirs, sizeof(LibraryDirectory), b->dir_count, f) == (size_t)b->dir_count) &&
+              (b->playlist_count == 0 ||
+               fwrite(b->playlists, sizeof(LibraryPlaylist), b->playlist_count, f) == (size_t)b->playlist_count) &&
+              (b->item_count == 0 || fwrite(b->items, sizeof(uint32_t), b->item_count, f) == b->item_count) &&
+              (posting_count == 0 ||
+               (fwrite(buckets, sizeof(uint32_t), SEARCH_BUCKETS + 1, f) == SEARCH_BUCKETS + 1 &&
+                fwrite(postings, sizeof(uint32_t), posting_count, f) == posting_count)) &&
+              fwrite(b->strings, 1, b->strings_size, f) == b->strings_size;
+    free(buckets);
+    free(postings);
+    if (fclose(f) != 0) ok = false;
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+// ============ SCANNER ============
+// One walker thread reads directories and reuses unchanged records; files that
+// need their tags parsed go through a bounded queue to a pool of workers. The
+// partial index is checkpointed so an interrupted first scan resumes where it was.
+
+typedef struct {
+    char path[512];
+    int64_t mtime;
+    int64_t size;
+} ScanJob;
+
+static pthread_mutex_t scan_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t scan_job_ready = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t scan_slot_free = PTHREAD_COND_INITIALIZER;
+static ScanJob scan_queue[SCAN_QUEUE_SIZE];
+static int scan_queue_head = 0;
+static int scan_queue_count = 0;
+static bool scan_walk_done = false;
+static LibraryBuilder scan_builder;
+static LibraryMap scan_checkpoint;      // Records of an interrupted scan
+static int scan_parsed = 0;             // Files parsed since the last checkpoint
+static char scan_forced[SCAN_FORCED_MAX][512];  // Directories to read even if their mtime matches
+static int scan_forced_count = 0;
+static bool scan_force_all = false;     // Ignore directory mtimes (too many changes to track)
+
+// inotify watches of the music folder: one per scanned directory, since
+// watches aren't recursive. The scanner adds them, the main thread reads events.
+typedef struct {
+    int wd;
+    char* path;
+} LibraryWatch;
+
+static int watch_fd = -1;
+static pthread_mutex_t watch_lock = PTHREAD_MUTEX_INITIALIZER;
+static LibraryWatch* watches = NULL;
+static int watch_count = 0;
+static int watch_capacity = 0;
+
+// Changes reported since the last rescan started (main thread)
+static char pending_dirs[SCAN_FORCED_MAX][512];
+static int pending_count = 0;
+static bool pending_all = false;
+static uint32_t pending_since = 0;      // SDL_GetTicks() of the last event
+
+// Watch a directory, or refresh the path of an existing watch (it follows the
+// inode, so a moved directory keeps its descriptor)
+static void watch_add(const char* path) {
+    if (watch_fd < 0) return;
+    int wd = inotify_add_watch(watch_fd, path, WATCH_MASK | IN_ONLYDIR);
+    if (wd < 0) return;
+
+    pthread_mutex_lock(&watch_lock);
+    LibraryWatch* w = NULL;
+    for (int i = 0; i < watch_count; i++) {
+        if (watches[i].wd == wd) {
+            w = &watches[i];
+            break;
+        }
+    }
+    if (!w && watch_count == watch_capacity) {
+        int capacity = watch_capacity ? watch_capacity * 2 : 256;
+        LibraryWatch* grown = realloc(watches, sizeof(LibraryWatch) * capacity);
+        if (grown) {
+            watches = grown;
+            watch_capacity = capacity;
+        }
+    }
+    if (!w && watch_count < watch_capacity) {
+        w = &watches[watch_count++];
+        w->wd = wd;
+        w->path = NULL;
+    }
+    if (w && (!w->path || strcmp(w->path, path) != 0)) {
+        free(w->path);
+        w->path = strdup(path);
+    }
+    pthread_mutex_unlock(&watch_lock);
+}
+
+// Directory whose contents changed, for the next rescan
+static void mark_changed(const char* dir_path) {
+    for (int i = 0; i < pending_count; i++) {
+        if (strcmp(pending_dirs[i], dir_path) == 0) return;
+    }
+    if (pending_count < SCAN_FORCED_MAX) {
+        snprintf(pending_dirs[pending_count++], sizeof(pending_dirs[0]), "%s", dir_path);
+    } else {
+        pending_all = true;
+    }
+}
+
+// Drain queued inotify events into the pending changes
+static void watch_poll(void) {
+    if (watch_fd < 0) return;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len;
+    while ((len = read(watch_fd, buf, sizeof(buf))) > 0) {
+        pthread_mutex_lock(&watch_lock);
+        for (char* p = buf; p < buf + len;) {
+            const struct inotify_event* ev = (const struct inotify_event*)p;
+            p += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) {
+                pending_all = true;
+                pending_since = SDL_GetTicks();
+                continue;
+            }
+            for (int i = 0; i < watch_count; i++) {
+                if (watches[i].wd != ev->wd) continue;
+                if (ev->mask & IN_IGNORED) {
+                    // Directory removed: its parent's event triggers the rescan
+                    free(watches[i].path);
+                    watches[i] = watches[--watch_count];
+                } else if (ev->len == 0 || ev->name[0] != '.') {
+                    // Hidden names are skipped, like the scanner (YouTube's temp downloads)
+                    mark_changed(watches[i].path);
+                    pending_since = SDL_GetTicks();
+                }
+                break;
+            }
+        }
+        pthread_mutex_unlock(&watch_lock);
+    }
+}
+
+static void watch_free(void) {
+    if (watch_fd >= 0) close(watch_fd);
+    watch_fd = -1;
+    for (int i = 0; i < watch_count; i++) free(watches[i].path);
+    free(watches);
+    watches = NULL;
+    watch_count = 0;
+    watch_capacity = 0;
+}
+
+// Back off while playback is short of buffered audio: tag reads compete with
+// the decoder for the SD card even though the threads only get idle CPU
+static void scan_throttle(void) {
+    while (!__atomic_load_n(&scan_quit, __ATOMIC_RELAXED)) {
+        PlayerDecodeStats stats;
+        Player_getDecodeStats(&stats);
+        if (!stats.active || stats.buffered_ms >= stats.low_watermark_ms) return;
+        usleep(SCAN_THROTTLE_MS * 1000);
+    }
+}
+
+// Queue a file for the workers (blocks while the queue is full)
+static void scan_push(const char* path, const struct stat* st) {
+    pthread_mutex_lock(&scan_lock);
+    while (scan_queue_count == SCAN_QUEUE_SIZE && !__atomic_load_n(&scan_quit, __ATOMIC_RELAXED)) {
+        pthread_cond_wait(&scan_slot_free, &scan_lock);
+    }
+    if (scan_queue_count < SCAN_QUEUE_SIZE) {
+        ScanJob* job = &scan_queue[(scan_queue_head + scan_queue_count) % SCAN_QUEUE_SIZE];
+        snprintf(job->path, sizeof(job->path), "%s", path);
+        job->mtime = (int64_t)st->st_mtime;
+        job->size = (int64_t)st->st_size;
+        scan_queue_count++;
+        pthread_cond_signal(&scan_job_ready);
+    }
+    pthread_mutex_unlock(&scan_lock);
+}
+
+// Next queued file, false once the walk is over and the queue is drained
+static bool scan_pop(ScanJob* job) {
+    pthread_mutex_lock(&scan_lock);
+    while (scan_queue_count == 0 && !scan_walk_done && !__atomic_load_n(&scan_quit, __ATOMIC_RELAXED)) {
+        pthread_cond_wait(&scan_job_ready, &scan_lock);
+    }
+    bool ok = scan_queue_count > 0 && !__atomic_load_n(&scan_quit, __ATOMIC_RELAXED);
+    if (ok) {
+        *job = scan_queue[scan_queue_head];
+        scan_queue_head = (scan_queue_head + 1) % SCAN_QUEUE_SIZE;
+        scan_queue_count--;
+        pthread_cond_signal(&scan_slot_free);
+    }
+    pthread_mutex_unlock(&scan_lock);
+    return ok;
+}
+
+static void* scan_worker_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    ScanJob job;
+    while (scan_pop(&job)) {
+        scan_throttle();
+
+        PlayerFileTags tags;
+        if (Player_readFileTags(job.path, &tags) != 0) continue;
+
+        pthread_mutex_lock(&scan_lock);
+        LibraryBuilder* b = &scan_builder;
+        LibraryRecord* r = builder_add(b);
+        if (r) {
+            r->path = builder_intern(b, job.path);
+            r->title = builder_intern(b, tags.info.title);
+            r->artist = builder_intern(b, tags.info.artist);
+            r->album = builder_intern(b, tags.info.album);
+            r->mtime = job.mtime;
+            r->size = job.size;
+            r->duration_ms = tags.info.duration_ms > 0 ? (uint32_t)tags.info.duration_ms : 0;
+            r->replaygain_db = tags.replaygain_db;
+            r->has_replaygain = tags.has_replaygain;
+            r->art_offset = (uint32_t)tags.art_offset;
+            r->art_size = tags.art_size;
+            r->format = (uint8_t)Player_probeFormat(job.path);   // What it holds, not what it's named
+        }
+        if (++scan_parsed >= SCAN_CHECKPOINT_FILES) {
+            builder_write(b, LIBRARY_CHECKPOINT_FILE, false);
+            scan_parsed = 0;
+        }
+        pthread_mutex_unlock(&scan_lock);
+    }
+    return NULL;
+}
+
+// Reuse the record of an unchanged file from the index or the checkpoint
+static bool scan_reuse(const LibraryMap* map, const char* path, const struct stat* st) {
+    int i = map_find(map, path);
+    if (i < 0 || map->records[i].mtime != (int64_t)st->st_mtime || map->records[i].size != (int64_t)st->st_size) {
+        return false;
+    }
+    pthread_mutex_lock(&scan_lock);
+    builder_copy(&scan_builder, map, i);
+    pthread_mutex_unlock(&scan_lock);
+    return true;
+}
+
+// Parse a playlist into the index, or reuse it from the index or the checkpoint
+// if the file is unchanged. Parsed in the walker: it's one read of a small file.
+static void scan_items_add(const char* item, void* userdata) {
+    builder_add_item((LibraryBuilder*)userdata, item);
+}
+
+static void scan_playlist(const char* path, const struct stat* st) {
+    const LibraryMap* maps[] = {&current, &scan_checkpoint};
+    for (int m = 0; m < 2; m++) {
+        int i = map_find_playlist(maps[m], path);
+        if (i < 0 || maps[m]->playlists[i].mtime != (int64_t)st->st_mtime ||
+            maps[m]->playlists[i].size != (int64_t)st->st_size) {
+            continue;
+        }
+        pthread_mutex_lock(&scan_lock);
+        builder_copy_playlist(&scan_builder, maps[m], i);
+        pthread_mutex_unlock(&scan_lock);
+        return;
+    }
+
+    // Items of one playlist stay consecutive: hold the lock for the whole file
+    pthread_mutex_lock(&scan_lock);
+    if (builder_add_playlist(&scan_builder, path, (int64_t)st->st_mtime, (int64_t)st->st_size)) {
+        Playlist_read(path, scan_items_add, &scan_builder);
+    }
+    pthread_mutex_unlock(&scan_lock);
+}
+
+// Formats the player can stream
+static bool is_playable(AudioFormat format) {
+    return format == AUDIO_FORMAT_MP3 || format == AUDIO_FORMAT_WAV || format == AUDIO_FORMAT_FLAC ||
+           format == AUDIO_FORMAT_OGG || format == AUDIO_FORMAT_M4A;
+}
+
+static bool scan_is_forced(const char* dir_path) {
+    if (scan_force_all) return true;
+    for (int i = 0; i < scan_forced_count; i++) {
+        if (strcmp(scan_forced[i], dir_path) == 0) return true;
+    }
+    return false;
+}
+
+static void scan_directory(const char* dir_path, const struct stat* dir_st);
+
+// Directory unchanged since the last index: copy its records and only stat the
+// subdirectories it had, without reading it
+static void scan_unchanged_directory(const char* dir_path) {
+    char prefix[512];
+    int prefix_len = snprintf(prefix, sizeof(prefix), "%s/", dir_path);
+    if (prefix_len >= (int)sizeof(prefix)) return;
+
+    pthread_mutex_lock(&scan_lock);
+    for (int i = map_lower_bound(&current, current.records, sizeof(LibraryRecord), current.count, prefix);
+         i < current.count; i++) {
+        const char* path = map_string(&current, current.records[i].path);
+        if (strncmp(path, prefix, prefix_len) != 0) break;
+        if (direct_child(path, prefix, prefix_len)) builder_copy(&scan_builder, &current, i);
+    }
+    for (int i = map_lower_bound(&current, current.playlists, sizeof(LibraryPlaylist), current.playlist_count, prefix);
+         i < current.playlist_count; i++) {
+        const char* path = map_string(&current, current.playlists[i].path);
+        if (strncmp(path, prefix, prefix_len) != 0) break;
+        if (direct_child(path, prefix, prefix_len) && map_find_playlist(&current, path) == i) {
+            builder_copy_playlist(&scan_builder, &current, i);
+        }
+    }
+    pthread_mutex_unlock(&scan_lock);
+
+    for (int i = map_lower_bound(&current, current.dirs, sizeof(LibraryDirectory), current.dir_count, prefix);
+         i < current.dir_count && !__atomic_load_n(&scan_quit, __ATOMIC_RELAXED); i++) {
+        const char* path = map_string(&current, current.dirs[i].path);
+        if (strncmp(path, prefix, prefix_len) != 0) break;
+        if (!direct_child(path, prefix, prefix_len)) continue;
+
+        struct stat st;
+        if (stat(path, &st) == 0 && S_ISDIR(st.st_mode)) {
+            scan_throttle();
+            scan_directory(path, &st);
+        }
+    }
+}
+
+// Walk a directory tree (hidden entries skipped, like the browser)
+static void scan_directory(const char* dir_path, const struct stat* dir_st) {
+    watch_add(dir_path);
+
+    pthread_mutex_lock(&scan_lock);
+    builder_add_dir(&scan_builder, dir_path, (int64_t)dir_st->st_mtime);
+    pthread_mutex_unlock(&scan_lock);
+
+    // Adding, removing or renaming an entry updates the directory mtime. One
+    // that changed within the mtime resolution of the last scan is read again.
+    int old = map_find_dir(&current, dir_path);
+    if (old >= 0 && !scan_is_forced(dir_path) && current.dirs[old].mtime == (int64_t)dir_st->st_mtime &&
+        (int64_t)dir_st->st_mtime + SCAN_MTIME_SLACK < current.built) {
+        scan_unchanged_directory(dir_path);
+        return;
+    }
+
+    DIR* dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent* ent;
+    while (!__atomic_load_n(&scan_quit, __ATOMIC_RELAXED) && (ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+
+        // Only directories, audio files and playlists need a syscall
+        bool maybe_dir = ent->d_type == DT_DIR || ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK;
+        bool indexed = is_playable(Player_detectFormat(ent->d_name)) || Playlist_isPlaylistFile(ent->d_name);
+        if (!maybe_dir && (ent->d_type != DT_REG || !indexed)) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, ent->d_name);
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0) continue;
+
+        if (S_ISDIR(st.st_mode)) {
+            // Symlinked directories are not followed, they could loop
+            if (ent->d_type != DT_LNK) {
+                scan_throttle();
+                scan_directory(path, &st);
+            }
+        } else if (S_ISREG(st.st_mode) && is_playable(Player_detectFormat(ent->d_name))) {
+            if (!scan_reuse(&current, path, &st) && !scan_reuse(&scan_checkpoint, path, &st)) {
+                scan_push(path, &st);
+            }
+        } else if (S_ISREG(st.st_mode) && Playlist_isPlaylistFile(ent->d_name)) {
+            scan_playlist(path, &st);
+        }
+    }
+    closedir(dir);
+}
+
+static void* scan_thread_func(void* arg) {
+    (void)arg;
+
+    // Lowest priority: only use CPU playback and the UI don't need
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    if (!builder_init(&scan_builder)) {
+        __atomic_store_n(&scan_done, true, __ATOMIC_RELEASE);
+        return NULL;
+    }
+    map_open(&scan_checkpoint, LIBRARY_CHECKPOINT_FILE);
+    scan_queue_head = 0;
+    scan_queue_count = 0;
+    scan_walk_done = false;
+    scan_parsed = 0;
+
+    // One worker per core outside the audio core
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (workers < 1) workers = 1;
+    if (workers > SCAN_MAX_WORKERS) workers = SCAN_MAX_WORKERS;
+    pthread_t worker_threads[SCAN_MAX_WORKERS];
+    int started = 0;
+    for (int i = 0; i < workers; i++) {
+        if (pthread_create(&worker_threads[started], NULL, scan_worker_func, NULL) == 0) started++;
+    }
+
+    struct stat root_st;
+    if (started > 0 && stat(library_root, &root_st) == 0) {
+        scan_directory(library_root, &root_st);
+    }
+
+    pthread_mutex_lock(&scan_lock);
+    scan_walk_done = true;
+    pthread_cond_broadcast(&scan_job_ready);
+    pthread_mutex_unlock(&scan_lock);
+    for (int i = 0; i < started; i++) {
+        pthread_join(worker_threads[i], NULL);
+    }
+    map_close(&scan_checkpoint);
+
+    if (started == 0) {
+        LOG_error("Library: failed to start scan workers\n");
+    } else if (__atomic_load_n(&scan_quit, __ATOMIC_RELAXED)) {
+        // Quit halfway: keep what was parsed for the next scan
+        builder_write(&scan_builder, LIBRARY_CHECKPOINT_FILE, false);
+    } else if (builder_write(&scan_builder, LIBRARY_FILE, true)) {
+        unlink(LIBRARY_CHECKPOINT_FILE);
+    } else {
+        LOG_error("Library: failed to write %s\n", LIBRARY_FILE);
+    }
+    builder_free(&scan_builder);
+
+    __atomic_store_n(&scan_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void scan_join(void) {
+    if (scan_active) {
+        pthread_join(scan_thread, NULL);
+        scan_active = false;
+    }
+}
+
+// ============ PUBLIC API ============
+
+void Library_init(const char* music_root) {
+    strncpy(library_root, music_root, sizeof(library_root) - 1);
+    library_root[sizeof(library_root) - 1] = '\0';
+    map_open(&current, LIBRARY_FILE);
+
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd < 0) LOG_error("Library: inotify unavailable, changes show up on the next start\n");
+
+    Library_rescan();
+}
+
+void Library_quit(void) {
+    pthread_mutex_lock(&scan_lock);
+    __atomic_store_n(&scan_quit, true, __ATOMIC_RELAXED);
+    pthread_cond_broadcast(&scan_job_ready);
+    pthread_cond_broadcast(&scan_slot_free);
+    pthread_mutex_unlock(&scan_lock);
+    scan_join();
+    map_close(&current);
+    watch_free();
+}
+
+void Library_rescan(void) {
+    if (scan_active || library_root[0] == '\0') return;
+
+    // Hand the reported changes to the scanner
+    memcpy(scan_forced, pending_dirs, sizeof(pending_dirs[0]) * pending_count);
+    scan_forced_count = pending_count;
+    scan_force_all = pending_all;
+    pending_count = 0;
+    pending_all = false;
+
+    __atomic_store_n(&scan_quit, false, __ATOMIC_RELAXED);
+    __atomic_store_n(&scan_done, false, __ATOMIC_RELAXED);
+    if (pthread_create(&scan_thread, NULL, scan_thread_func, NULL) == 0) {
+        scan_active = true;
+    }
+}
+
+bool Library_isScanning(void) {
+    return scan_active;
+}
+
+bool Library_update(void) {
+    watch_poll();
+
+    bool changed = false;
+    if (scan_active && __atomic_load_n(&scan_done, __ATOMIC_ACQUIRE)) {
+        // The scanner no longer reads the old mapping once it's done
+        scan_join();
+        map_close(&current);
+        map_open(&current, LIBRARY_FILE);
+        changed = true;
+    }
+
+    // Rescan once a burst of changes (a copy, a download) has settled
+    if (!scan_active && (pending_count > 0 || pending_all) && SDL_GetTicks() - pending_since >= WATCH_SETTLE_MS) {
+        Library_rescan();
+    }
+    return changed;
+}
+
+int Library_count(void) {
+    return current.count;
+}
+
+const LibraryRecord* Library_record(int index) {
+    if (index < 0 || index >= current.count) return NULL;
+    return &current.records[index];
+}
+
+const char* Library_string(uint32_t offset) {
+    return map_string(&current, offset);
+}
+
+int Library_find(const char* path) {
+    return map_find(&current, path);
+}
+
+int Library_playlist(const char* path, const uint32_t** items) {
+    int i = map_find_playlist(&current, path);
+    struct stat st;
+    if (i < 0 || stat(path, &st) != 0 || current.playlists[i].mtime != (int64_t)st.st_mtime ||
+        current.playlists[i].size != (int64_t)st.st_size) {
+        return -1;
+    }
+    *items = &current.items[current.playlists[i].first_item];
+    return (int)current.playlists[i].item_count;
+}
+
+int Library_folder(const char* dir, int* first) {
+    char prefix[512];
+    int len = snprintf(prefix, sizeof(prefix), "%s/", dir);
+    *first = map_lower_bound(&current, current.records, sizeof(LibraryRecord), current.count, prefix);
+    int end = *first;
+    while (end < current.count && strncmp(Library_string(current.records[end].path), prefix, len) == 0) {
+        end++;
+    }
+    return end - *first;
+}
+
+bool Library_folderStats(const char* dir, LibraryFolderStats* stats) {
+    memset(stats, 0, sizeof(LibraryFolderStats));
+    int i = map_find_dir(&current, dir);
+    if (i < 0) return false;
+    const LibraryDirectory* d = &current.dirs[i];
+    stats->files = d->file_count;
+    stats->direct_files = d->direct_count;
+    stats->duration_ms = d->duration_ms;
+    stats->bytes = d->bytes;
+    stats->formats = d->formats;
+    stats->art = d->art;
+    return true;
+}
+
+// Plain substring scan, for queries too short for trigrams or without a search index
+static int search_substring(const char* query, int* results, int max_results) {
+    int count = 0;
+    for (int i = 0; i < current.count && count < max_results; i++) {
+        const LibraryRecord* r = &current.records[i];
+        if (strcasestr(Library_string(r->title), query) ||
+            strcasestr(Library_string(r->artist), query) ||
+            strcasestr(Library_string(r->album), query)) {
+            results[count++] = i;
+        }
+    }
+    return count;
+}
+
+typedef struct {
+    int index;
+    int rank;
+} SearchHit;
+
+static int compare_search_hits(const void* a, const void* b) {
+    const SearchHit* ha = (const SearchHit*)a;
+    const SearchHit* hb = (const SearchHit*)b;
+    if (ha->rank != hb->rank) return hb->rank - ha->rank;
+    return ha->index - hb->index;
+}
+
+int Library_search(const char* query, int* results, int max_results) {
+    if (!query || !query[0] || max_results <= 0) return 0;
+
+    int letters = 0;
+    for (const char* c = query; *c; c++) {
+        if ((unsigned char)*c >= 0x80 || isalnum((unsigned char)*c)) letters++;
+    }
+    if (!current.buckets || letters < 3) return search_substring(query, results, max_results);
+
+    char text[SEARCH_TEXT_MAX];
+    uint16_t hashes[SEARCH_TEXT_MAX];
+    int qn = search_trigrams(text, search_fold(query, text, sizeof(text), 0), hashes);
+
+    // Count the query trigrams each record shares, by walking their posting lists
+    uint16_t* scores = calloc(current.count, sizeof(uint16_t));
+    SearchHit* hits = malloc(sizeof(SearchHit) * (current.count ? current.count : 1));
+    if (!scores || !hits) {
+        free(scores);
+        free(hits);
+        return search_substring(query, results, max_results);
+    }
+    for (int q = 0; q < qn; q++) {
+        uint32_t start = current.buckets[hashes[q]];
+        uint32_t end = current.buckets[hashes[q] + 1];
+        if (end > current.posting_count) end = current.posting_count;
+        for (uint32_t p = start; p < end; p++) {
+            uint32_t r = current.postings[p];
+            if (r < (uint32_t)current.count) scores[r]++;
+        }
+    }
+
+    // Allow a typo per ten trigrams or so, but at least half must match
+    int need = qn - SEARCH_TYPO_TRIGRAMS * (1 + qn / 10);
+    if (need < (qn + 1) / 2) need = (qn + 1) / 2;
+    if (need < 1) need = 1;
+
+    int hit_count = 0;
+    for (int i = 0; i < current.count; i++) {
+        if (scores[i] < need) continue;
+        const LibraryRecord* r = &current.records[i];
+        int rank = scores[i] * 1000 / qn;
+        // Exact matches first, title matches before artist or album ones
+        if (strcasestr(Library_string(r->title), query)) {
+            rank += 300;
+        } else if (strcasestr(Library_string(r->artist), query) || strcasestr(Library_string(r->album), query)) {
+            rank += 200;
+        }
+        hits[hit_count].index = i;
+        hits[hit_count].rank = rank;
+        hit_count++;
+    }
+    qsort(hits, hit_count, sizeof(SearchHit), compare_search_hits);
+
+    int count = hit_count < max_results ? hit_count : max_results;
+    for (int i = 0; i < count; i++) results[i] = hits[i].index;
+    free(hits);
+    free(scores);
+    return count;
+}
+
+int Library_filter(const char* artist, const char* album, int* results, int max_results) {
+    int count = 0;
+    for (int i = 0; i < current.count && count < max_results; i++) {
+        const LibraryRecord* r = &current.records[i];
+        if (artist && strcasecmp(Library_string(r->artist), artist) != 0) continue;
+        if (album && strcasecmp(Library_string(r->album), album) != 0) continue;
+        results[count++] = i;
+    }
+    return count;
+}
+
+static int compare_string_offsets(const void* a, const void* b) {
+    return strcasecmp(Library_string(*(const uint32_t*)a), Library_string(*(const uint32_t*)b));
+}
+
+// Add offset to a list of distinct offsets (strings are stored once, so equal
+// strings have equal offsets)
+static int add_distinct(uint32_t* list, int count, int max, uint32_t offset) {
+    if (offset == 0 || count >= max) return count;
+    for (int i = count - 1; i >= 0; i--) {
+        if (list[i] == offset) return count;
+    }
+    list[count] = offset;
+    return count + 1;
+}
+
+int Library_artists(uint32_t* artists, int max_artists) {
+    int count = 0;
+    for (int i = 0; i < current.count; i++) {
+        count = add_distinct(artists, count, max_artists, current.records[i].artist);
+    }
+    qsort(artists, count, sizeof(uint32_t), compare_string_offsets);
+    return count;
+}
+
+int Library_albums(const char* artist, uint32_t* albums, int max_albums) {
+    int count = 0;
+    for (int i = 0; i < current.count; i++) {
+        if (artist && strcasecmp(Library_string(current.records[i].artist), artist) != 0) continue;
+        count = add_distinct(albums, count, max_albums, current.records[i].album);
+    }
+    qsort(albums, count, sizeof(uint32_t), compare_string_offsets);
+    return count;
+}
+
+int Library_random(void) {
+    return current.count > 0 ? rand() % current.count : -1;
+}
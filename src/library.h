@@ -0,0 +1,99 @@
+#ifndef __LIBRARY_H__
+#define __LIBRARY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Music library index
+// Tags of every audio file under the music folder and the items of its
+// playlists, kept in one binary file (header, records sorted by path, string
+// table) that is mapped read-only, so artist/album views, search, shuffle and
+// playlists never touch the SD card. A background scanner rebuilds it, reusing
+// the records of files whose mtime and size are unchanged. All functions are
+// for the main thread.
+
+// One indexed file; strings are offsets into the string table (see Library_string)
+typedef struct {
+    uint32_t path;
+    uint32_t title;
+    uint32_t artist;
+    uint32_t album;
+    int64_t mtime;
+    int64_t size;
+    uint32_t duration_ms;
+    float replaygain_db;        // Valid if has_replaygain
+    uint32_t art_offset;        // Embedded ID3 cover (0 = none)
+    uint32_t art_size;
+    uint8_t format;             // AudioFormat
+    uint8_t has_replaygain;
+    uint16_t reserved;
+} LibraryRecord;
+
+// Map the index if there is one and start a background scan of music_root
+void Library_init(const char* music_root);
+
+// Stop the scanner and unmap the index
+void Library_quit(void);
+
+// Call once per main loop iteration: picks up a finished scan
+// Returns true if the index changed (record indexes are invalidated).
+bool Library_update(void);
+
+// Rescan in the background (no-op while a scan is running)
+void Library_rescan(void);
+
+bool Library_isScanning(void);
+
+// Indexed files
+int Library_count(void);
+const LibraryRecord* Library_record(int index);
+
+// String of a record field, "" for untagged fields
+const char* Library_string(uint32_t offset);
+
+// Record of a path, or -1
+int Library_find(const char* path);
+
+// Items of a playlist file as written in it (see Playlist_resolve), if the index
+// has the file as it is now: sets *items to their string offsets and returns the
+// count, or -1 if the playlist has to be read from the card
+int Library_playlist(const char* path, const uint32_t** items);
+
+// Records inside dir and its subfolders: sets *first, returns the count
+// (paths sort together, so they are consecutive records)
+int Library_folder(const char* dir, int* first);
+
+// Totals of the audio files in a folder and its subfolders, kept in the index
+// per directory by the scanner, so a folder row shows them without a file read
+typedef struct {
+    uint32_t files;
+    uint32_t direct_files;      // Of them, directly inside the folder
+    uint64_t duration_ms;
+    uint64_t bytes;
+    uint16_t formats;           // 1 << AudioFormat of each format among them
+    uint32_t art;               // First of them with an embedded cover (path, see Library_string), 0 = none
+} LibraryFolderStats;
+
+// Totals of dir (no trailing slash); false (stats zeroed) if the index doesn't have it
+bool Library_folderStats(const char* dir, LibraryFolderStats* stats);
+
+// Records matching query, best first. Title, artist, album and file name are
+// matched by shared trigrams through the index's posting lists, so partial words
+// and a wrong letter still match; exact substrings rank highest. Queries with
+// fewer than 3 letters fall back to a substring scan.
+// Returns the number of matches written to results.
+int Library_search(const char* query, int* results, int max_results);
+
+// Records of an artist and/or album (NULL = any), in path order
+int Library_filter(const char* artist, const char* album, int* results, int max_results);
+
+// Distinct artists (string offsets) sorted by name
+int Library_artists(uint32_t* artists, int max_artists);
+
+// Distinct albums of an artist (NULL = all), sorted by name
+int Library_albums(const char* artist, uint32_t* albums, int max_albums);
+
+// Random record for library-wide shuffle, or -1 if the index is empty
+int Library_random(void);
+
+#endif
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "log_async.h"
+#include "thread_role.h"
+#include "defines.h"
+#include "api.h"
+
+#define SLOT_MASK (LOG_ASYNC_SLOTS - 1)
+
+// Bounded MPMC queue slot (Vyukov): seq == position when free for the producer at
+// it, position + 1 once filled for the consumer
+typedef struct {
+    uint32_t seq;
+    uint8_t level;              // LogAsyncLevel
+    uint32_t suppressed;        // Lines of the same call site throttled before this one
+    char text[LOG_ASYNC_LINE_MAX];
+} LogSlot;
+
+// Rate limit window of one call site (format string), updated without a lock:
+// a race miscounts a line or two, which is fine for a limit
+typedef struct {
+    const char* fmt;
+    uint32_t second;            // Window start, monotonic seconds
+    uint32_t count;             // Lines in the window
+    uint32_t suppressed;        // Throttled since the last line that got through
+} RateSite;
+
+static LogSlot slots[LOG_ASYNC_SLOTS];
+static uint32_t enqueue_pos = 0;
+static uint32_t dequeue_pos = 0;       // Drain thread only
+static uint32_t dropped = 0;
+static RateSite rate_sites[LOG_ASYNC_RATE_SITES];
+
+static bool running = false;
+static bool quit = false;
+static sem_t wake;
+static pthread_t drain_thread;
+
+static void write_line(int level, uint32_t suppressed, const char* text) {
+    // The note goes on the line itself, before its newline
+    int len = (int)strlen(text);
+    if (len > 0 && text[len - 1] == '\n') len--;
+    if (level == LOG_ASYNC_ERROR) {
+        if (suppressed) LOG_error("%.*s  (%u similar suppressed)\n", len, text, suppressed);
+        else LOG_error("%s", text);
+    } else {
+        if (suppressed) LOG_info("%.*s  (%u similar suppressed)\n", len, text, suppressed);
+        else LOG_info("%s", text);
+    }
+}
+
+// Whether a line from fmt may go out now; *suppressed gets the count throttled before it
+static bool rate_allow(const char* fmt, uint32_t* suppressed) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint32_t second = (uint32_t)ts.tv_sec;
+
+    RateSite* site = &rate_sites[((uintptr_t)fmt >> 3) % LOG_ASYNC_RATE_SITES];
+    if (__atomic_load_n(&site->fmt, __ATOMIC_RELAXED) != fmt) {
+        // Another call site had it: start over for this one
+        __atomic_store_n(&site->fmt, fmt, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->second, second, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_load_n(&site->second, __ATOMIC_RELAXED) != second) {
+        __atomic_store_n(&site->second, second, __ATOMIC_RELAXED);
+        __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+    }
+    if (__atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) > LOG_ASYNC_RATE_MAX) {
+        __atomic_add_fetch(&site->suppressed, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    *suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+    return true;
+}
+
+void Log_async(LogAsyncLevel level, const char* fmt, ...) {
+    uint32_t suppressed = 0;
+    if (!rate_allow(fmt, &suppressed)) return;
+
+    va_list args;
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        char text[LOG_ASYNC_LINE_MAX];
+        va_start(args, fmt);
+        vsnprintf(text, sizeof(text), fmt, args);
+        va_end(args);
+        write_line(level, suppressed, text);
+        return;
+    }
+
+    // Claim the slot at the tail, unless the drain hasn't freed it yet (full)
+    uint32_t pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+    LogSlot* slot;
+    for (;;) {
+        slot = &slots[pos & SLOT_MASK];
+        int32_t diff = (int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&enqueue_pos, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+        } else if (diff < 0) {
+            __atomic_add_fetch(&dropped, 1, __ATOMIC_RELAXED);
+            return;
+        } else {
+            pos = __atomic_load_n(&enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->level = (uint8_t)level;
+    slot->suppressed = suppressed;
+    va_start(args, fmt);
+    vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+    va_end(args);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+    sem_post(&wake);
+}
+
+// Hand the oldest filled slot to the logger; false if there is none
+static bool drain_one(void) {
+    LogSlot* slot = &slots[dequeue_pos & SLOT_MASK];
+    if ((int32_t)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) - (dequeue_pos + 1)) < 0) return false;
+    write_line(slot->level, slot->suppressed, slot->text);
+    __atomic_store_n(&slot->seq, dequeue_pos + LOG_ASYNC_SLOTS, __ATOMIC_RELEASE);
+    dequeue_pos++;
+    return true;
+}
+
+static void* drain_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+    uint32_t reported = 0;
+    for (;;) {
+        sem_wait(&wake);
+        bool stop = __atomic_load_n(&quit, __ATOMIC_ACQUIRE);
+        // Let a burst collect so it goes out as one batch
+        if (!stop) usleep(LOG_ASYNC_BATCH_MS * 1000);
+        // Take the posts of the lines about to be drained (before, so a line
+        // published during the drain still wakes the next round)
+        while (sem_trywait(&wake) == 0) {}
+        while (drain_one()) {}
+
+        uint32_t lost = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+        if (lost != reported) {
+            LOG_error("Log: %u lines dropped on a full ring\n", lost - reported);
+            reported = lost;
+        }
+        if (stop) break;
+    }
+    return NULL;
+}
+
+void Log_asyncInit(void) {
+    if (running) return;
+    for (uint32_t i = 0; i < LOG_ASYNC_SLOTS; i++) {
+        slots[i].seq = i;
+    }
+    enqueue_pos = dequeue_pos = 0;
+    if (sem_init(&wake, 0, 0) != 0) return;
+    quit = false;
+    if (pthread_create(&drain_thread, NULL, drain_func, NULL) != 0) {
+        sem_destroy(&wake);
+        return;
+    }
+    __atomic_store_n(&running, true, __ATOMIC_RELEASE);
+}
+
+void Log_asyncQuit(void) {
+    if (!running) return;
+    // Lines from here on are written directly; the drain empties the ring and stops
+    __atomic_store_n(&running, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&quit, true, __ATOMIC_RELEASE);
+    sem_post(&wake);
+    pthread_join(drain_thread, NULL);
+    sem_destroy(&wake);
+}
+
+uint32_t Log_asyncDropped(void) {
+    return __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,43 @@
+#ifndef __LOG_ASYNC_H__
+#define __LOG_ASYNC_H__
+
+#include <stdint.h>
+
+// Asynchronous logging for the decode, stream and network threads
+// LOG_error and LOG_info write the log file on the SD card before returning, which
+// can stall the caller for tens of milliseconds. LOG_ASYNC_error/info format into
+// a slot of a lock-free ring (multiple producers, one consumer) and return; a
+// background thread hands the lines to the regular logger in batches. A line finds
+// the ring full: it is dropped and counted. A call site that repeats faster than
+// LOG_ASYNC_RATE_MAX lines per second is throttled (approximately, per format
+// string), and its next line that gets through notes how many were suppressed.
+// Before Log_asyncInit and after Log_asyncQuit lines are logged synchronously.
+
+#define LOG_ASYNC_SLOTS 64              // Power of two
+#define LOG_ASYNC_LINE_MAX 200
+#define LOG_ASYNC_BATCH_MS 100          // The drain waits this long for more lines after a wake
+#define LOG_ASYNC_RATE_MAX 5            // Lines per second per call site
+#define LOG_ASYNC_RATE_SITES 64
+
+typedef enum {
+    LOG_ASYNC_ERROR,
+    LOG_ASYNC_INFO
+} LogAsyncLevel;
+
+// Start the drain thread (main thread, at startup)
+void Log_asyncInit(void);
+
+// Write out what is queued and stop the drain thread (main thread, at exit, once
+// the threads that log have stopped)
+void Log_asyncQuit(void);
+
+// Queue a line; never blocks. fmt must be a string literal (it keys the rate limit).
+void Log_async(LogAsyncLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Lines dropped on a full ring so far
+uint32_t Log_asyncDropped(void);
+
+#define LOG_ASYNC_error(...) Log_async(LOG_ASYNC_ERROR, __VA_ARGS__)
+#define LOG_ASYNC_info(...) Log_async(LOG_ASYNC_INFO, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include "defines.h"
+#include "api.h"
+#include "maintenance.h"
+#include "album_thumbs.h"
+#include "governor.h"
+#include "jobs.h"
+#include "library.h"
+#include "player.h"
+
+#define CHECKPOINT_MAGIC 0x544E4D4D     // "MMNT"
+#define CHECKPOINT_VERSION 1
+#define POWER_SUPPLY_DIR "/sys/class/power_supply"
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t cursor;                     // Next library record; Library_count() = compaction
+    uint32_t reserved;
+    int64_t pass_done;                  // time() the last pass ended, 0 = one is under way
+    int64_t last_rescan;                // time() of the last rescan a pass started
+    char path[512];                     // Record before the cursor, to find the place again
+} Checkpoint;
+
+// One step of a pass, owned by its job
+typedef struct {
+    bool compact;                       // Else maintain path
+    char path[512];
+    bool save;                          // Write next once done
+    bool written;                       // ...and it was
+    Checkpoint next;                    // Checkpoint after this step
+} MaintenanceStep;
+
+static Checkpoint checkpoint;
+static bool loaded = false;
+static bool dirty = false;              // checkpoint is ahead of the file
+static int steps_since_save = 0;
+static JobToken* token = NULL;          // Step in flight
+static bool active = false;             // Conditions met as of the last check
+static uint32_t last_check = 0;
+static bool was_screen_off = false;
+static uint32_t screen_off_at = 0;
+static char battery_dir[300];           // Empty: none found (or not looked for yet)
+static bool battery_searched = false;
+static unsigned long long last_total = 0, last_busy = 0, last_self = 0;
+
+static bool write_checkpoint(const Checkpoint* cp) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", MAINTENANCE_FILE);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) return false;
+    bool ok = fwrite(cp, sizeof(*cp), 1, f) == 1;
+    ok = fclose(f) == 0 && ok;
+    if (ok) ok = rename(tmp_path, MAINTENANCE_FILE) == 0;
+    if (!ok) unlink(tmp_path);
+    return ok;
+}
+
+static void load_checkpoint(void) {
+    loaded = true;
+    memset(&checkpoint, 0, sizeof(checkpoint));
+    FILE* f = fopen(MAINTENANCE_FILE, "rb");
+    if (f) {
+        Checkpoint cp;
+        if (fread(&cp, sizeof(cp), 1, f) == 1 && cp.magic == CHECKPOINT_MAGIC &&
+            cp.version == CHECKPOINT_VERSION && cp.cursor >= 0) {
+            cp.path[sizeof(cp.path) - 1] = '\0';
+            checkpoint = cp;
+        }
+        fclose(f);
+    }
+    checkpoint.magic = CHECKPOINT_MAGIC;
+    checkpoint.version = CHECKPOINT_VERSION;
+}
+
+// First line of a sysfs file
+static bool read_line(const char* path, char* out, int size) {
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    bool ok = fgets(out, size, f) != NULL;
+    fclose(f);
+    if (ok) out[strcspn(out, "\n")] = '\0';
+    return ok;
+}
+
+static void find_battery(void) {
+    battery_searched = true;
+    DIR* dir = opendir(POWER_SUPPLY_DIR);
+    if (!dir) return;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char path[300], type[32];
+        snprintf(path, sizeof(path), POWER_SUPPLY_DIR "/%s/type", ent->d_name);
+        if (read_line(path, type, sizeof(type)) && strcmp(type, "Battery") == 0) {
+            snprintf(battery_dir, sizeof(battery_dir), POWER_SUPPLY_DIR "/%s", ent->d_name);
+            break;
+        }
+    }
+    closedir(dir);
+}
+
+// On external power (charging, or full and plugged in) and the charge in percent
+// (-1 if unknown). No battery at all counts as powered.
+static bool read_power(int* capacity) {
+    if (!battery_searched) find_battery();
+    *capacity = -1;
+    if (!battery_dir[0]) return true;
+
+    char path[340], line[32];
+    snprintf(path, sizeof(path), "%s/capacity", battery_dir);
+    if (read_line(path, line, sizeof(line))) *capacity = atoi(line);
+    snprintf(path, sizeof(path), "%s/status", battery_dir);
+    return read_line(path, line, sizeof(line)) && (strcmp(line, "Charging") == 0 || strcmp(line, "Full") == 0);
+}
+
+// Share of all cores other processes kept busy since the last call (0 the first time)
+static float other_cpu_share(void) {
+    char line[256];
+    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal = 0;
+    if (!read_line("/proc/stat", line, sizeof(line)) ||
+        sscanf(line, "cpu %llu %llu %llu %llu %llu %llu %llu %llu", &user, &nice, &system, &idle,
+               &iowait, &irq, &softirq, &steal) < 7) {
+        return 0.0f;
+    }
+    unsigned long long total = user + nice + system + idle + iowait + irq + softirq + steal;
+    unsigned long long busy = total - idle - iowait;
+
+    // Our own threads (playback, the maintenance jobs) are left out: utime and stime,
+    // fields 14 and 15, counted after the parenthesised name
+    unsigned long long self = last_self;
+    char stat[512];
+    const char* name_end;
+    unsigned long long utime, stime;
+    if (read_line("/proc/self/stat", stat, sizeof(stat)) && (name_end = strrchr(stat, ')')) &&
+        sscanf(name_end + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) == 2) {
+        self = utime + stime;
+    }
+
+    float share = 0.0f;
+    if (last_total != 0 && total > last_total) {
+        long long other = (long long)(busy - last_busy) - (long long)(self - last_self);
+        share = other > 0 ? (float)other / (float)(total - last_total) : 0.0f;
+    }
+    last_total = total;
+    last_busy = busy;
+    last_self = self;
+    return share;
+}
+
+// Whether maintenance may run now; logs when that changes
+static bool conditions_met(bool screen_off, uint32_t now) {
+    int capacity;
+    bool powered = read_power(&capacity);
+    bool idle = screen_off && now - screen_off_at >= MAINTENANCE_IDLE_MS;
+    float cpu = other_cpu_share();
+
+    const char* reason = NULL;
+    if (!powered && !idle) reason = "in use on battery";
+    else if (!powered && capacity >= 0 && capacity < MAINTENANCE_BATTERY_MIN) reason = "battery low";
+    else if (cpu > MAINTENANCE_CPU_MAX) reason = "CPU busy";
+    else if (Governor_playbackStrained()) reason = "playback strained";
+
+    bool met = reason == NULL;
+    if (met != active) {
+        if (met) LOG_info("Maintenance: running (%s, record %d)\n", powered ? "charging" : "idle", checkpoint.cursor);
+        else LOG_info("Maintenance: paused (%s)\n", reason);
+    }
+    return met;
+}
+
+static void step_job(void* arg, JobToken* job_token) {
+    MaintenanceStep* step = (MaintenanceStep*)arg;
+    if (step->compact) {
+        int removed = Player_compactCaches(job_token);
+        if (!Jobs_cancelled(job_token)) LOG_info("Maintenance: pass done, %d stale cache entries deleted\n", removed);
+    } else {
+        Player_maintainFile(step->path, job_token);
+    }
+    if (step->save && !Jobs_cancelled(job_token)) step->written = write_checkpoint(&step->next);
+}
+
+static void start_step(void);
+
+static void step_done(void* arg, bool cancelled) {
+    MaintenanceStep* step = (MaintenanceStep*)arg;
+    Jobs_release(token);
+    token = NULL;
+    if (!cancelled) {
+        // A step cancelled midway is done again from the start
+        checkpoint = step->next;
+        dirty = !step->written;
+    }
+    free(step);
+    if (active && !cancelled) start_step();
+}
+
+// After a rescan the records move: find the cursor again from the path done last
+static void relocate_cursor(void) {
+    int count = Library_count();
+    if (checkpoint.cursor > count) checkpoint.cursor = count;
+    if (checkpoint.cursor == 0 || !checkpoint.path[0]) return;
+    const LibraryRecord* before = Library_record(checkpoint.cursor - 1);
+    if (before && strcmp(Library_string(before->path), checkpoint.path) == 0) return;
+    int found = Library_find(checkpoint.path);
+    if (found >= 0) checkpoint.cursor = found + 1;
+}
+
+// Post the next step of the pass, if there is one
+static void start_step(void) {
+    if (token || Library_isScanning()) return;
+    int64_t now = (int64_t)time(NULL);
+    if (checkpoint.pass_done != 0) {
+        if (now - checkpoint.pass_done < MAINTENANCE_PASS_SECONDS) return;
+        // A new pass, over a freshly scanned library
+        checkpoint.pass_done = 0;
+        checkpoint.cursor = 0;
+        checkpoint.path[0] = '\0';
+        dirty = true;
+        if (now - checkpoint.last_rescan >= MAINTENANCE_PASS_SECONDS) {
+            checkpoint.last_rescan = now;
+            Library_rescan();
+            return;
+        }
+    }
+    relocate_cursor();
+
+    MaintenanceStep* step = calloc(1, sizeof(MaintenanceStep));
+    if (!step) return;
+    step->next = checkpoint;
+    int count = Library_count();
+    if (checkpoint.cursor < count) {
+        const LibraryRecord* record = Library_record(checkpoint.cursor);
+        if (!record) {
+            free(step);
+            return;
+        }
+        snprintf(step->path, sizeof(step->path), "%s", Library_string(record->path));
+        snprintf(step->next.path, sizeof(step->next.path), "%s", step->path);
+        step->next.cursor = checkpoint.cursor + 1;
+        // An album's first track stands for it in the thumbnail file
+        int first;
+        if (record->album && Library_filter(NULL, Library_string(record->album), &first, 1) == 1 &&
+            first == checkpoint.cursor) {
+            AlbumThumbs_prepare(record->album);
+        }
+        step->save = dirty || ++steps_since_save >= MAINTENANCE_CHECKPOINT_FILES;
+    } else {
+        step->compact = true;
+        step->next.cursor = 0;
+        step->next.path[0] = '\0';
+        step->next.pass_done = now;
+        step->save = true;
+    }
+    if (step->save) steps_since_save = 0;
+
+    token = Jobs_submit(JOB_PRIORITY_IDLE, step_job, step_done, step);
+    if (!token) free(step);
+}
+
+void Maintenance_update(bool screen_off) {
+    uint32_t now = SDL_GetTicks();
+    if (screen_off && !was_screen_off) screen_off_at = now;
+    was_screen_off = screen_off;
+    if (last_check != 0 && now - last_check < MAINTENANCE_INTERVAL_MS) return;
+    last_check = now;
+    if (!loaded) load_checkpoint();
+
+    bool met = conditions_met(screen_off, now);
+    active = met;
+    if (!met) {
+        if (token) Jobs_cancel(token);
+        AlbumThumbs_cancelPrepares();
+        return;
+    }
+    start_step();
+}
+
+void Maintenance_quit(void) {
+    active = false;
+    if (token) Jobs_cancel(token);
+    AlbumThumbs_cancelPrepares();
+    if (loaded && dirty && write_checkpoint(&checkpoint)) dirty = false;
+}
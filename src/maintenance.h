@@ -0,0 +1,35 @@
+#ifndef __MAINTENANCE_H__
+#define __MAINTENANCE_H__
+
+#include <stdbool.h>
+
+// Idle-time maintenance
+// Work that only makes later use faster is done when nobody would notice: while
+// the device is charging, or once the screen has been off for MAINTENANCE_IDLE_MS.
+// A pass walks the library index a file at a time on an idle job (SCHED_IDLE,
+// off the audio core), building what the file's first play or the album grid
+// would otherwise build: its seek index, loudness measurement and waveform
+// overview, and the album thumbnail of an album's first track. It ends by
+// deleting cache entries of files that are gone, and the next pass starts
+// MAINTENANCE_PASS_SECONDS later with a library rescan. Nothing starts on
+// battery below MAINTENANCE_BATTERY_MIN, while other processes keep more than
+// MAINTENANCE_CPU_MAX of the CPU busy, or while playback's buffer is strained;
+// when a condition goes, the file in progress is cancelled. Where the pass is
+// is checkpointed to MAINTENANCE_FILE every MAINTENANCE_CHECKPOINT_FILES files,
+// by path so a rescan doesn't lose the place, and resumed in the next session.
+
+#define MAINTENANCE_FILE SHARED_USERDATA_PATH "/maintenance.bin"
+#define MAINTENANCE_INTERVAL_MS 5000            // Conditions checked this often
+#define MAINTENANCE_IDLE_MS (60 * 1000)         // Screen off this long is idle
+#define MAINTENANCE_BATTERY_MIN 40              // Percent, when not charging
+#define MAINTENANCE_CPU_MAX 0.25f               // Other processes' share of all cores
+#define MAINTENANCE_CHECKPOINT_FILES 16
+#define MAINTENANCE_PASS_SECONDS (24 * 60 * 60)
+
+// Call once per main loop iteration
+void Maintenance_update(bool screen_off);
+
+// Cancel the file in progress and save the checkpoint (before Jobs_quit)
+void Maintenance_quit(void);
+
+#endif
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "defines.h"
+#include "api.h"
+#include "mem_pressure.h"
+#include "memstats.h"
+#include "player.h"
+#include "radio_album_art.h"
+#include "text_cache.h"
+#include "screen_cache.h"
+#include "youtube_thumbs.h"
+
+// Shed stages, each including the ones before it
+typedef enum {
+    SHED_NONE,
+    SHED_THUMBS,
+    SHED_TEXT,
+    SHED_ART,
+    SHED_PREFETCH
+} ShedStage;
+
+static uint32_t last_check = 0;
+static uint32_t last_shed = 0;
+static ShedStage last_stage = SHED_NONE;
+static bool psi_missing = false;        // Kernel without PSI: stop trying
+
+// Read a small /proc file into buffer (NUL-terminated); false if it can't be read
+static bool read_proc(const char* path, char* buffer, size_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    ssize_t n = read(fd, buffer, size - 1);
+    close(fd);
+    if (n <= 0) return false;
+    buffer[n] = '\0';
+    return true;
+}
+
+// MemAvailable in KB, -1 if unknown
+static long available_kb(void) {
+    char buffer[2048];
+    if (!read_proc("/proc/meminfo", buffer, sizeof(buffer))) return -1;
+    const char* line = strstr(buffer, "MemAvailable:");
+    return line ? strtol(line + strlen("MemAvailable:"), NULL, 10) : -1;
+}
+
+// Share of the last 10 s some task stalled on memory, in percent (0 without PSI)
+static float stall_percent(void) {
+    if (psi_missing) return 0.0f;
+    char buffer[256];
+    if (!read_proc("/proc/pressure/memory", buffer, sizeof(buffer))) {
+        psi_missing = true;
+        return 0.0f;
+    }
+    const char* avg = strstr(buffer, "some avg10=");
+    return avg ? strtof(avg + strlen("some avg10="), NULL) : 0.0f;
+}
+
+static ShedStage stage_for(long available, float stall) {
+    long mb = available / 1024;
+    ShedStage stage = mb < MEM_PRESSURE_PREFETCH_MB ? SHED_PREFETCH
+                    : mb < MEM_PRESSURE_ART_MB ? SHED_ART
+                    : mb < MEM_PRESSURE_TEXT_MB ? SHED_TEXT
+                    : mb < MEM_PRESSURE_THUMBS_MB ? SHED_THUMBS
+                    : SHED_NONE;
+    if (stall >= MEM_PRESSURE_PSI_STALL && stage < SHED_PREFETCH) stage++;
+    return stage;
+}
+
+// Shed every stage up to stage, logging what went
+static void shed(ShedStage stage, long available, float stall) {
+    char report[256];
+    int len = snprintf(report, sizeof(report), "MemPressure: %ld MB available, %.1f%% stalled: shed",
+                       available / 1024, stall);
+
+    size_t thumbs = YouTubeThumbs_shed();
+    len += snprintf(report + len, sizeof(report) - len, " thumbnails %zu KB", thumbs / 1024);
+    if (stage >= SHED_TEXT) {
+        size_t text = TextCache_clear() + ScreenCache_clear();
+        len += snprintf(report + len, sizeof(report) - len, ", text %zu KB", text / 1024);
+    }
+    if (stage >= SHED_ART) {
+        size_t art = radio_album_art_cacheShed();
+        len += snprintf(report + len, sizeof(report) - len, ", art %zu KB", art / 1024);
+    }
+    if (stage >= SHED_PREFETCH) {
+        int tracks = Player_shedPrefetch();
+        snprintf(report + len, sizeof(report) - len, ", prefetch %d tracks", tracks);
+    }
+    LOG_info("%s\n", report);
+#ifdef MEM_STATS
+    MemStats_log();
+#endif
+}
+
+void MemPressure_update(void) {
+    uint32_t now = SDL_GetTicks();
+    if (last_check != 0 && now - last_check < MEM_PRESSURE_INTERVAL_MS) return;
+    last_check = now;
+
+    long available = available_kb();
+    if (available < 0) return;
+    float stall = stall_percent();
+    ShedStage stage = stage_for(available, stall);
+
+    if (stage == SHED_NONE) {
+        if (last_stage != SHED_NONE) LOG_info("MemPressure: %ld MB available, relieved\n", available / 1024);
+        last_stage = SHED_NONE;
+        return;
+    }
+    // Worse than at the last shed, or the caches have had time to refill
+    if (stage > last_stage || now - last_shed >= MEM_PRESSURE_RESHED_MS) {
+        shed(stage, available, stall);
+        last_shed = now;
+    }
+    last_stage = stage;
+}
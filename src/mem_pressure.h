@@ -0,0 +1,29 @@
+#ifndef __MEM_PRESSURE_H__
+#define __MEM_PRESSURE_H__
+
+// Memory pressure governor
+// The app shares the device's memory with the launcher and whatever else runs,
+// and its caches only ever grow to their budgets. Every MEM_PRESSURE_INTERVAL_MS
+// the governor reads MemAvailable from /proc/meminfo and, where the kernel has
+// PSI, the share of time tasks stalled on memory (/proc/pressure/memory). The
+// lower the available memory, the more caches are shed, cheapest to rebuild
+// first: off-screen thumbnails, then rendered text and screens, then decoded
+// covers, then the prefetched tracks. A stall share over MEM_PRESSURE_PSI_STALL
+// sheds one stage further. Playback buffers, the open decoder and the queued
+// next track are never touched. The caches refill as they are used, so while
+// pressure lasts they are shed again every MEM_PRESSURE_RESHED_MS, and at once
+// when it gets worse. Every shed is logged with what it freed (and, in MEM_STATS
+// builds, the per-tag accounting after it) so the budgets can be tuned.
+
+#define MEM_PRESSURE_INTERVAL_MS 2000
+#define MEM_PRESSURE_RESHED_MS 30000
+#define MEM_PRESSURE_THUMBS_MB 96       // MemAvailable below which each stage is shed
+#define MEM_PRESSURE_TEXT_MB 64
+#define MEM_PRESSURE_ART_MB 48
+#define MEM_PRESSURE_PREFETCH_MB 32
+#define MEM_PRESSURE_PSI_STALL 10.0f    // "some" avg10, percent
+
+// Call once per main loop iteration (main thread: the text caches are shed here)
+void MemPressure_update(void);
+
+#endif
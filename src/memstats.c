@@ -0,0 +1,80 @@
+#ifdef MEM_STATS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "defines.h"
+#include "api.h"
+#include "memstats.h"
+
+static const char* tag_names[MEM_TAG_COUNT] = {
+    "player_buf", "readahead", "radio_ring", "radio_stream", "hls", "record",
+    "album_art", "art_cache", "background", "scroll_text", "curated", "browser", "stations", "thumbs", "screens"
+};
+
+static int64_t tag_current[MEM_TAG_COUNT];
+static int64_t tag_peak[MEM_TAG_COUNT];
+static uint32_t tag_allocs[MEM_TAG_COUNT];
+
+void MemStats_add(MemTag tag, int64_t bytes) {
+    if (tag < 0 || tag >= MEM_TAG_COUNT || bytes == 0) return;
+    int64_t current = __atomic_add_fetch(&tag_current[tag], bytes, __ATOMIC_RELAXED);
+    if (bytes < 0) return;
+    __atomic_add_fetch(&tag_allocs[tag], 1, __ATOMIC_RELAXED);
+    int64_t peak = __atomic_load_n(&tag_peak[tag], __ATOMIC_RELAXED);
+    while (current > peak &&
+           !__atomic_compare_exchange_n(&tag_peak[tag], &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void* MemStats_malloc(MemTag tag, size_t size) {
+    void* ptr = malloc(size);
+    if (ptr) MemStats_add(tag, (int64_t)malloc_usable_size(ptr));
+    return ptr;
+}
+
+void* MemStats_calloc(MemTag tag, size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr) MemStats_add(tag, (int64_t)malloc_usable_size(ptr));
+    return ptr;
+}
+
+void* MemStats_realloc(MemTag tag, void* ptr, size_t size) {
+    int64_t old = ptr ? (int64_t)malloc_usable_size(ptr) : 0;
+    void* grown = realloc(ptr, size);
+    if (grown) MemStats_add(tag, (int64_t)malloc_usable_size(grown) - old);
+    return grown;
+}
+
+void MemStats_free(MemTag tag, void* ptr) {
+    if (!ptr) return;
+    MemStats_add(tag, -(int64_t)malloc_usable_size(ptr));
+    free(ptr);
+}
+
+void MemStats_get(MemTagStats stats[MEM_TAG_COUNT]) {
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        stats[i].name = tag_names[i];
+        stats[i].current = __atomic_load_n(&tag_current[i], __ATOMIC_RELAXED);
+        stats[i].peak = __atomic_load_n(&tag_peak[i], __ATOMIC_RELAXED);
+        stats[i].allocs = __atomic_load_n(&tag_allocs[i], __ATOMIC_RELAXED);
+    }
+}
+
+void MemStats_log(void) {
+    MemTagStats stats[MEM_TAG_COUNT];
+    MemStats_get(stats);
+    char line[512];
+    int used = snprintf(line, sizeof(line), "mem KB now/peak:");
+    int64_t total = 0;
+    for (int i = 0; i < MEM_TAG_COUNT && used < (int)sizeof(line); i++) {
+        used += snprintf(line + used, sizeof(line) - used, " %s %lld/%lld", stats[i].name,
+                         (long long)(stats[i].current / 1024), (long long)(stats[i].peak / 1024));
+        total += stats[i].current;
+    }
+    LOG_info("%s | total %lldKB\n", line, (long long)(total / 1024));
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __MEMSTATS_H__
+#define __MEMSTATS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Per-subsystem memory accounting (MEM_STATS builds: make MEM_STATS=1)
+// The big owners of memory allocate through the MEM_* macros under a tag; each
+// tag counts the bytes it holds now and its high-water mark. Heap blocks count
+// at their usable size, and MEM_FREE always subtracts that size: a block has to be
+// allocated and freed through the macros under the same tag, or the counts drift.
+// Surfaces made by SDL are counted where their owner takes or drops them, with
+// MEM_SURFACE_ADD/SUB. Without MEM_STATS the macros are the plain calls. Any thread.
+
+typedef enum {
+    MEM_TAG_PLAYER_BUFFER,      // Decoded audio ahead of the callback
+    MEM_TAG_READAHEAD,          // Compressed file data ahead of the decoders
+    MEM_TAG_RADIO_RING,         // Radio network and audio rings
+    MEM_TAG_RADIO_STREAM,       // Radio decoder input buffer
+    MEM_TAG_HLS,                // HLS segment and prefetch slots
+    MEM_TAG_RECORD,             // Radio recording ring
+    MEM_TAG_ALBUM_ART,          // Covers shown or ready to show
+    MEM_TAG_ART_CACHE,          // Decoded covers kept for reuse
+    MEM_TAG_BACKGROUND,         // Blurred cover backgrounds
+    MEM_TAG_SCROLL_TEXT,        // Pre-rendered scrolling titles
+    MEM_TAG_CURATED,            // Curated station index
+    MEM_TAG_BROWSER,            // Folder listings and their cache
+    MEM_TAG_STATIONS,           // User station list and its strings
+    MEM_TAG_THUMBS,             // Album grid atlas and index, YouTube result thumbnails
+    MEM_TAG_SCREENS,            // Static screens kept rendered
+    MEM_TAG_COUNT
+} MemTag;
+
+#ifdef MEM_STATS
+
+typedef struct {
+    const char* name;
+    int64_t current;            // Bytes held now
+    int64_t peak;               // Since start
+    uint32_t allocs;            // Blocks and surfaces taken since start
+} MemTagStats;
+
+void* MemStats_malloc(MemTag tag, size_t size);
+void* MemStats_calloc(MemTag tag, size_t count, size_t size);
+void* MemStats_realloc(MemTag tag, void* ptr, size_t size);
+void MemStats_free(MemTag tag, void* ptr);
+
+// Count bytes allocated elsewhere (negative: released)
+void MemStats_add(MemTag tag, int64_t bytes);
+
+void MemStats_get(MemTagStats stats[MEM_TAG_COUNT]);
+
+// One log line with every tag's current/peak KB
+void MemStats_log(void);
+
+#define MEM_MALLOC(tag, size) MemStats_malloc(tag, size)
+#define MEM_CALLOC(tag, count, size) MemStats_calloc(tag, count, size)
+#define MEM_REALLOC(tag, ptr, size) MemStats_realloc(tag, ptr, size)
+#define MEM_FREE(tag, ptr) MemStats_free(tag, ptr)
+#define MEM_SURFACE_BYTES(surface) ((surface) ? (int64_t)(surface)->pitch * (surface)->h : 0)
+#define MEM_SURFACE_ADD(tag, surface) MemStats_add(tag, MEM_SURFACE_BYTES(surface))
+#define MEM_SURFACE_SUB(tag, surface) MemStats_add(tag, -MEM_SURFACE_BYTES(surface))
+
+#else
+
+#define MEM_MALLOC(tag, size) malloc(size)
+#define MEM_CALLOC(tag, count, size) calloc(count, size)
+#define MEM_REALLOC(tag, ptr, size) realloc(ptr, size)
+#define MEM_FREE(tag, ptr) free(ptr)
+#define MEM_SURFACE_ADD(tag, surface) ((void)0)
+#define MEM_SURFACE_SUB(tag, surface) ((void)0)
+
+#endif
+
+#endif
@@ -18,8 +18,28 @@
 #include "spectrum.h"
 #include "radio.h"
 #include "radio_album_art.h"
+#include "radio_catalog.h"
+#include "radio_net.h"
 #include "youtube.h"
 #include "selfupdate.h"
+#include "governor.h"
+#include "mem_pressure.h"
+#include "maintenance.h"
+#include "thread_role.h"
+#include "library.h"
+#include "album_thumbs.h"
+#include "youtube_thumbs.h"
+#include "shuffle.h"
+#include "queue.h"
+#include "track_meta.h"
+#include "session.h"
+#include "settings.h"
+#include "bookmarks.h"
+#include "log_async.h"
+#include "jobs.h"
+#include "netjobs.h"
+#include "net_prewarm.h"
+#include "youtube_search.h"
 
 // UI modules
 #include "ui_fonts.h"
@@ -31,11 +51,18 @@
 #include "ui_radio.h"
 #include "ui_youtube.h"
 #include "ui_system.h"
+#include "profile.h"
+#include "trace.h"
+#include "latency.h"
+#include "memstats.h"
+#include "energy.h"
 
 // App states
 typedef enum {
     STATE_MENU = 0,         // Main menu (Files / Radio / YouTube / Settings)
     STATE_BROWSER,          // File browser
+    STATE_LIBRARY_RESULTS,  // Library search results
+    STATE_ALBUM_GRID,       // Album covers from the library index
     STATE_PLAYING,          // Playing local file
     STATE_RADIO_LIST,       // Radio station list
     STATE_RADIO_PLAYING,    // Playing radio stream
@@ -58,7 +85,7 @@ typedef enum {
 #define MENU_ITEM_COUNT 4
 
 // YouTube menu count (youtube_menu_items moved to ui_youtube.c)
-#define YOUTUBE_MENU_COUNT 3
+#define YOUTUBE_MENU_COUNT 5
 
 // YouTube state
 static int youtube_menu_selected = 0;
@@ -71,9 +98,26 @@ static int youtube_result_count = 0;
 static bool youtube_searching = false;
 static char youtube_search_query[256] = "";
 static char youtube_toast_message[128] = "";
+static char youtube_stream_id[YOUTUBE_VIDEO_ID_LEN] = "";  // Result playing with play now
+static bool youtube_stream_playing = false;     // Player is on the play now file
 static uint32_t youtube_toast_time = 0;
 #define YOUTUBE_TOAST_DURATION 1500  // 1.5 seconds
 
+// Library search state
+#define LIBRARY_MAX_RESULTS 200
+static int library_results[LIBRARY_MAX_RESULTS];
+static int library_result_count = 0;
+static int library_results_selected = 0;
+static int library_results_scroll = 0;
+static char library_search_query[256] = "";
+
+// Album grid state (string offsets of album names)
+#define ALBUM_GRID_MAX 4096
+static uint32_t album_grid[ALBUM_GRID_MAX];
+static int album_grid_count = 0;
+static int album_grid_selected = 0;
+static int album_grid_scroll = 0;  // In rows
+
 // Global state
 static bool quit = false;
 static AppState app_state = STATE_MENU;
@@ -89,9 +133,28 @@ static int add_country_scroll = 0;
 static int add_station_selected = 0;
 static int add_station_scroll = 0;
 static const char* add_selected_country_code = NULL;
-static bool add_station_checked[256];  // Track selected stations for adding
+static bool* add_station_checked = NULL;  // Per station of the country, not per filtered row
+static int add_station_count = 0;         // Stations of the country
+static int add_station_rows = 0;          // Rows matching the filter
+static char add_station_query[64] = "";   // Station filter ("" = all)
+static uint32_t add_probe_generation = 0;  // Probe results shown on the station list
+static int add_probe_first = -1;           // First row of the window last probed
+#define ADD_PROBE_WINDOW 32                // Rows probed around the selection
 static int help_scroll = 0;  // Scroll position for help page
 
+// Redraw requests: dirty = 1 redraws the screen; a selection moved within a list
+// ORs in DIRTY_SELECTION, and a frame with nothing else only repaints its rows
+#define DIRTY_SELECTION 2
+
+// Main loop sleep when nothing is drawn or animating (see idle_timeout_ms)
+#define IDLE_POLL_MS 250
+#define IDLE_ACTIVE_MS 50       // While playback, radio or a YouTube job runs
+#define SCREEN_OFF_POLL_MS 1000 // Screen off: nothing to draw, audio runs on its own threads
+#define SCREEN_OFF_RADIO_MS 250 // Screen off with the radio on (rebuffering is noticed here)
+
+// Frames a redraw may be put off in a row for input that arrived meanwhile
+#define RENDER_DEFER_MAX 3
+
 // Screen off mode (screen off but audio keeps playing)
 static bool screen_off = false;
 static bool autosleep_disabled = false;
@@ -103,10 +166,26 @@ static bool show_quit_confirm = false;
 // Shuffle and repeat modes
 static bool shuffle_enabled = false;
 static bool repeat_enabled = false;
+static int loop_a_ms = -1;  // A point marked for an A-B loop, ms into the track (-1 = none)
 
 // Music folder
 #define MUSIC_PATH SDCARD_PATH "/Music"
 
+// Stop play now of a YouTube result and its playback
+static void youtube_stream_stop(void) {
+    YouTube_streamStop();
+    Player_endGrowingFile();
+    if (youtube_stream_playing) {
+        Player_stop();
+        youtube_stream_playing = false;
+        if (autosleep_disabled) {
+            PWR_enableAutosleep();
+            autosleep_disabled = false;
+        }
+    }
+    youtube_stream_id[0] = '\0';
+}
+
 static void sigHandler(int sig) {
     switch (sig) {
     case SIGINT:
@@ -118,31 +197,686 @@ static void sigHandler(int sig) {
     }
 }
 
+// Queue the folder's files for the background loudness scan (used for normalization)
+static void scan_directory_loudness(void) {
+    if (!Player_getNormalization()) return;
+
+    // Entries only store names, build the paths in one block
+    size_t dir_len = strlen(browser.current_path) + 1;
+    size_t bytes = 0;
+    for (int i = 0; i < browser.entry_count; i++) {
+        bytes += dir_len + strlen(Browser_string(&browser, browser.entries[i].file)) + 1;
+    }
+    const char** paths = malloc(browser.entry_count * sizeof(const char*));
+    char* block = malloc(bytes > 0 ? bytes : 1);
+    if (!paths || !block) {
+        free(paths);
+        free(block);
+        return;
+    }
+    int count = 0;
+    char* p = block;
+    for (int i = browser.audio_start; i < browser.entry_count; i++) {
+        const FileEntry* entry = &browser.entries[i];
+        // Cue tracks of one file are listed next to each other
+        if (count > 0 && Browser_isSameFile(&browser, entry, &browser.entries[i - 1])) {
+            continue;
+        }
+        Browser_getPath(&browser, entry, p, (int)(bytes - (p - block)));
+        paths[count++] = p;
+        p += strlen(p) + 1;
+    }
+    Player_scanLoudness(paths, count);
+    free(block);
+    free(paths);
+}
+
+// Tracks being played: the audio files of the browser folder, or the play queue
+// while one is open. Tracks are numbered from 0 in both.
+static int track_count(void) {
+    return Queue_isActive() ? Queue_count() : Browser_countAudioFiles(&browser);
+}
+
+// Playing track, -1 if none
+static int current_track(void) {
+    return Queue_isActive() ? Queue_position() : browser.selected - browser.audio_start;
+}
+
+// Browser entry of a track (NULL when playing a queue)
+static const FileEntry* track_entry(int track) {
+    if (Queue_isActive() || track < 0 || track >= track_count()) return NULL;
+    return &browser.entries[browser.audio_start + track];
+}
+
+static void track_path(int track, char* out, int max_len) {
+    const FileEntry* entry = track_entry(track);
+    if (entry) {
+        Browser_getPath(&browser, entry, out, max_len);
+    } else {
+        Queue_getPath(track, out, max_len);
+    }
+}
+
+static void track_region(int track, TrackRegion* region) {
+    const FileEntry* entry = track_entry(track);
+    if (entry) {
+        Browser_getRegion(&browser, entry, region);
+    } else {
+        memset(region, 0, sizeof(TrackRegion));
+    }
+}
+
+// Make a track the current one, following it in the shuffle order
+static void set_current_track(int track) {
+    if (Queue_isActive()) {
+        Queue_setPosition(track);
+    } else {
+        browser.selected = browser.audio_start + track;
+    }
+    Shuffle_setCurrent(track);
+}
+
 // Helper function to load directory using Browser module
 static void load_directory(const char* path) {
     Browser_loadDirectory(&browser, path, MUSIC_PATH);
+    // Browsing ends a play queue, the folder is what plays next
+    Queue_close();
+    Shuffle_reset(Browser_countAudioFiles(&browser), -1);
+    scan_directory_loudness();
+}
+
+// Gapless playback: queue the next track this long before the current one ends
+#define GAPLESS_QUEUE_AHEAD_MS 20000
+
+// Track queued with Player_queueNext (-1 if none) and its path, to find it again
+// if the play queue is rebuilt
+static int queued_track = -1;
+static char queued_path[512] = "";
+
+// Pick the track to play after the current one (repeat / shuffle / next in order)
+// Returns the track or -1 if there is no next track
+static int pick_next_track(void) {
+    int current = current_track();
+    if (repeat_enabled && current >= 0) {
+        // Repeat current track
+        return current;
+    }
+
+    if (shuffle_enabled) {
+        return Shuffle_peekNext();
+    }
+
+    // Normal: advance to next track
+    return current + 1 < track_count() ? current + 1 : -1;
+}
+
+// Have the player open the tracks that can come next: the end-of-track pick first,
+// then the following ones in order (NEXT button)
+static void prefetch_upcoming(void) {
+    char path_buf[PLAYER_PREFETCH_MAX][512];
+    const char* paths[PLAYER_PREFETCH_MAX];
+    int count = 0;
+    char current_path[512];
+    track_path(current_track(), current_path, sizeof(current_path));
+
+    int candidate = pick_next_track();
+    int i = current_track() + 1;
+    int total = track_count();
+    while (count < PLAYER_PREFETCH_MAX) {
+        if (candidate < 0) {
+            if (i >= total) break;
+            candidate = i++;
+        }
+        track_path(candidate, path_buf[count], sizeof(path_buf[count]));
+        candidate = -1;
+
+        // Cue tracks of the playing file (and repeat) need no open
+        if (!path_buf[count][0] || strcmp(path_buf[count], current_path) == 0) continue;
+        bool listed = false;
+        for (int j = 0; j < count && !listed; j++) {
+            listed = strcmp(paths[j], path_buf[count]) == 0;
+        }
+        if (!listed) {
+            paths[count] = path_buf[count];
+            count++;
+        }
+    }
+    Player_prefetch(paths, count);
+}
+
+// Scrubbing: Left/Right move a target the now playing view previews on the
+// waveform, the seek happens once on release (-1 = not scrubbing)
+static int scrub_target_ms = -1;
+static int scrub_shown_ms = -1;
+
+static void scrub_cancel(void) {
+    if (scrub_target_ms < 0) return;
+    scrub_target_ms = -1;
+    scrub_shown_ms = -1;
+    Player_previewSeek(-1);
+}
+
+// Resume points of long files: the one playing is sampled every BOOKMARK_SAVE_MS
+// (and when it is left), filed with the seek hint asked for at the last sample
+static uint32_t bookmark_sampled_at = 0;
+
+static void bookmark_update(void) {
+    PlayerState state = Player_getState();
+    if (state != PLAYER_STATE_PLAYING && state != PLAYER_STATE_PAUSED) return;
+    const FileEntry* entry = track_entry(current_track());
+    char path[512];
+    track_path(current_track(), path, sizeof(path));
+    int duration = Player_getDuration();
+    if (!entry || entry->cue_track || duration < BOOKMARK_MIN_DURATION_MS ||
+        strcmp(Player_getCurrentFile(), path) != 0) {
+        return;
+    }
+    bookmark_sampled_at = SDL_GetTicks();
+
+    // Near either end there is nothing to resume
+    int position = Player_getPosition();
+    if (position < BOOKMARK_END_MS || position >= duration - BOOKMARK_END_MS) {
+        Bookmarks_clear(path);
+        return;
+    }
+
+    // A hint from before a seek back would land past the position
+    int hint_ms;
+    SeekHint hint;
+    bool hinted = Player_takeSeekHint(&hint_ms, &hint) && hint_ms <= position;
+    Bookmarks_set(path, position, hinted ? &hint : NULL);
+    Player_requestSeekHint(position);
+}
+
+// Play a track. Cue tracks of the file already playing only seek,
+// everything else loads asynchronously (a long file from its bookmark).
+// Returns 0 if playback is starting.
+static int play_track(int track) {
+    const FileEntry* entry = track_entry(track);
+    TrackRegion region;
+    track_region(track, &region);
+    char path[512];
+    track_path(track, path, sizeof(path));
+
+    bookmark_update();  // Where the track being left was
+    queued_track = -1;
+    loop_a_ms = -1;
+    set_current_track(track);
+    scrub_cancel();
+
+    int result = 0;
+    PlayerState state = Player_getState();
+    if (entry && entry->cue_track && (state == PLAYER_STATE_PLAYING || state == PLAYER_STATE_PAUSED) &&
+        !Player_hasQueuedNext() && strcmp(Player_getCurrentFile(), path) == 0) {
+        Player_setRegion(&region);
+        Player_seek(0);
+        if (state == PLAYER_STATE_PAUSED) Player_play();
+    } else {
+        Bookmark bookmark;
+        if (entry && !entry->cue_track && Bookmarks_get(path, &bookmark)) {
+            result = Player_loadAsyncResume(path, bookmark.position_ms, &bookmark.hint);
+        } else {
+            result = Player_loadAsyncRegion(path, &region, true);
+        }
+    }
+    prefetch_upcoming();
+    return result;
+}
+
+// Play a file of the browser folder, leaving the play queue if one was playing
+static int play_entry(int index) {
+    if (Queue_isActive()) {
+        Queue_close();
+        Shuffle_reset(Browser_countAudioFiles(&browser), -1);
+    }
+    return play_track(index - browser.audio_start);
+}
+
+// Play a library scope from start_path (NULL = from the start, or anywhere when shuffling)
+// Returns 0 if playback is starting, -1 if the scope has no indexed tracks.
+static int play_queue(QueueScope scope, const char* key, const char* start_path) {
+    if (Queue_open(scope, key) == 0) return -1;
+    int start = start_path ? Queue_find(start_path) : -1;
+    Shuffle_reset(Queue_count(), start);
+    if (start < 0) start = shuffle_enabled ? Shuffle_peekNext() : 0;
+    return play_track(start);
+}
+
+// Load and play the next track after the current one stopped
+// Returns true if a new track is loading
+static bool advance_track(void) {
+    queued_track = -1;
+    int next = pick_next_track();
+    if (next < 0) return false;
+
+    return play_track(next) == 0;
+}
+
+// Move on when playback passes the end of a cue track. The next track of the
+// same album file is already playing, so it only takes over the region.
+// Returns true if the track changed.
+static bool check_region_end(void) {
+    if (!Player_regionEnded()) return false;
+
+    int next = pick_next_track();
+    if (next < 0) {
+        Player_stop();  // Handled like the end of the last track
+        return true;
+    }
+
+    const FileEntry* current = track_entry(current_track());
+    const FileEntry* entry = track_entry(next);
+    if (current && entry && next != current_track() && entry->cue_track && entry->start_ms == current->end_ms &&
+        Browser_isSameFile(&browser, entry, current)) {
+        TrackRegion region;
+        Browser_getRegion(&browser, entry, &region);
+        set_current_track(next);
+        Player_setRegion(&region);
+        prefetch_upcoming();
+        return true;
+    }
+    play_track(next);
+    return true;
+}
+
+// Queue the upcoming track near the end of the current one (gapless)
+static void queue_next_track(void) {
+    if (queued_track >= 0 || Player_getState() != PLAYER_STATE_PLAYING) return;
+    // Repeat and A-B loops are spliced by the player, the track doesn't end
+    if (repeat_enabled || Player_hasLoop()) return;
+    // Cue tracks ending mid-file are followed by check_region_end instead
+    const FileEntry* current = track_entry(current_track());
+    if (current && current->end_ms > 0) return;
+    // Count from what the decoder has reached (power-save buffers tens of seconds ahead)
+    int decoded_remaining = Player_getDuration() - Player_getPosition() - Player_getBufferedMs();
+    if (decoded_remaining > GAPLESS_QUEUE_AHEAD_MS) return;
+
+    int next = pick_next_track();
+    if (next < 0) return;
+    // A queued file always starts at its beginning
+    const FileEntry* entry = track_entry(next);
+    if (entry && entry->start_ms > 0) return;
+
+    // Remember the attempt even if it fails, the end-of-track path loads it with play_track
+    queued_track = next;
+    track_path(next, queued_path, sizeof(queued_path));
+    Player_queueNext(queued_path);
+}
+
+// Drop the queued track after shuffle/repeat/loop changed (unless already switched to)
+static void requeue_next_track(void) {
+    Player_clearNext();
+    if (!Player_hasQueuedNext()) {
+        queued_track = -1;
+    }
+}
+
+// Follow the player onto the queued track after a gapless switch
+static bool check_track_change(void) {
+    if (!Player_takeTrackChange()) return false;
+    if (queued_track >= 0) {
+        set_current_track(queued_track);
+        // First cue track of the next album file
+        const FileEntry* entry = track_entry(queued_track);
+        if (entry && entry->cue_track) {
+            TrackRegion region;
+            Browser_getRegion(&browser, entry, &region);
+            Player_setRegion(&region);
+        }
+    }
+    queued_track = -1;
+    prefetch_upcoming();
+    return true;
+}
+
+// The library index changed under the play queue: rebuild it around the playing track
+static void refresh_queue(void) {
+    Queue_refresh();
+    if (queued_track >= 0) queued_track = Queue_find(queued_path);
+    Shuffle_reset(Queue_count(), Queue_position());
+    prefetch_upcoming();
+}
+
+// Keep the stations either side of the selected one warm, like a tuner
+static void set_radio_neighbours(void) {
+    RadioStation* stations;
+    int station_count = Radio_getStations(&stations);
+    if (station_count < 2) {
+        Radio_setNeighbours(NULL, NULL);
+        return;
+    }
+    Radio_setNeighbours(stations[(radio_selected - 1 + station_count) % station_count].url,
+                        stations[(radio_selected + 1) % station_count].url);
+}
+
+// Network warm-up for the screens about to use it: on entering the radio list
+// or the YouTube menu, and both when the network comes up during the session
+#define PREWARM_STATIONS 5      // The selected station and the ones around it
+static AppState prewarm_state = STATE_MENU;
+static int prewarm_online = -1; // Unknown until the first look
+
+static void prewarm_radio(void) {
+    RadioStation* stations;
+    int station_count = Radio_getStations(&stations);
+    const char* urls[PREWARM_STATIONS + 1];
+    int count = 0;
+    for (int i = 0; i < PREWARM_STATIONS && i < station_count; i++) {
+        int offset = (i + 1) / 2 * (i % 2 ? 1 : -1);   // 0, +1, -1, +2, -2
+        urls[count++] = stations[((radio_selected + offset) % station_count + station_count) % station_count].url;
+    }
+    urls[count++] = "https://itunes.apple.com/";       // Song covers
+    NetPrewarm_start("prewarm-radio", urls, count, !radio_net_dataSaver());
+}
+
+static void prewarm_youtube(void) {
+    const char* urls[] = {YOUTUBE_SEARCH_URL, "https://i.ytimg.com/"};
+    NetPrewarm_start("prewarm-youtube", urls, 2, !radio_net_dataSaver());
+}
+
+static void prewarm_update(void) {
+    bool online = radio_net_online();
+    bool came_up = online && prewarm_online == 0;
+    prewarm_online = online;
+    bool entered = app_state != prewarm_state;
+    prewarm_state = app_state;
+    if (!online) return;
+
+    if (came_up || (entered && app_state == STATE_RADIO_LIST)) prewarm_radio();
+    if (came_up || (entered && app_state == STATE_YOUTUBE_MENU)) prewarm_youtube();
+}
+
+// Session snapshot (see session.h): nothing is saved until the last one was read
+// back, so a failed start can't overwrite it
+static bool session_restored = false;
+static uint32_t session_saved_at = 0;
+
+static void session_save(void) {
+    if (!session_restored) return;
+
+    Session session;
+    memset(&session, 0, sizeof(session));
+    session.track = -1;
+    switch (app_state) {
+        case STATE_BROWSER:
+        case STATE_LIBRARY_RESULTS:
+        case STATE_ALBUM_GRID:
+            session.screen = SESSION_SCREEN_BROWSER;
+            break;
+        case STATE_PLAYING:
+            session.screen = SESSION_SCREEN_PLAYING;
+            break;
+        case STATE_RADIO_LIST:
+        case STATE_RADIO_ADD:
+        case STATE_RADIO_ADD_STATIONS:
+        case STATE_RADIO_HELP:
+            session.screen = SESSION_SCREEN_RADIO_LIST;
+            break;
+        case STATE_RADIO_PLAYING:
+            session.screen = SESSION_SCREEN_RADIO_PLAYING;
+            break;
+        default:
+            session.screen = SESSION_SCREEN_MENU;
+            break;
+    }
+
+    snprintf(session.browser_path, sizeof(session.browser_path), "%s", browser.current_path);
+    if (browser.selected >= 0 && browser.selected < browser.entry_count) {
+        Browser_getPath(&browser, &browser.entries[browser.selected], session.browser_entry,
+                        sizeof(session.browser_entry));
+    }
+    session.queue_scope = Queue_getScope(session.queue_key, sizeof(session.queue_key));
+
+    // Local tracks only: a YouTube play now file is gone after the session
+    PlayerState state = Player_getState();
+    if (!youtube_stream_playing && (state == PLAYER_STATE_PLAYING || state == PLAYER_STATE_PAUSED)) {
+        session.track = current_track();
+        track_path(session.track, session.track_path, sizeof(session.track_path));
+        session.position_ms = Player_getPosition();
+        session.paused = state == PLAYER_STATE_PAUSED;
+    }
+    if (session.screen == SESSION_SCREEN_PLAYING && !session.track_path[0]) session.screen = SESSION_SCREEN_MENU;
+
+    session.shuffle = shuffle_enabled;
+    session.repeat = repeat_enabled;
+    RadioStation* stations;
+    int station_count = Radio_getStations(&stations);
+    if (radio_selected >= 0 && radio_selected < station_count) {
+        snprintf(session.radio_url, sizeof(session.radio_url), "%s", stations[radio_selected].url);
+    }
+
+    Session_save(&session);
+    session_saved_at = SDL_GetTicks();
+}
+
+// Track of the browser folder or queue with path, preferring number hint (cue
+// tracks of one file share their path). -1 if it isn't there.
+static int session_find_track(int hint, const char* path) {
+    char candidate[512];
+    int count = track_count();
+    if (hint >= 0 && hint < count) {
+        track_path(hint, candidate, sizeof(candidate));
+        if (strcmp(candidate, path) == 0) return hint;
+    }
+    if (Queue_isActive()) return Queue_find(path);
+    for (int i = 0; i < count; i++) {
+        track_path(i, candidate, sizeof(candidate));
+        if (strcmp(candidate, path) == 0) return i;
+    }
+    return -1;
+}
+
+#ifdef ENERGY_PROFILE
+// The screen family for the energy profile's state tag
+static const char* energy_view(void) {
+    switch (app_state) {
+        case STATE_MENU:
+        case STATE_ABOUT:
+            return "menu";
+        case STATE_BROWSER:
+        case STATE_LIBRARY_RESULTS:
+        case STATE_ALBUM_GRID:
+            return "browser";
+        case STATE_PLAYING:
+            return "playing";
+        case STATE_RADIO_LIST:
+        case STATE_RADIO_ADD:
+        case STATE_RADIO_ADD_STATIONS:
+        case STATE_RADIO_HELP:
+            return "radio_list";
+        case STATE_RADIO_PLAYING:
+            return "radio";
+        case STATE_APP_UPDATING:
+            return "updating";
+        default:
+            return "youtube";
+    }
+}
+#endif
+
+// Open the browser folder of the last session, select its entry and station
+// again, and pick its track up where it stopped. Returns the screen to show.
+static AppState session_restore(void) {
+    Session session;
+    bool loaded = Session_load(&session);
+    session_restored = true;
+
+    struct stat st;
+    bool folder_ok = loaded && strncmp(session.browser_path, MUSIC_PATH, strlen(MUSIC_PATH)) == 0 &&
+                     stat(session.browser_path, &st) == 0 && S_ISDIR(st.st_mode);
+    load_directory(folder_ok ? session.browser_path : MUSIC_PATH);
+    if (!loaded) return STATE_MENU;
+
+    for (int i = 0; i < browser.entry_count; i++) {
+        char entry_path[512];
+        Browser_getPath(&browser, &browser.entries[i], entry_path, sizeof(entry_path));
+        if (strcmp(entry_path, session.browser_entry) == 0) {
+            browser.selected = i;
+            break;
+        }
+    }
+    shuffle_enabled = session.shuffle;
+    repeat_enabled = session.repeat;
+    Player_setRepeat(repeat_enabled);
+
+    RadioStation* stations;
+    int station_count = Radio_getStations(&stations);
+    bool station_found = false;
+    for (int i = 0; i < station_count && !station_found; i++) {
+        if (strcmp(stations[i].url, session.radio_url) == 0) {
+            radio_selected = i;
+            station_found = true;
+        }
+    }
+
+    bool playing = false;
+    if (session.track_path[0] && stat(session.track_path, &st) == 0) {
+        // The queue is rebuilt from the library index, which is mapped by now
+        int track = -1;
+        if (session.queue_scope != QUEUE_SCOPE_NONE &&
+            Queue_open((QueueScope)session.queue_scope, session.queue_key) > 0) {
+            track = session_find_track(session.track, session.track_path);
+            if (track < 0) Queue_close();
+        }
+        if (!Queue_isActive()) track = session_find_track(session.track, session.track_path);
+
+        if (track >= 0) {
+            TrackRegion region;
+            track_region(track, &region);
+            Shuffle_reset(track_count(), track);
+            set_current_track(track);
+            if (Player_loadAsyncAt(session.track_path, &region, session.position_ms, session.paused) == 0) {
+                prefetch_upcoming();
+                playing = true;
+            }
+        }
+    }
+
+    switch (session.screen) {
+        case SESSION_SCREEN_BROWSER:
+            return STATE_BROWSER;
+        case SESSION_SCREEN_PLAYING:
+            return playing ? STATE_PLAYING : STATE_BROWSER;
+        case SESSION_SCREEN_RADIO_LIST:
+            return STATE_RADIO_LIST;
+        case SESSION_SCREEN_RADIO_PLAYING:
+            if (!playing && station_found && Radio_play(stations[radio_selected].url) == 0) {
+                set_radio_neighbours();
+                return STATE_RADIO_PLAYING;
+            }
+            return STATE_RADIO_LIST;
+        default:
+            return STATE_MENU;
+    }
+}
+
+// Whether the current screen animates on its own (GPU layers redrawn every frame)
+static bool screen_animating(void) {
+    switch (app_state) {
+        case STATE_BROWSER:
+            return browser_needs_scroll_refresh();
+        case STATE_LIBRARY_RESULTS:
+            return library_results_needs_scroll_refresh();
+        case STATE_PLAYING:
+            return player_needs_scroll_refresh() || Spectrum_needsRefresh();
+        case STATE_RADIO_PLAYING:
+            return radio_needs_scroll_refresh();
+        case STATE_YOUTUBE_RESULTS:
+            return youtube_results_needs_scroll_refresh();
+        case STATE_YOUTUBE_QUEUE:
+            return youtube_queue_needs_scroll_refresh();
+        default:
+            return false;
+    }
+}
+
+// How long the loop may sleep when nothing is drawn or animating: input wakes it
+// at once, background work it polls for is picked up within this
+static uint32_t idle_timeout_ms(void) {
+    if (screen_off) {
+        // Headless: only playback bookkeeping is left, and a track still loading
+        // must start on time
+        if (Player_getState() == PLAYER_STATE_LOADING) return IDLE_ACTIVE_MS;
+        return Radio_isActive() ? SCREEN_OFF_RADIO_MS : SCREEN_OFF_POLL_MS;
+    }
+    uint32_t timeout = IDLE_POLL_MS;
+    if (Player_getState() == PLAYER_STATE_PLAYING || Radio_isActive() ||
+        youtube_searching || youtube_stream_id[0]) {
+        timeout = IDLE_ACTIVE_MS;
+    }
+    // Wake when the folder under the cursor is due to be prefetched
+    int prefetch_ms = app_state == STATE_BROWSER ? Browser_prefetchWaitMs() : -1;
+    if (prefetch_ms >= 0 && (uint32_t)prefetch_ms < timeout) timeout = prefetch_ms;
+    // Wake when changed settings are due to be written
+    int settings_ms = Settings_flushWaitMs();
+    if (settings_ms >= 0 && (uint32_t)settings_ms < timeout) timeout = settings_ms;
+    return timeout;
+}
+
+// Whether button input is queued that PAD_poll hasn't read yet (left in the queue)
+static bool input_pending(void) {
+    SDL_PumpEvents();
+    return SDL_HasEvents(SDL_KEYDOWN, SDL_KEYUP) || SDL_HasEvents(SDL_JOYAXISMOTION, SDL_JOYBUTTONUP);
+}
+
+// The startup update check, deferred until there is a network
+static void startup_update_check(void* arg) {
+    (void)arg;
+    if (radio_net_dataSaver()) return;     // Left to the About screen
+    SelfUpdate_checkForUpdate();
 }
 
 // Render functions are now in UI modules (ui_music.h, ui_radio.h, ui_youtube.h, ui_system.h)
 // See: ui_music.c, ui_radio.c, ui_youtube.c, ui_system.c
 
 int main(int argc, char* argv[]) {
+    TRACE_BEGIN("startup_ui");
     InitSettings();
     PWR_setCPUSpeed(CPU_SPEED_MENU);
     screen = GFX_init(MODE_MAIN);
+    radio_album_art_set_display_size(screen->h);  // Covers are drawn at screen height
     PAD_init();
     PWR_init();
     WIFI_init();
 
+    // Keep the UI (and the threads it spawns, until they pick their own role) off the audio core
+    ThreadRole_apply(THREAD_ROLE_UI);
+
+    // Decode, stream and network threads log through a ring drained in the background
+    Log_asyncInit();
+
     // Load custom fonts (if available)
     load_custom_fonts();
 
     signal(SIGINT, sigHandler);
     signal(SIGTERM, sigHandler);
+    // A write to a socket the server (or radio_net_abortAll) closed fails instead
+    signal(SIGPIPE, SIG_IGN);
 
     // Seed random number generator for shuffle
     srand((unsigned int)time(NULL));
 
+    // Initialize self-update module (current directory is pak root)
+    // Version is read from state/app_version.txt
+    SelfUpdate_init(".");
+
+    // Show the menu before the audio device, radio, YouTube and library come up:
+    // it needs none of them, and the first input is handled after they have
+    render_menu(screen, 0, menu_selected);
+    GFX_flip(screen);
+    TRACE_END("startup_ui");
+    TRACE_BEGIN("startup_subsystems");
+
+    // Worker pool for background jobs (covers, scans, probes)
+    Jobs_init();
+#ifdef ENERGY_PROFILE
+    Energy_start();
+#endif
+
+    // Preferences the player, spectrum and YouTube read as they start
+    Settings_init();
+    Bookmarks_init();
+    radio_net_setDataSaver(Settings_getBool(SETTING_DATA_SAVER, false));
+
     // Initialize player and radio
     if (Player_init() != 0) {
         LOG_error("Failed to initialize audio player\n");
@@ -161,25 +895,43 @@ int main(int argc, char* argv[]) {
     Radio_init();
     YouTube_init();
 
-    // Initialize self-update module (current directory is pak root)
-    // Version is read from state/app_version.txt
-    SelfUpdate_init(".");
+    // CPU speed follows playback load from here on
+    Governor_init();
 
-    // Auto-check for updates on startup (non-blocking)
-    SelfUpdate_checkForUpdate();
+    // Auto-check for updates on startup (non-blocking), once there is a network
+    NetJobs_defer("update-check", startup_update_check, NULL);
+
+    // Refresh the curated station catalog in the background (at most daily)
+    radio_catalog_sync();
 
     // Create Music folder if it doesn't exist
     mkdir(MUSIC_PATH, 0755);
 
-    // Load initial directory
-    load_directory(MUSIC_PATH);
+    // Index the whole music folder in the background
+    Library_init(MUSIC_PATH);
+    TrackMeta_init();
+
+    // Back to the folder, screen and track of the last session
+    app_state = session_restore();
+    last_input_time = SDL_GetTicks();  // Start screen-off timer
+    TRACE_END("startup_subsystems");
 
     int dirty = 1;
     int show_setting = 0;
+    int render_deferred = 0;    // Redraws put off in a row for newer input
 
     while (!quit) {
         uint32_t frame_start = SDL_GetTicks();
+        PROFILE_FRAME_BEGIN();
         PAD_poll();
+        LATENCY_POLLED();
+
+#ifdef TRACE_EVENTS
+        // SELECT+Y writes the trace so far
+        if (PAD_isPressed(BTN_SELECT) && PAD_justPressed(BTN_Y)) {
+            if (TRACE_DUMP() == 0) LOG_info("Trace written to %s\n", TRACE_FILE);
+        }
+#endif
 
         // Handle volume buttons - works in all states
         // System volume is 0-20, software volume is 0.0-1.0
@@ -236,11 +988,11 @@ int main(int argc, char* argv[]) {
         else if (app_state == STATE_MENU) {
             if (PAD_justRepeated(BTN_UP)) {
                 menu_selected = (menu_selected > 0) ? menu_selected - 1 : MENU_ITEM_COUNT - 1;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justRepeated(BTN_DOWN)) {
                 menu_selected = (menu_selected < MENU_ITEM_COUNT - 1) ? menu_selected + 1 : 0;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justPressed(BTN_A)) {
                 if (menu_selected == 0) {
@@ -255,6 +1007,7 @@ int main(int argc, char* argv[]) {
                 } else if (menu_selected == 2) {
                     // Music Downloader
                     if (YouTube_isAvailable()) {
+                        YouTube_searchWarmup();
                         app_state = STATE_YOUTUBE_MENU;
                         youtube_menu_selected = 0;
                         dirty = 1;
@@ -272,31 +1025,86 @@ int main(int argc, char* argv[]) {
         else if (app_state == STATE_BROWSER) {
             if (PAD_justRepeated(BTN_UP) && browser.entry_count > 0) {
                 browser.selected = (browser.selected > 0) ? browser.selected - 1 : browser.entry_count - 1;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justRepeated(BTN_DOWN) && browser.entry_count > 0) {
                 browser.selected = (browser.selected < browser.entry_count - 1) ? browser.selected + 1 : 0;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justPressed(BTN_A) && browser.entry_count > 0) {
                 FileEntry* entry = &browser.entries[browser.selected];
                 if (entry->is_dir) {
                     // Copy path before load_directory frees browser.entries
                     char path_copy[512];
-                    strncpy(path_copy, entry->path, sizeof(path_copy) - 1);
-                    path_copy[sizeof(path_copy) - 1] = '\0';
+                    Browser_getPath(&browser, entry, path_copy, sizeof(path_copy));
                     load_directory(path_copy);
                     dirty = 1;
+                } else if (entry->is_playlist) {
+                    // Play the playlist as a queue
+                    char playlist_path[512];
+                    Browser_getPath(&browser, entry, playlist_path, sizeof(playlist_path));
+                    if (play_queue(QUEUE_SCOPE_PLAYLIST, playlist_path, NULL) == 0) {
+                        app_state = STATE_PLAYING;
+                        last_input_time = SDL_GetTicks();  // Start screen-off timer
+                    }
+                    dirty = 1;
                 } else {
                     // Load and play the file
-                    if (Player_load(entry->path) == 0) {
-                        Player_play();
+                    if (play_entry(browser.selected) == 0) {
                                                 app_state = STATE_PLAYING;
                         last_input_time = SDL_GetTicks();  // Start screen-off timer
                         dirty = 1;
                     }
                 }
             }
+            else if (PAD_justPressed(BTN_Y)) {
+                // Search the whole library
+                char* query = YouTube_openKeyboard("Search:");
+                // Reset button state and re-poll to prevent keyboard B press from triggering browser back
+                PAD_reset();
+                PAD_poll();
+                PAD_reset();
+                if (query && strlen(query) > 0) {
+                    snprintf(library_search_query, sizeof(library_search_query), "%s", query);
+                    library_result_count = Library_search(library_search_query, library_results, LIBRARY_MAX_RESULTS);
+                    library_results_selected = 0;
+                    library_results_scroll = 0;
+                    GFX_clearLayers(LAYER_SCROLLTEXT);
+                    app_state = STATE_LIBRARY_RESULTS;
+                }
+                if (query) free(query);
+                dirty = 1;
+            }
+            else if (PAD_justPressed(BTN_R1)) {
+                // Browse the library's albums by cover
+                album_grid_count = Library_albums(NULL, album_grid, ALBUM_GRID_MAX);
+                album_grid_selected = 0;
+                album_grid_scroll = 0;
+                AlbumThumbs_open();
+                GFX_clearLayers(LAYER_SCROLLTEXT);
+                app_state = STATE_ALBUM_GRID;
+                dirty = 1;
+            }
+            else if (PAD_justPressed(BTN_X) && browser.entry_count > 0) {
+                // Play a folder with its subfolders from the library index: the selected
+                // folder, or this one starting at the selected file
+                const FileEntry* entry = &browser.entries[browser.selected];
+                char folder[512], start[512];
+                bool is_folder = entry->is_dir && entry->file != 0;  // Not ".."
+                if (is_folder) {
+                    Browser_getPath(&browser, entry, folder, sizeof(folder));
+                } else {
+                    snprintf(folder, sizeof(folder), "%s", browser.current_path);
+                    Browser_getPath(&browser, entry, start, sizeof(start));
+                }
+                bool whole_library = strcmp(folder, MUSIC_PATH) == 0;
+                if (play_queue(whole_library ? QUEUE_SCOPE_LIBRARY : QUEUE_SCOPE_FOLDER, folder,
+                               entry->is_dir ? NULL : start) == 0) {
+                    app_state = STATE_PLAYING;
+                    last_input_time = SDL_GetTicks();  // Start screen-off timer
+                }
+                dirty = 1;
+            }
             else if (PAD_justPressed(BTN_B)) {
                 // Go up a directory or back to menu
                 if (strcmp(browser.current_path, MUSIC_PATH) != 0) {
@@ -313,11 +1121,122 @@ int main(int argc, char* argv[]) {
                 }
             }
 
+            // Tags of more rows arrived
+            if (TrackMeta_takeUpdate()) {
+                dirty = 1;
+            }
+
+            // A folder the cursor rests on is listed ahead of being opened
+            Browser_hover(&browser);
+
             // Animate scroll without full redraw (GPU mode)
             if (browser_needs_scroll_refresh()) {
                 browser_animate_scroll();
             }
         }
+        else if (app_state == STATE_LIBRARY_RESULTS) {
+            if (PAD_justRepeated(BTN_UP) && library_result_count > 0) {
+                library_results_selected = (library_results_selected > 0) ? library_results_selected - 1 : library_result_count - 1;
+                dirty |= DIRTY_SELECTION;
+            }
+            else if (PAD_justRepeated(BTN_DOWN) && library_result_count > 0) {
+                library_results_selected = (library_results_selected < library_result_count - 1) ? library_results_selected + 1 : 0;
+                dirty |= DIRTY_SELECTION;
+            }
+            else if (PAD_justPressed(BTN_A) && library_result_count > 0) {
+                // Open the track's folder so next/previous/shuffle follow it, then play it
+                const LibraryRecord* record = Library_record(library_results[library_results_selected]);
+                if (record) {
+                    char path[512], dir[512];
+                    snprintf(path, sizeof(path), "%s", Library_string(record->path));
+                    snprintf(dir, sizeof(dir), "%s", path);
+                    char* last_slash = strrchr(dir, '/');
+                    if (last_slash) *last_slash = '\0';
+                    load_directory(dir);
+
+                    for (int i = 0; i < browser.entry_count; i++) {
+                        char entry_path[512];
+                        if (browser.entries[i].is_dir) continue;
+                        Browser_getPath(&browser, &browser.entries[i], entry_path, sizeof(entry_path));
+                        if (strcmp(entry_path, path) != 0) continue;
+                        GFX_clearLayers(LAYER_SCROLLTEXT);
+                        if (play_entry(i) == 0) {
+                            app_state = STATE_PLAYING;
+                            last_input_time = SDL_GetTicks();  // Start screen-off timer
+                        } else {
+                            app_state = STATE_BROWSER;
+                        }
+                        break;
+                    }
+                }
+                dirty = 1;
+            }
+            else if ((PAD_justPressed(BTN_X) || PAD_justPressed(BTN_Y)) && library_result_count > 0) {
+                // Play the album (X) or artist (Y) of the selected track, starting with it
+                const LibraryRecord* record = Library_record(library_results[library_results_selected]);
+                bool album = PAD_justPressed(BTN_X);
+                if (record && (album ? record->album : record->artist)) {
+                    char key[256], path[512];
+                    snprintf(key, sizeof(key), "%s", Library_string(album ? record->album : record->artist));
+                    snprintf(path, sizeof(path), "%s", Library_string(record->path));
+                    GFX_clearLayers(LAYER_SCROLLTEXT);
+                    if (play_queue(album ? QUEUE_SCOPE_ALBUM : QUEUE_SCOPE_ARTIST, key, path) == 0) {
+                        app_state = STATE_PLAYING;
+                        last_input_time = SDL_GetTicks();  // Start screen-off timer
+                    }
+                }
+                dirty = 1;
+            }
+            else if (PAD_justPressed(BTN_B)) {
+                GFX_clearLayers(LAYER_SCROLLTEXT);  // Clear scroll layer when leaving
+                app_state = STATE_BROWSER;
+                dirty = 1;
+            }
+
+            // Animate scroll without full redraw (GPU mode)
+            if (library_results_needs_scroll_refresh()) {
+                library_results_animate_scroll();
+            }
+        }
+        else if (app_state == STATE_ALBUM_GRID) {
+            int columns = album_grid_columns(screen);
+            if (PAD_justRepeated(BTN_LEFT) && album_grid_count > 0) {
+                album_grid_selected = (album_grid_selected > 0) ? album_grid_selected - 1 : album_grid_count - 1;
+                dirty = 1;
+            }
+            else if (PAD_justRepeated(BTN_RIGHT) && album_grid_count > 0) {
+                album_grid_selected = (album_grid_selected < album_grid_count - 1) ? album_grid_selected + 1 : 0;
+                dirty = 1;
+            }
+            else if (PAD_justRepeated(BTN_UP) && album_grid_selected >= columns) {
+                album_grid_selected -= columns;
+                dirty = 1;
+            }
+            else if (PAD_justRepeated(BTN_DOWN) && album_grid_selected + columns < album_grid_count) {
+                album_grid_selected += columns;
+                dirty = 1;
+            }
+            else if (PAD_justPressed(BTN_A) && album_grid_count > 0) {
+                char key[256];
+                snprintf(key, sizeof(key), "%s", Library_string(album_grid[album_grid_selected]));
+                if (play_queue(QUEUE_SCOPE_ALBUM, key, NULL) == 0) {
+                    AlbumThumbs_close();
+                    app_state = STATE_PLAYING;
+                    last_input_time = SDL_GetTicks();  // Start screen-off timer
+                }
+                dirty = 1;
+            }
+            else if (PAD_justPressed(BTN_B)) {
+                AlbumThumbs_close();
+                app_state = STATE_BROWSER;
+                dirty = 1;
+            }
+
+            // More covers are in the atlas
+            if (AlbumThumbs_takeUpdate()) {
+                dirty = 1;
+            }
+        }
         else if (app_state == STATE_PLAYING) {
             // Disable autosleep while playing
             if (!autosleep_disabled) {
@@ -335,63 +1254,14 @@ int main(int argc, char* argv[]) {
                 }
                 // Still update player and process audio while screen is off
                 Player_update();
+                check_track_change();
+                check_region_end();
+                queue_next_track();
 
                 // Check if track ended while screen off
                 if (Player_getState() == PLAYER_STATE_STOPPED) {
-                    bool found_next = false;
-
-                    if (repeat_enabled) {
-                        // Repeat current track
-                        if (Player_load(browser.entries[browser.selected].path) == 0) {
-                            Player_play();
-                            found_next = true;
-                        }
-                    } else if (shuffle_enabled) {
-                        // Pick a random track
-                        int audio_count = Browser_countAudioFiles(&browser);
-                        if (audio_count > 1) {
-                            int random_idx = rand() % audio_count;
-                            int count = 0;
-                            for (int i = 0; i < browser.entry_count; i++) {
-                                if (!browser.entries[i].is_dir) {
-                                    if (count == random_idx && i != browser.selected) {
-                                        browser.selected = i;
-                                        if (Player_load(browser.entries[i].path) == 0) {
-                                            Player_play();
-                                            found_next = true;
-                                        }
-                                        break;
-                                    }
-                                    count++;
-                                }
-                            }
-                            // Fallback if we picked same track
-                            if (!found_next) {
-                                for (int i = 0; i < browser.entry_count; i++) {
-                                    if (!browser.entries[i].is_dir && i != browser.selected) {
-                                        browser.selected = i;
-                                        if (Player_load(browser.entries[i].path) == 0) {
-                                            Player_play();
-                                            found_next = true;
-                                        }
-                                        break;
-                                    }
-                                }
-                            }
-                        }
-                    } else {
-                        // Normal: advance to next track
-                        for (int i = browser.selected + 1; i < browser.entry_count; i++) {
-                            if (!browser.entries[i].is_dir) {
-                                browser.selected = i;
-                                if (Player_load(browser.entries[i].path) == 0) {
-                                    Player_play();
-                                                                    found_next = true;
-                                }
-                                break;
-                            }
-                        }
-                    }
+                    // A track that failed to open ends playback like the last track
+                    bool found_next = !Player_loadFailed() && advance_track();
 
                     // If no next track, wake screen and go back
                     if (!found_next && Player_getState() == PLAYER_STATE_STOPPED) {
@@ -403,6 +1273,7 @@ int main(int argc, char* argv[]) {
                         PLAT_clearLayers(LAYER_PLAYTIME);
                         PLAT_GPU_Flip();
                         PlayTime_clear();  // Reset playtime state
+                        Player_prefetch(NULL, 0);
                         app_state = STATE_BROWSER;
                         if (autosleep_disabled) {
                             PWR_enableAutosleep();
@@ -419,12 +1290,28 @@ int main(int argc, char* argv[]) {
                     last_input_time = SDL_GetTicks();
                 }
 
+                // Scrub released: one seek, to the target snapped to the seek index
+                if (scrub_target_ms >= 0 && !PAD_isPressed(BTN_LEFT) && !PAD_isPressed(BTN_RIGHT)) {
+                    int target = Player_getSeekPreview();
+                    scrub_cancel();
+                    if (target >= 0) {
+                        LATENCY_BEGIN(LATENCY_SEEK, true);
+                        Player_seek(target);
+                    }
+                    dirty = 1;
+                }
+
                 if (PAD_justPressed(BTN_A)) {
                     Player_togglePause();
+                    LATENCY_BEGIN(LATENCY_PAUSE, Player_getState() == PLAYER_STATE_PLAYING);
+                    LATENCY_AUDIO_READY();  // Resuming plays what the ring already holds
                     dirty = 1;
                 }
                 else if (PAD_justPressed(BTN_B)) {
+                    scrub_cancel();
                     Player_stop();
+                    Player_prefetch(NULL, 0);  // Nothing is coming up anymore
+                    queued_track = -1;
                     cleanup_album_art_background();  // Clear cached background when stopping
                     // Clear all GPU layers when leaving player
                     GFX_clearLayers(LAYER_SCROLLTEXT);
@@ -441,54 +1328,67 @@ int main(int argc, char* argv[]) {
                     }
                     dirty = 1;
                 }
-                else if (PAD_justRepeated(BTN_LEFT)) {
-                    // Seek backward 5 seconds
-                    int pos = Player_getPosition();
-                    Player_seek(pos - 5000);
-                    dirty = 1;
-                }
-                else if (PAD_justRepeated(BTN_RIGHT)) {
-                    // Seek forward 5 seconds
-                    int pos = Player_getPosition();
-                    Player_seek(pos + 5000);
+                else if (PAD_justRepeated(BTN_LEFT) || PAD_justRepeated(BTN_RIGHT)) {
+                    // Move the scrub target 5 seconds; the waveform replaces the spectrum meanwhile
+                    if (scrub_target_ms < 0) {
+                        scrub_target_ms = Player_getPosition();
+                        PLAT_clearLayers(LAYER_SPECTRUM);
+                    }
+                    scrub_target_ms += PAD_justRepeated(BTN_LEFT) ? -5000 : 5000;
+                    int duration = Player_getDuration();
+                    if (scrub_target_ms > duration) scrub_target_ms = duration;
+                    if (scrub_target_ms < 0) scrub_target_ms = 0;
+                    Player_previewSeek(scrub_target_ms);
                     dirty = 1;
                 }
                 else if (PAD_justPressed(BTN_DOWN) || PAD_justPressed(BTN_L1)) {
-                    // Previous track (Down or L1)
-                    for (int i = browser.selected - 1; i >= 0; i--) {
-                        if (!browser.entries[i].is_dir) {
-                            Player_stop();
-                            browser.selected = i;
-                            if (Player_load(browser.entries[i].path) == 0) {
-                                Player_play();
-                            }
-                            dirty = 1;
-                            break;
-                        }
+                    // Previous track (Down or L1), back through the shuffle history when shuffling
+                    int track = shuffle_enabled ? Shuffle_peekPrev() : current_track() - 1;
+                    if (track >= 0) {
+                        LATENCY_BEGIN(LATENCY_NEXT, true);
+                        play_track(track);
+                        dirty = 1;
                     }
                 }
                 else if (PAD_justPressed(BTN_UP) || PAD_justPressed(BTN_R1)) {
                     // Next track (Up or R1)
-                    for (int i = browser.selected + 1; i < browser.entry_count; i++) {
-                        if (!browser.entries[i].is_dir) {
-                            Player_stop();
-                            browser.selected = i;
-                            if (Player_load(browser.entries[i].path) == 0) {
-                                Player_play();
-                                                            }
-                            dirty = 1;
-                            break;
-                        }
+                    int next = current_track() + 1;
+                    int track = shuffle_enabled ? Shuffle_peekNext() : (next < track_count() ? next : -1);
+                    if (track >= 0) {
+                        LATENCY_BEGIN(LATENCY_NEXT, true);
+                        play_track(track);
+                        dirty = 1;
                     }
                 }
                 else if (PAD_justPressed(BTN_X)) {
                     // Toggle shuffle
                     shuffle_enabled = !shuffle_enabled;
+                    // New order starting from the playing track
+                    Shuffle_reset(track_count(), current_track());
+                    requeue_next_track();
+                    prefetch_upcoming();
+                    dirty = 1;
+                }
+                else if (PAD_isPressed(BTN_SELECT) && PAD_justPressed(BTN_Y)) {
+                    // A-B loop: mark A, then B closes the loop, then clear it
+                    if (Player_hasLoop()) {
+                        Player_clearLoop();
+                        loop_a_ms = -1;
+                    } else if (loop_a_ms < 0) {
+                        loop_a_ms = Player_getPosition();
+                    } else {
+                        Player_setLoop(loop_a_ms, Player_getPosition());
+                        loop_a_ms = -1;
+                        requeue_next_track();
+                    }
                     dirty = 1;
                 }
                 else if (PAD_justPressed(BTN_Y)) {
                     // Toggle repeat
                     repeat_enabled = !repeat_enabled;
+                    Player_setRepeat(repeat_enabled);
+                    requeue_next_track();
+                    prefetch_upcoming();
                     dirty = 1;
                 }
                 else if (PAD_justPressed(BTN_L3) || PAD_justPressed(BTN_L2)) {
@@ -510,61 +1410,22 @@ int main(int argc, char* argv[]) {
                 // Check if track ended (only if still in playing state - not if user pressed back)
                 if (app_state == STATE_PLAYING) {
                     Player_update();
-                    if (Player_getState() == PLAYER_STATE_STOPPED) {
-                        bool found_next = false;
+                    if (check_track_change() || check_region_end()) {
+                        scrub_cancel();
+                        dirty = 1;
+                    }
+                    if (scrub_target_ms >= 0 && Player_getSeekPreview() != scrub_shown_ms) {
+                        scrub_shown_ms = Player_getSeekPreview();
+                        dirty = 1;  // The decode thread snapped the target
+                    }
+                    if (Player_takeAlbumArtChange()) {
+                        dirty = 1;  // Embedded cover finished decoding
+                    }
+                    queue_next_track();
 
-                        if (repeat_enabled) {
-                            // Repeat current track
-                            if (Player_load(browser.entries[browser.selected].path) == 0) {
-                                Player_play();
-                                found_next = true;
-                            }
-                        } else if (shuffle_enabled) {
-                            // Pick a random track
-                            int audio_count = Browser_countAudioFiles(&browser);
-                            if (audio_count > 1) {
-                                int random_idx = rand() % audio_count;
-                                int count = 0;
-                                for (int i = 0; i < browser.entry_count; i++) {
-                                    if (!browser.entries[i].is_dir) {
-                                        if (count == random_idx && i != browser.selected) {
-                                            browser.selected = i;
-                                            if (Player_load(browser.entries[i].path) == 0) {
-                                                Player_play();
-                                                found_next = true;
-                                            }
-                                            break;
-                                        }
-                                        count++;
-                                    }
-                                }
-                                // Fallback if we picked same track
-                                if (!found_next) {
-                                    for (int i = 0; i < browser.entry_count; i++) {
-                                        if (!browser.entries[i].is_dir && i != browser.selected) {
-                                            browser.selected = i;
-                                            if (Player_load(browser.entries[i].path) == 0) {
-                                                Player_play();
-                                                found_next = true;
-                                            }
-                                            break;
-                                        }
-                                    }
-                                }
-                            }
-                        } else {
-                            // Normal: advance to next track
-                            for (int i = browser.selected + 1; i < browser.entry_count; i++) {
-                                if (!browser.entries[i].is_dir) {
-                                    browser.selected = i;
-                                    if (Player_load(browser.entries[i].path) == 0) {
-                                        Player_play();
-                                                                                found_next = true;
-                                    }
-                                    break;
-                                }
-                            }
-                        }
+                    if (Player_getState() == PLAYER_STATE_STOPPED) {
+                        // A track that failed to open ends playback like the last track
+                        bool found_next = !Player_loadFailed() && advance_track();
 
                         dirty = 1;
 
@@ -576,6 +1437,7 @@ int main(int argc, char* argv[]) {
                             PLAT_clearLayers(LAYER_PLAYTIME);
                             PLAT_GPU_Flip();
                             PlayTime_clear();  // Reset playtime state
+                            Player_prefetch(NULL, 0);
                             app_state = STATE_BROWSER;
                             if (autosleep_disabled) {
                                 PWR_enableAutosleep();
@@ -606,8 +1468,8 @@ int main(int argc, char* argv[]) {
                     player_animate_scroll();
                 }
 
-                // Animate spectrum visualizer (GPU mode)
-                if (Spectrum_needsRefresh()) {
+                // Animate spectrum visualizer (GPU mode), its area shows the waveform while scrubbing
+                if (scrub_target_ms < 0 && Spectrum_needsRefresh()) {
                     Spectrum_renderGPU();
                 }
 
@@ -623,15 +1485,17 @@ int main(int argc, char* argv[]) {
 
             if (PAD_justRepeated(BTN_UP) && station_count > 0) {
                 radio_selected = (radio_selected > 0) ? radio_selected - 1 : station_count - 1;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justRepeated(BTN_DOWN) && station_count > 0) {
                 radio_selected = (radio_selected < station_count - 1) ? radio_selected + 1 : 0;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justPressed(BTN_A) && station_count > 0) {
                 // Start playing the selected station
+                LATENCY_BEGIN(LATENCY_STATION, true);
                 if (Radio_play(stations[radio_selected].url) == 0) {
+                    set_radio_neighbours();
                     app_state = STATE_RADIO_PLAYING;
                     last_input_time = SDL_GetTicks();  // Start screen-off timer
                     dirty = 1;
@@ -641,8 +1505,18 @@ int main(int argc, char* argv[]) {
                 app_state = STATE_MENU;
                 dirty = 1;
             }
+            else if (PAD_justPressed(BTN_X)) {
+                // Data saver: takes effect from the next request; standbys close at
+                // once, and come back with the next station played once it's off
+                bool saver = !radio_net_dataSaver();
+                radio_net_setDataSaver(saver);
+                Settings_setBool(SETTING_DATA_SAVER, saver);
+                if (saver) Radio_setNeighbours(NULL, NULL);
+                dirty = 1;
+            }
             else if (PAD_justPressed(BTN_Y)) {
-                // Open Add Stations screen
+                // Open Add Stations screen, with a catalog synced since last time
+                radio_catalog_apply();
                 add_country_selected = 0;
                 add_country_scroll = 0;
                 app_state = STATE_RADIO_ADD;
@@ -680,8 +1554,10 @@ int main(int argc, char* argv[]) {
                     int station_count = Radio_getStations(&stations);
                     if (station_count > 1) {
                         radio_selected = (radio_selected + 1) % station_count;
+                        LATENCY_BEGIN(LATENCY_STATION, true);
                         Radio_stop();
                         Radio_play(stations[radio_selected].url);
+                        set_radio_neighbours();
                         dirty = 1;
                     }
                 }
@@ -691,13 +1567,44 @@ int main(int argc, char* argv[]) {
                     int station_count = Radio_getStations(&stations);
                     if (station_count > 1) {
                         radio_selected = (radio_selected - 1 + station_count) % station_count;
+                        LATENCY_BEGIN(LATENCY_STATION, true);
                         Radio_stop();
                         Radio_play(stations[radio_selected].url);
+                        set_radio_neighbours();
                         dirty = 1;
                     }
                 }
+                else if (PAD_justPressed(BTN_A)) {
+                    // Time-shift: pause keeps recording, play continues where it paused
+                    if (Radio_getState() == RADIO_STATE_PAUSED) {
+                        Radio_resume();
+                    } else {
+                        Radio_pause();
+                    }
+                    LATENCY_BEGIN(LATENCY_PAUSE, false);
+                    dirty = 1;
+                }
+                else if (PAD_justPressed(BTN_LEFT) || PAD_justPressed(BTN_RIGHT)) {
+                    LATENCY_BEGIN(LATENCY_SEEK, false);
+                    Radio_seekRelative(PAD_justPressed(BTN_LEFT) ? -30 : 30);
+                    dirty = 1;
+                }
+                else if (PAD_justPressed(BTN_X)) {
+                    Radio_seekSongStart();
+                    dirty = 1;
+                }
+                else if (PAD_justPressed(BTN_Y)) {
+                    // Save the stream to Music/Recordings, a file per song
+                    if (Radio_isRecording()) {
+                        Radio_stopRecording();
+                    } else {
+                        Radio_startRecording();
+                    }
+                    dirty = 1;
+                }
                 else if (PAD_justPressed(BTN_B)) {
                     Radio_stop();
+                    Radio_setNeighbours(NULL, NULL);
                     cleanup_album_art_background();  // Clear cached background when stopping
                     RadioStatus_clear();  // Clear GPU status layer
                     app_state = STATE_RADIO_LIST;
@@ -732,6 +1639,11 @@ int main(int argc, char* argv[]) {
                 if (RadioStatus_needsRefresh()) {
                     RadioStatus_renderGPU();
                 }
+
+                // Animate long station and artist lines (GPU mode)
+                if (!screen_off && radio_needs_scroll_refresh()) {
+                    radio_animate_scroll();
+                }
             }
         }
         else if (app_state == STATE_RADIO_ADD) {
@@ -740,11 +1652,11 @@ int main(int argc, char* argv[]) {
 
             if (PAD_justRepeated(BTN_UP) && country_count > 0) {
                 add_country_selected = (add_country_selected > 0) ? add_country_selected - 1 : country_count - 1;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justRepeated(BTN_DOWN) && country_count > 0) {
                 add_country_selected = (add_country_selected < country_count - 1) ? add_country_selected + 1 : 0;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justPressed(BTN_A) && country_count > 0) {
                 // Select country and go to station selection
@@ -753,12 +1665,20 @@ int main(int argc, char* argv[]) {
                 add_station_selected = 0;
                 add_station_scroll = 0;
                 // Initialize checked states based on existing stations
-                memset(add_station_checked, 0, sizeof(add_station_checked));
-                int sc = 0;
-                const CuratedStation* cs = Radio_getCuratedStations(add_selected_country_code, &sc);
-                for (int i = 0; i < sc && i < 256; i++) {
-                    add_station_checked[i] = Radio_stationExists(cs[i].url);
+                free(add_station_checked);
+                add_station_count = Radio_getCuratedStationCount(add_selected_country_code);
+                add_station_checked = calloc(add_station_count + 1, sizeof(bool));
+                CuratedStation cs;
+                for (int i = 0; add_station_checked && i < add_station_count; i++) {
+                    if (Radio_getCuratedStation(add_selected_country_code, i, &cs)) {
+                        add_station_checked[i] = Radio_stationExists(cs.url);
+                    }
                 }
+                if (!add_station_checked) add_station_count = 0;
+                add_station_query[0] = '\0';
+                add_station_rows = Radio_openCuratedView(add_selected_country_code, add_station_query);
+                add_probe_first = -1;
+                add_probe_generation = Radio_getProbeGeneration();
                 app_state = STATE_RADIO_ADD_STATIONS;
                 dirty = 1;
             }
@@ -773,9 +1693,22 @@ int main(int argc, char* argv[]) {
             }
         }
         else if (app_state == STATE_RADIO_ADD_STATIONS) {
-            // Station selection screen
-            int station_count = 0;
-            const CuratedStation* stations = Radio_getCuratedStations(add_selected_country_code, &station_count);
+            // Station selection screen: rows of the filtered view
+            int station_count = add_station_rows;
+
+            // Probe the rows around the selection once it leaves the window probed
+            if (station_count > 0 && (add_probe_first < 0 || add_station_selected < add_probe_first ||
+                                      add_station_selected >= add_probe_first + ADD_PROBE_WINDOW)) {
+                add_probe_first = MAX(0, add_station_selected - ADD_PROBE_WINDOW / 4);
+                Radio_probeCuratedStations(add_probe_first, ADD_PROBE_WINDOW);
+            }
+
+            // Redraw as probe results come in
+            uint32_t probe_generation = Radio_getProbeGeneration();
+            if (probe_generation != add_probe_generation) {
+                add_probe_generation = probe_generation;
+                dirty = 1;
+            }
 
             if (PAD_justRepeated(BTN_UP) && station_count > 0) {
                 add_station_selected = (add_station_selected > 0) ? add_station_selected - 1 : station_count - 1;
@@ -787,25 +1720,46 @@ int main(int argc, char* argv[]) {
             }
             else if (PAD_justPressed(BTN_A) && station_count > 0) {
                 // Toggle station selection (allow toggling all stations)
-                if (add_station_selected < 256) {
-                    add_station_checked[add_station_selected] = !add_station_checked[add_station_selected];
+                int station = Radio_getCuratedViewStation(add_station_selected);
+                if (station >= 0 && station < add_station_count) {
+                    add_station_checked[station] = !add_station_checked[station];
                     dirty = 1;
                 }
             }
+            else if (PAD_justPressed(BTN_Y)) {
+                // Filter by name or genre; typing on from the last filter narrows it
+                char* query = YouTube_openKeyboard("Filter:");
+                // Reset button state and re-poll to prevent keyboard B press from triggering back
+                PAD_reset();
+                PAD_poll();
+                PAD_reset();
+                if (query) {
+                    snprintf(add_station_query, sizeof(add_station_query), "%s", query);
+                    free(query);
+                    add_station_rows = Radio_openCuratedView(add_selected_country_code, add_station_query);
+                    add_station_selected = 0;
+                    add_station_scroll = 0;
+                    add_probe_first = -1;
+                }
+                dirty = 1;
+            }
             else if (PAD_justPressed(BTN_X)) {
                 // Add/remove stations based on checked state
+                // (all of the country's stations, filtered out or not)
                 int added = 0;
                 int removed = 0;
-                for (int i = 0; i < station_count && i < 256; i++) {
-                    bool exists = Radio_stationExists(stations[i].url);
+                CuratedStation station;
+                for (int i = 0; i < add_station_count; i++) {
+                    if (!Radio_getCuratedStation(add_selected_country_code, i, &station)) continue;
+                    bool exists = Radio_stationExists(station.url);
                     if (add_station_checked[i] && !exists) {
                         // Add new station
-                        if (Radio_addStation(stations[i].name, stations[i].url, stations[i].genre, stations[i].slogan) >= 0) {
+                        if (Radio_addStation(station.name, station.url, station.genre, station.slogan) >= 0) {
                             added++;
                         }
                     } else if (!add_station_checked[i] && exists) {
                         // Remove unchecked station
-                        if (Radio_removeStationByUrl(stations[i].url)) {
+                        if (Radio_removeStationByUrl(station.url)) {
                             removed++;
                         }
                     }
@@ -814,12 +1768,26 @@ int main(int argc, char* argv[]) {
                     Radio_saveStations();
                 }
                 // Clear selections and go back
-                memset(add_station_checked, 0, sizeof(add_station_checked));
+                free(add_station_checked);
+                add_station_checked = NULL;
+                add_station_count = 0;
                 app_state = STATE_RADIO_LIST;
                 dirty = 1;
             }
             else if (PAD_justPressed(BTN_B)) {
-                app_state = STATE_RADIO_ADD;
+                if (add_station_query[0]) {
+                    // Clear the filter first
+                    add_station_query[0] = '\0';
+                    add_station_rows = Radio_openCuratedView(add_selected_country_code, add_station_query);
+                    add_station_selected = 0;
+                    add_station_scroll = 0;
+                    add_probe_first = -1;
+                } else {
+                    free(add_station_checked);
+                    add_station_checked = NULL;
+                    add_station_count = 0;
+                    app_state = STATE_RADIO_ADD;
+                }
                 dirty = 1;
             }
         }
@@ -846,11 +1814,11 @@ int main(int argc, char* argv[]) {
         else if (app_state == STATE_YOUTUBE_MENU) {
             if (PAD_justRepeated(BTN_UP)) {
                 youtube_menu_selected = (youtube_menu_selected > 0) ? youtube_menu_selected - 1 : YOUTUBE_MENU_COUNT - 1;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justRepeated(BTN_DOWN)) {
                 youtube_menu_selected = (youtube_menu_selected < YOUTUBE_MENU_COUNT - 1) ? youtube_menu_selected + 1 : 0;
-                dirty = 1;
+                dirty |= DIRTY_SELECTION;
             }
             else if (PAD_justPressed(BTN_A)) {
                 if (youtube_menu_selected == 0) {
@@ -860,7 +1828,7 @@ int main(int argc, char* argv[]) {
                     PAD_reset();
                     PAD_poll();
                     PAD_reset();
-                    if (query && strlen(query) > 0) {
+                    if (query && strlen(query) > 0 && YouTube_searchStart(query, YOUTUBE_MAX_RESULTS) == 0) {
                         strncpy(youtube_search_query, query, sizeof(youtube_search_query) - 1);
                         youtube_search_query[sizeof(youtube_search_query) - 1] = '\0';
                         youtube_searching = true;
@@ -882,14 +1850,38 @@ int main(int argc, char* argv[]) {
                     YouTube_startUpdate();
                     app_state = STATE_YOUTUBE_UPDATING;
                     dirty = 1;
+                } else if (youtube_menu_selected == 3) {
+                    // Parallel downloads: cycle 1..max (taken up by the next batch)
+                    int workers = YouTube_getDownloadWorkers();
+                    YouTube_setDownloadWorkers(workers < YOUTUBE_DOWNLOAD_WORKERS_MAX ? workers + 1 : 1);
+                    dirty = 1;
+                } else if (youtube_menu_selected == 4) {
+                    // Download format: M4A <-> MP3 (taken up by the next item)
+                    YouTube_setDownloadFormat((YouTube_getDownloadFormat() + 1) % YOUTUBE_FORMAT_COUNT);
+                    dirty = 1;
                 }
             }
             else if (PAD_justPressed(BTN_B)) {
+                YouTube_searchRelease();
+                youtube_stream_stop();
                 app_state = STATE_MENU;
                 dirty = 1;
             }
         }
+        else if (app_state == STATE_YOUTUBE_SEARCHING) {
+            if (PAD_justPressed(BTN_B)) {
+                YouTube_cancelSearch();
+                youtube_searching = false;
+                app_state = STATE_YOUTUBE_MENU;
+                dirty = 1;
+            }
+        }
         else if (app_state == STATE_YOUTUBE_RESULTS) {
+            // Thumbnails of more rows arrived
+            if (YouTubeThumbs_takeUpdate()) {
+                dirty = 1;
+            }
+
             if (PAD_justRepeated(BTN_UP) && youtube_result_count > 0) {
                 if (youtube_results_selected < 0) {
                     youtube_results_selected = youtube_result_count - 1;  // From no selection, go to last
@@ -928,7 +1920,27 @@ int main(int argc, char* argv[]) {
                 youtube_toast_time = SDL_GetTicks();
                 dirty = 1;
             }
+            else if (PAD_justPressed(BTN_Y) && youtube_result_count > 0 && youtube_results_selected >= 0) {
+                // Play now: start or stop playing the result while it downloads
+                YouTubeResult* result = &youtube_results[youtube_results_selected];
+                bool playing = strcmp(youtube_stream_id, result->video_id) == 0;
+                youtube_stream_stop();
+                if (playing) {
+                    snprintf(youtube_toast_message, sizeof(youtube_toast_message), "Stopped");
+                } else if (YouTube_streamStart(result) == 0) {
+                    snprintf(youtube_stream_id, sizeof(youtube_stream_id), "%s", result->video_id);
+                    snprintf(youtube_toast_message, sizeof(youtube_toast_message), "Starting playback...");
+                } else {
+                    snprintf(youtube_toast_message, sizeof(youtube_toast_message), "Playback failed");
+                }
+                youtube_toast_time = SDL_GetTicks();
+                dirty = 1;
+            }
             else if (PAD_justPressed(BTN_B)) {
+                if (youtube_searching) {
+                    YouTube_cancelSearch();
+                    youtube_searching = false;
+                }
                 youtube_toast_message[0] = '\0';  // Clear toast
                 GFX_clearLayers(LAYER_SCROLLTEXT);  // Clear scroll layer when leaving
                 app_state = STATE_YOUTUBE_MENU;
@@ -978,8 +1990,9 @@ int main(int argc, char* argv[]) {
         }
         else if (app_state == STATE_YOUTUBE_DOWNLOADING) {
             YouTube_update();
-            const YouTubeDownloadStatus* status = YouTube_getDownloadStatus();
-            if (status->state != YOUTUBE_STATE_DOWNLOADING) {
+            YouTubeDownloadStatus status;
+            YouTube_getDownloadStatus(&status);
+            if (status.state != YOUTUBE_STATE_DOWNLOADING) {
                 // Download finished
                 app_state = STATE_YOUTUBE_QUEUE;
             }
@@ -1054,8 +2067,250 @@ int main(int argc, char* argv[]) {
 
         PWR_update(&dirty, &show_setting, NULL, NULL);
 
+        // Burst-decode with a large buffer while nobody is looking at the screen,
+        // and hold the work only the screen needs (cover lookups and decodes)
+        Player_setPowerSave(screen_off);
+        Radio_setPowerSave(screen_off);
+        radio_album_art_setSuspended(screen_off);
+        Governor_update(screen_off);
+        MemPressure_update();
+        Maintenance_update(screen_off);
+        YouTube_setThrottle(Governor_playbackStrained());
+        if (Library_update()) {
+            // Record indexes changed with the index: rebuild the queue, run the search
+            // and list the albums again
+            AlbumThumbs_reset();
+            if (Queue_isActive()) {
+                refresh_queue();
+                dirty = 1;
+            }
+            if (app_state == STATE_LIBRARY_RESULTS) {
+                library_result_count = Library_search(library_search_query, library_results, LIBRARY_MAX_RESULTS);
+                if (library_results_selected >= library_result_count) library_results_selected = 0;
+                dirty = 1;
+            }
+            if (app_state == STATE_ALBUM_GRID) {
+                album_grid_count = Library_albums(NULL, album_grid, ALBUM_GRID_MAX);
+                if (album_grid_selected >= album_grid_count) album_grid_selected = 0;
+                dirty = 1;
+            }
+        }
+
+        // Completion callbacks of background jobs (the waveform overview lands here)
+        if (Jobs_poll() && app_state == STATE_PLAYING) {
+            dirty = 1;
+        }
+
+        // Network work parked while offline goes once the network is back
+        NetJobs_poll();
+        prewarm_update();
+
+        // Radio buffers go back to the heap a while after the radio stops
+        Radio_releaseIdle();
+
+        // Keep the session snapshot current while something plays (a crash or a
+        // dead battery loses at most SESSION_SAVE_MS)
+        if ((Player_getState() == PLAYER_STATE_PLAYING || Radio_isActive()) &&
+            SDL_GetTicks() - session_saved_at >= SESSION_SAVE_MS) {
+            session_save();
+        }
+
+        // Changed settings go to the SD card once they settle
+        Settings_poll();
+
+        // Resume points of long files, sampled from the playback clock
+        if (SDL_GetTicks() - bookmark_sampled_at >= BOOKMARK_SAVE_MS) bookmark_update();
+        Bookmarks_poll();
+
+        // YouTube results come in while yt-dlp prints them: show the list with the first
+        if (youtube_searching) {
+            bool done;
+            if (YouTube_searchPoll(youtube_results, &youtube_result_count, &done)) {
+                dirty = 1;
+            }
+            if (app_state == STATE_YOUTUBE_SEARCHING && youtube_result_count > 0) {
+                app_state = STATE_YOUTUBE_RESULTS;
+                // Reset button state to prevent auto-add from lingering keyboard button press
+                PAD_reset();
+            }
+            if (done) {
+                youtube_searching = false;
+                if (app_state == STATE_YOUTUBE_SEARCHING) {
+                    // No results or error - go back to menu
+                    app_state = STATE_YOUTUBE_MENU;
+                }
+            }
+        }
+
+        // Play now: start on the file once it holds a few seconds of audio; once it's
+        // all written (or the download failed) playback runs to the file's real end
+        if (youtube_stream_id[0]) {
+            YouTubeStreamStatus stream;
+            if (YouTube_streamPoll(&stream)) {
+                if (stream.state == YOUTUBE_STREAM_READY) {
+                    Player_setGrowingFile(stream.filepath, stream.duration_ms);
+                } else {
+                    Player_endGrowingFile();
+                }
+                if (!youtube_stream_playing &&
+                    (stream.state == YOUTUBE_STREAM_READY || stream.state == YOUTUBE_STREAM_COMPLETE)) {
+                    if (Player_load(stream.filepath) == 0) {
+                        Player_play();
+                        youtube_stream_playing = true;
+                        if (!autosleep_disabled) {
+                            PWR_disableAutosleep();
+                            autosleep_disabled = true;
+                        }
+                    }
+                }
+                if (stream.state == YOUTUBE_STREAM_FAILED && !youtube_stream_playing) {
+                    youtube_stream_id[0] = '\0';
+                    snprintf(youtube_toast_message, sizeof(youtube_toast_message), "Playback failed");
+                    youtube_toast_time = SDL_GetTicks();
+                }
+                dirty = 1;
+            }
+            if (youtube_stream_playing && Player_getState() == PLAYER_STATE_STOPPED) {
+                youtube_stream_stop();
+                dirty = 1;
+            }
+        }
+
+#ifdef AUDIO_STATS
+        // Refresh the telemetry overlay every second and dump it to the log every 10
+        {
+            static uint32_t last_overlay = 0, last_dump = 0;
+            uint32_t now = SDL_GetTicks();
+            if (now - last_overlay >= 1000) {
+                last_overlay = now;
+                dirty = 1;
+            }
+            if (now - last_dump >= 10000) {
+                last_dump = now;
+                PlayerStats ps;
+                RadioStats rs;
+                Player_getStats(&ps);
+                Radio_getStats(&rs);
+                LOG_info("stats: underruns %u silence %llu trylock %u buf %d/%dms dec %dus cb %dus +-%dus "
+                         "plan %d-%dms %dKB stall %dms cost %d%% | "
+                         "radio rebuf %u underruns %u ring %.2f/%.2f net %dkbps/%u dec %dkbps/%u bits %.2f target %dms reconn %u/%ums\n",
+                         ps.underruns, (unsigned long long)ps.silence_frames, ps.trylock_misses,
+                         ps.buffer_min_ms, ps.buffer_avg_ms, ps.decode_chunk_us,
+                         ps.callback_interval_us, ps.callback_jitter_us,
+                         ps.buffer_low_ms, ps.buffer_high_ms, ps.buffer_capacity_kb,
+                         ps.read_stall_ms, ps.decode_cost_pct,
+                         rs.rebuffers, rs.underruns, rs.buffer_min, rs.buffer_avg,
+                         rs.net_kbps, rs.net_waits, rs.decode_kbps, rs.decode_waits, rs.bitstream_fill,
+                         rs.target_ms, rs.reconnects, rs.outage_max_ms);
+                RadioNetStats ns;
+                radio_net_getStats(&ns);
+                LOG_info("stats: setup avg/max dns %d/%dms connect %d/%dms tls %d/%dms ttfb %d/%dms "
+                         "timeouts %u/%u/%u/%u fallbacks %u tls arena %u/%u/%uKB oom %u\n",
+                         ns.avg_ms[RADIO_NET_PHASE_DNS], ns.max_ms[RADIO_NET_PHASE_DNS],
+                         ns.avg_ms[RADIO_NET_PHASE_CONNECT], ns.max_ms[RADIO_NET_PHASE_CONNECT],
+                         ns.avg_ms[RADIO_NET_PHASE_TLS], ns.max_ms[RADIO_NET_PHASE_TLS],
+                         ns.avg_ms[RADIO_NET_PHASE_FIRST_BYTE], ns.max_ms[RADIO_NET_PHASE_FIRST_BYTE],
+                         ns.timeouts[RADIO_NET_PHASE_DNS], ns.timeouts[RADIO_NET_PHASE_CONNECT],
+                         ns.timeouts[RADIO_NET_PHASE_TLS], ns.timeouts[RADIO_NET_PHASE_FIRST_BYTE],
+                         ns.fallbacks, ns.tls_in_use_kb, ns.tls_peak_kb, ns.tls_arena_kb,
+                         ns.tls_alloc_failures);
+                RadioNetTraffic traffic;
+                radio_net_getTraffic(&traffic);
+                char accounts[256];
+                int len = 0;
+                for (int i = 0; i < RADIO_NET_ACCOUNT_COUNT && len < (int)sizeof(accounts); i++) {
+                    len += snprintf(accounts + len, sizeof(accounts) - len, " %s %llu/%lluKB",
+                                    radio_net_accountName(i), (unsigned long long)(traffic.in[i] / 1024),
+                                    (unsigned long long)(traffic.out[i] / 1024));
+                }
+                LOG_info("stats: traffic in/out%s saver %s capped %u\n", accounts,
+                         radio_net_dataSaver() ? "on" : "off", traffic.capped);
+            }
+        }
+#endif
+
+#ifdef MEM_STATS
+        // Refresh the memory overlay every second and log it every 10
+        {
+            static uint32_t last_mem_overlay = 0, last_mem_dump = 0;
+            uint32_t now = SDL_GetTicks();
+            if (now - last_mem_overlay >= 1000) {
+                last_mem_overlay = now;
+                dirty = 1;
+            }
+            if (now - last_mem_dump >= 10000) {
+                last_mem_dump = now;
+                MemStats_log();
+            }
+        }
+#endif
+
+#ifdef LATENCY_STATS
+        // Refresh the latency overlay every second and log the histograms every 10
+        {
+            static uint32_t last_latency_overlay = 0, last_latency_dump = 0;
+            uint32_t now = SDL_GetTicks();
+            if (now - last_latency_overlay >= 1000) {
+                last_latency_overlay = now;
+                dirty = 1;
+            }
+            if (now - last_latency_dump >= 10000) {
+                last_latency_dump = now;
+                Latency_log();
+            }
+        }
+#endif
+
+#ifdef ENERGY_PROFILE
+        {
+            YouTubeDownloadStatus dl;
+            YouTube_getDownloadStatus(&dl);
+            EnergyAudio audio = Radio_isActive() ? ENERGY_AUDIO_RADIO :
+                                Player_getState() == PLAYER_STATE_PLAYING ? ENERGY_AUDIO_MUSIC : ENERGY_AUDIO_IDLE;
+            Energy_setState(energy_view(), screen_off, audio, dl.state == YOUTUBE_STATE_DOWNLOADING);
+        }
+#endif
+
+#ifdef UI_PROFILE
+        // Refresh the profiling overlay every second and log it every 10
+        if (Profile_tick()) {
+            static int reports = 0;
+            dirty = 1;
+            if (++reports % 10 == 0) {
+                const ProfileReport* pr = Profile_getReport();
+                LOG_info("profile: frames %u idle %u p50 %uus p95 %uus p99 %uus max %uus cpu %.1f%%\n",
+                         pr->frames, pr->idle, pr->p50_us, pr->p95_us, pr->p99_us, pr->max_us, pr->process_cpu);
+                for (int i = 0; i < pr->section_count; i++) {
+                    const ProfileSection* ps = &pr->sections[i];
+                    if (ps->calls == 0) continue;
+                    LOG_info("profile:   %-28s %5u calls avg %6uus max %6uus %5.1f%%\n",
+                             ps->name, ps->calls, ps->avg_us, ps->max_us, ps->share);
+                }
+                for (int i = 0; i < pr->thread_count; i++) {
+                    LOG_info("profile:   thread %d %-16s %5.1f%%\n",
+                             pr->threads[i].tid, pr->threads[i].name, pr->threads[i].cpu);
+                }
+            }
+        }
+#endif
+
+        // Selection moves only come from input
+        if (dirty & DIRTY_SELECTION) LATENCY_BEGIN(LATENCY_NAV, false);
+
+        // A press that came in while this iteration ran is handled before the frame
+        // is drawn and flipped (the flip waits for vsync): the next frame shows both,
+        // and a slow frame never sits between a press and its handling
+        if (dirty && !screen_off && render_deferred < RENDER_DEFER_MAX && input_pending()) {
+            render_deferred++;
+            PROFILE_FRAME_END(false);
+            continue;
+        }
+        render_deferred = 0;
+
         // Skip rendering when screen is off to save power
         if (dirty && !screen_off) {
+            UI_beginFrame(dirty == DIRTY_SELECTION && !show_quit_confirm);
+
             // Clear scroll layer on any full redraw - states with scrolling will re-render it
             GFX_clearLayers(LAYER_SCROLLTEXT);
 
@@ -1074,8 +2329,16 @@ int main(int argc, char* argv[]) {
                 case STATE_BROWSER:
                     render_browser(screen, show_setting, &browser);
                     break;
+                case STATE_LIBRARY_RESULTS:
+                    render_library_results(screen, show_setting, library_search_query, library_results,
+                                           library_result_count, library_results_selected, &library_results_scroll);
+                    break;
+                case STATE_ALBUM_GRID:
+                    render_album_grid(screen, show_setting, album_grid, album_grid_count, album_grid_selected,
+                                      &album_grid_scroll);
+                    break;
                 case STATE_PLAYING:
-                    render_playing(screen, show_setting, &browser, shuffle_enabled, repeat_enabled);
+                    render_playing(screen, show_setting, current_track() + 1, track_count(), shuffle_enabled, repeat_enabled);
                     break;
                 case STATE_RADIO_LIST:
                     render_radio_list(screen, show_setting, radio_selected, &radio_scroll);
@@ -1087,8 +2350,9 @@ int main(int argc, char* argv[]) {
                     render_radio_add(screen, show_setting, add_country_selected, &add_country_scroll);
                     break;
                 case STATE_RADIO_ADD_STATIONS:
-                    render_radio_add_stations(screen, show_setting, add_selected_country_code,
-                                              add_station_selected, &add_station_scroll, add_station_checked);
+                    render_radio_add_stations(screen, show_setting, add_selected_country_code, add_station_query,
+                                              add_station_selected, &add_station_scroll,
+                                              add_station_checked, add_station_count);
                     break;
                 case STATE_RADIO_HELP:
                     render_radio_help(screen, show_setting, &help_scroll);
@@ -1103,7 +2367,8 @@ int main(int argc, char* argv[]) {
                     render_youtube_results(screen, show_setting, youtube_search_query,
                                            youtube_results, youtube_result_count,
                                            youtube_results_selected, &youtube_results_scroll,
-                                           youtube_toast_message, youtube_toast_time, youtube_searching);
+                                           youtube_toast_message, youtube_toast_time, youtube_searching,
+                                           youtube_stream_id);
                     break;
                 case STATE_YOUTUBE_QUEUE:
                     render_youtube_queue(screen, show_setting, youtube_queue_selected, &youtube_queue_scroll);
@@ -1122,11 +2387,28 @@ int main(int argc, char* argv[]) {
                     break;
             }
 
+#ifdef AUDIO_STATS
+            render_audio_stats(screen);
+#endif
+#ifdef UI_PROFILE
+            render_profile_stats(screen);
+#endif
+#ifdef MEM_STATS
+            render_mem_stats(screen);
+#endif
+#ifdef LATENCY_STATS
+            render_latency_stats(screen);
+#endif
+
             if (show_setting) {
                 GFX_blitHardwareHints(screen, show_setting);
             }
 
-            GFX_flip(screen);
+            {
+                PROFILE_SCOPE("GFX_flip");
+                GFX_flip(screen);
+            }
+            LATENCY_FLIPPED();
             dirty = 0;
 
             // Keep refreshing while toast is visible
@@ -1135,27 +2417,31 @@ int main(int argc, char* argv[]) {
                     dirty = 1;
                 }
             }
-
-            // Perform YouTube search after rendering the searching screen
-            if (app_state == STATE_YOUTUBE_SEARCHING && youtube_searching) {
-                youtube_result_count = YouTube_search(youtube_search_query, youtube_results, YOUTUBE_MAX_RESULTS);
-                youtube_searching = false;
-                if (youtube_result_count > 0) {
-                    app_state = STATE_YOUTUBE_RESULTS;
-                    // Reset button state to prevent auto-add from lingering keyboard button press
-                    PAD_reset();
-                } else {
-                    // No results or error - go back to menu
-                    app_state = STATE_YOUTUBE_MENU;
-                }
-                dirty = 1;
-            }
-        } else if (!screen_off) {
-            GFX_sync();
+            PROFILE_FRAME_END(true);
+        } else if (!screen_off && (screen_animating() || PAD_anyPressed())) {
+            // Animations run at the display rate, and held buttons repeat on time;
+            // queued input is read at once rather than after the frame's wait
+            PROFILE_FRAME_END(false);
+            if (!input_pending()) GFX_sync();
+        } else {
+            // Nothing to draw: sleep until input, or until background work is due a look
+            PROFILE_FRAME_END(false);
+            SDL_WaitEventTimeout(NULL, idle_timeout_ms());
         }
     }
 
 cleanup:
+    // Persistent state first; from here on work in flight is abandoned, not
+    // waited for: every network wait fails at once and child processes are killed
+    session_save();
+    bookmark_update();
+    uint32_t quit_start = SDL_GetTicks();
+    radio_net_abortAll();
+    TRACE_DUMP();
+#ifdef ENERGY_PROFILE
+    Energy_stop();
+#endif
+
     // Ensure screen is back on and autosleep is re-enabled
     if (screen_off) {
         PLAT_enableBacklight(1);
@@ -1174,12 +2460,31 @@ cleanup:
 
     SelfUpdate_cleanup();
     YouTube_cleanup();
+    radio_catalog_quit();
     Radio_quit();
     cleanup_album_art_background();  // Clean up cached background surface
     Spectrum_quit();
+    TrackMeta_quit();
+    Maintenance_quit();
+    AlbumThumbs_quit();
+    YouTubeThumbs_quit();
+    Library_quit();
     Player_quit();
     Browser_freeEntries(&browser);
+    Browser_clearCache();
+    Shuffle_free();
+    Queue_close();
+    NetJobs_quit();
+    Jobs_quit();
+    Settings_quit();
+    Bookmarks_quit();
+    LOG_info("Quit: shut down in %u ms\n", (unsigned)(SDL_GetTicks() - quit_start));
+#ifdef MEM_STATS
+    // Anything still counted now was never given back
+    MemStats_log();
+#endif
     unload_custom_fonts();
+    Log_asyncQuit();
 
     QuitSettings();
     PWR_quit();
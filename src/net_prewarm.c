@@ -0,0 +1,93 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "net_prewarm.h"
+#include "netjobs.h"
+#include "radio_net.h"
+#include "radio.h"
+
+#define PREWARM_HOSTS 16                // Hosts remembered as warm
+
+typedef struct {
+    char urls[NET_PREWARM_MAX][RADIO_MAX_URL];
+    int count;
+    bool connect;
+} PrewarmRequest;
+
+// Hosts warmed recently (the jobs run on workers)
+typedef struct {
+    char host[256];
+    uint64_t warmed_ms;
+} WarmHost;
+
+static pthread_mutex_t warm_mutex = PTHREAD_MUTEX_INITIALIZER;
+static WarmHost warm_hosts[PREWARM_HOSTS];
+
+static uint64_t prewarm_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Claim host for a warm-up; false if it was warmed within the TTL
+static bool claim_host(const char* host) {
+    uint64_t now = prewarm_now_ms();
+    pthread_mutex_lock(&warm_mutex);
+    WarmHost* slot = &warm_hosts[0];
+    for (int i = 0; i < PREWARM_HOSTS; i++) {
+        WarmHost* h = &warm_hosts[i];
+        if (strcmp(h->host, host) == 0) {
+            slot = h;
+            break;
+        }
+        if (h->warmed_ms < slot->warmed_ms) slot = h;
+    }
+    bool fresh = strcmp(slot->host, host) == 0 && slot->warmed_ms && now - slot->warmed_ms < NET_PREWARM_TTL_MS;
+    if (!fresh) {
+        snprintf(slot->host, sizeof(slot->host), "%s", host);
+        slot->warmed_ms = now;
+    }
+    pthread_mutex_unlock(&warm_mutex);
+    return !fresh;
+}
+
+// A warm-up that failed doesn't count
+static void forget_host(const char* host) {
+    pthread_mutex_lock(&warm_mutex);
+    for (int i = 0; i < PREWARM_HOSTS; i++) {
+        if (strcmp(warm_hosts[i].host, host) == 0) warm_hosts[i].warmed_ms = 0;
+    }
+    pthread_mutex_unlock(&warm_mutex);
+}
+
+static void prewarm_job(void* arg, JobToken* token) {
+    PrewarmRequest* req = (PrewarmRequest*)arg;
+    for (int i = 0; i < req->count && !Jobs_cancelled(token); i++) {
+        char host[256], path[RADIO_MAX_URL];
+        int port;
+        bool is_https;
+        if (radio_net_parse_url(req->urls[i], host, sizeof(host), &port, path, sizeof(path), &is_https) != 0) continue;
+        if (!claim_host(host)) continue;
+        if (radio_net_prewarm(req->urls[i], req->connect) != 0) forget_host(host);
+    }
+}
+
+static void prewarm_done(void* arg, bool cancelled) {
+    (void)cancelled;
+    free(arg);
+}
+
+void NetPrewarm_start(const char* key, const char* const* urls, int count, bool connect) {
+    PrewarmRequest* req = calloc(1, sizeof(PrewarmRequest));
+    if (!req) return;
+    for (int i = 0; i < count && req->count < NET_PREWARM_MAX; i++) {
+        if (!urls[i] || !urls[i][0]) continue;
+        snprintf(req->urls[req->count++], RADIO_MAX_URL, "%s", urls[i]);
+    }
+    req->connect = connect;
+    if (req->count == 0 || NetJobs_post(JOB_PRIORITY_IDLE, key, prewarm_job, prewarm_done, req) != 0) free(req);
+}
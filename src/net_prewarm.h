@@ -0,0 +1,22 @@
+#ifndef __NET_PREWARM_H__
+#define __NET_PREWARM_H__
+
+#include <stdbool.h>
+
+// Network warm-up ahead of the first requests
+// The first request to a host pays a DNS lookup, a TCP connect and for HTTPS a
+// full TLS handshake, and the first HTTPS request of all seeds the DRBG. A
+// warm-up does that beforehand in an idle job (parked while offline, see
+// netjobs) through radio_net_prewarm. A host warmed less than
+// NET_PREWARM_TTL_MS ago is skipped, so coming back to a screen costs nothing.
+// Main thread.
+
+#define NET_PREWARM_MAX 8               // URLs per warm-up
+#define NET_PREWARM_TTL_MS (60 * 1000)
+
+// Warm the hosts of urls (copied; past NET_PREWARM_MAX ignored). connect: open
+// HTTPS connections too, not only look the hosts up. A newer warm-up under the
+// same key replaces one still waiting for the network.
+void NetPrewarm_start(const char* key, const char* const* urls, int count, bool connect);
+
+#endif
@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "netjobs.h"
+#include "radio_net.h"
+
+// Parked work, oldest first
+typedef struct NetJob {
+    struct NetJob* next;
+    JobPriority priority;
+    char key[32];               // "" = none
+    JobFunc run;                // NULL for a defer
+    JobDoneFunc done;
+    NetJobsFunc func;
+    void* arg;
+    bool dropped;               // Replaced or pushed out: done runs as cancelled
+} NetJob;
+
+static pthread_mutex_t netjobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+static NetJob* head = NULL;
+static NetJob* tail = NULL;
+static int live = 0;            // Parked and not dropped
+
+// Park job behind the others, dropping what it replaces (mutex held)
+static void park(NetJob* job) {
+    NetJob* oldest = NULL;
+    for (NetJob* j = head; j; j = j->next) {
+        if (j->dropped) continue;
+        if (job->key[0] && strcmp(j->key, job->key) == 0) {
+            j->dropped = true;
+            live--;
+        } else if (!oldest) {
+            oldest = j;
+        }
+    }
+    if (live >= NET_JOBS_PARKED_MAX && oldest) {
+        oldest->dropped = true;
+        live--;
+    }
+
+    job->next = NULL;
+    if (tail) tail->next = job;
+    else head = job;
+    tail = job;
+    live++;
+}
+
+static NetJob* job_new(const char* key) {
+    NetJob* job = calloc(1, sizeof(NetJob));
+    if (job && key) snprintf(job->key, sizeof(job->key), "%s", key);
+    return job;
+}
+
+int NetJobs_post(JobPriority priority, const char* key, JobFunc run, JobDoneFunc done, void* arg) {
+    // Behind work parked already, so it keeps its turn
+    pthread_mutex_lock(&netjobs_mutex);
+    bool waiting = live > 0;
+    pthread_mutex_unlock(&netjobs_mutex);
+    if (!waiting && radio_net_online()) return Jobs_post(priority, run, done, arg);
+
+    NetJob* job = job_new(key);
+    if (!job) return Jobs_post(priority, run, done, arg);
+    job->priority = priority;
+    job->run = run;
+    job->done = done;
+    job->arg = arg;
+    pthread_mutex_lock(&netjobs_mutex);
+    park(job);
+    pthread_mutex_unlock(&netjobs_mutex);
+    return 0;
+}
+
+int NetJobs_defer(const char* key, NetJobsFunc func, void* arg) {
+    NetJob* job = job_new(key);
+    if (!job) return -1;
+    job->func = func;
+    job->arg = arg;
+    pthread_mutex_lock(&netjobs_mutex);
+    park(job);
+    pthread_mutex_unlock(&netjobs_mutex);
+    return 0;
+}
+
+// Take the dropped work, or all of it (mutex held)
+static NetJob* take(bool all) {
+    NetJob* taken = NULL;
+    NetJob** taken_tail = &taken;
+    NetJob** link = &head;
+    tail = NULL;
+    while (*link) {
+        NetJob* job = *link;
+        if (all || job->dropped) {
+            *link = job->next;
+            if (!job->dropped) live--;
+            job->next = NULL;
+            *taken_tail = job;
+            taken_tail = &job->next;
+        } else {
+            tail = job;
+            link = &job->next;
+        }
+    }
+    return taken;
+}
+
+// Post, call or cancel taken work in order (main thread)
+static void release(NetJob* taken, bool cancel) {
+    while (taken) {
+        NetJob* job = taken;
+        taken = job->next;
+        if (job->dropped || cancel) {
+            if (job->done) job->done(job->arg, true);
+        } else if (job->func) {
+            job->func(job->arg);
+        } else if (Jobs_post(job->priority, job->run, job->done, job->arg) != 0) {
+            if (job->done) job->done(job->arg, true);
+        }
+        free(job);
+    }
+}
+
+bool NetJobs_poll(void) {
+    pthread_mutex_lock(&netjobs_mutex);
+    if (!head) {
+        pthread_mutex_unlock(&netjobs_mutex);
+        return false;
+    }
+    bool online = live > 0 && radio_net_online();
+    NetJob* taken = take(online);
+    pthread_mutex_unlock(&netjobs_mutex);
+
+    bool any = taken != NULL;
+    release(taken, false);
+    return any;
+}
+
+int NetJobs_parked(void) {
+    pthread_mutex_lock(&netjobs_mutex);
+    int count = live;
+    pthread_mutex_unlock(&netjobs_mutex);
+    return count;
+}
+
+void NetJobs_quit(void) {
+    pthread_mutex_lock(&netjobs_mutex);
+    NetJob* taken = take(true);
+    pthread_mutex_unlock(&netjobs_mutex);
+    release(taken, true);
+}
@@ -0,0 +1,43 @@
+#ifndef __NETJOBS_H__
+#define __NETJOBS_H__
+
+#include <stdbool.h>
+
+#include "jobs.h"
+
+// Network work that waits for connectivity
+// Background work that needs the network goes through here instead of straight
+// to the job pool. Online (radio_net_online) it is posted at once; offline it
+// is parked instead of running only to time out, and posted in order once
+// NetJobs_poll sees the network back. Parking costs no thread and no timer:
+// the main loop's poll is all that looks. Work posted under a key replaces
+// parked work of the same key (its done runs with cancelled set), so a lookup
+// asked for again and again while offline runs once. Past NET_JOBS_PARKED_MAX
+// the oldest parked work is dropped the same way. Safe from any thread.
+
+#define NET_JOBS_PARKED_MAX 32
+
+// A callback for the main thread once online (NetJobs_defer)
+typedef void (*NetJobsFunc)(void* arg);
+
+// Jobs_post(priority, run, done, arg) now or once online
+// key: NULL, or a name parked work is deduplicated by.
+// Returns 0 if posted or parked, -1 if the pool isn't running (arg untouched).
+int NetJobs_post(JobPriority priority, const char* key, JobFunc run, JobDoneFunc done, void* arg);
+
+// Call func(arg) on the main thread: from NetJobs_poll once online (at the
+// next poll if online already). A newer defer under the same key replaces it.
+// Returns 0, or -1 if out of memory.
+int NetJobs_defer(const char* key, NetJobsFunc func, void* arg);
+
+// Post or call the parked work if the network is back (main loop)
+// Returns true if any went.
+bool NetJobs_poll(void);
+
+// Parked work waiting for the network
+int NetJobs_parked(void);
+
+// Drop parked work, dones run as cancelled (main thread, before Jobs_quit)
+void NetJobs_quit(void);
+
+#endif
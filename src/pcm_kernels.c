@@ -0,0 +1,198 @@
+#include "pcm_kernels.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Scalar element conversions, the reference every kernel's tail runs
+static inline int16_t s32_to_s16(int32_t v) { return (int16_t)(v >> 16); }
+static inline int32_t s32_to_s32(int32_t v) { return v; }
+static inline float s32_to_f32(int32_t v) { return v * (1.0f / 2147483648.0f); }   // drflac's own f32
+
+static inline int16_t f32_to_s16_sat(float v) {
+    if (v > 32767.0f) v = 32767.0f;
+    if (v < -32768.0f) v = -32768.0f;
+    return (int16_t)v;
+}
+
+static inline int16_t q15_mul_sat(int16_t v, int16_t g) {
+    int32_t r = (2 * (int32_t)v * g + (1 << 15)) >> 16;
+    return (int16_t)(r > 32767 ? 32767 : r);
+}
+
+// ============ UPMIX ============
+
+#if defined(__ARM_NEON)
+// vec: NEON type stem (int16x8), lanes: elements per vector, sfx: intrinsic suffix
+#define UPMIX_NEON(vec, lanes, sfx)                                     \
+    for (; i + lanes <= frames; i += lanes) {                           \
+        vec##_t m = vld1q_##sfx(&mono[i]);                              \
+        vec##x2_t lr = vzipq_##sfx(m, m);                               \
+        vst1q_##sfx(&stereo[i * 2], lr.val[0]);                         \
+        vst1q_##sfx(&stereo[i * 2 + lanes], lr.val[1]);                 \
+    }
+#else
+#define UPMIX_NEON(vec, lanes, sfx)
+#endif
+
+#define UPMIX_KERNEL(name, type, vec, lanes, sfx)                       \
+    void name(const type* mono, type* stereo, size_t frames) {          \
+        size_t i = 0;                                                   \
+        UPMIX_NEON(vec, lanes, sfx)                                     \
+        for (; i < frames; i++) {                                       \
+            type sample = mono[i];                                      \
+            stereo[i * 2] = sample;                                     \
+            stereo[i * 2 + 1] = sample;                                 \
+        }                                                               \
+    }
+
+UPMIX_KERNEL(Pcm_upmixS16, int16_t, int16x8, 8, s16)
+UPMIX_KERNEL(Pcm_upmixS32, int32_t, int32x4, 4, s32)
+UPMIX_KERNEL(Pcm_upmixF32, float, float32x4, 4, f32)
+
+void Pcm_upmixInPlaceS16(int16_t* samples, size_t frames) {
+    size_t i = frames;
+    // Odd frames at the top first; then each block's stores land at or above
+    // the next block's input
+    for (; i % 8; i--) samples[(i - 1) * 2] = samples[(i - 1) * 2 + 1] = samples[i - 1];
+#if defined(__ARM_NEON)
+    for (; i >= 8; i -= 8) {
+        int16x8_t m = vld1q_s16(&samples[i - 8]);
+        vst2q_s16(&samples[(i - 8) * 2], (int16x8x2_t){{m, m}});
+    }
+#endif
+    for (; i > 0; i--) samples[(i - 1) * 2] = samples[(i - 1) * 2 + 1] = samples[i - 1];
+}
+
+void Pcm_takeLeftS16(const int16_t* in, int16_t* out, size_t frames) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 8 <= frames; i += 8) vst1q_s16(&out[i], vld2q_s16(&in[i * 2]).val[0]);
+#endif
+    for (; i < frames; i++) out[i] = in[i * 2];
+}
+
+// ============ FORMAT CONVERSION ============
+
+void Pcm_s16ToF32(const int16_t* in, float* out, size_t samples) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    const float32x4_t scale = vdupq_n_f32(1.0f / 32768.0f);
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t v = vld1q_s16(&in[i]);
+        vst1q_f32(&out[i], vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(&out[i + 4], vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+#endif
+    for (; i < samples; i++) out[i] = in[i] / 32768.0f;
+}
+
+void Pcm_planarF32ToS16(float* const* in, int channels, int16_t* out, size_t frames) {
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    // vcvtq truncates like the scalar cast, vqmovn saturates
+    const float32x4_t scale = vdupq_n_f32(32767.0f);
+    for (; i + 4 <= frames; i += 4) {
+        int16x4_t l = vqmovn_s32(vcvtq_s32_f32(vmulq_f32(vld1q_f32(&in[0][i]), scale)));
+        if (channels == 1) {
+            vst1_s16(&out[i], l);
+        } else {
+            int16x4_t r = vqmovn_s32(vcvtq_s32_f32(vmulq_f32(vld1q_f32(&in[1][i]), scale)));
+            vst2_s16(&out[i * 2], (int16x4x2_t){{l, r}});
+        }
+    }
+#endif
+    for (; i < frames; i++) {
+        for (int c = 0; c < channels; c++) out[i * channels + c] = f32_to_s16_sat(in[c][i] * 32767.0f);
+    }
+}
+
+// ============ GAIN ============
+
+void Pcm_gainS16(int16_t* samples, size_t frames, int16_t start, int16_t target) {
+    size_t blocks = frames / 4;
+    int32_t delta = (int32_t)target - start;
+    size_t i = 0;
+
+    for (size_t blk = 0; blk < blocks; blk++, i += 8) {
+        int16_t g = (int16_t)(start + (delta * (int32_t)(blk + 1)) / (int32_t)blocks);
+#if defined(__ARM_NEON)
+        vst1q_s16(&samples[i], vqrdmulhq_s16(vld1q_s16(&samples[i]), vdupq_n_s16(g)));
+#else
+        for (int j = 0; j < 8; j++) samples[i + j] = q15_mul_sat(samples[i + j], g);
+#endif
+    }
+
+    // Leftover frames (< 4) at target gain
+    for (; i < frames * 2; i++) samples[i] = q15_mul_sat(samples[i], target);
+}
+
+void Pcm_f32ToS16Gain(const float* in, int16_t* out, size_t frames, float g0, float step) {
+    size_t n = frames * 2;
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // 4 stereo frames per iteration: gains {g, g, g+s, g+s} and {g+2s, g+2s, g+3s, g+3s}
+    // vcvtq saturates to int32 and vqmovn to int16, so overs clip instead of wrapping
+    float32x4_t gain_lo = vmulq_n_f32((float32x4_t){g0, g0, g0 + step, g0 + step}, 32768.0f);
+    float32x4_t gain_hi = vmulq_n_f32((float32x4_t){g0 + 2 * step, g0 + 2 * step,
+                                                    g0 + 3 * step, g0 + 3 * step}, 32768.0f);
+    float32x4_t gain_inc = vdupq_n_f32(4 * step * 32768.0f);
+
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t lo = vcvtq_s32_f32(vmulq_f32(vld1q_f32(&in[i]), gain_lo));
+        int32x4_t hi = vcvtq_s32_f32(vmulq_f32(vld1q_f32(&in[i + 4]), gain_hi));
+        vst1q_s16(&out[i], vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+        gain_lo = vaddq_f32(gain_lo, gain_inc);
+        gain_hi = vaddq_f32(gain_hi, gain_inc);
+    }
+#endif
+
+    for (; i < n; i++) {
+        float g = g0 + (float)(i / 2) * step;
+        out[i] = f32_to_s16_sat(in[i] * g * 32768.0f);
+    }
+}
+
+// ============ STEREO FROM INT32 ============
+
+// NEON bodies cover plain stereo input, 4 frames per iteration
+#if defined(__ARM_NEON)
+#define STEREO_NEON_S16                                                         \
+    for (; i + 4 <= frames; i += 4) {                                           \
+        int16x4_t lo = vshrn_n_s32(vld1q_s32(&in[i * 2]), 16);                  \
+        int16x4_t hi = vshrn_n_s32(vld1q_s32(&in[i * 2 + 4]), 16);              \
+        vst1q_s16(&dst[i * 2], vcombine_s16(lo, hi));                           \
+    }
+#define STEREO_NEON_F32                                                         \
+    for (; i + 4 <= frames; i += 4) {                                           \
+        const float32x4_t scale = vdupq_n_f32(1.0f / 2147483648.0f);           \
+        vst1q_f32(&dst[i * 2], vmulq_f32(vcvtq_f32_s32(vld1q_s32(&in[i * 2])), scale));         \
+        vst1q_f32(&dst[i * 2 + 4], vmulq_f32(vcvtq_f32_s32(vld1q_s32(&in[i * 2 + 4])), scale)); \
+    }
+#else
+#define STEREO_NEON_S16
+#define STEREO_NEON_F32
+#endif
+#define STEREO_COPY_S32                                                         \
+    memcpy(dst, in, frames * 2 * sizeof(int32_t));                              \
+    i = frames;
+
+#define STEREO_KERNEL(name, type, convert, stereo_body)                         \
+    void name(const int32_t* in, int channels, void* out, size_t frames) {      \
+        type* dst = (type*)out;                                                 \
+        size_t i = 0;                                                           \
+        if (channels == 2) {                                                    \
+            stereo_body                                                         \
+        }                                                                       \
+        for (; i < frames; i++) {                                               \
+            dst[i * 2] = convert(in[i * channels]);                             \
+            dst[i * 2 + 1] = convert(in[i * channels + channels - 1]);          \
+        }                                                                       \
+    }
+
+STEREO_KERNEL(Pcm_stereoS32ToS16, int16_t, s32_to_s16, STEREO_NEON_S16)
+STEREO_KERNEL(Pcm_stereoS32ToS32, int32_t, s32_to_s32, STEREO_COPY_S32)
+STEREO_KERNEL(Pcm_stereoS32ToF32, float, s32_to_f32, STEREO_NEON_F32)
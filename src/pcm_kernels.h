@@ -0,0 +1,47 @@
+#ifndef __PCM_KERNELS_H__
+#define __PCM_KERNELS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sample format conversion kernels shared by the player and radio pipelines
+// Each is generated per sample type from one template: a NEON body for whole
+// vectors and a scalar reference for the tail, which is all that runs in
+// builds without NEON. Callers pick the kernel for a stream's format once
+// (Pcm_stereoFromS32) instead of branching per sample.
+
+// Mono to interleaved stereo, front to back: mono may sit in the back half of
+// stereo (mono == stereo + frames), every step loads before it stores
+void Pcm_upmixS16(const int16_t* mono, int16_t* stereo, size_t frames);
+void Pcm_upmixS32(const int32_t* mono, int32_t* stereo, size_t frames);
+void Pcm_upmixF32(const float* mono, float* stereo, size_t frames);
+
+// Mono to stereo in place, back to front, for mono at the start of a buffer
+// with room for frames stereo frames
+void Pcm_upmixInPlaceS16(int16_t* samples, size_t frames);
+
+// Stereo to mono from the left channel, in place allowed (out == in)
+void Pcm_takeLeftS16(const int16_t* in, int16_t* out, size_t frames);
+
+// int16 to float in [-1, 1)
+void Pcm_s16ToF32(const int16_t* in, float* out, size_t samples);
+
+// Planar float (stb_vorbis) to interleaved int16, 1 or 2 channels, saturating
+void Pcm_planarF32ToS16(float* const* in, int channels, int16_t* out, size_t frames);
+
+// Interleaved stereo int16 times a Q15 gain ramping from start to target in
+// 4-frame blocks (leftover frames at target), saturating rounding multiply
+void Pcm_gainS16(int16_t* samples, size_t frames, int16_t start, int16_t target);
+
+// Float stereo to int16 times a gain ramping by step per frame from g0,
+// scaled by 32768 (16-bit sources come back bit-exact at unity) and saturating
+void Pcm_f32ToS16Gain(const float* in, int16_t* out, size_t frames, float g0, float step);
+
+// Left-justified int32 frames of channels channels (first and last taken as
+// left and right) to stereo in a stream format
+typedef void (*PcmStereoFromS32)(const int32_t* in, int channels, void* out, size_t frames);
+void Pcm_stereoS32ToS16(const int32_t* in, int channels, void* out, size_t frames);
+void Pcm_stereoS32ToS32(const int32_t* in, int channels, void* out, size_t frames);
+void Pcm_stereoS32ToF32(const int32_t* in, int channels, void* out, size_t frames);
+
+#endif
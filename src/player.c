@@ -1,18 +1,42 @@
 #include "player.h"
 #include "radio.h"
 #include "radio_album_art.h"
+#include "folder_art.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <math.h>
-#include <samplerate.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <alsa/asoundlib.h>
 #include <SDL2/SDL_image.h>
 
 #include "defines.h"
 #include "api.h"
 #include "msettings.h"
+#include "thread_role.h"
+#include "jobs.h"
+#include "readahead.h"
+#include "equalizer.h"
+#include "spectrum.h"
+#include "trace.h"
+#include "latency.h"
+#include "memstats.h"
+#include "seqlock.h"
+#include "resampler.h"
+#include "pcm_kernels.h"
+#include "time_stretch.h"
+#include "settings.h"
+#include "log_async.h"
+#include "tag_reader.h"
+#ifdef PLAYER_BENCH
+#include "bench.h"
+#endif
 
 // Include dr_libs for audio decoding (header-only libraries)
 #define DR_MP3_IMPLEMENTATION
@@ -32,34 +56,421 @@
 #include "audio/minimp4.h"
 #include "aacdec.h"
 
+// ============ DECODER POOL ============
+
+// Decoder memory (dr_libs state, the stb_vorbis arena, the M4A read-ahead window and
+// AAC tables) lives in pooled blocks. Closing a decoder hands its blocks back and the
+// next open reuses them, so track changes initialise warm memory instead of going
+// through the heap. Up to DECODER_POOL_SLOTS blocks stay cached (roughly one decoder
+// of each format plus a pre-opened next track).
+#define DECODER_POOL_SLOTS 8
+#define DECODER_POOL_MIN_BLOCK 4096    // Smaller allocations aren't worth caching
+#define DECODER_POOL_HEADER 16         // Size prefix, keeps the payload 16-byte aligned
+
+static pthread_mutex_t decoder_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static void* decoder_pool_blocks[DECODER_POOL_SLOTS];
+static Resampler* pooled_resampler = NULL;   // One idle resampler (its bank and buffer stay warm)
+
+static size_t decoder_pool_block_size(const void* p) {
+    return *(const size_t*)((const uint8_t*)p - DECODER_POOL_HEADER);
+}
+
+static void* decoder_pool_alloc(size_t size) {
+    if (size >= DECODER_POOL_MIN_BLOCK) {
+        // Smallest cached block that fits, without spending a big block on a small request
+        int best = -1;
+        pthread_mutex_lock(&decoder_pool_mutex);
+        for (int i = 0; i < DECODER_POOL_SLOTS; i++) {
+            void* block = decoder_pool_blocks[i];
+            if (!block) continue;
+            size_t block_size = decoder_pool_block_size(block);
+            if (block_size < size || block_size / 4 > size) continue;
+            if (best < 0 || block_size < decoder_pool_block_size(decoder_pool_blocks[best])) {
+                best = i;
+            }
+        }
+        void* block = NULL;
+        if (best >= 0) {
+            block = decoder_pool_blocks[best];
+            decoder_pool_blocks[best] = NULL;
+        }
+        pthread_mutex_unlock(&decoder_pool_mutex);
+        if (block) return block;
+    }
+
+    uint8_t* raw = malloc(DECODER_POOL_HEADER + size);
+    if (!raw) return NULL;
+    *(size_t*)raw = size;
+    return raw + DECODER_POOL_HEADER;
+}
+
+static void decoder_pool_free(void* p) {
+    if (!p) return;
+
+    size_t size = decoder_pool_block_size(p);
+    if (size >= DECODER_POOL_MIN_BLOCK) {
+        // Take a free slot, or replace the smallest cached block if this one is bigger
+        pthread_mutex_lock(&decoder_pool_mutex);
+        int slot = 0;
+        for (int i = 0; i < DECODER_POOL_SLOTS; i++) {
+            if (!decoder_pool_blocks[i]) {
+                slot = i;
+                break;
+            }
+            if (decoder_pool_block_size(decoder_pool_blocks[i]) <
+                decoder_pool_block_size(decoder_pool_blocks[slot])) {
+                slot = i;
+            }
+        }
+        void* evicted = decoder_pool_blocks[slot];
+        if (!evicted || decoder_pool_block_size(evicted) < size) {
+            decoder_pool_blocks[slot] = p;
+            p = evicted;
+        }
+        pthread_mutex_unlock(&decoder_pool_mutex);
+        if (!p) return;
+    }
+    free((uint8_t*)p - DECODER_POOL_HEADER);
+}
+
+static void* decoder_pool_realloc(void* p, size_t size) {
+    if (!p) return decoder_pool_alloc(size);
+
+    size_t old_size = decoder_pool_block_size(p);
+    if (size <= old_size) return p;
+
+    void* grown = decoder_pool_alloc(size);
+    if (!grown) return NULL;
+    memcpy(grown, p, old_size);
+    decoder_pool_free(p);
+    return grown;
+}
+
+// Release every cached block (on quit)
+static void decoder_pool_drain(void) {
+    pthread_mutex_lock(&decoder_pool_mutex);
+    Resampler_free(pooled_resampler);
+    pooled_resampler = NULL;
+    for (int i = 0; i < DECODER_POOL_SLOTS; i++) {
+        if (decoder_pool_blocks[i]) {
+            free((uint8_t*)decoder_pool_blocks[i] - DECODER_POOL_HEADER);
+            decoder_pool_blocks[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&decoder_pool_mutex);
+}
+
+// dr_libs allocation callbacks (all three share the same layout)
+static void* decoder_pool_on_malloc(size_t size, void* user_data) {
+    (void)user_data;
+    return decoder_pool_alloc(size);
+}
+
+static void* decoder_pool_on_realloc(void* p, size_t size, void* user_data) {
+    (void)user_data;
+    return decoder_pool_realloc(p, size);
+}
+
+static void decoder_pool_on_free(void* p, void* user_data) {
+    (void)user_data;
+    decoder_pool_free(p);
+}
+
+static const drmp3_allocation_callbacks mp3_pool_callbacks = {
+    NULL, decoder_pool_on_malloc, decoder_pool_on_realloc, decoder_pool_on_free
+};
+static const drwav_allocation_callbacks wav_pool_callbacks = {
+    NULL, decoder_pool_on_malloc, decoder_pool_on_realloc, decoder_pool_on_free
+};
+static const drflac_allocation_callbacks flac_pool_callbacks = {
+    NULL, decoder_pool_on_malloc, decoder_pool_on_realloc, decoder_pool_on_free
+};
+
+// Arena sizes for decoders that run inside caller-provided memory. Start from the last
+// size that worked so only the first file pays for probing.
+#define VORBIS_ARENA_MIN (192 * 1024)
+#define VORBIS_ARENA_MAX (4 * 1024 * 1024)
+#define AAC_ARENA_MIN (96 * 1024)      // AACDecInfo + PSInfoBase + PSInfoSBR is ~80KB
+#define AAC_ARENA_MAX (512 * 1024)
+static int vorbis_arena_size = VORBIS_ARENA_MIN;
+static int aac_arena_size = AAC_ARENA_MIN;
+
 // M4A decoder state (uses minimp4 + Helix AAC)
+// Reads go through a read-ahead window: AAC frames within an mdat chunk are
+// contiguous, so one large read serves hundreds of frames and Helix decodes
+// straight from the window instead of doing a read per frame. The window is
+// filled by positional reads of the read-ahead input, which has the file's next
+// blocks in memory already.
+#define M4A_READAHEAD_SIZE (256 * 1024)
+#define M4A_DEFAULT_FRAME_DURATION 1024  // AAC-LC frame length, used when the track has no stts
+
+// A run of access units sharing one duration (an expanded stts entry)
+typedef struct {
+    unsigned first_sample;
+    unsigned duration;         // Per access unit, in track timescale units
+    uint64_t start_time;       // Media time of first_sample
+} M4ATimeRun;
+
 typedef struct {
     MP4D_demux_t mp4;
-    FILE* file;
+    ReadAhead* input;
     HAACDecoder aac_decoder;
+    void* aac_memory;          // Pooled arena behind aac_decoder, NULL if Helix allocated it
     int audio_track;           // Index of audio track in MP4
     unsigned current_sample;   // Current sample/frame index
     unsigned sample_count;     // Total samples
     int sample_rate;
     int channels;
-    // Buffer for reading AAC frames
-    uint8_t* frame_buffer;
-    size_t frame_buffer_size;
+    // Read-ahead window over the file
+    uint8_t* window;
+    size_t window_size;        // Allocated size
+    size_t window_len;         // Valid bytes in window
+    int64_t window_offset;     // File offset of window[0]
+    // Sample index built at open (minimp4 rescans the chunk table on every lookup)
+    unsigned* chunk_first_sample;  // First access unit of each chunk
+    M4ATimeRun* time_runs;
+    unsigned time_run_count;
+    uint64_t total_time;       // Track length in timescale units
+    int64_t edit_media_time;   // Media time presentation starts at (encoder priming)
+    uint64_t skip_time;        // Decoded media still to drop (priming, seek pre-roll)
+    // Offset of the next sequential access unit, so playback doesn't search at all
+    unsigned cursor_sample;
+    unsigned cursor_chunk;
+    int64_t cursor_offset;
 } M4ADecoder;
 
+// Return a pointer to [offset, offset+size) inside the read-ahead window,
+// refilling it from offset if the range is not resident. NULL on failure.
+static const uint8_t* m4a_window_get(M4ADecoder* m4a, int64_t offset, size_t size) {
+    if (offset >= m4a->window_offset &&
+        offset + (int64_t)size <= m4a->window_offset + (int64_t)m4a->window_len) {
+        return m4a->window + (offset - m4a->window_offset);
+    }
+
+    if (size > m4a->window_size) {
+        uint8_t* new_window = decoder_pool_realloc(m4a->window, size);
+        if (!new_window) return NULL;
+        m4a->window = new_window;
+        m4a->window_size = size;
+    }
+
+    m4a->window_offset = offset;
+    m4a->window_len = ReadAhead_readAt(m4a->input, m4a->window, m4a->window_size, offset);
+    if (m4a->window_len < size) {
+        return NULL;  // Read failed or past end of file
+    }
+    return m4a->window;
+}
+
 // minimp4 read callback - returns 0 on success, non-zero on failure
 static int m4a_read_callback(int64_t offset, void* buffer, size_t size, void* token) {
-    FILE* f = (FILE*)token;
-    if (fseek(f, (long)offset, SEEK_SET) != 0) {
-        return -1;  // Seek failed
-    }
-    size_t bytes_read = fread(buffer, 1, size, f);
-    if (bytes_read != size) {
-        return -1;  // Read failed or incomplete
+    M4ADecoder* m4a = (M4ADecoder*)token;
+    const uint8_t* data = m4a_window_get(m4a, offset, size);
+    if (!data) {
+        return -1;  // Seek or read failed
     }
+    memcpy(buffer, data, size);
     return 0;  // Success
 }
 
+// Helper: read big-endian 32-bit integer
+static uint32_t read_be32(const uint8_t* data) {
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
+           ((uint32_t)data[2] << 8) | (uint32_t)data[3];
+}
+
+// Find the index-th box of `type` among the boxes in [start, end)
+// Returns its payload offset and sets *box_end, or -1 if there is none
+static int64_t m4a_find_box(M4ADecoder* m4a, int64_t start, int64_t end, const char* type,
+                            int index, int64_t* box_end) {
+    int64_t pos = start;
+    while (pos + 8 <= end) {
+        const uint8_t* header = m4a_window_get(m4a, pos, 8);
+        if (!header) return -1;
+
+        uint64_t size = read_be32(header);
+        bool match = memcmp(header + 4, type, 4) == 0;
+        int64_t header_size = 8;
+        if (size == 1) {
+            const uint8_t* large = m4a_window_get(m4a, pos + 8, 8);
+            if (!large) return -1;
+            size = ((uint64_t)read_be32(large) << 32) | read_be32(large + 4);
+            header_size = 16;
+        } else if (size == 0) {
+            size = (uint64_t)(end - pos);  // Box runs to the end of its parent
+        }
+        if (size < (uint64_t)header_size || size > (uint64_t)(end - pos)) return -1;
+
+        if (match && index-- == 0) {
+            *box_end = pos + (int64_t)size;
+            return pos + header_size;
+        }
+        pos += (int64_t)size;
+    }
+    return -1;
+}
+
+// Media time of the audio track's first non-empty edit (moov/trak/edts/elst)
+// Encoders use it to hide their priming samples; 0 when the track has no edit list
+static int64_t m4a_edit_media_time(M4ADecoder* m4a, int64_t file_size) {
+    int64_t moov_end, trak_end, edts_end, elst_end;
+    int64_t moov = m4a_find_box(m4a, 0, file_size, "moov", 0, &moov_end);
+    if (moov < 0) return 0;
+    int64_t trak = m4a_find_box(m4a, moov, moov_end, "trak", m4a->audio_track, &trak_end);
+    if (trak < 0) return 0;
+    int64_t edts = m4a_find_box(m4a, trak, trak_end, "edts", 0, &edts_end);
+    if (edts < 0) return 0;
+    int64_t elst = m4a_find_box(m4a, edts, edts_end, "elst", 0, &elst_end);
+    if (elst < 0) return 0;
+
+    const uint8_t* header = m4a_window_get(m4a, elst, 8);
+    if (!header) return 0;
+    int version = header[0];
+    uint32_t count = read_be32(header + 4);
+    int64_t entry_size = (version == 1) ? 20 : 12;
+
+    for (uint32_t i = 0; i < count; i++) {
+        int64_t entry_offset = elst + 8 + (int64_t)i * entry_size;
+        if (entry_offset + entry_size > elst_end) break;
+        const uint8_t* entry = m4a_window_get(m4a, entry_offset, (size_t)entry_size);
+        if (!entry) break;
+
+        // media_time -1 marks an empty edit (a presentation delay), skip it
+        int64_t media_time = (version == 1)
+            ? (int64_t)(((uint64_t)read_be32(entry + 8) << 32) | read_be32(entry + 12))
+            : (int64_t)(int32_t)read_be32(entry + 4);
+        if (media_time >= 0) return media_time;
+    }
+    return 0;
+}
+
+static unsigned m4a_sample_duration(const M4ADecoder* m4a, unsigned sample) {
+    const MP4D_track_t* track = &m4a->mp4.track[m4a->audio_track];
+    return track->duration ? track->duration[sample] : M4A_DEFAULT_FRAME_DURATION;
+}
+
+// Build the chunk and timestamp index from minimp4's sample tables
+static int m4a_build_index(M4ADecoder* m4a) {
+    const MP4D_track_t* track = &m4a->mp4.track[m4a->audio_track];
+    if (track->chunk_count == 0 || track->sample_to_chunk_count == 0) return -1;
+
+    // First access unit of every chunk, from the stsc groups
+    m4a->chunk_first_sample = malloc(track->chunk_count * sizeof(unsigned));
+    if (!m4a->chunk_first_sample) return -1;
+    unsigned group = 0;
+    unsigned first = 0;
+    for (unsigned chunk = 0; chunk < track->chunk_count; chunk++) {
+        // stsc numbers chunks from 1
+        if (group + 1 < track->sample_to_chunk_count &&
+            chunk + 1 == track->sample_to_chunk[group + 1].first_chunk) {
+            group++;
+        }
+        m4a->chunk_first_sample[chunk] = first;
+        first += track->sample_to_chunk[group].samples_per_chunk;
+    }
+
+    // Collapse per-sample durations back into runs with cumulative start times
+    unsigned capacity = 4;
+    m4a->time_runs = malloc(capacity * sizeof(M4ATimeRun));
+    if (!m4a->time_runs) return -1;
+    m4a->time_run_count = 0;
+    uint64_t time = 0;
+    for (unsigned i = 0; i < m4a->sample_count; i++) {
+        unsigned duration = m4a_sample_duration(m4a, i);
+        if (m4a->time_run_count == 0 || m4a->time_runs[m4a->time_run_count - 1].duration != duration) {
+            if (m4a->time_run_count == capacity) {
+                M4ATimeRun* grown = realloc(m4a->time_runs, capacity * 2 * sizeof(M4ATimeRun));
+                if (!grown) return -1;
+                m4a->time_runs = grown;
+                capacity *= 2;
+            }
+            M4ATimeRun* run = &m4a->time_runs[m4a->time_run_count++];
+            run->first_sample = i;
+            run->duration = duration;
+            run->start_time = time;
+        }
+        time += duration;
+    }
+    m4a->total_time = time;
+    return 0;
+}
+
+// File offset and size of an access unit, 0 if it can't be located
+// Sequential reads continue from the cursor; random access binary-searches the chunks
+static int64_t m4a_sample_locate(M4ADecoder* m4a, unsigned sample, unsigned* bytes) {
+    const MP4D_track_t* track = &m4a->mp4.track[m4a->audio_track];
+    *bytes = 0;
+    if (sample >= m4a->sample_count) return 0;
+
+    unsigned chunk;
+    int64_t offset;
+    if (sample == m4a->cursor_sample && m4a->cursor_offset > 0) {
+        chunk = m4a->cursor_chunk;
+        offset = m4a->cursor_offset;
+    } else {
+        // Last chunk starting at or before the sample (skips over empty chunks)
+        unsigned lo = 0, hi = track->chunk_count - 1;
+        while (lo < hi) {
+            unsigned mid = lo + (hi - lo + 1) / 2;
+            if (m4a->chunk_first_sample[mid] <= sample) lo = mid;
+            else hi = mid - 1;
+        }
+        chunk = lo;
+        offset = (int64_t)track->chunk_offset[chunk];
+        for (unsigned s = m4a->chunk_first_sample[chunk]; s < sample; s++) {
+            offset += track->entry_size[s];
+        }
+    }
+    *bytes = track->entry_size[sample];
+
+    // Advance the cursor, moving to the next non-empty chunk at a chunk boundary
+    unsigned next_chunk = chunk;
+    while (next_chunk + 1 < track->chunk_count && m4a->chunk_first_sample[next_chunk + 1] <= sample + 1) {
+        next_chunk++;
+    }
+    m4a->cursor_sample = sample + 1;
+    m4a->cursor_chunk = next_chunk;
+    m4a->cursor_offset = (next_chunk != chunk) ? (int64_t)track->chunk_offset[next_chunk]
+                                               : offset + *bytes;
+    return offset;
+}
+
+// Position decoding so output resumes at media time `target` (timescale units)
+// Decoding starts one access unit early to rebuild Helix's overlap state after the
+// flush; the read loop drops everything before the target.
+static void m4a_seek_time(M4ADecoder* m4a, uint64_t target) {
+    if (m4a->time_run_count == 0 || target >= m4a->total_time) {
+        m4a->current_sample = m4a->sample_count;
+        m4a->skip_time = 0;
+        return;
+    }
+
+    // Last run starting at or before the target
+    unsigned lo = 0, hi = m4a->time_run_count - 1;
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo + 1) / 2;
+        if (m4a->time_runs[mid].start_time <= target) lo = mid;
+        else hi = mid - 1;
+    }
+    const M4ATimeRun* run = &m4a->time_runs[lo];
+    unsigned run_end = (lo + 1 < m4a->time_run_count) ? m4a->time_runs[lo + 1].first_sample
+                                                      : m4a->sample_count;
+
+    unsigned sample = run->first_sample;
+    if (run->duration > 0) {
+        uint64_t index = (target - run->start_time) / run->duration;
+        sample = (index < run_end - run->first_sample) ? run->first_sample + (unsigned)index : run_end - 1;
+    }
+    uint64_t sample_time = run->start_time + (uint64_t)(sample - run->first_sample) * run->duration;
+
+    m4a->skip_time = target - sample_time;
+    if (sample > 0) {
+        sample--;
+        m4a->skip_time += m4a_sample_duration(m4a, sample);
+    }
+    m4a->current_sample = sample;
+}
+
 // Sample rates for different audio outputs
 #define SAMPLE_RATE_BLUETOOTH 44100  // 44.1kHz for Bluetooth A2DP compatibility
 #define SAMPLE_RATE_SPEAKER   48000  // 48kHz for speaker output
@@ -67,18 +478,137 @@ static int m4a_read_callback(int64_t offset, void* buffer, size_t size, void* to
 #define SAMPLE_RATE_DEFAULT   48000  // Default fallback
 
 #define AUDIO_CHANNELS 2
-#define AUDIO_SAMPLES 2048  // Smaller buffer for lower latency
+#define AUDIO_SAMPLES_POWERSAVE 8192  // Screen off: latency doesn't matter, fewer callbacks
+
+// Per-sink audio profiles
+// The speaker and a USB DAC are local and steady: short device periods and the
+// planned watermarks. BlueALSA encodes and sends in bursts and stalls under load, so
+// Bluetooth gets a longer period and a deeper watermark floor (48 kHz tracks are
+// all converted to 44.1 kHz for it). A DAC, usually fed at the track's own rate,
+// gets the high resampler tier when it does convert. With the screen off every
+// sink drops to the low-power tier.
+typedef enum {
+    AUDIO_PROFILE_SPEAKER,
+    AUDIO_PROFILE_USB_DAC,
+    AUDIO_PROFILE_BLUETOOTH,
+    AUDIO_PROFILE_COUNT
+} AudioProfileId;
+
+typedef struct {
+    const char* name;
+    int sample_rate;
+    int period_samples;         // SDL callback size
+    int low_min_ms;             // Floor of the planned low watermark
+    int burst_min_ms;           // Smallest refill burst above it
+    ResamplerQuality resampler; // Tier for tracks at another rate
+    int sink_latency_ms;        // Delay past the device buffer (A2DP transport and headset decoding)
+} AudioProfile;
+
+static const AudioProfile audio_profiles[AUDIO_PROFILE_COUNT] = {
+    [AUDIO_PROFILE_SPEAKER]   = {"speaker",   SAMPLE_RATE_SPEAKER,   1024, 300,  1000, RESAMPLER_STANDARD, 0},
+    [AUDIO_PROFILE_USB_DAC]   = {"usb dac",   SAMPLE_RATE_USB_DAC,   2048, 500,  1000, RESAMPLER_HIGH,     0},
+    [AUDIO_PROFILE_BLUETOOTH] = {"bluetooth", SAMPLE_RATE_BLUETOOTH, 4096, 1500, 2000, RESAMPLER_STANDARD, 150},
+};
+
+static const AudioProfile* audio_profile = &audio_profiles[AUDIO_PROFILE_SPEAKER];  // Atomic
+static int audio_buffer_samples = 2048;
+static int output_latency_ms = 0;   // Fed to heard: device buffer plus sink delay (atomic)
+static SDL_AudioFormat device_format = AUDIO_S16SYS;  // AUDIO_S32SYS only for bit-perfect streams
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define PLAYER_SETTINGS_FILE SHARED_USERDATA_PATH "/player_settings.txt"
+
+// Perceived-loudness volume curve in Q15, one entry per system volume step (0-20)
+// round(32767 * (step / 20) ^ 0.4): at 50% input -> ~76% output, at 25% input -> ~57% output
+#define VOLUME_STEPS 20
+#define GAIN_UNITY_Q15 32767
+static const int16_t volume_curve_q15[VOLUME_STEPS + 1] = {
+        0,  9886, 13045, 15342, 17213, 18820, 20243, 21531, 22712, 23808, 24833,
+    25798, 26711, 27580, 28410, 29205, 29969, 30705, 31415, 32102, 32767
+};
+
+// Map linear volume (0-1) to the nearest curve step
+static inline int16_t volume_to_gain_q15(float linear_vol) {
+    if (linear_vol <= 0.0f) return 0;
+    if (linear_vol >= 1.0f) return GAIN_UNITY_Q15;
+    return volume_curve_q15[(int)(linear_vol * VOLUME_STEPS + 0.5f)];
+}
+
+// Gain stage state: target set by Player_setVolume, current owned by the audio callback
+static int16_t target_gain_q15 = GAIN_UNITY_Q15;
+static int16_t current_gain_q15 = GAIN_UNITY_Q15;
+
+// Loudness normalization of the playing track, and of the queued one, which the
+// audio callback takes over at the gapless boundary (Q15, atomic)
+static int16_t track_norm_q15 = GAIN_UNITY_Q15;
+static int16_t next_norm_q15 = GAIN_UNITY_Q15;
+
+// Gain stage target for local files: volume times the track's normalization
+static inline int16_t stream_target_gain_q15(void) {
+    int32_t volume = __atomic_load_n(&target_gain_q15, __ATOMIC_RELAXED);
+    int32_t norm = __atomic_load_n(&track_norm_q15, __ATOMIC_RELAXED);
+    if (norm == GAIN_UNITY_Q15) return (int16_t)volume;
+    return (int16_t)((volume * norm + (1 << 14)) >> 15);
+}
+
+// Apply Q15 gain to interleaved stereo, ramping from current to target gain across
+// the buffer so volume changes don't click. No float math in the real-time callback.
+static void apply_gain_q15(int16_t* samples, size_t frames, int16_t target) {
+    int32_t start = current_gain_q15;
+    current_gain_q15 = target;
 
-// Convert linear volume (0-1) to perceived volume using logarithmic curve
-// This makes volume steps feel more natural to human hearing
-static inline float apply_volume_curve(float linear_vol) {
-    if (linear_vol <= 0.0f) return 0.0f;
-    if (linear_vol >= 1.0f) return 1.0f;
-    // Use power curve with exponent 0.4 for natural perceived loudness
-    // At 50% input -> ~76% output, at 25% input -> ~57% output
-    return powf(linear_vol, 0.4f);
+    if (start == GAIN_UNITY_Q15 && target == GAIN_UNITY_Q15) return;
+    Pcm_gainS16(samples, frames, (int16_t)start, target);
 }
 
+// Playback telemetry, written by the audio callback (decode_chunks by the decode thread)
+// Relaxed atomics: readers only need a roughly consistent snapshot.
+typedef struct {
+    uint32_t callbacks;
+    uint32_t underruns;
+    uint64_t silence_frames;
+    uint32_t trylock_misses;
+    uint32_t fill_samples;      // Buffer fill observations
+    uint64_t fill_sum_frames;
+    size_t fill_min_frames;
+    uint32_t intervals;         // Callback intervals measured
+    uint64_t interval_sum_us;
+    uint32_t jitter_max_us;
+    uint64_t last_callback_us;
+    uint64_t decode_chunks;     // Decode thread iterations that produced audio
+    uint64_t decode_chunks_base;    // decode_chunks and player.decode_cpu_us at the last
+    uint64_t decode_cpu_base;       // reset (main thread only)
+    bool reset_pending;         // Set by Player_resetStats, applied by the callback
+} PlaybackStats;
+
+static PlaybackStats playback_stats = { .fill_min_frames = SIZE_MAX };
+
+static inline uint64_t monotonic_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Tags and embedded cover of a file, parsed without touching the player state
+// (applied to the current track with apply_metadata). Covers of every format
+// are only located here; the art job reads and decodes them when shown.
+typedef struct {
+    TrackInfo info;             // Title/artist/album (title starts as the file name)
+    long art_offset;            // Embedded cover: image offset in the file (0 = none)
+    uint32_t art_size;
+    uint64_t art_key;           // Its in-memory cache key (see embedded_art_key; 0 with tags_only)
+    float replaygain_db;        // Gain to the ReplayGain reference, valid if replaygain_source
+    int replaygain_source;      // REPLAYGAIN_NONE / _ALBUM / _TRACK (track gain wins)
+    bool tags_only;             // Don't decode embedded covers (library scan)
+} TrackMetadata;
+
+#define REPLAYGAIN_NONE 0
+#define REPLAYGAIN_ALBUM 1
+#define REPLAYGAIN_TRACK 2
+
 // Global player context
 static PlayerContext player = {0};
 static int64_t audio_position_samples = 0;  // Track position in samples for precision
@@ -86,21 +616,87 @@ static WaveformData waveform = {0};  // Waveform overview for progress display
 static int current_sample_rate = SAMPLE_RATE_DEFAULT;  // Track current SDL audio device rate
 static bool bluetooth_audio_active = false;  // Track if Bluetooth audio is active
 
-// Get target sample rate based on current audio sink
-static int get_target_sample_rate(void) {
+// What the UI reads each frame (Player_getSnapshot), republished whenever the
+// state or track info changes. Publishers serialize on snapshot_mutex.
+static PlayerSnapshot snapshot = {0};
+static Seqlock snapshot_lock = {0};
+static pthread_mutex_t snapshot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// The decode thread's answer to Player_requestSeekHint (it alone may look at
+// the decoder's index), published for the main thread like the snapshot
+typedef struct {
+    uint64_t request;           // seek_hint_request answered
+    SeekHint hint;
+} SeekHintAnswer;
+static SeekHintAnswer seek_hint_answer = {0};
+static Seqlock seek_hint_lock = {0};
+
+// Publish the state and track info (after changing them, player.mutex held)
+static void publish_snapshot(void) {
+    pthread_mutex_lock(&snapshot_mutex);
+    PlayerSnapshot next;
+    next.state = player.state;
+    next.track = player.track_info;
+    memcpy(next.file, player.current_file, sizeof(next.file));
+    next.duration_ms = Player_getDuration();
+    Seqlock_write(&snapshot_lock, &snapshot, &next, sizeof(next));
+    pthread_mutex_unlock(&snapshot_mutex);
+}
+
+// Profile of the current audio sink
+static AudioProfileId detect_audio_profile(void) {
     if (bluetooth_audio_active) {
-        return SAMPLE_RATE_BLUETOOTH;  // 44100 Hz for Bluetooth
+        return AUDIO_PROFILE_BLUETOOTH;
     }
     // Check audio sink from msettings
     int sink = GetAudioSink();
     switch (sink) {
         case AUDIO_SINK_BLUETOOTH:
-            return SAMPLE_RATE_BLUETOOTH;  // 44100 Hz
+            return AUDIO_PROFILE_BLUETOOTH;
         case AUDIO_SINK_USBDAC:
-            return SAMPLE_RATE_USB_DAC;    // 48000 Hz
+            return AUDIO_PROFILE_USB_DAC;
         default:
-            return SAMPLE_RATE_SPEAKER;    // 48000 Hz for speaker
+            return AUDIO_PROFILE_SPEAKER;
+    }
+}
+
+static const AudioProfile* current_audio_profile(void) {
+    return __atomic_load_n(&audio_profile, __ATOMIC_ACQUIRE);
+}
+
+// Resampler tier wanted now (applied by the decode thread before each chunk)
+static ResamplerQuality resampler_quality(void) {
+    if (__atomic_load_n(&player.power_save, __ATOMIC_RELAXED)) return RESAMPLER_LOW_POWER;
+    return current_audio_profile()->resampler;
+}
+
+// Get target sample rate based on current audio sink
+static int get_target_sample_rate(void) {
+    return audio_profiles[detect_audio_profile()].sample_rate;
+}
+
+// Take the current sink's profile; the device period applies at the next open
+static void apply_audio_profile(void) {
+    const AudioProfile* profile = &audio_profiles[detect_audio_profile()];
+    if (!__atomic_load_n(&player.power_save, __ATOMIC_RELAXED)) {
+        audio_buffer_samples = profile->period_samples;
     }
+    if (profile != current_audio_profile()) {
+        __atomic_store_n(&audio_profile, profile, __ATOMIC_RELEASE);
+        LOG_info("Audio: %s profile\n", profile->name);
+    }
+}
+
+// Work out the output latency from the device the open negotiated
+// SDL's ALSA backend keeps two periods queued behind the one being filled; callback
+// devices have no queued-bytes query and the PCM is SDL's, so the period it granted
+// stands in for a measurement, plus the profile's allowance past the device.
+static void set_output_latency(const SDL_AudioSpec* have) {
+    int latency_ms = 0;
+    if (have->freq > 0) latency_ms = (int)((int64_t)have->samples * 2 * 1000 / have->freq);
+    latency_ms += current_audio_profile()->sink_latency_ms;
+    __atomic_store_n(&output_latency_ms, latency_ms, __ATOMIC_RELAXED);
+    Spectrum_setLatency(latency_ms);
 }
 
 // Forward declaration for audio device change callback
@@ -111,1543 +707,5600 @@ static void audio_device_change_callback(int device_type, int event);
 // Decode chunk size (~0.5 seconds at 48kHz)
 #define DECODE_CHUNK_FRAMES 24000
 
-// Circular buffer functions
-static int circular_buffer_init(CircularBuffer* cb, size_t capacity_frames) {
-    cb->buffer = malloc(capacity_frames * sizeof(int16_t) * AUDIO_CHANNELS);
-    if (!cb->buffer) {
-        LOG_error("Failed to allocate circular buffer (%zu KB)\n",
-                  capacity_frames * sizeof(int16_t) * AUDIO_CHANNELS / 1024);
-        return -1;
+static inline float gain_q15_to_float(int16_t gain) {
+    return (gain == GAIN_UNITY_Q15) ? 1.0f : gain / 32768.0f;
+}
+
+// Final stage of the float pipeline (audio callback): convert float frames straight
+// out of the ring into int16 device frames, applying the volume ramp on the way.
+// This is the only float-to-int conversion on that path.
+static size_t circular_buffer_read_float_s16(CircularBuffer* cb, int16_t* out, size_t frames) {
+    int16_t target = stream_target_gain_q15();
+    float g0 = gain_q15_to_float(current_gain_q15);
+    float step = frames > 0 ? (gain_q15_to_float(target) - g0) / (float)frames : 0.0f;
+    current_gain_q15 = target;
+
+    size_t read = 0;
+    for (int part = 0; part < 2 && read < frames; part++) {
+        void* span;
+        size_t n = circular_buffer_read_span(cb, &span);
+        if (n == 0) break;
+        if (n > frames - read) n = frames - read;
+        Pcm_f32ToS16Gain((const float*)span, &out[read * AUDIO_CHANNELS], n,
+                              g0 + (float)read * step, step);
+        circular_buffer_consume(cb, n);
+        read += n;
     }
-    cb->capacity = capacity_frames;
-    cb->write_pos = 0;
-    cb->read_pos = 0;
-    cb->available = 0;
-    pthread_mutex_init(&cb->mutex, NULL);
-    return 0;
+
+    return read;
+}
+
+// ============ PER-FILE CACHES ============
+
+// Sidecar data derived from audio files (waveforms, seek indexes) lives in
+// $HOME/.cache/<subdir>/<djb2 of path>.<ext>; entries store path, mtime and size
+// so stale or colliding entries are rejected.
+
+// Simple hash function for cache filename (djb2, same as album art cache)
+static unsigned int cache_hash(const char* str) {
+    unsigned int hash = 5381;
+    int c;
+    while ((c = *str++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
 }
 
-static void circular_buffer_free(CircularBuffer* cb) {
-    if (cb->buffer) {
-        free(cb->buffer);
-        cb->buffer = NULL;
+static void get_cache_file_path(const char* subdir, const char* filepath, const char* ext,
+                                char* path, int path_size) {
+    const char* home = getenv("HOME");
+    if (home) {
+        snprintf(path, path_size, "%s/.cache/%s/%08x.%s", home, subdir, cache_hash(filepath), ext);
+    } else {
+        snprintf(path, path_size, "/tmp/%s_cache/%08x.%s", subdir, cache_hash(filepath), ext);
     }
-    pthread_mutex_destroy(&cb->mutex);
-    cb->capacity = 0;
-    cb->write_pos = 0;
-    cb->read_pos = 0;
-    cb->available = 0;
 }
 
-static void circular_buffer_clear(CircularBuffer* cb) {
-    pthread_mutex_lock(&cb->mutex);
-    cb->write_pos = 0;
-    cb->read_pos = 0;
-    cb->available = 0;
-    pthread_mutex_unlock(&cb->mutex);
+static void ensure_cache_subdir(const char* subdir) {
+    char dir[512];
+    const char* home = getenv("HOME");
+    if (home) {
+        snprintf(dir, sizeof(dir), "%s/.cache", home);
+        mkdir(dir, 0755);
+        snprintf(dir, sizeof(dir), "%s/.cache/%s", home, subdir);
+    } else {
+        snprintf(dir, sizeof(dir), "/tmp/%s_cache", subdir);
+    }
+    mkdir(dir, 0755);
 }
 
-static size_t circular_buffer_available(CircularBuffer* cb) {
-    pthread_mutex_lock(&cb->mutex);
-    size_t avail = cb->available;
-    pthread_mutex_unlock(&cb->mutex);
-    return avail;
+// Common header for per-file cache entries
+typedef struct {
+    uint32_t magic;
+    uint32_t count;             // Number of entries following the header
+    int64_t mtime;
+    int64_t size;
+    char path[512];
+} FileCacheHeader;
+
+static bool file_cache_header_init(FileCacheHeader* hdr, const char* filepath, uint32_t magic, uint32_t count) {
+    struct stat st;
+    if (stat(filepath, &st) != 0) return false;
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = magic;
+    hdr->count = count;
+    hdr->mtime = (int64_t)st.st_mtime;
+    hdr->size = (int64_t)st.st_size;
+    strncpy(hdr->path, filepath, sizeof(hdr->path) - 1);
+    return true;
 }
 
-// Write frames to circular buffer (called by decode thread)
-static size_t circular_buffer_write(CircularBuffer* cb, int16_t* data, size_t frames) {
-    pthread_mutex_lock(&cb->mutex);
+// Open a cache entry and validate its header against the file; returns NULL if stale
+static FILE* file_cache_open(const char* subdir, const char* ext, const char* filepath,
+                             uint32_t magic, FileCacheHeader* hdr) {
+    struct stat st;
+    if (stat(filepath, &st) != 0) return NULL;
 
-    size_t space = cb->capacity - cb->available;
-    size_t to_write = (frames < space) ? frames : space;
+    char cache_path[512];
+    get_cache_file_path(subdir, filepath, ext, cache_path, sizeof(cache_path));
+    FILE* f = fopen(cache_path, "rb");
+    if (!f) return NULL;
 
-    if (to_write == 0) {
-        pthread_mutex_unlock(&cb->mutex);
-        return 0;
+    if (fread(hdr, sizeof(*hdr), 1, f) != 1) {
+        fclose(f);
+        return NULL;
+    }
+    hdr->path[sizeof(hdr->path) - 1] = '\0';
+    if (hdr->magic != magic || hdr->mtime != (int64_t)st.st_mtime ||
+        hdr->size != (int64_t)st.st_size || strcmp(hdr->path, filepath) != 0) {
+        fclose(f);
+        return NULL;
     }
+    return f;
+}
 
-    // Write in two parts if wrapping
-    size_t first_part = cb->capacity - cb->write_pos;
-    if (first_part > to_write) first_part = to_write;
+// Write header + payload to a temp file and rename, so a half-written entry is never read
+static void file_cache_write(const char* subdir, const char* ext, const char* filepath,
+                             const FileCacheHeader* hdr, const void* payload, size_t payload_size) {
+    ensure_cache_subdir(subdir);
 
-    memcpy(&cb->buffer[cb->write_pos * AUDIO_CHANNELS], data,
-           first_part * sizeof(int16_t) * AUDIO_CHANNELS);
+    char cache_path[512], tmp_path[520];
+    get_cache_file_path(subdir, filepath, ext, cache_path, sizeof(cache_path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", cache_path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) return;
+    bool ok = fwrite(hdr, sizeof(*hdr), 1, f) == 1 &&
+              (payload_size == 0 || fwrite(payload, payload_size, 1, f) == 1);
+    fclose(f);
+    if (ok) {
+        rename(tmp_path, cache_path);
+    } else {
+        unlink(tmp_path);
+    }
+}
 
-    size_t second_part = to_write - first_part;
-    if (second_part > 0) {
-        memcpy(cb->buffer, &data[first_part * AUDIO_CHANNELS],
-               second_part * sizeof(int16_t) * AUDIO_CHANNELS);
+// ============ MP3 SEEK INDEX ============
+
+// drmp3 seeks without a seek table by decoding from the start (or current position),
+// which stalls for seconds on long VBR files. We build a sparse table (~1 point per
+// second) from a header-only scan the first time a file is opened and persist it, so
+// later opens skip both the scan and the frame count and every seek is a binary
+// search plus a short resync.
+
+#define MP3_SEEK_INDEX_MAGIC 0x3149534D  // "MSI1"
+#define MP3_SEEK_INDEX_MAX_POINTS 16384   // ~4.5 hours at one point per second
+
+// Load a cached seek index and bind it; sets total_frames. Returns 0 on success.
+static int mp3_seek_index_load(StreamDecoder* sd, const char* filepath) {
+    FileCacheHeader hdr;
+    FILE* f = file_cache_open("seekindex", "msi", filepath, MP3_SEEK_INDEX_MAGIC, &hdr);
+    if (!f) return -1;
+
+    int64_t total_frames = 0;
+    drmp3_seek_point* points = NULL;
+    bool ok = hdr.count > 0 && hdr.count <= MP3_SEEK_INDEX_MAX_POINTS &&
+              fread(&total_frames, sizeof(total_frames), 1, f) == 1;
+    if (ok) {
+        points = malloc(hdr.count * sizeof(drmp3_seek_point));
+        ok = points && fread(points, sizeof(drmp3_seek_point), hdr.count, f) == hdr.count;
     }
+    fclose(f);
 
-    cb->write_pos = (cb->write_pos + to_write) % cb->capacity;
-    cb->available += to_write;
+    if (!ok || !drmp3_bind_seek_table((drmp3*)sd->decoder, hdr.count, points)) {
+        free(points);
+        return -1;
+    }
 
-    pthread_mutex_unlock(&cb->mutex);
-    return to_write;
+    sd->seek_table = points;
+    sd->total_frames = total_frames;
+    return 0;
 }
 
-// Read frames from circular buffer (called by audio callback)
-static size_t circular_buffer_read(CircularBuffer* cb, int16_t* data, size_t frames) {
-    pthread_mutex_lock(&cb->mutex);
+// Build a seek index (header-only scan), bind it and persist it
+static void mp3_seek_index_build(StreamDecoder* sd, const char* filepath) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    if (sd->total_frames <= 0 || sd->source_sample_rate <= 0) return;
 
-    size_t to_read = (frames < cb->available) ? frames : cb->available;
+    int64_t seconds = sd->total_frames / sd->source_sample_rate + 1;
+    drmp3_uint32 count = (drmp3_uint32)(seconds < MP3_SEEK_INDEX_MAX_POINTS ? seconds : MP3_SEEK_INDEX_MAX_POINTS);
+    drmp3_seek_point* points = malloc(count * sizeof(drmp3_seek_point));
+    if (!points) return;
 
-    if (to_read == 0) {
-        pthread_mutex_unlock(&cb->mutex);
-        return 0;
+    if (!drmp3_calculate_seek_points(mp3, &count, points) || count == 0 ||
+        !drmp3_bind_seek_table(mp3, count, points)) {
+        free(points);
+        return;
     }
+    sd->seek_table = points;
+
+    FileCacheHeader hdr;
+    if (!file_cache_header_init(&hdr, filepath, MP3_SEEK_INDEX_MAGIC, count)) return;
+
+    // Payload: total frame count followed by the seek points
+    size_t payload_size = sizeof(int64_t) + count * sizeof(drmp3_seek_point);
+    uint8_t* payload = malloc(payload_size);
+    if (!payload) return;
+    int64_t total_frames = sd->total_frames;
+    memcpy(payload, &total_frames, sizeof(total_frames));
+    memcpy(payload + sizeof(total_frames), points, count * sizeof(drmp3_seek_point));
+    file_cache_write("seekindex", "msi", filepath, &hdr, payload, payload_size);
+    free(payload);
+}
 
-    // Read in two parts if wrapping
-    size_t first_part = cb->capacity - cb->read_pos;
-    if (first_part > to_read) first_part = to_read;
-
-    memcpy(data, &cb->buffer[cb->read_pos * AUDIO_CHANNELS],
-           first_part * sizeof(int16_t) * AUDIO_CHANNELS);
+// ============ OGG SEEK INDEX ============
 
-    size_t second_part = to_read - first_part;
-    if (second_part > 0) {
-        memcpy(&data[first_part * AUDIO_CHANNELS], cb->buffer,
-               second_part * sizeof(int16_t) * AUDIO_CHANNELS);
-    }
+// stb_vorbis seeks by bisecting the whole file, probing pages with small reads each
+// time. A background pass records one page every OGG_SEEK_INDEX_SPACING bytes (the
+// granule position and byte range stb_vorbis probes for) and caches it per file.
+// A seek then narrows stb_vorbis's search to the two indexed pages around the target,
+// leaving a short linear scan instead of a bisection.
 
-    cb->read_pos = (cb->read_pos + to_read) % cb->capacity;
-    cb->available -= to_read;
+#define OGG_SEEK_INDEX_MAGIC 0x3149534F   // "OSI1"
+#define OGG_SEEK_INDEX_SPACING (32 * 1024)
+#define OGG_SEEK_INDEX_MAX_PAGES 65536    // ~2GB at the spacing above
 
-    pthread_mutex_unlock(&cb->mutex);
-    return to_read;
+// Index shared by a decoder and the worker building it (freed by whichever finishes last)
+// A scan outlives a closed decoder so the cache entry still gets written.
+typedef struct {
+    int refs;
+    bool ready;                 // pages/count are complete (published with release)
+    uint32_t count;
+    ProbedPage* pages;          // Ascending by offset and granule
+    uint32_t scan_start;        // First audio page
+    uint32_t scan_end;          // Last page (stb_vorbis's p_last), not indexed
+    char filepath[512];
+} OggSeekIndex;
+
+// One background index scan at a time (OGG or FLAC), they compete with playback for SD reads
+static bool seek_index_build_active = false;
+
+static void ogg_seek_index_release(OggSeekIndex* index) {
+    if (!index) return;
+    if (__atomic_sub_fetch(&index->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(index->pages);
+        free(index);
+    }
 }
 
-// ============ STREAMING DECODER INTERFACE ============
-
-// Open decoder and read metadata (doesn't decode audio yet)
-static int stream_decoder_open(StreamDecoder* sd, const char* filepath) {
-    memset(sd, 0, sizeof(StreamDecoder));
-
-    sd->format = Player_detectFormat(filepath);
-    if (sd->format == AUDIO_FORMAT_UNKNOWN) {
-        LOG_error("Stream: Unknown audio format: %s\n", filepath);
-        return -1;
+// Read one page header at offset; returns the page length (0 if there is no page)
+// Header and lacing table come in one positional read (short only at the end).
+static uint32_t ogg_read_page(ReadAhead* in, uint32_t offset, ProbedPage* page) {
+    uint8_t header[27 + 255];
+    size_t len = ReadAhead_pread(in, header, sizeof(header), offset);
+    if (len < 27 || memcmp(header, "OggS", 4) != 0) return 0;
+    if (len < 27 + (size_t)header[26]) return 0;
+
+    uint32_t length = 27 + header[26];
+    for (int i = 0; i < header[26]; i++) {
+        length += header[27 + i];
     }
+    page->page_start = offset;
+    page->page_end = offset + length;
+    // Lower 32 bits of the granule position, the same value stb_vorbis compares
+    page->last_decoded_sample = header[6] | (header[7] << 8) | (header[8] << 16) | ((uint32_t)header[9] << 24);
+    return length;
+}
 
-    switch (sd->format) {
-        case AUDIO_FORMAT_MP3: {
-            drmp3* mp3 = malloc(sizeof(drmp3));
-            if (!mp3 || !drmp3_init_file(mp3, filepath, NULL)) {
-                free(mp3);
-                LOG_error("Stream: Failed to open MP3: %s\n", filepath);
-                return -1;
-            }
-            sd->decoder = mp3;
-            sd->source_sample_rate = mp3->sampleRate;
-            sd->source_channels = mp3->channels;
-            sd->total_frames = drmp3_get_pcm_frame_count(mp3);
-            break;
-        }
-        case AUDIO_FORMAT_WAV: {
-            drwav* wav = malloc(sizeof(drwav));
-            if (!wav || !drwav_init_file(wav, filepath, NULL)) {
-                free(wav);
-                LOG_error("Stream: Failed to open WAV: %s\n", filepath);
-                return -1;
+static void ogg_seek_index_job(void* arg, JobToken* token) {
+    OggSeekIndex* index = (OggSeekIndex*)arg;
+
+    ReadAhead* in = ReadAhead_openDirect(index->filepath);
+    if (in) {
+        uint32_t capacity = (index->scan_end - index->scan_start) / OGG_SEEK_INDEX_SPACING + 2;
+        if (capacity > OGG_SEEK_INDEX_MAX_PAGES) capacity = OGG_SEEK_INDEX_MAX_PAGES;
+        ProbedPage* pages = malloc(capacity * sizeof(ProbedPage));
+        uint32_t count = 0;
+        bool ok = pages != NULL;
+
+        uint32_t offset = index->scan_start;
+        uint32_t next_mark = offset;
+        while (ok && offset < index->scan_end) {
+            if (Jobs_cancelled(token)) {
+                ok = false;
+                break;
             }
-            sd->decoder = wav;
-            sd->source_sample_rate = wav->sampleRate;
-            sd->source_channels = wav->channels;
-            sd->total_frames = wav->totalPCMFrameCount;
-            break;
-        }
-        case AUDIO_FORMAT_FLAC: {
-            drflac* flac = drflac_open_file(filepath, NULL);
-            if (!flac) {
-                LOG_error("Stream: Failed to open FLAC: %s\n", filepath);
-                return -1;
+            ProbedPage page;
+            uint32_t length = ogg_read_page(in, offset, &page);
+            if (length == 0) break;  // Damaged or truncated: keep what was indexed so far
+
+            // Pages where no packet ends carry no granule
+            if (offset >= next_mark && page.last_decoded_sample != ~0U) {
+                // A granule going backwards means a chained stream stb_vorbis can't seek anyway
+                if (count > 0 && page.last_decoded_sample < pages[count - 1].last_decoded_sample) {
+                    ok = false;
+                    break;
+                }
+                if (count == capacity) break;
+                pages[count++] = page;
+                next_mark = offset + OGG_SEEK_INDEX_SPACING;
             }
-            sd->decoder = flac;
-            sd->source_sample_rate = flac->sampleRate;
-            sd->source_channels = flac->channels;
-            sd->total_frames = flac->totalPCMFrameCount;
-            break;
+            offset += length;
         }
-        case AUDIO_FORMAT_OGG: {
-            int error;
-            stb_vorbis* vorbis = stb_vorbis_open_filename(filepath, &error, NULL);
-            if (!vorbis) {
-                LOG_error("Stream: Failed to open OGG: %s (error %d)\n", filepath, error);
-                return -1;
+        ReadAhead_close(in);
+
+        if (ok && count > 0) {
+            FileCacheHeader hdr;
+            if (file_cache_header_init(&hdr, index->filepath, OGG_SEEK_INDEX_MAGIC, count)) {
+                file_cache_write("seekindex", "osi", index->filepath, &hdr, pages, count * sizeof(ProbedPage));
             }
-            sd->decoder = vorbis;
-            stb_vorbis_info info = stb_vorbis_get_info(vorbis);
-            sd->source_sample_rate = info.sample_rate;
-            sd->source_channels = info.channels;
-            sd->total_frames = stb_vorbis_stream_length_in_samples(vorbis);
-            break;
+            index->pages = pages;
+            index->count = count;
+            __atomic_store_n(&index->ready, true, __ATOMIC_RELEASE);
+        } else {
+            free(pages);
         }
-        case AUDIO_FORMAT_M4A: {
-            M4ADecoder* m4a = malloc(sizeof(M4ADecoder));
-            if (!m4a) {
-                LOG_error("Stream: Failed to allocate M4A decoder\n");
-                return -1;
-            }
-            memset(m4a, 0, sizeof(M4ADecoder));
+    }
 
-            // Open the file
-            m4a->file = fopen(filepath, "rb");
-            if (!m4a->file) {
-                free(m4a);
-                LOG_error("Stream: Failed to open M4A file: %s\n", filepath);
-                return -1;
-            }
+    __atomic_store_n(&seek_index_build_active, false, __ATOMIC_RELEASE);
+    ogg_seek_index_release(index);
+}
 
-            // Get file size
-            fseek(m4a->file, 0, SEEK_END);
-            int64_t file_size = ftell(m4a->file);
-            fseek(m4a->file, 0, SEEK_SET);
-
-            // Open MP4 demuxer
-            int track_count = MP4D_open(&m4a->mp4, m4a_read_callback, m4a->file, file_size);
-            if (track_count == 0) {
-                fclose(m4a->file);
-                free(m4a);
-                LOG_error("Stream: Failed to parse M4A container: %s\n", filepath);
-                return -1;
-            }
+// Attach a page index to an open OGG decoder: from the cache, or built in the background
+static void ogg_seek_index_attach(StreamDecoder* sd, const char* filepath) {
+    stb_vorbis* vorbis = (stb_vorbis*)sd->decoder;
+    if (vorbis->p_last.page_start <= vorbis->first_audio_page_offset) return;
+
+    OggSeekIndex* index = calloc(1, sizeof(OggSeekIndex));
+    if (!index) return;
+    index->refs = 1;
+    index->scan_start = vorbis->first_audio_page_offset;
+    index->scan_end = vorbis->p_last.page_start;
+    strncpy(index->filepath, filepath, sizeof(index->filepath) - 1);
+
+    FileCacheHeader hdr;
+    FILE* f = file_cache_open("seekindex", "osi", filepath, OGG_SEEK_INDEX_MAGIC, &hdr);
+    if (f) {
+        bool ok = hdr.count > 0 && hdr.count <= OGG_SEEK_INDEX_MAX_PAGES;
+        if (ok) {
+            index->pages = malloc(hdr.count * sizeof(ProbedPage));
+            ok = index->pages && fread(index->pages, sizeof(ProbedPage), hdr.count, f) == hdr.count;
+        }
+        fclose(f);
+        if (ok) {
+            index->count = hdr.count;
+            index->ready = true;
+            sd->seek_table = index;
+            return;
+        }
+        free(index->pages);
+        index->pages = NULL;
+    }
 
-            // Find audio track
-            m4a->audio_track = -1;
-            for (unsigned i = 0; i < m4a->mp4.track_count; i++) {
-                if (m4a->mp4.track[i].handler_type == MP4D_HANDLER_TYPE_SOUN) {
-                    m4a->audio_track = i;
-                    break;
-                }
-            }
+    // Build it, unless another file's scan is still running
+    bool expected = false;
+    if (!__atomic_compare_exchange_n(&seek_index_build_active, &expected, true,
+                                     false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(index);
+        return;
+    }
+    index->refs = 2;
+    if (Jobs_post(JOB_PRIORITY_BACKGROUND, ogg_seek_index_job, NULL, index) != 0) {
+        __atomic_store_n(&seek_index_build_active, false, __ATOMIC_RELEASE);
+        free(index);
+        return;
+    }
+    sd->seek_table = index;
+}
 
-            if (m4a->audio_track < 0) {
-                MP4D_close(&m4a->mp4);
-                fclose(m4a->file);
-                free(m4a);
-                LOG_error("Stream: No audio track found in M4A: %s\n", filepath);
-                return -1;
-            }
+// Seek with the search bounded by the indexed pages around the target
+// Returns false if there is no index yet or the bounded seek failed
+static bool ogg_seek_indexed(StreamDecoder* sd, unsigned int sample) {
+    OggSeekIndex* index = (OggSeekIndex*)sd->seek_table;
+    if (!index || !__atomic_load_n(&index->ready, __ATOMIC_ACQUIRE)) return false;
+    stb_vorbis* vorbis = (stb_vorbis*)sd->decoder;
+
+    // stb_vorbis looks for the page before sample - padding (granules mark window centres)
+    unsigned int padding = (unsigned int)((vorbis->blocksize_1 - vorbis->blocksize_0) >> 2);
+    if (sample <= padding) return false;
+    unsigned int limit = sample - padding;
+
+    // Last indexed page strictly before the limit; near the start the stock seek is fast
+    uint32_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (index->pages[mid].last_decoded_sample < limit) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0) return false;
+
+    ProbedPage left = index->pages[lo - 1];
+    ProbedPage right = (lo < index->count) ? index->pages[lo] : vorbis->p_last;
+    if (left.page_end > right.page_start) return false;
+
+    ProbedPage first = vorbis->p_first, last = vorbis->p_last;
+    vorbis->p_first = left;
+    vorbis->p_last = right;
+    bool ok = stb_vorbis_seek(vorbis, sample) != 0;
+    vorbis->p_first = first;
+    vorbis->p_last = last;
+    return ok;
+}
 
-            MP4D_track_t* track = &m4a->mp4.track[m4a->audio_track];
-            m4a->sample_count = track->sample_count;
-            m4a->sample_rate = track->SampleDescription.audio.samplerate_hz;
-            m4a->channels = track->SampleDescription.audio.channelcount;
-            m4a->current_sample = 0;
-
-            // Initialize AAC decoder
-            m4a->aac_decoder = AACInitDecoder();
-            if (!m4a->aac_decoder) {
-                MP4D_close(&m4a->mp4);
-                fclose(m4a->file);
-                free(m4a);
-                LOG_error("Stream: Failed to init AAC decoder for M4A: %s\n", filepath);
-                return -1;
-            }
+// ============ FLAC SEEK INDEX ============
 
-            // Set up AAC decoder with DSI (Decoder Specific Info)
-            if (track->dsi && track->dsi_bytes > 0) {
-                AACFrameInfo frame_info;
-                memset(&frame_info, 0, sizeof(frame_info));
-                frame_info.nChans = m4a->channels;
-                frame_info.sampRateCore = m4a->sample_rate;
-                AACSetRawBlockParams(m4a->aac_decoder, 0, &frame_info);
-            }
+// Without a SEEKTABLE block drflac seeks by bisecting the whole file, dozens of SD
+// reads per seek on a single-file album. For those files a background pass finds a
+// frame header roughly every FLAC_SEEK_INDEX_INTERVAL seconds, reading only a small
+// window at each spot estimated from the average bitrate, and caches the points.
+// Once ready they're handed to drflac as its seek table, so a seek only bisects the
+// span between two neighbouring points.
 
-            // Allocate frame buffer (AAC frames are typically < 2KB)
-            m4a->frame_buffer_size = 8192;
-            m4a->frame_buffer = malloc(m4a->frame_buffer_size);
-            if (!m4a->frame_buffer) {
-                AACFreeDecoder(m4a->aac_decoder);
-                MP4D_close(&m4a->mp4);
-                fclose(m4a->file);
-                free(m4a);
-                LOG_error("Stream: Failed to allocate M4A frame buffer\n");
-                return -1;
-            }
+#define FLAC_SEEK_INDEX_MAGIC 0x31495346  // "FSI1"
+#define FLAC_SEEK_INDEX_INTERVAL 10       // Seconds between points
+#define FLAC_SEEK_INDEX_MAX_POINTS 8192   // ~22 hours
+#define FLAC_SCAN_WINDOW (16 * 1024)
+#define FLAC_SCAN_LIMIT (1024 * 1024)     // Give up on a spot after this many bytes without a frame
+#define FLAC_FRAME_HEADER_MAX 16
 
-            // Calculate total PCM frames from track duration
-            // duration is in timescale units, need to convert to sample count
-            uint64_t duration = ((uint64_t)track->duration_hi << 32) | track->duration_lo;
-            if (track->timescale > 0 && m4a->sample_rate > 0) {
-                sd->total_frames = (duration * m4a->sample_rate) / track->timescale;
-            } else {
-                // Fallback: estimate from sample count (1024 samples per AAC frame)
-                sd->total_frames = (int64_t)m4a->sample_count * 1024;
-            }
+typedef struct {
+    int refs;
+    bool ready;                 // points/count are complete (published with release)
+    bool bound;                 // Handed to the decoder (decoder side only)
+    uint32_t count;
+    drflac_seekpoint* points;
+    // Stream parameters frame headers are validated against
+    uint64_t first_frame_offset;
+    uint64_t total_frames;
+    uint64_t file_size;
+    uint32_t sample_rate;
+    uint32_t channels;
+    uint32_t bits_per_sample;
+    uint32_t max_block_size;
+    char filepath[512];
+} FlacSeekIndex;
+
+static void flac_seek_index_release(FlacSeekIndex* index) {
+    if (!index) return;
+    if (__atomic_sub_fetch(&index->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(index->points);
+        free(index);
+    }
+}
 
-            sd->decoder = m4a;
-            sd->source_sample_rate = m4a->sample_rate;
-            sd->source_channels = m4a->channels;
-            break;
+static uint8_t flac_crc8(const uint8_t* data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
         }
-        default:
-            LOG_error("Stream: Unsupported format for streaming: %d\n", sd->format);
-            return -1;
     }
-
-    sd->current_frame = 0;
-    return 0;
+    return crc;
 }
 
-// Read chunk of audio from decoder (returns frames read, outputs stereo)
-static size_t stream_decoder_read(StreamDecoder* sd, int16_t* buffer, size_t frames) {
-    if (!sd->decoder) return 0;
+// Validate a frame header at p against the stream and return its first PCM frame, or -1
+// Besides the CRC-8 every field the header repeats from STREAMINFO has to match,
+// which rules out sync-code lookalikes inside compressed audio.
+static int64_t flac_parse_frame_header(const uint8_t* p, size_t len, const FlacSeekIndex* index,
+                                       uint32_t* block_size) {
+    static const uint32_t sample_rates[12] = {
+        0, 88200, 176400, 192000, 8000, 16000, 22050, 24000, 32000, 44100, 48000, 96000
+    };
+    static const uint32_t sample_sizes[8] = { 0, 8, 12, 0, 16, 20, 24, 32 };
+
+    if (len < FLAC_FRAME_HEADER_MAX || p[0] != 0xFF || (p[1] & 0xFE) != 0xF8) return -1;
+    bool variable = p[1] & 1;
+    int block_code = p[2] >> 4;
+    int rate_code = p[2] & 0x0F;
+    int channel_code = p[3] >> 4;
+    int size_code = (p[3] >> 1) & 0x07;
+    if (block_code == 0 || rate_code == 15 || channel_code > 10 || size_code == 3 || (p[3] & 1)) return -1;
+
+    uint32_t channels = (channel_code < 8) ? (uint32_t)channel_code + 1 : 2;
+    if (channels != index->channels) return -1;
+    if (size_code != 0 && sample_sizes[size_code] != index->bits_per_sample) return -1;
+    if (rate_code >= 1 && rate_code <= 11 && sample_rates[rate_code] != index->sample_rate) return -1;
+
+    // UTF-8 style coded frame (fixed blocking) or sample (variable blocking) number
+    size_t pos = 4;
+    uint64_t number = p[pos];
+    int extra = 0;
+    if (number >= 0x80) {
+        if (number >= 0xFE || (number & 0xC0) == 0x80) return -1;
+        while (number & (0x40 >> extra)) extra++;  // Leading ones past the first = continuation bytes
+        number &= 0x3F >> extra;
+    }
+    pos++;
+    for (int i = 0; i < extra; i++, pos++) {
+        if ((p[pos] & 0xC0) != 0x80) return -1;
+        number = (number << 6) | (p[pos] & 0x3F);
+    }
 
-    size_t frames_read = 0;
-
-    switch (sd->format) {
-        case AUDIO_FORMAT_MP3: {
-            drmp3* mp3 = (drmp3*)sd->decoder;
-            if (sd->source_channels == 1) {
-                // Read mono, convert to stereo
-                int16_t* mono = malloc(frames * sizeof(int16_t));
-                if (mono) {
-                    frames_read = drmp3_read_pcm_frames_s16(mp3, frames, mono);
-                    for (size_t i = 0; i < frames_read; i++) {
-                        buffer[i * 2] = mono[i];
-                        buffer[i * 2 + 1] = mono[i];
-                    }
-                    free(mono);
-                }
-            } else {
-                frames_read = drmp3_read_pcm_frames_s16(mp3, frames, buffer);
-            }
-            break;
-        }
-        case AUDIO_FORMAT_WAV: {
-            drwav* wav = (drwav*)sd->decoder;
-            if (sd->source_channels == 1) {
-                int16_t* mono = malloc(frames * sizeof(int16_t));
-                if (mono) {
-                    frames_read = drwav_read_pcm_frames_s16(wav, frames, mono);
-                    for (size_t i = 0; i < frames_read; i++) {
-                        buffer[i * 2] = mono[i];
-                        buffer[i * 2 + 1] = mono[i];
-                    }
-                    free(mono);
-                }
-            } else {
-                frames_read = drwav_read_pcm_frames_s16(wav, frames, buffer);
+    uint32_t samples;
+    if (block_code == 1) samples = 192;
+    else if (block_code <= 5) samples = 576u << (block_code - 2);
+    else if (block_code == 6) samples = (uint32_t)p[pos++] + 1;
+    else if (block_code == 7) { samples = (((uint32_t)p[pos] << 8) | p[pos + 1]) + 1; pos += 2; }
+    else samples = 256u << (block_code - 8);
+    if (samples > index->max_block_size) return -1;
+
+    if (rate_code == 12) pos += 1;
+    else if (rate_code == 13 || rate_code == 14) pos += 2;
+
+    if (flac_crc8(p, pos) != p[pos]) return -1;
+
+    *block_size = samples;
+    // Same numbering drflac uses for fixed-blocksize streams
+    return variable ? (int64_t)number : (int64_t)(number * index->max_block_size);
+}
+
+// Find the first valid frame header at or after offset whose first PCM frame is past
+// min_frame; returns its offset, or 0 if none turns up within FLAC_SCAN_LIMIT
+static uint64_t flac_scan_for_frame(ReadAhead* in, const FlacSeekIndex* index, uint8_t* window,
+                                    uint64_t offset, int64_t min_frame,
+                                    int64_t* first_frame, uint32_t* block_size) {
+    uint64_t limit = offset + FLAC_SCAN_LIMIT;
+    while (offset < index->file_size && offset < limit) {
+        size_t len = ReadAhead_pread(in, window, FLAC_SCAN_WINDOW, (int64_t)offset);
+        if (len < FLAC_FRAME_HEADER_MAX) return 0;
+
+        for (size_t i = 0; i + FLAC_FRAME_HEADER_MAX <= len; i++) {
+            const uint8_t* sync = memchr(window + i, 0xFF, len - FLAC_FRAME_HEADER_MAX + 1 - i);
+            if (!sync) break;
+            i = (size_t)(sync - window);
+            int64_t frame = flac_parse_frame_header(sync, len - i, index, block_size);
+            if (frame > min_frame && (uint64_t)frame < index->total_frames) {
+                *first_frame = frame;
+                return offset + i;
             }
-            break;
         }
-        case AUDIO_FORMAT_FLAC: {
-            drflac* flac = (drflac*)sd->decoder;
-            if (sd->source_channels == 1) {
-                int16_t* mono = malloc(frames * sizeof(int16_t));
-                if (mono) {
-                    frames_read = drflac_read_pcm_frames_s16(flac, frames, mono);
-                    for (size_t i = 0; i < frames_read; i++) {
-                        buffer[i * 2] = mono[i];
-                        buffer[i * 2 + 1] = mono[i];
-                    }
-                    free(mono);
-                }
-            } else {
-                frames_read = drflac_read_pcm_frames_s16(flac, frames, buffer);
+        // Overlap windows so a header straddling the boundary is still seen
+        offset += len - FLAC_FRAME_HEADER_MAX + 1;
+    }
+    return 0;
+}
+
+static void flac_seek_index_job(void* arg, JobToken* token) {
+    FlacSeekIndex* index = (FlacSeekIndex*)arg;
+
+    ReadAhead* in = ReadAhead_openDirect(index->filepath);
+    uint8_t* window = malloc(FLAC_SCAN_WINDOW);
+    uint64_t step = (uint64_t)index->sample_rate * FLAC_SEEK_INDEX_INTERVAL;
+    uint64_t max_points = index->total_frames / step + 2;
+    if (max_points > FLAC_SEEK_INDEX_MAX_POINTS) max_points = FLAC_SEEK_INDEX_MAX_POINTS;
+    drflac_seekpoint* points = malloc(max_points * sizeof(drflac_seekpoint));
+
+    uint32_t count = 0;
+    if (in && window && points) {
+        double bytes_per_frame = (double)(index->file_size - index->first_frame_offset) /
+                                 (double)index->total_frames;
+        uint64_t offset = index->first_frame_offset;
+        int64_t last_frame = -1;
+        for (uint64_t target = 0; target < index->total_frames && count < max_points; target += step) {
+            if (Jobs_cancelled(token)) {
+                count = 0;      // A partial table would be cached as complete
+                break;
             }
-            break;
+            // Aim a little early: the scan only moves forward from the estimate
+            uint64_t estimate = index->first_frame_offset + (uint64_t)(target * bytes_per_frame * 0.95);
+            if (estimate < offset) estimate = offset;
+
+            int64_t frame;
+            uint32_t block_size;
+            uint64_t found = flac_scan_for_frame(in, index, window, estimate, last_frame, &frame, &block_size);
+            if (found == 0) continue;
+
+            points[count].firstPCMFrame = (drflac_uint64)frame;
+            points[count].flacFrameOffset = found - index->first_frame_offset;
+            points[count].pcmFrameCount = (drflac_uint16)block_size;
+            count++;
+            last_frame = frame;
+            offset = found + 1;
+
+            // A frame past later targets (a bitrate peak) covers them as well
+            while (target + step <= (uint64_t)frame) target += step;
         }
-        case AUDIO_FORMAT_OGG: {
-            stb_vorbis* vorbis = (stb_vorbis*)sd->decoder;
-            // stb_vorbis always outputs interleaved, can handle stereo conversion
-            frames_read = stb_vorbis_get_samples_short_interleaved(
-                vorbis, AUDIO_CHANNELS, buffer, frames * AUDIO_CHANNELS);
-            break;
+    }
+    ReadAhead_close(in);
+    free(window);
+
+    // The first point has to be the first frame or drflac ignores the table below it
+    if (count > 1 && points[0].firstPCMFrame == 0) {
+        FileCacheHeader hdr;
+        if (file_cache_header_init(&hdr, index->filepath, FLAC_SEEK_INDEX_MAGIC, count)) {
+            file_cache_write("seekindex", "fsi", index->filepath, &hdr, points, count * sizeof(drflac_seekpoint));
         }
-        case AUDIO_FORMAT_M4A: {
-            M4ADecoder* m4a = (M4ADecoder*)sd->decoder;
-
-            // Decode AAC frames until we have enough PCM samples
-            size_t buffer_pos = 0;  // Current position in output buffer (in frames)
-
-            while (buffer_pos < frames && m4a->current_sample < m4a->sample_count) {
-                // Get frame offset and size
-                unsigned frame_bytes = 0;
-                unsigned timestamp = 0;
-                unsigned duration = 0;
-                MP4D_file_offset_t offset = MP4D_frame_offset(
-                    &m4a->mp4, m4a->audio_track, m4a->current_sample,
-                    &frame_bytes, &timestamp, &duration);
-
-                if (offset == 0 || frame_bytes == 0) {
-                    m4a->current_sample++;
-                    continue;
-                }
-
-                // Read AAC frame data
-                if (frame_bytes > m4a->frame_buffer_size) {
-                    // Resize buffer if needed
-                    uint8_t* new_buf = realloc(m4a->frame_buffer, frame_bytes);
-                    if (!new_buf) {
-                        break;
-                    }
-                    m4a->frame_buffer = new_buf;
-                    m4a->frame_buffer_size = frame_bytes;
-                }
+        index->points = points;
+        index->count = count;
+        __atomic_store_n(&index->ready, true, __ATOMIC_RELEASE);
+    } else {
+        free(points);
+    }
 
-                if (fseek(m4a->file, (long)offset, SEEK_SET) != 0) {
-                    break;
-                }
-                if (fread(m4a->frame_buffer, 1, frame_bytes, m4a->file) != frame_bytes) {
-                    break;
-                }
+    __atomic_store_n(&seek_index_build_active, false, __ATOMIC_RELEASE);
+    flac_seek_index_release(index);
+}
 
-                // Decode AAC frame
-                int16_t decode_buf[AAC_MAX_NSAMPS * AAC_MAX_NCHANS * 2];
-                unsigned char* inptr = m4a->frame_buffer;
-                int bytes_left = frame_bytes;
-
-                int err = AACDecode(m4a->aac_decoder, &inptr, &bytes_left, decode_buf);
-
-                if (err == ERR_AAC_NONE) {
-                    AACFrameInfo frame_info;
-                    AACGetLastFrameInfo(m4a->aac_decoder, &frame_info);
-
-                    if (frame_info.outputSamps > 0) {
-                        // Calculate how many frames we got
-                        int decoded_frames = frame_info.outputSamps / frame_info.nChans;
-                        int frames_to_copy = decoded_frames;
-
-                        // Don't overflow output buffer
-                        if (buffer_pos + frames_to_copy > frames) {
-                            frames_to_copy = frames - buffer_pos;
-                        }
-
-                        // Copy to output buffer, handling mono to stereo conversion
-                        if (frame_info.nChans == 1) {
-                            for (int i = 0; i < frames_to_copy; i++) {
-                                buffer[(buffer_pos + i) * 2] = decode_buf[i];
-                                buffer[(buffer_pos + i) * 2 + 1] = decode_buf[i];
-                            }
-                        } else {
-                            memcpy(&buffer[buffer_pos * 2], decode_buf,
-                                   frames_to_copy * sizeof(int16_t) * 2);
-                        }
-
-                        buffer_pos += frames_to_copy;
-                    }
-                }
+// Hand a finished index to drflac as its seek table (on the thread about to seek)
+static void flac_seek_index_bind(StreamDecoder* sd) {
+    FlacSeekIndex* index = (FlacSeekIndex*)sd->seek_table;
+    if (!index || index->bound || !__atomic_load_n(&index->ready, __ATOMIC_ACQUIRE)) return;
 
-                m4a->current_sample++;
-            }
+    // The table lives in the index, drflac_close only frees drflac's own block
+    drflac* flac = (drflac*)sd->decoder;
+    flac->pSeekpoints = index->points;
+    flac->seekpointCount = index->count;
+    index->bound = true;
+}
 
-            frames_read = buffer_pos;
-            break;
+// Give a native FLAC file without a SEEKTABLE an index: cached, or built in the background
+static void flac_seek_index_attach(StreamDecoder* sd, const char* filepath) {
+    drflac* flac = (drflac*)sd->decoder;
+    if (flac->seekpointCount > 0 || flac->container != drflac_container_native) return;
+    if (flac->totalPCMFrameCount == 0 || flac->sampleRate == 0 || flac->maxBlockSizeInPCMFrames == 0) return;
+
+    struct stat st;
+    if (stat(filepath, &st) != 0 || (uint64_t)st.st_size <= flac->firstFLACFramePosInBytes) return;
+
+    FlacSeekIndex* index = calloc(1, sizeof(FlacSeekIndex));
+    if (!index) return;
+    index->refs = 1;
+    index->first_frame_offset = flac->firstFLACFramePosInBytes;
+    index->total_frames = flac->totalPCMFrameCount;
+    index->file_size = (uint64_t)st.st_size;
+    index->sample_rate = flac->sampleRate;
+    index->channels = flac->channels;
+    index->bits_per_sample = flac->bitsPerSample;
+    index->max_block_size = flac->maxBlockSizeInPCMFrames;
+    strncpy(index->filepath, filepath, sizeof(index->filepath) - 1);
+
+    FileCacheHeader hdr;
+    FILE* f = file_cache_open("seekindex", "fsi", filepath, FLAC_SEEK_INDEX_MAGIC, &hdr);
+    if (f) {
+        bool ok = hdr.count > 1 && hdr.count <= FLAC_SEEK_INDEX_MAX_POINTS;
+        if (ok) {
+            index->points = malloc(hdr.count * sizeof(drflac_seekpoint));
+            ok = index->points && fread(index->points, sizeof(drflac_seekpoint), hdr.count, f) == hdr.count;
         }
-        default:
-            break;
+        fclose(f);
+        if (ok) {
+            index->count = hdr.count;
+            index->ready = true;
+            sd->seek_table = index;
+            flac_seek_index_bind(sd);
+            return;
+        }
+        free(index->points);
+        index->points = NULL;
     }
 
-    sd->current_frame += frames_read;
-    return frames_read;
+    bool expected = false;
+    if (!__atomic_compare_exchange_n(&seek_index_build_active, &expected, true,
+                                     false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        free(index);
+        return;
+    }
+    index->refs = 2;
+    if (Jobs_post(JOB_PRIORITY_BACKGROUND, flac_seek_index_job, NULL, index) != 0) {
+        __atomic_store_n(&seek_index_build_active, false, __ATOMIC_RELEASE);
+        free(index);
+        return;
+    }
+    sd->seek_table = index;
 }
 
-// Seek to frame position
-static int stream_decoder_seek(StreamDecoder* sd, int64_t frame) {
-    if (!sd->decoder) return -1;
-
-    if (frame < 0) frame = 0;
-    if (frame > sd->total_frames) frame = sd->total_frames;
+// ============ PARALLEL FLAC DECODE ============
+
+// Hi-res FLAC (over 16 bits at 88.2 kHz and up) keeps one core busy at a high clock
+// when decoded serially. FLAC frames decode independently, so the decode thread
+// hands the work to helpers on the cores outside the audio core: the stream is cut
+// into spans of about FLAC_PARALLEL_SPAN_FRAMES that begin at frame headers found
+// the way the seek index finds them (a short scan from a bitrate estimate), each
+// helper decodes whole spans with its own drflac into a slot, reading the decoder's
+// file at its own offsets, and the decode thread copies the slots out in order. The helper of a span scans for
+// its end exactly as the next span's helper scans for its start, so spans join
+// without gaps. A span longer than a slot (silence compresses far below the average
+// bitrate) is handed over a slot at a time, the helper waiting for each to drain.
+// A seek stops the helpers and the next read starts them at the new position; a
+// failure falls back to the serial decoder at the frame reached.
+
+#define FLAC_PARALLEL_MIN_RATE 88200
+#define FLAC_PARALLEL_SPAN_FRAMES 65536
+#define FLAC_PARALLEL_MAX_WORKERS 4
+#define FLAC_PARALLEL_SLOTS_PER_WORKER 2
+#define FLAC_PARALLEL_CHUNK_FRAMES 4096   // Helpers check for a stop between chunks
+#define FLAC_PARALLEL_COPY_FRAMES 1024
 
-    bool success = false;
-    switch (sd->format) {
-        case AUDIO_FORMAT_MP3:
-            success = drmp3_seek_to_pcm_frame((drmp3*)sd->decoder, frame);
-            break;
-        case AUDIO_FORMAT_WAV:
-            success = drwav_seek_to_pcm_frame((drwav*)sd->decoder, frame);
-            break;
-        case AUDIO_FORMAT_FLAC:
-            success = drflac_seek_to_pcm_frame((drflac*)sd->decoder, frame);
-            break;
-        case AUDIO_FORMAT_OGG:
-            success = (stb_vorbis_seek((stb_vorbis*)sd->decoder, (unsigned int)frame) != 0);
-            break;
-        case AUDIO_FORMAT_M4A: {
-            M4ADecoder* m4a = (M4ADecoder*)sd->decoder;
-            // Convert PCM frame to AAC sample index
-            // Each AAC frame typically produces 1024 PCM samples
-            unsigned target_sample = (unsigned)(frame / 1024);
-            if (target_sample >= m4a->sample_count) {
-                target_sample = m4a->sample_count > 0 ? m4a->sample_count - 1 : 0;
-            }
-            m4a->current_sample = target_sample;
-            // Flush AAC decoder state for clean seek
-            AACFlushCodec(m4a->aac_decoder);
-            success = true;
-            break;
-        }
-        default:
-            break;
-    }
+typedef struct {
+    int64_t span;               // Span it holds a part of, -1 = free
+    size_t frames;              // Frames in it once ready
+    bool ready;                 // Filled, the decode thread reads it
+    bool more;                  // The span goes on after these frames
+    int32_t* pcm;               // Left-justified, source channels interleaved
+} FlacSpanSlot;
 
-    if (success) {
-        sd->current_frame = frame;
-        return 0;
+typedef struct {
+    ReadAhead* input;           // The decoder's, read by the helpers at their own offsets
+    FlacSeekIndex params;       // Stream parameters the header scan checks (no points)
+    FlacSeekIndex* index;       // Seek index reference for the first span's seek, or NULL
+    double bytes_per_frame;
+    int worker_count;
+    int started;                // Helpers running (0 = stopped)
+    pthread_t workers[FLAC_PARALLEL_MAX_WORKERS];
+    int slot_count;
+    FlacSpanSlot slots[FLAC_PARALLEL_MAX_WORKERS * FLAC_PARALLEL_SLOTS_PER_WORKER];
+
+    // Under mutex while the helpers run
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool quit;
+    bool failed;
+    int64_t start_frame;        // First frame of span 0
+    uint64_t start_offset;      // About where span 0 is in the file, the estimates start there
+    int64_t span_count;
+    int64_t next_span;          // Next span a helper takes
+    int64_t read_span;          // Span the decode thread reads
+    size_t read_pos;            // Frames of its ready slot handed out
+    PcmStereoFromS32 convert;   // Picked on the first read, the stream format is fixed
+} FlacParallel;
+
+// First frame of a span and the offset of its frame header (0: reach it by seeking)
+// A span starts at the first frame header in [nominal, nominal + FLAC_PARALLEL_SPAN_FRAMES),
+// or at nominal itself (a drflac seek) when the scan finds none there, so starts only
+// ever increase and spans never overlap. Spans past the end start at total_frames.
+static void flac_parallel_span_start(FlacParallel* fp, uint8_t* window, int64_t span,
+                                     int64_t* frame, uint64_t* offset) {
+    *offset = 0;
+    if (span == 0) {
+        *frame = fp->start_frame;
+        return;
     }
-    return -1;
+    *frame = (int64_t)fp->params.total_frames;
+    int64_t nominal = fp->start_frame + span * FLAC_PARALLEL_SPAN_FRAMES;
+    if (nominal >= (int64_t)fp->params.total_frames) return;
+    *frame = nominal;
+
+    // Aim a little short: the scan only goes forward
+    uint64_t estimate = fp->start_offset +
+                        (uint64_t)((double)(nominal - fp->start_frame) * fp->bytes_per_frame * 0.95);
+    int64_t found_frame;
+    uint32_t block_size;
+    uint64_t found = flac_scan_for_frame(fp->input, &fp->params, window, estimate, nominal - 1,
+                                         &found_frame, &block_size);
+    if (found == 0 || found_frame >= nominal + FLAC_PARALLEL_SPAN_FRAMES) return;
+    *frame = found_frame;
+    *offset = found;
 }
 
-// Close decoder
-static void stream_decoder_close(StreamDecoder* sd) {
-    if (!sd->decoder) return;
+// Put drflac at a frame header known to start at frame (as a seek to the first frame does)
+static bool flac_parallel_position(drflac* flac, uint64_t offset, int64_t frame) {
+    if (!drflac__seek_to_byte(&flac->bs, offset)) return false;
+    memset(&flac->currentFLACFrame, 0, sizeof(flac->currentFLACFrame));
+    flac->currentPCMFrame = (drflac_uint64)frame;
+    return true;
+}
 
-    switch (sd->format) {
-        case AUDIO_FORMAT_MP3:
-            drmp3_uninit((drmp3*)sd->decoder);
-            free(sd->decoder);
-            break;
-        case AUDIO_FORMAT_WAV:
-            drwav_uninit((drwav*)sd->decoder);
-            free(sd->decoder);
-            break;
-        case AUDIO_FORMAT_FLAC:
-            drflac_close((drflac*)sd->decoder);
-            break;
-        case AUDIO_FORMAT_OGG:
-            stb_vorbis_close((stb_vorbis*)sd->decoder);
-            break;
-        case AUDIO_FORMAT_M4A: {
-            M4ADecoder* m4a = (M4ADecoder*)sd->decoder;
-            if (m4a->aac_decoder) {
-                AACFreeDecoder(m4a->aac_decoder);
-            }
-            if (m4a->frame_buffer) {
-                free(m4a->frame_buffer);
-            }
-            MP4D_close(&m4a->mp4);
-            if (m4a->file) {
-                fclose(m4a->file);
-            }
-            free(m4a);
-            break;
+// Decode one span into its slot, a slot's worth at a time
+// Returns false on a read error or a stop.
+static bool flac_parallel_decode_span(FlacParallel* fp, drflac* flac, uint8_t* window, int64_t span) {
+    int64_t start, end;
+    uint64_t offset, end_offset;
+    flac_parallel_span_start(fp, window, span, &start, &offset);
+    flac_parallel_span_start(fp, window, span + 1, &end, &end_offset);
+    if (end < start) end = start;
+
+    bool ok = offset ? flac_parallel_position(flac, offset, start)
+                     : drflac_seek_to_pcm_frame(flac, (drflac_uint64)start);
+    FlacSpanSlot* slot = &fp->slots[span % fp->slot_count];
+    uint64_t remaining = (uint64_t)(end - start);
+    do {
+        // Wait for the decode thread to take the previous part
+        pthread_mutex_lock(&fp->mutex);
+        while (slot->ready && !fp->quit) pthread_cond_wait(&fp->cond, &fp->mutex);
+        bool quit = fp->quit;
+        pthread_mutex_unlock(&fp->mutex);
+        if (quit) return false;
+
+        size_t want = remaining < FLAC_PARALLEL_SPAN_FRAMES ? (size_t)remaining : FLAC_PARALLEL_SPAN_FRAMES;
+        size_t got = 0;
+        while (ok && got < want) {
+            if (__atomic_load_n(&fp->quit, __ATOMIC_RELAXED)) return false;
+            size_t chunk = want - got < FLAC_PARALLEL_CHUNK_FRAMES ? want - got : FLAC_PARALLEL_CHUNK_FRAMES;
+            size_t n = (size_t)drflac_read_pcm_frames_s32(flac, chunk, &slot->pcm[got * fp->params.channels]);
+            got += n;
+            if (n < chunk) break;
+        }
+        if (!ok || got < want) {
+            // Short of the stream's stated length: what there is ends it
+            if (!ok || got == 0) return false;
+            remaining = got;
         }
-        default:
-            break;
-    }
 
-    sd->decoder = NULL;
-    sd->format = AUDIO_FORMAT_UNKNOWN;
+        pthread_mutex_lock(&fp->mutex);
+        remaining -= got;
+        slot->frames = got;
+        slot->more = remaining > 0;
+        slot->ready = true;
+        pthread_cond_broadcast(&fp->cond);
+        pthread_mutex_unlock(&fp->mutex);
+    } while (remaining > 0);
+    return true;
 }
 
-// ============ STREAMING RESAMPLER ============
+// A helper's own position in the decoder's input
+typedef struct {
+    ReadAhead* input;
+    int64_t pos;
+} FlacHelperInput;
+
+static size_t flac_helper_read(void* user, void* buffer, size_t bytes) {
+    FlacHelperInput* in = (FlacHelperInput*)user;
+    size_t n = ReadAhead_pread(in->input, buffer, bytes, in->pos);
+    in->pos += (int64_t)n;
+    return n;
+}
 
-// Resample a chunk of audio (for streaming)
-// Returns number of output frames
-static size_t resample_chunk(int16_t* input, size_t input_frames,
-                             int src_rate, int dst_rate,
-                             int16_t* output, size_t max_output_frames,
-                             SRC_STATE* src_state, bool is_last) {
-    if (src_rate == dst_rate) {
-        // No resampling needed, just copy
-        size_t to_copy = (input_frames < max_output_frames) ? input_frames : max_output_frames;
-        memcpy(output, input, to_copy * sizeof(int16_t) * AUDIO_CHANNELS);
-        return to_copy;
-    }
+static drflac_bool32 flac_helper_seek(void* user, int offset, drflac_seek_origin origin) {
+    FlacHelperInput* in = (FlacHelperInput*)user;
+    int64_t base = origin == DRFLAC_SEEK_CUR ? in->pos : origin == DRFLAC_SEEK_END ? ReadAhead_size(in->input) : 0;
+    int64_t target = base + offset;
+    if (target < 0 || target > ReadAhead_size(in->input)) return DRFLAC_FALSE;
+    in->pos = target;
+    return DRFLAC_TRUE;
+}
 
-    double ratio = (double)dst_rate / (double)src_rate;
+static drflac_bool32 flac_helper_tell(void* user, drflac_int64* cursor) {
+    *cursor = ((FlacHelperInput*)user)->pos;
+    return DRFLAC_TRUE;
+}
 
-    // Convert input to float
-    float* float_in = malloc(input_frames * AUDIO_CHANNELS * sizeof(float));
-    float* float_out = malloc(max_output_frames * AUDIO_CHANNELS * sizeof(float));
-    if (!float_in || !float_out) {
-        free(float_in);
-        free(float_out);
-        return 0;
+static void* flac_parallel_worker(void* arg) {
+    FlacParallel* fp = (FlacParallel*)arg;
+    ThreadRole_apply(THREAD_ROLE_DECODE_HELPER);
+
+    // Positional reads of the decoder's file: no descriptor of its own, no seeks
+    FlacHelperInput input = {fp->input, 0};
+    drflac* flac = drflac_open(flac_helper_read, flac_helper_seek, flac_helper_tell, &input, NULL);
+    uint8_t* window = malloc(FLAC_SCAN_WINDOW);
+    bool ok = flac && window;
+    if (ok && fp->index) {
+        // Shared read-only, drflac_close only frees drflac's own block
+        flac->pSeekpoints = fp->index->points;
+        flac->seekpointCount = fp->index->count;
     }
 
-    for (size_t i = 0; i < input_frames * AUDIO_CHANNELS; i++) {
-        float_in[i] = input[i] / 32768.0f;
+    pthread_mutex_lock(&fp->mutex);
+    while (ok && !fp->quit && fp->next_span < fp->span_count) {
+        int64_t span = fp->next_span;
+        // Its slot is free once the decode thread is past the span that used it last
+        if (span >= fp->read_span + fp->slot_count) {
+            pthread_cond_wait(&fp->cond, &fp->mutex);
+            continue;
+        }
+        fp->next_span++;
+        FlacSpanSlot* slot = &fp->slots[span % fp->slot_count];
+        slot->span = span;
+        slot->ready = false;
+        pthread_mutex_unlock(&fp->mutex);
+
+        ok = flac_parallel_decode_span(fp, flac, window, span);
+        pthread_mutex_lock(&fp->mutex);
     }
+    if (!ok && !fp->quit) {
+        fp->failed = true;
+        pthread_cond_broadcast(&fp->cond);
+    }
+    pthread_mutex_unlock(&fp->mutex);
 
-    // Setup conversion
-    SRC_DATA src_data;
-    src_data.data_in = float_in;
-    src_data.data_out = float_out;
-    src_data.input_frames = input_frames;
-    src_data.output_frames = max_output_frames;
-    src_data.src_ratio = ratio;
-    src_data.end_of_input = is_last ? 1 : 0;
+    free(window);
+    if (flac) drflac_close(flac);
+    return NULL;
+}
 
-    int error = src_process(src_state, &src_data);
-    if (error) {
-        LOG_error("Resample chunk failed: %s\n", src_strerror(error));
-        free(float_in);
-        free(float_out);
-        return 0;
+// Stop and join the helpers; the slots are kept for the next start
+static void flac_parallel_stop(FlacParallel* fp) {
+    if (!fp || fp->started == 0) return;
+    pthread_mutex_lock(&fp->mutex);
+    fp->quit = true;
+    pthread_cond_broadcast(&fp->cond);
+    pthread_mutex_unlock(&fp->mutex);
+    for (int i = 0; i < fp->started; i++) {
+        pthread_join(fp->workers[i], NULL);
     }
+    fp->started = 0;
+}
 
-    // Convert output back to int16
-    size_t output_frames = src_data.output_frames_gen;
-    for (size_t i = 0; i < output_frames * AUDIO_CHANNELS; i++) {
-        float sample = float_out[i] * 32767.0f;
-        if (sample > 32767.0f) sample = 32767.0f;
-        if (sample < -32768.0f) sample = -32768.0f;
-        output[i] = (int16_t)sample;
+// Start the helpers at frame; false if not a single one started
+static bool flac_parallel_start(FlacParallel* fp, int64_t frame, FlacSeekIndex* index) {
+    // An index finished since the last start speeds up the first span's seek
+    if (!fp->index && index && __atomic_load_n(&index->ready, __ATOMIC_ACQUIRE)) {
+        __atomic_add_fetch(&index->refs, 1, __ATOMIC_ACQ_REL);
+        fp->index = index;
+    }
+    if (fp->slots[0].pcm == NULL) {
+        size_t bytes = (size_t)FLAC_PARALLEL_SPAN_FRAMES * fp->params.channels * sizeof(int32_t);
+        for (int i = 0; i < fp->slot_count; i++) {
+            fp->slots[i].pcm = MEM_MALLOC(MEM_TAG_PLAYER_BUFFER, bytes);
+            if (!fp->slots[i].pcm) return false;
+        }
+    }
+    for (int i = 0; i < fp->slot_count; i++) {
+        fp->slots[i].span = -1;
+        fp->slots[i].ready = false;
     }
+    fp->quit = false;
+    fp->failed = false;
+    fp->start_frame = frame;
+    // The serial decoder was just put at frame, its reads are about there
+    int64_t tell = ReadAhead_tell(fp->input);
+    fp->start_offset = tell > (int64_t)fp->params.first_frame_offset ? (uint64_t)tell : fp->params.first_frame_offset;
+    fp->span_count = ((int64_t)fp->params.total_frames - frame + FLAC_PARALLEL_SPAN_FRAMES - 1) /
+                     FLAC_PARALLEL_SPAN_FRAMES;
+    fp->next_span = 0;
+    fp->read_span = 0;
+    fp->read_pos = 0;
+
+    for (int i = 0; i < fp->worker_count; i++) {
+        if (pthread_create(&fp->workers[fp->started], NULL, flac_parallel_worker, fp) == 0) fp->started++;
+    }
+    return fp->started > 0;
+}
 
-    free(float_in);
-    free(float_out);
-    return output_frames;
+static void flac_parallel_free(FlacParallel* fp) {
+    if (!fp) return;
+    flac_parallel_stop(fp);
+    for (int i = 0; i < fp->slot_count; i++) {
+        MEM_FREE(MEM_TAG_PLAYER_BUFFER, fp->slots[i].pcm);
+    }
+    flac_seek_index_release(fp->index);
+    pthread_mutex_destroy(&fp->mutex);
+    pthread_cond_destroy(&fp->cond);
+    free(fp);
 }
 
-// ============ STREAMING DECODE THREAD ============
+// Set a hi-res native FLAC stream up for parallel decoding (helpers start on the first read)
+static void flac_parallel_attach(StreamDecoder* sd) {
+    drflac* flac = (drflac*)sd->decoder;
+    if (flac->container != drflac_container_native || flac->bitsPerSample <= 16 ||
+        flac->sampleRate < FLAC_PARALLEL_MIN_RATE || flac->channels < 1 || flac->channels > 2) return;
+    if (flac->totalPCMFrameCount == 0 || flac->maxBlockSizeInPCMFrames == 0) return;
+
+    // One helper per core outside the audio core, two at least to be worth it
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    if (workers < 2) return;
+    if (workers > FLAC_PARALLEL_MAX_WORKERS) workers = FLAC_PARALLEL_MAX_WORKERS;
+
+    ReadAhead* input = (ReadAhead*)sd->input;
+    int64_t file_size = ReadAhead_size(input);
+    if ((uint64_t)file_size <= flac->firstFLACFramePosInBytes) return;
+
+    FlacParallel* fp = calloc(1, sizeof(FlacParallel));
+    if (!fp) return;
+    fp->input = input;
+    fp->params.first_frame_offset = flac->firstFLACFramePosInBytes;
+    fp->params.total_frames = flac->totalPCMFrameCount;
+    fp->params.file_size = (uint64_t)file_size;
+    fp->params.sample_rate = flac->sampleRate;
+    fp->params.channels = flac->channels;
+    fp->params.bits_per_sample = flac->bitsPerSample;
+    fp->params.max_block_size = flac->maxBlockSizeInPCMFrames;
+    fp->bytes_per_frame = (double)(fp->params.file_size - fp->params.first_frame_offset) /
+                          (double)fp->params.total_frames;
+    fp->worker_count = workers;
+    fp->slot_count = workers * FLAC_PARALLEL_SLOTS_PER_WORKER;
+    pthread_mutex_init(&fp->mutex, NULL);
+    pthread_cond_init(&fp->cond, NULL);
+    sd->parallel = fp;
+}
 
-static void* stream_thread_func(void* arg) {
-    (void)arg;
+// Give up on the helpers and carry on with the serial decoder where they left off
+static void flac_parallel_fail(StreamDecoder* sd) {
+    LOG_info("Stream: Parallel FLAC decode failed, continuing serially\n");
+    flac_parallel_free((FlacParallel*)sd->parallel);
+    sd->parallel = NULL;
+    flac_seek_index_bind(sd);
+    drflac_seek_to_pcm_frame((drflac*)sd->decoder, (drflac_uint64)sd->current_frame);
+}
 
-    // Allocate decode buffer
-    int16_t* decode_buffer = malloc(DECODE_CHUNK_FRAMES * sizeof(int16_t) * AUDIO_CHANNELS);
-    // Resample output buffer (allow for 2x expansion)
-    size_t resample_buffer_size = DECODE_CHUNK_FRAMES * 3;
-    int16_t* resample_buffer = malloc(resample_buffer_size * sizeof(int16_t) * AUDIO_CHANNELS);
+// Kernel copying decoded span frames out as stereo in a stream format
+static PcmStereoFromS32 flac_parallel_kernel(PcmFormat format) {
+    switch (format) {
+        case PCM_FORMAT_S32: return Pcm_stereoS32ToS32;
+        case PCM_FORMAT_F32: return Pcm_stereoS32ToF32;
+        default: return Pcm_stereoS32ToS16;
+    }
+}
 
-    if (!decode_buffer || !resample_buffer) {
-        LOG_error("Stream thread: Failed to allocate buffers\n");
-        free(decode_buffer);
-        free(resample_buffer);
-        return NULL;
+static size_t pcm_frame_bytes(PcmFormat format);
+
+// Read from the helpers' spans in order; 0 at the end of the stream
+// On a failure the decoder is switched back to serial (sd->parallel cleared).
+static size_t flac_parallel_read(StreamDecoder* sd, PcmFormat format, void* buffer, size_t frames) {
+    FlacParallel* fp = (FlacParallel*)sd->parallel;
+    if (fp->started == 0 && !flac_parallel_start(fp, sd->current_frame, (FlacSeekIndex*)sd->seek_table)) {
+        flac_parallel_fail(sd);
+        return 0;
     }
 
-    while (player.stream_running) {
-        // Check if seeking requested
-        if (player.stream_seeking) {
-            stream_decoder_seek(&player.stream_decoder, player.seek_target_frame);
-            circular_buffer_clear(&player.stream_buffer);
-            if (player.resampler) {
-                src_reset((SRC_STATE*)player.resampler);
-            }
-            player.stream_eof = false;  // Reset EOF flag on seek
-            player.stream_seeking = false;
+    if (!fp->convert) fp->convert = flac_parallel_kernel(format);
+    int channels = (int)fp->params.channels;
+    size_t frame_bytes = pcm_frame_bytes(format);
+    size_t got = 0;
+    pthread_mutex_lock(&fp->mutex);
+    while (got < frames && !fp->failed && fp->read_span < fp->span_count) {
+        FlacSpanSlot* slot = &fp->slots[fp->read_span % fp->slot_count];
+        if (slot->span != fp->read_span || !slot->ready) {
+            pthread_cond_wait(&fp->cond, &fp->mutex);
+            continue;
         }
 
-        // Check if buffer needs more data (< 50% full)
-        size_t available = circular_buffer_available(&player.stream_buffer);
-        if (available < STREAM_BUFFER_FRAMES / 2) {
-            // Decode a chunk
-            size_t decoded = stream_decoder_read(&player.stream_decoder,
-                                                  decode_buffer, DECODE_CHUNK_FRAMES);
-            if (decoded == 0) {
-                // Decoder has reached end of file
-                player.stream_eof = true;
-            } else {
-                // Resample chunk to target rate if needed
-                int src_rate = player.stream_decoder.source_sample_rate;
-                int dst_rate = get_target_sample_rate();
-                bool is_last = (player.stream_decoder.current_frame >= player.stream_decoder.total_frames);
-
-                size_t output_frames;
-                if (src_rate == dst_rate) {
-                    // No resampling needed
-                    output_frames = decoded;
-                    circular_buffer_write(&player.stream_buffer, decode_buffer, output_frames);
-                } else {
-                    // Resample
-                    output_frames = resample_chunk(decode_buffer, decoded,
-                                                   src_rate, dst_rate,
-                                                   resample_buffer, resample_buffer_size,
-                                                   (SRC_STATE*)player.resampler, is_last);
-                    circular_buffer_write(&player.stream_buffer, resample_buffer, output_frames);
-                }
+        // A ready slot is the decode thread's until handed back
+        size_t n = slot->frames - fp->read_pos;
+        if (n > frames - got) n = frames - got;
+        if (n > FLAC_PARALLEL_COPY_FRAMES) n = FLAC_PARALLEL_COPY_FRAMES;
+        pthread_mutex_unlock(&fp->mutex);
+        fp->convert(&slot->pcm[fp->read_pos * channels], channels,
+                    (uint8_t*)buffer + got * frame_bytes, n);
+        pthread_mutex_lock(&fp->mutex);
+        fp->read_pos += n;
+        got += n;
+
+        if (fp->read_pos >= slot->frames) {
+            fp->read_pos = 0;
+            slot->ready = false;
+            if (!slot->more) {
+                slot->span = -1;
+                fp->read_span++;
             }
-        } else {
-            // Buffer full enough, sleep briefly
-            usleep(5000);  // 5ms
+            pthread_cond_broadcast(&fp->cond);
         }
     }
+    bool failed = fp->failed;
+    pthread_mutex_unlock(&fp->mutex);
 
-    free(decode_buffer);
-    free(resample_buffer);
-    return NULL;
+    sd->current_frame += got;
+    if (failed && got == 0) flac_parallel_fail(sd);
+    return got;
 }
 
-// ============ END STREAMING PLAYBACK SYSTEM ============
+// ============ STREAMING DECODER INTERFACE ============
 
-// Audio callback - SDL pulls audio data from here
-static void audio_callback(void* userdata, Uint8* stream, int len) {
-    PlayerContext* ctx = (PlayerContext*)userdata;
-    int samples_needed = len / (sizeof(int16_t) * AUDIO_CHANNELS);
-    int16_t* out = (int16_t*)stream;
+// A file still being downloaded (YouTube play now) is read through a GrowingReader:
+// a read past its current end waits for the writer instead of returning short, so
+// the decoder follows behind the download. Player_stop interrupts the waits.
+#define GROWING_POLL_MS 100
 
-    // Check if radio is active - handle radio audio separately
-    if (Radio_isActive()) {
-        // Only get audio when radio is actually playing (not buffering)
-        if (Radio_getState() == RADIO_STATE_PLAYING) {
-            // Get audio from radio module
-            int samples_got = Radio_getAudioSamples(out, samples_needed * AUDIO_CHANNELS);
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    char filepath[512];
+    int duration_ms;
+    bool writing;               // Writer still appending
+    unsigned generation;        // Bumped by Player_stop, ends the waits of older readers
+} growing = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
 
-            // If we got less than needed, fill rest with silence
-            if (samples_got < samples_needed * AUDIO_CHANNELS) {
-                memset(&out[samples_got], 0, (samples_needed * AUDIO_CHANNELS - samples_got) * sizeof(int16_t));
-            }
+typedef struct {
+    int fd;
+    int64_t pos;                // Read with pread from here
+    int duration_ms;            // Expected length, the file's own isn't known yet
+    unsigned generation;
+} GrowingReader;
+
+void Player_setGrowingFile(const char* filepath, int duration_ms) {
+    pthread_mutex_lock(&growing.mutex);
+    snprintf(growing.filepath, sizeof(growing.filepath), "%s", filepath);
+    growing.duration_ms = duration_ms;
+    growing.writing = true;
+    pthread_mutex_unlock(&growing.mutex);
+}
 
-            // Apply volume with logarithmic curve for natural perceived loudness
-            if (ctx->volume < 0.99f || ctx->volume > 1.01f) {
-                float curved_vol = apply_volume_curve(ctx->volume);
-                for (int i = 0; i < samples_needed * AUDIO_CHANNELS; i++) {
-                    out[i] = (int16_t)(out[i] * curved_vol);
-                }
-            }
-        } else {
-            // Still buffering - output silence
-            memset(stream, 0, len);
+void Player_endGrowingFile(void) {
+    pthread_mutex_lock(&growing.mutex);
+    growing.writing = false;
+    pthread_cond_broadcast(&growing.cond);
+    pthread_mutex_unlock(&growing.mutex);
+}
+
+// Wake the readers waiting for data, they return what they have
+static void growing_interrupt(void) {
+    pthread_mutex_lock(&growing.mutex);
+    growing.generation++;
+    pthread_cond_broadcast(&growing.cond);
+    pthread_mutex_unlock(&growing.mutex);
+}
+
+// Open a reader if filepath is the file being written, NULL otherwise
+static GrowingReader* growing_reader_open(const char* filepath) {
+    pthread_mutex_lock(&growing.mutex);
+    bool match = growing.writing && strcmp(growing.filepath, filepath) == 0;
+    int duration_ms = growing.duration_ms;
+    unsigned generation = growing.generation;
+    pthread_mutex_unlock(&growing.mutex);
+    if (!match) return NULL;
+
+    GrowingReader* reader = malloc(sizeof(GrowingReader));
+    if (!reader) return NULL;
+    reader->fd = open(filepath, O_RDONLY);
+    if (reader->fd < 0) {
+        free(reader);
+        return NULL;
+    }
+    reader->pos = 0;
+    reader->duration_ms = duration_ms;
+    reader->generation = generation;
+    return reader;
+}
+
+static void growing_reader_close(GrowingReader* reader) {
+    if (!reader) return;
+    close(reader->fd);
+    free(reader);
+}
+
+// Wait a poll interval for more data; false once there won't be any
+static bool growing_wait(GrowingReader* reader) {
+    pthread_mutex_lock(&growing.mutex);
+    bool waiting = growing.writing && growing.generation == reader->generation;
+    if (waiting) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += GROWING_POLL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
         }
+        pthread_cond_timedwait(&growing.cond, &growing.mutex, &deadline);
+    }
+    pthread_mutex_unlock(&growing.mutex);
+    return waiting;
+}
 
-        return;
+// Read what the file has at the reader's position, up to bytes
+static size_t growing_pread(GrowingReader* reader, uint8_t* buffer, size_t bytes) {
+    size_t total = 0;
+    while (total < bytes) {
+        ssize_t n = pread(reader->fd, buffer + total, bytes - total, reader->pos);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        total += (size_t)n;
+        reader->pos += n;
     }
+    return total;
+}
 
-    // Try to lock, if can't, output silence (non-blocking to prevent crackling)
-    if (pthread_mutex_trylock(&ctx->mutex) != 0) {
-        memset(stream, 0, len);
-        return;
+static size_t growing_read(void* user, void* buffer, size_t bytes) {
+    GrowingReader* reader = (GrowingReader*)user;
+    size_t total = 0;
+    while (total < bytes) {
+        total += growing_pread(reader, (uint8_t*)buffer + total, bytes - total);
+        if (total == bytes) break;
+        if (!growing_wait(reader)) {
+            // Writer finished since the last read: take what it added last
+            total += growing_pread(reader, (uint8_t*)buffer + total, bytes - total);
+            break;
+        }
     }
+    return total;
+}
 
-    if (ctx->state != PLAYER_STATE_PLAYING) {
-        memset(stream, 0, len);
-        pthread_mutex_unlock(&ctx->mutex);
-        return;
+// No tell callback: dr_mp3 would look for end tags at an end that's still moving
+static drmp3_bool32 growing_seek(void* user, int offset, drmp3_seek_origin origin) {
+    GrowingReader* reader = (GrowingReader*)user;
+    int64_t base = reader->pos;
+    if (origin == DRMP3_SEEK_SET) {
+        base = 0;
+    } else if (origin == DRMP3_SEEK_END) {
+        struct stat st;
+        if (fstat(reader->fd, &st) != 0) return DRMP3_FALSE;
+        base = st.st_size;
     }
+    if (base + offset < 0) return DRMP3_FALSE;
+    reader->pos = base + offset;
+    return DRMP3_TRUE;
+}
 
-    // ============ STREAMING MODE ============
-    if (ctx->use_streaming) {
-        // Read from circular buffer
-        size_t samples_read = circular_buffer_read(&ctx->stream_buffer, out, samples_needed);
+// The length of a file still being written is an estimate: keep it ahead of the
+// decoder, until a read comes back empty at the real end
+static void growing_track_length(StreamDecoder* sd, size_t frames_read) {
+    if (frames_read == 0) {
+        sd->total_frames = sd->current_frame;
+    } else if (sd->current_frame + sd->source_sample_rate > sd->total_frames) {
+        sd->total_frames = sd->current_frame + sd->source_sample_rate;
+    }
+}
 
-        // If not enough data, fill rest with silence
-        if (samples_read < (size_t)samples_needed) {
-            memset(&out[samples_read * AUDIO_CHANNELS], 0,
-                   (samples_needed - samples_read) * sizeof(int16_t) * AUDIO_CHANNELS);
-        }
+// FLAC, WAV and MP3 files are read through the read-ahead I/O thread
+static size_t file_input_read(void* user, void* buffer, size_t bytes) {
+    return ReadAhead_read((ReadAhead*)user, buffer, bytes);
+}
 
-        // Apply volume with logarithmic curve for natural perceived loudness
-        if (ctx->volume < 0.99f || ctx->volume > 1.01f) {
-            float curved_vol = apply_volume_curve(ctx->volume);
-            for (size_t i = 0; i < samples_read * AUDIO_CHANNELS; i++) {
-                out[i] = (int16_t)(out[i] * curved_vol);
-            }
-        }
+static drflac_bool32 file_input_seek_flac(void* user, int offset, drflac_seek_origin origin) {
+    int whence = origin == DRFLAC_SEEK_CUR ? SEEK_CUR : origin == DRFLAC_SEEK_END ? SEEK_END : SEEK_SET;
+    return ReadAhead_seek((ReadAhead*)user, offset, whence) == 0;
+}
 
-        // Copy to visualization buffer (non-blocking)
-        if (samples_read > 0 && pthread_mutex_trylock(&ctx->vis_mutex) == 0) {
-            int vis_samples = samples_read * AUDIO_CHANNELS;
-            if (vis_samples > 2048) vis_samples = 2048;
-            memcpy(ctx->vis_buffer, out, vis_samples * sizeof(int16_t));
-            ctx->vis_buffer_pos = vis_samples;
-            pthread_mutex_unlock(&ctx->vis_mutex);
-        }
+static drflac_bool32 file_input_tell_flac(void* user, drflac_int64* cursor) {
+    *cursor = ReadAhead_tell((ReadAhead*)user);
+    return DRFLAC_TRUE;
+}
 
-        // Update position
-        audio_position_samples += samples_read;
-        ctx->position_ms = (audio_position_samples * 1000) / current_sample_rate;
+static drwav_bool32 file_input_seek_wav(void* user, int offset, drwav_seek_origin origin) {
+    int whence = origin == DRWAV_SEEK_CUR ? SEEK_CUR : origin == DRWAV_SEEK_END ? SEEK_END : SEEK_SET;
+    return ReadAhead_seek((ReadAhead*)user, offset, whence) == 0;
+}
 
-        // Check if track ended (decoder reached EOF or frame count)
-        if ((ctx->stream_decoder.current_frame >= ctx->stream_decoder.total_frames || ctx->stream_eof) &&
-            circular_buffer_available(&ctx->stream_buffer) == 0) {
-            if (ctx->repeat) {
-                // Seek back to beginning
-                ctx->seek_target_frame = 0;
-                ctx->stream_seeking = true;
-                audio_position_samples = 0;
-                ctx->position_ms = 0;
-            } else {
-                ctx->state = PLAYER_STATE_STOPPED;
-                audio_position_samples = 0;
-                ctx->position_ms = 0;
+static drwav_bool32 file_input_tell_wav(void* user, drwav_int64* cursor) {
+    *cursor = ReadAhead_tell((ReadAhead*)user);
+    return DRWAV_TRUE;
+}
+
+static drmp3_bool32 file_input_seek_mp3(void* user, int offset, drmp3_seek_origin origin) {
+    int whence = origin == DRMP3_SEEK_CUR ? SEEK_CUR : origin == DRMP3_SEEK_END ? SEEK_END : SEEK_SET;
+    return ReadAhead_seek((ReadAhead*)user, offset, whence) == 0;
+}
+
+static drmp3_bool32 file_input_tell_mp3(void* user, drmp3_int64* cursor) {
+    *cursor = ReadAhead_tell((ReadAhead*)user);
+    return DRMP3_TRUE;
+}
+
+// Open an OGG file inside a pooled arena, doubling it while stb_vorbis runs out of memory
+static stb_vorbis* vorbis_open_pooled(const char* filepath, void** arena, int* error) {
+    int size = __atomic_load_n(&vorbis_arena_size, __ATOMIC_RELAXED);
+    for (;;) {
+        void* memory = decoder_pool_alloc(size);
+        if (!memory) {
+            *error = VORBIS_outofmem;
+            return NULL;
+        }
+
+        // A recycled block may be larger than asked for, let stb_vorbis use all of it
+        stb_vorbis_alloc alloc;
+        alloc.alloc_buffer = memory;
+        alloc.alloc_buffer_length_in_bytes = (int)decoder_pool_block_size(memory);
+        stb_vorbis* vorbis = stb_vorbis_open_filename(filepath, error, &alloc);
+        if (vorbis) {
+            if (size > __atomic_load_n(&vorbis_arena_size, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&vorbis_arena_size, size, __ATOMIC_RELAXED);
             }
+            *arena = memory;
+            return vorbis;
         }
 
-        pthread_mutex_unlock(&ctx->mutex);
-        return;
+        decoder_pool_free(memory);
+        if (*error != VORBIS_outofmem || size >= VORBIS_ARENA_MAX) return NULL;
+        size *= 2;
     }
+}
 
-    // No audio loaded - output silence
-    memset(stream, 0, len);
-    pthread_mutex_unlock(&ctx->mutex);
+// Initialise Helix inside a pooled arena (a full reset, no allocation once warm)
+// Falls back to Helix's own allocation if no arena size fits
+static HAACDecoder aac_decoder_open_pooled(void** arena) {
+    *arena = NULL;
+    for (int size = __atomic_load_n(&aac_arena_size, __ATOMIC_RELAXED); size <= AAC_ARENA_MAX; size *= 2) {
+        void* memory = decoder_pool_alloc(size);
+        if (!memory) break;
+
+        HAACDecoder decoder = AACInitDecoderPre(memory, (int)decoder_pool_block_size(memory));
+        if (decoder) {
+            if (size > __atomic_load_n(&aac_arena_size, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&aac_arena_size, size, __ATOMIC_RELAXED);
+            }
+            *arena = memory;
+            return decoder;
+        }
+        decoder_pool_free(memory);
+    }
+    return AACInitDecoder();
 }
 
-int Player_init(void) {
-    memset(&player, 0, sizeof(PlayerContext));
+// Bytes per stereo frame in a stream sample format
+static size_t pcm_frame_bytes(PcmFormat format) {
+    return (format == PCM_FORMAT_S16 ? sizeof(int16_t) : sizeof(int32_t)) * AUDIO_CHANNELS;
+}
 
-    pthread_mutex_init(&player.mutex, NULL);
-    pthread_mutex_init(&player.vis_mutex, NULL);
+static void stream_decoder_drop_preroll(StreamDecoder* sd) {
+    free(sd->preroll);
+    sd->preroll = NULL;
+    sd->preroll_frames = 0;
+    sd->preroll_pos = 0;
+}
 
-    player.volume = 1.0f;
-    player.state = PLAYER_STATE_STOPPED;
+// Keep candidate in *best if it is nearer to frame (*best < 0 = nothing yet)
+static void snap_consider(int64_t candidate, int64_t frame, int64_t* best) {
+    if (*best < 0 || llabs(candidate - frame) < llabs(*best - frame)) *best = candidate;
+}
 
-    // Initialize SDL audio
-    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
-        LOG_error("Failed to init SDL audio: %s\n", SDL_GetError());
+// Decoders
+// Each format's decoder is a table of operations in decoder_registry. Reads hand
+// out interleaved stereo (a mono source is read into the back half of the output
+// and expanded in place) and leave current_frame to the stream_decoder_* wrappers.
+// What a decoder can do beyond int16 reads and exact seeks is declared in its
+// capabilities, which the pipeline goes by; their operations are NULL without them.
+#define DECODER_CAP_FAST_SEEK       0x01    // Seeks land at once: no approximate seeks while scrubbing
+#define DECODER_CAP_SEEK_INDEX      0x02    // snap: index entries a seek lands on without decoding forward
+#define DECODER_CAP_NATIVE_FLOAT    0x04    // read_f32 (else int16 widened to float)
+#define DECODER_CAP_HIRES           0x08    // read_s32: integer PCM deeper than 16 bits (bit-perfect pipeline)
+#define DECODER_CAP_FRAME_PARALLEL  0x10    // Frames decode on helper threads (parallel FLAC)
+
+struct StreamDecoderOps {
+    AudioFormat format;
+    const char* name;
+    unsigned caps;
+    int (*open)(StreamDecoder* sd, const char* filepath);   // 0, or -1 with nothing left open
+    size_t (*read_s16)(StreamDecoder* sd, int16_t* buffer, size_t frames);
+    size_t (*read_s32)(StreamDecoder* sd, int32_t* buffer, size_t frames);
+    size_t (*read_f32)(StreamDecoder* sd, float* buffer, size_t frames);
+    bool (*seek)(StreamDecoder* sd, int64_t frame);
+    int64_t (*snap)(StreamDecoder* sd, int64_t frame);      // Nearest entry, -1 = none
+    bool (*hint)(StreamDecoder* sd, int64_t frame, SeekHint* hint);        // Entry at or before frame
+    bool (*seek_hint)(StreamDecoder* sd, const SeekHint* hint, int64_t frame);  // Seek through it
+    void (*close)(StreamDecoder* sd);
+};
+
+_Static_assert(sizeof(drmp3_seek_point) <= PLAYER_SEEK_HINT_BYTES, "SeekHint too small for an MP3 seek point");
+_Static_assert(sizeof(drflac_seekpoint) <= PLAYER_SEEK_HINT_BYTES, "SeekHint too small for a FLAC seek point");
+
+// MP3 (drmp3), from a growing file while it downloads
+
+static int mp3_decoder_open(StreamDecoder* sd, const char* filepath) {
+    drmp3* mp3 = decoder_pool_alloc(sizeof(drmp3));
+    GrowingReader* growing_reader = growing_reader_open(filepath);
+    ReadAhead* input = mp3 && !growing_reader ? ReadAhead_open(filepath) : NULL;
+    bool opened = mp3 && (growing_reader
+        ? drmp3_init(mp3, growing_read, growing_seek, NULL, NULL, growing_reader, &mp3_pool_callbacks)
+        : input && drmp3_init(mp3, file_input_read, file_input_seek_mp3, file_input_tell_mp3, NULL, input,
+                              &mp3_pool_callbacks));
+    if (!opened) {
+        decoder_pool_free(mp3);
+        growing_reader_close(growing_reader);
+        ReadAhead_close(input);
+        LOG_error("Stream: Failed to open MP3: %s\n", filepath);
         return -1;
     }
+    sd->decoder = mp3;
+    sd->source = growing_reader;
+    sd->input = input;
+    sd->source_sample_rate = mp3->sampleRate;
+    sd->source_channels = mp3->channels;
+    if (growing_reader) {
+        // Neither scanned nor indexed while it's incomplete
+        sd->total_frames = (int64_t)growing_reader->duration_ms * mp3->sampleRate / 1000;
+    } else if (mp3_seek_index_load(sd, filepath) != 0) {
+        // Cached seek index also carries the frame count, skipping the file scan
+        sd->total_frames = drmp3_get_pcm_frame_count(mp3);
+        mp3_seek_index_build(sd, filepath);
+    }
+    return 0;
+}
 
-    // Check current audio sink setting
-    int audio_sink = GetAudioSink();
+static size_t mp3_decoder_read_s16(StreamDecoder* sd, int16_t* buffer, size_t frames) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    if (sd->source_channels != 1) return drmp3_read_pcm_frames_s16(mp3, frames, buffer);
+    int16_t* mono = &buffer[frames];
+    size_t n = drmp3_read_pcm_frames_s16(mp3, frames, mono);
+    Pcm_upmixS16(mono, buffer, n);
+    return n;
+}
 
-    // Also check if .asoundrc exists with bluealsa config (more reliable than msettings)
-    const char* home = getenv("HOME");
+static size_t mp3_decoder_read_f32(StreamDecoder* sd, float* buffer, size_t frames) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    if (sd->source_channels != 1) return drmp3_read_pcm_frames_f32(mp3, frames, buffer);
+    float* mono = &buffer[frames];
+    size_t n = drmp3_read_pcm_frames_f32(mp3, frames, mono);
+    Pcm_upmixF32(mono, buffer, n);
+    return n;
+}
 
-    if (home) {
-        char asoundrc_path[512];
-        snprintf(asoundrc_path, sizeof(asoundrc_path), "%s/.asoundrc", home);
-        FILE* f = fopen(asoundrc_path, "r");
-        if (f) {
-            char buf[256];
-            while (fgets(buf, sizeof(buf), f)) {
-                if (strstr(buf, "bluealsa")) {
-                    audio_sink = AUDIO_SINK_BLUETOOTH;
-                    bluetooth_audio_active = true;
-                    break;
-                }
-            }
-            fclose(f);
-        }
-    }
+static bool mp3_decoder_seek(StreamDecoder* sd, int64_t frame) {
+    return drmp3_seek_to_pcm_frame((drmp3*)sd->decoder, frame);
+}
 
-    // If Bluetooth audio is detected, set BlueALSA mixer to 100% for software volume control
-    if (audio_sink == AUDIO_SINK_BLUETOOTH) {
-        // Set all mixer controls that contain "A2DP" in their name to 100%
-        // This handles devices like "Galaxy Buds Live (4B23 A2DP" etc.
-        system("amixer scontrols 2>/dev/null | grep -i 'A2DP' | "
-               "sed \"s/.*'\\([^']*\\)'.*/\\1/\" | "
-               "while read ctrl; do amixer sset \"$ctrl\" 127 2>/dev/null; done");
+// Entries ascend, so the scan stops at the first one past the frame
+static int64_t mp3_decoder_snap(StreamDecoder* sd, int64_t frame) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    int64_t best = -1;
+    for (uint32_t i = 0; i < mp3->seekPointCount; i++) {
+        int64_t entry = (int64_t)mp3->pSeekPoints[i].pcmFrameIndex;
+        snap_consider(entry, frame, &best);
+        if (entry > frame) break;
     }
+    return best;
+}
 
-    // Determine target sample rate based on audio output
-    int target_rate = get_target_sample_rate();
+static bool mp3_decoder_hint(StreamDecoder* sd, int64_t frame, SeekHint* hint) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    const drmp3_seek_point* best = NULL;
+    for (uint32_t i = 0; i < mp3->seekPointCount; i++) {
+        if ((int64_t)mp3->pSeekPoints[i].pcmFrameIndex > frame) break;
+        best = &mp3->pSeekPoints[i];
+    }
+    if (!best) return false;
+    hint->frame = (int64_t)best->pcmFrameIndex;
+    memcpy(hint->entry, best, sizeof(*best));
+    return true;
+}
 
-    SDL_AudioSpec want, have;
-    SDL_zero(want);
-    want.freq = target_rate;
-    want.format = AUDIO_S16SYS;
-    want.channels = AUDIO_CHANNELS;
-    want.samples = AUDIO_SAMPLES;
-    want.callback = audio_callback;
-    want.userdata = &player;
+// A file whose index is bound seeks through it anyway; otherwise the hint
+// is bound as a one-point table for this seek only
+static bool mp3_decoder_seek_hint(StreamDecoder* sd, const SeekHint* hint, int64_t frame) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    if (mp3->seekPointCount > 0) return drmp3_seek_to_pcm_frame(mp3, frame);
+    drmp3_seek_point point;
+    memcpy(&point, hint->entry, sizeof(point));
+    drmp3_bind_seek_table(mp3, 1, &point);
+    bool ok = drmp3_seek_to_pcm_frame(mp3, frame);
+    drmp3_bind_seek_table(mp3, 0, NULL);
+    return ok;
+}
 
-    // Open default audio device - respects .asoundrc for Bluetooth/USB DAC routing
-    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+static void mp3_decoder_close(StreamDecoder* sd) {
+    drmp3_uninit((drmp3*)sd->decoder);
+    decoder_pool_free(sd->decoder);
+    growing_reader_close((GrowingReader*)sd->source);
+    sd->source = NULL;
+    ReadAhead_close((ReadAhead*)sd->input);
+    sd->input = NULL;
+}
 
-    if (player.audio_device == 0) {
-        LOG_error("Failed to open audio device: %s\n", SDL_GetError());
+// WAV (drwav)
 
-        // If Bluetooth was detected but device isn't available, fall back to speaker
-        if (bluetooth_audio_active) {
+static int wav_decoder_open(StreamDecoder* sd, const char* filepath) {
+    drwav* wav = decoder_pool_alloc(sizeof(drwav));
+    ReadAhead* input = wav ? ReadAhead_open(filepath) : NULL;
+    if (!input || !drwav_init(wav, file_input_read, file_input_seek_wav, file_input_tell_wav, input,
+                              &wav_pool_callbacks)) {
+        decoder_pool_free(wav);
+        ReadAhead_close(input);
+        LOG_error("Stream: Failed to open WAV: %s\n", filepath);
+        return -1;
+    }
+    sd->decoder = wav;
+    sd->input = input;
+    sd->source_sample_rate = wav->sampleRate;
+    sd->source_channels = wav->channels;
+    sd->total_frames = wav->totalPCMFrameCount;
+    // Float/compressed WAVs can't be passed through losslessly as integers
+    sd->bits_per_sample = (wav->translatedFormatTag == DR_WAVE_FORMAT_PCM) ? wav->bitsPerSample : 0;
+    return 0;
+}
+
+static size_t wav_decoder_read_s16(StreamDecoder* sd, int16_t* buffer, size_t frames) {
+    drwav* wav = (drwav*)sd->decoder;
+    if (sd->source_channels != 1) return drwav_read_pcm_frames_s16(wav, frames, buffer);
+    int16_t* mono = &buffer[frames];
+    size_t n = drwav_read_pcm_frames_s16(wav, frames, mono);
+    Pcm_upmixS16(mono, buffer, n);
+    return n;
+}
+
+static size_t wav_decoder_read_s32(StreamDecoder* sd, int32_t* buffer, size_t frames) {
+    drwav* wav = (drwav*)sd->decoder;
+    if (sd->source_channels != 1) return drwav_read_pcm_frames_s32(wav, frames, buffer);
+    int32_t* mono = &buffer[frames];
+    size_t n = drwav_read_pcm_frames_s32(wav, frames, mono);
+    Pcm_upmixS32(mono, buffer, n);
+    return n;
+}
+
+static size_t wav_decoder_read_f32(StreamDecoder* sd, float* buffer, size_t frames) {
+    drwav* wav = (drwav*)sd->decoder;
+    if (sd->source_channels != 1) return drwav_read_pcm_frames_f32(wav, frames, buffer);
+    float* mono = &buffer[frames];
+    size_t n = drwav_read_pcm_frames_f32(wav, frames, mono);
+    Pcm_upmixF32(mono, buffer, n);
+    return n;
+}
+
+static bool wav_decoder_seek(StreamDecoder* sd, int64_t frame) {
+    return drwav_seek_to_pcm_frame((drwav*)sd->decoder, frame);
+}
+
+static void wav_decoder_close(StreamDecoder* sd) {
+    drwav_uninit((drwav*)sd->decoder);
+    decoder_pool_free(sd->decoder);
+    ReadAhead_close((ReadAhead*)sd->input);
+    sd->input = NULL;
+}
+
+// FLAC (drflac), hi-res streams also on the parallel decoder
+
+static int flac_decoder_open(StreamDecoder* sd, const char* filepath) {
+    ReadAhead* input = ReadAhead_open(filepath);
+    drflac* flac = input ? drflac_open(file_input_read, file_input_seek_flac, file_input_tell_flac, input,
+                                       &flac_pool_callbacks) : NULL;
+    if (!flac) {
+        ReadAhead_close(input);
+        LOG_error("Stream: Failed to open FLAC: %s\n", filepath);
+        return -1;
+    }
+    sd->decoder = flac;
+    sd->input = input;
+    sd->source_sample_rate = flac->sampleRate;
+    sd->source_channels = flac->channels;
+    sd->total_frames = flac->totalPCMFrameCount;
+    sd->bits_per_sample = flac->bitsPerSample;
+    flac_seek_index_attach(sd, filepath);
+    return 0;
+}
+
+static size_t flac_decoder_read_s16(StreamDecoder* sd, int16_t* buffer, size_t frames) {
+    drflac* flac = (drflac*)sd->decoder;
+    if (sd->source_channels != 1) return drflac_read_pcm_frames_s16(flac, frames, buffer);
+    int16_t* mono = &buffer[frames];
+    size_t n = drflac_read_pcm_frames_s16(flac, frames, mono);
+    Pcm_upmixS16(mono, buffer, n);
+    return n;
+}
+
+static size_t flac_decoder_read_s32(StreamDecoder* sd, int32_t* buffer, size_t frames) {
+    drflac* flac = (drflac*)sd->decoder;
+    if (sd->source_channels != 1) return drflac_read_pcm_frames_s32(flac, frames, buffer);
+    int32_t* mono = &buffer[frames];
+    size_t n = drflac_read_pcm_frames_s32(flac, frames, mono);
+    Pcm_upmixS32(mono, buffer, n);
+    return n;
+}
+
+static size_t flac_decoder_read_f32(StreamDecoder* sd, float* buffer, size_t frames) {
+    drflac* flac = (drflac*)sd->decoder;
+    if (sd->source_channels != 1) return drflac_read_pcm_frames_f32(flac, frames, buffer);
+    float* mono = &buffer[frames];
+    size_t n = drflac_read_pcm_frames_f32(flac, frames, mono);
+    Pcm_upmixF32(mono, buffer, n);
+    return n;
+}
+
+static bool flac_decoder_seek(StreamDecoder* sd, int64_t frame) {
+    flac_parallel_stop((FlacParallel*)sd->parallel);  // Started again at the new frame
+    flac_seek_index_bind(sd);
+    return drflac_seek_to_pcm_frame((drflac*)sd->decoder, frame);
+}
+
+static int64_t flac_decoder_snap(StreamDecoder* sd, int64_t frame) {
+    flac_seek_index_bind(sd);
+    drflac* flac = (drflac*)sd->decoder;
+    int64_t best = -1;
+    for (uint32_t i = 0; i < flac->seekpointCount; i++) {
+        if (flac->pSeekpoints[i].firstPCMFrame == (drflac_uint64)-1) break;   // Placeholders
+        int64_t entry = (int64_t)flac->pSeekpoints[i].firstPCMFrame;
+        snap_consider(entry, frame, &best);
+        if (entry > frame) break;
+    }
+    return best;
+}
+
+static bool flac_decoder_hint(StreamDecoder* sd, int64_t frame, SeekHint* hint) {
+    flac_seek_index_bind(sd);
+    drflac* flac = (drflac*)sd->decoder;
+    const drflac_seekpoint* best = NULL;
+    for (uint32_t i = 0; i < flac->seekpointCount; i++) {
+        if (flac->pSeekpoints[i].firstPCMFrame == (drflac_uint64)-1) break;   // Placeholders
+        if ((int64_t)flac->pSeekpoints[i].firstPCMFrame > frame) break;
+        best = &flac->pSeekpoints[i];
+    }
+    if (!best) return false;
+    hint->frame = (int64_t)best->firstPCMFrame;
+    memcpy(hint->entry, best, sizeof(*best));
+    return true;
+}
+
+// Without a table of its own (the background index not built yet) the hint
+// stands in as a one-point table for this seek only
+static bool flac_decoder_seek_hint(StreamDecoder* sd, const SeekHint* hint, int64_t frame) {
+    flac_parallel_stop((FlacParallel*)sd->parallel);  // Started again at the new frame
+    flac_seek_index_bind(sd);
+    drflac* flac = (drflac*)sd->decoder;
+    if (flac->seekpointCount > 0) return drflac_seek_to_pcm_frame(flac, frame);
+    drflac_seekpoint point;
+    memcpy(&point, hint->entry, sizeof(point));
+    flac->pSeekpoints = &point;
+    flac->seekpointCount = 1;
+    bool ok = drflac_seek_to_pcm_frame(flac, frame);
+    flac->pSeekpoints = NULL;
+    flac->seekpointCount = 0;
+    return ok;
+}
+
+static void flac_decoder_close(StreamDecoder* sd) {
+    flac_parallel_free((FlacParallel*)sd->parallel);
+    sd->parallel = NULL;
+    drflac_close((drflac*)sd->decoder);
+    ReadAhead_close((ReadAhead*)sd->input);
+    sd->input = NULL;
+    flac_seek_index_release((FlacSeekIndex*)sd->seek_table);
+    sd->seek_table = NULL;
+}
+
+// Ogg Vorbis (stb_vorbis), which interleaves and upmixes itself
+
+static int ogg_decoder_open(StreamDecoder* sd, const char* filepath) {
+    int error;
+    stb_vorbis* vorbis = vorbis_open_pooled(filepath, &sd->decoder_memory, &error);
+    if (!vorbis) {
+        LOG_error("Stream: Failed to open OGG: %s (error %d)\n", filepath, error);
+        return -1;
+    }
+    sd->decoder = vorbis;
+    stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+    sd->source_sample_rate = info.sample_rate;
+    sd->source_channels = info.channels;
+    sd->total_frames = stb_vorbis_stream_length_in_samples(vorbis);
+    // Needs the last page, which the length lookup above finds
+    ogg_seek_index_attach(sd, filepath);
+    return 0;
+}
+
+static size_t ogg_decoder_read_s16(StreamDecoder* sd, int16_t* buffer, size_t frames) {
+    return stb_vorbis_get_samples_short_interleaved((stb_vorbis*)sd->decoder, AUDIO_CHANNELS,
+                                                    buffer, frames * AUDIO_CHANNELS);
+}
+
+static size_t ogg_decoder_read_f32(StreamDecoder* sd, float* buffer, size_t frames) {
+    return stb_vorbis_get_samples_float_interleaved((stb_vorbis*)sd->decoder, AUDIO_CHANNELS,
+                                                    buffer, frames * AUDIO_CHANNELS);
+}
+
+static bool ogg_decoder_seek(StreamDecoder* sd, int64_t frame) {
+    return ogg_seek_indexed(sd, (unsigned int)frame) ||
+           stb_vorbis_seek((stb_vorbis*)sd->decoder, (unsigned int)frame) != 0;
+}
+
+static int64_t ogg_decoder_snap(StreamDecoder* sd, int64_t frame) {
+    OggSeekIndex* index = (OggSeekIndex*)sd->seek_table;
+    int64_t best = -1;
+    if (!index || !__atomic_load_n(&index->ready, __ATOMIC_ACQUIRE)) return best;
+    for (uint32_t i = 0; i < index->count; i++) {
+        int64_t entry = (int64_t)index->pages[i].last_decoded_sample;
+        snap_consider(entry, frame, &best);
+        if (entry > frame) break;
+    }
+    return best;
+}
+
+static void ogg_decoder_close(StreamDecoder* sd) {
+    stb_vorbis_close((stb_vorbis*)sd->decoder);
+    decoder_pool_free(sd->decoder_memory);
+    ogg_seek_index_release((OggSeekIndex*)sd->seek_table);
+    sd->seek_table = NULL;
+}
+
+// M4A: AAC (Helix, fixed point) out of the MP4 container (minimp4), seeking by its sample tables
+
+static int m4a_decoder_open(StreamDecoder* sd, const char* filepath) {
+    M4ADecoder* m4a = decoder_pool_alloc(sizeof(M4ADecoder));
+    if (!m4a) {
+        LOG_error("Stream: Failed to allocate M4A decoder\n");
+        return -1;
+    }
+    memset(m4a, 0, sizeof(M4ADecoder));
+
+    m4a->input = ReadAhead_open(filepath);
+    if (!m4a->input) {
+        decoder_pool_free(m4a);
+        LOG_error("Stream: Failed to open M4A file: %s\n", filepath);
+        return -1;
+    }
+    int64_t file_size = ReadAhead_size(m4a->input);
+
+    m4a->window_size = M4A_READAHEAD_SIZE;
+    m4a->window = decoder_pool_alloc(m4a->window_size);
+    if (!m4a->window) {
+        ReadAhead_close(m4a->input);
+        decoder_pool_free(m4a);
+        LOG_error("Stream: Failed to allocate M4A read buffer\n");
+        return -1;
+    }
+
+    // Open MP4 demuxer
+    int track_count = MP4D_open(&m4a->mp4, m4a_read_callback, m4a, file_size);
+    if (track_count == 0) {
+        ReadAhead_close(m4a->input);
+        decoder_pool_free(m4a->window);
+        decoder_pool_free(m4a);
+        LOG_error("Stream: Failed to parse M4A container: %s\n", filepath);
+        return -1;
+    }
+
+    // Find audio track
+    m4a->audio_track = -1;
+    for (unsigned i = 0; i < m4a->mp4.track_count; i++) {
+        if (m4a->mp4.track[i].handler_type == MP4D_HANDLER_TYPE_SOUN) {
+            m4a->audio_track = i;
+            break;
+        }
+    }
+
+    if (m4a->audio_track < 0) {
+        MP4D_close(&m4a->mp4);
+        ReadAhead_close(m4a->input);
+        decoder_pool_free(m4a->window);
+        decoder_pool_free(m4a);
+        LOG_error("Stream: No audio track found in M4A: %s\n", filepath);
+        return -1;
+    }
+
+    MP4D_track_t* track = &m4a->mp4.track[m4a->audio_track];
+    m4a->sample_count = track->sample_count;
+    m4a->sample_rate = track->SampleDescription.audio.samplerate_hz;
+    m4a->channels = track->SampleDescription.audio.channelcount;
+    m4a->current_sample = 0;
+
+    // Index the sample tables for sequential reads and seeking
+    if (m4a_build_index(m4a) != 0) {
+        free(m4a->chunk_first_sample);
+        free(m4a->time_runs);
+        MP4D_close(&m4a->mp4);
+        ReadAhead_close(m4a->input);
+        decoder_pool_free(m4a->window);
+        decoder_pool_free(m4a);
+        LOG_error("Stream: Failed to index M4A samples: %s\n", filepath);
+        return -1;
+    }
+
+    // Drop the encoder priming the edit list hides (ignore implausible edits)
+    m4a->edit_media_time = m4a_edit_media_time(m4a, file_size);
+    if ((uint64_t)m4a->edit_media_time >= m4a->total_time) {
+        m4a->edit_media_time = 0;
+    }
+    m4a->skip_time = (uint64_t)m4a->edit_media_time;
+
+    // Initialize AAC decoder
+    m4a->aac_decoder = aac_decoder_open_pooled(&m4a->aac_memory);
+    if (!m4a->aac_decoder) {
+        free(m4a->chunk_first_sample);
+        free(m4a->time_runs);
+        MP4D_close(&m4a->mp4);
+        ReadAhead_close(m4a->input);
+        decoder_pool_free(m4a->window);
+        decoder_pool_free(m4a);
+        LOG_error("Stream: Failed to init AAC decoder for M4A: %s\n", filepath);
+        return -1;
+    }
+
+    // Set up AAC decoder with DSI (Decoder Specific Info)
+    if (track->dsi && track->dsi_bytes > 0) {
+        AACFrameInfo frame_info;
+        memset(&frame_info, 0, sizeof(frame_info));
+        frame_info.nChans = m4a->channels;
+        frame_info.sampRateCore = m4a->sample_rate;
+        AACSetRawBlockParams(m4a->aac_decoder, 0, &frame_info);
+    }
+
+    // Calculate total PCM frames from track duration
+    // duration is in timescale units, need to convert to sample count
+    uint64_t duration = ((uint64_t)track->duration_hi << 32) | track->duration_lo;
+    if (duration > (uint64_t)m4a->edit_media_time) {
+        duration -= (uint64_t)m4a->edit_media_time;
+    }
+    if (track->timescale > 0 && m4a->sample_rate > 0) {
+        sd->total_frames = (duration * m4a->sample_rate) / track->timescale;
+    } else {
+        // Fallback: estimate from sample count (1024 samples per AAC frame)
+        sd->total_frames = (int64_t)m4a->sample_count * 1024;
+    }
+
+    sd->decoder = m4a;
+    sd->source_sample_rate = m4a->sample_rate;
+    sd->source_channels = m4a->channels;
+    return 0;
+}
+
+static size_t m4a_decoder_read_s16(StreamDecoder* sd, int16_t* buffer, size_t frames) {
+    M4ADecoder* m4a = (M4ADecoder*)sd->decoder;
+
+    // Decode AAC frames until we have enough PCM samples
+    size_t buffer_pos = 0;  // Current position in output buffer (in frames)
+
+    while (buffer_pos < frames && m4a->current_sample < m4a->sample_count) {
+        // Get frame offset and size
+        unsigned frame_bytes = 0;
+        unsigned duration = m4a_sample_duration(m4a, m4a->current_sample);
+        int64_t offset = m4a_sample_locate(m4a, m4a->current_sample, &frame_bytes);
+
+        if (offset == 0 || frame_bytes == 0) {
+            m4a->skip_time -= (m4a->skip_time < duration) ? m4a->skip_time : duration;
+            m4a->current_sample++;
+            continue;
+        }
+
+        // Frame data comes straight from the read-ahead window
+        const uint8_t* frame_data = m4a_window_get(m4a, offset, frame_bytes);
+        if (!frame_data) {
+            break;
+        }
+
+        // Part of this access unit still to drop (priming or seek pre-roll)
+        uint64_t drop_time = (m4a->skip_time < duration) ? m4a->skip_time : duration;
+        m4a->skip_time -= drop_time;
+
+        // Decode AAC frame
+        int16_t decode_buf[AAC_MAX_NSAMPS * AAC_MAX_NCHANS * 2];
+        unsigned char* inptr = (unsigned char*)frame_data;
+        int bytes_left = frame_bytes;
+
+        int err = AACDecode(m4a->aac_decoder, &inptr, &bytes_left, decode_buf);
+
+        if (err == ERR_AAC_NONE) {
+            AACFrameInfo frame_info;
+            AACGetLastFrameInfo(m4a->aac_decoder, &frame_info);
+
+            if (frame_info.outputSamps > 0) {
+                // Calculate how many frames we got
+                int decoded_frames = frame_info.outputSamps / frame_info.nChans;
+
+                // Dropped media scales to output frames (HE-AAC yields twice the core duration)
+                int skip_frames = 0;
+                if (drop_time > 0) {
+                    skip_frames = (drop_time >= duration) ? decoded_frames
+                                : (int)(drop_time * (uint64_t)decoded_frames / duration);
+                }
+                const int16_t* pcm = decode_buf + skip_frames * frame_info.nChans;
+                int frames_to_copy = decoded_frames - skip_frames;
+
+                // Don't overflow output buffer
+                if (buffer_pos + frames_to_copy > frames) {
+                    frames_to_copy = frames - buffer_pos;
+                }
+
+                // Copy to output buffer, handling mono to stereo conversion
+                if (frame_info.nChans == 1) {
+                    Pcm_upmixS16(pcm, &buffer[buffer_pos * 2], frames_to_copy);
+                } else {
+                    memcpy(&buffer[buffer_pos * 2], pcm,
+                           frames_to_copy * sizeof(int16_t) * 2);
+                }
+
+                buffer_pos += frames_to_copy;
+            }
+        }
+
+        m4a->current_sample++;
+    }
+
+    return buffer_pos;
+}
+
+static bool m4a_decoder_seek(StreamDecoder* sd, int64_t frame) {
+    M4ADecoder* m4a = (M4ADecoder*)sd->decoder;
+    // PCM frame to media time, offset by the edit list like playback from the start
+    const MP4D_track_t* track = &m4a->mp4.track[m4a->audio_track];
+    uint64_t target = (uint64_t)frame;
+    if (track->timescale > 0 && sd->source_sample_rate > 0) {
+        target = (uint64_t)frame * track->timescale / (uint64_t)sd->source_sample_rate;
+    }
+    m4a_seek_time(m4a, target + (uint64_t)m4a->edit_media_time);
+    // Flush AAC decoder state for clean seek
+    AACFlushCodec(m4a->aac_decoder);
+    return true;
+}
+
+static void m4a_decoder_close(StreamDecoder* sd) {
+    M4ADecoder* m4a = (M4ADecoder*)sd->decoder;
+    if (m4a->aac_memory) {
+        decoder_pool_free(m4a->aac_memory);
+    } else if (m4a->aac_decoder) {
+        AACFreeDecoder(m4a->aac_decoder);
+    }
+    decoder_pool_free(m4a->window);
+    free(m4a->chunk_first_sample);
+    free(m4a->time_runs);
+    MP4D_close(&m4a->mp4);
+    ReadAhead_close(m4a->input);
+    decoder_pool_free(m4a);
+}
+
+static const struct StreamDecoderOps decoder_registry[] = {
+    {AUDIO_FORMAT_MP3, "mp3", DECODER_CAP_SEEK_INDEX | DECODER_CAP_NATIVE_FLOAT,
+     mp3_decoder_open, mp3_decoder_read_s16, NULL, mp3_decoder_read_f32,
+     mp3_decoder_seek, mp3_decoder_snap, mp3_decoder_hint, mp3_decoder_seek_hint, mp3_decoder_close},
+    {AUDIO_FORMAT_WAV, "wav", DECODER_CAP_FAST_SEEK | DECODER_CAP_NATIVE_FLOAT | DECODER_CAP_HIRES,
+     wav_decoder_open, wav_decoder_read_s16, wav_decoder_read_s32, wav_decoder_read_f32,
+     wav_decoder_seek, NULL, NULL, NULL, wav_decoder_close},
+    {AUDIO_FORMAT_FLAC, "flac",
+     DECODER_CAP_SEEK_INDEX | DECODER_CAP_NATIVE_FLOAT | DECODER_CAP_HIRES | DECODER_CAP_FRAME_PARALLEL,
+     flac_decoder_open, flac_decoder_read_s16, flac_decoder_read_s32, flac_decoder_read_f32,
+     flac_decoder_seek, flac_decoder_snap, flac_decoder_hint, flac_decoder_seek_hint, flac_decoder_close},
+    {AUDIO_FORMAT_OGG, "ogg", DECODER_CAP_SEEK_INDEX | DECODER_CAP_NATIVE_FLOAT,
+     ogg_decoder_open, ogg_decoder_read_s16, NULL, ogg_decoder_read_f32,
+     ogg_decoder_seek, ogg_decoder_snap, NULL, NULL, ogg_decoder_close},
+    {AUDIO_FORMAT_M4A, "m4a", DECODER_CAP_FAST_SEEK,
+     m4a_decoder_open, m4a_decoder_read_s16, NULL, NULL,
+     m4a_decoder_seek, NULL, NULL, NULL, m4a_decoder_close},
+};
+
+static const struct StreamDecoderOps* decoder_for(AudioFormat format) {
+    for (size_t i = 0; i < sizeof(decoder_registry) / sizeof(decoder_registry[0]); i++) {
+        if (decoder_registry[i].format == format) return &decoder_registry[i];
+    }
+    return NULL;
+}
+
+static unsigned stream_decoder_caps(const StreamDecoder* sd) {
+    return sd->ops ? sd->ops->caps : 0;
+}
+
+// Open decoder and read metadata (doesn't decode audio yet)
+static int stream_decoder_open(StreamDecoder* sd, const char* filepath) {
+    TRACE_SCOPE("decoder_open");
+    memset(sd, 0, sizeof(StreamDecoder));
+
+    // By content, so a file named for another format still opens
+    AudioFormat format = Player_probeFormat(filepath);
+    const struct StreamDecoderOps* ops = decoder_for(format);
+    if (!ops) {
+        LOG_error("Stream: Unknown audio format: %s\n", filepath);
+        return -1;
+    }
+    sd->format = format;
+    sd->ops = ops;
+    if (ops->open(sd, filepath) != 0) return -1;
+    if (ops->caps & DECODER_CAP_FRAME_PARALLEL) flac_parallel_attach(sd);
+
+    sd->current_frame = 0;
+    return 0;
+}
+
+// Read chunk of audio from decoder (returns frames read, outputs stereo)
+static size_t stream_decoder_read(StreamDecoder* sd, int16_t* buffer, size_t frames) {
+    if (!sd->decoder) return 0;
+    size_t frames_read = sd->ops->read_s16(sd, buffer, frames);
+    sd->current_frame += frames_read;
+    return frames_read;
+}
+
+// Whether a decoder can feed the bit-perfect pipeline (integer PCM deeper than 16 bits)
+static bool stream_decoder_is_hires(const StreamDecoder* sd) {
+    return (stream_decoder_caps(sd) & DECODER_CAP_HIRES) &&
+           sd->bits_per_sample > 16 && sd->source_channels >= 1 && sd->source_channels <= 2;
+}
+
+// Read chunk as left-justified 32-bit stereo (bit-perfect pipeline, hi-res decoders only)
+static size_t stream_decoder_read_s32(StreamDecoder* sd, int32_t* buffer, size_t frames) {
+    if (!sd->decoder || !(sd->ops->caps & DECODER_CAP_HIRES)) return 0;
+    size_t frames_read = sd->ops->read_s32(sd, buffer, frames);
+    sd->current_frame += frames_read;
+    return frames_read;
+}
+
+// Read chunk of audio as float stereo in [-1, 1) (float pipeline)
+static size_t stream_decoder_read_f32(StreamDecoder* sd, float* buffer, size_t frames) {
+    if (!sd->decoder) return 0;
+    if (!(sd->ops->caps & DECODER_CAP_NATIVE_FLOAT)) {
+        // Decode int16 into the back half of the buffer and widen in place (stores
+        // stay behind the unread input)
+        int16_t* pcm = (int16_t*)&buffer[frames];
+        size_t frames_read = stream_decoder_read(sd, pcm, frames);
+        Pcm_s16ToF32(pcm, buffer, frames_read * AUDIO_CHANNELS);
+        return frames_read;
+    }
+    size_t frames_read = sd->ops->read_f32(sd, buffer, frames);
+    sd->current_frame += frames_read;
+    return frames_read;
+}
+
+// Seek to frame position
+static int stream_decoder_seek(StreamDecoder* sd, int64_t frame) {
+    if (!sd->decoder) return -1;
+    stream_decoder_drop_preroll(sd);  // The decoder itself is past it
+
+    if (frame < 0) frame = 0;
+    if (frame > sd->total_frames) frame = sd->total_frames;
+
+    if (!sd->ops->seek(sd, frame)) return -1;
+    sd->current_frame = frame;
+    return 0;
+}
+
+// Seek index entry nearest to frame: a seek lands there without decoding forward
+// Formats and tracks without an index return frame itself.
+static int64_t stream_decoder_snap(StreamDecoder* sd, int64_t frame) {
+    if (!sd->decoder || !(sd->ops->caps & DECODER_CAP_SEEK_INDEX)) return frame;
+    int64_t best = sd->ops->snap(sd, frame);
+    return best >= 0 ? best : frame;
+}
+
+// Seek index entry at or before frame, for a later open to seek through
+// False (hint->frame = -1) for formats and tracks without one.
+static bool stream_decoder_hint(StreamDecoder* sd, int64_t frame, SeekHint* hint) {
+    memset(hint, 0, sizeof(SeekHint));
+    hint->frame = -1;
+    if (!sd->decoder || !sd->ops->hint || !sd->ops->hint(sd, frame, hint)) {
+        hint->frame = -1;
+        return false;
+    }
+    hint->format = (uint8_t)sd->format;
+    return true;
+}
+
+// Seek to frame through a saved hint; one that doesn't fit (another format,
+// past frame) falls back to a plain seek
+static int stream_decoder_seek_hint(StreamDecoder* sd, const SeekHint* hint, int64_t frame) {
+    if (!sd->decoder) return -1;
+    if (!hint || hint->frame < 0 || hint->frame > frame || hint->format != (uint8_t)sd->format ||
+        !sd->ops->seek_hint || frame > sd->total_frames) {
+        return stream_decoder_seek(sd, frame);
+    }
+    stream_decoder_drop_preroll(sd);
+    if (!sd->ops->seek_hint(sd, hint, frame)) return stream_decoder_seek(sd, frame);
+    sd->current_frame = frame;
+    return 0;
+}
+
+// Close decoder
+static void stream_decoder_close(StreamDecoder* sd) {
+    stream_decoder_drop_preroll(sd);
+    if (!sd->decoder) return;
+
+    sd->ops->close(sd);
+
+    free(sd->seek_table);
+    sd->seek_table = NULL;
+    sd->decoder = NULL;
+    sd->decoder_memory = NULL;
+    sd->format = AUDIO_FORMAT_UNKNOWN;
+    sd->ops = NULL;
+}
+
+// ============ STREAMING RESAMPLER ============
+
+// Resample a chunk (decode thread), int16 or float as the stream is decoded,
+// retuning the resampler to the wanted tier first
+// Returns number of output frames
+static size_t resample_chunk_pcm(void* input, size_t input_frames,
+                                 int src_rate, int dst_rate,
+                                 void* output, size_t max_output_frames,
+                                 Resampler* resampler, bool is_last) {
+    if (src_rate == dst_rate || !resampler) {
+        // No resampling needed, just copy
+        size_t to_copy = (input_frames < max_output_frames) ? input_frames : max_output_frames;
+        memcpy(output, input, to_copy * pcm_frame_bytes(player.stream_format));
+        return to_copy;
+    }
+
+    Resampler_setQuality(resampler, resampler_quality());
+    if (player.stream_format == PCM_FORMAT_F32) {
+        return Resampler_processF32(resampler, (const float*)input, input_frames, src_rate, dst_rate,
+                                    (float*)output, max_output_frames, is_last);
+    }
+    return Resampler_processS16(resampler, (const int16_t*)input, input_frames, src_rate, dst_rate,
+                                (int16_t*)output, max_output_frames, is_last);
+}
+
+// Decode a chunk in the given sample format
+static size_t stream_decoder_read_format(StreamDecoder* sd, PcmFormat format, void* buffer, size_t frames) {
+    size_t frames_read;
+    switch (format) {
+        case PCM_FORMAT_S32:
+            frames_read = stream_decoder_read_s32(sd, (int32_t*)buffer, frames);
+            break;
+        case PCM_FORMAT_F32:
+            frames_read = stream_decoder_read_f32(sd, (float*)buffer, frames);
+            break;
+        default:
+            frames_read = stream_decoder_read(sd, (int16_t*)buffer, frames);
+            break;
+    }
+    if (sd->source) growing_track_length(sd, frames_read);
+    return frames_read;
+}
+
+// Hand out PCM the prefetcher decoded ahead. If the output settings changed since,
+// it's in the wrong format: drop it and rewind the decoder to where it started.
+static size_t stream_decoder_read_preroll(StreamDecoder* sd, void* buffer, size_t frames) {
+    if (sd->preroll_format != player.stream_format) {
+        stream_decoder_seek(sd, sd->current_frame);  // Also drops the preroll
+        return 0;
+    }
+
+    size_t frame_bytes = pcm_frame_bytes(sd->preroll_format);
+    size_t n = sd->preroll_frames - sd->preroll_pos;
+    if (n > frames) n = frames;
+    memcpy(buffer, (uint8_t*)sd->preroll + sd->preroll_pos * frame_bytes, n * frame_bytes);
+    sd->preroll_pos += n;
+    sd->current_frame += n;
+
+    if (sd->preroll_pos >= sd->preroll_frames) {
+        stream_decoder_drop_preroll(sd);
+    }
+    return n;
+}
+
+// Decode a chunk in the current stream's sample format (prefetched PCM first)
+static size_t stream_decoder_read_pcm(StreamDecoder* sd, void* buffer, size_t frames) {
+    if (sd->preroll) {
+        size_t n = stream_decoder_read_preroll(sd, buffer, frames);
+        if (n > 0) return n;
+    }
+    // Hi-res FLAC on the helpers; the decode thread only, previews and scans stay serial
+    if (sd->parallel) {
+        size_t n = flac_parallel_read(sd, player.stream_format, buffer, frames);
+        if (sd->parallel) return n;
+    }
+    return stream_decoder_read_format(sd, player.stream_format, buffer, frames);
+}
+
+// ============ STREAMING DECODE THREAD ============
+
+// The decode thread refills the buffer in bursts instead of polling: once the fill
+// level reaches the high watermark it sleeps until the audio callback reports the
+// low watermark (or a seek/stop/next track needs it), so steady playback costs
+// about one wakeup per second of audio. In power-save mode the same cycle runs over
+// the whole ring, so the CPU and SD card can sleep for tens of seconds at a time.
+#define STREAM_POWERSAVE_LOW_WATERMARK (1 << 18)  // ~6 seconds, covers CPU and SD card wake-up
+#define STREAM_WAIT_TIMEOUT_MS 250  // Safety net for a wake lost to the callback race
+#define STREAM_POWERSAVE_WAIT_TIMEOUT_MS 1000
+
+// Normal-playback watermarks are planned in milliseconds (so they hold at any output
+// rate) from two measurements: the wall-clock time a decode chunk takes per second of
+// audio, kept per source format, and the worst recent wait beyond a chunk's CPU time
+// (file reads stalling on the SD card), kept across tracks. The low watermark covers a
+// few worst-case chunks, the high one adds a refill burst. WAV on fast storage ends up
+// with a ring of a few hundred KB; FLAC on a struggling card gets several seconds.
+// The low watermark's floor and the minimum burst come from the sink's AudioProfile.
+#define STREAM_LOW_MAX_MS 6000
+#define STREAM_CHUNK_MARGIN 3        // Worst-case chunks the low watermark must cover
+#define STREAM_WAKE_SLACK_MS 100     // Decode thread wake-up latency
+#define STREAM_STALL_DECAY 0.95f     // Per-chunk decay of the worst stall
+#define STREAM_COST_SMOOTHING 0.1f   // Weight of a new chunk in the decode cost average
+#define STREAM_PREBUFFER_MS 500      // Buffered before a load starts playing
+
+// Decode wall time per audio time for each AudioFormat, seeded with rough costs
+// (decode thread only, kept across tracks)
+static float stream_decode_cost[] = {
+    [AUDIO_FORMAT_UNKNOWN] = 0.10f,
+    [AUDIO_FORMAT_WAV] = 0.01f,
+    [AUDIO_FORMAT_MP3] = 0.05f,
+    [AUDIO_FORMAT_OGG] = 0.08f,
+    [AUDIO_FORMAT_FLAC] = 0.08f,
+    [AUDIO_FORMAT_MOD] = 0.10f,
+    [AUDIO_FORMAT_M4A] = 0.08f,
+};
+#define STREAM_COST_FORMATS ((int)(sizeof(stream_decode_cost) / sizeof(stream_decode_cost[0])))
+static float stream_read_stall_ms = 0.0f;  // Decaying worst stall (decode thread only)
+
+static float* stream_cost_slot(AudioFormat format) {
+    return &stream_decode_cost[(format >= 0 && format < STREAM_COST_FORMATS) ? format : AUDIO_FORMAT_UNKNOWN];
+}
+
+// Frames one decode chunk can add to the ring at the output rate, plus resampler slack
+static size_t stream_chunk_output_frames(void) {
+    int src_rate = player.stream_decoder.source_sample_rate;
+    int dst_rate = current_sample_rate;
+    size_t chunk_out = DECODE_CHUNK_FRAMES;
+    if (src_rate > 0 && dst_rate > src_rate) {
+        chunk_out = (size_t)((int64_t)DECODE_CHUNK_FRAMES * dst_rate / src_rate);
+    }
+    // Slowed down, a chunk comes out longer
+    int speed = __atomic_load_n(&player.speed_percent, __ATOMIC_RELAXED);
+    if (speed < 100) chunk_out = chunk_out * 100 / speed;
+    return chunk_out + 256;
+}
+
+// Work out the normal-playback watermarks for the current decoder and estimates
+static void stream_plan_update(void) {
+    const StreamDecoder* sd = &player.stream_decoder;
+    int src_rate = sd->source_sample_rate > 0 ? sd->source_sample_rate : current_sample_rate;
+    float cost = *stream_cost_slot(sd->format);
+    float chunk_ms = (float)DECODE_CHUNK_FRAMES * 1000.0f / (float)src_rate;
+
+    // A decoder that can't keep up gets the most headroom there is
+    float low_ms = STREAM_LOW_MAX_MS;
+    if (cost < 1.0f) {
+        low_ms = STREAM_CHUNK_MARGIN * (cost * chunk_ms + stream_read_stall_ms) + STREAM_WAKE_SLACK_MS;
+    }
+    const AudioProfile* profile = current_audio_profile();
+    if (low_ms < profile->low_min_ms) low_ms = profile->low_min_ms;
+    if (low_ms > STREAM_LOW_MAX_MS) low_ms = STREAM_LOW_MAX_MS;
+    float high_ms = low_ms + (low_ms > profile->burst_min_ms ? low_ms : profile->burst_min_ms);
+
+    __atomic_store_n(&player.stream_low_frames, (size_t)(low_ms * current_sample_rate / 1000.0f),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&player.stream_high_frames, (size_t)(high_ms * current_sample_rate / 1000.0f),
+                     __ATOMIC_RELAXED);
+}
+
+// Fold one decode iteration into the estimates (decode thread only)
+static void stream_plan_observe(uint64_t wall_us, uint64_t cpu_us, size_t output_frames) {
+    if (output_frames == 0 || current_sample_rate <= 0) return;
+
+    float audio_us = (float)output_frames * 1000000.0f / (float)current_sample_rate;
+    float* cost = stream_cost_slot(player.stream_decoder.format);
+    *cost += ((float)wall_us / audio_us - *cost) * STREAM_COST_SMOOTHING;
+
+    float stall_ms = wall_us > cpu_us ? (float)(wall_us - cpu_us) / 1000.0f : 0.0f;
+    stream_read_stall_ms *= STREAM_STALL_DECAY;
+    if (stall_ms > stream_read_stall_ms) stream_read_stall_ms = stall_ms;
+
+    stream_plan_update();
+}
+
+static size_t stream_low_watermark(void) {
+    size_t low = __atomic_load_n(&player.stream_low_frames, __ATOMIC_RELAXED);
+    if (__atomic_load_n(&player.power_save, __ATOMIC_RELAXED) && low < STREAM_POWERSAVE_LOW_WATERMARK) {
+        low = STREAM_POWERSAVE_LOW_WATERMARK;
+    }
+    return low;
+}
+
+// Wake the decode thread (any thread except the audio callback)
+static void stream_wake(void) {
+    pthread_mutex_lock(&player.stream_wake_mutex);
+    player.stream_wake_pending = true;
+    pthread_cond_signal(&player.stream_wake_cond);
+    pthread_mutex_unlock(&player.stream_wake_mutex);
+}
+
+// Wake the decode thread from the audio callback without blocking; a wake that
+// races with the thread going to sleep is picked up by the wait timeout
+static void stream_wake_from_callback(void) {
+    if (!__atomic_load_n(&player.stream_idle, __ATOMIC_ACQUIRE)) return;
+    __atomic_store_n(&player.stream_wake_pending, true, __ATOMIC_RELEASE);
+    pthread_cond_signal(&player.stream_wake_cond);
+}
+
+// Decode thread mailbox
+// The UI, the audio callback and the sink switch steer the decode thread through
+// commands rather than shared flags. stream_post stamps a command with the next
+// sequence number and publishes it in its type's slot; the decode thread takes the
+// pending ones at a chunk boundary, oldest first, and acknowledges each by storing
+// its sequence as the slot's done. Posting takes no lock (the callback posts the
+// repeat seek), and a newer post of a type replaces one not yet taken, so a burst
+// of seeks while scrubbing costs one seek. The caller wakes the thread.
+
+// Post a command; returns its sequence for stream_command_done
+static uint32_t stream_post(StreamCommand cmd, int64_t arg) {
+    StreamCommandSlot* slot = &player.stream_cmds[cmd];
+    __atomic_store_n(&slot->arg, arg, __ATOMIC_RELAXED);
+    uint32_t seq = __atomic_add_fetch(&player.stream_cmd_seq, 1, __ATOMIC_ACQ_REL);
+    // Two posters of one type: the newer sequence stays (either argument may win)
+    uint32_t posted = __atomic_load_n(&slot->posted, __ATOMIC_RELAXED);
+    while ((int32_t)(seq - posted) > 0 &&
+           !__atomic_compare_exchange_n(&slot->posted, &posted, seq, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    return seq;
+}
+
+// Whether the decode thread carried out the post with sequence seq (or a newer one)
+static bool stream_command_done(StreamCommand cmd, uint32_t seq) {
+    return (int32_t)(__atomic_load_n(&player.stream_cmds[cmd].done, __ATOMIC_ACQUIRE) - seq) >= 0;
+}
+
+// A post of cmd the decode thread hasn't carried out yet
+static bool stream_command_pending(StreamCommand cmd) {
+    const StreamCommandSlot* slot = &player.stream_cmds[cmd];
+    return __atomic_load_n(&slot->posted, __ATOMIC_ACQUIRE) != __atomic_load_n(&slot->done, __ATOMIC_ACQUIRE);
+}
+
+// Oldest pending command (decode thread); false if there is none
+static bool stream_take_command(StreamCommand* cmd, int64_t* arg, uint32_t* seq) {
+    bool found = false;
+    for (int i = 0; i < STREAM_CMD_COUNT; i++) {
+        if (!stream_command_pending((StreamCommand)i)) continue;
+        uint32_t posted = __atomic_load_n(&player.stream_cmds[i].posted, __ATOMIC_ACQUIRE);
+        if (!found || (int32_t)(posted - *seq) < 0) {
+            *cmd = (StreamCommand)i;
+            *seq = posted;
+            found = true;
+        }
+    }
+    if (found) *arg = __atomic_load_n(&player.stream_cmds[*cmd].arg, __ATOMIC_RELAXED);
+    return found;
+}
+
+static void stream_command_ack(StreamCommand cmd, uint32_t seq) {
+    __atomic_store_n(&player.stream_cmds[cmd].done, seq, __ATOMIC_RELEASE);
+}
+
+// Nothing pending from before the decode thread starts (main thread)
+static void stream_commands_reset(void) {
+    for (int i = 0; i < STREAM_CMD_COUNT; i++) {
+        StreamCommandSlot* slot = &player.stream_cmds[i];
+        __atomic_store_n(&slot->done, __atomic_load_n(&slot->posted, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    }
+}
+
+// Block until woken or the timeout passes
+static void stream_wait(void) {
+    struct timespec deadline;
+    int timeout_ms = __atomic_load_n(&player.power_save, __ATOMIC_RELAXED) ?
+                     STREAM_POWERSAVE_WAIT_TIMEOUT_MS : STREAM_WAIT_TIMEOUT_MS;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&player.stream_wake_mutex);
+    __atomic_store_n(&player.stream_idle, true, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(&player.stream_wake_pending, __ATOMIC_ACQUIRE) &&
+           !stream_command_pending(STREAM_CMD_STOP)) {
+        if (pthread_cond_timedwait(&player.stream_wake_cond, &player.stream_wake_mutex, &deadline) != 0) {
+            break;  // Timed out
+        }
+    }
+    __atomic_store_n(&player.stream_idle, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&player.stream_wake_pending, false, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&player.stream_wake_mutex);
+}
+
+// Ring size the current plan needs: the high watermark plus room for one decode
+// chunk, so a write never has to drop frames
+static size_t stream_buffer_needed(void) {
+    if (__atomic_load_n(&player.power_save, __ATOMIC_RELAXED)) return STREAM_BUFFER_FRAMES_POWERSAVE;
+    return __atomic_load_n(&player.stream_high_frames, __ATOMIC_RELAXED) + stream_chunk_output_frames();
+}
+
+// Grow the ring to at least `frames` (decode thread only)
+// The buffered frames are copied while the audio callback keeps reading the old ring
+// (only this thread writes), then the rings are swapped under player.mutex, which the
+// callback holds whenever it touches the ring.
+static bool stream_buffer_reserve(size_t frames) {
+    CircularBuffer* cb = &player.stream_buffer;
+    if (frames <= cb->capacity) return true;
+
+    size_t capacity = cb->capacity;
+    while (capacity < frames) capacity <<= 1;
+    uint8_t* buffer = MEM_MALLOC(cb->tag, capacity * cb->frame_bytes);
+    if (!buffer) return false;
+
+    size_t w = __atomic_load_n(&cb->write_pos, __ATOMIC_RELAXED);
+    size_t r = __atomic_load_n(&cb->read_pos, __ATOMIC_ACQUIRE);
+    for (size_t pos = r; pos < w;) {
+        size_t idx = pos & cb->mask;
+        size_t n = cb->capacity - idx;
+        if (n > w - pos) n = w - pos;
+        size_t new_idx = pos & (capacity - 1);
+        size_t first = capacity - new_idx < n ? capacity - new_idx : n;
+        memcpy(&buffer[new_idx * cb->frame_bytes], &cb->buffer[idx * cb->frame_bytes], first * cb->frame_bytes);
+        memcpy(buffer, &cb->buffer[(idx + first) * cb->frame_bytes], (n - first) * cb->frame_bytes);
+        pos += n;
+    }
+
+    pthread_mutex_lock(&player.mutex);
+    uint8_t* old = cb->buffer;
+    cb->buffer = buffer;
+    cb->capacity = capacity;
+    cb->mask = capacity - 1;
+    pthread_mutex_unlock(&player.mutex);
+
+    MEM_FREE(cb->tag, old);
+    return true;
+}
+
+// Fill level to refill up to
+static size_t stream_high_watermark(void) {
+    size_t low = stream_low_watermark();
+    size_t chunk_out = stream_chunk_output_frames();
+    size_t target = __atomic_load_n(&player.power_save, __ATOMIC_RELAXED) ?
+                    STREAM_BUFFER_FRAMES_POWERSAVE - chunk_out :
+                    __atomic_load_n(&player.stream_high_frames, __ATOMIC_RELAXED);
+
+    // Stay within the ring if it couldn't grow
+    size_t capacity = player.stream_buffer.capacity;
+    if (target + chunk_out > capacity) {
+        target = capacity > chunk_out ? capacity - chunk_out : 0;
+    }
+    return target > low ? target : low;
+}
+
+// Thread CPU time in microseconds (for the governor's load estimate)
+static uint64_t thread_cpu_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Background open of the queued next track (keeps file I/O off the decode thread)
+static int open_track(const char* filepath, StreamDecoder* sd, TrackMetadata* meta);
+static void prefetch_shutdown(void);
+static void loudness_shutdown(void);
+static int16_t track_normalization_q15(const char* filepath, const TrackMetadata* meta);
+
+// Tags of the queued next track, applied by Player_update at the switch
+// (written by next_thread, read after joining it)
+static TrackMetadata next_metadata;
+
+static void* next_open_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_DECODE);  // Gapless depends on this finishing in time
+    NextTrackState result = NEXT_TRACK_FAILED;
+    if (open_track(player.next_file, &player.next_decoder, &next_metadata) == 0) {
+        // Taken over by the audio callback at the boundary
+        __atomic_store_n(&next_norm_q15, track_normalization_q15(player.next_file, &next_metadata),
+                         __ATOMIC_RELAXED);
+        result = NEXT_TRACK_READY;
+    }
+    __atomic_store_n(&player.next_state, result, __ATOMIC_RELEASE);
+    // Decode thread may be waiting at end of track or for the crossfade window
+    stream_post(STREAM_CMD_NEXT, result);
+    stream_wake();
+    return NULL;
+}
+
+// ============ OUTPUT CLOCK ============
+
+// The decode thread stamps each block it queues with the ring position of its first
+// frame and that frame's place in the track. The callback takes the newest stamp at
+// or before what it has read and counts output frames from there, so the position
+// follows the audio actually played across seeks, resampling and track switches
+// instead of a counter that seeks overwrite. Each position is published with the
+// time it was output; Player_getPosition extrapolates from it without a lock.
+#define STREAM_STAMPS 256           // Blocks of DECODE_CHUNK_FRAMES, beyond the largest ring
+#define POSITION_EXTRAPOLATE_MAX_MS 500
+
+typedef struct {
+    size_t ring_pos;                // Ring write position of the block's first frame
+    int64_t source_frame;           // Its frame in the track
+    int source_rate;
+    uint32_t tempo_q16;             // Track frames per output frame (playback speed)
+} StreamStamp;
+
+static StreamStamp stream_stamps[STREAM_STAMPS];
+static uint32_t stamp_head = 0;     // Stamps written (decode thread, atomic)
+static uint32_t stamp_tail = 0;     // Stamps passed (callback, atomic)
+static StreamStamp clock_stamp;     // Callback's: newest stamp at or before its read position
+static bool clock_valid = false;    // Callback's
+
+// Playback speed stage (decode thread only), created the first time the speed
+// leaves 100%, with its output block
+#define STRETCH_BLOCK_FRAMES 4096
+static TimeStretch* stream_stretch = NULL;
+static void* stretch_block = NULL;
+
+static bool stream_stretching(void) {
+    return stream_stretch && TimeStretch_active(stream_stretch);
+}
+
+// Stamp the block about to be written at the ring's write position (decode thread)
+// A full queue drops the stamp; the clock then counts on from the previous one.
+// The speed stage's held input comes out ahead of the block.
+static void stream_stamp(int64_t source_frame, int source_rate) {
+    if (source_rate <= 0) return;
+    uint32_t tempo_q16 = 65536;
+    if (stream_stretching()) {
+        tempo_q16 = (uint32_t)(TimeStretch_getTempo(stream_stretch) * 65536.0f);
+        source_frame -= (int64_t)TimeStretch_pendingInput(stream_stretch) * source_rate / current_sample_rate;
+    }
+    uint32_t head = stamp_head;
+    if (head - __atomic_load_n(&stamp_tail, __ATOMIC_ACQUIRE) >= STREAM_STAMPS) return;
+    StreamStamp* stamp = &stream_stamps[head % STREAM_STAMPS];
+    stamp->ring_pos = circular_buffer_write_position(&player.stream_buffer);
+    stamp->source_frame = source_frame;
+    stamp->source_rate = source_rate;
+    stamp->tempo_q16 = tempo_q16;
+    __atomic_store_n(&stamp_head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Track time in microseconds of the frame at ring_pos (callback); false before any stamp
+static bool stream_clock_at(size_t ring_pos, int64_t* time_us) {
+    uint32_t head = __atomic_load_n(&stamp_head, __ATOMIC_ACQUIRE);
+    uint32_t tail = stamp_tail;
+    while (tail != head && (ptrdiff_t)(stream_stamps[tail % STREAM_STAMPS].ring_pos - ring_pos) <= 0) {
+        clock_stamp = stream_stamps[tail % STREAM_STAMPS];
+        clock_valid = true;
+        tail++;
+    }
+    __atomic_store_n(&stamp_tail, tail, __ATOMIC_RELEASE);
+    if (!clock_valid || current_sample_rate <= 0) return false;
+
+    *time_us = clock_stamp.source_frame * 1000000 / clock_stamp.source_rate +
+               ((int64_t)(ring_pos - clock_stamp.ring_pos) * clock_stamp.tempo_q16 >> 16) * 1000000 /
+               current_sample_rate;
+    return true;
+}
+
+// Drop all stamps before a new stream starts (neither side may be running)
+static void stream_clock_reset(void) {
+    stamp_head = 0;
+    stamp_tail = 0;
+    clock_valid = false;
+}
+
+// Set the position (file ms) and publish it with the moment it applies to
+static void set_position_ms(int position_ms) {
+    player.position_ms = position_ms;
+    __atomic_store_n(&player.output_clock,
+                     (uint64_t)(uint32_t)position_ms << 32 | (uint32_t)(monotonic_us() / 1000), __ATOMIC_RELEASE);
+}
+
+// Frames decoded per stream per iteration while crossfading
+// Both streams share the regular thread buffers, so no extra allocation is needed
+#define FADE_CHUNK_FRAMES 4096
+
+// Take the pooled resampler (reset) or create a new one
+static Resampler* resampler_acquire(void) {
+    pthread_mutex_lock(&decoder_pool_mutex);
+    Resampler* resampler = pooled_resampler;
+    pooled_resampler = NULL;
+    pthread_mutex_unlock(&decoder_pool_mutex);
+
+    if (resampler) {
+        Resampler_reset(resampler);
+        Resampler_setQuality(resampler, resampler_quality());
+        return resampler;
+    }
+    return Resampler_new(resampler_quality());
+}
+
+// Keep a resampler for the next track, or free it if one is already pooled
+static void resampler_release(void* resampler) {
+    if (!resampler) return;
+
+    pthread_mutex_lock(&decoder_pool_mutex);
+    if (!pooled_resampler) {
+        pooled_resampler = (Resampler*)resampler;
+        resampler = NULL;
+    }
+    pthread_mutex_unlock(&decoder_pool_mutex);
+
+    Resampler_free((Resampler*)resampler);
+}
+
+// Reset an existing resampler or create one if src_rate needs converting
+static int prepare_resampler(void** resampler, int src_rate, int dst_rate) {
+    if (*resampler) {
+        Resampler_reset((Resampler*)*resampler);
+        return 0;
+    }
+    if (src_rate == dst_rate) return 0;
+
+    *resampler = resampler_acquire();
+    if (!*resampler) {
+        LOG_ASYNC_error("Stream: Failed to create resampler\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Claim the READY next decoder for the decode thread
+// Fails if the main thread cleared it in the meantime
+static bool stream_claim_next(void) {
+    NextTrackState expected = NEXT_TRACK_READY;
+    return __atomic_compare_exchange_n(&player.next_state, &expected, NEXT_TRACK_SWITCHING,
+                                       false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Mark the current write position as the start of the next track
+// The audio callback resets the playback position once it reaches it
+static void stream_publish_switch(void) {
+    player.next_boundary = circular_buffer_write_position(&player.stream_buffer);
+    __atomic_store_n(&player.next_state, NEXT_TRACK_SWITCHED, __ATOMIC_RELEASE);
+    stream_stamp(player.stream_decoder.current_frame, player.stream_decoder.source_sample_rate);
+}
+
+// Swap the pre-opened next decoder in at end of track (decode thread only)
+// The ring buffer keeps playing the old track's tail; next_boundary marks where
+// the new track starts so the audio callback can switch position at the right sample.
+// Returns true if decoding continues with the next track.
+static bool stream_switch_to_next(void) {
+    // The bit-perfect device only takes tracks of the same rate; anything else needs a full reload
+    if (player.stream_format == PCM_FORMAT_S32 &&
+        (!stream_decoder_is_hires(&player.next_decoder) ||
+         player.next_decoder.source_sample_rate != current_sample_rate)) {
+        return false;
+    }
+    if (!stream_claim_next()) return false;
+
+    if (prepare_resampler(&player.resampler, player.next_decoder.source_sample_rate,
+                          current_sample_rate) != 0) {
+        stream_decoder_close(&player.next_decoder);
+        __atomic_store_n(&player.next_state, NEXT_TRACK_FAILED, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    stream_decoder_close(&player.stream_decoder);
+    player.stream_decoder = player.next_decoder;
+    memset(&player.next_decoder, 0, sizeof(StreamDecoder));
+
+    stream_publish_switch();
+    return true;
+}
+
+// Decode up to `frames` source frames and convert them to the output rate
+// Returns output frames written to out (0 at end of stream)
+static size_t stream_produce(StreamDecoder* sd, void* resampler, void* decode_buf,
+                             size_t frames, void* out, size_t max_out) {
+    size_t decoded = stream_decoder_read_pcm(sd, decode_buf, frames);
+    if (decoded == 0) return 0;
+
+    int src_rate = sd->source_sample_rate;
+    int dst_rate = current_sample_rate;
+    if (!resampler) src_rate = dst_rate;  // No resampler, pass through as-is
+    bool is_last = (sd->current_frame >= sd->total_frames);
+
+    return resample_chunk_pcm(decode_buf, decoded, src_rate, dst_rate, out, max_out,
+                              (Resampler*)resampler, is_last);
+}
+
+// Crossfade mix kernel: a = a + (b - a) * g, with g ramping by `step` per frame from g0
+// The result is a convex blend of two int16 samples so it never needs clipping.
+static void crossfade_mix(int16_t* restrict a, const int16_t* restrict b,
+                          size_t frames, float g0, float step) {
+    size_t n = frames * AUDIO_CHANNELS;
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // 4 stereo frames per iteration: gains {g, g, g+s, g+s} and {g+2s, g+2s, g+3s, g+3s}
+    float32x4_t gain_lo = {g0, g0, g0 + step, g0 + step};
+    float32x4_t gain_hi = {g0 + 2 * step, g0 + 2 * step, g0 + 3 * step, g0 + 3 * step};
+    float32x4_t gain_inc = vdupq_n_f32(4 * step);
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t va = vld1q_s16(&a[i]);
+        int16x8_t vb = vld1q_s16(&b[i]);
+
+        float32x4_t a_lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(va)));
+        float32x4_t a_hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(va)));
+        float32x4_t b_lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(vb)));
+        float32x4_t b_hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(vb)));
+
+        a_lo = vmlaq_f32(a_lo, vsubq_f32(b_lo, a_lo), gain_lo);
+        a_hi = vmlaq_f32(a_hi, vsubq_f32(b_hi, a_hi), gain_hi);
+
+        vst1q_s16(&a[i], vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a_lo)),
+                                      vqmovn_s32(vcvtq_s32_f32(a_hi))));
+
+        gain_lo = vaddq_f32(gain_lo, gain_inc);
+        gain_hi = vaddq_f32(gain_hi, gain_inc);
+    }
+#endif
+
+    // Scalar tail (and non-NEON builds)
+    for (; i < n; i++) {
+        float g = g0 + (float)(i / AUDIO_CHANNELS) * step;
+        float sa = a[i];
+        a[i] = (int16_t)(sa + ((float)b[i] - sa) * g);
+    }
+}
+
+// Float pipeline crossfade kernel, same blend without the int16 round trip
+static void crossfade_mix_f32(float* restrict a, const float* restrict b,
+                              size_t frames, float g0, float step) {
+    size_t n = frames * AUDIO_CHANNELS;
+    size_t i = 0;
+
+#if defined(__ARM_NEON)
+    // 2 stereo frames per iteration: gains {g, g, g+s, g+s}
+    float32x4_t gain = {g0, g0, g0 + step, g0 + step};
+    float32x4_t gain_inc = vdupq_n_f32(2 * step);
+
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t va = vld1q_f32(&a[i]);
+        float32x4_t vb = vld1q_f32(&b[i]);
+        vst1q_f32(&a[i], vmlaq_f32(va, vsubq_f32(vb, va), gain));
+        gain = vaddq_f32(gain, gain_inc);
+    }
+#endif
+
+    for (; i < n; i++) {
+        float g = g0 + (float)(i / AUDIO_CHANNELS) * step;
+        a[i] += (b[i] - a[i]) * g;
+    }
+}
+
+// Crossfade state (decode thread only)
+typedef struct {
+    bool active;
+    StreamDecoder outgoing;     // Track fading out (player.stream_decoder is the incoming one)
+    void* outgoing_resampler;
+    size_t total;               // Fade length in output frames
+    size_t pos;                 // Output frames mixed so far
+    uint8_t* pending;           // Incoming track frames not mixed yet (stream format)
+    size_t pending_frames;
+    size_t pending_capacity;
+} CrossfadeState;
+
+// Start a crossfade into the READY next track (decode thread only)
+// The incoming track becomes player.stream_decoder right away so seeking, track info
+// and end-of-track handling all follow it; the outgoing one is only mixed in.
+static bool stream_begin_crossfade(CrossfadeState* fade, size_t fade_frames) {
+    if (!stream_claim_next()) return false;
+
+    int dst_rate = current_sample_rate;
+    if (prepare_resampler(&player.fade_resampler, player.next_decoder.source_sample_rate, dst_rate) != 0) {
+        stream_decoder_close(&player.next_decoder);
+        __atomic_store_n(&player.next_state, NEXT_TRACK_FAILED, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    fade->outgoing = player.stream_decoder;
+    fade->outgoing_resampler = player.resampler;
+    player.stream_decoder = player.next_decoder;
+    player.resampler = player.fade_resampler;
+    player.fade_resampler = NULL;
+    memset(&player.next_decoder, 0, sizeof(StreamDecoder));
+
+    fade->active = true;
+    fade->total = fade_frames;
+    fade->pos = 0;
+    fade->pending_frames = 0;
+
+    stream_publish_switch();
+    return true;
+}
+
+// Finish (or abort) a crossfade: close the outgoing track, keep its resampler as spare
+static void stream_end_crossfade(CrossfadeState* fade) {
+    stream_decoder_close(&fade->outgoing);
+    if (fade->outgoing_resampler) {
+        resampler_release(player.fade_resampler);
+        player.fade_resampler = fade->outgoing_resampler;
+        fade->outgoing_resampler = NULL;
+    }
+    fade->active = false;
+    fade->pending_frames = 0;
+}
+
+// Output frames left in the current track, or 0 if unknown
+static size_t stream_remaining_output_frames(const StreamDecoder* sd) {
+    if (sd->total_frames <= 0 || sd->source_sample_rate <= 0) return 0;
+    int64_t remaining = sd->total_frames - sd->current_frame;
+    if (remaining <= 0) return 0;
+    size_t frames = (size_t)(remaining * current_sample_rate / sd->source_sample_rate);
+    return stream_stretching() ? (size_t)(frames / TimeStretch_getTempo(stream_stretch)) : frames;
+}
+
+// Equalizer history of the stream thread (decode thread only)
+static EqualizerState stream_eq;
+
+// Follow the wanted speed (decode thread); bit-perfect streams stay untouched
+static void stream_stretch_update(void) {
+    int speed = __atomic_load_n(&player.speed_percent, __ATOMIC_RELAXED);
+    if (player.stream_format == PCM_FORMAT_S32) return;
+    if (!stream_stretch) {
+        if (speed == 100) return;
+        stream_stretch = TimeStretch_new(current_sample_rate);
+        stretch_block = malloc(STRETCH_BLOCK_FRAMES * player.stream_buffer.frame_bytes);
+        if (!stream_stretch || !stretch_block) {
+            LOG_error("Stream: no memory for playback speed, playing at 100%%\n");
+            TimeStretch_free(stream_stretch);
+            free(stretch_block);
+            stream_stretch = NULL;
+            stretch_block = NULL;
+            __atomic_store_n(&player.speed_percent, 100, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+    TimeStretch_setTempo(stream_stretch, speed / 100.0f);
+}
+
+static void stream_stretch_free(void) {
+    TimeStretch_free(stream_stretch);
+    free(stretch_block);
+    stream_stretch = NULL;
+    stretch_block = NULL;
+}
+
+// Run frames through the speed stage into the ring; drain: the stream ends here
+static void stream_write_stretched(void* data, size_t frames, bool drain) {
+    for (;;) {
+        size_t n = player.stream_format == PCM_FORMAT_F32 ?
+            TimeStretch_processF32(stream_stretch, (const float*)data, frames,
+                                   (float*)stretch_block, STRETCH_BLOCK_FRAMES, drain) :
+            TimeStretch_processS16(stream_stretch, (const int16_t*)data, frames,
+                                   (int16_t*)stretch_block, STRETCH_BLOCK_FRAMES, drain);
+        circular_buffer_write(&player.stream_buffer, stretch_block, n);
+        if (n < STRETCH_BLOCK_FRAMES) break;
+        data = NULL;    // The rest of the output is pending
+        frames = 0;
+    }
+}
+
+// Equalize output-rate frames and queue them for the audio callback, through
+// the speed stage while it is in use. Bit-perfect streams bypass both.
+static void stream_write_output(void* data, size_t frames) {
+    if (player.stream_format == PCM_FORMAT_F32) {
+        Equalizer_processF32(&stream_eq, current_sample_rate, (float*)data, frames, AUDIO_CHANNELS);
+    } else if (player.stream_format == PCM_FORMAT_S16) {
+        Equalizer_processS16(&stream_eq, current_sample_rate, (int16_t*)data, frames, AUDIO_CHANNELS);
+    }
+    if (stream_stretching()) {
+        stream_write_stretched(data, frames, false);
+        return;
+    }
+    circular_buffer_write(&player.stream_buffer, data, frames);
+}
+
+// Seek requests closer together than this are scrubbing: they take the nearest seek
+// index entry, and one precise seek follows once they stop
+#define SEEK_SETTLE_MS 200
+#define MP3_SEEK_STEP_SECONDS 10
+
+// Walk an MP3 without a seek index toward frame in steps (drmp3 decodes every frame
+// on the way), giving up as soon as a newer seek or a stop is posted. False if superseded.
+static bool mp3_seek_steps(StreamDecoder* sd, int64_t frame, uint32_t request) {
+    drmp3* mp3 = (drmp3*)sd->decoder;
+    if (mp3->pSeekPoints || sd->source_sample_rate <= 0) return true;
+    stream_decoder_drop_preroll(sd);
+
+    int64_t step = (int64_t)MP3_SEEK_STEP_SECONDS * sd->source_sample_rate;
+    int64_t at = (int64_t)mp3->currentPCMFrame;
+    if (frame < at) at = 0;     // drmp3 goes back by starting over
+    while (frame - at > step) {
+        at += step;
+        if (!drmp3_seek_to_pcm_frame(mp3, (drmp3_uint64)at)) return true;  // The full seek reports it
+        sd->current_frame = at;
+        if (__atomic_load_n(&player.stream_cmds[STREAM_CMD_SEEK].posted, __ATOMIC_ACQUIRE) != request ||
+            stream_command_pending(STREAM_CMD_STOP)) return false;
+    }
+    return true;
+}
+
+// Seek the playing track and drop what was decoded from the old position
+// rate_changed: the output rate changed since the last seek, the resampler is rebuilt.
+// Returns false if a newer request superseded it half way (nothing was dropped).
+static bool stream_apply_seek(CrossfadeState* fade, int64_t frame, uint32_t request, bool rate_changed) {
+    StreamDecoder* sd = &player.stream_decoder;
+
+    // Seeking targets the incoming track, drop the outgoing one
+    if (fade->active) {
+        stream_end_crossfade(fade);
+    }
+    if (sd->format == AUDIO_FORMAT_MP3 && sd->decoder && !mp3_seek_steps(sd, frame, request)) {
+        return false;
+    }
+    stream_decoder_seek(sd, frame);
+    circular_buffer_clear(&player.stream_buffer);
+    if (rate_changed) {
+        // Sink switch: resample for the new output rate (the tier follows the profile)
+        resampler_release(player.resampler);
+        player.resampler = NULL;
+        prepare_resampler(&player.resampler, sd->source_sample_rate, current_sample_rate);
+        stream_plan_update();
+    } else if (player.resampler) {
+        Resampler_reset((Resampler*)player.resampler);
+    }
+    Equalizer_reset(&stream_eq);
+    if (stream_stretch) TimeStretch_reset(stream_stretch, current_sample_rate);
+    __atomic_store_n(&player.stream_eof, false, __ATOMIC_RELEASE);  // Reset EOF flag on seek
+    return true;
+}
+
+// One crossfade step: decode both streams, mix, write to the ring buffer
+// a_buf/a_out and b_buf are carved out of the regular thread buffers.
+static void stream_crossfade_step(CrossfadeState* fade, void* a_raw, void* b_raw,
+                                  void* a_out, size_t a_out_capacity) {
+    size_t frame_bytes = player.stream_buffer.frame_bytes;
+    size_t na = stream_produce(&fade->outgoing, fade->outgoing_resampler, a_raw,
+                               FADE_CHUNK_FRAMES, a_out, a_out_capacity);
+
+    if (na > 0) {
+        // Top up the incoming track to at least as many frames as the outgoing one
+        bool b_eof = false;
+        while (fade->pending_frames < na && !b_eof) {
+            size_t nb = stream_produce(&player.stream_decoder, player.resampler, b_raw,
+                                       FADE_CHUNK_FRAMES,
+                                       &fade->pending[fade->pending_frames * frame_bytes],
+                                       fade->pending_capacity - fade->pending_frames);
+            if (nb == 0) b_eof = true;
+            fade->pending_frames += nb;
+        }
+        if (fade->pending_frames < na) {
+            // Incoming track shorter than the fade, pad with silence
+            memset(&fade->pending[fade->pending_frames * frame_bytes], 0,
+                   (na - fade->pending_frames) * frame_bytes);
+            fade->pending_frames = na;
+        }
+
+        float step = 1.0f / (float)fade->total;
+        if (player.stream_format == PCM_FORMAT_F32) {
+            crossfade_mix_f32((float*)a_out, (const float*)fade->pending, na, (float)fade->pos * step, step);
+        } else {
+            crossfade_mix((int16_t*)a_out, (const int16_t*)fade->pending, na, (float)fade->pos * step, step);
+        }
+        stream_write_output(a_out, na);
+
+        fade->pending_frames -= na;
+        memmove(fade->pending, &fade->pending[na * frame_bytes],
+                fade->pending_frames * frame_bytes);
+        fade->pos += na;
+    }
+
+    if (na == 0 || fade->pos >= fade->total) {
+        // Outgoing track done, flush the incoming frames decoded ahead
+        stream_write_output(fade->pending, fade->pending_frames);
+        stream_end_crossfade(fade);
+    }
+}
+
+// Repeat-one and A-B loops never drain the ring. The first LOOP_HEAD_MS of the loop
+// is kept as the decoder passed it; at the loop end that head is written next, the
+// resampler running on across the joint, and the decoder seeks to the end of the head
+// behind it, so the seek stalls with a second of audio queued. A head not captured
+// yet (loop set past its start) makes that one splice seek to the start directly.
+#define LOOP_HEAD_MS 1000
+
+typedef struct {
+    uint8_t* pcm;               // Decoder output from start on, in the stream format
+    size_t frames;              // Held so far
+    size_t capacity;            // Frames pcm has room for
+    size_t played;              // Frames of the head written since the last splice
+    bool replaying;             // Spliced in, the decoder waits at the loop end
+    int64_t start;              // Source frame the head begins at (-1 = none)
+} LoopHead;
+
+// Loop the decode thread keeps to, in source frames of the current decoder
+// False if none is set.
+static bool loop_bounds(const StreamDecoder* sd, int64_t* start, int64_t* end) {
+    int start_ms = __atomic_load_n(&player.loop_start_ms, __ATOMIC_ACQUIRE);
+    int end_ms = __atomic_load_n(&player.loop_end_ms, __ATOMIC_RELAXED);
+    if (start_ms < 0 || sd->source_sample_rate <= 0) return false;
+    *start = (int64_t)start_ms * sd->source_sample_rate / 1000;
+    *end = end_ms > 0 ? (int64_t)end_ms * sd->source_sample_rate / 1000 : sd->total_frames;
+    if (*end > sd->total_frames) *end = sd->total_frames;
+    return *end > *start;
+}
+
+// Keep what a decoded chunk holds of the head of the loop [start, end)
+// The head stops short of the end, so the decoder always has the end to reach.
+static void loop_head_capture(LoopHead* head, int64_t start, int64_t end, int64_t chunk_start,
+                              const uint8_t* pcm, size_t frames, size_t frame_bytes, int source_rate) {
+    if (head->start != start) {
+        head->start = start;
+        head->frames = 0;
+    }
+    int64_t limit = (int64_t)LOOP_HEAD_MS * source_rate / 1000;
+    if (limit > end - start - 1) limit = end - start - 1;
+    int64_t want = start + (int64_t)head->frames;  // Next frame the head needs
+    if ((int64_t)head->frames >= limit || chunk_start > want || chunk_start + (int64_t)frames <= want) return;
+
+    // Allocated once per loop start (and thread), not per chunk
+    if (head->capacity < (size_t)limit) {
+        uint8_t* grown = realloc(head->pcm, (size_t)limit * frame_bytes);
+        if (!grown) return;
+        head->pcm = grown;
+        head->capacity = (size_t)limit;
+    }
+    size_t skip = (size_t)(want - chunk_start);
+    size_t n = frames - skip;
+    if (n > (size_t)limit - head->frames) n = (size_t)limit - head->frames;
+    memcpy(&head->pcm[head->frames * frame_bytes], &pcm[skip * frame_bytes], n * frame_bytes);
+    head->frames += n;
+}
+
+// Go back to the loop start at the loop end: the head replays first if there is one
+// Returns false if the decoder can't go back (the track then ends as usual).
+static bool loop_splice(LoopHead* head, StreamDecoder* sd, int64_t start) {
+    if (head->start == start && head->frames > 0) {
+        head->played = 0;
+        head->replaying = true;
+        sd->current_frame = start;  // What the output continues with
+        return true;
+    }
+    return stream_decoder_seek(sd, start) == 0;
+}
+
+// Write the spliced head out like a decoded chunk; once it's all out, the decoder
+// seeks to where it ends. Returns the frames copied to buffer.
+static size_t loop_head_replay(LoopHead* head, StreamDecoder* sd, void* buffer, size_t frames,
+                               size_t frame_bytes) {
+    size_t n = head->frames - head->played;
+    if (n > frames) n = frames;
+    memcpy(buffer, &head->pcm[head->played * frame_bytes], n * frame_bytes);
+    head->played += n;
+    sd->current_frame += n;
+
+    if (head->played >= head->frames) {
+        head->replaying = false;
+        if (stream_decoder_seek(sd, head->start + (int64_t)head->frames) != 0) {
+            head->start = -1;   // Next time straight from the start; if that fails too, the track ends
+        }
+    }
+    return n;
+}
+
+// A stop or seek posted and not yet carried out: the loop end waits for it instead of
+// splicing. A splice seek it cut short isn't a failure either (the loop stays set, and
+// the track doesn't end under the stop with the ring run dry).
+static bool loop_interrupted(void) {
+    return stream_command_pending(STREAM_CMD_STOP) || stream_command_pending(STREAM_CMD_SEEK);
+}
+
+static void* stream_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_DECODE);
+
+    // Buffers hold frames in the stream's sample format (fixed while the thread runs)
+    size_t frame_bytes = player.stream_buffer.frame_bytes;
+
+    // Allocate decode buffer
+    uint8_t* decode_buffer = malloc(DECODE_CHUNK_FRAMES * frame_bytes);
+    // Resample output buffer (allow for 2x expansion)
+    size_t resample_buffer_size = DECODE_CHUNK_FRAMES * 3;
+    uint8_t* resample_buffer = malloc(resample_buffer_size * frame_bytes);
+
+    if (!decode_buffer || !resample_buffer) {
+        LOG_error("Stream thread: Failed to allocate buffers\n");
+        free(decode_buffer);
+        free(resample_buffer);
+        return NULL;
+    }
+
+    // Crossfade splits the regular buffers: decode_buffer holds both raw chunks,
+    // resample_buffer holds the outgoing output followed by the incoming backlog
+    CrossfadeState fade = {0};
+    uint8_t* fade_a_raw = decode_buffer;
+    uint8_t* fade_b_raw = &decode_buffer[FADE_CHUNK_FRAMES * frame_bytes];
+    uint8_t* fade_a_out = resample_buffer;
+    size_t fade_a_capacity = FADE_CHUNK_FRAMES * 3;
+    fade.pending = &resample_buffer[fade_a_capacity * frame_bytes];
+    fade.pending_capacity = resample_buffer_size - fade_a_capacity;
+
+    // Bit-perfect streams go straight from the decoder to the buffer, without crossfade
+    bool bit_perfect = player.stream_format == PCM_FORMAT_S32;
+    Equalizer_reset(&stream_eq);
+
+    bool refilling = true;
+    bool measuring = false;      // Previous iteration produced audio, account its cost
+    uint64_t last_seek_us = 0;
+    bool precise_pending = false;   // Last seek was approximate, redo it exactly once requests settle
+    uint64_t hint_answered = 0;     // seek_hint_request last answered
+    uint64_t cpu_mark = 0;
+    uint64_t wall_mark = 0;
+    size_t write_mark = 0;
+
+    bool rate_changed = false;  // Taken from a RATE command, applied with the seek after it
+    LoopHead loop = {.start = -1};
+
+    for (;;) {
+        if (measuring) {
+            size_t written = circular_buffer_write_position(&player.stream_buffer) - write_mark;
+            uint64_t cpu_us = thread_cpu_us() - cpu_mark;
+            stream_plan_observe(monotonic_us() - wall_mark, cpu_us, written);
+            __atomic_add_fetch(&player.decode_cpu_us, cpu_us, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&player.decode_output_frames, (uint64_t)written, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&playback_stats.decode_chunks, 1, __ATOMIC_RELAXED);
+            measuring = false;
+        }
+
+        // Carry out the commands posted since the last chunk, oldest first
+        StreamCommand cmd;
+        int64_t arg;
+        uint32_t seq;
+        bool stop = false, superseded = false, seeked = false;
+        while (!stop && !superseded && stream_take_command(&cmd, &arg, &seq)) {
+            switch (cmd) {
+                case STREAM_CMD_STOP:
+                    stop = true;
+                    break;
+                case STREAM_CMD_RATE:
+                    rate_changed = true;
+                    break;
+                case STREAM_CMD_SEEK: {
+                    // A burst of seeks (scrubbing) seeks approximately, to the nearest
+                    // seek index entry, until the requests settle
+                    uint64_t now = monotonic_us();
+                    // Formats that seek exactly at once skip the approximate seeks
+                    precise_pending = now - last_seek_us < (uint64_t)SEEK_SETTLE_MS * 1000 &&
+                                      !(stream_decoder_caps(&player.stream_decoder) & DECODER_CAP_FAST_SEEK);
+                    last_seek_us = now;
+                    int64_t target = precise_pending ? stream_decoder_snap(&player.stream_decoder, arg) : arg;
+                    if (!stream_apply_seek(&fade, target, seq, rate_changed)) {
+                        superseded = true;  // The newer post is taken next round
+                        continue;
+                    }
+                    rate_changed = false;
+                    seeked = true;
+                    break;
+                }
+                case STREAM_CMD_NEXT:
+                    break;  // The crossfade and end-of-track checks below read next_state
+                default:
+                    break;
+            }
+            stream_command_ack(cmd, seq);
+        }
+        if (stop) break;
+        if (superseded) continue;
+        if (seeked) {
+            LATENCY_AUDIO_READY();  // The ring holds only audio from the new position
+            refilling = true;
+            loop.replaying = false;
+        } else if (precise_pending && monotonic_us() - last_seek_us >= (uint64_t)SEEK_SETTLE_MS * 1000) {
+            // Requests settled: seek exactly to where the position counter now is
+            precise_pending = false;
+            int src_rate = player.stream_decoder.source_sample_rate;
+            int64_t target = (int64_t)__atomic_load_n(&player.position_ms, __ATOMIC_RELAXED) * src_rate / 1000;
+            uint32_t request = __atomic_load_n(&player.stream_cmds[STREAM_CMD_SEEK].posted, __ATOMIC_ACQUIRE);
+            if (stream_apply_seek(&fade, target, request, false)) {
+                refilling = true;
+                loop.replaying = false;
+            }
+        }
+
+        // Answer a scrub preview (only this thread may look at the decoder's index)
+        int preview_ms = __atomic_load_n(&player.seek_preview_ms, __ATOMIC_ACQUIRE);
+        uint64_t snap = __atomic_load_n(&player.seek_preview_snap, __ATOMIC_RELAXED);
+        if (preview_ms >= 0 && (int)(snap >> 32) != preview_ms) {
+            StreamDecoder* sd = &player.stream_decoder;
+            int snapped_ms = preview_ms;
+            if (sd->source_sample_rate > 0) {
+                int64_t frame = stream_decoder_snap(sd, (int64_t)preview_ms * sd->source_sample_rate / 1000);
+                snapped_ms = (int)(frame * 1000 / sd->source_sample_rate);
+            }
+            __atomic_store_n(&player.seek_preview_snap, (uint64_t)(uint32_t)preview_ms << 32 | (uint32_t)snapped_ms,
+                             __ATOMIC_RELEASE);
+        }
+
+        // Answer a seek hint request, unless the decoder already moved on to the
+        // next track (its entry would be filed under this one)
+        uint64_t hint_request = __atomic_load_n(&player.seek_hint_request, __ATOMIC_ACQUIRE);
+        if (hint_request != hint_answered &&
+            __atomic_load_n(&player.next_state, __ATOMIC_ACQUIRE) != NEXT_TRACK_SWITCHED) {
+            StreamDecoder* sd = &player.stream_decoder;
+            SeekHintAnswer answer = {hint_request};
+            answer.hint.frame = -1;
+            if (sd->source_sample_rate > 0) {
+                int64_t frame = (int64_t)(uint32_t)hint_request * sd->source_sample_rate / 1000;
+                stream_decoder_hint(sd, frame, &answer.hint);
+            }
+            Seqlock_write(&seek_hint_lock, &seek_hint_answer, &answer, sizeof(answer));
+            hint_answered = hint_request;
+        }
+
+        // Follow the plan (or power save) if it outgrew the ring
+        stream_buffer_reserve(stream_buffer_needed());
+
+        // Refill in one burst up to the high watermark, then sleep until the
+        // audio callback reports the low watermark
+        size_t available = circular_buffer_available(&player.stream_buffer);
+        if (available >= stream_high_watermark()) {
+            refilling = false;
+        } else if (available < stream_low_watermark()) {
+            refilling = true;
+        }
+        __atomic_store_n(&player.stream_refilling, refilling, __ATOMIC_RELAXED);
+        if (!refilling) {
+            stream_wait();
+            continue;
+        }
+
+        measuring = true;
+        cpu_mark = thread_cpu_us();
+        wall_mark = monotonic_us();
+        write_mark = circular_buffer_write_position(&player.stream_buffer);
+
+        if (fade.active) {
+            stream_crossfade_step(&fade, fade_a_raw, fade_b_raw, fade_a_out, fade_a_capacity);
+            continue;
+        }
+
+        StreamDecoder* sd = &player.stream_decoder;
+        int64_t loop_start, loop_end;
+        bool looping = loop_bounds(sd, &loop_start, &loop_end);
+
+        // Start crossfading once the current track is within the fade window
+        int crossfade_ms = player.crossfade_ms;
+        if (crossfade_ms > 0 && !bit_perfect && !looping &&
+            __atomic_load_n(&player.next_state, __ATOMIC_ACQUIRE) == NEXT_TRACK_READY) {
+            size_t remaining = stream_remaining_output_frames(&player.stream_decoder);
+            size_t window = (size_t)crossfade_ms * current_sample_rate / 1000;
+            if (remaining > 0 && remaining <= window && stream_begin_crossfade(&fade, remaining)) {
+                precise_pending = false;    // The position counter belongs to the next track now
+                continue;
+            }
+        }
+
+        // Decode a chunk (or write the head of the loop spliced in)
+        stream_stretch_update();
+        bool replayed = loop.replaying;
+        size_t decoded = replayed ? loop_head_replay(&loop, sd, decode_buffer, DECODE_CHUNK_FRAMES, frame_bytes)
+                                  : stream_decoder_read_pcm(sd, decode_buffer, DECODE_CHUNK_FRAMES);
+        int64_t chunk_start = sd->current_frame - (int64_t)decoded;
+        bool splice = false;
+        if (looping && decoded > 0) {
+            // Cut the chunk at the loop end, the loop start follows
+            if (chunk_start < loop_end && sd->current_frame >= loop_end) {
+                decoded = (size_t)(loop_end - chunk_start);
+                splice = true;
+            }
+            if (!replayed) {
+                loop_head_capture(&loop, loop_start, loop_end, chunk_start, decode_buffer, decoded,
+                                  frame_bytes, sd->source_sample_rate);
+            }
+        }
+
+        if (decoded == 0 && looping &&
+            (loop_interrupted() || loop_splice(&loop, sd, loop_start) || loop_interrupted())) {
+            continue;   // Looped at the end of the file (or the stop or seek is taken first)
+        } else if (decoded == 0) {
+            // End of current track: continue with the queued next track if ready
+            NextTrackState next = __atomic_load_n(&player.next_state, __ATOMIC_ACQUIRE);
+            if (next == NEXT_TRACK_READY && stream_switch_to_next()) {
+                precise_pending = false;
+                // The loop belonged to the old track (the UI sets the new one's)
+                __atomic_store_n(&player.loop_start_ms, -1, __ATOMIC_RELEASE);
+                loop.start = -1;
+                continue;
+            }
+            if (next != NEXT_TRACK_OPENING) {
+                // Decoder has reached end of file: what the speed stage holds is the last of it
+                if (stream_stretching()) stream_write_stretched(NULL, 0, true);
+                __atomic_store_n(&player.stream_eof, true, __ATOMIC_RELEASE);
+            }
+            // Next track still opening (or nothing to do), wait for it or a seek
+            stream_wait();
+        } else {
+            // Resample chunk to target rate if needed (a loop carries the filter over the joint)
+            int src_rate = sd->source_sample_rate;
+            int dst_rate = current_sample_rate;
+            bool is_last = !looping && sd->current_frame >= sd->total_frames;
+            stream_stamp(chunk_start, src_rate);
+
+            size_t output_frames;
+            if (src_rate == dst_rate) {
+                // No resampling needed
+                output_frames = decoded;
+                stream_write_output(decode_buffer, output_frames);
+            } else {
+                // Resample
+                output_frames = resample_chunk_pcm(decode_buffer, decoded,
+                                                   src_rate, dst_rate,
+                                                   resample_buffer, resample_buffer_size,
+                                                   (Resampler*)player.resampler, is_last);
+                stream_write_output(resample_buffer, output_frames);
+            }
+            if (splice && !loop_interrupted() && !loop_splice(&loop, sd, loop_start) && !loop_interrupted()) {
+                // Can't go back: the rest of the track plays on
+                __atomic_store_n(&player.loop_start_ms, -1, __ATOMIC_RELEASE);
+            }
+        }
+    }
+
+    if (fade.active) {
+        stream_end_crossfade(&fade);
+    }
+    __atomic_store_n(&player.stream_refilling, false, __ATOMIC_RELAXED);
+
+    stream_stretch_free();
+    free(loop.pcm);
+    free(decode_buffer);
+    free(resample_buffer);
+    return NULL;
+}
+
+// ============ END STREAMING PLAYBACK SYSTEM ============
+
+// Telemetry helpers (audio callback only)
+static inline void stats_add32(uint32_t* counter, uint32_t n) {
+    __atomic_add_fetch(counter, n, __ATOMIC_RELAXED);
+}
+
+// Apply a pending reset, count the callback and measure its interval against the
+// device period implied by len
+static void stats_begin_callback(int len) {
+    PlaybackStats* st = &playback_stats;
+    uint64_t now = monotonic_us();
+
+    if (__atomic_load_n(&st->reset_pending, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&st->callbacks, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->underruns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->silence_frames, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->trylock_misses, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->fill_samples, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->fill_sum_frames, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->fill_min_frames, SIZE_MAX, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->intervals, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->interval_sum_us, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&st->jitter_max_us, 0, __ATOMIC_RELAXED);
+        st->last_callback_us = 0;
+        __atomic_store_n(&st->reset_pending, false, __ATOMIC_RELEASE);
+    }
+
+    stats_add32(&st->callbacks, 1);
+
+    // Skip the first callback after a pause or device reopen
+    uint64_t interval = now - st->last_callback_us;
+    if (st->last_callback_us != 0 && interval < 1000000) {
+        size_t device_frame_bytes = (device_format == AUDIO_S32SYS ? sizeof(int32_t) : sizeof(int16_t)) *
+                                    AUDIO_CHANNELS;
+        uint64_t expected = (uint64_t)(len / device_frame_bytes) * 1000000 / current_sample_rate;
+        uint32_t jitter = (uint32_t)(interval > expected ? interval - expected : expected - interval);
+        stats_add32(&st->intervals, 1);
+        __atomic_add_fetch(&st->interval_sum_us, interval, __ATOMIC_RELAXED);
+        if (jitter > st->jitter_max_us) {
+            __atomic_store_n(&st->jitter_max_us, jitter, __ATOMIC_RELAXED);
+        }
+    }
+    st->last_callback_us = now;
+}
+
+// Record the stream buffer fill and any shortfall for one streaming callback
+static void stats_record_stream(size_t available, size_t missing, bool track_ending) {
+    PlaybackStats* st = &playback_stats;
+    stats_add32(&st->fill_samples, 1);
+    __atomic_add_fetch(&st->fill_sum_frames, (uint64_t)available, __ATOMIC_RELAXED);
+    if (available < st->fill_min_frames) {
+        __atomic_store_n(&st->fill_min_frames, available, __ATOMIC_RELAXED);
+    }
+    // Running dry at the end of a track is expected, anywhere else it's audible
+    if (missing > 0 && !track_ending) {
+        stats_add32(&st->underruns, 1);
+        __atomic_add_fetch(&st->silence_frames, (uint64_t)missing, __ATOMIC_RELAXED);
+    }
+}
+
+// Audio callback - SDL pulls audio data from here
+static void audio_callback(void* userdata, Uint8* stream, int len) {
+    // SDL creates a new audio thread for every device open, tune each one on first use
+    static __thread bool role_applied = false;
+    if (!role_applied) {
+        ThreadRole_apply(THREAD_ROLE_AUDIO);
+        role_applied = true;
+    }
+    stats_begin_callback(len);
+
+    PlayerContext* ctx = (PlayerContext*)userdata;
+    int samples_needed = len / (sizeof(int16_t) * AUDIO_CHANNELS);
+    int16_t* out = (int16_t*)stream;
+    bool bit_perfect = ctx->stream_format == PCM_FORMAT_S32;
+
+    // Check if radio is active - handle radio audio separately
+    if (Radio_isActive()) {
+        // Only get audio when radio is actually playing (not buffering)
+        if (Radio_getState() == RADIO_STATE_PLAYING) {
+            // Get audio from radio module
+            int samples_got = Radio_getAudioSamples(out, samples_needed * AUDIO_CHANNELS);
+
+            // If we got less than needed, fill rest with silence
+            if (samples_got < samples_needed * AUDIO_CHANNELS) {
+                memset(&out[samples_got], 0, (samples_needed * AUDIO_CHANNELS - samples_got) * sizeof(int16_t));
+            }
+
+            // Apply volume with logarithmic curve for natural perceived loudness
+            apply_gain_q15(out, samples_needed, __atomic_load_n(&target_gain_q15, __ATOMIC_RELAXED));
+            Spectrum_feed(out, samples_needed, current_sample_rate);
+            if (samples_got > 0) LATENCY_AUDIO_OUT();
+        } else {
+            // Still buffering - output silence
+            memset(stream, 0, len);
+        }
+
+        return;
+    }
+
+    // Try to lock, if can't, output silence (non-blocking to prevent crackling)
+    if (pthread_mutex_trylock(&ctx->mutex) != 0) {
+        stats_add32(&playback_stats.trylock_misses, 1);
+        memset(stream, 0, len);
+        return;
+    }
+
+    if (ctx->state != PLAYER_STATE_PLAYING) {
+        memset(stream, 0, len);
+        pthread_mutex_unlock(&ctx->mutex);
+        return;
+    }
+
+    // ============ STREAMING MODE ============
+    if (ctx->use_streaming) {
+        // Read from circular buffer (float streams get volume and int16 conversion here)
+        bool float_stream = ctx->stream_format == PCM_FORMAT_F32;
+        size_t frame_bytes = bit_perfect ? ctx->stream_buffer.frame_bytes : sizeof(int16_t) * AUDIO_CHANNELS;
+        samples_needed = len / frame_bytes;
+        size_t samples_read;
+        if (float_stream) {
+            samples_read = circular_buffer_read_float_s16(&ctx->stream_buffer, out, samples_needed);
+        } else {
+            samples_read = circular_buffer_read(&ctx->stream_buffer, stream, samples_needed);
+        }
+        size_t available = circular_buffer_available(&ctx->stream_buffer);
+        if (available < stream_low_watermark()) {
+            stream_wake_from_callback();
+        }
+        stats_record_stream(available, samples_needed - samples_read,
+                            __atomic_load_n(&ctx->stream_eof, __ATOMIC_ACQUIRE) ||
+                            ctx->stream_decoder.current_frame >= ctx->stream_decoder.total_frames);
+
+        // If not enough data, fill rest with silence
+        if (samples_read < (size_t)samples_needed) {
+            memset(&stream[samples_read * frame_bytes], 0,
+                   (samples_needed - samples_read) * frame_bytes);
+        }
+
+        // Apply volume with logarithmic curve for natural perceived loudness
+        // (bit-perfect output is left untouched, the DAC's own volume applies)
+        if (!bit_perfect && !float_stream) {
+            apply_gain_q15(out, samples_read, stream_target_gain_q15());
+        }
+
+        // Visualizer tap (after volume, like what is heard)
+        if (samples_read > 0) {
+            LATENCY_AUDIO_OUT();
+            if (bit_perfect) {
+                Spectrum_feedS32((const int32_t*)stream, samples_read, current_sample_rate);
+            } else {
+                Spectrum_feed(out, samples_read, current_sample_rate);
+            }
+        }
+
+        // Update position
+        audio_position_samples += samples_read;
+
+        // Gapless: restart position once playback crosses into the next track
+        if (__atomic_load_n(&ctx->next_state, __ATOMIC_ACQUIRE) == NEXT_TRACK_SWITCHED) {
+            size_t read_pos = circular_buffer_read_position(&ctx->stream_buffer);
+            if (read_pos >= ctx->next_boundary) {
+                audio_position_samples = read_pos - ctx->next_boundary;
+                __atomic_store_n(&track_norm_q15, __atomic_load_n(&next_norm_q15, __ATOMIC_RELAXED),
+                                 __ATOMIC_RELAXED);
+                __atomic_store_n(&ctx->next_state, NEXT_TRACK_NONE, __ATOMIC_RELAXED);
+                __atomic_store_n(&ctx->track_changed, true, __ATOMIC_RELEASE);
+            }
+        }
+
+        // Where the output actually is, from the block stamps (the counter until the first)
+        int64_t time_us;
+        if (samples_read > 0 && stream_clock_at(circular_buffer_read_position(&ctx->stream_buffer), &time_us)) {
+            audio_position_samples = time_us * current_sample_rate / 1000000;
+        }
+        set_position_ms((int)((audio_position_samples * 1000) / current_sample_rate));
+
+        // Check if track ended (decoder reached EOF or frame count)
+        if ((ctx->stream_decoder.current_frame >= ctx->stream_decoder.total_frames ||
+             __atomic_load_n(&ctx->stream_eof, __ATOMIC_ACQUIRE)) &&
+            circular_buffer_available(&ctx->stream_buffer) == 0) {
+            // (Loops never get here, the decode thread splices them: see LoopHead)
+            ctx->state = PLAYER_STATE_STOPPED;
+            audio_position_samples = 0;
+            set_position_ms(0);
+        }
+
+        pthread_mutex_unlock(&ctx->mutex);
+        return;
+    }
+
+    // No audio loaded - output silence
+    memset(stream, 0, len);
+    pthread_mutex_unlock(&ctx->mutex);
+}
+
+// Carry the player settings file of before the settings store over into it
+static void load_legacy_player_settings(void) {
+    FILE* f = fopen(PLAYER_SETTINGS_FILE, "r");
+    if (!f) return;
+
+    static const SettingKey keys[] = {
+        SETTING_CROSSFADE, SETTING_NATIVE_RATE, SETTING_BIT_PERFECT,
+        SETTING_FLOAT_PIPELINE, SETTING_EQ_PRESET, SETTING_NORMALIZE
+    };
+    int value;
+    for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]) && fscanf(f, "%d\n", &value) == 1; i++) {
+        Settings_setInt(keys[i], value);
+    }
+    fclose(f);
+}
+
+// Load player settings from the settings store
+static void load_player_settings(void) {
+    if (!Settings_has(SETTING_CROSSFADE)) load_legacy_player_settings();
+
+    int crossfade = Settings_getInt(SETTING_CROSSFADE, 0);
+    if (crossfade >= 0 && crossfade <= PLAYER_CROSSFADE_MAX_SECONDS) {
+        player.crossfade_ms = crossfade * 1000;
+    }
+    player.native_rate = Settings_getBool(SETTING_NATIVE_RATE, player.native_rate);
+    player.bit_perfect = Settings_getBool(SETTING_BIT_PERFECT, player.bit_perfect);
+    player.float_pipeline = Settings_getBool(SETTING_FLOAT_PIPELINE, player.float_pipeline);
+    Equalizer_setPreset(Settings_getInt(SETTING_EQ_PRESET, EQ_PRESET_FLAT));
+    player.normalize = Settings_getBool(SETTING_NORMALIZE, player.normalize);
+    int speed = Settings_getInt(SETTING_SPEED, 100);
+    if (speed >= PLAYER_SPEED_MIN && speed <= PLAYER_SPEED_MAX) player.speed_percent = speed;
+}
+
+// Whether ~/.asoundrc routes the default device through BlueALSA
+static bool asoundrc_uses_bluealsa(void) {
+    const char* home = getenv("HOME");
+    if (!home) return false;
+
+    char asoundrc_path[512];
+    snprintf(asoundrc_path, sizeof(asoundrc_path), "%s/.asoundrc", home);
+    FILE* f = fopen(asoundrc_path, "r");
+    if (!f) return false;
+
+    bool found = false;
+    char buf[256];
+    while (fgets(buf, sizeof(buf), f)) {
+        if (strstr(buf, "bluealsa")) {
+            found = true;
+            break;
+        }
+    }
+    fclose(f);
+    return found;
+}
+
+// Set every A2DP volume control of the default mixer (BlueALSA's) to its maximum,
+// volume is applied in software. Handles names like "Galaxy Buds Live (4B23 A2DP".
+static void bluealsa_mixer_max(void) {
+    snd_mixer_t* mixer = NULL;
+    if (snd_mixer_open(&mixer, 0) < 0) return;
+    if (snd_mixer_attach(mixer, "default") < 0 || snd_mixer_selem_register(mixer, NULL, NULL) < 0 ||
+        snd_mixer_load(mixer) < 0) {
+        snd_mixer_close(mixer);
+        return;
+    }
+
+    for (snd_mixer_elem_t* elem = snd_mixer_first_elem(mixer); elem; elem = snd_mixer_elem_next(elem)) {
+        const char* name = snd_mixer_selem_get_name(elem);
+        if (!name || !strstr(name, "A2DP") || !snd_mixer_selem_has_playback_volume(elem)) continue;
+        long min = 0, max = 0;
+        if (snd_mixer_selem_get_playback_volume_range(elem, &min, &max) == 0) {
+            snd_mixer_selem_set_playback_volume_all(elem, max);
+        }
+    }
+    snd_mixer_close(mixer);
+}
+
+int Player_init(void) {
+    memset(&player, 0, sizeof(PlayerContext));
+    player.seek_preview_ms = -1;
+    player.ab_start_ms = -1;
+    player.loop_start_ms = -1;
+
+    pthread_mutex_init(&player.mutex, NULL);
+    pthread_mutex_init(&player.stream_wake_mutex, NULL);
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);  // Waits immune to clock changes
+    pthread_cond_init(&player.stream_wake_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    player.volume = 1.0f;
+    target_gain_q15 = GAIN_UNITY_Q15;
+    current_gain_q15 = GAIN_UNITY_Q15;
+    player.state = PLAYER_STATE_STOPPED;
+    publish_snapshot();
+    player.native_rate = true;
+    player.normalize = true;
+    player.speed_percent = 100;
+    load_player_settings();
+
+    // Initialize SDL audio
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+        LOG_error("Failed to init SDL audio: %s\n", SDL_GetError());
+        return -1;
+    }
+
+    // Check current audio sink setting
+    int audio_sink = GetAudioSink();
+
+    // Also check if .asoundrc exists with bluealsa config (more reliable than msettings)
+    if (asoundrc_uses_bluealsa()) {
+        audio_sink = AUDIO_SINK_BLUETOOTH;
+        bluetooth_audio_active = true;
+    }
+
+    // If Bluetooth audio is detected, set BlueALSA mixer to 100% for software volume control
+    if (audio_sink == AUDIO_SINK_BLUETOOTH) {
+        bluealsa_mixer_max();
+    }
+    apply_audio_profile();
+
+    // Determine target sample rate based on audio output
+    int target_rate = get_target_sample_rate();
+
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = target_rate;
+    want.format = device_format;
+    want.channels = AUDIO_CHANNELS;
+    want.samples = audio_buffer_samples;
+    want.callback = audio_callback;
+    want.userdata = &player;
+
+    // Open default audio device - respects .asoundrc for Bluetooth/USB DAC routing
+    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+
+    if (player.audio_device == 0) {
+        LOG_error("Failed to open audio device: %s\n", SDL_GetError());
+
+        // If Bluetooth was detected but device isn't available, fall back to speaker
+        if (bluetooth_audio_active) {
             bluetooth_audio_active = false;
 
-            // Retry with speaker sample rate and explicit device name to bypass .asoundrc
-            want.freq = SAMPLE_RATE_SPEAKER;
+            // Retry with speaker sample rate and explicit device name to bypass .asoundrc
+            want.freq = SAMPLE_RATE_SPEAKER;
+
+            // Try to open the first available audio device explicitly
+            int num_devices = SDL_GetNumAudioDevices(0);
+            for (int i = 0; i < num_devices; i++) {
+                const char* device_name = SDL_GetAudioDeviceName(i, 0);
+                player.audio_device = SDL_OpenAudioDevice(device_name, 0, &want, &have, 0);
+                if (player.audio_device != 0) {
+                    break;
+                }
+            }
+
+            if (player.audio_device == 0) {
+                LOG_error("All fallback audio devices failed\n");
+                return -1;
+            }
+        } else {
+            return -1;
+        }
+    }
+
+    set_output_latency(&have);
+    player.audio_initialized = true;
+
+    // Register for audio device changes (Bluetooth, USB DAC, etc.)
+    PLAT_audioDeviceWatchRegister(audio_device_change_callback);
+
+    return 0;
+}
+
+// Reconfigure audio device with a new sample rate
+static int reconfigure_audio_device(int new_sample_rate) {
+    if (new_sample_rate == current_sample_rate && device_format == AUDIO_S16SYS &&
+        player.audio_device > 0) {
+        return 0;  // No change needed
+    }
+    device_format = AUDIO_S16SYS;
+
+    // Pause and close existing device
+    if (player.audio_device > 0) {
+        SDL_PauseAudioDevice(player.audio_device, 1);
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+    }
+
+    // Open with new sample rate
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = new_sample_rate;
+    want.format = device_format;
+    want.channels = AUDIO_CHANNELS;
+    want.samples = audio_buffer_samples;
+    want.callback = audio_callback;
+    want.userdata = &player;
+
+    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (player.audio_device == 0) {
+        LOG_error("Failed to open audio device at %d Hz: %s\n", new_sample_rate, SDL_GetError());
+        // Try to reopen at target rate for current audio sink
+        int fallback_rate = get_target_sample_rate();
+        want.freq = fallback_rate;
+        player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+        if (player.audio_device == 0) {
+            return -1;
+        }
+    }
+
+    current_sample_rate = have.freq;
+    set_output_latency(&have);
+    return 0;
+}
+
+// Open the device at exactly the requested rate, without SDL converting behind our back
+// Returns -1 (device closed) if the sink doesn't accept the rate
+static int open_audio_device_exact(int sample_rate) {
+    device_format = AUDIO_S16SYS;
+    if (player.audio_device > 0) {
+        SDL_PauseAudioDevice(player.audio_device, 1);
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+    }
+
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = sample_rate;
+    want.format = device_format;
+    want.channels = AUDIO_CHANNELS;
+    want.samples = audio_buffer_samples;
+    want.callback = audio_callback;
+    want.userdata = &player;
+
+    // Let the sink report its own rate instead of SDL resampling internally
+    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (player.audio_device == 0) {
+        return -1;
+    }
+    if (have.freq != sample_rate) {
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+        return -1;
+    }
+
+    current_sample_rate = have.freq;
+    set_output_latency(&have);
+    return 0;
+}
+
+// Pick the device rate for a track: its native rate if the sink takes it (saves the
+// resampler entirely), otherwise the fixed rate for the current sink
+static void negotiate_output_rate(int source_rate) {
+    int target_rate = get_target_sample_rate();
+
+    // Bluetooth A2DP stays at its fixed rate
+    if (player.native_rate && !bluetooth_audio_active && source_rate > 0 && source_rate != target_rate) {
+        if (source_rate == current_sample_rate && device_format == AUDIO_S16SYS &&
+            player.audio_device > 0) {
+            return;  // Already there
+        }
+        if (open_audio_device_exact(source_rate) == 0) {
+            return;
+        }
+        // Sink rejected the rate, fall through to resampling
+    }
+
+    reconfigure_audio_device(target_rate);
+}
+
+// Open the device as 32-bit at exactly the track's rate for bit-perfect USB DAC output
+// Returns -1 (device closed) if the DAC doesn't take the format or rate as-is
+static int open_audio_device_bit_perfect(int sample_rate) {
+    if (player.audio_device > 0) {
+        SDL_PauseAudioDevice(player.audio_device, 1);
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+    }
+
+    device_format = AUDIO_S32SYS;
+
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = sample_rate;
+    want.format = device_format;
+    want.channels = AUDIO_CHANNELS;
+    want.samples = audio_buffer_samples;
+    want.callback = audio_callback;
+    want.userdata = &player;
+
+    // Any conversion by SDL would defeat the point, so accept only an exact match
+    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have,
+                                              SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE);
+    if (player.audio_device == 0) {
+        device_format = AUDIO_S16SYS;
+        return -1;
+    }
+    if (have.freq != sample_rate || have.format != AUDIO_S32SYS) {
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+        device_format = AUDIO_S16SYS;
+        return -1;
+    }
+
+    current_sample_rate = have.freq;
+    set_output_latency(&have);
+    return 0;
+}
+
+#define SINK_SWITCH_WAIT_MS 500   // Longest the device stays paused for audio at the new rate
+
+// Reopen audio device (called when audio sink changes, e.g., Bluetooth connect/disconnect)
+// Buffered audio carries over when the new sink runs at the same rate. Otherwise it is
+// PCM at the old rate: the device stays paused while the decode thread drops it and
+// decodes again from the frame last played, resampled for the new rate.
+static void reopen_audio_device(void) {
+    // Remember current playback state
+    PlayerState prev_state = player.state;
+    int old_rate = current_sample_rate;
+
+    // Pause and close existing device
+    if (player.audio_device > 0) {
+        SDL_PauseAudioDevice(player.audio_device, 1);
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+    }
+
+    // Get target sample rate for the new audio sink
+    // A bit-perfect stream keeps its format and rate, SDL converts if the new sink can't take them
+    int target_rate = (device_format == AUDIO_S32SYS) ? current_sample_rate : get_target_sample_rate();
+
+    // Reopen with target sample rate
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = target_rate;
+    want.format = device_format;
+    want.channels = AUDIO_CHANNELS;
+    want.samples = audio_buffer_samples;
+    want.callback = audio_callback;
+    want.userdata = &player;
+
+    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (player.audio_device == 0) {
+        LOG_error("Failed to reopen audio device: %s\n", SDL_GetError());
+        return;
+    }
+
+    current_sample_rate = have.freq;
+    set_output_latency(&have);
+
+    // The new profile's watermarks take over right away
+    if (player.use_streaming) stream_plan_update();
+
+    if (player.use_streaming && current_sample_rate != old_rate) {
+        // The callback is stopped, so the position is the frame the switch happens at
+        pthread_mutex_lock(&player.mutex);
+        audio_position_samples = (int64_t)player.position_ms * current_sample_rate / 1000;
+        stream_post(STREAM_CMD_RATE, current_sample_rate);
+        uint32_t request = stream_post(STREAM_CMD_SEEK,
+                                       (int64_t)player.position_ms * player.stream_decoder.source_sample_rate / 1000);
+        stream_wake();
+        pthread_mutex_unlock(&player.mutex);
+
+        size_t resume_frames = (size_t)STREAM_PREBUFFER_MS * current_sample_rate / 1000;
+        for (int waited = 0; waited < SINK_SWITCH_WAIT_MS; waited += 2) {
+            if (stream_command_done(STREAM_CMD_SEEK, request) &&
+                circular_buffer_available(&player.stream_buffer) >= resume_frames) {
+                break;
+            }
+            usleep(2000);
+        }
+    }
+
+    // Resume playback if it was playing
+    if (prev_state == PLAYER_STATE_PLAYING) {
+        SDL_PauseAudioDevice(player.audio_device, 0);
+    }
+}
+
+// Change the device buffer size, reopening the device at the current rate
+static void set_audio_buffer_samples(int samples) {
+    if (samples == audio_buffer_samples) return;
+    audio_buffer_samples = samples;
+    if (player.audio_device <= 0) return;
+
+    bool was_playing = SDL_GetAudioDeviceStatus(player.audio_device) == SDL_AUDIO_PLAYING;
+    SDL_PauseAudioDevice(player.audio_device, 1);
+    SDL_CloseAudioDevice(player.audio_device);
+
+    SDL_AudioSpec want, have;
+    SDL_zero(want);
+    want.freq = current_sample_rate;
+    want.format = device_format;
+    want.channels = AUDIO_CHANNELS;
+    want.samples = audio_buffer_samples;
+    want.callback = audio_callback;
+    want.userdata = &player;
+
+    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+    if (player.audio_device == 0) {
+        LOG_error("Failed to reopen audio device with %d samples: %s\n", samples, SDL_GetError());
+        return;
+    }
+    current_sample_rate = have.freq;
+    set_output_latency(&have);
+
+    if (was_playing) {
+        SDL_PauseAudioDevice(player.audio_device, 0);
+    }
+}
+
+// Callback for audio device changes (Bluetooth connect/disconnect, USB DAC, etc.)
+static void audio_device_change_callback(int device_type, int event) {
+    (void)device_type;
+    (void)event;
+
+    // Re-check if Bluetooth is now active/inactive
+    bool was_bluetooth = bluetooth_audio_active;
+    bluetooth_audio_active = asoundrc_uses_bluealsa();
+
+    // If Bluetooth just activated, set mixer to 100%
+    if (!was_bluetooth && bluetooth_audio_active) {
+        bluealsa_mixer_max();
+    }
+    apply_audio_profile();
+
+    reopen_audio_device();
+}
+
+void Player_quit(void) {
+    // Unregister audio device watcher
+    PLAT_audioDeviceWatchUnregister();
+
+    Player_stop();
+
+    // Load threads and album art jobs are detached and cancelled by Player_stop,
+    // give them a moment to notice before the mutex goes away
+    for (int i = 0; i < 200 && __atomic_load_n(&player.load_workers, __ATOMIC_ACQUIRE) > 0; i++) {
+        usleep(10000);  // 10ms, 2 seconds max
+    }
+
+    if (player.audio_device > 0) {
+        SDL_CloseAudioDevice(player.audio_device);
+        player.audio_device = 0;
+    }
 
-            // Try to open the first available audio device explicitly
-            int num_devices = SDL_GetNumAudioDevices(0);
-            for (int i = 0; i < num_devices; i++) {
-                const char* device_name = SDL_GetAudioDeviceName(i, 0);
-                player.audio_device = SDL_OpenAudioDevice(device_name, 0, &want, &have, 0);
-                if (player.audio_device != 0) {
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+
+    // Prefetched decoders go back to the pool before it's drained
+    prefetch_shutdown();
+    loudness_shutdown();
+    decoder_pool_drain();
+    ReadAhead_quit();
+
+    // A worker stuck on the network still references the mutex, leave it to process exit
+    if (__atomic_load_n(&player.load_workers, __ATOMIC_ACQUIRE) == 0) {
+        pthread_mutex_destroy(&player.mutex);
+    }
+    pthread_cond_destroy(&player.stream_wake_cond);
+    pthread_mutex_destroy(&player.stream_wake_mutex);
+
+    player.audio_initialized = false;
+}
+
+// ============ WAVEFORM OVERVIEW ============
+
+// Waveform overview is built by an idle-priority job with its own decoder instance.
+// Instead of decoding the whole file it seeks to each bar and takes the peak of a
+// short window, so only a small fraction of the audio is ever decoded (MP3 seeks go
+// through the seek index bound at open). Results are cached in $HOME/.cache/waveform.
+
+#define WAVEFORM_WINDOW_FRAMES 4096   // Frames decoded per bar
+#define WAVEFORM_CACHE_MAGIC 0x31465757  // "WWF1"
+
+typedef struct {
+    char filepath[512];
+    WaveformData result;
+} WaveformJob;
+
+static JobToken* waveform_token = NULL;     // Job of the current track (main thread)
+
+// Load cached waveform if it matches the file's current mtime and size
+static bool load_waveform_cache(const char* filepath, WaveformData* out) {
+    FileCacheHeader hdr;
+    FILE* f = file_cache_open("waveform", "wf", filepath, WAVEFORM_CACHE_MAGIC, &hdr);
+    if (!f) return false;
+
+    bool ok = hdr.count == WAVEFORM_BARS && fread(out->bars, sizeof(out->bars), 1, f) == 1;
+    fclose(f);
+    if (!ok) return false;
+
+    out->bar_count = WAVEFORM_BARS;
+    out->valid = true;
+    return true;
+}
+
+static void save_waveform_cache(const char* filepath, const WaveformData* data) {
+    FileCacheHeader hdr;
+    if (!file_cache_header_init(&hdr, filepath, WAVEFORM_CACHE_MAGIC, WAVEFORM_BARS)) return;
+    file_cache_write("waveform", "wf", filepath, &hdr, data->bars, sizeof(data->bars));
+}
+
+// Overview of a file, a window decoded per bar; false if cancelled or unreadable
+static bool waveform_compute(const char* filepath, const JobToken* token, WaveformData* out) {
+    StreamDecoder sd;
+    if (stream_decoder_open(&sd, filepath) != 0) return false;
+
+    // A file still downloading has no overview yet
+    int16_t* window = malloc(WAVEFORM_WINDOW_FRAMES * sizeof(int16_t) * AUDIO_CHANNELS);
+    if (!window || sd.total_frames <= 0 || sd.source) {
+        free(window);
+        stream_decoder_close(&sd);
+        return false;
+    }
+
+    WaveformData result;
+    memset(&result, 0, sizeof(result));
+    float max_peak = 0.0f;
+    int bar;
+
+    for (bar = 0; bar < WAVEFORM_BARS && !Jobs_cancelled(token); bar++) {
+        int64_t start = sd.total_frames * bar / WAVEFORM_BARS;
+        if (bar > 0 && stream_decoder_seek(&sd, start) != 0) break;
+
+        size_t got = stream_decoder_read(&sd, window, WAVEFORM_WINDOW_FRAMES);
+        int peak = 0;
+        for (size_t i = 0; i < got * AUDIO_CHANNELS; i++) {
+            int v = window[i] < 0 ? -window[i] : window[i];
+            if (v > peak) peak = v;
+        }
+        result.bars[bar] = peak / 32768.0f;
+        if (result.bars[bar] > max_peak) max_peak = result.bars[bar];
+    }
+
+    free(window);
+    stream_decoder_close(&sd);
+
+    if (bar < WAVEFORM_BARS) return false;
+
+    // Normalize so the loudest bar fills the display
+    if (max_peak > 0.0f) {
+        for (int i = 0; i < WAVEFORM_BARS; i++) {
+            result.bars[i] /= max_peak;
+        }
+    }
+    result.bar_count = WAVEFORM_BARS;
+    result.valid = true;
+    *out = result;
+    return true;
+}
+
+static void waveform_job(void* arg, JobToken* token) {
+    WaveformJob* job = (WaveformJob*)arg;
+    WaveformData result;
+    if (!waveform_compute(job->filepath, token, &result)) return;
+    save_waveform_cache(job->filepath, &result);
+    job->result = result;
+}
+
+// Main thread: the overview lands unless the track changed since (job cancelled)
+static void waveform_job_done(void* arg, bool cancelled) {
+    WaveformJob* job = (WaveformJob*)arg;
+    if (!cancelled && job->result.valid) {
+        pthread_mutex_lock(&player.mutex);
+        waveform = job->result;
+        pthread_mutex_unlock(&player.mutex);
+    }
+    free(job);
+}
+
+// Cancel the waveform job (must be called before clearing waveform): its result
+// is dropped even if it already finished
+static void waveform_stop(void) {
+    if (waveform_token) {
+        Jobs_cancel(waveform_token);
+        Jobs_release(waveform_token);
+        waveform_token = NULL;
+    }
+}
+
+static bool waveform_deferred = false;  // Track changed with the screen off
+
+// Show cached waveform right away, or start the background worker for it
+static void waveform_start(const char* filepath) {
+    waveform_stop();
+
+    WaveformData cached;
+    memset(&cached, 0, sizeof(cached));
+    if (load_waveform_cache(filepath, &cached)) {
+        pthread_mutex_lock(&player.mutex);
+        waveform = cached;
+        pthread_mutex_unlock(&player.mutex);
+        return;
+    }
+
+    WaveformJob* job = calloc(1, sizeof(WaveformJob));
+    if (!job) return;
+    snprintf(job->filepath, sizeof(job->filepath), "%s", filepath);
+    waveform_token = Jobs_submit(JOB_PRIORITY_IDLE, waveform_job, waveform_job_done, job);
+    if (!waveform_token) free(job);
+}
+
+// The overview is only drawn: with the screen off it waits until it is back on
+static void waveform_request(const char* filepath) {
+    if (__atomic_load_n(&player.power_save, __ATOMIC_RELAXED)) {
+        waveform_stop();
+        waveform_deferred = true;
+        return;
+    }
+    waveform_deferred = false;
+    waveform_start(filepath);
+}
+
+// ============ LOUDNESS SCAN ============
+
+// Untagged files get an EBU R128 integrated loudness measurement (BS.1770 K-weighting,
+// 400 ms blocks every 100 ms, absolute and relative gating) from idle-priority jobs
+// that decode the whole file with their own decoder. Results are cached in
+// $HOME/.cache/loudness as the gain to the ReplayGain 2.0 reference, so playback only
+// looks the gain up. A measurement finishing mid-track applies from the next play.
+
+#define LOUDNESS_CACHE_MAGIC 0x3144554C  // "LUD1"
+#define LOUDNESS_REFERENCE_LUFS -18.0f   // ReplayGain 2.0 reference level
+#define LOUDNESS_CHUNK_FRAMES 4096
+#define LOUDNESS_ABSOLUTE_GATE -70.0     // LUFS
+#define LOUDNESS_RELATIVE_GATE -10.0     // LU below the absolute-gated loudness
+
+static pthread_mutex_t loudness_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loudness_cond = PTHREAD_COND_INITIALIZER;
+static bool loudness_job_queued = false;     // A scan job is queued or running (loudness_mutex)
+static bool loudness_job_running = false;
+static bool loudness_quit = false;           // Atomic, checked between chunks
+static char** loudness_queue = NULL;         // Pending files, front first (loudness_mutex)
+static int loudness_queue_count = 0;
+
+static void metadata_init(TrackMetadata* meta, const char* filepath);
+static void parse_embedded_metadata(const char* filepath, TrackMetadata* meta);
+
+static bool load_loudness_cache(const char* filepath, float* gain_db) {
+    FileCacheHeader hdr;
+    FILE* f = file_cache_open("loudness", "lud", filepath, LOUDNESS_CACHE_MAGIC, &hdr);
+    if (!f) return false;
+
+    bool ok = hdr.count == 1 && fread(gain_db, sizeof(*gain_db), 1, f) == 1;
+    fclose(f);
+    return ok;
+}
+
+static void save_loudness_cache(const char* filepath, float gain_db) {
+    FileCacheHeader hdr;
+    if (!file_cache_header_init(&hdr, filepath, LOUDNESS_CACHE_MAGIC, 1)) return;
+    file_cache_write("loudness", "lud", filepath, &hdr, &gain_db, sizeof(gain_db));
+}
+
+// BS.1770 K-weighting: high shelf (head effects) then high pass (RLB), per channel
+typedef struct {
+    double b[2][3], a[2][3];
+    double z[AUDIO_CHANNELS][2][2];
+} KWeighting;
+
+static void k_weighting_init(KWeighting* kw, int sample_rate) {
+    memset(kw, 0, sizeof(*kw));
+
+    // Coefficients for any rate from the filter's analog prototype (as in libebur128)
+    double f0 = 1681.974450955533, gain = 3.999843853973347, q = 0.7071752369554196;
+    double k = tan(M_PI * f0 / sample_rate);
+    double vh = pow(10.0, gain / 20.0);
+    double vb = pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    kw->b[0][0] = (vh + vb * k / q + k * k) / a0;
+    kw->b[0][1] = 2.0 * (k * k - vh) / a0;
+    kw->b[0][2] = (vh - vb * k / q + k * k) / a0;
+    kw->a[0][1] = 2.0 * (k * k - 1.0) / a0;
+    kw->a[0][2] = (1.0 - k / q + k * k) / a0;
+
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = tan(M_PI * f0 / sample_rate);
+    a0 = 1.0 + k / q + k * k;
+    kw->b[1][0] = 1.0;
+    kw->b[1][1] = -2.0;
+    kw->b[1][2] = 1.0;
+    kw->a[1][1] = 2.0 * (k * k - 1.0) / a0;
+    kw->a[1][2] = (1.0 - k / q + k * k) / a0;
+}
+
+static inline double k_weighting_run(KWeighting* kw, int channel, double x) {
+    for (int s = 0; s < 2; s++) {
+        double* z = kw->z[channel][s];
+        double y = kw->b[s][0] * x + z[0];
+        z[0] = kw->b[s][1] * x - kw->a[s][1] * y + z[1];
+        z[1] = kw->b[s][2] * x - kw->a[s][2] * y;
+        x = y;
+    }
+    return x;
+}
+
+// Mean of the block energies above a threshold (0 if none)
+static double gated_mean(const float* blocks, size_t count, double threshold, size_t* passed) {
+    double sum = 0.0;
+    *passed = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (blocks[i] > threshold) {
+            sum += blocks[i];
+            (*passed)++;
+        }
+    }
+    return *passed > 0 ? sum / *passed : 0.0;
+}
+
+static inline double energy_to_lufs(double energy) {
+    return -0.691 + 10.0 * log10(energy);
+}
+
+static inline double lufs_to_energy(double lufs) {
+    return pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+// Integrated loudness of a whole file in LUFS; false if cancelled or silent
+static bool measure_loudness(StreamDecoder* sd, double* lufs) {
+    int channels = sd->source_channels == 1 ? 1 : AUDIO_CHANNELS;  // Mono is decoded duplicated
+    int sub_frames = sd->source_sample_rate / 10;                   // 100 ms
+    if (sub_frames <= 0) return false;
+
+    int16_t* pcm = malloc(LOUDNESS_CHUNK_FRAMES * sizeof(int16_t) * AUDIO_CHANNELS);
+    if (!pcm) return false;
+
+    KWeighting kw;
+    k_weighting_init(&kw, sd->source_sample_rate);
+
+    float* blocks = NULL;       // Mean square of each 400 ms block
+    size_t block_count = 0, block_capacity = 0;
+    double sub_energy[4] = {0}; // Last four 100 ms sums, the current block's quarters
+    int sub_done = 0;
+    double acc = 0.0;
+    int acc_frames = 0;
+    bool ok = true;
+
+    size_t got;
+    while ((got = stream_decoder_read(sd, pcm, LOUDNESS_CHUNK_FRAMES)) > 0) {
+        if (__atomic_load_n(&loudness_quit, __ATOMIC_RELAXED)) {
+            ok = false;
+            break;
+        }
+        for (size_t i = 0; i < got; i++) {
+            for (int c = 0; c < channels; c++) {
+                double y = k_weighting_run(&kw, c, pcm[i * AUDIO_CHANNELS + c] / 32768.0);
+                acc += y * y;
+            }
+            if (++acc_frames < sub_frames) continue;
+
+            sub_energy[sub_done++ % 4] = acc;
+            acc = 0.0;
+            acc_frames = 0;
+            if (sub_done < 4) continue;
+
+            if (block_count == block_capacity) {
+                size_t capacity = block_capacity ? block_capacity * 2 : 1024;
+                float* grown = realloc(blocks, capacity * sizeof(float));
+                if (!grown) {
+                    ok = false;
                     break;
                 }
+                blocks = grown;
+                block_capacity = capacity;
+            }
+            double sum = sub_energy[0] + sub_energy[1] + sub_energy[2] + sub_energy[3];
+            blocks[block_count++] = (float)(sum / (4.0 * sub_frames));
+        }
+        if (!ok) break;
+    }
+    free(pcm);
+
+    if (ok) {
+        size_t passed;
+        double mean = gated_mean(blocks, block_count, lufs_to_energy(LOUDNESS_ABSOLUTE_GATE), &passed);
+        if (passed > 0) {
+            double relative = lufs_to_energy(energy_to_lufs(mean) + LOUDNESS_RELATIVE_GATE);
+            double absolute = lufs_to_energy(LOUDNESS_ABSOLUTE_GATE);
+            mean = gated_mean(blocks, block_count, relative > absolute ? relative : absolute, &passed);
+        }
+        ok = passed > 0;
+        if (ok) *lufs = energy_to_lufs(mean);
+    }
+    free(blocks);
+    return ok;
+}
+
+// Measure one queued file unless it's tagged or already cached
+static void loudness_scan_file(const char* filepath) {
+    float gain_db;
+    if (load_loudness_cache(filepath, &gain_db)) return;
+
+    StreamDecoder sd;
+    if (stream_decoder_open(&sd, filepath) != 0) return;
+
+    TrackMetadata meta;
+    metadata_init(&meta, filepath);
+    parse_embedded_metadata(filepath, &meta);
+
+    double lufs;
+    if (meta.replaygain_source == REPLAYGAIN_NONE && sd.total_frames > 0 && !sd.source &&
+        measure_loudness(&sd, &lufs)) {
+        save_loudness_cache(filepath, LOUDNESS_REFERENCE_LUFS - (float)lufs);
+    }
+    stream_decoder_close(&sd);
+}
+
+static void loudness_wake(void);
+
+// One file per job, at idle priority: a folder's scan takes turns with other
+// background work instead of holding a worker until it is done
+static void loudness_job(void* arg, JobToken* token) {
+    (void)arg;
+    (void)token;
+
+    pthread_mutex_lock(&loudness_mutex);
+    char* filepath = NULL;
+    if (!loudness_quit && loudness_queue_count > 0) {
+        filepath = loudness_queue[0];
+        loudness_queue_count--;
+        memmove(loudness_queue, &loudness_queue[1], loudness_queue_count * sizeof(char*));
+        loudness_job_running = true;
+    }
+    pthread_mutex_unlock(&loudness_mutex);
+
+    if (filepath) {
+        loudness_scan_file(filepath);
+        free(filepath);
+    }
+
+    pthread_mutex_lock(&loudness_mutex);
+    loudness_job_running = false;
+    loudness_job_queued = false;
+    loudness_wake();
+    pthread_cond_broadcast(&loudness_cond);
+    pthread_mutex_unlock(&loudness_mutex);
+}
+
+// Drop pending files (loudness_mutex held)
+static void loudness_queue_clear(void) {
+    for (int i = 0; i < loudness_queue_count; i++) {
+        free(loudness_queue[i]);
+    }
+    free(loudness_queue);
+    loudness_queue = NULL;
+    loudness_queue_count = 0;
+}
+
+// Queue a scan job for the next file, unless one is pending (loudness_mutex held)
+static void loudness_wake(void) {
+    if (loudness_job_queued || loudness_quit || loudness_queue_count == 0) return;
+    loudness_job_queued = Jobs_post(JOB_PRIORITY_IDLE, loudness_job, NULL, NULL) == 0;
+}
+
+void Player_scanLoudness(const char* const* filepaths, int count) {
+    pthread_mutex_lock(&loudness_mutex);
+    loudness_queue_clear();
+    if (count > 0) {
+        loudness_queue = malloc(count * sizeof(char*));
+    }
+    for (int i = 0; loudness_queue && i < count; i++) {
+        char* copy = strdup(filepaths[i]);
+        if (copy) loudness_queue[loudness_queue_count++] = copy;
+    }
+    if (loudness_queue_count > 0) loudness_wake();
+    pthread_mutex_unlock(&loudness_mutex);
+}
+
+// Measure a file ahead of everything queued (the track that just started)
+static void loudness_request(const char* filepath) {
+    pthread_mutex_lock(&loudness_mutex);
+    for (int i = 0; i < loudness_queue_count; i++) {
+        if (strcmp(loudness_queue[i], filepath) == 0) {
+            // Already queued: move it to the front
+            char* entry = loudness_queue[i];
+            memmove(&loudness_queue[1], loudness_queue, i * sizeof(char*));
+            loudness_queue[0] = entry;
+            loudness_wake();
+            pthread_mutex_unlock(&loudness_mutex);
+            return;
+        }
+    }
+    char** grown = realloc(loudness_queue, (loudness_queue_count + 1) * sizeof(char*));
+    char* copy = grown ? strdup(filepath) : NULL;
+    if (grown) loudness_queue = grown;
+    if (copy) {
+        memmove(&loudness_queue[1], loudness_queue, loudness_queue_count * sizeof(char*));
+        loudness_queue[0] = copy;
+        loudness_queue_count++;
+        loudness_wake();
+    }
+    pthread_mutex_unlock(&loudness_mutex);
+}
+
+void Player_maintainFile(const char* filepath, JobToken* token) {
+    // Opening builds or loads the seek index as a first play would
+    StreamDecoder sd;
+    if (stream_decoder_open(&sd, filepath) != 0) return;
+    bool growing = sd.source != NULL;
+    stream_decoder_close(&sd);
+    if (growing || Jobs_cancelled(token)) return;
+
+    if (Player_getNormalization()) loudness_scan_file(filepath);
+    if (Jobs_cancelled(token)) return;
+
+    WaveformData overview;
+    if (!load_waveform_cache(filepath, &overview) && waveform_compute(filepath, token, &overview)) {
+        save_waveform_cache(filepath, &overview);
+    }
+}
+
+int Player_compactCaches(JobToken* token) {
+    static const char* const subdirs[] = {"seekindex", "waveform", "loudness"};
+    const char* home = getenv("HOME");
+    int removed = 0;
+    for (size_t i = 0; i < sizeof(subdirs) / sizeof(subdirs[0]) && !Jobs_cancelled(token); i++) {
+        char dir_path[512];
+        if (home) {
+            snprintf(dir_path, sizeof(dir_path), "%s/.cache/%s", home, subdirs[i]);
+        } else {
+            snprintf(dir_path, sizeof(dir_path), "/tmp/%s_cache", subdirs[i]);
+        }
+        DIR* dir = opendir(dir_path);
+        if (!dir) continue;
+
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != NULL && !Jobs_cancelled(token)) {
+            // Leave dot files, and entries being written (renamed into place when done)
+            if (ent->d_name[0] == '.' || strstr(ent->d_name, ".tmp")) continue;
+            char entry_path[800];
+            snprintf(entry_path, sizeof(entry_path), "%s/%s", dir_path, ent->d_name);
+
+            FileCacheHeader hdr;
+            FILE* f = fopen(entry_path, "rb");
+            if (!f) continue;
+            bool valid = fread(&hdr, sizeof(hdr), 1, f) == 1;
+            fclose(f);
+            if (valid) {
+                struct stat st;
+                hdr.path[sizeof(hdr.path) - 1] = '\0';
+                valid = stat(hdr.path, &st) == 0 && hdr.mtime == (int64_t)st.st_mtime &&
+                        hdr.size == (int64_t)st.st_size;
             }
+            if (!valid && unlink(entry_path) == 0) removed++;
+        }
+        closedir(dir);
+    }
+    return removed;
+}
+
+// Drop the queue and wait out a file being measured (Player_quit); a queued
+// job finds nothing left to do
+static void loudness_shutdown(void) {
+    pthread_mutex_lock(&loudness_mutex);
+    __atomic_store_n(&loudness_quit, true, __ATOMIC_RELAXED);
+    loudness_queue_clear();
+    while (loudness_job_running) pthread_cond_wait(&loudness_cond, &loudness_mutex);
+    pthread_mutex_unlock(&loudness_mutex);
+}
+
+// Normalization gain (Q15) for a track about to play: its ReplayGain tag, else the
+// cached measurement, else unity while the scan runs. Attenuation only: the gain
+// stage tops out at unity.
+static int16_t track_normalization_q15(const char* filepath, const TrackMetadata* meta) {
+    if (!player.normalize) return GAIN_UNITY_Q15;
+
+    float gain_db;
+    if (meta->replaygain_source != REPLAYGAIN_NONE) {
+        gain_db = meta->replaygain_db;
+    } else if (!load_loudness_cache(filepath, &gain_db)) {
+        loudness_request(filepath);
+        return GAIN_UNITY_Q15;
+    }
+    if (gain_db >= 0.0f) return GAIN_UNITY_Q15;
+    return (int16_t)(powf(10.0f, gain_db / 20.0f) * GAIN_UNITY_Q15 + 0.5f);
+}
+
+// ============ METADATA PARSING ============
+
+// Helper: copy string, trimming trailing spaces
+static void copy_metadata_string(char* dest, const char* src, size_t max_len) {
+    if (!src || !dest || max_len == 0) return;
+
+    size_t len = strlen(src);
+    if (len >= max_len) len = max_len - 1;
+
+    memcpy(dest, src, len);
+    dest[len] = '\0';
+
+    // Trim trailing spaces and nulls
+    while (len > 0 && (dest[len-1] == ' ' || dest[len-1] == '\0')) {
+        dest[--len] = '\0';
+    }
+}
+
+// Image bytes hashed for an embedded cover's cache key
+#define ART_KEY_SAMPLE 256
+
+// In-memory cover cache key of an embedded cover: a hash of its length and last
+// ART_KEY_SAMPLE bytes (the end of the compressed data), so the cover embedded
+// in every track of an album is decoded once whatever the tags say. One small
+// read; 0 if it fails.
+static uint64_t embedded_art_key(const char* filepath, long offset, uint32_t size) {
+    uint8_t sample[ART_KEY_SAMPLE];
+    uint32_t len = size < ART_KEY_SAMPLE ? size : ART_KEY_SAMPLE;
+    FILE* f = fopen(filepath, "rb");
+    if (!f) return 0;
+    bool read = fseek(f, offset + (long)(size - len), SEEK_SET) == 0 && fread(sample, 1, len, f) == len;
+    fclose(f);
+    if (!read) return 0;
+
+    uint64_t hash = 14695981039346656037ULL;  // FNV-1a, kind 'E' first like radio_album_art_key
+    hash = (hash ^ 'E') * 1099511628211ULL;
+    for (int i = 0; i < 4; i++) hash = (hash ^ ((size >> (i * 8)) & 0xFF)) * 1099511628211ULL;
+    for (uint32_t i = 0; i < len; i++) hash = (hash ^ sample[i]) * 1099511628211ULL;
+    return hash ? hash : 1;
+}
+
+AudioFormat Player_detectFormat(const char* filepath) {
+    if (!filepath) return AUDIO_FORMAT_UNKNOWN;
+
+    const char* ext = strrchr(filepath, '.');
+    if (!ext) return AUDIO_FORMAT_UNKNOWN;
+    ext++; // Skip the dot
+
+    if (strcasecmp(ext, "mp3") == 0) return AUDIO_FORMAT_MP3;
+    if (strcasecmp(ext, "wav") == 0) return AUDIO_FORMAT_WAV;
+    if (strcasecmp(ext, "ogg") == 0) return AUDIO_FORMAT_OGG;
+    if (strcasecmp(ext, "flac") == 0) return AUDIO_FORMAT_FLAC;
+    if (strcasecmp(ext, "m4a") == 0) return AUDIO_FORMAT_M4A;
+    if (strcasecmp(ext, "mod") == 0 || strcasecmp(ext, "xm") == 0 ||
+        strcasecmp(ext, "s3m") == 0 || strcasecmp(ext, "it") == 0) {
+        return AUDIO_FORMAT_MOD;
+    }
+
+    return AUDIO_FORMAT_UNKNOWN;
+}
+
+#define PROBE_HEADER_BYTES 64
+
+// Format of a file header, -1 if it isn't one we know
+// Ogg and MP4 say what they carry: Ogg's first packet names its codec (only Vorbis
+// decodes here), and an MP4 with audio is opened as M4A whatever its brand.
+static int probe_header(const uint8_t* h, size_t n) {
+    if (n >= 12 && (memcmp(h, "RIFF", 4) == 0 || memcmp(h, "RF64", 4) == 0) && memcmp(h + 8, "WAVE", 4) == 0) {
+        return AUDIO_FORMAT_WAV;
+    }
+    if (n >= 4 && memcmp(h, "fLaC", 4) == 0) return AUDIO_FORMAT_FLAC;
+    if (n >= 27 && memcmp(h, "OggS", 4) == 0) {
+        size_t packet = 27 + h[26];     // Past the page's segment table
+        bool vorbis = n >= packet + 7 && memcmp(h + packet, "\x01vorbis", 7) == 0;
+        return vorbis ? AUDIO_FORMAT_OGG : AUDIO_FORMAT_UNKNOWN;
+    }
+    if (n >= 8 && memcmp(h + 4, "ftyp", 4) == 0) return AUDIO_FORMAT_M4A;
+    // MPEG audio frame header: sync, a layer, a bitrate and a sample rate that exist
+    // (ADTS AAC has layer 0)
+    if (n >= 4 && h[0] == 0xFF && (h[1] & 0xE0) == 0xE0 && (h[1] & 0x06) != 0 &&
+        (h[2] & 0xF0) != 0xF0 && (h[2] & 0x0C) != 0x0C) {
+        return AUDIO_FORMAT_MP3;
+    }
+    return -1;
+}
+
+AudioFormat Player_probeFormat(const char* filepath) {
+    AudioFormat by_name = Player_detectFormat(filepath);
+    FILE* f = filepath ? fopen(filepath, "rb") : NULL;
+    if (!f) return by_name;
+
+    uint8_t head[PROBE_HEADER_BYTES];
+    size_t n = fread(head, 1, sizeof(head), f);
+    bool tagged = n >= 10 && memcmp(head, "ID3", 3) == 0;
+    if (tagged) {
+        // Look past the tag (size syncsafe, plus a footer if flagged)
+        long size = 10 + ((long)(head[6] & 0x7F) << 21 | (head[7] & 0x7F) << 14 | (head[8] & 0x7F) << 7 | (head[9] & 0x7F));
+        if (head[5] & 0x10) size += 10;
+        n = fseek(f, size, SEEK_SET) == 0 ? fread(head, 1, sizeof(head), f) : 0;
+    }
+    fclose(f);
+
+    int format = probe_header(head, n);
+    if (format >= 0) return (AudioFormat)format;
+    // An ID3 tag over a frame we couldn't place (padding, junk) is still an MP3
+    return tagged ? AUDIO_FORMAT_MP3 : by_name;
+}
+
+// Reset audio device to default sample rate (for radio use)
+void Player_resetSampleRate(void) {
+    reconfigure_audio_device(get_target_sample_rate());
+}
+
+// Set audio device to specific sample rate
+void Player_setSampleRate(int sample_rate) {
+    if (sample_rate > 0) {
+        reconfigure_audio_device(sample_rate);
+    }
+}
+
+int Player_getSampleRate(void) {
+    return __atomic_load_n(&current_sample_rate, __ATOMIC_RELAXED);
+}
+
+// Start streaming playback (decode on-the-fly) for the already opened player.stream_decoder
+// Takes ownership of the decoder and closes it on failure
+// Stream format a decoder would play in with the current output settings
+// (bit-perfect still depends on the DAC accepting the rate)
+static PcmFormat stream_format_for(const StreamDecoder* sd) {
+    // Hi-res files on a USB DAC can bypass the resampler and volume entirely
+    if (player.bit_perfect && !bluetooth_audio_active && GetAudioSink() == AUDIO_SINK_USBDAC &&
+        stream_decoder_is_hires(sd)) {
+        return PCM_FORMAT_S32;
+    }
+    return player.float_pipeline ? PCM_FORMAT_F32 : PCM_FORMAT_S16;
+}
+
+static int start_streaming(void) {
+    int src_rate = player.stream_decoder.source_sample_rate;
+
+    player.stream_format = PCM_FORMAT_S16;
+    if (stream_format_for(&player.stream_decoder) == PCM_FORMAT_S32) {
+        if (open_audio_device_bit_perfect(src_rate) == 0) {
+            player.stream_format = PCM_FORMAT_S32;
+        }
+        // DAC rejected it, fall back to the normal pipeline
+    }
+    if (player.stream_format == PCM_FORMAT_S16 && player.float_pipeline) {
+        player.stream_format = PCM_FORMAT_F32;
+    }
+
+    // Run the device at the track's own rate when allowed, otherwise at the sink's rate
+    if (player.stream_format != PCM_FORMAT_S32) {
+        negotiate_output_rate(src_rate);
+    }
+
+    // Initialize circular buffer, sized for this track's plan at the output rate
+    stream_plan_update();
+    size_t frame_bytes = pcm_frame_bytes(player.stream_format);
+    if (circular_buffer_init(&player.stream_buffer, stream_buffer_needed(), frame_bytes, MEM_TAG_PLAYER_BUFFER) != 0) {
+        player.stream_format = PCM_FORMAT_S16;
+        stream_decoder_close(&player.stream_decoder);
+        return -1;
+    }
+
+    // Initialize resampler for streaming (only when the device rate differs)
+    int dst_rate = current_sample_rate;
+
+    if (src_rate != dst_rate) {
+        player.resampler = resampler_acquire();
+        if (!player.resampler) {
+            LOG_ASYNC_error("Stream: Failed to create resampler\n");
+            circular_buffer_free(&player.stream_buffer);
+            stream_decoder_close(&player.stream_decoder);
+            return -1;
+        }
+
+        // Size its input buffer for a full decode chunk up front so the decode loop
+        // never allocates (crossfade chunks are smaller and fit as well)
+        Resampler_reserve(player.resampler, DECODE_CHUNK_FRAMES);
+    }
+
+    // Set track info
+    player.track_info.sample_rate = dst_rate;  // Output rate
+    player.track_info.channels = AUDIO_CHANNELS;
+    player.track_info.duration_ms = (int)((player.stream_decoder.total_frames * 1000) /
+                                          player.stream_decoder.source_sample_rate);
+
+    // Start decode thread
+    stream_clock_reset();
+    player.stream_running = true;
+    stream_commands_reset();
+    player.stream_eof = false;
+    pthread_create(&player.stream_thread, NULL, stream_thread_func, NULL);
+
+    player.use_streaming = true;
+    player.format = player.stream_decoder.format;
+
+    return 0;
+}
 
-            if (player.audio_device == 0) {
-                LOG_error("All fallback audio devices failed\n");
-                return -1;
-            }
-        } else {
-            return -1;
-        }
-    }
+// File name without directory and extension, the title of untagged files
+static void title_from_path(char* title, size_t size, const char* filepath) {
+    const char* filename = strrchr(filepath, '/');
+    if (filename) filename++; else filename = filepath;
+    strncpy(title, filename, size - 1);
+    title[size - 1] = '\0';
 
-    player.audio_initialized = true;
+    char* ext = strrchr(title, '.');
+    if (ext) *ext = '\0';
+}
 
-    // Register for audio device changes (Bluetooth, USB DAC, etc.)
-    PLAT_audioDeviceWatchRegister(audio_device_change_callback);
+// Set current file and filename-derived title (caller holds player.mutex)
+static void set_track_file(const char* filepath) {
+    // Store filename
+    strncpy(player.current_file, filepath, sizeof(player.current_file) - 1);
 
-    return 0;
+    title_from_path(player.track_info.title, sizeof(player.track_info.title), filepath);
+
+    // Clear artist/album
+    player.track_info.artist[0] = '\0';
+    player.track_info.album[0] = '\0';
 }
 
-// Reconfigure audio device with a new sample rate
-static int reconfigure_audio_device(int new_sample_rate) {
-    if (new_sample_rate == current_sample_rate && player.audio_device > 0) {
-        return 0;  // No change needed
-    }
+static void metadata_init(TrackMetadata* meta, const char* filepath) {
+    memset(meta, 0, sizeof(TrackMetadata));
+    title_from_path(meta->info.title, sizeof(meta->info.title), filepath);
+}
 
-    // Pause and close existing device
-    if (player.audio_device > 0) {
-        SDL_PauseAudioDevice(player.audio_device, 1);
-        SDL_CloseAudioDevice(player.audio_device);
-        player.audio_device = 0;
+// Make parsed metadata the current track's, taking its cover (caller holds player.mutex)
+// Replace the shown cover (mutex held, or the only thread touching it)
+static void set_album_art(SDL_Surface* art) {
+    if (player.album_art) {
+        MEM_SURFACE_SUB(MEM_TAG_ALBUM_ART, player.album_art);
+        SDL_FreeSurface(player.album_art);
     }
+    MEM_SURFACE_ADD(MEM_TAG_ALBUM_ART, art);
+    player.album_art = art;
+}
 
-    // Open with new sample rate
-    SDL_AudioSpec want, have;
-    SDL_zero(want);
-    want.freq = new_sample_rate;
-    want.format = AUDIO_S16SYS;
-    want.channels = AUDIO_CHANNELS;
-    want.samples = AUDIO_SAMPLES;
-    want.callback = audio_callback;
-    want.userdata = &player;
+static void apply_metadata(TrackMetadata* meta) {
+    strcpy(player.track_info.title, meta->info.title);
+    strcpy(player.track_info.artist, meta->info.artist);
+    strcpy(player.track_info.album, meta->info.album);
 
-    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
-    if (player.audio_device == 0) {
-        LOG_error("Failed to open audio device at %d Hz: %s\n", new_sample_rate, SDL_GetError());
-        // Try to reopen at target rate for current audio sink
-        int fallback_rate = get_target_sample_rate();
-        want.freq = fallback_rate;
-        player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
-        if (player.audio_device == 0) {
-            return -1;
-        }
+    set_album_art(NULL);
+    player.art_offset = meta->art_offset;
+    player.art_size = meta->art_size;
+    player.art_key = meta->art_key;
+    player.art_decoding = false;
+}
+
+// Publish the loop the decode thread keeps to (mutex held): the A-B loop, else
+// the region (or whole file) under repeat
+static void publish_loop(void) {
+    int start = -1, end = 0;
+    if (player.ab_start_ms >= 0) {
+        start = player.ab_start_ms;
+        end = player.ab_end_ms;
+    } else if (player.repeat) {
+        start = player.region.start_ms;
+        end = player.region.end_ms;
     }
+    __atomic_store_n(&player.loop_end_ms, end, __ATOMIC_RELAXED);
+    __atomic_store_n(&player.loop_start_ms, start, __ATOMIC_RELEASE);
+}
 
-    current_sample_rate = have.freq;
-    return 0;
+// Show the region's names instead of the file's tags (mutex held)
+static void apply_region_info(void) {
+    if (player.region.title[0]) {
+        copy_metadata_string(player.track_info.title, player.region.title, sizeof(player.track_info.title));
+    }
+    if (player.region.artist[0]) {
+        copy_metadata_string(player.track_info.artist, player.region.artist, sizeof(player.track_info.artist));
+    }
+    if (player.region.album[0]) {
+        copy_metadata_string(player.track_info.album, player.region.album, sizeof(player.track_info.album));
+    }
 }
 
-// Reopen audio device (called when audio sink changes, e.g., Bluetooth connect/disconnect)
-static void reopen_audio_device(void) {
-    // Remember current playback state
-    PlayerState prev_state = player.state;
+// Parse embedded metadata (file I/O only)
+// Every format's tags go through the tag reader, which finds them by the file's
+// bytes: no decoder needed.
+static void parse_embedded_metadata(const char* filepath, TrackMetadata* meta) {
+    TRACE_SCOPE("parse_tags");
+    TagSet tags;
+    if (TagReader_read(filepath, &tags) != 0) return;
+
+    const char* value;
+    if ((value = TagReader_get(&tags, TAG_TITLE))) {
+        copy_metadata_string(meta->info.title, value, sizeof(meta->info.title));
+    }
+    if ((value = TagReader_get(&tags, TAG_ARTIST))) {
+        copy_metadata_string(meta->info.artist, value, sizeof(meta->info.artist));
+    }
+    if ((value = TagReader_get(&tags, TAG_ALBUM))) {
+        copy_metadata_string(meta->info.album, value, sizeof(meta->info.album));
+    }
 
-    // Pause and close existing device
-    if (player.audio_device > 0) {
-        SDL_PauseAudioDevice(player.audio_device, 1);
-        SDL_CloseAudioDevice(player.audio_device);
-        player.audio_device = 0;
+    // The track's own gain over its album's
+    if (tags.has_track_gain) {
+        meta->replaygain_db = tags.track_gain_db;
+        meta->replaygain_source = REPLAYGAIN_TRACK;
+    } else if (tags.has_album_gain) {
+        meta->replaygain_db = tags.album_gain_db;
+        meta->replaygain_source = REPLAYGAIN_ALBUM;
     }
 
-    // Get target sample rate for the new audio sink
-    int target_rate = get_target_sample_rate();
+    meta->art_offset = tags.art_offset;
+    meta->art_size = tags.art_size;
+    if (meta->art_offset != 0 && !meta->tags_only) {
+        meta->art_key = embedded_art_key(filepath, meta->art_offset, meta->art_size);
+    }
+}
 
-    // Reopen with target sample rate
-    SDL_AudioSpec want, have;
-    SDL_zero(want);
-    want.freq = target_rate;
-    want.format = AUDIO_S16SYS;
-    want.channels = AUDIO_CHANNELS;
-    want.samples = AUDIO_SAMPLES;
-    want.callback = audio_callback;
-    want.userdata = &player;
+static bool start_folder_art_decode(const char* track, unsigned generation);
 
-    player.audio_device = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
-    if (player.audio_device == 0) {
-        LOG_error("Failed to reopen audio device: %s\n", SDL_GetError());
-        return;
-    }
+// If the track has no embedded album art, use a cover image in its folder, else
+// try to fetch it from the internet (queued on the album art worker, which drops
+// it once another track is asked for); online_only skips the folder
+static void fetch_album_art_fallback(unsigned generation, bool online_only) {
+    char artist[256], title[256], track[512];
 
-    current_sample_rate = have.freq;
+    pthread_mutex_lock(&player.mutex);
+    bool wanted = player.track_generation == generation && player.album_art == NULL &&
+                  player.art_offset == 0;
+    strncpy(artist, player.track_info.artist, sizeof(artist) - 1);
+    artist[sizeof(artist) - 1] = '\0';
+    strncpy(title, player.track_info.title, sizeof(title) - 1);
+    title[sizeof(title) - 1] = '\0';
+    strncpy(track, player.current_file, sizeof(track) - 1);
+    track[sizeof(track) - 1] = '\0';
+    pthread_mutex_unlock(&player.mutex);
 
-    // Resume playback if it was playing
-    if (prev_state == PLAYER_STATE_PLAYING) {
-        SDL_PauseAudioDevice(player.audio_device, 0);
+    if (!wanted) return;
+    if (!online_only && start_folder_art_decode(track, generation)) return;
+    if (artist[0] == '\0' && title[0] == '\0') return;
+    radio_album_art_fetch(artist, title);
+}
+
+// Queue the internet lookup for the current track
+static void start_album_art_fetch(void) {
+    fetch_album_art_fallback(__atomic_load_n(&player.track_generation, __ATOMIC_ACQUIRE), false);
+}
+
+// Embedded cover decode request, owned by its thread
+typedef struct {
+    char filepath[512];
+    long offset;
+    uint32_t size;
+    unsigned generation;
+    uint64_t key;               // In-memory cover cache key
+    bool folder;                // A folder image: only the internet is left if unreadable
+} ArtDecodeRequest;
+
+// Read and decode an embedded cover, caching it in memory under key
+static SDL_Surface* decode_embedded_art(const char* filepath, long offset, uint32_t size, uint64_t key) {
+    TRACE_SCOPE("decode_embedded_art");
+    SDL_Surface* art = NULL;
+    FILE* f = fopen(filepath, "rb");
+    if (f) {
+        uint8_t* data = malloc(size);
+        if (data && fseek(f, offset, SEEK_SET) == 0 && fread(data, 1, size, f) == size) {
+            art = radio_album_art_decode(data, size);
+            if (art) radio_album_art_cachePut(key, art);
+        }
+        free(data);
+        fclose(f);
     }
+    return art;
 }
 
-// Callback for audio device changes (Bluetooth connect/disconnect, USB DAC, etc.)
-static void audio_device_change_callback(int device_type, int event) {
-    (void)device_type;
-    (void)event;
+// Decode the embedded cover located by the tag parser, or a folder image; fall
+// back to the next source if it turns out to be unreadable
+static void album_art_decode_job(void* arg, JobToken* token) {
+    (void)token;
+    ArtDecodeRequest* req = (ArtDecodeRequest*)arg;
 
-    // Re-check if Bluetooth is now active/inactive
-    bool was_bluetooth = bluetooth_audio_active;
-    bluetooth_audio_active = false;
+    SDL_Surface* art = decode_embedded_art(req->filepath, req->offset, req->size, req->key);
 
-    const char* home = getenv("HOME");
-    if (home) {
-        char asoundrc_path[512];
-        snprintf(asoundrc_path, sizeof(asoundrc_path), "%s/.asoundrc", home);
-        FILE* f = fopen(asoundrc_path, "r");
-        if (f) {
-            char buf[256];
-            while (fgets(buf, sizeof(buf), f)) {
-                if (strstr(buf, "bluealsa")) {
-                    bluetooth_audio_active = true;
-                    break;
-                }
-            }
-            fclose(f);
+    bool failed = false;
+    pthread_mutex_lock(&player.mutex);
+    if (player.track_generation == req->generation) {
+        player.art_decoding = false;
+        player.art_offset = 0;
+        if (art) {
+            set_album_art(art);
+            player.art_changed = true;
+            art = NULL;
+        } else {
+            failed = true;
         }
     }
+    pthread_mutex_unlock(&player.mutex);
 
-    if (was_bluetooth != bluetooth_audio_active) {
-        // If Bluetooth just activated, set mixer to 100%
-        if (bluetooth_audio_active) {
-            system("amixer scontrols 2>/dev/null | grep -i 'A2DP' | "
-                   "sed \"s/.*'\\([^']*\\)'.*/\\1/\" | "
-                   "while read ctrl; do amixer sset \"$ctrl\" 127 2>/dev/null; done");
-        }
+    if (art) {
+        SDL_FreeSurface(art);  // Track changed while decoding
+    }
+    if (failed) {
+        fetch_album_art_fallback(req->generation, req->folder);
     }
 
-    reopen_audio_device();
+    free(req);
+    __atomic_sub_fetch(&player.load_workers, 1, __ATOMIC_RELEASE);
 }
 
-void Player_quit(void) {
-    // Unregister audio device watcher
-    PLAT_audioDeviceWatchUnregister();
+// Start decoding the current track's embedded cover, if located and not started yet
+static void start_album_art_decode(void) {
+    pthread_mutex_lock(&player.mutex);
+    if (player.art_offset == 0 || player.art_decoding || player.album_art) {
+        pthread_mutex_unlock(&player.mutex);
+        return;
+    }
 
-    Player_stop();
+    ArtDecodeRequest* req = malloc(sizeof(ArtDecodeRequest));
+    if (!req) {
+        pthread_mutex_unlock(&player.mutex);
+        return;
+    }
+    strncpy(req->filepath, player.current_file, sizeof(req->filepath) - 1);
+    req->filepath[sizeof(req->filepath) - 1] = '\0';
+    req->offset = player.art_offset;
+    req->size = player.art_size;
+    req->generation = player.track_generation;
+    req->key = player.art_key;
+    req->folder = false;
+
+    // Another track of the album was shown recently: no read or decode
+    SDL_Surface* cached = radio_album_art_cacheGet(req->key);
+    if (cached) {
+        set_album_art(cached);
+        player.art_offset = 0;
+        player.art_changed = true;
+        pthread_mutex_unlock(&player.mutex);
+        free(req);
+        return;
+    }
+    player.art_decoding = true;
+    pthread_mutex_unlock(&player.mutex);
 
-    if (player.audio_device > 0) {
-        SDL_CloseAudioDevice(player.audio_device);
-        player.audio_device = 0;
+    // A view is waiting for it
+    __atomic_add_fetch(&player.load_workers, 1, __ATOMIC_ACQ_REL);
+    if (Jobs_post(JOB_PRIORITY_INTERACTIVE, album_art_decode_job, NULL, req) != 0) {
+        __atomic_sub_fetch(&player.load_workers, 1, __ATOMIC_RELEASE);
+        free(req);
+        pthread_mutex_lock(&player.mutex);
+        player.art_decoding = false;
+        pthread_mutex_unlock(&player.mutex);
     }
+}
 
-    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+// Show the cover image in track's folder: from the in-memory cache (shared by
+// the folder's tracks), else decoded on a job. False if the folder has none.
+static bool start_folder_art_decode(const char* track, unsigned generation) {
+    FolderArt folder;
+    if (!FolderArt_find(track, &folder)) return false;
 
-    pthread_mutex_destroy(&player.mutex);
-    pthread_mutex_destroy(&player.vis_mutex);
+    SDL_Surface* cached = radio_album_art_cacheGet(folder.key);
+    if (cached) {
+        pthread_mutex_lock(&player.mutex);
+        if (player.track_generation == generation && player.album_art == NULL) {
+            set_album_art(cached);
+            player.art_changed = true;
+            cached = NULL;
+        }
+        pthread_mutex_unlock(&player.mutex);
+        if (cached) SDL_FreeSurface(cached);
+        return true;
+    }
 
-    player.audio_initialized = false;
+    ArtDecodeRequest* req = malloc(sizeof(ArtDecodeRequest));
+    if (!req) return false;
+    snprintf(req->filepath, sizeof(req->filepath), "%s", folder.path);
+    req->offset = 0;
+    req->size = folder.size;
+    req->generation = generation;
+    req->key = folder.key;
+    req->folder = true;
+
+    __atomic_add_fetch(&player.load_workers, 1, __ATOMIC_ACQ_REL);
+    if (Jobs_post(JOB_PRIORITY_INTERACTIVE, album_art_decode_job, NULL, req) != 0) {
+        __atomic_sub_fetch(&player.load_workers, 1, __ATOMIC_RELEASE);
+        free(req);
+        return false;
+    }
+    return true;
 }
 
-// ============ METADATA PARSING ============
+// ============ PREFETCH CACHE ============
 
-// Helper: read syncsafe integer (ID3v2)
-static uint32_t read_syncsafe_int(const uint8_t* data) {
-    return ((uint32_t)(data[0] & 0x7F) << 21) |
-           ((uint32_t)(data[1] & 0x7F) << 14) |
-           ((uint32_t)(data[2] & 0x7F) << 7) |
-           ((uint32_t)(data[3] & 0x7F));
-}
+// Upcoming tracks are opened by a background worker while the current one plays:
+// decoder open (seek index, sample tables), tag parsing, the first second of PCM
+// and the cover (into the in-memory art cache). Loading or queueing one of them then takes the slot instead of opening the
+// file, and the decode thread plays the preroll while the decoder catches up.
 
-// Helper: read big-endian 32-bit integer
-static uint32_t read_be32(const uint8_t* data) {
-    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) |
-           ((uint32_t)data[2] << 8) | (uint32_t)data[3];
-}
+#define PREFETCH_PREROLL_MS 1000
+#define PREFETCH_PREROLL_BUDGET (1024 * 1024)   // Pre-decoded PCM of all slots together
 
-// Helper: copy string, trimming trailing spaces
-static void copy_metadata_string(char* dest, const char* src, size_t max_len) {
-    if (!src || !dest || max_len == 0) return;
+typedef struct {
+    char filepath[512];         // Empty = free
+    StreamDecoder decoder;      // Open, with the start of the track in its preroll
+    TrackMetadata meta;
+} PrefetchSlot;
+
+static PrefetchSlot prefetch_slots[PLAYER_PREFETCH_MAX];
+static char prefetch_wanted[PLAYER_PREFETCH_MAX][512];  // Requested tracks in play order
+static bool prefetch_done[PLAYER_PREFETCH_MAX];         // Opened (or failed) once, don't retry
+static int prefetch_wanted_count = 0;
+static pthread_mutex_t prefetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t prefetch_thread;
+static bool prefetch_thread_active = false;
+static bool prefetch_quit = false;
+
+// Index in prefetch_wanted, -1 if not wanted (prefetch_mutex held)
+static int prefetch_wanted_index(const char* filepath) {
+    for (int i = 0; i < prefetch_wanted_count; i++) {
+        if (strcmp(prefetch_wanted[i], filepath) == 0) return i;
+    }
+    return -1;
+}
 
-    size_t len = strlen(src);
-    if (len >= max_len) len = max_len - 1;
+// Slot holding a track, NULL if not cached (prefetch_mutex held)
+static PrefetchSlot* prefetch_find(const char* filepath) {
+    for (int i = 0; i < PLAYER_PREFETCH_MAX; i++) {
+        if (prefetch_slots[i].filepath[0] && strcmp(prefetch_slots[i].filepath, filepath) == 0) {
+            return &prefetch_slots[i];
+        }
+    }
+    return NULL;
+}
 
-    memcpy(dest, src, len);
-    dest[len] = '\0';
+static void prefetch_slot_release(PrefetchSlot* slot) {
+    stream_decoder_close(&slot->decoder);
+    memset(slot, 0, sizeof(PrefetchSlot));
+}
 
-    // Trim trailing spaces and nulls
-    while (len > 0 && (dest[len-1] == ' ' || dest[len-1] == '\0')) {
-        dest[--len] = '\0';
+// Have an upcoming track's cover ready in the in-memory cache: decode the embedded
+// one or the folder's, or queue the internet lookup the track would start otherwise
+// (worker)
+static void prefetch_album_art(const char* filepath, const TrackMetadata* meta) {
+    if (meta->art_offset != 0) {
+        uint64_t key = meta->art_key;
+        if (radio_album_art_cacheHas(key)) return;
+        SDL_Surface* art = decode_embedded_art(filepath, meta->art_offset, meta->art_size, key);
+        if (art) SDL_FreeSurface(art);
+        return;
     }
+    FolderArt folder;
+    if (FolderArt_find(filepath, &folder)) {
+        if (radio_album_art_cacheHas(folder.key)) return;
+        SDL_Surface* art = decode_embedded_art(folder.path, 0, folder.size, folder.key);
+        if (art) SDL_FreeSurface(art);
+        return;
+    }
+    radio_album_art_prefetch(meta->info.artist, meta->info.title);
 }
 
-// Helper: convert UTF-16LE to ASCII (for ID3v2 text frames)
-static void utf16le_to_ascii(char* dest, const uint8_t* src, size_t src_len, size_t max_len) {
-    if (!dest || !src || max_len == 0) return;
+// Open a track and decode its start into the preroll (worker, no locks held)
+static bool prefetch_open(PrefetchSlot* slot) {
+    AudioFormat format = Player_detectFormat(slot->filepath);
+    if (format == AUDIO_FORMAT_UNKNOWN || format == AUDIO_FORMAT_MOD) return false;
+
+    StreamDecoder* sd = &slot->decoder;
+    if (stream_decoder_open(sd, slot->filepath) != 0) return false;
+    metadata_init(&slot->meta, slot->filepath);
+    parse_embedded_metadata(slot->filepath, &slot->meta);
+    prefetch_album_art(slot->filepath, &slot->meta);
+
+    // Decode in the format the stream will most likely use, checked again when played
+    PcmFormat pcm_format = stream_format_for(sd);
+    size_t frame_bytes = pcm_frame_bytes(pcm_format);
+    size_t frames = (size_t)sd->source_sample_rate * PREFETCH_PREROLL_MS / 1000;
+    size_t budget = PREFETCH_PREROLL_BUDGET / PLAYER_PREFETCH_MAX / frame_bytes;
+    if (frames > budget) frames = budget;
+
+    uint8_t* pcm = malloc(frames * frame_bytes);
+    if (!pcm) return true;  // Still worth it for the open and the tags
+
+    size_t got = 0;
+    while (got < frames) {
+        size_t chunk = frames - got < DECODE_CHUNK_FRAMES ? frames - got : DECODE_CHUNK_FRAMES;
+        size_t n = stream_decoder_read_format(sd, pcm_format, &pcm[got * frame_bytes], chunk);
+        if (n == 0) break;
+        got += n;
+    }
+    if (got == 0) {
+        free(pcm);
+        return true;
+    }
 
-    size_t j = 0;
-    for (size_t i = 0; i + 1 < src_len && j < max_len - 1; i += 2) {
-        // Get UTF-16LE character (low byte first)
-        uint16_t ch = src[i] | (src[i + 1] << 8);
+    sd->preroll = pcm;
+    sd->preroll_frames = got;
+    sd->preroll_pos = 0;
+    sd->preroll_format = pcm_format;
+    sd->current_frame -= got;  // Playback starts with the preroll
+    return true;
+}
 
-        // Only copy ASCII range characters
-        if (ch > 0 && ch < 128) {
-            dest[j++] = (char)ch;
-        } else if (ch >= 128 && ch < 256) {
-            // Latin-1 supplement - just use low byte
-            dest[j++] = (char)ch;
+static void* prefetch_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    pthread_mutex_lock(&prefetch_mutex);
+    while (!prefetch_quit) {
+        // Drop tracks that are no longer coming up
+        for (int i = 0; i < PLAYER_PREFETCH_MAX; i++) {
+            PrefetchSlot* slot = &prefetch_slots[i];
+            if (slot->filepath[0] && prefetch_wanted_index(slot->filepath) < 0) {
+                PrefetchSlot old = *slot;
+                memset(slot, 0, sizeof(PrefetchSlot));
+                pthread_mutex_unlock(&prefetch_mutex);
+                prefetch_slot_release(&old);
+                pthread_mutex_lock(&prefetch_mutex);
+            }
+        }
+
+        // Earliest wanted track not cached yet
+        int next = -1;
+        for (int i = 0; i < prefetch_wanted_count && next < 0; i++) {
+            if (!prefetch_done[i] && !prefetch_find(prefetch_wanted[i])) next = i;
+        }
+        if (next < 0) {
+            pthread_cond_wait(&prefetch_cond, &prefetch_mutex);
+            continue;
         }
-        // Skip non-ASCII/non-Latin1 characters
-    }
-    dest[j] = '\0';
-}
 
-// Helper: convert UTF-16BE to ASCII (for ID3v2 text frames)
-static void utf16be_to_ascii(char* dest, const uint8_t* src, size_t src_len, size_t max_len) {
-    if (!dest || !src || max_len == 0) return;
+        PrefetchSlot fresh;
+        memset(&fresh, 0, sizeof(fresh));
+        strcpy(fresh.filepath, prefetch_wanted[next]);
+        prefetch_done[next] = true;
+        pthread_mutex_unlock(&prefetch_mutex);
 
-    size_t j = 0;
-    for (size_t i = 0; i + 1 < src_len && j < max_len - 1; i += 2) {
-        // Get UTF-16BE character (high byte first)
-        uint16_t ch = (src[i] << 8) | src[i + 1];
+        bool opened = prefetch_open(&fresh);
 
-        // Only copy ASCII range characters
-        if (ch > 0 && ch < 128) {
-            dest[j++] = (char)ch;
-        } else if (ch >= 128 && ch < 256) {
-            // Latin-1 supplement
-            dest[j++] = (char)ch;
+        pthread_mutex_lock(&prefetch_mutex);
+        PrefetchSlot* free_slot = NULL;
+        for (int i = 0; i < PLAYER_PREFETCH_MAX && !free_slot; i++) {
+            if (!prefetch_slots[i].filepath[0]) free_slot = &prefetch_slots[i];
+        }
+        if (opened && !prefetch_quit && free_slot && prefetch_wanted_index(fresh.filepath) >= 0 &&
+            !prefetch_find(fresh.filepath)) {
+            *free_slot = fresh;
+        } else if (opened) {
+            pthread_mutex_unlock(&prefetch_mutex);
+            prefetch_slot_release(&fresh);
+            pthread_mutex_lock(&prefetch_mutex);
         }
     }
-    dest[j] = '\0';
+    pthread_mutex_unlock(&prefetch_mutex);
+    return NULL;
 }
 
-// Parse ID3v1 tag (at end of file, 128 bytes)
-static void parse_id3v1(const char* filepath) {
-    FILE* f = fopen(filepath, "rb");
-    if (!f) return;
+void Player_prefetch(const char* const* filepaths, int count) {
+    if (count < 0) count = 0;
+    if (count > PLAYER_PREFETCH_MAX) count = PLAYER_PREFETCH_MAX;
 
-    // Seek to last 128 bytes
-    if (fseek(f, -128, SEEK_END) != 0) {
-        fclose(f);
-        return;
+    pthread_mutex_lock(&prefetch_mutex);
+    bool changed = count != prefetch_wanted_count;
+    for (int i = 0; i < count && !changed; i++) {
+        changed = strcmp(prefetch_wanted[i], filepaths[i]) != 0;
     }
-
-    uint8_t tag[128];
-    if (fread(tag, 1, 128, f) != 128) {
-        fclose(f);
+    if (!changed) {
+        pthread_mutex_unlock(&prefetch_mutex);
         return;
     }
-    fclose(f);
 
-    // Check for "TAG" header
-    if (tag[0] != 'T' || tag[1] != 'A' || tag[2] != 'G') {
-        return;
+    for (int i = 0; i < count; i++) {
+        strncpy(prefetch_wanted[i], filepaths[i], sizeof(prefetch_wanted[i]) - 1);
+        prefetch_wanted[i][sizeof(prefetch_wanted[i]) - 1] = '\0';
+        prefetch_done[i] = false;
     }
+    prefetch_wanted_count = count;
 
-    // ID3v1 layout: TAG(3) + Title(30) + Artist(30) + Album(30) + Year(4) + Comment(30) + Genre(1)
-    char buf[31];
-
-    // Title (bytes 3-32)
-    if (player.track_info.title[0] == '\0' || strstr(player.track_info.title, ".") != NULL) {
-        memcpy(buf, &tag[3], 30);
-        buf[30] = '\0';
-        copy_metadata_string(player.track_info.title, buf, sizeof(player.track_info.title));
+    if (!prefetch_thread_active && count > 0) {
+        prefetch_quit = false;
+        prefetch_thread_active = pthread_create(&prefetch_thread, NULL, prefetch_thread_func, NULL) == 0;
     }
+    pthread_cond_signal(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_mutex);
+}
 
-    // Artist (bytes 33-62)
-    if (player.track_info.artist[0] == '\0') {
-        memcpy(buf, &tag[33], 30);
-        buf[30] = '\0';
-        copy_metadata_string(player.track_info.artist, buf, sizeof(player.track_info.artist));
+int Player_shedPrefetch(void) {
+    PrefetchSlot shed[PLAYER_PREFETCH_MAX];
+    int count = 0;
+    pthread_mutex_lock(&prefetch_mutex);
+    for (int i = 0; i < PLAYER_PREFETCH_MAX; i++) {
+        if (!prefetch_slots[i].filepath[0]) continue;
+        shed[count++] = prefetch_slots[i];
+        memset(&prefetch_slots[i], 0, sizeof(PrefetchSlot));
     }
+    pthread_mutex_unlock(&prefetch_mutex);
+    // Still marked done in prefetch_wanted, so the worker leaves them closed
+    for (int i = 0; i < count; i++) prefetch_slot_release(&shed[i]);
+    return count;
+}
 
-    // Album (bytes 63-92)
-    if (player.track_info.album[0] == '\0') {
-        memcpy(buf, &tag[63], 30);
-        buf[30] = '\0';
-        copy_metadata_string(player.track_info.album, buf, sizeof(player.track_info.album));
+// Claim a prefetched track: its open decoder and parsed tags. Returns false if not cached.
+static bool prefetch_take(const char* filepath, StreamDecoder* sd, TrackMetadata* meta) {
+    pthread_mutex_lock(&prefetch_mutex);
+    PrefetchSlot* slot = prefetch_find(filepath);
+    if (!slot) {
+        pthread_mutex_unlock(&prefetch_mutex);
+        return false;
     }
+    *sd = slot->decoder;
+    *meta = slot->meta;
+    memset(slot, 0, sizeof(PrefetchSlot));
+    pthread_mutex_unlock(&prefetch_mutex);
+    return true;
+}
 
+// Open a track for playback, from the prefetch cache when it's there
+static int open_track(const char* filepath, StreamDecoder* sd, TrackMetadata* meta) {
+    TRACE_SCOPE("open_track");
+    if (prefetch_take(filepath, sd, meta)) return 0;
+
+    memset(sd, 0, sizeof(StreamDecoder));
+    metadata_init(meta, filepath);
+    if (stream_decoder_open(sd, filepath) != 0) return -1;
+    parse_embedded_metadata(filepath, meta);
+    return 0;
 }
 
-// Parse ID3v2 tag (at beginning of file)
-static void parse_id3v2(const char* filepath) {
-    FILE* f = fopen(filepath, "rb");
-    if (!f) return;
+int Player_readFileTags(const char* filepath, PlayerFileTags* tags) {
+    memset(tags, 0, sizeof(PlayerFileTags));
 
-    uint8_t header[10];
-    if (fread(header, 1, 10, f) != 10) {
-        fclose(f);
-        return;
-    }
+    StreamDecoder sd;
+    if (stream_decoder_open(&sd, filepath) != 0) return -1;
 
-    // Check for "ID3" header
-    if (header[0] != 'I' || header[1] != 'D' || header[2] != '3') {
-        fclose(f);
-        return;
+    TrackMetadata meta;
+    metadata_init(&meta, filepath);
+    meta.tags_only = true;
+    parse_embedded_metadata(filepath, &meta);
+
+    tags->info = meta.info;
+    tags->info.sample_rate = sd.source_sample_rate;
+    tags->info.channels = sd.source_channels;
+    if (sd.source_sample_rate > 0) {
+        tags->info.duration_ms = (int)(sd.total_frames * 1000 / sd.source_sample_rate);
+    }
+    tags->art_offset = meta.art_offset;
+    tags->art_size = meta.art_size;
+    if (meta.replaygain_source != REPLAYGAIN_NONE) {
+        tags->replaygain_db = meta.replaygain_db;
+        tags->has_replaygain = true;
+    } else {
+        tags->has_replaygain = load_loudness_cache(filepath, &tags->replaygain_db);
     }
 
-    uint8_t version_major = header[3];  // 3 = ID3v2.3, 4 = ID3v2.4
-    // uint8_t version_minor = header[4];
-    // uint8_t flags = header[5];
-    uint32_t tag_size = read_syncsafe_int(&header[6]);
+    stream_decoder_close(&sd);
+    return 0;
+}
 
+// Stop the worker and release the cache (Player_quit)
+static void prefetch_shutdown(void) {
+    pthread_mutex_lock(&prefetch_mutex);
+    bool active = prefetch_thread_active;
+    prefetch_quit = true;
+    prefetch_wanted_count = 0;
+    pthread_cond_signal(&prefetch_cond);
+    pthread_mutex_unlock(&prefetch_mutex);
+
+    if (active) {
+        pthread_join(prefetch_thread, NULL);
+        prefetch_thread_active = false;
+    }
+    for (int i = 0; i < PLAYER_PREFETCH_MAX; i++) {
+        if (prefetch_slots[i].filepath[0]) prefetch_slot_release(&prefetch_slots[i]);
+    }
+}
 
-    // Read entire tag
-    uint8_t* tag_data = malloc(tag_size);
-    if (!tag_data) {
-        fclose(f);
-        return;
+// Async load request, owned by its load thread
+typedef struct {
+    char filepath[512];
+    unsigned generation;
+    int start_ms;           // File position to seek to once opened
+    SeekHint hint;          // Seek index entry to get there through (frame -1 = none)
+} LoadRequest;
+
+// Open the decoder and parse metadata off the UI thread, then hand the decoder
+// to Player_update. Results of a superseded request are discarded.
+static void* load_thread_func(void* arg) {
+    LoadRequest* req = (LoadRequest*)arg;
+    StreamDecoder sd;
+    TrackMetadata meta;
+
+    TRACE_BEGIN("load_thread");
+    int result = open_track(req->filepath, &sd, &meta);
+    int16_t norm = GAIN_UNITY_Q15;
+    if (result == 0) {
+        norm = track_normalization_q15(req->filepath, &meta);
+        if (req->start_ms > 0) {
+            stream_decoder_seek_hint(&sd, &req->hint, (int64_t)req->start_ms * sd.source_sample_rate / 1000);
+        }
     }
 
-    if (fread(tag_data, 1, tag_size, f) != tag_size) {
-        free(tag_data);
-        fclose(f);
-        return;
+    pthread_mutex_lock(&player.mutex);
+    if (player.track_generation != req->generation) {
+        pthread_mutex_unlock(&player.mutex);
+        if (result == 0) stream_decoder_close(&sd);
+        goto done;
     }
-    fclose(f);
 
-    // Parse frames
-    uint32_t pos = 0;
-    while (pos + 10 < tag_size) {
-        // Frame header: ID(4) + Size(4) + Flags(2)
-        char frame_id[5];
-        memcpy(frame_id, &tag_data[pos], 4);
-        frame_id[4] = '\0';
+    if (result != 0) {
+        LOG_error("Failed to open: %s\n", req->filepath);
+        player.load_failed = true;
+        player.state = PLAYER_STATE_STOPPED;
+        publish_snapshot();
+        pthread_mutex_unlock(&player.mutex);
+        goto done;
+    }
 
-        // Check for padding (all zeros)
-        if (frame_id[0] == '\0') break;
+    // Checked against the generation under the mutex, so a newer load can't interleave
+    apply_metadata(&meta);
+    __atomic_store_n(&track_norm_q15, norm, __ATOMIC_RELAXED);
+    player.load_decoder = sd;
+    player.load_ready = true;
+    publish_snapshot();
+    pthread_mutex_unlock(&player.mutex);
 
-        uint32_t frame_size;
-        if (version_major == 4) {
-            frame_size = read_syncsafe_int(&tag_data[pos + 4]);
-        } else {
-            frame_size = read_be32(&tag_data[pos + 4]);
-        }
-
-        // Skip flags
-        pos += 10;
-
-        if (frame_size == 0 || pos + frame_size > tag_size) break;
-
-        // Process text frames (TIT2, TPE1, TALB, etc.)
-        if (frame_id[0] == 'T' && frame_size > 1) {
-            const uint8_t* frame_data = &tag_data[pos];
-            uint8_t encoding = frame_data[0];
-            const uint8_t* text_data = &frame_data[1];
-            size_t text_len = frame_size - 1;
-
-            char temp[256];
-            temp[0] = '\0';
-
-            // Handle different encodings
-            // 0 = ISO-8859-1, 1 = UTF-16 with BOM, 2 = UTF-16BE, 3 = UTF-8
-            if (encoding == 0 || encoding == 3) {
-                // ISO-8859-1 or UTF-8: copy directly
-                size_t copy_len = text_len < 255 ? text_len : 255;
-                memcpy(temp, text_data, copy_len);
-                temp[copy_len] = '\0';
-            } else if (encoding == 1) {
-                // UTF-16 with BOM
-                if (text_len >= 2) {
-                    bool is_le = (text_data[0] == 0xFF && text_data[1] == 0xFE);
-                    bool is_be = (text_data[0] == 0xFE && text_data[1] == 0xFF);
-                    if (is_le || is_be) {
-                        text_data += 2;
-                        text_len -= 2;
-                    }
-                    if (is_be) {
-                        utf16be_to_ascii(temp, text_data, text_len, sizeof(temp));
-                    } else {
-                        // Default to LE
-                        utf16le_to_ascii(temp, text_data, text_len, sizeof(temp));
-                    }
-                }
-            } else if (encoding == 2) {
-                // UTF-16BE without BOM
-                utf16be_to_ascii(temp, text_data, text_len, sizeof(temp));
-            }
+    // The track is ready to play, the network lookup is background work
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+    fetch_album_art_fallback(req->generation, false);
 
-            // Assign to appropriate field
-            if (strcmp(frame_id, "TIT2") == 0 && temp[0]) {  // Title
-                copy_metadata_string(player.track_info.title, temp, sizeof(player.track_info.title));
-            } else if (strcmp(frame_id, "TPE1") == 0 && temp[0]) {  // Artist
-                copy_metadata_string(player.track_info.artist, temp, sizeof(player.track_info.artist));
-            } else if (strcmp(frame_id, "TALB") == 0 && temp[0]) {  // Album
-                copy_metadata_string(player.track_info.album, temp, sizeof(player.track_info.album));
-            }
-        }
-        // Process APIC frame (album art) - only if we don't already have art
-        else if (strcmp(frame_id, "APIC") == 0 && frame_size > 10 && player.album_art == NULL) {
-            const uint8_t* frame_data = &tag_data[pos];
-            uint8_t encoding = frame_data[0];
-            size_t offset = 1;
-
-            // Skip MIME type (null-terminated string)
-            while (offset < frame_size && frame_data[offset] != '\0') offset++;
-            offset++;  // Skip null terminator
-
-            if (offset < frame_size) {
-                uint8_t pic_type = frame_data[offset];
-                offset++;
-
-                // Skip description (null-terminated, encoding-dependent)
-                if (encoding == 1 || encoding == 2) {
-                    // UTF-16: look for double null
-                    while (offset + 1 < frame_size) {
-                        if (frame_data[offset] == 0 && frame_data[offset + 1] == 0) {
-                            offset += 2;
-                            break;
-                        }
-                        offset++;
-                    }
-                } else {
-                    // ISO-8859-1 or UTF-8: single null
-                    while (offset < frame_size && frame_data[offset] != '\0') offset++;
-                    offset++;
-                }
+done:
+    TRACE_END("load_thread");
+    free(req);
+    __atomic_sub_fetch(&player.load_workers, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int Player_loadAsync(const char* filepath, bool autoplay) {
+    return Player_loadAsyncRegion(filepath, NULL, autoplay);
+}
+
+static int load_async(const char* filepath, const TrackRegion* region, int position_ms, const SeekHint* hint,
+                      bool autoplay, bool paused) {
+    TRACE_SCOPE("Player_loadAsync");
+    if (!filepath || !player.audio_initialized) return -1;
+
+    // Use streaming playback for supported formats
+    AudioFormat format = Player_detectFormat(filepath);
+    if (format != AUDIO_FORMAT_MP3 && format != AUDIO_FORMAT_WAV &&
+        format != AUDIO_FORMAT_FLAC && format != AUDIO_FORMAT_OGG &&
+        format != AUDIO_FORMAT_M4A) {
+        LOG_error("Unsupported format for streaming: %s\n", filepath);
+        return -1;
+    }
 
-                // Now frame_data + offset points to the image data
-                if (offset < frame_size) {
-                    size_t image_size = frame_size - offset;
-                    const uint8_t* image_data = &frame_data[offset];
-
-                    // Prefer front cover (type 3), but accept any if we have none
-                    if (pic_type == 3 || player.album_art == NULL) {
-                        SDL_RWops* rw = SDL_RWFromConstMem(image_data, image_size);
-                        if (rw) {
-                            SDL_Surface* art = IMG_Load_RW(rw, 1);  // 1 = auto-close RWops
-                            if (art) {
-                                // Free previous art if we're replacing with front cover
-                                if (player.album_art) {
-                                    SDL_FreeSurface(player.album_art);
-                                }
-                                player.album_art = art;
-                            }
-                        }
-                    }
-                }
-            }
-        }
+    // Stop any current playback (also cancels an earlier load)
+    Player_stop();
 
-        pos += frame_size;
+    LoadRequest* req = malloc(sizeof(LoadRequest));
+    if (!req) return -1;
+    strncpy(req->filepath, filepath, sizeof(req->filepath) - 1);
+    req->filepath[sizeof(req->filepath) - 1] = '\0';
+    req->start_ms = (region ? region->start_ms : 0) + (position_ms > 0 ? position_ms : 0);
+    if (region && region->end_ms > 0 && req->start_ms >= region->end_ms) req->start_ms = region->start_ms;
+    if (hint) {
+        req->hint = *hint;
+    } else {
+        memset(&req->hint, 0, sizeof(req->hint));
+        req->hint.frame = -1;
     }
 
-    free(tag_data);
+    pthread_mutex_lock(&player.mutex);
+    set_track_file(filepath);
+    if (region) player.region = *region;
+    publish_loop();
+    player.format = format;
+    player.load_autoplay = autoplay;
+    player.load_paused = paused;
+    player.load_start_ms = req->start_ms;
+    player.load_failed = false;
+    player.state = PLAYER_STATE_LOADING;
+    req->generation = player.track_generation;
+    publish_snapshot();
+    pthread_mutex_unlock(&player.mutex);
 
+    pthread_t thread;
+    __atomic_add_fetch(&player.load_workers, 1, __ATOMIC_ACQ_REL);
+    if (pthread_create(&thread, NULL, load_thread_func, req) != 0) {
+        LOG_error("Failed to start load thread\n");
+        __atomic_sub_fetch(&player.load_workers, 1, __ATOMIC_RELEASE);
+        free(req);
+        pthread_mutex_lock(&player.mutex);
+        player.load_failed = true;
+        player.state = PLAYER_STATE_STOPPED;
+        publish_snapshot();
+        pthread_mutex_unlock(&player.mutex);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
 }
 
-// Parse MP3 metadata (ID3v2 first, then ID3v1 as fallback)
-static void parse_mp3_metadata(const char* filepath) {
-    // Try ID3v2 first (more modern, more info)
-    parse_id3v2(filepath);
+int Player_loadAsyncRegion(const char* filepath, const TrackRegion* region, bool autoplay) {
+    return load_async(filepath, region, 0, NULL, autoplay, false);
+}
 
-    // Fall back to ID3v1 for any missing fields
-    if (player.track_info.artist[0] == '\0' || player.track_info.album[0] == '\0') {
-        parse_id3v1(filepath);
-    }
+int Player_loadAsyncAt(const char* filepath, const TrackRegion* region, int position_ms, bool paused) {
+    return load_async(filepath, region, position_ms, NULL, !paused, paused);
 }
 
-// Parse M4A metadata from the already-opened decoder
-static void parse_m4a_metadata(void) {
-    if (player.stream_decoder.format != AUDIO_FORMAT_M4A || !player.stream_decoder.decoder) {
-        return;
-    }
+int Player_loadAsyncResume(const char* filepath, int position_ms, const SeekHint* hint) {
+    return load_async(filepath, NULL, position_ms, hint, true, false);
+}
 
-    M4ADecoder* m4a = (M4ADecoder*)player.stream_decoder.decoder;
+int Player_load(const char* filepath) {
+    TRACE_SCOPE("Player_load");
+    if (Player_loadAsync(filepath, false) != 0) return -1;
 
-    // Copy metadata from minimp4's parsed tags
-    if (m4a->mp4.tag.title && m4a->mp4.tag.title[0]) {
-        copy_metadata_string(player.track_info.title, (const char*)m4a->mp4.tag.title,
-                           sizeof(player.track_info.title));
+    while (Player_getState() == PLAYER_STATE_LOADING) {
+        Player_update();
+        usleep(10000);  // 10ms
     }
+    return player.load_failed ? -1 : 0;
+}
 
-    if (m4a->mp4.tag.artist && m4a->mp4.tag.artist[0]) {
-        copy_metadata_string(player.track_info.artist, (const char*)m4a->mp4.tag.artist,
-                           sizeof(player.track_info.artist));
-    }
+bool Player_loadFailed(void) {
+    return player.load_failed;
+}
 
-    if (m4a->mp4.tag.album && m4a->mp4.tag.album[0]) {
-        copy_metadata_string(player.track_info.album, (const char*)m4a->mp4.tag.album,
-                           sizeof(player.track_info.album));
+// Start streaming a decoder the load thread has opened (from Player_update)
+static void finish_async_load(void) {
+    pthread_mutex_lock(&player.mutex);
+    if (!player.load_ready) {
+        pthread_mutex_unlock(&player.mutex);
+        return;
+    }
+    player.stream_decoder = player.load_decoder;
+    memset(&player.load_decoder, 0, sizeof(player.load_decoder));
+    player.load_ready = false;
+    pthread_mutex_unlock(&player.mutex);
+    TRACE_SCOPE("start_streaming");
+
+    // A prefetched preroll lands in the buffer at once, start playing on a part of it
+    // instead of waiting for the decoder to fill the usual prebuffer
+    size_t preroll_frames = SIZE_MAX;
+    const StreamDecoder* sd = &player.stream_decoder;
+    if (sd->preroll && sd->preroll_format == stream_format_for(sd)) {
+        preroll_frames = sd->preroll_frames / 2;
     }
 
-    // Load cover art if present
-    if (m4a->mp4.tag.cover && m4a->mp4.tag.cover_size > 0 && player.album_art == NULL) {
-        SDL_RWops* rw = SDL_RWFromConstMem(m4a->mp4.tag.cover, m4a->mp4.tag.cover_size);
-        if (rw) {
-            SDL_Surface* art = IMG_Load_RW(rw, 1);  // 1 = auto-close RWops
-            if (art) {
-                player.album_art = art;
-            }
-        }
+    if (start_streaming() != 0) {
+        pthread_mutex_lock(&player.mutex);
+        player.load_failed = true;
+        player.state = PLAYER_STATE_STOPPED;
+        publish_snapshot();
+        pthread_mutex_unlock(&player.mutex);
+        return;
     }
-}
 
-// Parse Vorbis comments (for OGG and FLAC)
-static void parse_vorbis_comment(const char* comment) {
-    if (!comment) return;
+    pthread_mutex_lock(&player.mutex);
+    // The load thread already moved the decoder to the start position
+    set_position_ms(player.load_start_ms);
+    audio_position_samples = (int64_t)player.load_start_ms * current_sample_rate / 1000;
+    apply_region_info();
+    publish_snapshot();
+    player.load_prebuffering = true;
+    player.load_prebuffer_start = SDL_GetTicks();
+    // Prebuffer at the output rate start_streaming settled on
+    player.load_prebuffer_frames = (size_t)STREAM_PREBUFFER_MS * current_sample_rate / 1000;
+    if (preroll_frames < player.load_prebuffer_frames) player.load_prebuffer_frames = preroll_frames;
+    pthread_mutex_unlock(&player.mutex);
+
+    // Waveform overview comes from the cache or a low-priority background worker
+    waveform_request(player.current_file);
+}
 
-    // Vorbis comments are in format "KEY=VALUE"
-    const char* eq = strchr(comment, '=');
-    if (!eq) return;
+// Leave LOADING once ~0.5 seconds (less for a prefetched track) are buffered,
+// or after 1 second regardless
+static void check_prebuffer(void) {
+    if (!player.load_prebuffering) return;
+    if (circular_buffer_available(&player.stream_buffer) < player.load_prebuffer_frames &&
+        SDL_GetTicks() - player.load_prebuffer_start < 1000) {
+        return;
+    }
 
-    size_t key_len = eq - comment;
-    const char* value = eq + 1;
+    player.load_prebuffering = false;
+    pthread_mutex_lock(&player.mutex);
+    player.state = player.load_paused ? PLAYER_STATE_PAUSED : PLAYER_STATE_STOPPED;
+    publish_snapshot();
+    pthread_mutex_unlock(&player.mutex);
+    TRACE_INSTANT("prebuffered");
+    LATENCY_AUDIO_READY();
 
-    if (strncasecmp(comment, "TITLE", key_len) == 0 && key_len == 5) {
-        copy_metadata_string(player.track_info.title, value, sizeof(player.track_info.title));
-    } else if (strncasecmp(comment, "ARTIST", key_len) == 0 && key_len == 6) {
-        copy_metadata_string(player.track_info.artist, value, sizeof(player.track_info.artist));
-    } else if (strncasecmp(comment, "ALBUM", key_len) == 0 && key_len == 5) {
-        copy_metadata_string(player.track_info.album, value, sizeof(player.track_info.album));
+    if (player.load_autoplay) {
+        Player_play();
     }
 }
 
-// FLAC metadata callback
-static void flac_metadata_callback(void* pUserData, drflac_metadata* pMetadata) {
-    (void)pUserData;
+int Player_queueNext(const char* filepath) {
+    if (!filepath || !player.use_streaming) return -1;
 
-    if (pMetadata->type == DRFLAC_METADATA_BLOCK_TYPE_VORBIS_COMMENT) {
-        // Parse Vorbis comments
-        const drflac_vorbis_comment_iterator* comments = NULL;
-        uint32_t commentCount = pMetadata->data.vorbis_comment.commentCount;
-        const char* pComments = pMetadata->data.vorbis_comment.pComments;
+    AudioFormat format = Player_detectFormat(filepath);
+    if (format == AUDIO_FORMAT_UNKNOWN || format == AUDIO_FORMAT_MOD) return -1;
 
-        // Iterate through comments
-        for (uint32_t i = 0; i < commentCount; i++) {
-            uint32_t commentLength;
-            if (pComments) {
-                // Read comment length (little-endian 32-bit)
-                commentLength = *(const uint32_t*)pComments;
-                pComments += 4;
+    Player_clearNext();
 
-                // Create null-terminated copy
-                char* comment = malloc(commentLength + 1);
-                if (comment) {
-                    memcpy(comment, pComments, commentLength);
-                    comment[commentLength] = '\0';
-                    parse_vorbis_comment(comment);
-                    free(comment);
-                }
+    // Decode thread already moved to the previous queued track, wait for Player_update
+    if (__atomic_load_n(&player.next_state, __ATOMIC_ACQUIRE) != NEXT_TRACK_NONE) return -1;
 
-                pComments += commentLength;
-            }
-        }
+    strncpy(player.next_file, filepath, sizeof(player.next_file) - 1);
+    player.next_file[sizeof(player.next_file) - 1] = '\0';
+
+    __atomic_store_n(&player.next_state, NEXT_TRACK_OPENING, __ATOMIC_RELEASE);
+    if (pthread_create(&player.next_thread, NULL, next_open_thread_func, NULL) != 0) {
+        LOG_error("Failed to start next track open thread\n");
+        __atomic_store_n(&player.next_state, NEXT_TRACK_NONE, __ATOMIC_RELEASE);
+        return -1;
     }
+    player.next_thread_active = true;
+    return 0;
 }
 
-AudioFormat Player_detectFormat(const char* filepath) {
-    if (!filepath) return AUDIO_FORMAT_UNKNOWN;
-
-    const char* ext = strrchr(filepath, '.');
-    if (!ext) return AUDIO_FORMAT_UNKNOWN;
-    ext++; // Skip the dot
+void Player_clearNext(void) {
+    if (player.next_thread_active) {
+        pthread_join(player.next_thread, NULL);
+        player.next_thread_active = false;
+    }
 
-    if (strcasecmp(ext, "mp3") == 0) return AUDIO_FORMAT_MP3;
-    if (strcasecmp(ext, "wav") == 0) return AUDIO_FORMAT_WAV;
-    if (strcasecmp(ext, "ogg") == 0) return AUDIO_FORMAT_OGG;
-    if (strcasecmp(ext, "flac") == 0) return AUDIO_FORMAT_FLAC;
-    if (strcasecmp(ext, "m4a") == 0) return AUDIO_FORMAT_M4A;
-    if (strcasecmp(ext, "mod") == 0 || strcasecmp(ext, "xm") == 0 ||
-        strcasecmp(ext, "s3m") == 0 || strcasecmp(ext, "it") == 0) {
-        return AUDIO_FORMAT_MOD;
+    // Take the decoder back unless the decode thread has already claimed it
+    NextTrackState expected = NEXT_TRACK_READY;
+    if (__atomic_compare_exchange_n(&player.next_state, &expected, NEXT_TRACK_NONE,
+                                    false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        stream_decoder_close(&player.next_decoder);
+    } else if (expected == NEXT_TRACK_FAILED) {
+        __atomic_store_n(&player.next_state, NEXT_TRACK_NONE, __ATOMIC_RELEASE);
     }
+}
 
-    return AUDIO_FORMAT_UNKNOWN;
+bool Player_hasQueuedNext(void) {
+    NextTrackState next = __atomic_load_n(&player.next_state, __ATOMIC_ACQUIRE);
+    return next != NEXT_TRACK_NONE && next != NEXT_TRACK_FAILED;
 }
 
-// Reset audio device to default sample rate (for radio use)
-void Player_resetSampleRate(void) {
-    reconfigure_audio_device(get_target_sample_rate());
+void Player_setCrossfade(int seconds) {
+    if (seconds < 0) seconds = 0;
+    if (seconds > PLAYER_CROSSFADE_MAX_SECONDS) seconds = PLAYER_CROSSFADE_MAX_SECONDS;
+    player.crossfade_ms = seconds * 1000;  // Picked up by the decode thread at next track end
+    Settings_setInt(SETTING_CROSSFADE, seconds);
 }
 
-// Set audio device to specific sample rate
-void Player_setSampleRate(int sample_rate) {
-    if (sample_rate > 0) {
-        reconfigure_audio_device(sample_rate);
-    }
+int Player_getCrossfade(void) {
+    return player.crossfade_ms / 1000;
 }
 
-// Load file using streaming playback (decode on-the-fly)
-static int load_streaming(const char* filepath) {
-    // Open decoder
-    if (stream_decoder_open(&player.stream_decoder, filepath) != 0) {
-        return -1;
-    }
+void Player_setSpeed(int percent) {
+    if (percent < PLAYER_SPEED_MIN) percent = PLAYER_SPEED_MIN;
+    if (percent > PLAYER_SPEED_MAX) percent = PLAYER_SPEED_MAX;
+    if (percent == Player_getSpeed()) return;
+    __atomic_store_n(&player.speed_percent, percent, __ATOMIC_RELAXED);
+    Settings_setInt(SETTING_SPEED, percent);
 
-    // Initialize circular buffer
-    if (circular_buffer_init(&player.stream_buffer, STREAM_BUFFER_FRAMES) != 0) {
-        stream_decoder_close(&player.stream_decoder);
-        return -1;
-    }
+    // Decode what is buffered again, so the new speed is heard now
+    if (player.use_streaming && player.state != PLAYER_STATE_STOPPED) Player_seek(Player_getPosition());
+}
 
-    // Initialize resampler for streaming
-    int src_rate = player.stream_decoder.source_sample_rate;
-    int dst_rate = get_target_sample_rate();
+int Player_getSpeed(void) {
+    return __atomic_load_n(&player.speed_percent, __ATOMIC_RELAXED);
+}
 
-    if (src_rate != dst_rate) {
-        int error;
-        player.resampler = src_new(SRC_SINC_FASTEST, AUDIO_CHANNELS, &error);
-        if (!player.resampler) {
-            LOG_error("Stream: Failed to create resampler: %s\n", src_strerror(error));
-            circular_buffer_free(&player.stream_buffer);
-            stream_decoder_close(&player.stream_decoder);
-            return -1;
-        }
-    }
+void Player_setBitPerfect(bool enabled) {
+    player.bit_perfect = enabled;  // Applies from the next Player_load
+    Settings_setBool(SETTING_BIT_PERFECT, enabled);
+}
 
-    // Set track info
-    player.track_info.sample_rate = dst_rate;  // Output rate
-    player.track_info.channels = AUDIO_CHANNELS;
-    player.track_info.duration_ms = (int)((player.stream_decoder.total_frames * 1000) /
-                                          player.stream_decoder.source_sample_rate);
+bool Player_getBitPerfect(void) {
+    return player.bit_perfect;
+}
 
-    // Configure audio device at target rate (no reconfiguration needed later!)
-    reconfigure_audio_device(dst_rate);
+void Player_setFloatPipeline(bool enabled) {
+    player.float_pipeline = enabled;  // Applies from the next Player_load
+    Settings_setBool(SETTING_FLOAT_PIPELINE, enabled);
+}
 
-    // Start decode thread
-    player.stream_running = true;
-    player.stream_seeking = false;
-    player.stream_eof = false;
-    pthread_create(&player.stream_thread, NULL, stream_thread_func, NULL);
+bool Player_getFloatPipeline(void) {
+    return player.float_pipeline;
+}
 
-    // Pre-buffer some audio before returning (~0.5 seconds)
-    int prebuffer_timeout = 100;  // 100 * 10ms = 1 second max
-    while (circular_buffer_available(&player.stream_buffer) < STREAM_BUFFER_FRAMES / 6 &&
-           prebuffer_timeout > 0) {
-        usleep(10000);  // 10ms
-        prebuffer_timeout--;
-    }
+void Player_setEqualizerPreset(int preset) {
+    Equalizer_setPreset(preset);  // Picked up by the decode threads from their next chunk
+    Settings_setInt(SETTING_EQ_PRESET, Equalizer_getPreset());
+}
 
-    player.use_streaming = true;
-    player.format = player.stream_decoder.format;
+int Player_getEqualizerPreset(void) {
+    return Equalizer_getPreset();
+}
 
-    return 0;
+void Player_setNormalization(bool enabled) {
+    player.normalize = enabled;  // Applies from the next track
+    Settings_setBool(SETTING_NORMALIZE, enabled);
 }
 
-int Player_load(const char* filepath) {
-    if (!filepath || !player.audio_initialized) return -1;
+bool Player_getNormalization(void) {
+    return player.normalize;
+}
 
-    // Stop any current playback
-    Player_stop();
+void Player_setNativeRate(bool enabled) {
+    player.native_rate = enabled;  // Applies from the next Player_load
+    Settings_setBool(SETTING_NATIVE_RATE, enabled);
+}
 
-    int result = -1;
+bool Player_getNativeRate(void) {
+    return player.native_rate;
+}
 
-    pthread_mutex_lock(&player.mutex);
+int Player_getBufferedMs(void) {
+    if (!player.use_streaming || current_sample_rate <= 0) return 0;
+    return (int)((int64_t)circular_buffer_available(&player.stream_buffer) * 1000 / current_sample_rate);
+}
 
-    // Store filename
-    strncpy(player.current_file, filepath, sizeof(player.current_file) - 1);
+void Player_setPowerSave(bool enabled) {
+    if (__atomic_load_n(&player.power_save, __ATOMIC_RELAXED) == enabled) return;
+    __atomic_store_n(&player.power_save, enabled, __ATOMIC_RELEASE);
 
-    // Extract title from filename
-    const char* filename = strrchr(filepath, '/');
-    if (filename) filename++; else filename = filepath;
-    strncpy(player.track_info.title, filename, sizeof(player.track_info.title) - 1);
+    set_audio_buffer_samples(enabled ? AUDIO_SAMPLES_POWERSAVE : current_audio_profile()->period_samples);
 
-    // Remove extension from title
-    char* ext = strrchr(player.track_info.title, '.');
-    if (ext) *ext = '\0';
+    // Screen back on: the overview skipped while it was off
+    if (!enabled && waveform_deferred && player.current_file[0]) {
+        waveform_request(player.current_file);
+    }
 
-    // Clear artist/album
-    player.track_info.artist[0] = '\0';
-    player.track_info.album[0] = '\0';
+    // Decode thread picks up the new watermarks and CPU policy
+    if (player.stream_running) {
+        stream_wake();
+    }
+}
 
-    pthread_mutex_unlock(&player.mutex);
+void Player_getDecodeStats(PlayerDecodeStats* stats) {
+    stats->active = player.stream_running;
+    stats->refilling = __atomic_load_n(&player.stream_refilling, __ATOMIC_RELAXED);
+    stats->power_save = __atomic_load_n(&player.power_save, __ATOMIC_RELAXED);
+    stats->cpu_us = __atomic_load_n(&player.decode_cpu_us, __ATOMIC_RELAXED);
+    stats->output_frames = __atomic_load_n(&player.decode_output_frames, __ATOMIC_RELAXED);
+    stats->buffered_ms = Player_getBufferedMs();
+    stats->low_watermark_ms = current_sample_rate > 0 ?
+                              (int)((uint64_t)stream_low_watermark() * 1000 / current_sample_rate) : 0;
+    stats->sample_rate = current_sample_rate;
+}
 
-    // Use streaming playback for supported formats
-    AudioFormat format = Player_detectFormat(filepath);
-    if (format == AUDIO_FORMAT_MP3 || format == AUDIO_FORMAT_WAV ||
-        format == AUDIO_FORMAT_FLAC || format == AUDIO_FORMAT_OGG ||
-        format == AUDIO_FORMAT_M4A) {
-        result = load_streaming(filepath);
-
-        // Parse metadata for MP3
-        if (result == 0 && format == AUDIO_FORMAT_MP3) {
-            parse_mp3_metadata(filepath);
-        }
-        // Parse metadata for M4A
-        if (result == 0 && format == AUDIO_FORMAT_M4A) {
-            parse_m4a_metadata();
-        }
-
-        // If no embedded album art found, try to fetch from internet
-        if (result == 0 && player.album_art == NULL) {
-            const char* artist = player.track_info.artist[0] ? player.track_info.artist : NULL;
-            const char* title = player.track_info.title[0] ? player.track_info.title : NULL;
-            if (artist || title) {
-                radio_album_art_fetch(artist ? artist : "", title ? title : "");
-            }
-        }
+void Player_getStats(PlayerStats* stats) {
+    const PlaybackStats* st = &playback_stats;
+    int rate = current_sample_rate;
+
+    stats->callbacks = __atomic_load_n(&st->callbacks, __ATOMIC_RELAXED);
+    stats->underruns = __atomic_load_n(&st->underruns, __ATOMIC_RELAXED);
+    stats->silence_frames = __atomic_load_n(&st->silence_frames, __ATOMIC_RELAXED);
+    stats->trylock_misses = __atomic_load_n(&st->trylock_misses, __ATOMIC_RELAXED);
+
+    uint32_t fills = __atomic_load_n(&st->fill_samples, __ATOMIC_RELAXED);
+    size_t fill_min = __atomic_load_n(&st->fill_min_frames, __ATOMIC_RELAXED);
+    uint64_t fill_sum = __atomic_load_n(&st->fill_sum_frames, __ATOMIC_RELAXED);
+    stats->buffer_min_ms = (fills > 0 && fill_min != SIZE_MAX) ? (int)((uint64_t)fill_min * 1000 / rate) : 0;
+    stats->buffer_avg_ms = fills > 0 ? (int)(fill_sum / fills * 1000 / rate) : 0;
+
+    uint64_t chunks = __atomic_load_n(&st->decode_chunks, __ATOMIC_RELAXED) - st->decode_chunks_base;
+    uint64_t cpu = __atomic_load_n(&player.decode_cpu_us, __ATOMIC_RELAXED) - st->decode_cpu_base;
+    stats->decode_chunk_us = chunks > 0 ? (int)(cpu / chunks) : 0;
+
+    uint32_t intervals = __atomic_load_n(&st->intervals, __ATOMIC_RELAXED);
+    uint64_t interval_sum = __atomic_load_n(&st->interval_sum_us, __ATOMIC_RELAXED);
+    stats->callback_interval_us = intervals > 0 ? (int)(interval_sum / intervals) : 0;
+    stats->callback_jitter_us = (int)__atomic_load_n(&st->jitter_max_us, __ATOMIC_RELAXED);
+
+    // Buffer plan (read without the decode thread's cooperation, roughly consistent)
+    if (player.use_streaming && rate > 0) {
+        stats->buffer_low_ms = (int)((uint64_t)stream_low_watermark() * 1000 / rate);
+        stats->buffer_high_ms = (int)((uint64_t)stream_high_watermark() * 1000 / rate);
+        stats->buffer_capacity_kb = (int)(player.stream_buffer.capacity * player.stream_buffer.frame_bytes / 1024);
     } else {
-        LOG_error("Unsupported format for streaming: %s\n", filepath);
-        return -1;
+        stats->buffer_low_ms = stats->buffer_high_ms = stats->buffer_capacity_kb = 0;
     }
+    stats->read_stall_ms = (int)stream_read_stall_ms;
+    stats->decode_cost_pct = (int)(*stream_cost_slot(player.stream_decoder.format) * 100.0f);
+}
 
-    if (result == 0) {
-        pthread_mutex_lock(&player.mutex);
-        player.position_ms = 0;
-        audio_position_samples = 0;
-        player.state = PLAYER_STATE_STOPPED;
-        pthread_mutex_unlock(&player.mutex);
+void Player_resetStats(void) {
+    playback_stats.decode_chunks_base = __atomic_load_n(&playback_stats.decode_chunks, __ATOMIC_RELAXED);
+    playback_stats.decode_cpu_base = __atomic_load_n(&player.decode_cpu_us, __ATOMIC_RELAXED);
+    __atomic_store_n(&playback_stats.reset_pending, true, __ATOMIC_RELEASE);
+}
 
-        // Note: Waveform generation disabled for streaming mode
-        // (would require reading entire file which defeats the purpose)
-    }
+bool Player_takeAlbumArtChange(void) {
+    return __atomic_exchange_n(&player.art_changed, false, __ATOMIC_ACQ_REL);
+}
 
-    return result;
+bool Player_takeTrackChange(void) {
+    bool changed = player.track_change_pending;
+    player.track_change_pending = false;
+    return changed;
 }
 
 int Player_play(void) {
@@ -1656,6 +6309,7 @@ int Player_play(void) {
 
     pthread_mutex_lock(&player.mutex);
     player.state = PLAYER_STATE_PLAYING;
+    publish_snapshot();
     pthread_mutex_unlock(&player.mutex);
 
     SDL_PauseAudioDevice(player.audio_device, 0);
@@ -1667,47 +6321,75 @@ void Player_pause(void) {
     if (player.state == PLAYER_STATE_PLAYING) {
         player.state = PLAYER_STATE_PAUSED;
         SDL_PauseAudioDevice(player.audio_device, 1);
+        publish_snapshot();
     }
     pthread_mutex_unlock(&player.mutex);
 }
 
 void Player_stop(void) {
+    // Reads waiting on a download must not hold up the threads joined below
+    growing_interrupt();
+
     // Stop streaming thread first (before locking mutex to avoid deadlock)
     if (player.use_streaming && player.stream_running) {
-        player.stream_running = false;
+        stream_post(STREAM_CMD_STOP, 0);
+        stream_wake();
         pthread_join(player.stream_thread, NULL);
+        player.stream_running = false;
     }
 
+    // Cancel the waveform job before its result could land on the cleared state
+    waveform_stop();
+    waveform_deferred = false;
+
+    // Drop any queued next track (decode thread is gone, nothing can claim it now)
+    Player_clearNext();
+    __atomic_store_n(&player.next_state, NEXT_TRACK_NONE, __ATOMIC_RELEASE);
+    player.track_changed = false;
+    player.track_change_pending = false;
+
     pthread_mutex_lock(&player.mutex);
 
+    // Cancel any pending async load and stale album art lookups
+    __atomic_add_fetch(&player.track_generation, 1, __ATOMIC_ACQ_REL);
+    if (player.load_ready) {
+        stream_decoder_close(&player.load_decoder);
+        player.load_ready = false;
+    }
+    player.load_prebuffering = false;
+
     SDL_PauseAudioDevice(player.audio_device, 1);
 
     player.state = PLAYER_STATE_STOPPED;
-    player.position_ms = 0;
+    set_position_ms(0);
     audio_position_samples = 0;
 
     // Clean up streaming resources
     if (player.use_streaming) {
         stream_decoder_close(&player.stream_decoder);
         circular_buffer_free(&player.stream_buffer);
-        if (player.resampler) {
-            src_delete((SRC_STATE*)player.resampler);
-            player.resampler = NULL;
-        }
+        resampler_release(player.resampler);
+        player.resampler = NULL;
+        resampler_release(player.fade_resampler);
+        player.fade_resampler = NULL;
         player.use_streaming = false;
+        player.stream_format = PCM_FORMAT_S16;
     }
 
     memset(&player.track_info, 0, sizeof(TrackInfo));
+    memset(&player.region, 0, sizeof(TrackRegion));
+    player.ab_start_ms = -1;
+    publish_loop();
     player.current_file[0] = '\0';
+    publish_snapshot();
 
     // Clear waveform
     memset(&waveform, 0, sizeof(waveform));
 
     // Free album art
-    if (player.album_art) {
-        SDL_FreeSurface(player.album_art);
-        player.album_art = NULL;
-    }
+    set_album_art(NULL);
+    player.art_offset = 0;
+    player.art_decoding = false;
 
     // Clear any internet-fetched album art
     radio_album_art_clear();
@@ -1724,34 +6406,95 @@ void Player_togglePause(void) {
         player.state = PLAYER_STATE_PLAYING;
         SDL_PauseAudioDevice(player.audio_device, 0);
     }
+    publish_snapshot();
     pthread_mutex_unlock(&player.mutex);
 }
 
+// Region end in the file (mutex held or UI thread)
+static int region_end_ms(void) {
+    int end = player.track_info.duration_ms;
+    if (player.region.end_ms > 0 && player.region.end_ms < end) {
+        end = player.region.end_ms;
+    }
+    return end;
+}
+
 void Player_seek(int position_ms) {
     pthread_mutex_lock(&player.mutex);
-    if (position_ms < 0) position_ms = 0;
-    if (position_ms > player.track_info.duration_ms) {
-        position_ms = player.track_info.duration_ms;
+    // Region-relative to file position
+    position_ms += player.region.start_ms;
+    if (position_ms < player.region.start_ms) position_ms = player.region.start_ms;
+    if (position_ms > region_end_ms()) {
+        position_ms = region_end_ms();
+    }
+
+    // Decode thread already moved on to the next track, its audio isn't playing yet
+    if (__atomic_load_n(&player.next_state, __ATOMIC_ACQUIRE) == NEXT_TRACK_SWITCHED) {
+        pthread_mutex_unlock(&player.mutex);
+        return;
     }
 
     if (player.use_streaming) {
         // Streaming mode: signal decode thread to seek
         // Calculate target frame in source sample rate
-        int64_t target_frame = (int64_t)position_ms * player.stream_decoder.source_sample_rate / 1000;
-        player.seek_target_frame = target_frame;
-        player.stream_seeking = true;
+        stream_post(STREAM_CMD_SEEK, (int64_t)position_ms * player.stream_decoder.source_sample_rate / 1000);
+        stream_wake();
     }
 
-    player.position_ms = position_ms;
+    set_position_ms(position_ms);
     audio_position_samples = (int64_t)position_ms * current_sample_rate / 1000;
     pthread_mutex_unlock(&player.mutex);
 }
 
+void Player_previewSeek(int position_ms) {
+    if (position_ms < 0) {
+        __atomic_store_n(&player.seek_preview_ms, -1, __ATOMIC_RELEASE);
+        return;
+    }
+    int duration = Player_getDuration();
+    if (position_ms > duration) position_ms = duration;
+    __atomic_store_n(&player.seek_preview_ms, position_ms + player.region.start_ms, __ATOMIC_RELEASE);
+    if (player.use_streaming) stream_wake();
+}
+
+int Player_getSeekPreview(void) {
+    int preview_ms = __atomic_load_n(&player.seek_preview_ms, __ATOMIC_ACQUIRE);
+    if (preview_ms < 0) return -1;
+    uint64_t snap = __atomic_load_n(&player.seek_preview_snap, __ATOMIC_ACQUIRE);
+    if ((int)(snap >> 32) == preview_ms) preview_ms = (int)(uint32_t)snap;
+
+    // Snapping may cross the region edges of a cue track
+    preview_ms -= player.region.start_ms;
+    int duration = Player_getDuration();
+    if (preview_ms < 0) preview_ms = 0;
+    if (preview_ms > duration) preview_ms = duration;
+    return preview_ms;
+}
+
+void Player_requestSeekHint(int position_ms) {
+    if (position_ms < 0) position_ms = 0;
+    unsigned generation = __atomic_load_n(&player.track_generation, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&player.seek_hint_request, (uint64_t)generation << 32 | (uint32_t)position_ms,
+                     __ATOMIC_RELEASE);
+    if (player.use_streaming) stream_wake();
+}
+
+bool Player_takeSeekHint(int* position_ms, SeekHint* hint) {
+    SeekHintAnswer answer;
+    Seqlock_read(&seek_hint_lock, &answer, &seek_hint_answer, sizeof(answer));
+    unsigned generation = __atomic_load_n(&player.track_generation, __ATOMIC_ACQUIRE);
+    if (answer.request == 0 || (unsigned)(answer.request >> 32) != generation) return false;
+    *position_ms = (int)(uint32_t)answer.request;
+    *hint = answer.hint;
+    return true;
+}
+
 void Player_setVolume(float volume) {
     if (volume < 0.0f) volume = 0.0f;
     if (volume > 1.0f) volume = 1.0f;
     pthread_mutex_lock(&player.mutex);
     player.volume = volume;
+    __atomic_store_n(&target_gain_q15, volume_to_gain_q15(volume), __ATOMIC_RELAXED);
     pthread_mutex_unlock(&player.mutex);
 }
 
@@ -1763,34 +6506,86 @@ PlayerState Player_getState(void) {
     return player.state;
 }
 
+// What is being heard: the last output position carried forward to now, less the
+// audio still on its way out. Smooth between callbacks, no lock taken.
 int Player_getPosition(void) {
-    return player.position_ms;
+    uint64_t clock = __atomic_load_n(&player.output_clock, __ATOMIC_ACQUIRE);
+    int position = (int)(uint32_t)(clock >> 32);
+    if (player.state == PLAYER_STATE_PLAYING) {
+        uint32_t elapsed = (uint32_t)(monotonic_us() / 1000) - (uint32_t)clock;
+        if (elapsed > POSITION_EXTRAPOLATE_MAX_MS) elapsed = POSITION_EXTRAPOLATE_MAX_MS;   // Output stalled
+        int output_ms = (int)elapsed - __atomic_load_n(&output_latency_ms, __ATOMIC_RELAXED);
+        int speed = player.stream_format == PCM_FORMAT_S32 ? 100 : Player_getSpeed();
+        position += output_ms * speed / 100;    // Track time runs at the playback speed
+    }
+    position -= player.region.start_ms;
+    return position > 0 ? position : 0;
 }
 
 int Player_getDuration(void) {
-    return player.track_info.duration_ms;
+    int duration = region_end_ms() - player.region.start_ms;
+    return duration > 0 ? duration : 0;
 }
 
-const TrackInfo* Player_getTrackInfo(void) {
-    return &player.track_info;
+void Player_setRegion(const TrackRegion* region) {
+    pthread_mutex_lock(&player.mutex);
+    if (region) {
+        player.region = *region;
+    } else {
+        memset(&player.region, 0, sizeof(TrackRegion));
+    }
+    player.ab_start_ms = -1;    // Set within the track left
+    publish_loop();
+    apply_region_info();
+    publish_snapshot();
+    pthread_mutex_unlock(&player.mutex);
 }
 
-const char* Player_getCurrentFile(void) {
-    return player.current_file;
+bool Player_regionEnded(void) {
+    return player.region.end_ms > 0 && player.state == PLAYER_STATE_PLAYING &&
+           player.position_ms >= player.region.end_ms;
 }
 
-int Player_getVisBuffer(int16_t* buffer, int max_samples) {
-    if (!buffer || max_samples <= 0) return 0;
+void Player_setRepeat(bool repeat) {
+    pthread_mutex_lock(&player.mutex);
+    player.repeat = repeat;
+    publish_loop();
+    pthread_mutex_unlock(&player.mutex);
+}
 
-    pthread_mutex_lock(&player.vis_mutex);
-    int samples_to_copy = player.vis_buffer_pos;
-    if (samples_to_copy > max_samples) samples_to_copy = max_samples;
-    if (samples_to_copy > 0) {
-        memcpy(buffer, player.vis_buffer, samples_to_copy * sizeof(int16_t));
+void Player_setLoop(int a_ms, int b_ms) {
+    pthread_mutex_lock(&player.mutex);
+    // Region-relative to file time, kept inside the region
+    int start = player.region.start_ms + (a_ms > 0 ? a_ms : 0);
+    int end = player.region.start_ms + b_ms;
+    if (end > region_end_ms()) end = region_end_ms();
+    if (end > start) {
+        player.ab_start_ms = start;
+        player.ab_end_ms = end;
+    } else {
+        player.ab_start_ms = -1;
     }
-    pthread_mutex_unlock(&player.vis_mutex);
+    publish_loop();
+    pthread_mutex_unlock(&player.mutex);
+}
 
-    return samples_to_copy;
+void Player_clearLoop(void) {
+    pthread_mutex_lock(&player.mutex);
+    player.ab_start_ms = -1;
+    publish_loop();
+    pthread_mutex_unlock(&player.mutex);
+}
+
+bool Player_hasLoop(void) {
+    return player.ab_start_ms >= 0;
+}
+
+void Player_getSnapshot(PlayerSnapshot* out) {
+    Seqlock_read(&snapshot_lock, out, &snapshot, sizeof(PlayerSnapshot));
+}
+
+const char* Player_getCurrentFile(void) {
+    return player.current_file;
 }
 
 const WaveformData* Player_getWaveform(void) {
@@ -1802,13 +6597,55 @@ SDL_Surface* Player_getAlbumArt(void) {
     if (player.album_art) {
         return player.album_art;
     }
+    // Embedded cover located but not decoded yet: a view wants it now
+    if (player.art_offset != 0) {
+        start_album_art_decode();
+        return NULL;
+    }
     // Fallback to internet-fetched album art (from radio module)
     return radio_album_art_get();
 }
 
 void Player_update(void) {
-    // End-of-track detection is handled in the audio callback for streaming mode
-    // This function is kept for any future polling needs
+    // Async loads: start the stream once opened, report it loaded once prebuffered
+    finish_async_load();
+    check_prebuffer();
+
+    // End-of-track detection is handled in the audio callback for streaming mode.
+    // Here we only finalize gapless switches once the callback reports the boundary.
+    if (!__atomic_exchange_n(&player.track_changed, false, __ATOMIC_ACQ_REL)) return;
+
+    if (player.next_thread_active) {
+        pthread_join(player.next_thread, NULL);
+        player.next_thread_active = false;
+    }
+
+    pthread_mutex_lock(&player.mutex);
+    __atomic_add_fetch(&player.track_generation, 1, __ATOMIC_ACQ_REL);
+    set_track_file(player.next_file);
+    memset(&player.region, 0, sizeof(TrackRegion));
+    player.ab_start_ms = -1;
+    publish_loop();
+    player.format = player.stream_decoder.format;
+    player.track_info.duration_ms = (int)((player.stream_decoder.total_frames * 1000) /
+                                          player.stream_decoder.source_sample_rate);
+
+    // Replaces the previous track's album art
+    apply_metadata(&next_metadata);
+    publish_snapshot();
+    pthread_mutex_unlock(&player.mutex);
+
+    radio_album_art_clear();
+    start_album_art_fetch();
+
+    // Previous track's waveform no longer applies
+    waveform_stop();
+    pthread_mutex_lock(&player.mutex);
+    memset(&waveform, 0, sizeof(waveform));
+    pthread_mutex_unlock(&player.mutex);
+    waveform_request(player.current_file);
+
+    player.track_change_pending = true;
 }
 
 void Player_resumeAudio(void) {
@@ -1826,3 +6663,84 @@ void Player_pauseAudio(void) {
 bool Player_isBluetoothActive(void) {
     return bluetooth_audio_active;
 }
+
+#ifdef PLAYER_BENCH
+// ============ BENCHMARK ENTRY POINTS ============
+
+struct BenchDecoder {
+    StreamDecoder sd;
+};
+
+BenchDecoder* BenchDecoder_open(const char* path) {
+    BenchDecoder* decoder = calloc(1, sizeof(BenchDecoder));
+    if (!decoder) return NULL;
+    if (stream_decoder_open(&decoder->sd, path) != 0) {
+        free(decoder);
+        return NULL;
+    }
+    return decoder;
+}
+
+void BenchDecoder_close(BenchDecoder* decoder) {
+    if (!decoder) return;
+    stream_decoder_close(&decoder->sd);
+    free(decoder);
+}
+
+const char* BenchDecoder_format(const BenchDecoder* decoder) {
+    return decoder->sd.ops ? decoder->sd.ops->name : "unknown";
+}
+
+int BenchDecoder_sampleRate(const BenchDecoder* decoder) {
+    return decoder->sd.source_sample_rate;
+}
+
+int BenchDecoder_channels(const BenchDecoder* decoder) {
+    return decoder->sd.source_channels;
+}
+
+int64_t BenchDecoder_totalFrames(const BenchDecoder* decoder) {
+    return decoder->sd.total_frames;
+}
+
+size_t BenchDecoder_readS16(BenchDecoder* decoder, int16_t* buffer, size_t frames) {
+    return stream_decoder_read(&decoder->sd, buffer, frames);
+}
+
+size_t BenchDecoder_readF32(BenchDecoder* decoder, float* buffer, size_t frames) {
+    return stream_decoder_read_f32(&decoder->sd, buffer, frames);
+}
+
+int BenchDecoder_seek(BenchDecoder* decoder, int64_t frame) {
+    return stream_decoder_seek(&decoder->sd, frame);
+}
+
+void Bench_gainS16(int16_t* samples, size_t frames, int16_t gain_q15) {
+    current_gain_q15 = gain_q15;    // Steady state, no ramp
+    apply_gain_q15(samples, frames, gain_q15);
+}
+
+void Bench_gainF32(const float* in, int16_t* out, size_t frames, float gain) {
+    Pcm_f32ToS16Gain(in, out, frames, gain, 0.0f);
+}
+
+int Bench_detachAudio(int* sample_rate, int* period_frames, int* frame_bytes) {
+    if (player.audio_device == 0 || player.state != PLAYER_STATE_PLAYING) return -1;
+    SDL_CloseAudioDevice(player.audio_device);
+    player.audio_device = 0;
+
+    pthread_mutex_lock(&player.mutex);
+    player.repeat = true;
+    publish_loop();
+    pthread_mutex_unlock(&player.mutex);
+
+    *sample_rate = current_sample_rate;
+    *period_frames = audio_buffer_samples;
+    *frame_bytes = (int)((device_format == AUDIO_S32SYS ? sizeof(int32_t) : sizeof(int16_t)) * AUDIO_CHANNELS);
+    return 0;
+}
+
+void Bench_audioCallback(uint8_t* stream, int len) {
+    audio_callback(&player, stream, len);
+}
+#endif
@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <pthread.h>
 #include <SDL2/SDL.h>
+#include "circular_buffer.h"
+#include "jobs.h"
 
 // Audio format types
 typedef enum {
@@ -21,7 +23,8 @@ typedef enum {
 typedef enum {
     PLAYER_STATE_STOPPED = 0,
     PLAYER_STATE_PLAYING,
-    PLAYER_STATE_PAUSED
+    PLAYER_STATE_PAUSED,
+    PLAYER_STATE_LOADING    // Player_loadAsync in progress (opening or prebuffering)
 } PlayerState;
 
 // Track metadata
@@ -35,6 +38,23 @@ typedef struct {
     int bitrate;
 } TrackInfo;
 
+// Part of a file played as a track of its own (cue sheet), times in milliseconds
+typedef struct {
+    int start_ms;           // Offset of the track in the file
+    int end_ms;             // End offset, 0 = end of file
+    char title[256];        // Names replacing the file's tags when set
+    char artist[256];
+    char album[256];
+} TrackRegion;
+
+// What the UI shows of the player, copied out in one piece (Player_getSnapshot)
+typedef struct {
+    PlayerState state;
+    TrackInfo track;        // With the region's names for a cue track
+    char file[512];         // Current file ("" = none)
+    int duration_ms;        // Of the region playing
+} PlayerSnapshot;
+
 // Waveform overview data
 #define WAVEFORM_BARS 128  // Number of bars in waveform display
 typedef struct {
@@ -43,26 +63,74 @@ typedef struct {
     bool valid;
 } WaveformData;
 
+// Sample format of the stream buffer and audio device
+typedef enum {
+    PCM_FORMAT_S16 = 0,         // Normal pipeline: int16 stereo
+    PCM_FORMAT_S32,             // Bit-perfect pipeline: left-justified int32 stereo, untouched
+    PCM_FORMAT_F32              // Float pipeline: float stereo, converted to int16 once in the callback
+} PcmFormat;
+
 // Streaming decoder state (holds any decoder type)
 typedef struct {
     AudioFormat format;
     void* decoder;              // drmp3*, drwav*, drflac*, or stb_vorbis*
+    void* decoder_memory;       // Pooled arena the decoder runs in (OGG), or NULL
     int source_sample_rate;
     int source_channels;
+    int bits_per_sample;        // Source PCM depth (FLAC/PCM WAV), 0 for lossy formats
     int64_t total_frames;
     int64_t current_frame;
+    void* seek_table;           // Owned seek points bound to the decoder (MP3), page index (OGG/FLAC), or NULL
+    void* preroll;              // PCM decoded ahead by the prefetcher, played before the decoder's output
+    size_t preroll_frames;
+    size_t preroll_pos;         // Frames already handed out
+    PcmFormat preroll_format;
+    void* source;               // Reader of a file still being written (MP3), or NULL
+    void* input;                // ReadAhead the decoder reads its file through (FLAC/WAV/MP3), or NULL
+    void* parallel;             // Frame-parallel decoder of a hi-res FLAC stream, or NULL
+    const struct StreamDecoderOps* ops;     // Decoder of format (registry in player.c)
 } StreamDecoder;
 
-// Circular buffer for streaming playback
-#define STREAM_BUFFER_FRAMES (44100 * 3)  // ~3 seconds at 44.1kHz stereo (~500KB)
+// Stream buffer sizing
+// Normal playback sizes the ring per track from measured decode and read speed (see
+// the stream buffer plan in player.c); power save grows it to STREAM_BUFFER_FRAMES_POWERSAVE
+#define STREAM_BUFFER_FRAMES_POWERSAVE (1 << 21)  // ~45 seconds at 48kHz (~8MB)
+
+// Gapless next-track state
+typedef enum {
+    NEXT_TRACK_NONE = 0,        // Nothing queued
+    NEXT_TRACK_OPENING,         // Decoder being opened in background
+    NEXT_TRACK_READY,           // Decoder open, waiting for current track EOF
+    NEXT_TRACK_SWITCHING,       // Decode thread is swapping decoders
+    NEXT_TRACK_SWITCHED,        // Decode thread moved on, audio not yet at boundary
+    NEXT_TRACK_FAILED           // Open failed, end of track stops playback as usual
+} NextTrackState;
+
+// Commands to the decode thread (mailbox in player.c), taken oldest first
+typedef enum {
+    STREAM_CMD_STOP,            // Leave the decode loop
+    STREAM_CMD_RATE,            // Output rate changed: new resampler (posted before its seek)
+    STREAM_CMD_SEEK,            // arg: source frame
+    STREAM_CMD_NEXT,            // The next track finished opening: look at it again
+    STREAM_CMD_COUNT
+} StreamCommand;
+
+// One slot per command: a newer post replaces one not taken yet
 typedef struct {
-    int16_t* buffer;            // Stereo interleaved samples
-    size_t capacity;            // Total frames capacity
-    size_t write_pos;           // Write position (frames)
-    size_t read_pos;            // Read position (frames)
-    size_t available;           // Frames available to read
-    pthread_mutex_t mutex;
-} CircularBuffer;
+    int64_t arg;                // (atomic)
+    uint32_t posted;            // Sequence of the newest post (atomic)
+    uint32_t done;              // Sequence the decode thread last carried out (atomic)
+} StreamCommandSlot;
+
+// A decoder's seek index entry, kept so a later open can seek straight to it
+// (bookmarks). format tells whose entry it is; the bytes are that decoder's own
+// seek point, only meaningful for the file it came from.
+#define PLAYER_SEEK_HINT_BYTES 24
+typedef struct {
+    int64_t frame;              // Source frame the entry lands on (-1 = none)
+    uint8_t format;             // AudioFormat
+    uint8_t entry[PLAYER_SEEK_HINT_BYTES];
+} SeekHint;
 
 // Player context
 typedef struct {
@@ -73,19 +141,25 @@ typedef struct {
     // Current track
     char current_file[512];
     TrackInfo track_info;
+    TrackRegion region;     // Track within current_file (zeroed = whole file)
 
     // Album art
     SDL_Surface* album_art;     // Cached album art surface (NULL if none)
+    long art_offset;            // Embedded cover not decoded yet: image offset in current_file (0 = none)
+    uint32_t art_size;          // ...and its length in bytes
+    uint64_t art_key;           // ...and its in-memory cache key (shared by identical covers)
+    bool art_decoding;          // Background decode of the embedded cover in flight
+    bool art_changed;           // album_art arrived in the background (see Player_takeAlbumArtChange)
 
     // Playback
-    int position_ms;        // Current position in milliseconds
+    int position_ms;        // Current position in milliseconds (file time, see set_position_ms)
+    uint64_t output_clock;  // position_ms << 32 | monotonic ms it was output at (atomic)
     float volume;           // 0.0 to 1.0
-    bool repeat;            // Loop current track
-
-    // Audio buffer for visualization
-    int16_t vis_buffer[2048];  // Stereo samples for FFT
-    int vis_buffer_pos;
-    pthread_mutex_t vis_mutex;
+    bool repeat;            // Loop current track (or region), see Player_setRepeat
+    int ab_start_ms;        // A-B loop, file time (-1 = none)
+    int ab_end_ms;
+    int loop_start_ms;      // Loop the decode thread splices: the A-B loop, else the repeated
+    int loop_end_ms;        // region, file time (atomic, start -1 = none, end 0 = end of file)
 
     // SDL Audio
     int audio_device;
@@ -94,18 +168,98 @@ typedef struct {
     // Streaming playback
     StreamDecoder stream_decoder;
     CircularBuffer stream_buffer;
-    void* resampler;            // SRC_STATE* for libsamplerate
+    void* resampler;            // Resampler* (NULL while the track plays at the device rate)
     pthread_t stream_thread;
-    bool stream_running;
-    bool stream_seeking;        // Flag when seek is requested
-    int64_t seek_target_frame;  // Target frame for seeking
+    bool stream_running;        // Decode thread started and not joined yet (main thread)
+    StreamCommandSlot stream_cmds[STREAM_CMD_COUNT];  // Mailbox of the decode thread
+    uint32_t stream_cmd_seq;    // Last command sequence handed out (atomic)
+    int seek_preview_ms;        // Scrub target to snap to the seek index, file time (atomic, -1 = none)
+    uint64_t seek_preview_snap; // Request ms << 32 | snapped ms, written by the decode thread (atomic)
+    uint64_t seek_hint_request; // Generation << 32 | file ms to describe a seek hint for (atomic, 0 = none)
     bool use_streaming;         // True if using streaming mode
-    bool stream_eof;            // True when decoder has reached end of file
+    bool stream_eof;            // True when decoder has reached end of file (atomic)
+    pthread_mutex_t stream_wake_mutex;
+    pthread_cond_t stream_wake_cond;  // Wakes the decode thread (low watermark, seek, stop)
+    bool stream_wake_pending;   // Wake requested since the decode thread last woke
+    bool stream_idle;           // Decode thread is waiting for a wake (atomic)
+    bool power_save;            // Screen off: burst-decode into the large buffer (atomic)
+    bool stream_refilling;      // Decode thread is in a refill burst (atomic)
+    uint64_t decode_cpu_us;     // Decode thread CPU time spent producing audio (atomic)
+    uint64_t decode_output_frames;  // Frames written to stream_buffer (atomic)
+    size_t stream_low_frames;   // Planned refill watermarks for normal playback (atomic)
+    size_t stream_high_frames;
+
+    // Gapless playback (next track pre-opened while current one plays)
+    StreamDecoder next_decoder;
+    char next_file[512];
+    pthread_t next_thread;      // Opens next_decoder in the background
+    bool next_thread_active;    // next_thread needs joining
+    NextTrackState next_state;  // Accessed atomically (decode thread / audio callback)
+    size_t next_boundary;       // stream_buffer write position where next track starts
+    bool track_changed;         // Audio crossed next_boundary, finalized in Player_update
+    bool track_change_pending;  // Reported once through Player_takeTrackChange
+
+    // Output mode
+    bool native_rate;           // Open the device at the track's rate when the sink allows it
+    bool bit_perfect;           // USB DAC: pass hi-res FLAC/WAV through as 32-bit at native rate
+    bool float_pipeline;        // Keep PCM as float from decoder to the final output stage
+    bool normalize;             // Loudness normalization (ReplayGain tags or R128 scan)
+    PcmFormat stream_format;    // Format of stream_buffer and the device for the current stream
+
+    // Crossfade between queued tracks (0 = plain gapless)
+    int crossfade_ms;
+    void* fade_resampler;       // Resampler* for the second stream during a crossfade
+
+    // Playback speed of local files in percent, 100 = normal (atomic)
+    int speed_percent;
+
+    // Asynchronous loading (decoder opened off the UI thread, started in Player_update)
+    StreamDecoder load_decoder;     // Opened by the load thread, waiting for Player_update
+    bool load_ready;                // load_decoder is ready to start
+    bool load_autoplay;             // Start playing once prebuffered
+    bool load_paused;               // End up PAUSED instead of STOPPED once prebuffered
+    int load_start_ms;              // File position the load thread seeks to
+    bool load_failed;               // Last load could not open the file
+    bool load_prebuffering;         // Decode thread running, waiting for prebuffer
+    uint32_t load_prebuffer_start;  // SDL_GetTicks() when prebuffering started
+    size_t load_prebuffer_frames;   // Buffered frames that end prebuffering
+    unsigned track_generation;      // Bumped whenever the current track changes (stale work check)
+    int load_workers;               // Running load threads and album art jobs (atomic)
 
     // Threading
     pthread_mutex_t mutex;
 } PlayerContext;
 
+// Decode thread statistics (cumulative counters, for the CPU governor)
+typedef struct {
+    bool active;                // Decode thread running
+    bool refilling;             // Currently in a refill burst
+    bool power_save;            // Power-save watermarks in effect
+    uint64_t cpu_us;            // Decode thread CPU time spent producing audio
+    uint64_t output_frames;     // Output frames produced
+    int buffered_ms;            // Audio buffered ahead of playback
+    int low_watermark_ms;       // Refill starts below this fill level
+    int sample_rate;            // Output rate of output_frames
+} PlayerDecodeStats;
+
+// Playback telemetry (since Player_init or the last Player_resetStats)
+typedef struct {
+    uint32_t callbacks;         // Audio callbacks run
+    uint32_t underruns;         // Callbacks the stream buffer couldn't fill mid-track
+    uint64_t silence_frames;    // Frames filled with silence by those underruns
+    uint32_t trylock_misses;    // Callbacks that output silence because player.mutex was busy
+    int buffer_min_ms;          // Lowest stream buffer fill seen by the callback
+    int buffer_avg_ms;          // Average stream buffer fill seen by the callback
+    int decode_chunk_us;        // Average decode thread CPU time per decoded chunk
+    int callback_interval_us;   // Average time between audio callbacks
+    int callback_jitter_us;     // Largest deviation from the expected callback interval
+    int buffer_low_ms;          // Current refill watermarks (power save ones while it's on)
+    int buffer_high_ms;
+    int buffer_capacity_kb;     // Stream ring allocation
+    int read_stall_ms;          // Worst recent decode chunk wait beyond its CPU time (storage)
+    int decode_cost_pct;        // Decode time per audio time of the current format, in percent
+} PlayerStats;
+
 // Initialize the player
 int Player_init(void);
 
@@ -113,8 +267,52 @@ int Player_init(void);
 void Player_quit(void);
 
 // Load a file (does not start playing)
+// Blocks until the file is opened and prebuffered, prefer Player_loadAsync from the UI
 int Player_load(const char* filepath);
 
+// Start loading a file in the background and return immediately
+// State is PLAYER_STATE_LOADING until Player_update has the stream prebuffered, then
+// PLAYING (autoplay) or STOPPED. A newer load or Player_stop cancels an earlier one.
+// Returns -1 if the format is unsupported.
+int Player_loadAsync(const char* filepath, bool autoplay);
+
+// Like Player_loadAsync, but plays only a region of the file (see Player_setRegion)
+// The decoder starts at the region start, region may be NULL for the whole file.
+int Player_loadAsyncRegion(const char* filepath, const TrackRegion* region, bool autoplay);
+
+// Like Player_loadAsyncRegion, starting position_ms into the region. The load
+// thread seeks before the first decode (through the seek index where the format
+// has one), so playback resumes without decoding from the start. Plays once
+// prebuffered, or with paused set waits there in PLAYER_STATE_PAUSED.
+int Player_loadAsyncAt(const char* filepath, const TrackRegion* region, int position_ms, bool paused);
+
+// Like Player_loadAsync (autoplay), resuming at position_ms through a seek hint
+// saved from an earlier play of the file (NULL or a stale hint: a plain seek)
+int Player_loadAsyncResume(const char* filepath, int position_ms, const SeekHint* hint);
+
+// Switch the region of the loaded file that position, duration and seeks refer to
+// Playback is not moved (seek to 0 to jump to the region start), NULL = whole file.
+// Reset on every load and gapless track change.
+void Player_setRegion(const TrackRegion* region);
+
+// True while playback is past the end of a region that ends before the file does
+bool Player_regionEnded(void);
+
+// Loop the current track (or region) without a gap: at its end the decode thread
+// splices its pre-decoded start back in instead of ending the track
+void Player_setRepeat(bool repeat);
+
+// Loop between a_ms and b_ms into the track (region-relative, like Player_seek),
+// gaplessly like repeat and ahead of it. Cleared whenever the track or region changes.
+void Player_setLoop(int a_ms, int b_ms);
+void Player_clearLoop(void);
+
+// True while an A-B loop is set
+bool Player_hasLoop(void);
+
+// True if the most recent load failed to open its file
+bool Player_loadFailed(void);
+
 // Start/resume playback
 int Player_play(void);
 
@@ -130,6 +328,23 @@ void Player_togglePause(void);
 // Seek to position (in milliseconds)
 void Player_seek(int position_ms);
 
+// Preview a scrub target (in milliseconds, -1 = scrubbing ended) without seeking
+// The decode thread snaps it to the nearest seek index entry.
+void Player_previewSeek(int position_ms);
+
+// The previewed target snapped to the seek index, or as given until the decode
+// thread has answered (-1 = no preview)
+int Player_getSeekPreview(void);
+
+// Ask the decode thread for the seek index entry at or before position_ms of
+// the current track; a later Player_takeSeekHint picks up the answer
+void Player_requestSeekHint(int position_ms);
+
+// The answer to the last request, if it came for the track still playing
+// position_ms: what was asked for (file time). hint->frame is -1 where the
+// format or track has no index entry there.
+bool Player_takeSeekHint(int* position_ms, SeekHint* hint);
+
 // Set volume (0.0 to 1.0)
 void Player_setVolume(float volume);
 
@@ -139,34 +354,167 @@ float Player_getVolume(void);
 // Get current state
 PlayerState Player_getState(void);
 
+// Milliseconds of decoded audio buffered ahead of playback
+int Player_getBufferedMs(void);
+
+// Power-saving playback for when the screen is off: decodes ~45 seconds at a time
+// and sleeps until the next refill (the governor runs refills at full CPU speed).
+// Also uses a larger audio device buffer to cut callback frequency, and puts off
+// the waveform overview of tracks started meanwhile until it is turned off.
+void Player_setPowerSave(bool enabled);
+
+// Snapshot of decode thread statistics
+void Player_getDecodeStats(PlayerDecodeStats* stats);
+
+// Snapshot of playback telemetry (underruns, buffer fill, decode cost, callback timing)
+void Player_getStats(PlayerStats* stats);
+
+// Restart telemetry counters (applied by the audio callback on its next run)
+void Player_resetStats(void);
+
 // Get current position in milliseconds
 int Player_getPosition(void);
 
 // Get track duration in milliseconds
 int Player_getDuration(void);
 
-// Get track info
-const TrackInfo* Player_getTrackInfo(void);
+// Copy the state, track info, file and duration as one consistent set, without
+// a lock (the UI reads this once per frame)
+void Player_getSnapshot(PlayerSnapshot* snapshot);
 
 // Get current file path
 const char* Player_getCurrentFile(void);
 
-// Get visualization buffer (for spectrum analyzer)
-// Returns number of samples copied
-int Player_getVisBuffer(int16_t* buffer, int max_samples);
-
 // Get waveform overview data (for static waveform progress display)
 const WaveformData* Player_getWaveform(void);
 
 // Get album art surface (NULL if no album art available)
+// An embedded cover is decoded in the background on the first call, NULL until then
 SDL_Surface* Player_getAlbumArt(void);
 
-// Check if a file format is supported
+// True once after album art was decoded in the background (redraw to show it)
+bool Player_takeAlbumArtChange(void);
+
+// Format a file name stands for (by extension, no file access)
 AudioFormat Player_detectFormat(const char* filepath);
 
+// Format of a file by its first bytes (past an ID3v2 tag), falling back to the
+// extension when they aren't recognized; AUDIO_FORMAT_UNKNOWN for a container
+// without a decoder (e.g. Opus in Ogg). Reads the file: not for directory listings.
+AudioFormat Player_probeFormat(const char* filepath);
+
+// Tags of a file read without loading it (library scanner, any thread)
+typedef struct {
+    TrackInfo info;             // Title (file name if untagged), artist, album, duration_ms, sample_rate
+    float replaygain_db;        // Gain to the ReplayGain reference (tag or cached scan)
+    bool has_replaygain;
+    long art_offset;            // Embedded cover in the file: ID3, FLAC or M4A (0 = none)
+    uint32_t art_size;
+} PlayerFileTags;
+
+// Opens its own decoder for the duration (safe from several threads at once);
+// embedded covers are located, not decoded
+// Returns -1 if the file can't be opened.
+int Player_readFileTags(const char* filepath, PlayerFileTags* tags);
+
 // Update player (call this in main loop)
+// Starts async loads once opened and finalizes gapless track switches
 void Player_update(void);
 
+// Play a file a download is still writing (duration_ms = expected length)
+// Reads of it wait for more data instead of ending the track at the current end
+// of the file, until Player_endGrowingFile. MP3 only: it needs no index up front.
+void Player_setGrowingFile(const char* filepath, int duration_ms);
+
+// The writer is done (or gave up): reads see the file's real end again
+void Player_endGrowingFile(void);
+
+// Queue the track to play after the current one (gapless)
+// The decoder is opened in the background and swapped in at end of track,
+// keeping the audio device and stream buffer alive. Replaces any queued track.
+int Player_queueNext(const char* filepath);
+
+// Open upcoming tracks ahead of time, in play order (up to PLAYER_PREFETCH_MAX)
+// A background worker opens each file, parses its tags and decodes its first second,
+// so Player_loadAsync / Player_queueNext on one of them skip the cold open.
+// Tracks no longer listed are dropped, count 0 releases the whole cache.
+#define PLAYER_PREFETCH_MAX 3
+void Player_prefetch(const char* const* filepaths, int count);
+
+// Close the prefetched tracks (memory is short); they are opened cold when played,
+// and not again until the upcoming tracks change. Playback and the queued next
+// track are untouched. Returns the number closed.
+int Player_shedPrefetch(void);
+
+// Drop the queued next track (if the decode thread hasn't switched to it yet)
+void Player_clearNext(void);
+
+// Check if a next track is queued
+bool Player_hasQueuedNext(void);
+
+// Returns true once after playback has moved on to the queued track
+bool Player_takeTrackChange(void);
+
+// Crossfade window between queued tracks in seconds (0 = gapless, no fade)
+#define PLAYER_CROSSFADE_MAX_SECONDS 12
+void Player_setCrossfade(int seconds);
+int Player_getCrossfade(void);
+
+// Playback speed of local files in percent, pitch kept (time stretching on the
+// decode thread). Takes effect at once, the buffered audio is decoded again.
+// Bit-perfect streams always play at 100. Saved with the player settings.
+#define PLAYER_SPEED_MIN 50
+#define PLAYER_SPEED_MAX 200
+void Player_setSpeed(int percent);
+int Player_getSpeed(void);
+
+// Native-rate output: play each track at its own sample rate when the sink accepts it,
+// resampling only as a fallback (Bluetooth always uses its fixed rate). On by default.
+// Gapless/crossfaded tracks keep the device rate of the track that started playback.
+void Player_setNativeRate(bool enabled);
+bool Player_getNativeRate(void);
+
+// Bit-perfect USB DAC output: hi-res (>16-bit) FLAC and PCM WAV are sent to the DAC
+// as 32-bit samples at their native rate, with no resampling, software volume or
+// crossfade. Falls back to the normal pipeline if the DAC rejects the format or rate.
+// Off by default; applies from the next Player_load.
+void Player_setBitPerfect(bool enabled);
+bool Player_getBitPerfect(void);
+
+// Float pipeline: decoders output float, which goes through the resampler, crossfade
+// and volume unrounded and is converted to the device's int16 exactly once.
+// Off by default (doubles stream buffer memory); applies from the next Player_load.
+void Player_setFloatPipeline(bool enabled);
+bool Player_getFloatPipeline(void);
+
+// Equalizer preset (EqualizerPreset from equalizer.h, EQ_PRESET_FLAT = off) for
+// local files and radio. Applies to the audio decoded from now on; bypassed in
+// bit-perfect mode. Saved with the player settings.
+void Player_setEqualizerPreset(int preset);
+int Player_getEqualizerPreset(void);
+
+// Loudness normalization: tracks are attenuated to the ReplayGain 2.0 reference
+// (-18 LUFS) using their REPLAYGAIN_TRACK_GAIN/ALBUM_GAIN tags, or an EBU R128
+// measurement for untagged files (made in the background and cached). Attenuation
+// only, the gain stage can't boost past unity. On by default; applies from the next
+// track and is bypassed in bit-perfect mode.
+void Player_setNormalization(bool enabled);
+bool Player_getNormalization(void);
+
+// Queue files for the background loudness scan (replaces the pending queue)
+// Files with ReplayGain tags or a cached measurement are skipped.
+void Player_scanLoudness(const char* const* filepaths, int count);
+
+// Idle-time maintenance of one file (worker): build what its first play would,
+// skipping what is cached already: the seek index (OGG and FLAC ones on a job of
+// their own), the loudness measurement (with normalization on) and the waveform
+// overview. Stops between steps, and within the overview, once token is cancelled.
+void Player_maintainFile(const char* filepath, JobToken* token);
+
+// Delete the per-file cache entries (seek indexes, waveforms, loudness) of files
+// that are gone or changed (worker). Returns the number deleted.
+int Player_compactCaches(JobToken* token);
+
 // Resume/pause audio device (used by radio module)
 void Player_resumeAudio(void);
 void Player_pauseAudio(void);
@@ -177,6 +525,9 @@ void Player_resetSampleRate(void);
 // Set audio device to specific sample rate
 void Player_setSampleRate(int sample_rate);
 
+// Current sample rate of the audio device (radio resamples its streams to it)
+int Player_getSampleRate(void);
+
 // Check if Bluetooth audio is currently active
 bool Player_isBluetoothActive(void);
 
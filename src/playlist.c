@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "playlist.h"
+
+#define PLAYLIST_LINE_MAX 1024
+
+bool Playlist_isPlaylistFile(const char* filename) {
+    const char* ext = strrchr(filename, '.');
+    if (!ext) return false;
+    return strcasecmp(ext, ".m3u") == 0 || strcasecmp(ext, ".m3u8") == 0 || strcasecmp(ext, ".pls") == 0;
+}
+
+// Item text of a playlist line, NULL if the line holds none
+static char* parse_line(char* line, bool pls) {
+    // Trim whitespace and the line ending (playlists from Windows end in \r\n)
+    while (isspace((unsigned char)*line)) line++;
+    size_t len = strlen(line);
+    while (len > 0 && isspace((unsigned char)line[len - 1])) line[--len] = '\0';
+    if (len == 0) return NULL;
+
+    if (pls) {
+        // FileN=path, everything else (TitleN, LengthN, [playlist]) is metadata
+        if (strncasecmp(line, "file", 4) != 0 || !isdigit((unsigned char)line[4])) return NULL;
+        char* eq = strchr(line, '=');
+        if (!eq) return NULL;
+        line = eq + 1;
+    } else if (line[0] == '#') {
+        return NULL;  // #EXTM3U, #EXTINF and comments
+    }
+
+    if (strncasecmp(line, "file://", 7) == 0) {
+        line += 7;
+    } else if (strstr(line, "://")) {
+        return NULL;  // Streams belong to the radio
+    }
+    return line[0] ? line : NULL;
+}
+
+int Playlist_read(const char* path, PlaylistItemFunc func, void* userdata) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+
+    const char* ext = strrchr(path, '.');
+    bool pls = ext && strcasecmp(ext, ".pls") == 0;
+    char line[PLAYLIST_LINE_MAX];
+    bool first = true;
+    int count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            // Longer than any path: drop the rest of it
+            int c;
+            while ((c = fgetc(f)) != EOF && c != '\n') {}
+            continue;
+        }
+
+        char* text = line;
+        if (first && memcmp(text, "\xEF\xBB\xBF", 3) == 0) text += 3;  // UTF-8 BOM (m3u8)
+        first = false;
+
+        char* item = parse_line(text, pls);
+        if (!item) continue;
+        func(item, userdata);
+        count++;
+    }
+    fclose(f);
+    return count;
+}
+
+void Playlist_resolve(const char* playlist_path, const char* item, char* out, int max_len) {
+    char name[PLAYLIST_LINE_MAX];
+    snprintf(name, sizeof(name), "%s", item);
+    for (char* p = name; *p; p++) {
+        if (*p == '\\') *p = '/';
+    }
+
+    if (name[0] == '/') {
+        snprintf(out, max_len, "%s", name);
+        return;
+    }
+
+    const char* relative = name;
+    while (strncmp(relative, "./", 2) == 0) relative += 2;
+    const char* slash = strrchr(playlist_path, '/');
+    int dir_len = slash ? (int)(slash - playlist_path) : 0;
+    snprintf(out, max_len, "%.*s/%s", dir_len, playlist_path, relative);
+}
@@ -0,0 +1,23 @@
+#ifndef __PLAYLIST_H__
+#define __PLAYLIST_H__
+
+#include <stdbool.h>
+
+// Playlist files (M3U, M3U8, PLS)
+// Items are kept as written in the file and only resolved to a path when one
+// is needed, so opening a long playlist doesn't touch the files it lists.
+
+// True for .m3u, .m3u8 and .pls files
+bool Playlist_isPlaylistFile(const char* filename);
+
+// Called for each item, in file order
+typedef void (*PlaylistItemFunc)(const char* item, void* userdata);
+
+// Stream the items of a playlist file line by line (comments and stream URLs skipped)
+// Returns the number of items, -1 if the file can't be opened.
+int Playlist_read(const char* path, PlaylistItemFunc func, void* userdata);
+
+// Full path of an item: relative items are relative to the playlist's folder
+void Playlist_resolve(const char* playlist_path, const char* item, char* out, int max_len);
+
+#endif
@@ -0,0 +1,238 @@
+#ifdef UI_PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "profile.h"
+
+#define PROFILE_WINDOW_US 1000000
+#define PROFILE_FRAMES_MAX 256          // Frame times kept per window
+#define PROFILE_TASKS_MAX 64            // Threads tracked between windows
+
+typedef struct {
+    const char* name;
+    uint64_t total_us;
+    uint32_t calls;
+    uint32_t max_us;
+} SectionAccum;
+
+typedef struct {
+    int tid;
+    uint64_t ticks;                     // utime + stime
+    char name[16];
+    bool seen;
+} TaskSample;
+
+static SectionAccum sections[PROFILE_SECTIONS_MAX];
+static int section_count = 0;
+static uint32_t frame_us[PROFILE_FRAMES_MAX];
+static uint32_t frame_count = 0;
+static uint32_t frame_max_us = 0;
+static uint32_t idle_count = 0;
+static uint64_t frame_start_us = 0;
+static uint64_t window_start_us = 0;
+static TaskSample tasks[PROFILE_TASKS_MAX];
+static int task_count = 0;
+static ProfileReport report;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Sections are identified by their name's address; the string compare only
+// runs for a name seen through another pointer
+static int find_section(const char* name) {
+    for (int i = 0; i < section_count; i++) {
+        if (sections[i].name == name) return i;
+    }
+    for (int i = 0; i < section_count; i++) {
+        if (strcmp(sections[i].name, name) == 0) return i;
+    }
+    if (section_count == PROFILE_SECTIONS_MAX) return -1;
+    sections[section_count].name = name;
+    return section_count++;
+}
+
+ProfileScope Profile_beginScope(const char* name) {
+    ProfileScope scope = {find_section(name), now_us()};
+    return scope;
+}
+
+void Profile_endScope(ProfileScope* scope) {
+    if (scope->section < 0) return;
+    uint32_t us = (uint32_t)(now_us() - scope->start_us);
+    SectionAccum* s = &sections[scope->section];
+    s->total_us += us;
+    s->calls++;
+    if (us > s->max_us) s->max_us = us;
+}
+
+void Profile_frameBegin(void) {
+    frame_start_us = now_us();
+}
+
+void Profile_frameEnd(bool drew) {
+    if (!drew) {
+        idle_count++;
+        return;
+    }
+    uint32_t us = (uint32_t)(now_us() - frame_start_us);
+    if (frame_count < PROFILE_FRAMES_MAX) frame_us[frame_count] = us;
+    frame_count++;
+    if (us > frame_max_us) frame_max_us = us;
+}
+
+static int compare_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static int compare_threads(const void* a, const void* b) {
+    float x = ((const ProfileThread*)a)->cpu, y = ((const ProfileThread*)b)->cpu;
+    return x > y ? -1 : x < y;
+}
+
+// Read a thread's name and CPU ticks from /proc/self/task/<tid>/stat
+static bool read_task(int tid, char* name, int name_size, uint64_t* ticks) {
+    char path[64], line[512];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+    bool ok = fgets(line, sizeof(line), f) != NULL;
+    fclose(f);
+    if (!ok) return false;
+
+    // "tid (comm) state ..." - comm may hold spaces and parentheses
+    char* open = strchr(line, '(');
+    char* close = strrchr(line, ')');
+    if (!open || !close || close < open) return false;
+    int len = (int)(close - open - 1);
+    if (len >= name_size) len = name_size - 1;
+    memcpy(name, open + 1, len);
+    name[len] = '\0';
+
+    // Fields 14 and 15 (utime, stime) counted from the state, field 3
+    char* p = close + 2;
+    unsigned long long utime = 0, stime = 0;
+    for (int field = 3; field < 14 && p; field++) {
+        p = strchr(p, ' ');
+        if (p) p++;
+    }
+    if (!p || sscanf(p, "%llu %llu", &utime, &stime) != 2) return false;
+    *ticks = utime + stime;
+    return true;
+}
+
+static void sample_threads(uint64_t window_us) {
+    long hz = sysconf(_SC_CLK_TCK);
+    float scale = hz > 0 ? 100.0f * 1000000.0f / ((float)hz * (float)window_us) : 0.0f;
+
+    for (int i = 0; i < task_count; i++) tasks[i].seen = false;
+    report.thread_count = 0;
+    report.process_cpu = 0.0f;
+
+    ProfileThread all[PROFILE_TASKS_MAX];
+    int all_count = 0;
+
+    DIR* dir = opendir("/proc/self/task");
+    if (!dir) return;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        int tid = atoi(ent->d_name);
+        if (tid <= 0) continue;
+        char name[16];
+        uint64_t ticks;
+        if (!read_task(tid, name, sizeof(name), &ticks)) continue;
+
+        TaskSample* t = NULL;
+        for (int i = 0; i < task_count; i++) {
+            if (tasks[i].tid == tid) {
+                t = &tasks[i];
+                break;
+            }
+        }
+        uint64_t delta = 0;
+        if (t) {
+            delta = ticks - t->ticks;
+        } else if (task_count < PROFILE_TASKS_MAX) {
+            t = &tasks[task_count++];
+            t->tid = tid;
+        }
+        if (t) {
+            t->ticks = ticks;
+            t->seen = true;
+            snprintf(t->name, sizeof(t->name), "%s", name);
+        }
+
+        if (all_count < PROFILE_TASKS_MAX) {
+            ProfileThread* pt = &all[all_count++];
+            pt->tid = tid;
+            snprintf(pt->name, sizeof(pt->name), "%s", name);
+            pt->cpu = (float)delta * scale;
+            report.process_cpu += pt->cpu;
+        }
+    }
+    closedir(dir);
+
+    // Forget threads that exited
+    int kept = 0;
+    for (int i = 0; i < task_count; i++) {
+        if (tasks[i].seen) tasks[kept++] = tasks[i];
+    }
+    task_count = kept;
+
+    qsort(all, all_count, sizeof(all[0]), compare_threads);
+    report.thread_count = all_count < PROFILE_THREADS_MAX ? all_count : PROFILE_THREADS_MAX;
+    memcpy(report.threads, all, sizeof(all[0]) * report.thread_count);
+}
+
+bool Profile_tick(void) {
+    uint64_t now = now_us();
+    if (window_start_us == 0) window_start_us = now;
+    uint64_t window_us = now - window_start_us;
+    if (window_us < PROFILE_WINDOW_US) return false;
+
+    // Frame time percentiles
+    uint32_t kept = frame_count < PROFILE_FRAMES_MAX ? frame_count : PROFILE_FRAMES_MAX;
+    qsort(frame_us, kept, sizeof(frame_us[0]), compare_u32);
+    report.frames = frame_count;
+    report.idle = idle_count;
+    report.p50_us = kept ? frame_us[kept / 2] : 0;
+    report.p95_us = kept ? frame_us[kept * 95 / 100] : 0;
+    report.p99_us = kept ? frame_us[kept * 99 / 100] : 0;
+    report.max_us = frame_max_us;
+
+    report.section_count = section_count;
+    for (int i = 0; i < section_count; i++) {
+        SectionAccum* s = &sections[i];
+        ProfileSection* r = &report.sections[i];
+        r->name = s->name;
+        r->calls = s->calls;
+        r->avg_us = s->calls ? (uint32_t)(s->total_us / s->calls) : 0;
+        r->max_us = s->max_us;
+        r->share = (float)s->total_us * 100.0f / (float)window_us;
+        s->total_us = 0;
+        s->calls = 0;
+        s->max_us = 0;
+    }
+
+    sample_threads(window_us);
+
+    frame_count = 0;
+    frame_max_us = 0;
+    idle_count = 0;
+    window_start_us = now;
+    return true;
+}
+
+const ProfileReport* Profile_getReport(void) {
+    return &report;
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// UI frame profiling (UI_PROFILE builds: make UI_PROFILE=1)
+// Main loop iterations that draw are timed from the top of the loop to the end
+// of the flip, and named sections (render_* functions, spectrum, scroll text,
+// radio and YouTube updates) are timed by scoped timers. Per-thread CPU usage
+// is sampled from /proc/self/task. Without UI_PROFILE the macros compile to
+// nothing. Main thread only.
+
+#ifdef UI_PROFILE
+
+#define PROFILE_SECTIONS_MAX 32
+#define PROFILE_THREADS_MAX 8           // Busiest threads reported
+
+typedef struct {
+    const char* name;
+    uint32_t calls;                     // In the last report window
+    uint32_t avg_us;
+    uint32_t max_us;
+    float share;                        // Of the window's wall time
+} ProfileSection;
+
+typedef struct {
+    int tid;
+    char name[16];
+    float cpu;                          // Percent of one core
+} ProfileThread;
+
+typedef struct {
+    uint32_t frames;                    // Drawn in the last window
+    uint32_t idle;                      // Iterations that drew nothing
+    uint32_t p50_us, p95_us, p99_us, max_us;
+    int section_count;
+    ProfileSection sections[PROFILE_SECTIONS_MAX];
+    int thread_count;
+    ProfileThread threads[PROFILE_THREADS_MAX];
+    float process_cpu;                  // All threads, percent of one core
+} ProfileReport;
+
+typedef struct {
+    int section;
+    uint64_t start_us;
+} ProfileScope;
+
+ProfileScope Profile_beginScope(const char* name);
+void Profile_endScope(ProfileScope* scope);
+
+// Mark the start of a main loop iteration, and its end (drew: it rendered a frame)
+void Profile_frameBegin(void);
+void Profile_frameEnd(bool drew);
+
+// Close the report window once a second; returns true when a new report is ready
+bool Profile_tick(void);
+
+// The last completed report window
+const ProfileReport* Profile_getReport(void);
+
+#define PROFILE_CAT_(a, b) a##b
+#define PROFILE_CAT(a, b) PROFILE_CAT_(a, b)
+
+// Time from here to the end of the enclosing block under name (a string literal)
+#define PROFILE_SCOPE(name) \
+    ProfileScope PROFILE_CAT(profile_scope_, __LINE__) __attribute__((cleanup(Profile_endScope))) = Profile_beginScope(name)
+#define PROFILE_FRAME_BEGIN() Profile_frameBegin()
+#define PROFILE_FRAME_END(drew) Profile_frameEnd(drew)
+
+#else
+
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_FRAME_END(drew) ((void)0)
+
+#endif
+
+#endif
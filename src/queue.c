@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "queue.h"
+#include "library.h"
+#include "playlist.h"
+
+static int* tracks = NULL;          // Library record indexes (playlists: offsets into item_text)
+static int track_count = 0;
+static int track_capacity = 0;
+static char* item_text = NULL;      // Playlist items as written in the file
+static size_t item_text_size = 0;
+static size_t item_text_capacity = 0;
+static QueueScope scope = QUEUE_SCOPE_NONE;
+static char scope_key[512];
+static int position = -1;
+static char position_path[512];     // Playing track, found again after the index changes
+
+static void queue_free(void) {
+    free(tracks);
+    free(item_text);
+    tracks = NULL;
+    item_text = NULL;
+    track_count = track_capacity = 0;
+    item_text_size = item_text_capacity = 0;
+}
+
+// Append a playlist item (dropped if out of memory)
+static void queue_add_item(const char* item, void* userdata) {
+    (void)userdata;
+    size_t len = strlen(item) + 1;
+    if (item_text_size + len > item_text_capacity) {
+        size_t capacity = item_text_capacity ? item_text_capacity * 2 : 16 * 1024;
+        while (item_text_size + len > capacity) capacity *= 2;
+        char* grown = realloc(item_text, capacity);
+        if (!grown) return;
+        item_text = grown;
+        item_text_capacity = capacity;
+    }
+    if (track_count == track_capacity) {
+        int capacity = track_capacity ? track_capacity * 2 : 256;
+        int* grown = realloc(tracks, sizeof(int) * capacity);
+        if (!grown) return;
+        tracks = grown;
+        track_capacity = capacity;
+    }
+    memcpy(&item_text[item_text_size], item, len);
+    tracks[track_count++] = (int)item_text_size;
+    item_text_size += len;
+}
+
+// Items of the playlist from the index, or read from the file if it changed since
+static int queue_build_playlist(void) {
+    const uint32_t* items;
+    int count = Library_playlist(scope_key, &items);
+    if (count < 0) {
+        Playlist_read(scope_key, queue_add_item, NULL);
+    } else {
+        for (int i = 0; i < count; i++) {
+            queue_add_item(Library_string(items[i]), NULL);
+        }
+    }
+    return track_count;
+}
+
+// Fill tracks from scope and scope_key
+static int queue_build(void) {
+    queue_free();
+    if (scope == QUEUE_SCOPE_PLAYLIST) return queue_build_playlist();
+
+    int library_count = Library_count();
+    if (library_count <= 0) return 0;
+
+    if (scope == QUEUE_SCOPE_FOLDER) {
+        int first;
+        int count = Library_folder(scope_key, &first);
+        tracks = malloc(sizeof(int) * (count ? count : 1));
+        if (!tracks) return 0;
+        for (int i = 0; i < count; i++) {
+            tracks[i] = first + i;
+        }
+        track_count = count;
+    } else {
+        tracks = malloc(sizeof(int) * library_count);
+        if (!tracks) return 0;
+        if (scope == QUEUE_SCOPE_LIBRARY) {
+            for (int i = 0; i < library_count; i++) {
+                tracks[i] = i;
+            }
+            track_count = library_count;
+        } else {
+            track_count = Library_filter(scope == QUEUE_SCOPE_ARTIST ? scope_key : NULL,
+                                         scope == QUEUE_SCOPE_ALBUM ? scope_key : NULL,
+                                         tracks, library_count);
+        }
+    }
+    return track_count;
+}
+
+int Queue_open(QueueScope new_scope, const char* key) {
+    scope = new_scope;
+    snprintf(scope_key, sizeof(scope_key), "%s", key ? key : "");
+    position = -1;
+    position_path[0] = '\0';
+
+    if (scope == QUEUE_SCOPE_NONE || queue_build() == 0) {
+        Queue_close();
+        return 0;
+    }
+    return track_count;
+}
+
+void Queue_close(void) {
+    queue_free();
+    scope = QUEUE_SCOPE_NONE;
+    position = -1;
+    position_path[0] = '\0';
+}
+
+bool Queue_isActive(void) {
+    return scope != QUEUE_SCOPE_NONE;
+}
+
+int Queue_count(void) {
+    return track_count;
+}
+
+QueueScope Queue_getScope(char* key, int max_len) {
+    snprintf(key, max_len, "%s", scope_key);
+    return scope;
+}
+
+int Queue_position(void) {
+    return position;
+}
+
+void Queue_setPosition(int new_position) {
+    if (new_position < 0 || new_position >= track_count) return;
+    position = new_position;
+    Queue_getPath(position, position_path, sizeof(position_path));
+}
+
+void Queue_getPath(int index, char* out, int max_len) {
+    if (index < 0 || index >= track_count) {
+        if (max_len > 0) out[0] = '\0';
+    } else if (scope == QUEUE_SCOPE_PLAYLIST) {
+        Playlist_resolve(scope_key, &item_text[tracks[index]], out, max_len);
+    } else {
+        const LibraryRecord* record = Library_record(tracks[index]);
+        snprintf(out, max_len, "%s", record ? Library_string(record->path) : "");
+    }
+}
+
+int Queue_find(const char* path) {
+    if (scope == QUEUE_SCOPE_PLAYLIST) {
+        char item_path[512];
+        for (int i = 0; i < track_count; i++) {
+            Queue_getPath(i, item_path, sizeof(item_path));
+            if (strcmp(item_path, path) == 0) return i;
+        }
+        return -1;
+    }
+
+    int record = Library_find(path);
+    if (record < 0) return -1;
+    for (int i = 0; i < track_count; i++) {
+        if (tracks[i] == record) return i;
+    }
+    return -1;
+}
+
+void Queue_refresh(void) {
+    // Playlist items don't refer to the index
+    if (scope == QUEUE_SCOPE_NONE || scope == QUEUE_SCOPE_PLAYLIST) return;
+    queue_build();
+    position = position_path[0] ? Queue_find(position_path) : -1;
+}
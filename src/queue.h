@@ -0,0 +1,49 @@
+#ifndef __QUEUE_H__
+#define __QUEUE_H__
+
+#include <stdbool.h>
+
+// Play queue
+// The tracks of a library scope as library record indexes (4 bytes a track), so
+// playing a folder tree, an artist, an album or the whole library needs no
+// directory walks. Playlists keep their items as written and resolve one only
+// when its path is asked for. Positions are 0-based. All functions are for the
+// main thread.
+
+typedef enum {
+    QUEUE_SCOPE_NONE,       // No queue: the browser folder is played
+    QUEUE_SCOPE_FOLDER,     // A folder and its subfolders (key = folder path)
+    QUEUE_SCOPE_ARTIST,     // key = artist
+    QUEUE_SCOPE_ALBUM,      // key = album
+    QUEUE_SCOPE_LIBRARY,    // Every indexed file
+    QUEUE_SCOPE_PLAYLIST    // key = M3U/PLS file, in its order (from the index if it has it)
+} QueueScope;
+
+// Fill the queue from a scope, in path order (playlists: in their order)
+// Returns the number of tracks; an empty scope leaves no queue.
+int Queue_open(QueueScope scope, const char* key);
+
+// Drop the queue
+void Queue_close(void);
+
+bool Queue_isActive(void);
+int Queue_count(void);
+
+// Scope of the queue and its key (copied to key, max_len bytes)
+QueueScope Queue_getScope(char* key, int max_len);
+
+// Position of the playing track (-1 = none)
+int Queue_position(void);
+void Queue_setPosition(int position);
+
+// Path of a track ("" if there is none)
+void Queue_getPath(int position, char* out, int max_len);
+
+// Position of a path in the queue, or -1
+int Queue_find(const char* path);
+
+// Rebuild a library scope after Library_update() reported a new index,
+// keeping the position on the playing track (-1 if it is gone)
+void Queue_refresh(void);
+
+#endif
@@ -1,10 +1,30 @@
 #define _GNU_SOURCE  // For strcasestr
 #include "radio.h"
 #include "radio_net.h"
+#include "radio_conn.h"
+#include "radio_standby.h"
+#include "radio_reactor.h"
 #include "radio_album_art.h"
 #include "radio_hls.h"
+#include "radio_hls_fetch.h"
 #include "radio_curated.h"
+#include "radio_probe.h"
+#include "radio_timeshift.h"
+#include "radio_record.h"
+#include "radio_memo.h"
+#include "radio_stations.h"
 #include "player.h"
+#include "thread_role.h"
+#include "equalizer.h"
+#include "profile.h"
+#include "trace.h"
+#include "latency.h"
+#include "radio_capture.h"
+#include "seqlock.h"
+#include "resampler.h"
+#include "pcm_kernels.h"
+#include "time_stretch.h"
+#include "log_async.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +34,7 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <sys/select.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
@@ -28,24 +49,29 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
-// mbedTLS for HTTPS support
-#include "mbedtls/net_sockets.h"
-#include "mbedtls/ssl.h"
-#include "mbedtls/entropy.h"
-#include "mbedtls/ctr_drbg.h"
-#include "mbedtls/error.h"
-
 // MP3 streaming decoder (implementation is in player.c)
 #include "audio/dr_mp3.h"
 
 // AAC decoder (Helix)
 #include "aacdec.h"
 
+// Ogg Vorbis decoder, push mode (implementation is in player.c)
+#define STB_VORBIS_HEADER_ONLY
+#include "audio/stb_vorbis.h"
+
+// From ring position pos on, the decoded ring holds frames of this many channels
+typedef struct {
+    size_t pos;
+    int channels;
+} RingMark;
+
 // Audio format types for radio streams
 typedef enum {
     RADIO_FORMAT_UNKNOWN = 0,
     RADIO_FORMAT_MP3,
-    RADIO_FORMAT_AAC
+    RADIO_FORMAT_AAC,
+    RADIO_FORMAT_VORBIS,        // Ogg Vorbis
+    RADIO_FORMAT_OPUS           // Ogg Opus: recognised, but there is no decoder
 } RadioAudioFormat;
 
 // Stream types
@@ -59,8 +85,73 @@ typedef enum {
 #define SAMPLE_RATE 48000
 #define AUDIO_CHANNELS 2
 
-// Ring buffer for decoded audio
-#define AUDIO_RING_SIZE (SAMPLE_RATE * 2 * 15)  // 15 seconds of stereo audio for better buffering
+// Ring buffer for decoded audio, in samples (the ring rounds up to a power of two)
+// Only about half a second: the jitter buffer is the bitstream ring, decoded just in time.
+#define AUDIO_RING_SIZE (SAMPLE_RATE * 2 / 2)
+
+// Bitstream ring between the network and decode stages: the jitter buffer, holding
+// encoded frames (about 65 s at 128 kbps, 26 s at 320 kbps)
+#define NET_RING_SIZE (1024 * 1024)
+
+// Adaptive jitter buffer: playback starts once the target is buffered (bitstream
+// and decoded audio). The target doubles on every rebuffer and follows large gaps
+// in the stream's arrival; after a stable stretch it shrinks back by a quarter.
+#define RADIO_TARGET_MIN_MS 1500
+#define RADIO_TARGET_MAX_MS 30000
+#define RADIO_STABLE_MS 60000
+#define RADIO_JITTER_FACTOR 2       // Target kept at this many times the longest arrival gap
+
+// Below this playback drops back to buffering (just before the decoded ring runs dry)
+#define RADIO_REBUFFER_MS 250
+
+// While below the target, decoded audio is time-stretched this much slower (pitch
+// kept) to refill without a gap
+#define RADIO_STRETCH_TEMPO 0.98f
+#define RADIO_STRETCH_FRAMES 1024   // Stretched frames written to the ring at a time
+
+// Channel count changes queued in the decoded ring at once (see RingMark)
+#define RADIO_RING_MARKS 8
+
+// Buffered audio reported as a full buffer level (Radio_getBufferLevel)
+#define RADIO_LEVEL_FULL_MS 15000
+
+// Stream byte rate assumed until the decoder has measured one (128 kbps)
+#define RADIO_DEFAULT_BYTE_RATE (128 * 1000 / 8)
+
+// How long a pipeline stage sleeps while its input is empty or its output full
+#define RADIO_STAGE_WAIT_US 10000
+
+// Reconnecting a direct stream that ended: attempts, each after a jittered
+// exponential backoff (half the delay fixed, half random), while buffered audio plays on
+#define RADIO_RECONNECT_ATTEMPTS 6
+#define RADIO_RECONNECT_BASE_MS 250
+#define RADIO_RECONNECT_MAX_MS 8000
+
+// Where recordings go; the library indexes them with the rest of the music
+#define RADIO_RECORD_DIR SDCARD_PATH "/Music/Recordings"
+
+// Resampled frames handed to the audio ring at a time (an HE-AAC frame is 2048)
+#define RADIO_RESAMPLE_FRAMES 2048
+
+// Low-wakeup receiving with the screen off (power save) and the jitter buffer
+// this far above its target: the network stage wakes once per
+// RADIO_LOW_WAKEUP_MS of stream data, falling back below half the margin
+#define RADIO_LOW_WAKEUP_MS 1000
+#define RADIO_LOW_WAKEUP_MARGIN_MS 4000
+#define RADIO_LOW_WAKEUP_MAX (64 * 1024)    // Low water cap (a 512 kbps stream)
+#define RADIO_RECV_SIZE 8192                // Read size otherwise
+
+// Stream bytes buffered before the decoder is set up: enough to find the format's
+// first frames, less when the station's memo already says which it is
+#define RADIO_DECODER_START_BYTES 16384
+#define RADIO_DECODER_MEMO_BYTES 4096
+
+// HLS segment buffers (2-4): how far the fetcher can get ahead of playback
+#define RADIO_HLS_PREFETCH_SEGMENTS 3
+
+// Stream buffers are allocated by the first Radio_play and freed this long after
+// Radio_stop (about 2 MB with the HLS segment buffers), for local playback
+#define RADIO_IDLE_RELEASE_MS 60000
 
 // Default radio stations
 static RadioStation default_stations[] = {};
@@ -73,36 +164,79 @@ typedef struct {
     RadioState state;
     char error_msg[256];
 
-    // Connection
-    int socket_fd;
+    // Connection of a direct stream (NULL for HLS), and what an opened
+    // connection's ICY metadata says
+    RadioConn* conn;
+    uint8_t* warm_window;       // Audio a standby buffered before handing conn over
+    int warm_window_len;
     char current_url[RADIO_MAX_URL];
-    char redirect_url[RADIO_MAX_URL];  // For handling HTTP redirects
-
-    // SSL/TLS support
-    bool use_ssl;
-    mbedtls_net_context ssl_net;
-    mbedtls_ssl_context ssl;
-    mbedtls_ssl_config ssl_conf;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
-    bool ssl_initialized;
-
-    // ICY metadata
-    int icy_metaint;          // Bytes between metadata
-    int bytes_until_meta;     // Countdown to next metadata
+    char stream_url[RADIO_MAX_URL];     // Where the redirects led ("" = HLS)
     RadioMetadata metadata;
 
-    // Stream buffer (raw network data)
+    // The station's memo (radio_memo.h): codec it had last time (main thread
+    // before the pipeline starts), and whether this start's has been stored
+    RadioAudioFormat memo_format;
+    bool memo_saved;
+
+    int wake_fd;                // Readable once Radio_stop wants the network stage out of its wait
+
+    // Stations kept warm for switching to (main thread), applied while playing
+    char neighbour_urls[RADIO_STANDBY_MAX][RADIO_MAX_URL];
+    int neighbour_count;
+
+    // Stream buffer (raw network data): bytes [stream_buffer_start, stream_buffer_pos)
+    // are unread. Decoders advance the start; the unread bytes only move to the
+    // front when the tail runs out of room.
     uint8_t* stream_buffer;
     int stream_buffer_size;
+    int stream_buffer_start;
     int stream_buffer_pos;
-
-    // Audio ring buffer (decoded PCM)
-    int16_t* audio_ring;
-    int audio_ring_write;
-    int audio_ring_read;
-    int audio_ring_count;
-    pthread_mutex_t audio_mutex;
+    int stream_buffer_level;    // Unread bytes, published for buffered_ms() (atomic)
+
+    // Bitstream ring (compressed audio without ICY metadata): the network thread
+    // writes, the decode thread reads into the stream buffer. The time-shift store
+    // (radio_timeshift.h) takes its place when it could be opened.
+    CircularBuffer net_ring;
+    bool net_done;              // Network stage ended (atomic)
+
+    // Measured by the decode stage to convert buffered bytes to time (atomic)
+    int byte_rate;              // Encoded bytes per second of audio
+    int pcm_rate;               // Decoded samples per second (all channels)
+    uint64_t rate_bytes;        // Decode thread only: totals behind byte_rate
+    uint64_t rate_us;
+
+    // Time-shift: stream time of the decoder (decode thread), and seek requests
+    // from the main thread (position, -1 = none, and the stream time there)
+    uint64_t play_us;
+    uint64_t next_mark_us;
+    int64_t seek_pos;           // Atomic
+    uint64_t seek_ms;
+    bool shifted;               // Main thread: paused or sought since playing live
+
+    // Adaptive buffering target (atomic: set by the main thread, read by the decode stage)
+    int target_ms;
+    int arrival_gap_ms;         // Longest wait for socket data since the last check (atomic)
+    uint64_t stable_since_ms;   // Main thread only: last rebuffer or target change
+    uint32_t rebuffers_seen;    // Main thread only
+
+    // Refill stretch of the decode thread, created the first time it is needed
+    TimeStretch* stretch;
+    int stretch_rate;
+    int16_t stretch_out[RADIO_STRETCH_FRAMES * AUDIO_CHANNELS];
+
+    // Audio ring buffer (decoded PCM samples): the decode thread writes, the
+    // audio callback reads, without a lock (same ring as local playback)
+    // Mono stations stay mono in it, twice the time in the same memory: the
+    // decode thread queues a mark where the channel count changes, the audio
+    // callback upmixes on the way out.
+    CircularBuffer audio_ring;
+    RingMark ring_marks[RADIO_RING_MARKS];
+    uint32_t marks_head;        // Marks queued (decode thread, atomic)
+    uint32_t marks_tail;        // Marks applied (audio callback, atomic)
+    int write_channels;         // Decode thread: channels of the frames it writes (0 = none yet)
+    int read_channels;          // Audio callback: channels of the frames at its read position
+
+    uint64_t idle_since_ms;     // Main thread: buffers allocated but stopped since (0 = in use)
 
     // Audio format detection
     RadioAudioFormat audio_format;
@@ -115,12 +249,25 @@ typedef struct {
 
     // AAC decoder
     HAACDecoder aac_decoder;
+    bool aac_skip_sbr;          // Decode thread: SBR skipped by the decoder now
+    bool power_save;            // Radio_setPowerSave (atomic)
     bool aac_initialized;
-    uint8_t aac_inbuf[AAC_MAINBUF_SIZE * 2];
-    int aac_inbuf_size;
     int aac_sample_rate;
     int aac_channels;
 
+    // Ogg Vorbis decoder of the current logical stream (decode stage); Icecast
+    // starts a new one, with its own headers, for every song
+    stb_vorbis* vorbis;
+    int vorbis_sample_rate;
+    int vorbis_channels;
+
+    // Equalizer history of the decoded stream (stream thread only)
+    EqualizerState eq;
+
+    // Converter of streams at another rate than the audio device's (decode stage),
+    // kept across stations so the device is never reopened for one
+    Resampler* resampler;
+
     // HLS support
     StreamType stream_type;
     HLSContext hls;
@@ -128,493 +275,291 @@ typedef struct {
     int hls_segment_buffer_size;
     int hls_segment_buffer_pos;
 
-    // Pre-allocated HLS buffers (to reduce memory fragmentation)
-    uint8_t* hls_segment_buf;        // Segment download buffer
-    uint8_t* hls_aac_buf;            // AAC decode buffer
-    uint8_t* hls_prefetch_buf;       // Prefetch buffer for next segment
-    int hls_prefetch_len;            // Length of prefetched data
-    int hls_prefetch_segment;        // Which segment index is prefetched (-1 if none)
-    volatile bool hls_prefetch_ready; // Is prefetch data ready to use?
+    // (segments are downloaded and demuxed into the fetcher's pool, see radio_hls_fetch.h)
 
-    // TS demuxer state
-    int ts_aac_pid;                  // PID of AAC audio stream
-    bool ts_pid_detected;
-
-    // Threading
+    // Threading: stream_thread is the network stage of direct streams (or the
+    // whole HLS pipeline), decode_thread the decode stage of direct streams
     pthread_t stream_thread;
+    pthread_t decode_thread;
     bool thread_running;
+    bool decode_thread_running;
     bool should_stop;
 
-    // Stations
-    RadioStation stations[RADIO_MAX_STATIONS];
-    int station_count;
-
     // Album art is now managed by radio_album_art module
 
     // Deferred audio configuration (to avoid blocking stream thread)
     bool pending_sample_rate_change;
     int pending_sample_rate;
     bool pending_audio_resume;
+
+    // Playback telemetry (atomic, written by the pipeline stages and the audio callback)
+    struct {
+        uint64_t net_bytes;
+        uint64_t decode_bytes;
+        uint32_t net_waits;
+        uint32_t decode_waits;
+        uint64_t since_ms;          // When the counters were reset
+        uint32_t rebuffers;
+        uint32_t underruns;
+        uint64_t silence_samples;
+        uint32_t fill_samples;
+        uint64_t fill_sum;          // Sum of buffered_ms() readings
+        int fill_min;               // Lowest buffered_ms() reading, -1 = none yet
+        uint32_t reconnects;
+        uint32_t outage_ms;         // Total time spent reconnecting
+        uint32_t outage_max_ms;
+    } stats;
 } RadioContext;
 
 static RadioContext radio = {0};
 
-// Use radio_net_parse_url for URL parsing
-
-// Initialize SSL/TLS
-static int ssl_init(const char* host) {
-    int ret;
-    const char* pers = "radio_client";
-
-    mbedtls_net_init(&radio.ssl_net);
-    mbedtls_ssl_init(&radio.ssl);
-    mbedtls_ssl_config_init(&radio.ssl_conf);
-    mbedtls_entropy_init(&radio.entropy);
-    mbedtls_ctr_drbg_init(&radio.ctr_drbg);
-
-    // Seed random number generator
-    ret = mbedtls_ctr_drbg_seed(&radio.ctr_drbg, mbedtls_entropy_func,
-                                 &radio.entropy, (const unsigned char*)pers, strlen(pers));
-    if (ret != 0) {
-        LOG_error("mbedtls_ctr_drbg_seed failed: %d\n", ret);
-        return -1;
-    }
+// radio.metadata is the radio threads' working copy; the UI reads the copy they
+// publish after each change (Radio_getMetadata). Publishers serialize on
+// metadata_mutex.
+static RadioMetadata metadata_published = {0};
+static Seqlock metadata_lock = {0};
+static pthread_mutex_t metadata_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void publish_metadata(void) {
+    pthread_mutex_lock(&metadata_mutex);
+    Seqlock_write(&metadata_lock, &metadata_published, &radio.metadata, sizeof(RadioMetadata));
+    pthread_mutex_unlock(&metadata_mutex);
+}
 
-    // Set up SSL config
-    ret = mbedtls_ssl_config_defaults(&radio.ssl_conf,
-                                       MBEDTLS_SSL_IS_CLIENT,
-                                       MBEDTLS_SSL_TRANSPORT_STREAM,
-                                       MBEDTLS_SSL_PRESET_DEFAULT);
-    if (ret != 0) {
-        LOG_error("mbedtls_ssl_config_defaults failed: %d\n", ret);
-        return -1;
-    }
+// Monotonic clock in milliseconds (stats and buffering policy)
+static uint64_t radio_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-    // Skip certificate verification (radio streams use various CAs)
-    mbedtls_ssl_conf_authmode(&radio.ssl_conf, MBEDTLS_SSL_VERIFY_NONE);
-    mbedtls_ssl_conf_rng(&radio.ssl_conf, mbedtls_ctr_drbg_random, &radio.ctr_drbg);
+// Decoded samples buffered for the audio callback
+static int ring_count(void) {
+    return (int)circular_buffer_available(&radio.audio_ring);
+}
 
-    // Set up SSL context
-    ret = mbedtls_ssl_setup(&radio.ssl, &radio.ssl_conf);
-    if (ret != 0) {
-        LOG_error("mbedtls_ssl_setup failed: %d\n", ret);
-        return -1;
-    }
+// Append decoded samples (decode thread); samples that don't fit are dropped
+static void ring_write(const int16_t* samples, int count) {
+    circular_buffer_write(&radio.audio_ring, samples, count);
+}
 
-    // Set hostname for SNI
-    ret = mbedtls_ssl_set_hostname(&radio.ssl, host);
-    if (ret != 0) {
-        LOG_error("mbedtls_ssl_set_hostname failed: %d\n", ret);
-        return -1;
-    }
+// Unread bytes of the stream buffer
+static inline uint8_t* stream_data(void) {
+    return radio.stream_buffer + radio.stream_buffer_start;
+}
 
-    radio.ssl_initialized = true;
-    return 0;
+static inline int stream_available(void) {
+    return radio.stream_buffer_pos - radio.stream_buffer_start;
 }
 
-// Cleanup SSL
-static void ssl_cleanup(void) {
-    if (radio.ssl_initialized) {
-        mbedtls_ssl_close_notify(&radio.ssl);
-        mbedtls_net_free(&radio.ssl_net);
-        mbedtls_ssl_free(&radio.ssl);
-        mbedtls_ssl_config_free(&radio.ssl_conf);
-        mbedtls_ctr_drbg_free(&radio.ctr_drbg);
-        mbedtls_entropy_free(&radio.entropy);
-        radio.ssl_initialized = false;
+// Mark bytes as read; an emptied buffer starts over at the front for free
+static inline void stream_consume(int bytes) {
+    radio.stream_buffer_start += bytes;
+    if (radio.stream_buffer_start >= radio.stream_buffer_pos) {
+        radio.stream_buffer_start = 0;
+        radio.stream_buffer_pos = 0;
     }
+    __atomic_store_n(&radio.stream_buffer_level, stream_available(), __ATOMIC_RELAXED);
 }
 
-// Send wrapper (works with both HTTP and HTTPS)
-static int radio_send(const void* buf, size_t len) {
-    if (radio.use_ssl) {
-        return mbedtls_ssl_write(&radio.ssl, buf, len);
-    } else {
-        return send(radio.socket_fd, buf, len, 0);
+// Room for len more bytes, moving the unread bytes to the front if the tail is full
+static bool stream_reserve(int len) {
+    if (radio.stream_buffer_pos + len <= radio.stream_buffer_size) return true;
+    if (radio.stream_buffer_start > 0) {
+        int unread = stream_available();
+        memmove(radio.stream_buffer, stream_data(), unread);
+        radio.stream_buffer_start = 0;
+        radio.stream_buffer_pos = unread;
     }
+    return radio.stream_buffer_pos + len <= radio.stream_buffer_size;
 }
 
-// Receive wrapper (works with both HTTP and HTTPS)
-static int radio_recv(void* buf, size_t len) {
-    if (radio.use_ssl) {
-        return mbedtls_ssl_read(&radio.ssl, buf, len);
-    } else {
-        return recv(radio.socket_fd, buf, len, 0);
+// Encoded bytes per second of the stream, measured or assumed
+static int current_byte_rate(void) {
+    int byte_rate = __atomic_load_n(&radio.byte_rate, __ATOMIC_RELAXED);
+    if (byte_rate <= 0) {
+        byte_rate = radio.metadata.bitrate > 0 ? radio.metadata.bitrate * 1000 / 8 : RADIO_DEFAULT_BYTE_RATE;
     }
+    return byte_rate;
 }
 
-// Connect to stream server (supports HTTP and HTTPS)
-static int connect_stream(const char* url) {
-    char host[256], path[512];
-    int port;
-    bool is_https;
-    int ret;
+// Decoded samples per second (all channels)
+static int current_pcm_rate(void) {
+    int pcm_rate = __atomic_load_n(&radio.pcm_rate, __ATOMIC_RELAXED);
+    return pcm_rate > 0 ? pcm_rate : SAMPLE_RATE * AUDIO_CHANNELS;
+}
 
-    if (radio_net_parse_url(url, host, 256, &port, path, 512, &is_https) != 0) {
-        snprintf(radio.error_msg, sizeof(radio.error_msg), "Invalid URL");
-        return -1;
+// Encoded bytes waiting for the decode stage (safe from any thread)
+static uint64_t bitstream_available(void) {
+    if (radio_timeshift_isOpen()) {
+        return radio_timeshift_writePosition() - radio_timeshift_readPosition();
     }
+    return circular_buffer_available(&radio.net_ring);
+}
 
-    radio.use_ssl = is_https;
-
-    if (is_https) {
-        // HTTPS connection using mbedTLS
-        char port_str[16];
-        snprintf(port_str, sizeof(port_str), "%d", port);
-
-        // Initialize SSL
-        if (ssl_init(host) != 0) {
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "SSL init failed");
-            return -1;
-        }
-
-        // Connect using mbedTLS
-        ret = mbedtls_net_connect(&radio.ssl_net, host, port_str, MBEDTLS_NET_PROTO_TCP);
-        if (ret != 0) {
-            LOG_error("mbedtls_net_connect failed: %d\n", ret);
-            ssl_cleanup();
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Connection failed");
-            return -1;
-        }
-
-        // Set socket for SSL
-        mbedtls_ssl_set_bio(&radio.ssl, &radio.ssl_net,
-                            mbedtls_net_send, mbedtls_net_recv, NULL);
-
-        // SSL handshake
-        while ((ret = mbedtls_ssl_handshake(&radio.ssl)) != 0) {
-            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-                LOG_error("mbedtls_ssl_handshake failed: %d\n", ret);
-                ssl_cleanup();
-                snprintf(radio.error_msg, sizeof(radio.error_msg), "SSL handshake failed");
-                return -1;
-            }
-        }
-
-
-        // Store socket fd for select() compatibility
-        radio.socket_fd = radio.ssl_net.fd;
-    } else {
-        // Plain HTTP connection - use getaddrinfo (thread-safe)
-        struct addrinfo hints, *result = NULL;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-
-        char port_str[16];
-        snprintf(port_str, sizeof(port_str), "%d", port);
-
-        int gai_ret = getaddrinfo(host, port_str, &hints, &result);
-        if (gai_ret != 0 || !result) {
-            if (result) freeaddrinfo(result);
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "DNS lookup failed");
-            return -1;
-        }
-
-        radio.socket_fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
-        if (radio.socket_fd < 0) {
-            freeaddrinfo(result);
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Socket creation failed");
-            return -1;
-        }
+// Audio buffered ahead of playback: the bitstream ring and the unread stream buffer
+// at the measured byte rate, plus the decoded ring (safe from any thread)
+static int buffered_ms(void) {
+    uint64_t bytes = bitstream_available() +
+                     __atomic_load_n(&radio.stream_buffer_level, __ATOMIC_RELAXED);
+    return (int)(bytes * 1000 / current_byte_rate() + (uint64_t)ring_count() * 1000 / current_pcm_rate());
+}
 
-        struct timeval tv;
-        tv.tv_sec = 10;
-        tv.tv_usec = 0;
-        setsockopt(radio.socket_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-        setsockopt(radio.socket_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
-
-        if (connect(radio.socket_fd, result->ai_addr, result->ai_addrlen) < 0) {
-            close(radio.socket_fd);
-            radio.socket_fd = -1;
-            freeaddrinfo(result);
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Connection failed");
-            return -1;
-        }
-        freeaddrinfo(result);
-    }
-
-    // Send HTTP request with ICY headers
-    char request[1024];
-    snprintf(request, sizeof(request),
-        "GET %s HTTP/1.0\r\n"
-        "Host: %s\r\n"
-        "User-Agent: MusicPlayer/1.0\r\n"
-        "Accept: */*\r\n"
-        "Icy-MetaData: 1\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        path, host);
-
-    if (radio_send(request, strlen(request)) < 0) {
-        if (radio.use_ssl) {
-            ssl_cleanup();
-        } else {
-            close(radio.socket_fd);
-        }
-        radio.socket_fd = -1;
-        snprintf(radio.error_msg, sizeof(radio.error_msg), "Send failed");
-        return -1;
+// Start playing once enough is buffered: the adaptive target, or as much as the
+// bitstream ring holds, with the decoded ring filled behind it
+static void check_prebuffered(void) {
+    if (radio.state != RADIO_STATE_BUFFERING) return;
+    if (ring_count() < (int)radio.audio_ring.capacity / 2) return;
+
+    if (buffered_ms() >= __atomic_load_n(&radio.target_ms, __ATOMIC_RELAXED) ||
+        (!radio_timeshift_isOpen() &&
+         circular_buffer_available(&radio.net_ring) >= radio.net_ring.capacity * 9 / 10) ||
+        __atomic_load_n(&radio.net_done, __ATOMIC_ACQUIRE)) {
+        radio.state = RADIO_STATE_PLAYING;
+        TRACE_INSTANT("radio_prebuffered");
+        LATENCY_AUDIO_READY();
     }
-
-    return 0;
 }
 
-// Parse HTTP response headers
-// Returns: 0 = success, 1 = redirect (check redirect_url), -1 = error
-static int parse_headers(void) {
-    char header_buf[4096];
-    int header_pos = 0;
-    char c;
-
-    radio.redirect_url[0] = '\0';
-
-    // Read headers until \r\n\r\n
-    while (header_pos < sizeof(header_buf) - 1) {
-        if (radio_recv(&c, 1) != 1) {
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Header read failed");
-            return -1;
-        }
-        header_buf[header_pos++] = c;
+// A frame was decoded from bytes of the bitstream, already consumed (decode thread)
+static void note_decoded_frame(int bytes, int samples_per_channel, int sample_rate, int channels) {
+    if (sample_rate <= 0 || channels <= 0) return;
 
-        // Check for end of headers
-        if (header_pos >= 4 &&
-            header_buf[header_pos-4] == '\r' && header_buf[header_pos-3] == '\n' &&
-            header_buf[header_pos-2] == '\r' && header_buf[header_pos-1] == '\n') {
-            break;
-        }
+    // Index the time-shift recording once per second of audio
+    if (radio_timeshift_isOpen() && radio.play_us >= radio.next_mark_us) {
+        uint64_t frame_pos = radio_timeshift_readPosition() - stream_available() - bytes;
+        radio_timeshift_markTime(frame_pos, radio.play_us / 1000);
+        radio.next_mark_us = radio.play_us + 1000000;
     }
-    header_buf[header_pos] = '\0';
-
-
-    // Check for HTTP or ICY response
-    if (strncmp(header_buf, "HTTP/1.", 7) != 0 && strncmp(header_buf, "ICY", 3) != 0) {
-        snprintf(radio.error_msg, sizeof(radio.error_msg), "Invalid response");
-        return -1;
+    radio.play_us += (uint64_t)samples_per_channel * 1000000 / sample_rate;
+    radio.rate_bytes += bytes;
+    radio.rate_us += (uint64_t)samples_per_channel * 1000000 / sample_rate;
+    if (radio.rate_us > 0) {
+        __atomic_store_n(&radio.byte_rate, (int)(radio.rate_bytes * 1000000 / radio.rate_us), __ATOMIC_RELAXED);
     }
+}
 
-    // Check HTTP status code for redirects
-    int http_status = 0;
-    if (strncmp(header_buf, "HTTP/1.", 7) == 0) {
-        // Parse status code (e.g., "HTTP/1.1 302 Found")
-        char* status_start = header_buf + 9;  // Skip "HTTP/1.X "
-        http_status = atoi(status_start);
-
-        // Check for redirect (301, 302, 303, 307, 308)
-        if (http_status >= 300 && http_status < 400) {
-            // Find Location header
-            char* loc = strcasestr(header_buf, "\nLocation:");
-            if (!loc) loc = strcasestr(header_buf, "\rlocation:");
-            if (loc) {
-                loc += 10;  // Skip "Location:"
-                while (*loc == ' ' || *loc == '\t') loc++;  // Skip whitespace
-
-                // Copy until end of line
-                char* end = loc;
-                while (*end && *end != '\r' && *end != '\n') end++;
-
-                int len = end - loc;
-                if (len > 0 && len < RADIO_MAX_URL) {
-                    strncpy(radio.redirect_url, loc, len);
-                    radio.redirect_url[len] = '\0';
-                    return 1;  // Indicate redirect
-                }
-            }
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Redirect without Location");
-            return -1;
-        }
+// Hand audio bytes to the decode stage (network thread), teeing them to a recording.
+// The time-shift store never fills up; the ring is waited on while full, so TCP flow
+// control holds the server back.
+static void net_write(const uint8_t* data, int len) {
+    radio_record_write(data, len);
 
-        // Check for error status
-        if (http_status >= 400) {
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "HTTP error %d", http_status);
-            return -1;
-        }
+    if (radio_timeshift_isOpen()) {
+        radio_timeshift_write(data, len);
+        __atomic_add_fetch(&radio.stats.net_bytes, len, __ATOMIC_RELAXED);
+        return;
     }
 
-    // Parse ICY headers
-    radio.icy_metaint = 0;
-    radio.metadata.bitrate = 0;
-    radio.metadata.station_name[0] = '\0';
-    radio.metadata.content_type[0] = '\0';
-
-    char* line = strtok(header_buf, "\r\n");
-    while (line) {
-        if (strncasecmp(line, "icy-metaint:", 12) == 0) {
-            radio.icy_metaint = atoi(line + 12);
+    bool waited = false;
+    while (len > 0 && !radio.should_stop) {
+        int n = (int)circular_buffer_write(&radio.net_ring, data, len);
+        __atomic_add_fetch(&radio.stats.net_bytes, n, __ATOMIC_RELAXED);
+        data += n;
+        len -= n;
+        if (len > 0) {
+            if (!waited) __atomic_add_fetch(&radio.stats.net_waits, 1, __ATOMIC_RELAXED);
+            waited = true;
+            usleep(RADIO_STAGE_WAIT_US);
         }
-        else if (strncasecmp(line, "icy-br:", 7) == 0) {
-            radio.metadata.bitrate = atoi(line + 7);
-        }
-        else if (strncasecmp(line, "icy-name:", 9) == 0) {
-            strncpy(radio.metadata.station_name, line + 9, sizeof(radio.metadata.station_name) - 1);
-            // Trim leading space
-            char* name = radio.metadata.station_name;
-            while (*name == ' ') name++;
-            memmove(radio.metadata.station_name, name, strlen(name) + 1);
-        }
-        else if (strncasecmp(line, "content-type:", 13) == 0) {
-            strncpy(radio.metadata.content_type, line + 13, sizeof(radio.metadata.content_type) - 1);
-        }
-        line = strtok(NULL, "\r\n");
     }
+}
 
-    radio.bytes_until_meta = radio.icy_metaint;
+// Take the response headers of an opened connection
+static void apply_headers(const RadioConn* conn) {
+    radio.metadata.bitrate = conn->bitrate;
+    snprintf(radio.metadata.station_name, sizeof(radio.metadata.station_name), "%s", conn->station_name);
+    snprintf(radio.metadata.content_type, sizeof(radio.metadata.content_type), "%s", conn->content_type);
+    publish_metadata();
 
-    // Detect audio format from content type
-    radio.audio_format = RADIO_FORMAT_MP3;  // Default to MP3
+    // Detect audio format from content type, or what decoded last time without one
+    radio.audio_format = radio.memo_format != RADIO_FORMAT_UNKNOWN ? radio.memo_format : RADIO_FORMAT_MP3;
     const char* ct = radio.metadata.content_type;
     if (ct[0]) {
         // Skip leading whitespace
         while (*ct == ' ') ct++;
 
-        if (strcasestr(ct, "aac") != NULL ||
-            strcasestr(ct, "mp4") != NULL ||
-            strcasestr(ct, "m4a") != NULL) {
+        if (strcasestr(ct, "opus") != NULL) {
+            radio.audio_format = RADIO_FORMAT_OPUS;
+        } else if (strcasestr(ct, "ogg") != NULL || strcasestr(ct, "vorbis") != NULL) {
+            radio.audio_format = RADIO_FORMAT_VORBIS;
+        } else if (strcasestr(ct, "aac") != NULL ||
+                   strcasestr(ct, "mp4") != NULL ||
+                   strcasestr(ct, "m4a") != NULL) {
             radio.audio_format = RADIO_FORMAT_AAC;
         } else if (strcasestr(ct, "mpeg") != NULL ||
                    strcasestr(ct, "mp3") != NULL) {
             radio.audio_format = RADIO_FORMAT_MP3;
         }
     }
-
-    return 0;
 }
 
-// Parse ICY metadata block
-static void parse_icy_metadata(const uint8_t* data, int len) {
-    // Format: StreamTitle='Artist - Title';StreamUrl='...';
-    char meta[4096];
-    if (len >= sizeof(meta)) len = sizeof(meta) - 1;
-    memcpy(meta, data, len);
-    meta[len] = '\0';
-
-    // Save old values to detect changes
-    char old_artist[256], old_title[256];
-    strncpy(old_artist, radio.metadata.artist, sizeof(old_artist) - 1);
-    strncpy(old_title, radio.metadata.title, sizeof(old_title) - 1);
-
-    // Find StreamTitle
-    char* title_start = strstr(meta, "StreamTitle='");
-    if (title_start) {
-        title_start += 13;
-        char* title_end = strchr(title_start, '\'');
-        if (title_end) {
-            *title_end = '\0';
-            strncpy(radio.metadata.title, title_start, sizeof(radio.metadata.title) - 1);
-
-            // Try to parse "Artist - Title" format
-            char* separator = strstr(radio.metadata.title, " - ");
-            if (separator) {
-                *separator = '\0';
-                strncpy(radio.metadata.artist, radio.metadata.title, sizeof(radio.metadata.artist) - 1);
-                memmove(radio.metadata.title, separator + 3, strlen(separator + 3) + 1);
-            } else {
-                radio.metadata.artist[0] = '\0';
-            }
+// The song on air changed to artist/title (network thread, or before it starts)
+static void set_song(const char* artist, const char* title) {
+    if (strcmp(artist, radio.metadata.artist) == 0 && strcmp(title, radio.metadata.title) == 0) return;
+    snprintf(radio.metadata.artist, sizeof(radio.metadata.artist), "%s", artist);
+    snprintf(radio.metadata.title, sizeof(radio.metadata.title), "%s", title);
+    publish_metadata();
 
-            // Fetch album art if metadata changed
-            if (strcmp(old_artist, radio.metadata.artist) != 0 ||
-                strcmp(old_title, radio.metadata.title) != 0) {
-                radio_album_art_fetch(radio.metadata.artist, radio.metadata.title);
-            }
-        }
+    radio_album_art_fetch(radio.metadata.artist, radio.metadata.title);
+    radio_timeshift_markSong();
+    radio_record_newSong(radio.metadata.artist, radio.metadata.title);
+}
+
+// Parse ICY metadata block (radio_conn_demux callback)
+static void parse_icy_metadata(void* ctx, const uint8_t* data, int len) {
+    (void)ctx;
+    char artist[256], title[256];
+    if (radio_conn_parseTitle(data, len, artist, sizeof(artist), title, sizeof(title))) {
+        set_song(artist, title);
     }
 }
 
+// Audio of the demuxed stream (radio_conn_demux callback)
+static void on_stream_audio(void* ctx, const uint8_t* data, int len) {
+    (void)ctx;
+    if (!radio.should_stop) net_write(data, len);
+}
+
 // ============== HLS SUPPORT ==============
 // HLS functions are now in radio_hls.c module
 // Use radio_hls_is_url(), radio_hls_get_base_url(), radio_hls_resolve_url()
-// Use radio_hls_parse_playlist(), radio_hls_demux_ts(), radio_hls_parse_id3_metadata()
-
-// TS sync byte for container detection
-#define TS_SYNC_BYTE 0x47
-
-// Fetch content from URL - delegates to radio_net module
-static int fetch_url_content(const char* url, uint8_t* buffer, int buffer_size, char* content_type, int ct_size) {
-    return radio_net_fetch(url, buffer, buffer_size, content_type, ct_size);
-}
-
-// Prefetch thread state
-static pthread_t hls_prefetch_thread;
-static volatile bool hls_prefetch_thread_active = false;
-
-// HLS segment prefetch worker thread
-static void* hls_prefetch_thread_func(void* arg) {
-    int seg_idx = (int)(intptr_t)arg;
-
-    // Validate segment index
-    if (seg_idx < 0 || seg_idx >= radio.hls.segment_count || radio.should_stop) {
-        return NULL;
-    }
-
-    const char* seg_url = radio.hls.segments[seg_idx].url;
-    if (!seg_url || seg_url[0] == '\0') {
-        return NULL;
-    }
-
-    // Fetch segment into prefetch buffer
-    int len = fetch_url_content(seg_url, radio.hls_prefetch_buf,
-                                HLS_SEGMENT_BUF_SIZE, NULL, 0);
-
-    // Only mark as ready if fetch succeeded and we're not stopping
-    if (len > 0 && !radio.should_stop) {
-        radio.hls_prefetch_len = len;
-        radio.hls_prefetch_segment = seg_idx;
-        radio.hls_prefetch_ready = true;
+// Use radio_hls_fetch_playlist(), radio_hls_refresh_playlist(), radio_hls_parse_id3_metadata()
+// Segments are fetched and demuxed by radio_hls_fetch.c
+
+// Continue after the last played segment in a freshly loaded media playlist
+// media_sequence is the sequence number of its first segment
+static void hls_resume_position(void) {
+    if (radio.hls.last_played_sequence >= 0) {
+        int next_seq = radio.hls.last_played_sequence + 1;
+        int start_idx = next_seq - radio.hls.media_sequence;
+        if (start_idx < 0) start_idx = 0;
+        if (start_idx > radio.hls.segment_count) start_idx = radio.hls.segment_count;
+        radio.hls.current_segment = start_idx;
+    } else {
+        radio.hls.current_segment = 0;
     }
-
-    return NULL;
 }
 
-// Start prefetching a segment in the background
-static void start_segment_prefetch(int segment_idx) {
-    // Don't prefetch if stopping or buffer not allocated
-    if (radio.should_stop || !radio.hls_prefetch_buf) {
-        return;
-    }
-
-    // Wait for previous prefetch thread to complete
-    if (hls_prefetch_thread_active) {
-        pthread_join(hls_prefetch_thread, NULL);
-        hls_prefetch_thread_active = false;
-    }
-
-    // Validate segment index
-    if (segment_idx < 0 || segment_idx >= radio.hls.segment_count) {
+// Look up the cover of the next song the playlist's EXTINF titles name, so it
+// shows as soon as that song starts
+static void hls_prefetch_art(void) {
+    for (int i = radio.hls.current_segment + 1; i < radio.hls.segment_count; i++) {
+        const char* title = radio_hls_segment_title(&radio.hls, i);
+        const char* artist = radio_hls_segment_artist(&radio.hls, i);
+        if (!title || title[0] == '\0') continue;
+        // A segment without an artist keeps the current one, as when it plays
+        if (!artist || artist[0] == '\0' || strcmp(artist, " ") == 0) artist = radio.metadata.artist;
+        if (strcmp(title, radio.metadata.title) == 0 && strcmp(artist, radio.metadata.artist) == 0) continue;
+        radio_album_art_prefetch(artist, title);
         return;
     }
-
-    // Start prefetch thread
-    if (pthread_create(&hls_prefetch_thread, NULL, hls_prefetch_thread_func,
-                       (void*)(intptr_t)segment_idx) == 0) {
-        hls_prefetch_thread_active = true;
-    }
 }
 
-// HLS streaming thread
+// HLS network stage: fetches segments and hands their AAC frames to the decode stage
 static void* hls_stream_thread_func(void* arg) {
     (void)arg;
-
-    // Use pre-allocated buffers from RadioContext to reduce memory fragmentation
-    uint8_t* segment_buf = radio.hls_segment_buf;
-    uint8_t* aac_buf = radio.hls_aac_buf;
-
-    if (!segment_buf || !aac_buf) {
-        radio.state = RADIO_STATE_ERROR;
-        snprintf(radio.error_msg, sizeof(radio.error_msg), "HLS buffers not allocated");
-        return NULL;
-    }
-
-    // Initialize AAC decoder
-    radio.aac_decoder = AACInitDecoder();
-    if (!radio.aac_decoder) {
-        radio.state = RADIO_STATE_ERROR;
-        snprintf(radio.error_msg, sizeof(radio.error_msg), "AAC decoder init failed");
-        return NULL;
-    }
-    radio.aac_initialized = true;
-    radio.aac_inbuf_size = 0;
-    radio.aac_sample_rate = 0;  // Will be set on first frame
+    ThreadRole_apply(THREAD_ROLE_DECODE);
 
     radio.state = RADIO_STATE_BUFFERING;
 
@@ -622,39 +567,14 @@ static void* hls_stream_thread_func(void* arg) {
     while (!radio.should_stop) {
         loop_iteration++;
 
-        // Check if we need to refresh the playlist (for live streams)
-        if (radio.hls.is_live && radio.hls.current_segment >= radio.hls.segment_count) {
-            // Fetch updated playlist
-            uint8_t* playlist_buf = malloc(64 * 1024);
-            if (playlist_buf) {
-                int len = fetch_url_content(radio.current_url, playlist_buf, 64 * 1024, NULL, 0);
-                if (len > 0) {
-                    playlist_buf[len] = '\0';
-                    char base_url[HLS_MAX_URL_LEN];
-                    radio_hls_get_base_url(radio.current_url, base_url, HLS_MAX_URL_LEN);
-
-                    radio_hls_parse_playlist(&radio.hls, (char*)playlist_buf, base_url);
-
-                    // Skip segments we've already played based on last_played_sequence
-                    // media_sequence is the sequence number of the first segment in the new playlist
-                    // We want to start at last_played_sequence + 1
-                    if (radio.hls.last_played_sequence >= 0) {
-                        int next_seq = radio.hls.last_played_sequence + 1;
-                        int start_idx = next_seq - radio.hls.media_sequence;
-                        if (start_idx < 0) start_idx = 0;
-                        if (start_idx > radio.hls.segment_count) start_idx = radio.hls.segment_count;
-                        radio.hls.current_segment = start_idx;
-                    } else {
-                        radio.hls.current_segment = 0;
-                    }
-                }
-                free(playlist_buf);
-            }
-
-            // If still no segments, wait a bit
-            if (radio.hls.current_segment >= radio.hls.segment_count) {
-                usleep(100000);  // 100ms
-                continue;
+        // Refresh a live playlist (the rendition's, for a master playlist) once it
+        // is due and the segments left no longer cover the fetcher's queue
+        int depth = radio_hls_fetch_depth(radio.hls.target_duration);
+        if (radio.hls.is_live && radio.hls.current_segment + depth > radio.hls.segment_count &&
+            radio_hls_refresh_due(&radio.hls)) {
+            if (radio_hls_refresh_playlist(&radio.hls) > 0) {
+                // Skip segments we've already played based on last_played_sequence
+                hls_resume_position();
             }
         }
 
@@ -664,26 +584,31 @@ static void* hls_stream_thread_func(void* arg) {
                 // End of stream
                 break;
             }
-            usleep(100000);
+            usleep(100000);  // Until the next refresh is due
             continue;
         }
 
-        // Wait if buffer is nearly full to prevent overflow
-        // Use high threshold (90%) and short wait to minimize network fetch delays
-        while (radio.audio_ring_count > AUDIO_RING_SIZE * 9 / 10 && !radio.should_stop) {
-            usleep(50000);  // 50ms - short wait, check frequently
-        }
-        if (radio.should_stop) break;
-
         // Validate segment index
         if (radio.hls.current_segment < 0 || radio.hls.current_segment >= HLS_MAX_SEGMENTS) {
-            LOG_error("[HLS] Invalid segment index: %d\n", radio.hls.current_segment);
+            LOG_ASYNC_error("[HLS] Invalid segment index: %d\n", radio.hls.current_segment);
             break;
         }
 
-        const char* seg_url = radio.hls.segments[radio.hls.current_segment].url;
-        const char* seg_title = radio.hls.segments[radio.hls.current_segment].title;
-        const char* seg_artist = radio.hls.segments[radio.hls.current_segment].artist;
+        // Adaptive bitrate: change rendition between segments; renditions share
+        // media sequence numbers, so playback continues after the last one played
+        if (radio.hls.variant_count > 1 && radio.hls.last_played_sequence >= 0) {
+            int variant = radio_hls_abr_update(&radio.hls, radio_hls_fetch_throughput());
+            if (variant != radio.hls.current_variant &&
+                radio_hls_load_variant(&radio.hls, variant) == 0) {
+                hls_resume_position();
+                if (radio.hls.current_segment >= radio.hls.segment_count) continue;
+            }
+        }
+
+        char seg_url[HLS_MAX_URL_LEN];
+        radio_hls_segment_url(&radio.hls, radio.hls.current_segment, seg_url, sizeof(seg_url));
+        const char* seg_title = radio_hls_segment_title(&radio.hls, radio.hls.current_segment);
+        const char* seg_artist = radio_hls_segment_artist(&radio.hls, radio.hls.current_segment);
 
         // Save old metadata BEFORE any updates to detect changes for album art fetch
         char old_artist[256], old_title[256];
@@ -699,322 +624,590 @@ static void* hls_stream_thread_func(void* arg) {
         if (seg_artist && seg_artist[0] != '\0' && strcmp(seg_artist, " ") != 0) {
             strncpy(radio.metadata.artist, seg_artist, sizeof(radio.metadata.artist) - 1);
         }
+        publish_metadata();
+
+        hls_prefetch_art();
 
         // Validate URL
-        if (!seg_url || seg_url[0] == '\0') {
-            LOG_error("[HLS] Empty segment URL at index %d\n", radio.hls.current_segment);
+        if (seg_url[0] == '\0') {
+            LOG_ASYNC_error("[HLS] Empty segment URL at index %d\n", radio.hls.current_segment);
             radio.hls.current_segment++;
             continue;
         }
 
-        // Check if segment was already prefetched
-        int seg_len;
-        if (radio.hls_prefetch_ready &&
-            radio.hls_prefetch_segment == radio.hls.current_segment) {
-            // Use prefetched data - instant, no network wait
-            seg_len = radio.hls_prefetch_len;
-            memcpy(segment_buf, radio.hls_prefetch_buf, seg_len);
-            radio.hls_prefetch_ready = false;
-        } else {
-            // Fallback: fetch synchronously (first segment or prefetch not ready)
-            seg_len = fetch_url_content(seg_url, segment_buf, HLS_SEGMENT_BUF_SIZE, NULL, 0);
-            if (seg_len <= 0) {
-                LOG_error("[HLS] Failed to fetch segment: %s\n", seg_url);
-                radio.hls.current_segment++;
-                continue;
-            }
+        // Keep this segment and the ones after it queued on the fetcher, as far
+        // ahead as the measured bandwidth calls for
+        int seq = radio.hls.media_sequence + radio.hls.current_segment;
+        radio_hls_fetch_dropBefore(seq);
+        for (int i = 0; i < depth; i++) {
+            int idx = radio.hls.current_segment + i;
+            char url[HLS_MAX_URL_LEN];
+            radio_hls_segment_url(&radio.hls, idx, url, sizeof(url));
+            if (!url[0] || !radio_hls_fetch_queue(radio.hls.media_sequence + idx, url)) break;
         }
 
-        // Start prefetching next segment in background while we process current one
-        int next_seg = radio.hls.current_segment + 1;
-        if (next_seg < radio.hls.segment_count && !radio.hls_prefetch_ready) {
-            start_segment_prefetch(next_seg);
+        // Hand its ADTS frames to the decode stage as they download (net_write waits
+        // while the bitstream ring is full), checking should_stop
+        RadioHlsSegment seg;
+        int have = 0;
+        int ret = 0;
+        while (!radio.should_stop) {
+            ret = radio_hls_fetch_wait(seq, have, &seg, 100);
+            if (ret < 0) break;
+            if (ret == 0) continue;
+
+            if (have == 0) {
+                // ID3 metadata at the start of the segment (common in HLS radio streams)
+                if (seg.artist[0]) strncpy(radio.metadata.artist, seg.artist, sizeof(radio.metadata.artist) - 1);
+                if (seg.title[0]) strncpy(radio.metadata.title, seg.title, sizeof(radio.metadata.title) - 1);
+                publish_metadata();
+
+                // Fetch album art if metadata changed (from either EXTINF or ID3)
+                if (strcmp(old_artist, radio.metadata.artist) != 0 ||
+                    strcmp(old_title, radio.metadata.title) != 0) {
+                    radio_album_art_fetch(radio.metadata.artist, radio.metadata.title);
+                    radio_timeshift_markSong();
+                    radio_record_newSong(radio.metadata.artist, radio.metadata.title);
+                }
+            }
+
+            if (seg.len > have) {
+                net_write(seg.data + have, seg.len - have);
+                have = seg.len;
+            }
+            if (seg.complete) break;
+        }
+        radio_hls_fetch_release(seq);
+        if (radio.should_stop) continue;
+        if (ret < 0 && have == 0) {
+            radio.hls.current_segment++;
+            continue;
         }
 
         // Calculate and update bitrate from segment size and duration
         float seg_duration = radio.hls.segments[radio.hls.current_segment].duration;
-        if (seg_duration > 0) {
-            int bitrate = (int)((seg_len * 8.0f) / (seg_duration * 1000.0f));
+        if (ret > 0 && seg_duration > 0) {
+            int bitrate = (int)((have * 8.0f) / (seg_duration * 1000.0f));
             if (bitrate > 0 && bitrate < 1000) {  // Sanity check (0-1000 kbps)
                 radio.metadata.bitrate = bitrate;
+                publish_metadata();
             }
         }
 
-        // Check for ID3 metadata at start of segment (common in HLS radio streams)
-        char id3_artist[256] = "", id3_title[256] = "";
-        int id3_skip = radio_hls_parse_id3_metadata(segment_buf, seg_len,
-                                                     id3_artist, sizeof(id3_artist),
-                                                     id3_title, sizeof(id3_title));
-        if (id3_skip > 0) {
-            // Update metadata if ID3 tags found
-            if (id3_artist[0]) strncpy(radio.metadata.artist, id3_artist, sizeof(radio.metadata.artist) - 1);
-            if (id3_title[0]) strncpy(radio.metadata.title, id3_title, sizeof(radio.metadata.title) - 1);
-            // Adjust buffer to skip ID3 tag
-            seg_len -= id3_skip;
-            memmove(segment_buf, segment_buf + id3_skip, seg_len);
-        }
-
-        // Fetch album art if metadata changed (from either EXTINF or ID3)
-        if (strcmp(old_artist, radio.metadata.artist) != 0 ||
-            strcmp(old_title, radio.metadata.title) != 0) {
-            radio_album_art_fetch(radio.metadata.artist, radio.metadata.title);
-        }
+        // Track the sequence number of the segment we just played (before incrementing)
+        radio.hls.last_played_sequence = radio.hls.media_sequence + radio.hls.current_segment;
 
-        // Check if segment is MPEG-TS (starts with 0x47) or raw AAC (starts with 0xFF for ADTS)
-        int aac_len = 0;
-        if (seg_len > 0 && segment_buf[0] == TS_SYNC_BYTE) {
-            // MPEG-TS container - demux to get AAC
-            aac_len = radio_hls_demux_ts(segment_buf, seg_len, aac_buf, HLS_SEGMENT_BUF_SIZE,
-                                          &radio.ts_aac_pid, &radio.ts_pid_detected);
-        } else {
-            // Raw AAC/ADTS - use directly
-            aac_len = seg_len;
-            memcpy(aac_buf, segment_buf, seg_len);
-        }
+        radio.hls.current_segment++;
+    }
 
-        // Decode AAC - process entire segment
-        if (aac_len > 0) {
-            int frames_decoded = 0;
-            int aac_pos = 0;  // Current position in aac_buf
 
-            // Process all AAC data from segment
-            while (aac_pos < aac_len && !radio.should_stop) {
-                // Find sync word in remaining data
-                int sync_offset = AACFindSyncWord(aac_buf + aac_pos, aac_len - aac_pos);
-                if (sync_offset < 0) {
-                    break;  // No more sync words
-                }
-                aac_pos += sync_offset;
+    __atomic_store_n(&radio.net_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
 
-                // Decode frame - buffer on stack (4KB is fine with 1MB thread stack)
-                int16_t decode_buf[AAC_MAX_NSAMPS * AAC_MAX_NCHANS * 2];  // Extra room for HE-AAC
-                unsigned char* inptr = aac_buf + aac_pos;
-                int bytes_left = aac_len - aac_pos;
+// Find MP3 sync word in buffer
+// Returns offset to sync word, or -1 if not found
+static int find_mp3_sync(const uint8_t* buf, int size) {
+    const uint8_t* p = buf;
+    const uint8_t* last = buf + size - 1;
+    // memchr skips ahead to each 0xFF a word at a time
+    while (p < last && (p = memchr(p, 0xFF, last - p)) != NULL) {
+        // MP3 sync: 0xFF followed by 0xE0-0xFF (11 bits set)
+        if ((p[1] & 0xE0) == 0xE0) return (int)(p - buf);
+        p++;
+    }
+    return -1;
+}
 
-                int err = AACDecode(radio.aac_decoder, &inptr, &bytes_left, decode_buf);
+// Find the first page of an Ogg logical stream (a chained stream starts a new one
+// per song)
+// Returns offset to the page, or -1 if not found
+static int find_ogg_bos(const uint8_t* buf, int size) {
+    const uint8_t* p = buf;
+    const uint8_t* end = buf + size;
+    while (end - p >= 6 && (p = memmem(p, end - p, "OggS", 4)) != NULL) {
+        if (end - p < 6) break;
+        if (p[4] == 0 && (p[5] & 0x02)) return (int)(p - buf);
+        p++;
+    }
+    return -1;
+}
 
-                if (err == ERR_AAC_NONE) {
-                    AACFrameInfo frame_info;
-                    AACGetLastFrameInfo(radio.aac_decoder, &frame_info);
+// Move bytes from the bitstream ring to the stream buffer (decode thread)
+// Returns the bytes moved.
+static int stream_fill(void) {
+    uint64_t available = bitstream_available();
+    int len = radio.stream_buffer_size - stream_available();
+    if ((uint64_t)len > available) len = (int)available;
+    if (len <= 0 || !stream_reserve(len)) return 0;
+
+    uint8_t* dst = radio.stream_buffer + radio.stream_buffer_pos;
+    int n = radio_timeshift_isOpen() ? radio_timeshift_read(dst, len)
+                                     : (int)circular_buffer_read(&radio.net_ring, dst, len);
+    radio.stream_buffer_pos += n;
+    __atomic_store_n(&radio.stream_buffer_level, stream_available(), __ATOMIC_RELAXED);
+    __atomic_add_fetch(&radio.stats.decode_bytes, n, __ATOMIC_RELAXED);
+    return n;
+}
 
-                    // Update sample rate/channels on first successful decode
-                    if (radio.aac_sample_rate == 0 && frame_info.sampRateOut > 0) {
-                        radio.aac_sample_rate = frame_info.sampRateOut;
-                        radio.aac_channels = frame_info.nChans;
-                        // Reconfigure audio device to match stream's sample rate
-                        Player_setSampleRate(frame_info.sampRateOut);
-                        Player_resumeAudio();  // Resume after reconfiguration
-                    }
+// Mark queue full: the audio callback hasn't caught up with the last changes
+static bool ring_marks_full(void) {
+    return radio.marks_head - __atomic_load_n(&radio.marks_tail, __ATOMIC_ACQUIRE) >= RADIO_RING_MARKS;
+}
 
-                    // Update position based on consumed bytes
-                    int consumed = (aac_len - aac_pos) - bytes_left;
-                    aac_pos += consumed;
+// Append decoded frames of 1 or 2 channels (decode thread), waiting while the
+// audio ring is full (a seek request drops them). A change of channel count is
+// marked before the frames are published, so the callback sees it in time.
+static void ring_write_wait(const int16_t* samples, int frames, int channels) {
+    int count = frames * channels;
+    bool waited = false;
+    while (((int)radio.audio_ring.capacity - ring_count() < count ||
+            (channels != radio.write_channels && ring_marks_full())) && !radio.should_stop) {
+        if (__atomic_load_n(&radio.seek_pos, __ATOMIC_ACQUIRE) >= 0) return;
+        if (!waited) __atomic_add_fetch(&radio.stats.decode_waits, 1, __ATOMIC_RELAXED);
+        waited = true;
+        check_prebuffered();
+        usleep(RADIO_STAGE_WAIT_US);
+    }
+    if (channels != radio.write_channels) {
+        if (ring_marks_full()) return;
+        RingMark* mark = &radio.ring_marks[radio.marks_head % RADIO_RING_MARKS];
+        mark->pos = circular_buffer_write_position(&radio.audio_ring);
+        mark->channels = channels;
+        __atomic_store_n(&radio.marks_head, radio.marks_head + 1, __ATOMIC_RELEASE);
+        radio.write_channels = channels;
+    }
+    ring_write(samples, count);
+}
 
-                    if (frame_info.outputSamps > 0) {
-                        frames_decoded++;
+// Follow the buffer (decode thread): below the target, playing and still
+// receiving, audio is stretched slightly to refill. True while the stretch is
+// in use, including settling back once the target is reached.
+static bool stretch_update(int out_rate) {
+    bool wanted = radio.state == RADIO_STATE_PLAYING &&
+                  buffered_ms() < __atomic_load_n(&radio.target_ms, __ATOMIC_RELAXED) &&
+                  !__atomic_load_n(&radio.net_done, __ATOMIC_ACQUIRE);
+    if (!radio.stretch) {
+        if (!wanted) return false;
+        radio.stretch = TimeStretch_new(out_rate);
+        if (!radio.stretch) return false;
+        radio.stretch_rate = out_rate;
+    }
+    if (radio.stretch_rate != out_rate) {
+        TimeStretch_reset(radio.stretch, out_rate);
+        radio.stretch_rate = out_rate;
+    }
+    TimeStretch_setTempo(radio.stretch, wanted ? RADIO_STRETCH_TEMPO : 1.0f);
+    return TimeStretch_active(radio.stretch);
+}
 
-                        pthread_mutex_lock(&radio.audio_mutex);
+// Queue stereo frames at the device rate as channels channels, through the
+// stretch while it is in use
+static void ring_write_stereo(int16_t* stereo, int frames, int channels, bool stretching) {
+    if (!stretching) {
+        if (channels == 1) Pcm_takeLeftS16(stereo, stereo, frames);
+        ring_write_wait(stereo, frames, channels);
+        return;
+    }
+    const int16_t* in = stereo;
+    for (;;) {
+        size_t n = TimeStretch_processS16(radio.stretch, in, (size_t)frames,
+                                          radio.stretch_out, RADIO_STRETCH_FRAMES, false);
+        if (channels == 1) Pcm_takeLeftS16(radio.stretch_out, radio.stretch_out, n);
+        ring_write_wait(radio.stretch_out, (int)n, channels);
+        if (n < RADIO_STRETCH_FRAMES) break;
+        in = NULL;      // The rest of the output is pending
+        frames = 0;
+    }
+}
 
-                        int samples = frame_info.outputSamps;
-                        for (int s = 0; s < samples; s++) {
-                            if (radio.audio_ring_count < AUDIO_RING_SIZE) {
-                                radio.audio_ring[radio.audio_ring_write] = decode_buf[s];
-                                radio.audio_ring_write = (radio.audio_ring_write + 1) % AUDIO_RING_SIZE;
-                                radio.audio_ring_count++;
-                            }
-                        }
+// Append decoded frames in the audio ring's format (decode thread): mono or
+// stereo at the audio device's rate. Other rates go through the resampler, and
+// a refill through the stretch, which are stereo: mono is spread to both
+// channels in place for them (samples has room for frames * AUDIO_CHANNELS)
+// and taken back from the left one.
+static void ring_write_pcm(int16_t* samples, int frames, int sample_rate, int channels) {
+    int out_rate = Player_getSampleRate();
+    __atomic_store_n(&radio.pcm_rate, out_rate * channels, __ATOMIC_RELAXED);
+
+    bool stretching = stretch_update(out_rate);
+    bool resampling = sample_rate > 0 && sample_rate != out_rate;
+    if (!resampling && !stretching) {
+        ring_write_wait(samples, frames, channels);
+        return;
+    }
 
-                        pthread_mutex_unlock(&radio.audio_mutex);
-                    }
-                } else if (err == ERR_AAC_INDATA_UNDERFLOW) {
-                    break;
-                } else {
-                    // Skip one byte and try again
-                    aac_pos++;
-                }
-            }
-        }
+    if (channels == 1) Pcm_upmixInPlaceS16(samples, frames);
+    if (!resampling) {
+        ring_write_stereo(samples, frames, channels, stretching);
+        return;
+    }
 
-        // Update state based on buffer level - require 10 seconds of audio before playing
-        // This provides maximum headroom for network latency
-        if (radio.state == RADIO_STATE_BUFFERING &&
-            radio.audio_ring_count > SAMPLE_RATE * 2 * 10) {  // 10 seconds of stereo audio
-            radio.state = RADIO_STATE_PLAYING;
+    if (!radio.resampler) {
+        radio.resampler = Resampler_new(RESAMPLER_STANDARD);
+        if (!radio.resampler) {
+            LOG_ASYNC_error("Radio: no memory for the resampler\n");
+            return;
         }
+    }
 
-        // Track the sequence number of the segment we just played (before incrementing)
-        radio.hls.last_played_sequence = radio.hls.media_sequence + radio.hls.current_segment;
+    // Output in blocks of RADIO_RESAMPLE_FRAMES, the resampler holds the rest
+    // (a new rate pair restarts it)
+    int16_t out[RADIO_RESAMPLE_FRAMES * AUDIO_CHANNELS];
+    size_t n = Resampler_processS16(radio.resampler, samples, frames, sample_rate, out_rate,
+                                    out, RADIO_RESAMPLE_FRAMES, false);
+    while (n > 0) {
+        ring_write_stereo(out, (int)n, channels, stretching);
+        if (n < RADIO_RESAMPLE_FRAMES) break;
+        n = Resampler_processS16(radio.resampler, NULL, 0, sample_rate, out_rate,
+                                 out, RADIO_RESAMPLE_FRAMES, false);
+    }
+}
 
-        radio.hls.current_segment++;
+// Audio of the demuxed stream on the network stage (radio_conn_demux callback):
+// after a reconnect (*resync), the new connection's bytes are dropped up to the
+// first frame header, so the decoder picks up on a frame boundary
+static void on_network_audio(void* ctx, const uint8_t* data, int len) {
+    bool* resync = ctx;
+    if (*resync) {
+        int offset = radio.audio_format == RADIO_FORMAT_AAC    ? AACFindSyncWord((unsigned char*)data, len)
+                     : radio.audio_format == RADIO_FORMAT_VORBIS ? find_ogg_bos(data, len)
+                                                                 : find_mp3_sync(data, len);
+        if (offset < 0) return;
+        data += offset;
+        len -= offset;
+        *resync = false;
     }
+    on_stream_audio(NULL, data, len);
+}
 
+// Reopen the stream after it ended (network stage), backing off between attempts;
+// the decode stage keeps draining what is buffered meanwhile
+// Returns false if every attempt failed or playback stopped.
+static bool reconnect_stream(void) {
+    uint64_t start = radio_now_ms();
+    __atomic_add_fetch(&radio.stats.reconnects, 1, __ATOMIC_RELAXED);
+    LOG_ASYNC_info("Radio: %s, reconnecting\n", radio.conn->error);
+
+    bool connected = false;
+    for (int attempt = 0; attempt < RADIO_RECONNECT_ATTEMPTS && !connected && !radio.should_stop; attempt++) {
+        int delay = RADIO_RECONNECT_BASE_MS << attempt;
+        if (delay > RADIO_RECONNECT_MAX_MS) delay = RADIO_RECONNECT_MAX_MS;
+        delay = delay / 2 + rand() % (delay / 2 + 1);
+        for (int waited = 0; waited < delay && !radio.should_stop; waited += 100) {
+            usleep((delay - waited < 100 ? delay - waited : 100) * 1000);
+        }
+        if (radio.should_stop) break;
 
-    // Note: segment_buf and aac_buf are pre-allocated in RadioContext, not freed here
+        radio_conn_close(radio.conn);
+        connected = radio_conn_open(radio.conn, radio.current_url) == 0;
+        if (!connected) LOG_ASYNC_error("Radio: reconnect %d failed: %s\n", attempt + 1, radio.conn->error);
+    }
 
-    return NULL;
+    uint32_t outage = (uint32_t)(radio_now_ms() - start);
+    __atomic_add_fetch(&radio.stats.outage_ms, outage, __ATOMIC_RELAXED);
+    if (outage > __atomic_load_n(&radio.stats.outage_max_ms, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&radio.stats.outage_max_ms, outage, __ATOMIC_RELAXED);
+    }
+    return connected;
 }
 
-// Find MP3 sync word in buffer
-// Returns offset to sync word, or -1 if not found
-static int find_mp3_sync(const uint8_t* buf, int size) {
-    for (int i = 0; i < size - 1; i++) {
-        // MP3 sync: 0xFF followed by 0xE0-0xFF (11 bits set)
-        if (buf[i] == 0xFF && (buf[i + 1] & 0xE0) == 0xE0) {
-            return i;
-        }
-    }
-    return -1;
+// Network stage: receives the stream, strips ICY metadata and hands the audio
+// bytes to the decode stage through the bitstream ring, reconnecting when the
+// stream ends
+// Low water for the network stage's socket: a second of stream data while the
+// screen is off and the jitter buffer is well ahead, 0 otherwise (network thread)
+static int low_wakeup_bytes(bool active) {
+    if (!__atomic_load_n(&radio.power_save, __ATOMIC_RELAXED) || radio.state != RADIO_STATE_PLAYING) return 0;
+    int margin = buffered_ms() - __atomic_load_n(&radio.target_ms, __ATOMIC_RELAXED);
+    if (margin < (active ? RADIO_LOW_WAKEUP_MARGIN_MS / 2 : RADIO_LOW_WAKEUP_MARGIN_MS)) return 0;
+    int bytes = current_byte_rate() * RADIO_LOW_WAKEUP_MS / 1000;
+    return bytes < RADIO_LOW_WAKEUP_MAX ? bytes : RADIO_LOW_WAKEUP_MAX;
 }
 
-// Streaming thread
-static void* stream_thread_func(void* arg) {
+static void* network_thread_func(void* arg) {
     (void)arg;  // Unused
-    uint8_t recv_buf[8192];
+    ThreadRole_apply(THREAD_ROLE_DECODE);
+    uint8_t recv_buf[RADIO_LOW_WAKEUP_MAX + RADIO_RECV_SIZE];
+    uint64_t last_arrival = 0;  // End of the previous chunk's processing
+    bool resync = false;        // Reconnected: skip to the next frame header
+    int low_water = 0;          // Set on the socket: low-wakeup receiving
+
+    // Taken over from a standby: its audio comes first, for an instant start
+    if (radio.warm_window) {
+        net_write(radio.warm_window, radio.warm_window_len);
+        free(radio.warm_window);
+        radio.warm_window = NULL;
+    }
 
-    while (!radio.should_stop && radio.socket_fd >= 0) {
-        bool has_data = false;
+    while (!radio.should_stop && radio.conn) {
+        // Low-wakeup receiving: the socket turns readable with a second of data
+        int want = low_wakeup_bytes(low_water > 0);
+        if ((want > 0) != (low_water > 0)) {
+            if (radio_conn_setLowWater(radio.conn, want > 0 ? want : 1) == 0) low_water = want;
+            last_arrival = 0;   // Its gaps aren't arrival jitter either
+        }
 
-        // For SSL, check if there's pending data in the SSL buffer first
-        if (radio.use_ssl && mbedtls_ssl_get_bytes_avail(&radio.ssl) > 0) {
-            has_data = true;
+        // Radio_stop interrupts the wait through wake_fd
+        int ret = radio_conn_wait(radio.conn, low_water > 0 ? RADIO_LOW_WAKEUP_MS * 2 : 100, radio.wake_fd);
+        if (ret == 0) continue;
+
+        // Receive data; in low-wakeup mode, all that is queued
+        int bytes_read = ret > 0 ? radio_conn_recv(radio.conn, recv_buf,
+                                                   low_water > 0 ? sizeof(recv_buf) : RADIO_RECV_SIZE) : -1;
+        while (low_water > 0 && bytes_read > 0 && (size_t)bytes_read + RADIO_RECV_SIZE <= sizeof(recv_buf) &&
+               radio_conn_pending(radio.conn) > 0) {
+            int n = radio_conn_recv(radio.conn, recv_buf + bytes_read, sizeof(recv_buf) - bytes_read);
+            if (n <= 0) break;  // An ended stream shows on the next receive
+            bytes_read += n;
+        }
+        if (bytes_read == 0) continue;  // TLS record incomplete, retry
+        if (bytes_read < 0 && reconnect_stream()) {
+            resync = true;
+            last_arrival = 0;   // The outage isn't arrival jitter
+            low_water = 0;      // A new socket
+            continue;
+        }
+        if (bytes_read < 0) {
+            if (radio.should_stop) break;
+            radio.state = RADIO_STATE_ERROR;
+            snprintf(radio.error_msg, sizeof(radio.error_msg), "%s", radio.conn->error);
+            break;
         }
 
-        // If no pending SSL data, use select to wait for socket data
-        if (!has_data) {
-            fd_set read_fds;
-            FD_ZERO(&read_fds);
-            FD_SET(radio.socket_fd, &read_fds);
+        // Arrival jitter: time spent waiting on the socket (not on a full ring)
+        if (last_arrival > 0) {
+            int gap = (int)(radio_now_ms() - last_arrival);
+            if (gap > __atomic_load_n(&radio.arrival_gap_ms, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&radio.arrival_gap_ms, gap, __ATOMIC_RELAXED);
+            }
+        }
 
-            struct timeval tv = {0, 100000};  // 100ms timeout
-            int ret = select(radio.socket_fd + 1, &read_fds, NULL, NULL, &tv);
+        // Audio goes to the decode stage, ICY metadata updates the song
+        radio_conn_demux(radio.conn, recv_buf, bytes_read, on_network_audio, parse_icy_metadata, &resync);
 
-            if (ret < 0) {
-                radio.state = RADIO_STATE_ERROR;
-                snprintf(radio.error_msg, sizeof(radio.error_msg), "Select error");
-                break;
-            }
+        last_arrival = low_water > 0 ? 0 : radio_now_ms();
 
-            if (ret == 0) continue;  // Timeout, check should_stop
-            has_data = true;
+        // If buffering and have enough data
+        if (radio.state == RADIO_STATE_CONNECTING && bitstream_available() > 0) {
+            radio.state = RADIO_STATE_BUFFERING;
         }
+    }
 
-        // Receive data
-        int bytes_read = radio_recv(recv_buf, sizeof(recv_buf));
-        if (bytes_read <= 0) {
-            // For SSL, check if it's a non-fatal error
-            if (radio.use_ssl && (bytes_read == MBEDTLS_ERR_SSL_WANT_READ ||
-                                   bytes_read == MBEDTLS_ERR_SSL_WANT_WRITE)) {
-                continue;  // Retry
-            }
-            radio.state = RADIO_STATE_ERROR;
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Stream ended");
-            break;
+    __atomic_store_n(&radio.net_done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Continue decoding from a time-shift position (decode thread): drop the stream
+// buffer, the decoder history and the decoded audio of the old position
+static void apply_seek(uint64_t pos) {
+    radio_timeshift_seek(pos);
+    radio.stream_buffer_start = 0;
+    radio.stream_buffer_pos = 0;
+    __atomic_store_n(&radio.stream_buffer_level, 0, __ATOMIC_RELAXED);
+
+    if (radio.mp3_initialized) drmp3dec_init(&radio.mp3_decoder);
+    if (radio.aac_initialized) AACFlushCodec(radio.aac_decoder);
+    if (radio.vorbis) stb_vorbis_flush_pushdata(radio.vorbis);    // Resyncs on the next page
+    Equalizer_reset(&radio.eq);
+    if (radio.resampler) Resampler_reset(radio.resampler);     // Its history too
+    if (radio.stretch) TimeStretch_reset(radio.stretch, 0);
+    circular_buffer_clear(&radio.audio_ring);
+
+    radio.play_us = __atomic_load_n(&radio.seek_ms, __ATOMIC_RELAXED) * 1000;
+    radio.next_mark_us = radio.play_us;
+    if (radio.state == RADIO_STATE_PLAYING) radio.state = RADIO_STATE_BUFFERING;
+}
+
+// Artist and title from a Vorbis stream's comments, for Ogg streams without ICY
+// metadata (decode thread)
+static void vorbis_set_song(void) {
+    stb_vorbis_comment comments = stb_vorbis_get_comment(radio.vorbis);
+    const char* artist = "";
+    const char* title = "";
+    for (int i = 0; i < comments.comment_list_length; i++) {
+        const char* c = comments.comment_list[i];
+        if (strncasecmp(c, "ARTIST=", 7) == 0) artist = c + 7;
+        else if (strncasecmp(c, "TITLE=", 6) == 0) title = c + 6;
+    }
+    if (!title[0]) return;
+    if (strcmp(artist, radio.metadata.artist) == 0 && strcmp(title, radio.metadata.title) == 0) return;
+    snprintf(radio.metadata.artist, sizeof(radio.metadata.artist), "%s", artist);
+    snprintf(radio.metadata.title, sizeof(radio.metadata.title), "%s", title);
+    publish_metadata();
+    radio_album_art_fetch(radio.metadata.artist, radio.metadata.title);
+}
+
+// Open the Vorbis decoder on the stream start at the front of the stream buffer
+// (decode thread). An Opus stream is stopped with an error instead.
+// Returns false if more data is needed.
+static bool vorbis_open(void) {
+    int bos = find_ogg_bos(stream_data(), stream_available());
+    if (bos < 0) {
+        // Keep a partial page header
+        if (stream_available() > 5) stream_consume(stream_available() - 5);
+        return false;
+    }
+    stream_consume(bos);
+
+    const uint8_t* page = stream_data();
+    int avail = stream_available();
+    if (avail < 27 || avail < 27 + page[26] + 8) return false;
+    if (memcmp(page + 27 + page[26], "OpusHead", 8) == 0) {
+        radio.audio_format = RADIO_FORMAT_OPUS;
+        radio.state = RADIO_STATE_ERROR;
+        snprintf(radio.error_msg, sizeof(radio.error_msg), "Opus streams are not supported");
+        return false;
+    }
+
+    int used = 0, error = 0;
+    radio.vorbis = stb_vorbis_open_pushdata(page, avail, &used, &error, NULL);
+    if (!radio.vorbis) {
+        // All headers must be in the buffer at once; past that, it isn't Vorbis
+        if (error != VORBIS_need_more_data || avail >= radio.stream_buffer_size) stream_consume(1);
+        return false;
+    }
+    stream_consume(used);
+
+    stb_vorbis_info info = stb_vorbis_get_info(radio.vorbis);
+    radio.vorbis_sample_rate = info.sample_rate;
+    radio.vorbis_channels = info.channels;
+    vorbis_set_song();
+    return true;
+}
+
+// Decode Ogg Vorbis from the stream buffer (decode thread). stb_vorbis doesn't
+// follow chained streams, so each new logical stream gets a new decoder: data
+// is handed over only up to the next stream start.
+static void decode_vorbis(void) {
+    int16_t decode_buf[4096 * AUDIO_CHANNELS];
+
+    while (stream_available() >= 4096 && radio.state != RADIO_STATE_ERROR) {
+        if (radio.vorbis && find_ogg_bos(stream_data(), 6) == 0) {
+            stb_vorbis_close(radio.vorbis);
+            radio.vorbis = NULL;
+        }
+        if (!radio.vorbis) {
+            if (!vorbis_open()) return;
+            Equalizer_reset(&radio.eq);
+            if (radio.state == RADIO_STATE_CONNECTING) radio.state = RADIO_STATE_BUFFERING;
+            continue;
         }
 
-        // Process received data
-        int i = 0;
-        while (i < bytes_read && !radio.should_stop) {
-            if (radio.icy_metaint > 0 && radio.bytes_until_meta == 0) {
-                // Read metadata length byte
-                int meta_len = recv_buf[i++] * 16;
-                if (meta_len > 0 && i + meta_len <= bytes_read) {
-                    parse_icy_metadata(&recv_buf[i], meta_len);
-                    i += meta_len;
-                }
-                radio.bytes_until_meta = radio.icy_metaint;
+        int len = stream_available();
+        int next = find_ogg_bos(stream_data(), len);
+        if (next > 0) len = next;
+
+        int channels = 0, samples = 0;
+        float** output = NULL;
+        int used = stb_vorbis_decode_frame_pushdata(radio.vorbis, stream_data(), len, &channels, &output, &samples);
+        if (used == 0) {
+            if (next > 0) {
+                stream_consume(next);   // The rest of the song's last page
+            } else if (len >= radio.stream_buffer_size) {
+                // A frame bigger than the buffer: skip ahead
+                stb_vorbis_flush_pushdata(radio.vorbis);
+                stream_consume(len / 2);
             } else {
-                // Calculate how many bytes to copy
-                int bytes_to_copy = bytes_read - i;
-                if (radio.icy_metaint > 0 && bytes_to_copy > radio.bytes_until_meta) {
-                    bytes_to_copy = radio.bytes_until_meta;
-                }
+                return;                 // Need more data
+            }
+            continue;
+        }
+        stream_consume(used);
+        if (samples <= 0 || channels <= 0) continue;
+
+        if (samples > 4096) samples = 4096;
+        int out_channels = channels > 1 ? 2 : 1;
+        note_decoded_frame(used, samples, radio.vorbis_sample_rate, channels);
+        Pcm_planarF32ToS16(output, out_channels, decode_buf, samples);
+        Equalizer_processS16(&radio.eq, radio.vorbis_sample_rate, decode_buf, samples, out_channels);
+        ring_write_pcm(decode_buf, samples, radio.vorbis_sample_rate, out_channels);
+    }
+}
 
-                // Add to stream buffer if space available
-                if (radio.stream_buffer_pos + bytes_to_copy <= radio.stream_buffer_size) {
-                    memcpy(radio.stream_buffer + radio.stream_buffer_pos, &recv_buf[i], bytes_to_copy);
-                    radio.stream_buffer_pos += bytes_to_copy;
-                }
+// Decode stage: drains the bitstream ring into the stream buffer and decodes it
+static void* decode_thread_func(void* arg) {
+    (void)arg;  // Unused
+    ThreadRole_apply(THREAD_ROLE_DECODE);
 
-                i += bytes_to_copy;
-                if (radio.icy_metaint > 0) {
-                    radio.bytes_until_meta -= bytes_to_copy;
-                }
-            }
+    while (!radio.should_stop) {
+        int64_t seek = __atomic_exchange_n(&radio.seek_pos, -1, __ATOMIC_ACQ_REL);
+        if (seek >= 0) apply_seek((uint64_t)seek);
+
+        // Checked before draining so bytes written just before the network stage
+        // ended are still decoded; a full stream buffer always has frames to decode
+        bool net_done = __atomic_load_n(&radio.net_done, __ATOMIC_ACQUIRE);
+        if (stream_fill() == 0 && stream_available() < radio.stream_buffer_size) {
+            if (net_done) break;
+            usleep(RADIO_STAGE_WAIT_US);
+            continue;
         }
 
         // Initialize decoder once we have enough data
-        if (radio.stream_buffer_pos >= 16384) {
+        if (stream_available() >= (radio.audio_format == radio.memo_format ? RADIO_DECODER_MEMO_BYTES
+                                                                           : RADIO_DECODER_START_BYTES)) {
             if (radio.audio_format == RADIO_FORMAT_AAC && !radio.aac_initialized) {
                 // Initialize AAC decoder
                 radio.aac_decoder = AACInitDecoder();
                 if (radio.aac_decoder) {
                     radio.aac_initialized = true;
-                    radio.aac_inbuf_size = 0;
+                    radio.aac_skip_sbr = false;
                     radio.aac_sample_rate = 0;  // Will be set on first frame
+                    Equalizer_reset(&radio.eq);
                     radio.state = RADIO_STATE_BUFFERING;
                 } else {
-                    LOG_error("AAC decoder init failed\n");
+                    LOG_ASYNC_error("AAC decoder init failed\n");
                 }
             } else if (radio.audio_format == RADIO_FORMAT_MP3 && !radio.mp3_initialized) {
                 // Initialize low-level MP3 decoder for streaming
 
                 // Find MP3 sync word first
-                int sync_offset = find_mp3_sync(radio.stream_buffer, radio.stream_buffer_pos);
+                int sync_offset = find_mp3_sync(stream_data(), stream_available());
                 if (sync_offset >= 0) {
                     // Skip to sync word
-                    if (sync_offset > 0) {
-                        memmove(radio.stream_buffer, radio.stream_buffer + sync_offset,
-                                radio.stream_buffer_pos - sync_offset);
-                        radio.stream_buffer_pos -= sync_offset;
-                    }
+                    stream_consume(sync_offset);
 
                     // Initialize low-level decoder
                     drmp3dec_init(&radio.mp3_decoder);
                     radio.mp3_initialized = true;
                     radio.mp3_sample_rate = 0;  // Will be set on first frame
                     radio.mp3_channels = 0;
+                    Equalizer_reset(&radio.eq);
                     radio.state = RADIO_STATE_BUFFERING;
                 } else {
-                    LOG_error("No MP3 sync found in buffer\n");
+                    LOG_ASYNC_error("No MP3 sync found in buffer\n");
                 }
             }
         }
 
-        // Decode audio based on format
-        if (radio.audio_format == RADIO_FORMAT_AAC && radio.aac_initialized && radio.stream_buffer_pos >= 4096) {
-            // AAC decoding
-            // Copy data to AAC input buffer
-            int copy_size = radio.stream_buffer_pos;
-            if (radio.aac_inbuf_size + copy_size > sizeof(radio.aac_inbuf)) {
-                copy_size = sizeof(radio.aac_inbuf) - radio.aac_inbuf_size;
-            }
-            if (copy_size > 0) {
-                memcpy(radio.aac_inbuf + radio.aac_inbuf_size, radio.stream_buffer, copy_size);
-                radio.aac_inbuf_size += copy_size;
-                // Shift stream buffer
-                memmove(radio.stream_buffer, radio.stream_buffer + copy_size, radio.stream_buffer_pos - copy_size);
-                radio.stream_buffer_pos -= copy_size;
-            }
+        // Nothing to decode an Opus stream with: stop draining it
+        if (radio.audio_format == RADIO_FORMAT_OPUS) break;
 
-            // Find sync and decode AAC frames
-            while (radio.aac_inbuf_size >= AAC_MAINBUF_SIZE) {
-                int sync_offset = AACFindSyncWord(radio.aac_inbuf, radio.aac_inbuf_size);
+        // Decode audio based on format
+        if (radio.audio_format == RADIO_FORMAT_AAC && radio.aac_initialized && stream_available() >= 4096) {
+            // AAC decoding, straight from the stream buffer
+            while (stream_available() >= AAC_MAINBUF_SIZE) {
+                int sync_offset = AACFindSyncWord(stream_data(), stream_available());
                 if (sync_offset < 0) {
                     // No sync found, discard data
-                    radio.aac_inbuf_size = 0;
+                    stream_consume(stream_available());
                     break;
                 }
 
                 // Skip to sync word
-                if (sync_offset > 0) {
-                    memmove(radio.aac_inbuf, radio.aac_inbuf + sync_offset, radio.aac_inbuf_size - sync_offset);
-                    radio.aac_inbuf_size -= sync_offset;
-                }
+                stream_consume(sync_offset);
 
                 // Decode frame - extra room for HE-AAC (can output 4096 samples)
                 int16_t decode_buf[AAC_MAX_NSAMPS * AAC_MAX_NCHANS * 2];
-                unsigned char* inptr = radio.aac_inbuf;
-                int bytes_left = radio.aac_inbuf_size;
+                unsigned char* inptr = stream_data();
+                int bytes_left = stream_available();
+
+                // Power saving: HE-AAC without SBR, the core at half rate (resampled)
+                bool skip_sbr = __atomic_load_n(&radio.power_save, __ATOMIC_RELAXED);
+                if (skip_sbr != radio.aac_skip_sbr) {
+                    AACSetSkipSBR(radio.aac_decoder, skip_sbr);
+                    radio.aac_skip_sbr = skip_sbr;
+                }
 
                 int err = AACDecode(radio.aac_decoder, &inptr, &bytes_left, decode_buf);
 
@@ -1022,170 +1215,187 @@ static void* stream_thread_func(void* arg) {
                     AACFrameInfo frame_info;
                     AACGetLastFrameInfo(radio.aac_decoder, &frame_info);
 
-                    // Update sample rate/channels on first successful decode
-                    if (radio.aac_sample_rate == 0 && frame_info.sampRateOut > 0) {
+                    // Note sample rate/channels on first successful decode, or when
+                    // an HLS rendition switch changes them (the resampler follows)
+                    if (frame_info.sampRateOut > 0 && frame_info.sampRateOut != radio.aac_sample_rate) {
                         radio.aac_sample_rate = frame_info.sampRateOut;
                         radio.aac_channels = frame_info.nChans;
-                        // Reconfigure audio device to match stream's sample rate
-                        Player_setSampleRate(frame_info.sampRateOut);
-                        Player_resumeAudio();  // Resume after reconfiguration
                     }
 
                     // Consume the decoded data
-                    int consumed = radio.aac_inbuf_size - bytes_left;
-                    memmove(radio.aac_inbuf, radio.aac_inbuf + consumed, bytes_left);
-                    radio.aac_inbuf_size = bytes_left;
-
-                    if (frame_info.outputSamps > 0) {
-                        pthread_mutex_lock(&radio.audio_mutex);
-
-                        // Add to ring buffer (handle mono/stereo)
-                        int samples = frame_info.outputSamps;
-                        for (int s = 0; s < samples; s++) {
-                            if (radio.audio_ring_count < AUDIO_RING_SIZE) {
-                                radio.audio_ring[radio.audio_ring_write] = decode_buf[s];
-                                radio.audio_ring_write = (radio.audio_ring_write + 1) % AUDIO_RING_SIZE;
-                                radio.audio_ring_count++;
-                            }
-                        }
-
-                        pthread_mutex_unlock(&radio.audio_mutex);
+                    int consumed = stream_available() - bytes_left;
+                    stream_consume(consumed);
+                    if (frame_info.nChans > 0) {
+                        note_decoded_frame(consumed, frame_info.outputSamps / frame_info.nChans,
+                                           frame_info.sampRateOut, frame_info.nChans);
+                    }
+
+                    if (frame_info.outputSamps > 0 && frame_info.nChans > 0) {
+                        int frames = frame_info.outputSamps / frame_info.nChans;
+                        Equalizer_processS16(&radio.eq, frame_info.sampRateOut, decode_buf,
+                                             frames, frame_info.nChans);
+                        ring_write_pcm(decode_buf, frames, frame_info.sampRateOut, frame_info.nChans);
                     }
                 } else if (err == ERR_AAC_INDATA_UNDERFLOW) {
                     // Need more data
                     break;
                 } else {
                     // Error, skip a byte and try again
-                    memmove(radio.aac_inbuf, radio.aac_inbuf + 1, radio.aac_inbuf_size - 1);
-                    radio.aac_inbuf_size--;
+                    stream_consume(1);
                 }
             }
 
-            // Update state based on buffer level
-            if (radio.state == RADIO_STATE_BUFFERING &&
-                radio.audio_ring_count > AUDIO_RING_SIZE * 2 / 3) {
-                radio.state = RADIO_STATE_PLAYING;
-            }
-        } else if (radio.audio_format == RADIO_FORMAT_MP3 && radio.mp3_initialized && radio.stream_buffer_pos >= 1024) {
+        } else if (radio.audio_format == RADIO_FORMAT_MP3 && radio.mp3_initialized && stream_available() >= 1024) {
             // MP3 decoding using low-level frame decoder
             // DRMP3_MAX_SAMPLES_PER_FRAME = 1152*2 = 2304
             int16_t decode_buf[2304 * 2];  // Stereo samples
             drmp3dec_frame_info frame_info;
 
             // Decode frames while we have data
-            while (radio.stream_buffer_pos >= 512) {
+            while (stream_available() >= 512) {
                 // Find sync word
-                int sync_offset = find_mp3_sync(radio.stream_buffer, radio.stream_buffer_pos);
+                int sync_offset = find_mp3_sync(stream_data(), stream_available());
                 if (sync_offset < 0) {
                     // No sync found, keep last few bytes in case sync spans buffer boundary
-                    if (radio.stream_buffer_pos > 4) {
-                        memmove(radio.stream_buffer, radio.stream_buffer + radio.stream_buffer_pos - 4, 4);
-                        radio.stream_buffer_pos = 4;
-                    }
+                    if (stream_available() > 4) stream_consume(stream_available() - 4);
                     break;
                 }
 
                 // Skip to sync
-                if (sync_offset > 0) {
-                    memmove(radio.stream_buffer, radio.stream_buffer + sync_offset,
-                            radio.stream_buffer_pos - sync_offset);
-                    radio.stream_buffer_pos -= sync_offset;
-                }
+                stream_consume(sync_offset);
 
                 // Decode frame
                 int samples = drmp3dec_decode_frame(&radio.mp3_decoder,
-                                                     radio.stream_buffer,
-                                                     radio.stream_buffer_pos,
+                                                     stream_data(),
+                                                     stream_available(),
                                                      decode_buf,
                                                      &frame_info);
 
                 if (samples > 0 && frame_info.frame_bytes > 0) {
-                    // Update sample rate/channels on first successful decode
+                    // Note sample rate/channels on first successful decode
                     if (radio.mp3_sample_rate == 0) {
                         radio.mp3_sample_rate = frame_info.sample_rate;
                         radio.mp3_channels = frame_info.channels;
-                       // Reconfigure audio device to match stream's sample rate
-                        Player_setSampleRate(frame_info.sample_rate);
-                        Player_resumeAudio();  // Resume after reconfiguration
                     }
 
                     // Consume the frame
-                    memmove(radio.stream_buffer, radio.stream_buffer + frame_info.frame_bytes,
-                            radio.stream_buffer_pos - frame_info.frame_bytes);
-                    radio.stream_buffer_pos -= frame_info.frame_bytes;
+                    stream_consume(frame_info.frame_bytes);
+                    note_decoded_frame(frame_info.frame_bytes, samples, frame_info.sample_rate,
+                                       frame_info.channels);
 
-                    // Add decoded samples to ring buffer
-                    pthread_mutex_lock(&radio.audio_mutex);
-
-                    int total_samples = samples * frame_info.channels;
-                    for (int s = 0; s < total_samples; s++) {
-                        if (radio.audio_ring_count < AUDIO_RING_SIZE) {
-                            radio.audio_ring[radio.audio_ring_write] = decode_buf[s];
-                            radio.audio_ring_write = (radio.audio_ring_write + 1) % AUDIO_RING_SIZE;
-                            radio.audio_ring_count++;
-                        }
-                    }
+                    Equalizer_processS16(&radio.eq, frame_info.sample_rate, decode_buf,
+                                         samples, frame_info.channels);
 
-                    pthread_mutex_unlock(&radio.audio_mutex);
+                    // Add decoded samples to ring buffer
+                    ring_write_pcm(decode_buf, samples, frame_info.sample_rate, frame_info.channels);
                 } else if (frame_info.frame_bytes > 0) {
                     // Invalid frame, skip it
-                    memmove(radio.stream_buffer, radio.stream_buffer + frame_info.frame_bytes,
-                            radio.stream_buffer_pos - frame_info.frame_bytes);
-                    radio.stream_buffer_pos -= frame_info.frame_bytes;
+                    stream_consume(frame_info.frame_bytes);
                 } else {
                     // Need more data
                     break;
                 }
             }
-
-            // Update state based on buffer level
-            if (radio.state == RADIO_STATE_BUFFERING &&
-                radio.audio_ring_count > AUDIO_RING_SIZE * 2 / 3) {
-                radio.state = RADIO_STATE_PLAYING;
-            }
+        } else if (radio.audio_format == RADIO_FORMAT_VORBIS && stream_available() >= 4096) {
+            decode_vorbis();
+            if (radio.audio_format == RADIO_FORMAT_OPUS) break;
         }
 
-        // If buffering and have enough data
-        if (radio.state == RADIO_STATE_CONNECTING && radio.stream_buffer_pos > 0) {
-            radio.state = RADIO_STATE_BUFFERING;
-        }
+        check_prebuffered();
     }
 
     return NULL;
 }
 
+// Start the decode stage, then the network stage feeding it (stack_size 0 = default)
+// Close the direct stream's connection (no thread is using it)
+static void close_conn(void) {
+    free(radio.warm_window);
+    radio.warm_window = NULL;
+    if (!radio.conn) return;
+    radio_conn_close(radio.conn);
+    free(radio.conn);
+    radio.conn = NULL;
+}
+
+static int start_pipeline(void* (*network_func)(void*), size_t stack_size) {
+    radio.should_stop = false;
+    if (pthread_create(&radio.decode_thread, NULL, decode_thread_func, NULL) != 0) return -1;
+    radio.decode_thread_running = true;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack_size > 0) pthread_attr_setstacksize(&attr, stack_size);
+    int ret = pthread_create(&radio.stream_thread, &attr, network_func, NULL);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
+        radio.should_stop = true;
+        pthread_join(radio.decode_thread, NULL);
+        radio.decode_thread_running = false;
+        return -1;
+    }
+    radio.thread_running = true;
+    return 0;
+}
+
+// Allocate what a stream of this type needs (main thread, pipeline stopped):
+// the stream buffer and both rings, and the HLS segment buffers only for HLS
+static int ensure_buffers(StreamType type) {
+    radio.idle_since_ms = 0;
+    if (!radio.stream_buffer) {
+        radio.stream_buffer_size = RADIO_BUFFER_SIZE;
+        radio.stream_buffer = MEM_MALLOC(MEM_TAG_RADIO_STREAM, radio.stream_buffer_size);
+    }
+    if (!radio.net_ring.buffer) {
+        circular_buffer_init(&radio.net_ring, NET_RING_SIZE, 1, MEM_TAG_RADIO_RING);
+    }
+    if (!radio.audio_ring.buffer) {
+        circular_buffer_init(&radio.audio_ring, AUDIO_RING_SIZE, sizeof(int16_t), MEM_TAG_RADIO_RING);
+    }
+    if (!radio.stream_buffer || !radio.net_ring.buffer || !radio.audio_ring.buffer) return -1;
+
+    // A direct stream after an HLS one gives the segment buffers back at once
+    if (type == STREAM_TYPE_HLS) return radio_hls_fetch_init(RADIO_HLS_PREFETCH_SEGMENTS);
+    radio_hls_fetch_quit();
+    return 0;
+}
+
+// Free the stream buffers (main thread, pipeline stopped; the audio callback
+// only reads the ring while the radio is active)
+static void release_buffers(void) {
+    radio_hls_fetch_quit();
+    if (radio.stream_buffer) {
+        MEM_FREE(MEM_TAG_RADIO_STREAM, radio.stream_buffer);
+        radio.stream_buffer = NULL;
+    }
+    radio.stream_buffer_size = 0;
+    circular_buffer_free(&radio.net_ring);
+    circular_buffer_free(&radio.audio_ring);
+    Resampler_free(radio.resampler);
+    radio.resampler = NULL;
+    TimeStretch_free(radio.stretch);
+    radio.stretch = NULL;
+    radio.idle_since_ms = 0;
+}
+
 int Radio_init(void) {
     memset(&radio, 0, sizeof(RadioContext));
 
-    radio.socket_fd = -1;
     radio.state = RADIO_STATE_STOPPED;
 
-    pthread_mutex_init(&radio.audio_mutex, NULL);
-
-    // Allocate buffers
-    radio.stream_buffer_size = RADIO_BUFFER_SIZE;
-    radio.stream_buffer = malloc(radio.stream_buffer_size);
-    radio.audio_ring = malloc(AUDIO_RING_SIZE * sizeof(int16_t));
+    radio.stats.fill_min = -1;
+    radio.stats.since_ms = radio_now_ms();
 
-    // Pre-allocate HLS buffers to reduce memory fragmentation
-    radio.hls_segment_buf = malloc(HLS_SEGMENT_BUF_SIZE);
-    radio.hls_aac_buf = malloc(HLS_SEGMENT_BUF_SIZE);
-    radio.hls_prefetch_buf = malloc(HLS_SEGMENT_BUF_SIZE);
-    radio.hls_prefetch_segment = -1;
-    radio.hls_prefetch_ready = false;
+    radio.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
 
-    if (!radio.stream_buffer || !radio.audio_ring ||
-        !radio.hls_segment_buf || !radio.hls_aac_buf || !radio.hls_prefetch_buf) {
-        LOG_error("Radio_init: Failed to allocate buffers\n");
+    // Stream buffers wait for the first Radio_play
+    if (radio_reactor_init() != 0) {
+        LOG_error("Radio_init: Failed to start the reactor\n");
         Radio_quit();
         return -1;
     }
 
-    // Load default stations
-    radio.station_count = sizeof(default_stations) / sizeof(default_stations[0]);
-    memcpy(radio.stations, default_stations, sizeof(default_stations));
-
-    // Try to load custom stations
+    // Custom stations, else the defaults
     Radio_loadStations();
 
     // Load curated stations from JSON files
@@ -1194,195 +1404,163 @@ int Radio_init(void) {
     // Initialize album art module
     radio_album_art_init();
 
+    // Station prober for the curated browser
+    radio_probe_init();
+
     return 0;
 }
 
 void Radio_quit(void) {
     Radio_stop();
+    radio_record_quit();
+    radio_standby_quit();
+    radio_reactor_quit();
+    release_buffers();
+    if (radio.wake_fd >= 0) close(radio.wake_fd);
+    radio.wake_fd = -1;
+
+    radio_probe_quit();
+    radio_stations_free();
 
     // Cleanup curated stations module
     radio_curated_cleanup();
 
     // Cleanup album art module
     radio_album_art_cleanup();
+}
 
-    pthread_mutex_destroy(&radio.audio_mutex);
-
-    if (radio.stream_buffer) {
-        free(radio.stream_buffer);
-        radio.stream_buffer = NULL;
-    }
-    if (radio.audio_ring) {
-        free(radio.audio_ring);
-        radio.audio_ring = NULL;
-    }
-    if (radio.hls_segment_buf) {
-        free(radio.hls_segment_buf);
-        radio.hls_segment_buf = NULL;
-    }
-    if (radio.hls_aac_buf) {
-        free(radio.hls_aac_buf);
-        radio.hls_aac_buf = NULL;
-    }
-    if (radio.hls_prefetch_buf) {
-        free(radio.hls_prefetch_buf);
-        radio.hls_prefetch_buf = NULL;
-    }
+void Radio_releaseIdle(void) {
+    bool allocated = radio.stream_buffer || radio.net_ring.buffer || radio.audio_ring.buffer;
+    if (!allocated || Radio_isActive() || radio.thread_running || radio.decode_thread_running) return;
+    // Also after a Radio_play that failed before starting the pipeline
+    if (radio.idle_since_ms == 0) radio.idle_since_ms = radio_now_ms();
+    if (radio_now_ms() - radio.idle_since_ms < RADIO_IDLE_RELEASE_MS) return;
+    LOG_info("Radio: idle, releasing stream buffers\n");
+    release_buffers();
 }
 
 int Radio_getStations(RadioStation** stations) {
-    *stations = radio.stations;
-    return radio.station_count;
+    return radio_stations_get(stations);
 }
 
 int Radio_addStation(const char* name, const char* url, const char* genre, const char* slogan) {
-    if (radio.station_count >= RADIO_MAX_STATIONS) return -1;
-
-    RadioStation* s = &radio.stations[radio.station_count];
-    strncpy(s->name, name, RADIO_MAX_NAME - 1);
-    strncpy(s->url, url, RADIO_MAX_URL - 1);
-    strncpy(s->genre, genre ? genre : "", 63);
-    strncpy(s->slogan, slogan ? slogan : "", 127);
-    radio.station_count++;
-
-    return radio.station_count - 1;
+    return radio_stations_add(name, url, genre, slogan);
 }
 
 void Radio_removeStation(int index) {
-    if (index < 0 || index >= radio.station_count) return;
-
-    memmove(&radio.stations[index], &radio.stations[index + 1],
-            (radio.station_count - index - 1) * sizeof(RadioStation));
-    radio.station_count--;
+    radio_stations_remove(index);
 }
 
 void Radio_saveStations(void) {
-    char path[512];
-    snprintf(path, sizeof(path), "%s/radio_stations.txt", SHARED_USERDATA_PATH);
-
-    FILE* f = fopen(path, "w");
-    if (!f) return;
-
-    for (int i = 0; i < radio.station_count; i++) {
-        fprintf(f, "%s|%s|%s|%s\n",
-                radio.stations[i].name,
-                radio.stations[i].url,
-                radio.stations[i].genre,
-                radio.stations[i].slogan);
-    }
-
-    fclose(f);
+    radio_stations_compact(false);
 }
 
 void Radio_loadStations(void) {
-    char path[512];
-    snprintf(path, sizeof(path), "%s/radio_stations.txt", SHARED_USERDATA_PATH);
-
-    FILE* f = fopen(path, "r");
-    if (!f) return;
-
-    radio.station_count = 0;
-
-    char line[1024];
-    while (fgets(line, sizeof(line), f) && radio.station_count < RADIO_MAX_STATIONS) {
-        // Remove newline
-        char* nl = strchr(line, '\n');
-        if (nl) *nl = '\0';
-
-        // Parse: name|url|genre|slogan (slogan is optional)
-        char* name = strtok(line, "|");
-        char* url = strtok(NULL, "|");
-        char* genre = strtok(NULL, "|");
-        char* slogan = strtok(NULL, "|");
-
-        if (name && url) {
-            Radio_addStation(name, url, genre, slogan);
-        }
-    }
-
-    fclose(f);
+    radio_stations_load(default_stations, sizeof(default_stations) / sizeof(default_stations[0]));
 }
 
 int Radio_play(const char* url) {
+    TRACE_SCOPE("Radio_play");
+    RADIO_CAPTURE_STATION(url);
     Radio_stop();
 
-    // Reset audio device to 48000 Hz for radio playback
+    // Run the audio device at the sink's rate (a no-op between stations): streams
+    // at other rates are resampled
     Player_resetSampleRate();
 
     strncpy(radio.current_url, url, RADIO_MAX_URL - 1);
-    radio.state = RADIO_STATE_CONNECTING;
     radio.error_msg[0] = '\0';
 
+    if (ensure_buffers(radio_hls_is_url(url) ? STREAM_TYPE_HLS : STREAM_TYPE_DIRECT) != 0) {
+        LOG_error("Radio_play: Failed to allocate buffers\n");
+        radio.state = RADIO_STATE_ERROR;
+        snprintf(radio.error_msg, sizeof(radio.error_msg), "Memory allocation failed");
+        return -1;
+    }
+    radio.state = RADIO_STATE_CONNECTING;
+
     // Reset buffers
+    radio.stream_buffer_start = 0;
     radio.stream_buffer_pos = 0;
-    radio.audio_ring_write = 0;
-    radio.audio_ring_read = 0;
-    radio.audio_ring_count = 0;
+    circular_buffer_clear(&radio.net_ring);  // Neither stage is running yet
+    radio.net_done = false;
+    radio.stream_buffer_level = 0;
+    radio.byte_rate = 0;
+    radio.pcm_rate = 0;
+    if (radio.resampler) Resampler_reset(radio.resampler);
+    radio.rate_bytes = 0;
+    radio.rate_us = 0;
+    radio.target_ms = RADIO_TARGET_MIN_MS;
+    radio.arrival_gap_ms = 0;
+    radio.stable_since_ms = radio_now_ms();
+    radio.rebuffers_seen = __atomic_load_n(&radio.stats.rebuffers, __ATOMIC_RELAXED);
+    if (radio.stretch) TimeStretch_reset(radio.stretch, 0);
+    radio.play_us = 0;
+    radio.next_mark_us = 0;
+    radio.seek_pos = -1;
+    radio.shifted = false;
+    radio_timeshift_open();     // Without it, radio plays but can't pause for long or seek
+    circular_buffer_clear(&radio.audio_ring);  // The callback only reads while playing
+    radio.marks_head = radio.marks_tail = 0;
+    radio.write_channels = 0;
+    radio.read_channels = AUDIO_CHANNELS;
 
     memset(&radio.metadata, 0, sizeof(RadioMetadata));
+    publish_metadata();
+
+    // What this station was like last time: its byte rate until one is measured,
+    // and the resampler ready for its rate
+    RadioMemo memo;
+    bool have_memo = radio_memo_get(url, &memo);
+    radio.memo_format = have_memo ? (RadioAudioFormat)memo.format : RADIO_FORMAT_UNKNOWN;
+    radio.memo_saved = false;
+    radio.stream_url[0] = '\0';
+    if (have_memo && memo.byte_rate > 0) radio.byte_rate = memo.byte_rate;
+    if (have_memo && memo.sample_rate > 0 && memo.sample_rate != Player_getSampleRate()) {
+        if (!radio.resampler) radio.resampler = Resampler_new(RESAMPLER_STANDARD);
+        if (radio.resampler && Resampler_reserve(radio.resampler, RADIO_RESAMPLE_FRAMES * 2) == 0) {
+            // No input: only builds the filter for the rate pair
+            Resampler_processS16(radio.resampler, NULL, 0, memo.sample_rate, Player_getSampleRate(),
+                                 NULL, 0, false);
+        }
+    }
 
     // Reset HLS state
-    radio.ts_pid_detected = false;
-    radio.ts_aac_pid = -1;
     memset(&radio.hls, 0, sizeof(HLSContext));
 
     // Check if this is an HLS stream
     if (radio_hls_is_url(url)) {
         radio.stream_type = STREAM_TYPE_HLS;
 
-        // Fetch and parse the M3U8 playlist
-        uint8_t* playlist_buf = malloc(64 * 1024);
-        if (!playlist_buf) {
-            radio.state = RADIO_STATE_ERROR;
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Memory allocation failed");
-            return -1;
-        }
-
-        int len = fetch_url_content(url, playlist_buf, 64 * 1024, NULL, 0);
-        if (len <= 0) {
-            free(playlist_buf);
-            radio.state = RADIO_STATE_ERROR;
-            snprintf(radio.error_msg, sizeof(radio.error_msg), "Failed to fetch playlist");
-            return -1;
-        }
-
-        playlist_buf[len] = '\0';
-
-        // Get base URL for resolving relative paths
-        char base_url[HLS_MAX_URL_LEN];
-        radio_hls_get_base_url(url, base_url, HLS_MAX_URL_LEN);
-
         // Initialize segment tracking for new stream
         radio.hls.current_segment = 0;
         radio.hls.last_played_sequence = -1;
 
-        int seg_count = radio_hls_parse_playlist(&radio.hls, (char*)playlist_buf, base_url);
-        free(playlist_buf);
-
-        if (seg_count > 0) {
-            // Playlist parsed successfully
+        // Fetch and parse the M3U8 playlist; of a master playlist, the rendition
+        // the last measured throughput allows
+        TRACE_BEGIN("hls_playlist");
+        int seg_count = radio_hls_fetch_playlist(&radio.hls, url, radio_hls_fetch_throughput());
+        TRACE_END("hls_playlist");
+        if (seg_count < 0) {
+            radio.state = RADIO_STATE_ERROR;
+            snprintf(radio.error_msg, sizeof(radio.error_msg), "Failed to fetch playlist");
+            return -1;
         }
 
-        if (seg_count <= 0) {
+        if (seg_count == 0) {
             radio.state = RADIO_STATE_ERROR;
             snprintf(radio.error_msg, sizeof(radio.error_msg), "No segments in playlist");
             return -1;
         }
 
-        // Start HLS streaming thread with larger stack (mbedtls + getaddrinfo need more stack space)
-        radio.should_stop = false;
-        radio.thread_running = true;
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);
-        size_t stacksize = 1024 * 1024;  // 1MB stack - getaddrinfo uses a lot of stack
-        int stack_result = pthread_attr_setstacksize(&attr, stacksize);
-        if (pthread_create(&radio.stream_thread, &attr, hls_stream_thread_func, NULL) != 0) {
-            pthread_attr_destroy(&attr);
+        // Start the HLS pipeline; the network stage gets a larger stack
+        // (mbedtls + getaddrinfo need more stack space)
+        radio.audio_format = RADIO_FORMAT_AAC;
+        if (start_pipeline(hls_stream_thread_func, 1024 * 1024) != 0) {
             radio.state = RADIO_STATE_ERROR;
             snprintf(radio.error_msg, sizeof(radio.error_msg), "Thread creation failed");
             return -1;
         }
-        pthread_attr_destroy(&attr);
 
         // Unpause audio device for radio playback
         Player_resumeAudio();
@@ -1393,76 +1571,42 @@ int Radio_play(const char* url) {
     // Direct stream (Shoutcast/Icecast)
     radio.stream_type = STREAM_TYPE_DIRECT;
 
-    // Connect with redirect handling (max 5 redirects)
-    char current_url[RADIO_MAX_URL];
-    strncpy(current_url, url, RADIO_MAX_URL - 1);
-    current_url[RADIO_MAX_URL - 1] = '\0';
-
-    int max_redirects = 5;
-    int header_result;
-
-    for (int redirect_count = 0; redirect_count <= max_redirects; redirect_count++) {
-        // Connect to stream
-        if (connect_stream(current_url) != 0) {
+    // A warm standby is already in the live stream: start from what it buffered
+    RadioStandbyTakeover warm;
+    if (radio_standby_take(url, &warm)) {
+        radio.conn = warm.conn;
+        apply_headers(radio.conn);
+        set_song(warm.artist, warm.title);
+        radio.warm_window = warm.window;
+        radio.warm_window_len = warm.window_len;
+    } else {
+        radio.conn = calloc(1, sizeof(RadioConn));
+        if (!radio.conn) {
+            snprintf(radio.error_msg, sizeof(radio.error_msg), "Memory allocation failed");
             radio.state = RADIO_STATE_ERROR;
             return -1;
         }
-
-        // Parse headers
-        header_result = parse_headers();
-
-        if (header_result == 0) {
-            // Success - headers parsed, ready to stream
-            break;
-        } else if (header_result == 1) {
-            // Redirect - cleanup current connection and try new URL
-            if (radio.use_ssl) {
-                ssl_cleanup();
-                radio.use_ssl = false;
-            } else {
-                close(radio.socket_fd);
-            }
-            radio.socket_fd = -1;
-
-            if (radio.redirect_url[0] == '\0') {
-                snprintf(radio.error_msg, sizeof(radio.error_msg), "Empty redirect URL");
-                radio.state = RADIO_STATE_ERROR;
-                return -1;
-            }
-
-            strncpy(current_url, radio.redirect_url, RADIO_MAX_URL - 1);
-            current_url[RADIO_MAX_URL - 1] = '\0';
-
-            if (redirect_count == max_redirects) {
-                snprintf(radio.error_msg, sizeof(radio.error_msg), "Too many redirects");
-                radio.state = RADIO_STATE_ERROR;
-                return -1;
-            }
-        } else {
-            // Error - cleanup connection
-            if (radio.use_ssl) {
-                ssl_cleanup();
-                radio.use_ssl = false;
-            } else {
-                close(radio.socket_fd);
-            }
-            radio.socket_fd = -1;
+        // Straight to where the redirects led last time; through them if that fails
+        bool opened = have_memo && memo.stream_url[0] && radio_conn_open(radio.conn, memo.stream_url) == 0;
+        if (!opened && radio_conn_open(radio.conn, url) != 0) {
+            snprintf(radio.error_msg, sizeof(radio.error_msg), "%s", radio.conn->error);
+            close_conn();
             radio.state = RADIO_STATE_ERROR;
             return -1;
         }
+        apply_headers(radio.conn);
+    }
+    snprintf(radio.stream_url, sizeof(radio.stream_url), "%s", radio.conn->stream_url);
+    if (radio.audio_format == RADIO_FORMAT_OPUS) {
+        close_conn();
+        radio.state = RADIO_STATE_ERROR;
+        snprintf(radio.error_msg, sizeof(radio.error_msg), "Opus streams are not supported");
+        return -1;
     }
 
-    // Start streaming thread
-    radio.should_stop = false;
-    radio.thread_running = true;
-    if (pthread_create(&radio.stream_thread, NULL, stream_thread_func, NULL) != 0) {
-        if (radio.use_ssl) {
-            ssl_cleanup();
-            radio.use_ssl = false;
-        } else {
-            close(radio.socket_fd);
-        }
-        radio.socket_fd = -1;
+    // Start the decode and network stages
+    if (start_pipeline(network_thread_func, 0) != 0) {
+        close_conn();
         radio.state = RADIO_STATE_ERROR;
         snprintf(radio.error_msg, sizeof(radio.error_msg), "Thread creation failed");
         return -1;
@@ -1478,26 +1622,25 @@ void Radio_stop(void) {
     radio.should_stop = true;
 
     if (radio.thread_running) {
+        // Out of a long low-wakeup wait at once
+        uint64_t one = 1, count;
+        if (radio.wake_fd >= 0 && write(radio.wake_fd, &one, sizeof(one)) < 0) {}
         pthread_join(radio.stream_thread, NULL);
         radio.thread_running = false;
+        if (radio.wake_fd >= 0 && read(radio.wake_fd, &count, sizeof(count)) < 0) {}
     }
-
-    // Wait for prefetch thread to finish
-    if (hls_prefetch_thread_active) {
-        pthread_join(hls_prefetch_thread, NULL);
-        hls_prefetch_thread_active = false;
+    if (radio.decode_thread_running) {
+        pthread_join(radio.decode_thread, NULL);
+        radio.decode_thread_running = false;
     }
-    radio.hls_prefetch_ready = false;
-    radio.hls_prefetch_segment = -1;
 
-    // Cleanup SSL if active
-    if (radio.use_ssl) {
-        ssl_cleanup();
-        radio.use_ssl = false;
-    } else if (radio.socket_fd >= 0) {
-        close(radio.socket_fd);
-    }
-    radio.socket_fd = -1;
+    // Segments still queued or downloading for the stream are dropped
+    radio_hls_fetch_reset();
+
+    radio_record_stop();    // After the network thread: nothing more is teed
+    radio_timeshift_close();
+
+    close_conn();
 
     if (radio.mp3_initialized) {
         // Low-level drmp3dec doesn't need uninit
@@ -1510,21 +1653,28 @@ void Radio_stop(void) {
         AACFreeDecoder(radio.aac_decoder);
         radio.aac_decoder = NULL;
         radio.aac_initialized = false;
-        radio.aac_inbuf_size = 0;
         radio.aac_sample_rate = 0;
         radio.aac_channels = 0;
     }
 
+    if (radio.vorbis) {
+        stb_vorbis_close(radio.vorbis);
+        radio.vorbis = NULL;
+        radio.vorbis_sample_rate = 0;
+        radio.vorbis_channels = 0;
+    }
+
     // Reset HLS state
     radio.stream_type = STREAM_TYPE_DIRECT;
-    radio.ts_pid_detected = false;
-    radio.ts_aac_pid = -1;
 
     // Clear album art
     radio_album_art_clear();
 
     radio.state = RADIO_STATE_STOPPED;
 
+    // The buffers stay for a while, for the next station (Radio_releaseIdle)
+    if (radio.stream_buffer && radio.idle_since_ms == 0) radio.idle_since_ms = radio_now_ms();
+
     // Pause audio device when radio stops
     Player_pauseAudio();
 }
@@ -1533,66 +1683,361 @@ RadioState Radio_getState(void) {
     return radio.state;
 }
 
-const RadioMetadata* Radio_getMetadata(void) {
-    return &radio.metadata;
+void Radio_getMetadata(RadioMetadata* metadata) {
+    Seqlock_read(&metadata_lock, metadata, &metadata_published, sizeof(RadioMetadata));
 }
 
 float Radio_getBufferLevel(void) {
-    return (float)radio.audio_ring_count / AUDIO_RING_SIZE;
+    float level = (float)buffered_ms() / RADIO_LEVEL_FULL_MS;
+    return level < 1.0f ? level : 1.0f;
 }
 
 const char* Radio_getError(void) {
     return radio.error_msg;
 }
 
+// Adapt the buffering target (main thread)
+static void update_target(void) {
+    uint64_t now = radio_now_ms();
+    int target = __atomic_load_n(&radio.target_ms, __ATOMIC_RELAXED);
+    int new_target = target;
+
+    // Every rebuffer doubles the target
+    uint32_t rebuffers = __atomic_load_n(&radio.stats.rebuffers, __ATOMIC_RELAXED);
+    if (rebuffers != radio.rebuffers_seen) {
+        radio.rebuffers_seen = rebuffers;
+        new_target = target * 2;
+    }
+
+    // Cover the longest gap in the stream's arrival
+    int gap = __atomic_exchange_n(&radio.arrival_gap_ms, 0, __ATOMIC_RELAXED);
+    if (gap * RADIO_JITTER_FACTOR > new_target) {
+        new_target = gap * RADIO_JITTER_FACTOR;
+    }
+
+    if (new_target > RADIO_TARGET_MAX_MS) new_target = RADIO_TARGET_MAX_MS;
+    if (new_target != target) {
+        radio.stable_since_ms = now;
+    } else if (radio.state == RADIO_STATE_PLAYING && now - radio.stable_since_ms >= RADIO_STABLE_MS) {
+        // Stable for a while: shrink back towards a fast start
+        new_target = target * 3 / 4;
+        if (new_target < RADIO_TARGET_MIN_MS) new_target = RADIO_TARGET_MIN_MS;
+        radio.stable_since_ms = now;
+    }
+    __atomic_store_n(&radio.target_ms, new_target, __ATOMIC_RELAXED);
+}
+
+// Remember what this station's start found out (main thread, once playing)
+static void save_memo(void) {
+    radio.memo_saved = true;
+    RadioMemo memo;
+    memset(&memo, 0, sizeof(memo));
+    snprintf(memo.url, sizeof(memo.url), "%s", radio.current_url);
+    if (strcmp(radio.stream_url, radio.current_url) != 0) {
+        snprintf(memo.stream_url, sizeof(memo.stream_url), "%s", radio.stream_url);
+    }
+    memo.format = radio.audio_format;
+    // Written by the decode thread before it produced the audio now playing
+    if (radio.audio_format == RADIO_FORMAT_AAC) {
+        memo.sample_rate = radio.aac_sample_rate;
+        memo.channels = radio.aac_channels;
+    } else if (radio.audio_format == RADIO_FORMAT_VORBIS) {
+        memo.sample_rate = radio.vorbis_sample_rate;
+        memo.channels = radio.vorbis_channels;
+    } else {
+        memo.sample_rate = radio.mp3_sample_rate;
+        memo.channels = radio.mp3_channels;
+    }
+    memo.byte_rate = __atomic_load_n(&radio.byte_rate, __ATOMIC_RELAXED);
+    if (memo.sample_rate > 0) radio_memo_put(&memo);
+}
+
 void Radio_update(void) {
-    // Check for buffer underrun - transition to buffering when below 2 seconds
-    // This gives time to rebuffer before audio actually runs out
-    if (radio.state == RADIO_STATE_PLAYING && radio.audio_ring_count < SAMPLE_RATE * 2 * 2) {
+    PROFILE_SCOPE("Radio_update");
+    radio_standby_reap();
+    if (!Radio_isActive()) return;
+
+    // Neighbours connect once this station plays, not competing with its start
+    // (re-applied so that a standby whose stream ended reconnects in a while)
+    if (radio.neighbour_count > 0 && radio.state == RADIO_STATE_PLAYING) {
+        const char* urls[RADIO_STANDBY_MAX];
+        for (int i = 0; i < radio.neighbour_count; i++) urls[i] = radio.neighbour_urls[i];
+        radio_standby_set(urls, radio.neighbour_count);
+    }
+
+    // Check for buffer underrun - transition to buffering just before the
+    // decoded audio runs out
+    if (radio.state == RADIO_STATE_PLAYING && buffered_ms() < RADIO_REBUFFER_MS &&
+        !__atomic_load_n(&radio.net_done, __ATOMIC_ACQUIRE)) {
         radio.state = RADIO_STATE_BUFFERING;
+        __atomic_add_fetch(&radio.stats.rebuffers, 1, __ATOMIC_RELAXED);
     }
+
+    update_target();
+
+    // The decode stage also checks, but it may be waiting on the network
+    check_prebuffered();
+
+    if (radio.state == RADIO_STATE_PLAYING && !radio.memo_saved) save_memo();
+}
+
+// Read up to frames stereo frames from the decoded ring (audio callback), mono
+// blocks upmixed. Returns the frames read.
+static int ring_read_frames(int16_t* out, int frames) {
+    int done = 0;
+    while (done < frames) {
+        void* span;
+        size_t avail = circular_buffer_read_span(&radio.audio_ring, &span);   // Flushes first
+        size_t pos = circular_buffer_read_position(&radio.audio_ring);
+
+        // Apply the marks reached; the next one ends this block
+        uint32_t head = __atomic_load_n(&radio.marks_head, __ATOMIC_ACQUIRE);
+        uint32_t tail = radio.marks_tail;
+        while (tail != head && radio.ring_marks[tail % RADIO_RING_MARKS].pos <= pos) {
+            radio.read_channels = radio.ring_marks[tail % RADIO_RING_MARKS].channels;
+            tail++;
+        }
+        __atomic_store_n(&radio.marks_tail, tail, __ATOMIC_RELEASE);
+        if (tail != head && radio.ring_marks[tail % RADIO_RING_MARKS].pos - pos < avail) {
+            avail = radio.ring_marks[tail % RADIO_RING_MARKS].pos - pos;
+        }
+
+        int channels = radio.read_channels;
+        int n = (int)(avail / channels);
+        if (n > frames - done) n = frames - done;
+        if (n <= 0) {
+            // A stereo frame after an odd-length mono block can straddle the
+            // ring's end; taken whole once both halves are in
+            if (avail == 0 || circular_buffer_available(&radio.audio_ring) < AUDIO_CHANNELS) break;
+            circular_buffer_read(&radio.audio_ring, out + done * AUDIO_CHANNELS, AUDIO_CHANNELS);
+            done++;
+            continue;
+        }
+        if (channels == 1) {
+            Pcm_upmixS16(span, out + done * AUDIO_CHANNELS, n);
+        } else {
+            memcpy(out + done * AUDIO_CHANNELS, span, n * AUDIO_CHANNELS * sizeof(int16_t));
+        }
+        circular_buffer_consume(&radio.audio_ring, (size_t)n * channels);
+        done += n;
+    }
+    return done;
 }
 
 int Radio_getAudioSamples(int16_t* buffer, int max_samples) {
-    pthread_mutex_lock(&radio.audio_mutex);
+    int count = buffered_ms();
 
     // Check for underrun and transition to buffering if needed
     // This provides faster response than waiting for Radio_update()
-    if (radio.state == RADIO_STATE_PLAYING && radio.audio_ring_count < SAMPLE_RATE * 2 * 2) {
+    if (radio.state == RADIO_STATE_PLAYING && count < RADIO_REBUFFER_MS &&
+        !__atomic_load_n(&radio.net_done, __ATOMIC_ACQUIRE)) {
         radio.state = RADIO_STATE_BUFFERING;
-        pthread_mutex_unlock(&radio.audio_mutex);
+        __atomic_add_fetch(&radio.stats.rebuffers, 1, __ATOMIC_RELAXED);
         // Fill with silence while buffering
-        for (int i = 0; i < max_samples; i++) {
-            buffer[i] = 0;
-        }
+        memset(buffer, 0, max_samples * sizeof(int16_t));
         return 0;
     }
 
-    int samples_to_read = max_samples;
-    if (samples_to_read > radio.audio_ring_count) {
-        samples_to_read = radio.audio_ring_count;
-    }
+    // Below the target the decode stage stretches what it queues, not this
+    int samples_read = ring_read_frames(buffer, max_samples / AUDIO_CHANNELS) * AUDIO_CHANNELS;
 
-    for (int i = 0; i < samples_to_read; i++) {
-        buffer[i] = radio.audio_ring[radio.audio_ring_read];
-        radio.audio_ring_read = (radio.audio_ring_read + 1) % AUDIO_RING_SIZE;
+    __atomic_add_fetch(&radio.stats.fill_samples, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&radio.stats.fill_sum, count, __ATOMIC_RELAXED);
+    int fill_min = __atomic_load_n(&radio.stats.fill_min, __ATOMIC_RELAXED);
+    if (fill_min < 0 || count < fill_min) {
+        __atomic_store_n(&radio.stats.fill_min, count, __ATOMIC_RELAXED);
     }
-    radio.audio_ring_count -= samples_to_read;
-
-    // Fill rest with silence
-    for (int i = samples_to_read; i < max_samples; i++) {
-        buffer[i] = 0;
+    if (samples_read < max_samples) {
+        __atomic_add_fetch(&radio.stats.underruns, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&radio.stats.silence_samples, max_samples - samples_read, __ATOMIC_RELAXED);
+        // Fill rest with silence
+        memset(buffer + samples_read, 0, (max_samples - samples_read) * sizeof(int16_t));
     }
 
-    pthread_mutex_unlock(&radio.audio_mutex);
+    return samples_read;
+}
+
+void Radio_getStats(RadioStats* stats) {
+    int fill_min = __atomic_load_n(&radio.stats.fill_min, __ATOMIC_RELAXED);
+    uint32_t fill_samples = __atomic_load_n(&radio.stats.fill_samples, __ATOMIC_RELAXED);
+    uint64_t fill_sum = __atomic_load_n(&radio.stats.fill_sum, __ATOMIC_RELAXED);
+    stats->rebuffers = __atomic_load_n(&radio.stats.rebuffers, __ATOMIC_RELAXED);
+    stats->underruns = __atomic_load_n(&radio.stats.underruns, __ATOMIC_RELAXED);
+    stats->silence_samples = __atomic_load_n(&radio.stats.silence_samples, __ATOMIC_RELAXED);
+    stats->buffer_min = fill_min >= 0 ? (float)fill_min / RADIO_LEVEL_FULL_MS : 0.0f;
+    stats->buffer_avg = fill_samples > 0 ? (float)fill_sum / fill_samples / RADIO_LEVEL_FULL_MS : 0.0f;
+
+    stats->net_bytes = __atomic_load_n(&radio.stats.net_bytes, __ATOMIC_RELAXED);
+    stats->decode_bytes = __atomic_load_n(&radio.stats.decode_bytes, __ATOMIC_RELAXED);
+    stats->net_waits = __atomic_load_n(&radio.stats.net_waits, __ATOMIC_RELAXED);
+    stats->decode_waits = __atomic_load_n(&radio.stats.decode_waits, __ATOMIC_RELAXED);
+    stats->reconnects = __atomic_load_n(&radio.stats.reconnects, __ATOMIC_RELAXED);
+    stats->outage_ms = __atomic_load_n(&radio.stats.outage_ms, __ATOMIC_RELAXED);
+    stats->outage_max_ms = __atomic_load_n(&radio.stats.outage_max_ms, __ATOMIC_RELAXED);
+    uint64_t elapsed_ms = radio_now_ms() - __atomic_load_n(&radio.stats.since_ms, __ATOMIC_RELAXED);
+    stats->net_kbps = elapsed_ms > 0 ? (int)(stats->net_bytes * 8 / elapsed_ms) : 0;
+    stats->decode_kbps = elapsed_ms > 0 ? (int)(stats->decode_bytes * 8 / elapsed_ms) : 0;
+    stats->target_ms = __atomic_load_n(&radio.target_ms, __ATOMIC_RELAXED);
+    if (radio_timeshift_isOpen()) {
+        uint64_t recorded = radio_timeshift_writePosition() - radio_timeshift_oldestPosition();
+        stats->bitstream_fill = (float)recorded / TIMESHIFT_CAPACITY;
+    } else {
+        stats->bitstream_fill = radio.net_ring.capacity > 0 ?
+            (float)circular_buffer_available(&radio.net_ring) / radio.net_ring.capacity : 0.0f;
+    }
+}
 
-    return samples_to_read;
+// Races with the callback only blur the first sample of the new window
+void Radio_resetStats(void) {
+    __atomic_store_n(&radio.stats.rebuffers, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.underruns, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.silence_samples, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.fill_samples, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.fill_sum, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.fill_min, -1, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.net_bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.decode_bytes, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.net_waits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.decode_waits, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.reconnects, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.outage_ms, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.outage_max_ms, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.stats.since_ms, radio_now_ms(), __ATOMIC_RELAXED);
 }
 
 bool Radio_isActive(void) {
     return radio.state != RADIO_STATE_STOPPED && radio.state != RADIO_STATE_ERROR;
 }
 
+bool Radio_canTimeshift(void) {
+    return Radio_isActive() && radio_timeshift_isOpen();
+}
+
+int Radio_startRecording(void) {
+    // Split at song changes, Ogg pages wouldn't make playable files
+    if (!Radio_isActive() || (radio.audio_format != RADIO_FORMAT_MP3 && radio.audio_format != RADIO_FORMAT_AAC)) {
+        return -1;
+    }
+
+    // Name files after the station as it is listed, else as it calls itself
+    const char* station = radio.metadata.station_name;
+    int listed = radio_stations_find(radio.current_url);
+    if (listed >= 0) {
+        RadioStation* stations;
+        radio_stations_get(&stations);
+        station = stations[listed].name;
+    }
+    return radio_record_start(RADIO_RECORD_DIR, station,
+                              radio.audio_format == RADIO_FORMAT_AAC ? "aac" : "mp3",
+                              radio.metadata.artist, radio.metadata.title);
+}
+
+void Radio_setNeighbours(const char* prev_url, const char* next_url) {
+    const char* urls[RADIO_STANDBY_MAX] = {prev_url, next_url};
+    radio.neighbour_count = 0;
+    for (int i = 0; i < RADIO_STANDBY_MAX && !radio_net_dataSaver(); i++) {
+        // Not the playing station, nor twice when there are only two
+        if (!urls[i] || strcmp(urls[i], radio.current_url) == 0) continue;
+        if (radio.neighbour_count > 0 && strcmp(urls[i], radio.neighbour_urls[0]) == 0) continue;
+        snprintf(radio.neighbour_urls[radio.neighbour_count++], RADIO_MAX_URL, "%s", urls[i]);
+    }
+    if (radio.neighbour_count == 0) radio_standby_set(NULL, 0);
+}
+
+void Radio_stopRecording(void) {
+    radio_record_stop();
+}
+
+bool Radio_isRecording(void) {
+    return radio_record_isActive();
+}
+
+void Radio_setPowerSave(bool enabled) {
+    if (__atomic_load_n(&radio.power_save, __ATOMIC_RELAXED) == enabled) return;
+    __atomic_store_n(&radio.power_save, enabled, __ATOMIC_RELAXED);
+    LOG_info("Radio: power save %s\n", enabled ? "on" : "off");
+}
+
+void Radio_pause(void) {
+    if (radio.state == RADIO_STATE_PLAYING || radio.state == RADIO_STATE_BUFFERING) {
+        radio.state = RADIO_STATE_PAUSED;
+        radio.shifted = true;
+    }
+}
+
+void Radio_resume(void) {
+    // The decode stage starts playing once the decoded ring is full again
+    if (radio.state == RADIO_STATE_PAUSED) radio.state = RADIO_STATE_BUFFERING;
+}
+
+// Recording position being heard: the read position less what is decoded or
+// buffered after it
+static uint64_t play_position(void) {
+    uint64_t behind = __atomic_load_n(&radio.stream_buffer_level, __ATOMIC_RELAXED) +
+                      (uint64_t)ring_count() * current_byte_rate() / current_pcm_rate();
+    uint64_t pos = radio_timeshift_readPosition();
+    pos = pos > behind ? pos - behind : 0;
+    uint64_t oldest = radio_timeshift_oldestPosition();
+    return pos > oldest ? pos : oldest;
+}
+
+// Stream time at a recording position, from the time mark before it
+static uint64_t time_at(uint64_t pos) {
+    uint64_t mark_pos = 0;
+    int64_t ms = radio_timeshift_timeAt(pos, &mark_pos);
+    if (ms < 0) return 0;
+    return (uint64_t)ms + (pos - mark_pos) * 1000 / current_byte_rate();
+}
+
+// Ask the decode stage to continue from pos
+static void request_seek(uint64_t pos) {
+    __atomic_store_n(&radio.seek_ms, time_at(pos), __ATOMIC_RELAXED);
+    __atomic_store_n(&radio.seek_pos, (int64_t)pos, __ATOMIC_RELEASE);
+}
+
+void Radio_seekRelative(int seconds) {
+    if (!Radio_canTimeshift() || seconds == 0) return;
+
+    uint64_t pos = play_position();
+    uint64_t target_pos;
+    if (seconds < 0) {
+        int64_t target_ms = (int64_t)time_at(pos) + (int64_t)seconds * 1000;
+        if (target_ms < 0 || radio_timeshift_findTime((uint64_t)target_ms, &target_pos) < 0) {
+            target_pos = radio_timeshift_oldestPosition();
+        }
+        radio.shifted = true;
+    } else {
+        // Ahead of the recording is only undecoded stream, so estimate by byte rate;
+        // within a buffering target of live, rejoin live
+        uint64_t live = radio_timeshift_writePosition();
+        uint64_t margin = (uint64_t)__atomic_load_n(&radio.target_ms, __ATOMIC_RELAXED) *
+                          current_byte_rate() / 1000;
+        target_pos = pos + (uint64_t)seconds * current_byte_rate();
+        if (target_pos + margin >= live) {
+            target_pos = live > margin ? live - margin : 0;
+            if (radio.state != RADIO_STATE_PAUSED) radio.shifted = false;
+        }
+    }
+    request_seek(target_pos);
+}
+
+void Radio_seekSongStart(void) {
+    if (!Radio_canTimeshift()) return;
+
+    uint64_t pos = play_position();
+    int64_t start = radio_timeshift_songStart(pos);
+    // Just into a song: its start is where we are, go to the previous one
+    if (start >= 0 && pos - (uint64_t)start < (uint64_t)current_byte_rate() * 3 && start > 0) {
+        start = radio_timeshift_songStart((uint64_t)start - 1);
+    }
+    request_seek(start >= 0 ? (uint64_t)start : radio_timeshift_oldestPosition());
+    radio.shifted = true;
+}
+
+int Radio_getDelayMs(void) {
+    return radio.shifted ? buffered_ms() : 0;
+}
+
 // Curated stations API - delegates to radio_curated module
 int Radio_getCuratedCountryCount(void) {
     return radio_curated_get_country_count();
@@ -1606,27 +2051,45 @@ int Radio_getCuratedStationCount(const char* country_code) {
     return radio_curated_get_station_count(country_code);
 }
 
-const CuratedStation* Radio_getCuratedStations(const char* country_code, int* count) {
-    return radio_curated_get_stations(country_code, count);
+bool Radio_getCuratedStation(const char* country_code, int index, CuratedStation* out) {
+    return radio_curated_get_station(country_code, index, out);
 }
 
-bool Radio_stationExists(const char* url) {
-    for (int i = 0; i < radio.station_count; i++) {
-        if (strcmp(radio.stations[i].url, url) == 0) {
-            return true;
-        }
+int Radio_openCuratedView(const char* country_code, const char* query) {
+    return radio_curated_open_view(country_code, query);
+}
+
+bool Radio_getCuratedViewRow(int row, CuratedStation* out) {
+    return radio_curated_view_row(row, out);
+}
+
+int Radio_getCuratedViewStation(int row) {
+    return radio_curated_view_station(row);
+}
+
+void Radio_probeCuratedStations(int first, int count) {
+    const char* urls[count > 0 ? count : 1];
+    int n = 0;
+    CuratedStation station;
+    for (int i = 0; i < count; i++) {
+        if (radio_curated_view_row(first + i, &station)) urls[n++] = station.url;
     }
-    return false;
+    radio_probe_request(urls, n);
+}
+
+uint32_t Radio_getProbeGeneration(void) {
+    return radio_probe_generation();
+}
+
+bool Radio_stationExists(const char* url) {
+    return radio_stations_find(url) >= 0;
 }
 
 bool Radio_removeStationByUrl(const char* url) {
-    for (int i = 0; i < radio.station_count; i++) {
-        if (strcmp(radio.stations[i].url, url) == 0) {
-            Radio_removeStation(i);
-            return true;
-        }
-    }
-    return false;
+    int index = radio_stations_find(url);
+    if (index < 0) return false;
+    radio_stations_remove(index);
+    return true;
 }
 
 SDL_Surface* Radio_getAlbumArt(void) {
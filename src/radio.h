@@ -4,17 +4,16 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-#define RADIO_MAX_STATIONS 32
 #define RADIO_MAX_URL 512
 #define RADIO_MAX_NAME 128
 #define RADIO_BUFFER_SIZE (64 * 1024)  // 64KB buffer
 
-// Radio station
+// Radio station (strings are owned by the station list, "" when empty)
 typedef struct {
-    char name[RADIO_MAX_NAME];
-    char url[RADIO_MAX_URL];
-    char genre[64];
-    char slogan[128];
+    const char* name;
+    const char* url;
+    const char* genre;
+    const char* slogan;
 } RadioStation;
 
 // Curated country for station browser
@@ -23,13 +22,13 @@ typedef struct {
     char code[8];
 } CuratedCountry;
 
-// Curated station entry
+// Curated station entry (strings are owned by the curated index, "" when empty)
 typedef struct {
-    char name[RADIO_MAX_NAME];
-    char url[RADIO_MAX_URL];
-    char genre[64];
-    char slogan[128];
-    char country_code[8];
+    const char* name;
+    const char* url;
+    const char* genre;
+    const char* slogan;
+    const char* country_code;
 } CuratedStation;
 
 // Stream metadata (from ICY)
@@ -47,7 +46,8 @@ typedef enum {
     RADIO_STATE_CONNECTING,
     RADIO_STATE_BUFFERING,
     RADIO_STATE_PLAYING,
-    RADIO_STATE_ERROR
+    RADIO_STATE_ERROR,
+    RADIO_STATE_PAUSED      // Time-shift: playback held while the stream keeps recording
 } RadioState;
 
 // Initialize radio module
@@ -56,16 +56,16 @@ int Radio_init(void);
 // Cleanup
 void Radio_quit(void);
 
-// Get list of preset stations
+// Get list of preset stations (valid until the list changes)
 int Radio_getStations(RadioStation** stations);
 
-// Add a custom station
+// Add a custom station; returns its index, -1 if its URL is listed already
 int Radio_addStation(const char* name, const char* url, const char* genre, const char* slogan);
 
 // Remove a station by index
 void Radio_removeStation(int index);
 
-// Save stations to file
+// Changes are saved as they are made; this compacts the file once they pile up
 void Radio_saveStations(void);
 
 // Load stations from file
@@ -80,10 +80,11 @@ void Radio_stop(void);
 // Get current state
 RadioState Radio_getState(void);
 
-// Get current metadata
-const RadioMetadata* Radio_getMetadata(void);
+// Copy the current metadata (consistent, without a lock)
+void Radio_getMetadata(RadioMetadata* metadata);
 
-// Get buffer level (0.0 to 1.0)
+// Get buffer level (0.0 to 1.0): encoded and decoded audio buffered ahead of
+// playback, 1.0 at 15 seconds or more
 float Radio_getBufferLevel(void);
 
 // Get error message if state is RADIO_STATE_ERROR
@@ -92,18 +93,91 @@ const char* Radio_getError(void);
 // Update radio (call in main loop)
 void Radio_update(void);
 
+// Power-saving decode for when the screen is off: HE-AAC streams skip SBR and
+// decode the AAC-LC core at half rate, resampled to the device rate (less
+// treble, about half the decode CPU). Takes effect from the next frame.
+void Radio_setPowerSave(bool enabled);
+
+// Free the stream buffers once the radio has been stopped for a while (call in
+// the main loop, whatever the screen); Radio_play allocates them again
+void Radio_releaseIdle(void);
+
 // Get audio samples for playback (called by audio callback)
 int Radio_getAudioSamples(int16_t* buffer, int max_samples);
 
+// Radio playback telemetry (since Radio_init or the last Radio_resetStats)
+typedef struct {
+    uint32_t rebuffers;         // Times playback dropped back into RADIO_STATE_BUFFERING
+    uint32_t underruns;         // Reads the ring couldn't fill while playing
+    uint64_t silence_samples;   // Samples filled with silence by those underruns
+    float buffer_min;           // Lowest buffer level (see Radio_getBufferLevel) seen while playing
+    float buffer_avg;           // Average buffer level seen while playing
+
+    // Pipeline of direct streams: network stage -> bitstream ring -> decode stage
+    uint64_t net_bytes;         // Audio bytes received (without ICY metadata)
+    uint64_t decode_bytes;      // Bytes the decode stage took from the bitstream ring
+    int net_kbps;               // Average throughput of each stage
+    int decode_kbps;
+    uint32_t net_waits;         // Times the network stage waited for a full bitstream ring
+    uint32_t decode_waits;      // Times the decode stage waited for a full audio ring
+    float bitstream_fill;       // Current jitter (bitstream ring) fill (0.0 to 1.0)
+    int target_ms;              // Current adaptive buffering target
+
+    // Direct streams reopened after they ended, while buffered audio played on
+    uint32_t reconnects;
+    uint32_t outage_ms;         // Total time from a stream ending to reconnecting (or giving up)
+    uint32_t outage_max_ms;     // Longest such outage
+} RadioStats;
+
+void Radio_getStats(RadioStats* stats);
+void Radio_resetStats(void);
+
 // Check if radio is active
 bool Radio_isActive(void);
 
+// Time-shift: the playing station is recorded to the SD card (see radio_timeshift.h),
+// so playback can pause and seek within the recording
+bool Radio_canTimeshift(void);
+
+// Hold playback (the stream keeps recording) / continue where it was held
+void Radio_pause(void);
+void Radio_resume(void);
+
+// Jump by seconds: back within the recording, or forward up to the live stream
+void Radio_seekRelative(int seconds);
+
+// Back to the start of the song playing now, or of the previous song within its first seconds
+void Radio_seekSongStart(void);
+
+// How far playback is behind the live stream after a pause or seek (0 = live)
+int Radio_getDelayMs(void);
+
+// Keep the stations around the playing one connected (see radio_standby.h), so
+// switching to one starts at once; NULL for none. They connect once it plays.
+// None are kept under the data saver (radio_net.h).
+void Radio_setNeighbours(const char* prev_url, const char* next_url);
+
+// Recording: the live stream is saved to Music/Recordings as it arrives, one file
+// per song (see radio_record.h), until stopped or the station changes
+int Radio_startRecording(void);
+void Radio_stopRecording(void);
+bool Radio_isRecording(void);
+
 // Curated stations API
 int Radio_getCuratedCountryCount(void);
 const CuratedCountry* Radio_getCuratedCountries(void);
 int Radio_getCuratedStationCount(const char* country_code);
-const CuratedStation* Radio_getCuratedStations(const char* country_code, int* count);
+bool Radio_getCuratedStation(const char* country_code, int index, CuratedStation* out);
+// Browsing view of a country's stations, filtered by query (see radio_curated.h)
+int Radio_openCuratedView(const char* country_code, const char* query);
+bool Radio_getCuratedViewRow(int row, CuratedStation* out);
+int Radio_getCuratedViewStation(int row);
 bool Radio_stationExists(const char* url);
+
+// Check count rows of the curated view from first in the background: results
+// come from radio_probe_get(), Radio_getProbeGeneration() changes as each one completes
+void Radio_probeCuratedStations(int first, int count);
+uint32_t Radio_getProbeGeneration(void);
 bool Radio_removeStationByUrl(const char* url);
 
 // Album art for current radio track (fetched from iTunes)
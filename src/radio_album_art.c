@@ -1,14 +1,17 @@
 #define _GNU_SOURCE
 #include "radio_album_art.h"
+#include "radio_art_cache.h"
 #include "radio_net.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <unistd.h>
-#include <sys/stat.h>
-#include <dirent.h>
-#include <time.h>
+#include <pthread.h>
 
+#include "thread_role.h"
+#include "netjobs.h"
+#include "trace.h"
+#include "art_scale.h"
+#include "memstats.h"
 #include "defines.h"
 #include "api.h"
 #include "include/parson/parson.h"
@@ -16,139 +19,190 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+// Cover looked up ahead of time
+typedef struct {
+    char artist[256];
+    char title[256];
+} ArtPrefetch;
+
 // Album art module state
+// Lookups run on one worker thread. A request replaces the one still queued, and
+// bumps the generation so the worker drops a lookup in flight at its next step.
+// The worker leaves its result in ready, which the UI thread swaps in. Prefetches
+// run only while no request is queued, and one cut short by a request is retried.
+// Offline, a lookup the disk cache can't answer waits: the request and the
+// prefetches are taken up again once netjobs sees the network back.
 typedef struct {
-    SDL_Surface* album_art;
-    char last_art_artist[256];
+    SDL_Surface* album_art;         // Shown (UI thread)
+    SDL_Surface* ready;             // Finished lookup not picked up yet (NULL: none found)
+    bool ready_set;
+    char last_art_artist[256];      // Last requested track
     char last_art_title[256];
-    bool art_fetch_in_progress;
+    bool pending;                   // last_art_* queued for the worker
+    bool art_fetch_in_progress;     // Queued or being looked up
+    bool deferred;                  // last_art_* waits for the network
+    bool offline;                   // A lookup found the network down: prefetches wait
+    ArtPrefetch prefetch[RADIO_ALBUM_ART_PREFETCH_MAX];   // Oldest first
+    int prefetch_count;
+    uint32_t generation;            // Bumped by every request and clear (atomic)
+    bool stop;                      // Atomic
+    bool suspended;                 // Screen off: queued work waits
+    bool worker_running;
+    pthread_t worker;
 } AlbumArtContext;
 
 static AlbumArtContext art_ctx = {0};
+static pthread_mutex_t art_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t art_cond = PTHREAD_COND_INITIALIZER;
 
-// Simple hash function for cache filename
-static unsigned int simple_hash(const char* str) {
-    unsigned int hash = 5381;
-    int c;
-    while ((c = *str++)) {
-        hash = ((hash << 5) + hash) + c;
-    }
-    return hash;
+#define ART_CACHE_MAX_ENTRIES 32
+#define ART_JSON_MAX (256 * 1024)       // iTunes search response
+#define ART_IMAGE_MAX (4 * 1024 * 1024)
+
+// Display size covers are decoded to (0 = full size)
+static int art_display_size = 0;
+
+void radio_album_art_set_display_size(int size) {
+    art_display_size = size;
 }
 
-// Get album art cache directory path
-static void get_cache_dir(char* path, int path_size) {
-    const char* home = getenv("HOME");
-    if (home) {
-        snprintf(path, path_size, "%s/.cache/albumart", home);
+// Shrink a decoded cover so its shorter side matches the display size, in
+// RGBA8888 either way: the layout every later scale and composite of it expects
+// (the background, thumbnails), so none of them converts it again
+static SDL_Surface* fit_to_display(SDL_Surface* art) {
+    int target = art_display_size;
+    int short_side = art->w < art->h ? art->w : art->h;
+    SDL_Surface* fitted;
+    if (target <= 0 || short_side <= target) {
+        if (art->format->format == SDL_PIXELFORMAT_RGBA8888) return art;
+        fitted = SDL_ConvertSurfaceFormat(art, SDL_PIXELFORMAT_RGBA8888, 0);
     } else {
-        snprintf(path, path_size, "/tmp/albumart_cache");
+        int w = (int)((int64_t)art->w * target / short_side);
+        int h = (int)((int64_t)art->h * target / short_side);
+        fitted = ArtScale_scale(art, NULL, w, h);
     }
+    if (!fitted) return art;
+    SDL_FreeSurface(art);
+    return fitted;
 }
 
-// Ensure cache directory exists
-static void ensure_cache_dir(void) {
-    char cache_dir[512];
-    get_cache_dir(cache_dir, sizeof(cache_dir));
-
-    // Create parent .cache directory
-    char parent_dir[512];
-    const char* home = getenv("HOME");
-    if (home) {
-        snprintf(parent_dir, sizeof(parent_dir), "%s/.cache", home);
-        mkdir(parent_dir, 0755);
-    }
-
-    // Create albumart cache directory
-    mkdir(cache_dir, 0755);
+SDL_Surface* radio_album_art_decode(const void* data, size_t size) {
+    TRACE_SCOPE("art_decode");
+    SDL_RWops* rw = SDL_RWFromConstMem(data, (int)size);
+    if (!rw) return NULL;
+    SDL_Surface* art = IMG_Load_RW(rw, 1);  // 1 = auto-close RWops
+    if (!art) return NULL;
+    return fit_to_display(art);
 }
 
-// Clean up old cache files (older than 7 days)
-static void cleanup_old_cache(void) {
-    char cache_dir[512];
-    get_cache_dir(cache_dir, sizeof(cache_dir));
-
-    DIR* dir = opendir(cache_dir);
-    if (!dir) return;
-
-    time_t now = time(NULL);
-    time_t max_age = 7 * 24 * 60 * 60;  // 7 days in seconds
-
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != NULL) {
-        if (ent->d_name[0] == '.') continue;
-
-        char filepath[768];
-        snprintf(filepath, sizeof(filepath), "%s/%s", cache_dir, ent->d_name);
+// Decoded covers, least recently used evicted first
+typedef struct {
+    uint64_t key;
+    SDL_Surface* art;
+    size_t bytes;
+    uint64_t used;              // Access order (0 = free slot)
+} ArtCacheEntry;
+
+static ArtCacheEntry art_cache[ART_CACHE_MAX_ENTRIES];
+static size_t art_cache_bytes = 0;
+static uint64_t art_cache_clock = 0;
+static pthread_mutex_t art_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+uint64_t radio_album_art_key(char kind, const char* a, const char* b) {
+    // FNV-1a over kind, a, NUL, b
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ (uint8_t)kind) * 1099511628211ULL;
+    for (const char* p = a ? a : ""; *p; p++) hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+    hash *= 1099511628211ULL;
+    for (const char* p = b ? b : ""; *p; p++) hash = (hash ^ (uint8_t)*p) * 1099511628211ULL;
+    return hash;
+}
 
-        struct stat st;
-        if (stat(filepath, &st) == 0) {
-            if (now - st.st_mtime > max_age) {
-                unlink(filepath);
-            }
-        }
+SDL_Surface* radio_album_art_cacheGet(uint64_t key) {
+    SDL_Surface* copy = NULL;
+    pthread_mutex_lock(&art_cache_mutex);
+    for (int i = 0; i < ART_CACHE_MAX_ENTRIES; i++) {
+        ArtCacheEntry* e = &art_cache[i];
+        if (e->used == 0 || e->key != key) continue;
+        copy = SDL_DuplicateSurface(e->art);
+        if (copy) e->used = ++art_cache_clock;
+        break;
     }
-    closedir(dir);
+    pthread_mutex_unlock(&art_cache_mutex);
+    return copy;
 }
 
-// Get cache file path for artist+title
-static void get_cache_filepath(const char* artist, const char* title, char* path, int path_size) {
-    char cache_dir[512];
-    get_cache_dir(cache_dir, sizeof(cache_dir));
-
-    // Create hash from artist+title
-    char combined[512];
-    snprintf(combined, sizeof(combined), "%s_%s", artist ? artist : "", title ? title : "");
-    unsigned int hash = simple_hash(combined);
-
-    snprintf(path, path_size, "%s/%08x.jpg", cache_dir, hash);
+bool radio_album_art_cacheHas(uint64_t key) {
+    bool found = false;
+    pthread_mutex_lock(&art_cache_mutex);
+    for (int i = 0; i < ART_CACHE_MAX_ENTRIES && !found; i++) {
+        found = art_cache[i].used && art_cache[i].key == key;
+    }
+    pthread_mutex_unlock(&art_cache_mutex);
+    return found;
 }
 
-// Load album art from cache file
-static SDL_Surface* load_cached_album_art(const char* cache_path) {
-    FILE* f = fopen(cache_path, "rb");
-    if (!f) return NULL;
+// Free an entry (cache mutex held)
+static void art_cache_drop(ArtCacheEntry* e) {
+    MEM_SURFACE_SUB(MEM_TAG_ART_CACHE, e->art);
+    SDL_FreeSurface(e->art);
+    art_cache_bytes -= e->bytes;
+    memset(e, 0, sizeof(ArtCacheEntry));
+}
 
-    // Get file size
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
+void radio_album_art_cachePut(uint64_t key, SDL_Surface* art) {
+    size_t bytes = (size_t)art->pitch * art->h;
+    if (bytes > RADIO_ALBUM_ART_CACHE_BYTES) return;
+    SDL_Surface* copy = SDL_DuplicateSurface(art);
+    if (!copy) return;
 
-    if (size <= 0 || size > 2 * 1024 * 1024) {  // Max 2MB
-        fclose(f);
-        return NULL;
+    pthread_mutex_lock(&art_cache_mutex);
+    for (int i = 0; i < ART_CACHE_MAX_ENTRIES; i++) {
+        if (art_cache[i].used && art_cache[i].key == key) art_cache_drop(&art_cache[i]);
     }
-
-    uint8_t* data = (uint8_t*)malloc(size);
-    if (!data) {
-        fclose(f);
-        return NULL;
+    // Evict until the cover fits the budget and a slot is free
+    ArtCacheEntry* slot = NULL;
+    for (;;) {
+        ArtCacheEntry* oldest = NULL;
+        slot = NULL;
+        for (int i = 0; i < ART_CACHE_MAX_ENTRIES; i++) {
+            ArtCacheEntry* e = &art_cache[i];
+            if (e->used == 0) {
+                if (!slot) slot = e;
+            } else if (!oldest || e->used < oldest->used) {
+                oldest = e;
+            }
+        }
+        if (slot && art_cache_bytes + bytes <= RADIO_ALBUM_ART_CACHE_BYTES) break;
+        if (!oldest) break;
+        art_cache_drop(oldest);
     }
-
-    if (fread(data, 1, size, f) != (size_t)size) {
-        free(data);
-        fclose(f);
-        return NULL;
+    if (slot) {
+        MEM_SURFACE_ADD(MEM_TAG_ART_CACHE, copy);
+        slot->key = key;
+        slot->art = copy;
+        slot->bytes = bytes;
+        slot->used = ++art_cache_clock;
+        art_cache_bytes += bytes;
+        copy = NULL;
     }
-    fclose(f);
+    pthread_mutex_unlock(&art_cache_mutex);
+    if (copy) SDL_FreeSurface(copy);
+}
 
-    SDL_RWops* rw = SDL_RWFromConstMem(data, size);
-    SDL_Surface* art = NULL;
-    if (rw) {
-        art = IMG_Load_RW(rw, 1);
+// Free all cached covers, returning the bytes they held
+static size_t art_cache_clear(void) {
+    pthread_mutex_lock(&art_cache_mutex);
+    size_t bytes = art_cache_bytes;
+    for (int i = 0; i < ART_CACHE_MAX_ENTRIES; i++) {
+        if (art_cache[i].used) art_cache_drop(&art_cache[i]);
     }
-    free(data);
-
-    return art;
+    pthread_mutex_unlock(&art_cache_mutex);
+    return bytes;
 }
 
-// Save album art to cache file
-static void save_album_art_to_cache(const char* cache_path, const uint8_t* data, int size) {
-    FILE* f = fopen(cache_path, "wb");
-    if (!f) return;
-
-    fwrite(data, 1, size, f);
-    fclose(f);
+size_t radio_album_art_cacheShed(void) {
+    return art_cache_clear();
 }
 
 // URL encode a string for use in query parameters
@@ -171,77 +225,49 @@ static void url_encode(const char* src, char* dst, int dst_size) {
     dst[j] = '\0';
 }
 
-void radio_album_art_init(void) {
-    memset(&art_ctx, 0, sizeof(AlbumArtContext));
-}
-
-void radio_album_art_cleanup(void) {
-    if (art_ctx.album_art) {
-        SDL_FreeSurface(art_ctx.album_art);
-        art_ctx.album_art = NULL;
-    }
-    art_ctx.last_art_artist[0] = '\0';
-    art_ctx.last_art_title[0] = '\0';
-    art_ctx.art_fetch_in_progress = false;
-}
-
-void radio_album_art_clear(void) {
-    if (art_ctx.album_art) {
-        SDL_FreeSurface(art_ctx.album_art);
-        art_ctx.album_art = NULL;
-    }
-    art_ctx.last_art_artist[0] = '\0';
-    art_ctx.last_art_title[0] = '\0';
+// True once the lookup of generation is no longer wanted (worker thread)
+static bool superseded(uint32_t generation) {
+    return __atomic_load_n(&art_ctx.generation, __ATOMIC_ACQUIRE) != generation ||
+           __atomic_load_n(&art_ctx.stop, __ATOMIC_ACQUIRE);
 }
 
-SDL_Surface* radio_album_art_get(void) {
-    return art_ctx.album_art;
+// Body of a fetch, collected while its lookup is still wanted
+typedef struct {
+    RadioNetBody* body;
+    int max_size;
+    uint32_t generation;
+} ArtDownload;
+
+static bool on_download_data(void* ctx, const uint8_t* data, int len) {
+    ArtDownload* dl = ctx;
+    if (superseded(dl->generation)) return false;
+    return radio_net_bodyAppend(dl->body, data, len, dl->max_size);
 }
 
-bool radio_album_art_is_fetching(void) {
-    return art_ctx.art_fetch_in_progress;
+// Fetch url into body (up to max_size bytes), aborting once superseded
+// Returns bytes read, or -1 on error or when superseded.
+static int fetch_cancellable(const char* url, RadioNetBody* body, int max_size, uint32_t generation) {
+    ArtDownload dl = {body, max_size, generation};
+    if (radio_net_fetchStream(url, on_download_data, &dl) < 0 || !body->data) return -1;
+    return body->len;
 }
 
-// Fetch album art from iTunes Search API (with disk caching)
-void radio_album_art_fetch(const char* artist, const char* title) {
-    if (!artist || !title || (artist[0] == '\0' && title[0] == '\0')) {
-        return;
-    }
-
-    // Check if we already fetched art for this track
-    if (strcmp(art_ctx.last_art_artist, artist) == 0 &&
-        strcmp(art_ctx.last_art_title, title) == 0) {
-        return;  // Already fetched
-    }
-
-    // Mark as fetching and save current track
-    art_ctx.art_fetch_in_progress = true;
-    strncpy(art_ctx.last_art_artist, artist, sizeof(art_ctx.last_art_artist) - 1);
-    strncpy(art_ctx.last_art_title, title, sizeof(art_ctx.last_art_title) - 1);
-
-    // Ensure cache directory exists
-    ensure_cache_dir();
-
-    // Periodically clean up old cache (check ~once per hour based on static counter)
-    static int cleanup_counter = 0;
-    if (++cleanup_counter >= 60) {
-        cleanup_counter = 0;
-        cleanup_old_cache();
-    }
-
+// Disk cache, else iTunes
+// deferred: set when only the network could answer and it is down
+static SDL_Surface* fetch_album_art(const char* artist, const char* title, uint32_t generation, bool* deferred) {
     // Check disk cache first
-    char cache_path[768];
-    get_cache_filepath(artist, title, cache_path, sizeof(cache_path));
-
-    SDL_Surface* cached_art = load_cached_album_art(cache_path);
-    if (cached_art) {
-        // Free previous art
-        if (art_ctx.album_art) {
-            SDL_FreeSurface(art_ctx.album_art);
-        }
-        art_ctx.album_art = cached_art;
-        art_ctx.art_fetch_in_progress = false;
-        return;
+    uint8_t* cached = NULL;
+    int cached_size = 0;
+    RadioArtCacheResult cache_result = radio_art_cache_lookup(artist, title, &cached, &cached_size);
+    if (cache_result == RADIO_ART_CACHE_NONE) return NULL;
+    if (cache_result == RADIO_ART_CACHE_HIT) {
+        SDL_Surface* cached_art = radio_album_art_decode(cached, cached_size);
+        free(cached);
+        if (cached_art) return cached_art;
+    }
+    if (!radio_net_online()) {
+        *deferred = true;
+        return NULL;
     }
 
     // Build search query using iTunes API
@@ -266,61 +292,32 @@ void radio_album_art_fetch(const char* artist, const char* title) {
     }
 
     // Fetch iTunes API response
-    uint8_t* response_buf = (uint8_t*)malloc(32 * 1024);  // 32KB for JSON
-    if (!response_buf) {
-        art_ctx.art_fetch_in_progress = false;
-        return;
-    }
-
-    int bytes = radio_net_fetch(search_url, response_buf, 32 * 1024, NULL, 0);
+    RadioNetBody response = {0};
+    int bytes = fetch_cancellable(search_url, &response, ART_JSON_MAX, generation);
     if (bytes <= 0) {
-        LOG_error("Failed to fetch iTunes search results\n");
-        free(response_buf);
-        art_ctx.art_fetch_in_progress = false;
-        return;
+        if (!superseded(generation)) LOG_error("Failed to fetch iTunes search results\n");
+        radio_net_freeBody(&response);
+        return NULL;
     }
 
-    response_buf[bytes] = '\0';
-
     // Parse JSON response
-    JSON_Value* root = json_parse_string((const char*)response_buf);
-    free(response_buf);
+    JSON_Value* root = json_parse_string((const char*)response.data);
+    radio_net_freeBody(&response);
 
     if (!root) {
         LOG_error("Failed to parse iTunes JSON response\n");
-        art_ctx.art_fetch_in_progress = false;
-        return;
+        return NULL;
     }
 
+    // Artwork URL of the first result (100x100 by default, we'll request 300x300)
     JSON_Object* obj = json_value_get_object(root);
-    if (!obj) {
-        json_value_free(root);
-        art_ctx.art_fetch_in_progress = false;
-        return;
-    }
-
-    // Get results array
-    JSON_Array* results = json_object_get_array(obj, "results");
-    if (!results || json_array_get_count(results) == 0) {
-        json_value_free(root);
-        art_ctx.art_fetch_in_progress = false;
-        return;
-    }
-
-    // Get first result
-    JSON_Object* track = json_array_get_object(results, 0);
-    if (!track) {
-        json_value_free(root);
-        art_ctx.art_fetch_in_progress = false;
-        return;
-    }
-
-    // Get artwork URL (100x100 by default, we'll request 300x300)
-    const char* artwork_url = json_object_get_string(track, "artworkUrl100");
+    JSON_Array* results = obj ? json_object_get_array(obj, "results") : NULL;
+    JSON_Object* track = results && json_array_get_count(results) > 0 ? json_array_get_object(results, 0) : NULL;
+    const char* artwork_url = track ? json_object_get_string(track, "artworkUrl100") : NULL;
     if (!artwork_url) {
         json_value_free(root);
-        art_ctx.art_fetch_in_progress = false;
-        return;
+        if (obj && results && !superseded(generation)) radio_art_cache_storeNone(artist, title);
+        return NULL;
     }
 
     // Modify URL to get larger image and convert HTTPS to HTTP for better compatibility
@@ -351,39 +348,306 @@ void radio_album_art_fetch(const char* artist, const char* title) {
 
     json_value_free(root);
 
-    // Download the image - use larger buffer for high-res images
-    uint8_t* image_buf = (uint8_t*)malloc(1024 * 1024);  // 1MB for image
-    if (!image_buf) {
-        art_ctx.art_fetch_in_progress = false;
+    // Download the image
+    RadioNetBody image = {0};
+    int image_bytes = fetch_cancellable(large_artwork_url, &image, ART_IMAGE_MAX, generation);
+    if (image_bytes <= 0) {
+        if (!superseded(generation)) LOG_error("Failed to download album art image (bytes=%d)\n", image_bytes);
+        radio_net_freeBody(&image);
+        return NULL;
+    }
+
+    // Load image into SDL_Surface (at display size)
+    SDL_Surface* art = radio_album_art_decode(image.data, image_bytes);
+    if (art) {
+        // Save to disk cache for future use
+        radio_art_cache_store(artist, title, image.data, image_bytes);
+    } else {
+        LOG_error("Failed to load album art image: %s\n", IMG_GetError());
+    }
+
+    radio_net_freeBody(&image);
+    return art;
+}
+
+// Look up artist/title in the disk cache, else with the iTunes Search API (worker thread)
+// Returns the cover at display size, or NULL if none was found or it was superseded.
+static SDL_Surface* lookup_album_art(const char* artist, const char* title, uint32_t generation, bool* deferred) {
+    SDL_Surface* art = fetch_album_art(artist, title, generation, deferred);
+    if (art) radio_album_art_cachePut(radio_album_art_key('S', artist, title), art);
+    return art;
+}
+
+// Index of artist/title in the prefetch list, or -1 (mutex held)
+static int prefetch_index(const char* artist, const char* title) {
+    for (int i = 0; i < art_ctx.prefetch_count; i++) {
+        if (strcmp(art_ctx.prefetch[i].artist, artist) == 0 && strcmp(art_ctx.prefetch[i].title, title) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Take an entry off the prefetch list (mutex held)
+static void prefetch_remove(int index) {
+    memmove(&art_ctx.prefetch[index], &art_ctx.prefetch[index + 1],
+            (size_t)(art_ctx.prefetch_count - index - 1) * sizeof(ArtPrefetch));
+    art_ctx.prefetch_count--;
+}
+
+// The network is back (main thread, from NetJobs_poll): take up what waited
+static void art_online(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&art_mutex);
+    art_ctx.offline = false;
+    if (art_ctx.deferred) {
+        art_ctx.deferred = false;
+        art_ctx.pending = true;
+        art_ctx.art_fetch_in_progress = true;
+    }
+    pthread_cond_signal(&art_cond);
+    pthread_mutex_unlock(&art_mutex);
+}
+
+// A lookup needed the network and it is down (mutex held)
+static void art_offline(void) {
+    if (art_ctx.offline) return;
+    art_ctx.offline = true;
+    NetJobs_defer("album-art", art_online, NULL);
+}
+
+// Look up the oldest prefetch into the in-memory cache (mutex held, released meanwhile)
+static void run_prefetch(void) {
+    ArtPrefetch want = art_ctx.prefetch[0];
+    uint32_t generation = art_ctx.generation;
+    pthread_mutex_unlock(&art_mutex);
+
+    bool deferred = false;
+    if (!radio_album_art_cacheHas(radio_album_art_key('S', want.artist, want.title))) {
+        SDL_Surface* art = lookup_album_art(want.artist, want.title, generation, &deferred);
+        if (art) SDL_FreeSurface(art);
+    }
+
+    // Kept for another try if a request cut it short or the network is down
+    pthread_mutex_lock(&art_mutex);
+    if (deferred) {
+        art_offline();
+    } else if (art_ctx.generation == generation) {
+        int index = prefetch_index(want.artist, want.title);
+        if (index >= 0) prefetch_remove(index);
+    }
+}
+
+// Free the shown or the finished art
+static void drop_art(SDL_Surface* art) {
+    if (!art) return;
+    MEM_SURFACE_SUB(MEM_TAG_ALBUM_ART, art);
+    SDL_FreeSurface(art);
+}
+
+// Hand art (NULL: none found) over to radio_album_art_get (mutex held)
+static void set_ready(SDL_Surface* art) {
+    drop_art(art_ctx.ready);
+    MEM_SURFACE_ADD(MEM_TAG_ALBUM_ART, art);
+    art_ctx.ready = art;
+    art_ctx.ready_set = true;
+}
+
+static void* art_worker_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+    radio_net_setAccount(RADIO_NET_ACCOUNT_ART);
+
+    pthread_mutex_lock(&art_mutex);
+    while (!__atomic_load_n(&art_ctx.stop, __ATOMIC_ACQUIRE)) {
+        if (art_ctx.suspended) {
+            // A lookup already under way was finished; the queue waits for the screen
+            pthread_cond_wait(&art_cond, &art_mutex);
+            continue;
+        }
+        if (!art_ctx.pending && art_ctx.prefetch_count > 0 && !art_ctx.offline) {
+            run_prefetch();
+            continue;
+        }
+        if (!art_ctx.pending) {
+            // Idle: write back what the lookups changed in the disk cache index
+            pthread_mutex_unlock(&art_mutex);
+            radio_art_cache_flush();
+            pthread_mutex_lock(&art_mutex);
+            if (!art_ctx.pending && (art_ctx.prefetch_count == 0 || art_ctx.offline) &&
+                !__atomic_load_n(&art_ctx.stop, __ATOMIC_ACQUIRE)) {
+                pthread_cond_wait(&art_cond, &art_mutex);
+            }
+            continue;
+        }
+        char artist[256], title[256];
+        snprintf(artist, sizeof(artist), "%s", art_ctx.last_art_artist);
+        snprintf(title, sizeof(title), "%s", art_ctx.last_art_title);
+        uint32_t generation = art_ctx.generation;
+        art_ctx.pending = false;
+        pthread_mutex_unlock(&art_mutex);
+
+        bool deferred = false;
+        SDL_Surface* art = lookup_album_art(artist, title, generation, &deferred);
+
+        // Only the latest request's result is handed over
+        pthread_mutex_lock(&art_mutex);
+        if (deferred) {
+            if (art_ctx.generation == generation) {
+                art_ctx.deferred = true;
+                art_ctx.art_fetch_in_progress = false;
+            }
+            art_offline();
+        } else if (art_ctx.generation == generation) {
+            set_ready(art);
+            art_ctx.art_fetch_in_progress = false;
+        } else if (art) {
+            SDL_FreeSurface(art);
+        }
+    }
+    pthread_mutex_unlock(&art_mutex);
+    radio_art_cache_flush();
+    return NULL;
+}
+
+void radio_album_art_init(void) {
+    if (art_ctx.worker_running) return;
+    memset(&art_ctx, 0, sizeof(AlbumArtContext));
+    if (pthread_create(&art_ctx.worker, NULL, art_worker_func, NULL) == 0) {
+        art_ctx.worker_running = true;
+    } else {
+        LOG_error("Album art: worker thread creation failed\n");
+    }
+}
+
+// Drop the shown and the finished art (mutex held)
+static void free_art(void) {
+    drop_art(art_ctx.album_art);
+    drop_art(art_ctx.ready);
+    art_ctx.album_art = NULL;
+    art_ctx.ready = NULL;
+    art_ctx.ready_set = false;
+}
+
+void radio_album_art_cleanup(void) {
+    // A lookup in flight is abandoned at its next step (a connect finishes first)
+    pthread_mutex_lock(&art_mutex);
+    __atomic_store_n(&art_ctx.stop, true, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&art_ctx.generation, 1, __ATOMIC_ACQ_REL);
+    pthread_cond_broadcast(&art_cond);
+    pthread_mutex_unlock(&art_mutex);
+    if (art_ctx.worker_running) {
+        pthread_join(art_ctx.worker, NULL);
+        art_ctx.worker_running = false;
+    }
+
+    free_art();
+    art_cache_clear();
+    art_ctx.last_art_artist[0] = '\0';
+    art_ctx.last_art_title[0] = '\0';
+    art_ctx.pending = false;
+    art_ctx.art_fetch_in_progress = false;
+    art_ctx.prefetch_count = 0;
+}
+
+void radio_album_art_clear(void) {
+    pthread_mutex_lock(&art_mutex);
+    __atomic_add_fetch(&art_ctx.generation, 1, __ATOMIC_ACQ_REL);
+    free_art();
+    art_ctx.last_art_artist[0] = '\0';
+    art_ctx.last_art_title[0] = '\0';
+    art_ctx.pending = false;
+    art_ctx.deferred = false;
+    art_ctx.art_fetch_in_progress = false;
+    pthread_mutex_unlock(&art_mutex);
+}
+
+void radio_album_art_setSuspended(bool suspended) {
+    if (art_ctx.suspended == suspended) return;
+    pthread_mutex_lock(&art_mutex);
+    art_ctx.suspended = suspended;
+    if (!suspended) pthread_cond_signal(&art_cond);
+    pthread_mutex_unlock(&art_mutex);
+}
+
+SDL_Surface* radio_album_art_get(void) {
+    pthread_mutex_lock(&art_mutex);
+    if (art_ctx.ready_set) {
+        drop_art(art_ctx.album_art);
+        art_ctx.album_art = art_ctx.ready;
+        art_ctx.ready = NULL;
+        art_ctx.ready_set = false;
+    }
+    SDL_Surface* art = art_ctx.album_art;
+    pthread_mutex_unlock(&art_mutex);
+    return art;
+}
+
+bool radio_album_art_is_fetching(void) {
+    pthread_mutex_lock(&art_mutex);
+    bool fetching = art_ctx.art_fetch_in_progress;
+    pthread_mutex_unlock(&art_mutex);
+    return fetching;
+}
+
+// Queue a lookup for artist/title, superseding the previous track's
+void radio_album_art_fetch(const char* artist, const char* title) {
+    if (!artist || !title || (artist[0] == '\0' && title[0] == '\0')) {
         return;
     }
 
-    int image_bytes = radio_net_fetch(large_artwork_url, image_buf, 1024 * 1024, NULL, 0);
-    if (image_bytes <= 0) {
-        LOG_error("Failed to download album art image (bytes=%d)\n", image_bytes);
-        free(image_buf);
+    pthread_mutex_lock(&art_mutex);
+    // Check if we already fetched art for this track, or the worker is gone
+    if (!art_ctx.worker_running || __atomic_load_n(&art_ctx.stop, __ATOMIC_ACQUIRE) ||
+        (strcmp(art_ctx.last_art_artist, artist) == 0 && strcmp(art_ctx.last_art_title, title) == 0)) {
+        pthread_mutex_unlock(&art_mutex);
+        return;
+    }
+
+    snprintf(art_ctx.last_art_artist, sizeof(art_ctx.last_art_artist), "%s", artist);
+    snprintf(art_ctx.last_art_title, sizeof(art_ctx.last_art_title), "%s", title);
+    __atomic_add_fetch(&art_ctx.generation, 1, __ATOMIC_ACQ_REL);
+    art_ctx.deferred = false;
+
+    // Looked up now, not ahead anymore
+    int index = prefetch_index(art_ctx.last_art_artist, art_ctx.last_art_title);
+    if (index >= 0) prefetch_remove(index);
+
+    // A song heard recently is still decoded: hand it over without the worker
+    SDL_Surface* cached = radio_album_art_cacheGet(radio_album_art_key('S', artist, title));
+    if (cached) {
+        set_ready(cached);
+        art_ctx.pending = false;
         art_ctx.art_fetch_in_progress = false;
+    } else {
+        art_ctx.pending = true;
+        art_ctx.art_fetch_in_progress = true;
+        pthread_cond_signal(&art_cond);
+    }
+    pthread_mutex_unlock(&art_mutex);
+}
+
+// Queue a lookup ahead of time, dropping the oldest one when the list is full
+void radio_album_art_prefetch(const char* artist, const char* title) {
+    if (!artist || !title || (artist[0] == '\0' && title[0] == '\0') || radio_net_dataSaver()) {
         return;
     }
 
-    // Load image into SDL_Surface
-    SDL_RWops* rw = SDL_RWFromConstMem(image_buf, image_bytes);
-    if (rw) {
-        SDL_Surface* art = IMG_Load_RW(rw, 1);  // 1 = auto-close RWops
-        if (art) {
-            // Free previous art
-            if (art_ctx.album_art) {
-                SDL_FreeSurface(art_ctx.album_art);
-            }
-            art_ctx.album_art = art;
+    ArtPrefetch want;
+    snprintf(want.artist, sizeof(want.artist), "%s", artist);
+    snprintf(want.title, sizeof(want.title), "%s", title);
+    if (radio_album_art_cacheHas(radio_album_art_key('S', want.artist, want.title))) return;
 
-            // Save to disk cache for future use
-            save_album_art_to_cache(cache_path, image_buf, image_bytes);
-        } else {
-            LOG_error("Failed to load album art image: %s\n", IMG_GetError());
-        }
+    pthread_mutex_lock(&art_mutex);
+    if (!art_ctx.worker_running || __atomic_load_n(&art_ctx.stop, __ATOMIC_ACQUIRE) ||
+        prefetch_index(want.artist, want.title) >= 0 ||
+        (strcmp(art_ctx.last_art_artist, want.artist) == 0 && strcmp(art_ctx.last_art_title, want.title) == 0)) {
+        pthread_mutex_unlock(&art_mutex);
+        return;
     }
 
-    free(image_buf);
-    art_ctx.art_fetch_in_progress = false;
+    if (art_ctx.prefetch_count == RADIO_ALBUM_ART_PREFETCH_MAX) prefetch_remove(0);
+    art_ctx.prefetch[art_ctx.prefetch_count++] = want;
+    pthread_cond_signal(&art_cond);
+    pthread_mutex_unlock(&art_mutex);
 }
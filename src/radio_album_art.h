@@ -2,6 +2,8 @@
 #define __RADIO_ALBUM_ART_H__
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 // Forward declaration for SDL_Surface
 struct SDL_Surface;
@@ -12,17 +14,58 @@ void radio_album_art_init(void);
 // Cleanup album art module
 void radio_album_art_cleanup(void);
 
-// Fetch album art for artist/title (async, non-blocking)
-// Call this when metadata changes
+// Fetch album art for artist/title (async, non-blocking, from any thread)
+// Call this when metadata changes. Queued on a background worker: a newer track
+// replaces a request still queued and abandons one being looked up.
 void radio_album_art_fetch(const char* artist, const char* title);
 
-// Get current album art surface (NULL if none or still fetching)
+// Look up the cover of an upcoming track ahead of time (from any thread). Runs on
+// the worker while no fetch is queued and only fills the in-memory cache, so a later
+// fetch of the track hands its cover over at once. The newest
+// RADIO_ALBUM_ART_PREFETCH_MAX are kept. Not done under the data saver.
+#define RADIO_ALBUM_ART_PREFETCH_MAX 4
+void radio_album_art_prefetch(const char* artist, const char* title);
+
+// Get current album art surface (NULL if none), taking over the worker's latest
+// result. UI thread; the surface stays valid until the next get or clear.
 struct SDL_Surface* radio_album_art_get(void);
 
-// Check if a fetch is in progress
+// Check if a fetch is queued or in progress
 bool radio_album_art_is_fetching(void);
 
-// Clear current album art and reset state
+// Clear current album art and cancel pending fetches (UI thread)
 void radio_album_art_clear(void);
 
+// Hold lookups, downloads and decodes while nothing can show them (screen off).
+// Requests made meanwhile are kept and run once resumed. UI thread.
+void radio_album_art_setSuspended(bool suspended);
+
+// Size album art is displayed at (screen height); covers are shrunk to this on decode
+// so the shorter side matches it. 0 (default) keeps covers at full size.
+void radio_album_art_set_display_size(int size);
+
+// Decode an encoded cover image (JPEG/PNG) at display size (safe from any thread)
+struct SDL_Surface* radio_album_art_decode(const void* data, size_t size);
+
+// Decoded covers kept in memory, so tracks of one album and songs heard again skip
+// the read and decode (up to RADIO_ALBUM_ART_CACHE_BYTES, least recently used
+// evicted first). Safe from any thread.
+#define RADIO_ALBUM_ART_CACHE_BYTES (16 * 1024 * 1024)
+
+// Cache key of a cover: kind 'S' (song: artist, title), 'D' (folder image: path,
+// size and mtime), 'Y' (YouTube thumbnail: video ID). Embedded covers are keyed by their bytes (kind 'E', player.c).
+uint64_t radio_album_art_key(char kind, const char* a, const char* b);
+
+// Copy of the cached cover of key (the caller frees it), or NULL
+struct SDL_Surface* radio_album_art_cacheGet(uint64_t key);
+
+// True if the cover of key is cached
+bool radio_album_art_cacheHas(uint64_t key);
+
+// Cache a copy of art under key
+void radio_album_art_cachePut(uint64_t key, struct SDL_Surface* art);
+
+// Free every cached cover (memory is short); returns the bytes freed
+size_t radio_album_art_cacheShed(void);
+
 #endif
@@ -0,0 +1,288 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "radio_art_cache.h"
+#include "defines.h"
+#include "api.h"
+
+#define ART_INDEX_MAGIC 0x31545241      // "ART1"
+#define ART_INDEX_VERSION 1
+#define ART_INDEX_NAME "index.bin"
+#define ART_INDEX_MAX 4096
+#define ART_FILE_MAX (2 * 1024 * 1024)
+
+#define ART_ENTRY_NONE 1                // No art found (no file)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} ArtIndexHeader;
+
+typedef struct {
+    uint64_t key;
+    uint32_t size;              // Bytes of the cover file
+    uint32_t last_access;       // Unix time
+    uint32_t flags;
+    uint32_t reserved;
+} ArtIndexEntry;
+
+static ArtIndexEntry index_entries[ART_INDEX_MAX];
+static int index_count = 0;
+static uint64_t index_bytes = 0;        // Cover files in the index
+static bool index_loaded = false;
+static bool index_dirty = false;
+
+// Get album art cache directory path
+static void get_cache_dir(char* path, int path_size) {
+    const char* home = getenv("HOME");
+    if (home) {
+        snprintf(path, path_size, "%s/.cache/albumart", home);
+    } else {
+        snprintf(path, path_size, "/tmp/albumart_cache");
+    }
+}
+
+// Ensure cache directory exists
+static void ensure_cache_dir(void) {
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+
+    // Create parent .cache directory
+    char parent_dir[512];
+    const char* home = getenv("HOME");
+    if (home) {
+        snprintf(parent_dir, sizeof(parent_dir), "%s/.cache", home);
+        mkdir(parent_dir, 0755);
+    }
+
+    // Create albumart cache directory
+    mkdir(cache_dir, 0755);
+}
+
+static void get_cover_path(uint64_t key, char* path, int path_size) {
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+    snprintf(path, path_size, "%s/%016" PRIx64 ".jpg", cache_dir, key);
+}
+
+static void get_index_path(char* path, int path_size) {
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+    snprintf(path, path_size, "%s/" ART_INDEX_NAME, cache_dir);
+}
+
+// FNV-1a of a string lowercased, trimmed and with whitespace runs collapsed
+static uint64_t hash_normalized(uint64_t hash, const char* s) {
+    bool space = false;
+    bool started = false;
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (isspace(c)) {
+            space = started;
+            continue;
+        }
+        if (space) hash = (hash ^ ' ') * 1099511628211ULL;
+        hash = (hash ^ (uint8_t)tolower(c)) * 1099511628211ULL;
+        space = false;
+        started = true;
+    }
+    return hash;
+}
+
+static uint64_t entry_key(const char* artist, const char* title) {
+    uint64_t hash = hash_normalized(14695981039346656037ULL, artist);
+    hash = (hash ^ 0x1F) * 1099511628211ULL;   // Keeps "a b"+"c" apart from "a"+"b c"
+    return hash_normalized(hash, title);
+}
+
+// Remove the files of a directory without an index: covers of an older
+// version, or ones whose index was lost
+static void remove_unindexed(void) {
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+    DIR* dir = opendir(cache_dir);
+    if (!dir) return;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char filepath[768];
+        snprintf(filepath, sizeof(filepath), "%s/%s", cache_dir, ent->d_name);
+        unlink(filepath);
+    }
+    closedir(dir);
+}
+
+static void load_index(void) {
+    if (index_loaded) return;
+    index_loaded = true;
+    ensure_cache_dir();
+
+    char path[768];
+    get_index_path(path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    ArtIndexHeader header;
+    bool valid = f && fread(&header, sizeof(header), 1, f) == 1 && header.magic == ART_INDEX_MAGIC &&
+                 header.version == ART_INDEX_VERSION && header.count <= ART_INDEX_MAX &&
+                 fread(index_entries, sizeof(ArtIndexEntry), header.count, f) == header.count;
+    if (f) fclose(f);
+    if (!valid) {
+        remove_unindexed();
+        index_count = 0;
+        index_bytes = 0;
+        return;
+    }
+
+    index_count = (int)header.count;
+    index_bytes = 0;
+    for (int i = 0; i < index_count; i++) index_bytes += index_entries[i].size;
+}
+
+void radio_art_cache_flush(void) {
+    if (!index_dirty) return;
+
+    char path[768], tmp_path[800];
+    get_index_path(path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) return;
+
+    ArtIndexHeader header = {ART_INDEX_MAGIC, ART_INDEX_VERSION, (uint32_t)index_count, 0};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(index_entries, sizeof(ArtIndexEntry), index_count, f) == (size_t)index_count;
+    ok = fclose(f) == 0 && ok;
+    if (ok && rename(tmp_path, path) == 0) {
+        index_dirty = false;
+    } else {
+        unlink(tmp_path);
+    }
+}
+
+static ArtIndexEntry* find_entry(uint64_t key) {
+    for (int i = 0; i < index_count; i++) {
+        if (index_entries[i].key == key) return &index_entries[i];
+    }
+    return NULL;
+}
+
+// Remove an entry and its cover file
+static void remove_entry(ArtIndexEntry* entry) {
+    if (!(entry->flags & ART_ENTRY_NONE)) {
+        char path[768];
+        get_cover_path(entry->key, path, sizeof(path));
+        unlink(path);
+    }
+    index_bytes -= entry->size;
+    *entry = index_entries[--index_count];
+    index_dirty = true;
+}
+
+// Evict least recently used entries until size more bytes fit the budget and an
+// entry is free
+static void make_room(uint32_t size) {
+    while (index_count > 0 &&
+           (index_count >= ART_INDEX_MAX || index_bytes + size > RADIO_ART_CACHE_BYTES)) {
+        // A full budget needs a cover gone; a full index takes any entry
+        bool need_bytes = index_bytes + size > RADIO_ART_CACHE_BYTES;
+        ArtIndexEntry* oldest = NULL;
+        for (int i = 0; i < index_count; i++) {
+            ArtIndexEntry* e = &index_entries[i];
+            if (need_bytes && (e->flags & ART_ENTRY_NONE)) continue;
+            if (!oldest || e->last_access < oldest->last_access) oldest = e;
+        }
+        if (!oldest) break;
+        remove_entry(oldest);
+    }
+}
+
+// Add or replace the entry of key
+static ArtIndexEntry* put_entry(uint64_t key, uint32_t size, uint32_t flags) {
+    ArtIndexEntry* entry = find_entry(key);
+    if (entry) remove_entry(entry);
+    make_room(size);
+    if (index_count >= ART_INDEX_MAX) return NULL;
+
+    entry = &index_entries[index_count++];
+    memset(entry, 0, sizeof(ArtIndexEntry));
+    entry->key = key;
+    entry->size = size;
+    entry->flags = flags;
+    entry->last_access = (uint32_t)time(NULL);
+    index_bytes += size;
+    index_dirty = true;
+    return entry;
+}
+
+// Read a cover file
+static uint8_t* read_cover(uint64_t key, uint32_t expected, int* size) {
+    char path[768];
+    get_cover_path(key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    uint8_t* data = NULL;
+    if (expected > 0 && expected <= ART_FILE_MAX) data = malloc(expected);
+    if (data && fread(data, 1, expected, f) != expected) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = (int)expected;
+    return data;
+}
+
+RadioArtCacheResult radio_art_cache_lookup(const char* artist, const char* title, uint8_t** data, int* size) {
+    load_index();
+    ArtIndexEntry* entry = find_entry(entry_key(artist, title));
+    if (!entry) return RADIO_ART_CACHE_MISS;
+
+    uint32_t now = (uint32_t)time(NULL);
+    if (entry->flags & ART_ENTRY_NONE) {
+        // Also expired if the clock went back (no RTC)
+        if (now >= entry->last_access && now - entry->last_access < RADIO_ART_CACHE_NONE_TTL) {
+            return RADIO_ART_CACHE_NONE;
+        }
+        remove_entry(entry);
+        return RADIO_ART_CACHE_MISS;
+    }
+
+    *data = read_cover(entry->key, entry->size, size);
+    if (!*data) {
+        remove_entry(entry);    // Removed or damaged behind our back
+        return RADIO_ART_CACHE_MISS;
+    }
+    entry->last_access = now;
+    index_dirty = true;
+    return RADIO_ART_CACHE_HIT;
+}
+
+void radio_art_cache_store(const char* artist, const char* title, const uint8_t* data, int size) {
+    if (size <= 0 || size > ART_FILE_MAX) return;
+    load_index();
+    uint64_t key = entry_key(artist, title);
+    if (!put_entry(key, (uint32_t)size, 0)) return;
+
+    char path[768];
+    get_cover_path(key, path, sizeof(path));
+    FILE* f = fopen(path, "wb");
+    bool ok = f && fwrite(data, 1, size, f) == (size_t)size;
+    if (f) ok = fclose(f) == 0 && ok;
+    if (!ok) {
+        LOG_error("Album art: cannot write %s\n", path);
+        remove_entry(find_entry(key));
+    }
+}
+
+void radio_art_cache_storeNone(const char* artist, const char* title) {
+    load_index();
+    put_entry(entry_key(artist, title), 0, ART_ENTRY_NONE);
+}
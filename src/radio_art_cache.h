@@ -0,0 +1,37 @@
+#ifndef __RADIO_ART_CACHE_H__
+#define __RADIO_ART_CACHE_H__
+
+#include <stdint.h>
+
+// Album art disk cache
+// Downloaded covers are kept as files named after a 64-bit hash of the normalized
+// artist and title, listed in an index file (size, last access, or "no art found")
+// that is read once and written back when the worker is idle. The least recently
+// used covers are evicted to stay within RADIO_ART_CACHE_BYTES. Lookups that found
+// no art are remembered for RADIO_ART_CACHE_NONE_TTL, so unknown songs and station
+// jingles aren't searched again on every play.
+// Album art worker thread only.
+
+#define RADIO_ART_CACHE_BYTES (32 * 1024 * 1024)
+#define RADIO_ART_CACHE_NONE_TTL (3 * 24 * 60 * 60)    // Seconds
+
+typedef enum {
+    RADIO_ART_CACHE_MISS,       // Not cached: look it up
+    RADIO_ART_CACHE_HIT,        // Cover read
+    RADIO_ART_CACHE_NONE        // Known to have no art
+} RadioArtCacheResult;
+
+// Look up the cover of artist/title; on a hit *data (malloc'ed, the caller frees
+// it) and *size hold the encoded image
+RadioArtCacheResult radio_art_cache_lookup(const char* artist, const char* title, uint8_t** data, int* size);
+
+// Store the encoded cover of artist/title
+void radio_art_cache_store(const char* artist, const char* title, const uint8_t* data, int size);
+
+// Remember that artist/title has no art
+void radio_art_cache_storeNone(const char* artist, const char* title);
+
+// Write the index if it changed
+void radio_art_cache_flush(void);
+
+#endif
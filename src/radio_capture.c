@@ -0,0 +1,439 @@
+#ifdef RADIO_CAPTURE
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "defines.h"
+#include "api.h"
+#include "radio_capture.h"
+
+// A capture directory holds, per recorded response <id>:
+//   <id>.bin   the body
+//   <id>.tim   one "<ms since the request> <bytes>" line per piece received
+//   <id>.hdr   the response headers to replay
+// index.txt lists "<id> <ms since capture start> <stream|fetch> <url>" for the
+// complete ones, and stations.txt "<ms> <url>" for each Radio_play.
+
+#define CAPTURE_OPEN_MAX 16         // Responses recorded at the same time
+#define REPLAY_ENTRIES_MAX 8192
+#define REPLAY_REQUEST_MAX 8192
+#define REPLAY_PIECE_MAX (64 * 1024)
+
+typedef struct {
+    int id;                     // 0 = free
+    FILE* body;
+    FILE* timing;
+    uint64_t start_ms;          // Request time, on the capture clock
+    char* url;
+} CaptureEntry;
+
+static pthread_mutex_t capture_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int capture_state = 0;   // 0 = not checked yet, 1 = capturing, -1 = off
+static char capture_dir[512];
+static uint64_t capture_epoch_ms;
+static int capture_next_id = 1;
+static CaptureEntry capture_open[CAPTURE_OPEN_MAX];
+
+static int replay_redirect_port = 0;
+
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// ============ CAPTURE ============
+
+// Start a session directory if RADIO_CAPTURE_DIR exists (mutex held)
+static bool capture_ready(void) {
+    if (capture_state == 0) {
+        struct stat st;
+        capture_state = -1;
+        if (stat(RADIO_CAPTURE_DIR, &st) == 0 && S_ISDIR(st.st_mode)) {
+            snprintf(capture_dir, sizeof(capture_dir), "%s/%ld", RADIO_CAPTURE_DIR, (long)time(NULL));
+            if (mkdir(capture_dir, 0755) == 0) {
+                capture_state = 1;
+                capture_epoch_ms = now_ms();
+                LOG_info("RadioCapture: recording into %s\n", capture_dir);
+            }
+        }
+    }
+    return capture_state > 0;
+}
+
+static CaptureEntry* capture_find(int id) {
+    for (int i = 0; i < CAPTURE_OPEN_MAX; i++) {
+        if (capture_open[i].id == id) return &capture_open[i];
+    }
+    return NULL;
+}
+
+static FILE* capture_file(int id, const char* ext, const char* mode) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%d.%s", capture_dir, id, ext);
+    return fopen(path, mode);
+}
+
+void radio_capture_station(const char* url) {
+    pthread_mutex_lock(&capture_mutex);
+    if (capture_ready()) {
+        char path[600];
+        snprintf(path, sizeof(path), "%s/stations.txt", capture_dir);
+        FILE* f = fopen(path, "a");
+        if (f) {
+            fprintf(f, "%llu %s\n", (unsigned long long)(now_ms() - capture_epoch_ms), url);
+            fclose(f);
+        }
+    }
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+int radio_capture_open(const char* url) {
+    int id = 0;
+    pthread_mutex_lock(&capture_mutex);
+    CaptureEntry* e = capture_ready() ? capture_find(0) : NULL;
+    if (e) {
+        int next = capture_next_id;
+        e->body = capture_file(next, "bin", "wb");
+        e->timing = capture_file(next, "tim", "w");
+        e->url = strdup(url);
+        if (e->body && e->timing && e->url) {
+            e->id = id = capture_next_id++;
+            e->start_ms = now_ms() - capture_epoch_ms;
+        } else {
+            if (e->body) fclose(e->body);
+            if (e->timing) fclose(e->timing);
+            free(e->url);
+            memset(e, 0, sizeof(*e));
+        }
+    }
+    pthread_mutex_unlock(&capture_mutex);
+    return id;
+}
+
+void radio_capture_data(int id, const uint8_t* data, int len) {
+    if (id == 0 || len <= 0) return;
+    pthread_mutex_lock(&capture_mutex);
+    CaptureEntry* e = capture_find(id);
+    if (e) {
+        fwrite(data, 1, len, e->body);
+        fprintf(e->timing, "%llu %d\n",
+                (unsigned long long)(now_ms() - capture_epoch_ms - e->start_ms), len);
+    }
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+void radio_capture_close(int id, bool complete, bool stream, const char* content_type,
+                         int icy_metaint, int icy_br, const char* icy_name) {
+    if (id == 0) return;
+    pthread_mutex_lock(&capture_mutex);
+    CaptureEntry* e = capture_find(id);
+    if (e) {
+        fclose(e->body);
+        fclose(e->timing);
+        FILE* hdr = complete ? capture_file(id, "hdr", "w") : NULL;
+        if (hdr) {
+            while (content_type && *content_type == ' ') content_type++;
+            if (content_type && *content_type) fprintf(hdr, "Content-Type: %s\r\n", content_type);
+            if (icy_metaint > 0) fprintf(hdr, "icy-metaint: %d\r\n", icy_metaint);
+            if (icy_br > 0) fprintf(hdr, "icy-br: %d\r\n", icy_br);
+            if (icy_name && *icy_name) fprintf(hdr, "icy-name: %s\r\n", icy_name);
+            fclose(hdr);
+
+            char path[600];
+            snprintf(path, sizeof(path), "%s/index.txt", capture_dir);
+            FILE* index = fopen(path, "a");
+            if (index) {
+                fprintf(index, "%d %llu %s %s\n", id, (unsigned long long)e->start_ms,
+                        stream ? "stream" : "fetch", e->url);
+                fclose(index);
+            }
+        } else {
+            static const char* const exts[] = {"bin", "tim", "hdr"};
+            for (int i = 0; i < 3; i++) {
+                char path[600];
+                snprintf(path, sizeof(path), "%s/%d.%s", capture_dir, id, exts[i]);
+                unlink(path);
+            }
+        }
+        free(e->url);
+        memset(e, 0, sizeof(*e));
+    }
+    pthread_mutex_unlock(&capture_mutex);
+}
+
+// ============ REPLAY ============
+
+typedef struct {
+    int id;
+    uint64_t start_ms;
+    bool stream;
+    char* path;                 // Path and query of the recorded URL
+} ReplayEntry;
+
+static struct {
+    char dir[512];
+    RadioReplayOptions options;
+    ReplayEntry* entries;
+    int count;
+    uint64_t epoch_ms;          // First request: the replay clock starts there
+    uint64_t link_free_ms;      // Bandwidth cap: when the shared link is next idle
+    uint32_t connections;
+    pthread_mutex_t mutex;
+} replay = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+static const char* url_path(const char* url) {
+    const char* start = strstr(url, "://");
+    start = start ? start + 3 : url;
+    const char* path = strchr(start, '/');
+    return path ? path : "/";
+}
+
+static int replay_load(const char* dir) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/index.txt", dir);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+
+    replay.entries = calloc(REPLAY_ENTRIES_MAX, sizeof(ReplayEntry));
+    char line[4096];
+    while (replay.entries && replay.count < REPLAY_ENTRIES_MAX && fgets(line, sizeof(line), f)) {
+        int id;
+        unsigned long long start;
+        char kind[16];
+        int consumed;
+        if (sscanf(line, "%d %llu %15s %n", &id, &start, kind, &consumed) != 3) continue;
+        line[strcspn(line, "\r\n")] = '\0';
+        ReplayEntry* e = &replay.entries[replay.count];
+        e->path = strdup(url_path(line + consumed));
+        if (!e->path) break;
+        e->id = id;
+        e->start_ms = start;
+        e->stream = strcmp(kind, "stream") == 0;
+        replay.count++;
+    }
+    fclose(f);
+    return replay.count > 0 ? 0 : -1;
+}
+
+// The recording of path current at replay time elapsed_ms: the last one started
+// by then, or the first one of all
+static const ReplayEntry* replay_pick(const char* path, uint64_t elapsed_ms) {
+    const ReplayEntry* best = NULL;
+    const ReplayEntry* first = NULL;
+    for (int i = 0; i < replay.count; i++) {
+        const ReplayEntry* e = &replay.entries[i];
+        if (strcmp(e->path, path) != 0) continue;
+        if (!first || e->start_ms < first->start_ms) first = e;
+        if (e->start_ms <= elapsed_ms && (!best || e->start_ms > best->start_ms)) best = e;
+    }
+    return best ? best : first;
+}
+
+static int send_all(int fd, const void* data, size_t len) {
+    const uint8_t* p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void sleep_until_ms(uint64_t at) {
+    uint64_t now = now_ms();
+    if (at > now) usleep((useconds_t)(at - now) * 1000);
+}
+
+static void replay_serve(int fd, uint32_t seed) {
+    char request[REPLAY_REQUEST_MAX];
+    int len = 0;
+    while (len < REPLAY_REQUEST_MAX - 1) {
+        ssize_t n = recv(fd, request + len, REPLAY_REQUEST_MAX - 1 - len, 0);
+        if (n <= 0) return;
+        len += n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n")) break;
+    }
+    char path[4096];
+    if (sscanf(request, "GET %4095s", path) != 1) return;
+
+    uint64_t start = now_ms();
+    pthread_mutex_lock(&replay.mutex);
+    if (replay.epoch_ms == 0) replay.epoch_ms = start;
+    const ReplayEntry* e = replay_pick(path, start - replay.epoch_ms);
+    pthread_mutex_unlock(&replay.mutex);
+
+    char file[600];
+    FILE* body = NULL;
+    FILE* timing = NULL;
+    if (e) {
+        snprintf(file, sizeof(file), "%s/%d.bin", replay.dir, e->id);
+        body = fopen(file, "rb");
+        snprintf(file, sizeof(file), "%s/%d.tim", replay.dir, e->id);
+        timing = fopen(file, "r");
+    }
+    if (!body || !timing) {
+        static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        send_all(fd, not_found, sizeof(not_found) - 1);
+        if (body) fclose(body);
+        if (timing) fclose(timing);
+        return;
+    }
+
+    char headers[2048];
+    int pos = snprintf(headers, sizeof(headers), "%s 200 OK\r\n", e->stream ? "HTTP/1.0" : "HTTP/1.1");
+    snprintf(file, sizeof(file), "%s/%d.hdr", replay.dir, e->id);
+    FILE* hdr = fopen(file, "r");
+    if (hdr) {
+        pos += fread(headers + pos, 1, sizeof(headers) - 256 - pos, hdr);
+        fclose(hdr);
+    }
+    if (!e->stream) {
+        fseek(body, 0, SEEK_END);
+        pos += snprintf(headers + pos, sizeof(headers) - pos, "Content-Length: %ld\r\n", ftell(body));
+        fseek(body, 0, SEEK_SET);
+    }
+    snprintf(headers + pos, sizeof(headers) - pos, "Connection: close\r\n\r\n");
+    if (send_all(fd, headers, strlen(headers)) != 0) goto done;
+
+    // Pieces as they arrived, with the injected faults on top
+    uint8_t* piece = malloc(REPLAY_PIECE_MAX);
+    uint64_t last_due = start;
+    unsigned long long at_ms;
+    int bytes;
+    while (piece && fscanf(timing, "%llu %d", &at_ms, &bytes) == 2) {
+        if (bytes <= 0) break;
+        if (replay.options.loss_pct > 0 && rand_r(&seed) % 10000 < (unsigned)(replay.options.loss_pct * 100)) break;
+
+        uint64_t due = start + at_ms;
+        if (replay.options.jitter_ms > 0) due += rand_r(&seed) % (replay.options.jitter_ms + 1);
+        if (due < last_due) due = last_due;     // Jitter delays, it never reorders
+        last_due = due;
+        if (replay.options.kbps > 0) {
+            pthread_mutex_lock(&replay.mutex);
+            uint64_t begin = replay.link_free_ms > due ? replay.link_free_ms : due;
+            replay.link_free_ms = begin + (uint64_t)bytes * 8 / replay.options.kbps;
+            pthread_mutex_unlock(&replay.mutex);
+            due = begin;
+        }
+        sleep_until_ms(due);
+
+        bool sent = true;
+        for (int left = bytes; sent && left > 0;) {
+            int n = left < REPLAY_PIECE_MAX ? left : REPLAY_PIECE_MAX;
+            sent = fread(piece, 1, n, body) == (size_t)n && send_all(fd, piece, n) == 0;
+            left -= n;
+        }
+        if (!sent) break;
+    }
+    free(piece);
+
+done:
+    fclose(body);
+    fclose(timing);
+}
+
+typedef struct {
+    int fd;
+    uint32_t seed;
+} ReplayConnection;
+
+static void* replay_connection_func(void* arg) {
+    ReplayConnection* c = arg;
+    replay_serve(c->fd, c->seed);
+    close(c->fd);
+    free(c);
+    return NULL;
+}
+
+int radio_replay_station(const char* dir, char* url, int url_size) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/stations.txt", dir);
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    char line[4096];
+    int result = -1;
+    unsigned long long at;
+    int consumed;
+    if (fgets(line, sizeof(line), f) && sscanf(line, "%llu %n", &at, &consumed) == 1) {
+        line[strcspn(line, "\r\n")] = '\0';
+        snprintf(url, url_size, "%s", line + consumed);
+        result = url[0] ? 0 : -1;
+    }
+    fclose(f);
+    return result;
+}
+
+pid_t radio_replay_spawn(const char* dir, const RadioReplayOptions* options, int* port) {
+    snprintf(replay.dir, sizeof(replay.dir), "%s", dir);
+    replay.options = *options;
+    if (replay_load(dir) != 0) {
+        LOG_error("RadioReplay: no capture in %s\n", dir);
+        return -1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0) return -1;
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 16) != 0 ||
+        getsockname(listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+        close(listen_fd);
+        return -1;
+    }
+    *port = ntohs(addr.sin_port);
+
+    pid_t pid = fork();
+    if (pid != 0) {
+        close(listen_fd);
+        return pid;
+    }
+
+    // Server: one thread per connection until killed
+    signal(SIGPIPE, SIG_IGN);
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            _exit(1);
+        }
+        ReplayConnection* c = malloc(sizeof(ReplayConnection));
+        pthread_t thread;
+        if (c) {
+            c->fd = fd;
+            c->seed = options->seed + replay.connections++;
+        }
+        if (!c || pthread_create(&thread, NULL, replay_connection_func, c) != 0) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
+
+void radio_replay_redirect(int port) {
+    __atomic_store_n(&replay_redirect_port, port, __ATOMIC_RELEASE);
+}
+
+int radio_replay_port(void) {
+    return __atomic_load_n(&replay_redirect_port, __ATOMIC_ACQUIRE);
+}
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __RADIO_CAPTURE_H__
+#define __RADIO_CAPTURE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// Recorded radio traffic for reproducible soak tests (RADIO_CAPTURE builds:
+// make RADIO_CAPTURE=1; the benchmark build always has it)
+// Capture: while RADIO_CAPTURE_DIR exists, each run records into a new
+// subdirectory the stations given to Radio_play, and every direct stream and
+// HTTP fetch (HLS playlists and segments included): the body as received (ICY
+// metadata left in, gzip decoded), when each piece arrived, and the response
+// headers the player reads. Range requests aren't recorded.
+// Replay: radio_replay_spawn() serves a capture from a loopback HTTP server in
+// a child process, so its CPU time isn't counted as the player's. Responses are
+// paced as recorded; a playlist fetched several times is served as the version
+// captured last before that point of the replay clock. After
+// radio_replay_redirect() every stream and fetch goes to the server instead of
+// the network (matched by path, the host is ignored).
+// Without RADIO_CAPTURE the macros compile to nothing.
+
+#define RADIO_CAPTURE_DIR SHARED_USERDATA_PATH "/radio_capture"
+
+#ifdef RADIO_CAPTURE
+
+// Note a station being started
+void radio_capture_station(const char* url);
+
+// Start recording a response body; returns its id, or 0 when not capturing
+int radio_capture_open(const char* url);
+
+void radio_capture_data(int id, const uint8_t* data, int len);
+
+// Finish a recording: kept with its headers if complete, dropped otherwise.
+// stream marks a direct (ICY) stream; its icy-* values are replayed with it.
+void radio_capture_close(int id, bool complete, bool stream, const char* content_type,
+                         int icy_metaint, int icy_br, const char* icy_name);
+
+typedef struct {
+    int jitter_ms;              // Each piece delayed by up to this much more (uniform)
+    float loss_pct;             // Chance of the connection being cut before each piece
+    int kbps;                   // Bandwidth shared by all responses (0 = unlimited)
+    uint32_t seed;              // Same seed, same jitter and cuts
+} RadioReplayOptions;
+
+// First station captured in dir; 0 on success
+int radio_replay_station(const char* dir, char* url, int url_size);
+
+// Fork a server for the capture in dir (call before starting any thread)
+// Returns its pid with *port set, or -1. Stop it with SIGTERM.
+pid_t radio_replay_spawn(const char* dir, const RadioReplayOptions* options, int* port);
+
+// Send all radio traffic to the server on port (0 = back to the network)
+void radio_replay_redirect(int port);
+int radio_replay_port(void);
+
+#define RADIO_CAPTURE_STATION(url) radio_capture_station(url)
+#define RADIO_CAPTURE_OPEN(url) radio_capture_open(url)
+#define RADIO_CAPTURE_DATA(id, data, len) radio_capture_data(id, data, len)
+#define RADIO_CAPTURE_CLOSE(id, complete, stream, content_type, icy_metaint, icy_br, icy_name) \
+    radio_capture_close(id, complete, stream, content_type, icy_metaint, icy_br, icy_name)
+#define RADIO_REPLAY_PORT() radio_replay_port()
+
+#else
+
+#define RADIO_CAPTURE_STATION(url) ((void)0)
+#define RADIO_CAPTURE_OPEN(url) 0
+#define RADIO_CAPTURE_DATA(id, data, len) ((void)0)
+#define RADIO_CAPTURE_CLOSE(id, complete, stream, content_type, icy_metaint, icy_br, icy_name) ((void)0)
+#define RADIO_REPLAY_PORT() 0
+
+#endif
+
+#endif
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include "defines.h"
+#include "api.h"
+#include "jobs.h"
+#include "netjobs.h"
+#include "radio_net.h"
+#include "radio_curated.h"
+#include "radio_catalog.h"
+
+#include "include/parson/parson.h"
+
+#define MANIFEST_KEY "*"            // State line of the manifest itself
+
+// What CATALOG_DIR holds: one line per file, file|version|etag|last_modified
+typedef struct {
+    char file[64];
+    int version;
+    RadioNetValidators validators;
+} CatalogEntry;
+
+typedef struct {
+    CatalogEntry manifest;
+    CatalogEntry files[CATALOG_MAX_FILES];
+    int file_count;
+    bool changed;                   // Files written or deleted: the index needs a rebuild
+} CatalogState;
+
+static JobToken* sync_token = NULL;
+static bool sync_ready = false;     // A rebuilt index waits for radio_catalog_apply
+
+// Split a line at '|' into count fields, empty ones kept; false if it has fewer
+static bool split_fields(char* line, char* fields[], int count) {
+    char* nl = strpbrk(line, "\r\n");
+    if (nl) *nl = '\0';
+    for (int n = 0; n < count; n++) {
+        fields[n] = line;
+        line = strchr(line, '|');
+        if (!line) return n == count - 1;
+        *line++ = '\0';
+    }
+    return true;
+}
+
+static void load_state(CatalogState* state) {
+    memset(state, 0, sizeof(*state));
+    FILE* f = fopen(CATALOG_STATE, "r");
+    if (!f) return;
+    char line[512];
+    char* fields[4];
+    while (fgets(line, sizeof(line), f)) {
+        if (!split_fields(line, fields, 4)) continue;
+        CatalogEntry* entry;
+        if (strcmp(fields[0], MANIFEST_KEY) == 0) {
+            entry = &state->manifest;
+        } else if (state->file_count < CATALOG_MAX_FILES) {
+            entry = &state->files[state->file_count++];
+        } else {
+            continue;
+        }
+        snprintf(entry->file, sizeof(entry->file), "%s", fields[0]);
+        entry->version = atoi(fields[1]);
+        snprintf(entry->validators.etag, sizeof(entry->validators.etag), "%s", fields[2]);
+        snprintf(entry->validators.last_modified, sizeof(entry->validators.last_modified), "%s", fields[3]);
+    }
+    fclose(f);
+}
+
+static void write_entry(FILE* f, const char* file, const CatalogEntry* entry) {
+    fprintf(f, "%s|%d|%s|%s\n", file, entry->version, entry->validators.etag, entry->validators.last_modified);
+}
+
+// Written aside and renamed: the state file is what marks the catalog complete
+static void save_state(const CatalogState* state) {
+    const char* tmp = CATALOG_STATE ".tmp";
+    FILE* f = fopen(tmp, "w");
+    if (!f) return;
+    write_entry(f, MANIFEST_KEY, &state->manifest);
+    for (int i = 0; i < state->file_count; i++) write_entry(f, state->files[i].file, &state->files[i]);
+    if (fclose(f) != 0 || rename(tmp, CATALOG_STATE) != 0) unlink(tmp);
+}
+
+static CatalogEntry* find_entry(CatalogState* state, const char* file) {
+    for (int i = 0; i < state->file_count; i++) {
+        if (strcmp(state->files[i].file, file) == 0) return &state->files[i];
+    }
+    return NULL;
+}
+
+// A plain file name of CATALOG_DIR, nothing the manifest could escape it with
+static bool valid_file(const char* file) {
+    size_t len = file ? strlen(file) : 0;
+    if (len < 6 || len >= sizeof(((CatalogEntry*)0)->file) || file[0] == '.') return false;
+    if (strchr(file, '/') || strchr(file, '|') || strchr(file, '\\')) return false;
+    return strcmp(file + len - 5, ".json") == 0;
+}
+
+// Base URL of the manifest, country files are next to it
+static void file_url(const char* file, char* url, int url_size) {
+    const char* slash = strrchr(CATALOG_URL, '/');
+    snprintf(url, url_size, "%.*s/%s", (int)(slash - CATALOG_URL), CATALOG_URL, file);
+}
+
+// Fetch one country file into CATALOG_DIR unless what is there is current
+// Returns false if the sync should stop (fetch or write failed).
+static bool sync_file(CatalogState* old, CatalogEntry* entry) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", CATALOG_DIR, entry->file);
+    CatalogEntry* have = find_entry(old, entry->file);
+    bool present = access(path, F_OK) == 0;
+    if (have && present) {
+        entry->validators = have->validators;
+        if (have->version == entry->version) return true;
+    }
+    if (!present) memset(&entry->validators, 0, sizeof(entry->validators));
+
+    char url[512];
+    file_url(entry->file, url, sizeof(url));
+    RadioNetBody body = {0};
+    int len = radio_net_fetchBody(url, &body, CATALOG_FILE_MAX, &entry->validators);
+    if (len == RADIO_NET_NOT_MODIFIED) {
+        radio_net_freeBody(&body);
+        return true;
+    }
+    if (len <= 0) {
+        LOG_error("[Catalog] Fetch failed: %s\n", url);
+        radio_net_freeBody(&body);
+        return false;
+    }
+
+    char tmp[520];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE* f = fopen(tmp, "wb");
+    bool saved = f && fwrite(body.data, 1, len, f) == (size_t)len;
+    if (f && fclose(f) != 0) saved = false;
+    radio_net_freeBody(&body);
+    if (!saved || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return false;
+    }
+    old->changed = true;
+    return true;
+}
+
+// Delete the JSON files of CATALOG_DIR the manifest no longer lists
+static void drop_unlisted(CatalogState* old, CatalogState* state) {
+    DIR* dir = opendir(CATALOG_DIR);
+    if (!dir) return;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!valid_file(ent->d_name) || find_entry(state, ent->d_name)) continue;
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", CATALOG_DIR, ent->d_name);
+        unlink(path);
+        old->changed = true;
+    }
+    closedir(dir);
+}
+
+static void sync_run(CatalogState* old, JobToken* token) {
+    if (!radio_net_online()) return;
+    load_state(old);
+    mkdir(CATALOG_DIR, 0755);
+
+    // The manifest's ETag is only on file once a sync has completed
+    CatalogState* state = calloc(1, sizeof(CatalogState));
+    if (!state) return;
+    state->manifest = old->manifest;
+
+    RadioNetBody json = {0};
+    int len = radio_net_fetchBody(CATALOG_URL, &json, CATALOG_MANIFEST_MAX, &state->manifest.validators);
+    if (len == RADIO_NET_NOT_MODIFIED) {
+        utimes(CATALOG_STATE, NULL);    // Checked: not due for another interval
+        radio_net_freeBody(&json);
+        free(state);
+        return;
+    }
+    if (len <= 0) {
+        LOG_error("[Catalog] Fetch failed: %s\n", CATALOG_URL);
+        radio_net_freeBody(&json);
+        free(state);
+        return;
+    }
+
+    JSON_Value* root = json_parse_string((const char*)json.data);
+    radio_net_freeBody(&json);
+    JSON_Object* obj = json_value_get_object(root);
+    JSON_Array* countries = obj ? json_object_get_array(obj, "countries") : NULL;
+    if (!countries) {
+        LOG_error("[Catalog] Invalid manifest\n");
+        json_value_free(root);
+        free(state);
+        return;
+    }
+    state->manifest.version = (int)json_object_get_number(obj, "version");
+    for (size_t i = 0; i < json_array_get_count(countries) && state->file_count < CATALOG_MAX_FILES; i++) {
+        JSON_Object* c = json_array_get_object(countries, i);
+        const char* file = json_object_get_string(c, "file");
+        if (!valid_file(file) || find_entry(state, file)) continue;
+        CatalogEntry* entry = &state->files[state->file_count++];
+        snprintf(entry->file, sizeof(entry->file), "%s", file);
+        entry->version = (int)json_object_get_number(c, "version");
+    }
+    json_value_free(root);
+
+    // Only the countries whose version moved cost a download
+    bool complete = true;
+    for (int i = 0; i < state->file_count && complete; i++) {
+        if (Jobs_cancelled(token) || !sync_file(old, &state->files[i])) complete = false;
+    }
+    if (complete) {
+        drop_unlisted(old, state);
+        save_state(state);
+        if (old->changed && radio_curated_rebuild(CATALOG_DIR) == 0) {
+            LOG_info("[Catalog] Updated to version %d (%d countries)\n", state->manifest.version, state->file_count);
+        }
+    }
+    free(state);
+}
+
+static void sync_job(void* arg, JobToken* token) {
+    RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_CATALOG);
+    sync_run((CatalogState*)arg, token);
+    radio_net_setAccount(account);
+}
+
+static void sync_done(void* arg, bool cancelled) {
+    CatalogState* old = arg;
+    if (!cancelled && old->changed) sync_ready = true;
+    free(old);
+    Jobs_release(sync_token);
+    sync_token = NULL;
+}
+
+static void sync_online(void* arg) {
+    (void)arg;
+    radio_catalog_sync();
+}
+
+void radio_catalog_sync(void) {
+    if (sync_token) return;
+    struct stat st;
+    if (stat(CATALOG_STATE, &st) == 0 && time(NULL) - st.st_mtime < CATALOG_SYNC_INTERVAL) return;
+    if (radio_net_dataSaver()) return;     // Kept to the stations at hand
+
+    // Offline: asked again once the network is back
+    if (!radio_net_online()) {
+        NetJobs_defer("radio-catalog", sync_online, NULL);
+        return;
+    }
+
+    CatalogState* old = calloc(1, sizeof(CatalogState));
+    if (!old) return;
+    sync_token = Jobs_submit(JOB_PRIORITY_IDLE, sync_job, sync_done, old);
+    if (!sync_token) free(old);
+}
+
+bool radio_catalog_apply(void) {
+    if (!sync_ready) return false;
+    sync_ready = false;
+    radio_curated_cleanup();
+    radio_curated_init();
+    return true;
+}
+
+void radio_catalog_quit(void) {
+    if (sync_token) Jobs_cancel(sync_token);
+}
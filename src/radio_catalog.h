@@ -0,0 +1,38 @@
+#ifndef __RADIO_CATALOG_H__
+#define __RADIO_CATALOG_H__
+
+#include <stdbool.h>
+
+#include "selfupdate.h"
+
+// Curated catalog sync
+// The curated stations are refreshed without an app update. An idle job fetches
+// CATALOG_URL, a manifest listing one JSON file per country with a version:
+//   {"version": 3, "countries": [{"file": "MLA.json", "version": 2}, ...]}
+// conditionally on its ETag (kept across restarts, so an unchanged catalog costs
+// one 304), then only the country files whose version changed, each conditional
+// on its own ETag. Files are kept in CATALOG_DIR; those dropped from the manifest
+// are deleted. Once all are in, CATALOG_STATE is written and the job rebuilds
+// the curated index from them, still off the main thread. radio_catalog_apply()
+// swaps it in where nothing points into the old one. Until a sync completes the
+// pak's stations/ are used. A sync runs at most every CATALOG_SYNC_INTERVAL.
+
+#define CATALOG_URL "https://raw.githubusercontent.com/" APP_GITHUB_REPO "/main/stations/catalog.json"
+#define CATALOG_DIR SHARED_USERDATA_PATH "/stations"
+#define CATALOG_STATE CATALOG_DIR "/catalog.txt"
+#define CATALOG_SYNC_INTERVAL (24 * 60 * 60)   // Seconds
+#define CATALOG_MANIFEST_MAX (256 * 1024)
+#define CATALOG_FILE_MAX (8 * 1024 * 1024)
+#define CATALOG_MAX_FILES 256
+
+// Queue a sync if the last one is older than CATALOG_SYNC_INTERVAL (main thread)
+void radio_catalog_sync(void);
+
+// Swap in the index of a sync that finished (main thread, while the station
+// browser isn't open). Returns true if it did.
+bool radio_catalog_apply(void);
+
+// Cancel a sync in progress (main thread, before Jobs_quit)
+void radio_catalog_quit(void);
+
+#endif
@@ -0,0 +1,429 @@
+#define _GNU_SOURCE  // For strcasestr
+#include "radio_conn.h"
+#include "radio_net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/ioctl.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+
+#include "defines.h"
+#include "api.h"
+#include "radio_capture.h"
+
+#include "mbedtls/error.h"
+
+#define RADIO_CONN_MAX_REDIRECTS 5
+
+// Cleanup SSL
+static void ssl_cleanup(RadioConn* conn) {
+    if (conn->ssl_initialized) {
+        mbedtls_ssl_close_notify(&conn->ssl);
+        radio_net_release(conn->ssl_net.fd);
+        mbedtls_net_free(&conn->ssl_net);
+        mbedtls_ssl_free(&conn->ssl);
+        conn->ssl_initialized = false;
+    }
+}
+
+// Close the socket (and TLS session) of an attempt
+static void disconnect(RadioConn* conn) {
+    if (conn->use_ssl) {
+        ssl_cleanup(conn);
+        conn->use_ssl = false;
+    } else if (conn->socket_fd >= 0) {
+        radio_net_release(conn->socket_fd);
+        close(conn->socket_fd);
+    }
+    conn->socket_fd = -1;
+}
+
+// Send wrapper (works with both HTTP and HTTPS)
+static int conn_send(RadioConn* conn, const void* buf, size_t len) {
+    int n;
+    if (conn->use_ssl) {
+        n = mbedtls_ssl_write(&conn->ssl, buf, len);
+    } else {
+        n = send(conn->socket_fd, buf, len, 0);
+    }
+    if (n > 0) radio_net_count(conn->account, 0, n);
+    return n;
+}
+
+// Receive wrapper (works with both HTTP and HTTPS)
+static int conn_recv(RadioConn* conn, void* buf, size_t len) {
+    int n;
+    if (conn->use_ssl) {
+        n = mbedtls_ssl_read(&conn->ssl, buf, len);
+    } else {
+        n = recv(conn->socket_fd, buf, len, 0);
+    }
+    if (n > 0) radio_net_count(conn->account, n, 0);
+    return n;
+}
+
+// Connect to stream server (supports HTTP and HTTPS)
+static int connect_stream(RadioConn* conn, const char* url) {
+    char host[256], path[512];
+    int port;
+    bool is_https;
+
+    if (radio_net_parse_url(url, host, 256, &port, path, 512, &is_https) != 0) {
+        snprintf(conn->error, sizeof(conn->error), "Invalid URL");
+        return -1;
+    }
+
+    conn->use_ssl = is_https;
+
+    int ret;
+    if (is_https) {
+        // HTTPS over the shared TLS configuration, resuming the host's last session
+        mbedtls_net_init(&conn->ssl_net);
+        mbedtls_ssl_init(&conn->ssl);
+        conn->ssl_initialized = true;   // Freed by ssl_cleanup() from here on
+        ret = radio_net_tls_connect(&conn->ssl, &conn->ssl_net, host, port);
+
+        // Store socket fd for select() compatibility
+        conn->socket_fd = ret == 0 ? conn->ssl_net.fd : -1;
+    } else {
+        ret = conn->socket_fd = radio_net_connect(host, port);
+    }
+
+    if (ret < 0) {
+        disconnect(conn);
+        snprintf(conn->error, sizeof(conn->error), "%s",
+                 ret == RADIO_NET_ERR_OFFLINE ? "No network connection" :
+                 ret == RADIO_NET_ERR_DNS ? "DNS lookup failed" :
+                 ret == RADIO_NET_ERR_TLS ? "SSL handshake failed" :
+                 ret == RADIO_NET_ERR_TIMEOUT ? "Connection timed out" : "Connection failed");
+        return -1;
+    }
+
+    // Send HTTP request with ICY headers
+    char request[1024];
+    snprintf(request, sizeof(request),
+        "GET %s HTTP/1.0\r\n"
+        "Host: %s\r\n"
+        "User-Agent: MusicPlayer/1.0\r\n"
+        "Accept: */*\r\n"
+        "Icy-MetaData: 1\r\n"
+        "Connection: close\r\n"
+        "\r\n",
+        path, host);
+
+    if (conn_send(conn, request, strlen(request)) < 0) {
+        disconnect(conn);
+        snprintf(conn->error, sizeof(conn->error), "Send failed");
+        return -1;
+    }
+    if (radio_net_awaitResponse(conn->socket_fd, conn->use_ssl ? &conn->ssl : NULL) != 0) {
+        disconnect(conn);
+        snprintf(conn->error, sizeof(conn->error), "No response");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Parse HTTP response headers
+// Returns: 0 = success, 1 = redirect (to redirect_url), -1 = error
+static int parse_headers(RadioConn* conn, char* redirect_url, int redirect_size) {
+    char header_buf[4096];
+    int header_pos = 0;
+    char c;
+
+    redirect_url[0] = '\0';
+
+    // Read headers until \r\n\r\n
+    while (header_pos < sizeof(header_buf) - 1) {
+        if (conn_recv(conn, &c, 1) != 1) {
+            snprintf(conn->error, sizeof(conn->error), "Header read failed");
+            return -1;
+        }
+        header_buf[header_pos++] = c;
+
+        // Check for end of headers
+        if (header_pos >= 4 &&
+            header_buf[header_pos-4] == '\r' && header_buf[header_pos-3] == '\n' &&
+            header_buf[header_pos-2] == '\r' && header_buf[header_pos-1] == '\n') {
+            break;
+        }
+    }
+    header_buf[header_pos] = '\0';
+
+    // Check for HTTP or ICY response
+    if (strncmp(header_buf, "HTTP/1.", 7) != 0 && strncmp(header_buf, "ICY", 3) != 0) {
+        snprintf(conn->error, sizeof(conn->error), "Invalid response");
+        return -1;
+    }
+
+    // Check HTTP status code for redirects
+    int http_status = 0;
+    if (strncmp(header_buf, "HTTP/1.", 7) == 0) {
+        // Parse status code (e.g., "HTTP/1.1 302 Found")
+        char* status_start = header_buf + 9;  // Skip "HTTP/1.X "
+        http_status = atoi(status_start);
+
+        // Check for redirect (301, 302, 303, 307, 308)
+        if (http_status >= 300 && http_status < 400) {
+            // Find Location header
+            char* loc = strcasestr(header_buf, "\nLocation:");
+            if (!loc) loc = strcasestr(header_buf, "\rlocation:");
+            if (loc) {
+                loc += 10;  // Skip "Location:"
+                while (*loc == ' ' || *loc == '\t') loc++;  // Skip whitespace
+
+                // Copy until end of line
+                char* end = loc;
+                while (*end && *end != '\r' && *end != '\n') end++;
+
+                int len = end - loc;
+                if (len > 0 && len < redirect_size) {
+                    memcpy(redirect_url, loc, len);
+                    redirect_url[len] = '\0';
+                    return 1;  // Indicate redirect
+                }
+            }
+            snprintf(conn->error, sizeof(conn->error), "Redirect without Location");
+            return -1;
+        }
+
+        // Check for error status
+        if (http_status >= 400) {
+            snprintf(conn->error, sizeof(conn->error), "HTTP error %d", http_status);
+            return -1;
+        }
+    }
+
+    // Parse ICY headers (strtok_r: standby connections open on their own threads)
+    conn->icy_metaint = 0;
+    conn->bitrate = 0;
+    conn->station_name[0] = '\0';
+    conn->content_type[0] = '\0';
+
+    char* save = NULL;
+    char* line = strtok_r(header_buf, "\r\n", &save);
+    while (line) {
+        if (strncasecmp(line, "icy-metaint:", 12) == 0) {
+            conn->icy_metaint = atoi(line + 12);
+        }
+        else if (strncasecmp(line, "icy-br:", 7) == 0) {
+            conn->bitrate = atoi(line + 7);
+        }
+        else if (strncasecmp(line, "icy-name:", 9) == 0) {
+            // Trim leading space
+            const char* name = line + 9;
+            while (*name == ' ') name++;
+            snprintf(conn->station_name, sizeof(conn->station_name), "%s", name);
+        }
+        else if (strncasecmp(line, "content-type:", 13) == 0) {
+            snprintf(conn->content_type, sizeof(conn->content_type), "%s", line + 13);
+        }
+        line = strtok_r(NULL, "\r\n", &save);
+    }
+
+    conn->bytes_until_meta = conn->icy_metaint;
+    conn->meta_len = 0;
+    conn->meta_pos = 0;
+    return 0;
+}
+
+static int open_stream(RadioConn* conn, const char* url) {
+    // Connect with redirect handling
+    char current_url[RADIO_CONN_MAX_URL];
+    char redirect_url[RADIO_CONN_MAX_URL];
+    snprintf(current_url, sizeof(current_url), "%s", url);
+
+    for (int redirect_count = 0; redirect_count <= RADIO_CONN_MAX_REDIRECTS; redirect_count++) {
+        if (connect_stream(conn, current_url) != 0) return -1;
+
+        int header_result = parse_headers(conn, redirect_url, sizeof(redirect_url));
+        if (header_result == 0) {
+            // Headers parsed, ready to stream
+            snprintf(conn->stream_url, sizeof(conn->stream_url), "%s", current_url);
+            conn->capture_id = RADIO_CAPTURE_OPEN(url);
+            return 0;
+        }
+
+        // Redirect or error - cleanup current connection
+        disconnect(conn);
+        if (header_result < 0) return -1;
+
+        if (redirect_url[0] == '\0') {
+            snprintf(conn->error, sizeof(conn->error), "Empty redirect URL");
+            return -1;
+        }
+        snprintf(current_url, sizeof(current_url), "%s", redirect_url);
+    }
+
+    snprintf(conn->error, sizeof(conn->error), "Too many redirects");
+    return -1;
+}
+
+int radio_conn_open(RadioConn* conn, const char* url) {
+    memset(conn, 0, offsetof(RadioConn, meta_buf));
+    conn->socket_fd = -1;
+
+    // The opening thread's account, for the handshake too
+    RadioNetAccount account = radio_net_account();
+    conn->account = account == RADIO_NET_ACCOUNT_OTHER ? RADIO_NET_ACCOUNT_STREAM : account;
+    radio_net_setAccount(conn->account);
+    int result = open_stream(conn, url);
+    radio_net_setAccount(account);
+    return result;
+}
+
+int radio_conn_wait(RadioConn* conn, int timeout_ms, int wake_fd) {
+    if (conn->socket_fd < 0) return -1;
+
+    // For SSL, check if there's pending data in the SSL buffer first
+    if (conn->use_ssl && mbedtls_ssl_get_bytes_avail(&conn->ssl) > 0) return 1;
+
+    fd_set read_fds;
+    FD_ZERO(&read_fds);
+    FD_SET(conn->socket_fd, &read_fds);
+    if (wake_fd >= 0) FD_SET(wake_fd, &read_fds);
+    int max_fd = wake_fd > conn->socket_fd ? wake_fd : conn->socket_fd;
+
+    struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+    int ret = select(max_fd + 1, &read_fds, NULL, NULL, &tv);
+    if (ret < 0) {
+        snprintf(conn->error, sizeof(conn->error), "Select error");
+        return -1;
+    }
+    return ret > 0 && FD_ISSET(conn->socket_fd, &read_fds) ? 1 : 0;
+}
+
+int radio_conn_pending(RadioConn* conn) {
+    if (conn->socket_fd < 0) return 0;
+    int pending = conn->use_ssl ? (int)mbedtls_ssl_get_bytes_avail(&conn->ssl) : 0;
+    int queued = 0;
+    if (ioctl(conn->socket_fd, FIONREAD, &queued) == 0) pending += queued;
+    return pending;
+}
+
+int radio_conn_setLowWater(RadioConn* conn, int bytes) {
+    if (conn->socket_fd < 0) return -1;
+    if (bytes < 1) bytes = 1;
+
+    // The kernel reports double the size set; only ever grown here
+    int rcvbuf = 0;
+    socklen_t len = sizeof(rcvbuf);
+    if (bytes > 1 && getsockopt(conn->socket_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &len) == 0 &&
+        rcvbuf / 2 < bytes * 2) {
+        int size = bytes * 2;
+        setsockopt(conn->socket_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+    return setsockopt(conn->socket_fd, SOL_SOCKET, SO_RCVLOWAT, &bytes, sizeof(bytes)) == 0 ? 0 : -1;
+}
+
+int radio_conn_recv(RadioConn* conn, void* buf, size_t len) {
+    int bytes_read = conn_recv(conn, buf, len);
+    if (bytes_read > 0) {
+        RADIO_CAPTURE_DATA(conn->capture_id, buf, bytes_read);
+        return bytes_read;
+    }
+
+    // For SSL, check if it's a non-fatal error
+    if (conn->use_ssl && (bytes_read == MBEDTLS_ERR_SSL_WANT_READ ||
+                          bytes_read == MBEDTLS_ERR_SSL_WANT_WRITE)) {
+        return 0;
+    }
+    // Non-blocking socket with nothing received yet
+    if (!conn->use_ssl && bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    snprintf(conn->error, sizeof(conn->error), "Stream ended");
+    return -1;
+}
+
+int radio_conn_setNonBlocking(RadioConn* conn, bool non_blocking) {
+    if (conn->socket_fd < 0) return -1;
+    if (conn->use_ssl) {
+        // mbedTLS turns EAGAIN into WANT_READ once the socket is non-blocking
+        return non_blocking ? mbedtls_net_set_nonblock(&conn->ssl_net) : mbedtls_net_set_block(&conn->ssl_net);
+    }
+    int flags = fcntl(conn->socket_fd, F_GETFL);
+    if (flags < 0) return -1;
+    flags = non_blocking ? flags | O_NONBLOCK : flags & ~O_NONBLOCK;
+    return fcntl(conn->socket_fd, F_SETFL, flags) < 0 ? -1 : 0;
+}
+
+void radio_conn_demux(RadioConn* conn, const uint8_t* data, int len,
+                      RadioConnAudioFunc on_audio, RadioConnMetaFunc on_meta, void* ctx) {
+    if (conn->icy_metaint <= 0) {
+        if (len > 0) on_audio(ctx, data, len);
+        return;
+    }
+
+    int i = 0;
+    while (i < len) {
+        if (conn->meta_len > 0) {
+            // Collect a metadata block, which can span receives
+            int n = conn->meta_len - conn->meta_pos;
+            if (n > len - i) n = len - i;
+            memcpy(conn->meta_buf + conn->meta_pos, data + i, n);
+            conn->meta_pos += n;
+            i += n;
+            if (conn->meta_pos == conn->meta_len) {
+                on_meta(ctx, conn->meta_buf, conn->meta_len);
+                conn->meta_len = 0;
+                conn->bytes_until_meta = conn->icy_metaint;
+            }
+        } else if (conn->bytes_until_meta == 0) {
+            // Read metadata length byte
+            conn->meta_len = data[i++] * 16;
+            conn->meta_pos = 0;
+            if (conn->meta_len == 0) conn->bytes_until_meta = conn->icy_metaint;
+        } else {
+            // Audio up to the next metadata block
+            int n = len - i;
+            if (n > conn->bytes_until_meta) n = conn->bytes_until_meta;
+            on_audio(ctx, data + i, n);
+            i += n;
+            conn->bytes_until_meta -= n;
+        }
+    }
+}
+
+bool radio_conn_parseTitle(const uint8_t* meta, int len, char* artist, int artist_size,
+                           char* title, int title_size) {
+    // Format: StreamTitle='Artist - Title';StreamUrl='...';
+    char buf[RADIO_CONN_ICY_META_MAX + 1];
+    if (len > RADIO_CONN_ICY_META_MAX) len = RADIO_CONN_ICY_META_MAX;
+    memcpy(buf, meta, len);
+    buf[len] = '\0';
+
+    char* title_start = strstr(buf, "StreamTitle='");
+    if (!title_start) return false;
+    title_start += 13;
+    char* title_end = strchr(title_start, '\'');
+    if (!title_end) return false;
+    *title_end = '\0';
+
+    // Try to parse "Artist - Title" format
+    char* separator = strstr(title_start, " - ");
+    if (separator) {
+        *separator = '\0';
+        snprintf(artist, artist_size, "%s", title_start);
+        snprintf(title, title_size, "%s", separator + 3);
+    } else {
+        artist[0] = '\0';
+        snprintf(title, title_size, "%s", title_start);
+    }
+    return true;
+}
+
+void radio_conn_close(RadioConn* conn) {
+    RADIO_CAPTURE_CLOSE(conn->capture_id, true, true, conn->content_type, conn->icy_metaint, conn->bitrate,
+                        conn->station_name);
+    conn->capture_id = 0;
+    disconnect(conn);
+}
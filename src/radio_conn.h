@@ -0,0 +1,88 @@
+#ifndef __RADIO_CONN_H__
+#define __RADIO_CONN_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+
+#include "radio_net.h"
+
+// Connection to a direct (Shoutcast/Icecast) stream over HTTP or HTTPS
+// Opening connects, sends the ICY request and reads the response headers,
+// following redirects. The received stream is then split into audio and ICY
+// metadata blocks by radio_conn_demux(), whose state lives in the connection, so
+// an open connection can be handed from one reader to another (see
+// radio_standby.h). The TLS context points into the struct: it must not move
+// while open.
+// A connection is used by one thread at a time. Its traffic is counted under
+// the account of the thread that opened it, RADIO_NET_ACCOUNT_STREAM for one
+// without (radio_net.h).
+
+#define RADIO_CONN_ICY_META_MAX (255 * 16)
+#define RADIO_CONN_MAX_URL 512
+
+typedef struct {
+    int socket_fd;
+    bool use_ssl;
+    bool ssl_initialized;
+    mbedtls_net_context ssl_net;
+    mbedtls_ssl_context ssl;        // Over the shared configuration (radio_net.h)
+
+    // From the response headers
+    int icy_metaint;            // Audio bytes between metadata blocks (0 = none)
+    int bitrate;                // icy-br, kbps
+    char station_name[256];     // icy-name
+    char content_type[64];
+    char stream_url[RADIO_CONN_MAX_URL];    // Where the redirects led
+
+    // Demux state
+    int bytes_until_meta;       // Audio bytes before the next metadata length byte
+    int meta_len;               // Size of the metadata block being read (0 = none)
+    int meta_pos;
+    uint8_t meta_buf[RADIO_CONN_ICY_META_MAX];
+
+    char error[128];            // Why open or receive failed
+    int capture_id;             // Recording of the stream (radio_capture.h), 0 = none
+    RadioNetAccount account;    // Traffic counted under
+} RadioConn;
+
+// Open a stream connection: 0 on success, -1 with conn->error set
+int radio_conn_open(RadioConn* conn, const char* url);
+
+// Wait up to timeout_ms for stream data: 1 = readable, 0 = timeout or wake_fd
+// readable (-1 = none), -1 = error
+int radio_conn_wait(RadioConn* conn, int timeout_ms, int wake_fd);
+
+// Bytes that can be received without waiting (decrypted and still queued)
+int radio_conn_pending(RadioConn* conn);
+
+// Low-wakeup receiving: the socket only turns readable once bytes are queued
+// (SO_RCVLOWAT; 1 = any byte, the default), with the kernel's receive buffer
+// grown to hold twice that. Returns 0 on success, -1 on error.
+int radio_conn_setLowWater(RadioConn* conn, int bytes);
+
+// Receive up to len bytes: the count, 0 to retry (TLS needs more, or nothing
+// received yet on a non-blocking connection), -1 = stream ended
+int radio_conn_recv(RadioConn* conn, void* buf, size_t len);
+
+// Switch an open connection's socket to non-blocking reads (for radio_reactor.h)
+// or back: 0 on success, -1 on error
+int radio_conn_setNonBlocking(RadioConn* conn, bool non_blocking);
+
+// Split received bytes into audio and complete ICY metadata blocks
+typedef void (*RadioConnAudioFunc)(void* ctx, const uint8_t* data, int len);
+typedef void (*RadioConnMetaFunc)(void* ctx, const uint8_t* meta, int len);
+void radio_conn_demux(RadioConn* conn, const uint8_t* data, int len,
+                      RadioConnAudioFunc on_audio, RadioConnMetaFunc on_meta, void* ctx);
+
+// StreamTitle of an ICY metadata block, split into artist and title when it reads
+// "Artist - Title" (artist "" otherwise). Returns false if there is none.
+bool radio_conn_parseTitle(const uint8_t* meta, int len, char* artist, int artist_size,
+                           char* title, int title_size);
+
+void radio_conn_close(RadioConn* conn);
+
+#endif
@@ -3,28 +3,269 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <fcntl.h>
 #include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 
 #include "defines.h"
 #include "api.h"
 #include "include/parson/parson.h"
-
-// Maximum limits
-#define MAX_CURATED_COUNTRIES 32
-#define MAX_CURATED_STATIONS 256
+#include "memstats.h"
+#include "radio_catalog.h"
+
+// Binary index of the JSON files, rebuilt when they change
+#define CURATED_INDEX_FILE SHARED_USERDATA_PATH "/curated_stations.idx"
+#define CURATED_MAGIC 0x31525543  // "CUR1"
+#define CURATED_VERSION 2         // 1 kept 256 stations per country
+#define GENRE_CACHE_SIZE 64       // Filter results of recent genres (a power of two)
+
+// File layout: header, country_count countries, station_count stations grouped
+// by country, then strings_size bytes of null-terminated strings (offset 0 is the
+// empty string, every string is stored once)
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t country_count;
+    uint32_t station_count;
+    uint32_t strings_size;
+    uint32_t file_count;        // JSON files it was built from
+    uint64_t stamp;             // Of their names, mtimes and sizes (see source_stamp)
+} CuratedHeader;
+
+// stations[first_station..first_station + station_count) are the country's:
+// the per-country offset table
+typedef struct {
+    uint32_t name;
+    uint32_t code;
+    uint32_t first_station;
+    uint32_t station_count;
+} CuratedIndexCountry;
+
+typedef struct {
+    uint32_t name;
+    uint32_t url;
+    uint32_t genre;
+    uint32_t slogan;
+} CuratedIndexStation;
+
+// The index in use: mapped from the file, or the malloc'd buffer just built when
+// it couldn't be saved
+static struct {
+    void* base;
+    size_t size;
+    bool mapped;
+    const CuratedIndexCountry* countries;
+    const CuratedIndexStation* stations;
+    uint32_t station_count;
+    const char* strings;
+    uint32_t strings_size;
+} index_map;
 
 // Module state
-static CuratedCountry curated_countries[MAX_CURATED_COUNTRIES];
+static CuratedCountry* curated_countries = NULL;
 static int curated_country_count = 0;
-
-static CuratedStation curated_stations[MAX_CURATED_STATIONS];
-static int curated_station_count = 0;
+static bool curated_loaded = false;
+
+// The browsing view: one country's stations matching a query, as positions in
+// index_map.stations. Rows become CuratedStations only when asked for (the ones
+// on screen).
+static struct {
+    char country[8];
+    char query[64];
+    uint32_t* rows;
+    int row_count;
+    int capacity;
+} view;
 
 // Stations directory path
 static char stations_path[512] = "";
 
-// Load stations from a JSON file for a specific country
-static int load_country_stations(const char* filepath) {
+// ============ INDEX FILE ============
+
+static const char* index_string(uint32_t offset) {
+    if (!index_map.strings || offset >= index_map.strings_size) return "";
+    return &index_map.strings[offset];
+}
+
+static void index_close(void) {
+    if (index_map.base) {
+        if (index_map.mapped) munmap(index_map.base, index_map.size);
+        else MEM_FREE(MEM_TAG_CURATED, index_map.base);
+    }
+    memset(&index_map, 0, sizeof(index_map));
+    MEM_FREE(MEM_TAG_CURATED, curated_countries);
+    curated_countries = NULL;
+    curated_country_count = 0;
+}
+
+// Use an index image, rejecting one that doesn't add up or was built from other files
+static bool index_adopt(void* base, size_t size, bool mapped, uint32_t file_count, uint64_t stamp) {
+    const CuratedHeader* hdr = base;
+    if (size < sizeof(CuratedHeader)) return false;
+    uint64_t expected = sizeof(CuratedHeader) + (uint64_t)hdr->country_count * sizeof(CuratedIndexCountry) +
+                        (uint64_t)hdr->station_count * sizeof(CuratedIndexStation) + hdr->strings_size;
+    if (hdr->magic != CURATED_MAGIC || hdr->version != CURATED_VERSION || expected != size ||
+        hdr->strings_size == 0 || hdr->file_count != file_count || hdr->stamp != stamp) {
+        return false;
+    }
+
+    const char* countries = (const char*)base + sizeof(CuratedHeader);
+    const char* stations = countries + hdr->country_count * sizeof(CuratedIndexCountry);
+    const char* strings = stations + hdr->station_count * sizeof(CuratedIndexStation);
+    if (strings[hdr->strings_size - 1] != '\0') return false;
+    const CuratedIndexCountry* c = (const CuratedIndexCountry*)countries;
+    for (uint32_t i = 0; i < hdr->country_count; i++) {
+        if ((uint64_t)c[i].first_station + c[i].station_count > hdr->station_count) return false;
+    }
+
+    CuratedCountry* list = MEM_MALLOC(MEM_TAG_CURATED, (hdr->country_count + 1) * sizeof(CuratedCountry));
+    if (!list) return false;
+
+    index_map.base = base;
+    index_map.size = size;
+    index_map.mapped = mapped;
+    index_map.countries = c;
+    index_map.stations = (const CuratedIndexStation*)stations;
+    index_map.station_count = hdr->station_count;
+    index_map.strings = strings;
+    index_map.strings_size = hdr->strings_size;
+
+    // Countries are few and shown at once: materialize them now
+    curated_countries = list;
+    curated_country_count = 0;
+    for (uint32_t i = 0; i < hdr->country_count; i++) {
+        CuratedCountry* country = &curated_countries[curated_country_count++];
+        snprintf(country->name, sizeof(country->name), "%s", index_string(c[i].name));
+        snprintf(country->code, sizeof(country->code), "%s", index_string(c[i].code));
+    }
+    return true;
+}
+
+static bool index_map_file(uint32_t file_count, uint64_t stamp) {
+    int fd = open(CURATED_INDEX_FILE, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CuratedHeader)) {
+        close(fd);
+        return false;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return false;
+
+    if (!index_adopt(base, st.st_size, true, file_count, stamp)) {
+        munmap(base, st.st_size);
+        return false;
+    }
+    return true;
+}
+
+// ============ BUILDING ============
+
+typedef struct {
+    uint32_t name;
+    uint32_t url;
+    uint32_t genre;
+    uint32_t slogan;
+    int country;
+} BuildStation;
+
+typedef struct {
+    BuildStation* stations;
+    uint32_t station_count;
+    uint32_t station_capacity;
+    CuratedIndexCountry* countries;
+    uint32_t country_count;
+    uint32_t country_capacity;
+    char* strings;
+    uint32_t strings_size;
+    uint32_t strings_capacity;
+    uint32_t* slots;            // Intern hash table: string offset + 1, 0 = empty
+    uint32_t slot_count;        // Power of two
+    uint32_t slot_used;
+} CuratedBuilder;
+
+static uint32_t string_hash(const char* s) {
+    uint32_t hash = 5381;
+    while (*s) hash = ((hash << 5) + hash) + (uint8_t)*s++;
+    return hash;
+}
+
+static bool builder_init(CuratedBuilder* b) {
+    memset(b, 0, sizeof(*b));
+    b->strings_capacity = 16 * 1024;
+    b->strings = MEM_MALLOC(MEM_TAG_CURATED, b->strings_capacity);
+    b->slot_count = 1024;
+    b->slots = MEM_CALLOC(MEM_TAG_CURATED, b->slot_count, sizeof(uint32_t));
+    if (!b->strings || !b->slots) {
+        MEM_FREE(MEM_TAG_CURATED, b->strings);
+        MEM_FREE(MEM_TAG_CURATED, b->slots);
+        return false;
+    }
+    b->strings[0] = '\0';
+    b->strings_size = 1;
+    return true;
+}
+
+static void builder_free(CuratedBuilder* b) {
+    MEM_FREE(MEM_TAG_CURATED, b->stations);
+    MEM_FREE(MEM_TAG_CURATED, b->countries);
+    MEM_FREE(MEM_TAG_CURATED, b->strings);
+    MEM_FREE(MEM_TAG_CURATED, b->slots);
+    memset(b, 0, sizeof(*b));
+}
+
+static bool builder_grow_slots(CuratedBuilder* b) {
+    uint32_t count = b->slot_count * 2;
+    uint32_t* slots = MEM_CALLOC(MEM_TAG_CURATED, count, sizeof(uint32_t));
+    if (!slots) return false;
+    for (uint32_t i = 0; i < b->slot_count; i++) {
+        if (!b->slots[i]) continue;
+        uint32_t j = string_hash(&b->strings[b->slots[i] - 1]) & (count - 1);
+        while (slots[j]) j = (j + 1) & (count - 1);
+        slots[j] = b->slots[i];
+    }
+    MEM_FREE(MEM_TAG_CURATED, b->slots);
+    b->slots = slots;
+    b->slot_count = count;
+    return true;
+}
+
+// Offset of s in the string table, adding it the first time (0 on failure or "")
+static uint32_t builder_intern(CuratedBuilder* b, const char* s) {
+    if (!s || !s[0]) return 0;
+    if (b->slot_used * 2 >= b->slot_count && !builder_grow_slots(b)) return 0;
+
+    uint32_t mask = b->slot_count - 1;
+    uint32_t i = string_hash(s) & mask;
+    while (b->slots[i]) {
+        if (strcmp(&b->strings[b->slots[i] - 1], s) == 0) return b->slots[i] - 1;
+        i = (i + 1) & mask;
+    }
+
+    uint32_t len = strlen(s) + 1;
+    if (b->strings_size + len > b->strings_capacity) {
+        uint32_t capacity = b->strings_capacity * 2;
+        while (capacity < b->strings_size + len) capacity *= 2;
+        char* strings = MEM_REALLOC(MEM_TAG_CURATED, b->strings, capacity);
+        if (!strings) return 0;
+        b->strings = strings;
+        b->strings_capacity = capacity;
+    }
+    uint32_t offset = b->strings_size;
+    memcpy(&b->strings[offset], s, len);
+    b->strings_size += len;
+    b->slots[i] = offset + 1;
+    b->slot_used++;
+    return offset;
+}
+
+// Add the country and stations of one JSON file
+static int builder_add_file(CuratedBuilder* b, const char* filepath) {
     JSON_Value* root = json_parse_file(filepath);
     if (!root) {
         LOG_error("Failed to parse JSON: %s\n", filepath);
@@ -32,81 +273,207 @@ static int load_country_stations(const char* filepath) {
     }
 
     JSON_Object* obj = json_value_get_object(root);
-    if (!obj) {
-        json_value_free(root);
-        return -1;
-    }
-
-    const char* country_name = json_object_get_string(obj, "country");
-    const char* country_code = json_object_get_string(obj, "code");
-
+    const char* country_name = obj ? json_object_get_string(obj, "country") : NULL;
+    const char* country_code = obj ? json_object_get_string(obj, "code") : NULL;
     if (!country_name || !country_code) {
         json_value_free(root);
         return -1;
     }
 
-    // Add country to list if not already present
-    bool country_exists = false;
-    for (int i = 0; i < curated_country_count; i++) {
-        if (strcmp(curated_countries[i].code, country_code) == 0) {
-            country_exists = true;
+    // Countries can span files
+    int country = -1;
+    uint32_t code = builder_intern(b, country_code);
+    for (uint32_t i = 0; i < b->country_count; i++) {
+        if (b->countries[i].code == code) {
+            country = i;
             break;
         }
     }
-
-    if (!country_exists && curated_country_count < MAX_CURATED_COUNTRIES) {
-        strncpy(curated_countries[curated_country_count].name, country_name, 63);
-        curated_countries[curated_country_count].name[63] = '\0';
-        strncpy(curated_countries[curated_country_count].code, country_code, 7);
-        curated_countries[curated_country_count].code[7] = '\0';
-        curated_country_count++;
+    if (country < 0) {
+        if (b->country_count == b->country_capacity) {
+            uint32_t capacity = b->country_capacity ? b->country_capacity * 2 : 32;
+            CuratedIndexCountry* countries = MEM_REALLOC(MEM_TAG_CURATED, b->countries, capacity * sizeof(CuratedIndexCountry));
+            if (!countries) {
+                json_value_free(root);
+                return -1;
+            }
+            b->countries = countries;
+            b->country_capacity = capacity;
+        }
+        country = b->country_count++;
+        b->countries[country] = (CuratedIndexCountry){builder_intern(b, country_name), code, 0, 0};
     }
 
-    // Load stations
     JSON_Array* stations_arr = json_object_get_array(obj, "stations");
-    if (stations_arr) {
-        int count = json_array_get_count(stations_arr);
-        for (int i = 0; i < count && curated_station_count < MAX_CURATED_STATIONS; i++) {
-            JSON_Object* station = json_array_get_object(stations_arr, i);
-            if (!station) continue;
-
-            const char* name = json_object_get_string(station, "name");
-            const char* url = json_object_get_string(station, "url");
-            const char* genre = json_object_get_string(station, "genre");
-            const char* slogan = json_object_get_string(station, "slogan");
-
-            if (name && url) {
-                strncpy(curated_stations[curated_station_count].name, name, RADIO_MAX_NAME - 1);
-                curated_stations[curated_station_count].name[RADIO_MAX_NAME - 1] = '\0';
-                strncpy(curated_stations[curated_station_count].url, url, RADIO_MAX_URL - 1);
-                curated_stations[curated_station_count].url[RADIO_MAX_URL - 1] = '\0';
-                strncpy(curated_stations[curated_station_count].genre, genre ? genre : "", 63);
-                curated_stations[curated_station_count].genre[63] = '\0';
-                strncpy(curated_stations[curated_station_count].slogan, slogan ? slogan : "", 127);
-                curated_stations[curated_station_count].slogan[127] = '\0';
-                strncpy(curated_stations[curated_station_count].country_code, country_code, 7);
-                curated_stations[curated_station_count].country_code[7] = '\0';
-                curated_station_count++;
-            }
+    int count = stations_arr ? json_array_get_count(stations_arr) : 0;
+    for (int i = 0; i < count; i++) {
+        JSON_Object* station = json_array_get_object(stations_arr, i);
+        if (!station) continue;
+        const char* name = json_object_get_string(station, "name");
+        const char* url = json_object_get_string(station, "url");
+        if (!name || !url) continue;
+
+        if (b->station_count == b->station_capacity) {
+            uint32_t capacity = b->station_capacity ? b->station_capacity * 2 : 256;
+            BuildStation* stations = MEM_REALLOC(MEM_TAG_CURATED, b->stations, capacity * sizeof(BuildStation));
+            if (!stations) break;
+            b->stations = stations;
+            b->station_capacity = capacity;
         }
+        BuildStation* s = &b->stations[b->station_count++];
+        s->name = builder_intern(b, name);
+        s->url = builder_intern(b, url);
+        s->genre = builder_intern(b, json_object_get_string(station, "genre"));
+        s->slogan = builder_intern(b, json_object_get_string(station, "slogan"));
+        s->country = country;
+        b->countries[country].station_count++;
     }
 
     json_value_free(root);
     return 0;
 }
 
-// Scan stations directory and load all JSON files
+// Lay the index out in one buffer, stations grouped by country in file order
+static void* builder_finish(CuratedBuilder* b, uint32_t file_count, uint64_t stamp, size_t* size) {
+    *size = sizeof(CuratedHeader) + b->country_count * sizeof(CuratedIndexCountry) +
+            b->station_count * sizeof(CuratedIndexStation) + b->strings_size;
+    char* buf = MEM_MALLOC(MEM_TAG_CURATED, *size);
+    if (!buf) return NULL;
+
+    CuratedHeader* hdr = (CuratedHeader*)buf;
+    hdr->magic = CURATED_MAGIC;
+    hdr->version = CURATED_VERSION;
+    hdr->country_count = b->country_count;
+    hdr->station_count = b->station_count;
+    hdr->strings_size = b->strings_size;
+    hdr->file_count = file_count;
+    hdr->stamp = stamp;
+
+    CuratedIndexCountry* countries = (CuratedIndexCountry*)(buf + sizeof(CuratedHeader));
+    CuratedIndexStation* stations = (CuratedIndexStation*)(countries + b->country_count);
+    uint32_t next = 0;
+    for (uint32_t c = 0; c < b->country_count; c++) {
+        countries[c] = b->countries[c];
+        countries[c].first_station = next;
+        next += countries[c].station_count;
+        countries[c].station_count = 0;   // Counted again as they are placed
+    }
+    for (uint32_t i = 0; i < b->station_count; i++) {
+        const BuildStation* s = &b->stations[i];
+        CuratedIndexCountry* c = &countries[s->country];
+        stations[c->first_station + c->station_count++] = (CuratedIndexStation){s->name, s->url, s->genre, s->slogan};
+    }
+    memcpy(stations + b->station_count, b->strings, b->strings_size);
+    return buf;
+}
+
+static bool is_json(const char* name) {
+    const char* ext = strrchr(name, '.');
+    return ext && strcasecmp(ext, ".json") == 0;
+}
+
+// Order-independent hash of the JSON files' names, mtimes and sizes
+static uint64_t source_stamp(const char* path, uint32_t* file_count) {
+    uint64_t stamp = 0;
+    *file_count = 0;
+    DIR* dir = opendir(path);
+    if (!dir) return 0;
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (!is_json(ent->d_name)) continue;
+        char filepath[768];
+        snprintf(filepath, sizeof(filepath), "%s/%s", path, ent->d_name);
+        struct stat st;
+        if (stat(filepath, &st) != 0) continue;
+
+        uint64_t hash = string_hash(ent->d_name);
+        hash = hash * 1000003 ^ (uint64_t)st.st_mtime;
+        hash = hash * 1000003 ^ (uint64_t)st.st_size;
+        stamp += hash * 0x9E3779B97F4A7C15ULL;
+        (*file_count)++;
+    }
+    closedir(dir);
+    return stamp;
+}
+
+// Parse every JSON file of path into a new index image
+static void* build_image(const char* path, uint32_t file_count, uint64_t stamp, size_t* size) {
+    CuratedBuilder b;
+    if (!builder_init(&b)) return NULL;
+
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* ent;
+        while ((ent = readdir(dir)) != NULL) {
+            if (!is_json(ent->d_name)) continue;
+            char filepath[768];
+            snprintf(filepath, sizeof(filepath), "%s/%s", path, ent->d_name);
+            builder_add_file(&b, filepath);
+        }
+        closedir(dir);
+    }
+
+    void* buf = builder_finish(&b, file_count, stamp, size);
+    builder_free(&b);
+    return buf;
+}
+
+// Written aside (tmp_suffix: each builder its own) and renamed, so a crash
+// never leaves a torn index
+static bool save_image(const void* buf, size_t size, const char* tmp_suffix) {
+    char tmp_path[512];
+    snprintf(tmp_path, sizeof(tmp_path), "%s%s", CURATED_INDEX_FILE, tmp_suffix);
+    FILE* f = fopen(tmp_path, "wb");
+    bool saved = f && fwrite(buf, 1, size, f) == size;
+    if (f && fclose(f) != 0) saved = false;
+    if (!saved || rename(tmp_path, CURATED_INDEX_FILE) != 0) {
+        LOG_error("Failed to save curated station index\n");
+        unlink(tmp_path);
+        return false;
+    }
+    return true;
+}
+
+// Build a new index from the JSON files, save it and use it
+static void build_index(uint32_t file_count, uint64_t stamp) {
+    size_t size;
+    void* buf = build_image(stations_path, file_count, stamp, &size);
+    if (!buf) return;
+    save_image(buf, size, ".tmp");
+    if (!index_adopt(buf, size, false, file_count, stamp)) MEM_FREE(MEM_TAG_CURATED, buf);
+}
+
+int radio_curated_rebuild(const char* path) {
+    uint32_t file_count;
+    uint64_t stamp = source_stamp(path, &file_count);
+    size_t size;
+    void* buf = build_image(path, file_count, stamp, &size);
+    if (!buf) return -1;
+    bool saved = save_image(buf, size, ".sync.tmp");
+    MEM_FREE(MEM_TAG_CURATED, buf);
+    return saved ? 0 : -1;
+}
+
+// ============ LOADING ============
+
+// Find the stations directory and open its index, rebuilding it if the JSON
+// files changed
 static void load_curated_stations(void) {
     curated_country_count = 0;
-    curated_station_count = 0;
 
-    // Build stations path - look in pak folder first, then current directory
+    // Build stations path - a synced catalog first, then the pak folder, then
+    // the current directory
     const char* search_paths[] = {
         "%s/.system/tg5040/paks/Emus/Music Player.pak/stations",
         "./stations"
     };
 
     bool found = false;
+    if (access(CATALOG_STATE, F_OK) == 0) {
+        snprintf(stations_path, sizeof(stations_path), "%s", CATALOG_DIR);
+        found = true;
+    }
     for (int i = 0; i < 2 && !found; i++) {
         if (i == 0) {
             snprintf(stations_path, sizeof(stations_path), search_paths[0], SDCARD_PATH);
@@ -125,64 +492,142 @@ static void load_curated_stations(void) {
         return;
     }
 
-    DIR* dir = opendir(stations_path);
-    if (!dir) return;
+    uint32_t file_count;
+    uint64_t stamp = source_stamp(stations_path, &file_count);
+    if (!index_map_file(file_count, stamp)) build_index(file_count, stamp);
+}
 
-    struct dirent* ent;
-    while ((ent = readdir(dir)) != NULL) {
-        // Skip non-JSON files
-        const char* ext = strrchr(ent->d_name, '.');
-        if (!ext || strcasecmp(ext, ".json") != 0) continue;
+static void view_close(void) {
+    MEM_FREE(MEM_TAG_CURATED, view.rows);
+    memset(&view, 0, sizeof(view));
+}
 
-        char filepath[768];
-        snprintf(filepath, sizeof(filepath), "%s/%s", stations_path, ent->d_name);
-        load_country_stations(filepath);
+static const CuratedIndexCountry* find_country(const char* country_code) {
+    for (int i = 0; i < curated_country_count; i++) {
+        if (strcmp(curated_countries[i].code, country_code) == 0) return &index_map.countries[i];
     }
+    return NULL;
+}
 
-    closedir(dir);
+// The index is opened (or rebuilt) on first use, not at startup
+static void ensure_loaded(void) {
+    if (curated_loaded) return;
+    curated_loaded = true;
+    load_curated_stations();
 }
 
 void radio_curated_init(void) {
-    load_curated_stations();
+    curated_loaded = false;
 }
 
 void radio_curated_cleanup(void) {
-    curated_country_count = 0;
-    curated_station_count = 0;
+    view_close();
+    index_close();
     stations_path[0] = '\0';
+    curated_loaded = false;
 }
 
 int radio_curated_get_country_count(void) {
+    ensure_loaded();
     return curated_country_count;
 }
 
 const CuratedCountry* radio_curated_get_countries(void) {
+    ensure_loaded();
     return curated_countries;
 }
 
 int radio_curated_get_station_count(const char* country_code) {
-    int count = 0;
-    for (int i = 0; i < curated_station_count; i++) {
-        if (strcmp(curated_stations[i].country_code, country_code) == 0) {
-            count++;
-        }
+    ensure_loaded();
+    const CuratedIndexCountry* country = find_country(country_code);
+    return country ? (int)country->station_count : 0;
+}
+
+// Whether a station's name or genre contains query (case-insensitive). Genres
+// are interned and shared by many stations: each is matched once per pass.
+static bool station_matches(const CuratedIndexStation* s, const char* query,
+                            uint32_t genre_cache[GENRE_CACHE_SIZE], bool genre_match[GENRE_CACHE_SIZE]) {
+    if (strcasestr(index_string(s->name), query)) return true;
+    if (s->genre == 0) return false;
+    uint32_t slot = s->genre & (GENRE_CACHE_SIZE - 1);
+    if (genre_cache[slot] != s->genre) {
+        genre_cache[slot] = s->genre;
+        genre_match[slot] = strcasestr(index_string(s->genre), query) != NULL;
     }
-    return count;
+    return genre_match[slot];
 }
 
-const CuratedStation* radio_curated_get_stations(const char* country_code, int* count) {
-    // Find the first station for this country and count total
-    const CuratedStation* first = NULL;
-    *count = 0;
+int radio_curated_open_view(const char* country_code, const char* query) {
+    ensure_loaded();
+    if (!query) query = "";
+    const CuratedIndexCountry* country = find_country(country_code);
+    if (!country) {
+        view_close();
+        return 0;
+    }
+
+    bool same_country = view.rows && strcmp(view.country, country_code) == 0;
+    if (same_country && strcmp(view.query, query) == 0) return view.row_count;
+
+    // A query extending the last one (typing on) only narrows the rows it matched
+    bool narrow = same_country && strncmp(query, view.query, strlen(view.query)) == 0;
+    if (!same_country) {
+        view_close();
+        view.rows = MEM_MALLOC(MEM_TAG_CURATED, (country->station_count + 1) * sizeof(uint32_t));
+        if (!view.rows) return 0;
+        view.capacity = country->station_count;
+        snprintf(view.country, sizeof(view.country), "%s", country_code);
+    }
 
-    for (int i = 0; i < curated_station_count; i++) {
-        if (strcmp(curated_stations[i].country_code, country_code) == 0) {
-            if (!first) {
-                first = &curated_stations[i];
+    uint32_t genre_cache[GENRE_CACHE_SIZE] = {0};
+    bool genre_match[GENRE_CACHE_SIZE];
+    int count = 0;
+    if (narrow) {
+        for (int i = 0; i < view.row_count; i++) {
+            if (station_matches(&index_map.stations[view.rows[i]], query, genre_cache, genre_match)) {
+                view.rows[count++] = view.rows[i];
+            }
+        }
+    } else {
+        for (uint32_t i = 0; i < country->station_count; i++) {
+            uint32_t station = country->first_station + i;
+            if (!query[0] || station_matches(&index_map.stations[station], query, genre_cache, genre_match)) {
+                view.rows[count++] = station;
             }
-            (*count)++;
         }
     }
+    view.row_count = count;
+    snprintf(view.query, sizeof(view.query), "%s", query);
+    return view.row_count;
+}
+
+
+bool radio_curated_view_row(int row, CuratedStation* out) {
+    if (row < 0 || row >= view.row_count) return false;
+    const CuratedIndexStation* s = &index_map.stations[view.rows[row]];
+    out->name = index_string(s->name);
+    out->url = index_string(s->url);
+    out->genre = index_string(s->genre);
+    out->slogan = index_string(s->slogan);
+    out->country_code = view.country;
+    return true;
+}
+
+int radio_curated_view_station(int row) {
+    if (row < 0 || row >= view.row_count) return -1;
+    const CuratedIndexCountry* country = find_country(view.country);
+    return country ? (int)(view.rows[row] - country->first_station) : -1;
+}
 
-    return first;
+bool radio_curated_get_station(const char* country_code, int index, CuratedStation* out) {
+    ensure_loaded();
+    const CuratedIndexCountry* country = find_country(country_code);
+    if (!country || index < 0 || (uint32_t)index >= country->station_count) return false;
+    const CuratedIndexStation* s = &index_map.stations[country->first_station + index];
+    out->name = index_string(s->name);
+    out->url = index_string(s->url);
+    out->genre = index_string(s->genre);
+    out->slogan = index_string(s->slogan);
+    out->country_code = index_string(country->code);
+    return true;
 }
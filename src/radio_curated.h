@@ -3,12 +3,24 @@
 
 #include "radio.h"  // For CuratedCountry, CuratedStation types
 
-// Initialize curated stations (load from JSON files)
+// Curated stations come from the JSON files in stations/, through a binary index
+// (countries, stations and interned strings) in the shared userdata directory
+// that is rebuilt when the files change and mapped otherwise. Countries are read
+// the first time any of them is asked for. Stations are browsed through a view:
+// one country's stations, optionally filtered, of which only the rows asked for
+// are turned into CuratedStations, so catalogs can be large. The strings stay
+// in the index (valid until radio_curated_cleanup).
+
+// Initialize curated stations (the index is mapped, or rebuilt from JSON, on first use)
 void radio_curated_init(void);
 
 // Cleanup curated stations
 void radio_curated_cleanup(void);
 
+// Build the index of the JSON files in path and save it, for the next
+// radio_curated_init to map (any thread; see radio_catalog.h). 0 on success.
+int radio_curated_rebuild(const char* path);
+
 // Get number of available countries
 int radio_curated_get_country_count(void);
 
@@ -18,8 +30,18 @@ const CuratedCountry* radio_curated_get_countries(void);
 // Get number of stations for a specific country
 int radio_curated_get_station_count(const char* country_code);
 
-// Get stations for a specific country
-// Returns pointer to first station and sets count
-const CuratedStation* radio_curated_get_stations(const char* country_code, int* count);
+// Station index (0..count) of a country
+bool radio_curated_get_station(const char* country_code, int index, CuratedStation* out);
+
+// Make a country's stations whose name or genre contains query (case-insensitive,
+// "" = all) the view; returns its row count. A query that extends the previous
+// one filters only the rows that one matched.
+int radio_curated_open_view(const char* country_code, const char* query);
+
+// Row of the view; false past its end
+bool radio_curated_view_row(int row, CuratedStation* out);
+
+// Station index within its country of a row (-1 past the end)
+int radio_curated_view_station(int row);
 
 #endif
@@ -1,17 +1,26 @@
 #define _GNU_SOURCE
 #include "radio_hls.h"
 #include "radio_net.h"
+#include "log_async.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "defines.h"
+#include "api.h"
 
 // MPEG-TS constants
-#define TS_PACKET_SIZE 188
 #define TS_SYNC_BYTE 0x47
 #define TS_PAT_PID 0x0000
 
+#define HLS_PLAYLIST_MAX (1024 * 1024)  // Long live windows run past 64 KB
+
+// Adaptive bitrate policy
+#define HLS_ABR_FIT 0.8f            // Share of the throughput a rendition may take
+#define HLS_ABR_UP_FIT 0.6f         // Share the next rendition up may take to step up
+#define HLS_ABR_UP_HOLD 3           // Segments on a rendition before stepping up
+
 // Check if URL is an HLS stream
 bool radio_hls_is_url(const char* url) {
     const char* ext = strrchr(url, '.');
@@ -71,23 +80,11 @@ void radio_hls_resolve_url(const char* base, const char* relative, char* result,
     }
 }
 
-// Parse M3U8 playlist content
-int radio_hls_parse_playlist(HLSContext* ctx, const char* content, const char* base_url) {
-    ctx->segment_count = 0;
-    ctx->is_live = true;  // Assume live until we see ENDLIST
-    ctx->target_duration = 10.0f;
-    ctx->media_sequence = 0;
-
-    strncpy(ctx->base_url, base_url, HLS_MAX_URL_LEN - 1);
-
-    const char* line = content;
-    float segment_duration = 0;
-    char segment_title[256] = "";
-    char segment_artist[256] = "";
-    char variant_url[HLS_MAX_URL_LEN] = "";
-    bool is_master_playlist = false;
-
-    while (*line && ctx->segment_count < HLS_MAX_SEGMENTS) {
+// Copy the next non-empty line into buf (leading blanks skipped, cut to size)
+// Returns false at the end of the content.
+static bool next_line(const char** pos, char* buf, int size) {
+    const char* line = *pos;
+    while (*line) {
         // Skip whitespace
         while (*line == ' ' || *line == '\t') line++;
 
@@ -96,119 +93,386 @@ int radio_hls_parse_playlist(HLSContext* ctx, const char* content, const char* b
         while (*eol && *eol != '\n' && *eol != '\r') eol++;
         int line_len = eol - line;
 
+        // Move to next line
+        const char* next = eol;
+        while (*next == '\n' || *next == '\r') next++;
+
         if (line_len > 0) {
-            char line_buf[HLS_MAX_URL_LEN];
-            if (line_len >= HLS_MAX_URL_LEN) line_len = HLS_MAX_URL_LEN - 1;
-            strncpy(line_buf, line, line_len);
-            line_buf[line_len] = '\0';
-
-            if (strncmp(line_buf, "#EXTM3U", 7) == 0) {
-                // Valid M3U8 header
-            } else if (strncmp(line_buf, "#EXT-X-STREAM-INF:", 18) == 0) {
-                // Master playlist - we need to fetch the variant
-                is_master_playlist = true;
-            } else if (strncmp(line_buf, "#EXT-X-TARGETDURATION:", 22) == 0) {
-                ctx->target_duration = atof(line_buf + 22);
-            } else if (strncmp(line_buf, "#EXT-X-MEDIA-SEQUENCE:", 22) == 0) {
-                ctx->media_sequence = atoi(line_buf + 22);
-            } else if (strncmp(line_buf, "#EXTINF:", 8) == 0) {
-                // Segment duration and optional metadata
-                segment_duration = atof(line_buf + 8);
-                segment_title[0] = '\0';
-                segment_artist[0] = '\0';
-
-                // Parse title="..."
-                char* title_start = strstr(line_buf, "title=\"");
-                if (title_start) {
-                    title_start += 7;
-                    char* title_end = strchr(title_start, '"');
-                    if (title_end) {
-                        int len = title_end - title_start;
-                        if (len > 255) len = 255;
-                        strncpy(segment_title, title_start, len);
-                        segment_title[len] = '\0';
-                    }
+            if (line_len >= size) line_len = size - 1;
+            memcpy(buf, line, line_len);
+            buf[line_len] = '\0';
+            *pos = next;
+            return true;
+        }
+        line = next;
+    }
+    *pos = line;
+    return false;
+}
+
+static bool is_master_playlist(const char* content) {
+    return strstr(content, "#EXT-X-STREAM-INF:") != NULL;
+}
+
+// BANDWIDTH of an EXT-X-STREAM-INF attribute list (not AVERAGE-BANDWIDTH)
+static int stream_inf_bandwidth(const char* attrs) {
+    const char* p = attrs;
+    while ((p = strstr(p, "BANDWIDTH=")) != NULL) {
+        if (p == attrs || p[-1] == ',') return atoi(p + 10);
+        p += 10;
+    }
+    return 0;
+}
+
+// Collect the renditions of a master playlist
+static void parse_master(HLSContext* ctx, const char* content, const char* base_url) {
+    ctx->variant_count = 0;
+    ctx->current_variant = 0;
+    ctx->segments_since_switch = 0;
+
+    const char* line = content;
+    char line_buf[HLS_MAX_URL_LEN];
+    int bandwidth = -1;     // Of the EXT-X-STREAM-INF waiting for its URI (-1 = none)
+    while (ctx->variant_count < HLS_MAX_VARIANTS && next_line(&line, line_buf, sizeof(line_buf))) {
+        if (strncmp(line_buf, "#EXT-X-STREAM-INF:", 18) == 0) {
+            bandwidth = stream_inf_bandwidth(line_buf + 18);
+        } else if (line_buf[0] != '#' && bandwidth >= 0) {
+            HLSVariant* v = &ctx->variants[ctx->variant_count++];
+            radio_hls_resolve_url(base_url, line_buf, v->url, HLS_MAX_URL_LEN);
+            v->bandwidth = bandwidth;
+            bandwidth = -1;
+        }
+    }
+}
+
+static uint64_t hls_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Empty the string pool; offset 0 always holds ""
+static void pool_reset(HLSContext* ctx) {
+    ctx->strings[0] = '\0';
+    ctx->strings_len = 1;
+}
+
+static uint16_t pool_add(HLSContext* ctx, const char* str, int len) {
+    if (len == 0) return 0;
+    uint16_t offset = (uint16_t)ctx->strings_len;
+    memcpy(ctx->strings + offset, str, len);
+    ctx->strings[offset + len] = '\0';
+    ctx->strings_len += len + 1;
+    return offset;
+}
+
+// Append a segment; false when the segment table or the string pool is full
+static bool add_segment(HLSContext* ctx, const char* uri, float duration,
+                        const char* title, const char* artist) {
+    int uri_len = strlen(uri), title_len = strlen(title), artist_len = strlen(artist);
+    if (ctx->segment_count >= HLS_MAX_SEGMENTS ||
+        ctx->strings_len + uri_len + title_len + artist_len + 3 > HLS_STRING_POOL_SIZE) {
+        return false;
+    }
+    HLSSegment* seg = &ctx->segments[ctx->segment_count++];
+    seg->duration = duration;
+    seg->uri = pool_add(ctx, uri, uri_len);
+    seg->title = pool_add(ctx, title, title_len);
+    seg->artist = pool_add(ctx, artist, artist_len);
+    return true;
+}
+
+// Forget the first count segments (played ones); media_sequence and
+// current_segment move with them
+static void drop_segments(HLSContext* ctx, int count) {
+    if (count <= 0) return;
+    if (count >= ctx->segment_count) {
+        ctx->media_sequence += ctx->segment_count;
+        ctx->current_segment -= ctx->segment_count;
+        ctx->segment_count = 0;
+        pool_reset(ctx);
+    } else {
+        // Strings are pooled in segment order: the kept ones start at the first
+        // kept segment's URI
+        int start = ctx->segments[count].uri;
+        int shift = start - 1;
+        memmove(ctx->strings + 1, ctx->strings + start, ctx->strings_len - start);
+        ctx->strings_len -= shift;
+
+        ctx->segment_count -= count;
+        memmove(ctx->segments, ctx->segments + count, ctx->segment_count * sizeof(HLSSegment));
+        for (int i = 0; i < ctx->segment_count; i++) {
+            HLSSegment* seg = &ctx->segments[i];
+            seg->uri -= shift;
+            if (seg->title) seg->title -= shift;
+            if (seg->artist) seg->artist -= shift;
+        }
+        ctx->media_sequence += count;
+        ctx->current_segment -= count;
+    }
+    if (ctx->current_segment < 0) ctx->current_segment = 0;
+}
+
+// Parse a media playlist: replacing the segments, or with merge, appending only
+// those after the ones already known
+// Returns the number of segments added.
+static int parse_media(HLSContext* ctx, const char* content, const char* base_url, bool merge) {
+    if (!merge) {
+        ctx->segment_count = 0;
+        ctx->media_sequence = 0;
+        pool_reset(ctx);
+    }
+    ctx->is_live = true;  // Assume live until we see ENDLIST
+    ctx->target_duration = 10.0f;
+
+    if (ctx->base_url != base_url) strncpy(ctx->base_url, base_url, HLS_MAX_URL_LEN - 1);
+
+    const char* line = content;
+    char line_buf[HLS_MAX_URL_LEN];
+    float segment_duration = 0;
+    char segment_title[256] = "";
+    char segment_artist[256] = "";
+    int media_sequence = 0;
+    int index = 0;          // Of the segment in this playlist
+    int added = 0;
+
+    while (next_line(&line, line_buf, sizeof(line_buf))) {
+        if (strncmp(line_buf, "#EXTM3U", 7) == 0) {
+            // Valid M3U8 header
+        } else if (strncmp(line_buf, "#EXT-X-TARGETDURATION:", 22) == 0) {
+            ctx->target_duration = atof(line_buf + 22);
+        } else if (strncmp(line_buf, "#EXT-X-MEDIA-SEQUENCE:", 22) == 0) {
+            media_sequence = atoi(line_buf + 22);
+        } else if (strncmp(line_buf, "#EXTINF:", 8) == 0) {
+            // Segment duration and optional metadata
+            segment_duration = atof(line_buf + 8);
+            segment_title[0] = '\0';
+            segment_artist[0] = '\0';
+
+            // Parse title="..."
+            char* title_start = strstr(line_buf, "title=\"");
+            if (title_start) {
+                title_start += 7;
+                char* title_end = strchr(title_start, '"');
+                if (title_end) {
+                    int len = title_end - title_start;
+                    if (len > 255) len = 255;
+                    strncpy(segment_title, title_start, len);
+                    segment_title[len] = '\0';
                 }
+            }
 
-                // Parse artist="..."
-                char* artist_start = strstr(line_buf, "artist=\"");
-                if (artist_start) {
-                    artist_start += 8;
-                    char* artist_end = strchr(artist_start, '"');
-                    if (artist_end) {
-                        int len = artist_end - artist_start;
-                        if (len > 255) len = 255;
-                        strncpy(segment_artist, artist_start, len);
-                        segment_artist[len] = '\0';
-                    }
+            // Parse artist="..."
+            char* artist_start = strstr(line_buf, "artist=\"");
+            if (artist_start) {
+                artist_start += 8;
+                char* artist_end = strchr(artist_start, '"');
+                if (artist_end) {
+                    int len = artist_end - artist_start;
+                    if (len > 255) len = 255;
+                    strncpy(segment_artist, artist_start, len);
+                    segment_artist[len] = '\0';
                 }
-            } else if (strncmp(line_buf, "#EXT-X-ENDLIST", 14) == 0) {
-                ctx->is_live = false;
-            } else if (line_buf[0] != '#' && line_buf[0] != '\0') {
-                // This is a URL
-                if (is_master_playlist && variant_url[0] == '\0') {
-                    // Save first variant URL
-                    radio_hls_resolve_url(ctx->base_url, line_buf, variant_url, HLS_MAX_URL_LEN);
-                } else if (!is_master_playlist) {
-                    // Media segment
-                    radio_hls_resolve_url(ctx->base_url, line_buf,
-                               ctx->segments[ctx->segment_count].url, HLS_MAX_URL_LEN);
-                    ctx->segments[ctx->segment_count].duration = segment_duration;
-                    strncpy(ctx->segments[ctx->segment_count].title, segment_title, 255);
-                    strncpy(ctx->segments[ctx->segment_count].artist, segment_artist, 255);
-                    ctx->segment_count++;
-                    segment_duration = 0;
-                    segment_title[0] = '\0';
-                    segment_artist[0] = '\0';
+            }
+        } else if (strncmp(line_buf, "#EXT-X-ENDLIST", 14) == 0) {
+            ctx->is_live = false;
+        } else if (line_buf[0] != '#' && line_buf[0] != '\0') {
+            // Media segment URI (resolved against base_url when fetched)
+            int seq = media_sequence + index++;
+            if (index == 1) {
+                // A merge that can't continue where the known segments end (the
+                // window moved past them) starts over from this playlist
+                int next_seq = ctx->media_sequence + ctx->segment_count;
+                if (!merge || seq > next_seq) {
+                    ctx->segment_count = 0;
+                    ctx->current_segment = 0;
+                    pool_reset(ctx);
+                    ctx->media_sequence = seq;
                 }
             }
+            if (seq >= ctx->media_sequence + ctx->segment_count) {
+                if (!add_segment(ctx, line_buf, segment_duration, segment_title, segment_artist)) break;
+                added++;
+            }
+            segment_duration = 0;
+            segment_title[0] = '\0';
+            segment_artist[0] = '\0';
         }
-
-        // Move to next line
-        line = eol;
-        while (*line == '\n' || *line == '\r') line++;
     }
 
-    // If master playlist, fetch the variant playlist
-    if (is_master_playlist && variant_url[0]) {
-        uint8_t* playlist_buf = malloc(64 * 1024);
-        if (playlist_buf) {
-            int len = radio_net_fetch(variant_url, playlist_buf, 64 * 1024, NULL, 0);
-            if (len > 0) {
-                playlist_buf[len] = '\0';
-                // Update base URL for variant
-                radio_hls_get_base_url(variant_url, ctx->base_url, HLS_MAX_URL_LEN);
-                radio_hls_parse_playlist(ctx, (char*)playlist_buf, ctx->base_url);
-            }
-            free(playlist_buf);
-        }
+    return added;
+}
+
+// When to look at a live playlist again: a segment's duration after it last
+// grew (a new one should be there by then), half the target duration after an
+// unchanged load
+static void schedule_refresh(HLSContext* ctx, bool changed) {
+    float wait = ctx->target_duration > 0 ? ctx->target_duration : 10.0f;
+    if (changed && ctx->segment_count > 0 && ctx->segments[ctx->segment_count - 1].duration > 0) {
+        wait = ctx->segments[ctx->segment_count - 1].duration;
     }
+    if (!changed) wait /= 2;
+    if (wait < 0.25f) wait = 0.25f;
+    ctx->next_refresh_ms = hls_now_ms() + (uint64_t)(wait * 1000);
+}
 
+// Parse M3U8 playlist content
+int radio_hls_parse_playlist(HLSContext* ctx, const char* content, const char* base_url) {
+    if (is_master_playlist(content)) {
+        parse_master(ctx, content, base_url);
+        return 0;
+    }
+    parse_media(ctx, content, base_url, false);
     return ctx->segment_count;
 }
 
-// Fetch and parse M3U8 playlist from URL
-int radio_hls_fetch_playlist(HLSContext* ctx, const char* url) {
-    uint8_t* playlist_buf = malloc(64 * 1024);
-    if (!playlist_buf) {
+// Fetch url and parse it as a playlist
+// Returns the segment count, or -1 if it couldn't be fetched (or master_ok is
+// false and it is a master playlist).
+static int load_playlist(HLSContext* ctx, const char* url, bool master_ok) {
+    // Validators are kept for the refreshes of a media playlist
+    RadioNetValidators validators = {"", ""};
+    RadioNetBody playlist = {0};
+    RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_HLS);
+    int len = radio_net_fetchBody(url, &playlist, HLS_PLAYLIST_MAX, &validators);
+    radio_net_setAccount(account);
+    if (len <= 0 || (!master_ok && is_master_playlist((char*)playlist.data))) {
+        radio_net_freeBody(&playlist);
         return -1;
     }
 
-    int len = radio_net_fetch(url, playlist_buf, 64 * 1024, NULL, 0);
-    if (len <= 0) {
-        free(playlist_buf);
+    char base_url[HLS_MAX_URL_LEN];
+    radio_hls_get_base_url(url, base_url, HLS_MAX_URL_LEN);
+
+    int seg_count = radio_hls_parse_playlist(ctx, (char*)playlist.data, base_url);
+    radio_net_freeBody(&playlist);
+
+    ctx->validators = validators;
+    schedule_refresh(ctx, true);
+    return seg_count;
+}
+
+int radio_hls_refresh_playlist(HLSContext* ctx) {
+    RadioNetBody playlist = {0};
+    RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_HLS);
+    int len = radio_net_fetchBody(ctx->media_url, &playlist, HLS_PLAYLIST_MAX, &ctx->validators);
+    radio_net_setAccount(account);
+    if (len == RADIO_NET_NOT_MODIFIED) {
+        schedule_refresh(ctx, false);
+        return 0;
+    }
+    if (len <= 0 || is_master_playlist((char*)playlist.data)) {
+        radio_net_freeBody(&playlist);
+        schedule_refresh(ctx, false);
         return -1;
     }
 
-    playlist_buf[len] = '\0';
+    // Played segments go first, making room for the new ones
+    drop_segments(ctx, ctx->current_segment);
+    int added = parse_media(ctx, (char*)playlist.data, ctx->base_url, true);
+    radio_net_freeBody(&playlist);
 
-    char base_url[HLS_MAX_URL_LEN];
-    radio_hls_get_base_url(url, base_url, HLS_MAX_URL_LEN);
+    schedule_refresh(ctx, added > 0);
+    return added;
+}
 
-    int seg_count = radio_hls_parse_playlist(ctx, (char*)playlist_buf, base_url);
-    free(playlist_buf);
+bool radio_hls_refresh_due(const HLSContext* ctx) {
+    return hls_now_ms() >= ctx->next_refresh_ms;
+}
 
-    return seg_count;
+void radio_hls_segment_url(const HLSContext* ctx, int index, char* url, int url_size) {
+    if (index < 0 || index >= ctx->segment_count) {
+        url[0] = '\0';
+        return;
+    }
+    radio_hls_resolve_url(ctx->base_url, ctx->strings + ctx->segments[index].uri, url, url_size);
+}
+
+const char* radio_hls_segment_title(const HLSContext* ctx, int index) {
+    return ctx->strings + ctx->segments[index].title;
+}
+
+const char* radio_hls_segment_artist(const HLSContext* ctx, int index) {
+    return ctx->strings + ctx->segments[index].artist;
+}
+
+// Fetch and parse M3U8 playlist from URL
+int radio_hls_fetch_playlist(HLSContext* ctx, const char* url, int throughput_bps) {
+    ctx->variant_count = 0;
+    int seg_count = load_playlist(ctx, url, true);
+    if (seg_count < 0) return -1;
+
+    if (ctx->variant_count == 0) {
+        snprintf(ctx->media_url, sizeof(ctx->media_url), "%s", url);
+        return seg_count;
+    }
+
+    // Master playlist: play one of its renditions
+    if (radio_hls_load_variant(ctx, radio_hls_abr_pick(ctx, throughput_bps)) != 0) return -1;
+    return ctx->segment_count;
+}
+
+int radio_hls_load_variant(HLSContext* ctx, int index) {
+    if (index < 0 || index >= ctx->variant_count) return -1;
+    if (load_playlist(ctx, ctx->variants[index].url, false) < 0) {
+        LOG_ASYNC_error("[HLS] Failed to load variant: %s\n", ctx->variants[index].url);
+        return -1;
+    }
+    snprintf(ctx->media_url, sizeof(ctx->media_url), "%s", ctx->variants[index].url);
+    ctx->current_variant = index;
+    ctx->segments_since_switch = 0;
+    return 0;
+}
+
+// The leanest rendition
+static int abr_lowest(const HLSContext* ctx) {
+    int lowest = 0;
+    for (int i = 1; i < ctx->variant_count; i++) {
+        if (ctx->variants[i].bandwidth < ctx->variants[lowest].bandwidth) lowest = i;
+    }
+    return lowest;
+}
+
+int radio_hls_abr_pick(const HLSContext* ctx, int throughput_bps) {
+    if (ctx->variant_count > 0 && radio_net_dataSaver()) return abr_lowest(ctx);
+    if (ctx->variant_count == 0 || throughput_bps <= 0) return 0;
+
+    // The richest rendition that fits, else the leanest
+    int best = -1;
+    for (int i = 0; i < ctx->variant_count; i++) {
+        int bandwidth = ctx->variants[i].bandwidth;
+        if (bandwidth <= throughput_bps * HLS_ABR_FIT &&
+            (best < 0 || bandwidth > ctx->variants[best].bandwidth)) {
+            best = i;
+        }
+    }
+    return best >= 0 ? best : abr_lowest(ctx);
+}
+
+int radio_hls_abr_update(HLSContext* ctx, int throughput_bps) {
+    int current = ctx->current_variant;
+    if (ctx->variant_count >= 2 && radio_net_dataSaver()) return abr_lowest(ctx);
+    if (ctx->variant_count < 2 || throughput_bps <= 0) return current;
+    ctx->segments_since_switch++;
+
+    int bandwidth = ctx->variants[current].bandwidth;
+    if (bandwidth <= 0) return current;
+
+    // No longer fits: down to what does, straight away
+    if (bandwidth > throughput_bps * HLS_ABR_FIT) {
+        int pick = radio_hls_abr_pick(ctx, throughput_bps);
+        return ctx->variants[pick].bandwidth < bandwidth ? pick : current;
+    }
+
+    // Headroom for the next rendition up, held for a few segments
+    if (ctx->segments_since_switch < HLS_ABR_UP_HOLD) return current;
+    int up = -1;
+    for (int i = 0; i < ctx->variant_count; i++) {
+        int b = ctx->variants[i].bandwidth;
+        if (b > bandwidth && (up < 0 || b < ctx->variants[up].bandwidth)) up = i;
+    }
+    if (up >= 0 && ctx->variants[up].bandwidth <= throughput_bps * HLS_ABR_UP_FIT) return up;
+    return current;
 }
 
 // Parse ID3 tags from HLS segment
@@ -340,121 +604,123 @@ int radio_hls_parse_id3_metadata(const uint8_t* data, int len,
     return total_size;
 }
 
-// Extract AAC audio from MPEG-TS data
-int radio_hls_demux_ts(const uint8_t* ts_data, int ts_len,
-                       uint8_t* aac_out, int aac_out_size,
-                       int* audio_pid, bool* pid_detected) {
-    int aac_pos = 0;
-    int pmt_pid = -1;
-    int local_audio_pid = -1;
-
-    // Use cached audio PID if available
-    if (pid_detected && *pid_detected && audio_pid) {
-        local_audio_pid = *audio_pid;
+void radio_hls_ts_reset(HLSTsDemux* d, bool keep_pid) {
+    d->packet_len = 0;
+    d->in_pes = false;
+    if (!keep_pid) {
+        d->pmt_pid = -1;
+        d->audio_pid = -1;
     }
+}
 
-    int pos = 0;
-    while (pos + TS_PACKET_SIZE <= ts_len && aac_pos < aac_out_size - 1024) {
-        // Find sync byte
-        while (pos < ts_len && ts_data[pos] != TS_SYNC_BYTE) {
-            pos++;
-        }
-
-        if (pos + TS_PACKET_SIZE > ts_len) break;
-
-        const uint8_t* pkt = &ts_data[pos];
-
-        // Parse TS header
-        int pid = ((pkt[1] & 0x1F) << 8) | pkt[2];
-        int payload_start = (pkt[1] & 0x40) != 0;
-        int adaptation_field = (pkt[3] >> 4) & 0x03;
+// One 188-byte packet
+static void ts_packet(HLSTsDemux* d, const uint8_t* pkt, HLSAudioFunc on_audio, void* ctx) {
+    // Parse TS header
+    int pid = ((pkt[1] & 0x1F) << 8) | pkt[2];
+    int payload_start = (pkt[1] & 0x40) != 0;
+    int adaptation_field = (pkt[3] >> 4) & 0x03;
 
-        int header_len = 4;
-        if (adaptation_field == 2 || adaptation_field == 3) {
-            header_len += 1 + pkt[4];  // Skip adaptation field
-        }
+    int header_len = 4;
+    if (adaptation_field == 2 || adaptation_field == 3) {
+        header_len += 1 + pkt[4];  // Skip adaptation field
+    }
+    if (!(adaptation_field == 1 || adaptation_field == 3) || header_len >= TS_PACKET_SIZE) {
+        return;  // No payload
+    }
 
-        if (adaptation_field == 1 || adaptation_field == 3) {
-            // Has payload
-            const uint8_t* payload = pkt + header_len;
-            int payload_len = TS_PACKET_SIZE - header_len;
-
-            if (pid == TS_PAT_PID && payload_start && !(pid_detected && *pid_detected)) {
-                // Parse PAT to find PMT PID
-                int section_start = payload[0] + 1;
-                if (section_start + 8 < payload_len) {
-                    const uint8_t* pat = payload + section_start;
-                    if (pat[0] == 0x00) {  // table_id for PAT
-                        int section_len = ((pat[1] & 0x0F) << 8) | pat[2];
-                        if (section_len >= 9) {
-                            pmt_pid = ((pat[10] & 0x1F) << 8) | pat[11];
-                        }
-                    }
+    const uint8_t* payload = pkt + header_len;
+    int payload_len = TS_PACKET_SIZE - header_len;
+
+    if (pid == TS_PAT_PID && payload_start) {
+        // Parse PAT to find PMT PID
+        int section_start = payload[0] + 1;
+        if (section_start + 12 <= payload_len) {
+            const uint8_t* pat = payload + section_start;
+            if (pat[0] == 0x00) {  // table_id for PAT
+                int section_len = ((pat[1] & 0x0F) << 8) | pat[2];
+                if (section_len >= 9) {
+                    d->pmt_pid = ((pat[10] & 0x1F) << 8) | pat[11];
                 }
-            } else if (pmt_pid > 0 && pid == pmt_pid && payload_start && !(pid_detected && *pid_detected)) {
-                // Parse PMT to find audio stream PID
-                int section_start = payload[0] + 1;
-                if (section_start + 12 < payload_len) {
-                    const uint8_t* pmt = payload + section_start;
-                    if (pmt[0] == 0x02) {  // table_id for PMT
-                        int section_len = ((pmt[1] & 0x0F) << 8) | pmt[2];
-                        int prog_info_len = ((pmt[10] & 0x0F) << 8) | pmt[11];
-
-                        int es_pos = 12 + prog_info_len;
-                        while (es_pos + 5 <= section_len + 3 - 4) {
-                            int stream_type = pmt[es_pos];
-                            int es_pid = ((pmt[es_pos + 1] & 0x1F) << 8) | pmt[es_pos + 2];
-                            int es_info_len = ((pmt[es_pos + 3] & 0x0F) << 8) | pmt[es_pos + 4];
-
-                            // AAC stream types: 0x0F (ADTS), 0x11 (LATM)
-                            if (stream_type == 0x0F || stream_type == 0x11) {
-                                local_audio_pid = es_pid;
-                                if (audio_pid) *audio_pid = local_audio_pid;
-                                if (pid_detected) *pid_detected = true;
-                                break;
-                            }
-                            // Also check for MP3 (0x03, 0x04)
-                            if (stream_type == 0x03 || stream_type == 0x04) {
-                                local_audio_pid = es_pid;
-                                if (audio_pid) *audio_pid = local_audio_pid;
-                                if (pid_detected) *pid_detected = true;
-                                break;
-                            }
-
-                            es_pos += 5 + es_info_len;
-                        }
+            }
+        }
+    } else if (d->pmt_pid > 0 && pid == d->pmt_pid && payload_start) {
+        // Parse PMT to find audio stream PID
+        int section_start = payload[0] + 1;
+        if (section_start + 12 < payload_len) {
+            const uint8_t* pmt = payload + section_start;
+            if (pmt[0] == 0x02) {  // table_id for PMT
+                int section_len = ((pmt[1] & 0x0F) << 8) | pmt[2];
+                int prog_info_len = ((pmt[10] & 0x0F) << 8) | pmt[11];
+                int section_end = section_len + 3 - 4;  // Before the CRC
+                if (section_end > payload_len - section_start) section_end = payload_len - section_start;
+
+                int es_pos = 12 + prog_info_len;
+                while (es_pos + 5 <= section_end) {
+                    int stream_type = pmt[es_pos];
+                    int es_pid = ((pmt[es_pos + 1] & 0x1F) << 8) | pmt[es_pos + 2];
+                    int es_info_len = ((pmt[es_pos + 3] & 0x0F) << 8) | pmt[es_pos + 4];
+
+                    // AAC stream types: 0x0F (ADTS), 0x11 (LATM); MP3: 0x03, 0x04
+                    if (stream_type == 0x0F || stream_type == 0x11 ||
+                        stream_type == 0x03 || stream_type == 0x04) {
+                        d->audio_pid = es_pid;
+                        break;
                     }
+
+                    es_pos += 5 + es_info_len;
                 }
-            } else if (local_audio_pid > 0 && pid == local_audio_pid) {
-                // Extract audio data from PES packet
-                const uint8_t* pes = payload;
-                int pes_len = payload_len;
-
-                if (payload_start) {
-                    // Check PES start code
-                    if (pes[0] == 0x00 && pes[1] == 0x00 && pes[2] == 0x01) {
-                        // Parse PES header
-                        int pes_header_len = 9 + pes[8];
-                        if (pes_header_len < pes_len) {
-                            int audio_len = pes_len - pes_header_len;
-                            if (aac_pos + audio_len < aac_out_size) {
-                                memcpy(aac_out + aac_pos, pes + pes_header_len, audio_len);
-                                aac_pos += audio_len;
-                            }
-                        }
-                    }
-                } else {
-                    // Continuation of PES packet - raw audio data
-                    if (aac_pos + pes_len < aac_out_size) {
-                        memcpy(aac_out + aac_pos, pes, pes_len);
-                        aac_pos += pes_len;
-                    }
+            }
+        }
+    } else if (d->audio_pid > 0 && pid == d->audio_pid) {
+        // Extract audio data from PES packet
+        if (payload_start) {
+            // Check PES start code
+            d->in_pes = payload_len >= 9 && payload[0] == 0x00 && payload[1] == 0x00 && payload[2] == 0x01;
+            if (d->in_pes) {
+                // Parse PES header
+                int pes_header_len = 9 + payload[8];
+                if (pes_header_len < payload_len) {
+                    on_audio(ctx, payload + pes_header_len, payload_len - pes_header_len);
                 }
             }
+        } else if (d->in_pes) {
+            // Continuation of PES packet - raw audio data
+            on_audio(ctx, payload, payload_len);
         }
-
-        pos += TS_PACKET_SIZE;
     }
+}
+
+void radio_hls_ts_feed(HLSTsDemux* d, const uint8_t* data, int len,
+                       HLSAudioFunc on_audio, void* ctx) {
+    while (len > 0) {
+        if (d->packet_len == 0) {
+            // Whole packets straight from the input
+            while (len >= TS_PACKET_SIZE && data[0] == TS_SYNC_BYTE) {
+                ts_packet(d, data, on_audio, ctx);
+                data += TS_PACKET_SIZE;
+                len -= TS_PACKET_SIZE;
+            }
+            if (len == 0) break;
+            if (data[0] != TS_SYNC_BYTE) {
+                // Lost sync: skip to the next sync byte
+                const uint8_t* sync = memchr(data, TS_SYNC_BYTE, len);
+                if (!sync) break;
+                len -= sync - data;
+                data = sync;
+                continue;
+            }
+        }
 
-    return aac_pos;
+        // A packet split across feeds is completed from the next one
+        int n = TS_PACKET_SIZE - d->packet_len;
+        if (n > len) n = len;
+        memcpy(d->packet + d->packet_len, data, n);
+        d->packet_len += n;
+        data += n;
+        len -= n;
+        if (d->packet_len == TS_PACKET_SIZE) {
+            d->packet_len = 0;
+            ts_packet(d, d->packet, on_audio, ctx);
+        }
+    }
 }
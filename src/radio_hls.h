@@ -4,18 +4,30 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "radio_net.h"
+
 #define HLS_MAX_SEGMENTS 64
 #define HLS_MAX_URL_LEN 1024
 #define HLS_SEGMENT_BUF_SIZE (256 * 1024)
+#define HLS_MAX_VARIANTS 8
+#define HLS_STRING_POOL_SIZE (16 * 1024)
 
 // HLS segment info
+// Strings are offsets into HLSContext.strings (0 = ""); the URI is as the
+// playlist gives it, see radio_hls_segment_url()
 typedef struct {
-    char url[HLS_MAX_URL_LEN];
     float duration;
-    char title[256];
-    char artist[256];
+    uint16_t uri;
+    uint16_t title;
+    uint16_t artist;
 } HLSSegment;
 
+// Rendition listed by a master playlist
+typedef struct {
+    char url[HLS_MAX_URL_LEN];
+    int bandwidth;              // BANDWIDTH, bits per second (0 = not given)
+} HLSVariant;
+
 // HLS context
 typedef struct {
     char base_url[HLS_MAX_URL_LEN];
@@ -26,7 +38,21 @@ typedef struct {
     int media_sequence;
     int last_played_sequence;
     bool is_live;
-    uint32_t last_playlist_fetch;
+
+    // Segment strings, in segment order
+    char strings[HLS_STRING_POOL_SIZE];
+    int strings_len;
+
+    // Live refresh
+    RadioNetValidators validators;      // Of the media playlist, for conditional GETs
+    uint64_t next_refresh_ms;           // Monotonic
+
+    // Renditions of a master playlist (variant_count = 0 for a media playlist)
+    HLSVariant variants[HLS_MAX_VARIANTS];
+    int variant_count;
+    int current_variant;
+    int segments_since_switch;
+    char media_url[HLS_MAX_URL_LEN];    // Media playlist being played
 } HLSContext;
 
 // Check if URL is an HLS stream (.m3u8)
@@ -39,12 +65,50 @@ void radio_hls_init(HLSContext* ctx);
 void radio_hls_cleanup(HLSContext* ctx);
 
 // Parse M3U8 playlist from content
+// A media playlist replaces the segments; a master playlist replaces the variants
+// (and leaves the segments alone).
 // Returns number of segments found
 int radio_hls_parse_playlist(HLSContext* ctx, const char* content, const char* base_url);
 
-// Fetch and parse M3U8 playlist from URL
+// Refresh a live media playlist (media_url) with a conditional GET
+// Segments before current_segment are dropped (media_sequence and
+// current_segment move with them) and only segments with new media sequence
+// numbers are appended. Schedules the next refresh.
+// Returns the number of new segments (0 if unchanged), or -1 on error.
+int radio_hls_refresh_playlist(HLSContext* ctx);
+
+// Whether a live playlist is due for radio_hls_refresh_playlist(): a segment's
+// duration after it last grew, half the target duration after an unchanged load
+bool radio_hls_refresh_due(const HLSContext* ctx);
+
+// Segment index's URL, resolved against base_url ("" if there is none)
+void radio_hls_segment_url(const HLSContext* ctx, int index, char* url, int url_size);
+
+// Segment index's EXTINF title and artist ("" if none)
+const char* radio_hls_segment_title(const HLSContext* ctx, int index);
+const char* radio_hls_segment_artist(const HLSContext* ctx, int index);
+
+// Fetch and parse M3U8 playlist from URL; for a master playlist, the rendition
+// radio_hls_abr_pick() chooses for throughput_bps is loaded
 // Returns number of segments found, or -1 on error
-int radio_hls_fetch_playlist(HLSContext* ctx, const char* url);
+int radio_hls_fetch_playlist(HLSContext* ctx, const char* url, int throughput_bps);
+
+// Load the media playlist of variant index, keeping the current one on failure
+// Returns 0 on success, -1 on error.
+int radio_hls_load_variant(HLSContext* ctx, int index);
+
+// Adaptive bitrate
+// Renditions are chosen from the measured segment download throughput (bits per
+// second, 0 = not measured yet): the best one that fits with a safety margin.
+// Dropping down happens as soon as the current one no longer fits; stepping up
+// one rendition waits a few segments and needs more headroom. Under the data
+// saver (radio_net.h) the leanest rendition is played whatever the throughput.
+
+// Rendition to start with (the first listed while nothing is measured)
+int radio_hls_abr_pick(const HLSContext* ctx, int throughput_bps);
+
+// Call once per segment: the rendition to switch to, or current_variant to stay
+int radio_hls_abr_update(HLSContext* ctx, int throughput_bps);
 
 // URL utilities
 void radio_hls_get_base_url(const char* url, char* base, int base_size);
@@ -57,10 +121,26 @@ int radio_hls_parse_id3_metadata(const uint8_t* data, int len,
                                   char* title, int title_size);
 
 // MPEG-TS demuxer
-// Extract AAC audio from MPEG-TS data
-// Returns number of AAC bytes extracted
-int radio_hls_demux_ts(const uint8_t* ts_data, int ts_len,
-                       uint8_t* aac_out, int aac_out_size,
-                       int* audio_pid, bool* pid_detected);
+// Incremental: takes the segment in whatever pieces it arrives and emits the audio
+// stream's payload (ADTS frames) as each 188-byte packet completes.
+#define TS_PACKET_SIZE 188
+
+typedef struct {
+    uint8_t packet[TS_PACKET_SIZE];     // Packet split across feeds
+    int packet_len;
+    int pmt_pid;                        // -1 until the PAT names it
+    int audio_pid;                      // -1 until the PMT names it
+    bool in_pes;                        // Inside an audio PES packet
+} HLSTsDemux;
+
+typedef void (*HLSAudioFunc)(void* ctx, const uint8_t* data, int len);
+
+// Start a new segment; keep_pid reuses the PIDs found in earlier segments until
+// a PAT/PMT in this one replaces them
+void radio_hls_ts_reset(HLSTsDemux* d, bool keep_pid);
+
+// Demux the next len bytes of the segment, emitting audio payload through on_audio
+void radio_hls_ts_feed(HLSTsDemux* d, const uint8_t* data, int len,
+                       HLSAudioFunc on_audio, void* ctx);
 
 #endif
@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "radio_hls_fetch.h"
+#include "radio_hls.h"
+#include "radio_net.h"
+#include "thread_role.h"
+#include "memstats.h"
+#include "log_async.h"
+#include "defines.h"
+#include "api.h"
+
+#define TS_SYNC_BYTE 0x47
+#define FETCH_DEFAULT_DEPTH 2           // Until a segment download has been timed
+#define FETCH_BANDWIDTH_WEIGHT 0.3f     // Of the newest measurement in the average
+
+typedef enum {
+    SLOT_FREE,
+    SLOT_QUEUED,
+    SLOT_FETCHING,
+    SLOT_READY,
+    SLOT_FAILED
+} SlotState;
+
+typedef struct {
+    SlotState state;
+    bool discard;               // Download in progress no longer wanted: freed when it ends
+    int seq;
+    char url[HLS_MAX_URL_LEN];
+    uint8_t* buf;               // HLS_SEGMENT_BUF_SIZE, allocated once
+    int start;                  // Audio starts here, after an ID3 tag (-1 = not yet known)
+    int len;                    // Audio bytes published from start (-1 = none yet)
+    char artist[256];           // From the ID3 tag, set before start
+    char title[256];
+
+    // Fetcher thread only
+    int filled;                 // Bytes in buf
+    bool format_known;
+    bool is_ts;
+} FetchSlot;
+
+// All state guarded by fetch_mutex; the fetcher thread writes a slot's buffer
+// beyond what is published, and its fetcher-only fields, unlocked while the slot
+// is SLOT_FETCHING
+static pthread_mutex_t fetch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;     // Segment queued, or quit
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;     // Segment downloaded
+static FetchSlot slots[RADIO_HLS_FETCH_MAX_SLOTS];
+static int slot_count = 0;
+static pthread_t fetch_thread;
+static bool thread_running = false;
+static bool quit = false;
+static bool new_stream = true;          // Next segment is a new stream's: find its PIDs again
+static HLSTsDemux demux;                // Fetcher thread only
+
+// Download measurements: average bandwidth (request latency included) and size
+static float bytes_per_ms = 0.0f;
+static float segment_bytes = 0.0f;
+
+static uint64_t fetch_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static float average(float avg, float sample) {
+    return avg > 0.0f ? avg + (sample - avg) * FETCH_BANDWIDTH_WEIGHT : sample;
+}
+
+// Slot holding segment seq (locked)
+static FetchSlot* find_slot(int seq) {
+    for (int i = 0; i < slot_count; i++) {
+        FetchSlot* s = &slots[i];
+        if (s->state != SLOT_FREE && !s->discard && s->seq == seq) return s;
+    }
+    return NULL;
+}
+
+// Give a slot back; one being downloaded goes back when its download ends (locked)
+static void drop_slot(FetchSlot* s) {
+    if (s->state == SLOT_FETCHING) {
+        s->discard = true;
+    } else {
+        s->state = SLOT_FREE;
+    }
+}
+
+// Size of the ID3 tag a packed-audio segment starts with: 0 if none, -1 until known
+static int head_size(const uint8_t* buf, int filled, bool complete) {
+    if (filled >= 3 && memcmp(buf, "ID3", 3) != 0) return 0;
+    if (filled < 10) return complete ? 0 : -1;
+    int total = 10 + (((buf[6] & 0x7F) << 21) | ((buf[7] & 0x7F) << 14) |
+                      ((buf[8] & 0x7F) << 7) | (buf[9] & 0x7F));
+    if (filled < total && !complete) return -1;
+    return total < filled ? total : filled;
+}
+
+// Demuxed audio into the slot (what doesn't fit is dropped)
+static void append_audio(void* ctx, const uint8_t* data, int len) {
+    FetchSlot* s = ctx;
+    int n = HLS_SEGMENT_BUF_SIZE - s->filled;
+    if (n > len) n = len;
+    memcpy(s->buf + s->filled, data, n);
+    s->filled += n;
+}
+
+// Make the audio so far visible to the stream thread
+// Returns false once the segment is no longer wanted.
+static bool publish(FetchSlot* s, bool complete) {
+    int start = -1;
+    char artist[256] = "", title[256] = "";
+    if (s->start < 0) {
+        start = s->is_ts ? 0 : head_size(s->buf, s->filled, complete);
+        if (start > 0) {
+            radio_hls_parse_id3_metadata(s->buf, s->filled, artist, sizeof(artist),
+                                         title, sizeof(title));
+        }
+    }
+
+    pthread_mutex_lock(&fetch_mutex);
+    if (start >= 0) {
+        memcpy(s->artist, artist, sizeof(artist));
+        memcpy(s->title, title, sizeof(title));
+        s->start = start;
+    }
+    if (s->start >= 0) s->len = s->filled - s->start;
+    bool wanted = !s->discard && !quit;
+    pthread_cond_broadcast(&done_cond);
+    pthread_mutex_unlock(&fetch_mutex);
+    return wanted;
+}
+
+static bool on_segment_data(void* ctx, const uint8_t* data, int len) {
+    FetchSlot* s = ctx;
+    if (!s->format_known) {
+        // MPEG-TS starts with a sync byte; anything else is packed audio
+        s->is_ts = data[0] == TS_SYNC_BYTE;
+        s->format_known = true;
+    }
+    if (s->is_ts) {
+        radio_hls_ts_feed(&demux, data, len, append_audio, s);
+    } else {
+        append_audio(s, data, len);
+    }
+    return publish(s, false);
+}
+
+static void* fetch_func(void* arg) {
+    (void)arg;
+    // Feeds playback directly, like the HLS stream thread it works for
+    ThreadRole_apply(THREAD_ROLE_DECODE);
+    radio_net_setAccount(RADIO_NET_ACCOUNT_HLS);
+
+    pthread_mutex_lock(&fetch_mutex);
+    while (!quit) {
+        // Lowest queued sequence number first
+        FetchSlot* next = NULL;
+        for (int i = 0; i < slot_count; i++) {
+            FetchSlot* s = &slots[i];
+            if (s->state == SLOT_QUEUED && (!next || s->seq < next->seq)) next = s;
+        }
+        if (!next) {
+            pthread_cond_wait(&work_cond, &fetch_mutex);
+            continue;
+        }
+        next->state = SLOT_FETCHING;
+        next->start = -1;
+        next->len = -1;
+        next->artist[0] = next->title[0] = '\0';
+        next->filled = 0;
+        next->format_known = false;
+        bool keep_pid = !new_stream;
+        new_stream = false;
+        pthread_mutex_unlock(&fetch_mutex);
+
+        radio_hls_ts_reset(&demux, keep_pid);
+        uint64_t start = fetch_now_ms();
+        int len = radio_net_fetchStream(next->url, on_segment_data, next);
+        uint64_t elapsed = fetch_now_ms() - start;
+        if (len > 0) publish(next, true);
+
+        pthread_mutex_lock(&fetch_mutex);
+        if (len > 0) {
+            bytes_per_ms = average(bytes_per_ms, (float)len / (elapsed > 0 ? elapsed : 1));
+            segment_bytes = average(segment_bytes, (float)len);
+        }
+        if (next->discard) {
+            next->discard = false;
+            next->state = SLOT_FREE;
+        } else {
+            if (len <= 0) LOG_ASYNC_error("[HLS] Failed to fetch segment: %s\n", next->url);
+            next->state = len > 0 ? SLOT_READY : SLOT_FAILED;
+        }
+        pthread_cond_broadcast(&done_cond);
+    }
+    pthread_mutex_unlock(&fetch_mutex);
+    return NULL;
+}
+
+int radio_hls_fetch_init(int count) {
+    if (thread_running) return 0;
+    if (count < RADIO_HLS_FETCH_MIN_SLOTS) count = RADIO_HLS_FETCH_MIN_SLOTS;
+    if (count > RADIO_HLS_FETCH_MAX_SLOTS) count = RADIO_HLS_FETCH_MAX_SLOTS;
+
+    for (int i = 0; i < count; i++) {
+        memset(&slots[i], 0, sizeof(slots[i]));
+        slots[i].buf = MEM_MALLOC(MEM_TAG_HLS, HLS_SEGMENT_BUF_SIZE);
+        if (!slots[i].buf) {
+            while (i-- > 0) MEM_FREE(MEM_TAG_HLS, slots[i].buf);
+            return -1;
+        }
+    }
+    slot_count = count;
+    quit = false;
+
+    if (pthread_create(&fetch_thread, NULL, fetch_func, NULL) != 0) {
+        for (int i = 0; i < slot_count; i++) MEM_FREE(MEM_TAG_HLS, slots[i].buf);
+        slot_count = 0;
+        return -1;
+    }
+    thread_running = true;
+    return 0;
+}
+
+void radio_hls_fetch_reset(void) {
+    pthread_mutex_lock(&fetch_mutex);
+    for (int i = 0; i < slot_count; i++) {
+        if (slots[i].state != SLOT_FREE) drop_slot(&slots[i]);
+    }
+    new_stream = true;
+    pthread_mutex_unlock(&fetch_mutex);
+}
+
+int radio_hls_fetch_depth(float target_duration) {
+    pthread_mutex_lock(&fetch_mutex);
+    int depth = FETCH_DEFAULT_DEPTH;
+    if (bytes_per_ms > 0.0f && target_duration > 0.0f) {
+        // Keep twice the download time covered by segments already fetched
+        float ratio = segment_bytes / bytes_per_ms / (target_duration * 1000.0f);
+        depth = 1 + (int)(2.0f * ratio + 0.999f);
+    }
+    if (depth < RADIO_HLS_FETCH_MIN_SLOTS) depth = RADIO_HLS_FETCH_MIN_SLOTS;
+    if (depth > slot_count) depth = slot_count;
+    pthread_mutex_unlock(&fetch_mutex);
+    return depth;
+}
+
+int radio_hls_fetch_throughput(void) {
+    pthread_mutex_lock(&fetch_mutex);
+    int bps = (int)(bytes_per_ms * 8000.0f);
+    pthread_mutex_unlock(&fetch_mutex);
+    return bps;
+}
+
+void radio_hls_fetch_dropBefore(int seq) {
+    pthread_mutex_lock(&fetch_mutex);
+    for (int i = 0; i < slot_count; i++) {
+        FetchSlot* s = &slots[i];
+        if (s->state != SLOT_FREE && !s->discard && s->seq < seq) drop_slot(s);
+    }
+    pthread_mutex_unlock(&fetch_mutex);
+}
+
+bool radio_hls_fetch_queue(int seq, const char* url) {
+    bool queued = false;
+    pthread_mutex_lock(&fetch_mutex);
+    FetchSlot* have = find_slot(seq);
+    if (have) {
+        if (have->state == SLOT_QUEUED) snprintf(have->url, sizeof(have->url), "%s", url);
+        queued = true;
+    } else {
+        for (int i = 0; i < slot_count; i++) {
+            FetchSlot* s = &slots[i];
+            if (s->state != SLOT_FREE) continue;
+            s->state = SLOT_QUEUED;
+            s->seq = seq;
+            snprintf(s->url, sizeof(s->url), "%s", url);
+            pthread_cond_signal(&work_cond);
+            queued = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fetch_mutex);
+    return queued;
+}
+
+int radio_hls_fetch_wait(int seq, int have, RadioHlsSegment* out, int timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&fetch_mutex);
+    FetchSlot* s;
+    while ((s = find_slot(seq)) != NULL && s->len <= have &&
+           (s->state == SLOT_QUEUED || s->state == SLOT_FETCHING)) {
+        if (pthread_cond_timedwait(&done_cond, &fetch_mutex, &deadline) != 0) break;
+    }
+
+    int result = -1;
+    if (s && s->state != SLOT_FAILED) {
+        result = 0;
+        if (s->state == SLOT_READY || s->len > have) {
+            out->data = s->buf + s->start;
+            out->len = s->len;
+            out->complete = s->state == SLOT_READY;
+            memcpy(out->artist, s->artist, sizeof(out->artist));
+            memcpy(out->title, s->title, sizeof(out->title));
+            result = 1;
+        }
+    }
+    pthread_mutex_unlock(&fetch_mutex);
+    return result;
+}
+
+void radio_hls_fetch_release(int seq) {
+    pthread_mutex_lock(&fetch_mutex);
+    FetchSlot* s = find_slot(seq);
+    if (s) drop_slot(s);
+    pthread_mutex_unlock(&fetch_mutex);
+}
+
+void radio_hls_fetch_quit(void) {
+    if (!thread_running) return;
+    pthread_mutex_lock(&fetch_mutex);
+    quit = true;
+    pthread_cond_signal(&work_cond);
+    pthread_mutex_unlock(&fetch_mutex);
+    pthread_join(fetch_thread, NULL);
+    thread_running = false;
+
+    for (int i = 0; i < slot_count; i++) {
+        MEM_FREE(MEM_TAG_HLS, slots[i].buf);
+        memset(&slots[i], 0, sizeof(slots[i]));
+    }
+    slot_count = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef __RADIO_HLS_FETCH_H__
+#define __RADIO_HLS_FETCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// HLS segment fetcher
+// One persistent thread downloads queued segments, in sequence order, into a fixed
+// pool of segment buffers, so several segments can be fetched ahead of the one
+// being played and a slow segment is absorbed by the ones already queued.
+// Segments are demuxed as they download: a buffer holds the segment's audio
+// (ADTS frames from MPEG-TS, or packed audio without its ID3 tag) and the HLS
+// stream thread can decode it while the rest is still arriving.
+// Segments are identified by their media sequence number. The HLS stream thread
+// queues, waits on and releases them; a segment's audio stays valid until it is
+// released.
+
+#define RADIO_HLS_FETCH_MIN_SLOTS 2
+#define RADIO_HLS_FETCH_MAX_SLOTS 4
+
+// Allocate the buffer pool (slots clamped to the range above) and start the thread
+// Returns 0 on success, -1 on error.
+int radio_hls_fetch_init(int slots);
+
+// Drop everything queued or fetched (a download in progress is discarded when it ends)
+void radio_hls_fetch_reset(void);
+
+// How many segments, the playing one included, to keep queued for segments of
+// target_duration seconds: more when the measured bandwidth makes a segment take a
+// large part of its duration to download
+int radio_hls_fetch_depth(float target_duration);
+
+// Drop the segments before seq (ones the playlist moved past are never taken)
+void radio_hls_fetch_dropBefore(int seq);
+
+// Measured download throughput in bits per second (0 = nothing measured yet)
+int radio_hls_fetch_throughput(void);
+
+// Queue segment seq for download (if it already is but hasn't started, url
+// replaces its URL, e.g. after a rendition switch)
+// Returns false if the pool is full.
+bool radio_hls_fetch_queue(int seq, const char* url);
+
+// A segment's audio so far
+typedef struct {
+    const uint8_t* data;
+    int len;
+    bool complete;              // Downloaded: len is final
+    char artist[256];           // From an ID3 tag at its start ("" if none)
+    char title[256];
+} RadioHlsSegment;
+
+// Wait up to timeout_ms for segment seq to have more than have bytes of audio, or
+// to be complete
+// Returns 1 with *out filled, 0 on timeout, -1 if it failed or was never queued
+// (release it either way once done).
+int radio_hls_fetch_wait(int seq, int have, RadioHlsSegment* out, int timeout_ms);
+
+// Give the buffer of segment seq back to the pool
+void radio_hls_fetch_release(int seq);
+
+// Stop the thread and free the pool
+void radio_hls_fetch_quit(void);
+
+#endif
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "api.h"
+#include "radio_memo.h"
+
+// Lines: url|stream_url|format|sample_rate|channels|byte_rate
+static bool parse_line(char* line, RadioMemo* memo) {
+    char* nl = strchr(line, '\n');
+    if (nl) *nl = '\0';
+
+    char* fields[6];
+    int count = 0;
+    char* p = line;
+    while (count < 6) {
+        fields[count++] = p;
+        p = strchr(p, '|');
+        if (!p) break;
+        *p++ = '\0';
+    }
+    if (count < 6 || !fields[0][0]) return false;
+
+    memset(memo, 0, sizeof(RadioMemo));
+    snprintf(memo->url, sizeof(memo->url), "%s", fields[0]);
+    snprintf(memo->stream_url, sizeof(memo->stream_url), "%s", fields[1]);
+    memo->format = atoi(fields[2]);
+    memo->sample_rate = atoi(fields[3]);
+    memo->channels = atoi(fields[4]);
+    memo->byte_rate = atoi(fields[5]);
+    return true;
+}
+
+static void write_line(FILE* f, const RadioMemo* memo) {
+    fprintf(f, "%s|%s|%d|%d|%d|%d\n", memo->url, memo->stream_url, memo->format,
+            memo->sample_rate, memo->channels, memo->byte_rate);
+}
+
+static bool same(const RadioMemo* a, const RadioMemo* b) {
+    return strcmp(a->url, b->url) == 0 && strcmp(a->stream_url, b->stream_url) == 0 &&
+           a->format == b->format && a->sample_rate == b->sample_rate &&
+           a->channels == b->channels && a->byte_rate == b->byte_rate;
+}
+
+bool radio_memo_get(const char* url, RadioMemo* memo) {
+    FILE* f = fopen(RADIO_MEMO_FILE, "r");
+    if (!f) return false;
+
+    char line[RADIO_MAX_URL * 2 + 64];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f)) {
+        found = parse_line(line, memo) && strcmp(memo->url, url) == 0;
+    }
+    fclose(f);
+    return found;
+}
+
+void radio_memo_put(const RadioMemo* memo) {
+    if (!memo->url[0] || strchr(memo->url, '|') || strchr(memo->stream_url, '|')) return;
+
+    RadioMemo old;
+    if (radio_memo_get(memo->url, &old) && same(&old, memo)) return;
+
+    // Rewritten through a temporary file: an interrupted write keeps the old memos
+    const char* tmp = RADIO_MEMO_FILE ".tmp";
+    FILE* out = fopen(tmp, "w");
+    if (!out) return;
+    write_line(out, memo);
+
+    FILE* in = fopen(RADIO_MEMO_FILE, "r");
+    if (in) {
+        char line[RADIO_MAX_URL * 2 + 64];
+        int kept = 1;
+        while (kept < RADIO_MEMO_MAX && fgets(line, sizeof(line), in)) {
+            RadioMemo entry;
+            if (!parse_line(line, &entry) || strcmp(entry.url, memo->url) == 0) continue;
+            write_line(out, &entry);
+            kept++;
+        }
+        fclose(in);
+    }
+    if (fclose(out) != 0) {
+        remove(tmp);
+        return;
+    }
+    if (rename(tmp, RADIO_MEMO_FILE) != 0) remove(tmp);
+}
@@ -0,0 +1,34 @@
+#ifndef __RADIO_MEMO_H__
+#define __RADIO_MEMO_H__
+
+#include <stdbool.h>
+
+#include "radio.h"
+
+// What the last start of each station learned, so the next one can skip it:
+// the stream URL its redirects led to, the codec when the headers don't name
+// it, the decoded rate and channels (the resampler is set up before the first
+// frame) and the measured byte rate (buffering decisions are right from the
+// start). Kept in RADIO_MEMO_FILE, most recently played first, at most
+// RADIO_MEMO_MAX stations; only read and written by Radio_play and
+// Radio_update (main thread). A stale memo costs one failed connect.
+
+#define RADIO_MEMO_FILE SHARED_USERDATA_PATH "/radio_memo.txt"
+#define RADIO_MEMO_MAX 64
+
+typedef struct {
+    char url[RADIO_MAX_URL];        // As played (the key)
+    char stream_url[RADIO_MAX_URL]; // After redirects ("" = same)
+    int format;                     // Codec that decoded (radio.c's RadioAudioFormat)
+    int sample_rate;                // Decoded, before resampling
+    int channels;
+    int byte_rate;                  // Encoded bytes per second of audio
+} RadioMemo;
+
+// The memo of url; false if there is none
+bool radio_memo_get(const char* url, RadioMemo* memo);
+
+// Store a memo as the most recent (the file is only written when it changed)
+void radio_memo_put(const RadioMemo* memo);
+
+#endif
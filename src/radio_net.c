@@ -4,13 +4,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <strings.h>
+#include <dirent.h>
+#include <zlib.h>
 
 #include "defines.h"
 #include "api.h"
+#include "trace.h"
+#include "radio_capture.h"
+#include "log_async.h"
 
 // mbedTLS for HTTPS support
 #include "mbedtls/net_sockets.h"
@@ -18,17 +29,859 @@
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
 #include "mbedtls/error.h"
+#include "mbedtls/platform.h"
+#ifdef TLS_ARENA
+#include "mbedtls/memory_buffer_alloc.h"
+#endif
+
+#define DNS_CACHE_SIZE 16
+#define DNS_ADDRS_MAX 4                 // Addresses of a host kept (and raced)
+#define TLS_SESSION_CACHE_SIZE 8
+#define FETCH_POOL_SIZE 4
+#define FETCH_IDLE_MS 30000             // Servers commonly drop idle keep-alives after 60 s
+// A TLS connection holds ~22 KB of record buffers (16 KB in, 4 KB in once a server
+// agrees to 4 KB records, 4 KB out), a handshake briefly ~30 KB more: the stream,
+// the fetch pool and the probes fit with headroom
+#define TLS_ARENA_SIZE (512 * 1024)
+#define TLS_CIPHERSUITES_MAX 64
+#define LIVE_SOCKETS_MAX 32
 
 // SSL context for fetch operations (heap allocated to save stack space)
 typedef struct {
     mbedtls_net_context net;
     mbedtls_ssl_context ssl;
-    mbedtls_ssl_config conf;
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
     bool initialized;
 } FetchSSLContext;
 
+// Fetch connection, kept open between requests to the same host:port
+typedef struct {
+    bool open;
+    int fd;
+    FetchSSLContext* ssl;       // NULL for plain HTTP
+    bool https;
+    char host[256];
+    int port;
+    uint64_t idle_since_ms;     // When it went back to the pool
+} FetchConn;
+
+// Buffered reader over a fetch connection (a TLS record fits)
+typedef struct {
+    FetchConn* conn;
+    uint8_t buf[16 * 1024];
+    int pos;
+    int len;
+} FetchReader;
+
+// Where a response body goes: into a buffer, or to a callback as it arrives
+typedef struct {
+    uint8_t* buffer;            // NULL when streaming to on_data
+    int room;                   // Buffer bytes usable (one is left for a NUL)
+    RadioNetDataFunc on_data;
+    void* ctx;
+    int total;                  // Bytes stored, or handed to on_data
+    bool aborted;               // on_data asked to stop
+    RadioNetValidators* validators;     // Conditional request (NULL = none)
+    int64_t range_offset;       // Range request: offset < 0 asks for the last
+    int64_t range_length;       // range_length bytes (length 0 = whole resource)
+    z_stream* gzip;             // Decoder of a gzip-encoded response (NULL = none)
+    uint8_t* gzip_out;
+    int capture_id;             // Recording of the body (radio_capture.h), 0 = none
+    const char* post_data;      // POST request body (NULL = GET)
+    const char* post_type;      // Its Content-Type
+    const char* headers;        // More request header lines, each ending in CRLF (NULL = none)
+} FetchSink;
+
+#define GZIP_CHUNK (16 * 1024)
+
+// Addresses of a host, in the order to try them
+typedef struct {
+    struct sockaddr_storage addr[DNS_ADDRS_MAX];
+    socklen_t len[DNS_ADDRS_MAX];
+    int count;
+} DnsAddrs;
+
+typedef struct {
+    char host[256];
+    DnsAddrs addrs;
+    uint64_t expires_ms;
+} DnsEntry;
+
+// getaddrinfo() on a helper thread, which frees this when the waiter gave up on it
+typedef struct {
+    char host[256];
+    DnsAddrs addrs;
+    int ret;
+    bool done;
+    bool abandoned;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} DnsLookup;
+
+typedef struct {
+    char host[256];
+    int port;
+    mbedtls_ssl_session session;
+    bool valid;
+} TlsSession;
+
+static pthread_mutex_t dns_mutex = PTHREAD_MUTEX_INITIALIZER;
+static DnsEntry dns_cache[DNS_CACHE_SIZE];
+static int dns_next = 0;                // Entry replaced next when none has expired
+
+// Shared TLS client state, set up once by tls_setup()
+static pthread_once_t tls_once = PTHREAD_ONCE_INIT;
+static bool tls_ready = false;
+static mbedtls_entropy_context tls_entropy;
+static mbedtls_ctr_drbg_context tls_drbg;
+static mbedtls_ssl_config tls_conf;
+static int tls_ciphersuites[TLS_CIPHERSUITES_MAX];
+static pthread_mutex_t rng_mutex = PTHREAD_MUTEX_INITIALIZER;
+#ifdef TLS_ARENA
+static unsigned char tls_arena[TLS_ARENA_SIZE] __attribute__((aligned(16)));
+#endif
+
+static pthread_mutex_t session_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TlsSession tls_sessions[TLS_SESSION_CACHE_SIZE];
+static int session_next = 0;
+
+// Idle keep-alive connections, guarded by pool_mutex
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FetchConn fetch_pool[FETCH_POOL_SIZE];
+
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static RadioNetStats net_stats;
+static uint64_t phase_total_ms[RADIO_NET_PHASE_COUNT];
+
+static pthread_mutex_t link_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool link_up = false;
+static uint64_t link_checked_ms = 0;    // 0 = never
+static uint64_t offline_until_ms = 0;   // Connections failed for want of a network until then
+static int offline_backoff_ms = 0;      // Next backoff (0 = none yet)
+
+// Sockets from radio_net_connect not yet released, guarded by live_mutex
+static pthread_mutex_t live_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int live_sockets[LIVE_SOCKETS_MAX];
+static int live_count = 0;
+static bool net_aborted = false;        // radio_net_abortAll ran (atomic)
+
+// Session traffic per account (atomic)
+static uint64_t traffic_in[RADIO_NET_ACCOUNT_COUNT];
+static uint64_t traffic_out[RADIO_NET_ACCOUNT_COUNT];
+static uint32_t traffic_capped = 0;
+static bool data_saver = false;
+static __thread RadioNetAccount thread_account = RADIO_NET_ACCOUNT_OTHER;
+
+static uint64_t net_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static bool aborted(void) {
+    return __atomic_load_n(&net_aborted, __ATOMIC_ACQUIRE);
+}
+
+// Keep a connected socket where radio_net_abortAll finds it
+// Returns false (and closes it) if the abort came first.
+static bool live_add(int fd) {
+    pthread_mutex_lock(&live_mutex);
+    bool ok = !aborted();
+    if (ok && live_count < LIVE_SOCKETS_MAX) live_sockets[live_count++] = fd;
+    pthread_mutex_unlock(&live_mutex);
+    if (!ok) close(fd);
+    return ok;
+}
+
+void radio_net_release(int fd) {
+    if (fd < 0) return;
+    pthread_mutex_lock(&live_mutex);
+    for (int i = 0; i < live_count; i++) {
+        if (live_sockets[i] == fd) {
+            live_sockets[i] = live_sockets[--live_count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&live_mutex);
+}
+
+void radio_net_abortAll(void) {
+    pthread_mutex_lock(&live_mutex);
+    __atomic_store_n(&net_aborted, true, __ATOMIC_RELEASE);
+    // Blocked reads, writes and polls on them return at once; the owners close them
+    for (int i = 0; i < live_count; i++) shutdown(live_sockets[i], SHUT_RDWR);
+    pthread_mutex_unlock(&live_mutex);
+}
+
+static void record_phase(RadioNetPhase phase, uint64_t start_ms) {
+#ifdef TRACE_EVENTS
+    static const char* phase_names[RADIO_NET_PHASE_COUNT] = {"net_dns", "net_connect", "net_tls", "net_first_byte"};
+    TRACE_COMPLETE(phase_names[phase], start_ms * 1000);
+#endif
+    int ms = (int)(net_now_ms() - start_ms);
+    pthread_mutex_lock(&stats_mutex);
+    net_stats.count[phase]++;
+    net_stats.last_ms[phase] = ms;
+    if (ms > net_stats.max_ms[phase]) net_stats.max_ms[phase] = ms;
+    phase_total_ms[phase] += ms;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void record_alloc_failure(void) {
+    pthread_mutex_lock(&stats_mutex);
+    net_stats.tls_alloc_failures++;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+static void record_timeout(RadioNetPhase phase) {
+    pthread_mutex_lock(&stats_mutex);
+    net_stats.timeouts[phase]++;
+    pthread_mutex_unlock(&stats_mutex);
+}
+
+void radio_net_getStats(RadioNetStats* stats) {
+    pthread_mutex_lock(&stats_mutex);
+    *stats = net_stats;
+    for (int i = 0; i < RADIO_NET_PHASE_COUNT; i++) {
+        stats->avg_ms[i] = net_stats.count[i] > 0 ? (int)(phase_total_ms[i] / net_stats.count[i]) : 0;
+    }
+    pthread_mutex_unlock(&stats_mutex);
+#ifdef TLS_ARENA
+    // Unlocked reads of the allocator's counters: fine for a stats line
+    size_t used, peak, blocks;
+    mbedtls_memory_buffer_alloc_cur_get(&used, &blocks);
+    mbedtls_memory_buffer_alloc_max_get(&peak, &blocks);
+    stats->tls_arena_kb = TLS_ARENA_SIZE / 1024;
+    stats->tls_in_use_kb = (uint32_t)(used / 1024);
+    stats->tls_peak_kb = (uint32_t)(peak / 1024);
+#endif
+}
+
+void radio_net_resetStats(void) {
+    pthread_mutex_lock(&stats_mutex);
+    memset(&net_stats, 0, sizeof(net_stats));
+    memset(phase_total_ms, 0, sizeof(phase_total_ms));
+    pthread_mutex_unlock(&stats_mutex);
+#ifdef TLS_ARENA
+    mbedtls_memory_buffer_alloc_max_reset();
+#endif
+}
+
+RadioNetAccount radio_net_setAccount(RadioNetAccount account) {
+    RadioNetAccount previous = thread_account;
+    thread_account = account;
+    return previous;
+}
+
+RadioNetAccount radio_net_account(void) {
+    return thread_account;
+}
+
+void radio_net_count(RadioNetAccount account, uint64_t in, uint64_t out) {
+    if (account < 0 || account >= RADIO_NET_ACCOUNT_COUNT) account = RADIO_NET_ACCOUNT_OTHER;
+    if (in) __atomic_fetch_add(&traffic_in[account], in, __ATOMIC_RELAXED);
+    if (out) __atomic_fetch_add(&traffic_out[account], out, __ATOMIC_RELAXED);
+}
+
+void radio_net_getTraffic(RadioNetTraffic* traffic) {
+    for (int i = 0; i < RADIO_NET_ACCOUNT_COUNT; i++) {
+        traffic->in[i] = __atomic_load_n(&traffic_in[i], __ATOMIC_RELAXED);
+        traffic->out[i] = __atomic_load_n(&traffic_out[i], __ATOMIC_RELAXED);
+    }
+    traffic->capped = __atomic_load_n(&traffic_capped, __ATOMIC_RELAXED);
+}
+
+const char* radio_net_accountName(RadioNetAccount account) {
+    static const char* names[RADIO_NET_ACCOUNT_COUNT] = {
+        "other", "stream", "hls", "art", "catalog", "updates", "youtube"
+    };
+    return account >= 0 && account < RADIO_NET_ACCOUNT_COUNT ? names[account] : "?";
+}
+
+void radio_net_setDataSaver(bool enabled) {
+    __atomic_store_n(&data_saver, enabled, __ATOMIC_RELAXED);
+}
+
+bool radio_net_dataSaver(void) {
+    return __atomic_load_n(&data_saver, __ATOMIC_RELAXED);
+}
+
+// Whether the data saver holds the calling thread's account at its cap
+static bool saver_capped(void) {
+    if (!radio_net_dataSaver()) return false;
+    uint64_t cap;
+    switch (thread_account) {
+        case RADIO_NET_ACCOUNT_ART: cap = RADIO_NET_SAVER_ART_CAP; break;
+        case RADIO_NET_ACCOUNT_CATALOG: cap = RADIO_NET_SAVER_CATALOG_CAP; break;
+        default: return false;
+    }
+    uint64_t used = __atomic_load_n(&traffic_in[thread_account], __ATOMIC_RELAXED) +
+                    __atomic_load_n(&traffic_out[thread_account], __ATOMIC_RELAXED);
+    if (used < cap) return false;
+    __atomic_fetch_add(&traffic_capped, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// Keep up to DNS_ADDRS_MAX addresses, alternating families from the resolver's
+// preferred one, so a broken IPv6 (or IPv4) path costs one stagger, not a timeout
+static void dns_collect(const struct addrinfo* result, DnsAddrs* addrs) {
+    memset(addrs, 0, sizeof(*addrs));
+    int first_family = result->ai_family;
+    const struct addrinfo* next[2] = {result, result};   // Preferred family, the other
+    for (int turn = 0; addrs->count < DNS_ADDRS_MAX; turn ^= 1) {
+        const struct addrinfo* ai = next[turn];
+        while (ai && (ai->ai_family == first_family) != (turn == 0)) ai = ai->ai_next;
+        if (!ai) {
+            // This family is used up: the other one fills the rest
+            if (!next[turn ^ 1]) break;
+            next[turn] = NULL;
+            continue;
+        }
+        if ((ai->ai_family == AF_INET || ai->ai_family == AF_INET6) &&
+            ai->ai_addrlen <= sizeof(struct sockaddr_storage)) {
+            memcpy(&addrs->addr[addrs->count], ai->ai_addr, ai->ai_addrlen);
+            addrs->len[addrs->count] = ai->ai_addrlen;
+            addrs->count++;
+        }
+        next[turn] = ai->ai_next;
+    }
+}
+
+static void dns_lookup_free(DnsLookup* lookup) {
+    pthread_mutex_destroy(&lookup->mutex);
+    pthread_cond_destroy(&lookup->cond);
+    free(lookup);
+}
+
+static void* dns_lookup_thread(void* arg) {
+    DnsLookup* lookup = (DnsLookup*)arg;
+
+    // Use getaddrinfo instead of gethostbyname (thread-safe)
+    struct addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_ADDRCONFIG;     // No IPv6 addresses without an IPv6 route
+
+    int ret = getaddrinfo(lookup->host, NULL, &hints, &result);
+    if (ret == 0 && result) {
+        dns_collect(result, &lookup->addrs);
+        if (lookup->addrs.count == 0) ret = EAI_NONAME;
+    } else if (ret == 0) {
+        ret = EAI_NONAME;
+    }
+    if (result) freeaddrinfo(result);
+
+    pthread_mutex_lock(&lookup->mutex);
+    lookup->ret = ret;
+    lookup->done = true;
+    bool abandoned = lookup->abandoned;
+    pthread_cond_signal(&lookup->cond);
+    pthread_mutex_unlock(&lookup->mutex);
+    if (abandoned) dns_lookup_free(lookup);
+    return NULL;
+}
+
+// Resolve host within RADIO_NET_DNS_TIMEOUT_MS
+// Returns 0, a getaddrinfo error, or RADIO_NET_ERR_TIMEOUT.
+static int dns_lookup(const char* host, DnsAddrs* addrs) {
+    DnsLookup* lookup = (DnsLookup*)calloc(1, sizeof(DnsLookup));
+    if (!lookup) return EAI_MEMORY;
+    snprintf(lookup->host, sizeof(lookup->host), "%s", host);
+    pthread_mutex_init(&lookup->mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&lookup->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    pthread_attr_t thread_attr;
+    pthread_attr_init(&thread_attr);
+    pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&thread_attr, 64 * 1024);
+    int created = pthread_create(&thread, &thread_attr, dns_lookup_thread, lookup);
+    pthread_attr_destroy(&thread_attr);
+    if (created != 0) {
+        dns_lookup_free(lookup);
+        return EAI_SYSTEM;
+    }
+
+    // Waited for in slices, so an abort is noticed
+    uint64_t deadline = net_now_ms() + RADIO_NET_DNS_TIMEOUT_MS;
+    pthread_mutex_lock(&lookup->mutex);
+    while (!lookup->done && !aborted()) {
+        uint64_t now = net_now_ms();
+        if (now >= deadline) break;
+        uint64_t wake = now + RADIO_NET_ABORT_CHECK_MS < deadline ? now + RADIO_NET_ABORT_CHECK_MS : deadline;
+        struct timespec ts = {(time_t)(wake / 1000), (long)(wake % 1000) * 1000000};
+        pthread_cond_timedwait(&lookup->cond, &lookup->mutex, &ts);
+    }
+    if (!lookup->done) {
+        // The thread finishes (and frees it) whenever the resolver returns
+        lookup->abandoned = true;
+        pthread_mutex_unlock(&lookup->mutex);
+        return RADIO_NET_ERR_TIMEOUT;
+    }
+    pthread_mutex_unlock(&lookup->mutex);
+
+    int ret = lookup->ret;
+    if (ret == 0) *addrs = lookup->addrs;
+    dns_lookup_free(lookup);
+    return ret;
+}
+
+static void net_unreachable(void);
+
+// Addresses of host, from the cache while fresh
+// Returns 0, or RADIO_NET_ERR_DNS / RADIO_NET_ERR_TIMEOUT.
+static int dns_resolve(const char* host, DnsAddrs* addrs, bool* cached) {
+    uint64_t now = net_now_ms();
+    pthread_mutex_lock(&dns_mutex);
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (dns_cache[i].expires_ms > now && strcmp(dns_cache[i].host, host) == 0) {
+            *addrs = dns_cache[i].addrs;
+            pthread_mutex_unlock(&dns_mutex);
+            *cached = true;
+            return 0;
+        }
+    }
+    pthread_mutex_unlock(&dns_mutex);
+    *cached = false;
+
+    int ret = dns_lookup(host, addrs);
+    if (ret == RADIO_NET_ERR_TIMEOUT) {
+        LOG_ASYNC_error("[RadioNet] DNS lookup for %s timed out\n", host);
+        record_timeout(RADIO_NET_PHASE_DNS);
+        if (!aborted()) net_unreachable();
+        return RADIO_NET_ERR_TIMEOUT;
+    }
+    if (ret != 0) {
+        LOG_ASYNC_error("[RadioNet] getaddrinfo failed for host: %s (error: %d)\n", host, ret);
+        // EAI_AGAIN: no DNS server answered (an unknown name is EAI_NONAME)
+        if (ret == EAI_AGAIN) net_unreachable();
+        return RADIO_NET_ERR_DNS;
+    }
+    record_phase(RADIO_NET_PHASE_DNS, now);
+
+    // Refresh the host's entry, else take an expired one, else the oldest
+    pthread_mutex_lock(&dns_mutex);
+    int slot = -1;
+    for (int i = 0; i < DNS_CACHE_SIZE && slot < 0; i++) {
+        if (strcmp(dns_cache[i].host, host) == 0) slot = i;
+    }
+    for (int i = 0; i < DNS_CACHE_SIZE && slot < 0; i++) {
+        if (dns_cache[i].expires_ms <= now) slot = i;
+    }
+    if (slot < 0) {
+        slot = dns_next;
+        dns_next = (dns_next + 1) % DNS_CACHE_SIZE;
+    }
+    snprintf(dns_cache[slot].host, sizeof(dns_cache[slot].host), "%s", host);
+    dns_cache[slot].addrs = *addrs;
+    dns_cache[slot].expires_ms = now + RADIO_NET_DNS_TTL_MS;
+    pthread_mutex_unlock(&dns_mutex);
+    return 0;
+}
+
+static void dns_forget(const char* host) {
+    pthread_mutex_lock(&dns_mutex);
+    for (int i = 0; i < DNS_CACHE_SIZE; i++) {
+        if (strcmp(dns_cache[i].host, host) == 0) dns_cache[i].expires_ms = 0;
+    }
+    pthread_mutex_unlock(&dns_mutex);
+}
+
+static bool read_link(void) {
+    DIR* dir = opendir("/sys/class/net");
+    if (!dir) return true;      // No sysfs: let the connect tell
+    bool up = false;
+    struct dirent* entry;
+    while (!up && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || strcmp(entry->d_name, "lo") == 0) continue;
+        // carrier reads "1" with a link (and fails on an interface that's down)
+        char path[300];
+        snprintf(path, sizeof(path), "/sys/class/net/%s/carrier", entry->d_name);
+        FILE* f = fopen(path, "r");
+        if (!f) continue;
+        up = fgetc(f) == '1';
+        fclose(f);
+    }
+    closedir(dir);
+    return up;
+}
+
+bool radio_net_online(void) {
+    if (RADIO_REPLAY_PORT() > 0) return true;   // Replaying over loopback
+    pthread_mutex_lock(&link_mutex);
+    uint64_t now = net_now_ms();
+    if (link_checked_ms == 0 || now - link_checked_ms >= RADIO_NET_LINK_TTL_MS) {
+        bool was_up = link_up;
+        link_up = read_link();
+        link_checked_ms = now;
+        // A new link (Wi-Fi reconnected) is worth trying at once
+        if (link_up && !was_up) {
+            offline_until_ms = 0;
+            offline_backoff_ms = 0;
+        }
+    }
+    bool online = link_up && now >= offline_until_ms;
+    pthread_mutex_unlock(&link_mutex);
+    return online;
+}
+
+// A connection failed for want of a network: offline for the next backoff
+static void net_unreachable(void) {
+    pthread_mutex_lock(&link_mutex);
+    if (offline_backoff_ms == 0) offline_backoff_ms = RADIO_NET_OFFLINE_BACKOFF_MS;
+    offline_until_ms = net_now_ms() + offline_backoff_ms;
+    if (offline_backoff_ms < RADIO_NET_OFFLINE_BACKOFF_MAX_MS) {
+        offline_backoff_ms *= 2;
+        if (offline_backoff_ms > RADIO_NET_OFFLINE_BACKOFF_MAX_MS) offline_backoff_ms = RADIO_NET_OFFLINE_BACKOFF_MAX_MS;
+    }
+    pthread_mutex_unlock(&link_mutex);
+}
+
+// A connect got through: whatever failed before, the network is there
+static void net_reachable(void) {
+    pthread_mutex_lock(&link_mutex);
+    offline_until_ms = 0;
+    offline_backoff_ms = 0;
+    pthread_mutex_unlock(&link_mutex);
+}
+
+// Connect errors that say there is no route at all, rather than a server down
+static bool errno_unreachable(int err) {
+    return err == ENETUNREACH || err == ENETDOWN || err == EHOSTUNREACH;
+}
+
+// Start a non-blocking connect to addrs->addr[i]
+// Returns the socket (connected or connecting), or -1 if it failed at once (errno set).
+static int connect_start(const DnsAddrs* addrs, int i, int port) {
+    struct sockaddr_storage sa = addrs->addr[i];
+    if (sa.ss_family == AF_INET6) {
+        ((struct sockaddr_in6*)&sa)->sin6_port = htons(port);
+    } else {
+        ((struct sockaddr_in*)&sa)->sin_port = htons(port);
+    }
+    int fd = socket(sa.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr*)&sa, addrs->len[i]) == 0 || errno == EINPROGRESS) return fd;
+    int err = errno;
+    close(fd);
+    errno = err;
+    return -1;
+}
+
+// Race connects to the addresses, staggered, until one completes
+// Returns the connected (blocking) socket, or RADIO_NET_ERR_CONNECT / RADIO_NET_ERR_TIMEOUT.
+static int connect_race(const DnsAddrs* addrs, int port) {
+    struct pollfd fds[DNS_ADDRS_MAX];
+    int index[DNS_ADDRS_MAX];           // Address each pending socket goes to
+    int pending = 0;
+    int started = 0;
+    int winner = -1;
+    int winner_index = 0;
+    int unreachable = 0;                // Addresses that failed for want of a route
+    uint64_t start = net_now_ms();
+    uint64_t deadline = start + RADIO_NET_CONNECT_TIMEOUT_MS;
+    uint64_t next_start = start;
+
+    while (winner < 0 && !aborted()) {
+        uint64_t now = net_now_ms();
+        if (now >= deadline) break;
+
+        // Next address on schedule, or at once when nothing is left in flight
+        if (started < addrs->count && (now >= next_start || pending == 0)) {
+            int fd = connect_start(addrs, started, port);
+            if (fd >= 0) {
+                fds[pending].fd = fd;
+                fds[pending].events = POLLOUT;
+                index[pending] = started;
+                pending++;
+            } else if (errno_unreachable(errno)) {
+                unreachable++;
+            }
+            started++;
+            next_start = now + RADIO_NET_CONNECT_STAGGER_MS;
+            continue;
+        }
+        if (pending == 0) break;        // Every address failed
+
+        uint64_t wake = started < addrs->count && next_start < deadline ? next_start : deadline;
+        if (wake > now + RADIO_NET_ABORT_CHECK_MS) wake = now + RADIO_NET_ABORT_CHECK_MS;
+        int ready = poll(fds, pending, (int)(wake - now));
+        if (ready < 0 && errno != EINTR) break;
+        if (ready <= 0) continue;
+
+        for (int i = 0; i < pending && winner < 0; i++) {
+            if (!fds[i].revents) continue;
+            int err = 0;
+            socklen_t len = sizeof(err);
+            if (getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0) {
+                winner = fds[i].fd;
+                winner_index = index[i];
+            } else {
+                // Refused or unreachable: the next address goes now
+                if (errno_unreachable(err)) unreachable++;
+                close(fds[i].fd);
+                fds[i] = fds[pending - 1];
+                index[i] = index[pending - 1];
+                pending--;
+                i--;
+                next_start = net_now_ms();
+            }
+        }
+    }
+
+    for (int i = 0; i < pending; i++) {
+        if (fds[i].fd != winner) close(fds[i].fd);
+    }
+    if (winner < 0) {
+        if (aborted()) return RADIO_NET_ERR_CONNECT;
+        if (net_now_ms() >= deadline) {
+            record_timeout(RADIO_NET_PHASE_CONNECT);
+            return RADIO_NET_ERR_TIMEOUT;
+        }
+        if (unreachable == addrs->count) net_unreachable();
+        return RADIO_NET_ERR_CONNECT;
+    }
+
+    record_phase(RADIO_NET_PHASE_CONNECT, start);
+    net_reachable();
+    if (winner_index > 0) {
+        pthread_mutex_lock(&stats_mutex);
+        net_stats.fallbacks++;
+        pthread_mutex_unlock(&stats_mutex);
+    }
+
+    fcntl(winner, F_SETFL, fcntl(winner, F_GETFL) & ~O_NONBLOCK);
+    struct timeval tv = {10, 0};
+    setsockopt(winner, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(winner, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return live_add(winner) ? winner : RADIO_NET_ERR_CONNECT;
+}
+
+int radio_net_connect(const char* host, int port) {
+    if (!radio_net_online()) return RADIO_NET_ERR_OFFLINE;
+    int ret = RADIO_NET_ERR_CONNECT;
+    for (int attempt = 0; attempt < 2 && !aborted(); attempt++) {
+        DnsAddrs addrs;
+        bool cached;
+        ret = dns_resolve(host, &addrs, &cached);
+        if (ret != 0) return ret;
+
+        ret = connect_race(&addrs, port);
+        if (ret >= 0) return ret;
+
+        // The host may have moved: look it up again
+        if (!cached) break;
+        dns_forget(host);
+    }
+    LOG_ASYNC_error("[RadioNet] Connect to %s:%d %s\n", host, port,
+              ret == RADIO_NET_ERR_TIMEOUT ? "timed out" : "failed");
+    return ret;
+}
+
+// The DRBG isn't thread-safe by itself; every TLS context draws from it
+static int locked_random(void* ctx, unsigned char* output, size_t len) {
+    pthread_mutex_lock(&rng_mutex);
+    int ret = mbedtls_ctr_drbg_random(ctx, output, len);
+    pthread_mutex_unlock(&rng_mutex);
+    return ret;
+}
+
+// ChaCha20-Poly1305 and ECDSA first: without AES instructions they cost a
+// fraction of AES-GCM and RSA on these cores. mbedTLS's own order follows.
+static const int preferred_ciphersuites[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+};
+
+// X25519 is the cheapest key exchange enabled
+static const mbedtls_ecp_group_id preferred_curves[] = {
+    MBEDTLS_ECP_DP_CURVE25519,
+    MBEDTLS_ECP_DP_SECP256R1,
+    MBEDTLS_ECP_DP_SECP384R1,
+    MBEDTLS_ECP_DP_NONE
+};
+
+static void tls_order_ciphersuites(void) {
+    int count = 0;
+    int preferred = (int)(sizeof(preferred_ciphersuites) / sizeof(preferred_ciphersuites[0]));
+    for (int i = 0; i < preferred; i++) {
+        if (mbedtls_ssl_ciphersuite_from_id(preferred_ciphersuites[i])) {
+            tls_ciphersuites[count++] = preferred_ciphersuites[i];
+        }
+    }
+    for (const int* id = mbedtls_ssl_list_ciphersuites(); *id != 0 && count < TLS_CIPHERSUITES_MAX - 1; id++) {
+        bool seen = false;
+        for (int i = 0; i < count && !seen; i++) seen = tls_ciphersuites[i] == *id;
+        if (!seen) tls_ciphersuites[count++] = *id;
+    }
+    tls_ciphersuites[count] = 0;
+    mbedtls_ssl_conf_ciphersuites(&tls_conf, tls_ciphersuites);
+}
+
+static void tls_setup(void) {
+    const char* pers = "radio_net";
+#ifdef TLS_ARENA
+    // Before any mbedTLS allocation: until then its calloc fails
+    mbedtls_memory_buffer_alloc_init(tls_arena, sizeof(tls_arena));
+#endif
+    mbedtls_entropy_init(&tls_entropy);
+    mbedtls_ctr_drbg_init(&tls_drbg);
+    mbedtls_ssl_config_init(&tls_conf);
+
+    if (mbedtls_ctr_drbg_seed(&tls_drbg, mbedtls_entropy_func, &tls_entropy,
+                              (const unsigned char*)pers, strlen(pers)) != 0) {
+        LOG_ASYNC_error("[RadioNet] mbedtls_ctr_drbg_seed failed\n");
+        return;
+    }
+    if (mbedtls_ssl_config_defaults(&tls_conf, MBEDTLS_SSL_IS_CLIENT,
+                                    MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+        LOG_ASYNC_error("[RadioNet] mbedtls_ssl_config_defaults failed\n");
+        return;
+    }
+
+    // Skip certificate verification (radio streams use various CAs), so there is
+    // no CA chain to load
+    mbedtls_ssl_conf_authmode(&tls_conf, MBEDTLS_SSL_VERIFY_NONE);
+    mbedtls_ssl_conf_rng(&tls_conf, locked_random, &tls_drbg);
+    mbedtls_ssl_conf_session_tickets(&tls_conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+    mbedtls_ssl_conf_max_frag_len(&tls_conf, MBEDTLS_SSL_MAX_FRAG_LEN_4096);
+    mbedtls_ssl_conf_curves(&tls_conf, preferred_curves);
+    tls_order_ciphersuites();
+    tls_ready = true;
+}
+
+// Offer the last session with host:port for resumption
+static void tls_resume(mbedtls_ssl_context* ssl, const char* host, int port) {
+    pthread_mutex_lock(&session_mutex);
+    for (int i = 0; i < TLS_SESSION_CACHE_SIZE; i++) {
+        TlsSession* s = &tls_sessions[i];
+        if (s->valid && s->port == port && strcmp(s->host, host) == 0) {
+            mbedtls_ssl_set_session(ssl, &s->session);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&session_mutex);
+}
+
+// Keep the session of a finished handshake (a new ticket, or the resumed one)
+static void tls_save(mbedtls_ssl_context* ssl, const char* host, int port) {
+    pthread_mutex_lock(&session_mutex);
+    TlsSession* slot = NULL;
+    for (int i = 0; i < TLS_SESSION_CACHE_SIZE && !slot; i++) {
+        TlsSession* s = &tls_sessions[i];
+        if (s->valid && s->port == port && strcmp(s->host, host) == 0) slot = s;
+    }
+    if (!slot) {
+        slot = &tls_sessions[session_next];
+        session_next = (session_next + 1) % TLS_SESSION_CACHE_SIZE;
+    }
+    if (slot->valid) mbedtls_ssl_session_free(&slot->session);
+    mbedtls_ssl_session_init(&slot->session);
+    slot->valid = mbedtls_ssl_get_session(ssl, &slot->session) == 0;
+    if (!slot->valid) mbedtls_ssl_session_free(&slot->session);
+    snprintf(slot->host, sizeof(slot->host), "%s", host);
+    slot->port = port;
+    pthread_mutex_unlock(&session_mutex);
+}
+
+// Handshake I/O, failing reads once the deadline passes
+typedef struct {
+    mbedtls_net_context* net;
+    uint64_t deadline_ms;
+    bool timed_out;
+} HandshakeBio;
+
+static int handshake_recv(void* ctx, unsigned char* buf, size_t len) {
+    HandshakeBio* bio = (HandshakeBio*)ctx;
+    uint64_t now = net_now_ms();
+    struct pollfd pfd = {bio->net->fd, POLLIN, 0};
+    int ready = now < bio->deadline_ms ? poll(&pfd, 1, (int)(bio->deadline_ms - now)) : 0;
+    if (ready < 0) return errno == EINTR ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_RECV_FAILED;
+    if (ready == 0) {
+        bio->timed_out = true;
+        return MBEDTLS_ERR_SSL_TIMEOUT;
+    }
+    int n = mbedtls_net_recv(bio->net, buf, len);
+    if (n > 0) radio_net_count(thread_account, n, 0);
+    return n;
+}
+
+static int handshake_send(void* ctx, const unsigned char* buf, size_t len) {
+    int n = mbedtls_net_send(((HandshakeBio*)ctx)->net, buf, len);
+    if (n > 0) radio_net_count(thread_account, 0, n);
+    return n;
+}
+
+int radio_net_tls_connect(mbedtls_ssl_context* ssl, mbedtls_net_context* net,
+                          const char* host, int port) {
+    pthread_once(&tls_once, tls_setup);
+    if (!tls_ready) return RADIO_NET_ERR_TLS;
+
+    int ret = mbedtls_ssl_setup(ssl, &tls_conf);
+    if (ret != 0) {
+        if (ret == MBEDTLS_ERR_SSL_ALLOC_FAILED) record_alloc_failure();
+        return RADIO_NET_ERR_TLS;
+    }
+    // Set hostname for SNI
+    if (mbedtls_ssl_set_hostname(ssl, host) != 0) return RADIO_NET_ERR_TLS;
+    tls_resume(ssl, host, port);
+
+    int fd = radio_net_connect(host, port);
+    if (fd < 0) return fd;
+    net->fd = fd;
+
+    // The handshake reads through a deadline-aware BIO; the plain one after
+    uint64_t start = net_now_ms();
+    HandshakeBio bio = {net, start + RADIO_NET_TLS_TIMEOUT_MS, false};
+    mbedtls_ssl_set_bio(ssl, &bio, handshake_send, handshake_recv, NULL);
+
+    do {
+        ret = mbedtls_ssl_handshake(ssl);
+    } while ((ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) && !bio.timed_out);
+    // Never leave ssl pointing at this stack frame (the caller may close_notify)
+    mbedtls_ssl_set_bio(ssl, net, mbedtls_net_send, mbedtls_net_recv, NULL);
+
+    if (bio.timed_out) {
+        LOG_ASYNC_error("[RadioNet] TLS handshake with %s timed out\n", host);
+        record_timeout(RADIO_NET_PHASE_TLS);
+        return RADIO_NET_ERR_TIMEOUT;
+    }
+    if (ret != 0) {
+        if (ret == MBEDTLS_ERR_SSL_ALLOC_FAILED) record_alloc_failure();
+        LOG_ASYNC_error("[RadioNet] TLS handshake with %s failed: %d\n", host, ret);
+        return RADIO_NET_ERR_TLS;
+    }
+    record_phase(RADIO_NET_PHASE_TLS, start);
+    tls_save(ssl, host, port);
+    return 0;
+}
+
+int radio_net_awaitResponse(int fd, mbedtls_ssl_context* ssl) {
+    uint64_t start = net_now_ms();
+    if (ssl && mbedtls_ssl_get_bytes_avail(ssl) > 0) return 0;
+
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready;
+    do {
+        int left = RADIO_NET_FIRST_BYTE_TIMEOUT_MS - (int)(net_now_ms() - start);
+        ready = left > 0 ? poll(&pfd, 1, left) : 0;
+    } while (ready < 0 && errno == EINTR);
+    if (ready <= 0) {
+        record_timeout(RADIO_NET_PHASE_FIRST_BYTE);
+        return RADIO_NET_ERR_TIMEOUT;
+    }
+    // Hangups count too: the read that follows reports them
+    record_phase(RADIO_NET_PHASE_FIRST_BYTE, start);
+    return 0;
+}
+
 // Parse URL into host, port, path, and detect HTTPS
 int radio_net_parse_url(const char* url, char* host, int host_size,
                         int* port, char* path, int path_size, bool* is_https) {
@@ -75,314 +928,662 @@ int radio_net_parse_url(const char* url, char* host, int host_size,
         host[host_len] = '\0';
     }
 
-    return 0;
-}
-
-// Fetch content from URL into buffer
-// Returns bytes read, or -1 on error
-int radio_net_fetch(const char* url, uint8_t* buffer, int buffer_size,
-                    char* content_type, int ct_size) {
-    if (!url || !buffer || buffer_size <= 0) {
-        LOG_error("[RadioNet] Invalid parameters\n");
-        return -1;
+    // Replaying a capture: the loopback server stands in for every host
+    int replay_port = RADIO_REPLAY_PORT();
+    if (replay_port > 0) {
+        snprintf(host, host_size, "127.0.0.1");
+        *port = replay_port;
+        *is_https = false;
     }
 
-    // Use heap for URL components to reduce stack usage
-    char* host = (char*)malloc(256);
-    char* path = (char*)malloc(512);
-    if (!host || !path) {
-        LOG_error("[RadioNet] Failed to allocate host/path buffers\n");
-        free(host);
-        free(path);
-        return -1;
-    }
+    return 0;
+}
 
-    int port;
-    bool is_https;
+// ============== FETCH ==============
 
-    if (radio_net_parse_url(url, host, 256, &port, path, 512, &is_https) != 0) {
-        LOG_error("[RadioNet] Failed to parse URL: %s\n", url);
-        free(host);
-        free(path);
-        return -1;
+static void fetch_close(FetchConn* conn) {
+    radio_net_release(conn->ssl ? conn->ssl->net.fd : conn->fd);
+    if (conn->ssl) {
+        if (conn->ssl->initialized) {
+            mbedtls_ssl_close_notify(&conn->ssl->ssl);
+        }
+        mbedtls_net_free(&conn->ssl->net);
+        mbedtls_ssl_free(&conn->ssl->ssl);
+        mbedtls_free(conn->ssl);
+        conn->ssl = NULL;
+    } else if (conn->fd >= 0) {
+        close(conn->fd);
     }
+    conn->fd = -1;
+    conn->open = false;
+}
 
-    int sock_fd = -1;
-    FetchSSLContext* ssl_ctx = NULL;
-    char* header_buf = NULL;
+static int fetch_open(FetchConn* conn, const char* host, int port, bool is_https) {
+    memset(conn, 0, sizeof(*conn));
+    conn->fd = -1;
+    snprintf(conn->host, sizeof(conn->host), "%s", host);
+    conn->port = port;
+    conn->https = is_https;
 
     if (is_https) {
-        // Allocate SSL context on heap to avoid stack overflow
-        ssl_ctx = (FetchSSLContext*)calloc(1, sizeof(FetchSSLContext));
-        if (!ssl_ctx) {
-            LOG_error("[RadioNet] Failed to allocate SSL context\n");
-            free(host);
-            free(path);
+        // Allocate SSL context on heap to avoid stack overflow (from the TLS
+        // arena when there is one, so set it up first)
+        pthread_once(&tls_once, tls_setup);
+        conn->ssl = (FetchSSLContext*)mbedtls_calloc(1, sizeof(FetchSSLContext));
+        if (!conn->ssl) {
+            record_alloc_failure();
+            LOG_ASYNC_error("[RadioNet] Failed to allocate SSL context\n");
             return -1;
         }
+        mbedtls_net_init(&conn->ssl->net);
+        mbedtls_ssl_init(&conn->ssl->ssl);
 
-        const char* pers = "radio_net_fetch";
-        mbedtls_net_init(&ssl_ctx->net);
-        mbedtls_ssl_init(&ssl_ctx->ssl);
-        mbedtls_ssl_config_init(&ssl_ctx->conf);
-        mbedtls_entropy_init(&ssl_ctx->entropy);
-        mbedtls_ctr_drbg_init(&ssl_ctx->ctr_drbg);
-
-        if (mbedtls_ctr_drbg_seed(&ssl_ctx->ctr_drbg, mbedtls_entropy_func, &ssl_ctx->entropy,
-                                   (const unsigned char*)pers, strlen(pers)) != 0) {
-            goto cleanup;
+        if (radio_net_tls_connect(&conn->ssl->ssl, &conn->ssl->net, host, port) != 0) {
+            fetch_close(conn);
+            return -1;
         }
+        conn->ssl->initialized = true;
+        conn->fd = conn->ssl->net.fd;
+    } else {
+        conn->fd = radio_net_connect(host, port);
+        if (conn->fd < 0) return -1;
+    }
+    conn->open = true;
+    return 0;
+}
 
-        if (mbedtls_ssl_config_defaults(&ssl_ctx->conf, MBEDTLS_SSL_IS_CLIENT,
-                                         MBEDTLS_SSL_TRANSPORT_STREAM,
-                                         MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
-            goto cleanup;
+static int fetch_send(FetchConn* conn, const char* data, int len) {
+    while (len > 0) {
+        int n;
+        if (conn->ssl) {
+            n = mbedtls_ssl_write(&conn->ssl->ssl, (const unsigned char*)data, len);
+            if (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+        } else {
+            n = send(conn->fd, data, len, 0);
         }
+        if (n <= 0) return -1;
+        radio_net_count(thread_account, 0, n);
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
 
-        mbedtls_ssl_conf_authmode(&ssl_ctx->conf, MBEDTLS_SSL_VERIFY_NONE);
-        mbedtls_ssl_conf_rng(&ssl_ctx->conf, mbedtls_ctr_drbg_random, &ssl_ctx->ctr_drbg);
+// Bytes received, 0 when the server closed, < 0 on error
+static int fetch_recv(FetchConn* conn, uint8_t* buf, int len) {
+    int n;
+    if (conn->ssl) {
+        do {
+            n = mbedtls_ssl_read(&conn->ssl->ssl, buf, len);
+        } while (n == MBEDTLS_ERR_SSL_WANT_READ || n == MBEDTLS_ERR_SSL_WANT_WRITE);
+        if (n == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) n = 0;
+    } else {
+        n = recv(conn->fd, buf, len, 0);
+    }
+    if (n > 0) radio_net_count(thread_account, n, 0);
+    return n;
+}
 
-        if (mbedtls_ssl_setup(&ssl_ctx->ssl, &ssl_ctx->conf) != 0) {
-            goto cleanup;
+// An idle connection is only usable if the server has sent nothing since
+// (readable means it closed it, or timed it out)
+static bool fetch_idle_ok(FetchConn* conn) {
+    if (conn->ssl && mbedtls_ssl_get_bytes_avail(&conn->ssl->ssl) > 0) return false;
+    struct pollfd pfd = {conn->fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 0;
+}
+
+// An idle connection to host:port, if the pool has a live one
+static bool pool_take(const char* host, int port, bool is_https, FetchConn* out) {
+    uint64_t now = net_now_ms();
+    bool found = false;
+    pthread_mutex_lock(&pool_mutex);
+    for (int i = 0; i < FETCH_POOL_SIZE && !found; i++) {
+        FetchConn* c = &fetch_pool[i];
+        if (!c->open) continue;
+        bool match = c->port == port && c->https == is_https && strcmp(c->host, host) == 0;
+        if (now - c->idle_since_ms >= FETCH_IDLE_MS || (match && !fetch_idle_ok(c))) {
+            fetch_close(c);
+        } else if (match) {
+            *out = *c;
+            c->open = false;
+            found = true;
         }
+    }
+    pthread_mutex_unlock(&pool_mutex);
+    return found;
+}
 
-        mbedtls_ssl_set_hostname(&ssl_ctx->ssl, host);
+// Keep a connection whose response was read to the end for the next fetch
+static void pool_put(FetchConn* conn) {
+    pthread_mutex_lock(&pool_mutex);
+    FetchConn* slot = NULL;
+    for (int i = 0; i < FETCH_POOL_SIZE; i++) {
+        FetchConn* c = &fetch_pool[i];
+        if (!c->open) {
+            slot = c;
+            break;
+        }
+        if (!slot || c->idle_since_ms < slot->idle_since_ms) slot = c;
+    }
+    if (slot->open) fetch_close(slot);   // Full: the longest idle goes
+    *slot = *conn;
+    slot->idle_since_ms = net_now_ms();
+    pthread_mutex_unlock(&pool_mutex);
+}
 
-        char port_str[16];
-        snprintf(port_str, sizeof(port_str), "%d", port);
+static int reader_byte(FetchReader* r) {
+    if (r->pos == r->len) {
+        int n = fetch_recv(r->conn, r->buf, sizeof(r->buf));
+        if (n <= 0) return -1;
+        r->pos = 0;
+        r->len = n;
+    }
+    return r->buf[r->pos++];
+}
 
-        if (mbedtls_net_connect(&ssl_ctx->net, host, port_str, MBEDTLS_NET_PROTO_TCP) != 0) {
-            goto cleanup;
-        }
+// Up to len buffered bytes (receiving more if none are left), consumed
+// Returns their count with *data set, or <= 0 at the end of the stream.
+static int reader_span(FetchReader* r, int len, const uint8_t** data) {
+    if (r->pos == r->len) {
+        int n = fetch_recv(r->conn, r->buf, sizeof(r->buf));
+        if (n <= 0) return n;
+        r->pos = 0;
+        r->len = n;
+    }
+    int n = r->len - r->pos;
+    if (n > len) n = len;
+    *data = r->buf + r->pos;
+    r->pos += n;
+    return n;
+}
 
-        mbedtls_ssl_set_bio(&ssl_ctx->ssl, &ssl_ctx->net, mbedtls_net_send, mbedtls_net_recv, NULL);
+// Body bytes to the sink; what doesn't fit a buffer is dropped
+static void sink_put(FetchSink* sink, const uint8_t* data, int len) {
+    RADIO_CAPTURE_DATA(sink->capture_id, data, len);
+    if (sink->on_data) {
+        if (!sink->on_data(sink->ctx, data, len)) sink->aborted = true;
+        sink->total += len;
+        return;
+    }
+    int n = sink->room - sink->total;
+    if (n > len) n = len;
+    if (n <= 0) return;
+    memcpy(sink->buffer + sink->total, data, n);
+    sink->total += n;
+}
 
-        int ret;
-        while ((ret = mbedtls_ssl_handshake(&ssl_ctx->ssl)) != 0) {
-            if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
-                goto cleanup;
-            }
+// Decode gzip-encoded body bytes into the sink
+static void sink_put_gzip(FetchSink* sink, const uint8_t* data, int len) {
+    z_stream* z = sink->gzip;
+    z->next_in = (Bytef*)data;
+    z->avail_in = len;
+    do {
+        z->next_out = sink->gzip_out;
+        z->avail_out = GZIP_CHUNK;
+        int ret = inflate(z, Z_NO_FLUSH);
+        if (ret == Z_BUF_ERROR) break;      // Nothing pending
+        if (ret != Z_OK && ret != Z_STREAM_END) {
+            LOG_ASYNC_error("[RadioNet] Bad gzip body\n");
+            sink->aborted = true;
+            return;
         }
+        sink_put(sink, sink->gzip_out, GZIP_CHUNK - z->avail_out);
+        if (ret == Z_STREAM_END) break;
+    } while (!sink->aborted && (z->avail_in > 0 || z->avail_out == 0));
+}
 
-        ssl_ctx->initialized = true;
-        sock_fd = ssl_ctx->net.fd;
+static void body_put(FetchSink* sink, const uint8_t* data, int len) {
+    if (sink->gzip) {
+        sink_put_gzip(sink, data, len);
     } else {
-        // Use getaddrinfo instead of gethostbyname (thread-safe)
-        struct addrinfo hints, *result = NULL;
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-
-        char port_str[16];
-        snprintf(port_str, sizeof(port_str), "%d", port);
-
-        int gai_ret = getaddrinfo(host, port_str, &hints, &result);
-        if (gai_ret != 0 || !result) {
-            LOG_error("[RadioNet] getaddrinfo failed for host: %s (error: %d)\n", host, gai_ret);
-            if (result) freeaddrinfo(result);
-            free(host);
-            free(path);
-            return -1;
-        }
+        sink_put(sink, data, len);
+    }
+}
 
-        sock_fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
-        if (sock_fd < 0) {
-            LOG_error("[RadioNet] socket() failed\n");
-            freeaddrinfo(result);
-            free(host);
-            free(path);
-            return -1;
-        }
+static bool gzip_begin(FetchSink* sink) {
+    sink->gzip = calloc(1, sizeof(z_stream));
+    sink->gzip_out = malloc(GZIP_CHUNK);
+    // 16 + MAX_WBITS: gzip wrapper
+    if (sink->gzip && sink->gzip_out && inflateInit2(sink->gzip, 16 + MAX_WBITS) == Z_OK) return true;
+    free(sink->gzip);
+    free(sink->gzip_out);
+    sink->gzip = NULL;
+    sink->gzip_out = NULL;
+    return false;
+}
 
-        struct timeval tv = {10, 0};
-        setsockopt(sock_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
-        setsockopt(sock_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+static void gzip_end(FetchSink* sink) {
+    if (!sink->gzip) return;
+    inflateEnd(sink->gzip);
+    free(sink->gzip);
+    free(sink->gzip_out);
+    sink->gzip = NULL;
+    sink->gzip_out = NULL;
+}
 
-        if (connect(sock_fd, result->ai_addr, result->ai_addrlen) < 0) {
-            close(sock_fd);
-            freeaddrinfo(result);
-            free(host);
-            free(path);
-            return -1;
+// One line without its CRLF; false at the end of the stream or if it doesn't fit
+static bool reader_line(FetchReader* r, char* line, int size) {
+    int len = 0;
+    int c;
+    while ((c = reader_byte(r)) >= 0) {
+        if (c == '\n') {
+            if (len > 0 && line[len - 1] == '\r') len--;
+            line[len] = '\0';
+            return true;
         }
-        freeaddrinfo(result);
+        if (len >= size - 1) return false;
+        line[len++] = (char)c;
+    }
+    return false;
+}
+
+// Pass len body bytes to the sink
+// Returns false if the stream ended first or the sink aborted.
+static bool read_body(FetchReader* r, int len, FetchSink* sink) {
+    while (len > 0 && !sink->aborted) {
+        const uint8_t* data;
+        int n = reader_span(r, len, &data);
+        if (n <= 0) return false;
+        body_put(sink, data, n);
+        len -= n;
     }
+    return !sink->aborted;
+}
+
+// Send the request and read the response on conn
+// Returns the body bytes taken by the sink, FETCH_REDIRECT (redirect_url set),
+// RADIO_NET_NOT_MODIFIED, FETCH_STALE when a reused connection turned out to be
+// closed, or -1. *reusable tells whether the
+// response was read to its end on a connection the server keeps open.
+#define FETCH_REDIRECT -2
+#define FETCH_STALE -3
+static int fetch_on(FetchConn* conn, bool reused, const char* host, const char* path,
+                    FetchSink* sink, char* content_type, int ct_size,
+                    char* redirect_url, int redirect_size, bool* reusable) {
+    *reusable = false;
 
     // Send HTTP request (use HTTP/1.1 with proper headers for CDN compatibility)
-    char request[512];
-    snprintf(request, sizeof(request),
-        "GET %s HTTP/1.1\r\n"
+    char request[2560];
+    int req_len = snprintf(request, sizeof(request),
+        "%s %s HTTP/1.1\r\n"
         "Host: %s\r\n"
         "User-Agent: Mozilla/5.0 (Linux) AppleWebKit/537.36\r\n"
         "Accept: */*\r\n"
-        "Accept-Encoding: identity\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        path, host);
+        "Accept-Encoding: %s\r\n"
+        "Connection: keep-alive\r\n",
+        sink->post_data ? "POST" : "GET", path, host,
+        // Ranges are of the encoded body: only plain ones can be used
+        sink->range_length > 0 ? "identity" : "gzip");
+    if (sink->post_data && req_len < (int)sizeof(request)) {
+        req_len += snprintf(request + req_len, sizeof(request) - req_len,
+                            "Content-Type: %s\r\nContent-Length: %d\r\n",
+                            sink->post_type, (int)strlen(sink->post_data));
+    }
+    if (sink->headers && req_len < (int)sizeof(request)) {
+        req_len += snprintf(request + req_len, sizeof(request) - req_len, "%s", sink->headers);
+    }
+    RadioNetValidators* v = sink->validators;
+    if (v && v->etag[0] && req_len < (int)sizeof(request)) {
+        req_len += snprintf(request + req_len, sizeof(request) - req_len,
+                            "If-None-Match: %s\r\n", v->etag);
+    }
+    if (v && v->last_modified[0] && req_len < (int)sizeof(request)) {
+        req_len += snprintf(request + req_len, sizeof(request) - req_len,
+                            "If-Modified-Since: %s\r\n", v->last_modified);
+    }
+    if (sink->range_length > 0 && req_len < (int)sizeof(request)) {
+        if (sink->range_offset < 0) {
+            req_len += snprintf(request + req_len, sizeof(request) - req_len,
+                                "Range: bytes=-%lld\r\n", (long long)sink->range_length);
+        } else {
+            req_len += snprintf(request + req_len, sizeof(request) - req_len, "Range: bytes=%lld-%lld\r\n",
+                                (long long)sink->range_offset,
+                                (long long)(sink->range_offset + sink->range_length - 1));
+        }
+    }
+    if (req_len < (int)sizeof(request)) {
+        snprintf(request + req_len, sizeof(request) - req_len, "\r\n");
+    }
 
-    int sent;
-    if (is_https) {
-        sent = mbedtls_ssl_write(&ssl_ctx->ssl, (unsigned char*)request, strlen(request));
-    } else {
-        sent = send(sock_fd, request, strlen(request), 0);
+    if (fetch_send(conn, request, strlen(request)) != 0 ||
+        (sink->post_data && fetch_send(conn, sink->post_data, strlen(sink->post_data)) != 0)) {
+        return reused ? FETCH_STALE : -1;
+    }
+    if (radio_net_awaitResponse(conn->fd, conn->ssl ? &conn->ssl->ssl : NULL) != 0) {
+        LOG_ASYNC_error("[RadioNet] No response from %s\n", host);
+        return reused ? FETCH_STALE : -1;
     }
 
-    if (sent < 0) {
-        goto cleanup;
+    // Reader on the heap to reduce stack pressure
+    FetchReader* r = (FetchReader*)malloc(sizeof(FetchReader));
+    if (!r) {
+        LOG_ASYNC_error("[RadioNet] Failed to allocate reader\n");
+        return -1;
     }
+    r->conn = conn;
+    r->pos = r->len = 0;
 
-    // Read response - allocate header buffer on heap to reduce stack pressure
-    #define HEADER_BUF_SIZE 2048
-    header_buf = (char*)malloc(HEADER_BUF_SIZE);
-    if (!header_buf) {
-        LOG_error("[RadioNet] Failed to allocate header buffer\n");
-        goto cleanup;
+    // Status line: nothing at all on a reused connection means the server had closed it
+    char line[2048];
+    if (!reader_line(r, line, sizeof(line))) {
+        free(r);
+        return reused ? FETCH_STALE : -1;
+    }
+    int status = 0;
+    bool keep_alive = false;
+    if (strncmp(line, "HTTP/1.", 7) == 0) {
+        keep_alive = line[7] == '1';    // HTTP/1.1 keeps the connection unless told otherwise
+        status = atoi(line + 9);
     }
-    int header_pos = 0;
-    bool headers_done = false;
 
-    // Read headers
-    while (header_pos < HEADER_BUF_SIZE - 1) {
-        char c;
-        int r;
-        if (is_https) {
-            r = mbedtls_ssl_read(&ssl_ctx->ssl, (unsigned char*)&c, 1);
-        } else {
-            r = recv(sock_fd, &c, 1, 0);
+    // Headers
+    long content_length = -1;
+    bool chunked = false;
+    bool gzipped = false;
+    bool have_location = false;
+    char etag[sizeof(v->etag)] = "";
+    char last_modified[sizeof(v->last_modified)] = "";
+    if (content_type && ct_size > 0) content_type[0] = '\0';
+    while (true) {
+        if (!reader_line(r, line, sizeof(line))) {
+            free(r);
+            return -1;
         }
-        if (r != 1) break;
+        if (line[0] == '\0') break;
 
-        header_buf[header_pos++] = c;
-        if (header_pos >= 4 &&
-            header_buf[header_pos-4] == '\r' && header_buf[header_pos-3] == '\n' &&
-            header_buf[header_pos-2] == '\r' && header_buf[header_pos-1] == '\n') {
-            headers_done = true;
-            break;
+        char* value = strchr(line, ':');
+        if (!value) continue;
+        *value++ = '\0';
+        while (*value == ' ' || *value == '\t') value++;
+
+        if (strcasecmp(line, "Content-Length") == 0) {
+            content_length = atol(value);
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+            chunked = strcasestr(value, "chunked") != NULL;
+        } else if (strcasecmp(line, "Content-Encoding") == 0) {
+            gzipped = strcasestr(value, "gzip") != NULL;
+        } else if (strcasecmp(line, "Connection") == 0) {
+            if (strcasestr(value, "close")) keep_alive = false;
+            else if (strcasestr(value, "keep-alive")) keep_alive = true;
+        } else if (strcasecmp(line, "ETag") == 0) {
+            snprintf(etag, sizeof(etag), "%s", value);
+        } else if (strcasecmp(line, "Last-Modified") == 0) {
+            snprintf(last_modified, sizeof(last_modified), "%s", value);
+        } else if (strcasecmp(line, "Location") == 0) {
+            snprintf(redirect_url, redirect_size, "%s", value);
+            have_location = true;
+        } else if (strcasecmp(line, "Content-Type") == 0 && content_type && ct_size > 0) {
+            int len = strcspn(value, ";");
+            if (len < ct_size) {
+                memcpy(content_type, value, len);
+                content_type[len] = '\0';
+            }
         }
     }
-    header_buf[header_pos] = '\0';
 
-    if (!headers_done) {
-        goto cleanup;
+    // Redirects are followed on a new request; this connection isn't reused
+    if (status >= 300 && status < 400 && status != 304 && have_location) {
+        free(r);
+        return FETCH_REDIRECT;
     }
 
-    // Find end of first line (status line) for redirect detection
-    char* first_line_end = strstr(header_buf, "\r\n");
+    // Unchanged since the validators were taken: no body follows
+    if (status == 304) {
+        *reusable = keep_alive && r->pos == r->len;
+        free(r);
+        return RADIO_NET_NOT_MODIFIED;
+    }
 
-    // Check for redirect - only check the status line (first line), not entire headers
-    bool is_redirect = false;
-    if (first_line_end) {
-        char* status_start = strstr(header_buf, "HTTP/");
-        if (status_start && status_start < first_line_end) {
-            is_redirect = (strstr(status_start, " 301 ") && strstr(status_start, " 301 ") < first_line_end) ||
-                         (strstr(status_start, " 302 ") && strstr(status_start, " 302 ") < first_line_end) ||
-                         (strstr(status_start, " 303 ") && strstr(status_start, " 303 ") < first_line_end) ||
-                         (strstr(status_start, " 307 ") && strstr(status_start, " 307 ") < first_line_end) ||
-                         (strstr(status_start, " 308 ") && strstr(status_start, " 308 ") < first_line_end);
-        }
+    // Error pages aren't content
+    if (status >= 400) {
+        LOG_ASYNC_error("[RadioNet] HTTP %d for %s\n", status, path);
+        free(r);
+        return -1;
     }
-    if (is_redirect) {
-        char* loc = strcasestr(header_buf, "\nLocation:");
-        if (loc) {
-            loc += 10;
-            while (*loc == ' ') loc++;
-            char* end = loc;
-            while (*end && *end != '\r' && *end != '\n') end++;
-
-            // Copy redirect URL before cleanup
-            char redirect_url[1024];
-            int rlen = end - loc;
-            if (rlen >= (int)sizeof(redirect_url)) rlen = sizeof(redirect_url) - 1;
-            strncpy(redirect_url, loc, rlen);
-            redirect_url[rlen] = '\0';
-
-            // Cleanup current connection and buffers before recursive call
-            if (ssl_ctx) {
-                mbedtls_ssl_close_notify(&ssl_ctx->ssl);
-                mbedtls_net_free(&ssl_ctx->net);
-                mbedtls_ssl_free(&ssl_ctx->ssl);
-                mbedtls_ssl_config_free(&ssl_ctx->conf);
-                mbedtls_ctr_drbg_free(&ssl_ctx->ctr_drbg);
-                mbedtls_entropy_free(&ssl_ctx->entropy);
-                free(ssl_ctx);
-            } else {
-                close(sock_fd);
-            }
-            free(header_buf);
-            free(host);
-            free(path);
 
-            // Follow redirect
-            return radio_net_fetch(redirect_url, buffer, buffer_size, content_type, ct_size);
-        }
-        goto cleanup;
-    }
-
-    // Extract content type if requested
-    if (content_type && ct_size > 0) {
-        content_type[0] = '\0';
-        char* ct = strcasestr(header_buf, "\nContent-Type:");
-        if (ct) {
-            ct += 14;
-            while (*ct == ' ') ct++;
-            char* end = ct;
-            while (*end && *end != '\r' && *end != '\n' && *end != ';') end++;
-            int len = end - ct;
-            if (len < ct_size) {
-                strncpy(content_type, ct, len);
-                content_type[len] = '\0';
+    // A server ignoring the range would send the whole resource
+    if (sink->range_length > 0 && status != 206) {
+        LOG_ASYNC_error("[RadioNet] Range not served (HTTP %d)\n", status);
+        free(r);
+        return -1;
+    }
+    if (v && status == 200) {
+        memcpy(v->etag, etag, sizeof(etag));
+        memcpy(v->last_modified, last_modified, sizeof(last_modified));
+    }
+    if (gzipped && !gzip_begin(sink)) {
+        free(r);
+        return -1;
+    }
+
+    // Body: chunked, sized, or up to the end of the connection
+    bool complete;
+    if (chunked) {
+        complete = false;
+        while (reader_line(r, line, sizeof(line))) {
+            long size = strtol(line, NULL, 16);
+            if (size <= 0) {
+                // Last chunk: skip any trailer headers up to the blank line
+                while (reader_line(r, line, sizeof(line))) {
+                    if (line[0] == '\0') {
+                        complete = true;
+                        break;
+                    }
+                }
+                break;
             }
+            if (!read_body(r, (int)size, sink)) break;
+            if (!reader_line(r, line, sizeof(line))) break;     // CRLF after the chunk
         }
+    } else if (content_length >= 0) {
+        complete = read_body(r, (int)content_length, sink);
+    } else {
+        // A full buffer ends it early: the connection is closed anyway
+        while (!sink->aborted && (sink->on_data || sink->total < sink->room)) {
+            const uint8_t* data;
+            int n = reader_span(r, (int)sizeof(r->buf), &data);
+            if (n <= 0) break;
+            body_put(sink, data, n);
+        }
+        complete = false;
+        keep_alive = false;
     }
 
-    // Read body
-    int total_read = 0;
-    while (total_read < buffer_size - 1) {
-        int r;
-        if (is_https) {
-            r = mbedtls_ssl_read(&ssl_ctx->ssl, buffer + total_read, buffer_size - total_read - 1);
-            if (r == MBEDTLS_ERR_SSL_WANT_READ || r == MBEDTLS_ERR_SSL_WANT_WRITE) continue;
+    // Reusable only if the response ended exactly here; a body cut short to fit the
+    // buffer was still read to its end
+    *reusable = keep_alive && complete && r->pos == r->len;
+    free(r);
+    gzip_end(sink);
+    return sink->aborted ? -1 : sink->total;
+}
+
+// Fetch url into the sink, following redirects
+static int fetch_url(const char* url, FetchSink* sink, char* content_type, int ct_size) {
+    // Use heap for URL components to reduce stack usage
+    char* host = (char*)malloc(256);
+    char* path = (char*)malloc(2048);     // Signed CDN redirects run long
+    char* redirect_url = (char*)malloc(2048);
+    if (!host || !path || !redirect_url) {
+        LOG_ASYNC_error("[RadioNet] Failed to allocate host/path buffers\n");
+        free(host);
+        free(path);
+        free(redirect_url);
+        return -1;
+    }
+
+    int port;
+    bool is_https;
+
+    if (radio_net_parse_url(url, host, 256, &port, path, 2048, &is_https) != 0) {
+        LOG_ASYNC_error("[RadioNet] Failed to parse URL: %s\n", url);
+        free(host);
+        free(path);
+        free(redirect_url);
+        return -1;
+    }
+    if (saver_capped()) {
+        LOG_ASYNC_info("[RadioNet] Data saver: %s traffic at its cap, skipping %s\n",
+                       radio_net_accountName(thread_account), host);
+        free(host);
+        free(path);
+        free(redirect_url);
+        return -1;
+    }
+
+    // A pooled connection the server has dropped in the meantime is retried fresh
+    int result = -1;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        FetchConn conn;
+        bool reused = pool_take(host, port, is_https, &conn);
+        if (!reused && fetch_open(&conn, host, port, is_https) != 0) break;
+
+        bool reusable;
+        result = fetch_on(&conn, reused, host, path, sink, content_type, ct_size,
+                          redirect_url, 2048, &reusable);
+        if (reusable) {
+            pool_put(&conn);
         } else {
-            r = recv(sock_fd, buffer + total_read, buffer_size - total_read - 1, 0);
+            fetch_close(&conn);
         }
-        if (r <= 0) break;
-        total_read += r;
-    }
-
-    // Cleanup
-    if (ssl_ctx) {
-        mbedtls_ssl_close_notify(&ssl_ctx->ssl);
-        mbedtls_net_free(&ssl_ctx->net);
-        mbedtls_ssl_free(&ssl_ctx->ssl);
-        mbedtls_ssl_config_free(&ssl_ctx->conf);
-        mbedtls_ctr_drbg_free(&ssl_ctx->ctr_drbg);
-        mbedtls_entropy_free(&ssl_ctx->entropy);
-        free(ssl_ctx);
-    } else {
-        close(sock_fd);
+        if (result != FETCH_STALE) break;
+        result = -1;
     }
 
-    free(header_buf);
     free(host);
     free(path);
-    return total_read;
+    if (result == FETCH_REDIRECT) {
+        // Follow redirect
+        result = fetch_url(redirect_url, sink, content_type, ct_size);
+    }
+    free(redirect_url);
+    return result;
+}
 
-cleanup:
-    if (ssl_ctx) {
-        if (ssl_ctx->initialized) {
-            mbedtls_ssl_close_notify(&ssl_ctx->ssl);
-        }
-        mbedtls_net_free(&ssl_ctx->net);
-        mbedtls_ssl_free(&ssl_ctx->ssl);
-        mbedtls_ssl_config_free(&ssl_ctx->conf);
-        mbedtls_ctr_drbg_free(&ssl_ctx->ctr_drbg);
-        mbedtls_entropy_free(&ssl_ctx->entropy);
-        free(ssl_ctx);
-    } else if (sock_fd >= 0) {
-        close(sock_fd);
-    }
-    free(header_buf);
-    free(host);
-    free(path);
-    return -1;
+// fetch_url, recorded in RADIO_CAPTURE builds (whole responses only, not ranges)
+static int fetch_captured(const char* url, FetchSink* sink, char* content_type, int ct_size) {
+    sink->capture_id = RADIO_CAPTURE_OPEN(url);
+    int result = fetch_url(url, sink, content_type, ct_size);
+    RADIO_CAPTURE_CLOSE(sink->capture_id, result >= 0 && !sink->aborted, false,
+                        result >= 0 ? content_type : NULL, 0, 0, NULL);
+    return result;
+}
+
+// Fetch content from URL into buffer
+// Returns bytes read, or -1 on error
+int radio_net_fetch(const char* url, uint8_t* buffer, int buffer_size,
+                    char* content_type, int ct_size) {
+    if (!url || !buffer || buffer_size <= 0) {
+        LOG_ASYNC_error("[RadioNet] Invalid parameters\n");
+        return -1;
+    }
+    FetchSink sink = {buffer, buffer_size - 1, NULL, NULL, 0, false, NULL};
+    return fetch_captured(url, &sink, content_type, ct_size);
+}
+
+int radio_net_fetchStream(const char* url, RadioNetDataFunc on_data, void* ctx) {
+    if (!url || !on_data) {
+        LOG_ASYNC_error("[RadioNet] Invalid parameters\n");
+        return -1;
+    }
+    FetchSink sink = {NULL, 0, on_data, ctx, 0, false, NULL};
+    return fetch_captured(url, &sink, NULL, 0);
+}
+
+bool radio_net_bodyAppend(RadioNetBody* body, const uint8_t* data, int len, int max_size) {
+    if (body->len + len > max_size) return false;
+    if (body->len + len + 1 > body->cap) {
+        int cap = body->cap ? body->cap : 16 * 1024;
+        while (cap < body->len + len + 1) cap *= 2;
+        uint8_t* grown = realloc(body->data, cap);
+        if (!grown) return false;
+        body->data = grown;
+        body->cap = cap;
+    }
+    memcpy(body->data + body->len, data, len);
+    body->len += len;
+    body->data[body->len] = '\0';
+    return true;
+}
+
+void radio_net_freeBody(RadioNetBody* body) {
+    free(body->data);
+    body->data = NULL;
+    body->len = body->cap = 0;
+}
+
+typedef struct {
+    RadioNetBody* body;
+    int max_size;
+} BodySink;
+
+static bool on_body_data(void* ctx, const uint8_t* data, int len) {
+    BodySink* b = (BodySink*)ctx;
+    return radio_net_bodyAppend(b->body, data, len, b->max_size);
+}
+
+int radio_net_fetchBody(const char* url, RadioNetBody* body, int max_size,
+                        RadioNetValidators* validators) {
+    if (!url || !body || max_size <= 0) {
+        LOG_ASYNC_error("[RadioNet] Invalid parameters\n");
+        return -1;
+    }
+    BodySink b = {body, max_size};
+    FetchSink sink = {NULL, 0, on_body_data, &b, 0, false, validators};
+    int result = fetch_captured(url, &sink, NULL, 0);
+    // An empty body is still a string
+    if (result >= 0 && !radio_net_bodyAppend(body, (const uint8_t*)"", 0, max_size)) return -1;
+    return result;
+}
+
+int radio_net_postBody(const char* url, const char* content_type, const char* data,
+                       const char* headers, RadioNetBody* body, int max_size) {
+    if (!url || !content_type || !data || !body || max_size <= 0) {
+        LOG_ASYNC_error("[RadioNet] Invalid parameters\n");
+        return -1;
+    }
+    BodySink b = {body, max_size};
+    FetchSink sink = {NULL, 0, on_body_data, &b, 0, false, NULL};
+    sink.post_data = data;
+    sink.post_type = content_type;
+    sink.headers = headers;
+    int result = fetch_url(url, &sink, NULL, 0);
+    if (result >= 0 && !radio_net_bodyAppend(body, (const uint8_t*)"", 0, max_size)) return -1;
+    return result;
+}
+
+int radio_net_fetchRange(const char* url, int64_t offset, int64_t length,
+                         RadioNetDataFunc on_data, void* ctx) {
+    if (!url || length <= 0 || !on_data) {
+        LOG_ASYNC_error("[RadioNet] Invalid parameters\n");
+        return -1;
+    }
+    FetchSink sink = {NULL, 0, on_data, ctx, 0, false, NULL, offset, length};
+    return fetch_url(url, &sink, NULL, 0);
+}
+
+int radio_net_prewarm(const char* url, bool connect) {
+    char host[256], path[1024];
+    int port;
+    bool is_https;
+    if (radio_net_parse_url(url, host, sizeof(host), &port, path, sizeof(path), &is_https) != 0) {
+        return RADIO_NET_ERR_DNS;
+    }
+    if (!radio_net_online()) return RADIO_NET_ERR_OFFLINE;
+    pthread_once(&tls_once, tls_setup);    // The DRBG seed, paid once
+
+    if (!connect || !is_https) {
+        DnsAddrs addrs;
+        bool cached;
+        return dns_resolve(host, &addrs, &cached);
+    }
+
+    // A live pooled connection is warm already (and stays pooled)
+    FetchConn conn;
+    if (pool_take(host, port, is_https, &conn)) {
+        pool_put(&conn);
+        return 0;
+    }
+    if (fetch_open(&conn, host, port, is_https) != 0) return RADIO_NET_ERR_CONNECT;
+    pool_put(&conn);
+    return 0;
 }
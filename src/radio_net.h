@@ -4,15 +4,224 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/ssl.h"
+
 // Parse URL into components
 // Returns 0 on success, -1 on error
 int radio_net_parse_url(const char* url, char* host, int host_size,
                         int* port, char* path, int path_size, bool* is_https);
 
-// Fetch content from URL into buffer
+// Fetch content from URL into buffer (what doesn't fit is dropped; see
+// radio_net_fetchBody for bodies of unknown size)
 // Returns bytes read on success, -1 on error
 // content_type and ct_size are optional (can be NULL/0)
+// Connections are HTTP/1.1 keep-alive: one whose response was read to its end
+// goes back to a small pool (per host:port, idle up to 30 s) for the next fetch,
+// so HLS playlist and segment requests skip the connect and TLS handshake.
+// Redirects are followed, chunked bodies decoded, and every fetch but a range
+// one asks for gzip, which arrives decoded. Error statuses (400 and up) fail.
 int radio_net_fetch(const char* url, uint8_t* buffer, int buffer_size,
                     char* content_type, int ct_size);
 
+// Validators of a fetched resource, for conditional requests (empty = none)
+typedef struct {
+    char etag[128];
+    char last_modified[64];
+} RadioNetValidators;
+
+#define RADIO_NET_NOT_MODIFIED (-4)
+
+// Takes body bytes as they arrive; returning false aborts the fetch
+typedef bool (*RadioNetDataFunc)(void* ctx, const uint8_t* data, int len);
+
+// Fetch URL like radio_net_fetch, handing the body to on_data as it arrives
+// instead of buffering it
+// Returns the body bytes received, or -1 on error or when on_data aborted.
+int radio_net_fetchStream(const char* url, RadioNetDataFunc on_data, void* ctx);
+
+// Response body in memory, grown as it arrives and kept NUL-terminated
+typedef struct {
+    uint8_t* data;              // NULL until something arrives
+    int len;
+    int cap;
+} RadioNetBody;
+
+// Fetch URL into body (empty to begin with; radio_net_freeBody after). With
+// validators the request is conditional (If-None-Match / If-Modified-Since) and a
+// 200 response replaces them. Larger bodies than max_size fail the fetch.
+// Returns the body length, RADIO_NET_NOT_MODIFIED on 304, or -1 on error.
+int radio_net_fetchBody(const char* url, RadioNetBody* body, int max_size,
+                        RadioNetValidators* validators);
+
+// POST data (content_type; headers: more request header lines ending in CRLF, or
+// NULL) to URL and read the response into body like radio_net_fetchBody. Redirects
+// repeat the POST. Not recorded by RADIO_CAPTURE.
+// Returns the body length, or -1 on error.
+int radio_net_postBody(const char* url, const char* content_type, const char* data,
+                       const char* headers, RadioNetBody* body, int max_size);
+
+// Append to body, for RadioNetDataFunc callbacks of their own
+// Returns false if it would grow past max_size (or out of memory).
+bool radio_net_bodyAppend(RadioNetBody* body, const uint8_t* data, int len, int max_size);
+
+void radio_net_freeBody(RadioNetBody* body);
+
+// Fetch bytes [offset, offset + length) of URL like radio_net_fetchStream, or with
+// offset < 0 its last length bytes. A server that doesn't answer with the range
+// (206) fails the fetch.
+// Returns the body bytes received, or -1.
+int radio_net_fetchRange(const char* url, int64_t offset, int64_t length,
+                         RadioNetDataFunc on_data, void* ctx);
+
+// Connectivity, shared by everything that uses the network
+// Online means a network interface other than loopback has a link (its carrier,
+// read from sysfs and kept RADIO_NET_LINK_TTL_MS: the Wi-Fi module's interface
+// once it has associated), and connections haven't been failing for want of a
+// network (a lookup that reached no DNS server, a connect to an unreachable
+// network). Such a failure takes the device offline for
+// RADIO_NET_OFFLINE_BACKOFF_MS, doubled up to RADIO_NET_OFFLINE_BACKOFF_MAX_MS
+// while it repeats; a link coming back up or any connect that succeeds ends it.
+// Offline, radio_net_connect fails at once (RADIO_NET_ERR_OFFLINE) instead of
+// waiting on a lookup or connect, and netjobs holds back background work.
+#define RADIO_NET_LINK_TTL_MS 5000
+#define RADIO_NET_OFFLINE_BACKOFF_MS 15000
+#define RADIO_NET_OFFLINE_BACKOFF_MAX_MS (2 * 60 * 1000)
+bool radio_net_online(void);
+
+// Warm the way to url's host ahead of its first request (blocks; from a
+// background job): the host's addresses go into the DNS cache, the TLS DRBG
+// is seeded, and with connect an HTTPS host also gets a connection in the
+// keep-alive pool (unless one is pooled already) and a session to resume.
+// Plain HTTP hosts are only looked up: streams don't use the pool.
+// Returns 0, or a RADIO_NET_ERR_* code.
+int radio_net_prewarm(const char* url, bool connect);
+
+// Connections share a process-wide DNS cache (entries kept RADIO_NET_DNS_TTL_MS;
+// getaddrinfo doesn't report record TTLs) and, for HTTPS, one client TLS
+// configuration whose DRBG is seeded once and used under a lock, with the last
+// session of each host:port kept to resume by session ticket or ID. All of it is
+// thread-safe and set up on first use.
+
+#define RADIO_NET_DNS_TTL_MS (5 * 60 * 1000)
+
+// Each phase of setting up a request has its own deadline. The lookup runs on a
+// helper thread so a hung resolver can be walked away from. A host's addresses
+// (IPv6 and IPv4 interleaved) are raced: a non-blocking connect to the next one
+// starts every RADIO_NET_CONNECT_STAGGER_MS, or at once when one fails, and the
+// first to complete wins.
+#define RADIO_NET_DNS_TIMEOUT_MS 5000
+#define RADIO_NET_CONNECT_TIMEOUT_MS 8000
+#define RADIO_NET_CONNECT_STAGGER_MS 250
+#define RADIO_NET_TLS_TIMEOUT_MS 10000
+#define RADIO_NET_FIRST_BYTE_TIMEOUT_MS 10000   // From the request sent to its response
+#define RADIO_NET_ABORT_CHECK_MS 50             // Lookups and connects look for radio_net_abortAll this often
+
+// radio_net_connect() / radio_net_tls_connect() failures
+#define RADIO_NET_ERR_DNS -1
+#define RADIO_NET_ERR_CONNECT -2
+#define RADIO_NET_ERR_TLS -3
+#define RADIO_NET_ERR_TIMEOUT -4
+#define RADIO_NET_ERR_OFFLINE -5        // Not tried: radio_net_online is false
+
+// Open a TCP connection (10 s send/receive timeouts once connected)
+// A cached address that no longer answers is looked up again once.
+// Returns the socket, or a RADIO_NET_ERR_* code. The caller gives it back with
+// radio_net_release before closing it.
+int radio_net_connect(const char* host, int port);
+
+// Forget a socket from radio_net_connect (or radio_net_tls_connect's net) about to
+// be closed; -1 is ignored
+void radio_net_release(int fd);
+
+// Shutdown: every socket not yet released is shut down, so whatever blocks on it
+// (a read, a handshake, a select) returns at once and fails, and lookups, connects
+// and new requests fail within RADIO_NET_ABORT_CHECK_MS. Not undone; any thread.
+void radio_net_abortAll(void);
+
+// Connect ssl (mbedtls_ssl_init'ed by the caller) and net to host:port and complete
+// the handshake, resuming the host's last session when the server allows it
+// Returns 0, or a RADIO_NET_ERR_* code. The caller frees ssl and net either way.
+int radio_net_tls_connect(mbedtls_ssl_context* ssl, mbedtls_net_context* net,
+                          const char* host, int port);
+
+// Wait up to RADIO_NET_FIRST_BYTE_TIMEOUT_MS for the response to a request just
+// sent on fd (ssl = its TLS context, or NULL)
+// Returns 0 once something arrived, or RADIO_NET_ERR_TIMEOUT.
+int radio_net_awaitResponse(int fd, mbedtls_ssl_context* ssl);
+
+typedef enum {
+    RADIO_NET_PHASE_DNS,
+    RADIO_NET_PHASE_CONNECT,
+    RADIO_NET_PHASE_TLS,
+    RADIO_NET_PHASE_FIRST_BYTE,
+    RADIO_NET_PHASE_COUNT
+} RadioNetPhase;
+
+// Connection setup timings, per phase (since start or radio_net_resetStats)
+// Cached lookups and pooled connections skip their phases and aren't counted.
+typedef struct {
+    uint32_t count[RADIO_NET_PHASE_COUNT];      // Phases completed
+    uint32_t timeouts[RADIO_NET_PHASE_COUNT];   // Phases given up at their deadline
+    int last_ms[RADIO_NET_PHASE_COUNT];
+    int avg_ms[RADIO_NET_PHASE_COUNT];
+    int max_ms[RADIO_NET_PHASE_COUNT];
+    uint32_t fallbacks;         // Connects won by an address other than the first
+    // TLS arena (make TLS_ARENA=1, else 0): size, in use now and peak, in KB
+    uint32_t tls_arena_kb;
+    uint32_t tls_in_use_kb;
+    uint32_t tls_peak_kb;
+    uint32_t tls_alloc_failures;    // TLS setups that ran out of memory
+} RadioNetStats;
+
+void radio_net_getStats(RadioNetStats* stats);
+void radio_net_resetStats(void);
+
+// Traffic accounting
+// Bytes in and out are counted per subsystem for the session (not reset by
+// radio_net_resetStats): requests count under the calling thread's account,
+// stream connections (radio_conn.h) under the one they were opened with, and
+// work outside (yt-dlp) adds its own with radio_net_count. Payload bytes are
+// counted, plus the TLS handshakes; record and header overhead below that is not.
+typedef enum {
+    RADIO_NET_ACCOUNT_OTHER,
+    RADIO_NET_ACCOUNT_STREAM,       // Direct radio streams, standbys included
+    RADIO_NET_ACCOUNT_HLS,          // HLS playlists and segments
+    RADIO_NET_ACCOUNT_ART,          // Cover lookups and downloads
+    RADIO_NET_ACCOUNT_CATALOG,      // Station catalog and probes
+    RADIO_NET_ACCOUNT_UPDATES,      // Release checks and update downloads
+    RADIO_NET_ACCOUNT_YOUTUBE,      // Search, thumbnails, downloads
+    RADIO_NET_ACCOUNT_COUNT
+} RadioNetAccount;
+
+// Make account the calling thread's; returns the one it replaces, which work on
+// a shared job thread puts back when done
+RadioNetAccount radio_net_setAccount(RadioNetAccount account);
+RadioNetAccount radio_net_account(void);
+
+// Add bytes to account (any thread)
+void radio_net_count(RadioNetAccount account, uint64_t in, uint64_t out);
+
+typedef struct {
+    uint64_t in[RADIO_NET_ACCOUNT_COUNT];
+    uint64_t out[RADIO_NET_ACCOUNT_COUNT];
+    uint32_t capped;            // Requests refused by a data saver cap
+} RadioNetTraffic;
+
+void radio_net_getTraffic(RadioNetTraffic* traffic);
+
+// Short name of account, for stats lines
+const char* radio_net_accountName(RadioNetAccount account);
+
+// Data saver, for metered links (phone hotspots)
+// While on: HLS plays its leanest rendition, covers of upcoming tracks aren't
+// looked up ahead, neighbouring stations get no warm standby, background
+// update checks and catalog syncs are skipped, warm-ups only look up addresses,
+// and the background accounts below stop at their cap for the session:
+// requests past it fail at once. Off by default; any thread.
+#define RADIO_NET_SAVER_ART_CAP (4 * 1024 * 1024)
+#define RADIO_NET_SAVER_CATALOG_CAP (1 * 1024 * 1024)
+void radio_net_setDataSaver(bool enabled);
+bool radio_net_dataSaver(void);
+
 #endif
@@ -0,0 +1,246 @@
+#define _GNU_SOURCE  // For strcasestr
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "radio_probe.h"
+#include "radio_conn.h"
+#include "radio_hls.h"
+#include "radio_net.h"
+#include "jobs.h"
+#include "netjobs.h"
+#include "defines.h"
+#include "api.h"
+
+#define PROBE_JOBS 2                    // Probes queued or running at once
+#define PROBE_MAX_ENTRIES 256
+#define PROBE_MAX_URL 512
+#define PROBE_AUDIO_TIMEOUT_MS 5000     // For the first audio after the headers
+
+typedef struct {
+    char url[PROBE_MAX_URL];
+    RadioProbeResult result;    // Last completed probe (state UNKNOWN if none)
+    uint64_t probed_ms;         // When it completed (0 = never)
+    uint64_t queued;            // Queue order (0 = not queued)
+    bool probing;
+} ProbeEntry;
+
+static ProbeEntry entries[PROBE_MAX_ENTRIES];
+static int entry_count = 0;
+static uint64_t queue_counter = 0;
+static pthread_mutex_t probe_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t probe_cond = PTHREAD_COND_INITIALIZER;
+static int probe_jobs = 0;              // Queued or running probe jobs
+static int probe_running = 0;
+static bool probe_started = false;
+static bool probe_stop = false;
+static uint32_t probe_generation = 0;  // Completed probes (atomic)
+
+static uint64_t probe_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Frame sync at the start of the audio, for streams that don't say what they are
+static const char* sniff_codec(const uint8_t* data, int len) {
+    for (int i = 0; i + 1 < len; i++) {
+        if (data[i] != 0xFF) continue;
+        if ((data[i + 1] & 0xF6) == 0xF0) return "AAC";    // ADTS
+        if ((data[i + 1] & 0xE0) == 0xE0) return "MP3";
+    }
+    return "";
+}
+
+static void probe_direct(const char* url, RadioProbeResult* r, uint64_t start) {
+    RadioConn* conn = calloc(1, sizeof(RadioConn));
+    if (!conn) return;
+    conn->socket_fd = -1;
+
+    if (radio_conn_open(conn, url) == 0) {
+        r->connect_ms = (int)(probe_now_ms() - start);
+        r->bitrate = conn->bitrate;
+        if (strcasestr(conn->content_type, "aac")) snprintf(r->codec, sizeof(r->codec), "AAC");
+        else if (strcasestr(conn->content_type, "mpeg")) snprintf(r->codec, sizeof(r->codec), "MP3");
+
+        // One receive of audio is enough: the stream is never read on
+        uint8_t buf[4096];
+        uint64_t headers_ms = probe_now_ms();
+        while (probe_now_ms() - headers_ms < PROBE_AUDIO_TIMEOUT_MS &&
+               !__atomic_load_n(&probe_stop, __ATOMIC_ACQUIRE)) {
+            int ret = radio_conn_wait(conn, 100, -1);
+            if (ret == 0) continue;
+            int n = ret > 0 ? radio_conn_recv(conn, buf, sizeof(buf)) : -1;
+            if (n == 0) continue;
+            if (n < 0) break;
+            r->first_audio_ms = (int)(probe_now_ms() - start);
+            if (!r->codec[0]) snprintf(r->codec, sizeof(r->codec), "%s", sniff_codec(buf, n));
+            r->state = RADIO_PROBE_ALIVE;
+            break;
+        }
+    }
+    radio_conn_close(conn);
+    free(conn);
+}
+
+// radio_net_fetchStream callback: note the first bytes, then abort
+static bool first_bytes(void* ctx, const uint8_t* data, int len) {
+    (void)data;
+    if (len > 0) *(uint64_t*)ctx = probe_now_ms();
+    return false;
+}
+
+static void probe_hls(const char* url, RadioProbeResult* r, uint64_t start) {
+    HLSContext* hls = malloc(sizeof(HLSContext));
+    if (!hls) return;
+    radio_hls_init(hls);
+
+    // The rendition a first-time listener would get
+    if (radio_hls_fetch_playlist(hls, url, 0) > 0) {
+        r->connect_ms = (int)(probe_now_ms() - start);
+        snprintf(r->codec, sizeof(r->codec), "HLS");
+        if (hls->variant_count > 0) r->bitrate = hls->variants[hls->current_variant].bandwidth / 1000;
+
+        char segment_url[HLS_MAX_URL_LEN];
+        radio_hls_segment_url(hls, 0, segment_url, sizeof(segment_url));
+        uint64_t first_ms = 0;
+        if (segment_url[0]) radio_net_fetchStream(segment_url, first_bytes, &first_ms);
+        if (first_ms > 0) {
+            r->first_audio_ms = (int)(first_ms - start);
+            r->state = RADIO_PROBE_ALIVE;
+        }
+    }
+    radio_hls_cleanup(hls);
+    free(hls);
+}
+
+static void probe_schedule(void);
+
+// Probe the oldest queued entry (an idle job per station, so a long list takes
+// turns with other background work)
+static void probe_job(void* arg, JobToken* token) {
+    (void)arg;
+    (void)token;
+
+    pthread_mutex_lock(&probe_mutex);
+    ProbeEntry* next = NULL;
+    if (!__atomic_load_n(&probe_stop, __ATOMIC_ACQUIRE)) {
+        for (int i = 0; i < entry_count; i++) {
+            if (entries[i].queued && (!next || entries[i].queued < next->queued)) next = &entries[i];
+        }
+    }
+    if (next) {
+        next->queued = 0;
+        next->probing = true;
+        probe_running++;
+        char url[PROBE_MAX_URL];
+        snprintf(url, sizeof(url), "%s", next->url);
+        pthread_mutex_unlock(&probe_mutex);
+
+        RadioProbeResult result = {.state = RADIO_PROBE_DEAD};
+        uint64_t start = probe_now_ms();
+        RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_CATALOG);
+        if (radio_hls_is_url(url)) probe_hls(url, &result, start);
+        else probe_direct(url, &result, start);
+        radio_net_setAccount(account);
+
+        // Entries are only replaced while not probing, so next is still url's
+        pthread_mutex_lock(&probe_mutex);
+        next->result = result;
+        next->probed_ms = probe_now_ms();
+        next->probing = false;
+        probe_running--;
+        __atomic_add_fetch(&probe_generation, 1, __ATOMIC_RELEASE);
+    }
+    probe_jobs--;
+    probe_schedule();
+    pthread_cond_broadcast(&probe_cond);
+    pthread_mutex_unlock(&probe_mutex);
+}
+
+// Keep up to PROBE_JOBS jobs queued while entries wait (probe_mutex held)
+static void probe_schedule(void) {
+    if (__atomic_load_n(&probe_stop, __ATOMIC_ACQUIRE)) return;
+    int waiting = 0;
+    for (int i = 0; i < entry_count; i++) {
+        if (entries[i].queued) waiting++;
+    }
+    while (probe_jobs < PROBE_JOBS && probe_jobs - probe_running < waiting) {
+        if (NetJobs_post(JOB_PRIORITY_IDLE, NULL, probe_job, NULL, NULL) != 0) break;
+        probe_jobs++;
+    }
+}
+
+void radio_probe_init(void) {
+    probe_stop = false;
+    probe_started = true;
+}
+
+// Entry of url, taking a new one (or the least recently probed idle one) if needed
+// Called with the mutex held.
+static ProbeEntry* find_entry(const char* url, bool create) {
+    for (int i = 0; i < entry_count; i++) {
+        if (strcmp(entries[i].url, url) == 0) return &entries[i];
+    }
+    if (!create) return NULL;
+
+    ProbeEntry* entry = NULL;
+    if (entry_count < PROBE_MAX_ENTRIES) {
+        entry = &entries[entry_count++];
+    } else {
+        for (int i = 0; i < entry_count; i++) {
+            ProbeEntry* e = &entries[i];
+            if (e->probing || e->queued) continue;
+            if (!entry || e->probed_ms < entry->probed_ms) entry = e;
+        }
+        if (!entry) return NULL;
+    }
+    memset(entry, 0, sizeof(ProbeEntry));
+    snprintf(entry->url, sizeof(entry->url), "%s", url);
+    return entry;
+}
+
+void radio_probe_request(const char* const* urls, int count) {
+    if (!probe_started) return;
+    uint64_t now = probe_now_ms();
+    bool queued = false;
+
+    pthread_mutex_lock(&probe_mutex);
+    for (int i = 0; i < count; i++) {
+        if (!urls[i] || !urls[i][0]) continue;
+        ProbeEntry* entry = find_entry(urls[i], true);
+        if (!entry || entry->queued || entry->probing) continue;
+        if (entry->probed_ms > 0 && now - entry->probed_ms < RADIO_PROBE_TTL_MS) continue;
+        entry->queued = ++queue_counter;
+        queued = true;
+    }
+    if (queued) probe_schedule();
+    pthread_mutex_unlock(&probe_mutex);
+}
+
+bool radio_probe_get(const char* url, RadioProbeResult* out) {
+    pthread_mutex_lock(&probe_mutex);
+    ProbeEntry* entry = find_entry(url, false);
+    if (entry) {
+        *out = entry->result;
+        if (entry->probed_ms == 0) out->state = RADIO_PROBE_PENDING;
+    }
+    pthread_mutex_unlock(&probe_mutex);
+    return entry != NULL;
+}
+
+uint32_t radio_probe_generation(void) {
+    return __atomic_load_n(&probe_generation, __ATOMIC_ACQUIRE);
+}
+
+void radio_probe_quit(void) {
+    pthread_mutex_lock(&probe_mutex);
+    __atomic_store_n(&probe_stop, true, __ATOMIC_RELEASE);
+    // Queued jobs return at once; running ones finish their probe
+    while (probe_running > 0) pthread_cond_wait(&probe_cond, &probe_mutex);
+    probe_started = false;
+    entry_count = 0;
+    pthread_mutex_unlock(&probe_mutex);
+}
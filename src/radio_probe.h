@@ -0,0 +1,47 @@
+#ifndef __RADIO_PROBE_H__
+#define __RADIO_PROBE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Station health prober
+// Idle-priority jobs (a few at a time) check whether stations are
+// alive and how fast they start: a direct stream is opened and read until its
+// first audio bytes, an HLS station's playlist is loaded and its first segment
+// requested until its first bytes. Results are cached per URL for
+// RADIO_PROBE_TTL_MS; a stale one is probed again when next requested.
+
+#define RADIO_PROBE_TTL_MS (10 * 60 * 1000)
+
+typedef enum {
+    RADIO_PROBE_UNKNOWN,        // Not probed yet
+    RADIO_PROBE_PENDING,        // Queued or being probed
+    RADIO_PROBE_ALIVE,
+    RADIO_PROBE_DEAD            // Connect, response or first audio failed
+} RadioProbeState;
+
+typedef struct {
+    RadioProbeState state;
+    int connect_ms;             // Until the response headers (the playlist, for HLS)
+    int first_audio_ms;         // Until the first audio bytes
+    int bitrate;                // kbps (0 = not announced)
+    char codec[8];              // "MP3", "AAC", "HLS" ("" = unknown)
+} RadioProbeResult;
+
+// Start accepting probe requests (jobs run on the shared pool, see jobs.h)
+void radio_probe_init(void);
+
+// Queue the stations whose results are missing or stale (NULL entries ignored)
+void radio_probe_request(const char* const* urls, int count);
+
+// Latest result for url: last probed one while a new probe is pending
+// Returns false if url was never requested.
+bool radio_probe_get(const char* url, RadioProbeResult* out);
+
+// Changes whenever a probe completes (for redrawing results)
+uint32_t radio_probe_generation(void);
+
+// Stop probing (a probe in progress finishes its connect first)
+void radio_probe_quit(void);
+
+#endif
@@ -0,0 +1,205 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "radio_reactor.h"
+#include "thread_role.h"
+#include "defines.h"
+#include "api.h"
+
+#define REACTOR_WAKE_ID UINT64_MAX
+
+struct RadioReactorWatch {
+    bool used;
+    bool watching;              // Registered with epoll (false while paused)
+    uint32_t generation;        // Tells a reused watch from a removed one in pending events
+    int fd;
+    RadioReactorFunc func;
+    void* ctx;
+    uint64_t deadline_ms;       // Timer (0 = none)
+};
+
+static RadioReactorWatch watches[RADIO_REACTOR_MAX_WATCHES];
+// Held while handlers run, so a watch removed by another thread is never called
+static pthread_mutex_t reactor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t reactor_thread;
+static bool reactor_running = false;
+static bool reactor_stop = false;       // Atomic
+static int epoll_fd = -1;
+static int wake_fd = -1;
+
+static uint64_t reactor_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static uint64_t watch_id(const RadioReactorWatch* watch) {
+    return (uint64_t)watch->generation << 32 | (uint32_t)(watch - watches);
+}
+
+// Handlers call in with the mutex already held
+static bool on_reactor_thread(void) {
+    return reactor_running && pthread_equal(pthread_self(), reactor_thread);
+}
+
+static void reactor_lock(void) {
+    if (!on_reactor_thread()) pthread_mutex_lock(&reactor_mutex);
+}
+
+static void reactor_unlock(void) {
+    if (!on_reactor_thread()) pthread_mutex_unlock(&reactor_mutex);
+}
+
+// Start or stop watching input; a paused socket is taken out of epoll altogether,
+// as hang-ups and errors are reported even without EPOLLIN
+static int set_watching(RadioReactorWatch* watch, bool watching) {
+    if (watch->watching == watching) return 0;
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = watch_id(watch)};
+    if (epoll_ctl(epoll_fd, watching ? EPOLL_CTL_ADD : EPOLL_CTL_DEL, watch->fd, &ev) != 0) return -1;
+    watch->watching = watching;
+    return 0;
+}
+
+// Milliseconds until the next timer (-1 = none)
+static int next_timeout(void) {
+    uint64_t now = reactor_now_ms();
+    int timeout = -1;
+    for (int i = 0; i < RADIO_REACTOR_MAX_WATCHES; i++) {
+        RadioReactorWatch* watch = &watches[i];
+        if (!watch->used || watch->deadline_ms == 0) continue;
+        int left = watch->deadline_ms > now ? (int)(watch->deadline_ms - now) : 0;
+        if (timeout < 0 || left < timeout) timeout = left;
+    }
+    return timeout;
+}
+
+static void* reactor_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+    struct epoll_event events[RADIO_REACTOR_MAX_WATCHES + 1];
+
+    while (!__atomic_load_n(&reactor_stop, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&reactor_mutex);
+        int timeout = next_timeout();
+        pthread_mutex_unlock(&reactor_mutex);
+
+        int n = epoll_wait(epoll_fd, events, RADIO_REACTOR_MAX_WATCHES + 1, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            LOG_error("Reactor: epoll_wait failed: %s\n", strerror(errno));
+            break;
+        }
+
+        pthread_mutex_lock(&reactor_mutex);
+        for (int i = 0; i < n; i++) {
+            uint64_t id = events[i].data.u64;
+            if (id == REACTOR_WAKE_ID) {
+                uint64_t count;
+                if (read(wake_fd, &count, sizeof(count)) < 0) {}
+                continue;
+            }
+            // Skip watches an earlier handler of this batch removed or paused
+            RadioReactorWatch* watch = &watches[(uint32_t)id];
+            if (!watch->used || watch->generation != (uint32_t)(id >> 32) || !watch->watching) continue;
+            watch->func(watch->ctx, RADIO_REACTOR_READABLE);
+        }
+
+        uint64_t now = reactor_now_ms();
+        for (int i = 0; i < RADIO_REACTOR_MAX_WATCHES; i++) {
+            RadioReactorWatch* watch = &watches[i];
+            if (!watch->used || watch->deadline_ms == 0 || watch->deadline_ms > now) continue;
+            watch->deadline_ms = 0;
+            watch->func(watch->ctx, RADIO_REACTOR_TIMER);
+        }
+        pthread_mutex_unlock(&reactor_mutex);
+    }
+    return NULL;
+}
+
+int radio_reactor_init(void) {
+    if (reactor_running) return 0;
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    struct epoll_event ev = {.events = EPOLLIN, .data.u64 = REACTOR_WAKE_ID};
+    if (epoll_fd < 0 || wake_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev) != 0) {
+        LOG_error("Reactor: setup failed: %s\n", strerror(errno));
+        radio_reactor_quit();
+        return -1;
+    }
+
+    __atomic_store_n(&reactor_stop, false, __ATOMIC_RELEASE);
+    if (pthread_create(&reactor_thread, NULL, reactor_func, NULL) != 0) {
+        radio_reactor_quit();
+        return -1;
+    }
+    reactor_running = true;
+    return 0;
+}
+
+RadioReactorWatch* radio_reactor_add(int fd, RadioReactorFunc func, void* ctx) {
+    if (!reactor_running || fd < 0) return NULL;
+
+    RadioReactorWatch* added = NULL;
+    reactor_lock();
+    for (int i = 0; i < RADIO_REACTOR_MAX_WATCHES; i++) {
+        RadioReactorWatch* watch = &watches[i];
+        if (watch->used) continue;
+        watch->generation++;
+        watch->fd = fd;
+        watch->func = func;
+        watch->ctx = ctx;
+        watch->deadline_ms = 0;
+        watch->watching = false;
+        if (set_watching(watch, true) == 0) {
+            watch->used = true;
+            added = watch;
+        }
+        break;
+    }
+    reactor_unlock();
+    return added;
+}
+
+void radio_reactor_pause(RadioReactorWatch* watch, int ms) {
+    set_watching(watch, false);
+    watch->deadline_ms = ms >= 0 ? reactor_now_ms() + ms : 0;
+}
+
+void radio_reactor_resume(RadioReactorWatch* watch) {
+    watch->deadline_ms = 0;
+    if (set_watching(watch, true) != 0) {
+        LOG_error("Reactor: cannot watch fd %d: %s\n", watch->fd, strerror(errno));
+    }
+}
+
+void radio_reactor_remove(RadioReactorWatch* watch) {
+    if (!watch) return;
+    reactor_lock();
+    set_watching(watch, false);
+    watch->used = false;
+    watch->deadline_ms = 0;
+    reactor_unlock();
+}
+
+void radio_reactor_quit(void) {
+    if (reactor_running) {
+        __atomic_store_n(&reactor_stop, true, __ATOMIC_RELEASE);
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0) {}
+        pthread_join(reactor_thread, NULL);
+        reactor_running = false;
+    }
+    if (epoll_fd >= 0) close(epoll_fd);
+    if (wake_fd >= 0) close(wake_fd);
+    epoll_fd = -1;
+    wake_fd = -1;
+}
@@ -0,0 +1,44 @@
+#ifndef __RADIO_REACTOR_H__
+#define __RADIO_REACTOR_H__
+
+#include <stdbool.h>
+
+// Network reactor
+// One background thread waits on all registered non-blocking sockets with epoll
+// and runs a socket's handler when it becomes readable or its timer expires, so
+// long-lived readers share a thread and only wake up when there is data.
+// Handlers run on the reactor thread, one at a time, and must not block: they
+// read until the socket would block, or pause the watch when they want to wait.
+
+#define RADIO_REACTOR_MAX_WATCHES 8
+
+#define RADIO_REACTOR_READABLE 1
+#define RADIO_REACTOR_TIMER 2
+
+typedef void (*RadioReactorFunc)(void* ctx, int events);
+
+typedef struct RadioReactorWatch RadioReactorWatch;
+
+// Start the reactor thread
+// Returns 0 on success, -1 on error.
+int radio_reactor_init(void);
+
+// Watch fd for input
+// Returns NULL if the reactor isn't running or all watches are in use.
+RadioReactorWatch* radio_reactor_add(int fd, RadioReactorFunc func, void* ctx);
+
+// Stop watching input; after ms the handler is called with RADIO_REACTOR_TIMER
+// (ms < 0: never, until radio_reactor_resume). For handlers only.
+void radio_reactor_pause(RadioReactorWatch* watch, int ms);
+
+// Watch input again after radio_reactor_pause(). For handlers only.
+void radio_reactor_resume(RadioReactorWatch* watch);
+
+// Unregister and free a watch; its handler is not running and won't run again
+// once this returns
+void radio_reactor_remove(RadioReactorWatch* watch);
+
+// Stop the reactor thread (remove all watches first)
+void radio_reactor_quit(void);
+
+#endif
@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "radio_record.h"
+#include "circular_buffer.h"
+#include "thread_role.h"
+#include "defines.h"
+#include "api.h"
+
+#define RECORD_RING_SIZE (1024 * 1024)  // About a minute at 128 kbps
+#define RECORD_CHUNK (64 * 1024)        // Write size and file offset alignment
+#define RECORD_WAIT_US 50000
+#define RECORD_MAX_SPLITS 8
+#define RECORD_NAME_MAX 80
+
+typedef struct {
+    size_t pos;                 // Ring position where the new song starts
+    char artist[128];
+    char title[128];
+} RecordSplit;
+
+// Bytes flow network thread -> ring -> writer thread
+static CircularBuffer ring;
+static bool active = false;             // Network thread checks (atomic)
+static uint32_t dropped = 0;            // Bytes lost to a full ring (atomic)
+
+// Song changes, in stream order, guarded by splits_mutex
+static pthread_mutex_t splits_mutex = PTHREAD_MUTEX_INITIALIZER;
+static RecordSplit splits[RECORD_MAX_SPLITS];
+static int split_count = 0;
+static int split_head = 0;
+
+// Writer thread state
+static pthread_t writer_thread;
+static bool writer_running = false;     // Main thread only
+static bool writer_stop = false;        // Atomic
+static char record_dir[512];
+static char record_station[128];
+static char record_ext[8];
+static int file_fd = -1;
+static char file_path[768];
+static uint64_t file_bytes = 0;
+
+// Copy a name part without characters FAT can't store, cut at a UTF-8 boundary
+static void clean_name(const char* in, char* out, size_t max) {
+    size_t i = 0, j = 0;
+    for (; in[i] && j < max - 1; i++) {
+        unsigned char c = (unsigned char)in[i];
+        if (c < 0x20 || strchr("/\\:*?\"<>|", c)) continue;
+        out[j++] = c;
+    }
+    // Cut inside a character: drop its bytes back to and including the lead byte
+    if (((unsigned char)in[i] & 0xC0) == 0x80) {
+        while (j > 0 && ((unsigned char)out[j - 1] & 0xC0) == 0x80) j--;
+        if (j > 0 && ((unsigned char)out[j - 1] & 0xC0) == 0xC0) j--;
+    }
+    while (j > 0 && (out[j - 1] == ' ' || out[j - 1] == '.')) j--;
+    out[j] = '\0';
+}
+
+static void close_file(void) {
+    if (file_fd < 0) return;
+    close(file_fd);
+    file_fd = -1;
+    // Nothing recorded for the song (e.g. a title change right after starting)
+    if (file_bytes == 0) unlink(file_path);
+}
+
+static void open_file(const char* artist, const char* title) {
+    close_file();
+
+    char station[RECORD_NAME_MAX + 1], song[2 * RECORD_NAME_MAX + 4];
+    clean_name(record_station, station, sizeof(station));
+    char a[RECORD_NAME_MAX + 1], t[RECORD_NAME_MAX + 1];
+    clean_name(artist ? artist : "", a, sizeof(a));
+    clean_name(title ? title : "", t, sizeof(t));
+    if (a[0] && t[0]) snprintf(song, sizeof(song), " - %s - %s", a, t);
+    else if (t[0]) snprintf(song, sizeof(song), " - %s", t);
+    else song[0] = '\0';
+
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H.%M.%S", &tm_now);
+
+    snprintf(file_path, sizeof(file_path), "%s/%s %s%s.%s",
+             record_dir, station[0] ? station : "Radio", stamp, song, record_ext);
+    file_fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    file_bytes = 0;
+    if (file_fd < 0) LOG_error("Record: can't create %s\n", file_path);
+}
+
+// Write len ring bytes straight from the ring's spans; without a file they are dropped
+static void write_out(size_t len) {
+    while (len > 0) {
+        void* span;
+        size_t n = circular_buffer_read_span(&ring, &span);
+        if (n > len) n = len;
+        if (n == 0) break;
+        if (file_fd >= 0) {
+            const uint8_t* p = span;
+            size_t left = n;
+            while (left > 0) {
+                ssize_t w = write(file_fd, p, left);
+                if (w <= 0) {
+                    LOG_error("Record: write to %s failed\n", file_path);
+                    close(file_fd);
+                    file_fd = -1;
+                    break;
+                }
+                p += w;
+                left -= w;
+                file_bytes += w;
+            }
+        }
+        circular_buffer_consume(&ring, n);
+        len -= n;
+    }
+}
+
+static void* writer_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    while (true) {
+        bool stopping = __atomic_load_n(&writer_stop, __ATOMIC_ACQUIRE);
+        size_t avail = circular_buffer_available(&ring);
+        size_t rpos = circular_buffer_read_position(&ring);
+
+        // Bytes up to the next song change belong to the current file
+        RecordSplit split;
+        bool have_split = false;
+        pthread_mutex_lock(&splits_mutex);
+        if (split_count > 0) {
+            split = splits[split_head];
+            have_split = true;
+        }
+        pthread_mutex_unlock(&splits_mutex);
+        size_t limit = avail;
+        if (have_split && split.pos - rpos < limit) limit = split.pos - rpos;
+
+        if (have_split && limit == 0) {
+            open_file(split.artist, split.title);
+            pthread_mutex_lock(&splits_mutex);
+            split_head = (split_head + 1) % RECORD_MAX_SPLITS;
+            split_count--;
+            pthread_mutex_unlock(&splits_mutex);
+            continue;
+        }
+
+        // Whole chunks keep the file offsets aligned; the tail of a song or of the
+        // recording goes out as it is
+        size_t to_chunk = RECORD_CHUNK - (size_t)(file_bytes % RECORD_CHUNK);
+        if (limit >= to_chunk) {
+            write_out(limit - (limit - to_chunk) % RECORD_CHUNK);
+        } else if (limit > 0 && (stopping || (have_split && limit == split.pos - rpos))) {
+            write_out(limit);
+        } else if (stopping) {
+            break;
+        } else {
+            usleep(RECORD_WAIT_US);
+        }
+    }
+
+    close_file();
+    return NULL;
+}
+
+int radio_record_start(const char* dir, const char* station, const char* ext,
+                       const char* artist, const char* title) {
+    radio_record_stop();
+
+    if (!ring.buffer && circular_buffer_init(&ring, RECORD_RING_SIZE, 1, MEM_TAG_RECORD) != 0) {
+        LOG_error("Record: out of memory\n");
+        return -1;
+    }
+    // No consumer is running: drop anything a previous recording left behind
+    void* span;
+    size_t n;
+    while ((n = circular_buffer_read_span(&ring, &span)) > 0) circular_buffer_consume(&ring, n);
+
+    strncpy(record_dir, dir, sizeof(record_dir) - 1);
+    strncpy(record_station, station ? station : "", sizeof(record_station) - 1);
+    strncpy(record_ext, ext, sizeof(record_ext) - 1);
+    mkdir(record_dir, 0755);
+
+    open_file(artist, title);
+    if (file_fd < 0) return -1;
+
+    pthread_mutex_lock(&splits_mutex);
+    split_count = split_head = 0;
+    pthread_mutex_unlock(&splits_mutex);
+    __atomic_store_n(&dropped, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&writer_stop, false, __ATOMIC_RELEASE);
+
+    if (pthread_create(&writer_thread, NULL, writer_func, NULL) != 0) {
+        LOG_error("Record: can't start writer thread\n");
+        close_file();
+        return -1;
+    }
+    writer_running = true;
+    __atomic_store_n(&active, true, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void radio_record_stop(void) {
+    if (!writer_running) return;
+    __atomic_store_n(&active, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&writer_stop, true, __ATOMIC_RELEASE);
+    pthread_join(writer_thread, NULL);
+    writer_running = false;
+
+    uint32_t lost = __atomic_load_n(&dropped, __ATOMIC_RELAXED);
+    if (lost > 0) LOG_error("Record: %u bytes dropped, the card was too slow\n", lost);
+}
+
+bool radio_record_isActive(void) {
+    return __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+}
+
+void radio_record_write(const uint8_t* data, int len) {
+    if (!radio_record_isActive() || len <= 0) return;
+    size_t n = circular_buffer_write(&ring, data, len);
+    if (n < (size_t)len) __atomic_add_fetch(&dropped, (uint32_t)(len - n), __ATOMIC_RELAXED);
+}
+
+void radio_record_newSong(const char* artist, const char* title) {
+    if (!radio_record_isActive()) return;
+    pthread_mutex_lock(&splits_mutex);
+    // Titles changing faster than the writer keeps up just stay in the current file
+    if (split_count < RECORD_MAX_SPLITS) {
+        RecordSplit* s = &splits[(split_head + split_count) % RECORD_MAX_SPLITS];
+        s->pos = circular_buffer_write_position(&ring);
+        snprintf(s->artist, sizeof(s->artist), "%s", artist ? artist : "");
+        snprintf(s->title, sizeof(s->title), "%s", title ? title : "");
+        split_count++;
+    }
+    pthread_mutex_unlock(&splits_mutex);
+}
+
+void radio_record_quit(void) {
+    radio_record_stop();
+    circular_buffer_free(&ring);
+}
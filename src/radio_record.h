@@ -0,0 +1,36 @@
+#ifndef __RADIO_RECORD_H__
+#define __RADIO_RECORD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Radio stream recording
+// The encoded stream of the playing station (after ICY metadata is stripped, before
+// decoding) is teed into a ring and written out as-is by a background thread, so an
+// MP3 station records to .mp3 and an AAC/HLS station to ADTS .aac without
+// re-encoding. The writer appends in large chunks at chunk-aligned file offsets and
+// starts a new file at each ICY/HLS title change. The network thread never waits
+// on the SD card: if the writer falls a whole ring behind, the overflow is dropped.
+// Start/stop from the main thread; write and newSong from the network thread.
+
+// Start recording into dir (created if needed); ext is "mp3" or "aac"
+// Files are named "<station> <date time> - <artist> - <title>.<ext>".
+// Returns 0 on success, -1 on failure.
+int radio_record_start(const char* dir, const char* station, const char* ext,
+                       const char* artist, const char* title);
+
+// Write out what is buffered, close the file and stop the writer
+void radio_record_stop(void);
+
+bool radio_record_isActive(void);
+
+// Tee stream bytes into the recording (network thread)
+void radio_record_write(const uint8_t* data, int len);
+
+// The song changed at the current stream position: later bytes go to a new file
+void radio_record_newSong(const char* artist, const char* title);
+
+// Free the ring (after radio_record_stop, once no network thread can write)
+void radio_record_quit(void);
+
+#endif
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "radio_standby.h"
+#include "radio_hls.h"
+#include "radio_reactor.h"
+#include "thread_role.h"
+#include "defines.h"
+#include "api.h"
+
+#define STANDBY_WINDOW_SIZE (128 * 1024)        // Newest audio kept (about 8 s at 128 kbps)
+#define STANDBY_MAX_BYTES_PER_SEC (40 * 1024)   // Bandwidth cap per standby (320 kbps)
+#define STANDBY_BURST_MS 1000                   // Credit for reading ahead of the cap
+#define STANDBY_RETRY_MS 30000                  // Before reconnecting a standby that ended
+#define STANDBY_MAX_DROPPED 8
+#define STANDBY_MAX_URL 512
+
+typedef struct {
+    char url[STANDBY_MAX_URL];
+    RadioConn* conn;
+    pthread_t thread;           // Connects, then hands the connection to the reactor
+    RadioReactorWatch* watch;   // Written by the thread before done
+    bool stop;                  // Atomic
+    bool ready;                 // Streaming (atomic)
+    bool done;                  // Connect thread ended (atomic)
+    bool failed;                // Connect failed or the stream ended (atomic)
+    uint64_t ended_ms;          // When it failed (main thread)
+
+    // Reactor handler only while the watch exists
+    uint64_t start_ms;
+    uint64_t received;          // Bytes received, for the bandwidth cap
+    uint8_t window[STANDBY_WINDOW_SIZE];
+    uint64_t window_bytes;      // Audio bytes received in total
+    char artist[256];
+    char title[256];
+} StandbySlot;
+
+static StandbySlot* slots[RADIO_STANDBY_MAX];
+// Dropped while their thread was still busy (e.g. connecting): freed once it ends
+static StandbySlot* dropped[STANDBY_MAX_DROPPED];
+static int dropped_count = 0;
+
+static uint64_t standby_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void window_write(void* ctx, const uint8_t* data, int len) {
+    StandbySlot* s = ctx;
+    // Only the newest bytes of a large chunk can stay
+    if (len > STANDBY_WINDOW_SIZE) {
+        s->window_bytes += len - STANDBY_WINDOW_SIZE;
+        data += len - STANDBY_WINDOW_SIZE;
+        len = STANDBY_WINDOW_SIZE;
+    }
+    int offset = (int)(s->window_bytes % STANDBY_WINDOW_SIZE);
+    int part = len < STANDBY_WINDOW_SIZE - offset ? len : STANDBY_WINDOW_SIZE - offset;
+    memcpy(s->window + offset, data, part);
+    memcpy(s->window, data + part, len - part);
+    s->window_bytes += len;
+}
+
+static void note_title(void* ctx, const uint8_t* meta, int len) {
+    StandbySlot* s = ctx;
+    radio_conn_parseTitle(meta, len, s->artist, sizeof(s->artist), s->title, sizeof(s->title));
+}
+
+// Reactor handler: read what has arrived, up to the bandwidth cap
+static void standby_on_event(void* ctx, int events) {
+    (void)events;
+    StandbySlot* s = ctx;
+    uint8_t buf[4096];
+
+    for (;;) {
+        // Over the cap (the server's opening burst): let TCP flow control hold it
+        // back until the cap catches up
+        uint64_t allowed = (standby_now_ms() - s->start_ms + STANDBY_BURST_MS) *
+                           STANDBY_MAX_BYTES_PER_SEC / 1000;
+        if (s->received >= allowed) {
+            int wait_ms = (int)((s->received - allowed) * 1000 / STANDBY_MAX_BYTES_PER_SEC) + 1;
+            radio_reactor_pause(s->watch, wait_ms);
+            return;
+        }
+
+        int n = radio_conn_recv(s->conn, buf, sizeof(buf));
+        if (n == 0) {
+            // Drained: wait for the socket again (a no-op unless a timer fired)
+            radio_reactor_resume(s->watch);
+            return;
+        }
+        if (n < 0) {
+            __atomic_store_n(&s->failed, true, __ATOMIC_RELEASE);
+            radio_reactor_pause(s->watch, -1);
+            return;
+        }
+        s->received += n;
+        radio_conn_demux(s->conn, buf, n, window_write, note_title, s);
+    }
+}
+
+static void* standby_func(void* arg) {
+    StandbySlot* s = arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    if (radio_conn_open(s->conn, s->url) != 0) {
+        LOG_error("Standby: %s: %s\n", s->url, s->conn->error);
+        __atomic_store_n(&s->failed, true, __ATOMIC_RELEASE);
+        __atomic_store_n(&s->done, true, __ATOMIC_RELEASE);
+        return NULL;
+    }
+
+    if (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) {
+        s->start_ms = standby_now_ms();
+        if (radio_conn_setNonBlocking(s->conn, true) == 0) {
+            s->watch = radio_reactor_add(s->conn->socket_fd, standby_on_event, s);
+        }
+        if (s->watch) {
+            __atomic_store_n(&s->ready, true, __ATOMIC_RELEASE);
+        } else {
+            LOG_error("Standby: %s: cannot watch the connection\n", s->url);
+            __atomic_store_n(&s->failed, true, __ATOMIC_RELEASE);
+        }
+    }
+    __atomic_store_n(&s->done, true, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+// Free a standby whose thread has been joined
+static void release_slot(StandbySlot* s) {
+    radio_reactor_remove(s->watch);
+    if (s->conn) {
+        radio_conn_close(s->conn);
+        free(s->conn);
+    }
+    free(s);
+}
+
+static void free_slot(StandbySlot* s) {
+    pthread_join(s->thread, NULL);
+    release_slot(s);
+}
+
+// Stop a standby; it is freed now if its thread is done, else by radio_standby_reap()
+static void drop_slot(StandbySlot* s) {
+    __atomic_store_n(&s->stop, true, __ATOMIC_RELEASE);
+    if (!__atomic_load_n(&s->done, __ATOMIC_ACQUIRE) && dropped_count < STANDBY_MAX_DROPPED) {
+        dropped[dropped_count++] = s;
+        return;
+    }
+    free_slot(s);
+}
+
+static StandbySlot* start_slot(const char* url) {
+    StandbySlot* s = calloc(1, sizeof(StandbySlot));
+    if (!s) return NULL;
+    s->conn = calloc(1, sizeof(RadioConn));
+    if (!s->conn) {
+        free(s);
+        return NULL;
+    }
+    s->conn->socket_fd = -1;
+    snprintf(s->url, sizeof(s->url), "%s", url);
+    if (pthread_create(&s->thread, NULL, standby_func, s) != 0) {
+        free(s->conn);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+static bool is_wanted(const char* url, const char* const* urls, int count) {
+    for (int i = 0; i < count; i++) {
+        if (urls[i] && strcmp(urls[i], url) == 0) return true;
+    }
+    return false;
+}
+
+void radio_standby_set(const char* const* urls, int count) {
+    uint64_t now = standby_now_ms();
+
+    for (int i = 0; i < RADIO_STANDBY_MAX; i++) {
+        StandbySlot* s = slots[i];
+        if (!s) continue;
+        if (__atomic_load_n(&s->failed, __ATOMIC_ACQUIRE) && s->ended_ms == 0) {
+            s->ended_ms = now;
+        }
+        bool retry = s->ended_ms > 0 && now - s->ended_ms >= STANDBY_RETRY_MS;
+        if (!is_wanted(s->url, urls, count) || retry) {
+            drop_slot(s);
+            slots[i] = NULL;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const char* url = urls[i];
+        if (!url || !url[0] || radio_hls_is_url(url)) continue;
+
+        bool have = false;
+        int free_index = -1;
+        for (int j = 0; j < RADIO_STANDBY_MAX; j++) {
+            if (slots[j] && strcmp(slots[j]->url, url) == 0) have = true;
+            else if (!slots[j] && free_index < 0) free_index = j;
+        }
+        if (!have && free_index >= 0) slots[free_index] = start_slot(url);
+    }
+}
+
+bool radio_standby_take(const char* url, RadioStandbyTakeover* out) {
+    for (int i = 0; i < RADIO_STANDBY_MAX; i++) {
+        StandbySlot* s = slots[i];
+        if (!s || strcmp(s->url, url) != 0) continue;
+        slots[i] = NULL;
+
+        // Still connecting, or ended: the caller connects itself
+        if (!__atomic_load_n(&s->ready, __ATOMIC_ACQUIRE) || __atomic_load_n(&s->failed, __ATOMIC_ACQUIRE)) {
+            drop_slot(s);
+            return false;
+        }
+
+        // Ready is set just before the connect thread ends; once the watch is
+        // removed the reader is done with the window
+        pthread_join(s->thread, NULL);
+        radio_reactor_remove(s->watch);
+        s->watch = NULL;
+        int len = s->window_bytes < STANDBY_WINDOW_SIZE ? (int)s->window_bytes : STANDBY_WINDOW_SIZE;
+        uint8_t* window = len > 0 ? malloc(len) : NULL;
+        if (__atomic_load_n(&s->failed, __ATOMIC_ACQUIRE) || radio_conn_setNonBlocking(s->conn, false) != 0 ||
+            (len > 0 && !window)) {
+            free(window);
+            release_slot(s);
+            return false;
+        }
+
+        // Oldest byte first
+        if (len > 0) {
+            int start = s->window_bytes > STANDBY_WINDOW_SIZE
+                        ? (int)(s->window_bytes % STANDBY_WINDOW_SIZE) : 0;
+            memcpy(window, s->window + start, len - start);
+            memcpy(window + len - start, s->window, start);
+        }
+
+        out->conn = s->conn;
+        out->window = window;
+        out->window_len = len;
+        snprintf(out->artist, sizeof(out->artist), "%s", s->artist);
+        snprintf(out->title, sizeof(out->title), "%s", s->title);
+        free(s);
+        return true;
+    }
+    return false;
+}
+
+void radio_standby_reap(void) {
+    int kept = 0;
+    for (int i = 0; i < dropped_count; i++) {
+        if (__atomic_load_n(&dropped[i]->done, __ATOMIC_ACQUIRE)) {
+            free_slot(dropped[i]);
+        } else {
+            dropped[kept++] = dropped[i];
+        }
+    }
+    dropped_count = kept;
+}
+
+void radio_standby_quit(void) {
+    radio_standby_set(NULL, 0);
+    for (int i = 0; i < dropped_count; i++) free_slot(dropped[i]);
+    dropped_count = 0;
+}
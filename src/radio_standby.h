@@ -0,0 +1,45 @@
+#ifndef __RADIO_STANDBY_H__
+#define __RADIO_STANDBY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "radio_conn.h"
+
+// Warm standby stations
+// The stations next to the playing one are kept connected, reading their live
+// stream at a capped rate into a window of the newest audio and following their
+// ICY titles. A standby's thread only connects; reading happens on the network
+// reactor (radio_reactor.h), which is running while standbys exist. Switching to one hands its open
+// connection and that window to the player, so audio starts without a connect,
+// handshake or buffering wait. Direct streams only; HLS stations start as usual.
+// All functions are for the main thread.
+
+#define RADIO_STANDBY_MAX 2
+
+// What a standby hands over: an open connection positioned in the live stream
+// (caller closes and frees it), the audio just before it and the song on air
+typedef struct {
+    RadioConn* conn;
+    uint8_t* window;            // Malloc'd, caller frees
+    int window_len;
+    char artist[256];
+    char title[256];
+} RadioStandbyTakeover;
+
+// Keep these stations warm (NULL entries ignored): standbys for other URLs are
+// dropped, missing ones start connecting
+void radio_standby_set(const char* const* urls, int count);
+
+// Take over the standby of url if it is streaming
+// Returns true and fills *out; false if there is none (it is dropped if it was
+// still connecting).
+bool radio_standby_take(const char* url, RadioStandbyTakeover* out);
+
+// Finish off dropped standbys whose threads have ended (call regularly)
+void radio_standby_reap(void);
+
+// Drop all standbys and wait for their threads (before radio_reactor_quit)
+void radio_standby_quit(void);
+
+#endif
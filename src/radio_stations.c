@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "defines.h"
+#include "api.h"
+#include "memstats.h"
+#include "radio_stations.h"
+
+#define POOL_BLOCK_SIZE 4096
+#define STATIONS_MIN_CAPACITY 32
+#define LINE_MAX_LEN 2048
+
+// Interned strings live in blocks that are only freed all together
+typedef struct PoolBlock {
+    struct PoolBlock* next;
+    size_t used;
+    size_t size;
+    char data[];
+} PoolBlock;
+
+static PoolBlock* pool = NULL;
+static const char** interned = NULL;    // Open addressing set of pooled strings
+static int interned_capacity = 0;
+static int interned_count = 0;
+
+static RadioStation* stations = NULL;
+static int station_count = 0;
+static int station_capacity = 0;
+
+static int* url_index = NULL;           // Station index + 1 by URL hash, 0 = empty
+static int url_capacity = 0;
+
+static int journal_lines = 0;
+
+static uint32_t hash_str(const char* s) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (const char* p = s; *p; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char* pool_alloc(size_t len) {
+    if (!pool || pool->size - pool->used < len) {
+        size_t size = len > POOL_BLOCK_SIZE ? len : POOL_BLOCK_SIZE;
+        PoolBlock* block = MEM_MALLOC(MEM_TAG_STATIONS, sizeof(PoolBlock) + size);
+        if (!block) return NULL;
+        block->next = pool;
+        block->used = 0;
+        block->size = size;
+        pool = block;
+    }
+    char* p = pool->data + pool->used;
+    pool->used += len;
+    return p;
+}
+
+static bool interned_grow(void) {
+    int capacity = interned_capacity ? interned_capacity * 2 : 256;
+    const char** set = MEM_CALLOC(MEM_TAG_STATIONS, capacity, sizeof(const char*));
+    if (!set) return false;
+    for (int i = 0; i < interned_capacity; i++) {
+        if (!interned[i]) continue;
+        uint32_t j = hash_str(interned[i]) & (capacity - 1);
+        while (set[j]) j = (j + 1) & (capacity - 1);
+        set[j] = interned[i];
+    }
+    MEM_FREE(MEM_TAG_STATIONS, interned);
+    interned = set;
+    interned_capacity = capacity;
+    return true;
+}
+
+// The pooled copy of s (NULL reads as ""); NULL if out of memory
+static const char* intern(const char* s) {
+    if (!s) s = "";
+    if ((interned_count + 1) * 4 > interned_capacity * 3 && !interned_grow()) return NULL;
+
+    uint32_t i = hash_str(s) & (interned_capacity - 1);
+    while (interned[i]) {
+        if (strcmp(interned[i], s) == 0) return interned[i];
+        i = (i + 1) & (interned_capacity - 1);
+    }
+    size_t len = strlen(s) + 1;
+    char* copy = pool_alloc(len);
+    if (!copy) return NULL;
+    memcpy(copy, s, len);
+    interned[i] = copy;
+    interned_count++;
+    return copy;
+}
+
+static void index_insert(int station) {
+    uint32_t i = hash_str(stations[station].url) & (url_capacity - 1);
+    while (url_index[i]) i = (i + 1) & (url_capacity - 1);
+    url_index[i] = station + 1;
+}
+
+// Size the index for the list and fill it again (after a remove, or to grow)
+static bool index_rebuild(void) {
+    int capacity = url_capacity ? url_capacity : 64;
+    while (capacity < station_count * 2 + 2) capacity *= 2;
+    if (capacity != url_capacity) {
+        int* index = MEM_MALLOC(MEM_TAG_STATIONS, capacity * sizeof(int));
+        if (!index) return false;
+        MEM_FREE(MEM_TAG_STATIONS, url_index);
+        url_index = index;
+        url_capacity = capacity;
+    }
+    memset(url_index, 0, url_capacity * sizeof(int));
+    for (int i = 0; i < station_count; i++) index_insert(i);
+    return true;
+}
+
+int radio_stations_find(const char* url) {
+    if (!url_index || !url) return -1;
+    uint32_t i = hash_str(url) & (url_capacity - 1);
+    while (url_index[i]) {
+        int station = url_index[i] - 1;
+        if (strcmp(stations[station].url, url) == 0) return station;
+        i = (i + 1) & (url_capacity - 1);
+    }
+    return -1;
+}
+
+static int add(const char* name, const char* url, const char* genre, const char* slogan) {
+    if (!name || !url || !url[0] || radio_stations_find(url) >= 0) return -1;
+
+    if (station_count == station_capacity) {
+        int capacity = station_capacity ? station_capacity * 2 : STATIONS_MIN_CAPACITY;
+        RadioStation* grown = MEM_REALLOC(MEM_TAG_STATIONS, stations, capacity * sizeof(RadioStation));
+        if (!grown) return -1;
+        stations = grown;
+        station_capacity = capacity;
+    }
+    if ((station_count + 1) * 2 + 2 > url_capacity && !index_rebuild()) return -1;
+
+    RadioStation s = {intern(name), intern(url), intern(genre), intern(slogan)};
+    if (!s.name || !s.url || !s.genre || !s.slogan) return -1;
+    stations[station_count] = s;
+    index_insert(station_count);
+    return station_count++;
+}
+
+static void remove_at(int index) {
+    if (index < 0 || index >= station_count) return;
+    memmove(&stations[index], &stations[index + 1], (station_count - index - 1) * sizeof(RadioStation));
+    station_count--;
+    index_rebuild();    // Same capacity: can't fail
+}
+
+// Split a line at '|' into up to count fields, empty ones kept; returns the fields found
+static int split_fields(char* line, char* fields[], int count) {
+    char* nl = strpbrk(line, "\r\n");
+    if (nl) *nl = '\0';
+    int n = 0;
+    char* p = line;
+    while (n < count) {
+        fields[n++] = p;
+        p = strchr(p, '|');
+        if (!p) break;
+        *p++ = '\0';
+    }
+    return n;
+}
+
+static void write_station(FILE* f, const RadioStation* s) {
+    fprintf(f, "%s|%s|%s|%s\n", s->name, s->url, s->genre, s->slogan);
+}
+
+static void journal(char op, const RadioStation* s) {
+    FILE* f = fopen(RADIO_STATIONS_JOURNAL, "a");
+    if (!f) return;
+    fputc(op, f);
+    if (op == '+') write_station(f, s);
+    else fprintf(f, "%s\n", s->url);
+    fclose(f);
+    journal_lines++;
+}
+
+void radio_stations_free(void) {
+    while (pool) {
+        PoolBlock* next = pool->next;
+        MEM_FREE(MEM_TAG_STATIONS, pool);
+        pool = next;
+    }
+    MEM_FREE(MEM_TAG_STATIONS, interned);
+    interned = NULL;
+    interned_capacity = interned_count = 0;
+    MEM_FREE(MEM_TAG_STATIONS, stations);
+    stations = NULL;
+    station_count = station_capacity = 0;
+    MEM_FREE(MEM_TAG_STATIONS, url_index);
+    url_index = NULL;
+    url_capacity = 0;
+    journal_lines = 0;
+}
+
+void radio_stations_load(const RadioStation* defaults, int default_count) {
+    radio_stations_free();
+
+    char line[LINE_MAX_LEN];
+    char* fields[4];
+    FILE* f = fopen(RADIO_STATIONS_FILE, "r");
+    if (f) {
+        // name|url|genre|slogan (genre and slogan are optional)
+        while (fgets(line, sizeof(line), f)) {
+            int n = split_fields(line, fields, 4);
+            if (n >= 2) add(fields[0], fields[1], n > 2 ? fields[2] : "", n > 3 ? fields[3] : "");
+        }
+        fclose(f);
+    } else {
+        for (int i = 0; i < default_count; i++) {
+            add(defaults[i].name, defaults[i].url, defaults[i].genre, defaults[i].slogan);
+        }
+    }
+
+    f = fopen(RADIO_STATIONS_JOURNAL, "r");
+    if (!f) return;
+    while (fgets(line, sizeof(line), f)) {
+        journal_lines++;
+        if (line[0] == '+') {
+            int n = split_fields(line + 1, fields, 4);
+            if (n >= 2) add(fields[0], fields[1], n > 2 ? fields[2] : "", n > 3 ? fields[3] : "");
+        } else if (line[0] == '-') {
+            split_fields(line + 1, fields, 1);
+            remove_at(radio_stations_find(fields[0]));
+        }
+    }
+    fclose(f);
+}
+
+int radio_stations_get(RadioStation** out) {
+    *out = stations;
+    return station_count;
+}
+
+int radio_stations_add(const char* name, const char* url, const char* genre, const char* slogan) {
+    int index = add(name, url, genre, slogan);
+    if (index >= 0) journal('+', &stations[index]);
+    return index;
+}
+
+void radio_stations_remove(int index) {
+    if (index < 0 || index >= station_count) return;
+    journal('-', &stations[index]);
+    remove_at(index);
+}
+
+void radio_stations_compact(bool force) {
+    if (!force && journal_lines < RADIO_STATIONS_JOURNAL_MAX) return;
+
+    // An interrupted rewrite leaves the old file and the journal in place
+    const char* tmp = RADIO_STATIONS_FILE ".tmp";
+    FILE* f = fopen(tmp, "w");
+    if (!f) return;
+    for (int i = 0; i < station_count; i++) write_station(f, &stations[i]);
+    if (fclose(f) != 0 || rename(tmp, RADIO_STATIONS_FILE) != 0) {
+        remove(tmp);
+        return;
+    }
+    remove(RADIO_STATIONS_JOURNAL);
+    journal_lines = 0;
+}
@@ -0,0 +1,43 @@
+#ifndef __RADIO_STATIONS_H__
+#define __RADIO_STATIONS_H__
+
+#include <stdbool.h>
+
+#include "radio.h"
+
+// User station list
+// Kept in RADIO_STATIONS_FILE as name|url|genre|slogan lines (users edit it too).
+// The list grows as needed; its strings are interned in a pool, so stations
+// sharing a genre or slogan share one copy, and a hash index on the URL makes
+// membership checks O(1). A URL is listed once.
+// Each add and remove is appended to RADIO_STATIONS_JOURNAL as it is made
+// ("+name|url|genre|slogan" or "-url") and replayed over the file on load;
+// radio_stations_compact() folds the journal into the file once it runs long.
+// Main thread only.
+
+#define RADIO_STATIONS_FILE SHARED_USERDATA_PATH "/radio_stations.txt"
+#define RADIO_STATIONS_JOURNAL SHARED_USERDATA_PATH "/radio_stations.log"
+#define RADIO_STATIONS_JOURNAL_MAX 64   // Changes journaled before compacting
+
+// Load the file and its journal; the defaults when there is no file
+void radio_stations_load(const RadioStation* defaults, int default_count);
+
+// The list (valid until the next change) and its length
+int radio_stations_get(RadioStation** stations);
+
+// Add a station (journaled); returns its index, -1 if the URL is listed already
+int radio_stations_add(const char* name, const char* url, const char* genre, const char* slogan);
+
+// Remove a station by index (journaled)
+void radio_stations_remove(int index);
+
+// Index of the station with url, -1 if none
+int radio_stations_find(const char* url);
+
+// Rewrite the file with the journal folded in: when it has run long, or always
+void radio_stations_compact(bool force);
+
+// Free the list and its strings
+void radio_stations_free(void);
+
+#endif
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "radio_timeshift.h"
+#include "defines.h"
+#include "api.h"
+
+#define TIMESHIFT_FILE SHARED_USERDATA_PATH "/radio_timeshift.bin"
+
+#define TIMESHIFT_MAX_TIME_MARKS 8192   // One per second of decoded audio
+#define TIMESHIFT_MAX_SONG_MARKS 256
+
+typedef struct {
+    uint64_t pos;
+    uint64_t ms;
+} TimeMark;
+
+static int store_fd = -1;
+static uint64_t write_pos = 0;          // Network thread stores (atomic)
+static uint64_t write_reserved = 0;     // write_pos plus the write in progress, stored before it (atomic)
+static uint64_t read_pos = 0;           // Decode thread stores (atomic)
+static bool write_failed = false;       // Network thread only
+
+// Marks are rings of increasing positions, guarded by marks_mutex
+static pthread_mutex_t marks_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TimeMark time_marks[TIMESHIFT_MAX_TIME_MARKS];
+static int time_mark_count = 0;
+static int time_mark_head = 0;          // Oldest mark
+static uint64_t song_marks[TIMESHIFT_MAX_SONG_MARKS];
+static int song_mark_count = 0;
+static int song_mark_head = 0;
+
+static uint64_t oldest_position(uint64_t w) {
+    return w > TIMESHIFT_CAPACITY ? w - TIMESHIFT_CAPACITY : 0;
+}
+
+int radio_timeshift_open(void) {
+    radio_timeshift_close();
+
+    store_fd = open(TIMESHIFT_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (store_fd < 0) {
+        LOG_error("Timeshift: can't create %s\n", TIMESHIFT_FILE);
+        return -1;
+    }
+    __atomic_store_n(&write_pos, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&write_reserved, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&read_pos, 0, __ATOMIC_RELEASE);
+    write_failed = false;
+
+    pthread_mutex_lock(&marks_mutex);
+    time_mark_count = time_mark_head = 0;
+    song_mark_count = song_mark_head = 0;
+    pthread_mutex_unlock(&marks_mutex);
+    return 0;
+}
+
+void radio_timeshift_close(void) {
+    if (store_fd < 0) return;
+    close(store_fd);
+    store_fd = -1;
+    unlink(TIMESHIFT_FILE);
+}
+
+bool radio_timeshift_isOpen(void) {
+    return store_fd >= 0;
+}
+
+// pwrite/pread a span of the ring, in two parts where it wraps
+static bool store_io(bool write, uint8_t* data, uint64_t pos, int len) {
+    while (len > 0) {
+        uint64_t offset = pos % TIMESHIFT_CAPACITY;
+        int part = len;
+        if (offset + part > TIMESHIFT_CAPACITY) part = (int)(TIMESHIFT_CAPACITY - offset);
+        ssize_t n = write ? pwrite(store_fd, data, part, offset) : pread(store_fd, data, part, offset);
+        if (n <= 0) return false;
+        data += n;
+        pos += n;
+        len -= n;
+    }
+    return true;
+}
+
+void radio_timeshift_write(const uint8_t* data, int len) {
+    if (store_fd < 0 || len <= 0) return;
+
+    // Readers check the reservation after a read: data under it may be half overwritten
+    uint64_t w = __atomic_load_n(&write_pos, __ATOMIC_RELAXED);
+    __atomic_store_n(&write_reserved, w + len, __ATOMIC_SEQ_CST);
+    if (!store_io(true, (uint8_t*)data, w, len) && !write_failed) {
+        // The bytes are lost; the decoder resyncs after the gap
+        LOG_error("Timeshift: write failed\n");
+        write_failed = true;
+    }
+    __atomic_store_n(&write_pos, w + len, __ATOMIC_RELEASE);
+}
+
+void radio_timeshift_markSong(void) {
+    uint64_t w = __atomic_load_n(&write_pos, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&marks_mutex);
+    int slot = (song_mark_head + song_mark_count) % TIMESHIFT_MAX_SONG_MARKS;
+    if (song_mark_count == TIMESHIFT_MAX_SONG_MARKS) {
+        song_mark_head = (song_mark_head + 1) % TIMESHIFT_MAX_SONG_MARKS;
+    } else {
+        song_mark_count++;
+    }
+    song_marks[slot] = w;
+    pthread_mutex_unlock(&marks_mutex);
+}
+
+int radio_timeshift_read(uint8_t* buf, int len) {
+    if (store_fd < 0 || len <= 0) return 0;
+
+    uint64_t w = __atomic_load_n(&write_pos, __ATOMIC_ACQUIRE);
+    uint64_t r = __atomic_load_n(&read_pos, __ATOMIC_RELAXED);
+    uint64_t oldest = oldest_position(__atomic_load_n(&write_reserved, __ATOMIC_SEQ_CST));
+    if (r < oldest) r = oldest;
+    if (r >= w) len = 0;
+    if ((uint64_t)len > w - r) len = (int)(w - r);
+    if (len <= 0 || !store_io(false, buf, r, len)) {
+        __atomic_store_n(&read_pos, r, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    // Overwritten while reading, or being overwritten (a write in progress counts
+    // from its reservation): drop it and continue from the oldest data
+    oldest = oldest_position(__atomic_load_n(&write_reserved, __ATOMIC_SEQ_CST));
+    if (r < oldest) {
+        __atomic_store_n(&read_pos, oldest, __ATOMIC_RELEASE);
+        return 0;
+    }
+    __atomic_store_n(&read_pos, r + len, __ATOMIC_RELEASE);
+    return len;
+}
+
+void radio_timeshift_seek(uint64_t pos) {
+    uint64_t w = __atomic_load_n(&write_pos, __ATOMIC_ACQUIRE);
+    if (pos > w) pos = w;
+    if (pos < oldest_position(w)) pos = oldest_position(w);
+    __atomic_store_n(&read_pos, pos, __ATOMIC_RELEASE);
+}
+
+void radio_timeshift_markTime(uint64_t pos, uint64_t ms) {
+    pthread_mutex_lock(&marks_mutex);
+    if (time_mark_count > 0) {
+        int last = (time_mark_head + time_mark_count - 1) % TIMESHIFT_MAX_TIME_MARKS;
+        // Replaying after a seek: those positions are marked already
+        if (pos <= time_marks[last].pos) {
+            pthread_mutex_unlock(&marks_mutex);
+            return;
+        }
+    }
+    int slot = (time_mark_head + time_mark_count) % TIMESHIFT_MAX_TIME_MARKS;
+    if (time_mark_count == TIMESHIFT_MAX_TIME_MARKS) {
+        time_mark_head = (time_mark_head + 1) % TIMESHIFT_MAX_TIME_MARKS;
+    } else {
+        time_mark_count++;
+    }
+    time_marks[slot].pos = pos;
+    time_marks[slot].ms = ms;
+    pthread_mutex_unlock(&marks_mutex);
+}
+
+uint64_t radio_timeshift_writePosition(void) {
+    return __atomic_load_n(&write_pos, __ATOMIC_ACQUIRE);
+}
+
+uint64_t radio_timeshift_readPosition(void) {
+    return __atomic_load_n(&read_pos, __ATOMIC_ACQUIRE);
+}
+
+uint64_t radio_timeshift_oldestPosition(void) {
+    return oldest_position(radio_timeshift_writePosition());
+}
+
+// Latest time mark matching (by ms or by pos) that is still recorded, or -1
+// Called with marks_mutex held.
+static int find_time_mark(bool by_ms, uint64_t value) {
+    uint64_t oldest = radio_timeshift_oldestPosition();
+    int found = -1;
+    // Binary search over the ring in logical order; both fields increase
+    int lo = 0, hi = time_mark_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        const TimeMark* m = &time_marks[(time_mark_head + mid) % TIMESHIFT_MAX_TIME_MARKS];
+        if ((by_ms ? m->ms : m->pos) <= value) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (found < 0) return -1;
+    int slot = (time_mark_head + found) % TIMESHIFT_MAX_TIME_MARKS;
+    return time_marks[slot].pos >= oldest ? slot : -1;
+}
+
+int64_t radio_timeshift_findTime(uint64_t ms, uint64_t* pos) {
+    pthread_mutex_lock(&marks_mutex);
+    int slot = find_time_mark(true, ms);
+    int64_t found_ms = -1;
+    if (slot >= 0) {
+        *pos = time_marks[slot].pos;
+        found_ms = (int64_t)time_marks[slot].ms;
+    }
+    pthread_mutex_unlock(&marks_mutex);
+    return found_ms;
+}
+
+int64_t radio_timeshift_timeAt(uint64_t pos, uint64_t* mark_pos) {
+    pthread_mutex_lock(&marks_mutex);
+    int slot = find_time_mark(false, pos);
+    int64_t ms = -1;
+    if (slot >= 0) {
+        *mark_pos = time_marks[slot].pos;
+        ms = (int64_t)time_marks[slot].ms;
+    }
+    pthread_mutex_unlock(&marks_mutex);
+    return ms;
+}
+
+int64_t radio_timeshift_songStart(uint64_t pos) {
+    uint64_t oldest = radio_timeshift_oldestPosition();
+    int64_t start = -1;
+    pthread_mutex_lock(&marks_mutex);
+    for (int i = song_mark_count - 1; i >= 0; i--) {
+        uint64_t mark = song_marks[(song_mark_head + i) % TIMESHIFT_MAX_SONG_MARKS];
+        if (mark <= pos) {
+            if (mark >= oldest) start = (int64_t)mark;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&marks_mutex);
+    return start;
+}
@@ -0,0 +1,62 @@
+#ifndef __RADIO_TIMESHIFT_H__
+#define __RADIO_TIMESHIFT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Radio time-shift store
+// The encoded audio of the playing station is appended to a bounded file on the SD
+// card that is used as a ring, at free-running byte positions. The decode stage
+// reads it back at its own position, so playback can pause or jump back while the
+// stream keeps recording; the newest data is served from the page cache. Time marks
+// (stream time of a position) and song marks (where the ICY/HLS title changed)
+// index the recording for seeking.
+// The network thread writes, the decode thread reads and seeks; positions can be
+// queried from any thread.
+
+// Bytes of the stream kept (about 68 minutes at 128 kbps)
+#define TIMESHIFT_CAPACITY (64 * 1024 * 1024)
+
+// Create an empty store for a new station
+// Returns 0 on success, -1 if the file can't be created (no time-shift then).
+int radio_timeshift_open(void);
+
+// Close and delete the store
+void radio_timeshift_close(void);
+
+bool radio_timeshift_isOpen(void);
+
+// Append stream bytes (network thread), overwriting the oldest when full
+void radio_timeshift_write(const uint8_t* data, int len);
+
+// A new song starts at the write position (network thread)
+void radio_timeshift_markSong(void);
+
+// Read up to len bytes at the read position (decode thread)
+// A reader that fell more than the capacity behind skips to the oldest data.
+// Returns the bytes read.
+int radio_timeshift_read(uint8_t* buf, int len);
+
+// Move the read position (decode thread), clamped to the recorded range
+void radio_timeshift_seek(uint64_t pos);
+
+// Stream time in ms of the frame at pos (decode thread, positions in increasing order)
+void radio_timeshift_markTime(uint64_t pos, uint64_t ms);
+
+// Positions: write (live edge), read, and the oldest still recorded
+uint64_t radio_timeshift_writePosition(void);
+uint64_t radio_timeshift_readPosition(void);
+uint64_t radio_timeshift_oldestPosition(void);
+
+// Latest time mark at or before ms: sets *pos and returns its ms,
+// or returns -1 if nothing recorded is that old
+int64_t radio_timeshift_findTime(uint64_t ms, uint64_t* pos);
+
+// Stream time of the latest time mark at or before pos (its position in *mark_pos),
+// or -1
+int64_t radio_timeshift_timeAt(uint64_t pos, uint64_t* mark_pos);
+
+// Start of the song playing at pos, or -1 if it began before the recording
+int64_t radio_timeshift_songStart(uint64_t pos);
+
+#endif
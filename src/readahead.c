@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "defines.h"
+#include "api.h"
+#include "readahead.h"
+#include "thread_role.h"
+#include "memstats.h"
+
+typedef struct {
+    uint8_t* data;
+    int64_t offset;             // Aligned file offset, -1 if empty
+    int length;                 // Valid bytes (short at the end of the file)
+    bool loading;               // Being read by the I/O thread
+} ReadAheadBlock;
+
+struct ReadAhead {
+    int fd;
+    int64_t size;
+    int64_t pos;                // Reader position (mutex held to change)
+    int block_count;            // Fewer than READAHEAD_BLOCKS for small files
+    ReadAheadBlock blocks[READAHEAD_BLOCKS];
+    int loading;                // Blocks being read
+    ReadAhead* next;            // Open files
+};
+
+static pthread_mutex_t ra_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ra_cond = PTHREAD_COND_INITIALIZER;   // Work to do, or a block was read
+static ReadAhead* open_files = NULL;
+static pthread_t io_thread;
+static bool io_running = false;
+static bool io_quit = false;
+
+static int64_t block_start(int64_t offset) {
+    return offset - offset % READAHEAD_BLOCK_SIZE;
+}
+
+static ReadAheadBlock* find_block(ReadAhead* ra, int64_t offset) {
+    for (int i = 0; i < ra->block_count; i++) {
+        if (ra->blocks[i].offset == offset) return &ra->blocks[i];
+    }
+    return NULL;
+}
+
+// A block free for offset: empty, or holding data outside the window (mutex held)
+static ReadAheadBlock* free_block(ReadAhead* ra, int64_t window_start, int64_t window_end) {
+    for (int i = 0; i < ra->block_count; i++) {
+        ReadAheadBlock* b = &ra->blocks[i];
+        if (b->loading) continue;
+        if (b->offset < 0 || b->offset < window_start || b->offset >= window_end) return b;
+    }
+    return NULL;
+}
+
+// The missing block nearest to its reader, over all files (mutex held)
+static ReadAheadBlock* next_fetch(ReadAhead** owner) {
+    for (int ahead = 0; ahead < READAHEAD_BLOCKS; ahead++) {
+        for (ReadAhead* ra = open_files; ra; ra = ra->next) {
+            if (ahead >= ra->block_count) continue;
+            int64_t window_start = block_start(ra->pos);
+            int64_t window_end = window_start + (int64_t)ra->block_count * READAHEAD_BLOCK_SIZE;
+            int64_t offset = window_start + (int64_t)ahead * READAHEAD_BLOCK_SIZE;
+            if (offset >= ra->size || find_block(ra, offset)) continue;
+            ReadAheadBlock* b = free_block(ra, window_start, window_end);
+            if (!b) continue;
+            b->offset = offset;
+            b->length = 0;
+            *owner = ra;
+            return b;
+        }
+    }
+    return NULL;
+}
+
+static void* io_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_DECODE);
+
+    pthread_mutex_lock(&ra_mutex);
+    while (!io_quit) {
+        ReadAhead* ra = NULL;
+        ReadAheadBlock* b = next_fetch(&ra);
+        if (!b) {
+            pthread_cond_wait(&ra_cond, &ra_mutex);
+            continue;
+        }
+        b->loading = true;
+        ra->loading++;
+        int64_t offset = b->offset;
+        int want = (int)(ra->size - offset < READAHEAD_BLOCK_SIZE ? ra->size - offset : READAHEAD_BLOCK_SIZE);
+        pthread_mutex_unlock(&ra_mutex);
+
+        int got = 0;
+        while (got < want) {
+            ssize_t n = pread(ra->fd, b->data + got, want - got, offset + got);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+            got += (int)n;
+        }
+
+        pthread_mutex_lock(&ra_mutex);
+        b->loading = false;
+        b->length = got;
+        if (got == 0) b->offset = -1;
+        ra->loading--;
+        pthread_cond_broadcast(&ra_cond);
+    }
+    pthread_mutex_unlock(&ra_mutex);
+    return NULL;
+}
+
+static ReadAhead* open_file(const char* filepath) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    ReadAhead* ra = calloc(1, sizeof(ReadAhead));
+    if (!ra || fstat(fd, &st) != 0) {
+        free(ra);
+        close(fd);
+        return NULL;
+    }
+    ra->fd = fd;
+    ra->size = st.st_size;
+    return ra;
+}
+
+ReadAhead* ReadAhead_open(const char* filepath) {
+    ReadAhead* ra = open_file(filepath);
+    if (!ra) return NULL;
+    // The cache is ours: keep the kernel's own read-ahead sequential too
+    posix_fadvise(ra->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    ra->block_count = (int)((ra->size + READAHEAD_BLOCK_SIZE - 1) / READAHEAD_BLOCK_SIZE);
+    if (ra->block_count > READAHEAD_BLOCKS) ra->block_count = READAHEAD_BLOCKS;
+    for (int i = 0; i < ra->block_count; i++) {
+        ra->blocks[i].offset = -1;
+        ra->blocks[i].data = MEM_MALLOC(MEM_TAG_READAHEAD, READAHEAD_BLOCK_SIZE);
+        if (!ra->blocks[i].data) {
+            ra->block_count = i;        // Reads ahead less, or reads directly
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&ra_mutex);
+    if (!io_running && !io_quit) {
+        io_running = pthread_create(&io_thread, NULL, io_thread_func, NULL) == 0;
+    }
+    ra->next = open_files;
+    open_files = ra;
+    pthread_cond_broadcast(&ra_cond);
+    pthread_mutex_unlock(&ra_mutex);
+    return ra;
+}
+
+ReadAhead* ReadAhead_openDirect(const char* filepath) {
+    return open_file(filepath);     // No blocks: not on the I/O thread's list either
+}
+
+void ReadAhead_close(ReadAhead* ra) {
+    if (!ra) return;
+    pthread_mutex_lock(&ra_mutex);
+    for (ReadAhead** link = &open_files; *link; link = &(*link)->next) {
+        if (*link == ra) {
+            *link = ra->next;
+            break;
+        }
+    }
+    while (ra->loading > 0) pthread_cond_wait(&ra_cond, &ra_mutex);
+    pthread_mutex_unlock(&ra_mutex);
+
+    for (int i = 0; i < ra->block_count; i++) MEM_FREE(MEM_TAG_READAHEAD, ra->blocks[i].data);
+    close(ra->fd);
+    free(ra);
+}
+
+// Copy from offset, out of the blocks where they hold it and from the file where not
+// The reader waits for a block being read (it is the next thing it needs) and
+// carries the position along, so the window follows; any other read takes what is
+// resident and preads the rest. Called and returns with the mutex held.
+static size_t read_range(ReadAhead* ra, uint8_t* out, size_t bytes, int64_t offset, bool reader) {
+    size_t total = 0;
+    while (total < bytes && offset < ra->size) {
+        int64_t start = block_start(offset);
+        ReadAheadBlock* b = find_block(ra, start);
+        if (reader && b && b->loading) {
+            pthread_cond_wait(&ra_cond, &ra_mutex);
+            continue;
+        }
+        size_t want = bytes - total;
+        if (b && offset < b->offset + b->length) {
+            size_t avail = (size_t)(b->offset + b->length - offset);
+            size_t n = want < avail ? want : avail;
+            memcpy(out + total, b->data + (offset - b->offset), n);
+            total += n;
+            offset += n;
+            if (reader) {
+                ra->pos = offset;
+                // Crossed into the next block: the one behind can be refilled
+                if (block_start(offset) != start) pthread_cond_broadcast(&ra_cond);
+            }
+            continue;
+        }
+
+        // Not read ahead (the reader just seeked): read directly, and have the
+        // reader's window refilled from here
+        if (reader) pthread_cond_broadcast(&ra_cond);
+        pthread_mutex_unlock(&ra_mutex);
+        ssize_t n;
+        do {
+            n = pread(ra->fd, out + total, want, offset);
+        } while (n < 0 && errno == EINTR);
+        pthread_mutex_lock(&ra_mutex);
+        if (n <= 0) break;
+        total += (size_t)n;
+        offset += n;
+        if (reader) ra->pos = offset;
+    }
+    return total;
+}
+
+size_t ReadAhead_read(ReadAhead* ra, void* buffer, size_t bytes) {
+    pthread_mutex_lock(&ra_mutex);
+    size_t total = read_range(ra, (uint8_t*)buffer, bytes, ra->pos, true);
+    pthread_mutex_unlock(&ra_mutex);
+    return total;
+}
+
+size_t ReadAhead_readAt(ReadAhead* ra, void* buffer, size_t bytes, int64_t offset) {
+    if (offset < 0 || offset > ra->size) return 0;
+    pthread_mutex_lock(&ra_mutex);
+    if (block_start(offset) != block_start(ra->pos)) pthread_cond_broadcast(&ra_cond);
+    ra->pos = offset;
+    size_t total = read_range(ra, (uint8_t*)buffer, bytes, offset, true);
+    pthread_mutex_unlock(&ra_mutex);
+    return total;
+}
+
+size_t ReadAhead_pread(ReadAhead* ra, void* buffer, size_t bytes, int64_t offset) {
+    if (offset < 0) return 0;
+    pthread_mutex_lock(&ra_mutex);
+    size_t total = read_range(ra, (uint8_t*)buffer, bytes, offset, false);
+    pthread_mutex_unlock(&ra_mutex);
+    return total;
+}
+
+int ReadAhead_seek(ReadAhead* ra, int64_t offset, int whence) {
+    int64_t base = whence == SEEK_CUR ? ra->pos : whence == SEEK_END ? ra->size : 0;
+    int64_t target = base + offset;
+    if (target < 0 || target > ra->size) return -1;
+    pthread_mutex_lock(&ra_mutex);
+    bool moved_block = block_start(target) != block_start(ra->pos);
+    ra->pos = target;
+    if (moved_block) pthread_cond_broadcast(&ra_cond);
+    pthread_mutex_unlock(&ra_mutex);
+    return 0;
+}
+
+int64_t ReadAhead_tell(const ReadAhead* ra) {
+    return ra->pos;
+}
+
+int64_t ReadAhead_size(const ReadAhead* ra) {
+    return ra->size;
+}
+
+void ReadAhead_quit(void) {
+    pthread_mutex_lock(&ra_mutex);
+    bool running = io_running;
+    io_quit = true;
+    pthread_cond_broadcast(&ra_cond);
+    pthread_mutex_unlock(&ra_mutex);
+    if (running) pthread_join(io_thread, NULL);
+
+    pthread_mutex_lock(&ra_mutex);
+    io_running = false;
+    io_quit = false;
+    pthread_mutex_unlock(&ra_mutex);
+}
@@ -0,0 +1,54 @@
+#ifndef __READAHEAD_H__
+#define __READAHEAD_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Read-ahead file input for the decoders
+// One I/O thread reads every open file in large aligned blocks ahead of its
+// reader, into a small per-file block cache. Decoders read from memory, so an SD
+// card latency spike is absorbed by the compressed data already buffered (a
+// second or more per block) instead of stalling decoding. The next track's file is
+// opened by its prefetch, so it fills too. A read with no block ready (after a
+// seek) reads the file directly. One reader thread per file.
+//
+// Besides its reader, a file takes positional reads from any thread: they copy
+// what is resident and read the rest with pread, never moving the reader or its
+// window, so a scanner or a decoder helper shares the decoder's file without
+// seeking it. Offsets are 64-bit throughout.
+
+#define READAHEAD_BLOCK_SIZE (256 * 1024)
+#define READAHEAD_BLOCKS 4              // Per file: 1 MB ahead of the reader
+
+typedef struct ReadAhead ReadAhead;
+
+// Open filepath and start reading it ahead; NULL if it can't be opened
+ReadAhead* ReadAhead_open(const char* filepath);
+
+// Open filepath for positional reads only: nothing is read ahead or cached
+// For scanners that jump through a file; NULL if it can't be opened.
+ReadAhead* ReadAhead_openDirect(const char* filepath);
+
+// Stop reading ahead (waits for a block being read) and close
+void ReadAhead_close(ReadAhead* ra);
+
+// Copy up to bytes from the current position; fewer only at the end of the file
+size_t ReadAhead_read(ReadAhead* ra, void* buffer, size_t bytes);
+
+// The reader's read at offset: the position and window move there first
+size_t ReadAhead_readAt(ReadAhead* ra, void* buffer, size_t bytes, int64_t offset);
+
+// Copy up to bytes from offset, from any thread; fewer only at the end of the file
+// Leaves the reader's position alone.
+size_t ReadAhead_pread(ReadAhead* ra, void* buffer, size_t bytes, int64_t offset);
+
+// Like fseek: 0, or -1 if the offset is out of range
+int ReadAhead_seek(ReadAhead* ra, int64_t offset, int whence);
+
+int64_t ReadAhead_tell(const ReadAhead* ra);
+int64_t ReadAhead_size(const ReadAhead* ra);
+
+// Stop the I/O thread, once every file is closed
+void ReadAhead_quit(void);
+
+#endif
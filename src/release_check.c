@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "release_check.h"
+#include "radio_net.h"
+#include "selfupdate.h"
+#include "defines.h"
+#include "api.h"
+
+#include "include/parson/parson.h"
+
+#define RELEASE_JSON_MAX (2 * 1024 * 1024)   // yt-dlp lists a few dozen assets
+
+typedef struct {
+    const char* repo;                   // GitHub "owner/repo"
+    const char* asset;                  // Release asset to download
+    const char* manifest;               // Its file hash manifest (NULL = none)
+} ReleaseSource;
+
+static const ReleaseSource sources[RELEASE_COUNT] = {
+    [RELEASE_APP] = {APP_GITHUB_REPO, APP_RELEASE_ASSET, APP_RELEASE_MANIFEST},
+    [RELEASE_YTDLP] = {"yt-dlp/yt-dlp", "yt-dlp_linux_aarch64", NULL},
+};
+
+typedef struct {
+    ReleaseInfo info;
+    int result;                         // Of the last check
+    uint32_t checked;                   // Monotonic seconds (0 = never)
+    RadioNetValidators validators;      // Of info, for revalidating it
+} ReleaseEntry;
+
+static ReleaseEntry entries[RELEASE_COUNT];
+static pthread_mutex_t check_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec + 1;     // Never 0
+}
+
+static bool entry_fresh(const ReleaseEntry* entry, uint32_t now) {
+    if (entry->checked == 0) return false;
+    uint32_t ttl = entry->result == RELEASE_CHECK_OK ? RELEASE_CHECK_TTL : RELEASE_CHECK_RETRY;
+    return now - entry->checked < ttl;
+}
+
+// Read tag, notes and the asset URLs from a release JSON
+static int parse_release(const char* json, const ReleaseSource* source, ReleaseInfo* info) {
+    JSON_Value* root = json_parse_string(json);
+    JSON_Object* obj = json_value_get_object(root);
+    const char* tag = obj ? json_object_get_string(obj, "tag_name") : NULL;
+    if (!tag || !tag[0]) {
+        json_value_free(root);
+        return RELEASE_CHECK_INVALID;
+    }
+
+    memset(info, 0, sizeof(*info));
+    snprintf(info->tag, sizeof(info->tag), "%s", tag);
+    const char* body = json_object_get_string(obj, "body");
+    if (body) snprintf(info->notes, sizeof(info->notes), "%s", body);
+
+    JSON_Array* assets = json_object_get_array(obj, "assets");
+    for (size_t i = 0; i < json_array_get_count(assets); i++) {
+        JSON_Object* a = json_array_get_object(assets, i);
+        const char* name = json_object_get_string(a, "name");
+        const char* url = json_object_get_string(a, "browser_download_url");
+        if (!name || !url) continue;
+        if (strcmp(name, source->asset) == 0) {
+            snprintf(info->asset_url, sizeof(info->asset_url), "%s", url);
+        } else if (source->manifest && strcmp(name, source->manifest) == 0) {
+            snprintf(info->manifest_url, sizeof(info->manifest_url), "%s", url);
+        }
+    }
+
+    json_value_free(root);
+    return RELEASE_CHECK_OK;
+}
+
+// Fetch (or revalidate) the latest release of one repo into its entry
+static void check_one(ReleaseRepo repo, uint32_t now) {
+    ReleaseEntry* entry = &entries[repo];
+
+    char url[256];
+    snprintf(url, sizeof(url), "https://api.github.com/repos/%s/releases/latest", sources[repo].repo);
+
+    // Only a release we still hold may be answered with "not modified"
+    if (entry->result != RELEASE_CHECK_OK) memset(&entry->validators, 0, sizeof(entry->validators));
+
+    RadioNetBody json = {0};
+    RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_UPDATES);
+    int len = radio_net_fetchBody(url, &json, RELEASE_JSON_MAX, &entry->validators);
+    radio_net_setAccount(account);
+    entry->checked = now;
+    if (len == RADIO_NET_NOT_MODIFIED) {
+        entry->result = RELEASE_CHECK_OK;
+    } else if (len <= 0) {
+        LOG_error("[ReleaseCheck] Fetch failed: %s\n", url);
+        entry->result = RELEASE_CHECK_FAILED;
+    } else {
+        entry->result = parse_release((const char*)json.data, &sources[repo], &entry->info);
+    }
+    radio_net_freeBody(&json);
+}
+
+int release_check_get(ReleaseRepo repo, ReleaseInfo* info) {
+    if (repo < 0 || repo >= RELEASE_COUNT || !info) return RELEASE_CHECK_INVALID;
+
+    // Offline: nothing to fetch or to remember
+    if (!radio_net_online()) return RELEASE_CHECK_OFFLINE;
+
+    pthread_mutex_lock(&check_mutex);
+    uint32_t now = monotonic_seconds();
+    if (!entry_fresh(&entries[repo], now)) {
+        // Every stale release in one go, over the same connection
+        for (int r = 0; r < RELEASE_COUNT; r++) {
+            if (!entry_fresh(&entries[r], now)) check_one((ReleaseRepo)r, now);
+        }
+    }
+
+    int result = entries[repo].result;
+    if (result == RELEASE_CHECK_OK) *info = entries[repo].info;
+    pthread_mutex_unlock(&check_mutex);
+    return result;
+}
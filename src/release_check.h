@@ -0,0 +1,40 @@
+#ifndef __RELEASE_CHECK_H__
+#define __RELEASE_CHECK_H__
+
+// GitHub release check
+// Latest releases of the app and of yt-dlp, read from the GitHub API in-process
+// (radio_net keep-alive connection). A check fetches every release whose result
+// is older than RELEASE_CHECK_TTL in one go, so the app and yt-dlp checks share
+// one connection and the second one is usually answered from memory. Expired
+// results are revalidated with their ETag, which GitHub answers with a 304 that
+// doesn't count against its rate limit. A failed check is remembered for
+// RELEASE_CHECK_RETRY so a device offline doesn't try again on every request.
+// Safe from any thread; a check blocks, so call it from a background thread.
+
+#define RELEASE_CHECK_TTL (15 * 60)     // Seconds
+#define RELEASE_CHECK_RETRY 30          // Seconds
+
+typedef enum {
+    RELEASE_APP = 0,                    // APP_GITHUB_REPO, assets APP_RELEASE_ASSET/_MANIFEST
+    RELEASE_YTDLP,                      // yt-dlp/yt-dlp, asset yt-dlp_linux_aarch64
+    RELEASE_COUNT
+} ReleaseRepo;
+
+typedef struct {
+    char tag[32];                       // tag_name, e.g. "v1.2.0"
+    char asset_url[512];                // Download URL of the repo's asset ("" = none)
+    char manifest_url[512];             // Download URL of its file hash manifest ("" = none)
+    char notes[1024];                   // Release body
+} ReleaseInfo;
+
+// release_check_get() results
+#define RELEASE_CHECK_OK 0
+#define RELEASE_CHECK_OFFLINE -1        // Offline (radio_net_online)
+#define RELEASE_CHECK_FAILED -2         // GitHub didn't answer
+#define RELEASE_CHECK_INVALID -3        // Answer without a release
+
+// Latest release of repo into *info
+// Returns RELEASE_CHECK_OK, or one of the errors above.
+int release_check_get(ReleaseRepo repo, ReleaseInfo* info);
+
+#endif
@@ -0,0 +1,486 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <samplerate.h>
+
+#include "defines.h"
+#include "api.h"
+#include "resampler.h"
+#include "log_async.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define RESAMPLER_CHANNELS 2
+#define RESAMPLER_TAPS_MAX 256    // Longest filter, after scaling for downsampling
+
+typedef struct {
+    const char* name;
+    int taps;                   // Filter length in output frames (multiple of 4)
+    float cutoff;               // Passband edge as a fraction of the lower Nyquist
+    float kaiser_beta;          // Window shape; 0 = Catmull-Rom cubic instead of a sinc
+    int fallback;               // libsamplerate converter for ratios without a bank
+} QualityTier;
+
+static const QualityTier tiers[RESAMPLER_QUALITY_COUNT] = {
+    [RESAMPLER_LOW_POWER] = {"low power", 4,  1.00f, 0.0f,  SRC_LINEAR},
+    [RESAMPLER_STANDARD]  = {"standard",  32, 0.88f, 8.0f,  SRC_SINC_FASTEST},
+    [RESAMPLER_HIGH]      = {"high",      64, 0.93f, 10.0f, SRC_SINC_MEDIUM_QUALITY},
+};
+
+typedef enum {
+    SAMPLE_NONE,
+    SAMPLE_S16,
+    SAMPLE_F32
+} SampleType;
+
+struct Resampler {
+    ResamplerQuality quality;
+    int src_rate;               // Ratio set up for (0 = none yet)
+    int dst_rate;
+    int up;                     // dst_rate:src_rate in lowest terms: output phases per input frame
+    int down;                   // Phases advanced per output frame
+
+    // Polyphase bank: up rows of taps coefficients, row p for an output p/up of a
+    // frame past the centre of its window
+    int taps;
+    int bank_up;                // Ratio and tier the bank was built for
+    int bank_down;
+    ResamplerQuality bank_quality;
+    int16_t* bank_q15;
+    float* bank_f32;
+
+    // Input the filter still needs: taps/2 - 1 frames of history before the
+    // centre of the next output's window (starting at pos), then the lookahead
+    uint8_t* buf;
+    size_t buf_bytes;           // Capacity
+    size_t buf_frames;
+    size_t pos;
+    size_t skip;                // Input frames a large downsampling step jumped over
+    int phase;
+    SampleType type;            // Of the buffered frames
+    bool primed;                // History in place
+
+    // libsamplerate, for ratios with too many phases
+    SRC_STATE* src;
+    int src_converter;
+    float* src_in;
+    float* src_out;
+    float* src_carry;           // Input it didn't take (output full), fed first next call
+    float* src_join;            // The carried input followed by a call's own
+    size_t src_in_size;         // Samples
+    size_t src_out_size;
+    size_t src_carry_size;
+    size_t src_join_size;
+    size_t src_carry_frames;
+};
+
+static int gcd(int a, int b) {
+    while (b) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static size_t frame_bytes(SampleType type) {
+    return RESAMPLER_CHANNELS * (type == SAMPLE_F32 ? sizeof(float) : sizeof(int16_t));
+}
+
+// ============ FILTER DESIGN ============
+
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 64; k++) {
+        double f = x / (2.0 * k);
+        term *= f * f;
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+// Weight of an input frame t frames from the output time, for a window of half
+// frames either side (fc: cutoff, fraction of input Nyquist)
+static double kernel(const QualityTier* tier, double t, double half, double fc) {
+    if (tier->kaiser_beta == 0.0f) {
+        double a = fabs(t);
+        if (a < 1.0) return 1.5 * a * a * a - 2.5 * a * a + 1.0;
+        if (a < 2.0) return -0.5 * a * a * a + 2.5 * a * a - 4.0 * a + 2.0;
+        return 0.0;
+    }
+    double u = t / half;
+    if (u <= -1.0 || u >= 1.0) return 0.0;
+    double x = M_PI * fc * t;
+    double sinc = x == 0.0 ? 1.0 : sin(x) / x;
+    return fc * sinc * bessel_i0(tier->kaiser_beta * sqrt(1.0 - u * u)) / bessel_i0(tier->kaiser_beta);
+}
+
+static int build_bank(Resampler* r) {
+    const QualityTier* tier = &tiers[r->quality];
+
+    // Downsampling stretches the window over more input frames, so the filter
+    // keeps its steepness at the output rate
+    int taps = tier->taps;
+    if (r->down > r->up && tier->kaiser_beta != 0.0f) {
+        taps = (int)(((int64_t)tier->taps * r->down / r->up + 3) & ~3);
+        if (taps > RESAMPLER_TAPS_MAX) taps = RESAMPLER_TAPS_MAX;
+    }
+    size_t count = (size_t)r->up * taps;
+    int16_t* q15 = realloc(r->bank_q15, count * sizeof(int16_t));
+    if (q15) r->bank_q15 = q15;
+    float* f32 = realloc(r->bank_f32, count * sizeof(float));
+    if (f32) r->bank_f32 = f32;
+    if (!q15 || !f32) {
+        LOG_ASYNC_error("Resampler: no memory for %d phases\n", r->up);
+        r->bank_up = 0;
+        return -1;
+    }
+
+    // Downsampling moves the cutoff down to the output's Nyquist
+    double fc = tier->cutoff * (r->up < r->down ? (double)r->up / r->down : 1.0);
+    int lead = taps / 2 - 1;
+    double h[RESAMPLER_TAPS_MAX];
+    for (int p = 0; p < r->up; p++) {
+        double frac = (double)p / r->up;
+        double sum = 0.0;
+        for (int j = 0; j < taps; j++) {
+            h[j] = kernel(tier, j - lead - frac, taps / 2, fc);
+            sum += h[j];
+        }
+        // Unity gain at DC in every phase, so no phase ripples a constant signal
+        for (int j = 0; j < taps; j++) {
+            double v = h[j] / sum;
+            long q = lrint(v * 32768.0);
+            r->bank_f32[(size_t)p * taps + j] = (float)v;
+            r->bank_q15[(size_t)p * taps + j] = (int16_t)(q > 32767 ? 32767 : q < -32768 ? -32768 : q);
+        }
+    }
+
+    r->taps = taps;
+    r->bank_up = r->up;
+    r->bank_down = r->down;
+    r->bank_quality = r->quality;
+    LOG_ASYNC_info("Resampler: %d -> %d Hz, %s (%d phases x %d taps)\n",
+             r->src_rate, r->dst_rate, tier->name, r->up, r->taps);
+    return 0;
+}
+
+// ============ INPUT BUFFER ============
+
+static int reserve_bytes(Resampler* r, size_t bytes) {
+    if (r->buf_bytes >= bytes) return 0;
+    uint8_t* grown = realloc(r->buf, bytes);
+    if (!grown) {
+        LOG_ASYNC_error("Resampler: no memory for %zu KB of input\n", bytes / 1024);
+        return -1;
+    }
+    r->buf = grown;
+    r->buf_bytes = bytes;
+    return 0;
+}
+
+// Put frames of silence in front of the buffered input
+static int prepend_zeros(Resampler* r, size_t frames) {
+    size_t fb = frame_bytes(r->type);
+    if (reserve_bytes(r, (r->buf_frames + frames) * fb) != 0) return -1;
+    memmove(r->buf + frames * fb, r->buf, r->buf_frames * fb);
+    memset(r->buf, 0, frames * fb);
+    r->buf_frames += frames;
+    return 0;
+}
+
+// Build the bank the tier and ratio need; a new tier keeps the window centred
+// on the same input frame, so switching mid-stream doesn't jump
+static int prepare_bank(Resampler* r) {
+    if (r->bank_up != r->up || r->bank_down != r->down || r->bank_quality != r->quality) {
+        int old_lead = r->taps / 2 - 1;
+        if (build_bank(r) != 0) return -1;
+        if (r->primed) {
+            long pos = (long)r->pos + old_lead - (r->taps / 2 - 1);
+            if (pos < 0) {
+                if (prepend_zeros(r, (size_t)-pos) != 0) return -1;
+                pos = 0;
+            }
+            r->pos = (size_t)pos;
+        }
+    }
+    if (!r->primed) {
+        if (prepend_zeros(r, (size_t)(r->taps / 2 - 1)) != 0) return -1;
+        r->primed = true;
+    }
+    return 0;
+}
+
+// Queue input behind what the filter still needs (plus the lookahead's worth of
+// silence at the end of the stream)
+static int append_input(Resampler* r, const void* in, size_t frames, bool is_last) {
+    size_t fb = frame_bytes(r->type);
+    size_t keep_from = r->pos < r->buf_frames ? r->pos : r->buf_frames;
+    r->skip += r->pos - keep_from;
+    memmove(r->buf, r->buf + keep_from * fb, (r->buf_frames - keep_from) * fb);
+    r->buf_frames -= keep_from;
+    r->pos = 0;
+
+    size_t skipped = r->skip < frames ? r->skip : frames;
+    r->skip -= skipped;
+    frames -= skipped;
+
+    size_t pad = is_last ? (size_t)(r->taps / 2) : 0;
+    if (reserve_bytes(r, (r->buf_frames + frames + pad) * fb) != 0) return -1;
+    if (frames > 0) memcpy(r->buf + r->buf_frames * fb, (const uint8_t*)in + skipped * fb, frames * fb);
+    memset(r->buf + (r->buf_frames + frames) * fb, 0, pad * fb);
+    r->buf_frames += frames + pad;
+    return 0;
+}
+
+// ============ POLYPHASE FILTER ============
+
+static inline void advance(Resampler* r) {
+    r->phase += r->down;
+    if (r->phase >= r->up) {
+        r->pos += r->phase / r->up;
+        r->phase %= r->up;
+    }
+}
+
+static inline int16_t round_q15(int32_t acc) {
+    acc = (acc + (1 << 14)) >> 15;
+    return acc > 32767 ? 32767 : acc < -32768 ? -32768 : (int16_t)acc;
+}
+
+static size_t filter_s16(Resampler* r, int16_t* out, size_t max_out) {
+    const int16_t* x = (const int16_t*)r->buf;
+    int taps = r->taps;
+    size_t n = 0;
+    while (n < max_out && r->pos + taps <= r->buf_frames) {
+        const int16_t* c = &r->bank_q15[(size_t)r->phase * taps];
+        const int16_t* w = &x[r->pos * RESAMPLER_CHANNELS];
+        int32_t left = 0, right = 0;
+#if defined(__ARM_NEON)
+        int32x4_t acc_l = vdupq_n_s32(0), acc_r = vdupq_n_s32(0);
+        for (int j = 0; j < taps; j += 4) {
+            int16x4x2_t v = vld2_s16(&w[j * RESAMPLER_CHANNELS]);
+            int16x4_t k = vld1_s16(&c[j]);
+            acc_l = vmlal_s16(acc_l, v.val[0], k);
+            acc_r = vmlal_s16(acc_r, v.val[1], k);
+        }
+        int32x2_t sum = vpadd_s32(vadd_s32(vget_low_s32(acc_l), vget_high_s32(acc_l)),
+                                  vadd_s32(vget_low_s32(acc_r), vget_high_s32(acc_r)));
+        left = vget_lane_s32(sum, 0);
+        right = vget_lane_s32(sum, 1);
+#else
+        for (int j = 0; j < taps; j++) {
+            left += w[j * RESAMPLER_CHANNELS] * c[j];
+            right += w[j * RESAMPLER_CHANNELS + 1] * c[j];
+        }
+#endif
+        out[n * RESAMPLER_CHANNELS] = round_q15(left);
+        out[n * RESAMPLER_CHANNELS + 1] = round_q15(right);
+        n++;
+        advance(r);
+    }
+    return n;
+}
+
+static size_t filter_f32(Resampler* r, float* out, size_t max_out) {
+    const float* x = (const float*)r->buf;
+    int taps = r->taps;
+    size_t n = 0;
+    while (n < max_out && r->pos + taps <= r->buf_frames) {
+        const float* c = &r->bank_f32[(size_t)r->phase * taps];
+        const float* w = &x[r->pos * RESAMPLER_CHANNELS];
+        float left = 0.0f, right = 0.0f;
+#if defined(__ARM_NEON)
+        float32x4_t acc_l = vdupq_n_f32(0.0f), acc_r = vdupq_n_f32(0.0f);
+        for (int j = 0; j < taps; j += 4) {
+            float32x4x2_t v = vld2q_f32(&w[j * RESAMPLER_CHANNELS]);
+            float32x4_t k = vld1q_f32(&c[j]);
+            acc_l = vmlaq_f32(acc_l, v.val[0], k);
+            acc_r = vmlaq_f32(acc_r, v.val[1], k);
+        }
+        float32x2_t sum = vpadd_f32(vadd_f32(vget_low_f32(acc_l), vget_high_f32(acc_l)),
+                                    vadd_f32(vget_low_f32(acc_r), vget_high_f32(acc_r)));
+        left = vget_lane_f32(sum, 0);
+        right = vget_lane_f32(sum, 1);
+#else
+        for (int j = 0; j < taps; j++) {
+            left += w[j * RESAMPLER_CHANNELS] * c[j];
+            right += w[j * RESAMPLER_CHANNELS + 1] * c[j];
+        }
+#endif
+        out[n * RESAMPLER_CHANNELS] = left;
+        out[n * RESAMPLER_CHANNELS + 1] = right;
+        n++;
+        advance(r);
+    }
+    return n;
+}
+
+// ============ LIBSAMPLERATE FALLBACK ============
+
+static int prepare_fallback(Resampler* r) {
+    int converter = tiers[r->quality].fallback;
+    if (r->src && r->src_converter == converter) return 0;
+    if (r->src) src_delete(r->src);
+    int error = 0;
+    r->src = src_new(converter, RESAMPLER_CHANNELS, &error);
+    if (!r->src) {
+        LOG_ASYNC_error("Resampler: %s\n", src_strerror(error));
+        return -1;
+    }
+    r->src_converter = converter;
+    return 0;
+}
+
+static int ensure_scratch(float** buffer, size_t* size, size_t samples) {
+    if (*size >= samples) return 0;
+    float* grown = realloc(*buffer, samples * sizeof(float));
+    if (!grown) {
+        LOG_ASYNC_error("Resampler: no memory for %zu KB of scratch\n", samples * sizeof(float) / 1024);
+        return -1;
+    }
+    *buffer = grown;
+    *size = samples;
+    return 0;
+}
+
+static size_t fallback_f32(Resampler* r, const float* in, size_t frames,
+                           float* out, size_t max_out, bool is_last) {
+    static const float silence[RESAMPLER_CHANNELS];
+    const float* input = in ? in : silence;
+    size_t input_frames = frames;
+    if (r->src_carry_frames > 0) {
+        size_t carried = r->src_carry_frames * RESAMPLER_CHANNELS;
+        if (ensure_scratch(&r->src_join, &r->src_join_size, carried + frames * RESAMPLER_CHANNELS) != 0) return 0;
+        memcpy(r->src_join, r->src_carry, carried * sizeof(float));
+        if (frames > 0) memcpy(&r->src_join[carried], in, frames * RESAMPLER_CHANNELS * sizeof(float));
+        input = r->src_join;
+        input_frames += r->src_carry_frames;
+    }
+    if (input_frames == 0 && !is_last) return 0;
+
+    SRC_DATA data = {0};
+    data.data_in = input;
+    data.input_frames = input_frames;
+    data.data_out = out;
+    data.output_frames = max_out;
+    data.src_ratio = (double)r->dst_rate / r->src_rate;
+    data.end_of_input = is_last ? 1 : 0;
+    int error = src_process(r->src, &data);
+    if (error) {
+        LOG_ASYNC_error("Resampler: %s\n", src_strerror(error));
+        return 0;
+    }
+
+    // With the output full it stops short of the input: keep the rest for next time
+    size_t left = input_frames - (size_t)data.input_frames_used;
+    r->src_carry_frames = 0;
+    if (left > 0 && ensure_scratch(&r->src_carry, &r->src_carry_size, left * RESAMPLER_CHANNELS) == 0) {
+        memcpy(r->src_carry, &input[data.input_frames_used * RESAMPLER_CHANNELS],
+               left * RESAMPLER_CHANNELS * sizeof(float));
+        r->src_carry_frames = left;
+    }
+    return data.output_frames_gen;
+}
+
+static size_t fallback_s16(Resampler* r, const int16_t* in, size_t frames,
+                           int16_t* out, size_t max_out, bool is_last) {
+    if (ensure_scratch(&r->src_in, &r->src_in_size, (frames + 1) * RESAMPLER_CHANNELS) != 0 ||
+        ensure_scratch(&r->src_out, &r->src_out_size, max_out * RESAMPLER_CHANNELS) != 0) {
+        return 0;
+    }
+    if (frames > 0) src_short_to_float_array(in, r->src_in, (int)(frames * RESAMPLER_CHANNELS));
+    size_t n = fallback_f32(r, r->src_in, frames, r->src_out, max_out, is_last);
+    src_float_to_short_array(r->src_out, out, (int)(n * RESAMPLER_CHANNELS));
+    return n;
+}
+
+// ============ PUBLIC API ============
+
+Resampler* Resampler_new(ResamplerQuality quality) {
+    Resampler* r = calloc(1, sizeof(Resampler));
+    if (!r) return NULL;
+    r->quality = quality >= 0 && quality < RESAMPLER_QUALITY_COUNT ? quality : RESAMPLER_STANDARD;
+    return r;
+}
+
+void Resampler_free(Resampler* r) {
+    if (!r) return;
+    if (r->src) src_delete(r->src);
+    free(r->src_in);
+    free(r->src_out);
+    free(r->src_carry);
+    free(r->src_join);
+    free(r->bank_q15);
+    free(r->bank_f32);
+    free(r->buf);
+    free(r);
+}
+
+void Resampler_reset(Resampler* r) {
+    r->buf_frames = 0;
+    r->pos = 0;
+    r->skip = 0;
+    r->phase = 0;
+    r->primed = false;
+    r->src_carry_frames = 0;
+    if (r->src) src_reset(r->src);
+}
+
+void Resampler_setQuality(Resampler* r, ResamplerQuality quality) {
+    if (quality >= 0 && quality < RESAMPLER_QUALITY_COUNT) r->quality = quality;
+}
+
+int Resampler_reserve(Resampler* r, size_t frames) {
+    return reserve_bytes(r, (frames + 2 * RESAMPLER_TAPS_MAX) * frame_bytes(SAMPLE_F32));
+}
+
+// New ratio: a new stream, nothing buffered carries over
+static void set_ratio(Resampler* r, int src_rate, int dst_rate) {
+    int g = gcd(src_rate, dst_rate);
+    r->src_rate = src_rate;
+    r->dst_rate = dst_rate;
+    r->up = dst_rate / g;
+    r->down = src_rate / g;
+    Resampler_reset(r);
+    if (r->up > RESAMPLER_PHASES_MAX) {
+        LOG_ASYNC_info("Resampler: %d -> %d Hz through libsamplerate\n", src_rate, dst_rate);
+    }
+}
+
+static size_t process(Resampler* r, const void* in, size_t frames, int src_rate, int dst_rate,
+                      SampleType type, void* out, size_t max_out, bool is_last) {
+    if (src_rate <= 0 || dst_rate <= 0) return 0;
+    if (src_rate != r->src_rate || dst_rate != r->dst_rate) set_ratio(r, src_rate, dst_rate);
+
+    if (r->up > RESAMPLER_PHASES_MAX) {
+        if (prepare_fallback(r) != 0) return 0;
+        return type == SAMPLE_F32 ? fallback_f32(r, (const float*)in, frames, (float*)out, max_out, is_last)
+                                  : fallback_s16(r, (const int16_t*)in, frames, (int16_t*)out, max_out, is_last);
+    }
+
+    if (type != r->type) {
+        Resampler_reset(r);
+        r->type = type;
+    }
+    if (prepare_bank(r) != 0 || append_input(r, in, frames, is_last) != 0) return 0;
+    return type == SAMPLE_F32 ? filter_f32(r, (float*)out, max_out) : filter_s16(r, (int16_t*)out, max_out);
+}
+
+size_t Resampler_processS16(Resampler* r, const int16_t* in, size_t frames,
+                            int src_rate, int dst_rate, int16_t* out, size_t max_out, bool is_last) {
+    return process(r, in, frames, src_rate, dst_rate, SAMPLE_S16, out, max_out, is_last);
+}
+
+size_t Resampler_processF32(Resampler* r, const float* in, size_t frames,
+                            int src_rate, int dst_rate, float* out, size_t max_out, bool is_last) {
+    return process(r, in, frames, src_rate, dst_rate, SAMPLE_F32, out, max_out, is_last);
+}
+
+const char* Resampler_qualityName(ResamplerQuality quality) {
+    return quality >= 0 && quality < RESAMPLER_QUALITY_COUNT ? tiers[quality].name : "?";
+}
@@ -0,0 +1,54 @@
+#ifndef __RESAMPLER_H__
+#define __RESAMPLER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Stereo sample rate converter
+// Common ratios (44.1 <-> 48 kHz is 160:147) run on a built-in polyphase filter:
+// the bank of coefficients for every output phase is computed once per ratio,
+// so each output frame is one short dot product, in Q15 for int16 and in float
+// for the float pipeline, with no format round trip. Ratios needing more than
+// RESAMPLER_PHASES_MAX phases go through libsamplerate instead.
+// Input is always taken whole; output beyond max_out stays pending and comes out
+// of the next call (which may pass no input). libsamplerate stops at a full output,
+// so the input it leaves is carried into its next call the same way.
+// Not thread-safe: one owner at a time.
+
+#define RESAMPLER_PHASES_MAX 1024
+
+typedef enum {
+    RESAMPLER_LOW_POWER,        // 4-tap cubic: screen off, where nobody is listening closely
+    RESAMPLER_STANDARD,         // 32-tap windowed sinc: speaker, Bluetooth, radio
+    RESAMPLER_HIGH,             // 64-tap windowed sinc: USB DAC
+    RESAMPLER_QUALITY_COUNT
+} ResamplerQuality;
+
+typedef struct Resampler Resampler;
+
+// NULL if out of memory
+Resampler* Resampler_new(ResamplerQuality quality);
+
+void Resampler_free(Resampler* resampler);
+
+// Forget buffered audio (seek, new track)
+void Resampler_reset(Resampler* resampler);
+
+// Change the tier from the next call on, carrying the buffered audio over
+void Resampler_setQuality(Resampler* resampler, ResamplerQuality quality);
+
+// Allocate room for chunks of up to frames input frames, so processing them
+// doesn't allocate. Returns 0 on success, -1 if out of memory.
+int Resampler_reserve(Resampler* resampler, size_t frames);
+
+// Convert interleaved stereo from src_rate to dst_rate; returns the output frames.
+// is_last flushes the filter's lookahead at the end of the stream.
+size_t Resampler_processS16(Resampler* resampler, const int16_t* in, size_t frames,
+                            int src_rate, int dst_rate, int16_t* out, size_t max_out, bool is_last);
+size_t Resampler_processF32(Resampler* resampler, const float* in, size_t frames,
+                            int src_rate, int dst_rate, float* out, size_t max_out, bool is_last);
+
+const char* Resampler_qualityName(ResamplerQuality quality);
+
+#endif
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "screen_cache.h"
+#include "memstats.h"
+
+typedef struct {
+    const char* id;
+    uint32_t key;               // Stamp and theme
+    uint32_t last_used;
+    SDL_Surface* surface;
+} ScreenEntry;
+
+static ScreenEntry entries[SCREEN_CACHE_ENTRIES];
+static uint32_t cache_clock = 0;
+static bool capturing = false;
+
+uint32_t ScreenCache_stamp(uint32_t stamp, const char* text) {
+    while (text && *text) {
+        stamp ^= (uint8_t)*text++;
+        stamp *= 16777619u;
+    }
+    stamp ^= 0xff;              // Separator: ("ab", "") and ("a", "b") differ
+    stamp *= 16777619u;
+    return stamp;
+}
+
+// The stamp with the theme colors the pills and text are drawn in
+static uint32_t screen_key(uint32_t stamp) {
+    uint32_t colors[] = {THEME_COLOR1, THEME_COLOR1_255, THEME_COLOR4_255, THEME_COLOR5_255};
+    for (size_t i = 0; i < sizeof(colors) / sizeof(colors[0]); i++) {
+        stamp ^= colors[i];
+        stamp *= 16777619u;
+    }
+    return stamp;
+}
+
+static void drop(ScreenEntry* entry) {
+    if (entry->surface) {
+        MEM_SURFACE_SUB(MEM_TAG_SCREENS, entry->surface);
+        SDL_FreeSurface(entry->surface);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+static ScreenEntry* find(const char* id) {
+    for (int i = 0; i < SCREEN_CACHE_ENTRIES; i++) {
+        if (entries[i].surface && entries[i].id == id) return &entries[i];
+    }
+    return NULL;
+}
+
+SDL_Surface* ScreenCache_get(const char* id, uint32_t stamp) {
+    ScreenEntry* entry = find(id);
+    if (!entry || entry->key != screen_key(stamp)) return NULL;
+    entry->last_used = ++cache_clock;
+    return entry->surface;
+}
+
+void ScreenCache_put(const char* id, uint32_t stamp, SDL_Surface* surface) {
+    if (!surface) return;
+    // The id's own slot, else a free one, else the least recently used
+    ScreenEntry* slot = find(id);
+    if (!slot) {
+        for (int i = 0; i < SCREEN_CACHE_ENTRIES; i++) {
+            if (!entries[i].surface) {
+                slot = &entries[i];
+                break;
+            }
+            if (!slot || entries[i].last_used < slot->last_used) slot = &entries[i];
+        }
+    }
+    drop(slot);
+    slot->id = id;
+    slot->key = screen_key(stamp);
+    slot->last_used = ++cache_clock;
+    slot->surface = surface;
+    MEM_SURFACE_ADD(MEM_TAG_SCREENS, surface);
+}
+
+bool ScreenCache_restore(SDL_Surface* screen, const char* id, uint32_t stamp) {
+    SDL_Surface* cached = ScreenCache_get(id, stamp);
+    if (!cached || cached->w != screen->w || cached->h != screen->h) return false;
+    SDL_SetSurfaceBlendMode(cached, SDL_BLENDMODE_NONE);
+    SDL_BlitSurface(cached, NULL, screen, NULL);
+    return true;
+}
+
+void ScreenCache_begin(void) {
+    capturing = true;
+}
+
+void ScreenCache_store(SDL_Surface* screen, const char* id, uint32_t stamp) {
+    capturing = false;
+    SDL_Surface* copy = SDL_ConvertSurface(screen, screen->format, 0);
+    ScreenCache_put(id, stamp, copy);
+}
+
+bool ScreenCache_capturing(void) {
+    return capturing;
+}
+
+size_t ScreenCache_clear(void) {
+    size_t bytes = 0;
+    for (int i = 0; i < SCREEN_CACHE_ENTRIES; i++) {
+        if (entries[i].surface) bytes += (size_t)entries[i].surface->pitch * entries[i].surface->h;
+        drop(&entries[i]);
+    }
+    cache_clock = 0;
+    capturing = false;
+    return bytes;
+}
@@ -0,0 +1,47 @@
+#ifndef __SCREEN_CACHE_H__
+#define __SCREEN_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "defines.h"
+#include "api.h"
+
+// Static screen cache
+// The menus, About and the radio help draw the same text and pills on every
+// redraw. What doesn't change while they are shown is rendered once and kept
+// here as a surface, keyed by the screen's id (a string literal), a stamp of
+// what it shows (labels, version, ...) and the theme colors, so a repaint is a
+// blit plus whatever is live (the selected row, the hardware status). At most
+// SCREEN_CACHE_ENTRIES are kept, the least recently used dropped first; a theme
+// change misses by key, and closing the fonts clears it. Main thread only.
+
+#define SCREEN_CACHE_ENTRIES 4
+#define SCREEN_CACHE_STAMP_INIT 2166136261u
+
+// Fold text into a stamp (FNV-1a; start from SCREEN_CACHE_STAMP_INIT)
+uint32_t ScreenCache_stamp(uint32_t stamp, const char* text);
+
+// The surface stored for id and stamp, or NULL. It stays owned by the cache,
+// valid until the next ScreenCache_put or ScreenCache_clear.
+SDL_Surface* ScreenCache_get(const char* id, uint32_t stamp);
+
+// Keep surface (taken over) for id and stamp, replacing what id had
+void ScreenCache_put(const char* id, uint32_t stamp, SDL_Surface* surface);
+
+// Blit what is stored for id and stamp over the whole screen; false if nothing is
+bool ScreenCache_restore(SDL_Surface* screen, const char* id, uint32_t stamp);
+
+// Screen capture: between begin and store, drawing leaves out what is live
+// (render_screen_header skips the hardware status), and store keeps a copy of
+// the screen for id and stamp
+void ScreenCache_begin(void);
+void ScreenCache_store(SDL_Surface* screen, const char* id, uint32_t stamp);
+bool ScreenCache_capturing(void);
+
+// Drop everything (fonts are about to close, or memory is short)
+// Returns the bytes of the surfaces dropped.
+size_t ScreenCache_clear(void);
+
+#endif
@@ -1,4 +1,9 @@
 #include "selfupdate.h"
+#include "thread_role.h"
+#include "release_check.h"
+#include "selfupdate_delta.h"
+#include "bgtransfer.h"
+#include "radio_net.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,11 +15,11 @@
 #include <errno.h>
 #include <zip.h>
 
-#include "include/parson/parson.h"
+#include "defines.h"
+#include "api.h"
 
 // Paths
 static char pak_path[512] = "";
-static char wget_path[512] = "";
 static char version_file[512] = "";
 static char current_version[32] = "";
 
@@ -24,6 +29,8 @@ static pthread_t update_thread;
 static volatile bool update_running = false;
 static volatile bool update_cancel = false;
 
+#define EXTRACT_BUFFER_SIZE (256 * 1024)
+
 // Forward declarations
 static void* check_thread_func(void* arg);
 static void* update_thread_func(void* arg);
@@ -48,69 +55,99 @@ static int mkpath(const char* path, mode_t mode) {
     return mkdir(tmp, mode);
 }
 
-// Sync directories: copy all from src to dst, remove orphans in dst
-// This replaces all files and removes files that no longer exist in the update
-static int sync_directories(const char* src, const char* dst) {
-    char cmd[1024];
-    DIR* dir;
-    struct dirent* entry;
-
-    // First, copy all files from src to dst (overwriting existing)
-    snprintf(cmd, sizeof(cmd), "cp -rf \"%s\"/* \"%s\"/ 2>/dev/null", src, dst);
-    system(cmd);
-
-    // Now remove orphaned files in dst that don't exist in src
-    dir = opendir(dst);
-    if (!dir) return -1;
-
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip . and ..
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-            continue;
+// Remove a file, or a directory with everything in it
+static void remove_tree(const char* path) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return;
+    if (!S_ISDIR(st.st_mode)) {
+        unlink(path);
+        return;
+    }
+
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            char child[1024];
+            snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+            remove_tree(child);
         }
+        closedir(dir);
+    }
+    rmdir(path);
+}
 
-        char src_path[600], dst_path[600];
-        snprintf(src_path, sizeof(src_path), "%s/%s", src, entry->d_name);
-        snprintf(dst_path, sizeof(dst_path), "%s/%s", dst, entry->d_name);
-
-        // If file/folder doesn't exist in src, remove it from dst
-        if (access(src_path, F_OK) != 0) {
-            if (entry->d_type == DT_DIR) {
-                snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", dst_path);
-            } else {
-                snprintf(cmd, sizeof(cmd), "rm -f \"%s\"", dst_path);
-            }
-            system(cmd);
-        }
-        // If both are directories, recursively sync them
-        else if (entry->d_type == DT_DIR) {
-            sync_directories(src_path, dst_path);
+static int copy_file(const char* src, const char* dst) {
+    FILE* in = fopen(src, "rb");
+    if (!in) return -1;
+    FILE* out = fopen(dst, "wb");
+    if (!out) {
+        fclose(in);
+        return -1;
+    }
+    char buf[8192];
+    size_t n;
+    int result = 0;
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) {
+        if (fwrite(buf, 1, n, out) != n) {
+            result = -1;
+            break;
         }
     }
-
-    closedir(dir);
-    return 0;
+    fclose(in);
+    if (fclose(out) != 0) result = -1;
+    return result;
 }
 
-// Extract ZIP file using libzip
+// Extract the pak in a ZIP (the folder holding musicplayer.elf, wherever it is
+// nested) into dest_dir
+// Returns 0, EXTRACT_INVALID if the ZIP holds no pak, or -1 on error.
+#define EXTRACT_INVALID -2
 static int extract_zip(const char* zip_path, const char* dest_dir) {
     int err = 0;
-    zip_t* za = zip_open(zip_path, 0, &err);
+    zip_t* za = zip_open(zip_path, ZIP_RDONLY, &err);
     if (!za) {
         return -1;
     }
 
     zip_int64_t num_entries = zip_get_num_entries(za, 0);
-    for (zip_int64_t i = 0; i < num_entries; i++) {
+    const char* elf = "musicplayer.elf";
+    size_t elf_len = strlen(elf);
+    char prefix[512] = "";
+    bool found = false;
+    for (zip_int64_t i = 0; i < num_entries && !found; i++) {
         const char* name = zip_get_name(za, i, 0);
-        if (!name) continue;
+        size_t name_len = name ? strlen(name) : 0;
+        if (name_len < elf_len || name_len - elf_len >= sizeof(prefix)) continue;
+        if (strcmp(name + name_len - elf_len, elf) != 0) continue;
+        if (name_len > elf_len && name[name_len - elf_len - 1] != '/') continue;
+        memcpy(prefix, name, name_len - elf_len);
+        prefix[name_len - elf_len] = '\0';
+        found = true;
+    }
+    if (!found) {
+        zip_close(za);
+        return EXTRACT_INVALID;
+    }
 
-        char full_path[600];
-        snprintf(full_path, sizeof(full_path), "%s/%s", dest_dir, name);
+    size_t prefix_len = strlen(prefix);
+    char* buf = malloc(EXTRACT_BUFFER_SIZE);
+    char* out_buf = malloc(EXTRACT_BUFFER_SIZE);
+    int result = (buf && out_buf) ? 0 : -1;
+
+    for (zip_int64_t i = 0; result == 0 && i < num_entries; i++) {
+        const char* name = zip_get_name(za, i, 0);
+        if (!name || strncmp(name, prefix, prefix_len) != 0) continue;
+        const char* rel = name + prefix_len;
+        if (!rel[0] || strstr(rel, "..")) continue;
+
+        char full_path[1024];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dest_dir, rel);
 
         // Check if it's a directory
-        size_t name_len = strlen(name);
-        if (name_len > 0 && name[name_len - 1] == '/') {
+        size_t rel_len = strlen(rel);
+        if (rel[rel_len - 1] == '/') {
             mkpath(full_path, 0755);
             continue;
         }
@@ -123,32 +160,83 @@ static int extract_zip(const char* zip_path, const char* dest_dir) {
             *last_slash = '/';
         }
 
-        // Extract file
         zip_file_t* zf = zip_fopen_index(za, i, 0);
-        if (!zf) continue;
-
-        FILE* out = fopen(full_path, "wb");
+        FILE* out = zf ? fopen(full_path, "wb") : NULL;
         if (!out) {
-            zip_fclose(zf);
-            continue;
+            if (zf) zip_fclose(zf);
+            result = -1;
+            break;
         }
+        // Few large writes instead of many small ones
+        setvbuf(out, out_buf, _IOFBF, EXTRACT_BUFFER_SIZE);
 
-        char buf[8192];
         zip_int64_t bytes_read;
-        while ((bytes_read = zip_fread(zf, buf, sizeof(buf))) > 0) {
-            fwrite(buf, 1, bytes_read, out);
+        while ((bytes_read = zip_fread(zf, buf, EXTRACT_BUFFER_SIZE)) > 0) {
+            if (fwrite(buf, 1, bytes_read, out) != (size_t)bytes_read) {
+                result = -1;
+                break;
+            }
         }
-
-        fclose(out);
+        if (bytes_read < 0) result = -1;
+        if (fclose(out) != 0) result = -1;
         zip_fclose(zf);
 
-        // Preserve executable permission for .elf and .sh files
-        if (strstr(name, ".elf") || strstr(name, ".sh")) {
-            chmod(full_path, 0755);
+        // Permissions recorded in the ZIP, else executable for binaries and scripts
+        zip_uint8_t opsys;
+        zip_uint32_t attributes;
+        mode_t mode = 0;
+        if (zip_file_get_external_attributes(za, i, 0, &opsys, &attributes) == 0 && opsys == ZIP_OPSYS_UNIX) {
+            mode = (attributes >> 16) & 0777;
         }
+        if (!mode) {
+            bool exec = strstr(rel, ".elf") || strstr(rel, ".sh") || strncmp(rel, "bins/", 5) == 0;
+            mode = exec ? 0755 : 0644;
+        }
+        chmod(full_path, mode);
+
+        update_status.progress_percent = 45 + (int)(35 * (i + 1) / num_entries);
     }
 
+    free(buf);
+    free(out_buf);
     zip_close(za);
+    return result;
+}
+
+// Copy the files in old_pak/state/ the new pak doesn't come with (settings,
+// queue), so they survive the swap
+static void carry_over_state(const char* old_pak, const char* new_pak) {
+    char old_state[600], new_state[600];
+    snprintf(old_state, sizeof(old_state), "%s/state", old_pak);
+    snprintf(new_state, sizeof(new_state), "%s/state", new_pak);
+    mkdir(new_state, 0755);
+
+    DIR* dir = opendir(old_state);
+    if (!dir) return;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char src[1024], dst[1024];
+        snprintf(src, sizeof(src), "%s/%s", old_state, entry->d_name);
+        snprintf(dst, sizeof(dst), "%s/%s", new_state, entry->d_name);
+        struct stat st;
+        if (stat(src, &st) == 0 && S_ISREG(st.st_mode) && access(dst, F_OK) != 0) {
+            copy_file(src, dst);
+        }
+    }
+    closedir(dir);
+}
+
+// Put staging_dir in place of pak_dir, which is kept as old_dir (the previous
+// one replaced) to roll back to. Both are on the same filesystem, so each step
+// is a rename.
+static int swap_in(const char* pak_dir, const char* staging_dir, const char* old_dir) {
+    remove_tree(old_dir);
+    if (rename(pak_dir, old_dir) != 0) return -1;
+    if (rename(staging_dir, pak_dir) != 0) {
+        rename(old_dir, pak_dir);
+        return -1;
+    }
     return 0;
 }
 
@@ -158,7 +246,6 @@ int SelfUpdate_init(const char* path) {
     strncpy(pak_path, path, sizeof(pak_path) - 1);
 
     // Set up paths
-    snprintf(wget_path, sizeof(wget_path), "%s/bins/wget", pak_path);
     snprintf(version_file, sizeof(version_file), "%s/state/app_version.txt", pak_path);
 
     // Read version from file (primary source)
@@ -263,15 +350,15 @@ SelfUpdateState SelfUpdate_getState(void) {
 // Check for update thread
 static void* check_thread_func(void* arg) {
     (void)arg;
-
-    // Check connectivity
-    int conn = system("ping -c 1 -W 2 8.8.8.8 >/dev/null 2>&1");
-    if (conn != 0) {
-        conn = system("ping -c 1 -W 2 1.1.1.1 >/dev/null 2>&1");
-    }
-
-    if (conn != 0) {
-        strcpy(update_status.error_message, "No internet connection");
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    // Latest release, shared with the yt-dlp check
+    ReleaseInfo release;
+    int result = release_check_get(RELEASE_APP, &release);
+    if (result != RELEASE_CHECK_OK) {
+        strcpy(update_status.error_message,
+            result == RELEASE_CHECK_OFFLINE ? "No internet connection" :
+            result == RELEASE_CHECK_FAILED ? "Failed to check GitHub" : "Could not parse version");
         update_status.state = SELFUPDATE_STATE_ERROR;
         update_running = false;
         return NULL;
@@ -283,72 +370,7 @@ static void* check_thread_func(void* arg) {
         return NULL;
     }
 
-    update_status.progress_percent = 20;
-
-    // Create temp directory
-    char temp_dir[512];
-    snprintf(temp_dir, sizeof(temp_dir), "/tmp/app_update_%d", getpid());
-    mkdir(temp_dir, 0755);
-
-    // Fetch latest release info from GitHub API
-    char latest_file[600];
-    snprintf(latest_file, sizeof(latest_file), "%s/latest.json", temp_dir);
-
-    char cmd[1024];
-    if (access(wget_path, X_OK) == 0) {
-        snprintf(cmd, sizeof(cmd),
-            "%s -q -O \"%s\" \"https://api.github.com/repos/%s/releases/latest\" 2>/dev/null",
-            wget_path, latest_file, APP_GITHUB_REPO);
-    } else {
-        snprintf(cmd, sizeof(cmd),
-            "wget -q -O \"%s\" \"https://api.github.com/repos/%s/releases/latest\" 2>/dev/null",
-            latest_file, APP_GITHUB_REPO);
-    }
-
-    if (system(cmd) != 0 || access(latest_file, F_OK) != 0) {
-        strcpy(update_status.error_message, "Failed to check GitHub");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_ERROR;
-        update_running = false;
-        return NULL;
-    }
-
-    if (update_cancel) {
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_IDLE;
-        update_running = false;
-        return NULL;
-    }
-
-    update_status.progress_percent = 50;
-
-    // Parse version (tag_name) from JSON
-    char version_cmd[1024];
-    snprintf(version_cmd, sizeof(version_cmd),
-        "grep -o '\"tag_name\": *\"[^\"]*' \"%s\" | cut -d'\"' -f4",
-        latest_file);
-
-    char latest_version[32] = "";
-    FILE* pipe = popen(version_cmd, "r");
-    if (pipe) {
-        if (fgets(latest_version, sizeof(latest_version), pipe)) {
-            char* nl = strchr(latest_version, '\n');
-            if (nl) *nl = '\0';
-        }
-        pclose(pipe);
-    }
-
-    if (strlen(latest_version) == 0) {
-        strcpy(update_status.error_message, "Could not parse version");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_ERROR;
-        update_running = false;
-        return NULL;
-    }
-
+    const char* latest_version = release.tag;
     strncpy(update_status.latest_version, latest_version, sizeof(update_status.latest_version));
 
     update_status.progress_percent = 70;
@@ -359,73 +381,27 @@ static void* check_thread_func(void* arg) {
     if (curr[0] == 'v') curr++;
     if (latest[0] == 'v') latest++;
 
-    if (strcmp(latest, curr) == 0) {
-        update_status.update_available = false;
-        strcpy(update_status.status_message, "Already up to date");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_IDLE;
-        update_running = false;
-        return NULL;
-    }
-
     // Check if latest > current (simple string comparison for now)
     // For semantic versioning, a more sophisticated comparison would be needed
     if (strcmp(latest, curr) <= 0) {
         update_status.update_available = false;
         strcpy(update_status.status_message, "Already up to date");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
         update_status.state = SELFUPDATE_STATE_IDLE;
         update_running = false;
         return NULL;
     }
 
-    // Get download URL for the pak.zip asset
-    char url_cmd[1024];
-    snprintf(url_cmd, sizeof(url_cmd),
-        "grep -o '\"browser_download_url\": *\"[^\"]*%s\"' \"%s\" | cut -d'\"' -f4",
-        APP_RELEASE_ASSET, latest_file);
-
-    char download_url[512] = "";
-    pipe = popen(url_cmd, "r");
-    if (pipe) {
-        if (fgets(download_url, sizeof(download_url), pipe)) {
-            char* nl = strchr(download_url, '\n');
-            if (nl) *nl = '\0';
-        }
-        pclose(pipe);
-    }
-
-    if (strlen(download_url) == 0) {
+    if (!release.asset_url[0]) {
         strcpy(update_status.error_message, "Release package not found");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
         update_status.state = SELFUPDATE_STATE_ERROR;
         update_running = false;
         return NULL;
     }
 
-    strncpy(update_status.download_url, download_url, sizeof(update_status.download_url));
-
-    // Parse release notes (body) from JSON using parson
-    // This properly handles all JSON escape sequences
-    JSON_Value* json_root = json_parse_file(latest_file);
-    if (json_root) {
-        JSON_Object* json_obj = json_value_get_object(json_root);
-        if (json_obj) {
-            const char* body = json_object_get_string(json_obj, "body");
-            if (body) {
-                strncpy(update_status.release_notes, body, sizeof(update_status.release_notes) - 1);
-                update_status.release_notes[sizeof(update_status.release_notes) - 1] = '\0';
-            }
-        }
-        json_value_free(json_root);
-    }
-
-    // Cleanup temp
-    snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-    system(cmd);
+    strncpy(update_status.download_url, release.asset_url, sizeof(update_status.download_url));
+    strncpy(update_status.manifest_url, release.manifest_url, sizeof(update_status.manifest_url));
+    strncpy(update_status.release_notes, release.notes, sizeof(update_status.release_notes) - 1);
+    update_status.release_notes[sizeof(update_status.release_notes) - 1] = '\0';
 
     update_status.update_available = true;
     snprintf(update_status.status_message, sizeof(update_status.status_message),
@@ -437,15 +413,42 @@ static void* check_thread_func(void* arg) {
     return NULL;
 }
 
+// Fail the update (or end it quietly when cancelled), removing the temp directory
+static void* update_failed(const char* temp_dir, const char* error) {
+    remove_tree(temp_dir);
+    if (error) {
+        strcpy(update_status.error_message, error);
+        update_status.state = SELFUPDATE_STATE_ERROR;
+    } else {
+        update_status.state = SELFUPDATE_STATE_IDLE;
+    }
+    update_running = false;
+    return NULL;
+}
+
 // Update thread - downloads and applies update
 static void* update_thread_func(void* arg) {
     (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+    radio_net_setAccount(RADIO_NET_ACCOUNT_UPDATES);
 
-    char cmd[1024];
     char temp_dir[512];
     snprintf(temp_dir, sizeof(temp_dir), "/tmp/app_update_%d", getpid());
     mkdir(temp_dir, 0755);
 
+    // With a manifest, only the files that changed are fetched out of the zip;
+    // if that fails nothing was touched and the whole zip is downloaded instead
+    if (update_status.manifest_url[0]) {
+        update_status.state = SELFUPDATE_STATE_DOWNLOADING;
+        strcpy(update_status.status_message, "Downloading changes...");
+        if (selfupdate_delta_apply(update_status.manifest_url, update_status.download_url,
+                                   pak_path, &update_cancel, &update_status.progress_percent) == 0) {
+            // Nothing was downloaded into it, as with the zip once it's extracted
+            remove_tree(temp_dir);
+            goto installed;
+        }
+    }
+
     // Download the ZIP file
     update_status.state = SELFUPDATE_STATE_DOWNLOADING;
     strcpy(update_status.status_message, "Downloading update...");
@@ -454,121 +457,59 @@ static void* update_thread_func(void* arg) {
     char zip_file[600];
     snprintf(zip_file, sizeof(zip_file), "%s/update.zip", temp_dir);
 
-    if (access(wget_path, X_OK) == 0) {
-        snprintf(cmd, sizeof(cmd), "%s -q -O \"%s\" \"%s\" 2>/dev/null",
-            wget_path, zip_file, update_status.download_url);
-    } else {
-        snprintf(cmd, sizeof(cmd), "wget -q -O \"%s\" \"%s\" 2>/dev/null",
-            zip_file, update_status.download_url);
-    }
-
-    if (update_cancel) {
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_IDLE;
-        update_running = false;
-        return NULL;
-    }
-
-    if (system(cmd) != 0 || access(zip_file, F_OK) != 0) {
-        strcpy(update_status.error_message, "Download failed");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_ERROR;
-        update_running = false;
-        return NULL;
+    // Paced while the radio streams, so it doesn't starve the stream
+    if (BgTransfer_download(update_status.download_url, zip_file, &update_cancel) != 0) {
+        if (update_cancel) return update_failed(temp_dir, NULL);
+        return update_failed(temp_dir, "Download failed");
     }
 
     update_status.progress_percent = 40;
 
-    if (update_cancel) {
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_IDLE;
-        update_running = false;
-        return NULL;
-    }
+    if (update_cancel) return update_failed(temp_dir, NULL);
+
+    // The new pak is extracted next to the current one (same filesystem), then
+    // swapped in with renames: every file is written once and the old pak stays
+    // as <pak>.old to roll back to
+    char pak_dir[512];
+    if (!realpath(pak_path, pak_dir)) return update_failed(temp_dir, "Failed to install update");
+    char staging_dir[600], old_dir[600];
+    snprintf(staging_dir, sizeof(staging_dir), "%s.new", pak_dir);
+    snprintf(old_dir, sizeof(old_dir), "%s.old", pak_dir);
+    remove_tree(staging_dir);
+    mkdir(staging_dir, 0755);
 
     // Extract the ZIP file
     update_status.state = SELFUPDATE_STATE_EXTRACTING;
     strcpy(update_status.status_message, "Extracting update...");
     update_status.progress_percent = 45;
 
-    char extract_dir[600];
-    snprintf(extract_dir, sizeof(extract_dir), "%s/extracted", temp_dir);
-    mkdir(extract_dir, 0755);
-
-    // Extract using libzip
-    if (extract_zip(zip_file, extract_dir) != 0) {
-        strcpy(update_status.error_message, "Extraction failed");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_ERROR;
-        update_running = false;
-        return NULL;
-    }
-
-    update_status.progress_percent = 60;
-
-    // Find the actual extracted directory (might be nested)
-    // Look for musicplayer.elf to find the root
-    char find_cmd[1024];
-    snprintf(find_cmd, sizeof(find_cmd),
-        "find \"%s\" -name 'musicplayer.elf' -type f 2>/dev/null | head -1",
-        extract_dir);
-
-    char elf_path[600] = "";
-    FILE* pipe = popen(find_cmd, "r");
-    if (pipe) {
-        if (fgets(elf_path, sizeof(elf_path), pipe)) {
-            char* nl = strchr(elf_path, '\n');
-            if (nl) *nl = '\0';
-        }
-        pclose(pipe);
-    }
-
-    if (strlen(elf_path) == 0) {
-        strcpy(update_status.error_message, "Invalid update package");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_ERROR;
-        update_running = false;
-        return NULL;
-    }
-
-    // Get the directory containing musicplayer.elf
-    char* last_slash = strrchr(elf_path, '/');
-    if (last_slash) *last_slash = '\0';
-    char update_root[600];
-    strncpy(update_root, elf_path, sizeof(update_root));
-
-    update_status.progress_percent = 65;
-
-    if (update_cancel) {
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_IDLE;
-        update_running = false;
-        return NULL;
+    int extracted = extract_zip(zip_file, staging_dir);
+    // The ZIP isn't needed any more
+    remove_tree(temp_dir);
+    if (extracted != 0 || update_cancel) {
+        remove_tree(staging_dir);
+        if (update_cancel) return update_failed(temp_dir, NULL);
+        return update_failed(temp_dir, extracted == EXTRACT_INVALID ? "Invalid update package" : "Extraction failed");
     }
 
     // Apply update
     update_status.state = SELFUPDATE_STATE_APPLYING;
     strcpy(update_status.status_message, "Installing update...");
-    update_status.progress_percent = 70;
+    update_status.progress_percent = 85;
 
-    // Sync all files: copy everything from update, remove orphaned files
-    // This handles: musicplayer.elf, launch.sh, bins/, fonts/, stations/, state/, etc.
-    // Note: Linux allows replacing a running binary - it continues from memory
-    if (sync_directories(update_root, pak_path) != 0) {
-        strcpy(update_status.error_message, "Failed to install update");
-        snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-        system(cmd);
-        update_status.state = SELFUPDATE_STATE_ERROR;
-        update_running = false;
-        return NULL;
+    carry_over_state(pak_dir, staging_dir);
+    if (swap_in(pak_dir, staging_dir, old_dir) != 0) {
+        remove_tree(staging_dir);
+        return update_failed(temp_dir, "Failed to install update");
+    }
+
+    // The working directory moved with the old pak: relative paths (pak_path
+    // ".") should reach the new one. The running binary carries on from memory.
+    if (pak_path[0] != '/' && chdir(pak_dir) != 0) {
+        LOG_error("[SelfUpdate] Failed to enter %s\n", pak_dir);
     }
 
+installed:
     update_status.progress_percent = 90;
 
     // Ensure executables have correct permissions
@@ -590,10 +531,6 @@ static void* update_thread_func(void* arg) {
     // Sync filesystem
     sync();
 
-    // Cleanup temp directory
-    snprintf(cmd, sizeof(cmd), "rm -rf \"%s\"", temp_dir);
-    system(cmd);
-
     update_status.progress_percent = 100;
     strcpy(update_status.status_message, "Update complete! Restart to apply.");
     update_status.state = SELFUPDATE_STATE_COMPLETED;
@@ -9,6 +9,11 @@
 // Release asset name pattern (the .pak.zip file)
 #define APP_RELEASE_ASSET "Music.Player.pak.zip"
 
+// Release asset listing the SHA-256 of every file in the pak, in sha256sum format
+// (made with `find . -type f | xargs sha256sum` inside the pak). When a release
+// has one, an update downloads only the files whose hash differs.
+#define APP_RELEASE_MANIFEST "Music.Player.pak.sha256"
+
 // Fallback version if version file not found
 #define APP_VERSION_FALLBACK "0.0.0"
 
@@ -30,6 +35,7 @@ typedef struct {
     char current_version[32];
     char latest_version[32];
     char download_url[512];
+    char manifest_url[512];         // File hash manifest ("" = full update only)
     char release_notes[1024];       // Release description from GitHub
     int progress_percent;           // 0-100
     char status_message[256];
@@ -0,0 +1,649 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "selfupdate_delta.h"
+#include "radio_net.h"
+#include "bgtransfer.h"
+#include "defines.h"
+#include "api.h"
+
+#include "mbedtls/sha256.h"
+
+#define MANIFEST_MAX (128 * 1024)
+#define CENTRAL_DIR_MAX (4 * 1024 * 1024)
+#define EOCD_SEARCH (22 + 65535)            // End record plus the longest comment
+#define RANGE_GAP_MAX (64 * 1024)           // Unchanged bytes worth fetching to join two runs
+#define WRITE_BUFFER_SIZE (256 * 1024)
+#define INFLATE_CHUNK (64 * 1024)
+#define TEMP_SUFFIX ".delta"
+
+#define ZIP_LOCAL_SIG 0x04034b50
+#define ZIP_CENTRAL_SIG 0x02014b50
+#define ZIP_END_SIG 0x06054b50
+
+typedef struct {
+    char path[256];             // Relative to the pak
+    uint8_t sha256[32];
+    bool changed;
+    bool in_zip;                // Zip entry fields below are set
+    uint16_t method;            // 0 stored, 8 deflated
+    uint32_t comp_size;
+    uint32_t size;
+    uint32_t header_offset;     // Of the local header
+    uint32_t end_offset;        // Where the next entry (or the central directory) starts
+    mode_t mode;                // From the zip (0 = not recorded)
+} DeltaFile;
+
+typedef struct {
+    DeltaFile* files;           // Sorted by path
+    int count;
+    const char* pak_path;
+    volatile bool* cancel;
+    int* progress;
+    int64_t fetch_total;        // Compressed bytes of the changed files
+    int64_t fetch_done;
+} Delta;
+
+// Collects a response into a buffer
+typedef struct {
+    uint8_t* data;
+    int len;
+    int cap;
+} Collect;
+
+static bool collect_data(void* ctx, const uint8_t* data, int len) {
+    Collect* c = (Collect*)ctx;
+    if (c->len + len > c->cap) return false;
+    memcpy(c->data + c->len, data, len);
+    c->len += len;
+    return true;
+}
+
+static uint16_t rd16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t rd32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static int compare_path(const void* a, const void* b) {
+    return strcmp(((const DeltaFile*)a)->path, ((const DeltaFile*)b)->path);
+}
+
+static DeltaFile* find_file(Delta* d, const char* path) {
+    DeltaFile key;
+    snprintf(key.path, sizeof(key.path), "%s", path);
+    return bsearch(&key, d->files, d->count, sizeof(DeltaFile), compare_path);
+}
+
+static void full_path(const Delta* d, const DeltaFile* f, const char* suffix, char* out, int out_size) {
+    snprintf(out, out_size, "%s/%s%s", d->pak_path, f->path, suffix);
+}
+
+// Create the parent directories of path
+static void make_parents(const char* path) {
+    char tmp[512];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char* p = tmp + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            mkdir(tmp, 0755);
+            *p = '/';
+        }
+    }
+}
+
+// Parse "<sha256 hex>  <path>" lines (sha256sum output) into d->files
+static int parse_manifest(Delta* d, char* text) {
+    char* save = NULL;
+    for (char* line = strtok_r(text, "\r\n", &save); line; line = strtok_r(NULL, "\r\n", &save)) {
+        if (strlen(line) < 67 || (line[65] != ' ' && line[65] != '*') || line[64] != ' ') continue;
+        const char* path = line + 66;
+        if (strncmp(path, "./", 2) == 0) path += 2;
+        // Only plain relative paths inside the pak
+        if (!path[0] || path[0] == '/' || strstr(path, "..") || strlen(path) >= sizeof(d->files[0].path)) {
+            LOG_error("[SelfUpdate] Manifest path rejected: %s\n", path);
+            return -1;
+        }
+        if (d->count >= SELFUPDATE_DELTA_FILES_MAX) return -1;
+
+        DeltaFile* f = &d->files[d->count];
+        memset(f, 0, sizeof(*f));
+        for (int i = 0; i < 32; i++) {
+            int hi = hex_value(line[i * 2]);
+            int lo = hex_value(line[i * 2 + 1]);
+            if (hi < 0 || lo < 0) return -1;
+            f->sha256[i] = (uint8_t)(hi << 4 | lo);
+        }
+        snprintf(f->path, sizeof(f->path), "%s", path);
+        d->count++;
+    }
+    qsort(d->files, d->count, sizeof(DeltaFile), compare_path);
+    return d->count > 0 ? 0 : -1;
+}
+
+static int fetch_manifest(Delta* d, const char* url) {
+    Collect c = {malloc(MANIFEST_MAX), 0, MANIFEST_MAX - 1};
+    if (!c.data) return -1;
+    int result = -1;
+    if (radio_net_fetchStream(url, collect_data, &c) > 0) {
+        c.data[c.len] = '\0';
+        result = parse_manifest(d, (char*)c.data);
+    }
+    free(c.data);
+    return result;
+}
+
+static int compare_offset(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Locate each manifest file in the release zip from its central directory
+static int read_central_dir(Delta* d, const char* zip_url) {
+    // End of central directory record, within the zip's last bytes
+    Collect tail = {malloc(EOCD_SEARCH), 0, EOCD_SEARCH};
+    if (!tail.data) return -1;
+    if (radio_net_fetchRange(zip_url, -1, EOCD_SEARCH, collect_data, &tail) < 22) {
+        free(tail.data);
+        return -1;
+    }
+    int end = -1;
+    for (int i = tail.len - 22; i >= 0; i--) {
+        if (rd32(tail.data + i) == ZIP_END_SIG) {
+            end = i;
+            break;
+        }
+    }
+    uint32_t cd_size = end >= 0 ? rd32(tail.data + end + 12) : 0;
+    uint32_t cd_offset = end >= 0 ? rd32(tail.data + end + 16) : 0;
+    free(tail.data);
+    // No record, or a zip64 one
+    if (end < 0 || cd_offset == 0xFFFFFFFF || cd_size == 0 || cd_size > CENTRAL_DIR_MAX) return -1;
+
+    Collect cd = {malloc(cd_size), 0, (int)cd_size};
+    if (!cd.data) return -1;
+    if (radio_net_fetchRange(zip_url, cd_offset, cd_size, collect_data, &cd) != (int)cd_size) {
+        free(cd.data);
+        return -1;
+    }
+
+    // First pass: entry offsets (an entry's data ends where the next one starts),
+    // and the folder the pak sits in within the zip
+    uint32_t* offsets = malloc(sizeof(uint32_t) * (cd_size / 46 + 1));
+    int offset_count = 0;
+    char prefix[256] = "";
+    bool have_prefix = false;
+    int result = offsets ? 0 : -1;
+    for (uint32_t p = 0; result == 0 && p + 46 <= cd_size; ) {
+        const uint8_t* e = cd.data + p;
+        if (rd32(e) != ZIP_CENTRAL_SIG) break;
+        uint16_t name_len = rd16(e + 28);
+        uint32_t next = p + 46 + name_len + rd16(e + 30) + rd16(e + 32);
+        if (next > cd_size) {
+            result = -1;
+            break;
+        }
+        offsets[offset_count++] = rd32(e + 42);
+
+        const char* name = (const char*)e + 46;
+        const char* elf = "musicplayer.elf";
+        int elf_len = strlen(elf);
+        if (!have_prefix && name_len >= elf_len && name_len - elf_len < (int)sizeof(prefix) &&
+            memcmp(name + name_len - elf_len, elf, elf_len) == 0 &&
+            (name_len == elf_len || name[name_len - elf_len - 1] == '/')) {
+            memcpy(prefix, name, name_len - elf_len);
+            prefix[name_len - elf_len] = '\0';
+            have_prefix = true;
+        }
+        p = next;
+    }
+    if (!have_prefix) result = -1;
+    if (result == 0) qsort(offsets, offset_count, sizeof(uint32_t), compare_offset);
+
+    // Second pass: fill in the manifest's files
+    int prefix_len = strlen(prefix);
+    for (uint32_t p = 0; result == 0 && p + 46 <= cd_size; ) {
+        const uint8_t* e = cd.data + p;
+        if (rd32(e) != ZIP_CENTRAL_SIG) break;
+        uint16_t name_len = rd16(e + 28);
+        const char* name = (const char*)e + 46;
+        p += 46 + name_len + rd16(e + 30) + rd16(e + 32);
+
+        if (name_len <= prefix_len || name_len - prefix_len >= 256 ||
+            memcmp(name, prefix, prefix_len) != 0) continue;
+        char path[256];
+        memcpy(path, name + prefix_len, name_len - prefix_len);
+        path[name_len - prefix_len] = '\0';
+        DeltaFile* f = find_file(d, path);
+        if (!f) continue;
+
+        f->in_zip = true;
+        f->method = rd16(e + 10);
+        f->comp_size = rd32(e + 20);
+        f->size = rd32(e + 24);
+        f->header_offset = rd32(e + 42);
+        // Unix permissions when the zip was made on Unix
+        f->mode = (e[5] == 3) ? (rd32(e + 38) >> 16) & 0777 : 0;
+
+        f->end_offset = cd_offset;
+        uint32_t* at = bsearch(&f->header_offset, offsets, offset_count, sizeof(uint32_t), compare_offset);
+        if (at && at + 1 < offsets + offset_count) f->end_offset = at[1];
+    }
+
+    free(offsets);
+    free(cd.data);
+    return result;
+}
+
+static int hash_file(const char* path, uint8_t* out, uint8_t* buf, int buf_size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return -1;
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts_ret(&sha, 0);
+    size_t n;
+    while ((n = fread(buf, 1, buf_size, f)) > 0) {
+        mbedtls_sha256_update_ret(&sha, buf, n);
+    }
+    int result = ferror(f) ? -1 : 0;
+    fclose(f);
+    mbedtls_sha256_finish_ret(&sha, out);
+    mbedtls_sha256_free(&sha);
+    return result;
+}
+
+// Mark the files whose local copy differs from the manifest
+// Returns the number changed, or -1.
+static int find_changed(Delta* d) {
+    uint8_t* buf = malloc(WRITE_BUFFER_SIZE);
+    if (!buf) return -1;
+    int changed = 0;
+    for (int i = 0; i < d->count; i++) {
+        DeltaFile* f = &d->files[i];
+        if (!f->in_zip) {
+            LOG_error("[SelfUpdate] Not in the release zip: %s\n", f->path);
+            changed = -1;
+            break;
+        }
+
+        char path[512];
+        full_path(d, f, "", path, sizeof(path));
+        struct stat st;
+        uint8_t sha[32];
+        // A size that differs needs no hashing
+        f->changed = stat(path, &st) != 0 || st.st_size != f->size ||
+                     hash_file(path, sha, buf, WRITE_BUFFER_SIZE) != 0 ||
+                     memcmp(sha, f->sha256, 32) != 0;
+        if (f->changed) {
+            changed++;
+            d->fetch_total += f->comp_size;
+        }
+        *d->progress = 10 + 20 * (i + 1) / d->count;
+    }
+    free(buf);
+    return changed;
+}
+
+// Reads a run of neighbouring zip entries from one range response, writing each
+// changed file next to its old copy
+typedef enum {
+    RUN_SEEK = 0,               // Up to the next entry's local header
+    RUN_HEADER,
+    RUN_DATA
+} RunState;
+
+typedef struct {
+    Delta* d;
+    DeltaFile** files;          // Of the run, by offset
+    int count;
+    int index;                  // File being read
+    int64_t pos;                // Zip offset of the next byte
+    RunState state;
+    uint8_t header[30];
+    int header_len;
+    uint32_t skip;              // Name and extra field bytes left
+    uint32_t remaining;         // Compressed bytes left
+    z_stream z;
+    bool z_open;
+    bool z_end;
+    mbedtls_sha256_context sha;
+    FILE* out;
+    char* out_buf;              // stdio buffer of out
+    uint8_t* chunk;             // Inflated bytes
+    bool failed;
+} RunReader;
+
+static bool run_emit(RunReader* run, const uint8_t* data, size_t len) {
+    mbedtls_sha256_update_ret(&run->sha, data, len);
+    return fwrite(data, 1, len, run->out) == len;
+}
+
+static bool run_open_file(RunReader* run) {
+    DeltaFile* f = run->files[run->index];
+    char path[512];
+    full_path(run->d, f, TEMP_SUFFIX, path, sizeof(path));
+    make_parents(path);
+    run->out = fopen(path, "wb");
+    if (!run->out) return false;
+    setvbuf(run->out, run->out_buf, _IOFBF, WRITE_BUFFER_SIZE);
+
+    mbedtls_sha256_init(&run->sha);
+    mbedtls_sha256_starts_ret(&run->sha, 0);
+    run->z_end = f->method == 0;
+    if (f->method == 8) {
+        memset(&run->z, 0, sizeof(run->z));
+        if (inflateInit2(&run->z, -MAX_WBITS) != Z_OK) return false;
+        run->z_open = true;
+    }
+    return true;
+}
+
+// Close the current file and check it against the manifest
+static bool run_close_file(RunReader* run) {
+    DeltaFile* f = run->files[run->index];
+    bool ok = run->z_end;
+    if (run->z_open) {
+        inflateEnd(&run->z);
+        run->z_open = false;
+    }
+    if (run->out) {
+        if (fclose(run->out) != 0) ok = false;
+        run->out = NULL;
+    }
+    uint8_t sha[32];
+    mbedtls_sha256_finish_ret(&run->sha, sha);
+    mbedtls_sha256_free(&run->sha);
+    if (ok && memcmp(sha, f->sha256, 32) != 0) {
+        LOG_error("[SelfUpdate] Hash mismatch: %s\n", f->path);
+        ok = false;
+    }
+    return ok;
+}
+
+static bool run_data(RunReader* run, const uint8_t* data, uint32_t len) {
+    DeltaFile* f = run->files[run->index];
+    if (f->method == 0) return run_emit(run, data, len);
+
+    run->z.next_in = (Bytef*)data;
+    run->z.avail_in = len;
+    // A full output chunk may leave more pending even with the input used up
+    do {
+        run->z.next_out = run->chunk;
+        run->z.avail_out = INFLATE_CHUNK;
+        int ret = inflate(&run->z, Z_NO_FLUSH);
+        if (ret == Z_BUF_ERROR) break;     // Nothing pending
+        if (ret != Z_OK && ret != Z_STREAM_END) return false;
+        if (!run_emit(run, run->chunk, INFLATE_CHUNK - run->z.avail_out)) return false;
+        if (ret == Z_STREAM_END) run->z_end = true;
+    } while (!run->z_end && (run->z.avail_in > 0 || run->z.avail_out == 0));
+    return true;
+}
+
+static bool run_on_data(void* ctx, const uint8_t* data, int len) {
+    RunReader* run = (RunReader*)ctx;
+    int len_in = len;
+    if (*run->d->cancel) run->failed = true;
+
+    while (len > 0 && !run->failed && run->index < run->count) {
+        DeltaFile* f = run->files[run->index];
+        uint32_t n;
+        switch (run->state) {
+        case RUN_SEEK:
+            n = f->header_offset - run->pos;
+            if (n > (uint32_t)len) n = len;
+            if (run->pos + n == f->header_offset) {
+                run->state = RUN_HEADER;
+                run->header_len = 0;
+            }
+            break;
+        case RUN_HEADER:
+            if (run->header_len < 30) {
+                n = 30 - run->header_len;
+                if (n > (uint32_t)len) n = len;
+                memcpy(run->header + run->header_len, data, n);
+                run->header_len += n;
+                if (run->header_len == 30) {
+                    if (rd32(run->header) != ZIP_LOCAL_SIG) {
+                        run->failed = true;
+                        break;
+                    }
+                    run->skip = rd16(run->header + 26) + rd16(run->header + 28);
+                }
+            } else {
+                n = run->skip < (uint32_t)len ? run->skip : (uint32_t)len;
+                run->skip -= n;
+            }
+            if (run->header_len == 30 && run->skip == 0) {
+                if (!run_open_file(run)) {
+                    run->failed = true;
+                    break;
+                }
+                run->remaining = f->comp_size;
+                run->state = RUN_DATA;
+                // An empty stored file has no data to wait for
+                if (run->remaining == 0) {
+                    if (!run_close_file(run)) {
+                        run->failed = true;
+                        break;
+                    }
+                    run->index++;
+                    run->state = RUN_SEEK;
+                }
+            }
+            break;
+        case RUN_DATA:
+        default:
+            n = run->remaining < (uint32_t)len ? run->remaining : (uint32_t)len;
+            if (!run_data(run, data, n)) {
+                run->failed = true;
+                break;
+            }
+            run->remaining -= n;
+            run->d->fetch_done += n;
+            if (run->remaining == 0) {
+                if (!run_close_file(run)) {
+                    run->failed = true;
+                    break;
+                }
+                run->index++;
+                run->state = RUN_SEEK;
+            }
+            break;
+        }
+        if (run->failed) break;
+        data += n;
+        len -= n;
+        run->pos += n;
+    }
+
+    if (run->d->fetch_total > 0) {
+        *run->d->progress = 30 + (int)(55 * run->d->fetch_done / run->d->fetch_total);
+    }
+    if (!run->failed) BgTransfer_pace(len_in, run->d->cancel);
+    return !run->failed;
+}
+
+static int compare_header_offset(const void* a, const void* b) {
+    uint32_t x = (*(DeltaFile* const*)a)->header_offset;
+    uint32_t y = (*(DeltaFile* const*)b)->header_offset;
+    return (x > y) - (x < y);
+}
+
+// Fetch every changed file into its temp file, joining entries close together
+// into one range request
+static int fetch_changed(Delta* d, const char* zip_url) {
+    DeltaFile** changed = malloc(sizeof(DeltaFile*) * d->count);
+    RunReader run;
+    memset(&run, 0, sizeof(run));
+    run.out_buf = malloc(WRITE_BUFFER_SIZE);
+    run.chunk = malloc(INFLATE_CHUNK);
+    int result = (changed && run.out_buf && run.chunk) ? 0 : -1;
+
+    int count = 0;
+    for (int i = 0; result == 0 && i < d->count; i++) {
+        DeltaFile* f = &d->files[i];
+        if (!f->changed) continue;
+        if (f->method != 0 && f->method != 8) {
+            LOG_error("[SelfUpdate] Unsupported compression in zip: %s\n", f->path);
+            result = -1;
+        }
+        changed[count++] = f;
+    }
+    if (result == 0) qsort(changed, count, sizeof(DeltaFile*), compare_header_offset);
+
+    for (int first = 0; result == 0 && first < count; ) {
+        if (*d->cancel) {
+            result = -1;
+            break;
+        }
+        int last = first;
+        while (last + 1 < count && changed[last + 1]->header_offset - changed[last]->end_offset <= RANGE_GAP_MAX) {
+            last++;
+        }
+
+        run.d = d;
+        run.files = changed + first;
+        run.count = last - first + 1;
+        run.index = 0;
+        run.pos = changed[first]->header_offset;
+        run.state = RUN_SEEK;
+        run.failed = false;
+        int64_t length = (int64_t)changed[last]->end_offset - changed[first]->header_offset;
+        radio_net_fetchRange(zip_url, changed[first]->header_offset, length, run_on_data, &run);
+
+        if (run.index < run.count) {
+            // Cut short: drop the file it was writing
+            if (run.state == RUN_DATA) {
+                run.z_end = false;
+                run_close_file(&run);
+            }
+            LOG_error("[SelfUpdate] Range fetch failed at %s\n", run.files[run.index]->path);
+            result = -1;
+        }
+        first = last + 1;
+    }
+
+    free(changed);
+    free(run.out_buf);
+    free(run.chunk);
+    return result;
+}
+
+static void remove_temp_files(Delta* d) {
+    for (int i = 0; i < d->count; i++) {
+        if (!d->files[i].changed) continue;
+        char path[512];
+        full_path(d, &d->files[i], TEMP_SUFFIX, path, sizeof(path));
+        unlink(path);
+    }
+}
+
+// Move the fetched files into place
+static void install_changed(Delta* d) {
+    for (int i = 0; i < d->count; i++) {
+        DeltaFile* f = &d->files[i];
+        if (!f->changed) continue;
+        char path[512], temp[512];
+        full_path(d, f, "", path, sizeof(path));
+        full_path(d, f, TEMP_SUFFIX, temp, sizeof(temp));
+
+        // Permissions from the zip, else those of the old copy, else by kind
+        mode_t mode = f->mode;
+        struct stat st;
+        if (!mode && stat(path, &st) == 0) mode = st.st_mode & 0777;
+        if (!mode) {
+            bool exec = strstr(f->path, ".elf") || strstr(f->path, ".sh") || strncmp(f->path, "bins/", 5) == 0;
+            mode = exec ? 0755 : 0644;
+        }
+        chmod(temp, mode);
+
+        if (rename(temp, path) != 0) {
+            LOG_error("[SelfUpdate] Failed to install %s\n", f->path);
+            unlink(temp);
+        }
+    }
+}
+
+// Remove files the release no longer has (state/ is the user's)
+static void remove_orphans(Delta* d, const char* rel_dir) {
+    char dir_path[512];
+    snprintf(dir_path, sizeof(dir_path), "%s%s%s", d->pak_path, rel_dir[0] ? "/" : "", rel_dir);
+    DIR* dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        char rel[256];
+        if (snprintf(rel, sizeof(rel), "%s%s%s", rel_dir, rel_dir[0] ? "/" : "", entry->d_name) >= (int)sizeof(rel)) continue;
+        if (!rel_dir[0] && strcmp(rel, "state") == 0) continue;
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", d->pak_path, rel);
+        struct stat st;
+        if (lstat(path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            remove_orphans(d, rel);
+        } else if (!find_file(d, rel)) {
+            unlink(path);
+        }
+    }
+    closedir(dir);
+}
+
+int selfupdate_delta_apply(const char* manifest_url, const char* zip_url, const char* pak_path,
+                           volatile bool* cancel, int* progress) {
+    if (!manifest_url || !manifest_url[0] || !zip_url || !zip_url[0]) return -1;
+
+    Delta d;
+    memset(&d, 0, sizeof(d));
+    d.files = malloc(sizeof(DeltaFile) * SELFUPDATE_DELTA_FILES_MAX);
+    if (!d.files) return -1;
+    d.pak_path = pak_path;
+    d.cancel = cancel;
+    d.progress = progress;
+
+    *progress = 5;
+    int result = fetch_manifest(&d, manifest_url);
+    if (result == 0 && !*cancel) {
+        *progress = 10;
+        result = read_central_dir(&d, zip_url);
+    }
+    int changed = result == 0 && !*cancel ? find_changed(&d) : -1;
+    if (changed < 0) result = -1;
+    LOG_info("[SelfUpdate] Delta: %d of %d files changed, %lld bytes to fetch\n",
+             changed, d.count, (long long)d.fetch_total);
+
+    if (result == 0 && changed > 0) {
+        result = fetch_changed(&d, zip_url);
+        if (result != 0 || *cancel) {
+            remove_temp_files(&d);
+            result = -1;
+        }
+    }
+
+    if (result == 0) {
+        *progress = 90;
+        install_changed(&d);
+        remove_orphans(&d, "");
+    }
+
+    free(d.files);
+    return result;
+}
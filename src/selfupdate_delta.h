@@ -0,0 +1,23 @@
+#ifndef __SELFUPDATE_DELTA_H__
+#define __SELFUPDATE_DELTA_H__
+
+#include <stdbool.h>
+
+// Delta self-update
+// Brings the pak up to a release using its file hash manifest: files whose
+// SHA-256 differs are read out of the release zip with HTTP range requests
+// (the central directory first, then runs of neighbouring entries), inflated
+// and checked against the manifest. Nothing is replaced until every changed
+// file has arrived; then each one is renamed over the old one and files the
+// release no longer has are removed (state/ is left alone).
+
+#define SELFUPDATE_DELTA_FILES_MAX 512
+
+// Update pak_path to the release zip at zip_url, whose manifest is at manifest_url.
+// *cancel is polled between files; *progress is raised from 5 to 90.
+// Returns 0 when the pak matches the manifest, or -1 with nothing changed
+// (fall back to a full update).
+int selfupdate_delta_apply(const char* manifest_url, const char* zip_url, const char* pak_path,
+                           volatile bool* cancel, int* progress);
+
+#endif
@@ -0,0 +1,26 @@
+#include <string.h>
+#include <sched.h>
+
+#include "seqlock.h"
+
+#define SEQLOCK_SPINS 64    // Retries before yielding to a preempted writer
+
+void Seqlock_write(Seqlock* lock, void* shared, const void* value, size_t size) {
+    uint32_t seq = __atomic_load_n(&lock->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&lock->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(shared, value, size);
+    __atomic_store_n(&lock->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void Seqlock_read(Seqlock* lock, void* value, const void* shared, size_t size) {
+    for (int tries = 1;; tries++) {
+        uint32_t seq = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE);
+        if (!(seq & 1)) {
+            memcpy(value, shared, size);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&lock->seq, __ATOMIC_RELAXED) == seq) return;
+        }
+        if (tries % SEQLOCK_SPINS == 0) sched_yield();
+    }
+}
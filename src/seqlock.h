@@ -0,0 +1,23 @@
+#ifndef __SEQLOCK_H__
+#define __SEQLOCK_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Sequence lock for state the UI reads every frame
+// The owning side publishes a copy of a struct; readers copy it out without a
+// lock and retry if a publish overlapped the copy, so they never see a torn
+// string and never hold up the writer. seq is odd while a publish is under way.
+// Writers must be serialized among themselves (one thread, or a writer mutex
+// readers never take).
+typedef struct {
+    uint32_t seq;               // Atomic
+} Seqlock;
+
+// Copy size bytes of value into shared
+void Seqlock_write(Seqlock* lock, void* shared, const void* value, size_t size);
+
+// Copy a consistent size bytes of shared into value
+void Seqlock_read(Seqlock* lock, void* value, const void* shared, size_t size);
+
+#endif
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "defines.h"
+#include "api.h"
+#include "session.h"
+
+#define SESSION_FILE SHARED_USERDATA_PATH "/session.txt"
+#define SESSION_VERSION 1
+
+// key=value lines; unknown keys are skipped so fields can be added later
+bool Session_load(Session* session) {
+    memset(session, 0, sizeof(Session));
+    session->track = -1;
+
+    FILE* f = fopen(SESSION_FILE, "r");
+    if (!f) return false;
+
+    char line[600];
+    int version = 0;
+    while (fgets(line, sizeof(line), f)) {
+        char* nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        char* value = strchr(line, '=');
+        if (!value) continue;
+        *value++ = '\0';
+
+        if (strcmp(line, "version") == 0) version = atoi(value);
+        else if (strcmp(line, "screen") == 0) session->screen = (SessionScreen)atoi(value);
+        else if (strcmp(line, "browser_path") == 0) snprintf(session->browser_path, sizeof(session->browser_path), "%s", value);
+        else if (strcmp(line, "browser_entry") == 0) snprintf(session->browser_entry, sizeof(session->browser_entry), "%s", value);
+        else if (strcmp(line, "queue_scope") == 0) session->queue_scope = atoi(value);
+        else if (strcmp(line, "queue_key") == 0) snprintf(session->queue_key, sizeof(session->queue_key), "%s", value);
+        else if (strcmp(line, "track_path") == 0) snprintf(session->track_path, sizeof(session->track_path), "%s", value);
+        else if (strcmp(line, "track") == 0) session->track = atoi(value);
+        else if (strcmp(line, "position_ms") == 0) session->position_ms = atoi(value);
+        else if (strcmp(line, "paused") == 0) session->paused = atoi(value) != 0;
+        else if (strcmp(line, "shuffle") == 0) session->shuffle = atoi(value) != 0;
+        else if (strcmp(line, "repeat") == 0) session->repeat = atoi(value) != 0;
+        else if (strcmp(line, "radio_url") == 0) snprintf(session->radio_url, sizeof(session->radio_url), "%s", value);
+    }
+    fclose(f);
+
+    if (version != SESSION_VERSION) {
+        memset(session, 0, sizeof(Session));
+        session->track = -1;
+        return false;
+    }
+    if (session->position_ms < 0) session->position_ms = 0;
+    return true;
+}
+
+void Session_save(const Session* session) {
+    // A crash or power loss mid-write leaves the previous snapshot in place
+    const char* tmp = SESSION_FILE ".tmp";
+    FILE* f = fopen(tmp, "w");
+    if (!f) return;
+    fprintf(f, "version=%d\n", SESSION_VERSION);
+    fprintf(f, "screen=%d\n", (int)session->screen);
+    fprintf(f, "browser_path=%s\n", session->browser_path);
+    fprintf(f, "browser_entry=%s\n", session->browser_entry);
+    fprintf(f, "queue_scope=%d\n", session->queue_scope);
+    fprintf(f, "queue_key=%s\n", session->queue_key);
+    fprintf(f, "track_path=%s\n", session->track_path);
+    fprintf(f, "track=%d\n", session->track);
+    fprintf(f, "position_ms=%d\n", session->position_ms);
+    fprintf(f, "paused=%d\n", session->paused ? 1 : 0);
+    fprintf(f, "shuffle=%d\n", session->shuffle ? 1 : 0);
+    fprintf(f, "repeat=%d\n", session->repeat ? 1 : 0);
+    fprintf(f, "radio_url=%s\n", session->radio_url);
+    if (fclose(f) != 0) {
+        remove(tmp);
+        return;
+    }
+    if (rename(tmp, SESSION_FILE) != 0) remove(tmp);
+}
@@ -0,0 +1,43 @@
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stdbool.h>
+
+// Session snapshot
+// What was on screen and playing when the app was last left: the screen, the
+// browser folder and selection, the play queue, the track and its position,
+// shuffle/repeat and the radio station. Saved on exit and periodically while
+// something plays, and restored at launch instead of opening the main menu.
+
+#define SESSION_SAVE_MS 30000   // Snapshot interval while playing
+
+typedef enum {
+    SESSION_SCREEN_MENU = 0,
+    SESSION_SCREEN_BROWSER,
+    SESSION_SCREEN_PLAYING,
+    SESSION_SCREEN_RADIO_LIST,
+    SESSION_SCREEN_RADIO_PLAYING
+} SessionScreen;
+
+typedef struct {
+    SessionScreen screen;
+    char browser_path[512];     // Folder shown in the browser ("" = music root)
+    char browser_entry[512];    // Path of its selected entry
+    int queue_scope;            // QueueScope, QUEUE_SCOPE_NONE = the browser folder plays
+    char queue_key[512];
+    char track_path[512];       // "" = nothing was loaded
+    int track;                  // Track number in the browser folder or queue (cue tracks share a path)
+    int position_ms;            // Within the track
+    bool paused;
+    bool shuffle;
+    bool repeat;
+    char radio_url[512];        // Selected station
+} Session;
+
+// Read the last snapshot; false if there is none
+bool Session_load(Session* session);
+
+// Write a snapshot (replaces the file atomically)
+void Session_save(const Session* session);
+
+#endif
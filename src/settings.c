@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+
+#include "settings.h"
+#include "jobs.h"
+#include "defines.h"
+#include "api.h"
+
+#define SETTINGS_FILE SHARED_USERDATA_PATH "/settings.txt"
+
+// Names in the file, by key; unknown names are skipped so keys can be added later
+static const char* key_names[SETTING_COUNT] = {
+    "crossfade", "native_rate", "bit_perfect", "float_pipeline", "eq_preset", "normalize",
+    "spectrum_style", "spectrum_visible", "youtube_workers", "youtube_format", "speed",
+    "data_saver"
+};
+
+typedef struct {
+    int values[SETTING_COUNT];
+    bool set[SETTING_COUNT];
+    bool ok;                    // Written (result for the main thread)
+} SettingsSnapshot;
+
+static SettingsSnapshot store;
+static bool dirty = false;
+static bool flushing = false;   // A write job is in flight
+static uint32_t changed_at = 0;
+static uint32_t flushed_at = 0;
+
+// Write a snapshot atomically: a crash or power loss mid-write leaves the old file
+static bool write_snapshot(const SettingsSnapshot* snapshot) {
+    const char* tmp = SETTINGS_FILE ".tmp";
+    FILE* f = fopen(tmp, "w");
+    if (!f) return false;
+    for (int i = 0; i < SETTING_COUNT; i++) {
+        if (snapshot->set[i]) fprintf(f, "%s=%d\n", key_names[i], snapshot->values[i]);
+    }
+    if (fclose(f) != 0 || rename(tmp, SETTINGS_FILE) != 0) {
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+static void flush_job(void* arg, JobToken* token) {
+    (void)token;
+    SettingsSnapshot* snapshot = (SettingsSnapshot*)arg;
+    snapshot->ok = write_snapshot(snapshot);
+}
+
+static void flush_done(void* arg, bool cancelled) {
+    SettingsSnapshot* snapshot = (SettingsSnapshot*)arg;
+    flushing = false;
+    if (cancelled || !snapshot->ok) {
+        if (!cancelled) LOG_error("Settings: failed to write %s\n", SETTINGS_FILE);
+        dirty = true;           // Tried again after the interval (or by Settings_quit)
+    }
+    free(snapshot);
+}
+
+void Settings_init(void) {
+    memset(&store, 0, sizeof(store));
+    FILE* f = fopen(SETTINGS_FILE, "r");
+    if (!f) return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), f)) {
+        char* nl = strchr(line, '\n');
+        if (nl) *nl = '\0';
+        char* value = strchr(line, '=');
+        if (!value) continue;
+        *value++ = '\0';
+        for (int i = 0; i < SETTING_COUNT; i++) {
+            if (strcmp(line, key_names[i]) != 0) continue;
+            store.values[i] = atoi(value);
+            store.set[i] = true;
+            break;
+        }
+    }
+    fclose(f);
+}
+
+bool Settings_has(SettingKey key) {
+    return store.set[key];
+}
+
+int Settings_getInt(SettingKey key, int fallback) {
+    return store.set[key] ? store.values[key] : fallback;
+}
+
+bool Settings_getBool(SettingKey key, bool fallback) {
+    return Settings_getInt(key, fallback ? 1 : 0) != 0;
+}
+
+void Settings_setInt(SettingKey key, int value) {
+    if (store.set[key] && store.values[key] == value) return;
+    store.values[key] = value;
+    store.set[key] = true;
+    dirty = true;
+    changed_at = SDL_GetTicks();
+}
+
+void Settings_setBool(SettingKey key, bool value) {
+    Settings_setInt(key, value ? 1 : 0);
+}
+
+int Settings_flushWaitMs(void) {
+    if (!dirty || flushing) return -1;
+    uint32_t now = SDL_GetTicks();
+    uint32_t due = changed_at + SETTINGS_FLUSH_DELAY_MS;
+    if (flushed_at && flushed_at + SETTINGS_FLUSH_INTERVAL_MS > due) due = flushed_at + SETTINGS_FLUSH_INTERVAL_MS;
+    return (int32_t)(due - now) > 0 ? (int)(due - now) : 0;
+}
+
+void Settings_poll(void) {
+    if (Settings_flushWaitMs() != 0) return;
+
+    SettingsSnapshot* snapshot = malloc(sizeof(SettingsSnapshot));
+    if (!snapshot) return;
+    *snapshot = store;
+    if (Jobs_post(JOB_PRIORITY_BACKGROUND, flush_job, flush_done, snapshot) != 0) {
+        free(snapshot);
+        return;
+    }
+    dirty = false;
+    flushing = true;
+    flushed_at = SDL_GetTicks();
+}
+
+void Settings_quit(void) {
+    if (!dirty) return;
+    if (write_snapshot(&store)) dirty = false;
+}
@@ -0,0 +1,59 @@
+#ifndef __SETTINGS_H__
+#define __SETTINGS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Settings store
+// The app's preferences (player, spectrum, YouTube downloads) live in one file
+// and are read from memory. A change only marks the store dirty: Settings_poll
+// writes it out on a background job once no change came for
+// SETTINGS_FLUSH_DELAY_MS, and no sooner than SETTINGS_FLUSH_INTERVAL_MS after
+// the last write, so a run of toggles costs one SD write instead of one each.
+// Writes go to a temp file renamed over the old one. Keys never saved yet are
+// read by their module from its file of before the store, which carries them over.
+// All functions are for the main thread.
+
+#define SETTINGS_FLUSH_DELAY_MS 2000
+#define SETTINGS_FLUSH_INTERVAL_MS 5000
+
+typedef enum {
+    SETTING_CROSSFADE,          // Seconds
+    SETTING_NATIVE_RATE,
+    SETTING_BIT_PERFECT,
+    SETTING_FLOAT_PIPELINE,
+    SETTING_EQ_PRESET,
+    SETTING_NORMALIZE,
+    SETTING_SPECTRUM_STYLE,
+    SETTING_SPECTRUM_VISIBLE,
+    SETTING_YOUTUBE_WORKERS,
+    SETTING_YOUTUBE_FORMAT,
+    SETTING_SPEED,              // Percent
+    SETTING_DATA_SAVER,
+    SETTING_COUNT
+} SettingKey;
+
+// Read the settings file (before the modules that keep settings start)
+void Settings_init(void);
+
+// Whether key has a value (saved, or set since)
+bool Settings_has(SettingKey key);
+
+// Value of key, or fallback if it has none
+int Settings_getInt(SettingKey key, int fallback);
+bool Settings_getBool(SettingKey key, bool fallback);
+
+// Change a value; written out later
+void Settings_setInt(SettingKey key, int value);
+void Settings_setBool(SettingKey key, bool value);
+
+// Start the write of pending changes once due (main loop)
+void Settings_poll(void);
+
+// Milliseconds until Settings_poll has a write to start, -1 if none is pending
+int Settings_flushWaitMs(void);
+
+// Write pending changes now (after Jobs_quit)
+void Settings_quit(void);
+
+#endif
@@ -0,0 +1,135 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "shuffle.h"
+
+// Tracks at the end of a cycle kept out of the start of the next one
+#define SHUFFLE_RECENT_MAX 16
+
+static int* order = NULL;       // Play order of this cycle
+static int* where = NULL;       // Position of each track in order
+static int* pending = NULL;     // Order of the next cycle, made when first peeked
+static bool pending_ready = false;
+static int track_count = 0;
+static int capacity = 0;
+static int pos = -1;            // Position of the current track (-1 = none yet)
+
+// Fisher–Yates shuffle of a[start..end)
+static void shuffle_range(int* a, int start, int end) {
+    for (int i = end - 1; i > start; i--) {
+        int j = start + rand() % (i - start + 1);
+        int t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+static void update_where(int from, int to) {
+    for (int i = from; i < to; i++) {
+        where[order[i]] = i;
+    }
+}
+
+// Next cycle: a random order whose first places go to tracks that did not end this one
+static void make_pending(void) {
+    int recent = track_count / 2;
+    if (recent > SHUFFLE_RECENT_MAX) recent = SHUFFLE_RECENT_MAX;
+    int keep = track_count - recent;
+
+    memcpy(pending, order, sizeof(int) * keep);
+    shuffle_range(pending, 0, keep);
+    memcpy(pending + keep, order + keep, sizeof(int) * recent);
+    shuffle_range(pending, recent, track_count);
+    pending_ready = true;
+}
+
+void Shuffle_reset(int count, int current) {
+    pending_ready = false;
+    pos = -1;
+    track_count = 0;
+    if (count <= 0) return;
+
+    if (count > capacity) {
+        int* new_order = realloc(order, sizeof(int) * count);
+        if (new_order) order = new_order;
+        int* new_where = realloc(where, sizeof(int) * count);
+        if (new_where) where = new_where;
+        int* new_pending = realloc(pending, sizeof(int) * count);
+        if (new_pending) pending = new_pending;
+        if (!new_order || !new_where || !new_pending) return;
+        capacity = count;
+    }
+
+    track_count = count;
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+    }
+    shuffle_range(order, 0, count);
+    update_where(0, count);
+
+    if (current >= 0 && current < count) {
+        int p = where[current];
+        order[p] = order[0];
+        order[0] = current;
+        update_where(0, p + 1);
+        pos = 0;
+    }
+}
+
+void Shuffle_free(void) {
+    free(order);
+    free(where);
+    free(pending);
+    order = where = pending = NULL;
+    capacity = 0;
+    track_count = 0;
+    pos = -1;
+    pending_ready = false;
+}
+
+int Shuffle_peekNext(void) {
+    if (pos + 1 < track_count) return order[pos + 1];
+    if (track_count <= 1) return -1;
+    if (!pending_ready) make_pending();
+    return pending[0];
+}
+
+int Shuffle_peekPrev(void) {
+    return pos > 0 ? order[pos - 1] : -1;
+}
+
+void Shuffle_setCurrent(int track) {
+    if (track < 0 || track >= track_count) return;
+    if (pos >= 0 && order[pos] == track) return;
+
+    if (pos == track_count - 1 && pending_ready && pending[0] == track) {
+        // Start the next cycle
+        int* t = order;
+        order = pending;
+        pending = t;
+        pending_ready = false;
+        update_where(0, track_count);
+        pos = 0;
+        return;
+    }
+    pending_ready = false;
+
+    int p = where[track];
+    if (p > pos) {
+        // Ahead in the order (the next track, or a pick): bring it forward
+        order[p] = order[pos + 1];
+        order[pos + 1] = track;
+        where[order[p]] = p;
+        where[track] = pos + 1;
+        pos++;
+    } else if (p == pos - 1) {
+        // Previous: step back, the track we left is next again
+        pos--;
+    } else {
+        // Earlier in the history: replay it now, keeping the rest in order
+        memmove(&order[p], &order[p + 1], sizeof(int) * (pos - p));
+        order[pos] = track;
+        update_where(p, pos + 1);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef __SHUFFLE_H__
+#define __SHUFFLE_H__
+
+// Shuffle bag
+// Plays the tracks of a scope (the audio files of a folder, or the library) in a
+// precomputed Fisher–Yates order, each once per cycle. Tracks are 0-based indexes
+// into the scope. The played part of the order is the history for previous, and
+// a new cycle never starts with the tracks that ended the last one.
+// All functions are for the main thread.
+
+// Start a new order over count tracks, current (-1 = none) first
+void Shuffle_reset(int count, int current);
+
+// Release the order
+void Shuffle_free(void);
+
+// Track that plays after the current one, or -1 if there is none to shuffle
+// Stable until Shuffle_setCurrent or Shuffle_reset.
+int Shuffle_peekNext(void);
+
+// Track played before the current one, or -1 at the start of the history
+int Shuffle_peekPrev(void);
+
+// A track started playing: moves forward/back through the order when it is the
+// next/previous one, otherwise it is taken into the order at the current position
+void Shuffle_setCurrent(int track);
+
+#endif
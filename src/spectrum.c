@@ -2,34 +2,99 @@
 #include "player.h"
 #include "defines.h"
 #include "api.h"
+#include "profile.h"
+#include "settings.h"
 #include "audio/kiss_fftr.h"
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #define SPECTRUM_SETTINGS_FILE SHARED_USERDATA_PATH "/spectrum_settings.txt"
 
-#define SMOOTHING_FACTOR 0.7f
-#define PEAK_DECAY 0.97f
+#define SMOOTHING_FACTOR 0.7f   // Per 1/60 s, scaled to the analysis hop
+#define PEAK_DECAY 0.97f        // Ditto
+#define SPECTRUM_HOP 512        // Frames between analyses (about 90 per second, windows overlap by half)
+#define TAP_IDLE_MS 500         // Analysis stops this long after the renderer last looked
+#define FFT_MEM_SIZE (32 * 1024)        // Room for the kiss_fftr state of SPECTRUM_FFT_SIZE
+#define FFT_BINS (SPECTRUM_FFT_SIZE / 2 + 1)
 #define MIN_DB -60.0f
 #define MAX_DB 0.0f
 #define FREQ_COMPENSATION 1.0f  // dB boost per octave for high frequencies
 #define FREQ_DISTRIBUTION 0.6f  // <1.0 = more bars for high freq, >1.0 = more bars for low freq
 
+// Analysis runs on the audio thread as output is produced (Spectrum_feed). Its
+// state below is only touched there, apart from the FFT setup in Spectrum_init.
+// The FFT state lives in static memory so nothing is freed under a running callback.
 static kiss_fftr_cfg fft_cfg = NULL;
+static double fft_mem[FFT_MEM_SIZE / sizeof(double)];
 static kiss_fft_scalar fft_input[SPECTRUM_FFT_SIZE];
 static kiss_fft_cpx fft_output[SPECTRUM_FFT_SIZE / 2 + 1];
-static float hann_window[SPECTRUM_FFT_SIZE];
+static float window_scaled[SPECTRUM_FFT_SIZE];  // Hann window x 1/32768 (and size)
+static float bin_power[FFT_BINS];               // re^2 + im^2 of each bin
+static int16_t tap_ring[SPECTRUM_FFT_SIZE];     // Latest mono samples
+static int tap_pos = 0;
+static int tap_since = 0;                       // Frames since the last analysis
+static int tap_rate = 0;                        // Sample rate bins and decays are set for
+static float tap_smoothing, tap_peak_decay;     // SMOOTHING_FACTOR / PEAK_DECAY per hop
 static float prev_bars[SPECTRUM_BARS];
-static SpectrumData spectrum_data;
-static int16_t sample_buffer[SPECTRUM_FFT_SIZE * 2];
+static float peaks[SPECTRUM_BARS];
 
 static int bin_ranges[SPECTRUM_BARS + 1];
 static float freq_compensation[SPECTRUM_BARS];  // Per-band gain compensation
 
+// Results pass from the audio thread to the renderer through a ring of frames,
+// each stamped with when its audio will be heard (fed time plus the output
+// latency). The writer fills the slot after the newest and publishes it, the
+// reader takes the newest frame that is due. Neither ever waits: the latency is
+// capped well inside half the ring, so a slot being read is never being rewritten.
+typedef struct {
+    float bars[SPECTRUM_BARS];
+    float peaks[SPECTRUM_BARS];
+    uint32_t heard_ms;          // Monotonic ms its audio reaches the ear
+} SpectrumFrame;
+
+#define FRAME_RING 256          // ~2.7 s of analyses at 48 kHz
+#define LATENCY_MAX_MS 600      // Frames due within this fit in half the ring up to 96 kHz
+
+static SpectrumFrame frames[FRAME_RING];
+static uint32_t frame_head = 0;         // Frames ever published (atomic)
+static uint32_t frame_taken = 0;        // Renderer's: first frame it hasn't passed
+static int output_latency_ms = 0;       // Atomic
+static uint32_t tap_heard_ms = 0;       // When the block being fed starts to be heard
+static int tap_block_pos = 0;           // Frames into that block
+static uint32_t tap_wanted_until = 0;   // Monotonic ms the renderer asked for analysis until
+
+static SpectrumData spectrum_data;
+
 static int spec_x = 0, spec_y = 0, spec_w = 0, spec_h = 0;
 static bool position_set = false;
 
+// Bars as last drawn into the persistent surface, so a frame only repaints the
+// columns that changed and skips the upload when none did
+static SDL_Surface* spec_surface = NULL;
+static int drawn_h[SPECTRUM_BARS];
+static int drawn_peak_y[SPECTRUM_BARS];         // -1 = no peak indicator
+static uint32_t drawn_color[SPECTRUM_BARS];
+static SpectrumStyle drawn_style;
+static bool surface_stale = true;               // Every column needs repainting
+
+#define COLOR_LEVELS 256        // Magnitude steps of the magnitude style's colors
+
+// Colors packed for spec_surface, rebuilt only when the style, theme colors or
+// surface change, so drawing a bar is a fill or a blit
+static uint32_t bar_colors[SPECTRUM_BARS];      // Styles colored by bar (and peaks)
+static uint32_t level_colors[COLOR_LEVELS];     // Styles colored by magnitude
+static SDL_Surface* gradient_strip = NULL;      // Vertical style: a full-height bar
+static SpectrumStyle lut_style;
+static uint32_t lut_theme[2];                   // Accent colors the strip was drawn in
+static bool lut_ready = false;
+static bool layer_stale = true;                 // The layer lost what was uploaded
+
 static SpectrumStyle current_style = SPECTRUM_STYLE_WHITE;
 static bool spectrum_visible = true;
 
@@ -41,27 +106,31 @@ static const char* style_names[] = {
     "Vertical"
 };
 
-// Save spectrum settings to file
+// Save spectrum settings to the settings store
 static void save_settings(void) {
-    FILE* f = fopen(SPECTRUM_SETTINGS_FILE, "w");
-    if (!f) return;
-    fprintf(f, "%d\n%d\n", (int)current_style, spectrum_visible ? 1 : 0);
-    fclose(f);
+    Settings_setInt(SETTING_SPECTRUM_STYLE, (int)current_style);
+    Settings_setBool(SETTING_SPECTRUM_VISIBLE, spectrum_visible);
 }
 
-// Load spectrum settings from file
+// Load spectrum settings, from the file of before the settings store until they were saved
 static void load_settings(void) {
-    FILE* f = fopen(SPECTRUM_SETTINGS_FILE, "r");
-    if (!f) return;
-
-    int style = 0, visible = 1;
-    if (fscanf(f, "%d\n%d\n", &style, &visible) == 2) {
-        if (style >= 0 && style < SPECTRUM_STYLE_COUNT) {
-            current_style = (SpectrumStyle)style;
+    if (!Settings_has(SETTING_SPECTRUM_STYLE)) {
+        FILE* f = fopen(SPECTRUM_SETTINGS_FILE, "r");
+        if (f) {
+            int style = 0, visible = 1;
+            if (fscanf(f, "%d\n%d\n", &style, &visible) == 2) {
+                Settings_setInt(SETTING_SPECTRUM_STYLE, style);
+                Settings_setBool(SETTING_SPECTRUM_VISIBLE, visible != 0);
+            }
+            fclose(f);
         }
-        spectrum_visible = (visible != 0);
     }
-    fclose(f);
+
+    int style = Settings_getInt(SETTING_SPECTRUM_STYLE, (int)current_style);
+    if (style >= 0 && style < SPECTRUM_STYLE_COUNT) {
+        current_style = (SpectrumStyle)style;
+    }
+    spectrum_visible = Settings_getBool(SETTING_SPECTRUM_VISIBLE, spectrum_visible);
 }
 
 // HSV to RGB conversion (h: 0-360, s: 0-1, v: 0-1)
@@ -126,14 +195,67 @@ static void get_bar_color(int bar_index, float magnitude, uint8_t* r, uint8_t* g
 
 static void init_hann_window(void) {
     for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
-        hann_window[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * i / (SPECTRUM_FFT_SIZE - 1)));
+        float hann = 0.5f * (1.0f - cosf(2.0f * M_PI * i / (SPECTRUM_FFT_SIZE - 1)));
+        // Levels stay as tuned for a 512-point FFT, whatever the size
+        window_scaled[i] = hann / 32768.0f * (512.0f / SPECTRUM_FFT_SIZE);
     }
 }
 
-static void init_bin_ranges(void) {
+// log2(x) for x > 0, to about 0.01 (plenty for bars on a 60 dB scale): the
+// exponent bits give the integer part, a quadratic on the mantissa the rest
+static inline float fast_log2(float x) {
+    union { float f; uint32_t i; } v = {x};
+    float e = (float)(int)((v.i >> 23) & 0xFF) - 128.0f;
+    v.i = (v.i & 0x007FFFFF) | 0x3F800000;      // Mantissa as 1.0 .. 2.0
+    float m = v.f;
+    return e + (-0.34484843f * m + 2.02466578f) * m - 0.67487759f;
+}
+
+// Window the ring (oldest sample first) into fft_input
+static void window_input(void) {
+    // The ring splits into two straight runs
+    int first = SPECTRUM_FFT_SIZE - tap_pos;
+    const int16_t* runs[2] = {tap_ring + tap_pos, tap_ring};
+    int lens[2] = {first, tap_pos};
+    int out = 0;
+    for (int r = 0; r < 2; r++) {
+        const int16_t* in = runs[r];
+        int len = lens[r];
+        int i = 0;
+#if defined(__ARM_NEON)
+        for (; i + 8 <= len; i += 8) {
+            int16x8_t v = vld1q_s16(in + i);
+            float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+            float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+            vst1q_f32(fft_input + out + i, vmulq_f32(lo, vld1q_f32(window_scaled + out + i)));
+            vst1q_f32(fft_input + out + i + 4, vmulq_f32(hi, vld1q_f32(window_scaled + out + i + 4)));
+        }
+#endif
+        for (; i < len; i++) {
+            fft_input[out + i] = in[i] * window_scaled[out + i];
+        }
+        out += len;
+    }
+}
+
+// Power of every bin (no square roots: bars are averaged in the power domain)
+static void compute_bin_power(void) {
+    const float* cpx = (const float*)fft_output;
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i + 4 <= FFT_BINS; i += 4) {
+        float32x4x2_t v = vld2q_f32(cpx + i * 2);       // Splits re and im
+        vst1q_f32(bin_power + i, vmlaq_f32(vmulq_f32(v.val[0], v.val[0]), v.val[1], v.val[1]));
+    }
+#endif
+    for (; i < FFT_BINS; i++) {
+        bin_power[i] = cpx[i * 2] * cpx[i * 2] + cpx[i * 2 + 1] * cpx[i * 2 + 1];
+    }
+}
+
+static void init_bin_ranges(float sample_rate) {
     float min_freq = 80.0f;
     float max_freq = 16000.0f;
-    float sample_rate = 48000.0f;
     float bin_resolution = sample_rate / SPECTRUM_FFT_SIZE;
 
     int min_bin = (int)(min_freq / bin_resolution);
@@ -162,49 +284,41 @@ static void init_bin_ranges(void) {
 }
 
 void Spectrum_init(void) {
-    fft_cfg = kiss_fftr_alloc(SPECTRUM_FFT_SIZE, 0, NULL, NULL);
+    size_t fft_len = sizeof(fft_mem);
+    fft_cfg = kiss_fftr_alloc(SPECTRUM_FFT_SIZE, 0, fft_mem, &fft_len);
+    if (!fft_cfg) LOG_error("Spectrum: FFT state needs %zu bytes\n", fft_len);
     init_hann_window();
-    init_bin_ranges();
     memset(prev_bars, 0, sizeof(prev_bars));
     memset(&spectrum_data, 0, sizeof(spectrum_data));
     load_settings();  // Load saved style and visibility
 }
 
 void Spectrum_quit(void) {
-    if (fft_cfg) {
-        kiss_fftr_free(fft_cfg);
-        fft_cfg = NULL;
-    }
-}
-
-void Spectrum_update(void) {
-    if (!fft_cfg) return;
-
-    if (Player_getState() != PLAYER_STATE_PLAYING) {
-        for (int i = 0; i < SPECTRUM_BARS; i++) {
-            prev_bars[i] *= 0.9f;
-            spectrum_data.bars[i] = prev_bars[i];
-            spectrum_data.peaks[i] *= PEAK_DECAY;
-        }
-        spectrum_data.valid = true;
-        return;
+    if (spec_surface) {
+        SDL_FreeSurface(spec_surface);
+        spec_surface = NULL;
     }
-
-    int samples = Player_getVisBuffer(sample_buffer, SPECTRUM_FFT_SIZE * 2);
-    if (samples < SPECTRUM_FFT_SIZE) {
-        spectrum_data.valid = false;
-        return;
+    if (gradient_strip) {
+        SDL_FreeSurface(gradient_strip);
+        gradient_strip = NULL;
     }
+    lut_ready = false;
+}
 
-    for (int i = 0; i < SPECTRUM_FFT_SIZE; i++) {
-        float left = sample_buffer[i * 2];
-        float right = sample_buffer[i * 2 + 1];
-        float mono = (left + right) * 0.5f;
-        fft_input[i] = (mono / 32768.0f) * hann_window[i];
-    }
+static uint32_t spectrum_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
 
+// FFT of the last SPECTRUM_FFT_SIZE samples into bars and peaks, then publish them
+static void analyze(void) {
+    window_input();
     kiss_fftr(fft_cfg, fft_input, fft_output);
+    compute_bin_power();
 
+    uint32_t head = __atomic_load_n(&frame_head, __ATOMIC_RELAXED);
+    SpectrumFrame* frame = &frames[head % FRAME_RING];
     for (int i = 0; i < SPECTRUM_BARS; i++) {
         int start_bin = bin_ranges[i];
         int end_bin = bin_ranges[i + 1];
@@ -212,17 +326,15 @@ void Spectrum_update(void) {
 
         float sum = 0.0f;
         int count = 0;
-        for (int j = start_bin; j < end_bin && j < SPECTRUM_FFT_SIZE / 2 + 1; j++) {
-            float re = fft_output[j].r;
-            float im = fft_output[j].i;
-            float mag = sqrtf(re * re + im * im);
-            sum += mag;
+        for (int j = start_bin; j < end_bin && j < FFT_BINS; j++) {
+            sum += bin_power[j];
             count++;
         }
 
-        float avg_mag = (count > 0) ? sum / count : 0.0f;
+        float avg_power = (count > 0) ? sum / count : 0.0f;
 
-        float db = 20.0f * log10f(avg_mag + 1e-10f);
+        // 10 * log10(power) = 20 * log10(magnitude)
+        float db = 3.0103f * fast_log2(avg_power + 1e-20f);
         // Apply frequency compensation to boost higher frequencies
         db += freq_compensation[i];
         float normalized = (db - MIN_DB) / (MAX_DB - MIN_DB);
@@ -232,26 +344,113 @@ void Spectrum_update(void) {
         if (normalized > prev_bars[i]) {
             prev_bars[i] = normalized;
         } else {
-            prev_bars[i] = prev_bars[i] * SMOOTHING_FACTOR + normalized * (1.0f - SMOOTHING_FACTOR);
+            prev_bars[i] = prev_bars[i] * tap_smoothing + normalized * (1.0f - tap_smoothing);
         }
 
-        spectrum_data.bars[i] = prev_bars[i];
-
-        if (prev_bars[i] > spectrum_data.peaks[i]) {
-            spectrum_data.peaks[i] = prev_bars[i];
+        if (prev_bars[i] > peaks[i]) {
+            peaks[i] = prev_bars[i];
         } else {
+            peaks[i] *= tap_peak_decay;
+        }
+        frame->bars[i] = prev_bars[i];
+        frame->peaks[i] = peaks[i];
+    }
+
+    frame->heard_ms = tap_heard_ms + (uint32_t)((int64_t)tap_block_pos * 1000 / tap_rate);
+    __atomic_store_n(&frame_head, head + 1, __ATOMIC_RELEASE);
+}
+
+// Whether analysis is wanted, and set up for sample_rate
+static bool tap_begin(int sample_rate) {
+    if (!fft_cfg || sample_rate <= 0) return false;
+    int32_t left = (int32_t)(__atomic_load_n(&tap_wanted_until, __ATOMIC_RELAXED) - spectrum_now_ms());
+    if (left <= 0) return false;
+
+    tap_heard_ms = spectrum_now_ms() + (uint32_t)__atomic_load_n(&output_latency_ms, __ATOMIC_RELAXED);
+    tap_block_pos = 0;
+
+    if (sample_rate != tap_rate) {
+        init_bin_ranges((float)sample_rate);
+        float frames_60hz = 60.0f * SPECTRUM_HOP / sample_rate;
+        tap_smoothing = powf(SMOOTHING_FACTOR, frames_60hz);
+        tap_peak_decay = powf(PEAK_DECAY, frames_60hz);
+        tap_rate = sample_rate;
+    }
+    return true;
+}
+
+static inline void tap_sample(int16_t mono) {
+    tap_ring[tap_pos] = mono;
+    tap_pos = (tap_pos + 1) % SPECTRUM_FFT_SIZE;
+    tap_block_pos++;
+    if (++tap_since >= SPECTRUM_HOP) {
+        tap_since = 0;
+        analyze();
+    }
+}
+
+void Spectrum_feed(const int16_t* samples, int frames_count, int sample_rate) {
+    if (!tap_begin(sample_rate)) return;
+    for (int i = 0; i < frames_count; i++) {
+        tap_sample((int16_t)((samples[i * 2] + samples[i * 2 + 1]) >> 1));
+    }
+}
+
+void Spectrum_feedS32(const int32_t* samples, int frames_count, int sample_rate) {
+    if (!tap_begin(sample_rate)) return;
+    for (int i = 0; i < frames_count; i++) {
+        tap_sample((int16_t)(((samples[i * 2] >> 16) + (samples[i * 2 + 1] >> 16)) >> 1));
+    }
+}
+
+void Spectrum_update(void) {
+    PROFILE_SCOPE("Spectrum_update");
+    // Keep the audio thread analyzing while someone looks
+    __atomic_store_n(&tap_wanted_until, spectrum_now_ms() + TAP_IDLE_MS, __ATOMIC_RELAXED);
+
+    if (Player_getState() != PLAYER_STATE_PLAYING) {
+        for (int i = 0; i < SPECTRUM_BARS; i++) {
+            spectrum_data.bars[i] *= 0.9f;
             spectrum_data.peaks[i] *= PEAK_DECAY;
         }
+        spectrum_data.valid = true;
+        return;
     }
 
-    spectrum_data.valid = true;
+    // Newest published frame that is being heard by now
+    uint32_t head = __atomic_load_n(&frame_head, __ATOMIC_ACQUIRE);
+    if (head - frame_taken > FRAME_RING / 2) frame_taken = head - FRAME_RING / 2;
+    uint32_t now = spectrum_now_ms();
+    const SpectrumFrame* due = NULL;
+    while (frame_taken != head && (int32_t)(frames[frame_taken % FRAME_RING].heard_ms - now) <= 0) {
+        due = &frames[frame_taken % FRAME_RING];
+        frame_taken++;
+    }
+    if (due) {
+        memcpy(spectrum_data.bars, due->bars, sizeof(spectrum_data.bars));
+        memcpy(spectrum_data.peaks, due->peaks, sizeof(spectrum_data.peaks));
+        spectrum_data.valid = true;
+    }
+}
+
+void Spectrum_setLatency(int latency_ms) {
+    if (latency_ms < 0) latency_ms = 0;
+    if (latency_ms > LATENCY_MAX_MS) latency_ms = LATENCY_MAX_MS;
+    __atomic_store_n(&output_latency_ms, latency_ms, __ATOMIC_RELAXED);
 }
 
 const SpectrumData* Spectrum_getData(void) {
     return &spectrum_data;
 }
 
+// Called on every full redraw of the player, which clears the GPU layers
 void Spectrum_setPosition(int x, int y, int w, int h) {
+    if (spec_surface && (w != spec_w || h != spec_h)) {
+        SDL_FreeSurface(spec_surface);
+        spec_surface = NULL;
+        lut_ready = false;
+    }
+    layer_stale = true;
     spec_x = x;
     spec_y = y;
     spec_w = w;
@@ -275,6 +474,7 @@ void Spectrum_toggleVisibility(void) {
         PLAT_clearLayers(LAYER_SPECTRUM);
         PLAT_GPU_Flip();
     }
+    layer_stale = true;
     save_settings();  // Persist preference
 }
 
@@ -290,15 +490,10 @@ const char* Spectrum_getStyleName(void) {
     return style_names[current_style];
 }
 
-// Draw a vertical gradient bar (for SPECTRUM_STYLE_VERTICAL)
+// Draw the vertical style's gradient into strip, top to bottom
 // Uses system theme colors: primary accent (top) to secondary accent (bottom)
-static void draw_vertical_gradient_bar(SDL_Surface* surface, int x, int y, int w, int h, int bar_index) {
-    if (h <= 0 || w <= 0) return;
-
-    // Get raw theme colors (format: 0xRRGGBB)
-    // THEME_COLOR1 = main, THEME_COLOR2 = primary accent, THEME_COLOR3 = secondary accent
-    uint32_t color1 = CFG_getColor(2);  // Primary accent (top)
-    uint32_t color2 = CFG_getColor(3);  // Secondary accent (bottom)
+static void draw_gradient_strip(SDL_Surface* strip, uint32_t color1, uint32_t color2) {
+    int h = strip->h;
 
     uint8_t top_r = (color1 >> 16) & 0xFF;
     uint8_t top_g = (color1 >> 8) & 0xFF;
@@ -317,67 +512,137 @@ static void draw_vertical_gradient_bar(SDL_Surface* surface, int x, int y, int w
         uint8_t g = (uint8_t)(top_g + t * (bot_g - top_g));
         uint8_t b = (uint8_t)(top_b + t * (bot_b - top_b));
 
-        // Use SDL_MapRGBA for correct pixel format
-        uint32_t color = SDL_MapRGBA(surface->format, r, g, b, 255);
+        SDL_Rect row_rect = {0, row, strip->w, 1};
+        SDL_FillRect(strip, &row_rect, SDL_MapRGBA(strip->format, r, g, b, 255));
+    }
+}
 
-        SDL_Rect row_rect = {x, y + row, w, 1};
-        SDL_FillRect(surface, &row_rect, color);
+// Bring the color tables up to the current style and theme
+// Returns true if they were rebuilt (everything drawn with the old ones is stale).
+static bool update_luts(int bar_w, int bar_max_h) {
+    // Get raw theme colors (format: 0xRRGGBB)
+    // THEME_COLOR1 = main, THEME_COLOR2 = primary accent, THEME_COLOR3 = secondary accent
+    uint32_t theme[2] = {0, 0};
+    if (current_style == SPECTRUM_STYLE_VERTICAL) {
+        theme[0] = CFG_getColor(2);
+        theme[1] = CFG_getColor(3);
     }
+    bool strip_fits = gradient_strip && gradient_strip->w == bar_w && gradient_strip->h == bar_max_h;
+    if (lut_ready && lut_style == current_style && theme[0] == lut_theme[0] && theme[1] == lut_theme[1] &&
+        (current_style != SPECTRUM_STYLE_VERTICAL || strip_fits)) {
+        return false;
+    }
+
+    uint8_t r, g, b;
+    for (int i = 0; i < SPECTRUM_BARS; i++) {
+        get_bar_color(i, 0.0f, &r, &g, &b);
+        bar_colors[i] = SDL_MapRGBA(spec_surface->format, r, g, b, 255);
+    }
+    for (int level = 0; level < COLOR_LEVELS; level++) {
+        get_bar_color(0, (float)level / (COLOR_LEVELS - 1), &r, &g, &b);
+        level_colors[level] = SDL_MapRGBA(spec_surface->format, r, g, b, 255);
+    }
+
+    if (current_style == SPECTRUM_STYLE_VERTICAL) {
+        if (!strip_fits) {
+            if (gradient_strip) SDL_FreeSurface(gradient_strip);
+            gradient_strip = SDL_CreateRGBSurfaceWithFormat(0, bar_w, bar_max_h, 32, SDL_PIXELFORMAT_RGBA8888);
+            // Copied as is over the bar area, not blended
+            if (gradient_strip) SDL_SetSurfaceBlendMode(gradient_strip, SDL_BLENDMODE_NONE);
+        }
+        if (gradient_strip) draw_gradient_strip(gradient_strip, theme[0], theme[1]);
+    }
+
+    lut_style = current_style;
+    lut_theme[0] = theme[0];
+    lut_theme[1] = theme[1];
+    lut_ready = true;
+    return true;
+}
+
+static inline uint32_t lut_color(int bar_index, float magnitude) {
+    if (current_style != SPECTRUM_STYLE_MAGNITUDE) return bar_colors[bar_index];
+    int level = (int)(magnitude * (COLOR_LEVELS - 1) + 0.5f);
+    if (level < 0) level = 0;
+    if (level >= COLOR_LEVELS) level = COLOR_LEVELS - 1;
+    return level_colors[level];
 }
 
 void Spectrum_renderGPU(void) {
-    if (!position_set || !spectrum_visible) return;
+    PROFILE_SCOPE("Spectrum_renderGPU");
+    if (!position_set || !spectrum_visible || spec_w <= 0 || spec_h <= 0) return;
 
     Spectrum_update();
     if (!spectrum_data.valid) return;
 
-    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0,
-        spec_w, spec_h, 32, SDL_PIXELFORMAT_RGBA8888);
-    if (!surface) return;
-
-    SDL_FillRect(surface, NULL, 0);
+    if (!spec_surface) {
+        spec_surface = SDL_CreateRGBSurfaceWithFormat(0, spec_w, spec_h, 32, SDL_PIXELFORMAT_RGBA8888);
+        if (!spec_surface) return;
+        surface_stale = true;
+    }
 
     int total_bars = SPECTRUM_BARS;
     float bar_width_f = (float)spec_w / total_bars;
     int bar_gap = 1;
     int bar_draw_w = (int)bar_width_f - bar_gap;
     if (bar_draw_w < 1) bar_draw_w = 1;
+    int bar_max_h = (int)(spec_h * 0.9f);
+    if (bar_max_h < 2) bar_max_h = 2;
+
+    if (update_luts(bar_draw_w, bar_max_h) || current_style != drawn_style) surface_stale = true;
+    if (surface_stale) SDL_FillRect(spec_surface, NULL, 0);
 
+    bool changed = surface_stale;
     for (int i = 0; i < total_bars; i++) {
         float magnitude = spectrum_data.bars[i];
         int bar_h = (int)(magnitude * spec_h * 0.9f);
         if (bar_h < 2) bar_h = 2;
 
+        uint32_t color = lut_color(i, magnitude);
+
+        int peak_y = -1;
+        if (spectrum_data.peaks[i] > magnitude + 0.02f) {
+            peak_y = spec_h - (int)(spectrum_data.peaks[i] * spec_h * 0.9f);
+        }
+
+        if (!surface_stale && bar_h == drawn_h[i] && peak_y == drawn_peak_y[i] && color == drawn_color[i]) {
+            continue;
+        }
+        drawn_h[i] = bar_h;
+        drawn_peak_y[i] = peak_y;
+        drawn_color[i] = color;
+        changed = true;
+
         int bar_x_pos = (int)(i * bar_width_f);
         int bar_y_pos = spec_h - bar_h;
+        if (!surface_stale) {
+            SDL_Rect column = {bar_x_pos, 0, bar_draw_w, spec_h};
+            SDL_FillRect(spec_surface, &column, 0);
+        }
 
-        if (current_style == SPECTRUM_STYLE_VERTICAL) {
-            // Vertical gradient - draw pixel by pixel
-            draw_vertical_gradient_bar(surface, bar_x_pos, bar_y_pos, bar_draw_w, bar_h, i);
+        SDL_Rect bar_rect = {bar_x_pos, bar_y_pos, bar_draw_w, bar_h};
+        if (current_style == SPECTRUM_STYLE_VERTICAL && gradient_strip) {
+            // The whole gradient, squeezed to the bar's height
+            SDL_BlitScaled(gradient_strip, NULL, spec_surface, &bar_rect);
         } else {
-            // Solid color styles
-            uint8_t r, g, b;
-            get_bar_color(i, magnitude, &r, &g, &b);
-            uint32_t color = SDL_MapRGBA(surface->format, r, g, b, 255);
-
-            SDL_Rect bar_rect = {bar_x_pos, bar_y_pos, bar_draw_w, bar_h};
-            SDL_FillRect(surface, &bar_rect, color);
+            SDL_FillRect(spec_surface, &bar_rect, color);
         }
 
         // Draw peak indicator
-        if (spectrum_data.peaks[i] > magnitude + 0.02f) {
-            int peak_y = spec_h - (int)(spectrum_data.peaks[i] * spec_h * 0.9f);
-            uint8_t r, g, b;
-            get_bar_color(i, spectrum_data.peaks[i], &r, &g, &b);
-            uint32_t peak_color = SDL_MapRGBA(surface->format, r, g, b, 255);
+        if (peak_y >= 0) {
             SDL_Rect peak_rect = {bar_x_pos, peak_y, bar_draw_w, 2};
-            SDL_FillRect(surface, &peak_rect, peak_color);
+            SDL_FillRect(spec_surface, &peak_rect, lut_color(i, spectrum_data.peaks[i]));
         }
     }
+    surface_stale = false;
+    drawn_style = current_style;
+
+    // Nothing moved (silence, or bars at rest): the layer already shows it
+    if (!changed && !layer_stale) return;
+    layer_stale = false;
 
     PLAT_clearLayers(LAYER_SPECTRUM);
-    PLAT_drawOnLayer(surface, spec_x, spec_y, spec_w, spec_h, 1.0f, false, LAYER_SPECTRUM);
-    SDL_FreeSurface(surface);
+    PLAT_drawOnLayer(spec_surface, spec_x, spec_y, spec_w, spec_h, 1.0f, false, LAYER_SPECTRUM);
 
     PLAT_GPU_Flip();
 }
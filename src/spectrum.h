@@ -2,8 +2,9 @@
 #define __SPECTRUM_H__
 
 #include <stdbool.h>
+#include <stdint.h>
 
-#define SPECTRUM_FFT_SIZE 512
+#define SPECTRUM_FFT_SIZE 1024   // 47 Hz bins at 48 kHz
 #define SPECTRUM_BARS 64
 #define LAYER_SPECTRUM 5
 
@@ -27,6 +28,16 @@ void Spectrum_quit(void);
 void Spectrum_update(void);
 const SpectrumData* Spectrum_getData(void);
 
+// Analysis tap on the output, called from the audio callback with the stereo
+// frames just produced (player and radio alike). Every 512 frames the latest
+// SPECTRUM_FFT_SIZE window is analyzed and published lock-free for Spectrum_update.
+// Does nothing unless the spectrum was rendered within the last half second.
+void Spectrum_feed(const int16_t* samples, int frames, int sample_rate);
+void Spectrum_feedS32(const int32_t* samples, int frames, int sample_rate);  // Bit-perfect output
+
+// Time from feeding audio to hearing it; bars are shown when their audio is heard
+void Spectrum_setLatency(int latency_ms);
+
 void Spectrum_setPosition(int x, int y, int w, int h);
 void Spectrum_renderGPU(void);
 bool Spectrum_needsRefresh(void);
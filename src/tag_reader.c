@@ -0,0 +1,682 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "tag_reader.h"
+
+#define ID3V1_SIZE 128
+#define APE_FOOTER_SIZE 32
+#define ID3_TEXT_READ_MAX (3 + TAG_VALUE_MAX * 2)  // A UTF-16 value's worth, with encoding and BOM
+#define ID3_PICTURE_HEADER_MAX 512                  // Up to the image: MIME type, picture type, description
+#define VORBIS_ENTRY_MAX (64 + TAG_VALUE_MAX)       // "KEY=" and a value's worth, the rest skipped
+#define GAIN_TEXT_MAX 32
+
+// Text encodings (the first four are ID3v2's encoding byte)
+typedef enum {
+    TEXT_LATIN1,
+    TEXT_UTF16,         // Byte order mark first (little-endian without one)
+    TEXT_UTF16BE,
+    TEXT_UTF8
+} TextEncoding;
+
+// The file and the window read from it
+typedef struct {
+    FILE* f;
+    long size;
+    long start;         // File offset of buf[0]
+    int len;            // Bytes in buf
+    uint8_t buf[TAG_WINDOW_SIZE];
+} TagFile;
+
+static uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+static uint32_t syncsafe32(const uint8_t* p) {
+    return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) |
+           ((uint32_t)(p[2] & 0x7F) << 7) | (p[3] & 0x7F);
+}
+
+// len bytes at offset, moving the window there unless they are in it already
+// The pointer is good until the next call. NULL if they run past the end.
+static const uint8_t* window(TagFile* tf, long offset, int len) {
+    if (len < 0 || len > TAG_WINDOW_SIZE || offset < 0 || offset + len > tf->size) return NULL;
+    if (offset < tf->start || offset + len > tf->start + tf->len) {
+        if (fseek(tf->f, offset, SEEK_SET) != 0) return NULL;
+        tf->start = offset;
+        tf->len = (int)fread(tf->buf, 1, TAG_WINDOW_SIZE, tf->f);
+        if (tf->len < len) return NULL;
+    }
+    return tf->buf + (offset - tf->start);
+}
+
+// ============ VALUES ============
+
+// Append code point cp to out as UTF-8, if it fits before the terminator
+static bool put_utf8(char* out, int* n, int size, uint32_t cp) {
+    uint8_t bytes[4];
+    int len;
+    if (cp < 0x80) {
+        bytes[0] = (uint8_t)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        bytes[0] = 0xC0 | (cp >> 6);
+        bytes[1] = 0x80 | (cp & 0x3F);
+        len = 2;
+    } else if (cp < 0x10000) {
+        bytes[0] = 0xE0 | (cp >> 12);
+        bytes[1] = 0x80 | ((cp >> 6) & 0x3F);
+        bytes[2] = 0x80 | (cp & 0x3F);
+        len = 3;
+    } else {
+        bytes[0] = 0xF0 | (cp >> 18);
+        bytes[1] = 0x80 | ((cp >> 12) & 0x3F);
+        bytes[2] = 0x80 | ((cp >> 6) & 0x3F);
+        bytes[3] = 0x80 | (cp & 0x3F);
+        len = 4;
+    }
+    if (*n + len >= size) return false;
+    memcpy(out + *n, bytes, len);
+    *n += len;
+    return true;
+}
+
+// Decode text up to its first terminator into out (size bytes, terminated),
+// cut at a character boundary. Returns the length, trailing spaces trimmed.
+static int decode_text(const uint8_t* text, size_t len, TextEncoding encoding, char* out, int size) {
+    int n = 0;
+    if (encoding == TEXT_UTF16 || encoding == TEXT_UTF16BE) {
+        bool big_endian = encoding == TEXT_UTF16BE;
+        if (encoding == TEXT_UTF16 && len >= 2 && ((text[0] == 0xFF && text[1] == 0xFE) ||
+                                                   (text[0] == 0xFE && text[1] == 0xFF))) {
+            big_endian = text[0] == 0xFE;
+            text += 2;
+            len -= 2;
+        }
+        for (size_t i = 0; i + 1 < len; i += 2) {
+            uint32_t unit = big_endian ? (text[i] << 8) | text[i + 1] : text[i] | (text[i + 1] << 8);
+            if (unit == 0) break;
+            if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < len) {
+                uint32_t low = big_endian ? (text[i + 2] << 8) | text[i + 3] : text[i + 2] | (text[i + 3] << 8);
+                if (low < 0xDC00 || low >= 0xE000) continue;    // Unpaired: dropped
+                unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+                i += 2;
+            } else if (unit >= 0xD800 && unit < 0xE000) {
+                continue;
+            }
+            if (!put_utf8(out, &n, size, unit)) break;
+        }
+    } else if (encoding == TEXT_LATIN1) {
+        for (size_t i = 0; i < len && text[i]; i++) {
+            if (!put_utf8(out, &n, size, text[i])) break;
+        }
+    } else {
+        const uint8_t* end = memchr(text, 0, len);
+        if (end) len = end - text;
+        n = len < (size_t)size - 1 ? (int)len : size - 1;
+        memcpy(out, text, n);
+        // Cut short: not in the middle of a character
+        if ((size_t)n < len) {
+            int lead = n;
+            while (lead > 0 && ((uint8_t)out[lead - 1] & 0xC0) == 0x80) lead--;
+            if (lead > 0 && ((uint8_t)out[lead - 1] & 0x80)) n = lead - 1;
+        }
+    }
+    while (n > 0 && out[n - 1] == ' ') n--;
+    out[n] = '\0';
+    return n;
+}
+
+// Give field its value, unless an earlier tag did (empty values don't count)
+static void set_field(TagSet* tags, TagField field, const uint8_t* text, size_t len, TextEncoding encoding) {
+    if (tags->field[field] >= 0) return;
+    int room = TAG_ARENA_SIZE - tags->arena_used;
+    if (room > TAG_VALUE_MAX + 1) room = TAG_VALUE_MAX + 1;
+    if (room < 2) return;
+    int n = decode_text(text, len, encoding, tags->arena + tags->arena_used, room);
+    if (n == 0) return;
+    tags->field[field] = (int16_t)tags->arena_used;
+    tags->arena_used += n + 1;
+}
+
+// Field named key (Vorbis, APE and MP4 freeform names), -1 if none
+static int field_for_key(const char* key, size_t key_len) {
+    static const char* names[TAG_FIELD_COUNT] = {"TITLE", "ARTIST", "ALBUM"};
+    for (int i = 0; i < TAG_FIELD_COUNT; i++) {
+        if (strlen(names[i]) == key_len && strncasecmp(key, names[i], key_len) == 0) return i;
+    }
+    return -1;
+}
+
+// Take a REPLAYGAIN_TRACK_GAIN / REPLAYGAIN_ALBUM_GAIN value ("-6.48 dB")
+static void set_gain(TagSet* tags, const char* key, size_t key_len, const char* value) {
+    bool track;
+    if (key_len == 21 && strncasecmp(key, "REPLAYGAIN_TRACK_GAIN", 21) == 0) {
+        track = true;
+    } else if (key_len == 21 && strncasecmp(key, "REPLAYGAIN_ALBUM_GAIN", 21) == 0) {
+        track = false;
+    } else {
+        return;
+    }
+    if (track ? tags->has_track_gain : tags->has_album_gain) return;
+
+    char* end;
+    float gain = strtof(value, &end);
+    if (end == value || gain < -60.0f || gain > 60.0f) return;
+    if (track) {
+        tags->track_gain_db = gain;
+        tags->has_track_gain = true;
+    } else {
+        tags->album_gain_db = gain;
+        tags->has_album_gain = true;
+    }
+}
+
+// A "KEY=value" style pair of UTF-8 text (Vorbis, APE, MP4 freeform)
+static void set_pair(TagSet* tags, const char* key, size_t key_len, const uint8_t* value, size_t value_len) {
+    int field = field_for_key(key, key_len);
+    if (field >= 0) {
+        set_field(tags, (TagField)field, value, value_len, TEXT_UTF8);
+    } else if (key_len > 11 && strncasecmp(key, "REPLAYGAIN_", 11) == 0) {
+        char text[GAIN_TEXT_MAX];
+        decode_text(value, value_len, TEXT_UTF8, text, sizeof(text));
+        set_gain(tags, key, key_len, text);
+    }
+}
+
+// Take a cover: the front one (type 3) over others, else the first
+static void set_art(TagSet* tags, long offset, uint32_t size, uint8_t type) {
+    if (size == 0 || (tags->art_offset != 0 && (tags->art_type == 3 || type != 3))) return;
+    tags->art_offset = offset;
+    tags->art_size = size;
+    tags->art_type = type;
+}
+
+// ============ ID3 ============
+
+// An ID3v2 TXXX frame (description, terminator, value): only ReplayGain is used
+static void id3v2_txxx(TagSet* tags, const uint8_t* data, size_t len) {
+    TextEncoding encoding = (TextEncoding)data[0];
+    const uint8_t* text = data + 1;
+    len--;
+
+    // UTF-16 terminators are two zero bytes on a character boundary
+    size_t step = (encoding == TEXT_UTF16 || encoding == TEXT_UTF16BE) ? 2 : 1;
+    size_t split = 0;
+    while (split + step <= len && (text[split] != 0 || (step == 2 && text[split + 1] != 0))) split += step;
+    if (split + step > len) return;
+
+    char key[GAIN_TEXT_MAX], value[GAIN_TEXT_MAX];
+    int key_len = decode_text(text, split, encoding, key, sizeof(key));
+    decode_text(text + split + step, len - split - step, encoding, value, sizeof(value));
+    set_gain(tags, key, key_len, value);
+}
+
+// Locate the image of an ID3v2 APIC (or v2.2 PIC) frame at offset
+static void id3v2_picture(TagFile* tf, TagSet* tags, long offset, uint32_t size, bool v22) {
+    int len = size < ID3_PICTURE_HEADER_MAX ? (int)size : ID3_PICTURE_HEADER_MAX;
+    const uint8_t* data = window(tf, offset, len);
+    if (!data) return;
+    uint8_t encoding = data[0];
+    int pos = 1;
+
+    // Image format: a three-letter one for v2.2, else a terminated MIME type
+    if (v22) {
+        pos += 3;
+    } else {
+        while (pos < len && data[pos]) pos++;
+        pos++;
+    }
+    if (pos >= len) return;
+    uint8_t type = data[pos++];
+
+    // Description, terminated for its encoding
+    if (encoding == TEXT_UTF16 || encoding == TEXT_UTF16BE) {
+        while (pos + 1 < len && (data[pos] || data[pos + 1])) pos += 2;
+        pos += 2;
+    } else {
+        while (pos < len && data[pos]) pos++;
+        pos++;
+    }
+    if (pos > len || (uint32_t)pos >= size) return;
+    set_art(tags, offset + pos, size - pos, type);
+}
+
+// Apply the ID3v2 frame id of size bytes at offset
+static void id3v2_frame(TagFile* tf, TagSet* tags, const char* id, long offset, uint32_t size, bool v22) {
+    static const char* text_ids[TAG_FIELD_COUNT][2] = {{"TIT2", "TT2"}, {"TPE1", "TP1"}, {"TALB", "TAL"}};
+
+    if (strcmp(id, v22 ? "PIC" : "APIC") == 0) {
+        id3v2_picture(tf, tags, offset, size, v22);
+        return;
+    }
+    if (id[0] != 'T' || size < 2) return;
+
+    int len = size < ID3_TEXT_READ_MAX ? (int)size : ID3_TEXT_READ_MAX;
+    const uint8_t* data = window(tf, offset, len);
+    if (!data || data[0] > TEXT_UTF8) return;
+    if (strcmp(id, v22 ? "TXX" : "TXXX") == 0) {
+        id3v2_txxx(tags, data, len);
+        return;
+    }
+    for (int i = 0; i < TAG_FIELD_COUNT; i++) {
+        if (strcmp(id, text_ids[i][v22]) == 0) set_field(tags, (TagField)i, data + 1, len - 1, (TextEncoding)data[0]);
+    }
+}
+
+// An ID3v2 tag at the start of the file, frame by frame: only the headers and
+// the frames used are read (most of a tag is usually its cover)
+// Returns where the audio starts (0 without a tag).
+static long read_id3v2(TagFile* tf, TagSet* tags) {
+    const uint8_t* header = window(tf, 0, 10);
+    if (!header || memcmp(header, "ID3", 3) != 0) return 0;
+    int version = header[3];
+    uint8_t flags = header[5];
+    long tag_end = 10 + (long)syncsafe32(header + 6);
+    long audio = tag_end + ((version == 4 && (flags & 0x10)) ? 10 : 0);    // v2.4 footer
+    if (version < 2 || version > 4 || (version == 2 && (flags & 0x40))) return audio;  // v2.2: compressed
+
+    bool v22 = version == 2;
+    int frame_header = v22 ? 6 : 10;
+    long pos = 10;
+    if (!v22 && (flags & 0x40)) {
+        // Extended header (v2.3's size leaves out its own 4 bytes, v2.4's doesn't)
+        const uint8_t* ext = window(tf, pos, 4);
+        if (!ext) return audio;
+        pos += version == 4 ? (long)syncsafe32(ext) : (long)be32(ext) + 4;
+    }
+
+    while (pos + frame_header <= tag_end) {
+        const uint8_t* h = window(tf, pos, frame_header);
+        if (!h || h[0] == 0) break;     // Padding
+        char id[5] = {0};
+        memcpy(id, h, v22 ? 3 : 4);
+        uint32_t size = v22 ? ((uint32_t)h[3] << 16) | (h[4] << 8) | h[5]
+                            : version == 4 ? syncsafe32(h + 4) : be32(h + 4);
+        uint8_t format = v22 ? 0 : h[9];
+        pos += frame_header;
+        if (size == 0 || pos + (long)size > tag_end) break;
+
+        // v2.4 frames may be compressed or encrypted (skipped), or carry their length first
+        long data = pos;
+        uint32_t data_size = size;
+        if (version == 4 && (format & 0x01) && size > 4) {
+            data += 4;
+            data_size -= 4;
+        }
+        if (!(version == 4 && (format & 0x0C)) && !(version == 3 && (format & 0xC0))) {
+            id3v2_frame(tf, tags, id, data, data_size, v22);
+        }
+        pos += size;
+    }
+    return audio;
+}
+
+// ID3v1 at the end of the file: fixed Latin-1 fields
+static bool read_id3v1(TagFile* tf, TagSet* tags) {
+    const uint8_t* tag = window(tf, tf->size - ID3V1_SIZE, ID3V1_SIZE);
+    if (!tag || memcmp(tag, "TAG", 3) != 0) return false;
+    // TAG(3) + Title(30) + Artist(30) + Album(30) + Year(4) + Comment(30) + Genre(1)
+    for (int i = 0; i < TAG_FIELD_COUNT; i++) set_field(tags, (TagField)i, tag + 3 + i * 30, 30, TEXT_LATIN1);
+    return true;
+}
+
+// ============ APE ============
+
+// An APEv1/v2 tag ending at end (its footer last)
+static void read_ape(TagFile* tf, TagSet* tags, long end) {
+    const uint8_t* footer = window(tf, end - APE_FOOTER_SIZE, APE_FOOTER_SIZE);
+    if (!footer || memcmp(footer, "APETAGEX", 8) != 0) return;
+    uint32_t tag_size = le32(footer + 12);     // Items and footer
+    uint32_t count = le32(footer + 16);
+    if (tag_size < APE_FOOTER_SIZE || (long)tag_size > end) return;
+
+    long pos = end - (long)tag_size;
+    long items_end = end - APE_FOOTER_SIZE;
+    for (uint32_t i = 0; i < count && pos + 10 <= items_end; i++) {
+        // Value size, flags, key (terminated), value
+        int len = items_end - pos < 8 + 256 ? (int)(items_end - pos) : 8 + 256;
+        const uint8_t* item = window(tf, pos, len);
+        if (!item) return;
+        uint32_t value_size = le32(item);
+        uint32_t item_flags = le32(item + 4);
+        const uint8_t* key_end = memchr(item + 8, 0, len - 8);
+        if (!key_end) return;
+        char key[256];
+        size_t key_len = key_end - (item + 8);
+        memcpy(key, item + 8, key_len);
+        key[key_len] = '\0';
+        long value = pos + 8 + (long)key_len + 1;
+        if (value + (long)value_size > items_end) return;
+        pos = value + value_size;
+
+        if (((item_flags >> 1) & 3) == 1) {
+            // Binary: a cover is its file name, terminated, then the image
+            if (strncasecmp(key, "Cover Art (", 11) != 0) continue;
+            int head = value_size < 256 ? (int)value_size : 256;
+            const uint8_t* data = window(tf, value, head);
+            const uint8_t* name_end = data ? memchr(data, 0, head) : NULL;
+            if (!name_end) continue;
+            uint32_t skip = (uint32_t)(name_end - data) + 1;
+            set_art(tags, value + skip, value_size - skip, strcasecmp(key, "Cover Art (Front)") == 0 ? 3 : 0);
+        } else if (((item_flags >> 1) & 3) == 0) {
+            int take = value_size < TAG_VALUE_MAX ? (int)value_size : TAG_VALUE_MAX;
+            const uint8_t* text = window(tf, value, take);
+            if (text) set_pair(tags, key, key_len, text, take);
+        }
+    }
+}
+
+// ============ VORBIS COMMENTS ============
+
+// Sequential reader over a byte range, or over one packet of an Ogg stream
+// (its bytes are split in segments over pages, page headers in between)
+typedef struct {
+    TagFile* tf;
+    long pos;               // File offset of the next byte
+    long left;              // Bytes left before the next segment run
+    bool last;              // The packet (or range) ends with this run
+    bool ogg;
+    long page_end;
+    int seg;
+    int seg_count;
+    uint8_t lacing[255];
+} Cursor;
+
+static void cursor_range(Cursor* c, TagFile* tf, long pos, long len) {
+    memset(c, 0, sizeof(*c));
+    c->tf = tf;
+    c->pos = pos;
+    c->left = len;
+    c->last = true;
+}
+
+// Move to the Ogg page at pos
+static bool ogg_page(Cursor* c, long pos) {
+    const uint8_t* header = window(c->tf, pos, 27);
+    if (!header || memcmp(header, "OggS", 4) != 0) return false;
+    int seg_count = header[26];
+    const uint8_t* lacing = window(c->tf, pos + 27, seg_count);
+    if (!lacing) return false;
+    memcpy(c->lacing, lacing, seg_count);
+    c->seg_count = seg_count;
+    c->seg = 0;
+    c->pos = pos + 27 + seg_count;
+    c->page_end = c->pos;
+    for (int i = 0; i < seg_count; i++) c->page_end += lacing[i];
+    return true;
+}
+
+// Take the packet's next run of segments (to the one ending it, or the page's end)
+static bool ogg_run(Cursor* c) {
+    while (c->seg >= c->seg_count) {
+        if (!ogg_page(c, c->page_end)) return false;
+    }
+    c->left = 0;
+    c->last = false;
+    while (c->seg < c->seg_count) {
+        int len = c->lacing[c->seg++];
+        c->left += len;
+        if (len < 255) {
+            c->last = true;
+            break;
+        }
+    }
+    return true;
+}
+
+// Copy the next n bytes to dst, or skip them (dst NULL)
+static bool cursor_take(Cursor* c, uint8_t* dst, size_t n) {
+    while (n > 0) {
+        if (c->left == 0) {
+            if (c->last || !c->ogg || !ogg_run(c)) return false;
+            continue;
+        }
+        size_t part = n < (size_t)c->left ? n : (size_t)c->left;
+        if (dst) {
+            if (part > TAG_WINDOW_SIZE) part = TAG_WINDOW_SIZE;
+            const uint8_t* src = window(c->tf, c->pos, (int)part);
+            if (!src) return false;
+            memcpy(dst, src, part);
+            dst += part;
+        }
+        c->pos += part;
+        c->left -= part;
+        n -= part;
+    }
+    return true;
+}
+
+// On to the start of the next Ogg packet
+static bool ogg_next_packet(Cursor* c) {
+    while (c->left > 0 || !c->last) {
+        if (c->left > 0) {
+            c->pos += c->left;
+            c->left = 0;
+        } else if (!ogg_run(c)) {
+            return false;
+        }
+    }
+    return ogg_run(c);
+}
+
+// Vendor string, comment count, then length-prefixed "KEY=value" entries
+// (lengths little-endian). Only the start of an entry is read.
+static void read_vorbis_comments(Cursor* c, TagSet* tags) {
+    uint8_t word[4];
+    if (!cursor_take(c, word, 4) || !cursor_take(c, NULL, le32(word)) || !cursor_take(c, word, 4)) return;
+    uint32_t count = le32(word);
+    for (uint32_t i = 0; i < count; i++) {
+        if (!cursor_take(c, word, 4)) return;
+        uint32_t len = le32(word);
+        uint8_t entry[VORBIS_ENTRY_MAX];
+        size_t take = len < sizeof(entry) ? len : sizeof(entry);
+        if (!cursor_take(c, entry, take) || !cursor_take(c, NULL, len - take)) return;
+        const uint8_t* eq = memchr(entry, '=', take);
+        if (eq) set_pair(tags, (const char*)entry, eq - entry, eq + 1, take - (eq + 1 - entry));
+    }
+}
+
+// FLAC metadata blocks from offset (past "fLaC"): comments and pictures
+static void read_flac(TagFile* tf, TagSet* tags, long pos) {
+    bool last = false;
+    while (!last) {
+        // Last flag and type (1 byte), size (24-bit big-endian)
+        const uint8_t* header = window(tf, pos, 4);
+        if (!header) return;
+        last = (header[0] & 0x80) != 0;
+        uint8_t type = header[0] & 0x7F;
+        uint32_t size = ((uint32_t)header[1] << 16) | ((uint32_t)header[2] << 8) | header[3];
+        pos += 4;
+
+        if (type == 4) {            // VORBIS_COMMENT
+            Cursor c;
+            cursor_range(&c, tf, pos, size);
+            read_vorbis_comments(&c, tags);
+        } else if (type == 6) {     // PICTURE
+            // Type, MIME type and description (length-prefixed), width, height,
+            // depth and colors, then the image's length and the image (big-endian)
+            const uint8_t* field = window(tf, pos, 8);
+            if (!field) return;
+            uint8_t pic_type = (uint8_t)be32(field);
+            long at = pos + 8 + be32(field + 4);
+            field = window(tf, at, 4);
+            if (field) {
+                at += 4 + be32(field) + 16;
+                field = window(tf, at, 4);
+            }
+            if (field && at + 4 + (long)be32(field) <= pos + (long)size) {
+                set_art(tags, at + 4, be32(field), pic_type);
+            }
+        }
+        pos += size;
+    }
+}
+
+// An Ogg stream's comment header: the second packet, "\x03vorbis" or "OpusTags"
+static void read_ogg(TagFile* tf, TagSet* tags, long pos) {
+    Cursor c;
+    memset(&c, 0, sizeof(c));
+    c.tf = tf;
+    c.ogg = true;
+    if (!ogg_page(&c, pos) || !ogg_run(&c) || !ogg_next_packet(&c)) return;
+
+    uint8_t magic[8];
+    if (!cursor_take(&c, magic, 7)) return;
+    if (memcmp(magic, "\x03vorbis", 7) == 0 ||
+        (memcmp(magic, "OpusTag", 7) == 0 && cursor_take(&c, magic + 7, 1) && magic[7] == 's')) {
+        read_vorbis_comments(&c, tags);
+    }
+}
+
+// ============ MP4 ============
+
+// The first box of type among the boxes in [start, end)
+// Returns its payload's offset and sets *box_end, or -1 if there is none.
+static long mp4_find(TagFile* tf, long start, long end, const char* type, long* box_end) {
+    long pos = start;
+    while (pos + 8 <= end) {
+        const uint8_t* h = window(tf, pos, 8);
+        if (!h) return -1;
+        uint64_t size = be32(h);
+        bool match = memcmp(h + 4, type, 4) == 0;
+        long header = 8;
+        if (size == 1) {
+            const uint8_t* large = window(tf, pos + 8, 8);
+            if (!large) return -1;
+            size = ((uint64_t)be32(large) << 32) | be32(large + 4);
+            header = 16;
+        } else if (size == 0) {
+            size = end - pos;       // To the end
+        }
+        if (size < (uint64_t)header || size > (uint64_t)(end - pos)) return -1;
+        if (match) {
+            *box_end = pos + (long)size;
+            return pos + header;
+        }
+        pos += (long)size;
+    }
+    return -1;
+}
+
+// An ilst item's value: the payload of its data box, past type and locale
+static long mp4_value(TagFile* tf, long item, long item_end, uint32_t* size) {
+    long data_end;
+    long data = mp4_find(tf, item, item_end, "data", &data_end);
+    if (data < 0 || data + 8 > data_end) return -1;
+    *size = (uint32_t)(data_end - data - 8);
+    return data + 8;
+}
+
+// A "----" item: mean, name (the key, past version and flags) and data
+static void mp4_freeform(TagFile* tf, TagSet* tags, long item, long item_end) {
+    long name_end;
+    long name = mp4_find(tf, item, item_end, "name", &name_end);
+    uint32_t value_size;
+    long value = mp4_value(tf, item, item_end, &value_size);
+    if (name < 0 || value < 0 || name_end - name < 5 || name_end - name > 4 + 64) return;
+
+    char key[64];
+    const uint8_t* text = window(tf, name + 4, (int)(name_end - name - 4));
+    if (!text) return;
+    size_t key_len = name_end - name - 4;
+    memcpy(key, text, key_len);
+    int take = value_size < TAG_VALUE_MAX ? (int)value_size : TAG_VALUE_MAX;
+    text = window(tf, value, take);
+    if (text) set_pair(tags, key, key_len, text, take);
+}
+
+// MP4 metadata: moov > udta > meta > ilst (meta straight under moov too)
+static void read_mp4(TagFile* tf, TagSet* tags) {
+    static const char* item_ids[TAG_FIELD_COUNT] = {"\xA9nam", "\xA9" "ART", "\xA9" "alb"};
+    long moov_end, udta_end, meta_end, ilst_end;
+    long moov = mp4_find(tf, 0, tf->size, "moov", &moov_end);
+    if (moov < 0) return;
+    long udta = mp4_find(tf, moov, moov_end, "udta", &udta_end);
+    long meta = udta >= 0 ? mp4_find(tf, udta, udta_end, "meta", &meta_end) : -1;
+    if (meta < 0) meta = mp4_find(tf, moov, moov_end, "meta", &meta_end);
+    if (meta < 0) return;
+
+    // A full box (version and flags first), except in some QuickTime files
+    const uint8_t* peek = window(tf, meta + 4, 4);
+    if (!peek || memcmp(peek, "hdlr", 4) != 0) meta += 4;
+    long ilst = mp4_find(tf, meta, meta_end, "ilst", &ilst_end);
+    if (ilst < 0) return;
+
+    long pos = ilst;
+    while (pos + 8 <= ilst_end) {
+        const uint8_t* h = window(tf, pos, 8);
+        if (!h) return;
+        long size = be32(h);
+        char id[4];
+        memcpy(id, h + 4, 4);
+        if (size < 8 || size > ilst_end - pos) return;
+        long item = pos + 8, item_end = pos + size;
+        pos = item_end;
+
+        if (memcmp(id, "----", 4) == 0) {
+            mp4_freeform(tf, tags, item, item_end);
+            continue;
+        }
+        uint32_t value_size;
+        long value = mp4_value(tf, item, item_end, &value_size);
+        if (value < 0) continue;
+        if (memcmp(id, "covr", 4) == 0) {
+            set_art(tags, value, value_size, 3);
+            continue;
+        }
+        for (int i = 0; i < TAG_FIELD_COUNT; i++) {
+            if (memcmp(id, item_ids[i], 4) != 0) continue;
+            int take = value_size < TAG_VALUE_MAX ? (int)value_size : TAG_VALUE_MAX;
+            const uint8_t* text = window(tf, value, take);
+            if (text) set_field(tags, (TagField)i, text, take, TEXT_UTF8);
+        }
+    }
+}
+
+// ============ API ============
+
+int TagReader_read(const char* filepath, TagSet* tags) {
+    memset(tags, 0, sizeof(*tags));
+    for (int i = 0; i < TAG_FIELD_COUNT; i++) tags->field[i] = -1;
+
+    TagFile tf;
+    tf.f = fopen(filepath, "rb");
+    if (!tf.f) return -1;
+    tf.start = 0;
+    tf.len = 0;
+    tf.size = fseek(tf.f, 0, SEEK_END) == 0 ? ftell(tf.f) : -1;
+    if (tf.size <= 0) {
+        fclose(tf.f);
+        return 0;
+    }
+
+    // A leading ID3v2 (some FLACs carry one too), then the container's own
+    long audio = read_id3v2(&tf, tags);
+    const uint8_t* magic = window(&tf, audio, 8);
+    if (magic && memcmp(magic, "fLaC", 4) == 0) {
+        read_flac(&tf, tags, audio + 4);
+    } else if (magic && memcmp(magic, "OggS", 4) == 0) {
+        read_ogg(&tf, tags, audio);
+    } else if (magic && audio == 0 && memcmp(magic + 4, "ftyp", 4) == 0) {
+        read_mp4(&tf, tags);
+    }
+
+    // Trailing tags: APE sits in front of an ID3v1
+    bool id3v1 = tf.size >= ID3V1_SIZE && (magic = window(&tf, tf.size - ID3V1_SIZE, 3)) != NULL &&
+                 memcmp(magic, "TAG", 3) == 0;
+    read_ape(&tf, tags, tf.size - (id3v1 ? ID3V1_SIZE : 0));
+    if (id3v1) read_id3v1(&tf, tags);
+
+    fclose(tf.f);
+    return 0;
+}
+
+const char* TagReader_get(const TagSet* tags, TagField field) {
+    return tags->field[field] >= 0 ? tags->arena + tags->field[field] : NULL;
+}
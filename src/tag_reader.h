@@ -0,0 +1,49 @@
+#ifndef __TAG_READER_H__
+#define __TAG_READER_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tags of an audio file, whatever holds them
+// One reader for ID3v2 (2.2 to 2.4) and ID3v1, APE, Vorbis comments (FLAC, and
+// Ogg Vorbis or Opus) and MP4 ilst atoms, found by the file's bytes rather than
+// its name. The file is read through a window of TAG_WINDOW_SIZE bytes moved
+// along it, and values are decoded from there to UTF-8 (Latin-1 and UTF-16,
+// surrogate pairs included) straight into the TagSet's arena: nothing is
+// allocated. A file carrying several tags gets each field from the first that
+// has it: a leading ID3v2, the container's own, APE, then ID3v1. Embedded
+// covers are located, not read. Any thread.
+
+#define TAG_WINDOW_SIZE 2048
+#define TAG_VALUE_MAX 255           // Bytes of UTF-8 kept of a value
+
+typedef enum {
+    TAG_TITLE,
+    TAG_ARTIST,
+    TAG_ALBUM,
+    TAG_FIELD_COUNT
+} TagField;
+
+#define TAG_ARENA_SIZE (TAG_FIELD_COUNT * (TAG_VALUE_MAX + 1))
+
+typedef struct {
+    int16_t field[TAG_FIELD_COUNT];     // Arena offset of each value, -1 = none
+    int arena_used;
+    char arena[TAG_ARENA_SIZE];
+    float track_gain_db;                // ReplayGain, valid with has_track_gain
+    float album_gain_db;                // Valid with has_album_gain
+    bool has_track_gain;
+    bool has_album_gain;
+    long art_offset;                    // Embedded cover image in the file (0 = none)
+    uint32_t art_size;
+    uint8_t art_type;                   // Picture type (3 = front cover, preferred)
+} TagSet;
+
+// Read the tags of filepath (none found leaves tags empty)
+// Returns 0, or -1 if the file can't be opened.
+int TagReader_read(const char* filepath, TagSet* tags);
+
+// Value of field, NULL if the file has none
+const char* TagReader_get(const TagSet* tags, TagField field);
+
+#endif
@@ -0,0 +1,325 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "text_cache.h"
+
+#define TEXT_CACHE_BUCKETS 1024             // Power of two
+#define ELLIPSIS "..."
+
+typedef enum {
+    TEXT_WIDTH,
+    TEXT_TRUNCATE,
+    TEXT_SURFACE,
+    TEXT_PREFIX
+} TextKind;
+
+typedef struct {
+    uint64_t key;
+    TTF_Font* font;
+    char* text;
+    uint32_t color;             // RGBA (TEXT_SURFACE)
+    int max_width;              // TEXT_TRUNCATE
+    int padding;
+    int width;                  // Measured or truncated width
+    char* truncated;            // TEXT_TRUNCATE
+    SDL_Surface* surface;       // TEXT_SURFACE
+    int* prefix;                // TEXT_PREFIX: widths of the first i chars, then their byte offsets
+    int chars;
+    int bytes;
+    uint32_t last_used;
+    int16_t next;               // Hash chain (-1 = end)
+    uint8_t kind;               // TextKind
+    bool used;
+} TextEntry;
+
+static TextEntry entries[TEXT_CACHE_ENTRIES];
+static int16_t buckets[TEXT_CACHE_BUCKETS];
+static bool buckets_ready = false;
+static int cache_bytes = 0;
+static uint32_t cache_clock = 0;
+static SDL_Surface* uncached = NULL;     // Rendered but not cached, freed on the next render
+
+static uint32_t pack_color(SDL_Color c) {
+    return ((uint32_t)c.r << 24) | ((uint32_t)c.g << 16) | ((uint32_t)c.b << 8) | c.a;
+}
+
+// FNV-1a over the text, then the rest of the key
+static uint64_t text_key(TextKind kind, TTF_Font* font, const char* text, uint32_t color, int max_width, int padding) {
+    uint64_t hash = 1469598103934665603ULL;
+    while (*text) {
+        hash ^= (uint8_t)*text++;
+        hash *= 1099511628211ULL;
+    }
+    uint64_t fields[5] = {kind, (uint64_t)(uintptr_t)font, color, (uint32_t)max_width, (uint32_t)padding};
+    for (int i = 0; i < 5; i++) {
+        hash ^= fields[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void init_buckets(void) {
+    for (int i = 0; i < TEXT_CACHE_BUCKETS; i++) buckets[i] = -1;
+    buckets_ready = true;
+}
+
+static TextEntry* cache_find(uint64_t key, TextKind kind, TTF_Font* font, const char* text,
+                             uint32_t color, int max_width, int padding) {
+    if (!buckets_ready) init_buckets();
+    for (int i = buckets[key & (TEXT_CACHE_BUCKETS - 1)]; i >= 0; i = entries[i].next) {
+        TextEntry* e = &entries[i];
+        if (e->key != key || e->kind != kind || e->font != font || e->color != color ||
+            e->max_width != max_width || e->padding != padding || strcmp(e->text, text) != 0) continue;
+        e->last_used = ++cache_clock;
+        return e;
+    }
+    return NULL;
+}
+
+static void cache_drop(TextEntry* e) {
+    int index = (int)(e - entries);
+    int16_t* link = &buckets[e->key & (TEXT_CACHE_BUCKETS - 1)];
+    while (*link >= 0 && *link != index) link = &entries[*link].next;
+    if (*link == index) *link = e->next;
+
+    cache_bytes -= e->bytes;
+    free(e->text);
+    free(e->truncated);
+    free(e->prefix);
+    if (e->surface) SDL_FreeSurface(e->surface);
+    memset(e, 0, sizeof(*e));
+}
+
+static TextEntry* least_recent(void) {
+    TextEntry* oldest = NULL;
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+        if (entries[i].used && (!oldest || entries[i].last_used < oldest->last_used)) oldest = &entries[i];
+    }
+    return oldest;
+}
+
+// Add an entry of bytes (on top of the key), evicting to make room.
+// Returns NULL if the text can't be copied.
+static TextEntry* cache_insert(uint64_t key, TextKind kind, TTF_Font* font, const char* text,
+                               uint32_t color, int max_width, int padding, int bytes) {
+    char* copy = strdup(text);
+    if (!copy) return NULL;
+    bytes += (int)strlen(text) + 1 + (int)sizeof(TextEntry);
+
+    TextEntry* e = NULL;
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+        if (!entries[i].used) {
+            e = &entries[i];
+            break;
+        }
+    }
+    while (cache_bytes + bytes > TEXT_CACHE_BYTES || !e) {
+        TextEntry* oldest = least_recent();
+        if (!oldest) break;
+        cache_drop(oldest);
+        if (!e) e = oldest;
+    }
+    if (!e) {
+        free(copy);
+        return NULL;
+    }
+
+    e->key = key;
+    e->kind = kind;
+    e->font = font;
+    e->text = copy;
+    e->color = color;
+    e->max_width = max_width;
+    e->padding = padding;
+    e->bytes = bytes;
+    e->last_used = ++cache_clock;
+    e->used = true;
+    int16_t* bucket = &buckets[key & (TEXT_CACHE_BUCKETS - 1)];
+    e->next = *bucket;
+    *bucket = (int16_t)(e - entries);
+    cache_bytes += bytes;
+    return e;
+}
+
+int TextCache_width(TTF_Font* font, const char* text) {
+    uint64_t key = text_key(TEXT_WIDTH, font, text, 0, 0, 0);
+    TextEntry* e = cache_find(key, TEXT_WIDTH, font, text, 0, 0, 0);
+    if (e) return e->width;
+
+    int w = 0, h = 0;
+    TTF_SizeUTF8(font, text, &w, &h);
+    e = cache_insert(key, TEXT_WIDTH, font, text, 0, 0, 0, 0);
+    if (e) e->width = w;
+    return w;
+}
+
+// Length of the UTF-8 sequence starting with byte c (1 for stray continuation bytes)
+static int utf8_length(uint8_t c) {
+    if (c >= 0xF0) return 4;
+    if (c >= 0xE0) return 3;
+    if (c >= 0xC0) return 2;
+    return 1;
+}
+
+static uint32_t utf8_decode(const char* s, int len) {
+    const uint8_t* p = (const uint8_t*)s;
+    if (len == 1) return p[0];
+    uint32_t cp = p[0] & (0x7F >> len);
+    for (int i = 1; i < len; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0xFFFD;
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    return cp;
+}
+
+// Advance of the char at s (len bytes)
+static int char_advance(TTF_Font* font, const char* s, int len) {
+    uint32_t cp = utf8_decode(s, len);
+    int advance = 0;
+    if (cp <= 0xFFFF && TTF_GlyphMetrics(font, (Uint16)cp, NULL, NULL, NULL, NULL, &advance) == 0) return advance;
+
+    // Outside the 16-bit glyph API: measure the char on its own
+    char one[5];
+    memcpy(one, s, len);
+    one[len] = '\0';
+    int w = 0, h = 0;
+    TTF_SizeUTF8(font, one, &w, &h);
+    return w;
+}
+
+// Cumulative char advances of text, measured once per (font, text)
+static TextEntry* text_prefix(TTF_Font* font, const char* text) {
+    uint64_t key = text_key(TEXT_PREFIX, font, text, 0, 0, 0);
+    TextEntry* e = cache_find(key, TEXT_PREFIX, font, text, 0, 0, 0);
+    if (e) return e;
+
+    int bytes = (int)strlen(text);
+    int* prefix = malloc(sizeof(int) * 2 * (bytes + 1));
+    if (!prefix) return NULL;
+    int* offsets = prefix + bytes + 1;
+    int chars = 0;
+    prefix[0] = 0;
+    offsets[0] = 0;
+    for (int at = 0; at < bytes;) {
+        int len = utf8_length((uint8_t)text[at]);
+        if (at + len > bytes) len = bytes - at;
+        prefix[chars + 1] = prefix[chars] + char_advance(font, text + at, len);
+        at += len;
+        offsets[++chars] = at;
+    }
+
+    // Widths then offsets, packed together
+    memmove(prefix + chars + 1, offsets, sizeof(int) * (chars + 1));
+    e = cache_insert(key, TEXT_PREFIX, font, text, 0, 0, 0, (int)sizeof(int) * 2 * (chars + 1));
+    if (!e) {
+        free(prefix);
+        return NULL;
+    }
+    e->prefix = prefix;
+    e->chars = chars;
+    return e;
+}
+
+// Fit text into max_width (padding included), cutting it at a char boundary
+// and ending it with an ellipsis. The cut point is binary-searched over the
+// cached advances and then checked with one real measurement, which accounts
+// for kerning. Returns the width of out plus padding.
+static int truncate_text(TTF_Font* font, const char* text, char* out, int max_width, int padding) {
+    int w = 0, h = 0;
+    int len = (int)strlen(text);
+    if (len < TEXT_CACHE_TEXT_MAX) {
+        TTF_SizeUTF8(font, text, &w, &h);
+        if (w + padding <= max_width) {
+            memcpy(out, text, len + 1);
+            return w + padding;
+        }
+    }
+
+    // Before the advances: caching the ellipsis may evict entries
+    int ellipsis_w = TextCache_width(font, ELLIPSIS);
+    TextEntry* e = text_prefix(font, text);
+    if (!e) return GFX_truncateText(font, text, out, max_width, padding);
+    const int* prefix = e->prefix;
+    const int* offsets = e->prefix + e->chars + 1;
+
+    int budget = max_width - padding - ellipsis_w;
+    int max_bytes = TEXT_CACHE_TEXT_MAX - (int)sizeof(ELLIPSIS);
+
+    // Most chars whose advances fit the budget and whose bytes fit out
+    int lo = 0, hi = e->chars;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (prefix[mid] <= budget && offsets[mid] <= max_bytes) lo = mid;
+        else hi = mid - 1;
+    }
+
+    // Trailing spaces before the ellipsis look odd
+    while (lo > 0 && text[offsets[lo] - 1] == ' ') lo--;
+
+    for (;;) {
+        memcpy(out, text, offsets[lo]);
+        memcpy(out + offsets[lo], ELLIPSIS, sizeof(ELLIPSIS));
+        TTF_SizeUTF8(font, out, &w, &h);
+        if (w + padding <= max_width || lo == 0) break;
+        lo--;
+    }
+    return w + padding;
+}
+
+int TextCache_truncate(TTF_Font* font, const char* text, char* out, int max_width, int padding) {
+    uint64_t key = text_key(TEXT_TRUNCATE, font, text, 0, max_width, padding);
+    TextEntry* e = cache_find(key, TEXT_TRUNCATE, font, text, 0, max_width, padding);
+    if (e) {
+        snprintf(out, TEXT_CACHE_TEXT_MAX, "%s", e->truncated);
+        return e->width;
+    }
+
+    int width = truncate_text(font, text, out, max_width, padding);
+    char* truncated = strdup(out);
+    if (!truncated) return width;
+    e = cache_insert(key, TEXT_TRUNCATE, font, text, 0, max_width, padding, (int)strlen(out) + 1);
+    if (!e) {
+        free(truncated);
+        return width;
+    }
+    e->truncated = truncated;
+    e->width = width;
+    return width;
+}
+
+SDL_Surface* TextCache_render(TTF_Font* font, const char* text, SDL_Color color) {
+    uint32_t rgba = pack_color(color);
+    uint64_t key = text_key(TEXT_SURFACE, font, text, rgba, 0, 0);
+    TextEntry* e = cache_find(key, TEXT_SURFACE, font, text, rgba, 0, 0);
+    if (e) return e->surface;
+
+    if (uncached) {
+        SDL_FreeSurface(uncached);
+        uncached = NULL;
+    }
+    SDL_Surface* surface = TTF_RenderUTF8_Blended(font, text, color);
+    if (!surface) return NULL;
+    e = cache_insert(key, TEXT_SURFACE, font, text, rgba, 0, 0, surface->pitch * surface->h);
+    if (!e) {
+        uncached = surface;
+        return surface;
+    }
+    e->surface = surface;
+    e->width = surface->w;
+    return surface;
+}
+
+size_t TextCache_clear(void) {
+    size_t bytes = (size_t)cache_bytes;
+    for (int i = 0; i < TEXT_CACHE_ENTRIES; i++) {
+        if (entries[i].used) cache_drop(&entries[i]);
+    }
+    cache_clock = 0;
+    if (uncached) {
+        SDL_FreeSurface(uncached);
+        uncached = NULL;
+    }
+    return bytes;
+}
@@ -0,0 +1,37 @@
+#ifndef __TEXT_CACHE_H__
+#define __TEXT_CACHE_H__
+
+#include "defines.h"
+#include "api.h"
+
+// Rendered text cache
+// List rows, headers and labels are drawn again on every redraw with the same
+// font, text and color. Measured widths, truncated strings and rendered
+// surfaces are kept here keyed by (font, text, color, width), and the least
+// recently used are dropped to stay within TEXT_CACHE_BYTES, so scrolling a
+// list rasterizes each label once. Fonts must stay open while cached: call
+// TextCache_clear() before closing them. Main thread only.
+
+#define TEXT_CACHE_BYTES (4 * 1024 * 1024)
+#define TEXT_CACHE_ENTRIES 512
+#define TEXT_CACHE_TEXT_MAX 256             // Size of the truncate output buffer
+
+// Width of text in font
+int TextCache_width(TTF_Font* font, const char* text);
+
+// GFX_truncateText(), cached: out (TEXT_CACHE_TEXT_MAX bytes) gets text,
+// shortened at a char boundary with "..." to fit max_width once padding is
+// added. The cut is binary-searched over the text's cached char advances, so
+// a long name costs O(log n) instead of a measurement per dropped char.
+// Returns the width of out plus padding.
+int TextCache_truncate(TTF_Font* font, const char* text, char* out, int max_width, int padding);
+
+// TTF_RenderUTF8_Blended(), cached. The surface belongs to the cache: blit it
+// but don't free or modify it; it stays valid until the next TextCache call.
+SDL_Surface* TextCache_render(TTF_Font* font, const char* text, SDL_Color color);
+
+// Drop everything (fonts are about to close, or memory is short)
+// Returns the bytes that were cached.
+size_t TextCache_clear(void);
+
+#endif
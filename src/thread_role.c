@@ -0,0 +1,67 @@
+#define _GNU_SOURCE
+#include "thread_role.h"
+#include "defines.h"
+#include "api.h"
+#include <stdbool.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+// Per-role scheduling, applied by the thread itself
+typedef struct {
+    int policy;         // SCHED_FIFO, SCHED_OTHER or SCHED_IDLE
+    int rt_priority;    // SCHED_FIFO priority (1-99)
+    int nice;           // Nice value for SCHED_OTHER (also the SCHED_FIFO fallback)
+    bool audio_core;    // Pin to the audio core, otherwise keep off it
+} ThreadRoleConfig;
+
+static const ThreadRoleConfig role_configs[] = {
+    [THREAD_ROLE_AUDIO]      = { SCHED_FIFO,  20, -15, true  },
+    [THREAD_ROLE_DECODE]     = { SCHED_OTHER, 0,  -10, true  },
+    [THREAD_ROLE_DECODE_HELPER] = { SCHED_OTHER, 0, -10, false },
+    [THREAD_ROLE_UI]         = { SCHED_OTHER, 0,  0,   false },
+    [THREAD_ROLE_BACKGROUND] = { SCHED_IDLE,  0,  19,  false },
+};
+
+// The last core is reserved for audio (A133: cpu3); needs at least 2 cores
+static void apply_affinity(bool audio_core) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 2) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (audio_core) {
+        CPU_SET(cores - 1, &set);
+    } else {
+        for (long i = 0; i < cores - 1; i++) CPU_SET(i, &set);
+    }
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        LOG_error("ThreadRole: Failed to set CPU affinity\n");
+    }
+}
+
+// Per-thread nice (Linux applies nice values to the calling thread's tid)
+static void apply_nice(int nice_value) {
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    setpriority(PRIO_PROCESS, tid, nice_value);
+}
+
+void ThreadRole_apply(ThreadRole role) {
+    if (role < THREAD_ROLE_AUDIO || role > THREAD_ROLE_BACKGROUND) return;
+    const ThreadRoleConfig* cfg = &role_configs[role];
+
+    apply_affinity(cfg->audio_core);
+
+    // On Linux pid 0 means the calling thread, not the whole process
+    struct sched_param param = {0};
+    param.sched_priority = (cfg->policy == SCHED_FIFO) ? cfg->rt_priority : 0;
+    if (sched_setscheduler(0, cfg->policy, &param) != 0) {
+        // Not permitted (or not supported): stay SCHED_OTHER and use nice instead
+        param.sched_priority = 0;
+        sched_setscheduler(0, SCHED_OTHER, &param);
+    }
+    if (cfg->policy != SCHED_FIFO || sched_getscheduler(0) != SCHED_FIFO) {
+        apply_nice(cfg->nice);
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef __THREAD_ROLE_H__
+#define __THREAD_ROLE_H__
+
+// Scheduling roles for the app's threads
+// Keeps the audio path responsive while downloads, scans and fetches run:
+// audio and decode threads share a dedicated core at elevated priority, everything
+// else is kept off that core and background work only gets otherwise idle CPU.
+typedef enum {
+    THREAD_ROLE_AUDIO,          // SDL audio callback thread (SCHED_FIFO, audio core)
+    THREAD_ROLE_DECODE,         // Player/radio decode and stream threads (high priority, audio core)
+    THREAD_ROLE_DECODE_HELPER,  // Parallel decode workers (high priority, off the audio core)
+    THREAD_ROLE_UI,             // Main loop (normal priority, off the audio core)
+    THREAD_ROLE_BACKGROUND      // Downloads, scans, art fetches (SCHED_IDLE, off the audio core)
+} ThreadRole;
+
+// Apply a role to the calling thread
+// Best effort: falls back to nice values when real-time scheduling isn't permitted.
+// Child processes (popen/system) inherit the caller's role.
+void ThreadRole_apply(ThreadRole role);
+
+#endif
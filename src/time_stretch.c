@@ -0,0 +1,330 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "time_stretch.h"
+#include "pcm_kernels.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define STRETCH_CHANNELS 2
+#define SEQUENCE_MS 40              // Output sequence, overlap included
+#define OVERLAP_MS 8                // Cross-fade between sequences
+#define SEEK_MS 15                  // Window searched for the best continuation
+#define SEEK_COARSE_STEP 4          // Offsets tried first; the best is refined around
+
+struct TimeStretch {
+    int sample_rate;                // Windows built for
+    float tempo;
+    size_t sequence;                // In frames
+    size_t overlap;                 // Multiple of 4 frames
+    size_t seek;
+
+    // Precomputed per rate: fade-in gains across the overlap (sin^2, the fade-out
+    // is 1 - ramp) and the Hann weighting of the search reference
+    float* ramp;
+    float* weight;
+
+    // The overlap frames that continue the last sequence, and their weighted copy
+    float* mid;
+    float* ref;
+    bool mid_valid;
+    double skip_frac;               // Fraction of an input frame carried over
+
+    float* in;                      // Input not consumed yet
+    size_t in_len;
+    size_t in_cap;
+    float* out;                     // Output not handed out yet (from out_pos)
+    size_t out_len;
+    size_t out_pos;
+    size_t out_cap;
+};
+
+static void free_windows(TimeStretch* ts) {
+    free(ts->ramp);
+    free(ts->weight);
+    free(ts->mid);
+    free(ts->ref);
+    ts->ramp = ts->weight = ts->mid = ts->ref = NULL;
+}
+
+static bool build_windows(TimeStretch* ts, int sample_rate) {
+    free_windows(ts);
+    ts->sample_rate = sample_rate;
+    ts->sequence = (size_t)sample_rate * SEQUENCE_MS / 1000;
+    ts->overlap = ((size_t)sample_rate * OVERLAP_MS / 1000) & ~(size_t)3;
+    ts->seek = (size_t)sample_rate * SEEK_MS / 1000;
+    if (ts->overlap < 4) ts->overlap = 4;
+    if (ts->sequence < ts->overlap * 3) ts->sequence = ts->overlap * 3;
+
+    ts->ramp = malloc(ts->overlap * sizeof(float));
+    ts->weight = malloc(ts->overlap * sizeof(float));
+    ts->mid = malloc(ts->overlap * STRETCH_CHANNELS * sizeof(float));
+    ts->ref = malloc(ts->overlap * STRETCH_CHANNELS * sizeof(float));
+    if (!ts->ramp || !ts->weight || !ts->mid || !ts->ref) {
+        free_windows(ts);
+        return false;
+    }
+    for (size_t i = 0; i < ts->overlap; i++) {
+        float s = sinf((float)M_PI * 0.5f * ((float)i + 0.5f) / (float)ts->overlap);
+        ts->ramp[i] = s * s;
+        ts->weight[i] = 0.5f - 0.5f * cosf(2.0f * (float)M_PI * ((float)i + 0.5f) / (float)ts->overlap);
+    }
+    return true;
+}
+
+TimeStretch* TimeStretch_new(int sample_rate) {
+    TimeStretch* ts = calloc(1, sizeof(TimeStretch));
+    if (!ts) return NULL;
+    ts->tempo = 1.0f;
+    if (!build_windows(ts, sample_rate > 0 ? sample_rate : 48000)) {
+        free(ts);
+        return NULL;
+    }
+    return ts;
+}
+
+void TimeStretch_free(TimeStretch* ts) {
+    if (!ts) return;
+    free_windows(ts);
+    free(ts->in);
+    free(ts->out);
+    free(ts);
+}
+
+void TimeStretch_reset(TimeStretch* ts, int sample_rate) {
+    ts->in_len = 0;
+    ts->out_len = 0;
+    ts->out_pos = 0;
+    ts->mid_valid = false;
+    ts->skip_frac = 0.0;
+    // On failure the old windows stay, sized for the old rate
+    if (sample_rate > 0 && sample_rate != ts->sample_rate) build_windows(ts, sample_rate);
+}
+
+void TimeStretch_setTempo(TimeStretch* ts, float tempo) {
+    if (tempo < TIME_STRETCH_TEMPO_MIN) tempo = TIME_STRETCH_TEMPO_MIN;
+    if (tempo > TIME_STRETCH_TEMPO_MAX) tempo = TIME_STRETCH_TEMPO_MAX;
+    ts->tempo = tempo;
+}
+
+float TimeStretch_getTempo(const TimeStretch* ts) {
+    return ts->tempo;
+}
+
+bool TimeStretch_active(const TimeStretch* ts) {
+    return ts->tempo != 1.0f || ts->in_len > 0 || ts->mid_valid || ts->out_pos < ts->out_len;
+}
+
+size_t TimeStretch_pendingInput(const TimeStretch* ts) {
+    return ts->in_len + (ts->mid_valid ? ts->overlap : 0);
+}
+
+static bool grow(float** buf, size_t* cap, size_t frames) {
+    if (frames <= *cap) return true;
+    size_t want = *cap ? *cap : 4096;
+    while (want < frames) want *= 2;
+    float* grown = realloc(*buf, want * STRETCH_CHANNELS * sizeof(float));
+    if (!grown) return false;
+    *buf = grown;
+    *cap = want;
+    return true;
+}
+
+// Room for frames more output frames, the handed out ones dropped first
+static float* out_reserve(TimeStretch* ts, size_t frames) {
+    if (ts->out_pos > 0) {
+        ts->out_len -= ts->out_pos;
+        memmove(ts->out, ts->out + ts->out_pos * STRETCH_CHANNELS, ts->out_len * STRETCH_CHANNELS * sizeof(float));
+        ts->out_pos = 0;
+    }
+    if (!grow(&ts->out, &ts->out_cap, ts->out_len + frames)) return NULL;
+    return ts->out + ts->out_len * STRETCH_CHANNELS;
+}
+
+static void consume_input(TimeStretch* ts, size_t frames) {
+    if (frames > ts->in_len) frames = ts->in_len;
+    ts->in_len -= frames;
+    memmove(ts->in, ts->in + frames * STRETCH_CHANNELS, ts->in_len * STRETCH_CHANNELS * sizeof(float));
+}
+
+// Normalized cross-correlation of the reference with a candidate (n samples)
+static float similarity(const float* ref, const float* cand, size_t n) {
+    float corr = 0.0f, norm = 0.0f;
+    size_t i = 0;
+#if defined(__ARM_NEON)
+    float32x4_t vcorr = vdupq_n_f32(0.0f);
+    float32x4_t vnorm = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t c = vld1q_f32(&cand[i]);
+        vcorr = vmlaq_f32(vcorr, vld1q_f32(&ref[i]), c);
+        vnorm = vmlaq_f32(vnorm, c, c);
+    }
+    float32x2_t c2 = vadd_f32(vget_low_f32(vcorr), vget_high_f32(vcorr));
+    float32x2_t n2 = vadd_f32(vget_low_f32(vnorm), vget_high_f32(vnorm));
+    corr = vget_lane_f32(vpadd_f32(c2, c2), 0);
+    norm = vget_lane_f32(vpadd_f32(n2, n2), 0);
+#endif
+    for (; i < n; i++) {
+        corr += ref[i] * cand[i];
+        norm += cand[i] * cand[i];
+    }
+    return corr / sqrtf(norm + 1e-9f);
+}
+
+// Offset within the seek window whose start best continues the last sequence:
+// every SEEK_COARSE_STEP-th offset, then the neighbours of the best one
+static size_t best_offset(const TimeStretch* ts, const float* base) {
+    size_t n = ts->overlap * STRETCH_CHANNELS;
+    size_t best = 0;
+    float best_score = -INFINITY;
+    for (size_t off = 0; off < ts->seek; off += SEEK_COARSE_STEP) {
+        float score = similarity(ts->ref, base + off * STRETCH_CHANNELS, n);
+        if (score > best_score) {
+            best_score = score;
+            best = off;
+        }
+    }
+    size_t lo = best >= SEEK_COARSE_STEP ? best - SEEK_COARSE_STEP + 1 : 0;
+    size_t hi = best + SEEK_COARSE_STEP < ts->seek ? best + SEEK_COARSE_STEP : ts->seek;
+    size_t coarse = best;
+    for (size_t off = lo; off < hi; off++) {
+        if (off == coarse) continue;
+        float score = similarity(ts->ref, base + off * STRETCH_CHANNELS, n);
+        if (score > best_score) {
+            best_score = score;
+            best = off;
+        }
+    }
+    return best;
+}
+
+// Fade the held continuation into seg across the overlap
+static void cross_fade(const TimeStretch* ts, float* dst, const float* seg) {
+    for (size_t i = 0; i < ts->overlap; i++) {
+        float in_gain = ts->ramp[i];
+        float out_gain = 1.0f - in_gain;
+        for (int c = 0; c < STRETCH_CHANNELS; c++) {
+            size_t k = i * STRETCH_CHANNELS + c;
+            dst[k] = ts->mid[k] * out_gain + seg[k] * in_gain;
+        }
+    }
+}
+
+// Hold the overlap frames after a sequence, and their weighted copy for the search
+static void hold_mid(TimeStretch* ts, const float* frames) {
+    memcpy(ts->mid, frames, ts->overlap * STRETCH_CHANNELS * sizeof(float));
+    for (size_t i = 0; i < ts->overlap; i++) {
+        for (int c = 0; c < STRETCH_CHANNELS; c++) {
+            size_t k = i * STRETCH_CHANNELS + c;
+            ts->ref[k] = ts->mid[k] * ts->weight[i];
+        }
+    }
+    ts->mid_valid = true;
+}
+
+// Stretch whole sequences while the input covers one and its seek window
+static void run_sequences(TimeStretch* ts) {
+    size_t emit = ts->sequence - ts->overlap;
+    size_t need = ts->seek + ts->sequence;
+    size_t advance_max = (size_t)(ts->tempo * (float)emit) + 1;
+    if (need < advance_max) need = advance_max;
+
+    size_t pos = 0;
+    while (ts->in_len - pos >= need) {
+        const float* base = ts->in + pos * STRETCH_CHANNELS;
+        const float* seg = base + (ts->mid_valid ? best_offset(ts, base) : 0) * STRETCH_CHANNELS;
+        float* dst = out_reserve(ts, emit);
+        if (!dst) break;
+
+        if (ts->mid_valid) {
+            cross_fade(ts, dst, seg);
+        } else {
+            memcpy(dst, seg, ts->overlap * STRETCH_CHANNELS * sizeof(float));
+        }
+        memcpy(dst + ts->overlap * STRETCH_CHANNELS, seg + ts->overlap * STRETCH_CHANNELS,
+               (emit - ts->overlap) * STRETCH_CHANNELS * sizeof(float));
+        hold_mid(ts, seg + emit * STRETCH_CHANNELS);
+        ts->out_len += emit;
+
+        double skip = ts->tempo * (double)emit + ts->skip_frac;
+        size_t whole = (size_t)skip;
+        ts->skip_frac = skip - (double)whole;
+        pos += whole;
+    }
+    consume_input(ts, pos);
+}
+
+// Back onto the input: the held continuation fades into it at its nominal
+// place and the rest follows as is. Waits for an overlap of input unless draining.
+static void settle(TimeStretch* ts, bool drain) {
+    size_t head = 0;
+    if (ts->mid_valid) {
+        if (ts->in_len < ts->overlap && !drain) return;
+        head = ts->in_len < ts->overlap ? 0 : ts->overlap;
+        float* dst = out_reserve(ts, ts->overlap);
+        if (!dst) return;
+        if (head) {
+            cross_fade(ts, dst, ts->in);
+        } else {
+            memcpy(dst, ts->mid, ts->overlap * STRETCH_CHANNELS * sizeof(float));
+        }
+        ts->out_len += ts->overlap;
+        ts->mid_valid = false;
+    }
+    float* dst = out_reserve(ts, ts->in_len - head);
+    if (!dst) return;
+    memcpy(dst, ts->in + head * STRETCH_CHANNELS, (ts->in_len - head) * STRETCH_CHANNELS * sizeof(float));
+    ts->out_len += ts->in_len - head;
+    ts->in_len = 0;
+    ts->skip_frac = 0.0;
+}
+
+// Take the input, stretch what it allows, and report the output frames ready
+static size_t stretch(TimeStretch* ts, const int16_t* in_s16, const float* in_f32, size_t frames, bool drain) {
+    if (frames > 0 && grow(&ts->in, &ts->in_cap, ts->in_len + frames)) {
+        float* dst = ts->in + ts->in_len * STRETCH_CHANNELS;
+        if (in_s16) {
+            Pcm_s16ToF32(in_s16, dst, frames * STRETCH_CHANNELS);
+        } else {
+            memcpy(dst, in_f32, frames * STRETCH_CHANNELS * sizeof(float));
+        }
+        ts->in_len += frames;
+    }
+
+    if (ts->tempo == 1.0f || drain) {
+        settle(ts, drain);
+    } else {
+        run_sequences(ts);
+    }
+    return ts->out_len - ts->out_pos;
+}
+
+// Hand out up to max_out frames
+static const float* take_output(TimeStretch* ts, size_t* frames, size_t max_out) {
+    const float* src = ts->out + ts->out_pos * STRETCH_CHANNELS;
+    if (*frames > max_out) *frames = max_out;
+    ts->out_pos += *frames;
+    if (ts->out_pos == ts->out_len) ts->out_pos = ts->out_len = 0;
+    return src;
+}
+
+size_t TimeStretch_processS16(TimeStretch* ts, const int16_t* in, size_t frames,
+                              int16_t* out, size_t max_out, bool drain) {
+    size_t n = stretch(ts, in, NULL, frames, drain);
+    if (n == 0) return 0;
+    const float* src = take_output(ts, &n, max_out);
+    Pcm_f32ToS16Gain(src, out, n, 1.0f, 0.0f);
+    return n;
+}
+
+size_t TimeStretch_processF32(TimeStretch* ts, const float* in, size_t frames,
+                              float* out, size_t max_out, bool drain) {
+    size_t n = stretch(ts, NULL, in, frames, drain);
+    if (n == 0) return 0;
+    const float* src = take_output(ts, &n, max_out);
+    memcpy(out, src, n * STRETCH_CHANNELS * sizeof(float));
+    return n;
+}
@@ -0,0 +1,47 @@
+#ifndef __TIME_STRETCH_H__
+#define __TIME_STRETCH_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Stereo time stretching without a pitch change (WSOLA)
+// Input is cut into overlapping sequences. Each one is taken at the offset,
+// within a short seek window, that best continues the previous sequence
+// (normalized cross-correlation, NEON), and cross-faded into it over a
+// precomputed ramp. Input advances by tempo times the output, so 2.0 plays
+// twice as fast and 0.98 slightly slower. At tempo 1.0 the stage settles
+// back onto its input and then passes audio through untouched.
+// Input is always taken whole; output beyond max_out stays pending and comes out
+// of the next call (which may pass no input). Not thread-safe: one owner at a time.
+
+#define TIME_STRETCH_TEMPO_MIN 0.5f
+#define TIME_STRETCH_TEMPO_MAX 2.0f
+
+typedef struct TimeStretch TimeStretch;
+
+// NULL if out of memory
+TimeStretch* TimeStretch_new(int sample_rate);
+void TimeStretch_free(TimeStretch* ts);
+
+// Forget buffered audio (seek, new stream); a new rate rebuilds the windows
+void TimeStretch_reset(TimeStretch* ts, int sample_rate);
+
+// Tempo from the next call on (clamped to TIME_STRETCH_TEMPO_MIN..MAX)
+void TimeStretch_setTempo(TimeStretch* ts, float tempo);
+float TimeStretch_getTempo(const TimeStretch* ts);
+
+// Stretching or still holding audio; when false the stage can be skipped
+bool TimeStretch_active(const TimeStretch* ts);
+
+// Input frames taken but not output yet
+size_t TimeStretch_pendingInput(const TimeStretch* ts);
+
+// Stretch interleaved stereo; returns the output frames. drain: the stream
+// ends here, so what is held comes out unstretched.
+size_t TimeStretch_processS16(TimeStretch* ts, const int16_t* in, size_t frames,
+                              int16_t* out, size_t max_out, bool drain);
+size_t TimeStretch_processF32(TimeStretch* ts, const float* in, size_t frames,
+                              float* out, size_t max_out, bool drain);
+
+#endif
@@ -0,0 +1,157 @@
+#ifdef TRACE_EVENTS
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "trace.h"
+
+typedef struct {
+    const char* name;
+    uint64_t ts_us;
+    uint32_t dur_us;        // 'X' events
+    char phase;             // Chrome phase: B, E, X or i
+} TraceEvent;
+
+typedef struct {
+    TraceEvent events[TRACE_EVENTS_PER_THREAD];
+    uint32_t head;          // Events ever written; only the owner writes
+    int tid;
+    bool exited;
+} TraceBuffer;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TraceBuffer* buffers[TRACE_THREADS_MAX];
+static int buffer_count = 0;
+static pthread_key_t exit_key;
+static pthread_once_t exit_key_once = PTHREAD_ONCE_INIT;
+
+static __thread TraceBuffer* local = NULL;
+static __thread bool local_untraced = false;   // Registry was full
+
+uint64_t Trace_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void thread_exited(void* arg) {
+    TraceBuffer* buffer = (TraceBuffer*)arg;
+    pthread_mutex_lock(&registry_mutex);
+    buffer->exited = true;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void create_exit_key(void) {
+    pthread_key_create(&exit_key, thread_exited);
+}
+
+static uint64_t last_ts(const TraceBuffer* buffer) {
+    if (buffer->head == 0) return 0;
+    return buffer->events[(buffer->head - 1) % TRACE_EVENTS_PER_THREAD].ts_us;
+}
+
+// The calling thread's ring: a new one, else that of the thread that exited
+// longest ago (a load thread is started per track). NULL once all are taken.
+static TraceBuffer* local_buffer(void) {
+    if (local) return local;
+    if (local_untraced) return NULL;
+
+    pthread_once(&exit_key_once, create_exit_key);
+    pthread_mutex_lock(&registry_mutex);
+    TraceBuffer* buffer = NULL;
+    if (buffer_count < TRACE_THREADS_MAX) {
+        buffer = calloc(1, sizeof(TraceBuffer));
+        if (buffer) buffers[buffer_count++] = buffer;
+    } else {
+        for (int i = 0; i < buffer_count; i++) {
+            if (buffers[i]->exited && (!buffer || last_ts(buffers[i]) < last_ts(buffer))) buffer = buffers[i];
+        }
+        if (buffer) {
+            __atomic_store_n(&buffer->head, 0, __ATOMIC_RELEASE);
+            buffer->exited = false;
+        }
+    }
+    if (buffer) buffer->tid = (int)syscall(SYS_gettid);
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (!buffer) {
+        local_untraced = true;
+        return NULL;
+    }
+    pthread_setspecific(exit_key, buffer);
+    local = buffer;
+    return buffer;
+}
+
+static void record(const char* name, char phase, uint64_t ts_us, uint32_t dur_us) {
+    TraceBuffer* buffer = local_buffer();
+    if (!buffer) return;
+    uint32_t head = buffer->head;
+    TraceEvent* e = &buffer->events[head % TRACE_EVENTS_PER_THREAD];
+    e->name = name;
+    e->ts_us = ts_us;
+    e->dur_us = dur_us;
+    e->phase = phase;
+    __atomic_store_n(&buffer->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void Trace_begin(const char* name) {
+    record(name, 'B', Trace_now(), 0);
+}
+
+void Trace_end(const char* name) {
+    record(name, 'E', Trace_now(), 0);
+}
+
+void Trace_instant(const char* name) {
+    record(name, 'i', Trace_now(), 0);
+}
+
+void Trace_complete(const char* name, uint64_t start_us) {
+    Trace_span(name, start_us, Trace_now());
+}
+
+void Trace_span(const char* name, uint64_t start_us, uint64_t end_us) {
+    record(name, 'X', start_us, start_us < end_us ? (uint32_t)(end_us - start_us) : 0);
+}
+
+// Other threads keep recording while their rings are copied out: an event being
+// overwritten mid-copy may come out mangled, which a debug trace can live with
+int Trace_dump(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+
+    int pid = (int)getpid();
+    bool first = true;
+    fputs("{\"traceEvents\":[\n", f);
+
+    pthread_mutex_lock(&registry_mutex);
+    for (int i = 0; i < buffer_count; i++) {
+        TraceBuffer* buffer = buffers[i];
+        uint32_t head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+        uint32_t count = head < TRACE_EVENTS_PER_THREAD ? head : TRACE_EVENTS_PER_THREAD;
+        for (uint32_t n = head - count; n != head; n++) {
+            const TraceEvent* e = &buffer->events[n % TRACE_EVENTS_PER_THREAD];
+            if (!e->name) continue;
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%d",
+                    first ? "" : ",\n", e->name, e->phase, (unsigned long long)e->ts_us, pid, buffer->tid);
+            if (e->phase == 'X') fprintf(f, ",\"dur\":%u", e->dur_us);
+            if (e->phase == 'i') fputs(",\"s\":\"t\"", f);
+            fputc('}', f);
+            first = false;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", f);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stdint.h>
+
+// Startup and track-switch latency tracing (TRACE builds: make TRACE=1)
+// Begin/end events are stamped with the monotonic clock into a ring buffer
+// owned by the calling thread, so recording takes no lock. Trace_dump() writes
+// every thread's ring as a Chrome trace_event JSON file (open it in
+// chrome://tracing or Perfetto); the player dumps on exit and on SELECT+Y.
+// Names must be string literals. Without TRACE_EVENTS the macros compile to
+// nothing.
+
+#define TRACE_FILE SHARED_USERDATA_PATH "/musicplayer_trace.json"
+
+#ifdef TRACE_EVENTS
+
+#define TRACE_THREADS_MAX 48
+#define TRACE_EVENTS_PER_THREAD 2048    // Oldest events are overwritten
+
+// Monotonic time in microseconds (the trace's clock)
+uint64_t Trace_now(void);
+
+void Trace_begin(const char* name);
+void Trace_end(const char* name);
+void Trace_instant(const char* name);
+
+// A span from start_us (Trace_now() or the same clock) until now
+void Trace_complete(const char* name, uint64_t start_us);
+
+// A span from start_us until end_us, recorded on the calling thread
+void Trace_span(const char* name, uint64_t start_us, uint64_t end_us);
+
+// Write all rings to path; returns 0 on success
+int Trace_dump(const char* path);
+
+typedef struct {
+    const char* name;
+} TraceScope;
+
+static inline TraceScope Trace_beginScope(const char* name) {
+    Trace_begin(name);
+    TraceScope scope = {name};
+    return scope;
+}
+
+static inline void Trace_endScope(TraceScope* scope) {
+    Trace_end(scope->name);
+}
+
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+// Trace from here to the end of the enclosing block under name
+#define TRACE_SCOPE(name) \
+    TraceScope TRACE_CAT(trace_scope_, __LINE__) __attribute__((cleanup(Trace_endScope))) = Trace_beginScope(name)
+#define TRACE_BEGIN(name) Trace_begin(name)
+#define TRACE_END(name) Trace_end(name)
+#define TRACE_INSTANT(name) Trace_instant(name)
+#define TRACE_COMPLETE(name, start_us) Trace_complete(name, start_us)
+#define TRACE_SPAN(name, start_us, end_us) Trace_span(name, start_us, end_us)
+#define TRACE_DUMP() Trace_dump(TRACE_FILE)
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_COMPLETE(name, start_us) ((void)0)
+#define TRACE_SPAN(name, start_us, end_us) ((void)0)
+#define TRACE_DUMP() ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "track_meta.h"
+#include "library.h"
+#include "player.h"
+#include "thread_role.h"
+#include "defines.h"
+#include "api.h"
+
+#define META_CACHE_SIZE 256         // Rows kept (a few screens of each recent folder)
+#define META_PENDING_MAX 64         // Rows waiting for the worker
+#define META_BATCH 8                // Files parsed per wakeup
+#define META_LOOKAHEAD_PAGES 2      // Pages loaded below the visible one
+#define META_LOOKBEHIND_PAGES 1     // ...and above it
+
+typedef enum {
+    META_EMPTY,
+    META_PENDING,       // Queued for the worker
+    META_DONE
+} MetaState;
+
+typedef struct {
+    uint64_t key;       // Hash of the path
+    char title[128];
+    char artist[96];
+    uint32_t last_used;
+    uint8_t state;      // MetaState
+} MetaSlot;
+
+static pthread_mutex_t meta_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t meta_ready = PTHREAD_COND_INITIALIZER;
+static pthread_t meta_thread;
+static bool meta_running = false;
+static bool meta_quit = false;
+static bool meta_updated = false;
+
+static MetaSlot cache[META_CACHE_SIZE];
+static uint32_t cache_clock = 0;
+static char pending[META_PENDING_MAX][512];
+static uint64_t pending_keys[META_PENDING_MAX];
+static int pending_head = 0;
+static int pending_count = 0;
+
+// FNV-1a, 64 bits so different paths don't share a slot
+static uint64_t path_key(const char* path) {
+    uint64_t hash = 1469598103934665603ULL;
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static MetaSlot* cache_find(uint64_t key) {
+    for (int i = 0; i < META_CACHE_SIZE; i++) {
+        if (cache[i].state != META_EMPTY && cache[i].key == key) return &cache[i];
+    }
+    return NULL;
+}
+
+// Free slot, or the least recently used loaded one (NULL if all are pending)
+static MetaSlot* cache_claim(uint64_t key) {
+    MetaSlot* slot = NULL;
+    for (int i = 0; i < META_CACHE_SIZE; i++) {
+        if (cache[i].state == META_EMPTY) {
+            slot = &cache[i];
+            break;
+        }
+        if (cache[i].state == META_DONE && (!slot || cache[i].last_used < slot->last_used)) slot = &cache[i];
+    }
+    if (!slot) return NULL;
+    memset(slot, 0, sizeof(MetaSlot));
+    slot->key = key;
+    slot->last_used = ++cache_clock;
+    return slot;
+}
+
+static void* meta_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    char paths[META_BATCH][512];
+    uint64_t keys[META_BATCH];
+    PlayerFileTags tags[META_BATCH];
+    bool ok[META_BATCH];
+
+    pthread_mutex_lock(&meta_lock);
+    while (!meta_quit) {
+        if (pending_count == 0) {
+            pthread_cond_wait(&meta_ready, &meta_lock);
+            continue;
+        }
+
+        int count = 0;
+        while (count < META_BATCH && pending_count > 0) {
+            memcpy(paths[count], pending[pending_head], sizeof(paths[count]));
+            keys[count] = pending_keys[pending_head];
+            pending_head = (pending_head + 1) % META_PENDING_MAX;
+            pending_count--;
+            count++;
+        }
+        pthread_mutex_unlock(&meta_lock);
+
+        for (int i = 0; i < count; i++) {
+            ok[i] = Player_readFileTags(paths[i], &tags[i]) == 0;
+        }
+
+        pthread_mutex_lock(&meta_lock);
+        for (int i = 0; i < count; i++) {
+            // The slot may have been dropped with its request meanwhile
+            MetaSlot* slot = cache_find(keys[i]);
+            if (!slot || slot->state != META_PENDING) continue;
+            if (ok[i]) {
+                snprintf(slot->title, sizeof(slot->title), "%s", tags[i].info.title);
+                snprintf(slot->artist, sizeof(slot->artist), "%s", tags[i].info.artist);
+            }
+            slot->state = META_DONE;
+            meta_updated = true;
+        }
+    }
+    pthread_mutex_unlock(&meta_lock);
+    return NULL;
+}
+
+void TrackMeta_init(void) {
+    if (meta_running) return;
+    meta_quit = false;
+    meta_running = pthread_create(&meta_thread, NULL, meta_thread_func, NULL) == 0;
+    if (!meta_running) LOG_error("TrackMeta: failed to start the tag loader\n");
+}
+
+void TrackMeta_quit(void) {
+    if (!meta_running) return;
+    pthread_mutex_lock(&meta_lock);
+    meta_quit = true;
+    pthread_cond_signal(&meta_ready);
+    pthread_mutex_unlock(&meta_lock);
+    pthread_join(meta_thread, NULL);
+    meta_running = false;
+}
+
+// Queue a row for the worker (called with meta_lock held)
+static void request_row(const char* path) {
+    uint64_t key = path_key(path);
+    MetaSlot* slot = cache_find(key);
+    if (slot) {
+        slot->last_used = ++cache_clock;
+        return;
+    }
+
+    // Served from the library index without touching the file
+    int record = Library_find(path);
+    if (record >= 0) {
+        const LibraryRecord* r = Library_record(record);
+        slot = cache_claim(key);
+        if (!slot) return;
+        snprintf(slot->title, sizeof(slot->title), "%s", Library_string(r->title));
+        snprintf(slot->artist, sizeof(slot->artist), "%s", Library_string(r->artist));
+        slot->state = META_DONE;
+        return;
+    }
+
+    if (!meta_running || pending_count == META_PENDING_MAX) return;
+    slot = cache_claim(key);
+    if (!slot) return;
+    slot->state = META_PENDING;
+    int tail = (pending_head + pending_count) % META_PENDING_MAX;
+    snprintf(pending[tail], sizeof(pending[tail]), "%s", path);
+    pending_keys[tail] = key;
+    pending_count++;
+}
+
+void TrackMeta_request(const BrowserContext* ctx, int first, int count) {
+    int page = count > 0 ? count : 1;
+    int start = first - page * META_LOOKBEHIND_PAGES;
+    int end = first + page * (1 + META_LOOKAHEAD_PAGES);
+    if (start < ctx->audio_start) start = ctx->audio_start;
+    if (end > ctx->entry_count) end = ctx->entry_count;
+
+    pthread_mutex_lock(&meta_lock);
+    // Requests for rows that scrolled away are dropped (their slots freed)
+    for (int i = 0; i < pending_count; i++) {
+        MetaSlot* slot = cache_find(pending_keys[(pending_head + i) % META_PENDING_MAX]);
+        if (slot && slot->state == META_PENDING) slot->state = META_EMPTY;
+    }
+    pending_head = 0;
+    pending_count = 0;
+
+    // Visible rows first, then below, then above
+    char path[512];
+    int visible_start = first > start ? first : start;
+    for (int pass = 0; pass < 2; pass++) {
+        int from = pass == 0 ? visible_start : start;
+        int to = pass == 0 ? end : visible_start;
+        for (int i = from; i < to; i++) {
+            const FileEntry* entry = &ctx->entries[i];
+            if (entry->cue_track) continue;  // Titled by the cue sheet
+            Browser_getPath(ctx, entry, path, sizeof(path));
+            request_row(path);
+        }
+    }
+    if (pending_count > 0) pthread_cond_signal(&meta_ready);
+    pthread_mutex_unlock(&meta_lock);
+}
+
+bool TrackMeta_get(const char* path, char* title, int title_size, char* artist, int artist_size) {
+    pthread_mutex_lock(&meta_lock);
+    MetaSlot* slot = cache_find(path_key(path));
+    bool found = slot && slot->state == META_DONE;
+    if (found) {
+        snprintf(title, title_size, "%s", slot->title);
+        snprintf(artist, artist_size, "%s", slot->artist);
+    }
+    pthread_mutex_unlock(&meta_lock);
+    return found;
+}
+
+void TrackMeta_put(const char* path, const char* title, const char* artist) {
+    uint64_t key = path_key(path);
+    pthread_mutex_lock(&meta_lock);
+    MetaSlot* slot = cache_find(key);
+    if (!slot) slot = cache_claim(key);
+    // A pending slot is the worker's to fill
+    if (slot && slot->state != META_PENDING) {
+        snprintf(slot->title, sizeof(slot->title), "%s", title);
+        snprintf(slot->artist, sizeof(slot->artist), "%s", artist);
+        slot->state = META_DONE;
+    }
+    pthread_mutex_unlock(&meta_lock);
+}
+
+bool TrackMeta_takeUpdate(void) {
+    pthread_mutex_lock(&meta_lock);
+    bool updated = meta_updated;
+    meta_updated = false;
+    pthread_mutex_unlock(&meta_lock);
+    return updated;
+}
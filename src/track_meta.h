@@ -0,0 +1,29 @@
+#ifndef __TRACK_META_H__
+#define __TRACK_META_H__
+
+#include <stdbool.h>
+#include "browser.h"
+
+// Title and artist of the files on screen in the browser
+// Rows are looked up in the library index first; files it doesn't have are
+// parsed on a background thread in small batches, visible rows first, then a
+// look-ahead window. Results are cached by path. All functions are for the
+// main thread and never wait for I/O.
+
+void TrackMeta_init(void);
+void TrackMeta_quit(void);
+
+// Rows [first, first + count) of ctx are visible: load them and the rows
+// around them, dropping requests for rows no longer near the screen
+void TrackMeta_request(const BrowserContext* ctx, int first, int count);
+
+// Tags of a file if they are loaded (empty strings if it has none)
+bool TrackMeta_get(const char* path, char* title, int title_size, char* artist, int artist_size);
+
+// Tags of a file read elsewhere (a folder prefetch), cached like loaded ones
+void TrackMeta_put(const char* path, const char* title, const char* artist);
+
+// True once after new rows were loaded in the background (redraw the list)
+bool TrackMeta_takeUpdate(void);
+
+#endif
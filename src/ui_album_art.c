@@ -1,188 +1,201 @@
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include "ui_album_art.h"
-
-// Cache for album art background rendering
-static SDL_Surface* cached_bg_surface = NULL;
-static SDL_Surface* cached_bg_art_ptr = NULL;  // Track pointer for cache invalidation
-static int cached_bg_art_w = 0;  // Track source dimensions for cache invalidation
-static int cached_bg_art_h = 0;
-static int cached_screen_w = 0;  // Track screen dimensions
-static int cached_screen_h = 0;
-
-// Render album art as a triangular background with fade effect
-void render_album_art_background(SDL_Surface* screen, SDL_Surface* album_art) {
-    if (!album_art || !screen) return;
-    if (album_art->w <= 0 || album_art->h <= 0) return;
-
-    int hw = screen->w;
-    int hh = screen->h;
-
-    // Check if we need to regenerate the cached surface
-    // Track both pointer and dimensions to detect changes
-    // Pointer is safe to compare here because caller verified !is_fetching
-    bool needs_regen = (cached_bg_surface == NULL) ||
-                       (cached_bg_art_ptr != album_art) ||
-                       (cached_bg_art_w != album_art->w) ||
-                       (cached_bg_art_h != album_art->h) ||
-                       (cached_screen_w != hw) ||
-                       (cached_screen_h != hh);
-
-    if (needs_regen) {
-        // Free old cached surface
-        if (cached_bg_surface) {
-            SDL_FreeSurface(cached_bg_surface);
-            cached_bg_surface = NULL;
-        }
-
-        // Calculate dimensions: square background matching screen height
-        // Positioned at bottom-right corner
-        int bg_size = hh;  // Square size = screen height (for square album art)
-        int bg_width = bg_size;
-        int bg_height = bg_size;
-        int bg_x = hw - bg_width;   // Right edge
-        int bg_y = 0;               // Top edge (full height)
-
-        // Create RGBA surface for the masked background
-        cached_bg_surface = SDL_CreateRGBSurfaceWithFormat(0, hw, hh, 32, SDL_PIXELFORMAT_RGBA8888);
-        if (!cached_bg_surface) return;
-
-        // Fill with transparent
-        SDL_FillRect(cached_bg_surface, NULL, 0);
-
-        // Scale album art to cover the square region
-        SDL_Surface* scaled_art = SDL_CreateRGBSurfaceWithFormat(0, bg_width, bg_height, 32, SDL_PIXELFORMAT_RGBA8888);
-        if (!scaled_art) {
-            SDL_FreeSurface(cached_bg_surface);
-            cached_bg_surface = NULL;
-            return;
+#include "profile.h"
+#include "memstats.h"
+#include "art_scale.h"
+
+// Backgrounds of the last few covers, recognised by their pixels: tracks of one
+// album and songs flipped between get the same cover back as a new surface (and a
+// freed surface's address can come back with another cover)
+#define BG_RECENT 3
+
+typedef struct {
+    SDL_Surface* bg;            // Composite of the square at the right edge
+    uint64_t key;               // Cover pixels sampled, with its size
+    int size;                   // Screen height it was built for
+    uint32_t format;            // Screen pixel format it was built in
+    uint32_t used;              // Use order (0 = free)
+} BackgroundEntry;
+
+static BackgroundEntry recent[BG_RECENT];
+static uint32_t recent_clock = 0;
+
+// Alpha of the fade over the square, which only depends on its size
+static uint8_t* mask = NULL;
+static int mask_size = 0;
+
+// Fade from the diagonal (bottom-left of the square to the middle of its top) to
+// the right edge, feathered across it, 80% opaque at most
+static const uint8_t* get_mask(int size) {
+    if (mask && mask_size == size) return mask;
+    MEM_FREE(MEM_TAG_BACKGROUND, mask);
+    mask = MEM_MALLOC(MEM_TAG_BACKGROUND, (size_t)size * size);
+    mask_size = mask ? size : 0;
+    if (!mask) return NULL;
+
+    float max_opacity = 0.80f;  // 80% max opacity at right edge
+    float feather_width = size * 0.20f;  // Feather zone: 20% of background width for soft edge
+
+    for (int y = 0; y < size; y++) {
+        float t = (float)y / size;
+        float diag_x = (size * 0.5f) * (1.0f - t);
+
+        // Total fade distance: from (diag_x - feather_width) to right edge
+        // This creates one continuous smooth gradient
+        float total_width = (size - diag_x) + feather_width;
+        for (int x = 0; x < size; x++) {
+            float adjusted_dist = (float)x - diag_x + feather_width;  // Feather zone starts at 0
+            float opacity = 0.0f;
+            if (adjusted_dist > 0 && total_width > 0) {
+                float fade = adjusted_dist / total_width;
+                if (fade > 1.0f) fade = 1.0f;
+
+                // Apply smooth easing (smoothstep) for seamless transition
+                fade = fade * fade * (3.0f - 2.0f * fade);
+                opacity = fade * max_opacity;
+            }
+            mask[(size_t)y * size + x] = opacity > 0.001f ? (uint8_t)(opacity * 255.0f) : 0;
         }
+    }
+    return mask;
+}
 
-        // Scale the album art to fill the region (crop if needed)
-        int src_w = album_art->w;
-        int src_h = album_art->h;
-
-        // Calculate scale to fill (crop excess)
-        float scale_w = (float)bg_width / src_w;
-        float scale_h = (float)bg_height / src_h;
-        float scale = (scale_w > scale_h) ? scale_w : scale_h;
-
-        int crop_w = (int)(bg_width / scale);
-        int crop_h = (int)(bg_height / scale);
-        int crop_x = (src_w - crop_w) / 2;
-        int crop_y = (src_h - crop_h) / 2;
-
-        if (crop_x < 0) crop_x = 0;
-        if (crop_y < 0) crop_y = 0;
-        if (crop_x + crop_w > src_w) crop_w = src_w - crop_x;
-        if (crop_y + crop_h > src_h) crop_h = src_h - crop_y;
-
-        SDL_Rect src_rect = {crop_x, crop_y, crop_w, crop_h};
-        SDL_Rect dst_rect = {0, 0, bg_width, bg_height};
-        SDL_BlitScaled(album_art, &src_rect, scaled_art, &dst_rect);
-
-        // Apply triangular alpha mask with gradient
-        // Lock surfaces for pixel access
-        if (SDL_LockSurface(scaled_art) != 0 || SDL_LockSurface(cached_bg_surface) != 0) {
-            SDL_FreeSurface(scaled_art);
-            SDL_FreeSurface(cached_bg_surface);
-            cached_bg_surface = NULL;
-            return;
+// Identity of a cover's pixels: its size and a sample of 64 x 64 pixels
+static uint64_t art_key(SDL_Surface* art) {
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ (uint64_t)art->w) * 1099511628211ULL;
+    hash = (hash ^ (uint64_t)art->h) * 1099511628211ULL;
+    hash = (hash ^ art->format->format) * 1099511628211ULL;
+    if (SDL_LockSurface(art) != 0) return hash;
+
+    int bpp = art->format->BytesPerPixel;
+    for (int sy = 0; sy < 64; sy++) {
+        const uint8_t* row = (const uint8_t*)art->pixels + (size_t)(sy * art->h / 64) * art->pitch;
+        for (int sx = 0; sx < 64; sx++) {
+            const uint8_t* px = row + (size_t)(sx * art->w / 64) * bpp;
+            for (int i = 0; i < bpp; i++) hash = (hash ^ px[i]) * 1099511628211ULL;
         }
+    }
+    SDL_UnlockSurface(art);
+    return hash;
+}
 
-        uint32_t* src_pixels = (uint32_t*)scaled_art->pixels;
-        uint32_t* dst_pixels = (uint32_t*)cached_bg_surface->pixels;
-        int src_pitch = scaled_art->pitch / 4;
-        int dst_pitch = cached_bg_surface->pitch / 4;
-
-        float max_opacity = 0.80f;  // 80% max opacity at right edge
-        float feather_width = bg_width * 0.20f;  // Feather zone: 20% of background width for soft edge
-
-        for (int y = 0; y < bg_height; y++) {
-            // Diagonal in SCREEN coordinates: from bottom-left of square to middle-top of square
-            // Square is positioned at (bg_x, bg_y) with size bg_size
-            float t = (float)y / bg_height;
-
-            // Screen coordinates of the diagonal line
-            // At y=0 (top of square): screen_diag_x = bg_x + bg_width/2 (middle of square)
-            // At y=bg_height (bottom of square): screen_diag_x = bg_x (left edge of square)
-            float screen_diag = bg_x + (bg_width * 0.5f) * (1.0f - t);
-
-            // Convert to local coordinates (relative to bg_x)
-            float diag_x = screen_diag - bg_x;
-            if (diag_x < 0) diag_x = 0;  // Clamp to region bounds
-
-            for (int x = 0; x < bg_width; x++) {
-                // Calculate distance from diagonal line (can be negative for feathering)
-                float dist_from_diag = (float)x - diag_x;
-
-                // Calculate opacity based on distance from diagonal with feathering
-                float opacity = 0.0f;
-
-                // Total fade distance: from (diag_x - feather_width) to right edge
-                // This creates one continuous smooth gradient
-                float total_width = (bg_width - diag_x) + feather_width;
-                float adjusted_dist = dist_from_diag + feather_width;  // Shift so feather zone starts at 0
-
-                if (adjusted_dist > 0 && total_width > 0) {
-                    float fade = adjusted_dist / total_width;
-                    if (fade > 1.0f) fade = 1.0f;
-
-                    // Apply smooth easing (smoothstep) for seamless transition
-                    fade = fade * fade * (3.0f - 2.0f * fade);
-
-                    opacity = fade * max_opacity;
-                }
-
-                if (opacity > 0.001f) {
-                    // Get source pixel
-                    uint32_t src_pixel = src_pixels[y * src_pitch + x];
-
-                    // Extract RGB components (SDL_PIXELFORMAT_RGBA8888: R bits 24-31, G 16-23, B 8-15, A 0-7)
-                    uint8_t r = (src_pixel >> 24) & 0xFF;
-                    uint8_t g = (src_pixel >> 16) & 0xFF;
-                    uint8_t b = (src_pixel >> 8) & 0xFF;
-
-                    uint8_t alpha = (uint8_t)(opacity * 255.0f);
+// Scale the cover to fill a square of the screen's height (cropping the excess),
+// faded in by the mask over the cleared (black) screen, in the screen's format:
+// drawing it is then a plain copy, with no per-pixel blending every frame
+static SDL_Surface* build_background(SDL_Surface* album_art, int size, SDL_PixelFormat* format) {
+    const uint8_t* alpha = get_mask(size);
+    if (!alpha) return NULL;
+
+    SDL_Surface* bg = SDL_CreateRGBSurfaceWithFormat(0, size, size, 32, SDL_PIXELFORMAT_RGBA8888);
+    if (!bg) return NULL;
+
+    // Calculate scale to fill (crop excess)
+    int src_w = album_art->w;
+    int src_h = album_art->h;
+    float scale_w = (float)size / src_w;
+    float scale_h = (float)size / src_h;
+    float scale = (scale_w > scale_h) ? scale_w : scale_h;
+
+    int crop_w = (int)(size / scale);
+    int crop_h = (int)(size / scale);
+    int crop_x = (src_w - crop_w) / 2;
+    int crop_y = (src_h - crop_h) / 2;
+
+    if (crop_x < 0) crop_x = 0;
+    if (crop_y < 0) crop_y = 0;
+    if (crop_x + crop_w > src_w) crop_w = src_w - crop_x;
+    if (crop_y + crop_h > src_h) crop_h = src_h - crop_y;
+
+    SDL_Rect src_rect = {crop_x, crop_y, crop_w, crop_h};
+    if (ArtScale_blit(album_art, &src_rect, bg) != 0 || SDL_LockSurface(bg) != 0) {
+        SDL_FreeSurface(bg);
+        return NULL;
+    }
 
-                    // Write to destination at correct screen position (RGBA8888 format)
-                    int dst_x = bg_x + x;
-                    int dst_y = bg_y + y;
-                    if (dst_x >= 0 && dst_x < hw && dst_y >= 0 && dst_y < hh) {
-                        dst_pixels[dst_y * dst_pitch + dst_x] = (r << 24) | (g << 16) | (b << 8) | alpha;
-                    }
-                }
-            }
+    // Blend onto black (SDL_PIXELFORMAT_RGBA8888: R bits 24-31, G 16-23, B 8-15,
+    // A 0-7): each channel scaled by the mask, opaque
+    for (int y = 0; y < size; y++) {
+        uint32_t* px = (uint32_t*)((uint8_t*)bg->pixels + (size_t)y * bg->pitch);
+        const uint8_t* a = alpha + (size_t)y * size;
+        for (int x = 0; x < size; x++) {
+            uint32_t p = px[x];
+            uint32_t m = a[x];
+            uint32_t r = ((p >> 24) * m + 127) / 255;
+            uint32_t g = (((p >> 16) & 0xFF) * m + 127) / 255;
+            uint32_t b = (((p >> 8) & 0xFF) * m + 127) / 255;
+            px[x] = (r << 24) | (g << 16) | (b << 8) | 0xFF;
         }
+    }
+    SDL_UnlockSurface(bg);
 
-        SDL_UnlockSurface(cached_bg_surface);
-        SDL_UnlockSurface(scaled_art);
-        SDL_FreeSurface(scaled_art);
+    SDL_Surface* converted = SDL_ConvertSurface(bg, format, 0);
+    SDL_FreeSurface(bg);
+    if (converted) SDL_SetSurfaceBlendMode(converted, SDL_BLENDMODE_NONE);
+    return converted;
+}
 
-        // Remember source info for cache validation
-        cached_bg_art_ptr = album_art;
-        cached_bg_art_w = album_art->w;
-        cached_bg_art_h = album_art->h;
-        cached_screen_w = hw;
-        cached_screen_h = hh;
+// Background of album_art for screen, built if not recent
+static BackgroundEntry* get_background(SDL_Surface* album_art, SDL_Surface* screen) {
+    int size = screen->h;
+    uint32_t format = screen->format->format;
+    uint64_t key = art_key(album_art);
+    BackgroundEntry* entry = NULL;
+    for (int i = 0; i < BG_RECENT; i++) {
+        if (recent[i].used && recent[i].key == key && recent[i].size == size && recent[i].format == format) {
+            entry = &recent[i];
+        }
     }
+    if (!entry) {
+        SDL_Surface* bg = build_background(album_art, size, screen->format);
+        if (!bg) return NULL;
+
+        // Replace the least recently used
+        entry = &recent[0];
+        for (int i = 1; i < BG_RECENT; i++) {
+            if (recent[i].used < entry->used) entry = &recent[i];
+        }
+        if (entry->bg) {
+            MEM_SURFACE_SUB(MEM_TAG_BACKGROUND, entry->bg);
+            SDL_FreeSurface(entry->bg);
+        }
+        MEM_SURFACE_ADD(MEM_TAG_BACKGROUND, bg);
+        entry->bg = bg;
+        entry->key = key;
+        entry->size = size;
+        entry->format = format;
+    }
+    entry->used = ++recent_clock;
+    return entry;
+}
+
+// Render album art as a triangular background with fade effect
+void render_album_art_background(SDL_Surface* screen, SDL_Surface* album_art) {
+    PROFILE_SCOPE("render_album_art_background");
+    if (!album_art || !screen) return;
+    if (album_art->w <= 0 || album_art->h <= 0) return;
 
-    // Blit the cached background surface
-    if (cached_bg_surface) {
-        SDL_SetSurfaceBlendMode(cached_bg_surface, SDL_BLENDMODE_BLEND);
-        SDL_BlitSurface(cached_bg_surface, NULL, screen, NULL);
+    // Square background matching screen height, at the right edge
+    BackgroundEntry* entry = get_background(album_art, screen);
+    if (entry) {
+        SDL_Rect dst = {screen->w - screen->h, 0, screen->h, screen->h};
+        SDL_BlitSurface(entry->bg, NULL, screen, &dst);
     }
 }
 
-// Cleanup cached background surface (call on exit or when album art changes)
+// Cleanup cached background surfaces (call on exit or when album art changes)
 void cleanup_album_art_background(void) {
-    if (cached_bg_surface) {
-        SDL_FreeSurface(cached_bg_surface);
-        cached_bg_surface = NULL;
+    for (int i = 0; i < BG_RECENT; i++) {
+        if (recent[i].bg) {
+            MEM_SURFACE_SUB(MEM_TAG_BACKGROUND, recent[i].bg);
+            SDL_FreeSurface(recent[i].bg);
+        }
     }
-    cached_bg_art_ptr = NULL;
-    cached_bg_art_w = 0;
-    cached_bg_art_h = 0;
-    cached_screen_w = 0;
-    cached_screen_h = 0;
+    memset(recent, 0, sizeof(recent));
+    MEM_FREE(MEM_TAG_BACKGROUND, mask);
+    mask = NULL;
+    mask_size = 0;
 }
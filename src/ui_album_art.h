@@ -3,11 +3,12 @@
 
 #include <SDL2/SDL.h>
 
-// Render album art as triangular background with fade effect
-// The background is cached internally for performance
+// Render album art as triangular background with fade effect, onto a just
+// cleared screen (the fade is pre-blended with its black)
+// The backgrounds of the last few covers are cached internally for performance
 void render_album_art_background(SDL_Surface* screen, SDL_Surface* album_art);
 
-// Cleanup cached background surface (call on exit or when switching tracks)
+// Cleanup cached background surfaces (call on exit or when switching tracks)
 void cleanup_album_art_background(void);
 
 #endif
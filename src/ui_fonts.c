@@ -2,11 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
+#include <unistd.h>
 
 #include "defines.h"
 #include "api.h"
 #include "config.h"
 #include "ui_fonts.h"
+#include "text_cache.h"
+#include "screen_cache.h"
 
 // Path to Next font (font1.ttf) - supports CJK characters
 #define NEXT_FONT_PATH RES_PATH "/font1.ttf"
@@ -14,89 +18,145 @@
 // Custom font size for title (larger than system fonts)
 #define FONT_TITLE_SIZE 28
 
-// Custom fonts for the interface (except buttons)
+// Custom fonts for the interface (except buttons), in the order they load:
+// the menu and list fonts first, the now playing ones last
+typedef enum {
+    CUSTOM_FONT_LARGE,      // List items, menus (16pt)
+    CUSTOM_FONT_ARTIST,     // Artist name, headers, lists (14pt)
+    CUSTOM_FONT_BADGE,      // Format badge, small text (12pt)
+    CUSTOM_FONT_TINY,       // Genre, bitrate (10pt)
+    CUSTOM_FONT_TITLE,      // Track title (28pt)
+    CUSTOM_FONT_ALBUM,      // Album name (12pt)
+    CUSTOM_FONT_COUNT
+} CustomFontId;
+
+static const int custom_font_sizes[CUSTOM_FONT_COUNT] = {
+    FONT_LARGE, FONT_MEDIUM, FONT_SMALL, FONT_TINY, FONT_TITLE_SIZE, FONT_SMALL
+};
+
 typedef struct {
-    TTF_Font* title;      // Track title (28pt)
-    TTF_Font* large;      // List items, menus (16pt)
-    TTF_Font* artist;     // Artist name (14pt)
-    TTF_Font* album;      // Album name (12pt)
-    TTF_Font* badge;      // Format badge, small text (12pt)
-    TTF_Font* tiny;       // Genre, bitrate (10pt)
-    bool loaded;          // True if custom fonts were loaded
-} CustomFonts;
+    TTF_Font* font;         // NULL if it failed to open (the system font stands in)
+    bool ready;             // Opened (or failed) and warmed: the main thread's from here (atomic)
+} CustomFont;
+
+static CustomFont custom_fonts[CUSTOM_FONT_COUNT];
+static pthread_mutex_t fonts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t fonts_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t fonts_thread;
+static bool fonts_thread_running = false;
+
+// Rasterize the printable ASCII and Latin-1 glyphs into the font's glyph cache,
+// a line of them at a time (a single surface of all of them runs to megabytes)
+static void warm_font(TTF_Font* f) {
+    char line[32 * 2 + 1];
+    int len = 0;
+    for (int c = 0x20; c <= 0xFF; c++) {
+        if (c >= 0x7F && c < 0xA0) continue;   // DEL and the C1 controls
+        if (c < 0x80) {
+            line[len++] = (char)c;
+        } else {
+            line[len++] = (char)(0xC0 | (c >> 6));
+            line[len++] = (char)(0x80 | (c & 0x3F));
+        }
+        if (len >= (int)sizeof(line) - 2 || c == 0xFF) {
+            line[len] = '\0';
+            SDL_Surface* text = TTF_RenderUTF8_Blended(f, line, (SDL_Color){255, 255, 255, 255});
+            if (text) SDL_FreeSurface(text);
+            len = 0;
+        }
+    }
+}
 
-static CustomFonts custom_font = {0};
+// Open and warm one font, then hand it to the main thread
+static void open_font(CustomFontId id) {
+    TTF_Font* f = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(custom_font_sizes[id]));
+    if (f) warm_font(f);
+    pthread_mutex_lock(&fonts_mutex);
+    custom_fonts[id].font = f;
+    __atomic_store_n(&custom_fonts[id].ready, true, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&fonts_cond);
+    pthread_mutex_unlock(&fonts_mutex);
+}
+
+static void* fonts_thread_func(void* arg) {
+    (void)arg;
+    for (int i = 0; i < CUSTOM_FONT_COUNT; i++) open_font((CustomFontId)i);
+    return NULL;
+}
 
 // Load Next font (font1.ttf) at custom sizes
+// The sizes open on a background thread, each glyph-warmed before the main
+// thread gets it; asking for one not there yet waits for just that one, so
+// the first screen only holds up launch for the fonts it draws with. Without
+// the thread they open here.
 void load_custom_fonts(void) {
-    // Load all font sizes from font1.ttf
-    custom_font.title = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(FONT_TITLE_SIZE));
-    custom_font.large = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(FONT_LARGE));
-    custom_font.artist = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(FONT_MEDIUM));
-    custom_font.album = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(FONT_SMALL));
-    custom_font.badge = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(FONT_SMALL));
-    custom_font.tiny = TTF_OpenFont(NEXT_FONT_PATH, SCALE1(FONT_TINY));
-
-    if (custom_font.title && custom_font.large && custom_font.artist &&
-        custom_font.album && custom_font.badge && custom_font.tiny) {
-        custom_font.loaded = true;
-    } else {
-        // Failed to load, cleanup partial loads and fall back to system fonts
-        if (custom_font.title) { TTF_CloseFont(custom_font.title); custom_font.title = NULL; }
-        if (custom_font.large) { TTF_CloseFont(custom_font.large); custom_font.large = NULL; }
-        if (custom_font.artist) { TTF_CloseFont(custom_font.artist); custom_font.artist = NULL; }
-        if (custom_font.album) { TTF_CloseFont(custom_font.album); custom_font.album = NULL; }
-        if (custom_font.badge) { TTF_CloseFont(custom_font.badge); custom_font.badge = NULL; }
-        if (custom_font.tiny) { TTF_CloseFont(custom_font.tiny); custom_font.tiny = NULL; }
-        custom_font.loaded = false;
+    memset(custom_fonts, 0, sizeof(custom_fonts));
+    if (access(NEXT_FONT_PATH, R_OK) != 0) {
+        for (int i = 0; i < CUSTOM_FONT_COUNT; i++) custom_fonts[i].ready = true;
+        return;
     }
+    fonts_thread_running = pthread_create(&fonts_thread, NULL, fonts_thread_func, NULL) == 0;
+    if (!fonts_thread_running) fonts_thread_func(NULL);
 }
 
 // Cleanup custom fonts
 void unload_custom_fonts(void) {
-    if (custom_font.title) { TTF_CloseFont(custom_font.title); custom_font.title = NULL; }
-    if (custom_font.large) { TTF_CloseFont(custom_font.large); custom_font.large = NULL; }
-    if (custom_font.artist) { TTF_CloseFont(custom_font.artist); custom_font.artist = NULL; }
-    if (custom_font.album) { TTF_CloseFont(custom_font.album); custom_font.album = NULL; }
-    if (custom_font.badge) { TTF_CloseFont(custom_font.badge); custom_font.badge = NULL; }
-    if (custom_font.tiny) { TTF_CloseFont(custom_font.tiny); custom_font.tiny = NULL; }
-    custom_font.loaded = false;
+    TextCache_clear();
+    ScreenCache_clear();
+    if (fonts_thread_running) {
+        pthread_join(fonts_thread, NULL);
+        fonts_thread_running = false;
+    }
+    for (int i = 0; i < CUSTOM_FONT_COUNT; i++) {
+        if (custom_fonts[i].font) TTF_CloseFont(custom_fonts[i].font);
+        custom_fonts[i].font = NULL;
+    }
+}
+
+// Custom font id, waiting for it if it hasn't loaded yet, or fallback
+static TTF_Font* custom_font(CustomFontId id, TTF_Font* fallback) {
+    if (!__atomic_load_n(&custom_fonts[id].ready, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&fonts_mutex);
+        while (!custom_fonts[id].ready) pthread_cond_wait(&fonts_cond, &fonts_mutex);
+        pthread_mutex_unlock(&fonts_mutex);
+    }
+    return custom_fonts[id].font ? custom_fonts[id].font : fallback;
 }
 
 // Get font for specific element (custom or system fallback)
 // Title font (28pt) - for track title
 TTF_Font* get_font_title(void) {
-    return custom_font.loaded ? custom_font.title : font.large;
+    return custom_font(CUSTOM_FONT_TITLE, font.large);
 }
 
 // Artist font (14pt) - for artist name
 TTF_Font* get_font_artist(void) {
-    return custom_font.loaded ? custom_font.artist : font.medium;
+    return custom_font(CUSTOM_FONT_ARTIST, font.medium);
 }
 
 // Album font (12pt) - for album name
 TTF_Font* get_font_album(void) {
-    return custom_font.loaded ? custom_font.album : font.medium;
+    return custom_font(CUSTOM_FONT_ALBUM, font.medium);
 }
 
 // Large font for general use (menus, list items)
 TTF_Font* get_font_large(void) {
-    return custom_font.loaded ? custom_font.large : font.large;
+    return custom_font(CUSTOM_FONT_LARGE, font.large);
 }
 
 // Medium font for general use (lists, info)
 TTF_Font* get_font_medium(void) {
-    return custom_font.loaded ? custom_font.artist : font.medium;
+    return custom_font(CUSTOM_FONT_ARTIST, font.medium);
 }
 
 // Small font (badges, secondary text)
 TTF_Font* get_font_small(void) {
-    return custom_font.loaded ? custom_font.badge : font.small;
+    return custom_font(CUSTOM_FONT_BADGE, font.small);
 }
 
 // Tiny font (genre, bitrate)
 TTF_Font* get_font_tiny(void) {
-    return custom_font.loaded ? custom_font.tiny : font.tiny;
+    return custom_font(CUSTOM_FONT_TINY, font.tiny);
 }
 
 // Get text color for list items based on selection state
@@ -117,12 +177,11 @@ int calc_list_pill_width(TTF_Font* font, const char* text, char* truncated, int
     int padding = SCALE1(BUTTON_PADDING * 2);
 
     // Check if text fits without truncation
-    int raw_text_w, raw_text_h;
-    TTF_SizeUTF8(font, text, &raw_text_w, &raw_text_h);
+    int raw_text_w = TextCache_width(font, text);
 
     if (raw_text_w + padding > available_width) {
         // Text needs truncation - extend pill to full width (no right padding gap)
-        GFX_truncateText(font, text, truncated, available_width, padding);
+        TextCache_truncate(font, text, truncated, available_width, padding);
         return max_width;
     }
 
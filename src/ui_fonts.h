@@ -4,7 +4,9 @@
 #include <SDL2/SDL_ttf.h>
 #include <stdbool.h>
 
-// Initialize custom fonts (call once at startup)
+// Initialize custom fonts (call once at startup): they open and get their
+// ASCII and Latin-1 glyphs rasterized on a background thread, and an accessor
+// below waits for its font if that hasn't finished yet
 void load_custom_fonts(void);
 
 // Cleanup custom fonts (call at shutdown)
@@ -7,6 +7,7 @@
 #include "ui_fonts.h"
 #include "ui_utils.h"
 #include "selfupdate.h"
+#include "profile.h"
 
 // Menu items
 static const char* menu_items[] = {"Local Files", "Internet Radio", "MP3 Downloader", "About"};
@@ -27,6 +28,7 @@ static const char* main_menu_get_label(int index, const char* default_label,
 
 // Render the main menu
 void render_menu(SDL_Surface* screen, int show_setting, int menu_selected) {
+    PROFILE_SCOPE("render_menu");
     SimpleMenuConfig config = {
         .title = "Music Player",
         .items = menu_items,
@@ -40,6 +42,7 @@ void render_menu(SDL_Surface* screen, int show_setting, int menu_selected) {
 
 // Render quit confirmation dialog overlay
 void render_quit_confirm(SDL_Surface* screen) {
+    PROFILE_SCOPE("render_quit_confirm");
     int hw = screen->w;
     int hh = screen->h;
 
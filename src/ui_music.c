@@ -6,14 +6,26 @@
 #include "ui_music.h"
 #include "ui_fonts.h"
 #include "ui_utils.h"
+#include "text_cache.h"
 #include "ui_album_art.h"
 #include "spectrum.h"
+#include "library.h"
+#include "album_thumbs.h"
+#include "track_meta.h"
+#include "profile.h"
 
 // Scroll text state for browser list (selected item)
 static ScrollTextState browser_scroll = {0};
 
-// Scroll text state for player title
+// Scroll text state for library search results (selected item)
+static ScrollTextState library_results_scroll = {0};
+
+// Marquees of the now-playing lines (drawn together on the scroll layer)
+static ScrollTextState player_artist_scroll;
 static ScrollTextState player_title_scroll;
+static ScrollTextState player_album_scroll;
+static ScrollTextState* const player_marquees[] = {&player_artist_scroll, &player_title_scroll, &player_album_scroll};
+#define PLAYER_MARQUEE_COUNT (int)(sizeof(player_marquees) / sizeof(player_marquees[0]))
 
 // Playtime GPU state
 static int playtime_x = 0, playtime_y = 0, playtime_dur_x = 0;
@@ -21,21 +33,41 @@ static int last_rendered_position = -1;
 static int last_rendered_duration = -1;
 static bool playtime_position_set = false;
 
+// "12 tracks, 1h 04m, FLAC" for a folder row (the format only when they share one)
+static void folder_stats_text(const LibraryFolderStats* stats, char* out, size_t size) {
+    int minutes = (int)((stats->duration_ms + 30000) / 60000);
+    char length[32];
+    if (minutes >= 60) {
+        snprintf(length, sizeof(length), "%dh %02dm", minutes / 60, minutes % 60);
+    } else {
+        snprintf(length, sizeof(length), "%d min", minutes);
+    }
+    uint16_t formats = stats->formats;
+    bool one_format = formats && !(formats & (formats - 1));
+    snprintf(out, size, "%u %s, %s%s%s", stats->files, stats->files == 1 ? "track" : "tracks", length,
+             one_format ? ", " : "", one_format ? get_format_name((AudioFormat)__builtin_ctz(formats)) : "");
+}
+
 // Render the file browser
 void render_browser(SDL_Surface* screen, int show_setting, BrowserContext* browser) {
-    GFX_clear(screen);
-
+    PROFILE_SCOPE("render_browser");
     int hw = screen->w;
     int hh = screen->h;
     char truncated[256];
 
-    render_screen_header(screen, "Music Player", show_setting);
-
     // Use common list layout calculation
     ListLayout layout = calc_list_layout(screen, 0);
     browser->items_per_page = layout.items_per_page;
 
     adjust_list_scroll(browser->selected, &browser->scroll_offset, browser->items_per_page);
+    TrackMeta_request(browser, browser->scroll_offset, browser->items_per_page);
+
+    // Only the selection moved: repaint its old and new rows
+    int previous = list_rows_only(browser, browser->scroll_offset, browser->selected, show_setting);
+    if (previous < 0) {
+        GFX_clear(screen);
+        render_screen_header(screen, "Music Player", show_setting);
+    }
 
     for (int i = 0; i < browser->items_per_page && browser->scroll_offset + i < browser->entry_count; i++) {
         int idx = browser->scroll_offset + i;
@@ -43,13 +75,42 @@ void render_browser(SDL_Surface* screen, int show_setting, BrowserContext* brows
         bool selected = (idx == browser->selected);
 
         int y = layout.list_y + i * layout.item_h;
+        if (previous >= 0) {
+            if (idx != previous && !selected) continue;
+            list_clear_row(screen, y, layout.item_h);
+        }
 
         // Icon or folder indicator
         char display[256];
+        const char* name = Browser_string(browser, entry->name);
         if (entry->is_dir) {
-            snprintf(display, sizeof(display), "[%s]", entry->name);
+            // Totals from the library index, not the card
+            char path[512], stats_text[96];
+            LibraryFolderStats stats;
+            Browser_getPath(browser, entry, path, sizeof(path));
+            if (entry->file && Library_folderStats(path, &stats) && stats.files > 0) {
+                folder_stats_text(&stats, stats_text, sizeof(stats_text));
+                snprintf(display, sizeof(display), "[%s]  %s", name, stats_text);
+            } else {
+                snprintf(display, sizeof(display), "[%s]", name);
+            }
+        } else if (entry->is_playlist) {
+            snprintf(display, sizeof(display), "%s", name);  // Extension marks it as a playlist
+        } else if (entry->cue_track) {
+            snprintf(display, sizeof(display), "%02d. %s", entry->cue_track, name);
         } else {
-            Browser_getDisplayName(entry->name, display, sizeof(display));
+            // Tags once loaded, the file name until then
+            char path[512], title[128], artist[96];
+            Browser_getPath(browser, entry, path, sizeof(path));
+            if (TrackMeta_get(path, title, sizeof(title), artist, sizeof(artist)) && title[0]) {
+                if (artist[0]) {
+                    snprintf(display, sizeof(display), "%s - %s", artist, title);
+                } else {
+                    snprintf(display, sizeof(display), "%s", title);
+                }
+            } else {
+                Browser_getDisplayName(name, display, sizeof(display));
+            }
         }
 
         // Render pill background and get text position
@@ -61,6 +122,7 @@ void render_browser(SDL_Surface* screen, int show_setting, BrowserContext* brows
     }
 
     render_scroll_indicators(screen, browser->scroll_offset, browser->items_per_page, browser->entry_count);
+    if (previous >= 0) return;
 
     // Empty folder message
     if (browser->entry_count == 0) {
@@ -73,13 +135,201 @@ void render_browser(SDL_Surface* screen, int show_setting, BrowserContext* brows
     }
 
     // Button hints
-    GFX_blitButtonGroup((char*[]){"U/D", "SCROLL", NULL}, 0, screen, 0);
+    GFX_blitButtonGroup((char*[]){"R1", "ALBUMS", "Y", "SEARCH", "X", "PLAY ALL", NULL}, 0, screen, 0);
     GFX_blitButtonGroup((char*[]){"B", "BACK", "A", "SELECT", NULL}, 1, screen, 1);
 }
 
+// Render library search results
+void render_library_results(SDL_Surface* screen, int show_setting, const char* search_query,
+                            const int* results, int result_count, int selected, int* scroll) {
+    PROFILE_SCOPE("render_library_results");
+    int hw = screen->w;
+    int hh = screen->h;
+    char truncated[256];
+
+    ListLayout layout = calc_list_layout(screen, 0);
+    adjust_list_scroll(selected, scroll, layout.items_per_page);
+
+    int previous = list_rows_only(results, *scroll, selected, show_setting);
+    if (previous < 0) {
+        GFX_clear(screen);
+        char title[128];
+        snprintf(title, sizeof(title), "Search: %s", search_query);
+        render_screen_header(screen, title, show_setting);
+    }
+
+    for (int i = 0; i < layout.items_per_page && *scroll + i < result_count; i++) {
+        int idx = *scroll + i;
+        const LibraryRecord* record = Library_record(results[idx]);
+        if (!record) continue;
+        bool is_selected = (idx == selected);
+        int y = layout.list_y + i * layout.item_h;
+        if (previous >= 0) {
+            if (idx != previous && !is_selected) continue;
+            list_clear_row(screen, y, layout.item_h);
+        }
+
+        char display[512];
+        const char* artist = Library_string(record->artist);
+        if (artist[0]) {
+            snprintf(display, sizeof(display), "%s - %s", Library_string(record->title), artist);
+        } else {
+            snprintf(display, sizeof(display), "%s", Library_string(record->title));
+        }
+
+        ListItemPos pos = render_list_item_pill(screen, &layout, display, truncated, y, is_selected, 0);
+        render_list_item_text(screen, &library_results_scroll, display, get_font_medium(),
+                              pos.text_x, pos.text_y, pos.pill_width - SCALE1(BUTTON_PADDING * 2), is_selected);
+    }
+
+    render_scroll_indicators(screen, *scroll, layout.items_per_page, result_count);
+    if (previous >= 0) return;
+
+    if (result_count == 0) {
+        const char* msg = Library_isScanning() && Library_count() == 0 ? "Indexing library..." : "No results found";
+        SDL_Surface* text = TTF_RenderUTF8_Blended(get_font_large(), msg, COLOR_GRAY);
+        if (text) {
+            SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){(hw - text->w) / 2, hh / 2 - text->h / 2});
+            SDL_FreeSurface(text);
+        }
+    }
+
+    GFX_blitButtonGroup((char*[]){"X", "ALBUM", "Y", "ARTIST", NULL}, 0, screen, 0);
+    GFX_blitButtonGroup((char*[]){"B", "BACK", "A", "PLAY", NULL}, 1, screen, 1);
+}
+
+// Album grid geometry: thumbnails at their stored size in rows of columns, the
+// selected album's name on a line below; never more visible than atlas cells
+typedef struct {
+    int x, y;            // Top left of the first cell
+    int cell;            // Thumbnail plus gap
+    int columns;
+    int rows;
+    int name_y;
+} AlbumGridLayout;
+
+static AlbumGridLayout calc_album_grid_layout(SDL_Surface* screen) {
+    ListLayout list = calc_list_layout(screen, 0);
+    AlbumGridLayout grid;
+    int gap = SCALE1(PADDING);
+    int name_h = TTF_FontHeight(get_font_medium());
+    grid.cell = ALBUM_THUMB_SIZE + gap;
+    grid.columns = (list.max_width + gap) / grid.cell;
+    if (grid.columns < 1) grid.columns = 1;
+    grid.rows = (list.list_h - name_h + gap) / grid.cell;
+    if (grid.rows < 1) grid.rows = 1;
+    while (grid.rows > 1 && grid.rows * grid.columns > ALBUM_THUMBS_ATLAS_CELLS - grid.columns) grid.rows--;
+    grid.x = (screen->w - (grid.columns * grid.cell - gap)) / 2;
+    grid.y = list.list_y;
+    grid.name_y = grid.y + grid.rows * grid.cell;
+    return grid;
+}
+
+int album_grid_columns(SDL_Surface* screen) {
+    return calc_album_grid_layout(screen).columns;
+}
+
+// Render the album grid (string offsets from Library_albums); *scroll is in rows
+void render_album_grid(SDL_Surface* screen, int show_setting, const uint32_t* albums, int album_count,
+                       int selected, int* scroll) {
+    PROFILE_SCOPE("render_album_grid");
+    int hw = screen->w;
+    int hh = screen->h;
+    AlbumGridLayout grid = calc_album_grid_layout(screen);
+    int total_rows = (album_count + grid.columns - 1) / grid.columns;
+    adjust_list_scroll(selected / grid.columns, scroll, grid.rows);
+
+    GFX_clear(screen);
+    render_screen_header(screen, "Albums", show_setting);
+
+    uint32_t placeholder = SDL_MapRGB(screen->format, 0x28, 0x28, 0x28);
+    uint32_t highlight = SDL_MapRGB(screen->format, 0xFF, 0xFF, 0xFF);
+    int border = SCALE1(2);
+    for (int row = 0; row < grid.rows; row++) {
+        for (int col = 0; col < grid.columns; col++) {
+            int idx = (*scroll + row) * grid.columns + col;
+            if (idx >= album_count) break;
+            SDL_Rect dst = {grid.x + col * grid.cell, grid.y + row * grid.cell, ALBUM_THUMB_SIZE, ALBUM_THUMB_SIZE};
+            if (idx == selected) {
+                SDL_FillRect(screen, &(SDL_Rect){dst.x - border, dst.y - border, dst.w + border * 2, dst.h + border * 2},
+                             highlight);
+            }
+            // Cells come from the atlas by rect; albums still loading get a placeholder
+            SDL_Surface* atlas;
+            SDL_Rect src;
+            if (AlbumThumbs_get(albums[idx], &atlas, &src)) {
+                SDL_BlitSurface(atlas, &src, screen, &dst);
+            } else {
+                SDL_FillRect(screen, &dst, placeholder);
+            }
+        }
+    }
+
+    render_scroll_indicators(screen, *scroll, grid.rows, total_rows);
+
+    if (album_count == 0) {
+        const char* msg = Library_isScanning() && Library_count() == 0 ? "Indexing library..." : "No albums found";
+        SDL_Surface* text = TTF_RenderUTF8_Blended(get_font_large(), msg, COLOR_GRAY);
+        if (text) {
+            SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){(hw - text->w) / 2, hh / 2 - text->h / 2});
+            SDL_FreeSurface(text);
+        }
+    } else if (selected >= 0 && selected < album_count) {
+        char truncated[256];
+        TextCache_truncate(get_font_medium(), Library_string(albums[selected]), truncated, hw - SCALE1(PADDING * 2), 0);
+        SDL_Surface* name = TextCache_render(get_font_medium(), truncated, COLOR_WHITE);
+        if (name) {
+            SDL_BlitSurface(name, NULL, screen, &(SDL_Rect){(hw - name->w) / 2, grid.name_y});
+        }
+    }
+
+    GFX_blitButtonGroup((char*[]){"B", "BACK", "A", "PLAY", NULL}, 1, screen, 1);
+}
+
+// Scrub target over the waveform: bars before it white, the rest gray, a marker
+// and the target time above it. A flat line stands in until the waveform is scanned.
+static void render_scrub_preview(SDL_Surface* screen, int x, int y, int w, int h, int target_ms, int duration) {
+    const WaveformData* waveform = Player_getWaveform();
+    float target = (duration > 0) ? (float)target_ms / duration : 0.0f;
+    int marker_x = x + (int)(target * w);
+
+    if (waveform->valid && waveform->bar_count > 0) {
+        int count = waveform->bar_count;
+        for (int i = 0; i < count; i++) {
+            int bar_x = x + i * w / count;
+            int bar_w = x + (i + 1) * w / count - bar_x - 1;  // 1px gap
+            if (bar_w < 1) bar_w = 1;
+            int bar_h = (int)(waveform->bars[i] * h);
+            if (bar_h < SCALE1(1)) bar_h = SCALE1(1);
+            SDL_Rect bar = {bar_x, y + (h - bar_h) / 2, bar_w, bar_h};
+            SDL_FillRect(screen, &bar, bar_x < marker_x ? RGB_WHITE : RGB_GRAY);
+        }
+    } else {
+        SDL_Rect line = {x, y + h / 2, w, SCALE1(1)};
+        SDL_FillRect(screen, &line, RGB_GRAY);
+        line.w = marker_x - x;
+        SDL_FillRect(screen, &line, RGB_WHITE);
+    }
+
+    SDL_Rect marker = {marker_x - SCALE1(1), y, SCALE1(2), h};
+    SDL_FillRect(screen, &marker, RGB_WHITE);
+
+    char time_str[16];
+    format_time(time_str, target_ms);
+    SDL_Surface* time_surf = TTF_RenderUTF8_Blended(get_font_small(), time_str, COLOR_WHITE);
+    if (time_surf) {
+        int time_x = marker_x - time_surf->w / 2;
+        if (time_x < x) time_x = x;
+        if (time_x > x + w - time_surf->w) time_x = x + w - time_surf->w;
+        SDL_BlitSurface(time_surf, NULL, screen, &(SDL_Rect){time_x, y - time_surf->h - SCALE1(2)});
+        SDL_FreeSurface(time_surf);
+    }
+}
+
 // Render the now playing screen
-void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* browser,
+void render_playing(SDL_Surface* screen, int show_setting, int track_num, int total_tracks,
                     bool shuffle_enabled, bool repeat_enabled) {
+    PROFILE_SCOPE("render_playing");
     GFX_clear(screen);
 
     // Render album art as triangular background (if available)
@@ -91,10 +341,13 @@ void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* brows
     int hw = screen->w;
     int hh = screen->h;
 
-    const TrackInfo* info = Player_getTrackInfo();
-    PlayerState state = Player_getState();
-    AudioFormat format = Player_detectFormat(Player_getCurrentFile());
-    int duration = Player_getDuration();
+    // One consistent copy for the frame; the loader may be changing the track meanwhile
+    PlayerSnapshot snapshot;
+    Player_getSnapshot(&snapshot);
+    const TrackInfo* info = &snapshot.track;
+    PlayerState state = snapshot.state;
+    AudioFormat format = Player_detectFormat(snapshot.file);
+    int duration = snapshot.duration_ms;
     int position = Player_getPosition();
     float progress = (duration > 0) ? (float)position / duration : 0.0f;
 
@@ -121,8 +374,6 @@ void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* brows
     }
 
     // Track counter "01 - 03" (smaller, gray) - after the format badge
-    int track_num = Browser_getCurrentTrackNumber(browser);
-    int total_tracks = Browser_countAudioFiles(browser);
     char track_str[32];
     snprintf(track_str, sizeof(track_str), "%02d - %02d", track_num, total_tracks);
     SDL_Surface* track_surf = TTF_RenderUTF8_Blended(get_font_tiny(), track_str, COLOR_GRAY);
@@ -137,57 +388,27 @@ void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* brows
     GFX_blitHardwareGroup(screen, show_setting);
 
     // === TRACK INFO SECTION ===
+    // Lines too long to fit scroll on the GPU layer (no background) instead of
+    // being truncated; the screen behind them is drawn once
     int info_y = SCALE1(PADDING + 45);
-    char truncated[256];
 
     // Max width for text (album art is now only shown as background)
     int max_w_text = hw - SCALE1(PADDING * 2);
 
     // Artist name (Medium font, gray)
     const char* artist = info->artist[0] ? info->artist : "Unknown Artist";
-    GFX_truncateText(get_font_artist(), artist, truncated, max_w_text, 0);
-    SDL_Surface* artist_surf = TTF_RenderUTF8_Blended(get_font_artist(), truncated, COLOR_GRAY);
-    if (artist_surf) {
-        SDL_BlitSurface(artist_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), info_y});
-        info_y += artist_surf->h + SCALE1(2);  // Same gap as title-album
-        SDL_FreeSurface(artist_surf);
-    } else {
-        info_y += SCALE1(18);
-    }
+    info_y += ScrollText_placeLine(&player_artist_scroll, artist, get_font_artist(), COLOR_GRAY,
+                                   screen, SCALE1(PADDING), info_y, max_w_text) + SCALE1(2);  // Same gap as title-album
 
-    // Song title (Regular font extra large, white) - with GPU scrolling animation (no background)
+    // Song title (Regular font extra large, white)
     const char* title = info->title[0] ? info->title : "Unknown Title";
-    int title_y = info_y;  // Save for GPU scroll
-
-    // Check if text changed and reset scroll state
-    if (strcmp(player_title_scroll.text, title) != 0) {
-        ScrollText_reset(&player_title_scroll, title, get_font_title(), max_w_text, true);  // true = GPU mode
-    }
-
-    // If text needs scrolling, use GPU layer (no background)
-    if (player_title_scroll.needs_scroll) {
-        ScrollText_renderGPU_NoBg(&player_title_scroll, get_font_title(), COLOR_WHITE, SCALE1(PADDING), title_y);
-    } else {
-        // Static text - render to screen surface
-        PLAT_clearLayers(LAYER_SCROLLTEXT);
-        SDL_Surface* title_surf = TTF_RenderUTF8_Blended(get_font_title(), title, COLOR_WHITE);
-        if (title_surf) {
-            SDL_BlitSurface(title_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), title_y, 0, 0});
-            SDL_FreeSurface(title_surf);
-        }
-    }
-    info_y += TTF_FontHeight(get_font_title()) + SCALE1(2);  // Smaller gap after title
+    info_y += ScrollText_placeLine(&player_title_scroll, title, get_font_title(), COLOR_WHITE,
+                                   screen, SCALE1(PADDING), info_y, max_w_text) + SCALE1(2);  // Smaller gap after title
 
     // Album name (Bold font smaller, gray)
-    const char* album = info->album[0] ? info->album : "";
-    if (album[0]) {
-        GFX_truncateText(get_font_album(), album, truncated, max_w_text, 0);
-        SDL_Surface* album_surf = TTF_RenderUTF8_Blended(get_font_album(), truncated, COLOR_GRAY);
-        if (album_surf) {
-            SDL_BlitSurface(album_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), info_y});
-            SDL_FreeSurface(album_surf);
-        }
-    }
+    ScrollText_placeLine(&player_album_scroll, info->album, get_font_album(), COLOR_GRAY,
+                         screen, SCALE1(PADDING), info_y, max_w_text);
+    ScrollText_renderMarquees(player_marquees, PLAYER_MARQUEE_COUNT);
 
     // === SPECTRUM SECTION (GPU rendered) ===
     int spec_y = hh - SCALE1(PADDING + BUTTON_SIZE + BUTTON_MARGIN + 90);
@@ -198,6 +419,12 @@ void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* brows
     // Set position for GPU rendering (actual rendering happens in main loop)
     Spectrum_setPosition(spec_x, spec_y, spec_w, spec_h);
 
+    // While scrubbing, the waveform overview takes the spectrum's place
+    int scrub_ms = Player_getSeekPreview();
+    if (scrub_ms >= 0) {
+        render_scrub_preview(screen, spec_x, spec_y, spec_w, spec_h, scrub_ms, duration);
+    }
+
     // === BOTTOM BAR ===
     int bottom_y = hh - SCALE1(PADDING + BUTTON_SIZE + BUTTON_MARGIN + 35);
 
@@ -210,8 +437,10 @@ void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* brows
     // Shuffle and Repeat labels on right side
     int label_x = hw - SCALE1(PADDING);
 
-    // Repeat label
-    const char* repeat_text = "REPEAT";
+    // Repeat label (A-B while part of the track loops)
+    bool ab_loop = Player_hasLoop();
+    if (ab_loop) repeat_enabled = true;
+    const char* repeat_text = ab_loop ? "A-B" : "REPEAT";
     SDL_Color repeat_color = repeat_enabled ? COLOR_WHITE : COLOR_GRAY;
     SDL_Surface* repeat_surf = TTF_RenderUTF8_Blended(get_font_tiny(), repeat_text, repeat_color);
     if (repeat_surf) {
@@ -256,19 +485,30 @@ void browser_animate_scroll(void) {
     ScrollText_animateOnly(&browser_scroll);
 }
 
-// Check if player title has active scrolling (for refresh optimization)
+// Check if library results list has active scrolling (for refresh optimization)
+bool library_results_needs_scroll_refresh(void) {
+    return ScrollText_isScrolling(&library_results_scroll);
+}
+
+// Animate library results scroll only (GPU mode, no screen redraw needed)
+void library_results_animate_scroll(void) {
+    ScrollText_animateOnly(&library_results_scroll);
+}
+
+// Check if a player line has active scrolling (for refresh optimization)
 bool player_needs_scroll_refresh(void) {
     // Only scroll when playing, not when paused
     if (Player_getState() != PLAYER_STATE_PLAYING) return false;
-    return ScrollText_isScrolling(&player_title_scroll);
+    for (int i = 0; i < PLAYER_MARQUEE_COUNT; i++) {
+        if (ScrollText_isScrolling(player_marquees[i])) return true;
+    }
+    return false;
 }
 
-// Animate player title scroll (GPU mode, no screen redraw needed)
+// Animate player line scroll (GPU mode, no screen redraw needed)
 void player_animate_scroll(void) {
-    if (!player_title_scroll.text[0] || !player_title_scroll.needs_scroll) return;
-    ScrollText_renderGPU_NoBg(&player_title_scroll, player_title_scroll.last_font,
-                              player_title_scroll.last_color,
-                              player_title_scroll.last_x, player_title_scroll.last_y);
+    PROFILE_SCOPE("player_animate_scroll");
+    ScrollText_renderMarquees(player_marquees, PLAYER_MARQUEE_COUNT);
 }
 
 // === PLAYTIME GPU FUNCTIONS ===
@@ -292,7 +532,8 @@ bool PlayTime_needsRefresh(void) {
     // Only update when playing, not when paused
     if (Player_getState() != PLAYER_STATE_PLAYING) return false;
 
-    int position = Player_getPosition();
+    // Position moves every frame, the text only when its second does
+    int position = Player_getPosition() / 1000;
     int duration = Player_getDuration();
 
     // Only refresh if position changed (updates once per second)
@@ -300,15 +541,16 @@ bool PlayTime_needsRefresh(void) {
 }
 
 void PlayTime_renderGPU(void) {
+    PROFILE_SCOPE("PlayTime_renderGPU");
     if (!playtime_position_set) return;
 
     int position = Player_getPosition();
     int duration = Player_getDuration();
 
     // Skip if nothing changed
-    if (position == last_rendered_position && duration == last_rendered_duration) return;
+    if (position / 1000 == last_rendered_position && duration == last_rendered_duration) return;
 
-    last_rendered_position = position;
+    last_rendered_position = position / 1000;
     last_rendered_duration = duration;
 
     // Render position text
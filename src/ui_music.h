@@ -12,8 +12,19 @@
 // Render the file browser screen
 void render_browser(SDL_Surface* screen, int show_setting, BrowserContext* browser);
 
-// Render the now playing screen
-void render_playing(SDL_Surface* screen, int show_setting, BrowserContext* browser,
+// Render library search results (record indexes from Library_search)
+void render_library_results(SDL_Surface* screen, int show_setting, const char* search_query,
+                            const int* results, int result_count, int selected, int* scroll);
+
+// Render the album grid (string offsets from Library_albums); *scroll is in rows
+void render_album_grid(SDL_Surface* screen, int show_setting, const uint32_t* albums, int album_count,
+                       int selected, int* scroll);
+
+// Albums per row of the grid (for moving the selection up and down)
+int album_grid_columns(SDL_Surface* screen);
+
+// Render the now playing screen (track_num is 1-based, 0 = none)
+void render_playing(SDL_Surface* screen, int show_setting, int track_num, int total_tracks,
                     bool shuffle_enabled, bool repeat_enabled);
 
 // Check if browser list has active scrolling (for refresh optimization)
@@ -22,10 +33,16 @@ bool browser_needs_scroll_refresh(void);
 // Animate browser scroll only (GPU mode, no screen redraw needed)
 void browser_animate_scroll(void);
 
-// Check if player title has active scrolling (for refresh optimization)
+// Check if library results list has active scrolling (for refresh optimization)
+bool library_results_needs_scroll_refresh(void);
+
+// Animate library results scroll only (GPU mode, no screen redraw needed)
+void library_results_animate_scroll(void);
+
+// Check if a player line has active scrolling (for refresh optimization)
 bool player_needs_scroll_refresh(void);
 
-// Animate player title scroll (GPU mode, no screen redraw needed)
+// Animate player line scroll (GPU mode, no screen redraw needed)
 void player_animate_scroll(void);
 
 // Playtime GPU rendering functions
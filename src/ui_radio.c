@@ -7,20 +7,29 @@
 #include "ui_radio.h"
 #include "ui_fonts.h"
 #include "ui_utils.h"
+#include "text_cache.h"
+#include "screen_cache.h"
 #include "ui_album_art.h"
 #include "radio_album_art.h"
 #include "radio_curated.h"
+#include "radio_probe.h"
+#include "radio_net.h"
+#include "profile.h"
+
+// Marquees of the radio player's lines (drawn together on the scroll layer)
+static ScrollTextState radio_genre_scroll;
+static ScrollTextState radio_name_scroll;
+static ScrollTextState radio_artist_scroll;
+static ScrollTextState* const radio_marquees[] = {&radio_genre_scroll, &radio_name_scroll, &radio_artist_scroll};
+#define RADIO_MARQUEE_COUNT (int)(sizeof(radio_marquees) / sizeof(radio_marquees[0]))
 
 // Render the radio station list
 void render_radio_list(SDL_Surface* screen, int show_setting,
                        int radio_selected, int* radio_scroll) {
-    GFX_clear(screen);
-
+    PROFILE_SCOPE("render_radio_list");
     int hw = screen->w;
     char truncated[256];
 
-    render_screen_header(screen, "Internet Radio", show_setting);
-
     // Station list
     RadioStation* stations;
     int station_count = Radio_getStations(&stations);
@@ -29,12 +38,23 @@ void render_radio_list(SDL_Surface* screen, int show_setting,
     ListLayout layout = calc_list_layout(screen, 0);
     adjust_list_scroll(radio_selected, radio_scroll, layout.items_per_page);
 
+    // Only the selection moved: repaint its old and new rows
+    int previous = list_rows_only(stations, *radio_scroll, radio_selected, show_setting);
+    if (previous < 0) {
+        GFX_clear(screen);
+        render_screen_header(screen, "Internet Radio", show_setting);
+    }
+
     for (int i = 0; i < layout.items_per_page && *radio_scroll + i < station_count; i++) {
         int idx = *radio_scroll + i;
         RadioStation* station = &stations[idx];
         bool selected = (idx == radio_selected);
 
         int y = layout.list_y + i * layout.item_h;
+        if (previous >= 0) {
+            if (idx != previous && !selected) continue;
+            list_clear_row(screen, y, layout.item_h);
+        }
 
         // Render pill background and get text position
         ListItemPos pos = render_list_item_pill(screen, &layout, station->name, truncated, y, selected, 0);
@@ -46,18 +66,19 @@ void render_radio_list(SDL_Surface* screen, int show_setting,
         // Genre (if available)
         if (station->genre[0]) {
             SDL_Color genre_color = selected ? COLOR_GRAY : COLOR_DARK_TEXT;
-            SDL_Surface* genre_text = TTF_RenderUTF8_Blended(get_font_tiny(), station->genre, genre_color);
+            SDL_Surface* genre_text = TextCache_render(get_font_tiny(), station->genre, genre_color);
             if (genre_text) {
                 SDL_BlitSurface(genre_text, NULL, screen, &(SDL_Rect){hw - genre_text->w - SCALE1(PADDING * 2), y + (layout.item_h - genre_text->h) / 2});
-                SDL_FreeSurface(genre_text);
             }
         }
     }
 
     render_scroll_indicators(screen, *radio_scroll, layout.items_per_page, station_count);
+    if (previous >= 0) return;
 
     // Button hints
-    GFX_blitButtonGroup((char*[]){"Y", "MANAGE STATIONS", NULL}, 0, screen, 0);
+    GFX_blitButtonGroup((char*[]){"X", radio_net_dataSaver() ? "SAVER ON" : "SAVER OFF",
+                                  "Y", "MANAGE STATIONS", NULL}, 0, screen, 0);
     GFX_blitButtonGroup((char*[]){"B", "BACK", "A", "PLAY", NULL}, 1, screen, 1);
 }
 
@@ -73,10 +94,11 @@ static RadioStation* get_station_by_index(int index) {
 
 // Render the radio playing screen
 void render_radio_playing(SDL_Surface* screen, int show_setting, int radio_selected) {
+    PROFILE_SCOPE("render_radio_playing");
     GFX_clear(screen);
 
     // Render album art as triangular background (if available and not being fetched)
-    // Skip during fetch to avoid accessing potentially invalid surface
+    // Skip during fetch: the surface is still the previous song's
     if (!radio_album_art_is_fetching()) {
         SDL_Surface* album_art = Radio_getAlbumArt();
         if (album_art && album_art->w > 0 && album_art->h > 0) {
@@ -89,7 +111,9 @@ void render_radio_playing(SDL_Surface* screen, int show_setting, int radio_selec
     char truncated[256];
 
     RadioState state = Radio_getState();
-    const RadioMetadata* meta = Radio_getMetadata();
+    RadioMetadata metadata;
+    Radio_getMetadata(&metadata);
+    const RadioMetadata* meta = &metadata;
     RadioStation* current_station = get_station_by_index(radio_selected);
     RadioStation* stations;
     int station_count = Radio_getStations(&stations);
@@ -137,29 +161,16 @@ void render_radio_playing(SDL_Surface* screen, int show_setting, int radio_selec
     int max_w_full = hw - SCALE1(PADDING * 2);
 
     // Genre (like Artist in local player) - gray, medium font
+    // It, the station name and the artist scroll on the GPU layer when too long
     const char* genre = (current_station && current_station->genre[0]) ? current_station->genre : "Radio";
-    GFX_truncateText(get_font_artist(), genre, truncated, max_w_half, 0);
-    SDL_Surface* genre_surf = TTF_RenderUTF8_Blended(get_font_artist(), truncated, COLOR_GRAY);
-    if (genre_surf) {
-        SDL_BlitSurface(genre_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), info_y});
-        info_y += genre_surf->h + SCALE1(2);
-        SDL_FreeSurface(genre_surf);
-    } else {
-        info_y += SCALE1(18);
-    }
+    info_y += ScrollText_placeLine(&radio_genre_scroll, genre, get_font_artist(), COLOR_GRAY,
+                                   screen, SCALE1(PADDING), info_y, max_w_half) + SCALE1(2);
 
     // Station name (like Title in local player) - white, large font
     const char* station_name = meta->station_name[0] ? meta->station_name :
                                (current_station ? current_station->name : "Unknown Station");
-    GFX_truncateText(get_font_title(), station_name, truncated, max_w_full, 0);
-    SDL_Surface* name_surf = TTF_RenderUTF8_Blended(get_font_title(), truncated, COLOR_WHITE);
-    if (name_surf) {
-        SDL_BlitSurface(name_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), info_y});
-        info_y += name_surf->h + SCALE1(2);
-        SDL_FreeSurface(name_surf);
-    } else {
-        info_y += SCALE1(32);
-    }
+    info_y += ScrollText_placeLine(&radio_name_scroll, station_name, get_font_title(), COLOR_WHITE,
+                                   screen, SCALE1(PADDING), info_y, max_w_full) + SCALE1(2);
 
     // Now Playing - Title on top (white, large), Artist below (gray, small)
     if (meta->title[0]) {
@@ -227,20 +238,15 @@ void render_radio_playing(SDL_Surface* screen, int show_setting, int radio_selec
             lines_rendered++;
         }
     }
-    if (meta->artist[0]) {
-        // Artist line (smaller font)
-        GFX_truncateText(get_font_small(), meta->artist, truncated, max_w_full, 0);
-        SDL_Surface* artist_surf = TTF_RenderUTF8_Blended(get_font_small(), truncated, COLOR_GRAY);
-        if (artist_surf) {
-            SDL_BlitSurface(artist_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), info_y});
-            info_y += artist_surf->h + SCALE1(2);
-            SDL_FreeSurface(artist_surf);
-        }
-    }
+    // Artist line (smaller font)
+    int artist_h = ScrollText_placeLine(&radio_artist_scroll, meta->artist, get_font_small(), COLOR_GRAY,
+                                        screen, SCALE1(PADDING), info_y, max_w_full);
+    if (meta->artist[0]) info_y += artist_h + SCALE1(2);
+    ScrollText_renderMarquees(radio_marquees, RADIO_MARQUEE_COUNT);
 
     // Show slogan if no title/artist available
     if (!meta->title[0] && !meta->artist[0] && current_station && current_station->slogan[0]) {
-        GFX_truncateText(get_font_album(), current_station->slogan, truncated, max_w_full, 0);
+        TextCache_truncate(get_font_album(), current_station->slogan, truncated, max_w_full, 0);
         SDL_Surface* slogan_surf = TTF_RenderUTF8_Blended(get_font_album(), truncated, COLOR_GRAY);
         if (slogan_surf) {
             SDL_BlitSurface(slogan_surf, NULL, screen, &(SDL_Rect){SCALE1(PADDING), info_y});
@@ -275,28 +281,22 @@ void render_radio_playing(SDL_Surface* screen, int show_setting, int radio_selec
     }
 
     // === BUTTON HINTS ===
-    GFX_blitButtonGroup((char*[]){"U/D", "PREV/NEXT", NULL}, 0, screen, 0);
-    GFX_blitButtonGroup((char*[]){"B", "STOP", NULL}, 1, screen, 1);
+    if (Radio_canTimeshift()) {
+        GFX_blitButtonGroup((char*[]){"U/D", "PREV/NEXT", "L/R", "-/+30S", NULL}, 0, screen, 0);
+    } else {
+        GFX_blitButtonGroup((char*[]){"U/D", "PREV/NEXT", NULL}, 0, screen, 0);
+    }
+    GFX_blitButtonGroup((char*[]){"Y", Radio_isRecording() ? "STOP REC" : "REC",
+                                  "A", state == RADIO_STATE_PAUSED ? "PLAY" : "PAUSE", "B", "STOP", NULL}, 1, screen, 1);
 }
 
 // Render add stations - country selection screen
 void render_radio_add(SDL_Surface* screen, int show_setting,
                       int add_country_selected, int* add_country_scroll) {
-    GFX_clear(screen);
-
+    PROFILE_SCOPE("render_radio_add");
     int hw = screen->w;
     char truncated[256];
 
-    render_screen_header(screen, "Add Stations", show_setting);
-
-    // Subtitle
-    const char* subtitle = "Select Country";
-    SDL_Surface* sub_text = TTF_RenderUTF8_Blended(get_font_small(), subtitle, COLOR_GRAY);
-    if (sub_text) {
-        SDL_BlitSurface(sub_text, NULL, screen, &(SDL_Rect){SCALE1(PADDING) + SCALE1(BUTTON_PADDING), SCALE1(PADDING + PILL_SIZE + 4)});
-        SDL_FreeSurface(sub_text);
-    }
-
     // Country list
     int country_count = Radio_getCuratedCountryCount();
     const CuratedCountry* countries = Radio_getCuratedCountries();
@@ -305,12 +305,30 @@ void render_radio_add(SDL_Surface* screen, int show_setting,
     ListLayout layout = calc_list_layout(screen, SCALE1(20));
     adjust_list_scroll(add_country_selected, add_country_scroll, layout.items_per_page);
 
+    int previous = list_rows_only(countries, *add_country_scroll, add_country_selected, show_setting);
+    if (previous < 0) {
+        GFX_clear(screen);
+        render_screen_header(screen, "Add Stations", show_setting);
+
+        // Subtitle
+        const char* subtitle = "Select Country";
+        SDL_Surface* sub_text = TTF_RenderUTF8_Blended(get_font_small(), subtitle, COLOR_GRAY);
+        if (sub_text) {
+            SDL_BlitSurface(sub_text, NULL, screen, &(SDL_Rect){SCALE1(PADDING) + SCALE1(BUTTON_PADDING), SCALE1(PADDING + PILL_SIZE + 4)});
+            SDL_FreeSurface(sub_text);
+        }
+    }
+
     for (int i = 0; i < layout.items_per_page && *add_country_scroll + i < country_count; i++) {
         int idx = *add_country_scroll + i;
         const CuratedCountry* country = &countries[idx];
         bool selected = (idx == add_country_selected);
 
         int y = layout.list_y + i * layout.item_h;
+        if (previous >= 0) {
+            if (idx != previous && !selected) continue;
+            list_clear_row(screen, y, layout.item_h);
+        }
 
         // Render pill background and get text position
         ListItemPos pos = render_list_item_pill(screen, &layout, country->name, truncated, y, selected, 0);
@@ -324,14 +342,14 @@ void render_radio_add(SDL_Surface* screen, int show_setting,
         char count_str[32];
         snprintf(count_str, sizeof(count_str), "%d stations", curated_station_count);
         SDL_Color count_color = selected ? COLOR_GRAY : COLOR_DARK_TEXT;
-        SDL_Surface* count_text = TTF_RenderUTF8_Blended(get_font_tiny(), count_str, count_color);
+        SDL_Surface* count_text = TextCache_render(get_font_tiny(), count_str, count_color);
         if (count_text) {
             SDL_BlitSurface(count_text, NULL, screen, &(SDL_Rect){hw - count_text->w - SCALE1(PADDING * 2), y + (layout.item_h - count_text->h) / 2});
-            SDL_FreeSurface(count_text);
         }
     }
 
     render_scroll_indicators(screen, *add_country_scroll, layout.items_per_page, country_count);
+    if (previous >= 0) return;
 
     // Button hints
     GFX_blitButtonGroup((char*[]){"Y", "HELP", NULL}, 0, screen, 0);
@@ -340,9 +358,10 @@ void render_radio_add(SDL_Surface* screen, int show_setting,
 
 // Render add stations - station selection screen
 void render_radio_add_stations(SDL_Surface* screen, int show_setting,
-                               const char* country_code,
+                               const char* country_code, const char* query,
                                int add_station_selected, int* add_station_scroll,
-                               const bool* add_station_checked) {
+                               const bool* add_station_checked, int add_station_count) {
+    PROFILE_SCOPE("render_radio_add_stations");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -361,19 +380,22 @@ void render_radio_add_stations(SDL_Surface* screen, int show_setting,
 
     render_screen_header(screen, country_name, show_setting);
 
-    // Get stations for selected country
-    int station_count = 0;
-    const CuratedStation* stations = Radio_getCuratedStations(country_code, &station_count);
+    // Rows of the filtered view (already open: this returns its count)
+    int station_count = Radio_openCuratedView(country_code, query);
 
     // Count selected stations
     int selected_count = 0;
-    for (int i = 0; i < station_count && i < 256; i++) {
+    for (int i = 0; i < add_station_count; i++) {
         if (add_station_checked[i]) selected_count++;
     }
 
-    // Subtitle with selection count
-    char subtitle[64];
-    snprintf(subtitle, sizeof(subtitle), "%d selected", selected_count);
+    // Subtitle with selection count, and the filter with its matches
+    char subtitle[128];
+    if (query[0]) {
+        snprintf(subtitle, sizeof(subtitle), "%d selected  \"%s\": %d", selected_count, query, station_count);
+    } else {
+        snprintf(subtitle, sizeof(subtitle), "%d selected", selected_count);
+    }
     SDL_Surface* sub_text = TTF_RenderUTF8_Blended(get_font_small(), subtitle, COLOR_GRAY);
     if (sub_text) {
         SDL_BlitSurface(sub_text, NULL, screen, &(SDL_Rect){SCALE1(PADDING) + SCALE1(BUTTON_PADDING), SCALE1(PADDING + PILL_SIZE + 4)});
@@ -386,22 +408,22 @@ void render_radio_add_stations(SDL_Surface* screen, int show_setting,
 
     for (int i = 0; i < layout.items_per_page && *add_station_scroll + i < station_count; i++) {
         int idx = *add_station_scroll + i;
-        const CuratedStation* station = &stations[idx];
+        CuratedStation row;
+        if (!Radio_getCuratedViewRow(idx, &row)) break;
+        const CuratedStation* station = &row;
+        int station_index = Radio_getCuratedViewStation(idx);
         bool selected = (idx == add_station_selected);
-        bool checked = (idx < 256) ? add_station_checked[idx] : false;
+        bool checked = station_index >= 0 && station_index < add_station_count && add_station_checked[station_index];
 
         int y = layout.list_y + i * layout.item_h;
 
         // Calculate checkbox width first
         const char* checkbox = checked ? "[x]" : "[ ]";
-        int cb_width = 0;
-        int cb_w, cb_h;
-        TTF_SizeUTF8(get_font_small(), checkbox, &cb_w, &cb_h);
-        cb_width = cb_w + SCALE1(6);
+        int cb_width = TextCache_width(get_font_small(), checkbox) + SCALE1(6);
 
         // Calculate text width for pill sizing (checkbox + station name)
         int name_max_width = layout.max_width - cb_width - SCALE1(60);
-        int text_width = GFX_truncateText(get_font_medium(), station->name, truncated, name_max_width, SCALE1(BUTTON_PADDING * 2));
+        int text_width = TextCache_truncate(get_font_medium(), station->name, truncated, name_max_width, SCALE1(BUTTON_PADDING * 2));
         int pill_width = MIN(layout.max_width, cb_width + text_width + SCALE1(BUTTON_PADDING));
 
         // Background pill (sized to text width)
@@ -412,23 +434,38 @@ void render_radio_add_stations(SDL_Surface* screen, int show_setting,
         SDL_Color cb_color = get_list_text_color(selected);
         int text_x = SCALE1(PADDING) + SCALE1(BUTTON_PADDING);
         int text_y = y + (layout.item_h - TTF_FontHeight(get_font_medium())) / 2;
-        SDL_Surface* cb_text = TTF_RenderUTF8_Blended(get_font_small(), checkbox, cb_color);
+        SDL_Surface* cb_text = TextCache_render(get_font_small(), checkbox, cb_color);
         if (cb_text) {
             SDL_BlitSurface(cb_text, NULL, screen, &(SDL_Rect){text_x, y + (layout.item_h - cb_text->h) / 2});
-            SDL_FreeSurface(cb_text);
         }
 
         // Station name
         render_list_item_text(screen, NULL, station->name, get_font_medium(),
                               text_x + cb_width, text_y, name_max_width, selected);
 
-        // Genre on right
-        if (station->genre[0]) {
+        // Genre and probe result on right: how long the station takes to start
+        // playing, or that it is offline
+        char right[128];
+        RadioProbeResult probe;
+        const char* health = "";
+        char health_buf[32];
+        if (radio_probe_get(station->url, &probe)) {
+            if (probe.state == RADIO_PROBE_PENDING) {
+                health = "...";
+            } else if (probe.state == RADIO_PROBE_DEAD) {
+                health = "offline";
+            } else if (probe.state == RADIO_PROBE_ALIVE) {
+                snprintf(health_buf, sizeof(health_buf), "%.1fs", probe.first_audio_ms / 1000.0f);
+                health = health_buf;
+            }
+        }
+        snprintf(right, sizeof(right), "%s%s%s", station->genre,
+                 station->genre[0] && health[0] ? "  " : "", health);
+        if (right[0]) {
             SDL_Color genre_color = selected ? COLOR_GRAY : COLOR_DARK_TEXT;
-            SDL_Surface* genre_text = TTF_RenderUTF8_Blended(get_font_tiny(), station->genre, genre_color);
+            SDL_Surface* genre_text = TextCache_render(get_font_tiny(), right, genre_color);
             if (genre_text) {
                 SDL_BlitSurface(genre_text, NULL, screen, &(SDL_Rect){hw - genre_text->w - SCALE1(PADDING * 2), y + (layout.item_h - genre_text->h) / 2});
-                SDL_FreeSurface(genre_text);
             }
         }
     }
@@ -436,12 +473,15 @@ void render_radio_add_stations(SDL_Surface* screen, int show_setting,
     render_scroll_indicators(screen, *add_station_scroll, layout.items_per_page, station_count);
 
     // Button hints
-    GFX_blitButtonGroup((char*[]){"X", "SAVE", NULL}, 0, screen, 0);
-    GFX_blitButtonGroup((char*[]){"A", "TOGGLE", "B", "BACK", NULL}, 1, screen, 1);
+    GFX_blitButtonGroup((char*[]){"X", "SAVE", "Y", "FILTER", NULL}, 0, screen, 0);
+    GFX_blitButtonGroup((char*[]){"A", "TOGGLE", "B", query[0] ? "CLEAR" : "BACK", NULL}, 1, screen, 1);
 }
 
+static const char help_cache_id[] = "radio_help";
+
 // Render help/instructions screen
 void render_radio_help(SDL_Surface* screen, int show_setting, int* help_scroll) {
+    PROFILE_SCOPE("render_radio_help");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -493,44 +533,46 @@ void render_radio_help(SDL_Surface* screen, int show_setting, int* help_scroll)
     if (*help_scroll > max_scroll) *help_scroll = max_scroll;
     if (*help_scroll < 0) *help_scroll = 0;
 
-    // Render lines with scroll offset
-    int text_y = content_start_y - *help_scroll;
-    for (int i = 0; i < num_lines; i++) {
-        int current_line_h = (lines[i][0] == '\0') ? line_h / 2 : line_h;
-
-        // Skip lines that are above visible area
-        if (text_y + current_line_h < content_start_y) {
-            text_y += current_line_h;
-            continue;
-        }
-
-        // Stop if we're below visible area
-        if (text_y >= hh - button_area_h) {
-            break;
-        }
-
-        if (lines[i][0] == '\0') {
-            text_y += line_h / 2;
-            continue;
-        }
+    // All the text is rendered once into a surface as tall as it (kept in the
+    // screen cache); each redraw blits the scrolled window of it
+    SDL_Surface* content = ScreenCache_get(help_cache_id, SCREEN_CACHE_STAMP_INIT);
+    if (!content || content->w != hw) {
+        content = SDL_CreateRGBSurfaceWithFormat(0, hw, total_content_h + line_h, 32, SDL_PIXELFORMAT_RGBA8888);
+        if (content) {
+            SDL_FillRect(content, NULL, SDL_MapRGBA(content->format, 0, 0, 0, 255));
+            int text_y = 0;
+            for (int i = 0; i < num_lines; i++) {
+                if (lines[i][0] == '\0') {
+                    text_y += line_h / 2;
+                    continue;
+                }
 
-        SDL_Color color = COLOR_WHITE;
-        TTF_Font* use_font = get_font_small();
+                SDL_Color color = COLOR_WHITE;
+                TTF_Font* use_font = get_font_small();
 
-        // Highlight special lines
-        if (strstr(lines[i], "Example:") || strstr(lines[i], "Notes:")) {
-            color = COLOR_GRAY;
-        } else if (lines[i][0] == '-') {
-            color = COLOR_GRAY;
-            use_font = get_font_tiny();
-        }
+                // Highlight special lines
+                if (strstr(lines[i], "Example:") || strstr(lines[i], "Notes:")) {
+                    color = COLOR_GRAY;
+                } else if (lines[i][0] == '-') {
+                    color = COLOR_GRAY;
+                    use_font = get_font_tiny();
+                }
 
-        SDL_Surface* line_text = TTF_RenderUTF8_Blended(use_font, lines[i], color);
-        if (line_text) {
-            SDL_BlitSurface(line_text, NULL, screen, &(SDL_Rect){SCALE1(PADDING), text_y});
-            SDL_FreeSurface(line_text);
+                SDL_Surface* line_text = TTF_RenderUTF8_Blended(use_font, lines[i], color);
+                if (line_text) {
+                    SDL_BlitSurface(line_text, NULL, content, &(SDL_Rect){SCALE1(PADDING), text_y});
+                    SDL_FreeSurface(line_text);
+                }
+                text_y += line_h;
+            }
+            ScreenCache_put(help_cache_id, SCREEN_CACHE_STAMP_INIT, content);
         }
-        text_y += line_h;
+    }
+    if (content) {
+        int window_h = MIN(visible_height, content->h - *help_scroll);
+        SDL_SetSurfaceBlendMode(content, SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(content, &(SDL_Rect){0, *help_scroll, hw, window_h}, screen,
+                        &(SDL_Rect){0, content_start_y});
     }
 
     // Scroll indicators
@@ -556,6 +598,21 @@ static bool status_position_set = false;
 static float last_buffer_level = -1.0f;
 static RadioState last_rendered_state = RADIO_STATE_STOPPED;
 static int last_bitrate_val = -1;
+static int last_delay_s = -1;
+static bool last_recording = false;
+
+bool radio_needs_scroll_refresh(void) {
+    if (Radio_getState() != RADIO_STATE_PLAYING) return false;
+    for (int i = 0; i < RADIO_MARQUEE_COUNT; i++) {
+        if (ScrollText_isScrolling(radio_marquees[i])) return true;
+    }
+    return false;
+}
+
+void radio_animate_scroll(void) {
+    PROFILE_SCOPE("radio_animate_scroll");
+    ScrollText_renderMarquees(radio_marquees, RADIO_MARQUEE_COUNT);
+}
 
 void RadioStatus_setPosition(int bar_x, int bar_y, int bar_w, int bar_h,
                               int left_x, int left_y) {
@@ -573,6 +630,8 @@ void RadioStatus_clear(void) {
     last_buffer_level = -1.0f;
     last_rendered_state = RADIO_STATE_STOPPED;
     last_bitrate_val = -1;
+    last_delay_s = -1;
+    last_recording = false;
     PLAT_clearLayers(LAYER_BUFFER);
     PLAT_GPU_Flip();
 }
@@ -584,13 +643,16 @@ bool RadioStatus_needsRefresh(void) {
     float current_level = Radio_getBufferLevel();
 
     // Get bitrate directly from metadata
-    const RadioMetadata* meta = Radio_getMetadata();
-    int current_bitrate = meta ? meta->bitrate : 0;
+    RadioMetadata metadata;
+    Radio_getMetadata(&metadata);
+    int current_bitrate = metadata.bitrate;
 
-    // Refresh if state changed, buffer level changed, or bitrate changed
+    // Refresh if state changed, buffer level changed, bitrate or time-shift delay changed
     if (state != last_rendered_state) return true;
     if (fabsf(current_level - last_buffer_level) > 0.01f) return true;
     if (current_bitrate != last_bitrate_val) return true;
+    if (Radio_getDelayMs() / 1000 != last_delay_s) return true;
+    if (Radio_isRecording() != last_recording) return true;
 
     return false;
 }
@@ -602,17 +664,25 @@ void RadioStatus_renderGPU(void) {
     float buffer_level = Radio_getBufferLevel();
 
     // Get bitrate directly from metadata (updates asynchronously)
-    const RadioMetadata* meta = Radio_getMetadata();
-    int current_bitrate = meta ? meta->bitrate : 0;
+    RadioMetadata metadata;
+    Radio_getMetadata(&metadata);
+    int current_bitrate = metadata.bitrate;
+
+    int delay_s = Radio_getDelayMs() / 1000;
+    bool recording = Radio_isRecording();
 
     // Skip if nothing changed
     if (state == last_rendered_state &&
         fabsf(buffer_level - last_buffer_level) <= 0.01f &&
-        current_bitrate == last_bitrate_val) return;
+        current_bitrate == last_bitrate_val &&
+        delay_s == last_delay_s &&
+        recording == last_recording) return;
 
     last_rendered_state = state;
     last_buffer_level = buffer_level;
     last_bitrate_val = current_bitrate;
+    last_delay_s = delay_s;
+    last_recording = recording;
 
     // Get status text
     const char* status_text = "";
@@ -620,10 +690,24 @@ void RadioStatus_renderGPU(void) {
         case RADIO_STATE_CONNECTING: status_text = "connecting"; break;
         case RADIO_STATE_BUFFERING: status_text = "buffering"; break;
         case RADIO_STATE_PLAYING: status_text = "streaming"; break;
+        case RADIO_STATE_PAUSED: status_text = "paused"; break;
         case RADIO_STATE_ERROR: status_text = "error"; break;
         default: break;
     }
 
+    // Behind live after a pause or seek: show by how much
+    char delay_str[48];
+    if (delay_s > 0 && state != RADIO_STATE_ERROR) {
+        snprintf(delay_str, sizeof(delay_str), "%s -%d:%02d", status_text, delay_s / 60, delay_s % 60);
+        status_text = delay_str;
+    }
+
+    char rec_str[64];
+    if (recording) {
+        snprintf(rec_str, sizeof(rec_str), "%s rec", status_text);
+        status_text = rec_str;
+    }
+
     // Prepare bitrate string
     char bitrate_str[32] = "";
     if (current_bitrate > 0) {
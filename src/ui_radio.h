@@ -21,13 +21,19 @@ void render_radio_add(SDL_Surface* screen, int show_setting,
 
 // Render add stations - station selection screen
 void render_radio_add_stations(SDL_Surface* screen, int show_setting,
-                               const char* country_code,
+                               const char* country_code, const char* query,
                                int add_station_selected, int* add_station_scroll,
-                               const bool* add_station_checked);
+                               const bool* add_station_checked, int add_station_count);
 
 // Render help/instructions screen
 void render_radio_help(SDL_Surface* screen, int show_setting, int* help_scroll);
 
+// Check if a radio player line has active scrolling (for refresh optimization)
+bool radio_needs_scroll_refresh(void);
+
+// Animate radio player line scroll (GPU mode, no screen redraw needed)
+void radio_animate_scroll(void);
+
 // GPU buffer indicator and status functions
 void RadioStatus_setPosition(int bar_x, int bar_y, int bar_w, int bar_h,
                               int left_x, int left_y);
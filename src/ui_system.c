@@ -9,10 +9,20 @@
 #include "ui_fonts.h"
 #include "ui_utils.h"
 #include "selfupdate.h"
+#include "player.h"
+#include "radio.h"
+#include "radio_net.h"
 #include "qr_code_data.h"
+#include "profile.h"
+#include "memstats.h"
+#include "latency.h"
+#include "screen_cache.h"
+
+static const char about_cache_id[] = "about";
 
 // Render the app update screen
 void render_app_updating(SDL_Surface* screen, int show_setting) {
+    PROFILE_SCOPE("render_app_updating");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -174,6 +184,18 @@ void render_app_updating(SDL_Surface* screen, int show_setting) {
 
 // Render the about screen
 void render_about(SDL_Surface* screen, int show_setting) {
+    PROFILE_SCOPE("render_about");
+
+    // All but the hardware status is static: kept rendered, keyed by the version
+    // and the update on offer
+    const SelfUpdateStatus* status = SelfUpdate_getStatus();
+    uint32_t stamp = ScreenCache_stamp(SCREEN_CACHE_STAMP_INIT, SelfUpdate_getVersion());
+    stamp = ScreenCache_stamp(stamp, status->update_available ? status->latest_version : "");
+    if (ScreenCache_restore(screen, about_cache_id, stamp)) {
+        render_screen_status(screen, show_setting);
+        return;
+    }
+    ScreenCache_begin();
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -209,7 +231,6 @@ void render_about(SDL_Surface* screen, int show_setting) {
     }
 
     // Show update available message if there's an update (directly under tagline)
-    const SelfUpdateStatus* status = SelfUpdate_getStatus();
     if (status->update_available) {
         char update_msg[128];
         snprintf(update_msg, sizeof(update_msg), "Update available: v%s", status->latest_version);
@@ -240,4 +261,187 @@ void render_about(SDL_Surface* screen, int show_setting) {
     } else {
         GFX_blitButtonGroup((char*[]){"B", "BACK", NULL}, 1, screen, 1);
     }
+
+    ScreenCache_store(screen, about_cache_id, stamp);
+    render_screen_status(screen, show_setting);
+}
+
+void render_audio_stats(SDL_Surface* screen) {
+    char lines[5][128];
+    int line_count = 2;
+
+    if (Radio_isActive()) {
+        RadioStats rs;
+        Radio_getStats(&rs);
+        snprintf(lines[0], sizeof(lines[0]), "radio rebuf %u  underrun %u  silence %llu",
+                 rs.rebuffers, rs.underruns, (unsigned long long)rs.silence_samples);
+        snprintf(lines[1], sizeof(lines[1]), "ring min %d%%  avg %d%%  target %dms  reconn %u",
+                 (int)(rs.buffer_min * 100), (int)(rs.buffer_avg * 100), rs.target_ms, rs.reconnects);
+        snprintf(lines[2], sizeof(lines[2]), "net %dkbps wait %u  dec %dkbps wait %u  bits %d%%",
+                 rs.net_kbps, rs.net_waits, rs.decode_kbps, rs.decode_waits,
+                 (int)(rs.bitstream_fill * 100));
+        line_count = 3;
+    } else {
+        PlayerStats ps;
+        Player_getStats(&ps);
+        snprintf(lines[0], sizeof(lines[0]), "underrun %u  silence %llu  trylock %u",
+                 ps.underruns, (unsigned long long)ps.silence_frames, ps.trylock_misses);
+        snprintf(lines[1], sizeof(lines[1]), "buf min %dms avg %dms  dec %dus  cb %dus +-%dus",
+                 ps.buffer_min_ms, ps.buffer_avg_ms, ps.decode_chunk_us,
+                 ps.callback_interval_us, ps.callback_jitter_us);
+        snprintf(lines[2], sizeof(lines[2]), "plan low %dms high %dms  ring %dKB  stall %dms  cost %d%%",
+                 ps.buffer_low_ms, ps.buffer_high_ms, ps.buffer_capacity_kb,
+                 ps.read_stall_ms, ps.decode_cost_pct);
+        line_count = 3;
+    }
+
+    // Session traffic, and where it went (accounts that used any, in MB)
+    RadioNetTraffic traffic;
+    radio_net_getTraffic(&traffic);
+    uint64_t total_in = 0, total_out = 0;
+    int len = 0;
+    char* accounts = lines[line_count + 1];
+    accounts[0] = '\0';
+    for (int i = 0; i < RADIO_NET_ACCOUNT_COUNT; i++) {
+        total_in += traffic.in[i];
+        total_out += traffic.out[i];
+        uint64_t bytes = traffic.in[i] + traffic.out[i];
+        if (bytes == 0 || len >= (int)sizeof(lines[0])) continue;
+        len += snprintf(accounts + len, sizeof(lines[0]) - len, "%s%s %.1f", len ? "  " : "",
+                        radio_net_accountName(i), bytes / (1024.0f * 1024.0f));
+    }
+    snprintf(lines[line_count], sizeof(lines[0]), "data in %.1fMB  out %.1fMB  saver %s  capped %u",
+             total_in / (1024.0f * 1024.0f), total_out / (1024.0f * 1024.0f),
+             radio_net_dataSaver() ? "on" : "off", traffic.capped);
+    line_count += accounts[0] ? 2 : 1;
+
+    int y = SCALE1(PADDING);
+    for (int i = 0; i < line_count; i++) {
+        SDL_Surface* text = TTF_RenderUTF8_Blended(get_font_tiny(), lines[i], COLOR_WHITE);
+        if (text) {
+            SDL_FillRect(screen, &(SDL_Rect){SCALE1(PADDING), y, text->w, text->h},
+                         RGB_BLACK);
+            SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){SCALE1(PADDING), y});
+            y += text->h;
+            SDL_FreeSurface(text);
+        }
+    }
+}
+
+#ifdef UI_PROFILE
+void render_profile_stats(SDL_Surface* screen) {
+    const ProfileReport* pr = Profile_getReport();
+    char lines[8][128];
+    int line_count = 0;
+
+    snprintf(lines[line_count++], sizeof(lines[0]), "frames %u  p50 %.1f  p95 %.1f  p99 %.1f  max %.1fms",
+             pr->frames, pr->p50_us / 1000.0f, pr->p95_us / 1000.0f, pr->p99_us / 1000.0f, pr->max_us / 1000.0f);
+
+    // The three sections that took the most time
+    int top[3] = {-1, -1, -1};
+    for (int i = 0; i < pr->section_count; i++) {
+        if (pr->sections[i].calls == 0) continue;
+        for (int t = 0; t < 3; t++) {
+            if (top[t] < 0 || pr->sections[i].share > pr->sections[top[t]].share) {
+                for (int m = 2; m > t; m--) top[m] = top[m - 1];
+                top[t] = i;
+                break;
+            }
+        }
+    }
+    for (int t = 0; t < 3 && top[t] >= 0; t++) {
+        const ProfileSection* ps = &pr->sections[top[t]];
+        snprintf(lines[line_count++], sizeof(lines[0]), "%s  %ux avg %uus max %uus  %.1f%%",
+                 ps->name, ps->calls, ps->avg_us, ps->max_us, ps->share);
+    }
+
+    char* line = lines[line_count++];
+    int used = snprintf(line, sizeof(lines[0]), "cpu %.0f%%", pr->process_cpu);
+    for (int i = 0; i < pr->thread_count && i < 3 && used < (int)sizeof(lines[0]); i++) {
+        used += snprintf(line + used, sizeof(lines[0]) - used, "  %d %.0f%%", pr->threads[i].tid, pr->threads[i].cpu);
+    }
+
+    int line_h = TTF_FontHeight(get_font_tiny());
+    int y = screen->h - SCALE1(PADDING + PILL_SIZE) - line_count * line_h;
+    for (int i = 0; i < line_count; i++) {
+        SDL_Surface* text = TTF_RenderUTF8_Blended(get_font_tiny(), lines[i], COLOR_WHITE);
+        if (text) {
+            SDL_FillRect(screen, &(SDL_Rect){SCALE1(PADDING), y, text->w, text->h},
+                         RGB_BLACK);
+            SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){SCALE1(PADDING), y});
+            SDL_FreeSurface(text);
+        }
+        y += line_h;
+    }
+}
+#endif
+
+#ifdef MEM_STATS
+void render_mem_stats(SDL_Surface* screen) {
+    MemTagStats stats[MEM_TAG_COUNT];
+    MemStats_get(stats);
+    char lines[MEM_TAG_COUNT + 1][64];
+    int line_count = 0;
+
+    int64_t total = 0, total_peak = 0;
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        total += stats[i].current;
+        total_peak += stats[i].peak;
+    }
+    snprintf(lines[line_count++], sizeof(lines[0]), "mem %lldKB  peaks %lldKB",
+             (long long)(total / 1024), (long long)(total_peak / 1024));
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        if (stats[i].peak == 0) continue;
+        snprintf(lines[line_count++], sizeof(lines[0]), "%s %lld/%lldKB", stats[i].name,
+                 (long long)(stats[i].current / 1024), (long long)(stats[i].peak / 1024));
+    }
+
+    int y = SCALE1(PADDING);
+    for (int i = 0; i < line_count; i++) {
+        SDL_Surface* text = TTF_RenderUTF8_Blended(get_font_tiny(), lines[i], COLOR_WHITE);
+        if (text) {
+            int x = screen->w - SCALE1(PADDING) - text->w;
+            SDL_FillRect(screen, &(SDL_Rect){x, y, text->w, text->h}, RGB_BLACK);
+            SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){x, y});
+            y += text->h;
+            SDL_FreeSurface(text);
+        }
+    }
+}
+#endif
+
+#ifdef LATENCY_STATS
+void render_latency_stats(SDL_Surface* screen) {
+    char lines[LATENCY_ACTION_COUNT + 1][96];
+    int line_count = 0;
+
+    snprintf(lines[line_count++], sizeof(lines[0]), "latency ms  photon p50/p95/max  audio p50/p95/max");
+    for (int i = 0; i < LATENCY_ACTION_COUNT; i++) {
+        LatencyHistogram photon, audio;
+        Latency_get((LatencyAction)i, LATENCY_PHOTON, &photon);
+        Latency_get((LatencyAction)i, LATENCY_AUDIO, &audio);
+        if (photon.count == 0 && audio.count == 0) continue;
+        int used = snprintf(lines[line_count], sizeof(lines[0]), "%s %u  %u/%u/%u", Latency_actionName((LatencyAction)i),
+                            photon.count, Latency_percentile(&photon, 50), Latency_percentile(&photon, 95),
+                            photon.max_ms);
+        if (audio.count > 0 && used < (int)sizeof(lines[0])) {
+            snprintf(lines[line_count] + used, sizeof(lines[0]) - used, "  %u/%u/%u",
+                     Latency_percentile(&audio, 50), Latency_percentile(&audio, 95), audio.max_ms);
+        }
+        line_count++;
+    }
+
+    int line_h = TTF_FontHeight(get_font_tiny());
+    int y = screen->h - SCALE1(PADDING + PILL_SIZE) - line_count * line_h;
+    for (int i = 0; i < line_count; i++) {
+        SDL_Surface* text = TTF_RenderUTF8_Blended(get_font_tiny(), lines[i], COLOR_WHITE);
+        if (text) {
+            int x = screen->w - SCALE1(PADDING) - text->w;
+            SDL_FillRect(screen, &(SDL_Rect){x, y, text->w, text->h}, RGB_BLACK);
+            SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){x, y});
+            SDL_FreeSurface(text);
+        }
+        y += line_h;
+    }
 }
+#endif
@@ -9,4 +9,19 @@ void render_app_updating(SDL_Surface* screen, int show_setting);
 // Render the about screen
 void render_about(SDL_Surface* screen, int show_setting);
 
+// Draw playback telemetry over the top-left corner (AUDIO_STATS builds)
+void render_audio_stats(SDL_Surface* screen);
+
+// Draw frame times, the costliest sections and the busiest threads over the
+// bottom-left corner (UI_PROFILE builds)
+void render_profile_stats(SDL_Surface* screen);
+
+// Draw the memory held per subsystem, now and peak, over the top-right corner
+// (MEM_STATS builds)
+void render_mem_stats(SDL_Surface* screen);
+
+// Draw input-to-photon and input-to-audio latency per action over the
+// bottom-right corner (LATENCY_STATS builds)
+void render_latency_stats(SDL_Surface* screen);
+
 #endif
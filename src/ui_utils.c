@@ -2,6 +2,10 @@
 #include <string.h>
 #include "ui_utils.h"
 #include "ui_fonts.h"
+#include "text_cache.h"
+#include "screen_cache.h"
+#include "profile.h"
+#include "memstats.h"
 
 // Format duration as MM:SS
 void format_time(char* buf, int ms) {
@@ -27,13 +31,20 @@ const char* get_format_name(AudioFormat format) {
 // Scroll gap for software scrolling
 #define SCROLL_GAP 30
 
-// Reset scroll state for new text
-void ScrollText_reset(ScrollTextState* state, const char* text, TTF_Font* font, int max_width, bool use_gpu) {
+// Reset scroll state for new text, the GPU marquee surface rendered in color
+static void scroll_reset(ScrollTextState* state, const char* text, TTF_Font* font, int max_width,
+                         bool use_gpu, SDL_Color color) {
+    PROFILE_SCOPE("ScrollText_reset");
     // Clear the scroll layer when text changes to avoid ghost text
     GFX_clearLayers(LAYER_SCROLLTEXT);
 
-    // Free old cached surface if exists
+    // Free old cached surface if exists (the view first: it points into it)
+    if (state->scroll_view) {
+        SDL_FreeSurface(state->scroll_view);
+        state->scroll_view = NULL;
+    }
     if (state->cached_scroll_surface) {
+        MEM_SURFACE_SUB(MEM_TAG_SCROLL_TEXT, state->cached_scroll_surface);
         SDL_FreeSurface(state->cached_scroll_surface);
         state->cached_scroll_surface = NULL;
     }
@@ -65,22 +76,30 @@ void ScrollText_reset(ScrollTextState* state, const char* text, TTF_Font* font,
             total_width, height, 32, SDL_PIXELFORMAT_RGBA8888);
 
         if (state->cached_scroll_surface) {
+            MEM_SURFACE_ADD(MEM_TAG_SCROLL_TEXT, state->cached_scroll_surface);
             // Clear to transparent
             SDL_FillRect(state->cached_scroll_surface, NULL, 0);
 
             // Render text twice for seamless looping
-            SDL_Color white = {255, 255, 255, 255};  // Will be overwritten by actual color
-            SDL_Surface* text_surf = TTF_RenderUTF8_Blended(font, state->text, white);
+            SDL_Surface* text_surf = TTF_RenderUTF8_Blended(font, state->text, color);
             if (text_surf) {
                 SDL_SetSurfaceBlendMode(text_surf, SDL_BLENDMODE_NONE);
                 SDL_BlitSurface(text_surf, NULL, state->cached_scroll_surface, &(SDL_Rect){0, 0, 0, 0});
                 SDL_BlitSurface(text_surf, NULL, state->cached_scroll_surface, &(SDL_Rect){state->text_width + padding, 0, 0, 0});
                 SDL_FreeSurface(text_surf);
             }
+
+            // The visible window: moving it is a pointer change, no copy
+            state->scroll_view = SDL_CreateRGBSurfaceWithFormatFrom(state->cached_scroll_surface->pixels,
+                max_width, height, 32, state->cached_scroll_surface->pitch, SDL_PIXELFORMAT_RGBA8888);
         }
     }
 }
 
+void ScrollText_reset(ScrollTextState* state, const char* text, TTF_Font* font, int max_width, bool use_gpu) {
+    scroll_reset(state, text, font, max_width, use_gpu, (SDL_Color){255, 255, 255, 255});
+}
+
 // Check if scrolling is active (text needs to scroll)
 bool ScrollText_isScrolling(ScrollTextState* state) {
     return state->needs_scroll;
@@ -89,6 +108,7 @@ bool ScrollText_isScrolling(ScrollTextState* state) {
 // Update scroll animation only (for GPU mode, doesn't redraw screen)
 // Call this when dirty=0 but scrolling is active - uses saved position from last render
 void ScrollText_animateOnly(ScrollTextState* state) {
+    PROFILE_SCOPE("ScrollText_animateOnly");
     if (!state->text[0] || !state->needs_scroll || !state->use_gpu_scroll) return;
     if (!state->last_font) return;  // Never rendered yet
 
@@ -108,6 +128,7 @@ void ScrollText_animateOnly(ScrollTextState* state) {
 // Render scrolling text - GPU mode for lists, software mode for player
 void ScrollText_render(ScrollTextState* state, TTF_Font* font, SDL_Color color,
                        SDL_Surface* screen, int x, int y) {
+    PROFILE_SCOPE("ScrollText_render");
     if (!state->text[0]) return;
 
     // Save position info for animate-only mode
@@ -120,11 +141,8 @@ void ScrollText_render(ScrollTextState* state, TTF_Font* font, SDL_Color color,
     if (!state->needs_scroll) {
         // Clear scroll layer to remove any previous scrolling text
         GFX_clearLayers(LAYER_SCROLLTEXT);
-        SDL_Surface* surf = TTF_RenderUTF8_Blended(font, state->text, color);
-        if (surf) {
-            SDL_BlitSurface(surf, NULL, screen, &(SDL_Rect){x, y, 0, 0});
-            SDL_FreeSurface(surf);
-        }
+        SDL_Surface* surf = TextCache_render(font, state->text, color);
+        if (surf) SDL_BlitSurface(surf, NULL, screen, &(SDL_Rect){x, y, 0, 0});
         return;
     }
 
@@ -188,47 +206,45 @@ void ScrollText_update(ScrollTextState* state, const char* text, TTF_Font* font,
     ScrollText_render(state, font, color, screen, x, y);
 }
 
-// GPU scroll without background (for player title)
-// Uses PLAT_drawOnLayer to render to GPU layer without pill background
-void ScrollText_renderGPU_NoBg(ScrollTextState* state, TTF_Font* font,
-                                SDL_Color color, int x, int y) {
-    if (!state->text[0] || !state->needs_scroll || !state->cached_scroll_surface) {
-        // Static text or no scroll needed - just clear layer
-        PLAT_clearLayers(LAYER_SCROLLTEXT);
-        return;
-    }
+int ScrollText_placeLine(ScrollTextState* state, const char* text, TTF_Font* font, SDL_Color color,
+                         SDL_Surface* screen, int x, int y, int max_width) {
+    PROFILE_SCOPE("ScrollText_placeLine");
+    bool changed = strcmp(state->text, text) != 0 || state->max_width != max_width ||
+                   state->last_font != font || memcmp(&state->last_color, &color, sizeof(color)) != 0;
+    if (changed) scroll_reset(state, text, font, max_width, true, color);
 
-    // Save render info
     state->last_x = x;
     state->last_y = y;
     state->last_font = font;
     state->last_color = color;
+    if (state->text[0] && (!state->needs_scroll || !state->scroll_view)) {
+        SDL_Surface* surf = TextCache_render(font, state->text, color);
+        if (surf) SDL_BlitSurface(surf, NULL, screen, &(SDL_Rect){x, y, 0, 0});
+    }
+    return TTF_FontHeight(font);
+}
 
-    int padding = SCALE1(SCROLL_GAP);
-    int height = state->cached_scroll_surface->h;
-
-    // Create clipped view at current scroll offset (only this is created per-frame)
-    SDL_Surface* clipped = SDL_CreateRGBSurfaceWithFormat(0,
-        state->max_width, height, 32, SDL_PIXELFORMAT_RGBA8888);
-    if (!clipped) return;
-
-    SDL_FillRect(clipped, NULL, 0);
-    SDL_SetSurfaceBlendMode(state->cached_scroll_surface, SDL_BLENDMODE_NONE);
-    SDL_Rect src = {state->scroll_offset, 0, state->max_width, height};
-    SDL_BlitSurface(state->cached_scroll_surface, &src, clipped, NULL);
-
-    // Render to GPU layer
+void ScrollText_renderMarquees(ScrollTextState* const* states, int count) {
+    PROFILE_SCOPE("ScrollText_renderMarquees");
     PLAT_clearLayers(LAYER_SCROLLTEXT);
-    PLAT_drawOnLayer(clipped, x, y, state->max_width, height, 1.0f, false, LAYER_SCROLLTEXT);
-    SDL_FreeSurface(clipped);
-
-    // Advance scroll offset (1 pixel per frame for smooth, slower scrolling)
-    state->scroll_offset += 1;
-    if (state->scroll_offset >= state->text_width + padding) {
-        state->scroll_offset = 0;
+    bool drawn = false;
+    for (int i = 0; i < count; i++) {
+        ScrollTextState* state = states[i];
+        if (!state->text[0] || !state->needs_scroll || !state->scroll_view) continue;
+
+        uint8_t* pixels = (uint8_t*)state->cached_scroll_surface->pixels;
+        state->scroll_view->pixels = pixels + state->scroll_offset * 4;
+        PLAT_drawOnLayer(state->scroll_view, state->last_x, state->last_y, state->max_width,
+                         state->scroll_view->h, 1.0f, false, LAYER_SCROLLTEXT);
+        drawn = true;
+
+        // Advance scroll offset (1 pixel per frame for smooth, slower scrolling)
+        state->scroll_offset += 1;
+        if (state->scroll_offset >= state->text_width + SCALE1(SCROLL_GAP)) {
+            state->scroll_offset = 0;
+        }
     }
-
-    PLAT_GPU_Flip();
+    if (drawn) PLAT_GPU_Flip();
 }
 
 // Render standard screen header (title pill + hardware status)
@@ -236,16 +252,20 @@ void render_screen_header(SDL_Surface* screen, const char* title, int show_setti
     int hw = screen->w;
     char truncated[256];
 
-    int title_width = GFX_truncateText(get_font_medium(), title, truncated, hw - SCALE1(PADDING * 4), SCALE1(BUTTON_PADDING * 2));
+    int title_width = TextCache_truncate(get_font_medium(), title, truncated, hw - SCALE1(PADDING * 4), SCALE1(BUTTON_PADDING * 2));
     GFX_blitPill(ASSET_BLACK_PILL, screen, &(SDL_Rect){SCALE1(PADDING), SCALE1(PADDING), title_width, SCALE1(PILL_SIZE)});
 
-    SDL_Surface* title_text = TTF_RenderUTF8_Blended(get_font_medium(), truncated, COLOR_GRAY);
+    SDL_Surface* title_text = TextCache_render(get_font_medium(), truncated, COLOR_GRAY);
     if (title_text) {
         SDL_BlitSurface(title_text, NULL, screen, &(SDL_Rect){SCALE1(PADDING) + SCALE1(BUTTON_PADDING), SCALE1(PADDING + 4)});
-        SDL_FreeSurface(title_text);
     }
 
-    if (hw >= SCALE1(320)) {
+    // Left out of a cached screen: it's live
+    if (!ScreenCache_capturing()) render_screen_status(screen, show_setting);
+}
+
+void render_screen_status(SDL_Surface* screen, int show_setting) {
+    if (screen->w >= SCALE1(320)) {
         GFX_blitHardwareGroup(screen, show_setting);
     }
 }
@@ -295,6 +315,41 @@ ListLayout calc_list_layout(SDL_Surface* screen, int offset_y) {
     return layout;
 }
 
+static uint32_t ui_frame = 0;
+static bool ui_selection_moved = false;
+
+// The list drawn last, and on which frame
+static struct {
+    const void* list;
+    int scroll;
+    int selected;
+    int show_setting;
+    uint32_t frame;
+} last_list;
+
+void UI_beginFrame(bool selection_moved) {
+    ui_frame++;
+    ui_selection_moved = selection_moved;
+}
+
+int list_rows_only(const void* list, int scroll, int selected, int show_setting) {
+    int previous = -1;
+    if (ui_selection_moved && last_list.frame == ui_frame - 1 && last_list.list == list &&
+        last_list.scroll == scroll && last_list.show_setting == show_setting && last_list.selected != selected) {
+        previous = last_list.selected;
+    }
+    last_list.list = list;
+    last_list.scroll = scroll;
+    last_list.selected = selected;
+    last_list.show_setting = show_setting;
+    last_list.frame = ui_frame;
+    return previous;
+}
+
+void list_clear_row(SDL_Surface* screen, int y, int h) {
+    SDL_FillRect(screen, &(SDL_Rect){0, y, screen->w, h}, 0);
+}
+
 // Render a list item's text with optional scrolling for selected items
 void render_list_item_text(SDL_Surface* screen, ScrollTextState* scroll_state,
                            const char* text, TTF_Font* font_param,
@@ -308,11 +363,10 @@ void render_list_item_text(SDL_Surface* screen, ScrollTextState* scroll_state,
                           text_color, screen, text_x, text_y, true);
     } else {
         // Non-selected items: static rendering with clipping
-        SDL_Surface* text_surf = TTF_RenderUTF8_Blended(font_param, text, text_color);
+        SDL_Surface* text_surf = TextCache_render(font_param, text, text_color);
         if (text_surf) {
             SDL_Rect src = {0, 0, text_surf->w > max_text_width ? max_text_width : text_surf->w, text_surf->h};
             SDL_BlitSurface(text_surf, &src, screen, &(SDL_Rect){text_x, text_y, 0, 0});
-            SDL_FreeSurface(text_surf);
         }
     }
 }
@@ -366,38 +420,64 @@ MenuItemPos render_menu_item_pill(SDL_Surface* screen, ListLayout* layout,
 // Generic Simple Menu Rendering
 // ============================================
 
-// Render a simple menu with optional customization callbacks
-void render_simple_menu(SDL_Surface* screen, int show_setting, int menu_selected,
-                        const SimpleMenuConfig* config) {
-    GFX_clear(screen);
+// One menu row: its pill, label and badge
+static void render_simple_menu_item(SDL_Surface* screen, ListLayout* layout, const SimpleMenuConfig* config,
+                                    int index, bool selected) {
     char truncated[256];
     char label_buffer[256];
 
-    render_screen_header(screen, config->title, show_setting);
-    ListLayout layout = calc_list_layout(screen, 0);
+    // Get label (use callback if provided)
+    const char* label = config->items[index];
+    if (config->get_label) {
+        const char* custom = config->get_label(index, label, label_buffer, sizeof(label_buffer));
+        if (custom) label = custom;
+    }
 
-    for (int i = 0; i < config->item_count; i++) {
-        bool selected = (i == menu_selected);
+    // Render pill and text
+    MenuItemPos pos = render_menu_item_pill(screen, layout, label, truncated, index, selected);
+    render_list_item_text(screen, NULL, truncated, get_font_large(),
+                          pos.text_x, pos.text_y, layout->max_width, selected);
 
-        // Get label (use callback if provided)
-        const char* label = config->items[i];
-        if (config->get_label) {
-            const char* custom = config->get_label(i, label, label_buffer, sizeof(label_buffer));
-            if (custom) label = custom;
-        }
+    // Render badge if callback provided
+    if (config->render_badge) {
+        config->render_badge(screen, index, selected, pos.item_y, SCALE1(PILL_SIZE));
+    }
+}
 
-        // Render pill and text
-        MenuItemPos pos = render_menu_item_pill(screen, &layout, label, truncated, i, selected);
-        render_list_item_text(screen, NULL, truncated, get_font_large(),
-                              pos.text_x, pos.text_y, layout.max_width, selected);
+// Render a simple menu with optional customization callbacks
+void render_simple_menu(SDL_Surface* screen, int show_setting, int menu_selected,
+                        const SimpleMenuConfig* config) {
+    char label_buffer[256];
+    ListLayout layout = calc_list_layout(screen, 0);
 
-        // Render badge if callback provided
-        if (config->render_badge) {
-            config->render_badge(screen, i, selected, pos.item_y, SCALE1(PILL_SIZE));
+    // Menus don't scroll; the title tells them apart
+    int previous = list_rows_only(config->title, 0, menu_selected, show_setting);
+    if (previous < 0) {
+        // The menu with no row selected is cached, keyed by its labels; then only
+        // the selected row is drawn over it
+        uint32_t stamp = ScreenCache_stamp(SCREEN_CACHE_STAMP_INIT, config->btn_b_label);
+        for (int i = 0; i < config->item_count; i++) {
+            const char* label = config->get_label ? config->get_label(i, config->items[i], label_buffer,
+                                                                      sizeof(label_buffer)) : NULL;
+            stamp = ScreenCache_stamp(stamp, label ? label : config->items[i]);
+        }
+        if (!ScreenCache_restore(screen, config->title, stamp)) {
+            ScreenCache_begin();
+            GFX_clear(screen);
+            render_screen_header(screen, config->title, show_setting);
+            for (int i = 0; i < config->item_count; i++) render_simple_menu_item(screen, &layout, config, i, false);
+            GFX_blitButtonGroup((char*[]){"U/D", "SELECT", NULL}, 0, screen, 0);
+            GFX_blitButtonGroup((char*[]){"B", (char*)config->btn_b_label, "A", "OPEN", NULL}, 1, screen, 1);
+            ScreenCache_store(screen, config->title, stamp);
         }
+        render_screen_status(screen, show_setting);
+        previous = menu_selected;
     }
 
-    // Button hints
-    GFX_blitButtonGroup((char*[]){"U/D", "SELECT", NULL}, 0, screen, 0);
-    GFX_blitButtonGroup((char*[]){"B", (char*)config->btn_b_label, "A", "OPEN", NULL}, 1, screen, 1);
+    for (int i = 0; i < config->item_count; i++) {
+        bool selected = (i == menu_selected);
+        if (i != previous && !selected) continue;
+        list_clear_row(screen, layout.list_y + i * SCALE1(PILL_SIZE + BUTTON_MARGIN), SCALE1(PILL_SIZE));
+        render_simple_menu_item(screen, &layout, config, i, selected);
+    }
 }
@@ -21,11 +21,12 @@ typedef struct {
     uint32_t start_time;    // Animation start time
     bool needs_scroll;      // True if text is wider than max_width
     int scroll_offset;      // Current pixel offset for smooth scrolling
-    bool use_gpu_scroll;    // True = use GPU layer (for lists), False = software (for player)
+    bool use_gpu_scroll;    // True = use GPU layer (lists and player lines), False = software
     int last_x, last_y;     // Last render position (for animate-only mode)
     TTF_Font* last_font;    // Last font used (for animate-only mode)
     SDL_Color last_color;   // Last color used (for animate-only mode)
     SDL_Surface* cached_scroll_surface;  // Cached surface for GPU scroll (no bg)
+    SDL_Surface* scroll_view;            // Window into it at scroll_offset (shares its pixels)
 } ScrollTextState;
 
 // Reset scroll state for new text
@@ -48,14 +49,24 @@ void ScrollText_render(ScrollTextState* state, TTF_Font* font, SDL_Color color,
 void ScrollText_update(ScrollTextState* state, const char* text, TTF_Font* font,
                        int max_width, SDL_Color color, SDL_Surface* screen, int x, int y, bool use_gpu);
 
-// GPU scroll without background (for player title)
-// Uses PLAT_drawOnLayer to render to GPU layer without pill background
-void ScrollText_renderGPU_NoBg(ScrollTextState* state, TTF_Font* font,
-                                SDL_Color color, int x, int y);
+// A line of the now-playing views (title, artist, album)
+// Text that fits is blitted to screen from the text cache; wider text is rendered
+// once into the state's marquee surface and only placed here, to be drawn on the
+// scroll layer by ScrollText_renderMarquees. Returns the line's height.
+int ScrollText_placeLine(ScrollTextState* state, const char* text, TTF_Font* font, SDL_Color color,
+                         SDL_Surface* screen, int x, int y, int max_width);
+
+// Draw the placed lines that scroll on the GPU layer, without background, and
+// advance them: per line a window moved along its cached surface, no text
+// rendered and nothing behind it redrawn. Clears the layer when none scrolls.
+void ScrollText_renderMarquees(ScrollTextState* const* states, int count);
 
 // Render standard screen header (title pill + hardware status)
 void render_screen_header(SDL_Surface* screen, const char* title, int show_setting);
 
+// Render the hardware status alone (over a header restored from the screen cache)
+void render_screen_status(SDL_Surface* screen, int show_setting);
+
 // Adjust scroll offset to keep selected item visible
 void adjust_list_scroll(int selected, int* scroll, int items_per_page);
 
@@ -87,6 +98,22 @@ void render_list_item_text(SDL_Surface* screen, ScrollTextState* scroll_state,
                            int text_x, int text_y, int max_text_width,
                            bool selected);
 
+// Partial list repaints
+// The main loop tells each frame whether the only change since the last one is
+// a moved list selection. A list renderer then asks list_rows_only(): when the
+// same list was drawn the frame before at the same scroll position, only the
+// rows that were and are selected are cleared and drawn again, on top of what
+// the screen surface still holds; otherwise it draws the whole screen.
+void UI_beginFrame(bool selection_moved);
+
+// list: any pointer identifying the list (the same on every frame it's shown)
+// Returns the previously selected index to repaint along with selected, or -1
+// for a full redraw.
+int list_rows_only(const void* list, int scroll, int selected, int show_setting);
+
+// Clear a row's band across the screen before repainting it
+void list_clear_row(SDL_Surface* screen, int y, int h);
+
 // Position information returned by render_list_item_pill
 typedef struct {
     int pill_width;   // Width of the rendered pill
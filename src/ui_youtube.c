@@ -6,6 +6,9 @@
 #include "ui_youtube.h"
 #include "ui_fonts.h"
 #include "ui_utils.h"
+#include "text_cache.h"
+#include "youtube_thumbs.h"
+#include "profile.h"
 
 // Scroll text state for YouTube results (selected item)
 static ScrollTextState youtube_results_scroll_text = {0};
@@ -14,13 +17,14 @@ static ScrollTextState youtube_results_scroll_text = {0};
 static ScrollTextState youtube_queue_scroll_text = {0};
 
 // YouTube sub-menu items
-static const char* youtube_menu_items[] = {"Search Music", "Download Queue", "Update yt-dlp"};
-#define YOUTUBE_MENU_COUNT 3
+static const char* youtube_menu_items[] = {"Search Music", "Download Queue", "Update yt-dlp", "Parallel Downloads", "Download Format"};
+#define YOUTUBE_MENU_COUNT 5
 
 // Toast duration constant
 #define YOUTUBE_TOAST_DURATION 1500  // 1.5 seconds
 
-// Label callback for queue count on Download Queue menu item
+// Label callback for queue count on Download Queue menu item, and the
+// parallel download setting
 static const char* youtube_menu_get_label(int index, const char* default_label,
                                           char* buffer, int buffer_size) {
     if (index == 1) {  // Download Queue
@@ -30,11 +34,21 @@ static const char* youtube_menu_get_label(int index, const char* default_label,
             return buffer;
         }
     }
+    if (index == 3) {  // Parallel Downloads
+        snprintf(buffer, buffer_size, "%s: %d", default_label, YouTube_getDownloadWorkers());
+        return buffer;
+    }
+    if (index == 4) {  // Download Format
+        snprintf(buffer, buffer_size, "%s: %s", default_label,
+                 YouTube_getDownloadFormatName(YouTube_getDownloadFormat()));
+        return buffer;
+    }
     return NULL;  // Use default label
 }
 
 // Render YouTube sub-menu
 void render_youtube_menu(SDL_Surface* screen, int show_setting, int menu_selected) {
+    PROFILE_SCOPE("render_youtube_menu");
     SimpleMenuConfig config = {
         .title = "MP3 Downloader",
         .items = youtube_menu_items,
@@ -48,6 +62,7 @@ void render_youtube_menu(SDL_Surface* screen, int show_setting, int menu_selecte
 
 // Render YouTube searching status
 void render_youtube_searching(SDL_Surface* screen, int show_setting, const char* search_query) {
+    PROFILE_SCOPE("render_youtube_searching");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -80,7 +95,9 @@ void render_youtube_results(SDL_Surface* screen, int show_setting,
                             const char* search_query,
                             YouTubeResult* results, int result_count,
                             int selected, int* scroll,
-                            char* toast_message, uint32_t toast_time, bool searching) {
+                            char* toast_message, uint32_t toast_time, bool searching,
+                            const char* playing_id) {
+    PROFILE_SCOPE("render_youtube_results");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -104,41 +121,61 @@ void render_youtube_results(SDL_Surface* screen, int show_setting,
     int dur_w, dur_h;
     TTF_SizeUTF8(get_font_tiny(), "99:59", &dur_w, &dur_h);
     int duration_reserved = dur_w + SCALE1(PADDING * 2);  // Duration width + gap
-    int max_width = layout.max_width - duration_reserved;
+
+    // Thumbnails (16:9) left of the pills, loaded for the rows on screen
+    int thumb_h = layout.item_h - SCALE1(4);
+    int thumb_w = thumb_h * 16 / 9;
+    int list_x = SCALE1(PADDING) + thumb_w + SCALE1(BUTTON_MARGIN);
+    int max_width = layout.max_width - duration_reserved - thumb_w - SCALE1(BUTTON_MARGIN);
+    YouTubeThumbs_view(results, result_count, *scroll, layout.items_per_page, thumb_h);
+    uint32_t placeholder = SDL_MapRGB(screen->format, 0x28, 0x28, 0x28);
 
     for (int i = 0; i < layout.items_per_page && *scroll + i < result_count; i++) {
         int idx = *scroll + i;
         YouTubeResult* result = &results[idx];
         bool is_selected = (idx == selected);
-        bool in_queue = YouTube_isInQueue(result->video_id);
+        bool playing = strcmp(result->video_id, playing_id) == 0;
+        const char* indicator_text = playing ? "[>]" : YouTube_isInQueue(result->video_id) ? "[+]"
+                                   : YouTube_isDownloaded(result->video_id) ? "[OK]" : NULL;
 
         int y = layout.list_y + i * layout.item_h;
 
-        // Calculate indicator width if in queue
+        SDL_Rect thumb_rect = {SCALE1(PADDING), y + (layout.item_h - thumb_h) / 2, thumb_w, thumb_h};
+        SDL_Surface* thumb = YouTubeThumbs_get(result->video_id);
+        if (thumb) {
+            SDL_Rect src = {(thumb->w - thumb_w) / 2, 0, thumb_w, thumb_h};
+            if (src.x < 0) {
+                thumb_rect.x -= src.x;
+                src.x = 0;
+                src.w = thumb->w;
+            }
+            SDL_BlitSurface(thumb, &src, screen, &thumb_rect);
+        } else {
+            SDL_FillRect(screen, &thumb_rect, placeholder);
+        }
+
+        // Calculate indicator width if playing, queued or downloaded
         int indicator_width = 0;
-        if (in_queue) {
-            int ind_w, ind_h;
-            TTF_SizeUTF8(get_font_tiny(), "[+]", &ind_w, &ind_h);
-            indicator_width = ind_w + SCALE1(4);
+        if (indicator_text) {
+            indicator_width = TextCache_width(get_font_tiny(), indicator_text) + SCALE1(4);
         }
 
         // Calculate text width for pill sizing
         int pill_width = calc_list_pill_width(get_font_medium(), result->title, truncated, max_width, indicator_width);
 
         // Background pill (sized to text width)
-        SDL_Rect pill_rect = {SCALE1(PADDING), y, pill_width, layout.item_h};
+        SDL_Rect pill_rect = {list_x, y, pill_width, layout.item_h};
         draw_list_item_bg(screen, &pill_rect, is_selected);
 
-        int title_x = SCALE1(PADDING) + SCALE1(BUTTON_PADDING);
+        int title_x = list_x + SCALE1(BUTTON_PADDING);
         int text_y = y + (layout.item_h - TTF_FontHeight(get_font_medium())) / 2;
 
-        // Show indicator if already in queue
-        if (in_queue) {
-            SDL_Surface* indicator = TTF_RenderUTF8_Blended(get_font_tiny(), "[+]", is_selected ? uintToColour(THEME_COLOR5_255) : COLOR_GRAY);
+        // Show indicator if playing or already in queue
+        if (indicator_text) {
+            SDL_Surface* indicator = TextCache_render(get_font_tiny(), indicator_text, is_selected ? uintToColour(THEME_COLOR5_255) : COLOR_GRAY);
             if (indicator) {
                 SDL_BlitSurface(indicator, NULL, screen, &(SDL_Rect){title_x, y + (layout.item_h - indicator->h) / 2});
                 title_x += indicator->w + SCALE1(4);
-                SDL_FreeSurface(indicator);
             }
         }
 
@@ -153,10 +190,9 @@ void render_youtube_results(SDL_Surface* screen, int show_setting,
             int m = result->duration_sec / 60;
             int s = result->duration_sec % 60;
             snprintf(dur, sizeof(dur), "%d:%02d", m, s);
-            SDL_Surface* dur_text = TTF_RenderUTF8_Blended(get_font_tiny(), dur, COLOR_GRAY);
+            SDL_Surface* dur_text = TextCache_render(get_font_tiny(), dur, COLOR_GRAY);
             if (dur_text) {
                 SDL_BlitSurface(dur_text, NULL, screen, &(SDL_Rect){hw - dur_text->w - SCALE1(PADDING * 2), y + (layout.item_h - dur_text->h) / 2});
-                SDL_FreeSurface(dur_text);
             }
         }
     }
@@ -194,8 +230,13 @@ void render_youtube_results(SDL_Surface* screen, int show_setting,
         }
     }
 
-    // Button hints
-    GFX_blitButtonGroup((char*[]){"U/D", "SELECT", NULL}, 0, screen, 0);
+    // Button hints (play now only once an item is selected)
+    if (selected >= 0 && result_count > 0) {
+        const char* play_hint = strcmp(results[selected].video_id, playing_id) == 0 ? "STOP" : "PLAY";
+        GFX_blitButtonGroup((char*[]){"Y", (char*)play_hint, NULL}, 0, screen, 0);
+    } else {
+        GFX_blitButtonGroup((char*[]){"U/D", "SELECT", NULL}, 0, screen, 0);
+    }
 
     // Dynamic hint based on queue status (only show A action if item is selected)
     if (selected >= 0 && result_count > 0) {
@@ -213,6 +254,7 @@ void render_youtube_results(SDL_Surface* screen, int show_setting,
 // Render YouTube download queue
 void render_youtube_queue(SDL_Surface* screen, int show_setting,
                           int queue_selected, int* queue_scroll) {
+    PROFILE_SCOPE("render_youtube_queue");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -249,9 +291,7 @@ void render_youtube_queue(SDL_Surface* screen, int show_setting,
         // Calculate status indicator width
         int status_width = 0;
         if (status_str) {
-            int st_w, st_h;
-            TTF_SizeUTF8(get_font_tiny(), status_str, &st_w, &st_h);
-            status_width = st_w + SCALE1(8);
+            status_width = TextCache_width(get_font_tiny(), status_str) + SCALE1(8);
         }
 
         // Render pill background and get text position
@@ -260,11 +300,10 @@ void render_youtube_queue(SDL_Surface* screen, int show_setting,
 
         // Render status indicator
         if (status_str) {
-            SDL_Surface* status_text = TTF_RenderUTF8_Blended(get_font_tiny(), status_str, selected ? uintToColour(THEME_COLOR5_255) : status_color);
+            SDL_Surface* status_text = TextCache_render(get_font_tiny(), status_str, selected ? uintToColour(THEME_COLOR5_255) : status_color);
             if (status_text) {
                 SDL_BlitSurface(status_text, NULL, screen, &(SDL_Rect){title_x, y + (layout.item_h - status_text->h) / 2});
                 title_x += status_text->w + SCALE1(8);
-                SDL_FreeSurface(status_text);
             }
         }
 
@@ -273,8 +312,10 @@ void render_youtube_queue(SDL_Surface* screen, int show_setting,
         render_list_item_text(screen, &youtube_queue_scroll_text, item->title, get_font_medium(),
                               title_x, pos.text_y, title_max_w, selected);
 
-        // Progress bar for downloading items (always on right, outside pill)
-        if (item->status == YOUTUBE_STATUS_DOWNLOADING) {
+        // Progress bar for downloading items, and pending ones with a partial download
+        // to resume (always on right, outside pill)
+        if (item->status == YOUTUBE_STATUS_DOWNLOADING ||
+            (item->status == YOUTUBE_STATUS_PENDING && item->progress_percent > 0)) {
             int bar_w = SCALE1(60);
             int bar_h = SCALE1(8);
             int bar_x = hw - SCALE1(PADDING * 2) - bar_w;
@@ -323,6 +364,7 @@ void render_youtube_queue(SDL_Surface* screen, int show_setting,
 
 // Render YouTube downloading progress
 void render_youtube_downloading(SDL_Surface* screen, int show_setting) {
+    PROFILE_SCOPE("render_youtube_downloading");
     GFX_clear(screen);
 
     int hw = screen->w;
@@ -331,15 +373,12 @@ void render_youtube_downloading(SDL_Surface* screen, int show_setting) {
 
     render_screen_header(screen, "Downloading...", show_setting);
 
-    const YouTubeDownloadStatus* status = YouTube_getDownloadStatus();
+    YouTubeDownloadStatus download;
+    YouTube_getDownloadStatus(&download);
+    const YouTubeDownloadStatus* status = &download;
 
-    // Get current item progress from queue
-    int current_progress = 0;
-    int qcount = 0;
-    YouTubeQueueItem* queue = YouTube_queueGet(&qcount);
-    if (queue && status->current_index >= 0 && status->current_index < qcount) {
-        current_progress = queue[status->current_index].progress_percent;
-    }
+    // Downloads run in parallel: the bar shows the whole batch
+    int current_progress = status->progress_percent;
 
     // Progress info
     char progress[128];
@@ -350,9 +389,15 @@ void render_youtube_downloading(SDL_Surface* screen, int show_setting) {
         SDL_FreeSurface(prog_text);
     }
 
-    // Current track
+    // Current track, and how many more are downloading alongside it
     if (strlen(status->current_title) > 0) {
-        GFX_truncateText(get_font_small(), status->current_title, truncated, hw - SCALE1(PADDING * 4), 0);
+        char current[YOUTUBE_MAX_TITLE + 16];
+        if (status->active_count > 1) {
+            snprintf(current, sizeof(current), "%s (+%d)", status->current_title, status->active_count - 1);
+        } else {
+            snprintf(current, sizeof(current), "%s", status->current_title);
+        }
+        TextCache_truncate(get_font_small(), current, truncated, hw - SCALE1(PADDING * 4), 0);
         SDL_Surface* curr_text = TTF_RenderUTF8_Blended(get_font_small(), truncated, COLOR_WHITE);
         if (curr_text) {
             SDL_BlitSurface(curr_text, NULL, screen, &(SDL_Rect){(hw - curr_text->w) / 2, hh / 2 - SCALE1(20)});
@@ -412,6 +457,7 @@ void youtube_queue_animate_scroll(void) {
 
 // Render YouTube yt-dlp update progress
 void render_youtube_updating(SDL_Surface* screen, int show_setting) {
+    PROFILE_SCOPE("render_youtube_updating");
     GFX_clear(screen);
 
     int hw = screen->w;
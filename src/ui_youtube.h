@@ -12,12 +12,13 @@ void render_youtube_menu(SDL_Surface* screen, int show_setting, int menu_selecte
 // Render YouTube searching status
 void render_youtube_searching(SDL_Surface* screen, int show_setting, const char* search_query);
 
-// Render YouTube search results
+// Render YouTube search results (playing_id: result playing with play now, or "")
 void render_youtube_results(SDL_Surface* screen, int show_setting,
                             const char* search_query,
                             YouTubeResult* results, int result_count,
                             int selected, int* scroll,
-                            char* toast_message, uint32_t toast_time, bool searching);
+                            char* toast_message, uint32_t toast_time, bool searching,
+                            const char* playing_id);
 
 // Render YouTube download queue
 void render_youtube_queue(SDL_Surface* screen, int show_setting,
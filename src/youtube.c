@@ -1,5 +1,6 @@
 #define _GNU_SOURCE
 #include "youtube.h"
+#include "thread_role.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,17 +12,33 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <signal.h>
+#include <stdint.h>
 #include <ctype.h>
+#include <time.h>
+#include <poll.h>
+#include <stdarg.h>
 
 #include "defines.h"
 #include "api.h"
+#include "youtube_cache.h"
+#include "youtube_index.h"
+#include "release_check.h"
+#include "bgtransfer.h"
+#include "profile.h"
+#include "trace.h"
+#include "jobs.h"
+#include "radio_net.h"
+#include "seqlock.h"
+#include "folder_art.h"
+#include "youtube_search.h"
+#include "settings.h"
 
 // Paths
 static char ytdlp_path[512] = "";
 static char keyboard_path[512] = "";
-static char wget_path[512] = "";
 static char download_dir[512] = "";
 static char queue_file[512] = "";
+static char settings_file[512] = "";  // Settings of before the settings store
 static char version_file[512] = "";
 static char pak_path[512] = "";
 
@@ -30,15 +47,74 @@ static YouTubeState youtube_state = YOUTUBE_STATE_IDLE;
 static char error_message[256] = "";
 
 // Download queue
+// Persisted as a journal (queue_file) that changes are appended to, one line each:
+//   A|id|title                  queued
+//   P|id|progress|attempts      progress kept with a partial download, failed tries
+//   R|id                        removed
+//   D|id                        downloaded (and off the queue)
+// Loading replays it; once it has grown well past what it describes it is
+// rewritten as just the live lines (compacted). youtube_index maps IDs to their
+// queue slot and downloaded flag.
+#define JOURNAL_SLACK_LINES 256     // Stale lines allowed beyond twice the live ones
+#define YOUTUBE_THUMB_HEIGHT 480    // Downloaded thumbnails are shrunk to at most this
+#define YOUTUBE_OFFLINE_WAIT_US 2000000  // Download workers look for the network this often
 static YouTubeQueueItem download_queue[YOUTUBE_MAX_QUEUE];
 static int queue_count = 0;
 static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int journal_lines = 0;           // Lines in queue_file (queue_mutex)
+static int journal_live_lines = 0;      // Lines the last compaction wrote
 
 // Download status
+// Up to download_workers threads take pending items off the queue, each running
+// its yt-dlp in a process group of its own.
 static YouTubeDownloadStatus download_status = {0};
-static pthread_t download_thread;
 static volatile bool download_running = false;
 static volatile bool download_should_stop = false;
+static int download_workers = YOUTUBE_DOWNLOAD_WORKERS_DEFAULT;   // Configured
+static int download_workers_active = 0;                 // Running worker threads (atomic)
+static pid_t download_pids[YOUTUBE_DOWNLOAD_WORKERS_MAX];   // Process group per worker (queue_mutex)
+static volatile bool download_throttled = false;        // Workers after the first paused
+static YouTubeDownloadFormat download_format = YOUTUBE_FORMAT_M4A;
+
+// download_status holds the batch counters (queue_mutex); the UI reads the
+// status published from it after each change (YouTube_getDownloadStatus)
+static YouTubeDownloadStatus status_published = {0};
+static Seqlock status_lock = {0};
+
+// Work out the items in progress and the batch as a whole, and publish them
+// (caller holds queue_mutex, which serializes publishers)
+static void publish_download_status(void) {
+    int active = 0, active_percent = 0;
+    download_status.current_index = -1;
+    for (int i = 0; i < queue_count; i++) {
+        if (download_queue[i].status != YOUTUBE_STATUS_DOWNLOADING) continue;
+        if (active == 0) {
+            download_status.current_index = i;
+            strncpy(download_status.current_title, download_queue[i].title, sizeof(download_status.current_title) - 1);
+        }
+        active++;
+        active_percent += download_queue[i].progress_percent;
+    }
+    int done = download_status.completed_count + download_status.failed_count;
+    download_status.active_count = active;
+    download_status.progress_percent = download_status.total_items > 0 ?
+        (done * 100 + active_percent) / download_status.total_items : 0;
+    Seqlock_write(&status_lock, &status_published, &download_status, sizeof(YouTubeDownloadStatus));
+}
+
+// Play now
+// The stream thread runs yt-dlp piping the audio into ffmpeg (one process group)
+// and watches the MP3 ffmpeg writes, until it's playable and then complete.
+#define STREAM_READY_BYTES (96 * 1024)  // A few seconds of audio before playing
+static YouTubeStreamStatus stream_status = {0};
+static pthread_mutex_t stream_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t stream_thread;
+static bool stream_joinable = false;                // Started and not joined yet (main thread)
+static volatile bool stream_should_stop = false;
+static pid_t stream_pid = 0;                        // yt-dlp, leading the group (stream_mutex)
+static bool stream_changed = false;                 // State changed since the last poll
+static char stream_title[YOUTUBE_MAX_TITLE];
+static char stream_artist[YOUTUBE_MAX_ARTIST];
 
 // Update status
 static YouTubeUpdateStatus update_status = {0};
@@ -47,22 +123,119 @@ static volatile bool update_running = false;
 static volatile bool update_should_stop = false;
 
 // Search
+// Searches go to YouTube Music's endpoint first (youtube_search.h), on a thread
+// that is left to finish on its own when cancelled. If that fails they go to
+// yt-dlp, whose results a reader thread appends as they are printed; after an
+// answer the native search can't read, yt-dlp answers for the rest of the session.
+// The main loop copies results out with YouTube_searchPoll.
 static pthread_t search_thread;
+static bool search_joinable = false;                // Started and not joined yet (main thread)
 static volatile bool search_running = false;
 static volatile bool search_should_stop = false;
+static pthread_mutex_t search_mutex = PTHREAD_MUTEX_INITIALIZER;
 static YouTubeResult search_results[YOUTUBE_MAX_RESULTS];
 static int search_result_count = 0;
+static int search_max_results = 0;
+static bool search_changed = false;                 // Results or state changed since the last poll
+static pid_t search_pid = 0;                        // yt-dlp answering the search (0 = reaped)
+static int search_fd = -1;                          // Its stdout, read by the search thread
+static char search_query[256];                      // Sanitized query, for the cache
+static YouTubeResult search_stale[YOUTUBE_MAX_RESULTS];    // Expired cached results, if the search fails
+static int search_stale_count = 0;
+static bool search_native = false;                  // The running search is the native one
+static bool search_fallback = false;                // It failed: ask yt-dlp (search_mutex)
+static bool search_native_broken = false;           // Its answers can't be read (search_mutex)
+static uint32_t search_generation = 0;              // Bumped when a native search is abandoned (search_mutex)
+
+// A native search, owned by its thread
+typedef struct {
+    char query[256];
+    int max_results;
+    uint32_t generation;
+} NativeSearch;
+
+// Spare search process (main thread)
+// yt-dlp started ahead with its search options and "-a -", so it loads the
+// interpreter and extractors and then waits for the query on stdin. A search
+// hands its query to the spare, and the next spare is started right away.
+typedef struct {
+    pid_t pid;                  // 0 = none
+    int query_fd;               // Its stdin
+    int results_fd;             // Its stdout
+} SearchWorker;
+
+static SearchWorker search_worker = {0, -1, -1};
+static bool search_worker_wanted = false;
+
+#define SEARCH_ERROR_FILE "/tmp/yt_search_error.txt"
 
 // Current yt-dlp version
 static char current_version[32] = "unknown";
 
+// Asking yt-dlp for its version starts Python (seconds): done in the background
+static pthread_mutex_t version_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t version_cond = PTHREAD_COND_INITIALIZER;
+static bool version_probing = false;
+static pid_t version_pid = 0;           // Its process group (version_mutex)
+
 // Forward declarations
 static void* download_thread_func(void* arg);
+static int search_start_ytdlp(void);
 static void* update_thread_func(void* arg);
 static int run_command(const char* cmd, char* output, size_t output_size);
+static FILE* command_start(const char* cmd, pid_t* pid);
 static void sanitize_filename(const char* input, char* output, size_t max_len);
+static void remove_partial_files(const char* video_id);
+static void journal_append(const char* fmt, ...);
+static void journal_compact(void);
+
+static void version_job(void* arg, JobToken* token) {
+    (void)arg;
+    (void)token;
+    TRACE_SCOPE("ytdlp_version");
+
+    char version[32] = "";
+    char cmd[600];
+    snprintf(cmd, sizeof(cmd), "%s --version 2>/dev/null", ytdlp_path);
+    pid_t pid = 0;
+    FILE* pipe = command_start(cmd, &pid);
+    if (pipe) {
+        pthread_mutex_lock(&version_mutex);
+        version_pid = pid;
+        pthread_mutex_unlock(&version_mutex);
+        if (fgets(version, sizeof(version), pipe)) {
+            char* nl = strchr(version, '\n');
+            if (nl) *nl = '\0';
+        }
+        fclose(pipe);
+        waitpid(pid, NULL, 0);
+    }
+
+    pthread_mutex_lock(&version_mutex);
+    version_pid = 0;
+    if (version[0]) {
+        snprintf(current_version, sizeof(current_version), "%s", version);
+        // Save to version file for future
+        FILE* vf = fopen(version_file, "w");
+        if (vf) {
+            fprintf(vf, "%s\n", current_version);
+            fclose(vf);
+        }
+    }
+    version_probing = false;
+    pthread_cond_broadcast(&version_cond);
+    pthread_mutex_unlock(&version_mutex);
+}
+
+// Let a running version probe finish (the updater compares against it)
+static void version_wait(void) {
+    pthread_mutex_lock(&version_mutex);
+    while (version_probing) pthread_cond_wait(&version_cond, &version_mutex);
+    pthread_mutex_unlock(&version_mutex);
+}
 
 int YouTube_init(void) {
+    TRACE_SCOPE("YouTube_init");
     // Build paths based on pak location
     // Try multiple locations where the pak might be
     const char* search_paths[] = {
@@ -99,15 +272,14 @@ int YouTube_init(void) {
     // Set paths
     snprintf(ytdlp_path, sizeof(ytdlp_path), "%s/bins/yt-dlp", pak_path);
     snprintf(keyboard_path, sizeof(keyboard_path), "%s/bins/keyboard", pak_path);
-    snprintf(wget_path, sizeof(wget_path), "%s/bins/wget", pak_path);
     snprintf(version_file, sizeof(version_file), "%s/state/yt-dlp_version.txt", pak_path);
     snprintf(queue_file, sizeof(queue_file), "%s/state/youtube_queue.txt", pak_path);
+    snprintf(settings_file, sizeof(settings_file), "%s/state/youtube_settings.txt", pak_path);
     snprintf(download_dir, sizeof(download_dir), "%s/Music", SDCARD_PATH);
 
     // Ensure binaries are executable
     chmod(ytdlp_path, 0755);
     chmod(keyboard_path, 0755);
-    chmod(wget_path, 0755);
 
     // Create music directory if needed
     mkdir(download_dir, 0755);
@@ -123,41 +295,68 @@ int YouTube_init(void) {
         fclose(f);
     }
 
-    // If version is still unknown, try to get it from yt-dlp --version
+    // If version is still unknown, get it from yt-dlp --version without waiting
     if (strcmp(current_version, "unknown") == 0) {
-        char cmd[600];
-        snprintf(cmd, sizeof(cmd), "%s --version 2>/dev/null", ytdlp_path);
-        FILE* pipe = popen(cmd, "r");
-        if (pipe) {
-            if (fgets(current_version, sizeof(current_version), pipe)) {
-                char* nl = strchr(current_version, '\n');
-                if (nl) *nl = '\0';
-                // Save to version file for future
-                FILE* vf = fopen(version_file, "w");
-                if (vf) {
-                    fprintf(vf, "%s\n", current_version);
-                    fclose(vf);
-                }
-            }
-            pclose(pipe);
-        }
+        version_probing = true;
+        if (Jobs_post(JOB_PRIORITY_BACKGROUND, version_job, NULL, NULL) != 0) version_probing = false;
     }
 
-    // Load queue from file
+    // Settings from the file of before the settings store, until they were saved there
+    if (!Settings_has(SETTING_YOUTUBE_WORKERS)) {
+        f = fopen(settings_file, "r");
+        if (f) {
+            int workers = 0, format = 0;
+            if (fscanf(f, "%d", &workers) == 1) Settings_setInt(SETTING_YOUTUBE_WORKERS, workers);
+            if (fscanf(f, "%d", &format) == 1) Settings_setInt(SETTING_YOUTUBE_FORMAT, format);
+            fclose(f);
+        }
+    }
+    int workers = Settings_getInt(SETTING_YOUTUBE_WORKERS, download_workers);
+    if (workers >= 1 && workers <= YOUTUBE_DOWNLOAD_WORKERS_MAX) {
+        download_workers = workers;
+    }
+    int format = Settings_getInt(SETTING_YOUTUBE_FORMAT, (int)download_format);
+    if (format >= 0 && format < YOUTUBE_FORMAT_COUNT) {
+        download_format = (YouTubeDownloadFormat)format;
+    }
     YouTube_loadQueue();
 
     return 0;
 }
 
-void YouTube_cleanup(void) {
-    // Stop any running operations
-    YouTube_downloadStop();
-    YouTube_cancelUpdate();
-    YouTube_cancelSearch();
+// Kill every child's process group outright (shutdown): a yt-dlp asked with
+// SIGTERM can take a second to wind down Python, and nothing it would still
+// write is wanted. The threads reading them see their output end.
+static void kill_children(void) {
+    pthread_mutex_lock(&stream_mutex);
+    if (stream_pid > 0) kill(-stream_pid, SIGKILL);
+    pthread_mutex_unlock(&stream_mutex);
+    pthread_mutex_lock(&queue_mutex);
+    for (int i = 0; i < YOUTUBE_DOWNLOAD_WORKERS_MAX; i++) {
+        if (download_pids[i] > 0) kill(-download_pids[i], SIGKILL);
+    }
+    pthread_mutex_unlock(&queue_mutex);
+    pthread_mutex_lock(&search_mutex);
+    if (search_pid > 0) kill(search_pid, SIGKILL);
+    pthread_mutex_unlock(&search_mutex);
+    if (search_worker.pid > 0) kill(search_worker.pid, SIGKILL);
+    pthread_mutex_lock(&version_mutex);
+    if (version_pid > 0) kill(-version_pid, SIGKILL);
+    pthread_mutex_unlock(&version_mutex);
+}
 
-    // Save queue
+void YouTube_cleanup(void) {
+    // The queue first: what follows only abandons work
     YouTube_saveQueue();
 
+    // Downloads and the update are left to the process exit (their threads are
+    // detached); the stream and search threads end as their children die
+    download_should_stop = true;
+    update_should_stop = true;
+    kill_children();
+    YouTube_streamStop();
+    YouTube_searchRelease();    // First, so finishing the search starts no spare
+    YouTube_cancelSearch();
 }
 
 bool YouTube_isAvailable(void) {
@@ -168,24 +367,279 @@ const char* YouTube_getVersion(void) {
     return current_version;
 }
 
-int YouTube_search(const char* query, YouTubeResult* results, int max_results) {
-    if (!query || !results || max_results <= 0) {
+// Start the spare search process (no-op if one is running)
+static void search_worker_start(void) {
+    if (search_worker.pid > 0) return;
+
+    // Close-on-exec, so processes other threads start don't hold the pipes open
+    int query_pipe[2], results_pipe[2];
+    if (pipe2(query_pipe, O_CLOEXEC) != 0) return;
+    if (pipe2(results_pipe, O_CLOEXEC) != 0) {
+        close(query_pipe[0]);
+        close(query_pipe[1]);
+        return;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Child: query from stdin, results (one line per video) to stdout
+        dup2(query_pipe[0], STDIN_FILENO);
+        dup2(results_pipe[1], STDOUT_FILENO);
+        int err = open(SEARCH_ERROR_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (err >= 0) dup2(err, STDERR_FILENO);
+        for (int fd = STDERR_FILENO + 1; fd < 256; fd++) close(fd);
+        execl(ytdlp_path, ytdlp_path,
+              "--flat-playlist", "--lazy-playlist", "--no-warnings",
+              "--print", "%(id)s\t%(title)s\t%(duration_string)s\t%(channel)s",
+              "-a", "-", (char*)NULL);
+        _exit(127);
+    }
+
+    close(query_pipe[0]);
+    close(results_pipe[1]);
+    if (pid < 0) {
+        close(query_pipe[1]);
+        close(results_pipe[0]);
+        return;
+    }
+    search_worker.pid = pid;
+    search_worker.query_fd = query_pipe[1];
+    search_worker.results_fd = results_pipe[0];
+}
+
+// Stop the spare search process
+static void search_worker_stop(void) {
+    if (search_worker.pid <= 0) return;
+    close(search_worker.query_fd);
+    close(search_worker.results_fd);
+    kill(search_worker.pid, SIGTERM);
+    waitpid(search_worker.pid, NULL, 0);
+    search_worker.pid = 0;
+    search_worker.query_fd = -1;
+    search_worker.results_fd = -1;
+}
+
+// Take the spare search process, starting one if there is none or it exited
+static bool search_worker_take(SearchWorker* worker) {
+    if (search_worker.pid > 0 && waitpid(search_worker.pid, NULL, WNOHANG) != 0) {
+        // Exited on its own (reaped): only the pipes are left
+        close(search_worker.query_fd);
+        close(search_worker.results_fd);
+        search_worker.pid = 0;
+    }
+    search_worker_start();
+    if (search_worker.pid <= 0) return false;
+
+    *worker = search_worker;
+    search_worker.pid = 0;
+    search_worker.query_fd = -1;
+    search_worker.results_fd = -1;
+    return true;
+}
+
+// Write all of buf to a pipe, failing instead of raising SIGPIPE if the reader is gone
+static bool write_query(int fd, const char* buf, size_t len) {
+    sigset_t pipe_set, old_set;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &old_set);
+
+    bool ok = true;
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        buf += n;
+        len -= n;
+    }
+
+    if (!ok && errno == EPIPE) {
+        // Consume the SIGPIPE raised for this thread before unblocking
+        struct timespec zero = {0, 0};
+        sigtimedwait(&pipe_set, NULL, &zero);
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    return ok;
+}
+
+void YouTube_searchWarmup(void) {
+    search_worker_wanted = true;
+    search_worker_start();
+}
+
+void YouTube_searchRelease(void) {
+    search_worker_wanted = false;
+    search_worker_stop();
+}
+
+// Parse a result line: id<TAB>title<TAB>duration<TAB>channel (tab-separated)
+static bool parse_search_line(char* line, YouTubeResult* result) {
+    // Remove newline
+    char* nl = strchr(line, '\n');
+    if (nl) *nl = '\0';
+
+    char* id = strtok(line, "\t");
+    char* title = strtok(NULL, "\t");
+    char* duration = strtok(NULL, "\t");
+    char* channel = strtok(NULL, "\t");
+    if (!id || !title || strlen(id) == 0) return false;
+
+    strncpy(result->title, title, YOUTUBE_MAX_TITLE - 1);
+    result->title[YOUTUBE_MAX_TITLE - 1] = '\0';
+
+    strncpy(result->video_id, id, YOUTUBE_VIDEO_ID_LEN - 1);
+    result->video_id[YOUTUBE_VIDEO_ID_LEN - 1] = '\0';
+
+    // Fields yt-dlp has no value for print as "NA"
+    result->artist[0] = '\0';
+    if (channel && strcmp(channel, "NA") != 0) {
+        strncpy(result->artist, channel, YOUTUBE_MAX_ARTIST - 1);
+        result->artist[YOUTUBE_MAX_ARTIST - 1] = '\0';
+    }
+
+    // Parse duration string (e.g., "3:45" or "1:23:45")
+    result->duration_sec = 0;
+    if (duration && strlen(duration) > 0) {
+        int h = 0, m = 0, s = 0;
+        int parts = sscanf(duration, "%d:%d:%d", &h, &m, &s);
+        if (parts == 2) {
+            result->duration_sec = h * 60 + m;
+        } else if (parts == 3) {
+            result->duration_sec = h * 3600 + m * 60 + s;
+        }
+    }
+    return true;
+}
+
+// Read the results of the running search as yt-dlp prints them
+static void* search_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    FILE* f = fdopen(search_fd, "r");
+    if (!f) close(search_fd);
+
+    char line[512];
+    while (f && !search_should_stop && fgets(line, sizeof(line), f)) {
+        YouTubeResult result;
+        if (!parse_search_line(line, &result)) continue;
+
+        pthread_mutex_lock(&search_mutex);
+        bool full = search_result_count >= search_max_results;
+        if (!full) {
+            search_results[search_result_count++] = result;
+            search_changed = true;
+        }
+        pthread_mutex_unlock(&search_mutex);
+        if (full) break;
+    }
+    if (f) fclose(f);  // Stops yt-dlp if it is still printing
+
+    // Wait without reaping, so a cancel can't signal a reused pid
+    siginfo_t info;
+    waitid(P_PID, search_pid, &info, WEXITED | WNOWAIT);
+    pthread_mutex_lock(&search_mutex);
+    pid_t pid = search_pid;
+    search_pid = 0;
+    pthread_mutex_unlock(&search_mutex);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    bool failed = !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+    if (!search_should_stop && failed) {
+        // Try to read error message
+        FILE* err = fopen(SEARCH_ERROR_FILE, "r");
+        if (err) {
+            char err_line[256];
+            if (fgets(err_line, sizeof(err_line), err)) {
+                LOG_error("yt-dlp error: %s\n", err_line);
+            }
+            fclose(err);
+        }
+    }
+
+    // Keep complete results; a search that found nothing (offline) gets the
+    // expired ones instead
+    if (!search_should_stop) {
+        YouTubeResult found[YOUTUBE_MAX_RESULTS];
+        pthread_mutex_lock(&search_mutex);
+        int count = search_result_count;
+        memcpy(found, search_results, (size_t)count * sizeof(YouTubeResult));
+        if (count == 0 && search_stale_count > 0) {
+            memcpy(search_results, search_stale, (size_t)search_stale_count * sizeof(YouTubeResult));
+            search_result_count = search_stale_count;
+        }
+        pthread_mutex_unlock(&search_mutex);
+        if (count > 0 && (!failed || count >= search_max_results)) youtube_cache_store(search_query, search_max_results, found, count);
+    }
+
+    pthread_mutex_lock(&search_mutex);
+    search_changed = true;
+    pthread_mutex_unlock(&search_mutex);
+    search_running = false;
+    return NULL;
+}
+
+// Search through YouTube Music's endpoint; a failure leaves the search to yt-dlp.
+// An abandoned search (generation moved on) only frees its request.
+static void* native_search_thread_func(void* arg) {
+    NativeSearch* search = (NativeSearch*)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    YouTubeResult found[YOUTUBE_MAX_RESULTS];
+    int count = youtube_search_native(search->query, search->max_results, found);
+    if (count > 0) youtube_cache_store(search->query, search->max_results, found, count);
+
+    pthread_mutex_lock(&search_mutex);
+    bool current = search->generation == search_generation;
+    if (current) {
+        if (count >= 0) {
+            memcpy(search_results, found, (size_t)count * sizeof(YouTubeResult));
+            search_result_count = count;
+        } else {
+            search_fallback = true;
+            if (count == YOUTUBE_SEARCH_ERR_FORMAT) {
+                LOG_error("YouTube search: unreadable answer, using yt-dlp\n");
+                search_native_broken = true;
+            }
+        }
+        search_changed = true;
+        search_running = false;
+    }
+    pthread_mutex_unlock(&search_mutex);
+    free(search);
+    return NULL;
+}
+
+// Join a finished or cancelled search and get the next spare ready (main thread)
+static void search_finish(void) {
+    pthread_join(search_thread, NULL);
+    search_joinable = false;
+    youtube_state = YOUTUBE_STATE_IDLE;
+
+    // Next search starts warm while these results are browsed
+    if (search_worker_wanted) search_worker_start();
+}
+
+int YouTube_searchStart(const char* query, int max_results) {
+    if (!query || max_results <= 0) {
         return -1;
     }
 
-    if (search_running) {
+    if (search_joinable) {
         return -1;  // Already searching
     }
 
-    youtube_state = YOUTUBE_STATE_SEARCHING;
-
-    // Sanitize query - escape special characters
+    // Sanitize query - it goes to yt-dlp as one line of its batch input (no shell)
     char safe_query[256];
     int j = 0;
     for (int i = 0; query[i] && j < (int)sizeof(safe_query) - 2; i++) {
         char c = query[i];
-        // Skip potentially dangerous characters for shell
-        if (c == '"' || c == '\'' || c == '`' || c == '$' || c == '\\' || c == ';' || c == '&' || c == '|') {
+        // Skip line breaks and other control characters
+        if ((unsigned char)c < 0x20) {
             continue;
         }
         safe_query[j++] = c;
@@ -194,105 +648,145 @@ int YouTube_search(const char* query, YouTubeResult* results, int max_results) {
 
     int num_results = max_results > YOUTUBE_MAX_RESULTS ? YOUTUBE_MAX_RESULTS : max_results;
 
-    // Use a temp file to capture results (more reliable than pipe)
-    const char* temp_file = "/tmp/yt_search_results.txt";
-    const char* temp_err = "/tmp/yt_search_error.txt";
+    // A recent search is answered from the cache without yt-dlp
+    YouTubeResult cached[YOUTUBE_MAX_RESULTS];
+    int cached_count = 0;
+    YouTubeCacheResult cache = youtube_cache_lookup(safe_query, num_results, cached, &cached_count);
+    if (cache == YOUTUBE_CACHE_FRESH) {
+        pthread_mutex_lock(&search_mutex);
+        memcpy(search_results, cached, (size_t)cached_count * sizeof(YouTubeResult));
+        search_result_count = cached_count;
+        search_changed = true;
+        pthread_mutex_unlock(&search_mutex);
+        youtube_state = YOUTUBE_STATE_IDLE;
+        return 0;
+    }
 
-    // Build yt-dlp search command - use tab as delimiter to avoid issues with | in titles
-    char cmd[2048];
-    snprintf(cmd, sizeof(cmd),
-        "%s 'ytsearch%d:%s music' "
-        "--flat-playlist "
-        "--no-warnings "
-        "--print '%%(id)s\t%%(title)s\t%%(duration_string)s' "
-        "> %s 2> %s",
-        ytdlp_path,
-        num_results,
-        safe_query,
-        temp_file,
-        temp_err);
-
-
-    int ret = system(cmd);
-    if (ret != 0) {
-        // Try to read error message
-        FILE* err = fopen(temp_err, "r");
-        if (err) {
-            char err_line[256];
-            if (fgets(err_line, sizeof(err_line), err)) {
-                LOG_error("yt-dlp error: %s\n", err_line);
+    pthread_mutex_lock(&search_mutex);
+    search_result_count = 0;
+    search_max_results = num_results;
+    snprintf(search_query, sizeof(search_query), "%s", safe_query);
+    search_stale_count = cache == YOUTUBE_CACHE_STALE ? cached_count : 0;
+    memcpy(search_stale, cached, (size_t)search_stale_count * sizeof(YouTubeResult));
+    search_changed = true;
+    search_fallback = false;
+    bool native = !search_native_broken;
+    pthread_mutex_unlock(&search_mutex);
+
+    if (native) {
+        NativeSearch* search = calloc(1, sizeof(NativeSearch));
+        if (search) {
+            snprintf(search->query, sizeof(search->query), "%s", safe_query);
+            search->max_results = num_results;
+            pthread_mutex_lock(&search_mutex);
+            search->generation = search_generation;
+            pthread_mutex_unlock(&search_mutex);
+
+            search_should_stop = false;
+            search_running = true;
+            if (pthread_create(&search_thread, NULL, native_search_thread_func, search) == 0) {
+                search_native = true;
+                search_joinable = true;
+                youtube_state = YOUTUBE_STATE_SEARCHING;
+                return 0;
             }
-            fclose(err);
+            search_running = false;
+            free(search);
         }
     }
+    return search_start_ytdlp();
+}
 
-    // Read results from temp file
-    FILE* f = fopen(temp_file, "r");
-    if (!f) {
-        strcpy(error_message, "Failed to read search results");
+// Hand the query set up by YouTube_searchStart to the spare yt-dlp (tab-separated
+// id, title, duration per line)
+static int search_start_ytdlp(void) {
+    SearchWorker worker;
+    if (!search_worker_take(&worker)) {
+        strcpy(error_message, "Failed to start yt-dlp");
         youtube_state = YOUTUBE_STATE_ERROR;
         return -1;
     }
 
     char line[512];
-    int count = 0;
-
-    while (fgets(line, sizeof(line), f) && count < max_results) {
-        // Remove newline
-        char* nl = strchr(line, '\n');
-        if (nl) *nl = '\0';
-
-        // Skip empty lines
-        if (line[0] == '\0') continue;
-
-        // Make a copy for strtok since it modifies the string
-        char line_copy[512];
-        strncpy(line_copy, line, sizeof(line_copy) - 1);
-        line_copy[sizeof(line_copy) - 1] = '\0';
-
-        // Parse: id<TAB>title<TAB>duration (tab-separated)
-        char* id = strtok(line_copy, "\t");
-        char* title = strtok(NULL, "\t");
-        char* duration = strtok(NULL, "\t");
-
-        if (id && title && strlen(id) > 0) {
-            strncpy(results[count].title, title, YOUTUBE_MAX_TITLE - 1);
-            results[count].title[YOUTUBE_MAX_TITLE - 1] = '\0';
-
-            strncpy(results[count].video_id, id, YOUTUBE_VIDEO_ID_LEN - 1);
-            results[count].video_id[YOUTUBE_VIDEO_ID_LEN - 1] = '\0';
-
-            results[count].artist[0] = '\0';
-
-            // Parse duration string (e.g., "3:45" or "1:23:45")
-            results[count].duration_sec = 0;
-            if (duration && strlen(duration) > 0) {
-                int h = 0, m = 0, s = 0;
-                int parts = sscanf(duration, "%d:%d:%d", &h, &m, &s);
-                if (parts == 2) {
-                    results[count].duration_sec = h * 60 + m;
-                } else if (parts == 3) {
-                    results[count].duration_sec = h * 3600 + m * 60 + s;
-                }
-            }
-
-            count++;
-        }
+    int len = snprintf(line, sizeof(line), "ytsearch%d:%s music\n", search_max_results, search_query);
+    bool sent = write_query(worker.query_fd, line, len);
+    close(worker.query_fd);
+    if (!sent) {
+        close(worker.results_fd);
+        kill(worker.pid, SIGTERM);
+        waitpid(worker.pid, NULL, 0);
+        if (search_worker_wanted) search_worker_start();
+        strcpy(error_message, "Failed to start search");
+        youtube_state = YOUTUBE_STATE_ERROR;
+        return -1;
     }
 
-    fclose(f);
+    pthread_mutex_lock(&search_mutex);
+    search_pid = worker.pid;
+    search_fd = worker.results_fd;
+    pthread_mutex_unlock(&search_mutex);
 
-    // Cleanup temp files
-    unlink(temp_file);
-    unlink(temp_err);
+    search_should_stop = false;
+    search_running = true;
+    youtube_state = YOUTUBE_STATE_SEARCHING;
+    if (pthread_create(&search_thread, NULL, search_thread_func, NULL) != 0) {
+        search_running = false;
+        close(worker.results_fd);
+        kill(worker.pid, SIGTERM);
+        waitpid(worker.pid, NULL, 0);
+        search_pid = 0;
+        if (search_worker_wanted) search_worker_start();
+        strcpy(error_message, "Failed to create search thread");
+        youtube_state = YOUTUBE_STATE_ERROR;
+        return -1;
+    }
+    search_native = false;
+    search_joinable = true;
+    return 0;
+}
 
-    youtube_state = YOUTUBE_STATE_IDLE;
+bool YouTube_searchPoll(YouTubeResult* results, int* count, bool* done) {
+    bool finished = search_joinable && !search_running;
 
-    return count;
+    pthread_mutex_lock(&search_mutex);
+    bool changed = search_changed;
+    if (changed) {
+        memcpy(results, search_results, (size_t)search_result_count * sizeof(YouTubeResult));
+        *count = search_result_count;
+        search_changed = false;
+    }
+    pthread_mutex_unlock(&search_mutex);
+
+    if (finished) {
+        search_finish();
+        pthread_mutex_lock(&search_mutex);
+        bool fallback = search_fallback;
+        search_fallback = false;
+        pthread_mutex_unlock(&search_mutex);
+        if (fallback) search_start_ytdlp();
+    }
+    *done = !search_joinable;
+    return changed;
 }
 
 void YouTube_cancelSearch(void) {
+    if (!search_joinable) return;
     search_should_stop = true;
+
+    // yt-dlp stops printing, so the reader sees the end of its output; a native
+    // search may be waiting on the network, so it is left to finish unseen
+    pthread_mutex_lock(&search_mutex);
+    if (search_pid > 0) kill(search_pid, SIGTERM);
+    if (search_native) search_generation++;
+    pthread_mutex_unlock(&search_mutex);
+    if (search_native) {
+        pthread_detach(search_thread);
+        search_joinable = false;
+        search_running = false;
+        youtube_state = YOUTUBE_STATE_IDLE;
+        return;
+    }
+    search_finish();
 }
 
 int YouTube_queueAdd(const char* video_id, const char* title) {
@@ -301,11 +795,9 @@ int YouTube_queueAdd(const char* video_id, const char* title) {
     pthread_mutex_lock(&queue_mutex);
 
     // Check if already in queue
-    for (int i = 0; i < queue_count; i++) {
-        if (strcmp(download_queue[i].video_id, video_id) == 0) {
-            pthread_mutex_unlock(&queue_mutex);
-            return 0;  // Already in queue
-        }
+    if (youtube_index_slot(video_id) >= 0) {
+        pthread_mutex_unlock(&queue_mutex);
+        return 0;  // Already in queue
     }
 
     // Check queue size
@@ -315,20 +807,31 @@ int YouTube_queueAdd(const char* video_id, const char* title) {
     }
 
     // Add to queue
-    strncpy(download_queue[queue_count].video_id, video_id, YOUTUBE_VIDEO_ID_LEN - 1);
-    strncpy(download_queue[queue_count].title, title, YOUTUBE_MAX_TITLE - 1);
-    download_queue[queue_count].status = YOUTUBE_STATUS_PENDING;
-    download_queue[queue_count].progress_percent = 0;
+    YouTubeQueueItem* item = &download_queue[queue_count];
+    memset(item, 0, sizeof(YouTubeQueueItem));
+    strncpy(item->video_id, video_id, YOUTUBE_VIDEO_ID_LEN - 1);
+    strncpy(item->title, title, YOUTUBE_MAX_TITLE - 1);
+    item->status = YOUTUBE_STATUS_PENDING;
+    youtube_index_set_slot(item->video_id, queue_count);
     queue_count++;
+    journal_append("A|%s|%s", item->video_id, item->title);
 
     pthread_mutex_unlock(&queue_mutex);
 
-    // Save queue to file
-    YouTube_saveQueue();
-
     return 1;  // Successfully added
 }
 
+// Take the item at index off the queue (caller holds queue_mutex)
+static void queue_remove_at(int index) {
+    youtube_index_set_slot(download_queue[index].video_id, -1);
+    for (int i = index; i < queue_count - 1; i++) {
+        download_queue[i] = download_queue[i + 1];
+        youtube_index_set_slot(download_queue[i].video_id, i);
+    }
+    queue_count--;
+    publish_download_status();     // Indexes past it moved
+}
+
 int YouTube_queueRemove(int index) {
     pthread_mutex_lock(&queue_mutex);
 
@@ -337,54 +840,53 @@ int YouTube_queueRemove(int index) {
         return -1;
     }
 
-    // Shift items
-    for (int i = index; i < queue_count - 1; i++) {
-        download_queue[i] = download_queue[i + 1];
-    }
-    queue_count--;
+    char video_id[YOUTUBE_VIDEO_ID_LEN];
+    snprintf(video_id, sizeof(video_id), "%s", download_queue[index].video_id);
+    queue_remove_at(index);
+    journal_append("R|%s", video_id);
 
     pthread_mutex_unlock(&queue_mutex);
 
-    YouTube_saveQueue();
+    remove_partial_files(video_id);
     return 0;
 }
 
-int YouTube_queueRemoveById(const char* video_id) {
-    if (!video_id) return -1;
+int YouTube_queueRemoveById(const char* id) {
+    if (!id) return -1;
+    char video_id[YOUTUBE_VIDEO_ID_LEN];  // id may point into the queue
+    snprintf(video_id, sizeof(video_id), "%s", id);
 
     pthread_mutex_lock(&queue_mutex);
 
-    int found_index = -1;
-    for (int i = 0; i < queue_count; i++) {
-        if (strcmp(download_queue[i].video_id, video_id) == 0) {
-            found_index = i;
-            break;
-        }
-    }
-
-    if (found_index < 0) {
+    int index = youtube_index_slot(video_id);
+    if (index < 0 || index >= queue_count) {
         pthread_mutex_unlock(&queue_mutex);
         return -1;  // Not found
     }
-
-    // Shift items
-    for (int i = found_index; i < queue_count - 1; i++) {
-        download_queue[i] = download_queue[i + 1];
-    }
-    queue_count--;
+    queue_remove_at(index);
+    journal_append("R|%s", video_id);
 
     pthread_mutex_unlock(&queue_mutex);
 
-    YouTube_saveQueue();
+    remove_partial_files(video_id);
     return 0;
 }
 
 int YouTube_queueClear(void) {
+    char removed[YOUTUBE_MAX_QUEUE][YOUTUBE_VIDEO_ID_LEN];
     pthread_mutex_lock(&queue_mutex);
+    int count = queue_count;
+    for (int i = 0; i < count; i++) {
+        memcpy(removed[i], download_queue[i].video_id, YOUTUBE_VIDEO_ID_LEN);
+        youtube_index_set_slot(removed[i], -1);
+    }
     queue_count = 0;
+    journal_compact();
     pthread_mutex_unlock(&queue_mutex);
 
-    YouTube_saveQueue();
+    for (int i = 0; i < count; i++) {
+        remove_partial_files(removed[i]);
+    }
     return 0;
 }
 
@@ -398,210 +900,336 @@ YouTubeQueueItem* YouTube_queueGet(int* count) {
 }
 
 bool YouTube_isInQueue(const char* video_id) {
-    if (!video_id) return false;
+    return youtube_index_slot(video_id) >= 0;
+}
 
+bool YouTube_isDownloaded(const char* video_id) {
+    return youtube_index_downloaded(video_id);
+}
+
+// Start cmd through the shell in a process group of its own, reading its output
+// (the group gets the pause and cancel signals, reaching yt-dlp and ffmpeg)
+static FILE* command_start(const char* cmd, pid_t* pid) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) != 0) return NULL;
+
+    pid_t child = fork();
+    if (child == 0) {
+        setpgid(0, 0);
+        dup2(fds[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", cmd, (char*)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+    if (child < 0) {
+        close(fds[0]);
+        return NULL;
+    }
+    setpgid(child, child);  // Also from here, so the group exists before it is signalled
+
+    FILE* pipe = fdopen(fds[0], "r");
+    if (!pipe) {
+        close(fds[0]);
+        kill(-child, SIGKILL);
+        waitpid(child, NULL, 0);
+        return NULL;
+    }
+    *pid = child;
+    return pipe;
+}
+
+// Set the progress of a queue item (items move as others finish, so by ID)
+static void set_item_progress(const char* video_id, int percent) {
     pthread_mutex_lock(&queue_mutex);
     for (int i = 0; i < queue_count; i++) {
         if (strcmp(download_queue[i].video_id, video_id) == 0) {
-            pthread_mutex_unlock(&queue_mutex);
-            return true;
+            download_queue[i].progress_percent = percent;
+            publish_download_status();
+            break;
         }
     }
     pthread_mutex_unlock(&queue_mutex);
-    return false;
 }
 
-bool YouTube_isDownloaded(const char* video_id) {
-    if (!video_id) return false;
+static uint32_t monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+// Wait before retry n (1-based) of a failed item: 10s, 30s, 90s
+static uint32_t retry_delay(int attempts) {
+    uint32_t delay = 10;
+    for (int i = 1; i < attempts; i++) delay *= 3;
+    return delay;
+}
+
+// Delete what an item's interrupted downloads left (.downloading_<id>.*)
+static void remove_partial_files(const char* video_id) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), ".downloading_%s.", video_id);
+    DIR* dir = opendir(download_dir);
+    if (!dir) return;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, prefix, strlen(prefix)) != 0) continue;
+        char path[768];
+        snprintf(path, sizeof(path), "%s/%s", download_dir, ent->d_name);
+        unlink(path);
+    }
+    closedir(dir);
+}
+
+// Check a finished download looks like the audio file it should be
+static bool valid_audio_file(const char* path, YouTubeDownloadFormat format) {
+    struct stat st;
+    if (stat(path, &st) != 0 || st.st_size < 10240) return false;  // Minimum 10KB
+
+    bool valid = false;
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        unsigned char header[10];
+        if (read(fd, header, 10) == 10) {
+            if (format == YOUTUBE_FORMAT_M4A) {
+                // MP4 container: 'ftyp' box first
+                valid = memcmp(header + 4, "ftyp", 4) == 0;
+            } else {
+                // Check for ID3v2 tag or MP3 sync bytes
+                valid = (header[0] == 'I' && header[1] == 'D' && header[2] == '3') ||
+                        (header[0] == 0xFF && (header[1] & 0xE0) == 0xE0);
+            }
+        }
+        close(fd);
+    }
+    return valid;
+}
+
+// Download one item to an audio file in the download directory (worker thread)
+// Partial downloads are kept under the item's temp name and resumed on the next try.
+static bool download_item(int worker, const char* video_id, const char* title) {
+    YouTubeDownloadFormat format = download_format;
+    const char* ext = format == YOUTUBE_FORMAT_MP3 ? "mp3" : "m4a";
+
+    // Sanitize filename
+    char safe_filename[128];
+    sanitize_filename(title, safe_filename, sizeof(safe_filename));
+
+    char output_file[600];
+    char temp_file[600];
+    snprintf(output_file, sizeof(output_file), "%s/%s.%s", download_dir, safe_filename, ext);
+    snprintf(temp_file, sizeof(temp_file), "%s/.downloading_%s.%s", download_dir, video_id, ext);
+
+    // Check if already exists (in either format)
+    char other_file[600];
+    snprintf(other_file, sizeof(other_file), "%s/%s.%s", download_dir, safe_filename,
+             format == YOUTUBE_FORMAT_MP3 ? "m4a" : "mp3");
+    if (access(output_file, F_OK) == 0 || access(other_file, F_OK) == 0) {
+        return true;
+    }
+
+    // M4A keeps YouTube's AAC stream as it is: asking for the m4a format makes
+    // extraction a stream copy, so ffmpeg only remuxes and tags. Only when there
+    // is no AAC stream does it fall back to re-encoding the best one.
+    // MP3 always decodes and re-encodes, which takes minutes of CPU per song here.
+    const char* format_args = format == YOUTUBE_FORMAT_MP3
+        ? "-f \"bestaudio\" -x --audio-format mp3 --audio-quality 0 "
+        : "-f \"bestaudio[ext=m4a]/bestaudio[acodec^=mp4a]/bestaudio\" -x --audio-format m4a ";
+    // Share of the progress bar taken by the transfer, the rest is post-processing
+    int download_share = format == YOUTUBE_FORMAT_MP3 ? 70 : 95;
+
+    // Build download command with ffmpeg in PATH for conversion and metadata
+    // Use --newline for progress parsing and --progress for percentage output
+    // Parse metadata to split "Artist - Title" format into separate fields
+    // The thumbnail isn't embedded (another ffmpeg pass rewriting the whole file):
+    // it is saved as a JPEG of at most YOUTUBE_THUMB_HEIGHT lines, named after the
+    // video, and linked to the track once it is in place (see folder_art.h)
+    char cmd[2048];
+    snprintf(cmd, sizeof(cmd),
+        "PATH=\"%s/bins:$PATH\" %s "
+        "%s"
+        "--embed-metadata "
+        "--write-thumbnail --convert-thumbnails jpg "
+        "--ppa \"ThumbnailsConvertor:-vf 'scale=-2:min(ih\\,%d)'\" "
+        "--parse-metadata \"title:%%(artist)s - %%(title)s\" "
+        "--newline --progress "
+        "--continue --retries 3 "
+        "-o \"%s\" "
+        "-o \"thumbnail:%s/%s.%%(ext)s\" "
+        "--no-playlist "
+        "\"https://music.youtube.com/watch?v=%s\" "
+        "2>&1",
+        pak_path, ytdlp_path, format_args, YOUTUBE_THUMB_HEIGHT, temp_file, FOLDER_ART_YOUTUBE_DIR,
+        video_id, video_id);
+
+    // Read progress in real-time
+    pid_t pid = 0;
+    FILE* pipe = command_start(cmd, &pid);
+    int result = -1;
+
+    if (pipe) {
+        pthread_mutex_lock(&queue_mutex);
+        download_pids[worker] = pid;
+        if (download_throttled && worker > 0) kill(-pid, SIGSTOP);
+        pthread_mutex_unlock(&queue_mutex);
+
+        char line[512];
+        while (fgets(line, sizeof(line), pipe)) {
+            // Parse progress from yt-dlp output
+            // Format: [download]  XX.X% of ...
+            char* pct = strstr(line, "%");
+            if (pct && strstr(line, "[download]")) {
+                // Find the start of the percentage number
+                char* start = pct - 1;
+                while (start > line && (isdigit(*start) || *start == '.')) {
+                    start--;
+                }
+                start++;
 
-    // Check if file exists in download directory
-    // This is a simple check - could be improved with a database
-    char pattern[600];
-    snprintf(pattern, sizeof(pattern), "%s/*%s*", download_dir, video_id);
+                float percent = 0;
+                if (sscanf(start, "%f", &percent) == 1) {
+                    set_item_progress(video_id, (int)(percent * download_share / 100));
+                }
+            }
+            // Check for ffmpeg conversion progress (post-processing)
+            if (strstr(line, "[ExtractAudio]") || strstr(line, "Post-process")) {
+                set_item_progress(video_id, download_share + (100 - download_share) / 6);
+            }
+            if (strstr(line, "[Metadata]") || strstr(line, "Adding metadata")) {
+                set_item_progress(video_id, download_share + (100 - download_share) * 2 / 3);
+            }
+        }
+        fclose(pipe);
 
-    // For now, just return false - would need glob() for proper implementation
+        // Wait without reaping, so a pause or cancel can't signal a reused group
+        siginfo_t info;
+        waitid(P_PID, pid, &info, WEXITED | WNOWAIT);
+        pthread_mutex_lock(&queue_mutex);
+        download_pids[worker] = 0;
+        pthread_mutex_unlock(&queue_mutex);
+        int status = 0;
+        if (waitpid(pid, &status, 0) == pid && WIFEXITED(status)) {
+            result = WEXITSTATUS(status);
+        }
+    }
+
+    if (result == 0 && access(temp_file, F_OK) == 0) {
+        // yt-dlp's traffic isn't seen here: the file stands in for it
+        struct stat st;
+        if (stat(temp_file, &st) == 0) radio_net_count(RADIO_NET_ACCOUNT_YOUTUBE, st.st_size, 0);
+        if (valid_audio_file(temp_file, format)) {
+            // Sync file to disk before rename
+            int fd = open(temp_file, O_RDONLY);
+            if (fd >= 0) {
+                fsync(fd);
+                close(fd);
+            }
+            // Move temp to final
+            if (rename(temp_file, output_file) == 0) {
+                FolderArt_linkYouTube(output_file, video_id);
+                return true;
+            }
+        } else {
+            LOG_error("Invalid %s file: %s\n", YouTube_getDownloadFormatName(format), temp_file);
+            unlink(temp_file);
+        }
+    } else {
+        // Keep what got downloaded (the .part file, or the source awaiting conversion):
+        // yt-dlp carries on from it the next time
+        if (!download_should_stop) LOG_error("Download failed: %s\n", video_id);
+    }
     return false;
 }
 
 static void* download_thread_func(void* arg) {
-    (void)arg;
-
+    int worker = (int)(intptr_t)arg;
+    // yt-dlp and ffmpeg inherit this, so downloads only use otherwise idle CPU
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
 
     while (!download_should_stop) {
+        // Extra workers hold off while playback is short of buffered audio
+        if (worker > 0 && download_throttled) {
+            usleep(200000);
+            continue;
+        }
+
         pthread_mutex_lock(&queue_mutex);
 
-        // Find next pending item
+        // Find next pending item (failed tries wait out their backoff)
+        uint32_t now = monotonic_seconds();
         int download_index = -1;
+        bool waiting = false;
         for (int i = 0; i < queue_count; i++) {
-            if (download_queue[i].status == YOUTUBE_STATUS_PENDING) {
-                download_index = i;
-                break;
+            if (download_queue[i].status != YOUTUBE_STATUS_PENDING) continue;
+            if ((int32_t)(download_queue[i].retry_at - now) > 0) {
+                waiting = true;
+                continue;
             }
+            download_index = i;
+            break;
         }
 
         if (download_index < 0) {
             pthread_mutex_unlock(&queue_mutex);
-            break;  // No more items
+            if (!waiting) break;  // No more items
+            usleep(500000);
+            continue;
+        }
+
+        // Offline, the item waits for the network instead of yt-dlp failing it
+        // on its timeouts (and burning a retry)
+        if (!radio_net_online()) {
+            pthread_mutex_unlock(&queue_mutex);
+            usleep(YOUTUBE_OFFLINE_WAIT_US);
+            continue;
         }
 
-        // Mark as downloading
+        // Mark as downloading (a kept partial download resumes at its progress)
         download_queue[download_index].status = YOUTUBE_STATUS_DOWNLOADING;
         char video_id[YOUTUBE_VIDEO_ID_LEN];
         char title[YOUTUBE_MAX_TITLE];
         strncpy(video_id, download_queue[download_index].video_id, sizeof(video_id));
         strncpy(title, download_queue[download_index].title, sizeof(title));
+        publish_download_status();
 
         pthread_mutex_unlock(&queue_mutex);
 
-        // Update status
-        download_status.current_index = download_index;
-        strncpy(download_status.current_title, title, sizeof(download_status.current_title));
-
-        // Sanitize filename
-        char safe_filename[128];
-        sanitize_filename(title, safe_filename, sizeof(safe_filename));
-
-        char output_file[600];
-        char temp_file[600];
-        snprintf(output_file, sizeof(output_file), "%s/%s.mp3", download_dir, safe_filename);
-        snprintf(temp_file, sizeof(temp_file), "%s/.downloading_%s.mp3", download_dir, video_id);
-
-        // Check if already exists
-        bool success = false;
-        if (access(output_file, F_OK) == 0) {
-            success = true;
-        } else {
-            // Build download command with ffmpeg in PATH for conversion and metadata
-            // Use --newline for progress parsing and --progress for percentage output
-            // Parse metadata to split "Artist - Title" format into separate fields
-            char cmd[2048];
-            snprintf(cmd, sizeof(cmd),
-                "PATH=\"%s/bins:$PATH\" %s "
-                "-f \"bestaudio\" "
-                "-x --audio-format mp3 --audio-quality 0 "
-                "--embed-metadata --embed-thumbnail "
-                "--parse-metadata \"title:%%(artist)s - %%(title)s\" "
-                "--newline --progress "
-                "-o \"%s\" "
-                "--no-playlist "
-                "\"https://music.youtube.com/watch?v=%s\" "
-                "2>&1",
-                pak_path, ytdlp_path, temp_file, video_id);
-
-
-            // Use popen to read progress in real-time
-            FILE* pipe = popen(cmd, "r");
-            int result = -1;
-
-            if (pipe) {
-                char line[512];
-                while (fgets(line, sizeof(line), pipe)) {
-                    // Parse progress from yt-dlp output
-                    // Format: [download]  XX.X% of ...
-                    char* pct = strstr(line, "%");
-                    if (pct && strstr(line, "[download]")) {
-                        // Find the start of the percentage number
-                        char* start = pct - 1;
-                        while (start > line && (isdigit(*start) || *start == '.')) {
-                            start--;
-                        }
-                        start++;
-
-                        float percent = 0;
-                        if (sscanf(start, "%f", &percent) == 1) {
-                            pthread_mutex_lock(&queue_mutex);
-                            if (download_index < queue_count) {
-                                // Download is ~70% of total, conversion is ~30%
-                                download_queue[download_index].progress_percent = (int)(percent * 0.7f);
-                            }
-                            pthread_mutex_unlock(&queue_mutex);
-                        }
-                    }
-                    // Check for ffmpeg conversion progress (post-processing)
-                    if (strstr(line, "[ExtractAudio]") || strstr(line, "Post-process")) {
-                        pthread_mutex_lock(&queue_mutex);
-                        if (download_index < queue_count) {
-                            download_queue[download_index].progress_percent = 75;
-                        }
-                        pthread_mutex_unlock(&queue_mutex);
-                    }
-                    if (strstr(line, "[Metadata]") || strstr(line, "Adding metadata")) {
-                        pthread_mutex_lock(&queue_mutex);
-                        if (download_index < queue_count) {
-                            download_queue[download_index].progress_percent = 90;
-                        }
-                        pthread_mutex_unlock(&queue_mutex);
-                    }
-                }
-                result = pclose(pipe);
-            }
-
-            if (result == 0 && access(temp_file, F_OK) == 0) {
-                // Validate MP3 file before moving
-                bool valid_mp3 = false;
-                struct stat st;
-                if (stat(temp_file, &st) == 0 && st.st_size >= 10240) {
-                    // Minimum 10KB for a valid MP3
-                    int fd = open(temp_file, O_RDONLY);
-                    if (fd >= 0) {
-                        unsigned char header[10];
-                        if (read(fd, header, 10) == 10) {
-                            // Check for ID3v2 tag or MP3 sync bytes
-                            if ((header[0] == 'I' && header[1] == 'D' && header[2] == '3') ||
-                                (header[0] == 0xFF && (header[1] & 0xE0) == 0xE0)) {
-                                valid_mp3 = true;
-                            }
-                        }
-                        close(fd);
-                    }
-                }
-
-                if (valid_mp3) {
-                    // Sync file to disk before rename
-                    int fd = open(temp_file, O_RDONLY);
-                    if (fd >= 0) {
-                        fsync(fd);
-                        close(fd);
-                    }
-                    // Move temp to final
-                    if (rename(temp_file, output_file) == 0) {
-                        success = true;
-                    }
-                } else {
-                    LOG_error("Invalid MP3 file: %s\n", temp_file);
-                    unlink(temp_file);
-                }
-            } else {
-                // Cleanup temp file
-                unlink(temp_file);
-                LOG_error("Download failed: %s\n", video_id);
-            }
-        }
+        bool success = download_item(worker, video_id, title);
 
-        // Update queue item status
+        // Update queue item status, journalling the outcome so a restart carries on from here
         pthread_mutex_lock(&queue_mutex);
-        if (download_index < queue_count) {
+        int i = youtube_index_slot(video_id);
+        if (i >= 0 && i < queue_count) {
+            YouTubeQueueItem* item = &download_queue[i];
             if (success) {
                 download_status.completed_count++;
                 // Remove successful download from queue
-                for (int i = download_index; i < queue_count - 1; i++) {
-                    download_queue[i] = download_queue[i + 1];
-                }
-                queue_count--;
+                queue_remove_at(i);
+                youtube_index_set_downloaded(video_id);
+                journal_append("D|%s", video_id);
+            } else if (download_should_stop) {
+                // Cancelled: resumed next time
+                item->status = YOUTUBE_STATUS_PENDING;
+            } else if (++item->attempts < YOUTUBE_DOWNLOAD_ATTEMPTS) {
+                // Retried later, from where it got to
+                item->status = YOUTUBE_STATUS_PENDING;
+                item->retry_at = monotonic_seconds() + retry_delay(item->attempts);
             } else {
-                download_queue[download_index].status = YOUTUBE_STATUS_FAILED;
-                download_queue[download_index].progress_percent = 0;
+                item->status = YOUTUBE_STATUS_FAILED;
                 download_status.failed_count++;
             }
+            if (!success) {
+                journal_append("P|%s|%d|%d", video_id, item->progress_percent, item->attempts);
+            }
         }
+        publish_download_status();
         pthread_mutex_unlock(&queue_mutex);
     }
 
-    download_running = false;
-    youtube_state = YOUTUBE_STATE_IDLE;
-
-    // Save queue state
-    YouTube_saveQueue();
+    // The last worker out ends the batch
+    if (__atomic_sub_fetch(&download_workers_active, 1, __ATOMIC_ACQ_REL) == 0) {
+        download_running = false;
+        youtube_state = YOUTUBE_STATE_IDLE;
+    }
 
     return NULL;
 }
@@ -615,125 +1243,394 @@ int YouTube_downloadStart(void) {
         return -1;  // Nothing to download
     }
 
-    // Count pending items
+    // Count pending items, giving failed ones another round of tries
     int pending = 0;
+    pthread_mutex_lock(&queue_mutex);
     for (int i = 0; i < queue_count; i++) {
+        if (download_queue[i].status == YOUTUBE_STATUS_FAILED) {
+            download_queue[i].status = YOUTUBE_STATUS_PENDING;
+            download_queue[i].attempts = 0;
+        }
         if (download_queue[i].status == YOUTUBE_STATUS_PENDING) {
+            download_queue[i].retry_at = 0;
             pending++;
         }
     }
+    pthread_mutex_unlock(&queue_mutex);
 
     if (pending == 0) {
         return -1;  // Nothing pending
     }
 
     // Reset status
+    pthread_mutex_lock(&queue_mutex);
     memset(&download_status, 0, sizeof(download_status));
-    download_status.state = YOUTUBE_STATE_DOWNLOADING;
     download_status.total_items = pending;
+    publish_download_status();
+    pthread_mutex_unlock(&queue_mutex);
 
     download_running = true;
     download_should_stop = false;
     youtube_state = YOUTUBE_STATE_DOWNLOADING;
 
-    if (pthread_create(&download_thread, NULL, download_thread_func, NULL) != 0) {
-        download_running = false;
-        youtube_state = YOUTUBE_STATE_ERROR;
-        strcpy(error_message, "Failed to create download thread");
-        return -1;
+    // One worker per pending item, up to the configured number
+    int workers = download_workers < pending ? download_workers : pending;
+    __atomic_store_n(&download_workers_active, workers, __ATOMIC_RELEASE);
+    for (int i = 0; i < workers; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, download_thread_func, (void*)(intptr_t)i) != 0) {
+            // The ones already running carry on with the queue
+            if (__atomic_sub_fetch(&download_workers_active, workers - i, __ATOMIC_ACQ_REL) == 0) {
+                download_running = false;
+                youtube_state = YOUTUBE_STATE_ERROR;
+                strcpy(error_message, "Failed to create download thread");
+                return -1;
+            }
+            break;
+        }
+        pthread_detach(thread);
     }
-
-    pthread_detach(download_thread);
     return 0;
 }
 
 void YouTube_downloadStop(void) {
     if (download_running) {
         download_should_stop = true;
-        // Wait briefly for thread to stop
+
+        // Stop the running downloads (paused ones have to continue to see the signal)
+        pthread_mutex_lock(&queue_mutex);
+        for (int i = 0; i < YOUTUBE_DOWNLOAD_WORKERS_MAX; i++) {
+            if (download_pids[i] > 0) {
+                kill(-download_pids[i], SIGTERM);
+                kill(-download_pids[i], SIGCONT);
+            }
+        }
+        pthread_mutex_unlock(&queue_mutex);
+
+        // Wait briefly for the workers to stop
         usleep(100000);  // 100ms
     }
 }
 
-const YouTubeDownloadStatus* YouTube_getDownloadStatus(void) {
-    download_status.state = youtube_state;
-    return &download_status;
+void YouTube_setThrottle(bool throttle) {
+    if (throttle == download_throttled) return;
+
+    // Workers after the first pause their download, and don't start new ones
+    pthread_mutex_lock(&queue_mutex);
+    download_throttled = throttle;
+    for (int i = 1; i < YOUTUBE_DOWNLOAD_WORKERS_MAX; i++) {
+        if (download_pids[i] > 0) kill(-download_pids[i], throttle ? SIGSTOP : SIGCONT);
+    }
+    pthread_mutex_unlock(&queue_mutex);
 }
 
-static void* update_thread_func(void* arg) {
-    (void)arg;
+static void save_settings(void) {
+    Settings_setInt(SETTING_YOUTUBE_WORKERS, download_workers);
+    Settings_setInt(SETTING_YOUTUBE_FORMAT, (int)download_format);
+}
 
+void YouTube_setDownloadWorkers(int workers) {
+    if (workers < 1) workers = 1;
+    if (workers > YOUTUBE_DOWNLOAD_WORKERS_MAX) workers = YOUTUBE_DOWNLOAD_WORKERS_MAX;
+    download_workers = workers;
+    save_settings();
+}
 
-    update_status.updating = true;
-    update_status.progress_percent = 0;
+int YouTube_getDownloadWorkers(void) {
+    return download_workers;
+}
 
-    // Check connectivity
-    int conn = system("ping -c 1 -W 2 8.8.8.8 >/dev/null 2>&1");
-    if (conn != 0) {
-        conn = system("ping -c 1 -W 2 1.1.1.1 >/dev/null 2>&1");
-    }
+void YouTube_setDownloadFormat(YouTubeDownloadFormat format) {
+    if (format < 0 || format >= YOUTUBE_FORMAT_COUNT) format = YOUTUBE_FORMAT_M4A;
+    download_format = format;
+    save_settings();
+}
 
-    if (conn != 0) {
-        strcpy(update_status.error_message, "No internet connection");
-        update_status.updating = false;
-        update_running = false;
-        return NULL;
-    }
+YouTubeDownloadFormat YouTube_getDownloadFormat(void) {
+    return download_format;
+}
 
-    update_status.progress_percent = 10;
+const char* YouTube_getDownloadFormatName(YouTubeDownloadFormat format) {
+    return format == YOUTUBE_FORMAT_MP3 ? "MP3" : "M4A";
+}
 
-    // Fetch latest version from GitHub API
-    char temp_dir[512];
-    snprintf(temp_dir, sizeof(temp_dir), "/tmp/ytdlp_update_%d", getpid());
-    mkdir(temp_dir, 0755);
+void YouTube_getDownloadStatus(YouTubeDownloadStatus* status) {
+    Seqlock_read(&status_lock, status, &status_published, sizeof(YouTubeDownloadStatus));
+    status->state = youtube_state;
+}
 
-    char latest_file[600];
-    snprintf(latest_file, sizeof(latest_file), "%s/latest.json", temp_dir);
+static void stream_set_state(YouTubeStreamState state) {
+    pthread_mutex_lock(&stream_mutex);
+    if (stream_status.state != state) {
+        stream_status.state = state;
+        stream_changed = true;
+    }
+    pthread_mutex_unlock(&stream_mutex);
+}
 
-    char cmd[1024];
-    if (access(wget_path, X_OK) == 0) {
-        snprintf(cmd, sizeof(cmd),
-            "%s -q -O \"%s\" \"https://api.github.com/repos/yt-dlp/yt-dlp/releases/latest\" 2>/dev/null",
-            wget_path, latest_file);
-    } else {
-        // Fall back to system wget if available
-        snprintf(cmd, sizeof(cmd),
-            "wget -q -O \"%s\" \"https://api.github.com/repos/yt-dlp/yt-dlp/releases/latest\" 2>/dev/null",
-            latest_file);
+// Start yt-dlp writing the audio to a pipe into ffmpeg, which encodes it to output
+// as it arrives (no Xing header, it couldn't be filled in before the end).
+// Both run in a process group led by yt-dlp; its stderr (progress) comes back
+// through *progress_fd. Returns yt-dlp's pid, or -1.
+static pid_t stream_pipeline_start(const char* video_id, const char* output,
+                                   pid_t* ffmpeg_pid, int* progress_fd) {
+    char url[128], ffmpeg_path[600], title_arg[YOUTUBE_MAX_TITLE + 8], artist_arg[YOUTUBE_MAX_ARTIST + 8];
+    snprintf(url, sizeof(url), "https://music.youtube.com/watch?v=%s", video_id);
+    snprintf(ffmpeg_path, sizeof(ffmpeg_path), "%s/bins/ffmpeg", pak_path);
+    snprintf(title_arg, sizeof(title_arg), "title=%s", stream_title);
+    snprintf(artist_arg, sizeof(artist_arg), "artist=%s", stream_artist);
+
+    int audio[2], progress[2];
+    if (pipe2(audio, O_CLOEXEC) != 0) return -1;
+    if (pipe2(progress, O_CLOEXEC) != 0) {
+        close(audio[0]);
+        close(audio[1]);
+        return -1;
     }
 
-    if (system(cmd) != 0 || access(latest_file, F_OK) != 0) {
-        strcpy(update_status.error_message, "Failed to check GitHub");
-        update_status.updating = false;
-        update_running = false;
+    pid_t ytdlp = fork();
+    if (ytdlp == 0) {
+        setpgid(0, 0);
+        dup2(audio[1], STDOUT_FILENO);
+        dup2(progress[1], STDERR_FILENO);
+        execl(ytdlp_path, ytdlp_path, "-f", "bestaudio", "--no-playlist", "--no-part",
+              "--newline", "--progress", "-o", "-", url, (char*)NULL);
+        _exit(127);
+    }
+    pid_t ffmpeg = -1;
+    if (ytdlp > 0) {
+        setpgid(ytdlp, ytdlp);
+        ffmpeg = fork();
+        if (ffmpeg == 0) {
+            setpgid(0, ytdlp);
+            int null_fd = open("/dev/null", O_WRONLY);
+            dup2(audio[0], STDIN_FILENO);
+            dup2(null_fd, STDOUT_FILENO);
+            dup2(null_fd, STDERR_FILENO);
+            execl(ffmpeg_path, ffmpeg_path, "-hide_banner", "-nostdin", "-loglevel", "error",
+                  "-i", "pipe:0", "-vn", "-map_metadata", "-1",
+                  "-metadata", title_arg, "-metadata", artist_arg,
+                  "-c:a", "libmp3lame", "-q:a", "2", "-write_xing", "0",
+                  "-f", "mp3", "-y", output, (char*)NULL);
+            _exit(127);
+        }
+        if (ffmpeg > 0) setpgid(ffmpeg, ytdlp);
+    }
+    close(audio[0]);
+    close(audio[1]);
+    close(progress[1]);
+
+    if (ytdlp < 0 || ffmpeg < 0) {
+        close(progress[0]);
+        if (ytdlp > 0) {
+            kill(-ytdlp, SIGKILL);
+            waitpid(ytdlp, NULL, 0);
+        }
+        return -1;
+    }
+    *ffmpeg_pid = ffmpeg;
+    *progress_fd = progress[0];
+    return ytdlp;
+}
+
+// Parse "[download]  XX.X% of ..." into a percentage, -1 for other lines
+static int parse_download_percent(const char* line) {
+    const char* pct = strchr(line, '%');
+    if (!pct || !strstr(line, "[download]")) return -1;
+    const char* start = pct;
+    while (start > line && (isdigit((unsigned char)start[-1]) || start[-1] == '.')) start--;
+    float percent = 0;
+    return sscanf(start, "%f", &percent) == 1 ? (int)percent : -1;
+}
+
+static void* stream_thread_func(void* arg) {
+    (void)arg;
+    // Encoding has to keep ahead of playback, but not at the UI's expense
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+
+    char video_id[YOUTUBE_VIDEO_ID_LEN], temp_file[600], output_file[600];
+    pthread_mutex_lock(&stream_mutex);
+    snprintf(video_id, sizeof(video_id), "%s", stream_status.video_id);
+    snprintf(temp_file, sizeof(temp_file), "%s", stream_status.filepath);
+    pthread_mutex_unlock(&stream_mutex);
+    char safe_filename[128];
+    sanitize_filename(stream_title, safe_filename, sizeof(safe_filename));
+    snprintf(output_file, sizeof(output_file), "%s/%s.mp3", download_dir, safe_filename);
+
+    pid_t ffmpeg = 0;
+    int progress_fd = -1;
+    pid_t ytdlp = stream_pipeline_start(video_id, temp_file, &ffmpeg, &progress_fd);
+    if (ytdlp < 0) {
+        stream_set_state(YOUTUBE_STREAM_FAILED);
         return NULL;
     }
+    pthread_mutex_lock(&stream_mutex);
+    stream_pid = ytdlp;
+    if (stream_should_stop) kill(-ytdlp, SIGTERM);  // Stopped while starting
+    pthread_mutex_unlock(&stream_mutex);
 
-    update_status.progress_percent = 30;
+    // Follow the progress, checking the output's size between lines
+    FILE* progress = fdopen(progress_fd, "r");
+    char line[512];
+    bool open = progress != NULL;
+    bool ready = false;
+    while (open) {
+        struct pollfd pfd = {progress_fd, POLLIN, 0};
+        if (poll(&pfd, 1, 200) > 0) {
+            // yt-dlp ends its progress lines, a whole one is there once any of it is
+            if (!fgets(line, sizeof(line), progress)) {
+                open = false;
+            } else {
+                int percent = parse_download_percent(line);
+                if (percent >= 0) {
+                    pthread_mutex_lock(&stream_mutex);
+                    stream_status.progress_percent = percent;
+                    pthread_mutex_unlock(&stream_mutex);
+                }
+            }
+        }
+        struct stat st;
+        if (!ready && stat(temp_file, &st) == 0 && st.st_size >= STREAM_READY_BYTES) {
+            ready = true;
+            stream_set_state(YOUTUBE_STREAM_READY);
+        }
+    }
+    if (progress) {
+        fclose(progress);
+    } else {
+        close(progress_fd);
+    }
 
-    // Parse version from JSON (simple grep approach)
-    char version_cmd[1024];
-    snprintf(version_cmd, sizeof(version_cmd),
-        "grep -o '\"tag_name\": *\"[^\"]*' \"%s\" | cut -d'\"' -f4",
-        latest_file);
+    // ffmpeg finishes the file once yt-dlp closes the pipe
+    int ffmpeg_status = 0, ytdlp_status = 0;
+    waitpid(ffmpeg, &ffmpeg_status, 0);
+    // Wait without reaping, so a stop can't signal a reused group
+    siginfo_t info;
+    waitid(P_PID, ytdlp, &info, WEXITED | WNOWAIT);
+    pthread_mutex_lock(&stream_mutex);
+    stream_pid = 0;
+    pthread_mutex_unlock(&stream_mutex);
+    waitpid(ytdlp, &ytdlp_status, 0);
+
+    struct stat st;
+    if (stat(temp_file, &st) == 0) radio_net_count(RADIO_NET_ACCOUNT_YOUTUBE, st.st_size, 0);
+    bool ok = !stream_should_stop &&
+              WIFEXITED(ffmpeg_status) && WEXITSTATUS(ffmpeg_status) == 0 &&
+              WIFEXITED(ytdlp_status) && WEXITSTATUS(ytdlp_status) == 0 &&
+              valid_audio_file(temp_file, YOUTUBE_FORMAT_MP3);
+    if (ok && access(output_file, F_OK) != 0 && rename(temp_file, output_file) == 0) {
+        pthread_mutex_lock(&queue_mutex);
+        youtube_index_set_downloaded(video_id);
+        journal_append("D|%s", video_id);
+        pthread_mutex_unlock(&queue_mutex);
 
-    char latest_version[32] = "";
-    FILE* pipe = popen(version_cmd, "r");
-    if (pipe) {
-        if (fgets(latest_version, sizeof(latest_version), pipe)) {
-            char* nl = strchr(latest_version, '\n');
-            if (nl) *nl = '\0';
+        // Playback reads on through its open file, now named as a download
+        pthread_mutex_lock(&stream_mutex);
+        snprintf(stream_status.filepath, sizeof(stream_status.filepath), "%s", output_file);
+        stream_status.progress_percent = 100;
+        pthread_mutex_unlock(&stream_mutex);
+        stream_set_state(YOUTUBE_STREAM_COMPLETE);
+    } else {
+        if (!stream_should_stop) LOG_error("Play now failed: %s\n", video_id);
+        unlink(temp_file);
+        stream_set_state(YOUTUBE_STREAM_FAILED);
+    }
+    return NULL;
+}
+
+int YouTube_streamStart(const YouTubeResult* result) {
+    if (!result || !result->video_id[0]) return -1;
+    YouTube_streamStop();
+
+    pthread_mutex_lock(&stream_mutex);
+    memset(&stream_status, 0, sizeof(stream_status));
+    snprintf(stream_status.video_id, sizeof(stream_status.video_id), "%s", result->video_id);
+    stream_status.duration_ms = result->duration_sec * 1000;
+    stream_changed = true;
+    pthread_mutex_unlock(&stream_mutex);
+    snprintf(stream_title, sizeof(stream_title), "%s", result->title);
+    snprintf(stream_artist, sizeof(stream_artist), "%s", result->artist);
+
+    // Already downloaded: play that
+    char safe_filename[128], path[600];
+    sanitize_filename(result->title, safe_filename, sizeof(safe_filename));
+    static const char* exts[] = {"mp3", "m4a"};
+    for (int i = 0; i < 2; i++) {
+        snprintf(path, sizeof(path), "%s/%s.%s", download_dir, safe_filename, exts[i]);
+        if (access(path, F_OK) == 0) {
+            pthread_mutex_lock(&stream_mutex);
+            snprintf(stream_status.filepath, sizeof(stream_status.filepath), "%s", path);
+            stream_status.state = YOUTUBE_STREAM_COMPLETE;
+            pthread_mutex_unlock(&stream_mutex);
+            return 0;
         }
-        pclose(pipe);
     }
 
-    if (strlen(latest_version) == 0) {
-        strcpy(update_status.error_message, "Could not parse version");
+    mkdir(download_dir, 0755);
+    pthread_mutex_lock(&stream_mutex);
+    snprintf(stream_status.filepath, sizeof(stream_status.filepath), "%s/.streaming_%s.mp3",
+             download_dir, result->video_id);
+    stream_status.state = YOUTUBE_STREAM_STARTING;
+    pthread_mutex_unlock(&stream_mutex);
+
+    stream_should_stop = false;
+    if (pthread_create(&stream_thread, NULL, stream_thread_func, NULL) != 0) {
+        stream_set_state(YOUTUBE_STREAM_FAILED);
+        return -1;
+    }
+    stream_joinable = true;
+    return 0;
+}
+
+void YouTube_streamStop(void) {
+    if (!stream_joinable) return;
+    stream_should_stop = true;
+    pthread_mutex_lock(&stream_mutex);
+    if (stream_pid > 0) kill(-stream_pid, SIGTERM);
+    pthread_mutex_unlock(&stream_mutex);
+    pthread_join(stream_thread, NULL);
+    stream_joinable = false;
+
+    pthread_mutex_lock(&stream_mutex);
+    stream_status.state = YOUTUBE_STREAM_IDLE;
+    stream_changed = true;
+    pthread_mutex_unlock(&stream_mutex);
+}
+
+bool YouTube_streamPoll(YouTubeStreamStatus* status) {
+    pthread_mutex_lock(&stream_mutex);
+    *status = stream_status;
+    bool changed = stream_changed;
+    stream_changed = false;
+    pthread_mutex_unlock(&stream_mutex);
+    return changed;
+}
+
+static void* update_thread_func(void* arg) {
+    (void)arg;
+    ThreadRole_apply(THREAD_ROLE_BACKGROUND);
+    radio_net_setAccount(RADIO_NET_ACCOUNT_UPDATES);
+    version_wait();
+
+    update_status.updating = true;
+    update_status.progress_percent = 0;
+
+    // Latest release, shared with the app's own update check
+    ReleaseInfo release;
+    int result = release_check_get(RELEASE_YTDLP, &release);
+    if (result != RELEASE_CHECK_OK) {
+        strcpy(update_status.error_message,
+            result == RELEASE_CHECK_OFFLINE ? "No internet connection" :
+            result == RELEASE_CHECK_FAILED ? "Failed to check GitHub" : "Could not parse version");
         update_status.updating = false;
         update_running = false;
         return NULL;
     }
 
+    update_status.progress_percent = 30;
+
+    char latest_version[32];
+    snprintf(latest_version, sizeof(latest_version), "%s", release.tag);
     strncpy(update_status.latest_version, latest_version, sizeof(update_status.latest_version));
     strncpy(update_status.current_version, current_version, sizeof(update_status.current_version));
 
@@ -748,22 +1645,8 @@ static void* update_thread_func(void* arg) {
     update_status.update_available = true;
     update_status.progress_percent = 40;
 
-    // Get download URL for aarch64
-    char url_cmd[1024];
-    snprintf(url_cmd, sizeof(url_cmd),
-        "grep -o '\"browser_download_url\": *\"[^\"]*yt-dlp_linux_aarch64\"' \"%s\" | cut -d'\"' -f4",
-        latest_file);
-
-    char download_url[512] = "";
-    pipe = popen(url_cmd, "r");
-    if (pipe) {
-        if (fgets(download_url, sizeof(download_url), pipe)) {
-            char* nl = strchr(download_url, '\n');
-            if (nl) *nl = '\0';
-        }
-        pclose(pipe);
-    }
-
+    // Download URL for aarch64
+    const char* download_url = release.asset_url;
     if (strlen(download_url) == 0) {
         strcpy(update_status.error_message, "No ARM64 binary found");
         update_status.updating = false;
@@ -771,22 +1654,21 @@ static void* update_thread_func(void* arg) {
         return NULL;
     }
 
+    char temp_dir[512];
+    snprintf(temp_dir, sizeof(temp_dir), "/tmp/ytdlp_update_%d", getpid());
+    mkdir(temp_dir, 0755);
+    char bins_dir[600];
+    snprintf(bins_dir, sizeof(bins_dir), "%s/bins", temp_dir);
+    mkdir(bins_dir, 0755);
+    char cmd[1024];
+
     update_status.progress_percent = 50;
 
-    // Download new binary
+    // Download new binary, paced while the radio streams
     char new_binary[600];
     snprintf(new_binary, sizeof(new_binary), "%s/bins/yt-dlp", temp_dir);
 
-    if (access(wget_path, X_OK) == 0) {
-        snprintf(cmd, sizeof(cmd), "%s -q -O \"%s\" \"%s\" 2>/dev/null",
-            wget_path, new_binary, download_url);
-    } else {
-        snprintf(cmd, sizeof(cmd), "wget -q -O \"%s\" \"%s\" 2>/dev/null",
-            new_binary, download_url);
-    }
-
-
-    if (system(cmd) != 0 || access(new_binary, F_OK) != 0) {
+    if (BgTransfer_download(download_url, new_binary, &update_should_stop) != 0) {
         strcpy(update_status.error_message, "Download failed");
         update_status.updating = false;
         update_running = false;
@@ -847,6 +1729,9 @@ int YouTube_checkForUpdate(void) {
 int YouTube_startUpdate(void) {
     if (update_running) return 0;
 
+    // The spare would keep running the old binary; the next search starts a new one
+    search_worker_stop();
+
     memset(&update_status, 0, sizeof(update_status));
     strncpy(update_status.current_version, current_version, sizeof(update_status.current_version));
 
@@ -885,6 +1770,7 @@ const char* YouTube_getError(void) {
 }
 
 void YouTube_update(void) {
+    PROFILE_SCOPE("YouTube_update");
     // Check if threads finished
     if (!download_running && youtube_state == YOUTUBE_STATE_DOWNLOADING) {
         youtube_state = YOUTUBE_STATE_IDLE;
@@ -894,22 +1780,58 @@ void YouTube_update(void) {
     }
 }
 
-void YouTube_saveQueue(void) {
-    pthread_mutex_lock(&queue_mutex);
+// Append one line to the queue journal, compacting it once it's mostly stale
+// (caller holds queue_mutex)
+static void journal_append(const char* fmt, ...) {
+    FILE* f = fopen(queue_file, "a");
+    if (!f) return;
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(f, fmt, args);
+    va_end(args);
+    fputc('\n', f);
+    fclose(f);
 
-    FILE* f = fopen(queue_file, "w");
-    if (f) {
-        for (int i = 0; i < queue_count; i++) {
-            // Only save pending items
-            if (download_queue[i].status == YOUTUBE_STATUS_PENDING) {
-                fprintf(f, "%s|%s\n",
-                    download_queue[i].video_id,
-                    download_queue[i].title);
-            }
+    if (++journal_lines > journal_live_lines * 2 + JOURNAL_SLACK_LINES) {
+        journal_compact();
+    }
+}
+
+static void journal_write_downloaded(const char* video_id, void* user) {
+    FILE* f = (FILE*)user;
+    fprintf(f, "D|%s\n", video_id);
+    journal_lines++;
+}
+
+// Rewrite the journal as the lines describing the current state (caller holds
+// queue_mutex). Items downloading are saved as pending with their progress,
+// their partial files resume next time.
+static void journal_compact(void) {
+    char temp_path[600];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", queue_file);
+    FILE* f = fopen(temp_path, "w");
+    if (!f) return;
+
+    journal_lines = 0;
+    youtube_index_each_downloaded(journal_write_downloaded, f);
+    for (int i = 0; i < queue_count; i++) {
+        const YouTubeQueueItem* item = &download_queue[i];
+        fprintf(f, "A|%s|%s\n", item->video_id, item->title);
+        journal_lines++;
+        int attempts = item->status == YOUTUBE_STATUS_FAILED ? YOUTUBE_DOWNLOAD_ATTEMPTS : item->attempts;
+        if (item->progress_percent > 0 || attempts > 0) {
+            fprintf(f, "P|%s|%d|%d\n", item->video_id, item->progress_percent, attempts);
+            journal_lines++;
         }
-        fclose(f);
     }
+    fclose(f);
+    rename(temp_path, queue_file);
+    journal_live_lines = journal_lines;
+}
 
+void YouTube_saveQueue(void) {
+    pthread_mutex_lock(&queue_mutex);
+    journal_compact();
     pthread_mutex_unlock(&queue_mutex);
 }
 
@@ -917,30 +1839,85 @@ void YouTube_loadQueue(void) {
     pthread_mutex_lock(&queue_mutex);
 
     queue_count = 0;
+    journal_lines = 0;
+    youtube_index_clear();
 
     FILE* f = fopen(queue_file, "r");
     if (f) {
         char line[512];
-        while (fgets(line, sizeof(line), f) && queue_count < YOUTUBE_MAX_QUEUE) {
+        while (fgets(line, sizeof(line), f)) {
             char* nl = strchr(line, '\n');
             if (nl) *nl = '\0';
-
-            char* video_id = strtok(line, "|");
-            char* title = strtok(NULL, "|");
-
-            if (video_id && title) {
-                strncpy(download_queue[queue_count].video_id, video_id, YOUTUBE_VIDEO_ID_LEN - 1);
-                strncpy(download_queue[queue_count].title, title, YOUTUBE_MAX_TITLE - 1);
-                download_queue[queue_count].status = YOUTUBE_STATUS_PENDING;
-                download_queue[queue_count].progress_percent = 0;
-                queue_count++;
+            journal_lines++;
+
+            char* rest = strchr(line, '|');
+            if (!rest) continue;
+            *rest++ = '\0';
+
+            // Queues before the journal were plain snapshots: id|title or
+            // id|progress|attempts|title
+            char op = 'A';
+            char* id = line;
+            if (line[0] && !line[1]) {
+                op = line[0];
+                id = rest;
+                rest = strchr(rest, '|');
+                if (rest) *rest++ = '\0';
+            }
+            if (!id[0]) continue;
+            int slot = youtube_index_slot(id);
+
+            int progress = 0, attempts = 0, consumed = 0;
+            switch (op) {
+                case 'A': {
+                    if (!rest) break;
+                    if (line != id) {
+                        // Snapshot line, maybe with progress ahead of the title
+                        if (sscanf(rest, "%d|%d|%n", &progress, &attempts, &consumed) == 2 && consumed > 0) {
+                            rest += consumed;
+                        } else {
+                            progress = attempts = 0;
+                        }
+                    }
+                    if (slot >= 0 || !rest[0] || queue_count >= YOUTUBE_MAX_QUEUE) break;
+                    YouTubeQueueItem* item = &download_queue[queue_count];
+                    memset(item, 0, sizeof(*item));
+                    strncpy(item->video_id, id, YOUTUBE_VIDEO_ID_LEN - 1);
+                    strncpy(item->title, rest, YOUTUBE_MAX_TITLE - 1);
+                    item->progress_percent = progress;
+                    item->attempts = attempts;
+                    item->status = attempts >= YOUTUBE_DOWNLOAD_ATTEMPTS ? YOUTUBE_STATUS_FAILED : YOUTUBE_STATUS_PENDING;
+                    youtube_index_set_slot(item->video_id, queue_count);
+                    queue_count++;
+                    break;
+                }
+                case 'P':
+                    if (slot < 0 || !rest || sscanf(rest, "%d|%d", &progress, &attempts) != 2) break;
+                    download_queue[slot].progress_percent = progress;
+                    download_queue[slot].attempts = attempts;
+                    download_queue[slot].status = attempts >= YOUTUBE_DOWNLOAD_ATTEMPTS ?
+                        YOUTUBE_STATUS_FAILED : YOUTUBE_STATUS_PENDING;
+                    break;
+                case 'D':
+                    youtube_index_set_downloaded(id);
+                    // Fall through - also off the queue
+                case 'R':
+                    if (slot >= 0) queue_remove_at(slot);
+                    break;
+                default:
+                    break;
             }
         }
         fclose(f);
     }
 
-    pthread_mutex_unlock(&queue_mutex);
+    // Compact a journal that's mostly stale (at most two lines per item, one per download)
+    journal_live_lines = queue_count * 2 + youtube_index_downloaded_count();
+    if (journal_lines > journal_live_lines * 2 + JOURNAL_SLACK_LINES) {
+        journal_compact();
+    }
 
+    pthread_mutex_unlock(&queue_mutex);
 }
 
 const char* YouTube_getDownloadPath(void) {
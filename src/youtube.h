@@ -9,6 +9,9 @@
 #define YOUTUBE_MAX_TITLE 256
 #define YOUTUBE_MAX_ARTIST 128
 #define YOUTUBE_VIDEO_ID_LEN 16
+#define YOUTUBE_DOWNLOAD_WORKERS_MAX 3
+#define YOUTUBE_DOWNLOAD_WORKERS_DEFAULT 2
+#define YOUTUBE_DOWNLOAD_ATTEMPTS 4          // Tries per item before it's marked failed
 
 // YouTube search result
 typedef struct {
@@ -26,12 +29,21 @@ typedef enum {
     YOUTUBE_STATUS_FAILED
 } YouTubeItemStatus;
 
+// Download file format
+typedef enum {
+    YOUTUBE_FORMAT_M4A = 0,     // YouTube's own AAC stream, remuxed only
+    YOUTUBE_FORMAT_MP3,         // Re-encoded with ffmpeg (slow on the device)
+    YOUTUBE_FORMAT_COUNT
+} YouTubeDownloadFormat;
+
 // Download queue item
 typedef struct {
     char video_id[YOUTUBE_VIDEO_ID_LEN];
     char title[YOUTUBE_MAX_TITLE];
     YouTubeItemStatus status;
-    int progress_percent;  // 0-100 during download
+    int progress_percent;  // 0-100 during download, kept with a partial download
+    int attempts;          // Failed tries so far
+    uint32_t retry_at;     // Monotonic seconds before which a failed try isn't retried
 } YouTubeQueueItem;
 
 // Module states
@@ -46,10 +58,12 @@ typedef enum {
 // Download status info
 typedef struct {
     YouTubeState state;
-    int current_index;           // Currently downloading item index
+    int current_index;           // First item downloading (-1 = none)
     int total_items;             // Total items in queue
     int completed_count;         // Number completed
     int failed_count;            // Number failed
+    int active_count;            // Items downloading right now
+    int progress_percent;        // Whole batch, 0-100
     char current_title[YOUTUBE_MAX_TITLE];
     char error_message[256];
 } YouTubeDownloadStatus;
@@ -64,11 +78,31 @@ typedef struct {
     char error_message[256];
 } YouTubeUpdateStatus;
 
+// Play now status
+typedef enum {
+    YOUTUBE_STREAM_IDLE = 0,
+    YOUTUBE_STREAM_STARTING,     // Waiting for the first seconds of audio
+    YOUTUBE_STREAM_READY,        // File playable while it's still being written
+    YOUTUBE_STREAM_COMPLETE,     // Whole track written and kept as a download
+    YOUTUBE_STREAM_FAILED
+} YouTubeStreamState;
+
+typedef struct {
+    YouTubeStreamState state;
+    char video_id[YOUTUBE_VIDEO_ID_LEN];
+    char filepath[512];          // MP3 being written, or the finished download
+    int duration_ms;             // From the search result (0 = unknown)
+    int progress_percent;        // Download, 0-100
+} YouTubeStreamStatus;
+
 // Initialize YouTube module
+// Without a saved version, yt-dlp is asked for it in the background (the version
+// reads "unknown" until it answers).
 // Returns 0 on success, -1 if yt-dlp not found
 int YouTube_init(void);
 
-// Cleanup resources
+// Exit: save the queue, then kill every yt-dlp and ffmpeg (by process group) and
+// stop the threads reading them; downloads and an update are abandoned
 void YouTube_cleanup(void);
 
 // Check if yt-dlp binary exists
@@ -77,14 +111,27 @@ bool YouTube_isAvailable(void);
 // Get yt-dlp version
 const char* YouTube_getVersion(void);
 
-// Search YouTube for music
+// Start searching YouTube for music in the background
 // query: search string
-// results: array to fill with results
 // max_results: maximum number of results (up to YOUTUBE_MAX_RESULTS)
-// Returns number of results found, or -1 on error
-int YouTube_search(const char* query, YouTubeResult* results, int max_results);
+// Results come from YouTube Music's search endpoint all at once, or when that
+// fails one by one as yt-dlp prints them, see YouTube_searchPoll.
+// Returns 0 if the search started, or -1 on error
+int YouTube_searchStart(const char* query, int max_results);
+
+// Copy the results found so far into results (YOUTUBE_MAX_RESULTS entries) and
+// *count. Returns true if they or the search state changed since the last poll
+// (redraw). *done is set once the search has finished. Main loop.
+bool YouTube_searchPoll(YouTubeResult* results, int* count, bool* done);
 
-// Cancel ongoing search
+// Keep a spare yt-dlp process started for searches (call when the YouTube menu
+// opens), so a search skips interpreter and extractor startup
+void YouTube_searchWarmup(void);
+
+// Stop the spare search process (call when the YouTube menu is left)
+void YouTube_searchRelease(void);
+
+// Cancel ongoing search, keeping the results found so far
 void YouTube_cancelSearch(void);
 
 // Queue management
@@ -100,13 +147,39 @@ bool YouTube_isInQueue(const char* video_id);
 bool YouTube_isDownloaded(const char* video_id);
 
 // Start downloading queue items (runs in background)
+// Items that failed every try are given another round.
 int YouTube_downloadStart(void);
 
 // Stop/cancel current download
 void YouTube_downloadStop(void);
 
-// Get download status
-const YouTubeDownloadStatus* YouTube_getDownloadStatus(void);
+// Play a search result while it downloads: yt-dlp pipes the audio into ffmpeg,
+// which writes an MP3 as it arrives. The file is READY to play (as a growing file)
+// after a few seconds of audio and is kept as a download once COMPLETE.
+// Replaces any earlier one. Returns 0 if started, -1 on error.
+int YouTube_streamStart(const YouTubeResult* result);
+
+// Stop the play now download (the partial file is deleted)
+void YouTube_streamStop(void);
+
+// Copy the play now status. Returns true if its state changed since the last poll.
+bool YouTube_streamPoll(YouTubeStreamStatus* status);
+
+// Downloads run in parallel (1 to YOUTUBE_DOWNLOAD_WORKERS_MAX, saved)
+void YouTube_setDownloadWorkers(int workers);
+int YouTube_getDownloadWorkers(void);
+
+// File format of new downloads (saved)
+void YouTube_setDownloadFormat(YouTubeDownloadFormat format);
+YouTubeDownloadFormat YouTube_getDownloadFormat(void);
+const char* YouTube_getDownloadFormatName(YouTubeDownloadFormat format);
+
+// Pause the downloads after the first one while set, e.g. while playback is short
+// of buffered audio (call from the main loop)
+void YouTube_setThrottle(bool throttle);
+
+// Copy the download status (consistent, without a lock)
+void YouTube_getDownloadStatus(YouTubeDownloadStatus* status);
 
 // yt-dlp update functions
 int YouTube_checkForUpdate(void);  // Check if new version available
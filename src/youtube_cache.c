@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "youtube_cache.h"
+#include "defines.h"
+#include "api.h"
+
+#define SEARCH_FILE_MAGIC 0x31535459    // "YTS1"
+#define SEARCH_FILE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t saved;             // Unix time
+    uint32_t count;             // Results following the header
+} SearchFileHeader;
+
+// Recently used searches, most recent first
+typedef struct {
+    uint64_t key;
+    uint32_t saved;
+    int count;
+    YouTubeResult results[YOUTUBE_MAX_RESULTS];
+} SearchEntry;
+
+static SearchEntry mru[YOUTUBE_CACHE_MRU];
+static int mru_count = 0;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Get search cache directory path
+static void get_cache_dir(char* path, int path_size) {
+    const char* home = getenv("HOME");
+    if (home) {
+        snprintf(path, path_size, "%s/.cache/youtube", home);
+    } else {
+        snprintf(path, path_size, "/tmp/youtube_cache");
+    }
+}
+
+// Ensure cache directory exists
+static void ensure_cache_dir(void) {
+    const char* home = getenv("HOME");
+    if (home) {
+        char parent_dir[512];
+        snprintf(parent_dir, sizeof(parent_dir), "%s/.cache", home);
+        mkdir(parent_dir, 0755);
+    }
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+    mkdir(cache_dir, 0755);
+}
+
+static void get_search_path(uint64_t key, char* path, int path_size) {
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+    snprintf(path, path_size, "%s/%016" PRIx64 ".bin", cache_dir, key);
+}
+
+// FNV-1a of the query lowercased, trimmed and with whitespace runs collapsed,
+// then the result count
+static uint64_t search_key(const char* query, int max_results) {
+    uint64_t hash = 14695981039346656037ULL;
+    bool space = false;
+    bool started = false;
+    for (const char* s = query; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (isspace(c)) {
+            space = started;
+            continue;
+        }
+        if (space) hash = (hash ^ ' ') * 1099511628211ULL;
+        hash = (hash ^ (uint8_t)tolower(c)) * 1099511628211ULL;
+        space = false;
+        started = true;
+    }
+    hash = (hash ^ 0x1F) * 1099511628211ULL;
+    return (hash ^ (uint8_t)max_results) * 1099511628211ULL;
+}
+
+// Move an entry to the front of the MRU, or add it there (cache mutex held)
+static void mru_put(const SearchEntry* entry) {
+    SearchEntry moved = *entry;  // May be one of the slots shifted below
+    int i = 0;
+    while (i < mru_count && mru[i].key != moved.key) i++;
+    if (i == mru_count) {
+        if (mru_count < YOUTUBE_CACHE_MRU) mru_count++;
+        i = mru_count - 1;  // Slot taken over: the least recently used when full
+    }
+    memmove(&mru[1], &mru[0], (size_t)i * sizeof(SearchEntry));
+    mru[0] = moved;
+}
+
+// Read the file of key into entry
+static bool read_search_file(uint64_t key, SearchEntry* entry) {
+    char path[768];
+    get_search_path(key, path, sizeof(path));
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+
+    SearchFileHeader header;
+    bool valid = fread(&header, sizeof(header), 1, f) == 1 && header.magic == SEARCH_FILE_MAGIC &&
+                 header.version == SEARCH_FILE_VERSION && header.count <= YOUTUBE_MAX_RESULTS &&
+                 fread(entry->results, sizeof(YouTubeResult), header.count, f) == header.count;
+    fclose(f);
+    if (!valid) {
+        unlink(path);
+        return false;
+    }
+
+    entry->key = key;
+    entry->saved = header.saved;
+    entry->count = (int)header.count;
+    for (int i = 0; i < entry->count; i++) {
+        // Strings as read may lack their terminator
+        YouTubeResult* r = &entry->results[i];
+        r->video_id[YOUTUBE_VIDEO_ID_LEN - 1] = '\0';
+        r->title[YOUTUBE_MAX_TITLE - 1] = '\0';
+        r->artist[YOUTUBE_MAX_ARTIST - 1] = '\0';
+    }
+    return true;
+}
+
+// Remove the oldest files beyond YOUTUBE_CACHE_MAX_FILES
+static void prune_files(void) {
+    char cache_dir[512];
+    get_cache_dir(cache_dir, sizeof(cache_dir));
+    DIR* dir = opendir(cache_dir);
+    if (!dir) return;
+
+    int count = 0;
+    char oldest_path[768] = "";
+    time_t oldest_time = 0;
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] == '.') continue;
+        char filepath[768];
+        struct stat st;
+        snprintf(filepath, sizeof(filepath), "%s/%s", cache_dir, ent->d_name);
+        if (stat(filepath, &st) != 0) continue;
+        count++;
+        if (!oldest_path[0] || st.st_mtime < oldest_time) {
+            snprintf(oldest_path, sizeof(oldest_path), "%s", filepath);
+            oldest_time = st.st_mtime;
+        }
+    }
+    closedir(dir);
+
+    // One search is stored at a time, so at most one file is over
+    if (count > YOUTUBE_CACHE_MAX_FILES) unlink(oldest_path);
+}
+
+YouTubeCacheResult youtube_cache_lookup(const char* query, int max_results, YouTubeResult* results, int* count) {
+    uint64_t key = search_key(query, max_results);
+
+    pthread_mutex_lock(&cache_mutex);
+    int i = 0;
+    while (i < mru_count && mru[i].key != key) i++;
+    if (i < mru_count) {
+        mru_put(&mru[i]);
+    } else {
+        SearchEntry entry;
+        if (!read_search_file(key, &entry)) {
+            pthread_mutex_unlock(&cache_mutex);
+            return YOUTUBE_CACHE_MISS;
+        }
+        mru_put(&entry);
+    }
+
+    memcpy(results, mru[0].results, (size_t)mru[0].count * sizeof(YouTubeResult));
+    *count = mru[0].count;
+    // Also expired if the clock went back (no RTC)
+    uint32_t now = (uint32_t)time(NULL);
+    bool fresh = now >= mru[0].saved && now - mru[0].saved < YOUTUBE_CACHE_TTL;
+    pthread_mutex_unlock(&cache_mutex);
+    return fresh ? YOUTUBE_CACHE_FRESH : YOUTUBE_CACHE_STALE;
+}
+
+void youtube_cache_store(const char* query, int max_results, const YouTubeResult* results, int count) {
+    if (count <= 0) return;
+    if (count > YOUTUBE_MAX_RESULTS) count = YOUTUBE_MAX_RESULTS;
+
+    SearchEntry entry;
+    entry.key = search_key(query, max_results);
+    entry.saved = (uint32_t)time(NULL);
+    entry.count = count;
+    memcpy(entry.results, results, (size_t)count * sizeof(YouTubeResult));
+
+    pthread_mutex_lock(&cache_mutex);
+    mru_put(&entry);
+    pthread_mutex_unlock(&cache_mutex);
+
+    // Written through a temp file, so a torn write never replaces good results
+    ensure_cache_dir();
+    char path[768], tmp_path[800];
+    get_search_path(entry.key, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE* f = fopen(tmp_path, "wb");
+    if (!f) return;
+
+    SearchFileHeader header = {SEARCH_FILE_MAGIC, SEARCH_FILE_VERSION, entry.saved, (uint32_t)count};
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(results, sizeof(YouTubeResult), count, f) == (size_t)count;
+    ok = fclose(f) == 0 && ok;
+    if (ok && rename(tmp_path, path) == 0) {
+        prune_files();
+    } else {
+        LOG_error("YouTube: cannot write %s\n", path);
+        unlink(tmp_path);
+    }
+}
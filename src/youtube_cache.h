@@ -0,0 +1,31 @@
+#ifndef __YOUTUBE_CACHE_H__
+#define __YOUTUBE_CACHE_H__
+
+#include "youtube.h"
+
+// YouTube search cache
+// Results of recent searches (video ID, title, duration, channel), keyed by the
+// normalized query and the number of results asked for. The latest
+// YOUTUBE_CACHE_MRU are kept in memory and all of them as files, up to
+// YOUTUBE_CACHE_MAX_FILES (oldest removed first). Results older than
+// YOUTUBE_CACHE_TTL are searched again, but still serve a search that failed
+// (offline). Safe from any thread.
+
+#define YOUTUBE_CACHE_TTL (24 * 60 * 60)    // Seconds
+#define YOUTUBE_CACHE_MRU 8
+#define YOUTUBE_CACHE_MAX_FILES 64
+
+typedef enum {
+    YOUTUBE_CACHE_MISS,         // Not cached: search
+    YOUTUBE_CACHE_FRESH,        // Results within the TTL
+    YOUTUBE_CACHE_STALE         // Expired results: search, fall back to these
+} YouTubeCacheResult;
+
+// Look up the results of query; on a hit they are copied to results (up to
+// YOUTUBE_MAX_RESULTS) and *count
+YouTubeCacheResult youtube_cache_lookup(const char* query, int max_results, YouTubeResult* results, int* count);
+
+// Store the results of query
+void youtube_cache_store(const char* query, int max_results, const YouTubeResult* results, int count);
+
+#endif
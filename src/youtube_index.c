@@ -0,0 +1,129 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "youtube_index.h"
+#include "youtube.h"
+
+// An entry is published by setting used last: lookups racing an insert either
+// see the whole entry or stop at the empty slot
+typedef struct {
+    char video_id[YOUTUBE_VIDEO_ID_LEN];
+    int slot;                   // Queue slot, -1 = not queued
+    uint32_t downloaded;        // Order it was downloaded in, 0 = not downloaded
+    bool used;
+} IndexEntry;
+
+#define INDEX_LIMIT (YOUTUBE_INDEX_SIZE * 3 / 4)     // Entries in use, keeps probes short
+
+static IndexEntry entries[YOUTUBE_INDEX_SIZE];
+static int entry_count = 0;
+static uint32_t downloaded_seq = 0;
+
+static uint32_t hash_id(const char* video_id) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (const char* p = video_id; *p; p++) {
+        hash ^= (uint8_t)*p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static IndexEntry* find(const char* video_id) {
+    uint32_t i = hash_id(video_id) & (YOUTUBE_INDEX_SIZE - 1);
+    for (int probes = 0; probes < YOUTUBE_INDEX_SIZE; probes++) {
+        IndexEntry* entry = &entries[i];
+        if (!__atomic_load_n(&entry->used, __ATOMIC_ACQUIRE)) return NULL;
+        if (strcmp(entry->video_id, video_id) == 0) return entry;
+        i = (i + 1) & (YOUTUBE_INDEX_SIZE - 1);
+    }
+    return NULL;
+}
+
+// Find or add video_id, keeping at most limit entries in use. A new ID takes the
+// first free or dead (not queued, not downloaded) entry on its probe path: lookups
+// walk over entries in use either way, so reusing one keeps every chain intact.
+static IndexEntry* find_or_add(const char* video_id, int limit) {
+    IndexEntry* entry = find(video_id);
+    if (entry) return entry;
+
+    uint32_t i = hash_id(video_id) & (YOUTUBE_INDEX_SIZE - 1);
+    while (entries[i].used && (entries[i].slot >= 0 || entries[i].downloaded)) {
+        i = (i + 1) & (YOUTUBE_INDEX_SIZE - 1);
+    }
+    entry = &entries[i];
+    bool reuse = entry->used;
+    if (!reuse && entry_count >= limit) return NULL;
+
+    strncpy(entry->video_id, video_id, YOUTUBE_VIDEO_ID_LEN - 1);
+    entry->video_id[YOUTUBE_VIDEO_ID_LEN - 1] = '\0';
+    entry->slot = -1;
+    entry->downloaded = 0;
+    if (!reuse) {
+        __atomic_store_n(&entry->used, true, __ATOMIC_RELEASE);
+        entry_count++;
+    }
+    return entry;
+}
+
+void youtube_index_clear(void) {
+    memset(entries, 0, sizeof(entries));
+    entry_count = 0;
+    downloaded_seq = 0;
+}
+
+void youtube_index_set_slot(const char* video_id, int slot) {
+    if (!video_id || !video_id[0]) return;
+    // Unqueuing an unknown ID leaves nothing to record
+    IndexEntry* entry = slot < 0 ? find(video_id) : find_or_add(video_id, INDEX_LIMIT);
+    if (entry) __atomic_store_n(&entry->slot, slot, __ATOMIC_RELAXED);
+}
+
+int youtube_index_slot(const char* video_id) {
+    if (!video_id) return -1;
+    IndexEntry* entry = find(video_id);
+    return entry ? __atomic_load_n(&entry->slot, __ATOMIC_RELAXED) : -1;
+}
+
+void youtube_index_set_downloaded(const char* video_id) {
+    if (!video_id || !video_id[0]) return;
+    // Leaves room for a full queue
+    IndexEntry* entry = find_or_add(video_id, INDEX_LIMIT - YOUTUBE_MAX_QUEUE);
+    if (entry) __atomic_store_n(&entry->downloaded, ++downloaded_seq, __ATOMIC_RELAXED);
+}
+
+bool youtube_index_downloaded(const char* video_id) {
+    if (!video_id) return false;
+    IndexEntry* entry = find(video_id);
+    return entry && __atomic_load_n(&entry->downloaded, __ATOMIC_RELAXED) != 0;
+}
+
+int youtube_index_downloaded_count(void) {
+    int count = 0;
+    for (int i = 0; i < YOUTUBE_INDEX_SIZE; i++) {
+        if (entries[i].used && entries[i].downloaded) count++;
+    }
+    return count < YOUTUBE_INDEX_DOWNLOADED_MAX ? count : YOUTUBE_INDEX_DOWNLOADED_MAX;
+}
+
+static int compare_downloaded(const void* a, const void* b) {
+    uint32_t x = (*(const IndexEntry* const*)a)->downloaded;
+    uint32_t y = (*(const IndexEntry* const*)b)->downloaded;
+    return (x > y) - (x < y);
+}
+
+void youtube_index_each_downloaded(void (*fn)(const char* video_id, void* user), void* user) {
+    IndexEntry** sorted = malloc(sizeof(IndexEntry*) * YOUTUBE_INDEX_SIZE);
+    if (!sorted) return;
+    int count = 0;
+    for (int i = 0; i < YOUTUBE_INDEX_SIZE; i++) {
+        if (entries[i].used && entries[i].downloaded) sorted[count++] = &entries[i];
+    }
+    qsort(sorted, count, sizeof(IndexEntry*), compare_downloaded);
+
+    int first = count > YOUTUBE_INDEX_DOWNLOADED_MAX ? count - YOUTUBE_INDEX_DOWNLOADED_MAX : 0;
+    for (int i = first; i < count; i++) {
+        fn(sorted[i]->video_id, user);
+    }
+    free(sorted);
+}
@@ -0,0 +1,37 @@
+#ifndef __YOUTUBE_INDEX_H__
+#define __YOUTUBE_INDEX_H__
+
+#include <stdbool.h>
+
+// YouTube video index
+// Video IDs the YouTube module knows about, with their download queue slot and
+// whether they have been downloaded, in an open-addressed hash table. Lookups
+// take no lock and make no syscalls, so result lists can show their badges
+// every frame. Updates come from one thread at a time (the caller holds the
+// queue lock). Entries of IDs neither queued nor downloaded are reused.
+
+#define YOUTUBE_INDEX_SIZE 1024             // Slots, a power of two
+#define YOUTUBE_INDEX_DOWNLOADED_MAX 512    // Downloaded IDs kept across sessions
+
+// Forget everything
+void youtube_index_clear(void);
+
+// Set the queue slot of video_id (-1 = not queued)
+void youtube_index_set_slot(const char* video_id, int slot);
+
+// Queue slot of video_id, or -1 if it isn't queued
+int youtube_index_slot(const char* video_id);
+
+// Mark video_id downloaded
+void youtube_index_set_downloaded(const char* video_id);
+
+bool youtube_index_downloaded(const char* video_id);
+
+// Number of downloaded IDs (up to YOUTUBE_INDEX_DOWNLOADED_MAX)
+int youtube_index_downloaded_count(void);
+
+// Call fn for every downloaded ID, oldest first (at most YOUTUBE_INDEX_DOWNLOADED_MAX,
+// the most recent ones)
+void youtube_index_each_downloaded(void (*fn)(const char* video_id, void* user), void* user);
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "youtube_search.h"
+#include "radio_net.h"
+#include "trace.h"
+#include "defines.h"
+#include "api.h"
+#include "include/parson/parson.h"
+
+#define SEARCH_WALK_DEPTH_MAX 32
+
+typedef struct {
+    YouTubeResult* results;
+    int max;
+    int count;
+    int items;                  // Result rows seen, readable or not
+} SearchParse;
+
+// Text of a flex column: its runs joined, or the first run only
+static void column_text(JSON_Array* columns, size_t column, bool first_run, char* out, size_t size) {
+    out[0] = '\0';
+    JSON_Object* col = json_object_get_object(json_array_get_object(columns, column),
+                                              "musicResponsiveListItemFlexColumnRenderer");
+    JSON_Array* runs = json_object_dotget_array(col, "text.runs");
+    size_t len = 0;
+    for (size_t i = 0; i < json_array_get_count(runs) && len + 1 < size; i++) {
+        const char* text = json_object_get_string(json_array_get_object(runs, i), "text");
+        if (!text) continue;
+        len += snprintf(out + len, size - len, "%s", text);
+        if (first_run) break;
+    }
+    if (len >= size) out[size - 1] = '\0';
+}
+
+// Last "m:ss" or "h:mm:ss" run of a flex column, in seconds (0 = none)
+static int column_duration(JSON_Array* columns, size_t column) {
+    JSON_Object* col = json_object_get_object(json_array_get_object(columns, column),
+                                              "musicResponsiveListItemFlexColumnRenderer");
+    JSON_Array* runs = json_object_dotget_array(col, "text.runs");
+    for (size_t i = json_array_get_count(runs); i > 0; i--) {
+        const char* text = json_object_get_string(json_array_get_object(runs, i - 1), "text");
+        int h = 0, m = 0, s = 0;
+        char end;
+        if (!text) continue;
+        if (sscanf(text, "%d:%d:%d%c", &h, &m, &s, &end) == 3) return h * 3600 + m * 60 + s;
+        if (sscanf(text, "%d:%d%c", &m, &s, &end) == 2) return m * 60 + s;
+    }
+    return 0;
+}
+
+// One result row: title and video in the first column, "Artist • Album • 3:45"
+// in the second
+static void parse_item(JSON_Object* item, SearchParse* p) {
+    const char* video_id = json_object_dotget_string(item, "playlistItemData.videoId");
+    JSON_Array* columns = json_object_get_array(item, "flexColumns");
+    if (!video_id) {
+        JSON_Object* col = json_object_get_object(json_array_get_object(columns, 0),
+                                                  "musicResponsiveListItemFlexColumnRenderer");
+        JSON_Array* runs = json_object_dotget_array(col, "text.runs");
+        video_id = json_object_dotget_string(json_array_get_object(runs, 0),
+                                             "navigationEndpoint.watchEndpoint.videoId");
+    }
+    if (!video_id || !video_id[0] || strlen(video_id) >= YOUTUBE_VIDEO_ID_LEN) return;
+
+    YouTubeResult* result = &p->results[p->count];
+    memset(result, 0, sizeof(*result));
+    snprintf(result->video_id, sizeof(result->video_id), "%s", video_id);
+    column_text(columns, 0, false, result->title, sizeof(result->title));
+    if (!result->title[0]) return;
+    column_text(columns, 1, true, result->artist, sizeof(result->artist));
+    result->duration_sec = column_duration(columns, 1);
+    p->count++;
+}
+
+// Find the result rows wherever the answer nests them
+static void walk(const JSON_Value* value, SearchParse* p, int depth) {
+    if (p->count >= p->max || depth > SEARCH_WALK_DEPTH_MAX) return;
+    if (json_value_get_type(value) == JSONArray) {
+        JSON_Array* array = json_value_get_array(value);
+        for (size_t i = 0; i < json_array_get_count(array) && p->count < p->max; i++) {
+            walk(json_array_get_value(array, i), p, depth + 1);
+        }
+    } else if (json_value_get_type(value) == JSONObject) {
+        JSON_Object* obj = json_value_get_object(value);
+        JSON_Object* item = json_object_get_object(obj, "musicResponsiveListItemRenderer");
+        if (item) {
+            p->items++;
+            parse_item(item, p);
+            return;
+        }
+        for (size_t i = 0; i < json_object_get_count(obj) && p->count < p->max; i++) {
+            walk(json_object_get_value_at(obj, i), p, depth + 1);
+        }
+    }
+}
+
+// Request body: the web app's client and the query, filtered to songs
+static char* request_body(const char* query) {
+    JSON_Value* root = json_value_init_object();
+    JSON_Object* obj = json_value_get_object(root);
+    if (!obj) {
+        json_value_free(root);
+        return NULL;
+    }
+    json_object_dotset_string(obj, "context.client.clientName", "WEB_REMIX");
+    json_object_dotset_string(obj, "context.client.clientVersion", YOUTUBE_SEARCH_CLIENT_VERSION);
+    json_object_dotset_string(obj, "context.client.hl", "en");
+    json_object_set_string(obj, "query", query);
+    json_object_set_string(obj, "params", YOUTUBE_SEARCH_SONGS);
+    char* body = json_serialize_to_string(root);
+    json_value_free(root);
+    return body;
+}
+
+int youtube_search_native(const char* query, int max_results, YouTubeResult* results) {
+    TRACE_SCOPE("youtube_search_native");
+    if (!query || !query[0] || max_results <= 0) return 0;
+    if (!radio_net_online()) return YOUTUBE_SEARCH_ERR_NETWORK;
+
+    char* request = request_body(query);
+    if (!request) return YOUTUBE_SEARCH_ERR_NETWORK;
+    RadioNetBody body = {0};
+    RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_YOUTUBE);
+    int len = radio_net_postBody(YOUTUBE_SEARCH_URL, "application/json", request,
+                                 "Origin: https://music.youtube.com\r\n", &body, YOUTUBE_SEARCH_MAX_BYTES);
+    radio_net_setAccount(account);
+    json_free_serialized_string(request);
+    if (len <= 0) {
+        radio_net_freeBody(&body);
+        return YOUTUBE_SEARCH_ERR_NETWORK;
+    }
+
+    JSON_Value* root = json_parse_string((const char*)body.data);
+    radio_net_freeBody(&body);
+    if (!root) return YOUTUBE_SEARCH_ERR_FORMAT;
+
+    SearchParse p = {results, max_results, 0, 0};
+    walk(root, &p, 0);
+    // No rows in an answer with contents: nothing found. Rows we can't read, or
+    // no contents at all: the format changed.
+    bool empty = p.items == 0 && json_object_dotget_value(json_value_get_object(root), "contents") != NULL;
+    json_value_free(root);
+    if (p.count == 0 && (p.items > 0 || !empty)) return YOUTUBE_SEARCH_ERR_FORMAT;
+    return p.count;
+}
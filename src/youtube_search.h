@@ -0,0 +1,23 @@
+#ifndef __YOUTUBE_SEARCH_H__
+#define __YOUTUBE_SEARCH_H__
+
+#include "youtube.h"
+
+// Native YouTube search
+// Asks YouTube Music's search endpoint (the one its web app uses, filtered to
+// songs) for results over the in-process HTTPS client and reads them out of the
+// JSON answer, without starting yt-dlp. Any thread.
+
+#define YOUTUBE_SEARCH_URL "https://music.youtube.com/youtubei/v1/search?prettyPrint=false"
+#define YOUTUBE_SEARCH_CLIENT_VERSION "1.20240918.01.00"
+#define YOUTUBE_SEARCH_SONGS "EgWKAQIIAWoMEA4QChADEAQQCRAF"   // Search params: songs only
+#define YOUTUBE_SEARCH_MAX_BYTES (2 * 1024 * 1024)
+
+#define YOUTUBE_SEARCH_ERR_NETWORK -1           // No answer: offline, or the request failed
+#define YOUTUBE_SEARCH_ERR_FORMAT -2            // An answer we can't read (the API changed)
+
+// Search for query; up to max_results go to results
+// Returns their count, or a YOUTUBE_SEARCH_ERR_* code.
+int youtube_search_native(const char* query, int max_results, YouTubeResult* results);
+
+#endif
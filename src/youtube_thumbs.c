@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+
+#include "youtube_thumbs.h"
+#include "radio_net.h"
+#include "jobs.h"
+#include "memstats.h"
+#include "art_scale.h"
+#include "defines.h"
+#include "api.h"
+
+typedef enum {
+    THUMB_FREE,
+    THUMB_LOADING,
+    THUMB_READY,
+    THUMB_FAILED                // Not tried again while cached
+} ThumbState;
+
+typedef struct {
+    char video_id[YOUTUBE_VIDEO_ID_LEN];
+    uint8_t state;              // ThumbState
+    bool cancelled;             // Loading, but out of the window
+    int height;                 // Loaded (or loading) at
+    uint32_t used;              // LRU clock
+    uint32_t load;              // Id of its load
+    JobToken* token;
+    SDL_Surface* surface;
+} ThumbEntry;
+
+// One thumbnail being fetched, owned by its job
+typedef struct {
+    uint32_t load;
+    char url[128];
+    int height;
+    SDL_Surface* surface;       // Result
+} ThumbLoad;
+
+typedef struct {
+    RadioNetBody* body;
+    JobToken* token;
+} ThumbSink;
+
+static ThumbEntry cache[YOUTUBE_THUMBS_CACHE_MAX];
+static uint32_t cache_clock = 0;
+static uint32_t view_clock = 0;     // cache_clock as the last view began
+static uint32_t load_counter = 0;
+static int loads_running = 0;
+static bool updated = false;
+
+static ThumbEntry* find_entry(const char* video_id) {
+    for (int i = 0; i < YOUTUBE_THUMBS_CACHE_MAX; i++) {
+        if (cache[i].state != THUMB_FREE && strcmp(cache[i].video_id, video_id) == 0) return &cache[i];
+    }
+    return NULL;
+}
+
+static void free_entry(ThumbEntry* entry) {
+    if (entry->surface) {
+        MEM_SURFACE_SUB(MEM_TAG_THUMBS, entry->surface);
+        SDL_FreeSurface(entry->surface);
+    }
+    memset(entry, 0, sizeof(*entry));
+}
+
+// Body bytes as they arrive; a cancelled load stops the transfer
+static bool on_thumb_data(void* ctx, const uint8_t* data, int len) {
+    ThumbSink* sink = (ThumbSink*)ctx;
+    if (Jobs_cancelled(sink->token)) return false;
+    return radio_net_bodyAppend(sink->body, data, len, YOUTUBE_THUMBS_MAX_BYTES);
+}
+
+// Decode an image and shrink it to height, keeping its aspect
+static SDL_Surface* decode_thumb(const uint8_t* data, int len, int height) {
+    SDL_RWops* rw = SDL_RWFromConstMem(data, len);
+    if (!rw) return NULL;
+    SDL_Surface* image = IMG_Load_RW(rw, 1);  // 1 = auto-close RWops
+    if (!image) return NULL;
+    SDL_Surface* thumb = image->h > 0 ? ArtScale_scale(image, NULL, image->w * height / image->h, height) : NULL;
+    SDL_FreeSurface(image);
+    return thumb;
+}
+
+static void thumb_job(void* arg, JobToken* token) {
+    ThumbLoad* load = (ThumbLoad*)arg;
+    RadioNetBody body = {0};
+    ThumbSink sink = {&body, token};
+    RadioNetAccount account = radio_net_setAccount(RADIO_NET_ACCOUNT_YOUTUBE);
+    if (radio_net_fetchStream(load->url, on_thumb_data, &sink) > 0 && !Jobs_cancelled(token)) {
+        load->surface = decode_thumb(body.data, body.len, load->height);
+    }
+    radio_net_setAccount(account);
+    radio_net_freeBody(&body);
+}
+
+static void thumb_done(void* arg, bool cancelled) {
+    ThumbLoad* load = (ThumbLoad*)arg;
+    loads_running--;
+
+    ThumbEntry* entry = NULL;
+    for (int i = 0; i < YOUTUBE_THUMBS_CACHE_MAX; i++) {
+        if (cache[i].state == THUMB_LOADING && cache[i].load == load->load) entry = &cache[i];
+    }
+    if (entry) {
+        Jobs_release(entry->token);
+        entry->token = NULL;
+        if (cancelled || entry->cancelled) {
+            free_entry(entry);      // Loaded again if it comes back into view
+        } else if (load->surface) {
+            entry->surface = load->surface;
+            MEM_SURFACE_ADD(MEM_TAG_THUMBS, entry->surface);
+            load->surface = NULL;
+            entry->state = THUMB_READY;
+        } else {
+            entry->state = THUMB_FAILED;
+        }
+        updated = true;
+    }
+    if (load->surface) SDL_FreeSurface(load->surface);
+    free(load);
+}
+
+// Take an entry for video_id: a free one, else the least recently drawn one
+// that isn't loading
+static ThumbEntry* take_entry(void) {
+    ThumbEntry* victim = NULL;
+    for (int i = 0; i < YOUTUBE_THUMBS_CACHE_MAX; i++) {
+        ThumbEntry* entry = &cache[i];
+        if (entry->state == THUMB_FREE) return entry;
+        if (entry->state == THUMB_LOADING) continue;
+        if (!victim || entry->used < victim->used) victim = entry;
+    }
+    if (victim) free_entry(victim);
+    return victim;
+}
+
+static void start_load(const char* video_id, int height, JobPriority priority) {
+    ThumbEntry* entry = take_entry();
+    if (!entry) return;
+    ThumbLoad* load = calloc(1, sizeof(ThumbLoad));
+    if (!load) return;
+    load->load = ++load_counter;
+    load->height = height;
+    snprintf(load->url, sizeof(load->url), YOUTUBE_THUMB_URL, video_id);
+
+    JobToken* token = Jobs_submit(priority, thumb_job, thumb_done, load);
+    if (!token) {
+        free(load);
+        return;
+    }
+    snprintf(entry->video_id, sizeof(entry->video_id), "%s", video_id);
+    entry->state = THUMB_LOADING;
+    entry->height = height;
+    entry->used = ++cache_clock;
+    entry->load = load->load;
+    entry->token = token;
+    loads_running++;
+}
+
+static bool in_window(const YouTubeResult* results, int first, int last, const char* video_id) {
+    for (int i = first; i < last; i++) {
+        if (strcmp(results[i].video_id, video_id) == 0) return true;
+    }
+    return false;
+}
+
+void YouTubeThumbs_view(const YouTubeResult* results, int result_count, int first, int count, int height) {
+    if (first < 0) first = 0;
+    int visible = first + count < result_count ? first + count : result_count;
+    int last = visible + YOUTUBE_THUMBS_LOOKAHEAD < result_count ? visible + YOUTUBE_THUMBS_LOOKAHEAD : result_count;
+    view_clock = cache_clock;
+
+    // Rows that scrolled out of the window (or a new row height) stop loading
+    for (int i = 0; i < YOUTUBE_THUMBS_CACHE_MAX; i++) {
+        ThumbEntry* entry = &cache[i];
+        if (entry->state != THUMB_LOADING || entry->cancelled) continue;
+        if (entry->height != height || !results || !in_window(results, first, last, entry->video_id)) {
+            Jobs_cancel(entry->token);
+            entry->cancelled = true;
+        }
+    }
+
+    // Rows on screen first, then the look-ahead
+    for (int i = first; i < last; i++) {
+        ThumbEntry* entry = find_entry(results[i].video_id);
+        if (entry && entry->state != THUMB_LOADING && entry->height != height) {
+            free_entry(entry);
+            entry = NULL;
+        }
+        if (entry) {
+            if (!entry->cancelled) entry->used = ++cache_clock;
+            continue;
+        }
+        if (loads_running >= YOUTUBE_THUMBS_LOADS_MAX) break;
+        start_load(results[i].video_id, height, i < visible ? JOB_PRIORITY_INTERACTIVE : JOB_PRIORITY_BACKGROUND);
+    }
+}
+
+SDL_Surface* YouTubeThumbs_get(const char* video_id) {
+    ThumbEntry* entry = find_entry(video_id);
+    if (!entry || entry->state != THUMB_READY) return NULL;
+    entry->used = ++cache_clock;
+    return entry->surface;
+}
+
+bool YouTubeThumbs_takeUpdate(void) {
+    bool result = updated;
+    updated = false;
+    return result;
+}
+
+size_t YouTubeThumbs_shed(void) {
+    size_t bytes = 0;
+    for (int i = 0; i < YOUTUBE_THUMBS_CACHE_MAX; i++) {
+        ThumbEntry* entry = &cache[i];
+        if (entry->state == THUMB_FREE || entry->state == THUMB_LOADING || entry->used > view_clock) continue;
+        if (entry->surface) bytes += (size_t)entry->surface->pitch * entry->surface->h;
+        free_entry(entry);
+    }
+    return bytes;
+}
+
+void YouTubeThumbs_quit(void) {
+    for (int i = 0; i < YOUTUBE_THUMBS_CACHE_MAX; i++) {
+        if (cache[i].token) {
+            Jobs_cancel(cache[i].token);
+            Jobs_release(cache[i].token);
+        }
+        free_entry(&cache[i]);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef __YOUTUBE_THUMBS_H__
+#define __YOUTUBE_THUMBS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "youtube.h"
+
+// Forward declaration for SDL_Surface
+struct SDL_Surface;
+
+// YouTube result thumbnails
+// Only the rows on screen and YOUTUBE_THUMBS_LOOKAHEAD past them are fetched: the
+// small mqdefault image, over the keep-alive HTTP pool, on the jobs pool, and
+// shrunk to the row height. Rows that scroll out of that window have their loads
+// cancelled. The last YOUTUBE_THUMBS_CACHE_MAX thumbnails are kept (least
+// recently drawn evicted first), so scrolling back costs nothing.
+// All functions are for the main thread.
+
+#define YOUTUBE_THUMB_URL "https://i.ytimg.com/vi/%s/mqdefault.jpg"
+#define YOUTUBE_THUMBS_LOOKAHEAD 3
+#define YOUTUBE_THUMBS_CACHE_MAX 24
+#define YOUTUBE_THUMBS_LOADS_MAX 4
+#define YOUTUBE_THUMBS_MAX_BYTES (256 * 1024)
+
+// Rows first .. first + count - 1 of results are on screen, with thumbnails
+// height pixels tall: load theirs and the look-ahead's, cancel the rest
+void YouTubeThumbs_view(const YouTubeResult* results, int result_count, int first, int count, int height);
+
+// Thumbnail of video_id if loaded (owned by the cache, valid until the next view)
+struct SDL_Surface* YouTubeThumbs_get(const char* video_id);
+
+// True once per batch of thumbnails loaded since the last call (redraw)
+bool YouTubeThumbs_takeUpdate(void);
+
+// Free the thumbnails the last view didn't draw or look ahead to (memory is
+// short); loads carry on. Returns the bytes freed.
+size_t YouTubeThumbs_shed(void);
+
+// Cancel loads and free the thumbnails (before Jobs_quit)
+void YouTubeThumbs_quit(void);
+
+#endif